@@ -43,11 +43,22 @@ static int list_dependencies_print(
 
 static int list_dependencies_get_dependencies(sd_bus *bus, const char *name, char ***deps) {
         _cleanup_free_ char *path = NULL;
+        UnitTimes *times;
 
         assert(bus);
         assert(name);
         assert(deps);
 
+        /* The ordering dependencies of all units that were started were already acquired together with their
+         * timestamps, hence only ask the service manager about the others. */
+        times = hashmap_get(unit_times_hashmap, name);
+        if (times) {
+                if (strv_copy_unless_empty(times->deps[UNIT_AFTER], deps) < 0)
+                        return -ENOMEM;
+
+                return 0;
+        }
+
         path = unit_dbus_path_from_name(name);
         if (!path)
                 return -ENOMEM;
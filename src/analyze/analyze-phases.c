@@ -0,0 +1,220 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include "analyze.h"
+#include "analyze-phases.h"
+#include "bus-error.h"
+#include "bus-locator.h"
+#include "format-table.h"
+#include "stdio-util.h"
+
+static int dump_phases(sd_bus *bus) {
+        _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        _cleanup_(table_unrefp) Table *table = NULL;
+        int r;
+
+        assert(bus);
+
+        r = bus_get_property(bus, bus_systemd_mgr, "Phases", &error, &reply, "a(stttt)");
+        if (r < 0)
+                return log_error_errno(r, "Failed to get Phases property: %s", bus_error_message(&error, r));
+
+        table = table_new("phase", "first start", "last finish", "total", "runs");
+        if (!table)
+                return log_oom();
+
+        for (size_t i = 1; i < 5; i++)
+                (void) table_set_align_percent(table, TABLE_HEADER_CELL(i), 100);
+
+        /* Show the phases in the order they were first entered in */
+        r = table_set_sort(table, (size_t) 1, (size_t) 0);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_enter_container(reply, 'a', "(stttt)");
+        if (r < 0)
+                return bus_log_parse_error(r);
+
+        for (;;) {
+                uint64_t first_start, last_finish, total, n_runs;
+                const char *name;
+
+                r = sd_bus_message_read(reply, "(stttt)", &name, &first_start, &last_finish, &total, &n_runs);
+                if (r < 0)
+                        return bus_log_parse_error(r);
+                if (r == 0)
+                        break;
+
+                if (n_runs == 0)
+                        continue;
+
+                r = table_add_many(table,
+                                   TABLE_STRING, name,
+                                   TABLE_TIMESPAN_MSEC, first_start,
+                                   TABLE_SET_ALIGN_PERCENT, 100,
+                                   TABLE_TIMESPAN_MSEC, last_finish,
+                                   TABLE_SET_ALIGN_PERCENT, 100,
+                                   TABLE_TIMESPAN_MSEC, total,
+                                   TABLE_SET_ALIGN_PERCENT, 100,
+                                   TABLE_UINT64, n_runs,
+                                   TABLE_SET_ALIGN_PERCENT, 100);
+                if (r < 0)
+                        return table_log_add_error(r);
+        }
+
+        r = sd_bus_message_exit_container(reply);
+        if (r < 0)
+                return bus_log_parse_error(r);
+
+        return table_print_with_pager(table, arg_json_format_flags, arg_pager_flags, /* show_header= */ true);
+}
+
+static int dump_generators(sd_bus *bus) {
+        _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        _cleanup_(table_unrefp) Table *table = NULL;
+        int r;
+
+        assert(bus);
+
+        r = bus_get_property(bus, bus_systemd_mgr, "Generators", &error, &reply, "a(sttib)");
+        if (r < 0)
+                return log_error_errno(r, "Failed to get Generators property: %s", bus_error_message(&error, r));
+
+        table = table_new("generator", "start", "duration", "result");
+        if (!table)
+                return log_oom();
+
+        for (size_t i = 1; i < 3; i++)
+                (void) table_set_align_percent(table, TABLE_HEADER_CELL(i), 100);
+
+        /* Show the slowest generators first */
+        r = table_set_sort(table, (size_t) 2, (size_t) 0);
+        if (r < 0)
+                return r;
+
+        r = table_set_reverse(table, 2, true);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_enter_container(reply, 'a', "(sttib)");
+        if (r < 0)
+                return bus_log_parse_error(r);
+
+        for (;;) {
+                uint64_t start, duration;
+                const char *name;
+                int exit_status, reused;
+                char result[STRLEN("exit-status-") + DECIMAL_STR_MAX(int)];
+
+                r = sd_bus_message_read(reply, "(sttib)", &name, &start, &duration, &exit_status, &reused);
+                if (r < 0)
+                        return bus_log_parse_error(r);
+                if (r == 0)
+                        break;
+
+                if (reused)
+                        strcpy(result, "reused");
+                else if (exit_status == 0)
+                        strcpy(result, "success");
+                else if (exit_status > 0)
+                        xsprintf(result, "exit-status-%i", exit_status);
+                else
+                        strcpy(result, "failed");
+
+                r = table_add_many(table,
+                                   TABLE_STRING, name,
+                                   TABLE_TIMESPAN_MSEC, start,
+                                   TABLE_SET_ALIGN_PERCENT, 100,
+                                   TABLE_TIMESPAN_MSEC, duration,
+                                   TABLE_SET_ALIGN_PERCENT, 100,
+                                   TABLE_STRING, result);
+                if (r < 0)
+                        return table_log_add_error(r);
+        }
+
+        r = sd_bus_message_exit_container(reply);
+        if (r < 0)
+                return bus_log_parse_error(r);
+
+        if (table_isempty(table))
+                return 0;
+
+        if (FLAGS_SET(arg_json_format_flags, SD_JSON_FORMAT_OFF))
+                putchar('\n');
+
+        return table_print_with_pager(table, arg_json_format_flags, arg_pager_flags, /* show_header= */ true);
+}
+
+static int dump_counters(sd_bus *bus) {
+        _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        _cleanup_(table_unrefp) Table *table = NULL;
+        int r;
+
+        assert(bus);
+
+        r = bus_get_property(bus, bus_systemd_mgr, "Counters", &error, &reply, "a(st)");
+        if (r < 0)
+                return log_error_errno(r, "Failed to get Counters property: %s", bus_error_message(&error, r));
+
+        table = table_new("counter", "value");
+        if (!table)
+                return log_oom();
+
+        (void) table_set_align_percent(table, TABLE_HEADER_CELL(1), 100);
+
+        r = sd_bus_message_enter_container(reply, 'a', "(st)");
+        if (r < 0)
+                return bus_log_parse_error(r);
+
+        for (;;) {
+                const char *name;
+                uint64_t value;
+
+                r = sd_bus_message_read(reply, "(st)", &name, &value);
+                if (r < 0)
+                        return bus_log_parse_error(r);
+                if (r == 0)
+                        break;
+
+                r = table_add_many(table,
+                                   TABLE_STRING, name,
+                                   TABLE_UINT64, value,
+                                   TABLE_SET_ALIGN_PERCENT, 100);
+                if (r < 0)
+                        return table_log_add_error(r);
+        }
+
+        r = sd_bus_message_exit_container(reply);
+        if (r < 0)
+                return bus_log_parse_error(r);
+
+        return table_print_with_pager(table, arg_json_format_flags, arg_pager_flags, /* show_header= */ true);
+}
+
+int verb_phases(int argc, char *argv[], void *userdata) {
+        _cleanup_(sd_bus_flush_close_unrefp) sd_bus *bus = NULL;
+        int r;
+
+        r = acquire_bus(&bus, NULL);
+        if (r < 0)
+                return bus_log_connect_error(r, arg_transport);
+
+        r = dump_phases(bus);
+        if (r < 0)
+                return r;
+
+        r = dump_generators(bus);
+        if (r < 0)
+                return r;
+
+        if (FLAGS_SET(arg_json_format_flags, SD_JSON_FORMAT_OFF))
+                putchar('\n');
+
+        r = dump_counters(bus);
+        if (r < 0)
+                return r;
+
+        return EXIT_SUCCESS;
+}
@@ -6,9 +6,11 @@
 #include "bus-locator.h"
 #include "bus-map-properties.h"
 #include "bus-unit-util.h"
+#include "constants.h"
 #include "memory-util.h"
 #include "special.h"
 #include "strv.h"
+#include "varlink.h"
 
 static void subtract_timestamp(usec_t *a, usec_t b) {
         assert(a);
@@ -267,6 +269,194 @@ UnitTimes* unit_times_free_array(UnitTimes *t) {
 
 DEFINE_TRIVIAL_CLEANUP_FUNC_FULL(UnitTimes*, unit_times_clear, NULL);
 
+/* Applies the offset of the manager instance to the timestamps of the unit, and calculates the time it
+ * took to start. Returns false if the unit shall be ignored. */
+static bool unit_times_finalize(UnitTimes *t, const BootTimes *boot_times) {
+        assert(t);
+        assert(boot_times);
+
+        /* Activated in the previous soft-reboot iteration? Ignore it, we want new activations */
+        if ((t->activated > 0 && t->activated < boot_times->shutdown_start_time) ||
+            (t->activating > 0 && t->activating < boot_times->shutdown_start_time))
+                return false;
+
+        subtract_timestamp(&t->activating, boot_times->reverse_offset);
+        subtract_timestamp(&t->activated, boot_times->reverse_offset);
+
+        /* If the last deactivation was in the previous soft-reboot, ignore it */
+        if (boot_times->soft_reboots_count > 0) {
+                if (t->deactivating < boot_times->reverse_offset)
+                        t->deactivating = 0;
+                else
+                        subtract_timestamp(&t->deactivating, boot_times->reverse_offset);
+                if (t->deactivated < boot_times->reverse_offset)
+                        t->deactivated = 0;
+                else
+                        subtract_timestamp(&t->deactivated, boot_times->reverse_offset);
+        } else {
+                subtract_timestamp(&t->deactivating, boot_times->reverse_offset);
+                subtract_timestamp(&t->deactivated, boot_times->reverse_offset);
+        }
+
+        if (t->activated >= t->activating)
+                t->time = t->activated - t->activating;
+        else if (t->deactivated >= t->activating)
+                t->time = t->deactivated - t->activating;
+        else
+                t->time = 0;
+
+        return t->activating > 0;
+}
+
+typedef struct TimeDataCollect {
+        const BootTimes *boot_times;
+        UnitTimes *unit_times;
+        size_t n_unit_times;
+        int error;
+} TimeDataCollect;
+
+static int time_data_reply(
+                Varlink *link,
+                sd_json_variant *parameters,
+                const char *error_id,
+                VarlinkReplyFlags flags,
+                void *userdata) {
+
+        static const sd_json_dispatch_field dispatch_table[] = {
+                { "Id",                              SD_JSON_VARIANT_STRING,        sd_json_dispatch_string, offsetof(UnitTimes, name),                  SD_JSON_MANDATORY },
+                { "InactiveExitTimestampMonotonic",  _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64, offsetof(UnitTimes, activating),            0                 },
+                { "ActiveEnterTimestampMonotonic",   _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64, offsetof(UnitTimes, activated),             0                 },
+                { "ActiveExitTimestampMonotonic",    _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64, offsetof(UnitTimes, deactivating),          0                 },
+                { "InactiveEnterTimestampMonotonic", _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64, offsetof(UnitTimes, deactivated),           0                 },
+                { "After",                           SD_JSON_VARIANT_ARRAY,         sd_json_dispatch_strv,   offsetof(UnitTimes, deps[UNIT_AFTER]),      0                 },
+                { "Before",                          SD_JSON_VARIANT_ARRAY,         sd_json_dispatch_strv,   offsetof(UnitTimes, deps[UNIT_BEFORE]),     0                 },
+                { "Requires",                        SD_JSON_VARIANT_ARRAY,         sd_json_dispatch_strv,   offsetof(UnitTimes, deps[UNIT_REQUIRES]),   0                 },
+                { "Requisite",                       SD_JSON_VARIANT_ARRAY,         sd_json_dispatch_strv,   offsetof(UnitTimes, deps[UNIT_REQUISITE]),  0                 },
+                { "Wants",                           SD_JSON_VARIANT_ARRAY,         sd_json_dispatch_strv,   offsetof(UnitTimes, deps[UNIT_WANTS]),      0                 },
+                { "Conflicts",                       SD_JSON_VARIANT_ARRAY,         sd_json_dispatch_strv,   offsetof(UnitTimes, deps[UNIT_CONFLICTS]),  0                 },
+                { "Upholds",                         SD_JSON_VARIANT_ARRAY,         sd_json_dispatch_strv,   offsetof(UnitTimes, deps[UNIT_UPHOLDS]),    0                 },
+                {}
+        };
+
+        TimeDataCollect *c = ASSERT_PTR(userdata);
+        _cleanup_(unit_times_clearp) UnitTimes *t = NULL;
+        int r;
+
+        assert(link);
+
+        /* Only remember the first failure, but keep processing until the server is done */
+        if (c->error < 0)
+                return 0;
+
+        if (error_id) {
+                if (streq(error_id, "io.systemd.Manager.NoMatchingUnits"))
+                        return 0;
+
+                c->error = varlink_error_to_errno(error_id, parameters);
+                if (c->error >= 0)
+                        c->error = -EBADMSG;
+
+                return log_debug_errno(c->error, "ListUnitTimes() failed: %s", error_id);
+        }
+
+        if (!GREEDY_REALLOC0(c->unit_times, c->n_unit_times + 2)) {
+                c->error = log_oom();
+                return c->error;
+        }
+
+        /* The entry might have been used for a unit we ignored before, unit_times_clearp only frees the
+         * strings */
+        t = &c->unit_times[c->n_unit_times];
+        *t = (UnitTimes) {};
+
+        r = sd_json_dispatch(parameters, dispatch_table, SD_JSON_LOG|SD_JSON_ALLOW_EXTENSIONS, t);
+        if (r < 0) {
+                c->error = r;
+                return r;
+        }
+
+        if (!unit_times_finalize(t, c->boot_times))
+                return 0;
+
+        t->has_data = true;
+        TAKE_PTR(t);
+        c->n_unit_times++;
+        return 0;
+}
+
+static int acquire_time_data_varlink(const BootTimes *boot_times, UnitTimes **out) {
+        _cleanup_(varlink_unrefp) Varlink *vl = NULL;
+        TimeDataCollect c = {
+                .boot_times = boot_times,
+        };
+        int r;
+
+        assert(boot_times);
+        assert(out);
+
+        /* Fetches the timing data and dependencies of all units in one go, instead of issuing one D-Bus call
+         * per unit. Only the system manager provides this, and only locally. Returns -EOPNOTSUPP if the
+         * caller should fall back to D-Bus. */
+
+        if (arg_transport != BUS_TRANSPORT_LOCAL || arg_runtime_scope != RUNTIME_SCOPE_SYSTEM)
+                return -EOPNOTSUPP;
+
+        r = varlink_connect_address(&vl, VARLINK_ADDR_PATH_MANAGER_SYSTEM);
+        if (r < 0) {
+                log_debug_errno(r, "Failed to connect to %s, falling back to D-Bus: %m", VARLINK_ADDR_PATH_MANAGER_SYSTEM);
+                return -EOPNOTSUPP;
+        }
+
+        varlink_set_userdata(vl, &c);
+
+        r = varlink_bind_reply(vl, time_data_reply);
+        if (r < 0)
+                return log_error_errno(r, "Failed to bind reply callback: %m");
+
+        r = varlink_observebo(vl, "io.systemd.Manager.ListUnitTimes",
+                              SD_JSON_BUILD_PAIR_CONDITION(!!arg_since, "since", SD_JSON_BUILD_STRING(arg_since)));
+        if (r < 0)
+                return log_error_errno(r, "Failed to issue ListUnitTimes() call: %m");
+
+        for (;;) {
+                r = varlink_is_idle(vl);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to check if varlink connection is idle: %m");
+                if (r > 0)
+                        break;
+
+                r = varlink_process(vl);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to process varlink connection: %m");
+                if (r != 0)
+                        continue;
+
+                r = varlink_wait(vl, USEC_INFINITY);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to wait for varlink connection events: %m");
+        }
+
+        if (c.error < 0) {
+                unit_times_free_array(c.unit_times);
+
+                /* Not implemented, or the server gave up on us midway, let's try D-Bus instead */
+                if (IN_SET(c.error, -EADDRNOTAVAIL, -ENXIO, -ECONNRESET, -ENOBUFS)) {
+                        log_debug_errno(c.error, "Failed to acquire unit timing data via Varlink, falling back to D-Bus: %m");
+                        return -EOPNOTSUPP;
+                }
+                if (c.error == -EINVAL && arg_since)
+                        return log_error_errno(c.error, "Invalid boot phase specified with --since=: %s", arg_since);
+
+                return log_error_errno(c.error, "Failed to acquire unit timing data: %m");
+        }
+
+        if (!c.unit_times && !(c.unit_times = new0(UnitTimes, 1)))
+                return log_oom();
+
+        *out = TAKE_PTR(c.unit_times);
+        return c.n_unit_times;
+}
+
 int acquire_time_data(sd_bus *bus, bool require_finished, UnitTimes **out) {
         static const struct bus_properties_map property_map[] = {
                 { "InactiveExitTimestampMonotonic",  "t",  NULL, offsetof(UnitTimes, activating)           },
@@ -294,6 +484,14 @@ int acquire_time_data(sd_bus *bus, bool require_finished, UnitTimes **out) {
         if (r < 0)
                 return r;
 
+        r = acquire_time_data_varlink(boot_times, out);
+        if (r != -EOPNOTSUPP)
+                return r;
+
+        if (arg_since)
+                return log_error_errno(SYNTHETIC_ERRNO(EOPNOTSUPP),
+                                       "--since= is only supported for the local system service manager.");
+
         r = bus_call_method(bus, bus_systemd_mgr, "ListUnits", &error, &reply, NULL);
         if (r < 0)
                 return log_error_errno(r, "Failed to list units: %s", bus_error_message(&error, r));
@@ -327,37 +525,7 @@ int acquire_time_data(sd_bus *bus, bool require_finished, UnitTimes **out) {
                         return log_error_errno(r, "Failed to get timestamp properties of unit %s: %s",
                                                u.id, bus_error_message(&error, r));
 
-                /* Activated in the previous soft-reboot iteration? Ignore it, we want new activations */
-                if ((t->activated > 0 && t->activated < boot_times->shutdown_start_time) ||
-                    (t->activating > 0 && t->activating < boot_times->shutdown_start_time))
-                        continue;
-
-                subtract_timestamp(&t->activating, boot_times->reverse_offset);
-                subtract_timestamp(&t->activated, boot_times->reverse_offset);
-
-                /* If the last deactivation was in the previous soft-reboot, ignore it */
-                if (boot_times->soft_reboots_count > 0) {
-                        if (t->deactivating < boot_times->reverse_offset)
-                                t->deactivating = 0;
-                        else
-                                subtract_timestamp(&t->deactivating, boot_times->reverse_offset);
-                        if (t->deactivated < boot_times->reverse_offset)
-                                t->deactivated = 0;
-                        else
-                                subtract_timestamp(&t->deactivated, boot_times->reverse_offset);
-                } else {
-                        subtract_timestamp(&t->deactivating, boot_times->reverse_offset);
-                        subtract_timestamp(&t->deactivated, boot_times->reverse_offset);
-                }
-
-                if (t->activated >= t->activating)
-                        t->time = t->activated - t->activating;
-                else if (t->deactivated >= t->activating)
-                        t->time = t->deactivated - t->activating;
-                else
-                        t->time = 0;
-
-                if (t->activating == 0)
+                if (!unit_times_finalize(t, boot_times))
                         continue;
 
                 t->name = strdup(u.id);
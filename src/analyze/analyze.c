@@ -31,6 +31,7 @@
 #include "analyze-log-control.h"
 #include "analyze-malloc.h"
 #include "analyze-pcrs.h"
+#include "analyze-phases.h"
 #include "analyze-plot.h"
 #include "analyze-security.h"
 #include "analyze-service-watchdogs.h"
@@ -93,6 +94,7 @@
 DotMode arg_dot = DEP_ALL;
 char **arg_dot_from_patterns = NULL, **arg_dot_to_patterns = NULL;
 usec_t arg_fuzz = 0;
+const char *arg_since = NULL;
 PagerFlags arg_pager_flags = 0;
 CatFlags arg_cat_flags = 0;
 BusTransport arg_transport = BUS_TRANSPORT_LOCAL;
@@ -216,6 +218,8 @@ static int help(int argc, char *argv[], void *userdata) {
                "                             of units\n"
                "  plot                       Output SVG graphic showing service\n"
                "                             initialization\n"
+               "  phases                     Print time spent in phases of the service\n"
+               "                             manager's own work\n"
                "  dot [UNIT...]              Output dependency graph in %s format\n"
                "  dump [PATTERN...]          Output state serialization of service\n"
                "                             manager\n"
@@ -266,6 +270,8 @@ static int help(int argc, char *argv[], void *userdata) {
                "     --to-pattern=GLOB       Show only destinations in the graph\n"
                "     --fuzz=SECONDS          Also print services which finished SECONDS\n"
                "                             earlier than the latest in the branch\n"
+               "     --since=PHASE           Only consider units that changed state\n"
+               "                             after the specified boot phase\n"
                "     --man[=BOOL]            Do [not] check for existence of man pages\n"
                "     --generators[=BOOL]     Do [not] run unit generators\n"
                "                             (requires privileges)\n"
@@ -310,6 +316,7 @@ static int parse_argv(int argc, char *argv[]) {
                 ARG_DOT_FROM_PATTERN,
                 ARG_DOT_TO_PATTERN,
                 ARG_FUZZ,
+                ARG_SINCE,
                 ARG_NO_PAGER,
                 ARG_MAN,
                 ARG_GENERATORS,
@@ -345,6 +352,7 @@ static int parse_argv(int argc, char *argv[]) {
                 { "from-pattern",     required_argument, NULL, ARG_DOT_FROM_PATTERN },
                 { "to-pattern",       required_argument, NULL, ARG_DOT_TO_PATTERN   },
                 { "fuzz",             required_argument, NULL, ARG_FUZZ             },
+                { "since",            required_argument, NULL, ARG_SINCE            },
                 { "no-pager",         no_argument,       NULL, ARG_NO_PAGER         },
                 { "man",              optional_argument, NULL, ARG_MAN              },
                 { "generators",       optional_argument, NULL, ARG_GENERATORS       },
@@ -447,6 +455,10 @@ static int parse_argv(int argc, char *argv[]) {
                                 return r;
                         break;
 
+                case ARG_SINCE:
+                        arg_since = optarg;
+                        break;
+
                 case ARG_NO_PAGER:
                         arg_pager_flags |= PAGER_DISABLE;
                         break;
@@ -627,6 +639,7 @@ static int run(int argc, char *argv[]) {
                 { "blame",             VERB_ANY, 1,        0,            verb_blame             },
                 { "critical-chain",    VERB_ANY, VERB_ANY, 0,            verb_critical_chain    },
                 { "plot",              VERB_ANY, 1,        0,            verb_plot              },
+                { "phases",            VERB_ANY, 1,        0,            verb_phases            },
                 { "dot",               VERB_ANY, VERB_ANY, 0,            verb_dot               },
                 /* ↓ The following seven verbs are deprecated, from here … ↓ */
                 { "log-level",         VERB_ANY, 2,        0,            verb_log_control       },
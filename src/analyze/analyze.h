@@ -21,6 +21,7 @@ typedef enum DotMode {
 extern DotMode arg_dot;
 extern char **arg_dot_from_patterns, **arg_dot_to_patterns;
 extern usec_t arg_fuzz;
+extern const char *arg_since;
 extern PagerFlags arg_pager_flags;
 extern CatFlags arg_cat_flags;
 extern BusTransport arg_transport;
@@ -95,6 +95,13 @@ int cg_enumerate_processes(const char *controller, const char *path, FILE **ret)
         return cg_enumerate_items(controller, path, ret, "cgroup.procs");
 }
 
+int cg_enumerate_processes_at(int dir_fd, FILE **ret) {
+        assert(dir_fd >= 0);
+        assert(ret);
+
+        return xfopenat(dir_fd, "cgroup.procs", "re", /* open_flags= */ 0, ret);
+}
+
 int cg_read_pid(FILE *f, pid_t *ret, CGroupFlags flags) {
         unsigned long ul;
 
@@ -164,22 +171,11 @@ int cg_read_pidref(FILE *f, PidRef *ret, CGroupFlags flags) {
         }
 }
 
-int cg_read_event(
-                const char *controller,
-                const char *path,
-                const char *event,
-                char **ret) {
-
-        _cleanup_free_ char *events = NULL, *content = NULL;
+static int cg_parse_event(const char *content, const char *event, char **ret) {
         int r;
 
-        r = cg_get_path(controller, path, "cgroup.events", &events);
-        if (r < 0)
-                return r;
-
-        r = read_full_virtual_file(events, &content, NULL);
-        if (r < 0)
-                return r;
+        assert(content);
+        assert(event);
 
         for (const char *p = content;;) {
                 _cleanup_free_ char *line = NULL, *key = NULL;
@@ -205,6 +201,39 @@ int cg_read_event(
         }
 }
 
+int cg_read_event(
+                const char *controller,
+                const char *path,
+                const char *event,
+                char **ret) {
+
+        _cleanup_free_ char *events = NULL, *content = NULL;
+        int r;
+
+        r = cg_get_path(controller, path, "cgroup.events", &events);
+        if (r < 0)
+                return r;
+
+        r = read_full_virtual_file(events, &content, NULL);
+        if (r < 0)
+                return r;
+
+        return cg_parse_event(content, event, ret);
+}
+
+int cg_read_event_at(int dir_fd, const char *event, char **ret) {
+        _cleanup_free_ char *content = NULL;
+        int r;
+
+        assert(dir_fd >= 0);
+
+        r = read_virtual_file_at(dir_fd, "cgroup.events", SIZE_MAX, &content, /* ret_size= */ NULL);
+        if (r < 0)
+                return r;
+
+        return cg_parse_event(content, event, ret);
+}
+
 bool cg_ns_supported(void) {
         static thread_local int enabled = -1;
 
@@ -1025,6 +1054,24 @@ int cg_is_empty_recursive(const char *controller, const char *path) {
         }
 }
 
+int cg_is_empty_recursive_at(int dir_fd) {
+        _cleanup_free_ char *t = NULL;
+        int r;
+
+        assert(dir_fd >= 0);
+
+        /* Like cg_is_empty_recursive(), but for a cgroup on the unified hierarchy, opened already. Note that
+         * the root cgroup has no "cgroup.events", and is hence considered empty, unlike there. */
+
+        r = cg_read_event_at(dir_fd, "populated", &t);
+        if (r == -ENOENT)
+                return true;
+        if (r < 0)
+                return r;
+
+        return streq(t, "0");
+}
+
 int cg_split_spec(const char *spec, char **ret_controller, char **ret_path) {
         _cleanup_free_ char *controller = NULL, *path = NULL;
         int r;
@@ -1836,6 +1883,13 @@ int cg_set_attribute(const char *controller, const char *path, const char *attri
         return write_string_file(p, value, WRITE_STRING_FILE_DISABLE_BUFFER);
 }
 
+int cg_set_attribute_at(int dir_fd, const char *attribute, const char *value) {
+        assert(dir_fd >= 0);
+        assert(attribute);
+
+        return write_string_file_at(dir_fd, attribute, value, WRITE_STRING_FILE_DISABLE_BUFFER);
+}
+
 int cg_get_attribute(const char *controller, const char *path, const char *attribute, char **ret) {
         _cleanup_free_ char *p = NULL;
         int r;
@@ -1847,19 +1901,20 @@ int cg_get_attribute(const char *controller, const char *path, const char *attri
         return read_one_line_file(p, ret);
 }
 
-int cg_get_attribute_as_uint64(const char *controller, const char *path, const char *attribute, uint64_t *ret) {
-        _cleanup_free_ char *value = NULL;
+int cg_get_attribute_at(int dir_fd, const char *attribute, char **ret) {
+        assert(dir_fd >= 0);
+        assert(attribute);
+
+        return read_one_line_file_at(dir_fd, attribute, ret);
+}
+
+static int cg_parse_attribute_as_uint64(const char *value, uint64_t *ret) {
         uint64_t v;
         int r;
 
+        assert(value);
         assert(ret);
 
-        r = cg_get_attribute(controller, path, attribute, &value);
-        if (r == -ENOENT)
-                return -ENODATA;
-        if (r < 0)
-                return r;
-
         if (streq(value, "max")) {
                 *ret = CGROUP_LIMIT_MAX;
                 return 0;
@@ -1873,6 +1928,41 @@ int cg_get_attribute_as_uint64(const char *controller, const char *path, const c
         return 0;
 }
 
+int cg_get_attribute_as_uint64(const char *controller, const char *path, const char *attribute, uint64_t *ret) {
+        _cleanup_free_ char *value = NULL;
+        int r;
+
+        assert(ret);
+
+        r = cg_get_attribute(controller, path, attribute, &value);
+        if (r == -ENOENT)
+                return -ENODATA;
+        if (r < 0)
+                return r;
+
+        return cg_parse_attribute_as_uint64(value, ret);
+}
+
+int cg_get_attribute_as_uint64_at(int dir_fd, const char *attribute, char **buf, uint64_t *ret) {
+        int r;
+
+        assert(dir_fd >= 0);
+        assert(attribute);
+        assert(buf);
+        assert(ret);
+
+        /* Like cg_get_attribute_as_uint64(), but reads the attribute relative to an fd of the cgroup
+         * directory, into a buffer that is reused across calls, see read_virtual_file_at_buffer(). */
+
+        r = read_virtual_file_at_buffer(dir_fd, attribute, SIZE_MAX, buf, /* ret_size= */ NULL);
+        if (r == -ENOENT)
+                return -ENODATA;
+        if (r < 0)
+                return r;
+
+        return cg_parse_attribute_as_uint64(truncate_nl(*buf), ret);
+}
+
 int cg_get_attribute_as_bool(const char *controller, const char *path, const char *attribute, bool *ret) {
         _cleanup_free_ char *value = NULL;
         int r;
@@ -1915,34 +2005,18 @@ int cg_get_owner(const char *path, uid_t *ret_uid) {
         return 0;
 }
 
-int cg_get_keyed_attribute_full(
-                const char *controller,
-                const char *path,
-                const char *attribute,
+static int cg_parse_keyed_attribute(
+                const char *contents,
                 char **keys,
                 char **ret_values,
                 CGroupKeyMode mode) {
 
-        _cleanup_free_ char *filename = NULL, *contents = NULL;
         const char *p;
         size_t n, i, n_done = 0;
         char **v;
         int r;
 
-        /* Reads one or more fields of a cgroup v2 keyed attribute file. The 'keys' parameter should be an strv with
-         * all keys to retrieve. The 'ret_values' parameter should be passed as string size with the same number of
-         * entries as 'keys'. On success each entry will be set to the value of the matching key.
-         *
-         * If the attribute file doesn't exist at all returns ENOENT, if any key is not found returns ENXIO. If mode
-         * is set to GG_KEY_MODE_GRACEFUL we ignore missing keys and return those that were parsed successfully. */
-
-        r = cg_get_path(controller, path, attribute, &filename);
-        if (r < 0)
-                return r;
-
-        r = read_full_file(filename, &contents, NULL);
-        if (r < 0)
-                return r;
+        assert(contents);
 
         n = strv_length(keys);
         if (n == 0) /* No keys to retrieve? That's easy, we are done then */
@@ -1999,6 +2073,61 @@ done:
         return 0;
 }
 
+int cg_get_keyed_attribute_full(
+                const char *controller,
+                const char *path,
+                const char *attribute,
+                char **keys,
+                char **ret_values,
+                CGroupKeyMode mode) {
+
+        _cleanup_free_ char *filename = NULL, *contents = NULL;
+        int r;
+
+        /* Reads one or more fields of a cgroup v2 keyed attribute file. The 'keys' parameter should be an strv with
+         * all keys to retrieve. The 'ret_values' parameter should be passed as string size with the same number of
+         * entries as 'keys'. On success each entry will be set to the value of the matching key.
+         *
+         * If the attribute file doesn't exist at all returns ENOENT, if any key is not found returns ENXIO. If mode
+         * is set to GG_KEY_MODE_GRACEFUL we ignore missing keys and return those that were parsed successfully. */
+
+        r = cg_get_path(controller, path, attribute, &filename);
+        if (r < 0)
+                return r;
+
+        /* These are virtual files, hence read them in a single read() rather than through stdio */
+        r = read_virtual_file_at_buffer(AT_FDCWD, filename, SIZE_MAX, &contents, /* ret_size= */ NULL);
+        if (r < 0)
+                return r;
+
+        return cg_parse_keyed_attribute(contents, keys, ret_values, mode);
+}
+
+int cg_get_keyed_attribute_at(
+                int dir_fd,
+                const char *attribute,
+                char **keys,
+                char **ret_values,
+                CGroupKeyMode mode,
+                char **buf) {
+
+        int r;
+
+        assert(dir_fd >= 0);
+        assert(attribute);
+        assert(buf);
+
+        /* Like cg_get_keyed_attribute_full(), but reads the attribute relative to an fd of the cgroup
+         * directory, into a buffer that is reused across calls. For callers sampling the same cgroups
+         * over and over again. */
+
+        r = read_virtual_file_at_buffer(dir_fd, attribute, SIZE_MAX, buf, /* ret_size= */ NULL);
+        if (r < 0)
+                return r;
+
+        return cg_parse_keyed_attribute(*buf, keys, ret_values, mode);
+}
+
 int cg_mask_to_string(CGroupMask mask, char **ret) {
         _cleanup_free_ char *s = NULL;
         bool space = false;
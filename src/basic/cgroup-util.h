@@ -191,10 +191,16 @@ typedef enum CGroupFlags {
         CGROUP_NO_PIDFD           = 1 << 4,
 } CGroupFlags;
 
+/* The *_at() variants below operate on an fd of a cgroup directory, e.g. from cg_path_open() or
+ * cg_cgroupid_open(), hence avoid building the path and looking it up in the kernel. They only make sense
+ * on the unified hierarchy, where all attributes are in the same directory. */
+
 int cg_enumerate_processes(const char *controller, const char *path, FILE **ret);
+int cg_enumerate_processes_at(int dir_fd, FILE **ret);
 int cg_read_pid(FILE *f, pid_t *ret, CGroupFlags flags);
 int cg_read_pidref(FILE *f, PidRef *ret, CGroupFlags flags);
 int cg_read_event(const char *controller, const char *path, const char *event, char **ret);
+int cg_read_event_at(int dir_fd, const char *event, char **ret);
 
 int cg_enumerate_subgroups(const char *controller, const char *path, DIR **ret);
 int cg_read_subgroup(DIR *d, char **ret);
@@ -228,8 +234,11 @@ typedef enum {
 } CGroupKeyMode;
 
 int cg_set_attribute(const char *controller, const char *path, const char *attribute, const char *value);
+int cg_set_attribute_at(int dir_fd, const char *attribute, const char *value);
 int cg_get_attribute(const char *controller, const char *path, const char *attribute, char **ret);
+int cg_get_attribute_at(int dir_fd, const char *attribute, char **ret);
 int cg_get_keyed_attribute_full(const char *controller, const char *path, const char *attribute, char **keys, char **values, CGroupKeyMode mode);
+int cg_get_keyed_attribute_at(int dir_fd, const char *attribute, char **keys, char **ret_values, CGroupKeyMode mode, char **buf);
 
 static inline int cg_get_keyed_attribute(
                 const char *controller,
@@ -250,6 +259,7 @@ static inline int cg_get_keyed_attribute_graceful(
 }
 
 int cg_get_attribute_as_uint64(const char *controller, const char *path, const char *attribute, uint64_t *ret);
+int cg_get_attribute_as_uint64_at(int dir_fd, const char *attribute, char **buf, uint64_t *ret);
 
 /* Does a parse_boolean() on the attribute contents and sets ret accordingly */
 int cg_get_attribute_as_bool(const char *controller, const char *path, const char *attribute, bool *ret);
@@ -268,6 +278,7 @@ int cg_uninstall_release_agent(const char *controller);
 
 int cg_is_empty(const char *controller, const char *path);
 int cg_is_empty_recursive(const char *controller, const char *path);
+int cg_is_empty_recursive_at(int dir_fd);
 
 int cg_get_root_path(char **path);
 
@@ -13,6 +13,7 @@
 #endif
 
 #if HAVE_ZSTD
+#include <zdict.h>
 #include <zstd.h>
 #include <zstd_errors.h>
 #endif
@@ -53,18 +54,27 @@ DEFINE_TRIVIAL_CLEANUP_FUNC_FULL(LZ4F_decompressionContext_t, sym_LZ4F_freeDecom
 #if HAVE_ZSTD
 static void *zstd_dl = NULL;
 
+static DLSYM_PROTOTYPE(ZDICT_getErrorName) = NULL;
+static DLSYM_PROTOTYPE(ZDICT_isError) = NULL;
+static DLSYM_PROTOTYPE(ZDICT_trainFromBuffer) = NULL;
 static DLSYM_PROTOTYPE(ZSTD_CCtx_setParameter) = NULL;
+static DLSYM_PROTOTYPE(ZSTD_DCtx_refDDict) = NULL;
 static DLSYM_PROTOTYPE(ZSTD_compress) = NULL;
 static DLSYM_PROTOTYPE(ZSTD_compressStream2) = NULL;
+static DLSYM_PROTOTYPE(ZSTD_compress_usingCDict) = NULL;
 static DLSYM_PROTOTYPE(ZSTD_createCCtx) = NULL;
+static DLSYM_PROTOTYPE(ZSTD_createCDict) = NULL;
 static DLSYM_PROTOTYPE(ZSTD_createDCtx) = NULL;
+static DLSYM_PROTOTYPE(ZSTD_createDDict) = NULL;
 static DLSYM_PROTOTYPE(ZSTD_CStreamInSize) = NULL;
 static DLSYM_PROTOTYPE(ZSTD_CStreamOutSize) = NULL;
 static DLSYM_PROTOTYPE(ZSTD_decompressStream) = NULL;
 static DLSYM_PROTOTYPE(ZSTD_DStreamInSize) = NULL;
 static DLSYM_PROTOTYPE(ZSTD_DStreamOutSize) = NULL;
 static DLSYM_PROTOTYPE(ZSTD_freeCCtx) = NULL;
+static DLSYM_PROTOTYPE(ZSTD_freeCDict) = NULL;
 static DLSYM_PROTOTYPE(ZSTD_freeDCtx) = NULL;
+static DLSYM_PROTOTYPE(ZSTD_freeDDict) = NULL;
 static DLSYM_PROTOTYPE(ZSTD_getErrorCode) = NULL;
 static DLSYM_PROTOTYPE(ZSTD_getErrorName) = NULL;
 static DLSYM_PROTOTYPE(ZSTD_getFrameContentSize) = NULL;
@@ -73,6 +83,28 @@ static DLSYM_PROTOTYPE(ZSTD_isError) = NULL;
 DEFINE_TRIVIAL_CLEANUP_FUNC_FULL(ZSTD_CCtx*, sym_ZSTD_freeCCtx, NULL);
 DEFINE_TRIVIAL_CLEANUP_FUNC_FULL(ZSTD_DCtx*, sym_ZSTD_freeDCtx, NULL);
 
+struct Compressor {
+        ZSTD_CCtx *cctx;
+        void *buffer;
+        size_t buffer_size;
+};
+
+struct Decompressor {
+        ZSTD_DCtx *dctx;
+        void *buffer;
+        size_t buffer_size;
+};
+
+struct ZstdDictionary {
+        void *data;
+        size_t size;
+
+        /* Digested lazily, readers only need the decompression side, and writers only the compression side */
+        ZSTD_CDict *cdict;
+        ZSTD_DDict *ddict;
+        ZSTD_CCtx *cctx;
+};
+
 static int zstd_ret_to_errno(size_t ret) {
         switch (sym_ZSTD_getErrorCode(ret)) {
         case ZSTD_error_dstSize_tooSmall:
@@ -117,6 +149,16 @@ static const char* const compression_table[_COMPRESSION_MAX] = {
 
 DEFINE_STRING_TABLE_LOOKUP(compression, Compression);
 
+/* The names used in HTTP Content-Encoding headers and similar places */
+static const char* const compression_lowercase_table[_COMPRESSION_MAX] = {
+        [COMPRESSION_NONE] = "none",
+        [COMPRESSION_XZ]   = "xz",
+        [COMPRESSION_LZ4]  = "lz4",
+        [COMPRESSION_ZSTD] = "zstd",
+};
+
+DEFINE_STRING_TABLE_LOOKUP(compression_lowercase, Compression);
+
 bool compression_supported(Compression c) {
         static const unsigned supported =
                 (1U << COMPRESSION_NONE) |
@@ -275,7 +317,16 @@ int dlopen_zstd(void) {
                         DLSYM_ARG(ZSTD_freeDCtx),
                         DLSYM_ARG(ZSTD_isError),
                         DLSYM_ARG(ZSTD_createDCtx),
-                        DLSYM_ARG(ZSTD_createCCtx));
+                        DLSYM_ARG(ZSTD_createCCtx),
+                        DLSYM_ARG(ZSTD_createCDict),
+                        DLSYM_ARG(ZSTD_createDDict),
+                        DLSYM_ARG(ZSTD_freeCDict),
+                        DLSYM_ARG(ZSTD_freeDDict),
+                        DLSYM_ARG(ZSTD_compress_usingCDict),
+                        DLSYM_ARG(ZSTD_DCtx_refDDict),
+                        DLSYM_ARG(ZDICT_trainFromBuffer),
+                        DLSYM_ARG(ZDICT_isError),
+                        DLSYM_ARG(ZDICT_getErrorName));
 }
 #endif
 
@@ -308,6 +359,49 @@ int compress_blob_zstd(
 #endif
 }
 
+int compress_blob_zstd_with_dictionary(
+                const void *src, uint64_t src_size,
+                void *dst, size_t dst_alloc_size, size_t *dst_size,
+                ZstdDictionary *d) {
+
+        assert(src);
+        assert(src_size > 0);
+        assert(dst);
+        assert(dst_alloc_size > 0);
+        assert(dst_size);
+        assert(d);
+
+#if HAVE_ZSTD
+        size_t k;
+        int r;
+
+        r = dlopen_zstd();
+        if (r < 0)
+                return r;
+
+        if (!d->cdict) {
+                d->cdict = sym_ZSTD_createCDict(d->data, d->size, ZSTD_CLEVEL_DEFAULT);
+                if (!d->cdict)
+                        return -ENOMEM;
+        }
+
+        if (!d->cctx) {
+                d->cctx = sym_ZSTD_createCCtx();
+                if (!d->cctx)
+                        return -ENOMEM;
+        }
+
+        k = sym_ZSTD_compress_usingCDict(d->cctx, dst, dst_alloc_size, src, src_size, d->cdict);
+        if (sym_ZSTD_isError(k))
+                return zstd_ret_to_errno(k);
+
+        *dst_size = k;
+        return 0;
+#else
+        return -EPROTONOSUPPORT;
+#endif
+}
+
 int decompress_blob_xz(
                 const void *src,
                 uint64_t src_size,
@@ -416,12 +510,42 @@ int decompress_blob_lz4(
 #endif
 }
 
-int decompress_blob_zstd(
+#if HAVE_ZSTD
+static int zstd_dctx_new(ZstdDictionary *d, ZSTD_DCtx **ret) {
+        _cleanup_(sym_ZSTD_freeDCtxp) ZSTD_DCtx *dctx = NULL;
+
+        assert(ret);
+
+        dctx = sym_ZSTD_createDCtx();
+        if (!dctx)
+                return -ENOMEM;
+
+        if (d) {
+                size_t k;
+
+                if (!d->ddict) {
+                        d->ddict = sym_ZSTD_createDDict(d->data, d->size);
+                        if (!d->ddict)
+                                return -ENOMEM;
+                }
+
+                k = sym_ZSTD_DCtx_refDDict(dctx, d->ddict);
+                if (sym_ZSTD_isError(k))
+                        return zstd_ret_to_errno(k);
+        }
+
+        *ret = TAKE_PTR(dctx);
+        return 0;
+}
+#endif
+
+static int decompress_blob_zstd_internal(
                 const void *src,
                 uint64_t src_size,
                 void **dst,
                 size_t *dst_size,
-                size_t dst_max) {
+                size_t dst_max,
+                ZstdDictionary *d) {
 
         assert(src);
         assert(src_size > 0);
@@ -448,9 +572,10 @@ int decompress_blob_zstd(
         if (!(greedy_realloc(dst, MAX(sym_ZSTD_DStreamOutSize(), size), 1)))
                 return -ENOMEM;
 
-        _cleanup_(sym_ZSTD_freeDCtxp) ZSTD_DCtx *dctx = sym_ZSTD_createDCtx();
-        if (!dctx)
-                return -ENOMEM;
+        _cleanup_(sym_ZSTD_freeDCtxp) ZSTD_DCtx *dctx = NULL;
+        r = zstd_dctx_new(d, &dctx);
+        if (r < 0)
+                return r;
 
         ZSTD_inBuffer input = {
                 .src = src,
@@ -475,6 +600,29 @@ int decompress_blob_zstd(
 #endif
 }
 
+int decompress_blob_zstd(
+                const void *src,
+                uint64_t src_size,
+                void **dst,
+                size_t *dst_size,
+                size_t dst_max) {
+
+        return decompress_blob_zstd_internal(src, src_size, dst, dst_size, dst_max, /* d= */ NULL);
+}
+
+int decompress_blob_zstd_with_dictionary(
+                const void *src,
+                uint64_t src_size,
+                void **dst,
+                size_t *dst_size,
+                size_t dst_max,
+                ZstdDictionary *d) {
+
+        assert(d);
+
+        return decompress_blob_zstd_internal(src, src_size, dst, dst_size, dst_max, d);
+}
+
 int decompress_blob(
                 Compression compression,
                 const void *src,
@@ -640,13 +788,14 @@ int decompress_startswith_lz4(
 #endif
 }
 
-int decompress_startswith_zstd(
+static int decompress_startswith_zstd_internal(
                 const void *src,
                 uint64_t src_size,
                 void **buffer,
                 const void *prefix,
                 size_t prefix_len,
-                uint8_t extra) {
+                uint8_t extra,
+                ZstdDictionary *d) {
 
         assert(src);
         assert(src_size > 0);
@@ -667,9 +816,10 @@ int decompress_startswith_zstd(
         if (size < prefix_len + 1)
                 return 0; /* Decompressed text too short to match the prefix and extra */
 
-        _cleanup_(sym_ZSTD_freeDCtxp) ZSTD_DCtx *dctx = sym_ZSTD_createDCtx();
-        if (!dctx)
-                return -ENOMEM;
+        _cleanup_(sym_ZSTD_freeDCtxp) ZSTD_DCtx *dctx = NULL;
+        r = zstd_dctx_new(d, &dctx);
+        if (r < 0)
+                return r;
 
         if (!(greedy_realloc(buffer, MAX(sym_ZSTD_DStreamOutSize(), prefix_len + 1), 1)))
                 return -ENOMEM;
@@ -698,6 +848,31 @@ int decompress_startswith_zstd(
 #endif
 }
 
+int decompress_startswith_zstd(
+                const void *src,
+                uint64_t src_size,
+                void **buffer,
+                const void *prefix,
+                size_t prefix_len,
+                uint8_t extra) {
+
+        return decompress_startswith_zstd_internal(src, src_size, buffer, prefix, prefix_len, extra, /* d= */ NULL);
+}
+
+int decompress_startswith_zstd_with_dictionary(
+                const void *src,
+                uint64_t src_size,
+                void **buffer,
+                const void *prefix,
+                size_t prefix_len,
+                uint8_t extra,
+                ZstdDictionary *d) {
+
+        assert(d);
+
+        return decompress_startswith_zstd_internal(src, src_size, buffer, prefix, prefix_len, extra, d);
+}
+
 int decompress_startswith(
                 Compression compression,
                 const void *src,
@@ -1052,7 +1227,13 @@ int decompress_stream_lz4(int in, int out, uint64_t max_bytes) {
 #endif
 }
 
-int compress_stream_zstd(int fdf, int fdt, uint64_t max_bytes, uint64_t *ret_uncompressed_size) {
+int compress_stream_zstd_full(
+                int fdf,
+                int fdt,
+                uint64_t max_bytes,
+                unsigned n_threads,
+                uint64_t *ret_uncompressed_size) {
+
         assert(fdf >= 0);
         assert(fdt >= 0);
 
@@ -1081,6 +1262,15 @@ int compress_stream_zstd(int fdf, int fdt, uint64_t max_bytes, uint64_t *ret_unc
         if (sym_ZSTD_isError(z))
                 log_debug("Failed to enable ZSTD checksum, ignoring: %s", sym_ZSTD_getErrorName(z));
 
+        /* With workers, zstd compresses chunks of the input in parallel in the background, while we keep
+         * reading from the input and writing out what is done. The output is a regular zstd frame. */
+        if (n_threads > 1) {
+                z = sym_ZSTD_CCtx_setParameter(cctx, ZSTD_c_nbWorkers, (int) MIN(n_threads, (unsigned) INT_MAX));
+                if (sym_ZSTD_isError(z))
+                        log_debug("Failed to enable ZSTD multithreading, compressing in a single thread: %s",
+                                  sym_ZSTD_getErrorName(z));
+        }
+
         /* This loop read from the input file, compresses that entire chunk,
          * and writes all output produced to the output file.
          */
@@ -1162,6 +1352,10 @@ int compress_stream_zstd(int fdf, int fdt, uint64_t max_bytes, uint64_t *ret_unc
 #endif
 }
 
+int compress_stream_zstd(int fdf, int fdt, uint64_t max_bytes, uint64_t *ret_uncompressed_size) {
+        return compress_stream_zstd_full(fdf, fdt, max_bytes, /* n_threads= */ 1, ret_uncompressed_size);
+}
+
 int decompress_stream_zstd(int fdf, int fdt, uint64_t max_bytes) {
         assert(fdf >= 0);
         assert(fdt >= 0);
@@ -1285,3 +1479,306 @@ int decompress_stream(const char *filename, int fdf, int fdt, uint64_t max_bytes
         else
                 return -EPROTONOSUPPORT;
 }
+
+int zstd_dictionary_new(const void *data, size_t size, ZstdDictionary **ret) {
+        assert(data || size == 0);
+        assert(ret);
+
+        if (size == 0)
+                return -EINVAL;
+
+#if HAVE_ZSTD
+        _cleanup_free_ ZstdDictionary *d = NULL;
+        int r;
+
+        r = dlopen_zstd();
+        if (r < 0)
+                return r;
+
+        d = new0(ZstdDictionary, 1);
+        if (!d)
+                return -ENOMEM;
+
+        d->data = memdup(data, size);
+        if (!d->data)
+                return -ENOMEM;
+        d->size = size;
+
+        *ret = TAKE_PTR(d);
+        return 0;
+#else
+        return -EPROTONOSUPPORT;
+#endif
+}
+
+ZstdDictionary* zstd_dictionary_free(ZstdDictionary *d) {
+        if (!d)
+                return NULL;
+
+#if HAVE_ZSTD
+        sym_ZSTD_freeCDict(d->cdict);
+        sym_ZSTD_freeDDict(d->ddict);
+        sym_ZSTD_freeCCtx(d->cctx);
+        free(d->data);
+#endif
+
+        return mfree(d);
+}
+
+int zstd_dictionary_prepare_decompression(ZstdDictionary *d) {
+        assert(d);
+
+        /* Normally the dictionary is digested on first use. Doing so up front allows it to be used for
+         * decompression by multiple threads at once afterwards. */
+
+#if HAVE_ZSTD
+        if (d->ddict)
+                return 0;
+
+        d->ddict = sym_ZSTD_createDDict(d->data, d->size);
+        if (!d->ddict)
+                return -ENOMEM;
+
+        return 0;
+#else
+        return -EPROTONOSUPPORT;
+#endif
+}
+
+int zstd_dictionary_train(
+                const void *samples,
+                const size_t *sample_sizes,
+                size_t n_samples,
+                size_t max_size,
+                void **ret,
+                size_t *ret_size) {
+
+        assert(samples || n_samples == 0);
+        assert(sample_sizes || n_samples == 0);
+        assert(max_size > 0);
+        assert(ret);
+        assert(ret_size);
+
+#if HAVE_ZSTD
+        _cleanup_free_ void *buf = NULL;
+        size_t k;
+        int r;
+
+        if (n_samples == 0 || n_samples > UINT_MAX)
+                return -EINVAL;
+
+        r = dlopen_zstd();
+        if (r < 0)
+                return r;
+
+        buf = malloc(max_size);
+        if (!buf)
+                return -ENOMEM;
+
+        k = sym_ZDICT_trainFromBuffer(buf, max_size, samples, sample_sizes, (unsigned) n_samples);
+        if (sym_ZDICT_isError(k))
+                /* Most likely there's not enough sample data to train on. */
+                return log_debug_errno(SYNTHETIC_ERRNO(ENODATA),
+                                       "Failed to train ZSTD dictionary: %s", sym_ZDICT_getErrorName(k));
+
+        *ret = TAKE_PTR(buf);
+        *ret_size = k;
+        return 0;
+#else
+        return -EPROTONOSUPPORT;
+#endif
+}
+
+int compressor_new(Compression compression, Compressor **ret) {
+        assert(ret);
+
+        /* Like the decompressor below, only zstd is supported */
+        if (compression != COMPRESSION_ZSTD)
+                return -EOPNOTSUPP;
+
+#if HAVE_ZSTD
+        _cleanup_(compressor_freep) Compressor *c = NULL;
+        int r;
+
+        r = dlopen_zstd();
+        if (r < 0)
+                return r;
+
+        c = new0(Compressor, 1);
+        if (!c)
+                return -ENOMEM;
+
+        c->cctx = sym_ZSTD_createCCtx();
+        if (!c->cctx)
+                return -ENOMEM;
+
+        c->buffer_size = sym_ZSTD_CStreamOutSize();
+        c->buffer = malloc(c->buffer_size);
+        if (!c->buffer)
+                return -ENOMEM;
+
+        *ret = TAKE_PTR(c);
+        return 0;
+#else
+        return -EPROTONOSUPPORT;
+#endif
+}
+
+Compressor* compressor_free(Compressor *c) {
+        if (!c)
+                return NULL;
+
+#if HAVE_ZSTD
+        sym_ZSTD_freeCCtx(c->cctx);
+        free(c->buffer);
+#endif
+
+        return mfree(c);
+}
+
+int compressor_push(
+                Compressor *c,
+                const void *src,
+                size_t src_size,
+                bool end,
+                compression_callback_t callback,
+                void *userdata) {
+
+        assert(c);
+        assert(src || src_size == 0);
+        assert(callback);
+
+        /* Compresses the data and flushes everything to the callback, so that the receiver can decode all
+         * data pushed so far. If 'end' is true the current frame is finished, and the next push starts a
+         * new one. */
+
+#if HAVE_ZSTD
+        ZSTD_inBuffer input = {
+                .src = src,
+                .size = src_size,
+        };
+
+        for (;;) {
+                ZSTD_outBuffer output = {
+                        .dst = c->buffer,
+                        .size = c->buffer_size,
+                };
+                size_t k;
+                int r;
+
+                k = sym_ZSTD_compressStream2(c->cctx, &output, &input, end ? ZSTD_e_end : ZSTD_e_flush);
+                if (sym_ZSTD_isError(k))
+                        return log_debug_errno(zstd_ret_to_errno(k),
+                                               "ZSTD encoder failed: %s", sym_ZSTD_getErrorName(k));
+
+                if (output.pos > 0) {
+                        r = callback(output.dst, output.pos, userdata);
+                        if (r < 0)
+                                return r;
+                }
+
+                /* Zero means all input was consumed and flushed */
+                if (k == 0)
+                        return 0;
+        }
+#else
+        return -EPROTONOSUPPORT;
+#endif
+}
+
+int decompressor_new(Compression compression, Decompressor **ret) {
+        assert(ret);
+
+        /* Only zstd may be decoded incrementally from arbitrarily split input for now */
+        if (compression != COMPRESSION_ZSTD)
+                return -EOPNOTSUPP;
+
+#if HAVE_ZSTD
+        _cleanup_(decompressor_freep) Decompressor *d = NULL;
+        int r;
+
+        r = dlopen_zstd();
+        if (r < 0)
+                return r;
+
+        d = new0(Decompressor, 1);
+        if (!d)
+                return -ENOMEM;
+
+        d->dctx = sym_ZSTD_createDCtx();
+        if (!d->dctx)
+                return -ENOMEM;
+
+        d->buffer_size = sym_ZSTD_DStreamOutSize();
+        d->buffer = malloc(d->buffer_size);
+        if (!d->buffer)
+                return -ENOMEM;
+
+        *ret = TAKE_PTR(d);
+        return 0;
+#else
+        return -EPROTONOSUPPORT;
+#endif
+}
+
+Decompressor* decompressor_free(Decompressor *d) {
+        if (!d)
+                return NULL;
+
+#if HAVE_ZSTD
+        sym_ZSTD_freeDCtx(d->dctx);
+        free(d->buffer);
+#endif
+
+        return mfree(d);
+}
+
+int decompressor_push(
+                Decompressor *d,
+                const void *src,
+                size_t src_size,
+                compression_callback_t callback,
+                void *userdata) {
+
+        assert(d);
+        assert(src || src_size == 0);
+        assert(callback);
+
+        /* Feeds the next piece of a compressed stream, which may consist of multiple concatenated frames,
+         * into the decoder, and passes everything that can be decoded so far to the callback, in pieces of
+         * at most one output buffer. Returns the first error returned by the callback, if any. */
+
+#if HAVE_ZSTD
+        ZSTD_inBuffer input = {
+                .src = src,
+                .size = src_size,
+        };
+
+        for (;;) {
+                ZSTD_outBuffer output = {
+                        .dst = d->buffer,
+                        .size = d->buffer_size,
+                };
+                size_t k;
+                int r;
+
+                k = sym_ZSTD_decompressStream(d->dctx, &output, &input);
+                if (sym_ZSTD_isError(k))
+                        return log_debug_errno(zstd_ret_to_errno(k),
+                                               "ZSTD decoder failed: %s", sym_ZSTD_getErrorName(k));
+
+                if (output.pos > 0) {
+                        r = callback(output.dst, output.pos, userdata);
+                        if (r < 0)
+                                return r;
+                }
+
+                /* If the output buffer was filled up, there might be more data buffered in the decoder even
+                 * if all input was consumed. */
+                if (input.pos >= input.size && output.pos < output.size)
+                        return 0;
+        }
+#else
+        return -EPROTONOSUPPORT;
+#endif
+}
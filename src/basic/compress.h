@@ -24,15 +24,62 @@ typedef enum Compression {
 
 const char* compression_to_string(Compression compression);
 Compression compression_from_string(const char *compression);
+const char* compression_lowercase_to_string(Compression compression);
+Compression compression_lowercase_from_string(const char *compression);
 
 bool compression_supported(Compression c);
 
+typedef int (*compression_callback_t)(const void *data, size_t size, void *userdata);
+
+typedef struct Compressor Compressor;
+
+int compressor_new(Compression compression, Compressor **ret);
+Compressor* compressor_free(Compressor *c);
+DEFINE_TRIVIAL_CLEANUP_FUNC(Compressor*, compressor_free);
+int compressor_push(
+                Compressor *c,
+                const void *src,
+                size_t src_size,
+                bool end,
+                compression_callback_t callback,
+                void *userdata);
+
+typedef struct Decompressor Decompressor;
+
+int decompressor_new(Compression compression, Decompressor **ret);
+Decompressor* decompressor_free(Decompressor *d);
+DEFINE_TRIVIAL_CLEANUP_FUNC(Decompressor*, decompressor_free);
+int decompressor_push(
+                Decompressor *d,
+                const void *src,
+                size_t src_size,
+                compression_callback_t callback,
+                void *userdata);
+
+typedef struct ZstdDictionary ZstdDictionary;
+
+int zstd_dictionary_new(const void *data, size_t size, ZstdDictionary **ret);
+ZstdDictionary* zstd_dictionary_free(ZstdDictionary *d);
+DEFINE_TRIVIAL_CLEANUP_FUNC(ZstdDictionary*, zstd_dictionary_free);
+int zstd_dictionary_prepare_decompression(ZstdDictionary *d);
+
+int zstd_dictionary_train(
+                const void *samples,
+                const size_t *sample_sizes,
+                size_t n_samples,
+                size_t max_size,
+                void **ret,
+                size_t *ret_size);
+
 int compress_blob_xz(const void *src, uint64_t src_size,
                      void *dst, size_t dst_alloc_size, size_t *dst_size);
 int compress_blob_lz4(const void *src, uint64_t src_size,
                       void *dst, size_t dst_alloc_size, size_t *dst_size);
 int compress_blob_zstd(const void *src, uint64_t src_size,
                        void *dst, size_t dst_alloc_size, size_t *dst_size);
+int compress_blob_zstd_with_dictionary(const void *src, uint64_t src_size,
+                                       void *dst, size_t dst_alloc_size, size_t *dst_size,
+                                       ZstdDictionary *d);
 
 int decompress_blob_xz(const void *src, uint64_t src_size,
                        void **dst, size_t* dst_size, size_t dst_max);
@@ -40,6 +87,9 @@ int decompress_blob_lz4(const void *src, uint64_t src_size,
                         void **dst, size_t* dst_size, size_t dst_max);
 int decompress_blob_zstd(const void *src, uint64_t src_size,
                         void **dst, size_t* dst_size, size_t dst_max);
+int decompress_blob_zstd_with_dictionary(const void *src, uint64_t src_size,
+                                         void **dst, size_t* dst_size, size_t dst_max,
+                                         ZstdDictionary *d);
 int decompress_blob(Compression compression,
                     const void *src, uint64_t src_size,
                     void **dst, size_t* dst_size, size_t dst_max);
@@ -56,6 +106,11 @@ int decompress_startswith_zstd(const void *src, uint64_t src_size,
                                void **buffer,
                                const void *prefix, size_t prefix_len,
                                uint8_t extra);
+int decompress_startswith_zstd_with_dictionary(const void *src, uint64_t src_size,
+                                               void **buffer,
+                                               const void *prefix, size_t prefix_len,
+                                               uint8_t extra,
+                                               ZstdDictionary *d);
 int decompress_startswith(Compression compression,
                           const void *src, uint64_t src_size,
                           void **buffer,
@@ -65,6 +120,8 @@ int decompress_startswith(Compression compression,
 int compress_stream_xz(int fdf, int fdt, uint64_t max_bytes, uint64_t *ret_uncompressed_size);
 int compress_stream_lz4(int fdf, int fdt, uint64_t max_bytes, uint64_t *ret_uncompressed_size);
 int compress_stream_zstd(int fdf, int fdt, uint64_t max_bytes, uint64_t *ret_uncompressed_size);
+/* Uses as many threads to compress, if libzstd was built with support for that */
+int compress_stream_zstd_full(int fdf, int fdt, uint64_t max_bytes, unsigned n_threads, uint64_t *ret_uncompressed_size);
 
 int decompress_stream_xz(int fdf, int fdt, uint64_t max_size);
 int decompress_stream_lz4(int fdf, int fdt, uint64_t max_size);
@@ -104,10 +161,16 @@ static inline int compress_blob(
         }
 }
 
-static inline int compress_stream(int fdf, int fdt, uint64_t max_bytes, uint64_t *ret_uncompressed_size) {
+static inline int compress_stream_full(
+                int fdf,
+                int fdt,
+                uint64_t max_bytes,
+                unsigned n_threads, /* Only honoured by zstd */
+                uint64_t *ret_uncompressed_size) {
+
         switch (DEFAULT_COMPRESSION) {
         case COMPRESSION_ZSTD:
-                return compress_stream_zstd(fdf, fdt, max_bytes, ret_uncompressed_size);
+                return compress_stream_zstd_full(fdf, fdt, max_bytes, n_threads, ret_uncompressed_size);
         case COMPRESSION_LZ4:
                 return compress_stream_lz4(fdf, fdt, max_bytes, ret_uncompressed_size);
         case COMPRESSION_XZ:
@@ -117,6 +180,10 @@ static inline int compress_stream(int fdf, int fdt, uint64_t max_bytes, uint64_t
         }
 }
 
+static inline int compress_stream(int fdf, int fdt, uint64_t max_bytes, uint64_t *ret_uncompressed_size) {
+        return compress_stream_full(fdf, fdt, max_bytes, /* n_threads= */ 1, ret_uncompressed_size);
+}
+
 static inline const char* default_compression_extension(void) {
         switch (DEFAULT_COMPRESSION) {
         case COMPRESSION_ZSTD:
@@ -84,5 +84,7 @@
 #define VARLINK_ADDR_PATH_MANAGED_OOM_SYSTEM "/run/systemd/io.systemd.ManagedOOM"
 /* Path where systemd-oomd listens for varlink connections from user managers to report changes in ManagedOOM settings. */
 #define VARLINK_ADDR_PATH_MANAGED_OOM_USER "/run/systemd/oom/io.systemd.ManagedOOM"
+/* Path where PID1 provides bulk unit state queries, e.g. for systemd-analyze. */
+#define VARLINK_ADDR_PATH_MANAGER_SYSTEM "/run/systemd/io.systemd.Manager"
 
 #define KERNEL_BASELINE_VERSION "4.15"
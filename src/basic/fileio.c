@@ -594,6 +594,94 @@ int read_virtual_file_at(
         return read_virtual_file_fd(fd, max_size, ret_contents, ret_size);
 }
 
+int read_virtual_file_at_buffer(
+                int dir_fd,
+                const char *filename,
+                size_t max_size,
+                char **buf,
+                size_t *ret_size) {
+
+        _cleanup_close_ int fd = -EBADF;
+        bool truncated = false;
+        size_t limit, size;
+        ssize_t n;
+
+        /* Like read_virtual_file_at(), but for callers reading small virtual files over and over again: the
+         * contents are read into *buf, which the caller keeps around for the next call, and which is only
+         * (re)allocated if it is too small. Its size is also used as first guess for the size of the file,
+         * instead of fstat() – files in procfs, sysfs and cgroupfs report meaningless sizes anyway. Hence in
+         * the common case this needs no allocation and no syscalls beyond openat(), a single pread() and
+         * close(), or just the pread() if filename is NULL and dir_fd refers to the file itself.
+         *
+         * The contents are NUL terminated, and remain valid until the next call. Note that unlike
+         * read_virtual_file_at() the type of the file is not checked, hence only use this on files the
+         * caller knows to be in a virtual file system. Returns 0 on partial success, 1 if untruncated
+         * contents were read. */
+
+        assert(dir_fd >= 0 || dir_fd == AT_FDCWD);
+        assert(buf);
+        assert(max_size <= READ_VIRTUAL_BYTES_MAX || max_size == SIZE_MAX);
+
+        if (filename) {
+                fd = openat(dir_fd, filename, O_RDONLY | O_NOCTTY | O_CLOEXEC);
+                if (fd < 0)
+                        return -errno;
+        } else if (dir_fd == AT_FDCWD)
+                return -EBADF;
+
+        limit = MIN(max_size, READ_VIRTUAL_BYTES_MAX);
+
+        for (;;) {
+                if (!*buf) {
+                        /* Files in /proc are generally smaller than the page size, start with that */
+                        *buf = malloc(MIN(page_size(), limit + 1));
+                        if (!*buf)
+                                return -ENOMEM;
+                }
+
+                size = MIN(MALLOC_SIZEOF_SAFE(*buf) - 1, limit);
+
+                /* Read one more byte so we can detect whether the buffer was large enough. Always read from
+                 * the beginning, so that the kernel generates the contents anew if we need to retry. */
+                do
+                        n = pread(fd >= 0 ? fd : dir_fd, *buf, size + 1, 0);
+                while (n < 0 && errno == EINTR);
+                if (n < 0)
+                        return -errno;
+
+                /* Consider a short read as EOF */
+                if ((size_t) n <= size)
+                        break;
+
+                if (size == max_size) {
+                        /* Keep the last byte for the trailing NUL */
+                        n = size;
+                        truncated = true;
+                        break;
+                }
+
+                if (size >= READ_VIRTUAL_BYTES_MAX)
+                        return -EFBIG;
+
+                /* The old contents are useless, hence don't bother with realloc() */
+                *buf = mfree(*buf);
+                *buf = malloc(MIN(2 * (size + 1), limit + 1));
+                if (!*buf)
+                        return -ENOMEM;
+        }
+
+        /* Same safety check as in read_virtual_file_fd() */
+        if (!ret_size && memchr(*buf, 0, n))
+                return -EBADMSG;
+
+        (*buf)[n] = 0;
+
+        if (ret_size)
+                *ret_size = n;
+
+        return !truncated;
+}
+
 int read_full_stream_full(
                 FILE *f,
                 const char *filename,
@@ -848,18 +936,26 @@ int executable_is_script(const char *path, char **interpreter) {
  */
 int get_proc_field(const char *filename, const char *pattern, const char *terminator, char **field) {
         _cleanup_free_ char *status = NULL;
-        char *t, *f;
         int r;
 
-        assert(terminator);
         assert(filename);
-        assert(pattern);
-        assert(field);
 
         r = read_full_virtual_file(filename, &status, NULL);
         if (r < 0)
                 return r;
 
+        return get_proc_field_from_string(status, pattern, terminator, field);
+}
+
+int get_proc_field_from_string(const char *status, const char *pattern, const char *terminator, char **field) {
+        const char *t;
+        char *f;
+
+        assert(status);
+        assert(terminator);
+        assert(pattern);
+        assert(field);
+
         t = status;
 
         do {
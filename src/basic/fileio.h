@@ -90,6 +90,7 @@ static inline int read_virtual_file(const char *filename, size_t max_size, char
 static inline int read_full_virtual_file(const char *filename, char **ret_contents, size_t *ret_size) {
         return read_virtual_file(filename, SIZE_MAX, ret_contents, ret_size);
 }
+int read_virtual_file_at_buffer(int dir_fd, const char *filename, size_t max_size, char **buf, size_t *ret_size);
 
 int read_full_stream_full(FILE *f, const char *filename, uint64_t offset, size_t size, ReadFullFileFlags flags, char **ret_contents, size_t *ret_size);
 static inline int read_full_stream(FILE *f, char **ret_contents, size_t *ret_size) {
@@ -104,6 +105,7 @@ static inline int verify_file(const char *fn, const char *blob, bool accept_extr
 int executable_is_script(const char *path, char **interpreter);
 
 int get_proc_field(const char *filename, const char *pattern, const char *terminator, char **field);
+int get_proc_field_from_string(const char *status, const char *pattern, const char *terminator, char **field);
 
 DIR *xopendirat(int dirfd, const char *name, int flags);
 
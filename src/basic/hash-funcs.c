@@ -20,6 +20,12 @@ DEFINE_HASH_OPS_FULL(string_hash_ops_free_strv_free,
                      char, string_hash_func, string_compare_func, free,
                      char*, strv_free);
 
+const struct hash_ops string_hash_ops_trusted = {
+        .hash = (hash_func_t) string_hash_func,
+        .compare = (compare_func_t) string_compare_func,
+        .trusted_keys = true,
+};
+
 void path_hash_func(const char *q, struct siphash *state) {
         bool add_slash = false;
 
@@ -92,6 +98,12 @@ const struct hash_ops trivial_hash_ops_free_free = {
         .free_value = free,
 };
 
+const struct hash_ops trivial_hash_ops_trusted = {
+        .hash = trivial_hash_func,
+        .compare = trivial_compare_func,
+        .trusted_keys = true,
+};
+
 void uint64_hash_func(const uint64_t *p, struct siphash *state) {
         siphash24_compress_typesafe(*p, state);
 }
@@ -102,6 +114,12 @@ int uint64_compare_func(const uint64_t *a, const uint64_t *b) {
 
 DEFINE_HASH_OPS(uint64_hash_ops, uint64_t, uint64_hash_func, uint64_compare_func);
 
+const struct hash_ops uint64_hash_ops_trusted = {
+        .hash = (hash_func_t) uint64_hash_func,
+        .compare = (compare_func_t) uint64_compare_func,
+        .trusted_keys = true,
+};
+
 #if SIZEOF_DEV_T != 8
 void devt_hash_func(const dev_t *p, struct siphash *state) {
         siphash24_compress_typesafe(*p, state);
@@ -295,8 +295,8 @@ void hashmap_trim_pools(void) {
         if (r != 1)
                 return (void) log_debug("Not cleaning up memory pools, running in multi-threaded process.");
 
-        mempool_trim(&hashmap_pool);
-        mempool_trim(&ordered_hashmap_pool);
+        /* This releases the unused memory of all other pools too. */
+        mempool_trim_all();
 }
 
 #if HAVE_VALGRIND_VALGRIND_H
@@ -345,7 +345,10 @@ static unsigned base_bucket_hash(HashmapBase *h, const void *p) {
         struct siphash state;
         uint64_t hash;
 
-        siphash24_init(&state, hash_key(h));
+        if (h->hash_ops->trusted_keys)
+                siphash13_init(&state, hash_key(h));
+        else
+                siphash24_init(&state, hash_key(h));
 
         h->hash_ops->hash(p, &state);
 
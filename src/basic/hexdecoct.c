@@ -5,11 +5,80 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+#if defined(__x86_64__)
+#  include <immintrin.h>
+#elif defined(__aarch64__)
+#  include <arm_neon.h>
+#endif
+
 #include "alloc-util.h"
 #include "hexdecoct.h"
 #include "macro.h"
 #include "memory-util.h"
+#include "simd-util.h"
 #include "string-util.h"
+#include "unaligned.h"
+
+/* The vector code below only ever handles the easy bulk of the input, i.e. runs of valid characters without
+ * any whitespace and padding, in whole vectors. It returns the number of input bytes it consumed, always a
+ * multiple of the group size of the encoding, and the regular code continues from there and takes care of
+ * everything else. That way all errors are reported by the same code as before, with the same semantics. */
+
+#if defined(__x86_64__)
+/* Per byte 0xFF if lo <= c <= hi, and 0x00 otherwise. The comparisons are signed, which is fine, as all
+ * characters that are valid in any of the encodings are ASCII. */
+static inline __m128i in_range_sse2(__m128i c, char lo, char hi) {
+        return _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8(lo - 1)),
+                             _mm_cmplt_epi8(c, _mm_set1_epi8(hi + 1)));
+}
+
+_target_("avx2") static inline __m256i in_range_avx2(__m256i c, char lo, char hi) {
+        return _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8(lo - 1)),
+                                _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), c));
+}
+
+/* Copies the first n bytes of a vector to the output, for the final vector that is only partially valid */
+static inline void store_partial_sse2(void *z, __m128i v, size_t n) {
+        uint8_t t[sizeof(__m128i)];
+
+        assert(n <= sizeof(t));
+
+        _mm_storeu_si128((__m128i*) t, v);
+        memcpy(z, t, n);
+        explicit_bzero_safe(t, sizeof(t));
+}
+
+_target_("avx2") static inline void store_partial_avx2(void *z, __m256i v, size_t n) {
+        uint8_t t[sizeof(__m256i)];
+
+        assert(n <= sizeof(t));
+
+        _mm256_storeu_si256((__m256i*) t, v);
+        memcpy(z, t, n);
+        explicit_bzero_safe(t, sizeof(t));
+}
+#elif defined(__aarch64__)
+static inline uint8x16_t in_range_neon(uint8x16_t c, uint8_t lo, uint8_t hi) {
+        return vcleq_u8(vsubq_u8(c, vdupq_n_u8(lo)), vdupq_n_u8(hi - lo));
+}
+
+/* Returns the index of the first lane that is not 0xFF, or 16 if there is none */
+static inline size_t first_unset_lane_neon(uint8x16_t mask) {
+        uint64_t m;
+
+        /* Narrow each lane to 4 bits, so the whole mask fits into an integer */
+        m = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(mask), 4)), 0);
+        if (m == UINT64_MAX)
+                return 16;
+
+        return __builtin_ctzll(~m) / 4;
+}
+
+static inline void store_partial_neon(void *z, uint8_t *t, size_t n, size_t size) {
+        memcpy(z, t, n);
+        explicit_bzero_safe(t, size);
+}
+#endif
 
 char octchar(int x) {
         return '0' + (x & 7);
@@ -55,6 +124,93 @@ int unhexchar(char c) {
         return -EINVAL;
 }
 
+#if defined(__x86_64__)
+static inline __m128i hexchar_sse2(__m128i n) {
+        /* '0' + n, plus the distance from the character after '9' to 'a' for nibbles above 9 */
+        return _mm_add_epi8(_mm_add_epi8(n, _mm_set1_epi8('0')),
+                            _mm_and_si128(_mm_cmpgt_epi8(n, _mm_set1_epi8(9)), _mm_set1_epi8('a' - '9' - 1)));
+}
+
+static size_t hexmem_sse2(const uint8_t *x, size_t l, char *z) {
+        const __m128i mask = _mm_set1_epi8(15);
+        size_t i = 0;
+
+        for (; l - i >= sizeof(__m128i); i += sizeof(__m128i)) {
+                __m128i v = _mm_loadu_si128((const __m128i*) (x + i)), hi, lo;
+
+                hi = hexchar_sse2(_mm_and_si128(_mm_srli_epi16(v, 4), mask));
+                lo = hexchar_sse2(_mm_and_si128(v, mask));
+
+                _mm_storeu_si128((__m128i*) (z + 2 * i), _mm_unpacklo_epi8(hi, lo));
+                _mm_storeu_si128((__m128i*) (z + 2 * i + 16), _mm_unpackhi_epi8(hi, lo));
+        }
+
+        return i;
+}
+
+_target_("avx2") static inline __m256i hexchar_avx2(__m256i n) {
+        return _mm256_add_epi8(_mm256_add_epi8(n, _mm256_set1_epi8('0')),
+                               _mm256_and_si256(_mm256_cmpgt_epi8(n, _mm256_set1_epi8(9)),
+                                                _mm256_set1_epi8('a' - '9' - 1)));
+}
+
+_target_("avx2") static size_t hexmem_avx2(const uint8_t *x, size_t l, char *z) {
+        const __m256i mask = _mm256_set1_epi8(15);
+        size_t i = 0;
+
+        for (; l - i >= sizeof(__m256i); i += sizeof(__m256i)) {
+                __m256i v = _mm256_loadu_si256((const __m256i*) (x + i)), hi, lo, a, b;
+
+                hi = hexchar_avx2(_mm256_and_si256(_mm256_srli_epi16(v, 4), mask));
+                lo = hexchar_avx2(_mm256_and_si256(v, mask));
+
+                /* Interleaving works per 128-bit lane, hence put the lanes back in order afterwards */
+                a = _mm256_unpacklo_epi8(hi, lo);
+                b = _mm256_unpackhi_epi8(hi, lo);
+                _mm256_storeu_si256((__m256i*) (z + 2 * i), _mm256_permute2x128_si256(a, b, 0x20));
+                _mm256_storeu_si256((__m256i*) (z + 2 * i + 32), _mm256_permute2x128_si256(a, b, 0x31));
+        }
+
+        return i;
+}
+#elif defined(__aarch64__)
+static size_t hexmem_neon(const uint8_t *x, size_t l, char *z) {
+        const uint8x16_t table = vld1q_u8((const uint8_t*) "0123456789abcdef");
+        size_t i = 0;
+
+        for (; l - i >= sizeof(uint8x16_t); i += sizeof(uint8x16_t)) {
+                uint8x16_t v = vld1q_u8(x + i);
+                uint8x16x2_t c = {{
+                        vqtbl1q_u8(table, vshrq_n_u8(v, 4)),
+                        vqtbl1q_u8(table, vandq_u8(v, vdupq_n_u8(15))),
+                }};
+
+                vst2q_u8((uint8_t*) z + 2 * i, c);
+        }
+
+        return i;
+}
+#endif
+
+static size_t hexmem_simd(const uint8_t *x, size_t l, char *z) {
+#if defined(__x86_64__)
+        SimdLevel level = simd_level();
+        size_t i = 0;
+
+        if (level >= SIMD_AVX2)
+                i = hexmem_avx2(x, l, z);
+        if (level >= SIMD_BASELINE)
+                i += hexmem_sse2(x + i, l - i, z + 2 * i);
+
+        return i;
+#elif defined(__aarch64__)
+        if (simd_level() >= SIMD_BASELINE)
+                return hexmem_neon(x, l, z);
+#endif
+
+        return 0;
+}
+
 char* hexmem(const void *p, size_t l) {
         const uint8_t *x;
         char *r, *z;
@@ -65,7 +221,15 @@ char* hexmem(const void *p, size_t l) {
         if (!r)
                 return NULL;
 
-        for (x = p; x && x < (const uint8_t*) p + l; x++) {
+        x = p;
+        if (l > 0) {
+                size_t k = hexmem_simd(x, l, z);
+
+                x += k;
+                z += k * 2;
+        }
+
+        for (; x && x < (const uint8_t*) p + l; x++) {
                 *(z++) = hexchar(*x >> 4);
                 *(z++) = hexchar(*x & 15);
         }
@@ -110,6 +274,157 @@ static int unhex_next(const char **p, size_t *l) {
         return r;
 }
 
+#if defined(__x86_64__)
+/* Returns the values of the hex digits in c, and the lanes that are hex digits in the first place */
+static inline __m128i unhexchar_sse2(__m128i c, __m128i *ret_valid) {
+        __m128i lower = _mm_or_si128(c, _mm_set1_epi8(0x20)), digit, alpha;
+
+        digit = in_range_sse2(c, '0', '9');
+        alpha = in_range_sse2(lower, 'a', 'f');
+
+        *ret_valid = _mm_or_si128(digit, alpha);
+        return _mm_or_si128(_mm_and_si128(digit, _mm_sub_epi8(c, _mm_set1_epi8('0'))),
+                            _mm_and_si128(alpha, _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10))));
+}
+
+/* Merges pairs of nibbles, the first one being the high one, into a byte per 16-bit lane */
+static inline __m128i unhex_merge_sse2(__m128i v) {
+        return _mm_or_si128(_mm_slli_epi16(_mm_and_si128(v, _mm_set1_epi16(0xff)), 4), _mm_srli_epi16(v, 8));
+}
+
+static size_t unhexmem_sse2(const char *x, size_t l, uint8_t *z) {
+        size_t i = 0;
+
+        for (; l - i >= 2 * sizeof(__m128i); i += 2 * sizeof(__m128i)) {
+                __m128i a, b, va, vb, out;
+                uint32_t m;
+
+                a = unhexchar_sse2(_mm_loadu_si128((const __m128i*) (x + i)), &va);
+                b = unhexchar_sse2(_mm_loadu_si128((const __m128i*) (x + i + 16)), &vb);
+                m = (uint32_t) _mm_movemask_epi8(va) | (uint32_t) _mm_movemask_epi8(vb) << 16;
+
+                out = _mm_packus_epi16(unhex_merge_sse2(a), unhex_merge_sse2(b));
+
+                if (m != UINT32_MAX) {
+                        size_t n = __builtin_ctz(~m) & ~1U;
+
+                        store_partial_sse2(z + i / 2, out, n / 2);
+                        return i + n;
+                }
+
+                _mm_storeu_si128((__m128i*) (z + i / 2), out);
+        }
+
+        return i;
+}
+
+_target_("avx2") static inline __m256i unhexchar_avx2(__m256i c, __m256i *ret_valid) {
+        __m256i lower = _mm256_or_si256(c, _mm256_set1_epi8(0x20)), digit, alpha;
+
+        digit = in_range_avx2(c, '0', '9');
+        alpha = in_range_avx2(lower, 'a', 'f');
+
+        *ret_valid = _mm256_or_si256(digit, alpha);
+        return _mm256_or_si256(_mm256_and_si256(digit, _mm256_sub_epi8(c, _mm256_set1_epi8('0'))),
+                               _mm256_and_si256(alpha, _mm256_sub_epi8(lower, _mm256_set1_epi8('a' - 10))));
+}
+
+_target_("avx2") static inline __m256i unhex_merge_avx2(__m256i v) {
+        return _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(v, _mm256_set1_epi16(0xff)), 4),
+                               _mm256_srli_epi16(v, 8));
+}
+
+_target_("avx2") static size_t unhexmem_avx2(const char *x, size_t l, uint8_t *z) {
+        size_t i = 0;
+
+        for (; l - i >= 2 * sizeof(__m256i); i += 2 * sizeof(__m256i)) {
+                __m256i a, b, va, vb, out;
+                uint64_t m;
+
+                a = unhexchar_avx2(_mm256_loadu_si256((const __m256i*) (x + i)), &va);
+                b = unhexchar_avx2(_mm256_loadu_si256((const __m256i*) (x + i + 32)), &vb);
+                m = (uint64_t) (uint32_t) _mm256_movemask_epi8(va) |
+                    (uint64_t) (uint32_t) _mm256_movemask_epi8(vb) << 32;
+
+                /* Packing works per 128-bit lane, hence put the 64-bit quarters back in order afterwards */
+                out = _mm256_permute4x64_epi64(_mm256_packus_epi16(unhex_merge_avx2(a), unhex_merge_avx2(b)),
+                                               _MM_SHUFFLE(3, 1, 2, 0));
+
+                if (m != UINT64_MAX) {
+                        size_t n = __builtin_ctzll(~m) & ~1U;
+
+                        store_partial_avx2(z + i / 2, out, n / 2);
+                        return i + n;
+                }
+
+                _mm256_storeu_si256((__m256i*) (z + i / 2), out);
+        }
+
+        return i;
+}
+#elif defined(__aarch64__)
+static inline uint8x16_t unhexchar_neon(uint8x16_t c, uint8x16_t *ret_valid) {
+        uint8x16_t lower = vorrq_u8(c, vdupq_n_u8(0x20)), digit, alpha;
+
+        digit = in_range_neon(c, '0', '9');
+        alpha = in_range_neon(lower, 'a', 'f');
+
+        *ret_valid = vorrq_u8(digit, alpha);
+        return vorrq_u8(vandq_u8(digit, vsubq_u8(c, vdupq_n_u8('0'))),
+                        vandq_u8(alpha, vsubq_u8(lower, vdupq_n_u8('a' - 10))));
+}
+
+static size_t unhexmem_neon(const char *x, size_t l, uint8_t *z) {
+        size_t i = 0;
+
+        for (; l - i >= 2 * sizeof(uint8x16_t); i += 2 * sizeof(uint8x16_t)) {
+                /* Loads the first digit of each pair into the first vector, the second one into the other */
+                uint8x16x2_t c = vld2q_u8((const uint8_t*) x + i);
+                uint8x16_t hi, lo, vhi, vlo, out;
+                size_t n;
+
+                hi = unhexchar_neon(c.val[0], &vhi);
+                lo = unhexchar_neon(c.val[1], &vlo);
+                out = vorrq_u8(vshlq_n_u8(hi, 4), lo);
+
+                n = first_unset_lane_neon(vandq_u8(vhi, vlo));
+                if (n < 16) {
+                        uint8_t t[16];
+
+                        vst1q_u8(t, out);
+                        store_partial_neon(z + i / 2, t, n, sizeof(t));
+                        return i + 2 * n;
+                }
+
+                vst1q_u8(z + i / 2, out);
+        }
+
+        return i;
+}
+#endif
+
+static size_t unhexmem_simd(const char *x, size_t l, uint8_t *z) {
+#if defined(__x86_64__)
+        SimdLevel level = simd_level();
+        size_t i = 0;
+
+        if (level >= SIMD_AVX2) {
+                i = unhexmem_avx2(x, l, z);
+                if (l - i >= 64) /* Stopped at something that is not a hex digit */
+                        return i;
+        }
+        if (level >= SIMD_BASELINE)
+                i += unhexmem_sse2(x + i, l - i, z + i / 2);
+
+        return i;
+#elif defined(__aarch64__)
+        if (simd_level() >= SIMD_BASELINE)
+                return unhexmem_neon(x, l, z);
+#endif
+
+        return 0;
+}
+
 int unhexmem_full(
                 const char *p,
                 size_t l,
@@ -138,6 +453,15 @@ int unhexmem_full(
         for (x = p, z = buf;;) {
                 int a, b;
 
+                /* Decode runs of hex digits in bulk first, if there are any at this point */
+                if (l > 0) {
+                        size_t k = unhexmem_simd(x, l, z);
+
+                        x += k;
+                        l -= k;
+                        z += k / 2;
+                }
+
                 a = unhex_next(&x, &l);
                 if (a == -EPIPE) /* End of string */
                         break;
@@ -581,6 +905,147 @@ static void maybe_line_break(char **x, char *start, size_t line_break) {
                 *((*x)++) = '\n';
 }
 
+#if defined(__x86_64__)
+/* Splits each of the four groups of three input bytes in the first 12 bytes of v into four 6-bit values, one
+ * per output byte, in the order they are written */
+_target_("ssse3") static inline __m128i base64_split_ssse3(__m128i v) {
+        __m128i a, b;
+
+        v = _mm_shuffle_epi8(v, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+
+        /* Move the first and third value of each group into place with a multiplication of the high
+         * half, and the second and fourth one with one of the low half */
+        a = _mm_mulhi_epu16(_mm_and_si128(v, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+        b = _mm_mullo_epi16(_mm_and_si128(v, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+
+        return _mm_or_si128(a, b);
+}
+
+/* Turns 6-bit values into characters by adding the offset to the range of the alphabet they fall into */
+_target_("ssse3") static inline __m128i base64char_ssse3(__m128i v) {
+        const __m128i offsets = _mm_setr_epi8('A', 'a' - 26,
+                                              '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                              '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                              '+' - 62, '/' - 63, 0, 0);
+        __m128i i;
+
+        /* 0…25 → 0, 26…51 → 1, 52…61 → 2…11, 62 → 12, 63 → 13 */
+        i = _mm_subs_epu8(v, _mm_set1_epi8(51));
+        i = _mm_sub_epi8(i, _mm_cmpgt_epi8(v, _mm_set1_epi8(25)));
+
+        return _mm_add_epi8(v, _mm_shuffle_epi8(offsets, i));
+}
+
+_target_("ssse3") static size_t base64mem_ssse3(const uint8_t *x, size_t l, char *z) {
+        size_t i = 0;
+
+        /* This loads 16 bytes, but only consumes 12 of them */
+        for (; l - i >= sizeof(__m128i); i += 12, z += sizeof(__m128i)) {
+                __m128i v = _mm_loadu_si128((const __m128i*) (x + i));
+
+                _mm_storeu_si128((__m128i*) z, base64char_ssse3(base64_split_ssse3(v)));
+        }
+
+        return i;
+}
+
+_target_("avx2") static inline __m256i base64_split_avx2(__m256i v) {
+        __m256i a, b;
+
+        v = _mm256_shuffle_epi8(v, _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+                                                   10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+
+        a = _mm256_mulhi_epu16(_mm256_and_si256(v, _mm256_set1_epi32(0x0fc0fc00)), _mm256_set1_epi32(0x04000040));
+        b = _mm256_mullo_epi16(_mm256_and_si256(v, _mm256_set1_epi32(0x003f03f0)), _mm256_set1_epi32(0x01000010));
+
+        return _mm256_or_si256(a, b);
+}
+
+_target_("avx2") static inline __m256i base64char_avx2(__m256i v) {
+        const __m256i offsets = _mm256_setr_epi8('A', 'a' - 26,
+                                                 '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                                 '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                                 '+' - 62, '/' - 63, 0, 0,
+                                                 'A', 'a' - 26,
+                                                 '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                                 '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                                 '+' - 62, '/' - 63, 0, 0);
+        __m256i i;
+
+        i = _mm256_subs_epu8(v, _mm256_set1_epi8(51));
+        i = _mm256_sub_epi8(i, _mm256_cmpgt_epi8(v, _mm256_set1_epi8(25)));
+
+        return _mm256_add_epi8(v, _mm256_shuffle_epi8(offsets, i));
+}
+
+_target_("avx2") static size_t base64mem_avx2(const uint8_t *x, size_t l, char *z) {
+        size_t i = 0;
+
+        /* Each 128-bit lane is processed like above, the second one starting 12 bytes in. This reads 28
+         * bytes and consumes 24. */
+        for (; l - i >= 28; i += 24, z += sizeof(__m256i)) {
+                __m256i v;
+
+                v = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*) (x + i))),
+                                            _mm_loadu_si128((const __m128i*) (x + i + 12)), 1);
+
+                _mm256_storeu_si256((__m256i*) z, base64char_avx2(base64_split_avx2(v)));
+        }
+
+        return i;
+}
+#elif defined(__aarch64__)
+static size_t base64mem_neon(const uint8_t *x, size_t l, char *z) {
+        const uint8x16x4_t table = {{
+                vld1q_u8((const uint8_t*) "ABCDEFGHIJKLMNOP"),
+                vld1q_u8((const uint8_t*) "QRSTUVWXYZabcdef"),
+                vld1q_u8((const uint8_t*) "ghijklmnopqrstuv"),
+                vld1q_u8((const uint8_t*) "wxyz0123456789+/"),
+        }};
+        size_t i = 0;
+
+        for (; l - i >= 3 * sizeof(uint8x16_t); i += 3 * sizeof(uint8x16_t), z += 4 * sizeof(uint8x16_t)) {
+                /* Loads the first byte of each group of three into the first vector, and so on */
+                uint8x16x3_t v = vld3q_u8(x + i);
+                uint8x16x4_t c;
+
+                c.val[0] = vshrq_n_u8(v.val[0], 2);
+                c.val[1] = vorrq_u8(vshlq_n_u8(vandq_u8(v.val[0], vdupq_n_u8(3)), 4), vshrq_n_u8(v.val[1], 4));
+                c.val[2] = vorrq_u8(vshlq_n_u8(vandq_u8(v.val[1], vdupq_n_u8(15)), 2), vshrq_n_u8(v.val[2], 6));
+                c.val[3] = vandq_u8(v.val[2], vdupq_n_u8(63));
+
+                for (size_t k = 0; k < 4; k++)
+                        c.val[k] = vqtbl4q_u8(table, c.val[k]);
+
+                vst4q_u8((uint8_t*) z, c);
+        }
+
+        return i;
+}
+#endif
+
+static size_t base64mem_simd(const uint8_t *x, size_t l, char *z) {
+        /* Encodes whole groups of three bytes only, never more than l bytes. The caller limits l to what
+         * fits into the current line. */
+
+#if defined(__x86_64__)
+        SimdLevel level = simd_level();
+        size_t i = 0;
+
+        if (level >= SIMD_AVX2)
+                i = base64mem_avx2(x, l, z);
+        if (level >= SIMD_SSSE3)
+                i += base64mem_ssse3(x + i, l - i, z + i / 3 * 4);
+
+        return i;
+#elif defined(__aarch64__)
+        if (simd_level() >= SIMD_BASELINE)
+                return base64mem_neon(x, l, z);
+#endif
+
+        return 0;
+}
+
 ssize_t base64mem_full(
                 const void *p,
                 size_t l,
@@ -605,6 +1070,23 @@ ssize_t base64mem_full(
                 return -ENOMEM;
 
         for (x = p; x && x < (const uint8_t*) p + (l / 3) * 3; x += 3) {
+                size_t n = (const uint8_t*) p + (l / 3) * 3 - x, k;
+
+                /* Encode in bulk first, as much as fits into the current line */
+                if (line_break != SIZE_MAX) {
+                        maybe_line_break(&z, b, line_break);
+                        n = MIN(n, (line_break - (size_t) (z - b) % (line_break + 1)) / 4 * 3);
+                }
+
+                k = base64mem_simd(x, n, z);
+                if (k > 0) {
+                        x += k;
+                        z += k / 3 * 4;
+
+                        if (x >= (const uint8_t*) p + (l / 3) * 3)
+                                break;
+                }
+
                 /* x[0] == XXXXXXXX; x[1] == YYYYYYYY; x[2] == ZZZZZZZZ */
                 maybe_line_break(&z, b, line_break);
                 *(z++) = base64char(x[0] >> 2);                    /* 00XXXXXX */
@@ -762,6 +1244,187 @@ static int unbase64_next(const char **p, size_t *l) {
         return ret;
 }
 
+#if defined(__x86_64__)
+/* Returns the 6-bit values of the characters in c, and the lanes that are valid characters, in both the
+ * regular and the URL safe alphabet like unbase64char() */
+static inline __m128i unbase64char_sse2(__m128i c, __m128i *ret_valid) {
+        __m128i upper, lower, digit, plus, slash;
+
+        upper = in_range_sse2(c, 'A', 'Z');
+        lower = in_range_sse2(c, 'a', 'z');
+        digit = in_range_sse2(c, '0', '9');
+        plus = _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('+')), _mm_cmpeq_epi8(c, _mm_set1_epi8('-')));
+        slash = _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('/')), _mm_cmpeq_epi8(c, _mm_set1_epi8('_')));
+
+        *ret_valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(_mm_or_si128(digit, plus), slash));
+
+        return _mm_or_si128(
+                        _mm_or_si128(_mm_and_si128(upper, _mm_sub_epi8(c, _mm_set1_epi8('A'))),
+                                     _mm_and_si128(lower, _mm_sub_epi8(c, _mm_set1_epi8('a' - 26)))),
+                        _mm_or_si128(_mm_and_si128(digit, _mm_sub_epi8(c, _mm_set1_epi8('0' - 52))),
+                                     _mm_or_si128(_mm_and_si128(plus, _mm_set1_epi8(62)),
+                                                  _mm_and_si128(slash, _mm_set1_epi8(63)))));
+}
+
+/* Merges each group of four 6-bit values into three bytes, in the first 12 bytes of the result */
+_target_("ssse3") static inline __m128i unbase64_merge_ssse3(__m128i v) {
+        v = _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140)); /* 0000XXXX XXYYYYYY per 16 bits */
+        v = _mm_madd_epi16(v, _mm_set1_epi32(0x00011000));    /* 00000000 XXXXXXYY YYYYZZZZ ZZWWWWWW per 32 bits */
+
+        return _mm_shuffle_epi8(v, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+}
+
+_target_("ssse3") static size_t unbase64mem_ssse3(const char *x, size_t l, uint8_t *z) {
+        size_t i = 0;
+
+        for (; l - i >= sizeof(__m128i); i += sizeof(__m128i), z += 12) {
+                __m128i v, valid;
+                unsigned m;
+
+                v = unbase64_merge_ssse3(unbase64char_sse2(_mm_loadu_si128((const __m128i*) (x + i)), &valid));
+
+                m = (unsigned) _mm_movemask_epi8(valid);
+                if (m != 0xFFFFU) {
+                        size_t n = __builtin_ctz(~m) & ~3U;
+
+                        store_partial_sse2(z, v, n / 4 * 3);
+                        return i + n;
+                }
+
+                _mm_storel_epi64((__m128i*) z, v);
+                unaligned_write_ne32(z + 8, (uint32_t) _mm_cvtsi128_si32(_mm_srli_si128(v, 8)));
+        }
+
+        return i;
+}
+
+_target_("avx2") static inline __m256i unbase64char_avx2(__m256i c, __m256i *ret_valid) {
+        __m256i upper, lower, digit, plus, slash;
+
+        upper = in_range_avx2(c, 'A', 'Z');
+        lower = in_range_avx2(c, 'a', 'z');
+        digit = in_range_avx2(c, '0', '9');
+        plus = _mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('+')), _mm256_cmpeq_epi8(c, _mm256_set1_epi8('-')));
+        slash = _mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('/')), _mm256_cmpeq_epi8(c, _mm256_set1_epi8('_')));
+
+        *ret_valid = _mm256_or_si256(_mm256_or_si256(upper, lower),
+                                     _mm256_or_si256(_mm256_or_si256(digit, plus), slash));
+
+        return _mm256_or_si256(
+                        _mm256_or_si256(_mm256_and_si256(upper, _mm256_sub_epi8(c, _mm256_set1_epi8('A'))),
+                                        _mm256_and_si256(lower, _mm256_sub_epi8(c, _mm256_set1_epi8('a' - 26)))),
+                        _mm256_or_si256(_mm256_and_si256(digit, _mm256_sub_epi8(c, _mm256_set1_epi8('0' - 52))),
+                                        _mm256_or_si256(_mm256_and_si256(plus, _mm256_set1_epi8(62)),
+                                                        _mm256_and_si256(slash, _mm256_set1_epi8(63)))));
+}
+
+_target_("avx2") static inline __m256i unbase64_merge_avx2(__m256i v) {
+        v = _mm256_maddubs_epi16(v, _mm256_set1_epi32(0x01400140));
+        v = _mm256_madd_epi16(v, _mm256_set1_epi32(0x00011000));
+        v = _mm256_shuffle_epi8(v, _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                                    2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+
+        /* Close the gap between the 12 bytes of both 128-bit lanes */
+        return _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+}
+
+_target_("avx2") static size_t unbase64mem_avx2(const char *x, size_t l, uint8_t *z) {
+        size_t i = 0;
+
+        for (; l - i >= sizeof(__m256i); i += sizeof(__m256i), z += 24) {
+                __m256i v, valid;
+                uint32_t m;
+
+                v = unbase64_merge_avx2(unbase64char_avx2(_mm256_loadu_si256((const __m256i*) (x + i)), &valid));
+
+                m = (uint32_t) _mm256_movemask_epi8(valid);
+                if (m != UINT32_MAX) {
+                        size_t n = __builtin_ctz(~m) & ~3U;
+
+                        store_partial_avx2(z, v, n / 4 * 3);
+                        return i + n;
+                }
+
+                _mm_storeu_si128((__m128i*) z, _mm256_castsi256_si128(v));
+                _mm_storel_epi64((__m128i*) (z + 16), _mm256_extracti128_si256(v, 1));
+        }
+
+        return i;
+}
+#elif defined(__aarch64__)
+static inline uint8x16_t unbase64char_neon(uint8x16_t c, uint8x16_t *ret_valid) {
+        uint8x16_t upper, lower, digit, plus, slash;
+
+        upper = in_range_neon(c, 'A', 'Z');
+        lower = in_range_neon(c, 'a', 'z');
+        digit = in_range_neon(c, '0', '9');
+        plus = vorrq_u8(vceqq_u8(c, vdupq_n_u8('+')), vceqq_u8(c, vdupq_n_u8('-')));
+        slash = vorrq_u8(vceqq_u8(c, vdupq_n_u8('/')), vceqq_u8(c, vdupq_n_u8('_')));
+
+        *ret_valid = vorrq_u8(vorrq_u8(upper, lower), vorrq_u8(vorrq_u8(digit, plus), slash));
+
+        return vorrq_u8(vorrq_u8(vandq_u8(upper, vsubq_u8(c, vdupq_n_u8('A'))),
+                                 vandq_u8(lower, vsubq_u8(c, vdupq_n_u8('a' - 26)))),
+                        vorrq_u8(vandq_u8(digit, vaddq_u8(c, vdupq_n_u8(52 - '0'))),
+                                 vorrq_u8(vandq_u8(plus, vdupq_n_u8(62)),
+                                          vandq_u8(slash, vdupq_n_u8(63)))));
+}
+
+static size_t unbase64mem_neon(const char *x, size_t l, uint8_t *z) {
+        size_t i = 0;
+
+        for (; l - i >= 4 * sizeof(uint8x16_t); i += 4 * sizeof(uint8x16_t), z += 3 * sizeof(uint8x16_t)) {
+                /* Loads the first character of each group of four into the first vector, and so on */
+                uint8x16x4_t c = vld4q_u8((const uint8_t*) x + i);
+                uint8x16_t v[4], valid[4];
+                uint8x16x3_t out;
+                size_t n;
+
+                for (size_t k = 0; k < 4; k++)
+                        v[k] = unbase64char_neon(c.val[k], valid + k);
+
+                out.val[0] = vorrq_u8(vshlq_n_u8(v[0], 2), vshrq_n_u8(v[1], 4));
+                out.val[1] = vorrq_u8(vshlq_n_u8(v[1], 4), vshrq_n_u8(v[2], 2));
+                out.val[2] = vorrq_u8(vshlq_n_u8(v[2], 6), v[3]);
+
+                n = first_unset_lane_neon(vandq_u8(vandq_u8(valid[0], valid[1]), vandq_u8(valid[2], valid[3])));
+                if (n < 16) {
+                        uint8_t t[3 * 16];
+
+                        vst3q_u8(t, out);
+                        store_partial_neon(z, t, 3 * n, sizeof(t));
+                        return i + 4 * n;
+                }
+
+                vst3q_u8(z, out);
+        }
+
+        return i;
+}
+#endif
+
+static size_t unbase64mem_simd(const char *x, size_t l, uint8_t *z) {
+#if defined(__x86_64__)
+        SimdLevel level = simd_level();
+        size_t i = 0;
+
+        if (level >= SIMD_AVX2) {
+                i = unbase64mem_avx2(x, l, z);
+                if (l - i >= 32) /* Stopped at something that is not part of the alphabet */
+                        return i;
+        }
+        if (level >= SIMD_SSSE3)
+                i += unbase64mem_ssse3(x + i, l - i, z + i / 4 * 3);
+
+        return i;
+#elif defined(__aarch64__)
+        if (simd_level() >= SIMD_BASELINE)
+                return unbase64mem_neon(x, l, z);
+#endif
+
+        return 0;
+}
+
 int unbase64mem_full(
                 const char *p,
                 size_t l,
@@ -792,6 +1455,15 @@ int unbase64mem_full(
         for (x = p, z = buf;;) {
                 int a, b, c, d; /* a == 00XXXXXX; b == 00YYYYYY; c == 00ZZZZZZ; d == 00WWWWWW */
 
+                /* Decode runs without whitespace and padding in bulk first, if there are any at this point */
+                if (l > 0) {
+                        size_t k = unbase64mem_simd(x, l, z);
+
+                        x += k;
+                        l -= k;
+                        z += k / 4 * 3;
+                }
+
                 a = unbase64_next(&x, &l);
                 if (a == -EPIPE) /* End of string */
                         break;
@@ -24,6 +24,7 @@
 #include "iovec-util.h"
 #include "log.h"
 #include "macro.h"
+#include "memory-util.h"
 #include "missing_syscall.h"
 #include "missing_threads.h"
 #include "parse-util.h"
@@ -44,6 +45,10 @@
 #define SNDBUF_SIZE (8*1024*1024)
 #define IOVEC_MAX 256U
 
+/* Bounds of the buffer of asynchronous logging, see log_async_append() */
+#define LOG_ASYNC_BUFFER_SIZE (64U*1024U)
+#define LOG_ASYNC_ENTRIES_MAX 64U
+
 static log_syntax_callback_t log_syntax_callback = NULL;
 static void *log_syntax_callback_userdata = NULL;
 
@@ -76,6 +81,19 @@ static bool always_reopen_console = false;
 static bool open_when_needed = false;
 static bool prohibit_ipc = false;
 static bool assert_return_is_critical = BUILD_MODE_DEVELOPER;
+static bool log_async = false;
+
+typedef struct LogAsyncBuffer {
+        pid_t pid; /* The process that buffered the messages, so that forked off children don't send them again */
+        size_t size;
+        size_t n_entries;
+        uint64_t n_dropped;
+        struct iovec entries[LOG_ASYNC_ENTRIES_MAX];
+        struct mmsghdr msgs[LOG_ASYNC_ENTRIES_MAX];
+        char buffer[LOG_ASYNC_BUFFER_SIZE];
+} LogAsyncBuffer;
+
+static LogAsyncBuffer *log_async_buffer = NULL;
 
 /* Akin to glibc's __abort_msg; which is private and we hence cannot
  * use here. */
@@ -292,6 +310,9 @@ int log_open(void) {
          * reference an error that happened immediately before the log_open() call. */
         PROTECT_ERRNO;
 
+        /* Send what was buffered before we possibly close the journal socket below */
+        log_flush();
+
         /* If we don't use the console, we close it here to not get killed by SAK. If we don't use syslog, we
          * close it here too, so that we are not confused by somebody deleting the socket in the fs, and to
          * make sure we don't use it if prohibit_ipc is set. If we don't use /dev/kmsg we still keep it open,
@@ -382,6 +403,8 @@ void log_set_target_and_open(LogTarget target) {
 void log_close(void) {
         /* Do not call from library code. */
 
+        log_flush();
+
         log_close_journal();
         log_close_syslog();
         log_close_kmsg();
@@ -721,6 +744,141 @@ static void log_do_context(struct iovec *iovec, size_t iovec_len, size_t *n) {
         }
 }
 
+static bool log_async_applies(int level) {
+        /* Messages on LOG_CRIT or higher are sent right away, as we might be about to die. Only the main
+         * thread buffers messages, which means the buffer needs no locking, and other threads log
+         * synchronously. Also, don't buffer if the journal socket is closed after each message. */
+        return log_async && LOG_PRI(level) > LOG_CRIT && !open_when_needed && is_main_thread();
+}
+
+static void log_async_reset(void) {
+        assert(log_async_buffer);
+
+        log_async_buffer->size = 0;
+        log_async_buffer->n_entries = 0;
+
+        if (log_async_buffer->pid != getpid_cached()) {
+                log_async_buffer->pid = getpid_cached();
+                log_async_buffer->n_dropped = 0;
+        }
+}
+
+static int log_async_append(const struct iovec *iovec, size_t n) {
+        size_t size;
+        char *p;
+
+        /* Copies a native journal message into the buffer, which is sent with sendmmsg() in log_flush()
+         * later, for processes that log a lot and should not be slowed down by a syscall per message.
+         * Returns 0 if the message cannot be buffered and should be sent directly instead. */
+
+        size = iovec_total_size(iovec, n);
+        if (size > LOG_ASYNC_BUFFER_SIZE)
+                return 0;
+
+        if (!log_async_buffer) {
+                log_async_buffer = new(LogAsyncBuffer, 1);
+                if (!log_async_buffer)
+                        return 0;
+
+                log_async_buffer->pid = 0;
+                log_async_reset();
+
+                /* Make sure nothing is lost if we exit without closing the log */
+                (void) atexit(log_flush);
+        } else if (log_async_buffer->pid != getpid_cached())
+                /* Leave sending the messages buffered before fork() to the parent */
+                log_async_reset();
+
+        if (log_async_buffer->size + size > LOG_ASYNC_BUFFER_SIZE ||
+            log_async_buffer->n_entries >= LOG_ASYNC_ENTRIES_MAX) {
+                log_flush();
+
+                /* Flushing might have logged about dropped messages */
+                if (log_async_buffer->size + size > LOG_ASYNC_BUFFER_SIZE ||
+                    log_async_buffer->n_entries >= LOG_ASYNC_ENTRIES_MAX)
+                        return 0;
+        }
+
+        p = log_async_buffer->buffer + log_async_buffer->size;
+        log_async_buffer->entries[log_async_buffer->n_entries++] = IOVEC_MAKE(p, size);
+        log_async_buffer->size += size;
+
+        for (size_t i = 0; i < n; i++)
+                p = mempcpy_safe(p, iovec[i].iov_base, iovec[i].iov_len);
+
+        return 1;
+}
+
+void log_flush(void) {
+        uint64_t n_dropped;
+        size_t n, m = 0;
+
+        /* Sends all messages buffered for the journal. Called before anything is sent synchronously to
+         * keep the order of messages, and by sd-event before it goes to sleep. */
+
+        if (!log_async_buffer || log_async_buffer->n_entries == 0)
+                return;
+
+        if (log_async_buffer->pid != getpid_cached()) {
+                log_async_reset();
+                return;
+        }
+
+        PROTECT_ERRNO;
+
+        n = log_async_buffer->n_entries;
+
+        if (journal_fd >= 0) {
+                for (size_t i = 0; i < n; i++)
+                        log_async_buffer->msgs[i] = (struct mmsghdr) {
+                                .msg_hdr.msg_iov = log_async_buffer->entries + i,
+                                .msg_hdr.msg_iovlen = 1,
+                        };
+
+                while (m < n) {
+                        int k;
+
+                        k = sendmmsg(journal_fd, log_async_buffer->msgs + m, n - m, MSG_NOSIGNAL);
+                        if (k < 0) {
+                                if (errno == EINTR)
+                                        continue;
+                                if (errno != EAGAIN)
+                                        log_close_journal();
+                                break;
+                        }
+
+                        m += k;
+                }
+        }
+
+        log_async_buffer->n_dropped += n - m;
+        log_async_reset();
+
+        if (m == 0 || log_async_buffer->n_dropped == 0)
+                return;
+
+        n_dropped = TAKE_GENERIC(log_async_buffer->n_dropped, uint64_t, 0);
+        log_warning("Dropped %" PRIu64 " buffered log messages, as they could not be sent to the journal.",
+                    n_dropped);
+}
+
+static int log_send_journal(int level, const struct iovec *iovec, size_t n) {
+        if (log_async_applies(level) && log_async_append(iovec, n) > 0)
+                return 0;
+
+        /* Send what was buffered first, to keep the order of messages */
+        log_flush();
+        if (journal_fd < 0)
+                return -EBADF;
+
+        const struct msghdr msghdr = {
+                .msg_iov = (struct iovec*) iovec,
+                .msg_iovlen = n,
+        };
+
+        return RET_NERRNO(sendmsg(journal_fd, &msghdr, MSG_NOSIGNAL));
+}
+
 static int write_to_journal(
                 int level,
                 int error,
@@ -736,6 +894,7 @@ static int write_to_journal(
         char header[LINE_MAX];
         size_t n = 0, iovec_len;
         struct iovec *iovec;
+        int r;
 
         if (journal_fd < 0)
                 return 0;
@@ -759,13 +918,9 @@ static int write_to_journal(
 
         log_do_context(iovec, iovec_len, &n);
 
-        const struct msghdr msghdr = {
-                .msg_iov = iovec,
-                .msg_iovlen = n,
-        };
-
-        if (sendmsg(journal_fd, &msghdr, MSG_NOSIGNAL) < 0)
-                return -errno;
+        r = log_send_journal(level, iovec, n);
+        if (r < 0)
+                return r;
 
         return 1;
 }
@@ -1111,12 +1266,7 @@ int log_struct_internal(
                         else {
                                 log_do_context(iovec, iovec_len, &n);
 
-                                const struct msghdr msghdr = {
-                                        .msg_iov = iovec,
-                                        .msg_iovlen = n,
-                                };
-
-                                (void) sendmsg(journal_fd, &msghdr, MSG_NOSIGNAL);
+                                (void) log_send_journal(level, iovec, n);
                         }
 
                         va_end(ap);
@@ -1205,12 +1355,7 @@ int log_struct_iovec_internal(
 
                 log_do_context(iovec, iovec_len, &n);
 
-                const struct msghdr msghdr = {
-                        .msg_iov = iovec,
-                        .msg_iovlen = n,
-                };
-
-                if (sendmsg(journal_fd, &msghdr, MSG_NOSIGNAL) >= 0)
+                if (log_send_journal(level, iovec, n) >= 0)
                         return -ERRNO_VALUE(error);
         }
 
@@ -1313,6 +1458,17 @@ int log_max_levels_to_string(int level, char **ret) {
         return 0;
 }
 
+static int log_set_async_from_string(const char *e) {
+        int r;
+
+        r = parse_boolean(e);
+        if (r < 0)
+                return r;
+
+        log_set_async(r);
+        return 0;
+}
+
 static int log_set_ratelimit_kmsg_from_string(const char *e) {
         int r;
 
@@ -1430,6 +1586,10 @@ void log_parse_environment_variables(void) {
         e = getenv("SYSTEMD_LOG_RATELIMIT_KMSG");
         if (e && log_set_ratelimit_kmsg_from_string(e) < 0)
                 log_warning("Failed to parse log ratelimit kmsg boolean '%s', ignoring.", e);
+
+        e = getenv("SYSTEMD_LOG_ASYNC");
+        if (e && log_set_async_from_string(e) < 0)
+                log_warning("Failed to parse log async boolean '%s', ignoring.", e);
 }
 
 void log_parse_environment(void) {
@@ -1709,6 +1869,17 @@ void log_set_prohibit_ipc(bool b) {
         prohibit_ipc = b;
 }
 
+void log_set_async(bool b) {
+        if (!b)
+                log_flush();
+
+        log_async = b;
+}
+
+bool log_get_async(void) {
+        return log_async;
+}
+
 int log_emergency_level(void) {
         /* Returns the log level to use for log_emergency() logging. We use LOG_EMERG only when we are PID 1, as only
          * then the system of the whole system is obviously affected. */
@@ -334,6 +334,13 @@ void log_set_open_when_needed(bool b);
  * stderr, the console or kmsg */
 void log_set_prohibit_ipc(bool b);
 
+/* If turned on, messages to the journal below LOG_CRIT are buffered, and sent in batches by log_flush(),
+ * which is called whenever the buffer is full, before anything is logged synchronously, by sd-event
+ * before it waits for events, and at exit. */
+void log_set_async(bool b);
+bool log_get_async(void) _pure_;
+void log_flush(void);
+
 void log_set_assert_return_is_critical(bool b);
 bool log_get_assert_return_is_critical(void) _pure_;
 
@@ -7,6 +7,7 @@
 #include "macro.h"
 #include "memory-util.h"
 #include "mempool.h"
+#include "string-util.h"
 
 struct pool {
         struct pool *next;
@@ -14,10 +15,25 @@ struct pool {
         size_t n_used;
 };
 
+/* All pools that allocated memory so far, for statistics and mempool_trim_all(). Pools are only used
+ * from the main thread, hence no locking. */
+static struct mempool *registered_pools = NULL;
+
 static void* pool_ptr(struct pool *p) {
         return ((uint8_t*) ASSERT_PTR(p)) + ALIGN(sizeof(struct pool));
 }
 
+static void mempool_register(struct mempool *mp) {
+        assert(mp);
+
+        if (mp->registered)
+                return;
+
+        mp->next_registered = registered_pools;
+        registered_pools = mp;
+        mp->registered = true;
+}
+
 void* mempool_alloc_tile(struct mempool *mp) {
         size_t i;
 
@@ -33,6 +49,7 @@ void* mempool_alloc_tile(struct mempool *mp) {
 
                 t = mp->freelist;
                 mp->freelist = *(void**) mp->freelist;
+                mp->n_tiles_used++;
                 return t;
         }
 
@@ -55,9 +72,11 @@ void* mempool_alloc_tile(struct mempool *mp) {
                 p->n_used = 0;
 
                 mp->first_pool = p;
+                mempool_register(mp);
         }
 
         i = mp->first_pool->n_used++;
+        mp->n_tiles_used++;
 
         return (uint8_t*) pool_ptr(mp->first_pool) + i*mp->tile_size;
 }
@@ -80,6 +99,9 @@ void* mempool_free_tile(struct mempool *mp, void *p) {
         *(void**) p = mp->freelist;
         mp->freelist = p;
 
+        assert(mp->n_tiles_used > 0);
+        mp->n_tiles_used--;
+
         return NULL;
 }
 
@@ -173,3 +195,40 @@ void mempool_trim(struct mempool *mp) {
 
         log_debug("Trimmed %s from memory pool %p. (%s left)", FORMAT_BYTES(trimmed), mp, FORMAT_BYTES(left));
 }
+
+void mempool_trim_all(void) {
+        for (struct mempool *mp = registered_pools; mp; mp = mp->next_registered)
+                mempool_trim(mp);
+}
+
+void mempool_get_stats(const struct mempool *mp, MempoolStats *ret) {
+        MempoolStats stats = {};
+
+        assert(mp);
+        assert(ret);
+
+        for (struct pool *p = mp->first_pool; p; p = p->next) {
+                stats.n_pools++;
+                stats.n_tiles += p->n_tiles;
+                stats.n_bytes += PAGE_ALIGN(ALIGN(sizeof(struct pool)) + p->n_tiles * mp->tile_size);
+        }
+
+        stats.n_tiles_used = mp->n_tiles_used;
+
+        *ret = stats;
+}
+
+void mempool_dump_stats(FILE *f) {
+        assert(f);
+
+        for (struct mempool *mp = registered_pools; mp; mp = mp->next_registered) {
+                MempoolStats stats;
+
+                mempool_get_stats(mp, &stats);
+                if (stats.n_pools == 0)
+                        continue;
+
+                fprintf(f, "<!-- mempool name=\"%s\" tile-size=\"%zu\" pools=\"%zu\" tiles=\"%zu\" used=\"%zu\" bytes=\"%zu\" -->\n",
+                        strna(mp->name), mp->tile_size, stats.n_pools, stats.n_tiles, stats.n_tiles_used, stats.n_bytes);
+        }
+}
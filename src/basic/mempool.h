@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdio.h>
 
 struct pool;
 
@@ -11,18 +12,44 @@ struct mempool {
         void *freelist;
         size_t tile_size;
         size_t at_least;
+
+        /* For statistics only */
+        const char *name;
+        size_t n_tiles_used;
+        struct mempool *next_registered;
+        bool registered;
 };
 
 void* mempool_alloc_tile(struct mempool *mp);
 void* mempool_alloc0_tile(struct mempool *mp);
 void* mempool_free_tile(struct mempool *mp, void *p);
 
+#define MEMPOOL_INIT(pool_name, size, alloc_at_least) \
+        { \
+                .tile_size = (size), \
+                .at_least = (alloc_at_least), \
+                .name = (pool_name), \
+        }
+
 #define DEFINE_MEMPOOL(pool_name, tile_type, alloc_at_least) \
-static struct mempool pool_name = { \
-        .tile_size = sizeof(tile_type), \
-        .at_least = alloc_at_least, \
-}
+static struct mempool pool_name = MEMPOOL_INIT(#pool_name, sizeof(tile_type), alloc_at_least)
 
 __attribute__((weak)) bool mempool_enabled(void);
 
 void mempool_trim(struct mempool *mp);
+
+/* Trims all pools that allocated memory so far. Like pools in general, only call this from the main thread. */
+void mempool_trim_all(void);
+
+typedef struct MempoolStats {
+        size_t n_pools;
+        size_t n_tiles;      /* tiles allocated from the system */
+        size_t n_tiles_used; /* tiles currently handed out */
+        size_t n_bytes;
+} MempoolStats;
+
+void mempool_get_stats(const struct mempool *mp, MempoolStats *ret);
+
+/* Writes the statistics of all pools that allocated memory so far as XML comments, so that they can be
+ * appended to the output of malloc_info(). */
+void mempool_dump_stats(FILE *f);
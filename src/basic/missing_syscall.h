@@ -652,6 +652,113 @@ static inline int missing_fsmount(int fd, unsigned flags, unsigned ms_flags) {
 
 /* ======================================================================= */
 
+/* Always define the newest versions of the listmount()/statmount() structures we are aware of as distinct
+ * types (6.8, extended up to 6.14), so that we can use them even if the kernel headers carry an older
+ * definition. */
+struct new_mnt_id_req {
+        uint32_t size;
+        uint32_t spare;
+        uint64_t mnt_id;
+        uint64_t param;
+        uint64_t mnt_ns_id;
+};
+
+struct new_statmount {
+        uint32_t size;
+        uint32_t mnt_opts;
+        uint64_t mask;
+        uint32_t sb_dev_major;
+        uint32_t sb_dev_minor;
+        uint64_t sb_magic;
+        uint32_t sb_flags;
+        uint32_t fs_type;
+        uint64_t mnt_id;
+        uint64_t mnt_parent_id;
+        uint32_t mnt_id_old;
+        uint32_t mnt_parent_id_old;
+        uint64_t mnt_attr;
+        uint64_t mnt_propagation;
+        uint64_t mnt_peer_group;
+        uint64_t mnt_master;
+        uint64_t propagate_from;
+        uint32_t mnt_root;
+        uint32_t mnt_point;
+        uint64_t mnt_ns_id;
+        uint32_t fs_subtype;
+        uint32_t sb_source;
+        uint32_t opt_num;
+        uint32_t opt_array;
+        uint32_t opt_sec_num;
+        uint32_t opt_sec_array;
+        uint64_t __spare2[46];
+        char str[];
+};
+
+#ifndef MNT_ID_REQ_SIZE_VER0
+#define MNT_ID_REQ_SIZE_VER0    24
+#endif
+
+#ifndef STATMOUNT_SB_BASIC
+#define STATMOUNT_SB_BASIC      0x00000001U
+#endif
+
+#ifndef STATMOUNT_MNT_BASIC
+#define STATMOUNT_MNT_BASIC     0x00000002U
+#endif
+
+#ifndef STATMOUNT_MNT_ROOT
+#define STATMOUNT_MNT_ROOT      0x00000008U
+#endif
+
+#ifndef STATMOUNT_MNT_POINT
+#define STATMOUNT_MNT_POINT     0x00000010U
+#endif
+
+#ifndef STATMOUNT_FS_TYPE
+#define STATMOUNT_FS_TYPE       0x00000020U
+#endif
+
+/* 6.11 */
+#ifndef STATMOUNT_MNT_OPTS
+#define STATMOUNT_MNT_OPTS      0x00000080U
+#endif
+
+/* 6.13 */
+#ifndef STATMOUNT_FS_SUBTYPE
+#define STATMOUNT_FS_SUBTYPE    0x00000100U
+#endif
+
+/* 6.14 */
+#ifndef STATMOUNT_SB_SOURCE
+#define STATMOUNT_SB_SOURCE     0x00000200U
+#endif
+
+#ifndef LSMT_ROOT
+#define LSMT_ROOT               UINT64_C(0xffffffffffffffff)
+#endif
+
+/* We always use our own wrappers here, as they operate on our own structure definitions from above. */
+
+static inline ssize_t missing_listmount(const struct new_mnt_id_req *req, uint64_t *mnt_ids, size_t nr_mnt_ids, unsigned flags) {
+#  if defined __NR_listmount && __NR_listmount >= 0
+        return syscall(__NR_listmount, req, mnt_ids, nr_mnt_ids, flags);
+#  else
+        errno = ENOSYS;
+        return -1;
+#  endif
+}
+
+static inline int missing_statmount(const struct new_mnt_id_req *req, struct new_statmount *buf, size_t bufsize, unsigned flags) {
+#  if defined __NR_statmount && __NR_statmount >= 0
+        return syscall(__NR_statmount, req, buf, bufsize, flags);
+#  else
+        errno = ENOSYS;
+        return -1;
+#  endif
+}
+
+/* ======================================================================= */
+
 #if !HAVE_GETDENTS64
 
 static inline ssize_t missing_getdents64(int fd, void *buffer, size_t length) {
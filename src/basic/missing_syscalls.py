@@ -11,6 +11,7 @@ SYSCALLS = [
     'copy_file_range',
     'fchmodat2',
     'getrandom',
+    'listmount',
     'memfd_create',
     'mount_setattr',
     'move_mount',
@@ -22,6 +23,7 @@ SYSCALLS = [
     'pkey_mprotect',
     'renameat2',
     'setns',
+    'statmount',
     'statx',
 ]
 
@@ -13,6 +13,7 @@
 #include "fileio.h"
 #include "filesystems.h"
 #include "fs-util.h"
+#include "hash-funcs.h"
 #include "missing_fs.h"
 #include "missing_mount.h"
 #include "missing_stat.h"
@@ -22,6 +23,7 @@
 #include "nulstr-util.h"
 #include "parse-util.h"
 #include "path-util.h"
+#include "sort-util.h"
 #include "stat-util.h"
 #include "stdio-util.h"
 #include "strv.h"
@@ -814,3 +816,139 @@ bool path_below_api_vfs(const char *p) {
         /* API VFS are either directly mounted on any of these three paths, or below it. */
         return PATH_STARTSWITH_SET(p, "/dev", "/sys", "/proc");
 }
+
+int mount_list_ids(uint64_t **ret_ids, size_t *ret_n_ids) {
+        _cleanup_free_ uint64_t *ids = NULL;
+        size_t n = 0;
+
+        assert(ret_ids);
+        assert(ret_n_ids);
+
+        /* Returns the unique (i.e. never recycled) IDs of all mounts in our mount namespace, in ascending
+         * order, via listmount(). Returns -EOPNOTSUPP if the kernel doesn't know listmount(). */
+
+        for (;;) {
+                struct new_mnt_id_req req = {
+                        .size = MNT_ID_REQ_SIZE_VER0,
+                        .mnt_id = LSMT_ROOT,
+                        .param = n > 0 ? ids[n-1] : 0, /* continue after the last ID we got */
+                };
+                ssize_t k;
+
+                if (!GREEDY_REALLOC(ids, n + 1024))
+                        return -ENOMEM;
+
+                k = missing_listmount(&req, ids + n, MALLOC_ELEMENTSOF(ids) - n, /* flags= */ 0);
+                if (k < 0) {
+                        if (ERRNO_IS_NOT_SUPPORTED(errno))
+                                return -EOPNOTSUPP;
+
+                        return -errno;
+                }
+                if (k == 0)
+                        break;
+
+                n += k;
+        }
+
+        /* The kernel returns them in order anyway, but let's not rely on that */
+        typesafe_qsort(ids, n, uint64_compare_func);
+
+        *ret_ids = TAKE_PTR(ids);
+        *ret_n_ids = n;
+        return 0;
+}
+
+int mount_stat(uint64_t mnt_id, uint64_t mask, struct new_statmount **ret) {
+        size_t sz = sizeof(struct new_statmount) + 4096;
+
+        assert(ret);
+
+        /* Queries information about the specified mount via statmount(). Note that the kernel only fills in
+         * the fields it knows about, callers need to check the returned mask. */
+
+        for (;;) {
+                _cleanup_free_ struct new_statmount *sm = NULL;
+                struct new_mnt_id_req req = {
+                        .size = MNT_ID_REQ_SIZE_VER0,
+                        .mnt_id = mnt_id,
+                        .param = mask,
+                };
+
+                sm = malloc0(sz);
+                if (!sm)
+                        return -ENOMEM;
+
+                if (missing_statmount(&req, sm, sz, /* flags= */ 0) >= 0) {
+                        *ret = TAKE_PTR(sm);
+                        return 0;
+                }
+                if (ERRNO_IS_NOT_SUPPORTED(errno))
+                        return -EOPNOTSUPP;
+                if (errno != EOVERFLOW)
+                        return -errno;
+
+                if (sz >= 16U * 1024U * 1024U)
+                        return -E2BIG;
+
+                sz *= 2;
+        }
+}
+
+const char* statmount_string(const struct new_statmount *sm, uint64_t flag, uint32_t offset) {
+        assert(sm);
+
+        if (!FLAGS_SET(sm->mask, flag))
+                return NULL;
+
+        return sm->str + offset;
+}
+
+int statmount_options_to_string(const struct new_statmount *sm, char **ret) {
+        _cleanup_free_ char *s = NULL;
+        const char *fs_options;
+
+        assert(sm);
+        assert(ret);
+
+        /* Formats the mount options the same way libmount merges the per-mount and per-superblock option
+         * fields of /proc/self/mountinfo, so that mounts look the same regardless of where we learnt about
+         * them from. */
+
+        if (!FLAGS_SET(sm->mask, STATMOUNT_SB_BASIC|STATMOUNT_MNT_BASIC))
+                return -ENODATA;
+
+        if (!strextend(&s, FLAGS_SET(sm->mnt_attr, MOUNT_ATTR_RDONLY) || FLAGS_SET(sm->sb_flags, MS_RDONLY) ? "ro" : "rw"))
+                return -ENOMEM;
+
+        if (FLAGS_SET(sm->mnt_attr, MOUNT_ATTR_NOSUID) && !strextend(&s, ",nosuid"))
+                return -ENOMEM;
+        if (FLAGS_SET(sm->mnt_attr, MOUNT_ATTR_NODEV) && !strextend(&s, ",nodev"))
+                return -ENOMEM;
+        if (FLAGS_SET(sm->mnt_attr, MOUNT_ATTR_NOEXEC) && !strextend(&s, ",noexec"))
+                return -ENOMEM;
+        if ((sm->mnt_attr & MOUNT_ATTR__ATIME) == MOUNT_ATTR_NOATIME && !strextend(&s, ",noatime"))
+                return -ENOMEM;
+        if (FLAGS_SET(sm->mnt_attr, MOUNT_ATTR_NODIRATIME) && !strextend(&s, ",nodiratime"))
+                return -ENOMEM;
+        if ((sm->mnt_attr & MOUNT_ATTR__ATIME) == MOUNT_ATTR_RELATIME && !strextend(&s, ",relatime"))
+                return -ENOMEM;
+        if (FLAGS_SET(sm->mnt_attr, MOUNT_ATTR_NOSYMFOLLOW) && !strextend(&s, ",nosymfollow"))
+                return -ENOMEM;
+        if (FLAGS_SET(sm->mnt_attr, MOUNT_ATTR_IDMAP) && !strextend(&s, ",idmapped"))
+                return -ENOMEM;
+
+        if (FLAGS_SET(sm->sb_flags, MS_SYNCHRONOUS) && !strextend(&s, ",sync"))
+                return -ENOMEM;
+        if (FLAGS_SET(sm->sb_flags, MS_DIRSYNC) && !strextend(&s, ",dirsync"))
+                return -ENOMEM;
+        if (FLAGS_SET(sm->sb_flags, MS_LAZYTIME) && !strextend(&s, ",lazytime"))
+                return -ENOMEM;
+
+        fs_options = statmount_string(sm, STATMOUNT_MNT_OPTS, sm->mnt_opts);
+        if (!isempty(fs_options) && !strextend(&s, ",", fs_options))
+                return -ENOMEM;
+
+        *ret = TAKE_PTR(s);
+        return 0;
+}
@@ -4,6 +4,7 @@
 #include <fcntl.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <sys/types.h>
 
 /* The limit used for /dev itself. 4MB should be enough since device nodes and symlinks don't
@@ -80,3 +81,10 @@ unsigned long ms_nosymfollow_supported(void);
 int mount_option_supported(const char *fstype, const char *key, const char *value);
 
 bool path_below_api_vfs(const char *p);
+
+struct new_statmount;
+
+int mount_list_ids(uint64_t **ret_ids, size_t *ret_n_ids);
+int mount_stat(uint64_t mnt_id, uint64_t mask, struct new_statmount **ret);
+const char* statmount_string(const struct new_statmount *sm, uint64_t flag, uint32_t offset);
+int statmount_options_to_string(const struct new_statmount *sm, char **ret);
@@ -7,7 +7,12 @@
  * priority. Insertion and removal are Θ(log n). Optionally, the caller can
  * provide a pointer to an index which will be kept up-to-date by the prioq.
  *
- * The underlying algorithm used in this implementation is a Heap.
+ * The underlying algorithm used in this implementation is a Heap. By default it's a binary heap, but
+ * queues that are reshuffled a lot may opt into a heap with more children per node, which has fewer
+ * levels to walk through, and keeps the children of a node next to each other in memory. Optionally, the
+ * caller can also provide a function returning an integer sort key for an object. The keys are stored in
+ * an array next to the heap, so that most comparisons are done inline, and the comparison function is
+ * only called to order objects with the same key.
  */
 
 #include <errno.h>
@@ -24,47 +29,79 @@ struct prioq_item {
 
 struct Prioq {
         compare_func_t compare_func;
+        prioq_key_func_t key_func;
+        unsigned arity_shift;
         unsigned n_items, n_allocated;
 
         struct prioq_item *items;
+        uint64_t *keys; /* only allocated if key_func is set */
 };
 
-Prioq *prioq_new(compare_func_t compare_func) {
+Prioq *prioq_new_full(compare_func_t compare_func, prioq_key_func_t key_func, unsigned arity) {
         Prioq *q;
 
+        assert(compare_func || key_func);
+        assert(arity >= 2 && ISPOWEROF2(arity));
+
         q = new(Prioq, 1);
         if (!q)
                 return q;
 
         *q = (Prioq) {
                 .compare_func = compare_func,
+                .key_func = key_func,
+                .arity_shift = __builtin_ctz(arity),
         };
 
         return q;
 }
 
+Prioq *prioq_new(compare_func_t compare_func) {
+        return prioq_new_full(compare_func, /* key_func= */ NULL, 2);
+}
+
 Prioq* prioq_free(Prioq *q) {
         if (!q)
                 return NULL;
 
         free(q->items);
+        free(q->keys);
         return mfree(q);
 }
 
-int prioq_ensure_allocated(Prioq **q, compare_func_t compare_func) {
+int prioq_ensure_allocated_full(Prioq **q, compare_func_t compare_func, prioq_key_func_t key_func, unsigned arity) {
         assert(q);
 
         if (*q)
                 return 0;
 
-        *q = prioq_new(compare_func);
+        *q = prioq_new_full(compare_func, key_func, arity);
         if (!*q)
                 return -ENOMEM;
 
         return 0;
 }
 
-static void swap(Prioq *q, unsigned j, unsigned k) {
+int prioq_ensure_allocated(Prioq **q, compare_func_t compare_func) {
+        return prioq_ensure_allocated_full(q, compare_func, /* key_func= */ NULL, 2);
+}
+
+/* The helpers below are inlined with constant arguments for the common cases, so that queues that use
+ * neither keys nor a wider heap pay nothing for either. */
+
+static inline int compare(Prioq *q, unsigned j, unsigned k, bool keyed) {
+        if (keyed) {
+                int r;
+
+                r = CMP(q->keys[j], q->keys[k]);
+                if (r != 0 || !q->compare_func)
+                        return r;
+        }
+
+        return q->compare_func(q->items[j].data, q->items[k].data);
+}
+
+static inline void swap(Prioq *q, unsigned j, unsigned k, bool keyed) {
         assert(q);
         assert(j < q->n_items);
         assert(k < q->n_items);
@@ -72,8 +109,9 @@ static void swap(Prioq *q, unsigned j, unsigned k) {
         assert(!q->items[j].idx || *(q->items[j].idx) == j);
         assert(!q->items[k].idx || *(q->items[k].idx) == k);
 
-        SWAP_TWO(q->items[j].data, q->items[k].data);
-        SWAP_TWO(q->items[j].idx, q->items[k].idx);
+        SWAP_TWO(q->items[j], q->items[k]);
+        if (keyed)
+                SWAP_TWO(q->keys[j], q->keys[k]);
 
         if (q->items[j].idx)
                 *q->items[j].idx = j;
@@ -82,65 +120,74 @@ static void swap(Prioq *q, unsigned j, unsigned k) {
                 *q->items[k].idx = k;
 }
 
-static unsigned shuffle_up(Prioq *q, unsigned idx) {
+static inline unsigned shuffle_up_impl(Prioq *q, unsigned idx, unsigned shift, bool keyed) {
         assert(q);
         assert(idx < q->n_items);
 
         while (idx > 0) {
                 unsigned k;
 
-                k = (idx-1)/2;
+                k = (idx-1) >> shift; /* parent */
 
-                if (q->compare_func(q->items[k].data, q->items[idx].data) <= 0)
+                if (compare(q, k, idx, keyed) <= 0)
                         break;
 
-                swap(q, idx, k);
+                swap(q, idx, k, keyed);
                 idx = k;
         }
 
         return idx;
 }
 
-static unsigned shuffle_down(Prioq *q, unsigned idx) {
+static inline unsigned shuffle_down_impl(Prioq *q, unsigned idx, unsigned shift, bool keyed) {
         assert(q);
 
         for (;;) {
                 unsigned j, k, s;
 
-                k = (idx+1)*2; /* right child */
-                j = k-1;       /* left child */
-
+                j = (idx << shift) + 1; /* first child */
                 if (j >= q->n_items)
                         break;
 
-                if (q->compare_func(q->items[j].data, q->items[idx].data) < 0)
-
-                        /* So our left child is smaller than we are, let's
-                         * remember this fact */
-                        s = j;
-                else
-                        s = idx;
+                k = MIN(j + (1U << shift), q->n_items); /* end of children */
 
-                if (k < q->n_items &&
-                    q->compare_func(q->items[k].data, q->items[s].data) < 0)
+                /* Find the smallest of the children */
+                s = j;
+                for (j++; j < k; j++)
+                        if (compare(q, j, s, keyed) < 0)
+                                s = j;
 
-                        /* So our right child is smaller than we are, let's
-                         * remember this fact */
-                        s = k;
-
-                /* s now points to the smallest of the three items */
-
-                if (s == idx)
-                        /* No swap necessary, we're done */
+                if (compare(q, s, idx, keyed) >= 0)
+                        /* No child is smaller than we are, no swap necessary, we're done */
                         break;
 
-                swap(q, idx, s);
+                swap(q, idx, s, keyed);
                 idx = s;
         }
 
         return idx;
 }
 
+static unsigned shuffle_up(Prioq *q, unsigned idx) {
+        assert(q);
+
+        if (q->keys)
+                return shuffle_up_impl(q, idx, q->arity_shift, /* keyed= */ true);
+        if (q->arity_shift == 1)
+                return shuffle_up_impl(q, idx, 1, /* keyed= */ false);
+        return shuffle_up_impl(q, idx, q->arity_shift, /* keyed= */ false);
+}
+
+static unsigned shuffle_down(Prioq *q, unsigned idx) {
+        assert(q);
+
+        if (q->keys)
+                return shuffle_down_impl(q, idx, q->arity_shift, /* keyed= */ true);
+        if (q->arity_shift == 1)
+                return shuffle_down_impl(q, idx, 1, /* keyed= */ false);
+        return shuffle_down_impl(q, idx, q->arity_shift, /* keyed= */ false);
+}
+
 int prioq_put(Prioq *q, void *data, unsigned *idx) {
         struct prioq_item *i;
         unsigned k;
@@ -157,6 +204,17 @@ int prioq_put(Prioq *q, void *data, unsigned *idx) {
                         return -ENOMEM;
 
                 q->items = j;
+
+                if (q->key_func) {
+                        uint64_t *keys;
+
+                        keys = reallocarray(q->keys, n, sizeof(uint64_t));
+                        if (!keys)
+                                return -ENOMEM;
+
+                        q->keys = keys;
+                }
+
                 q->n_allocated = n;
         }
 
@@ -164,6 +222,8 @@ int prioq_put(Prioq *q, void *data, unsigned *idx) {
         i = q->items + k;
         i->data = data;
         i->idx = idx;
+        if (q->keys)
+                q->keys[k] = q->key_func(data);
 
         if (idx)
                 *idx = k;
@@ -206,6 +266,8 @@ static void remove_item(Prioq *q, struct prioq_item *i) {
                 i->idx = l->idx;
                 if (i->idx)
                         *i->idx = k;
+                if (q->keys)
+                        q->keys[k] = q->keys[q->n_items - 1];
                 q->n_items--;
 
                 k = shuffle_down(q, k);
@@ -264,6 +326,11 @@ void prioq_reshuffle(Prioq *q, void *data, unsigned *idx) {
                 return;
 
         k = i - q->items;
+
+        /* The object changed, hence refresh its key */
+        if (q->keys)
+                q->keys[k] = q->key_func(data);
+
         k = shuffle_down(q, k);
         shuffle_up(q, k);
 }
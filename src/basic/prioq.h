@@ -2,6 +2,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "hashmap.h"
 #include "macro.h"
@@ -10,9 +11,18 @@ typedef struct Prioq Prioq;
 
 #define PRIOQ_IDX_NULL (UINT_MAX)
 
+/* Returns an integer sort key for an object. Objects with a lower key are ordered first, hence the key
+ * must follow the order of the comparison function if both are used. The comparison function then only
+ * orders objects with the same key against each other. The key is refreshed on prioq_reshuffle(). */
+typedef uint64_t (*prioq_key_func_t)(const void *data);
+
+/* 'arity' is the number of children per heap node, and must be a power of two. prioq_new() creates a
+ * binary heap ordered by the comparison function only. */
+Prioq *prioq_new_full(compare_func_t compare_func, prioq_key_func_t key_func, unsigned arity);
 Prioq *prioq_new(compare_func_t compare);
 Prioq *prioq_free(Prioq *q);
 DEFINE_TRIVIAL_CLEANUP_FUNC(Prioq*, prioq_free);
+int prioq_ensure_allocated_full(Prioq **q, compare_func_t compare_func, prioq_key_func_t key_func, unsigned arity);
 int prioq_ensure_allocated(Prioq **q, compare_func_t compare_func);
 
 int prioq_put(Prioq *q, void *data, unsigned *idx);
@@ -60,11 +60,6 @@
 #include "user-util.h"
 #include "utf8.h"
 
-/* The kernel limits userspace processes to TASK_COMM_LEN (16 bytes), but allows higher values for its own
- * workers, e.g. "kworker/u9:3-kcryptd/253:0". Let's pick a fixed smallish limit that will work for the kernel.
- */
-#define COMM_MAX_LEN 128
-
 static int get_process_state(pid_t pid) {
         _cleanup_free_ char *line = NULL;
         const char *p;
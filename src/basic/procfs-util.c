@@ -19,11 +19,11 @@ int procfs_get_pid_max(uint64_t *ret) {
 
         assert(ret);
 
-        r = read_one_line_file("/proc/sys/kernel/pid_max", &value);
+        r = read_virtual_file("/proc/sys/kernel/pid_max", DECIMAL_STR_MAX(uint64_t), &value, /* ret_size= */ NULL);
         if (r < 0)
                 return r;
 
-        return safe_atou64(value, ret);
+        return safe_atou64(truncate_nl(value), ret);
 }
 
 int procfs_get_threads_max(uint64_t *ret) {
@@ -32,11 +32,11 @@ int procfs_get_threads_max(uint64_t *ret) {
 
         assert(ret);
 
-        r = read_one_line_file("/proc/sys/kernel/threads-max", &value);
+        r = read_virtual_file("/proc/sys/kernel/threads-max", DECIMAL_STR_MAX(uint64_t), &value, /* ret_size= */ NULL);
         if (r < 0)
                 return r;
 
-        return safe_atou64(value, ret);
+        return safe_atou64(truncate_nl(value), ret);
 }
 
 int procfs_tasks_set_limit(uint64_t limit) {
@@ -96,9 +96,10 @@ int procfs_tasks_get_current(uint64_t *ret) {
 
         assert(ret);
 
-        r = read_one_line_file("/proc/loadavg", &value);
+        r = read_virtual_file("/proc/loadavg", LINE_MAX, &value, /* ret_size= */ NULL);
         if (r < 0)
                 return r;
+        truncate_nl(value);
 
         /* Look for the second part of the fourth field, which is separated by a slash from the first part. None of the
          * earlier fields use a slash, hence let's use this to find the right spot. */
@@ -138,9 +139,12 @@ int procfs_cpu_get_usage(nsec_t *ret) {
 
         assert(ret);
 
-        r = read_one_line_file("/proc/stat", &first_line);
+        /* The file has a line per CPU and more, but we only need the summary in the first line, hence only
+         * let the kernel format a prefix of it */
+        r = read_virtual_file("/proc/stat", LINE_MAX, &first_line, /* ret_size= */ NULL);
         if (r < 0)
                 return r;
+        truncate_nl(first_line);
 
         p = first_word(first_line, "cpu");
         if (!p)
@@ -220,24 +224,25 @@ int convert_meminfo_value_to_uint64_bytes(const char *word, uint64_t *ret) {
 
 int procfs_memory_get(uint64_t *ret_total, uint64_t *ret_used) {
         uint64_t mem_total = UINT64_MAX, mem_available = UINT64_MAX;
-        _cleanup_fclose_ FILE *f = NULL;
+        _cleanup_free_ char *contents = NULL;
         int r;
 
-        f = fopen("/proc/meminfo", "re");
-        if (!f)
-                return -errno;
+        /* Read the file in one go rather than line by line through stdio, it's polled frequently by oomd */
+        r = read_full_virtual_file("/proc/meminfo", &contents, /* ret_size= */ NULL);
+        if (r < 0)
+                return r;
 
-        for (;;) {
-                _cleanup_free_ char *line = NULL;
+        for (char *line = contents, *eol; ; line = eol) {
                 uint64_t *v;
                 char *p;
 
-                r = read_line(f, LONG_LINE_MAX, &line);
-                if (r < 0)
-                        return r;
-                if (r == 0)
+                if (!line || *line == 0)
                         return -EINVAL; /* EOF: Couldn't find one or both fields? */
 
+                eol = strchr(line, '\n');
+                if (eol)
+                        *(eol++) = 0;
+
                 p = first_word(line, "MemTotal:");
                 if (p)
                         v = &mem_total;
@@ -145,6 +145,17 @@ int readdir_all_at(int fd, const char *path, RecurseDirFlags flags, DirectoryEnt
         return readdir_all(dir_fd, flags, ret);
 }
 
+static void dirent_to_statx(const struct dirent *de, struct statx *ret) {
+        assert(de);
+        assert(de->d_type != DT_UNKNOWN);
+        assert(ret);
+
+        *ret = (struct statx) {
+                .stx_mask = STATX_TYPE,
+                .stx_mode = DTTOIF(de->d_type),
+        };
+}
+
 int recurse_dir(
                 int dir_fd,
                 const char *path,
@@ -250,7 +261,10 @@ int recurse_dir(
                                 /* If we managed to get a DIR* off the inode, it's definitely a directory. */
                                 de->entries[i]->d_type = DT_DIR;
 
-                                if (statx_mask != 0 || (flags & RECURSE_DIR_SAME_MOUNT)) {
+                                if (statx_mask == STATX_TYPE && !(flags & RECURSE_DIR_SAME_MOUNT)) {
+                                        dirent_to_statx(de->entries[i], &sx);
+                                        sx_valid = true;
+                                } else if (statx_mask != 0 || (flags & RECURSE_DIR_SAME_MOUNT)) {
                                         r = statx_fallback(subdir_fd, "", AT_EMPTY_PATH, statx_mask, &sx);
                                         if (r < 0)
                                                 return r;
@@ -313,6 +327,12 @@ int recurse_dir(
                                         inode_fd = safe_close(inode_fd);
                                 }
 
+                        } else if (statx_mask == STATX_TYPE && !IN_SET(de->entries[i]->d_type, DT_UNKNOWN, DT_DIR)) {
+                                /* Spare us the statx() call if the caller is only interested in the type,
+                                 * and the file system told us about it already. */
+                                dirent_to_statx(de->entries[i], &sx);
+                                sx_valid = true;
+
                         } else if (statx_mask != 0 || (de->entries[i]->d_type == DT_UNKNOWN && (flags & RECURSE_DIR_ENSURE_TYPE))) {
 
                                 r = statx_fallback(dir_fd, de->entries[i]->d_name, AT_SYMLINK_NOFOLLOW, statx_mask | STATX_TYPE, &sx);
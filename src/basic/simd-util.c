@@ -0,0 +1,54 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include "simd-util.h"
+#include "string-table.h"
+
+static SimdLevel cached_level_supported = _SIMD_LEVEL_INVALID;
+SimdLevel simd_level_current = _SIMD_LEVEL_INVALID;
+
+SimdLevel simd_level_supported(void) {
+        if (cached_level_supported >= 0)
+                return cached_level_supported;
+
+#if defined(__x86_64__)
+        /* This takes the OS into account too, i.e. AVX2 is only reported if the kernel saves the YMM
+         * registers on context switches. */
+        __builtin_cpu_init();
+
+        if (__builtin_cpu_supports("avx2"))
+                cached_level_supported = SIMD_AVX2;
+        else if (__builtin_cpu_supports("ssse3"))
+                cached_level_supported = SIMD_SSSE3;
+        else
+                cached_level_supported = SIMD_BASELINE;
+#elif defined(__aarch64__)
+        cached_level_supported = SIMD_BASELINE;
+#else
+        cached_level_supported = SIMD_NONE;
+#endif
+
+        return cached_level_supported;
+}
+
+SimdLevel simd_level_init(void) {
+        return (simd_level_current = simd_level_supported());
+}
+
+int simd_level_set(SimdLevel level) {
+        assert(level >= 0 && level < _SIMD_LEVEL_MAX);
+
+        if (level > simd_level_supported())
+                return -EOPNOTSUPP;
+
+        simd_level_current = level;
+        return 0;
+}
+
+static const char* const simd_level_table[_SIMD_LEVEL_MAX] = {
+        [SIMD_NONE]     = "none",
+        [SIMD_BASELINE] = "baseline",
+        [SIMD_SSSE3]    = "ssse3",
+        [SIMD_AVX2]     = "avx2",
+};
+
+DEFINE_STRING_TABLE_LOOKUP(simd_level, SimdLevel);
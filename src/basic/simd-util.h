@@ -0,0 +1,46 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+#pragma once
+
+#include <errno.h>
+
+#include "macro.h"
+
+/* Which vector instructions the hot codec loops (UTF-8 validation, hex and base64) may use. Each level
+ * implies all lower ones. SIMD_BASELINE is what every CPU of the architecture has, i.e. SSE2 on x86-64 and
+ * NEON on aarch64, everything above is only ever used after checking the CPU at runtime. */
+typedef enum SimdLevel {
+        SIMD_NONE,
+        SIMD_BASELINE,
+        SIMD_SSSE3,
+        SIMD_AVX2,
+        _SIMD_LEVEL_MAX,
+        _SIMD_LEVEL_INVALID = -EINVAL,
+} SimdLevel;
+
+#if defined(__x86_64__) || defined(__aarch64__)
+#  define HAVE_SIMD 1
+#else
+#  define HAVE_SIMD 0
+#endif
+
+/* Functions using instructions beyond the baseline need to be compiled for them explicitly */
+#define _target_(x) __attribute__((__target__(x)))
+
+SimdLevel simd_level_supported(void) _pure_;
+
+/* This is checked on every call of the codec functions, hence make the common case cheap */
+extern SimdLevel simd_level_current;
+SimdLevel simd_level_init(void);
+
+static inline SimdLevel simd_level(void) {
+        if (_likely_(simd_level_current >= 0))
+                return simd_level_current;
+
+        return simd_level_init();
+}
+
+/* Lowers (or raises again, up to what the CPU supports) the level in use, for tests and benchmarks */
+int simd_level_set(SimdLevel level);
+
+const char* simd_level_to_string(SimdLevel l) _const_;
+SimdLevel simd_level_from_string(const char *s) _pure_;
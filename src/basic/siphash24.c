@@ -50,6 +50,11 @@ static void sipround(struct siphash *state) {
         state->v2 = rotate_left(state->v2, 32);
 }
 
+static inline void sipround_n(struct siphash *state, unsigned n) {
+        for (unsigned i = 0; i < n; i++)
+                sipround(state);
+}
+
 void siphash24_init(struct siphash *state, const uint8_t k[static 16]) {
         uint64_t k0, k1;
 
@@ -70,7 +75,14 @@ void siphash24_init(struct siphash *state, const uint8_t k[static 16]) {
         };
 }
 
-void siphash24_compress(const void *_in, size_t inlen, struct siphash *state) {
+void siphash13_init(struct siphash *state, const uint8_t k[static 16]) {
+        siphash24_init(state, k);
+        state->reduced_rounds = true;
+}
+
+/* The number of rounds is a constant in each caller, so that the compiler can unroll the rounds for both
+ * variants rather than looking at state->reduced_rounds for each block. */
+static inline void siphash_compress(const void *_in, size_t inlen, struct siphash *state, unsigned c_rounds) {
 
         const uint8_t *in = ASSERT_PTR(_in);
         const uint8_t *end = in + inlen;
@@ -100,8 +112,7 @@ void siphash24_compress(const void *_in, size_t inlen, struct siphash *state) {
 #endif
 
                 state->v3 ^= state->padding;
-                sipround(state);
-                sipround(state);
+                sipround_n(state, c_rounds);
                 state->v0 ^= state->padding;
 
                 state->padding = 0;
@@ -119,8 +130,7 @@ void siphash24_compress(const void *_in, size_t inlen, struct siphash *state) {
                 printf("(%3zu) compress %08x %08x\n", state->inlen, (uint32_t) (m >> 32), (uint32_t) m);
 #endif
                 state->v3 ^= m;
-                sipround(state);
-                sipround(state);
+                sipround_n(state, c_rounds);
                 state->v0 ^= m;
         }
 
@@ -152,7 +162,16 @@ void siphash24_compress(const void *_in, size_t inlen, struct siphash *state) {
         }
 }
 
-uint64_t siphash24_finalize(struct siphash *state) {
+void siphash24_compress(const void *in, size_t inlen, struct siphash *state) {
+        assert(state);
+
+        if (state->reduced_rounds)
+                siphash_compress(in, inlen, state, 1);
+        else
+                siphash_compress(in, inlen, state, 2);
+}
+
+static inline uint64_t siphash_finalize(struct siphash *state, unsigned c_rounds, unsigned d_rounds) {
         uint64_t b;
 
         assert(state);
@@ -168,8 +187,7 @@ uint64_t siphash24_finalize(struct siphash *state) {
 #endif
 
         state->v3 ^= b;
-        sipround(state);
-        sipround(state);
+        sipround_n(state, c_rounds);
         state->v0 ^= b;
 
 #if ENABLE_DEBUG_SIPHASH
@@ -180,14 +198,20 @@ uint64_t siphash24_finalize(struct siphash *state) {
 #endif
         state->v2 ^= 0xff;
 
-        sipround(state);
-        sipround(state);
-        sipround(state);
-        sipround(state);
+        sipround_n(state, d_rounds);
 
         return state->v0 ^ state->v1 ^ state->v2  ^ state->v3;
 }
 
+uint64_t siphash24_finalize(struct siphash *state) {
+        assert(state);
+
+        if (state->reduced_rounds)
+                return siphash_finalize(state, 1, 3);
+
+        return siphash_finalize(state, 2, 4);
+}
+
 uint64_t siphash24(const void *in, size_t inlen, const uint8_t k[static 16]) {
         struct siphash state;
 
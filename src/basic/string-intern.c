@@ -0,0 +1,148 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc-util.h"
+#include "hashmap.h"
+#include "string-intern.h"
+#include "strv.h"
+
+typedef struct InternedString {
+        unsigned n_ref;
+        size_t size;
+        char str[];
+} InternedString;
+
+/* Keyed by InternedString.str */
+static Hashmap *pool = NULL;
+static size_t pool_n_refs = 0, pool_bytes_saved = 0;
+
+static InternedString* interned_string_find(const char *s) {
+        InternedString *i;
+
+        /* Only returns the entry if 's' is the interned copy itself, not just an equal string. */
+        i = hashmap_get(pool, s);
+        if (!i || i->str != s)
+                return NULL;
+
+        return i;
+}
+
+char* string_intern(const char *s) {
+        InternedString *i;
+        size_t size;
+
+        assert(s);
+
+        i = hashmap_get(pool, s);
+        if (i) {
+                i->n_ref++;
+                pool_n_refs++;
+                pool_bytes_saved += i->size;
+                return i->str;
+        }
+
+        size = strlen(s) + 1;
+
+        i = malloc(offsetof(InternedString, str) + size);
+        if (!i)
+                return NULL;
+
+        i->n_ref = 1;
+        i->size = size;
+        memcpy(i->str, s, size);
+
+        if (hashmap_ensure_put(&pool, &string_hash_ops, i->str, i) < 0) {
+                free(i);
+                return NULL;
+        }
+
+        pool_n_refs++;
+        return i->str;
+}
+
+char* string_unintern(char *s) {
+        InternedString *i;
+
+        if (!s)
+                return NULL;
+
+        i = interned_string_find(s);
+        if (!i)
+                return mfree(s);
+
+        assert(i->n_ref > 0);
+        assert(pool_n_refs > 0);
+
+        pool_n_refs--;
+
+        if (--i->n_ref > 0) {
+                assert(pool_bytes_saved >= i->size);
+                pool_bytes_saved -= i->size;
+                return NULL;
+        }
+
+        assert_se(hashmap_remove(pool, i->str) == i);
+        free(i);
+
+        if (hashmap_isempty(pool))
+                pool = hashmap_free(pool);
+
+        return NULL;
+}
+
+int string_intern_replace(char **p, const char *s) {
+        char *t = NULL;
+
+        assert(p);
+
+        if (*p && s && interned_string_find(*p) && streq(*p, s))
+                return 0;
+
+        if (s) {
+                t = string_intern(s);
+                if (!t)
+                        return -ENOMEM;
+        }
+
+        string_unintern(*p);
+        *p = t;
+        return 1;
+}
+
+int string_intern_strv(char **l) {
+        /* Replaces all elements of the list that are not interned yet by their interned copies, in place. */
+
+        STRV_FOREACH(s, l) {
+                char *t;
+
+                if (interned_string_find(*s))
+                        continue;
+
+                t = string_intern(*s);
+                if (!t)
+                        return -ENOMEM;
+
+                free_and_replace(*s, t);
+        }
+
+        return 0;
+}
+
+char** string_unintern_strv(char **l) {
+        STRV_FOREACH(s, l)
+                string_unintern(*s);
+
+        return mfree(l);
+}
+
+void string_intern_stats(size_t *ret_n_strings, size_t *ret_n_refs, size_t *ret_bytes_saved) {
+        if (ret_n_strings)
+                *ret_n_strings = hashmap_size(pool);
+        if (ret_n_refs)
+                *ret_n_refs = pool_n_refs;
+        if (ret_bytes_saved)
+                *ret_bytes_saved = pool_bytes_saved;
+}
@@ -0,0 +1,24 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+#pragma once
+
+#include <stddef.h>
+
+#include "macro.h"
+
+/* A process-wide, reference counted pool of immutable strings. Useful for long-lived objects that carry lots
+ * of identical strings, e.g. the units instantiated from the same template in PID 1, which share fragment
+ * paths, drop-in paths, documentation URLs and so on.
+ *
+ * Strings returned by string_intern() must never be modified, and must be released with string_unintern()
+ * rather than free(). For convenience string_unintern() also accepts strings that have not been interned
+ * and simply frees them, so that fields may be set from both sources. Not thread-safe. */
+
+char* string_intern(const char *s);
+char* string_unintern(char *s);
+
+int string_intern_replace(char **p, const char *s);
+
+int string_intern_strv(char **l);
+char** string_unintern_strv(char **l);
+
+void string_intern_stats(size_t *ret_n_strings, size_t *ret_n_refs, size_t *ret_bytes_saved);
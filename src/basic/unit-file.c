@@ -4,16 +4,21 @@
 
 #include "chase.h"
 #include "dirent-util.h"
+#include "env-util.h"
+#include "escape.h"
 #include "fd-util.h"
+#include "fileio.h"
 #include "fs-util.h"
 #include "initrd-util.h"
 #include "macro.h"
+#include "mkdir.h"
 #include "path-lookup.h"
 #include "set.h"
 #include "special.h"
 #include "stat-util.h"
 #include "string-util.h"
 #include "strv.h"
+#include "tmpfile-util.h"
 #include "unit-file.h"
 
 bool unit_type_may_alias(UnitType type) {
@@ -635,6 +640,405 @@ int unit_file_build_name_map(
         return 1;
 }
 
+/* The name map cache: the result of unit_file_build_name_map() stored in a file below the runtime
+ * directory, so that other processes (and the service manager after a reload) can reuse it instead of
+ * walking all unit directories again. It is keyed by the device, inode and modification time of every unit
+ * directory. Directories which are under our exclusive control and are recreated all the time (i.e. those
+ * of generators, transient units and the control drop-ins) are keyed by their listing instead: the names,
+ * types and symlink targets of their entries, and whether regular files are empty. */
+
+#define NAME_MAP_CACHE_HASH_KEY SD_ID128_MAKE(9b,3e,52,0c,6d,71,4f,a8,b2,0e,87,1f,c4,55,d9,30)
+#define NAME_MAP_CACHE_MAGIC "# systemd unit name map v1"
+
+static bool name_map_cache_enabled(const LookupPaths *lp) {
+        int r;
+
+        assert(lp);
+
+        /* Not for offline operation and test runs, those have their own, short-lived, directories */
+        if (lp->root_dir || lp->temporary_dir || !lp->runtime_config)
+                return false;
+
+        r = getenv_bool("SYSTEMD_UNIT_NAME_MAP_CACHE");
+        if (r < 0 && r != -ENXIO)
+                log_debug_errno(r, "Failed to parse $SYSTEMD_UNIT_NAME_MAP_CACHE, ignoring: %m");
+
+        return r != 0;
+}
+
+static int name_map_cache_path(const LookupPaths *lp, char **ret) {
+        _cleanup_free_ char *dir = NULL;
+        struct siphash state;
+        int r;
+
+        assert(lp);
+        assert(ret);
+
+        /* Next to the runtime unit directory, i.e. /run/systemd/ or $XDG_RUNTIME_DIR/systemd/, one file per
+         * search path, so that the system and the user instances don't get in each other's way. */
+        r = path_extract_directory(lp->runtime_config, &dir);
+        if (r < 0)
+                return r;
+
+        siphash24_init(&state, NAME_MAP_CACHE_HASH_KEY.bytes);
+        STRV_FOREACH(p, lp->search_path)
+                siphash24_compress(*p, strlen(*p) + 1, &state);
+
+        if (asprintf(ret, "%s/unit-name-map/%016" PRIx64 ".map", dir, siphash24_finalize(&state)) < 0)
+                return -ENOMEM;
+
+        return 0;
+}
+
+static int name_map_cache_hash_listing(const char *path, struct siphash *state) {
+        _cleanup_strv_free_ char **l = NULL;
+        _cleanup_closedir_ DIR *d = NULL;
+        int r;
+
+        assert(path);
+        assert(state);
+
+        d = opendir(path);
+        if (!d) {
+                if (errno == ENOENT) {
+                        siphash24_compress_byte(0, state);
+                        return 0;
+                }
+
+                return -errno;
+        }
+
+        FOREACH_DIRENT(de, d, return -errno) {
+                r = strv_extend(&l, de->d_name);
+                if (r < 0)
+                        return r;
+        }
+
+        /* readdir() order is not stable across recreations of the directory */
+        strv_sort(l);
+
+        STRV_FOREACH(name, l) {
+                struct stat st;
+                mode_t type;
+
+                if (fstatat(dirfd(d), *name, &st, AT_SYMLINK_NOFOLLOW) < 0) {
+                        if (errno == ENOENT)
+                                continue;
+
+                        return -errno;
+                }
+
+                siphash24_compress(*name, strlen(*name) + 1, state);
+                type = st.st_mode & S_IFMT;
+                siphash24_compress_typesafe(type, state);
+
+                if (S_ISLNK(st.st_mode)) {
+                        _cleanup_free_ char *target = NULL;
+
+                        r = readlinkat_malloc(dirfd(d), *name, &target);
+                        if (r < 0)
+                                return r;
+
+                        siphash24_compress(target, strlen(target) + 1, state);
+                } else if (S_ISREG(st.st_mode))
+                        siphash24_compress_boolean(st.st_size == 0, state);
+        }
+
+        return 0;
+}
+
+static int name_map_cache_key(const LookupPaths *lp, uint64_t *ret) {
+        struct siphash state;
+        int r;
+
+        assert(lp);
+        assert(ret);
+
+        siphash24_init(&state, NAME_MAP_CACHE_HASH_KEY.bytes);
+
+        STRV_FOREACH(dir, lp->search_path) {
+                struct stat st;
+                nsec_t mtime;
+
+                siphash24_compress(*dir, strlen(*dir) + 1, &state);
+
+                if (lookup_paths_mtime_exclude(lp, *dir)) {
+                        r = name_map_cache_hash_listing(*dir, &state);
+                        if (r < 0)
+                                return r;
+
+                        continue;
+                }
+
+                if (stat(*dir, &st) < 0) {
+                        if (errno != ENOENT)
+                                return -errno;
+
+                        siphash24_compress_byte(0, &state);
+                        continue;
+                }
+
+                siphash24_compress_byte(1, &state);
+                siphash24_compress_typesafe(st.st_dev, &state);
+                siphash24_compress_typesafe(st.st_ino, &state);
+                mtime = timespec_load_nsec(&st.st_mtim);
+                siphash24_compress_typesafe(mtime, &state);
+        }
+
+        *ret = siphash24_finalize(&state);
+        return 0;
+}
+
+static int name_map_cache_load(
+                const char *path,
+                uint64_t key,
+                Hashmap **ret_ids,
+                Hashmap **ret_names,
+                Set **ret_paths) {
+
+        _cleanup_hashmap_free_ Hashmap *ids = NULL, *names = NULL;
+        _cleanup_set_free_ Set *paths = NULL;
+        _cleanup_free_ char *line = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        struct stat st;
+        uint64_t k;
+        int r;
+
+        assert(path);
+        assert(ret_ids);
+        assert(ret_names);
+        assert(ret_paths);
+
+        f = fopen(path, "re");
+        if (!f)
+                return -errno;
+
+        /* Only trust what we or root wrote */
+        if (fstat(fileno(f), &st) < 0)
+                return -errno;
+        if (!S_ISREG(st.st_mode))
+                return -EBADFD;
+        if ((st.st_uid != 0 && st.st_uid != geteuid()) || (st.st_mode & 0022) != 0)
+                return -EPERM;
+
+        r = read_line(f, LONG_LINE_MAX, &line);
+        if (r < 0)
+                return r;
+        if (!streq(line, NAME_MAP_CACHE_MAGIC))
+                return -EBADMSG;
+
+        line = mfree(line);
+        r = read_line(f, LONG_LINE_MAX, &line);
+        if (r < 0)
+                return r;
+        if (sscanf(line, "key %" SCNx64, &k) != 1)
+                return -EBADMSG;
+        if (k != key)
+                return -ESTALE;
+
+        for (;;) {
+                _cleanup_free_ char *a = NULL, *b = NULL;
+                const char *p, *tab;
+
+                line = mfree(line);
+                r = read_line(f, LONG_LINE_MAX, &line);
+                if (r < 0)
+                        return r;
+                if (r == 0)
+                        break;
+
+                if (strlen(line) < 2 || line[1] != ' ')
+                        return -EBADMSG;
+
+                p = line + 2;
+                tab = strchr(p, '\t');
+
+                if (cunescape_length(p, tab ? (size_t) (tab - p) : strlen(p), 0, &a) < 0)
+                        return -EBADMSG;
+                if (tab && cunescape(tab + 1, 0, &b) < 0)
+                        return -EBADMSG;
+
+                switch (line[0]) {
+
+                case 'I': /* name → unit file */
+                        if (!b)
+                                return -EBADMSG;
+
+                        r = hashmap_ensure_put(&ids, &string_hash_ops_free_free, a, b);
+                        if (r < 0)
+                                return r;
+
+                        TAKE_PTR(a);
+                        TAKE_PTR(b);
+                        break;
+
+                case 'N': /* unit name ← alias */
+                        if (!b)
+                                return -EBADMSG;
+
+                        r = string_strv_hashmap_put(&names, a, b);
+                        if (r < 0)
+                                return r;
+                        break;
+
+                case 'P': /* unit path */
+                        if (b)
+                                return -EBADMSG;
+
+                        r = set_ensure_consume(&paths, &path_hash_ops_free, TAKE_PTR(a));
+                        if (r < 0)
+                                return r;
+                        break;
+
+                default:
+                        return -EBADMSG;
+                }
+        }
+
+        *ret_ids = TAKE_PTR(ids);
+        *ret_names = TAKE_PTR(names);
+        *ret_paths = TAKE_PTR(paths);
+        return 0;
+}
+
+static int name_map_cache_write_entry(FILE *f, char type, const char *a, const char *b) {
+        _cleanup_free_ char *x = NULL, *y = NULL;
+
+        assert(f);
+        assert(a);
+
+        x = cescape(a);
+        if (!x)
+                return -ENOMEM;
+
+        if (b) {
+                y = cescape(b);
+                if (!y)
+                        return -ENOMEM;
+        }
+
+        fprintf(f, "%c %s%s%s\n", type, x, y ? "\t" : "", strempty(y));
+        return 0;
+}
+
+static int name_map_cache_save(const char *path, uint64_t key, Hashmap *ids, Hashmap *names, Set *paths) {
+        _cleanup_(unlink_and_freep) char *t = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        const char *k, *v;
+        char **l;
+        int r;
+
+        assert(path);
+
+        r = mkdir_parents(path, 0755);
+        if (r < 0)
+                return r;
+
+        r = fopen_temporary(path, &f, &t);
+        if (r < 0)
+                return r;
+
+        if (fchmod(fileno(f), 0644) < 0)
+                return -errno;
+
+        fputs(NAME_MAP_CACHE_MAGIC "\n", f);
+        fprintf(f, "key %016" PRIx64 "\n", key);
+
+        HASHMAP_FOREACH_KEY(v, k, ids) {
+                r = name_map_cache_write_entry(f, 'I', k, v);
+                if (r < 0)
+                        return r;
+        }
+
+        HASHMAP_FOREACH_KEY(l, k, names)
+                STRV_FOREACH(alias, l) {
+                        r = name_map_cache_write_entry(f, 'N', k, *alias);
+                        if (r < 0)
+                                return r;
+                }
+
+        SET_FOREACH(k, paths) {
+                r = name_map_cache_write_entry(f, 'P', k, NULL);
+                if (r < 0)
+                        return r;
+        }
+
+        r = fflush_and_check(f);
+        if (r < 0)
+                return r;
+
+        if (rename(t, path) < 0)
+                return -errno;
+
+        t = mfree(t);
+        return 0;
+}
+
+int unit_file_load_or_build_name_map(
+                const LookupPaths *lp,
+                uint64_t *cache_timestamp_hash,
+                Hashmap **unit_ids_map,
+                Hashmap **unit_names_map,
+                Set **path_cache) {
+
+        _cleanup_hashmap_free_ Hashmap *ids = NULL, *names = NULL;
+        _cleanup_set_free_ Set *paths = NULL;
+        _cleanup_free_ char *path = NULL;
+        uint64_t timestamp_hash = 0, key;
+        int r;
+
+        assert(lp);
+
+        /* Like unit_file_build_name_map(), but first tries to load the maps from the name map cache, and
+         * stores them there if they had to be built. */
+
+        if (!name_map_cache_enabled(lp))
+                return unit_file_build_name_map(lp, cache_timestamp_hash, unit_ids_map, unit_names_map, path_cache);
+
+        if (cache_timestamp_hash &&
+            lookup_paths_timestamp_hash_same(lp, *cache_timestamp_hash, &timestamp_hash))
+                return 0;
+
+        r = name_map_cache_path(lp, &path);
+        if (r < 0)
+                return r;
+
+        /* Determine the key before building the maps. If anything is modified concurrently, the cache will
+         * be considered outdated next time. */
+        r = name_map_cache_key(lp, &key);
+        if (r < 0) {
+                log_debug_errno(r, "Failed to determine unit name map cache key, not using cache: %m");
+                return unit_file_build_name_map(lp, cache_timestamp_hash, unit_ids_map, unit_names_map, path_cache);
+        }
+
+        r = name_map_cache_load(path, key, &ids, &names, &paths);
+        if (r >= 0)
+                log_debug("Loaded unit name map from %s.", path);
+        else {
+                if (r != -ENOENT)
+                        log_debug_errno(r, "Failed to load unit name map from %s, rebuilding: %m", path);
+
+                /* Always collect the path cache, so that the result is useful to everyone */
+                r = unit_file_build_name_map(lp, NULL, &ids, &names, &paths);
+                if (r < 0)
+                        return r;
+
+                r = name_map_cache_save(path, key, ids, names, paths);
+                if (r < 0)
+                        log_debug_errno(r, "Failed to save unit name map to %s, ignoring: %m", path);
+        }
+
+        if (cache_timestamp_hash)
+                *cache_timestamp_hash = timestamp_hash;
+
+        hashmap_free_and_replace(*unit_ids_map, ids);
+        hashmap_free_and_replace(*unit_names_map, names);
+        if (path_cache)
+                set_free_and_replace(*path_cache, paths);
+
+        return 1;
+}
+
 static int add_name(
                 const char *unit_name,
                 Set **names,
@@ -51,6 +51,12 @@ int unit_file_build_name_map(
                 Hashmap **unit_ids_map,
                 Hashmap **unit_names_map,
                 Set **path_cache);
+int unit_file_load_or_build_name_map(
+                const LookupPaths *lp,
+                uint64_t *cache_timestamp_hash,
+                Hashmap **unit_ids_map,
+                Hashmap **unit_names_map,
+                Set **path_cache);
 
 int unit_file_find_fragment(
                 Hashmap *unit_ids_map,
@@ -11,11 +11,19 @@
 #include <stdbool.h>
 #include <stdlib.h>
 
+#if defined(__x86_64__)
+#  include <immintrin.h>
+#elif defined(__aarch64__)
+#  include <arm_neon.h>
+#endif
+
 #include "alloc-util.h"
 #include "gunicode.h"
 #include "hexdecoct.h"
 #include "macro.h"
+#include "simd-util.h"
 #include "string-util.h"
+#include "unaligned.h"
 #include "utf8.h"
 
 bool unichar_is_valid(char32_t ch) {
@@ -130,20 +138,129 @@ bool utf8_is_printable_newline(const char* str, size_t length, bool allow_newlin
         return true;
 }
 
+#if defined(__x86_64__)
+_target_("avx2") static size_t ascii_span_avx2(const char *str, size_t len) {
+        const __m256i zero = _mm256_setzero_si256();
+        size_t i = 0;
+
+        for (; len - i >= sizeof(__m256i); i += sizeof(__m256i)) {
+                __m256i v = _mm256_loadu_si256((const __m256i*) (str + i));
+                uint32_t m;
+
+                /* The sign bit is set for bytes >= 128, and the comparison flags NUL */
+                m = (uint32_t) _mm256_movemask_epi8(_mm256_or_si256(v, _mm256_cmpeq_epi8(v, zero)));
+                if (m != 0)
+                        return i + __builtin_ctz(m);
+        }
+
+        return i;
+}
+
+static size_t ascii_span_sse2(const char *str, size_t len) {
+        const __m128i zero = _mm_setzero_si128();
+        size_t i = 0;
+
+        for (; len - i >= sizeof(__m128i); i += sizeof(__m128i)) {
+                __m128i v = _mm_loadu_si128((const __m128i*) (str + i));
+                unsigned m;
+
+                m = (unsigned) _mm_movemask_epi8(_mm_or_si128(v, _mm_cmpeq_epi8(v, zero)));
+                if (m != 0)
+                        return i + __builtin_ctz(m);
+        }
+
+        return i;
+}
+#elif defined(__aarch64__)
+static size_t ascii_span_neon(const char *str, size_t len) {
+        size_t i = 0;
+
+        for (; len - i >= sizeof(uint8x16_t); i += sizeof(uint8x16_t)) {
+                uint8x16_t v = vld1q_u8((const uint8_t*) str + i);
+
+                /* Bytes that are not between 1 and 127 are those that wrap around when 1 is subtracted, or
+                 * have the high bit set. Only figure out which one it was if there is one at all. */
+                if (vmaxvq_u8(vsubq_u8(v, vdupq_n_u8(1))) >= 127)
+                        break;
+        }
+
+        return i;
+}
+#endif
+
+static size_t ascii_span_simd(const char *str, size_t len) {
+        /* Returns the number of bytes at the beginning of str that are ASCII, looking at whole vectors only.
+         * The caller takes care of the rest, i.e. a shorter tail and the exact position in the vector with
+         * the first non-ASCII byte where the vector code doesn't figure it out by itself. */
+
+#if defined(__x86_64__)
+        SimdLevel level = simd_level();
+
+        if (level >= SIMD_AVX2)
+                return ascii_span_avx2(str, len);
+        if (level >= SIMD_BASELINE)
+                return ascii_span_sse2(str, len);
+#elif defined(__aarch64__)
+        if (simd_level() >= SIMD_BASELINE)
+                return ascii_span_neon(str, len);
+#endif
+
+        return 0;
+}
+
+size_t ascii_span(const char *str, size_t len) {
+        size_t i = 0;
+
+        /* Returns the number of bytes at the beginning of str that are ASCII, i.e. values between 1 and 127,
+         * inclusive. Long runs are checked with vector instructions if we can, and otherwise eight bytes
+         * at a time: a byte has its high bit set in (w | (w - 0x01…01)) if and only if it is >= 128 or, via
+         * the borrow, NUL. A borrow only ever starts at a NUL byte, hence words without either are never
+         * flagged. */
+
+        assert(str || len == 0);
+
+        if (len >= 16) {
+                i = ascii_span_simd(str, len);
+                if (i < len && ((unsigned char) str[i] >= 128 || str[i] == '\0'))
+                        return i;
+        }
+
+        for (; len - i >= sizeof(uint64_t); i += sizeof(uint64_t)) {
+                uint64_t w = unaligned_read_ne64(str + i);
+
+                if ((w | (w - UINT64_C(0x0101010101010101))) & UINT64_C(0x8080808080808080))
+                        break;
+        }
+
+        for (; i < len; i++)
+                if ((unsigned char) str[i] >= 128 || str[i] == '\0')
+                        break;
+
+        return i;
+}
+
 char* utf8_is_valid_n(const char *str, size_t len_bytes) {
         /* Check if the string is composed of valid utf8 characters. If length len_bytes is given, stop after
          * len_bytes. Otherwise, stop at NUL. */
 
         assert(str);
 
-        for (size_t i = 0; len_bytes != SIZE_MAX ? i < len_bytes : str[i] != '\0'; ) {
+        if (len_bytes == SIZE_MAX)
+                len_bytes = strlen(str);
+
+        for (size_t i = 0; i < len_bytes; ) {
                 int len;
 
                 if (_unlikely_(str[i] == '\0'))
                         return NULL; /* embedded NUL */
 
-                len = utf8_encoded_valid_unichar(str + i,
-                                                 len_bytes != SIZE_MAX ? len_bytes - i : SIZE_MAX);
+                if ((unsigned char) str[i] < 128) {
+                        /* ASCII is valid UTF-8 by definition, skip over it in bulk */
+                        i += ascii_span(str + i, len_bytes - i);
+                        continue;
+                }
+
+                len = utf8_encoded_valid_unichar(str + i, len_bytes - i);
                 if (_unlikely_(len < 0))
                         return NULL; /* invalid character */
 
@@ -277,11 +394,10 @@ char* ascii_is_valid_n(const char *str, size_t len) {
 
         assert(str);
 
-        for (size_t i = 0; len != SIZE_MAX ? i < len : str[i] != '\0'; i++)
-                if ((unsigned char) str[i] >= 128 || str[i] == '\0')
-                        return NULL;
+        if (len == SIZE_MAX)
+                len = strlen(str);
 
-        return (char*) str;
+        return ascii_span(str, len) == len ? (char*) str : NULL;
 }
 
 int utf8_to_ascii(const char *str, char replacement_char, char **ret) {
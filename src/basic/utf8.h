@@ -14,6 +14,8 @@
 
 bool unichar_is_valid(char32_t c);
 
+size_t ascii_span(const char *str, size_t len) _pure_;
+
 char* utf8_is_valid_n(const char *str, size_t len_bytes) _pure_;
 static inline char* utf8_is_valid(const char *str) {
         return utf8_is_valid_n(str, SIZE_MAX);
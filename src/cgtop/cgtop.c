@@ -2,6 +2,7 @@
 
 #include <errno.h>
 #include <getopt.h>
+#include <pthread.h>
 #include <signal.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -15,6 +16,8 @@
 #include "bus-util.h"
 #include "cgroup-show.h"
 #include "cgroup-util.h"
+#include "cpu-set-util.h"
+#include "dirent-util.h"
 #include "fd-util.h"
 #include "fileio.h"
 #include "hashmap.h"
@@ -26,6 +29,7 @@
 #include "pretty-print.h"
 #include "process-util.h"
 #include "procfs-util.h"
+#include "rlimit-util.h"
 #include "sort-util.h"
 #include "stdio-util.h"
 #include "strv.h"
@@ -33,9 +37,19 @@
 #include "unit-name.h"
 #include "virt.h"
 
-typedef struct Group {
+typedef struct Group Group;
+
+struct Group {
         char *path;
 
+        /* On the unified hierarchy the cgroup directory is kept open between iterations, and the inode
+         * number is used to detect if the cgroup was replaced by a new one of the same name. 'parent' is
+         * only valid during one iteration. */
+        DIR *dir;
+        ino_t ino;
+        bool is_root;
+        Group *parent;
+
         bool n_tasks_valid;
         bool cpu_valid;
         bool memory_valid;
@@ -54,7 +68,7 @@ typedef struct Group {
         uint64_t io_input, io_output;
         nsec_t io_timestamp;
         uint64_t io_input_bps, io_output_bps;
-} Group;
+};
 
 /* Counted objects, enum order matters */
 typedef enum PidsCount {
@@ -75,6 +89,17 @@ static bool arg_recursive_unset = false;
 
 static PidsCount arg_count = COUNT_PIDS;
 
+/* On the unified hierarchy groups are sampled in parallel by up to this many threads, including the calling
+ * one, but only if each gets at least this many groups. Reading attributes is CPU bound in the kernel, hence
+ * the number is also limited by the CPUs we may run on. */
+#define SAMPLE_THREADS_MAX 8U
+#define SAMPLE_GROUPS_PER_THREAD_MIN 256U
+
+static unsigned n_sample_threads = 1;
+
+/* Cgroup directories are kept open between iterations as long as we stay below this many open */
+static size_t n_dirs_open = 0, n_dirs_open_max = 0;
+
 static enum {
         ORDER_PATH,
         ORDER_TASKS,
@@ -93,6 +118,10 @@ static Group *group_free(Group *g) {
                 return NULL;
 
         free(g->path);
+        if (g->dir) {
+                safe_closedir(g->dir);
+                n_dirs_open--;
+        }
         return mfree(g);
 }
 
@@ -148,24 +177,16 @@ static bool is_root_cgroup(const char *path) {
         return empty_or_root(path);
 }
 
-static int process(
-                const char *controller,
-                const char *path,
-                Hashmap *a,
-                Hashmap *b,
-                unsigned iteration,
-                Group **ret) {
-
+static int group_get(const char *path, Hashmap *a, Hashmap *b, Group **ret) {
         Group *g;
-        int r, all_unified;
+        int r;
 
-        assert(controller);
         assert(path);
         assert(a);
+        assert(ret);
 
-        all_unified = cg_all_unified();
-        if (all_unified < 0)
-                return all_unified;
+        /* Looks up the group in this iteration's hashmap, moves it over from the previous iteration's
+         * one, or creates it. */
 
         g = hashmap_get(a, path);
         if (!g) {
@@ -181,6 +202,8 @@ static int process(
                                 return -ENOMEM;
                         }
 
+                        g->is_root = is_root_cgroup(path);
+
                         r = hashmap_put(a, g->path, g);
                         if (r < 0) {
                                 group_free(g);
@@ -195,6 +218,120 @@ static int process(
                 }
         }
 
+        *ret = g;
+        return 0;
+}
+
+static void group_update_io(Group *g, uint64_t rd, uint64_t wr, unsigned iteration) {
+        nsec_t timestamp;
+
+        assert(g);
+
+        timestamp = now_nsec(CLOCK_MONOTONIC);
+
+        if (g->io_iteration == iteration - 1) {
+                uint64_t x, yr, yw;
+
+                x = (uint64_t) (timestamp - g->io_timestamp);
+                if (x < 1)
+                        x = 1;
+
+                if (rd > g->io_input)
+                        yr = rd - g->io_input;
+                else
+                        yr = 0;
+
+                if (wr > g->io_output)
+                        yw = wr - g->io_output;
+                else
+                        yw = 0;
+
+                if (yr > 0 || yw > 0) {
+                        g->io_input_bps = (yr * 1000000000ULL) / x;
+                        g->io_output_bps = (yw * 1000000000ULL) / x;
+                        g->io_valid = true;
+                }
+        }
+
+        g->io_input = rd;
+        g->io_output = wr;
+        g->io_timestamp = timestamp;
+        g->io_iteration = iteration;
+}
+
+static void group_update_cpu(Group *g, uint64_t new_usage, unsigned iteration) {
+        nsec_t timestamp;
+
+        assert(g);
+
+        timestamp = now_nsec(CLOCK_MONOTONIC);
+
+        if (g->cpu_iteration == iteration - 1 &&
+            (nsec_t) new_usage > g->cpu_usage) {
+
+                nsec_t x, y;
+
+                x = timestamp - g->cpu_timestamp;
+                if (x < 1)
+                        x = 1;
+
+                y = (nsec_t) new_usage - g->cpu_usage;
+                g->cpu_fraction = (double) y / (double) x;
+                g->cpu_valid = true;
+        }
+
+        g->cpu_usage = (nsec_t) new_usage;
+        g->cpu_timestamp = timestamp;
+        g->cpu_iteration = iteration;
+}
+
+static void parse_io_stat_line(const char *line, uint64_t *rd, uint64_t *wr) {
+        const char *l;
+        uint64_t k;
+
+        assert(line);
+        assert(rd);
+        assert(wr);
+
+        /* Parses one line of io.stat on the unified hierarchy, and adds up the bytes read and written */
+
+        /* Skip the device */
+        l = line + strcspn(line, WHITESPACE);
+        l += strspn(l, WHITESPACE);
+
+        while (!isempty(l)) {
+                if (sscanf(l, "rbytes=%" SCNu64, &k) == 1)
+                        *rd += k;
+                else if (sscanf(l, "wbytes=%" SCNu64, &k) == 1)
+                        *wr += k;
+
+                l += strcspn(l, WHITESPACE);
+                l += strspn(l, WHITESPACE);
+        }
+}
+
+static int process(
+                const char *controller,
+                const char *path,
+                Hashmap *a,
+                Hashmap *b,
+                unsigned iteration,
+                Group **ret) {
+
+        Group *g;
+        int r;
+
+        assert(controller);
+        assert(path);
+        assert(a);
+
+        /* Samples one attribute of the group on the legacy or hybrid hierarchies, where each controller
+         * has its own tree. See sample_group() for the unified hierarchy. */
+
+        r = group_get(path, a, b, &g);
+        if (r < 0)
+                return r;
+
         if (streq(controller, SYSTEMD_CGROUP_CONTROLLER) &&
             IN_SET(arg_count, COUNT_ALL_PROCESSES, COUNT_USERSPACE_PROCESSES)) {
                 _cleanup_fclose_ FILE *f = NULL;
@@ -220,7 +357,7 @@ static int process(
 
         } else if (streq(controller, "pids") && arg_count == COUNT_PIDS) {
 
-                if (is_root_cgroup(path)) {
+                if (g->is_root) {
                         r = procfs_tasks_get_current(&g->n_tasks);
                         if (r < 0)
                                 return r;
@@ -247,17 +384,14 @@ static int process(
 
         } else if (streq(controller, "memory")) {
 
-                if (is_root_cgroup(path)) {
+                if (g->is_root) {
                         r = procfs_memory_get_used(&g->memory);
                         if (r < 0)
                                 return r;
                 } else {
                         _cleanup_free_ char *p = NULL, *v = NULL;
 
-                        if (all_unified)
-                                r = cg_get_path(controller, path, "memory.current", &p);
-                        else
-                                r = cg_get_path(controller, path, "memory.usage_in_bytes", &p);
+                        r = cg_get_path(controller, path, "memory.usage_in_bytes", &p);
                         if (r < 0)
                                 return r;
 
@@ -275,14 +409,12 @@ static int process(
                 if (g->memory > 0)
                         g->memory_valid = true;
 
-        } else if ((streq(controller, "io") && all_unified) ||
-                   (streq(controller, "blkio") && !all_unified)) {
+        } else if (streq(controller, "blkio")) {
                 _cleanup_fclose_ FILE *f = NULL;
                 _cleanup_free_ char *p = NULL;
                 uint64_t wr = 0, rd = 0;
-                nsec_t timestamp;
 
-                r = cg_get_path(controller, path, all_unified ? "io.stat" : "blkio.io_service_bytes", &p);
+                r = cg_get_path(controller, path, "blkio.io_service_bytes", &p);
                 if (r < 0)
                         return r;
 
@@ -308,91 +440,32 @@ static int process(
                         l = line + strcspn(line, WHITESPACE);
                         l += strspn(l, WHITESPACE);
 
-                        if (all_unified) {
-                                while (!isempty(l)) {
-                                        if (sscanf(l, "rbytes=%" SCNu64, &k) == 1)
-                                                rd += k;
-                                        else if (sscanf(l, "wbytes=%" SCNu64, &k) == 1)
-                                                wr += k;
-
-                                        l += strcspn(l, WHITESPACE);
-                                        l += strspn(l, WHITESPACE);
-                                }
-                        } else {
-                                if (first_word(l, "Read")) {
-                                        l += 4;
-                                        q = &rd;
-                                } else if (first_word(l, "Write")) {
-                                        l += 5;
-                                        q = &wr;
-                                } else
-                                        continue;
-
-                                l += strspn(l, WHITESPACE);
-                                r = safe_atou64(l, &k);
-                                if (r < 0)
-                                        continue;
-
-                                *q += k;
-                        }
-                }
-
-                timestamp = now_nsec(CLOCK_MONOTONIC);
-
-                if (g->io_iteration == iteration - 1) {
-                        uint64_t x, yr, yw;
-
-                        x = (uint64_t) (timestamp - g->io_timestamp);
-                        if (x < 1)
-                                x = 1;
-
-                        if (rd > g->io_input)
-                                yr = rd - g->io_input;
-                        else
-                                yr = 0;
+                        if (first_word(l, "Read")) {
+                                l += 4;
+                                q = &rd;
+                        } else if (first_word(l, "Write")) {
+                                l += 5;
+                                q = &wr;
+                        } else
+                                continue;
 
-                        if (wr > g->io_output)
-                                yw = wr - g->io_output;
-                        else
-                                yw = 0;
+                        l += strspn(l, WHITESPACE);
+                        r = safe_atou64(l, &k);
+                        if (r < 0)
+                                continue;
 
-                        if (yr > 0 || yw > 0) {
-                                g->io_input_bps = (yr * 1000000000ULL) / x;
-                                g->io_output_bps = (yw * 1000000000ULL) / x;
-                                g->io_valid = true;
-                        }
+                        *q += k;
                 }
 
-                g->io_input = rd;
-                g->io_output = wr;
-                g->io_timestamp = timestamp;
-                g->io_iteration = iteration;
+                group_update_io(g, rd, wr, iteration);
         } else if (STR_IN_SET(controller, "cpu", "cpuacct") || cpu_accounting_is_cheap()) {
                 _cleanup_free_ char *p = NULL, *v = NULL;
                 uint64_t new_usage;
-                nsec_t timestamp;
 
-                if (is_root_cgroup(path)) {
+                if (g->is_root) {
                         r = procfs_cpu_get_usage(&new_usage);
                         if (r < 0)
                                 return r;
-                } else if (all_unified) {
-                        _cleanup_free_ char *val = NULL;
-
-                        if (!streq(controller, "cpu"))
-                                return 0;
-
-                        r = cg_get_keyed_attribute("cpu", path, "cpu.stat", STRV_MAKE("usage_usec"), &val);
-                        if (IN_SET(r, -ENOENT, -ENXIO))
-                                return 0;
-                        if (r < 0)
-                                return r;
-
-                        r = safe_atou64(val, &new_usage);
-                        if (r < 0)
-                                return r;
-
-                        new_usage *= NSEC_PER_USEC;
                 } else {
                         if (!streq(controller, "cpuacct"))
                                 return 0;
@@ -412,26 +485,7 @@ static int process(
                                 return r;
                 }
 
-                timestamp = now_nsec(CLOCK_MONOTONIC);
-
-                if (g->cpu_iteration == iteration - 1 &&
-                    (nsec_t) new_usage > g->cpu_usage) {
-
-                        nsec_t x, y;
-
-                        x = timestamp - g->cpu_timestamp;
-                        if (x < 1)
-                                x = 1;
-
-                        y = (nsec_t) new_usage - g->cpu_usage;
-                        g->cpu_fraction = (double) y / (double) x;
-                        g->cpu_valid = true;
-                }
-
-                g->cpu_usage = (nsec_t) new_usage;
-                g->cpu_timestamp = timestamp;
-                g->cpu_iteration = iteration;
-
+                group_update_cpu(g, new_usage, iteration);
         }
 
         if (ret)
@@ -513,10 +567,352 @@ static int refresh_one(
         return 1;
 }
 
+static int walk_unified(
+                const char *path,
+                Group *parent,
+                int parent_fd,
+                const struct dirent *de,
+                Hashmap *a,
+                Hashmap *b,
+                unsigned depth,
+                Group ***groups,
+                size_t *n_groups) {
+
+        _cleanup_closedir_ DIR *temporary = NULL;
+        Group *g;
+        DIR *d;
+        int r;
+
+        assert(path);
+        assert(a);
+        assert(groups);
+        assert(n_groups);
+
+        /* Collects the groups to sample on the unified hierarchy, parents before their children */
+
+        r = group_get(path, a, b, &g);
+        if (r < 0)
+                return r;
+
+        /* The cgroup was removed and created again since the last iteration */
+        if (g->dir && de && g->ino != de->d_ino) {
+                g->dir = safe_closedir(g->dir);
+                n_dirs_open--;
+        }
+
+        d = g->dir;
+        if (!d) {
+                _cleanup_close_ int fd = -EBADF;
+
+                if (parent_fd < 0)
+                        fd = cg_path_open(SYSTEMD_CGROUP_CONTROLLER, path);
+                else
+                        fd = RET_NERRNO(openat(parent_fd, de->d_name, O_DIRECTORY|O_CLOEXEC|O_NOFOLLOW));
+                if (fd == -ENOENT)
+                        return 0;
+                if (fd < 0)
+                        return fd;
+
+                d = take_fdopendir(&fd);
+                if (!d)
+                        return -errno;
+
+                if (n_dirs_open < n_dirs_open_max) {
+                        g->dir = d;
+                        g->ino = de ? de->d_ino : 0;
+                        n_dirs_open++;
+                } else
+                        /* Out of fds to keep open, sample_group() opens the cgroup again */
+                        temporary = d;
+        }
+
+        g->parent = parent;
+
+        if (!GREEDY_REALLOC(*groups, *n_groups + 1))
+                return -ENOMEM;
+
+        (*groups)[(*n_groups)++] = g;
+
+        if (depth >= arg_depth)
+                return 0;
+
+        rewinddir(d);
+
+        FOREACH_DIRENT_ALL(e, d, return -errno) {
+                _cleanup_free_ char *p = NULL;
+
+                if (e->d_type != DT_DIR || dot_or_dot_dot(e->d_name))
+                        continue;
+
+                p = path_join(path, e->d_name);
+                if (!p)
+                        return -ENOMEM;
+
+                path_simplify(p);
+
+                r = walk_unified(p, g, dirfd(d), e, a, b, depth + 1, groups, n_groups);
+                if (r < 0)
+                        return r;
+        }
+
+        return 0;
+}
+
+static int count_processes_at(int dir_fd, char **buf, uint64_t *ret) {
+        uint64_t n = 0;
+        int r;
+
+        assert(dir_fd >= 0);
+        assert(buf);
+        assert(ret);
+
+        r = read_virtual_file_at_buffer(dir_fd, "cgroup.procs", SIZE_MAX, buf, /* ret_size= */ NULL);
+        if (r == -ENOENT)
+                return -ENODATA;
+        if (r < 0)
+                return r;
+
+        for (char *p = *buf, *eol; !isempty(p); p = eol) {
+                pid_t pid;
+
+                eol = strchrnul(p, '\n');
+                if (*eol)
+                        *(eol++) = 0;
+
+                /* PIDs from other PID namespaces show up as 0, count them too */
+                if (arg_count == COUNT_USERSPACE_PROCESSES &&
+                    parse_pid(p, &pid) >= 0 &&
+                    pid_is_kernel_thread(pid) > 0)
+                        continue;
+
+                n++;
+        }
+
+        *ret = n;
+        return 0;
+}
+
+static int sample_group(Group *g, unsigned iteration, char **buf) {
+        _cleanup_close_ int temporary_fd = -EBADF;
+        uint64_t v, rd = 0, wr = 0;
+        int fd, r;
+
+        assert(g);
+        assert(buf);
+
+        /* Samples all attributes of the group on the unified hierarchy. Only touches the group itself, hence
+         * may be called for different groups in parallel. */
+
+        if (g->dir)
+                fd = dirfd(g->dir);
+        else {
+                temporary_fd = cg_path_open(SYSTEMD_CGROUP_CONTROLLER, g->path);
+                if (temporary_fd == -ENOENT)
+                        return 0;
+                if (temporary_fd < 0)
+                        return temporary_fd;
+
+                fd = temporary_fd;
+        }
+
+        if (arg_count == COUNT_PIDS) {
+                /* pids.current is maintained by the kernel, no need to enumerate anything */
+                if (g->is_root)
+                        r = procfs_tasks_get_current(&v);
+                else
+                        r = cg_get_attribute_as_uint64_at(fd, "pids.current", buf, &v);
+        } else
+                r = count_processes_at(fd, buf, &v);
+        if (r < 0 && r != -ENODATA)
+                return r;
+        if (r >= 0) {
+                g->n_tasks = v;
+                g->n_tasks_valid = v > 0;
+        }
+
+        if (g->is_root)
+                r = procfs_memory_get_used(&v);
+        else
+                r = cg_get_attribute_as_uint64_at(fd, "memory.current", buf, &v);
+        if (r < 0 && r != -ENODATA)
+                return r;
+        if (r >= 0) {
+                g->memory = v;
+                g->memory_valid = v > 0;
+        }
+
+        r = read_virtual_file_at_buffer(fd, "io.stat", SIZE_MAX, buf, /* ret_size= */ NULL);
+        if (r < 0 && r != -ENOENT)
+                return r;
+        if (r >= 0) {
+                for (char *line = *buf, *eol; !isempty(line); line = eol) {
+                        eol = strchrnul(line, '\n');
+                        if (*eol)
+                                *(eol++) = 0;
+
+                        parse_io_stat_line(line, &rd, &wr);
+                }
+
+                group_update_io(g, rd, wr, iteration);
+        }
+
+        if (g->is_root)
+                r = procfs_cpu_get_usage(&v);
+        else {
+                _cleanup_free_ char *val = NULL;
+
+                r = cg_get_keyed_attribute_at(fd, "cpu.stat", STRV_MAKE("usage_usec"), &val, /* mode= */ 0, buf);
+                if (IN_SET(r, -ENOENT, -ENXIO))
+                        return 0;
+                if (r < 0)
+                        return r;
+
+                r = safe_atou64(val, &v);
+                if (r < 0)
+                        return r;
+
+                v *= NSEC_PER_USEC;
+        }
+        if (r < 0)
+                return r;
+
+        group_update_cpu(g, v, iteration);
+        return 0;
+}
+
+static int sample_groups(Group **groups, size_t n_groups, unsigned iteration) {
+        _cleanup_free_ char *buf = NULL;
+        int r;
+
+        assert(groups || n_groups == 0);
+
+        FOREACH_ARRAY(g, groups, n_groups) {
+                r = sample_group(*g, iteration, &buf);
+                if (r < 0)
+                        return r;
+        }
+
+        return 0;
+}
+
+typedef struct SampleWorker {
+        pthread_t thread;
+        Group **groups;
+        size_t n_groups;
+        unsigned iteration;
+        int result;
+} SampleWorker;
+
+static void* sample_worker_thread(void *userdata) {
+        SampleWorker *w = ASSERT_PTR(userdata);
+
+        w->result = sample_groups(w->groups, w->n_groups, w->iteration);
+        return NULL;
+}
+
+static int sample_groups_parallel(Group **groups, size_t n_groups, unsigned iteration) {
+        SampleWorker workers[SAMPLE_THREADS_MAX];
+        unsigned n_workers, n_started;
+        sigset_t ss, saved_ss;
+        int r, ret;
+
+        assert(groups || n_groups == 0);
+
+        n_workers = MIN(n_sample_threads, n_groups / SAMPLE_GROUPS_PER_THREAD_MIN);
+        if (n_workers <= 1)
+                return sample_groups(groups, n_groups, iteration);
+
+        /* Groups are listed depth-first, hence each slice mostly covers whole subtrees */
+        for (unsigned k = 0; k < n_workers; k++) {
+                size_t start = n_groups * k / n_workers, end = n_groups * (k + 1) / n_workers;
+
+                workers[k] = (SampleWorker) {
+                        .groups = groups + start,
+                        .n_groups = end - start,
+                        .iteration = iteration,
+                };
+        }
+
+        /* The workers are not supposed to handle any signals, the calling thread does */
+        assert_se(sigfillset(&ss) >= 0);
+        r = pthread_sigmask(SIG_BLOCK, &ss, &saved_ss);
+        if (r > 0)
+                return -r;
+
+        for (n_started = 1; n_started < n_workers; n_started++) {
+                r = pthread_create(&workers[n_started].thread, NULL, sample_worker_thread, workers + n_started);
+                if (r > 0) {
+                        /* Fewer threads will do, too */
+                        log_debug_errno(r, "Failed to start thread for sampling cgroups, ignoring: %m");
+                        break;
+                }
+        }
+
+        assert_se(pthread_sigmask(SIG_SETMASK, &saved_ss, NULL) == 0);
+
+        /* The calling thread takes the first slice, and those of the threads that couldn't be started */
+        ret = sample_groups(groups, workers[0].n_groups, iteration);
+        if (n_started < n_workers)
+                RET_GATHER(ret, sample_groups(workers[n_started].groups,
+                                              groups + n_groups - workers[n_started].groups,
+                                              iteration));
+
+        for (unsigned k = 1; k < n_started; k++) {
+                assert_se(pthread_join(workers[k].thread, NULL) == 0);
+                RET_GATHER(ret, workers[k].result);
+        }
+
+        return ret;
+}
+
+static int refresh_unified(const char *root, Hashmap *a, Hashmap *b, unsigned iteration) {
+        _cleanup_free_ Group **groups = NULL;
+        size_t n_groups = 0;
+        int r;
+
+        /* All controllers share one tree on the unified hierarchy, hence walk it once, and sample all
+         * attributes of each group at once */
+
+        r = walk_unified(root, /* parent= */ NULL, /* parent_fd= */ -EBADF, /* de= */ NULL, a, b, 0, &groups, &n_groups);
+        if (r < 0)
+                return r;
+
+        r = sample_groups_parallel(groups, n_groups, iteration);
+        if (r < 0)
+                return r;
+
+        if (!arg_recursive || !IN_SET(arg_count, COUNT_ALL_PROCESSES, COUNT_USERSPACE_PROCESSES))
+                return 0;
+
+        /* Recursively sum up processes. Children are listed after their parents, hence going backwards the
+         * count of each group is complete by the time it is added to its parent. */
+        for (size_t i = n_groups; i > 0; i--) {
+                Group *g = groups[i - 1];
+
+                if (!g->parent || !g->n_tasks_valid)
+                        continue;
+
+                if (g->parent->n_tasks_valid)
+                        g->parent->n_tasks += g->n_tasks;
+                else {
+                        g->parent->n_tasks = g->n_tasks;
+                        g->parent->n_tasks_valid = true;
+                }
+        }
+
+        return 0;
+}
+
 static int refresh(const char *root, Hashmap *a, Hashmap *b, unsigned iteration) {
         int r;
 
-        FOREACH_STRING(c, SYSTEMD_CGROUP_CONTROLLER, "cpu", "cpuacct", "memory", "io", "blkio", "pids") {
+        r = cg_all_unified();
+        if (r < 0)
+                return r;
+        if (r > 0)
+                return refresh_unified(root, a, b, iteration);
+
+        FOREACH_STRING(c, SYSTEMD_CGROUP_CONTROLLER, "cpuacct", "memory", "blkio", "pids") {
                 r = refresh_one(c, root, a, b, iteration, 0, NULL);
                 if (r < 0)
                         return r;
@@ -1074,6 +1470,7 @@ static int loop(const char *root) {
 static int run(int argc, char *argv[]) {
         _cleanup_free_ char *root = NULL;
         CGroupMask mask;
+        struct rlimit rl;
         int r;
 
         log_setup();
@@ -1099,6 +1496,17 @@ static int run(int argc, char *argv[]) {
                 return log_error_errno(r, "Failed to get root control group path: %m");
         log_debug("CGroup path: %s", root);
 
+        /* Keeping the cgroup directories open needs a lot of fds. Leave some room for everything else. */
+        (void) rlimit_nofile_bump(HIGH_RLIMIT_NOFILE);
+        if (getrlimit(RLIMIT_NOFILE, &rl) >= 0)
+                n_dirs_open_max = LESS_BY(MIN(rl.rlim_cur, (rlim_t) SIZE_MAX), (rlim_t) 128);
+
+        r = cpus_in_affinity_mask();
+        if (r < 0)
+                log_debug_errno(r, "Failed to determine number of CPUs, sampling cgroups in one thread: %m");
+        else
+                n_sample_threads = CLAMP((unsigned) r, 1U, SAMPLE_THREADS_MAX);
+
         signal(SIGWINCH, columns_lines_cache_reset);
 
         if (arg_iterations == UINT_MAX)
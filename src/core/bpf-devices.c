@@ -195,7 +195,8 @@ int bpf_devices_apply_policy(
         _cleanup_free_ char *controller_path = NULL;
         int r;
 
-        /* This will assign *prog_installed if everything goes well. */
+        /* This will assign *prog_installed if everything goes well. Returns 1 if the same program was
+         * installed already, and nothing needed to be done, 0 otherwise. */
 
         assert(prog);
         if (!*prog)
@@ -237,6 +238,13 @@ int bpf_devices_apply_policy(
         if (r < 0)
                 return log_error_errno(r, "Failed to determine cgroup path: %m");
 
+        /* Loading a program into the kernel means running it through the verifier, hence if the very same
+         * program is attached to the cgroup already, leave it in place. */
+        if (prog_installed && bpf_program_is_attached_same(*prog_installed, *prog, BPF_CGROUP_DEVICE, controller_path, BPF_F_ALLOW_MULTI)) {
+                *prog = bpf_program_free(*prog);
+                return 1;
+        }
+
         r = bpf_program_cgroup_attach(*prog, BPF_CGROUP_DEVICE, controller_path, BPF_F_ALLOW_MULTI);
         if (r < 0)
                 return log_error_errno(r, "Attaching device control BPF program to cgroup %s failed: %m",
@@ -49,6 +49,9 @@
 
 #define CGROUP_CPU_QUOTA_DEFAULT_PERIOD_USEC ((usec_t) 100 * USEC_PER_MSEC)
 
+/* How much time to spend at most on units whose cgroup ran empty, per event loop iteration */
+#define CGROUP_EMPTY_BUDGET_USEC ((usec_t) 5 * USEC_PER_MSEC)
+
 /* Returns the log level to use when cgroup attribute writes fail. When an attribute is missing or we have access
  * problems we downgrade to LOG_DEBUG. This is supposed to be nice to container managers and kernels which want to mask
  * out specific attributes from us. */
@@ -114,6 +117,101 @@ bool unit_has_host_root_cgroup(Unit *u) {
         return unit_has_name(u, SPECIAL_ROOT_SLICE);
 }
 
+static void cgroup_attribute_forget(CGroupRuntime *crt, const char *attribute) {
+        char *k = NULL;
+
+        assert(crt);
+
+        free(hashmap_remove2(crt->cgroup_attributes, attribute, (void**) &k));
+        free(k);
+}
+
+static void cgroup_attribute_remember(CGroupRuntime *crt, const char *attribute, const char *value) {
+        _cleanup_free_ char *k = NULL, *v = NULL;
+
+        assert(crt);
+
+        cgroup_attribute_forget(crt, attribute);
+
+        /* On failure we'll simply write the attribute again next time, hence ignore errors */
+        k = strdup(attribute);
+        v = strdup(value);
+        if (!k || !v)
+                return;
+
+        if (hashmap_ensure_put(&crt->cgroup_attributes, &string_hash_ops_free_free, k, v) < 0)
+                return;
+
+        TAKE_PTR(k);
+        TAKE_PTR(v);
+}
+
+static int unit_get_cgroup_fd(Unit *u, bool attributes) {
+        int r;
+
+        assert(u);
+
+        /* Returns the unit's cgroup directory on the unified hierarchy. If 'attributes' is true, only if
+         * all controllers are on the unified hierarchy, since otherwise their attributes live elsewhere. The
+         * fd is kept until the cgroup is removed or created anew. */
+
+        CGroupRuntime *crt = unit_get_cgroup_runtime(u);
+        if (!crt || !crt->cgroup_path)
+                return -EOWNERDEAD;
+
+        r = attributes ? cg_all_unified() : cg_unified_controller(SYSTEMD_CGROUP_CONTROLLER);
+        if (r < 0)
+                return r;
+        if (r == 0)
+                return -EOPNOTSUPP;
+
+        if (crt->cgroup_fd >= 0)
+                return crt->cgroup_fd;
+
+        r = cg_path_open(SYSTEMD_CGROUP_CONTROLLER, crt->cgroup_path);
+        if (r < 0)
+                return r;
+
+        return (crt->cgroup_fd = r);
+}
+
+static int unit_cgroup_set_attribute(Unit *u, const char *controller, const char *attribute, const char *value) {
+        int fd, r;
+
+        assert(u);
+        assert(attribute);
+        assert(value);
+
+        CGroupRuntime *crt = unit_get_cgroup_runtime(u);
+        if (!crt || !crt->cgroup_path)
+                return -EOWNERDEAD;
+
+        /* Realizing a slice rewrites the attributes of all its members, most of which usually didn't
+         * change. Writes of identical values are suppressed, as each is a syscall, and some make the kernel
+         * do real work. Note that this is only correct because we never write attributes where the write
+         * itself has side effects beyond setting the value, i.e. not the cgroup v1 devices.allow/deny
+         * lists. */
+        if (streq_ptr(hashmap_get(crt->cgroup_attributes, attribute), value)) {
+                u->manager->n_cgroup_attribute_writes_skipped++;
+                return 0;
+        }
+
+        u->manager->n_cgroup_attribute_writes++;
+
+        fd = unit_get_cgroup_fd(u, /* attributes = */ true);
+        if (fd >= 0)
+                r = cg_set_attribute_at(fd, attribute, value);
+        else
+                r = cg_set_attribute(controller, crt->cgroup_path, attribute, value);
+        if (r < 0) {
+                cgroup_attribute_forget(crt, attribute);
+                return r;
+        }
+
+        cgroup_attribute_remember(crt, attribute, value);
+        return r;
+}
+
 static int set_attribute_and_warn(Unit *u, const char *controller, const char *attribute, const char *value) {
         int r;
 
@@ -123,7 +221,7 @@ static int set_attribute_and_warn(Unit *u, const char *controller, const char *a
         if (!crt || !crt->cgroup_path)
                 return -EOWNERDEAD;
 
-        r = cg_set_attribute(controller, crt->cgroup_path, attribute, value);
+        r = unit_cgroup_set_attribute(u, controller, attribute, value);
         if (r < 0)
                 log_unit_full_errno(u, LOG_LEVEL_CGROUP_WRITE(r), r, "Failed to set '%s' attribute on '%s' to '%.*s': %m",
                                     strna(attribute), empty_to_root(crt->cgroup_path), (int) strcspn(value, NEWLINE), value);
@@ -131,6 +229,47 @@ static int set_attribute_and_warn(Unit *u, const char *controller, const char *a
         return r;
 }
 
+static int unit_cgroup_get_attribute_as_uint64(Unit *u, const char *controller, const char *attribute, uint64_t *ret) {
+        _cleanup_free_ char *buf = NULL;
+        int fd;
+
+        assert(u);
+
+        CGroupRuntime *crt = unit_get_cgroup_runtime(u);
+        if (!crt || !crt->cgroup_path)
+                return -EOWNERDEAD;
+
+        fd = unit_get_cgroup_fd(u, /* attributes = */ true);
+        if (fd >= 0)
+                return cg_get_attribute_as_uint64_at(fd, attribute, &buf, ret);
+
+        return cg_get_attribute_as_uint64(controller, crt->cgroup_path, attribute, ret);
+}
+
+static int unit_cgroup_get_keyed_attribute(
+                Unit *u,
+                const char *controller,
+                const char *attribute,
+                char **keys,
+                char **ret_values,
+                CGroupKeyMode mode) {
+
+        _cleanup_free_ char *buf = NULL;
+        int fd;
+
+        assert(u);
+
+        CGroupRuntime *crt = unit_get_cgroup_runtime(u);
+        if (!crt || !crt->cgroup_path)
+                return -EOWNERDEAD;
+
+        fd = unit_get_cgroup_fd(u, /* attributes = */ !streq(controller, SYSTEMD_CGROUP_CONTROLLER));
+        if (fd >= 0)
+                return cg_get_keyed_attribute_at(fd, attribute, keys, ret_values, mode, &buf);
+
+        return cg_get_keyed_attribute_full(controller, crt->cgroup_path, attribute, keys, ret_values, mode);
+}
+
 static void cgroup_compat_warn(void) {
         static bool cgroup_compat_warned = false;
 
@@ -633,7 +772,7 @@ static int unit_get_kernel_memory_limit(Unit *u, const char *file, uint64_t *ret
         if (!crt || !crt->cgroup_path)
                 return -EOWNERDEAD;
 
-        return cg_get_attribute_as_uint64("memory", crt->cgroup_path, file, ret);
+        return unit_cgroup_get_attribute_as_uint64(u, "memory", file, ret);
 }
 
 static int unit_compare_memory_limit(Unit *u, const char *property_name, uint64_t *ret_unit_value, uint64_t *ret_kernel_value) {
@@ -1543,7 +1682,7 @@ static void cgroup_apply_unified_cpu_idle(Unit *u, uint64_t weight) {
 
         is_idle = weight == CGROUP_WEIGHT_IDLE;
         idle_val = one_zero(is_idle);
-        r = cg_set_attribute("cpu", crt->cgroup_path, "cpu.idle", idle_val);
+        r = unit_cgroup_set_attribute(u, "cpu", "cpu.idle", idle_val);
         if (r < 0 && (r != -ENOENT || is_idle))
                 log_unit_full_errno(u, LOG_LEVEL_CGROUP_WRITE(r), r, "Failed to set '%s' attribute on '%s' to '%s': %m",
                                     "cpu.idle", empty_to_root(crt->cgroup_path), idle_val);
@@ -1687,7 +1826,7 @@ static int set_bfq_weight(Unit *u, const char *controller, dev_t dev, uint64_t i
         else
                 xsprintf(buf, "%" PRIu64 "\n", bfq_weight);
 
-        r = cg_set_attribute(controller, crt->cgroup_path, p, buf);
+        r = unit_cgroup_set_attribute(u, controller, p, buf);
 
         /* FIXME: drop this when kernels prior
          * 795fe54c2a82 ("bfq: Add per-device weight") v5.4
@@ -1723,7 +1862,7 @@ static void cgroup_apply_io_device_weight(Unit *u, const char *dev_path, uint64_
         r1 = set_bfq_weight(u, "io", dev, io_weight);
 
         xsprintf(buf, DEVNUM_FORMAT_STR " %" PRIu64 "\n", DEVNUM_FORMAT_VAL(dev), io_weight);
-        r2 = cg_set_attribute("io", crt->cgroup_path, "io.weight", buf);
+        r2 = unit_cgroup_set_attribute(u, "io", "io.weight", buf);
 
         /* Look at the configured device, when both fail, prefer io.weight errno. */
         r = r2 == -EOPNOTSUPP ? r1 : r2;
@@ -1963,6 +2102,8 @@ static int cgroup_apply_devices(Unit *u) {
         }
 
         r = bpf_devices_apply_policy(&prog, policy, any, crt->cgroup_path, &crt->bpf_device_control_installed);
+        if (r > 0)
+                u->manager->n_cgroup_attribute_writes_skipped++;
         if (r < 0) {
                 static bool warned = false;
 
@@ -2858,7 +2999,6 @@ static int unit_update_cgroup(
 
         bool created, is_root_slice;
         CGroupMask migrate_mask = 0;
-        _cleanup_free_ char *cgroup_full_path = NULL;
         int r;
 
         assert(u);
@@ -2882,17 +3022,22 @@ static int unit_update_cgroup(
                 return log_unit_error_errno(u, r, "Failed to create cgroup %s: %m", empty_to_root(crt->cgroup_path));
         created = r;
 
+        /* A cgroup created anew is a different directory than the one we might have kept open */
+        if (created)
+                crt->cgroup_fd = safe_close(crt->cgroup_fd);
+
         if (cg_unified_controller(SYSTEMD_CGROUP_CONTROLLER) > 0) {
                 uint64_t cgroup_id = 0;
+                int fd;
 
-                r = cg_get_path(SYSTEMD_CGROUP_CONTROLLER, crt->cgroup_path, NULL, &cgroup_full_path);
-                if (r == 0) {
-                        r = cg_path_get_cgroupid(cgroup_full_path, &cgroup_id);
+                fd = unit_get_cgroup_fd(u, /* attributes = */ false);
+                if (fd >= 0) {
+                        r = cg_fd_get_cgroupid(fd, &cgroup_id);
                         if (r < 0)
                                 log_unit_full_errno(u, ERRNO_IS_NOT_SUPPORTED(r) ? LOG_DEBUG : LOG_WARNING, r,
-                                                    "Failed to get cgroup ID of cgroup %s, ignoring: %m", cgroup_full_path);
+                                                    "Failed to get cgroup ID of cgroup %s, ignoring: %m", empty_to_root(crt->cgroup_path));
                 } else
-                        log_unit_warning_errno(u, r, "Failed to get full cgroup path on cgroup %s, ignoring: %m", empty_to_root(crt->cgroup_path));
+                        log_unit_warning_errno(u, fd, "Failed to open cgroup %s, ignoring: %m", empty_to_root(crt->cgroup_path));
 
                 crt->cgroup_id = cgroup_id;
         }
@@ -2917,6 +3062,11 @@ static int unit_update_cgroup(
                 migrate_mask = crt->cgroup_realized_mask ^ target_mask;
         }
 
+        /* A new cgroup, or one which gained or lost controllers, has the kernel's defaults set in the
+         * affected attributes, hence forget what we wrote before. */
+        if (created || !crt->cgroup_realized || crt->cgroup_realized_mask != target_mask)
+                hashmap_clear(crt->cgroup_attributes);
+
         /* Keep track that this is now realized */
         crt->cgroup_realized = true;
         crt->cgroup_realized_mask = target_mask;
@@ -3378,12 +3528,17 @@ static int unit_realize_cgroup_now(Unit *u, ManagerState state) {
 unsigned manager_dispatch_cgroup_realize_queue(Manager *m) {
         ManagerState state;
         unsigned n = 0;
+        usec_t ts;
         Unit *i;
         int r;
 
         assert(m);
 
+        if (!m->cgroup_realize_queue)
+                return 0;
+
         state = manager_state(m);
+        ts = manager_phase_start(m, MANAGER_PHASE_CGROUP_REALIZE);
 
         while ((i = m->cgroup_realize_queue)) {
                 assert(i->in_cgroup_realize_queue);
@@ -3401,6 +3556,8 @@ unsigned manager_dispatch_cgroup_realize_queue(Manager *m) {
                 n++;
         }
 
+        manager_phase_finish(m, MANAGER_PHASE_CGROUP_REALIZE, ts);
+
         return n;
 }
 
@@ -3460,6 +3617,8 @@ void unit_add_family_to_cgroup_realize_queue(Unit *u) {
 
 int unit_realize_cgroup(Unit *u) {
         Unit *slice;
+        usec_t ts;
+        int r;
 
         assert(u);
 
@@ -3480,7 +3639,11 @@ int unit_realize_cgroup(Unit *u) {
                 unit_add_family_to_cgroup_realize_queue(slice);
 
         /* And realize this one now (and apply the values) */
-        return unit_realize_cgroup_now(u, manager_state(u->manager));
+        ts = manager_phase_start(u->manager, MANAGER_PHASE_CGROUP_REALIZE);
+        r = unit_realize_cgroup_now(u, manager_state(u->manager));
+        manager_phase_finish(u->manager, MANAGER_PHASE_CGROUP_REALIZE, ts);
+
+        return r;
 }
 
 void unit_release_cgroup(Unit *u) {
@@ -3528,7 +3691,12 @@ int unit_cgroup_is_empty(Unit *u) {
         if (!crt->cgroup_path)
                 return -EOWNERDEAD;
 
-        r = cg_is_empty_recursive(SYSTEMD_CGROUP_CONTROLLER, crt->cgroup_path);
+        /* The root cgroup has no cgroup.events, and is always populated, let cg_is_empty_recursive() handle it */
+        int fd = empty_or_root(crt->cgroup_path) ? -EBADF : unit_get_cgroup_fd(u, /* attributes = */ false);
+        if (fd >= 0)
+                r = cg_is_empty_recursive_at(fd);
+        else
+                r = cg_is_empty_recursive(SYSTEMD_CGROUP_CONTROLLER, crt->cgroup_path);
         if (r < 0)
                 return log_unit_debug_errno(u, r, "Failed to determine whether cgroup %s is empty, ignoring: %m", empty_to_root(crt->cgroup_path));
 
@@ -3604,6 +3772,9 @@ void unit_prune_cgroup(Unit *u) {
         crt->cgroup_realized = false;
         crt->cgroup_realized_mask = 0;
         crt->cgroup_enabled_mask = 0;
+        crt->cgroup_fd = safe_close(crt->cgroup_fd);
+
+        hashmap_clear(crt->cgroup_attributes);
 
         crt->bpf_device_control_installed = bpf_program_free(crt->bpf_device_control_installed);
 }
@@ -3620,7 +3791,11 @@ int unit_search_main_pid(Unit *u, PidRef *ret) {
         if (!crt || !crt->cgroup_path)
                 return -ENXIO;
 
-        r = cg_enumerate_processes(SYSTEMD_CGROUP_CONTROLLER, crt->cgroup_path, &f);
+        int fd = unit_get_cgroup_fd(u, /* attributes = */ false);
+        if (fd >= 0)
+                r = cg_enumerate_processes_at(fd, &f);
+        else
+                r = cg_enumerate_processes(SYSTEMD_CGROUP_CONTROLLER, crt->cgroup_path, &f);
         if (r < 0)
                 return r;
 
@@ -3760,18 +3935,36 @@ int unit_watch_all_pids(Unit *u) {
 
 static int on_cgroup_empty_event(sd_event_source *s, void *userdata) {
         Manager *m = ASSERT_PTR(userdata);
+        usec_t deadline;
         Unit *u;
         int r;
 
         assert(s);
 
-        u = m->cgroup_empty_queue;
-        if (!u)
-                return 0;
+        /* Process the units in the order their cgroups ran empty, i.e. starting from the tail of the queue,
+         * and as many of them as we can in our time budget: when thousands of scopes exit at once, handling
+         * one per event loop iteration would take forever, handling all of them at once would block
+         * everything else for too long. */
+        deadline = usec_add(now(CLOCK_MONOTONIC), CGROUP_EMPTY_BUDGET_USEC);
 
-        assert(u->in_cgroup_empty_queue);
-        u->in_cgroup_empty_queue = false;
-        LIST_REMOVE(cgroup_empty_queue, m->cgroup_empty_queue, u);
+        while ((u = m->cgroup_empty_queue_tail)) {
+                assert(u->in_cgroup_empty_queue);
+                unit_remove_from_cgroup_empty_queue(u);
+
+                /* Update state based on OOM kills before we notify about cgroup empty event */
+                (void) unit_check_oom(u);
+                (void) unit_check_oomd_kill(u);
+
+                unit_add_to_gc_queue(u);
+
+                if (IN_SET(unit_active_state(u), UNIT_INACTIVE, UNIT_FAILED))
+                        unit_prune_cgroup(u);
+                else if (UNIT_VTABLE(u)->notify_cgroup_empty)
+                        UNIT_VTABLE(u)->notify_cgroup_empty(u);
+
+                if (now(CLOCK_MONOTONIC) >= deadline)
+                        break;
+        }
 
         if (m->cgroup_empty_queue) {
                 /* More stuff queued, let's make sure we remain enabled */
@@ -3780,18 +3973,27 @@ static int on_cgroup_empty_event(sd_event_source *s, void *userdata) {
                         log_debug_errno(r, "Failed to reenable cgroup empty event source, ignoring: %m");
         }
 
-        /* Update state based on OOM kills before we notify about cgroup empty event */
-        (void) unit_check_oom(u);
-        (void) unit_check_oomd_kill(u);
+        return 0;
+}
 
-        unit_add_to_gc_queue(u);
+static void unit_enqueue_cgroup_empty(Unit *u) {
+        int r;
 
-        if (IN_SET(unit_active_state(u), UNIT_INACTIVE, UNIT_FAILED))
-                unit_prune_cgroup(u);
-        else if (UNIT_VTABLE(u)->notify_cgroup_empty)
-                UNIT_VTABLE(u)->notify_cgroup_empty(u);
+        assert(u);
 
-        return 0;
+        if (u->in_cgroup_empty_queue)
+                return;
+
+        /* New entries are added at the head, and dispatched from the tail */
+        LIST_PREPEND(cgroup_empty_queue, u->manager->cgroup_empty_queue, u);
+        if (!u->manager->cgroup_empty_queue_tail)
+                u->manager->cgroup_empty_queue_tail = u;
+        u->in_cgroup_empty_queue = true;
+
+        /* Trigger the defer event */
+        r = sd_event_source_set_enabled(u->manager->cgroup_empty_event_source, SD_EVENT_ONESHOT);
+        if (r < 0)
+                log_debug_errno(r, "Failed to enable cgroup empty event source: %m");
 }
 
 void unit_add_to_cgroup_empty_queue(Unit *u) {
@@ -3824,21 +4026,18 @@ void unit_add_to_cgroup_empty_queue(Unit *u) {
         if (r <= 0)
                 return;
 
-        LIST_PREPEND(cgroup_empty_queue, u->manager->cgroup_empty_queue, u);
-        u->in_cgroup_empty_queue = true;
-
-        /* Trigger the defer event */
-        r = sd_event_source_set_enabled(u->manager->cgroup_empty_event_source, SD_EVENT_ONESHOT);
-        if (r < 0)
-                log_debug_errno(r, "Failed to enable cgroup empty event source: %m");
+        unit_enqueue_cgroup_empty(u);
 }
 
-static void unit_remove_from_cgroup_empty_queue(Unit *u) {
+void unit_remove_from_cgroup_empty_queue(Unit *u) {
         assert(u);
 
         if (!u->in_cgroup_empty_queue)
                 return;
 
+        if (u->manager->cgroup_empty_queue_tail == u)
+                u->manager->cgroup_empty_queue_tail = u->cgroup_empty_queue_prev;
+
         LIST_REMOVE(cgroup_empty_queue, u->manager->cgroup_empty_queue, u);
         u->in_cgroup_empty_queue = false;
 }
@@ -3910,12 +4109,13 @@ int unit_check_oom(Unit *u) {
         if (!crt || !crt->cgroup_path)
                 return 0;
 
-        r = cg_get_keyed_attribute(
+        r = unit_cgroup_get_keyed_attribute(
+                        u,
                         "memory",
-                        crt->cgroup_path,
                         "memory.events",
                         STRV_MAKE("oom_kill"),
-                        &oom_kill);
+                        &oom_kill,
+                        /* mode = */ 0);
         if (IN_SET(r, -ENOENT, -ENXIO)) /* Handle gracefully if cgroup or oom_kill attribute don't exist */
                 c = 0;
         else if (r < 0)
@@ -4020,12 +4220,13 @@ static int unit_check_cgroup_events(Unit *u) {
         if (!crt || !crt->cgroup_path)
                 return 0;
 
-        r = cg_get_keyed_attribute_graceful(
+        r = unit_cgroup_get_keyed_attribute(
+                        u,
                         SYSTEMD_CGROUP_CONTROLLER,
-                        crt->cgroup_path,
                         "cgroup.events",
                         STRV_MAKE("populated", "frozen"),
-                        values);
+                        values,
+                        CG_KEY_MODE_GRACEFUL);
         if (r < 0)
                 return r;
 
@@ -4036,7 +4237,8 @@ static int unit_check_cgroup_events(Unit *u) {
                 if (streq(values[0], "1"))
                         unit_remove_from_cgroup_empty_queue(u);
                 else
-                        unit_add_to_cgroup_empty_queue(u);
+                        /* We just read that the cgroup is not populated, no need to verify that again */
+                        unit_enqueue_cgroup_empty(u);
         }
 
         /* Disregard freezer state changes due to operations not initiated by us.
@@ -4062,8 +4264,10 @@ static int on_cgroup_inotify_event(sd_event_source *s, int fd, uint32_t revents,
         assert(fd >= 0);
 
         for (;;) {
+                _cleanup_set_free_ Set *units = NULL;
                 union inotify_event_buffer buffer;
                 ssize_t l;
+                Unit *u;
 
                 l = read(fd, &buffer, sizeof(buffer));
                 if (l < 0) {
@@ -4074,7 +4278,6 @@ static int on_cgroup_inotify_event(sd_event_source *s, int fd, uint32_t revents,
                 }
 
                 FOREACH_INOTIFY_EVENT_WARN(e, buffer, l) {
-                        Unit *u;
 
                         if (e->wd < 0)
                                 /* Queue overflow has no watch descriptor */
@@ -4087,14 +4290,20 @@ static int on_cgroup_inotify_event(sd_event_source *s, int fd, uint32_t revents,
                         /* Note that inotify might deliver events for a watch even after it was removed,
                          * because it was queued before the removal. Let's ignore this here safely. */
 
+                        /* A cgroup.events file is typically modified multiple times in a row (e.g. when
+                         * the last process of a scope exits), hence only read it once per batch of
+                         * events. */
                         u = hashmap_get(m->cgroup_control_inotify_wd_unit, INT_TO_PTR(e->wd));
-                        if (u)
+                        if (u && set_ensure_put(&units, NULL, u) < 0)
                                 unit_check_cgroup_events(u);
 
                         u = hashmap_get(m->cgroup_memory_inotify_wd_unit, INT_TO_PTR(e->wd));
                         if (u)
                                 unit_add_to_cgroup_oom_queue(u);
                 }
+
+                SET_FOREACH(u, units)
+                        unit_check_cgroup_events(u);
         }
 }
 
@@ -4503,7 +4712,7 @@ int unit_get_memory_current(Unit *u, uint64_t *ret) {
         if (r < 0)
                 return r;
 
-        return cg_get_attribute_as_uint64("memory", crt->cgroup_path, r > 0 ? "memory.current" : "memory.usage_in_bytes", ret);
+        return unit_cgroup_get_attribute_as_uint64(u, "memory", r > 0 ? "memory.current" : "memory.usage_in_bytes", ret);
 }
 
 int unit_get_memory_accounting(Unit *u, CGroupMemoryAccountingMetric metric, uint64_t *ret) {
@@ -4546,7 +4755,7 @@ int unit_get_memory_accounting(Unit *u, CGroupMemoryAccountingMetric metric, uin
         if (r == 0)
                 return -ENODATA;
 
-        r = cg_get_attribute_as_uint64("memory", crt->cgroup_path, attributes_table[metric], &bytes);
+        r = unit_cgroup_get_attribute_as_uint64(u, "memory", attributes_table[metric], &bytes);
         if (r < 0 && r != -ENODATA)
                 return r;
         updated = r >= 0;
@@ -4589,7 +4798,7 @@ int unit_get_tasks_current(Unit *u, uint64_t *ret) {
         if ((crt->cgroup_realized_mask & CGROUP_MASK_PIDS) == 0)
                 return -ENODATA;
 
-        return cg_get_attribute_as_uint64("pids", crt->cgroup_path, "pids.current", ret);
+        return unit_cgroup_get_attribute_as_uint64(u, "pids", "pids.current", ret);
 }
 
 static int unit_get_cpu_usage_raw(Unit *u, nsec_t *ret) {
@@ -4618,7 +4827,7 @@ static int unit_get_cpu_usage_raw(Unit *u, nsec_t *ret) {
                 _cleanup_free_ char *val = NULL;
                 uint64_t us;
 
-                r = cg_get_keyed_attribute("cpu", crt->cgroup_path, "cpu.stat", STRV_MAKE("usage_usec"), &val);
+                r = unit_cgroup_get_keyed_attribute(u, "cpu", "cpu.stat", STRV_MAKE("usage_usec"), &val, /* mode = */ 0);
                 if (IN_SET(r, -ENOENT, -ENXIO))
                         return -ENODATA;
                 if (r < 0)
@@ -5220,6 +5429,7 @@ CGroupRuntime *cgroup_runtime_new(void) {
         *crt = (CGroupRuntime) {
                 .cpu_usage_last = NSEC_INFINITY,
 
+                .cgroup_fd = -EBADF,
                 .cgroup_control_inotify_wd = -1,
                 .cgroup_memory_inotify_wd = -1,
 
@@ -5256,6 +5466,7 @@ CGroupRuntime *cgroup_runtime_free(CGroupRuntime *crt) {
         bpf_link_free(crt->ipv6_socket_bind_link);
 #endif
         hashmap_free(crt->bpf_foreign_by_key);
+        hashmap_free(crt->cgroup_attributes);
 
         bpf_program_free(crt->bpf_device_control_installed);
 
@@ -5270,6 +5481,8 @@ CGroupRuntime *cgroup_runtime_free(CGroupRuntime *crt) {
         safe_close(crt->ipv4_deny_map_fd);
         safe_close(crt->ipv6_deny_map_fd);
 
+        safe_close(crt->cgroup_fd);
+
         bpf_program_free(crt->ip_bpf_ingress);
         bpf_program_free(crt->ip_bpf_ingress_installed);
         bpf_program_free(crt->ip_bpf_egress);
@@ -318,6 +318,7 @@ typedef struct CGroupRuntime {
         /* Counterparts in the cgroup filesystem */
         char *cgroup_path;
         uint64_t cgroup_id;
+        int cgroup_fd;                             /* Directory of the cgroup on the unified hierarchy, opened on first use, to access it without path lookups */
         CGroupMask cgroup_realized_mask;           /* In which hierarchies does this unit's cgroup exist? (only relevant on cgroup v1) */
         CGroupMask cgroup_enabled_mask;            /* Which controllers are enabled (or more correctly: enabled for the children) for this unit's cgroup? (only relevant on cgroup v2) */
         CGroupMask cgroup_invalidated_mask;        /* A mask specifying controllers which shall be considered invalidated, and require re-realization */
@@ -327,6 +328,11 @@ typedef struct CGroupRuntime {
         int cgroup_control_inotify_wd;
         int cgroup_memory_inotify_wd;
 
+        /* The values we last successfully wrote to the cgroup's attributes, attribute name → value. Flushed
+         * whenever the cgroup is created anew or its set of controllers changes, since the kernel resets
+         * the attributes then. */
+        Hashmap *cgroup_attributes;
+
         /* Device Controller BPF program */
         BPFProgram *bpf_device_control_installed;
 
@@ -455,6 +461,7 @@ void unit_release_cgroup(Unit *u);
 bool unit_maybe_release_cgroup(Unit *u);
 
 void unit_add_to_cgroup_empty_queue(Unit *u);
+void unit_remove_from_cgroup_empty_queue(Unit *u);
 int unit_check_oomd_kill(Unit *u);
 int unit_check_oom(Unit *u);
 
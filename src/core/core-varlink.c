@@ -8,6 +8,8 @@
 #include "varlink.h"
 #include "varlink-io.systemd.UserDatabase.h"
 #include "varlink-io.systemd.ManagedOOM.h"
+#include "varlink-io.systemd.Manager.h"
+#include "varlink-io.systemd.service.h"
 
 typedef struct LookupParameters {
         const char *user_name;
@@ -489,6 +491,132 @@ static int vl_method_get_memberships(Varlink *link, sd_json_variant *parameters,
         return varlink_error(link, "io.systemd.UserDatabase.NoRecordFound", NULL);
 }
 
+static bool unit_changed_since(Unit *u, usec_t since) {
+        assert(u);
+
+        return u->inactive_exit_timestamp.monotonic >= since ||
+                u->active_enter_timestamp.monotonic >= since ||
+                u->active_exit_timestamp.monotonic >= since ||
+                u->inactive_enter_timestamp.monotonic >= since;
+}
+
+static int list_unit_times_one(Varlink *link, Unit *u, bool more) {
+        /* The dependency types systemd-analyze needs to draw its output */
+        static const UnitDependency dependencies[] = {
+                UNIT_AFTER,
+                UNIT_BEFORE,
+                UNIT_REQUIRES,
+                UNIT_REQUISITE,
+                UNIT_WANTS,
+                UNIT_CONFLICTS,
+                UNIT_UPHOLDS,
+        };
+
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        int r;
+
+        assert(link);
+        assert(u);
+
+        r = sd_json_buildo(
+                        &v,
+                        SD_JSON_BUILD_PAIR_STRING("Id", u->id),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("InactiveExitTimestampMonotonic", u->inactive_exit_timestamp.monotonic),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("ActiveEnterTimestampMonotonic", u->active_enter_timestamp.monotonic),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("ActiveExitTimestampMonotonic", u->active_exit_timestamp.monotonic),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("InactiveEnterTimestampMonotonic", u->inactive_enter_timestamp.monotonic));
+        if (r < 0)
+                return r;
+
+        FOREACH_ELEMENT(d, dependencies) {
+                _cleanup_(sd_json_variant_unrefp) sd_json_variant *a = NULL;
+                Unit *other;
+
+                UNIT_FOREACH_DEPENDENCY_OF_TYPE(other, NULL, u, *d) {
+                        r = sd_json_variant_append_arrayb(&a, SD_JSON_BUILD_STRING(other->id));
+                        if (r < 0)
+                                return r;
+                }
+
+                if (!a)
+                        continue;
+
+                r = sd_json_variant_set_field(&v, unit_dependency_to_string(*d), a);
+                if (r < 0)
+                        return r;
+        }
+
+        if (more)
+                return varlink_notify(link, v);
+
+        return varlink_reply(link, v);
+}
+
+static int vl_method_list_unit_times(Varlink *link, sd_json_variant *parameters, VarlinkMethodFlags flags, void *userdata) {
+
+        static const sd_json_dispatch_field dispatch_table[] = {
+                { "since", SD_JSON_VARIANT_STRING, sd_json_dispatch_const_string, 0, 0 },
+                {}
+        };
+
+        Manager *m = ASSERT_PTR(userdata);
+        const char *since_name = NULL;
+        usec_t since = 0;
+        Unit *u, *previous = NULL;
+        const char *k;
+        int r;
+
+        assert(parameters);
+
+        r = varlink_dispatch(link, parameters, dispatch_table, &since_name);
+        if (r != 0)
+                return r;
+
+        if (since_name) {
+                ManagerTimestamp t;
+
+                t = manager_timestamp_from_string(since_name);
+                if (t < 0)
+                        return varlink_error_invalid_parameter_name(link, "since");
+
+                /* A phase that wasn't reached yet means nothing happened since */
+                if (!dual_timestamp_is_set(m->timestamps + t))
+                        return varlink_error(link, "io.systemd.Manager.NoMatchingUnits", NULL);
+
+                since = m->timestamps[t].monotonic;
+        }
+
+        if (!FLAGS_SET(flags, VARLINK_METHOD_MORE))
+                return varlink_error(link, VARLINK_ERROR_EXPECTED_MORE, NULL);
+
+        /* One reply per unit so that the individual messages stay small even with many thousands of units
+         * and their dependencies. Units that were never started carry no timing information, and are
+         * skipped, the same way systemd-analyze would ignore them. */
+        HASHMAP_FOREACH_KEY(u, k, m->units) {
+                if (k != u->id) /* skip aliases */
+                        continue;
+
+                if (!dual_timestamp_is_set(&u->inactive_exit_timestamp))
+                        continue;
+
+                if (since > 0 && !unit_changed_since(u, since))
+                        continue;
+
+                if (previous) {
+                        r = list_unit_times_one(link, previous, /* more= */ true);
+                        if (r < 0)
+                                return r;
+                }
+
+                previous = u;
+        }
+
+        if (previous)
+                return list_unit_times_one(link, previous, /* more= */ false);
+
+        return varlink_error(link, "io.systemd.Manager.NoMatchingUnits", NULL);
+}
+
 static void vl_disconnect(VarlinkServer *s, Varlink *link, void *userdata) {
         Manager *m = ASSERT_PTR(userdata);
 
@@ -515,7 +643,9 @@ static int manager_setup_varlink_server(Manager *m, VarlinkServer **ret) {
         r = varlink_server_add_interface_many(
                         s,
                         &vl_interface_io_systemd_UserDatabase,
-                        &vl_interface_io_systemd_ManagedOOM);
+                        &vl_interface_io_systemd_ManagedOOM,
+                        &vl_interface_io_systemd_Manager,
+                        &vl_interface_io_systemd_service);
         if (r < 0)
                 return log_debug_errno(r, "Failed to add interfaces to varlink server: %m");
 
@@ -524,7 +654,12 @@ static int manager_setup_varlink_server(Manager *m, VarlinkServer **ret) {
                         "io.systemd.UserDatabase.GetUserRecord",  vl_method_get_user_record,
                         "io.systemd.UserDatabase.GetGroupRecord", vl_method_get_group_record,
                         "io.systemd.UserDatabase.GetMemberships", vl_method_get_memberships,
-                        "io.systemd.ManagedOOM.SubscribeManagedOOMCGroups", vl_method_subscribe_managed_oom_cgroups);
+                        "io.systemd.ManagedOOM.SubscribeManagedOOMCGroups", vl_method_subscribe_managed_oom_cgroups,
+                        "io.systemd.Manager.ListUnitTimes", vl_method_list_unit_times,
+                        "io.systemd.service.SetEventLoopStatistics", varlink_method_set_event_loop_statistics,
+                        "io.systemd.service.GetEventLoopStatistics", varlink_method_get_event_loop_statistics,
+                        "io.systemd.service.SetVarlinkStatistics", varlink_method_set_varlink_statistics,
+                        "io.systemd.service.GetVarlinkStatistics", varlink_method_get_varlink_statistics);
         if (r < 0)
                 return log_debug_errno(r, "Failed to register varlink methods: %m");
 
@@ -555,7 +690,10 @@ static int manager_varlink_init_system(Manager *m) {
         if (!MANAGER_IS_TEST_RUN(m)) {
                 (void) mkdir_p_label("/run/systemd/userdb", 0755);
 
-                FOREACH_STRING(address, "/run/systemd/userdb/io.systemd.DynamicUser", VARLINK_ADDR_PATH_MANAGED_OOM_SYSTEM) {
+                FOREACH_STRING(address,
+                               "/run/systemd/userdb/io.systemd.DynamicUser",
+                               VARLINK_ADDR_PATH_MANAGED_OOM_SYSTEM,
+                               VARLINK_ADDR_PATH_MANAGER_SYSTEM) {
                         if (MANAGER_IS_RELOADING(m)) {
                                 /* If manager is reloading, we skip listening on existing addresses, since
                                  * the fd should be acquired later through deserialization. */
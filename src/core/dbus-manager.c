@@ -11,6 +11,8 @@
 #include "bus-common-errors.h"
 #include "bus-get-properties.h"
 #include "bus-log-control-api.h"
+#include "bus-message.h"
+#include "bus-objects.h"
 #include "bus-util.h"
 #include "chase.h"
 #include "confidential-virt.h"
@@ -27,6 +29,7 @@
 #include "fd-util.h"
 #include "fileio.h"
 #include "format-util.h"
+#include "glob-util.h"
 #include "initrd-util.h"
 #include "install.h"
 #include "log.h"
@@ -36,6 +39,7 @@
 #include "path-util.h"
 #include "process-util.h"
 #include "selinux-access.h"
+#include "sort-util.h"
 #include "stat-util.h"
 #include "string-util.h"
 #include "strv.h"
@@ -230,6 +234,96 @@ static int property_get_environment(
         return sd_bus_message_append_strv(reply, l);
 }
 
+static int property_get_phases(
+                sd_bus *bus,
+                const char *path,
+                const char *interface,
+                const char *property,
+                sd_bus_message *reply,
+                void *userdata,
+                sd_bus_error *error) {
+
+        Manager *m = ASSERT_PTR(userdata);
+        int r;
+
+        assert(bus);
+        assert(reply);
+
+        r = sd_bus_message_open_container(reply, 'a', "(stttt)");
+        if (r < 0)
+                return r;
+
+        for (ManagerPhase p = 0; p < _MANAGER_PHASE_MAX; p++) {
+                const ManagerPhaseStatistics *s = m->phases + p;
+
+                r = sd_bus_message_append(reply, "(stttt)",
+                                          manager_phase_to_string(p),
+                                          s->first_start,
+                                          s->last_finish,
+                                          s->total_usec,
+                                          s->n_runs);
+                if (r < 0)
+                        return r;
+        }
+
+        return sd_bus_message_close_container(reply);
+}
+
+static int property_get_generators(
+                sd_bus *bus,
+                const char *path,
+                const char *interface,
+                const char *property,
+                sd_bus_message *reply,
+                void *userdata,
+                sd_bus_error *error) {
+
+        Manager *m = ASSERT_PTR(userdata);
+        int r;
+
+        assert(bus);
+        assert(reply);
+
+        r = sd_bus_message_open_container(reply, 'a', "(sttib)");
+        if (r < 0)
+                return r;
+
+        FOREACH_ARRAY(i, m->generator_results, m->n_generator_results) {
+                r = sd_bus_message_append(reply, "(sttib)",
+                                          i->name,
+                                          i->start,
+                                          i->duration,
+                                          i->exit_status,
+                                          i->reused);
+                if (r < 0)
+                        return r;
+        }
+
+        return sd_bus_message_close_container(reply);
+}
+
+static int property_get_counters(
+                sd_bus *bus,
+                const char *path,
+                const char *interface,
+                const char *property,
+                sd_bus_message *reply,
+                void *userdata,
+                sd_bus_error *error) {
+
+        Manager *m = ASSERT_PTR(userdata);
+
+        assert(bus);
+        assert(reply);
+
+        return sd_bus_message_append(reply, "a(st)", 5,
+                                     "units-loaded", (uint64_t) m->load_statistics.n_loaded,
+                                     "unit-files-parsed", (uint64_t) m->load_statistics.n_files_parsed,
+                                     "jobs-installed", (uint64_t) m->n_installed_jobs,
+                                     "cgroup-attribute-writes", m->n_cgroup_attribute_writes,
+                                     "cgroup-attribute-writes-skipped", m->n_cgroup_attribute_writes_skipped);
+}
+
 static int property_get_show_status(
                 sd_bus *bus,
                 const char *path,
@@ -954,6 +1048,11 @@ static int method_get_unit_processes(sd_bus_message *message, void *userdata, sd
         return method_generic_unit_operation(message, userdata, error, bus_unit_method_get_processes, /* flags = */ 0);
 }
 
+static int method_get_unit_processes_with_limit(sd_bus_message *message, void *userdata, sd_bus_error *error) {
+        /* Same as above */
+        return method_generic_unit_operation(message, userdata, error, bus_unit_method_get_processes_with_limit, /* flags = */ 0);
+}
+
 static int method_attach_processes_to_unit(sd_bus_message *message, void *userdata, sd_bus_error *error) {
         /* Don't allow attaching new processes to units that aren't loaded. Don't bother with loading a unit
          * for this purpose though, as an unloaded unit is a stopped unit, and we don't allow attaching
@@ -1100,6 +1199,159 @@ static int method_start_transient_unit(sd_bus_message *message, void *userdata,
         return bus_unit_queue_job(message, u, JOB_START, mode, 0, error);
 }
 
+static int bus_message_unwind_containers(sd_bus_message *message, size_t n_containers) {
+        int r;
+
+        assert(message);
+
+        /* Skips whatever is left unread of the containers entered beyond the specified depth, and leaves
+         * them. Used to continue with the next element after processing failed half-way through one. */
+
+        while (message->n_containers > n_containers) {
+                while ((r = sd_bus_message_at_end(message, /* complete= */ false)) == 0) {
+                        r = sd_bus_message_skip(message, NULL);
+                        if (r < 0)
+                                return r;
+                }
+                if (r < 0)
+                        return r;
+
+                r = sd_bus_message_exit_container(message);
+                if (r < 0)
+                        return r;
+        }
+
+        return 0;
+}
+
+static int start_transient_unit_one(
+                Manager *m,
+                sd_bus_message *message,
+                const char *name,
+                JobMode mode,
+                sd_bus_message *reply,
+                sd_bus_error *error) {
+
+        Unit *u;
+        int r;
+
+        assert(m);
+        assert(message);
+        assert(name);
+        assert(reply);
+
+        r = transient_unit_from_message(m, message, name, &u, error);
+        if (r < 0)
+                return r;
+
+        r = transient_aux_units_from_message(m, message, error);
+        if (r < 0)
+                return r;
+
+        return bus_unit_queue_job_one(message, u, JOB_START, mode, /* flags= */ 0, reply, error);
+}
+
+static int method_start_transient_units(sd_bus_message *message, void *userdata, sd_bus_error *error) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        Manager *m = ASSERT_PTR(userdata);
+        size_t n_containers;
+        const char *smode;
+        JobMode mode;
+        int r;
+
+        assert(message);
+
+        /* Like StartTransientUnit(), but for many units at once. Checks access only once, and reports
+         * failures for each unit in the reply rather than failing the whole call, unless we run out of
+         * resources. */
+
+        r = mac_selinux_access_check(message, "start", error);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_read(message, "s", &smode);
+        if (r < 0)
+                return r;
+
+        mode = job_mode_from_string(smode);
+        if (mode < 0)
+                return sd_bus_error_setf(error, SD_BUS_ERROR_INVALID_ARGS, "Job mode %s is invalid.", smode);
+
+        r = bus_verify_manage_units_async(m, message, error);
+        if (r < 0)
+                return r;
+        if (r == 0)
+                return 1; /* No authorization for now, but the async polkit stuff will call us again when it has it */
+
+        r = sd_bus_message_new_method_return(message, &reply);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_open_container(reply, 'a', "(soss)");
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_enter_container(message, 'a', "(sa(sv)a(sa(sv)))");
+        if (r < 0)
+                return r;
+
+        n_containers = message->n_containers;
+
+        while ((r = sd_bus_message_enter_container(message, 'r', "sa(sv)a(sa(sv))")) > 0) {
+                _cleanup_(sd_bus_error_free) sd_bus_error e = SD_BUS_ERROR_NULL;
+                const char *name;
+
+                r = sd_bus_message_read(message, "s", &name);
+                if (r < 0)
+                        return r;
+
+                r = sd_bus_message_open_container(reply, 'r', "soss");
+                if (r < 0)
+                        return r;
+
+                r = sd_bus_message_append(reply, "s", name);
+                if (r < 0)
+                        return r;
+
+                /* On success this appends the job path to the reply */
+                r = start_transient_unit_one(m, message, name, mode, reply, &e);
+                if (ERRNO_IS_NEG_RESOURCE(r))
+                        return r;
+                if (r < 0) {
+                        if (!sd_bus_error_is_set(&e))
+                                (void) sd_bus_error_set_errno(&e, r);
+
+                        log_debug("Failed to start transient unit %s: %s", name, bus_error_message(&e, r));
+
+                        r = sd_bus_message_append(reply, "oss", "/", e.name, e.message);
+                } else
+                        r = sd_bus_message_append(reply, "ss", "", "");
+                if (r < 0)
+                        return r;
+
+                r = sd_bus_message_close_container(reply);
+                if (r < 0)
+                        return r;
+
+                /* Skip over whatever was left unparsed of this unit's specification */
+                r = bus_message_unwind_containers(message, n_containers);
+                if (r < 0)
+                        return r;
+        }
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_exit_container(message);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_close_container(reply);
+        if (r < 0)
+                return r;
+
+        return sd_bus_send(NULL, reply, NULL);
+}
+
 static int method_get_job(sd_bus_message *message, void *userdata, sd_bus_error *error) {
         _cleanup_free_ char *path = NULL;
         Manager *m = ASSERT_PTR(userdata);
@@ -1191,6 +1443,15 @@ static int method_reset_failed(sd_bus_message *message, void *userdata, sd_bus_e
         return sd_bus_reply_method_return(message, NULL);
 }
 
+static bool unit_matches_states(Unit *u, char **states) {
+        assert(u);
+
+        return strv_isempty(states) ||
+                strv_contains(states, unit_load_state_to_string(u->load_state)) ||
+                strv_contains(states, unit_active_state_to_string(unit_active_state(u))) ||
+                strv_contains(states, unit_sub_state_to_string(u));
+}
+
 static int list_units_filtered(sd_bus_message *message, void *userdata, sd_bus_error *error, char **states, char **patterns) {
         _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
         Manager *m = ASSERT_PTR(userdata);
@@ -1218,10 +1479,7 @@ static int list_units_filtered(sd_bus_message *message, void *userdata, sd_bus_e
                 if (k != u->id)
                         continue;
 
-                if (!strv_isempty(states) &&
-                    !strv_contains(states, unit_load_state_to_string(u->load_state)) &&
-                    !strv_contains(states, unit_active_state_to_string(unit_active_state(u))) &&
-                    !strv_contains(states, unit_sub_state_to_string(u)))
+                if (!unit_matches_states(u, states))
                         continue;
 
                 if (!strv_isempty(patterns) &&
@@ -1271,6 +1529,171 @@ static int method_list_units_by_patterns(sd_bus_message *message, void *userdata
         return list_units_filtered(message, userdata, error, states, patterns);
 }
 
+static int reply_unit_properties(
+                sd_bus_message *reply,
+                sd_bus_message *message,
+                const char *name,
+                Unit *u,
+                const Set *properties,
+                sd_bus_error *error) {
+
+        _cleanup_free_ char *path = NULL;
+        int r;
+
+        assert(reply);
+        assert(message);
+        assert(name);
+        assert(u);
+
+        /* Same check as for GetAll() on the unit object */
+        r = mac_selinux_unit_access_check(u, message, "status", error);
+        if (r < 0)
+                return r;
+
+        path = unit_dbus_path(u);
+        if (!path)
+                return -ENOMEM;
+
+        r = sd_bus_message_open_container(reply, 'r', "sa{sv}");
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_append(reply, "s", name);
+        if (r < 0)
+                return r;
+
+        r = bus_message_append_object_properties(sd_bus_message_get_bus(message), reply, path, properties, error);
+        if (r < 0)
+                return r;
+
+        return sd_bus_message_close_container(reply);
+}
+
+static int unit_compare_by_id(Unit * const *a, Unit * const *b) {
+        return strcmp((*a)->id, (*b)->id);
+}
+
+static int method_list_unit_properties_by_patterns(sd_bus_message *message, void *userdata, sd_bus_error *error) {
+        _cleanup_strv_free_ char **states = NULL, **patterns = NULL, **property_names = NULL;
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        _cleanup_set_free_ Set *properties = NULL, *seen = NULL;
+        Manager *m = ASSERT_PTR(userdata);
+        int r;
+
+        assert(message);
+
+        /* Returns the properties of many units at once, i.e. what a GetAll() call on each of them would
+         * return, or only the listed properties. Patterns that are unit names rather than globs are loaded
+         * like GetAll() would do it, and listed in the order they are specified in, under the name they are
+         * specified as, even if they refer to the same unit. Globs are matched against all loaded units,
+         * which are then listed in alphabetical order, unless they are already included. */
+
+        r = sd_bus_message_read_strv(message, &states);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_read_strv(message, &patterns);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_read_strv(message, &property_names);
+        if (r < 0)
+                return r;
+
+        /* Anyone can call this method */
+
+        r = mac_selinux_access_check(message, "status", error);
+        if (r < 0)
+                return r;
+
+        if (!strv_isempty(property_names)) {
+                /* The strings are borrowed from the strv */
+                properties = set_new(&string_hash_ops);
+                if (!properties)
+                        return -ENOMEM;
+
+                STRV_FOREACH(p, property_names) {
+                        r = set_put(properties, *p);
+                        if (r < 0)
+                                return r;
+                }
+        }
+
+        r = sd_bus_message_new_method_return(message, &reply);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_open_container(reply, 'a', "(sa{sv})");
+        if (r < 0)
+                return r;
+
+        STRV_FOREACH(pattern, strv_isempty(patterns) ? STRV_MAKE("*") : patterns) {
+                _cleanup_free_ Unit **units = NULL;
+                size_t n_units = 0;
+                const char *k;
+                Unit *u;
+
+                if (!string_is_glob(*pattern)) {
+                        if (!unit_name_is_valid(*pattern, UNIT_NAME_ANY))
+                                continue;
+
+                        r = bus_load_unit_by_name(m, message, *pattern, &u, error);
+                        if (r < 0)
+                                return r;
+
+                        if (!unit_matches_states(u, states))
+                                continue;
+
+                        r = set_ensure_put(&seen, NULL, u);
+                        if (r < 0)
+                                return r;
+
+                        r = reply_unit_properties(reply, message, *pattern, u, properties, error);
+                        if (r < 0)
+                                return r;
+
+                        continue;
+                }
+
+                HASHMAP_FOREACH_KEY(u, k, m->units) {
+                        if (k != u->id)
+                                continue;
+
+                        if (set_contains(seen, u))
+                                continue;
+
+                        if (!unit_matches_states(u, states))
+                                continue;
+
+                        if (fnmatch(*pattern, u->id, FNM_NOESCAPE) != 0)
+                                continue;
+
+                        if (!GREEDY_REALLOC(units, n_units + 1))
+                                return -ENOMEM;
+
+                        units[n_units++] = u;
+                }
+
+                typesafe_qsort(units, n_units, unit_compare_by_id);
+
+                FOREACH_ARRAY(i, units, n_units) {
+                        r = set_ensure_put(&seen, NULL, *i);
+                        if (r < 0)
+                                return r;
+
+                        r = reply_unit_properties(reply, message, (*i)->id, *i, properties, error);
+                        if (r < 0)
+                                return r;
+                }
+        }
+
+        r = sd_bus_message_close_container(reply);
+        if (r < 0)
+                return r;
+
+        return sd_bus_send(NULL, reply, NULL);
+}
+
 static int method_list_jobs(sd_bus_message *message, void *userdata, sd_bus_error *error) {
         _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
         Manager *m = ASSERT_PTR(userdata);
@@ -2189,7 +2612,7 @@ static int method_enqueue_marked_jobs(sd_bus_message *message, void *userdata, s
 static int list_unit_files_by_patterns(sd_bus_message *message, void *userdata, sd_bus_error *error, char **states, char **patterns) {
         Manager *m = ASSERT_PTR(userdata);
         _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
-        _cleanup_hashmap_free_ Hashmap *h = NULL;
+        Hashmap *h;
         int r;
 
         assert(message);
@@ -2204,7 +2627,8 @@ static int list_unit_files_by_patterns(sd_bus_message *message, void *userdata,
         if (r < 0)
                 return r;
 
-        r = unit_file_get_list(m->runtime_scope, /* root_dir = */ NULL, states, patterns, &h);
+        /* Owned by the cache */
+        r = install_cache_get_list(m->install_cache, &h);
         if (r < 0)
                 return r;
 
@@ -2213,7 +2637,15 @@ static int list_unit_files_by_patterns(sd_bus_message *message, void *userdata,
                 return r;
 
         UnitFileList *item;
-        HASHMAP_FOREACH(item, h) {
+        const char *name;
+        HASHMAP_FOREACH_KEY(item, name, h) {
+                if (!strv_fnmatch_or_empty(patterns, name, FNM_NOESCAPE))
+                        continue;
+
+                if (!strv_isempty(states) &&
+                    !strv_contains(states, unit_file_state_to_string(item->state)))
+                        continue;
+
                 r = sd_bus_message_append(reply, "(ss)", item->path, unit_file_state_to_string(item->state));
                 if (r < 0)
                         return r;
@@ -2264,7 +2696,7 @@ static int method_get_unit_file_state(sd_bus_message *message, void *userdata, s
         if (r < 0)
                 return r;
 
-        r = unit_file_get_state(m->runtime_scope, NULL, name, &state);
+        r = install_cache_get_state(m->install_cache, name, &state);
         if (r < 0)
                 return r;
 
@@ -2321,6 +2753,10 @@ static void manager_unit_files_changed(Manager *m, const InstallChange *changes,
         /* See comments for this variable in manager.h */
         m->unit_file_state_outdated = true;
 
+        /* Most changes are noticed through inotify, but e.g. linked unit files are outside of the search
+         * path */
+        install_cache_flush(m->install_cache);
+
         r = bus_foreach_bus(m, NULL, send_unit_files_changed, NULL);
         if (r < 0)
                 log_debug_errno(r, "Failed to send UnitFilesChanged signal, ignoring: %m");
@@ -3080,6 +3516,9 @@ const sd_bus_vtable bus_manager_vtable[] = {
         SD_BUS_PROPERTY("NJobs", "u", property_get_hashmap_size, offsetof(Manager, jobs), 0),
         SD_BUS_PROPERTY("NInstalledJobs", "u", bus_property_get_unsigned, offsetof(Manager, n_installed_jobs), 0),
         SD_BUS_PROPERTY("NFailedJobs", "u", bus_property_get_unsigned, offsetof(Manager, n_failed_jobs), 0),
+        SD_BUS_PROPERTY("Phases", "a(stttt)", property_get_phases, 0, 0),
+        SD_BUS_PROPERTY("Generators", "a(sttib)", property_get_generators, 0, 0),
+        SD_BUS_PROPERTY("Counters", "a(st)", property_get_counters, 0, 0),
         SD_BUS_PROPERTY("Progress", "d", property_get_progress, 0, 0),
         SD_BUS_PROPERTY("Environment", "as", property_get_environment, 0, 0),
         SD_BUS_PROPERTY("ConfirmSpawn", "b", bus_property_get_bool, offsetof(Manager, confirm_spawn), SD_BUS_VTABLE_PROPERTY_CONST),
@@ -3299,11 +3738,21 @@ const sd_bus_vtable bus_manager_vtable[] = {
                                 SD_BUS_RESULT("o", job),
                                 method_start_transient_unit,
                                 SD_BUS_VTABLE_UNPRIVILEGED),
+        SD_BUS_METHOD_WITH_ARGS("StartTransientUnits",
+                                SD_BUS_ARGS("s", mode, "a(sa(sv)a(sa(sv)))", units),
+                                SD_BUS_RESULT("a(soss)", jobs),
+                                method_start_transient_units,
+                                SD_BUS_VTABLE_UNPRIVILEGED),
         SD_BUS_METHOD_WITH_ARGS("GetUnitProcesses",
                                 SD_BUS_ARGS("s", name),
                                 SD_BUS_RESULT("a(sus)", processes),
                                 method_get_unit_processes,
                                 SD_BUS_VTABLE_UNPRIVILEGED),
+        SD_BUS_METHOD_WITH_ARGS("GetUnitProcessesWithLimit",
+                                SD_BUS_ARGS("s", name, "t", limit),
+                                SD_BUS_RESULT("a(sus)", processes, "t", n_processes),
+                                method_get_unit_processes_with_limit,
+                                SD_BUS_VTABLE_UNPRIVILEGED),
         SD_BUS_METHOD_WITH_ARGS("AttachProcessesToUnit",
                                 SD_BUS_ARGS("s", unit_name, "s", subcgroup, "au", pids),
                                 SD_BUS_NO_RESULT,
@@ -3369,6 +3818,11 @@ const sd_bus_vtable bus_manager_vtable[] = {
                                 SD_BUS_RESULT("a(ssssssouso)", units),
                                 method_list_units_by_names,
                                 SD_BUS_VTABLE_UNPRIVILEGED),
+        SD_BUS_METHOD_WITH_ARGS("ListUnitPropertiesByPatterns",
+                                SD_BUS_ARGS("as", states, "as", patterns, "as", properties),
+                                SD_BUS_RESULT("a(sa{sv})", units),
+                                method_list_unit_properties_by_patterns,
+                                SD_BUS_VTABLE_UNPRIVILEGED),
         SD_BUS_METHOD_WITH_ARGS("ListJobs",
                                 SD_BUS_NO_ARGS,
                                 SD_BUS_RESULT("a(usssoo)", jobs),
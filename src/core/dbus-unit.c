@@ -6,6 +6,7 @@
 #include "bpf-firewall.h"
 #include "bus-common-errors.h"
 #include "bus-get-properties.h"
+#include "bus-objects.h"
 #include "bus-polkit.h"
 #include "bus-util.h"
 #include "cgroup-util.h"
@@ -15,6 +16,7 @@
 #include "dbus-unit.h"
 #include "dbus-util.h"
 #include "dbus.h"
+#include "execute-serialize.h"
 #include "fd-util.h"
 #include "install.h"
 #include "locale-util.h"
@@ -25,6 +27,7 @@
 #include "service.h"
 #include "signal-util.h"
 #include "special.h"
+#include "string-intern.h"
 #include "string-table.h"
 #include "string-util.h"
 #include "strv.h"
@@ -152,8 +155,6 @@ static int property_get_dependencies(
 
         Unit *u = userdata, *other;
         UnitDependency d;
-        Hashmap *deps;
-        void *v;
         int r;
 
         assert(bus);
@@ -163,13 +164,11 @@ static int property_get_dependencies(
         d = unit_dependency_from_string(property);
         assert_se(d >= 0);
 
-        deps = unit_get_dependencies(u, d);
-
         r = sd_bus_message_open_container(reply, 'a', "s");
         if (r < 0)
                 return r;
 
-        HASHMAP_FOREACH_KEY(v, other, deps) {
+        UNIT_FOREACH_DEPENDENCY_OF_TYPE(other, NULL, u, d) {
                 r = sd_bus_message_append(reply, "s", other->id);
                 if (r < 0)
                         return r;
@@ -1240,19 +1239,58 @@ static int property_get_cgroup_id(
         return sd_bus_message_append(reply, "t", crt ? crt->cgroup_id : UINT64_C(0));
 }
 
-static int append_process(sd_bus_message *reply, const char *p, PidRef *pid, Set *pids) {
+typedef struct ProcessList {
+        sd_bus_message *reply;
+        Set *pids;              /* PIDs listed or counted so far, the main and control processes are seen twice */
+        uint64_t limit;         /* Processes beyond this are only counted */
+        uint64_t n_processes;
+} ProcessList;
+
+static int append_process(ProcessList *l, const char *p, PidRef *pid, bool in_cgroup) {
         _cleanup_free_ char *buf = NULL, *cmdline = NULL;
         int r;
 
-        assert(reply);
+        assert(l);
         assert(pidref_is_set(pid));
 
-        r = set_put(pids, PID_TO_PTR(pid->pid));
+        r = set_put(l->pids, PID_TO_PTR(pid->pid));
         if (IN_SET(r, 0, -EEXIST))
                 return 0;
         if (r < 0)
                 return r;
 
+        if (l->n_processes >= l->limit) {
+                /* Only counted, hence all we need to know is whether this is a kernel thread */
+                if (in_cgroup && pid_is_kernel_thread(pid->pid) > 0)
+                        return 0;
+
+                l->n_processes++;
+                return 0;
+        }
+
+        /* Kernel threads have no command line, hence only check for them if there is none, which saves a
+         * lookup for every other process. */
+        r = pidref_get_cmdline(pid, SIZE_MAX, PROCESS_CMDLINE_QUOTE, &cmdline);
+        if (r == -ESRCH) /* gone by now */
+                return 0;
+        if (r == -ENOENT) {
+                if (in_cgroup) {
+                        r = pidref_is_kernel_thread(pid);
+                        if (r == -ESRCH)
+                                return 0;
+                        if (r < 0)
+                                log_debug_errno(r, "Failed to determine if " PID_FMT " is a kernel thread, assuming not: %m", pid->pid);
+                        if (r > 0)
+                                return 0;
+                }
+
+                (void) pidref_get_cmdline(
+                                pid,
+                                SIZE_MAX,
+                                PROCESS_CMDLINE_COMM_FALLBACK | PROCESS_CMDLINE_QUOTE,
+                                &cmdline);
+        }
+
         if (!p) {
                 r = cg_pidref_get_path(SYSTEMD_CGROUP_CONTROLLER, pid, &buf);
                 if (r == -ESRCH)
@@ -1263,25 +1301,24 @@ static int append_process(sd_bus_message *reply, const char *p, PidRef *pid, Set
                 p = buf;
         }
 
-        (void) pidref_get_cmdline(
-                        pid,
-                        SIZE_MAX,
-                        PROCESS_CMDLINE_COMM_FALLBACK | PROCESS_CMDLINE_QUOTE,
-                        &cmdline);
+        r = sd_bus_message_append(l->reply,
+                                  "(sus)",
+                                  p,
+                                  (uint32_t) pid->pid,
+                                  cmdline);
+        if (r < 0)
+                return r;
 
-        return sd_bus_message_append(reply,
-                                     "(sus)",
-                                     p,
-                                     (uint32_t) pid->pid,
-                                     cmdline);
+        l->n_processes++;
+        return 0;
 }
 
-static int append_cgroup(sd_bus_message *reply, const char *p, Set *pids) {
+static int append_cgroup(ProcessList *l, const char *p) {
         _cleanup_closedir_ DIR *d = NULL;
         _cleanup_fclose_ FILE *f = NULL;
         int r;
 
-        assert(reply);
+        assert(l);
         assert(p);
 
         r = cg_enumerate_processes(SYSTEMD_CGROUP_CONTROLLER, p, &f);
@@ -1296,23 +1333,17 @@ static int append_cgroup(sd_bus_message *reply, const char *p, Set *pids) {
                 /* libvirt / qemu uses threaded mode and cgroup.procs cannot be read at the lower levels.
                  * From https://docs.kernel.org/admin-guide/cgroup-v2.html#threads, “cgroup.procs” in a
                  * threaded domain cgroup contains the PIDs of all processes in the subtree and is not
-                 * readable in the subtree proper. */
+                 * readable in the subtree proper.
+                 *
+                 * Processes that are only counted don't need a pidfd. */
 
-                r = cg_read_pidref(f, &pidref, /* flags = */ 0);
+                r = cg_read_pidref(f, &pidref, l->n_processes >= l->limit ? CGROUP_NO_PIDFD : 0);
                 if (IN_SET(r, 0, -EOPNOTSUPP))
                         break;
                 if (r < 0)
                         return r;
 
-                r = pidref_is_kernel_thread(&pidref);
-                if (r == -ESRCH) /* gone by now */
-                        continue;
-                if (r < 0)
-                        log_debug_errno(r, "Failed to determine if " PID_FMT " is a kernel thread, assuming not: %m", pidref.pid);
-                if (r > 0)
-                        continue;
-
-                r = append_process(reply, p, &pidref, pids);
+                r = append_process(l, p, &pidref, /* in_cgroup = */ true);
                 if (r < 0)
                         return r;
         }
@@ -1336,7 +1367,7 @@ static int append_cgroup(sd_bus_message *reply, const char *p, Set *pids) {
                 if (!j)
                         return -ENOMEM;
 
-                r = append_cgroup(reply, j, pids);
+                r = append_cgroup(l, j);
                 if (r < 0)
                         return r;
         }
@@ -1344,13 +1375,13 @@ static int append_cgroup(sd_bus_message *reply, const char *p, Set *pids) {
         return 0;
 }
 
-int bus_unit_method_get_processes(sd_bus_message *message, void *userdata, sd_bus_error *error) {
+static int get_processes(sd_bus_message *message, Unit *u, uint64_t limit, bool with_count, sd_bus_error *error) {
         _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
         _cleanup_set_free_ Set *pids = NULL;
-        Unit *u = userdata;
         int r;
 
         assert(message);
+        assert(u);
 
         r = mac_selinux_unit_access_check(u, message, "status", error);
         if (r < 0)
@@ -1368,24 +1399,31 @@ int bus_unit_method_get_processes(sd_bus_message *message, void *userdata, sd_bu
         if (r < 0)
                 return r;
 
-        CGroupRuntime *crt = unit_get_cgroup_runtime(u);
-        if (crt && crt->cgroup_path) {
-                r = append_cgroup(reply, crt->cgroup_path, pids);
-                if (r < 0)
-                        return r;
-        }
+        ProcessList l = {
+                .reply = reply,
+                .pids = pids,
+                .limit = limit,
+        };
 
-        /* The main and control pids might live outside of the cgroup, hence fetch them separately */
+        /* The main and control pids might live outside of the cgroup, hence fetch them separately. They go
+         * first, so that they are listed even if the limit is hit. */
         PidRef *pid = unit_main_pid(u);
         if (pidref_is_set(pid)) {
-                r = append_process(reply, NULL, pid, pids);
+                r = append_process(&l, NULL, pid, /* in_cgroup = */ false);
                 if (r < 0)
                         return r;
         }
 
         pid = unit_control_pid(u);
         if (pidref_is_set(pid)) {
-                r = append_process(reply, NULL, pid, pids);
+                r = append_process(&l, NULL, pid, /* in_cgroup = */ false);
+                if (r < 0)
+                        return r;
+        }
+
+        CGroupRuntime *crt = unit_get_cgroup_runtime(u);
+        if (crt && crt->cgroup_path) {
+                r = append_cgroup(&l, crt->cgroup_path);
                 if (r < 0)
                         return r;
         }
@@ -1394,9 +1432,32 @@ int bus_unit_method_get_processes(sd_bus_message *message, void *userdata, sd_bu
         if (r < 0)
                 return r;
 
+        if (with_count) {
+                r = sd_bus_message_append(reply, "t", l.n_processes);
+                if (r < 0)
+                        return r;
+        }
+
         return sd_bus_send(NULL, reply, NULL);
 }
 
+int bus_unit_method_get_processes(sd_bus_message *message, void *userdata, sd_bus_error *error) {
+        return get_processes(message, ASSERT_PTR(userdata), UINT64_MAX, /* with_count = */ false, error);
+}
+
+int bus_unit_method_get_processes_with_limit(sd_bus_message *message, void *userdata, sd_bus_error *error) {
+        uint64_t limit;
+        int r;
+
+        assert(message);
+
+        r = sd_bus_message_read(message, "t", &limit);
+        if (r < 0)
+                return r;
+
+        return get_processes(message, ASSERT_PTR(userdata), limit, /* with_count = */ true, error);
+}
+
 static int property_get_ip_counter(
                 sd_bus *bus,
                 const char *path,
@@ -1643,9 +1704,65 @@ static int send_new_signal(sd_bus *bus, void *userdata) {
         return sd_bus_send(bus, m, NULL);
 }
 
+typedef struct ChangedSignalContext {
+        Unit *unit;
+        bool computed;
+        /* The properties to include for the type-specific interface and the generic unit interface, or
+         * NULL for all of them */
+        char **names[2];
+} ChangedSignalContext;
+
+static void changed_signal_context_done(ChangedSignalContext *c) {
+        assert(c);
+
+        /* Only the arrays are owned, the strings are borrowed from the vtables */
+        free(c->names[0]);
+        free(c->names[1]);
+}
+
+void bus_unit_free_property_digests(Unit *u) {
+        assert(u);
+
+        if (!u->dbus_property_digests)
+                return;
+
+        bus_properties_digest_done(u->dbus_property_digests);
+        bus_properties_digest_done(u->dbus_property_digests + 1);
+        u->dbus_property_digests = mfree(u->dbus_property_digests);
+}
+
+static int changed_signal_context_compute(ChangedSignalContext *c, sd_bus *bus, const char *path) {
+        Unit *u;
+        int r;
+
+        assert(c);
+        assert(bus);
+        assert(path);
+
+        u = c->unit;
+
+        /* Determine the properties that changed since the last signal once, on the first bus we send
+         * to, and include only those on all buses. */
+
+        if (!u->dbus_property_digests) {
+                u->dbus_property_digests = new0(BusPropertiesDigest, 2);
+                if (!u->dbus_property_digests)
+                        return -ENOMEM;
+        }
+
+        r = bus_properties_changed(bus, path, unit_dbus_interface_from_type(u->type),
+                                   u->dbus_property_digests, c->names);
+        if (r < 0)
+                return r;
+
+        return bus_properties_changed(bus, path, "org.freedesktop.systemd1.Unit",
+                                      u->dbus_property_digests + 1, c->names + 1);
+}
+
 static int send_changed_signal(sd_bus *bus, void *userdata) {
+        ChangedSignalContext *c = ASSERT_PTR(userdata);
         _cleanup_free_ char *p = NULL;
-        Unit *u = ASSERT_PTR(userdata);
+        Unit *u = c->unit;
         int r;
 
         assert(bus);
@@ -1654,6 +1771,19 @@ static int send_changed_signal(sd_bus *bus, void *userdata) {
         if (!p)
                 return -ENOMEM;
 
+        if (u->manager->dbus_signal_changed_properties_only && !c->computed) {
+                c->computed = true;
+
+                r = changed_signal_context_compute(c, bus, p);
+                if (r < 0) {
+                        log_unit_debug_errno(u, r, "Failed to determine changed properties, including all: %m");
+
+                        changed_signal_context_done(c);
+                        c->names[0] = c->names[1] = NULL;
+                        bus_unit_free_property_digests(u);
+                }
+        }
+
         /* Send a properties changed signal. First for the specific
          * type, then for the generic unit. The clients may rely on
          * this order to get atomic behavior if needed. */
@@ -1661,14 +1791,14 @@ static int send_changed_signal(sd_bus *bus, void *userdata) {
         r = sd_bus_emit_properties_changed_strv(
                         bus, p,
                         unit_dbus_interface_from_type(u->type),
-                        NULL);
+                        c->names[0]);
         if (r < 0)
                 return r;
 
         return sd_bus_emit_properties_changed_strv(
                         bus, p,
                         "org.freedesktop.systemd1.Unit",
-                        NULL);
+                        c->names[1]);
 }
 
 void bus_unit_send_change_signal(Unit *u) {
@@ -1686,7 +1816,19 @@ void bus_unit_send_change_signal(Unit *u) {
         if (!u->id)
                 return;
 
-        r = bus_foreach_bus(u->manager, u->bus_track, u->sent_dbus_new_signal ? send_changed_signal : send_new_signal, u);
+        if (u->sent_dbus_new_signal) {
+                _cleanup_(changed_signal_context_done) ChangedSignalContext c = {
+                        .unit = u,
+                };
+
+                r = bus_foreach_bus(u->manager, u->bus_track, send_changed_signal, &c);
+
+                /* If nobody got to see the current values, the next signal has to include everything
+                 * again, since subscribers might have picked up any of the values in between. */
+                if (!c.computed)
+                        bus_unit_free_property_digests(u);
+        } else
+                r = bus_foreach_bus(u->manager, u->bus_track, send_new_signal, u);
         if (r < 0)
                 log_unit_debug_errno(u, r, "Failed to send unit change signal for %s: %m", u->id);
 
@@ -1711,6 +1853,11 @@ void bus_unit_send_pending_change_signal(Unit *u, bool including_new) {
                                                * when we are reloading. */
                 return;
 
+        if (!including_new && u->manager->dbus_signal_coalesce_usec > 0) /* When coalescing signals, intermediate
+                                                                            * states are not announced, except
+                                                                            * before job signals */
+                return;
+
         bus_unit_send_change_signal(u);
 }
 
@@ -2283,13 +2430,17 @@ static int bus_unit_set_transient_property(
 
                 if (!UNIT_WRITE_FLAGS_NOOP(flags)) {
                         if (strv_isempty(l)) {
-                                u->documentation = strv_free(u->documentation);
+                                u->documentation = string_unintern_strv(u->documentation);
                                 unit_write_settingf(u, flags, name, "%s=", name);
                         } else {
                                 r = strv_extend_strv(&u->documentation, l, /* filter_duplicates= */ false);
                                 if (r < 0)
                                         return r;
 
+                                r = string_intern_strv(u->documentation);
+                                if (r < 0)
+                                        return r;
+
                                 STRV_FOREACH(p, l)
                                         unit_write_settingf(u, flags, name, "%s=%s", name, *p);
                         }
@@ -2493,6 +2644,9 @@ int bus_unit_set_properties(
                                 goto error;
 
                         for_real = true;
+
+                        /* The contexts are about to change, serialize them anew for the next process */
+                        u->exec_serialization_cache = exec_serialization_cache_free(u->exec_serialization_cache);
                         continue;
                 }
 
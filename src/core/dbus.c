@@ -702,12 +702,24 @@ static int bus_on_connection(sd_event_source *s, int fd, uint32_t revents, void
                 return 0;
         }
 
+        r = sd_bus_set_creds_cache(bus, true);
+        if (r < 0)
+                log_warning_errno(r, "Failed to enable sender credentials cache for new connection, ignoring: %m");
+
         r = sd_bus_set_sender(bus, "org.freedesktop.systemd1");
         if (r < 0) {
                 log_warning_errno(r, "Failed to set direct connection sender: %m");
                 return 0;
         }
 
+        /* Large replies, e.g. to ListUnits() on systems with many units, are passed in memfds if the
+         * client agrees */
+        r = sd_bus_negotiate_memfd(bus, true);
+        if (r < 0) {
+                log_warning_errno(r, "Failed to enable memfd bodies for new connection: %m");
+                return 0;
+        }
+
         r = sd_bus_start(bus);
         if (r < 0) {
                 log_warning_errno(r, "Failed to start new connection bus: %m");
@@ -784,6 +796,10 @@ static int bus_setup_api(Manager *m, sd_bus *bus) {
         if (r < 0)
                 log_warning_errno(r, "Failed to enable credential passing, ignoring: %m");
 
+        r = sd_bus_set_creds_cache(bus, true);
+        if (r < 0)
+                log_warning_errno(r, "Failed to enable sender credentials cache, ignoring: %m");
+
         r = bus_setup_api_vtables(m, bus);
         if (r < 0)
                 return r;
@@ -30,6 +30,9 @@ static const UnitActiveState state_translation_table[_DEVICE_STATE_MAX] = {
         [DEVICE_PLUGGED]   = UNIT_ACTIVE,
 };
 
+/* Flush queued uevents inline once this many accumulated without the queue being dispatched. */
+#define DEVICE_QUEUE_MAX 1024U
+
 static int device_dispatch_io(sd_device_monitor *monitor, sd_device *dev, void *userdata);
 
 static int device_by_path(Manager *m, const char *path, Unit **ret) {
@@ -631,14 +634,13 @@ static bool device_is_bound_by_mounts(Device *d, sd_device *dev) {
 
 static void device_upgrade_mount_deps(Unit *u) {
         Unit *other;
-        void *v;
         int r;
 
         /* Let's upgrade Requires= to BindsTo= on us. (Used when SYSTEMD_MOUNT_DEVICE_BOUND is set) */
 
         assert(u);
 
-        HASHMAP_FOREACH_KEY(v, other, unit_get_dependencies(u, UNIT_REQUIRED_BY)) {
+        UNIT_FOREACH_DEPENDENCY_OF_TYPE(other, NULL, u, UNIT_REQUIRED_BY) {
                 if (other->type != UNIT_MOUNT)
                         continue;
 
@@ -1001,6 +1003,13 @@ static void device_shutdown(Manager *m) {
 
         m->device_monitor = sd_device_monitor_unref(m->device_monitor);
         m->devices_by_sysfs = hashmap_free(m->devices_by_sysfs);
+
+        m->device_queue_event_source = sd_event_source_disable_unref(m->device_queue_event_source);
+        m->device_queue_by_sysfs = hashmap_free(m->device_queue_by_sysfs);
+        FOREACH_ARRAY(dev, m->device_queue, m->n_device_queue)
+                sd_device_unref(*dev);
+        m->device_queue = mfree(m->device_queue);
+        m->n_device_queue = 0;
 }
 
 static void device_enumerate(Manager *m) {
@@ -1102,29 +1111,27 @@ static void device_remove_old_on_move(Manager *m, sd_device *dev) {
         device_update_found_by_sysfs(m, syspath_old, DEVICE_NOT_FOUND, DEVICE_FOUND_MASK);
 }
 
-static int device_dispatch_io(sd_device_monitor *monitor, sd_device *dev, void *userdata) {
+static void device_process_uevent(Manager *m, sd_device *dev) {
         _cleanup_set_free_ Set *ready_units = NULL, *not_ready_units = NULL;
-        Manager *m = ASSERT_PTR(userdata);
         sd_device_action_t action;
         const char *sysfs;
         bool ready;
         Device *d;
         int r;
 
+        assert(m);
         assert(dev);
 
         log_device_uevent(dev, "Processing udev action");
 
         r = sd_device_get_syspath(dev, &sysfs);
         if (r < 0) {
-                log_device_warning_errno(dev, r, "Failed to get device syspath, ignoring: %m");
-                return 0;
+                return (void) log_device_warning_errno(dev, r, "Failed to get device syspath, ignoring: %m");
         }
 
         r = sd_device_get_action(dev, &action);
         if (r < 0) {
-                log_device_warning_errno(dev, r, "Failed to get udev action, ignoring: %m");
-                return 0;
+                return (void) log_device_warning_errno(dev, r, "Failed to get udev action, ignoring: %m");
         }
 
         log_device_debug(dev, "Got '%s' action on syspath '%s'.", device_action_to_string(action), sysfs);
@@ -1148,7 +1155,7 @@ static int device_dispatch_io(sd_device_monitor *monitor, sd_device *dev, void *
                 } else
                         log_device_warning(dev, "systemd-udevd failed to process the device with unknown result, ignoring.");
 
-                return 0;
+                return;
         }
 
         /* A change event can signal that a device is becoming ready, in particular if the device is using
@@ -1190,6 +1197,130 @@ static int device_dispatch_io(sd_device_monitor *monitor, sd_device *dev, void *
          * the rest around. This may be redundant for remove uevent, but should be harmless. */
         SET_FOREACH(d, not_ready_units)
                 device_update_found_one(d, DEVICE_NOT_FOUND, DEVICE_FOUND_UDEV);
+}
+
+static void device_queue_flush(Manager *m) {
+        assert(m);
+
+        if (m->n_device_queue == 0)
+                return;
+
+        log_debug("Processing %zu queued udev event(s).", m->n_device_queue);
+
+        /* Drop the index first, so that nothing can be coalesced into entries we are about to process. */
+        hashmap_clear(m->device_queue_by_sysfs);
+
+        FOREACH_ARRAY(dev, m->device_queue, m->n_device_queue) {
+                device_process_uevent(m, *dev);
+                *dev = sd_device_unref(*dev);
+        }
+
+        /* Keep the array allocated, the next burst of uevents is likely to need it again. */
+        m->n_device_queue = 0;
+
+        (void) sd_event_source_set_enabled(m->device_queue_event_source, SD_EVENT_OFF);
+}
+
+static int device_queue_dispatch(sd_event_source *source, void *userdata) {
+        Manager *m = ASSERT_PTR(userdata);
+
+        device_queue_flush(m);
+        return 0;
+}
+
+static int device_queue_uevent(Manager *m, sd_device *dev) {
+        sd_device_action_t action;
+        const char *sysfs;
+        void *p;
+        int r;
+
+        assert(m);
+        assert(dev);
+
+        r = sd_device_get_syspath(dev, &sysfs);
+        if (r < 0)
+                return r;
+
+        r = sd_device_get_action(dev, &action);
+        if (r < 0)
+                return r;
+
+        /* If the most recent queued uevent for the same device is a 'change' uevent too, and it hasn't been
+         * processed yet, there's no point in processing both: the properties of the newer one describe the
+         * current state of the device, hence simply replace the queued one. Any other sequence of actions
+         * (e.g. 'remove' followed by 'add') is kept as is. */
+        p = hashmap_get(m->device_queue_by_sysfs, sysfs);
+        if (p && action == SD_DEVICE_CHANGE) {
+                sd_device **q = m->device_queue + PTR_TO_SIZE(p) - 1;
+                sd_device_action_t a;
+
+                if (sd_device_get_action(*q, &a) >= 0 && a == SD_DEVICE_CHANGE) {
+                        log_device_debug(dev, "Coalescing 'change' uevent with the one already queued.");
+
+                        /* The key is owned by the queued device object, hence update it too. */
+                        r = hashmap_replace(m->device_queue_by_sysfs, sysfs, p);
+                        if (r < 0)
+                                return r;
+
+                        sd_device_unref(*q);
+                        *q = sd_device_ref(dev);
+                        return 0;
+                }
+        }
+
+        /* Don't let the queue grow without bounds if uevents keep coming in faster than we get around to
+         * dispatching the queue. */
+        if (m->n_device_queue >= DEVICE_QUEUE_MAX)
+                device_queue_flush(m);
+
+        if (!m->device_queue_event_source) {
+                r = sd_event_add_defer(m->event, &m->device_queue_event_source, device_queue_dispatch, m);
+                if (r < 0)
+                        return r;
+
+                r = sd_event_source_set_priority(m->device_queue_event_source, EVENT_PRIORITY_DEVICE_QUEUE);
+                if (r < 0)
+                        return r;
+
+                (void) sd_event_source_set_description(m->device_queue_event_source, "device-queue");
+        }
+
+        r = sd_event_source_set_enabled(m->device_queue_event_source, SD_EVENT_ONESHOT);
+        if (r < 0)
+                return r;
+
+        if (!GREEDY_REALLOC(m->device_queue, m->n_device_queue + 1))
+                return -ENOMEM;
+
+        r = hashmap_ensure_allocated(&m->device_queue_by_sysfs, &path_hash_ops);
+        if (r < 0)
+                return r;
+
+        r = hashmap_replace(m->device_queue_by_sysfs, sysfs, SIZE_TO_PTR(m->n_device_queue + 1));
+        if (r < 0)
+                return r;
+
+        m->device_queue[m->n_device_queue++] = sd_device_ref(dev);
+        return 0;
+}
+
+static int device_dispatch_io(sd_device_monitor *monitor, sd_device *dev, void *userdata) {
+        Manager *m = ASSERT_PTR(userdata);
+        int r;
+
+        assert(dev);
+
+        /* Rather than processing each uevent right away, queue them up and process them from a defer event
+         * source with a lower priority than the device monitor. That way we drain everything the monitor has
+         * to offer first, and can skip intermediate 'change' uevents of the same device. */
+        r = device_queue_uevent(m, dev);
+        if (r < 0) {
+                log_device_warning_errno(dev, r, "Failed to queue udev event, processing it immediately: %m");
+
+                /* Process everything queued so far first, to keep the ordering intact. */
+                device_queue_flush(m);
+                device_process_uevent(m, dev);
+        }
 
         return 0;
 }
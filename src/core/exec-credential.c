@@ -267,7 +267,7 @@ static int maybe_decrypt_and_write_credential(
                                 /* tpm2_signature_path= */ NULL,
                                 getuid(),
                                 &IOVEC_MAKE(data, size),
-                                CREDENTIAL_ANY_SCOPE,
+                                CREDENTIAL_ANY_SCOPE|CREDENTIAL_TPM2_CACHE,
                                 &plaintext);
                 if (r < 0)
                         return r;
@@ -702,7 +702,7 @@ static int acquire_credentials(
                                         /* tpm2_signature_path= */ NULL,
                                         getuid(),
                                         &IOVEC_MAKE(sc->data, sc->size),
-                                        CREDENTIAL_ANY_SCOPE,
+                                        CREDENTIAL_ANY_SCOPE|CREDENTIAL_TPM2_CACHE,
                                         &plaintext);
                         if (r < 0)
                                 return r;
@@ -861,6 +861,11 @@ static int setup_credentials_internal(
         (void) label_fix_full(AT_FDCWD, where, final, 0);
 
         r = acquire_credentials(context, params, unit, where, uid, gid, workspace_mounted);
+
+        /* The TPM2 context was kept around while decrypting the credentials of this unit, we are done
+         * with it now, and it shouldn't be inherited by the service either. */
+        decrypt_credential_flush_cache();
+
         if (r < 0) {
                 /* If we're using final place as workspace, and failed to acquire credentials, we might
                  * have left half-written creds there. Let's get rid of the whole mount, so future
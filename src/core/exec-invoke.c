@@ -1425,6 +1425,16 @@ static int apply_syscall_filter(const ExecContext *c, const ExecParameters *p, b
         if (skip_seccomp_unavailable(c, p, "SystemCallFilter="))
                 return 0;
 
+        /* PID 1 precompiled the filter for us, with write() added but without the ambient capability
+         * hack. Use it if that matches what we need. */
+        if (p->syscall_filter_fd >= 0 && !needs_ambient_hack && (p->exec_fd >= 0 || p->handoff_timestamp_fd >= 0)) {
+                r = seccomp_load_compiled_filter(p->syscall_filter_fd);
+                if (r >= 0 || ERRNO_IS_NEG_SECCOMP_FATAL(r))
+                        return r;
+
+                log_exec_debug_errno(c, p, r, "Failed to install precompiled system call filter, compiling it again: %m");
+        }
+
         negative_action = c->syscall_errno == SECCOMP_ERROR_NUMBER_KILL ? scmp_act_kill_process() : SCMP_ACT_ERRNO(c->syscall_errno);
 
         if (c->syscall_allow_list) {
@@ -3238,6 +3248,10 @@ static int apply_mount_namespace(
                 .notify_socket = root_dir || root_image ? params->notify_socket : NULL,
                 .host_os_release_stage = host_os_release_stage,
 
+                .mount_template_storage_socket =
+                        context->reuse_mount_namespace && runtime && runtime->mount_template_storage_socket[0] >= 0 ?
+                        runtime->mount_template_storage_socket : NULL,
+
                 /* If DynamicUser=no and RootDirectory= is set then lets pass a relaxed sandbox info,
                  * otherwise enforce it, don't ignore protected paths and fail if we are enable to apply the
                  * sandbox inside the mount namespace. */
@@ -3523,7 +3537,7 @@ static int close_remaining_fds(
                 const int *fds, size_t n_fds) {
 
         size_t n_dont_close = 0;
-        int dont_close[n_fds + 16];
+        int dont_close[n_fds + 18];
 
         assert(params);
 
@@ -3541,8 +3555,10 @@ static int close_remaining_fds(
                 n_dont_close += n_fds;
         }
 
-        if (runtime)
+        if (runtime) {
                 append_socket_pair(dont_close, &n_dont_close, runtime->ephemeral_storage_socket);
+                append_socket_pair(dont_close, &n_dont_close, runtime->mount_template_storage_socket);
+        }
 
         if (runtime && runtime->shared) {
                 append_socket_pair(dont_close, &n_dont_close, runtime->shared->netns_storage_socket);
@@ -3971,6 +3987,7 @@ static void exec_runtime_close(ExecRuntime *rt) {
                 return;
 
         safe_close_pair(rt->ephemeral_storage_socket);
+        safe_close_pair(rt->mount_template_storage_socket);
 
         exec_shared_runtime_close(rt->shared);
         dynamic_creds_close(rt->dynamic_creds);
@@ -4162,7 +4179,7 @@ int exec_invoke(
                 return log_exec_error_errno(context, params, r, "Failed to get OpenFile= file descriptors: %m");
         }
 
-        int keep_fds[n_fds + 4];
+        int keep_fds[n_fds + 5];
         memcpy_safe(keep_fds, params->fds, n_fds * sizeof(int));
         n_keep_fds = n_fds;
 
@@ -4186,6 +4203,14 @@ int exec_invoke(
         }
 #endif
 
+#if HAVE_SECCOMP
+        r = add_shifted_fd(keep_fds, ELEMENTSOF(keep_fds), &n_keep_fds, &params->syscall_filter_fd);
+        if (r < 0) {
+                *exit_status = EXIT_FDS;
+                return log_exec_error_errno(context, params, r, "Failed to collect shifted fd: %m");
+        }
+#endif
+
         r = close_remaining_fds(params, runtime, socket_fd, keep_fds, n_keep_fds);
         if (r < 0) {
                 *exit_status = EXIT_FDS;
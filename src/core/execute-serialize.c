@@ -10,6 +10,7 @@
 #include "fd-util.h"
 #include "fileio.h"
 #include "in-addr-prefix-util.h"
+#include "memstream-util.h"
 #include "parse-helpers.h"
 #include "parse-util.h"
 #include "percent-util.h"
@@ -1163,6 +1164,12 @@ static int exec_runtime_serialize(const ExecRuntime *rt, FILE *f, FDSet *fds) {
                         return r;
         }
 
+        if (rt->mount_template_storage_socket[0] >= 0 && rt->mount_template_storage_socket[1] >= 0) {
+                r = serialize_fd_many(f, fds, "exec-runtime-mount-template-storage-socket", rt->mount_template_storage_socket, 2);
+                if (r < 0)
+                        return r;
+        }
+
         fputc('\n', f); /* End marker */
 
         return 0;
@@ -1235,6 +1242,11 @@ static int exec_runtime_deserialize(ExecRuntime *rt, FILE *f, FDSet *fds) {
                         r = deserialize_fd_many(fds, val, 2, rt->ephemeral_storage_socket);
                         if (r < 0)
                                 continue;
+                } else if ((val = startswith(l, "exec-runtime-mount-template-storage-socket="))) {
+
+                        r = deserialize_fd_many(fds, val, 2, rt->mount_template_storage_socket);
+                        if (r < 0)
+                                continue;
                 } else
                         log_warning("Failed to parse serialized line, ignoring: %s", l);
         }
@@ -1383,6 +1395,10 @@ static int exec_parameters_serialize(const ExecParameters *p, const ExecContext
                         return r;
         }
 
+        r = serialize_fd(f, fds, "exec-parameters-syscall-filter-fd", p->syscall_filter_fd);
+        if (r < 0)
+                return r;
+
         r = serialize_item(f, "exec-parameters-notify-socket", p->notify_socket);
         if (r < 0)
                 return r;
@@ -1640,6 +1656,14 @@ static int exec_parameters_deserialize(ExecParameters *p, FILE *f, FDSet *fds) {
                                 continue;
 
                         close_and_replace(p->bpf_restrict_fs_map_fd, fd);
+                } else if ((val = startswith(l, "exec-parameters-syscall-filter-fd="))) {
+                        int fd;
+
+                        fd = deserialize_fd(fds, val);
+                        if (fd < 0)
+                                continue;
+
+                        close_and_replace(p->syscall_filter_fd, fd);
                 } else if ((val = startswith(l, "exec-parameters-notify-socket="))) {
                         r = free_and_strdup(&p->notify_socket, val);
                         if (r < 0)
@@ -1864,6 +1888,10 @@ static int exec_context_serialize(const ExecContext *c, FILE *f) {
         if (r < 0)
                 return r;
 
+        r = serialize_bool_elide(f, "exec-context-reuse-mount-namespace", c->reuse_mount_namespace);
+        if (r < 0)
+                return r;
+
         r = serialize_bool_elide(f, "exec-context-protect-control-groups", c->protect_control_groups);
         if (r < 0)
                 return r;
@@ -2748,6 +2776,11 @@ static int exec_context_deserialize(ExecContext *c, FILE *f) {
                         if (r < 0)
                                 return r;
                         c->protect_clock = r;
+                } else if ((val = startswith(l, "exec-context-reuse-mount-namespace="))) {
+                        r = parse_boolean(val);
+                        if (r < 0)
+                                return r;
+                        c->reuse_mount_namespace = r;
                 } else if ((val = startswith(l, "exec-context-protect-control-groups="))) {
                         r = parse_boolean(val);
                         if (r < 0)
@@ -3827,6 +3860,71 @@ static int exec_command_deserialize(ExecCommand *c, FILE *f) {
         return 0;
 }
 
+ExecSerializationCache* exec_serialization_cache_free(ExecSerializationCache *c) {
+        if (!c)
+                return NULL;
+
+        free(c->context);
+        free(c->cgroup_context);
+        return mfree(c);
+}
+
+static int exec_context_serialize_cached(const ExecContext *c, FILE *f, char **cached) {
+        _cleanup_(memstream_done) MemStream m = {};
+        FILE *g;
+        int r;
+
+        assert(f);
+
+        if (!cached)
+                return exec_context_serialize(c, f);
+
+        if (!*cached) {
+                g = memstream_init(&m);
+                if (!g)
+                        return -ENOMEM;
+
+                r = exec_context_serialize(c, g);
+                if (r < 0)
+                        return r;
+
+                r = memstream_finalize(&m, cached, NULL);
+                if (r < 0)
+                        return r;
+        }
+
+        fputs(*cached, f);
+        return 0;
+}
+
+static int exec_cgroup_context_serialize_cached(const CGroupContext *c, FILE *f, char **cached) {
+        _cleanup_(memstream_done) MemStream m = {};
+        FILE *g;
+        int r;
+
+        assert(f);
+
+        if (!cached)
+                return exec_cgroup_context_serialize(c, f);
+
+        if (!*cached) {
+                g = memstream_init(&m);
+                if (!g)
+                        return -ENOMEM;
+
+                r = exec_cgroup_context_serialize(c, g);
+                if (r < 0)
+                        return r;
+
+                r = memstream_finalize(&m, cached, NULL);
+                if (r < 0)
+                        return r;
+        }
+
+        fputs(*cached, f);
+        return 0;
+}
+
 int exec_serialize_invocation(
                 FILE *f,
                 FDSet *fds,
@@ -3834,14 +3932,18 @@ int exec_serialize_invocation(
                 const ExecCommand *cmd,
                 const ExecParameters *p,
                 const ExecRuntime *rt,
-                const CGroupContext *cg) {
+                const CGroupContext *cg,
+                ExecSerializationCache *cache) {
 
         int r;
 
         assert(f);
         assert(fds);
 
-        r = exec_context_serialize(ctx, f);
+        /* If a cache is passed, the contexts are serialized into it on first use, and the cached text is
+         * used from then on. It's up to the caller to drop the cache whenever the contexts change. */
+
+        r = exec_context_serialize_cached(ctx, f, cache ? &cache->context : NULL);
         if (r < 0)
                 return log_debug_errno(r, "Failed to serialize context: %m");
 
@@ -3857,7 +3959,7 @@ int exec_serialize_invocation(
         if (r < 0)
                 return log_debug_errno(r, "Failed to serialize runtime: %m");
 
-        r = exec_cgroup_context_serialize(cg, f);
+        r = exec_cgroup_context_serialize_cached(cg, f, cache ? &cache->cgroup_context : NULL);
         if (r < 0)
                 return log_debug_errno(r, "Failed to serialize cgroup context: %m");
 
@@ -6,13 +6,24 @@
 /* These functions serialize/deserialize for invocation purposes (i.e.: serialized object is passed to a
  * child process) rather than to save state across reload/reexec. */
 
+/* The serialized ExecContext and CGroupContext of a unit only change when the unit is reloaded or its
+ * properties are changed, hence they may be kept around and reused for every process the unit spawns. */
+typedef struct ExecSerializationCache {
+        char *context;
+        char *cgroup_context;
+} ExecSerializationCache;
+
+ExecSerializationCache* exec_serialization_cache_free(ExecSerializationCache *c);
+DEFINE_TRIVIAL_CLEANUP_FUNC(ExecSerializationCache*, exec_serialization_cache_free);
+
 int exec_serialize_invocation(FILE *f,
         FDSet *fds,
         const ExecContext *ctx,
         const ExecCommand *cmd,
         const ExecParameters *p,
         const ExecRuntime *rt,
-        const CGroupContext *cg);
+        const CGroupContext *cg,
+        ExecSerializationCache *cache);
 
 int exec_deserialize_invocation(FILE *f,
         FDSet *fds,
@@ -33,6 +33,7 @@
 #include "exec-credential.h"
 #include "execute.h"
 #include "execute-serialize.h"
+#include "executor-pool.h"
 #include "exit-status.h"
 #include "fd-util.h"
 #include "fileio.h"
@@ -62,6 +63,7 @@
 #include "sort-util.h"
 #include "special.h"
 #include "stat-util.h"
+#include "string-intern.h"
 #include "string-table.h"
 #include "string-util.h"
 #include "strv.h"
@@ -366,6 +368,7 @@ int exec_spawn(
                 PidRef *ret) {
 
         _cleanup_free_ char *subcgroup_path = NULL, *max_log_levels = NULL, *executor_path = NULL;
+        ExecSerializationCache *cache = NULL;
         _cleanup_fdset_free_ FDSet *fdset = NULL;
         _cleanup_fclose_ FILE *f = NULL;
         int r;
@@ -420,7 +423,19 @@ int exec_spawn(
         if (!fdset)
                 return log_oom();
 
-        r = exec_serialize_invocation(f, fdset, context, command, params, runtime, cgroup_context);
+        /* The contexts are the same for every process the unit spawns until it is reloaded or its properties
+         * are changed, hence serialize them only once. Only do so for the unit's own contexts though. */
+        if (context == unit_get_exec_context(unit) && cgroup_context == unit_get_cgroup_context(unit)) {
+                if (!unit->exec_serialization_cache) {
+                        unit->exec_serialization_cache = new0(ExecSerializationCache, 1);
+                        if (!unit->exec_serialization_cache)
+                                return log_oom();
+                }
+
+                cache = unit->exec_serialization_cache;
+        }
+
+        r = exec_serialize_invocation(f, fdset, context, command, params, runtime, cgroup_context, cache);
         if (r < 0)
                 return log_unit_error_errno(unit, r, "Failed to serialize parameters: %m");
 
@@ -456,6 +471,27 @@ int exec_spawn(
          * handoff timestamp. */
         dual_timestamp_now(&start_timestamp);
 
+        /* If there's an executor waiting in the pool, hand the invocation to it, saving us the spawning. It
+         * is moved to the cgroup before it receives anything, so no user code ever runs outside of it. */
+        r = executor_pool_invoke(
+                        unit->manager,
+                        fileno(f),
+                        fdset,
+                        max_log_levels,
+                        log_target_to_string(manager_get_executor_log_target(unit->manager)),
+                        subcgroup_path,
+                        &pidref);
+        if (r < 0)
+                log_unit_debug_errno(unit, r, "Failed to hand %s to pooled executor, spawning one: %m", command->path);
+        if (r > 0) {
+                log_unit_debug(unit, "Handed %s to pooled executor " PID_FMT, command->path, pidref.pid);
+
+                exec_status_start(&command->exec_status, pidref.pid, &start_timestamp);
+
+                *ret = TAKE_PIDREF(pidref);
+                return 0;
+        }
+
         /* The executor binary is pinned, to avoid compatibility problems during upgrades. */
         r = posix_spawn_wrapper(
                         FORMAT_PROC_FD_PATH(unit->manager->executor_fd),
@@ -679,7 +715,7 @@ int exec_context_destroy_mount_ns_dir(Unit *u) {
 void exec_command_done(ExecCommand *c) {
         assert(c);
 
-        c->path = mfree(c->path);
+        c->path = string_unintern(c->path);
         c->argv = strv_free(c->argv);
 }
 
@@ -948,6 +984,7 @@ void exec_context_dump(const ExecContext *c, FILE* f, const char *prefix) {
                 "%sProtectKernelModules: %s\n"
                 "%sProtectKernelLogs: %s\n"
                 "%sProtectClock: %s\n"
+                "%sReuseMountNamespace: %s\n"
                 "%sProtectControlGroups: %s\n"
                 "%sPrivateNetwork: %s\n"
                 "%sPrivateUsers: %s\n"
@@ -973,6 +1010,7 @@ void exec_context_dump(const ExecContext *c, FILE* f, const char *prefix) {
                 prefix, yes_no(c->protect_kernel_modules),
                 prefix, yes_no(c->protect_kernel_logs),
                 prefix, yes_no(c->protect_clock),
+                prefix, yes_no(c->reuse_mount_namespace),
                 prefix, yes_no(c->protect_control_groups),
                 prefix, yes_no(c->private_network),
                 prefix, yes_no(c->private_users),
@@ -1991,7 +2029,8 @@ int exec_command_set(ExecCommand *c, const char *path, ...) {
                 return -ENOMEM;
         }
 
-        free_and_replace(c->path, p);
+        string_unintern(c->path);
+        c->path = p;
 
         return strv_free_and_replace(c->argv, l);
 }
@@ -2482,8 +2521,9 @@ int exec_runtime_make(
                 ExecSharedRuntime *shared,
                 DynamicCreds *creds,
                 ExecRuntime **ret) {
-        _cleanup_close_pair_ int ephemeral_storage_socket[2] = EBADF_PAIR;
+        _cleanup_close_pair_ int ephemeral_storage_socket[2] = EBADF_PAIR, mount_template_storage_socket[2] = EBADF_PAIR;
         _cleanup_free_ char *ephemeral = NULL;
+        bool reuse_mount_namespace;
         _cleanup_(exec_runtime_freep) ExecRuntime *rt = NULL;
         int r;
 
@@ -2491,7 +2531,10 @@ int exec_runtime_make(
         assert(context);
         assert(ret);
 
-        if (!shared && !creds && !exec_needs_ephemeral(context)) {
+        reuse_mount_namespace = context->reuse_mount_namespace &&
+                exec_needs_mount_namespace(context, /* params= */ NULL, /* runtime= */ NULL);
+
+        if (!shared && !creds && !exec_needs_ephemeral(context) && !reuse_mount_namespace) {
                 *ret = NULL;
                 return 0;
         }
@@ -2509,6 +2552,10 @@ int exec_runtime_make(
                         return -errno;
         }
 
+        if (reuse_mount_namespace &&
+            socketpair(AF_UNIX, SOCK_DGRAM|SOCK_CLOEXEC, 0, mount_template_storage_socket) < 0)
+                return -errno;
+
         rt = new(ExecRuntime, 1);
         if (!rt)
                 return -ENOMEM;
@@ -2519,6 +2566,8 @@ int exec_runtime_make(
                 .ephemeral_copy = TAKE_PTR(ephemeral),
                 .ephemeral_storage_socket[0] = TAKE_FD(ephemeral_storage_socket[0]),
                 .ephemeral_storage_socket[1] = TAKE_FD(ephemeral_storage_socket[1]),
+                .mount_template_storage_socket[0] = TAKE_FD(mount_template_storage_socket[0]),
+                .mount_template_storage_socket[1] = TAKE_FD(mount_template_storage_socket[1]),
         };
 
         *ret = TAKE_PTR(rt);
@@ -2535,6 +2584,7 @@ ExecRuntime* exec_runtime_free(ExecRuntime *rt) {
         rt->ephemeral_copy = destroy_tree(rt->ephemeral_copy);
 
         safe_close_pair(rt->ephemeral_storage_socket);
+        safe_close_pair(rt->mount_template_storage_socket);
         return mfree(rt);
 }
 
@@ -2552,6 +2602,7 @@ void exec_runtime_clear(ExecRuntime *rt) {
                 return;
 
         safe_close_pair(rt->ephemeral_storage_socket);
+        safe_close_pair(rt->mount_template_storage_socket);
         rt->ephemeral_copy = mfree(rt->ephemeral_copy);
 }
 
@@ -2569,6 +2620,7 @@ void exec_params_shallow_clear(ExecParameters *p) {
         p->exec_fd = safe_close(p->exec_fd);
         p->user_lookup_fd = -EBADF;
         p->bpf_restrict_fs_map_fd = -EBADF;
+        p->syscall_filter_fd = -EBADF;
         p->unit_id = mfree(p->unit_id);
         p->invocation_id = SD_ID128_NULL;
         p->invocation_id_string[0] = '\0';
@@ -2603,6 +2655,7 @@ void exec_params_deep_clear(ExecParameters *p) {
         p->stdin_fd = safe_close(p->stdin_fd);
         p->stdout_fd = safe_close(p->stdout_fd);
         p->stderr_fd = safe_close(p->stderr_fd);
+        p->syscall_filter_fd = safe_close(p->syscall_filter_fd);
 
         p->notify_socket = mfree(p->notify_socket);
 
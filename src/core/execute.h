@@ -139,6 +139,11 @@ struct ExecRuntime {
          * the root directory or root image. The lock prevents tmpfiles from removing the ephemeral snapshot
          * until we're done using it. */
         int ephemeral_storage_socket[2];
+
+        /* An AF_UNIX socket pair that contains a datagram with a file descriptor referring to a template of
+         * the mount namespace, together with a hash of the configuration it was set up for. Only used if
+         * ReuseMountNamespace= is on. */
+        int mount_template_storage_socket[2];
 };
 
 typedef enum ExecDirectoryType {
@@ -323,6 +328,7 @@ struct ExecContext {
         bool protect_kernel_modules;
         bool protect_kernel_logs;
         bool protect_clock;
+        bool reuse_mount_namespace;
         bool protect_control_groups;
         ProtectSystem protect_system;
         ProtectHome protect_home;
@@ -458,6 +464,9 @@ struct ExecParameters {
 
         int bpf_restrict_fs_map_fd;
 
+        /* Precompiled SystemCallFilter= programs, owned by the manager */
+        int syscall_filter_fd;
+
         /* Used for logging in the executor functions */
         char *unit_id;
         sd_id128_t invocation_id;
@@ -474,6 +483,7 @@ struct ExecParameters {
                 .bpf_restrict_fs_map_fd = -EBADF, \
                 .user_lookup_fd         = -EBADF, \
                 .handoff_timestamp_fd   = -EBADF, \
+                .syscall_filter_fd      = -EBADF, \
         }
 
 #include "unit.h"
@@ -0,0 +1,430 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "sd-event.h"
+
+#include "alloc-util.h"
+#include "cgroup-setup.h"
+#include "cgroup-util.h"
+#include "executor-pool.h"
+#include "fd-util.h"
+#include "fileio.h"
+#include "iovec-util.h"
+#include "log.h"
+#include "manager.h"
+#include "parse-util.h"
+#include "process-util.h"
+#include "socket-util.h"
+#include "stdio-util.h"
+#include "string-util.h"
+#include "strv.h"
+
+/* Spawning systemd-executor for every process we start means a clone() and an execve() of the executor,
+ * before it can even start to deserialize the invocation. If ExecutorPoolSize= is set we keep that many
+ * executors around that were spawned ahead of time, each waiting on a SOCK_SEQPACKET socket. An invocation
+ * is then handed to one of them in a single message, whose payload is
+ *
+ *         log-level=LEVELS
+ *         log-target=TARGET
+ *         fd=N
+ *         …
+ *
+ * with the serialization fd as the first fd attached, followed by the fds referenced by the serialization,
+ * in the order of the fd= lines, which carry the numbers they have in the manager. The executor moves the
+ * fds to these numbers and then proceeds as if it had been started with --deserialize=. */
+
+int executor_pool_send_invocation(
+                int fd,
+                int serialization_fd,
+                FDSet *fds,
+                const char *log_levels,
+                const char *log_target) {
+
+        _cleanup_free_ char *text = NULL;
+        _cleanup_free_ int *array = NULL;
+        size_t n = 0;
+        ssize_t k;
+        int i, r;
+
+        assert(fd >= 0);
+        assert(serialization_fd >= 0);
+        assert(log_levels);
+        assert(log_target);
+
+        if (fdset_size(fds) >= EXECUTOR_POOL_FDS_MAX)
+                return -E2BIG;
+
+        array = new(int, fdset_size(fds) + 1);
+        if (!array)
+                return -ENOMEM;
+
+        text = strjoin("log-level=", log_levels, "\n"
+                       "log-target=", log_target, "\n");
+        if (!text)
+                return -ENOMEM;
+
+        array[n++] = serialization_fd;
+
+        FDSET_FOREACH(i, fds) {
+                r = strextendf(&text, "fd=%i\n", i);
+                if (r < 0)
+                        return r;
+
+                array[n++] = i;
+        }
+
+        if (strlen(text) > EXECUTOR_POOL_MESSAGE_MAX)
+                return -E2BIG;
+
+        k = send_many_fds_iov(fd, array, n, &IOVEC_MAKE_STRING(text), 1, MSG_DONTWAIT|MSG_NOSIGNAL);
+        if (k < 0)
+                return (int) k;
+
+        return 0;
+}
+
+int executor_pool_receive_invocation(
+                int fd,
+                FILE **ret_serialization,
+                char **ret_log_levels,
+                char **ret_log_target) {
+
+        CMSG_BUFFER_TYPE(CMSG_SPACE(sizeof(int) * EXECUTOR_POOL_FDS_MAX)) control;
+        char buf[EXECUTOR_POOL_MESSAGE_MAX + 1];
+        struct iovec iovec = IOVEC_MAKE(buf, sizeof(buf) - 1);
+        struct msghdr msghdr = {
+                .msg_iov = &iovec,
+                .msg_iovlen = 1,
+                .msg_control = &control,
+                .msg_controllen = sizeof(control),
+        };
+        _cleanup_free_ char *log_levels = NULL, *log_target = NULL;
+        _cleanup_free_ int *fds = NULL, *numbers = NULL;
+        _cleanup_strv_free_ char **lines = NULL;
+        _cleanup_close_ int socket_fd = fd;
+        size_t n_fds = 0, n_numbers = 0;
+        struct cmsghdr *cmsg;
+        int max_number = STDERR_FILENO, r;
+        ssize_t n;
+        FILE *f;
+
+        assert(fd >= 0);
+        assert(ret_serialization);
+        assert(ret_log_levels);
+        assert(ret_log_target);
+
+        /* Waits for an invocation on the socket, which is closed in any case, and moves the fds passed along
+         * to the numbers they had in the manager, replacing whatever fd happened to have that number
+         * before. Hence the caller should have no fds open besides stdin, stdout and stderr at this point.
+         * Returns 0 if the manager closed the socket without sending anything, 1 otherwise. */
+
+        n = recvmsg_safe(socket_fd, &msghdr, MSG_CMSG_CLOEXEC|MSG_TRUNC);
+        if (n < 0)
+                return (int) n;
+
+        socket_fd = safe_close(socket_fd);
+
+        cmsg = cmsg_find(&msghdr, SOL_SOCKET, SCM_RIGHTS, (socklen_t) -1);
+        if (cmsg) {
+                n_fds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+
+                fds = newdup(int, CMSG_TYPED_DATA(cmsg, int), n_fds);
+                if (!fds) {
+                        close_many(CMSG_TYPED_DATA(cmsg, int), n_fds);
+                        return -ENOMEM;
+                }
+        }
+
+        /* From here on the fds are ours, make sure to close them if anything goes wrong */
+        r = 0;
+
+        if (n == 0 && n_fds == 0)
+                goto finish;
+
+        if ((size_t) n >= sizeof(buf) || FLAGS_SET(msghdr.msg_flags, MSG_TRUNC) || memchr(buf, 0, n) || n_fds == 0) {
+                r = -EBADMSG;
+                goto finish;
+        }
+
+        buf[n] = 0;
+
+        lines = strv_split_newlines(buf);
+        if (!lines) {
+                r = -ENOMEM;
+                goto finish;
+        }
+
+        STRV_FOREACH(l, lines) {
+                const char *v;
+
+                if ((v = startswith(*l, "log-level="))) {
+                        r = free_and_strdup(&log_levels, v);
+                        if (r < 0)
+                                goto finish;
+
+                } else if ((v = startswith(*l, "log-target="))) {
+                        r = free_and_strdup(&log_target, v);
+                        if (r < 0)
+                                goto finish;
+
+                } else if ((v = startswith(*l, "fd="))) {
+                        int k;
+
+                        k = parse_fd(v);
+                        if (k < 0 || k <= STDERR_FILENO) {
+                                r = -EBADMSG;
+                                goto finish;
+                        }
+
+                        /* Every number may only be used once */
+                        for (size_t j = 0; j < n_numbers; j++)
+                                if (numbers[j] == k) {
+                                        r = -EBADMSG;
+                                        goto finish;
+                                }
+
+                        if (!GREEDY_REALLOC(numbers, n_numbers + 1)) {
+                                r = -ENOMEM;
+                                goto finish;
+                        }
+
+                        numbers[n_numbers++] = k;
+                        max_number = MAX(max_number, k);
+                } else {
+                        r = -EBADMSG;
+                        goto finish;
+                }
+        }
+
+        if (!log_levels || !log_target || n_numbers != n_fds - 1) {
+                r = -EBADMSG;
+                goto finish;
+        }
+
+        /* First move all fds above the highest number we want to use, so that none of them occupies the
+         * number another one shall get, then move them to their numbers, without O_CLOEXEC, the same way
+         * they would have been inherited from the manager. */
+        for (size_t i = 0; i < n_fds; i++) {
+                int k;
+
+                k = fcntl(fds[i], F_DUPFD_CLOEXEC, max_number + 1);
+                if (k < 0) {
+                        r = -errno;
+                        goto finish;
+                }
+
+                safe_close(fds[i]);
+                fds[i] = k;
+        }
+
+        for (size_t i = 1; i < n_fds; i++) {
+                if (dup2(fds[i], numbers[i - 1]) < 0) {
+                        r = -errno;
+                        goto finish;
+                }
+
+                fds[i] = safe_close(fds[i]);
+        }
+
+        f = take_fdopen(&fds[0], "r");
+        if (!f) {
+                r = -errno;
+                goto finish;
+        }
+
+        *ret_serialization = f;
+        *ret_log_levels = TAKE_PTR(log_levels);
+        *ret_log_target = TAKE_PTR(log_target);
+        r = 1;
+
+finish:
+        close_many(fds, n_fds);
+        return r;
+}
+
+static void executor_pool_entry_done(ExecutorPoolEntry *e) {
+        assert(e);
+
+        /* Closing the socket tells the executor to exit, we'll reap it when it did */
+        e->fd = safe_close(e->fd);
+        pidref_done(&e->pidref);
+}
+
+static bool executor_pool_enabled(Manager *m) {
+        assert(m);
+
+        return m->executor_pool_size > 0 &&
+                m->executor_fd >= 0 &&
+                m->objective == MANAGER_OK &&
+                !MANAGER_IS_TEST_RUN(m);
+}
+
+static int executor_pool_spawn_one(Manager *m) {
+        _cleanup_free_ char *executor_path = NULL, *max_log_levels = NULL;
+        _cleanup_(pidref_done) PidRef pidref = PIDREF_NULL;
+        _cleanup_close_pair_ int pair[2] = EBADF_PAIR;
+        char fd_number[DECIMAL_STR_MAX(int)];
+        int r;
+
+        assert(m);
+
+        if (!GREEDY_REALLOC(m->executor_pool, m->n_executor_pool + 1))
+                return -ENOMEM;
+
+        if (socketpair(AF_UNIX, SOCK_SEQPACKET|SOCK_CLOEXEC, 0, pair) < 0)
+                return -errno;
+
+        r = fd_cloexec(pair[1], false);
+        if (r < 0)
+                return r;
+
+        r = fd_get_path(m->executor_fd, &executor_path);
+        if (r < 0)
+                return r;
+
+        /* The log level and target are sent along with the invocation, these are only used until then */
+        r = log_max_levels_to_string(log_get_max_level(), &max_log_levels);
+        if (r < 0)
+                return r;
+
+        xsprintf(fd_number, "%i", pair[1]);
+
+        r = posix_spawn_wrapper(
+                        FORMAT_PROC_FD_PATH(m->executor_fd),
+                        STRV_MAKE(executor_path,
+                                  "--pool", fd_number,
+                                  "--log-level", max_log_levels,
+                                  "--log-target", log_target_to_string(manager_get_executor_log_target(m))),
+                        environ,
+                        /* cgroup= */ NULL,
+                        &pidref);
+        if (r < 0)
+                return r;
+
+        log_debug("Spawned pooled executor as " PID_FMT ".", pidref.pid);
+
+        m->executor_pool[m->n_executor_pool++] = (ExecutorPoolEntry) {
+                .pidref = TAKE_PIDREF(pidref),
+                .fd = TAKE_FD(pair[0]),
+        };
+
+        return 0;
+}
+
+static int executor_pool_dispatch_refill(sd_event_source *source, void *userdata) {
+        Manager *m = ASSERT_PTR(userdata);
+        unsigned size;
+        int r;
+
+        size = executor_pool_enabled(m) ? MIN(m->executor_pool_size, EXECUTOR_POOL_SIZE_MAX) : 0;
+
+        /* The pool might have been shrunk by a reload */
+        while (m->n_executor_pool > size)
+                executor_pool_entry_done(m->executor_pool + --m->n_executor_pool);
+
+        while (m->n_executor_pool < size) {
+                r = executor_pool_spawn_one(m);
+                if (r < 0) {
+                        log_warning_errno(r, "Failed to spawn pooled executor, ignoring: %m");
+                        break;
+                }
+        }
+
+        return 0;
+}
+
+int executor_pool_schedule_refill(Manager *m) {
+        int r;
+
+        assert(m);
+
+        if (m->n_executor_pool == 0 && !executor_pool_enabled(m))
+                return 0;
+
+        if (!m->executor_pool_event_source) {
+                r = sd_event_add_defer(m->event, &m->executor_pool_event_source, executor_pool_dispatch_refill, m);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to allocate executor pool event source: %m");
+
+                /* Refill the pool only once everything else is done, it's not urgent */
+                r = sd_event_source_set_priority(m->executor_pool_event_source, EVENT_PRIORITY_EXECUTOR_POOL);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to set priority of executor pool event source: %m");
+
+                (void) sd_event_source_set_description(m->executor_pool_event_source, "manager-executor-pool");
+        }
+
+        r = sd_event_source_set_enabled(m->executor_pool_event_source, SD_EVENT_ONESHOT);
+        if (r < 0)
+                return log_error_errno(r, "Failed to enable executor pool event source: %m");
+
+        return 0;
+}
+
+int executor_pool_invoke(
+                Manager *m,
+                int serialization_fd,
+                FDSet *fds,
+                const char *log_levels,
+                const char *log_target,
+                const char *cgroup,
+                PidRef *ret) {
+
+        int r;
+
+        assert(m);
+        assert(ret);
+
+        /* Hands the invocation to a pooled executor, if there is one. Returns 1 if so, 0 if the caller
+         * shall spawn an executor itself. */
+
+        if (!executor_pool_enabled(m))
+                return 0;
+
+        (void) executor_pool_schedule_refill(m);
+
+        if (fdset_size(fds) >= EXECUTOR_POOL_FDS_MAX)
+                return 0;
+
+        while (m->n_executor_pool > 0) {
+                _cleanup_(executor_pool_entry_done) ExecutorPoolEntry e = m->executor_pool[--m->n_executor_pool];
+
+                /* Move it to the right cgroup first, so that it never runs anything outside of it */
+                if (cgroup) {
+                        r = cg_attach(SYSTEMD_CGROUP_CONTROLLER, cgroup, e.pidref.pid);
+                        if (r < 0) {
+                                (void) pidref_kill(&e.pidref, SIGKILL);
+                                return log_debug_errno(r, "Failed to move pooled executor " PID_FMT " to cgroup '%s': %m",
+                                                       e.pidref.pid, cgroup);
+                        }
+                }
+
+                r = executor_pool_send_invocation(e.fd, serialization_fd, fds, log_levels, log_target);
+                if (r < 0) {
+                        /* Most likely it died in the meantime, try the next one */
+                        log_debug_errno(r, "Failed to send invocation to pooled executor " PID_FMT ", ignoring: %m",
+                                        e.pidref.pid);
+                        (void) pidref_kill(&e.pidref, SIGKILL);
+                        continue;
+                }
+
+                *ret = TAKE_PIDREF(e.pidref);
+                return 1;
+        }
+
+        return 0;
+}
+
+void executor_pool_flush(Manager *m) {
+        assert(m);
+
+        FOREACH_ARRAY(e, m->executor_pool, m->n_executor_pool)
+                executor_pool_entry_done(e);
+
+        m->executor_pool = mfree(m->executor_pool);
+        m->n_executor_pool = 0;
+        m->executor_pool_event_source = sd_event_source_disable_unref(m->executor_pool_event_source);
+}
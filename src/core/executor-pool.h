@@ -0,0 +1,43 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+#pragma once
+
+#include <stdio.h>
+
+#include "fdset.h"
+#include "pidref.h"
+
+typedef struct Manager Manager;
+
+/* The kernel accepts at most SCM_MAX_FD = 253 fds per message, one of which is the serialization */
+#define EXECUTOR_POOL_FDS_MAX 253U
+#define EXECUTOR_POOL_MESSAGE_MAX (8U*1024U)
+#define EXECUTOR_POOL_SIZE_MAX 64U
+
+/* An executor spawned ahead of time, waiting on its socket for an invocation */
+typedef struct ExecutorPoolEntry {
+        PidRef pidref;
+        int fd;
+} ExecutorPoolEntry;
+
+int executor_pool_send_invocation(
+                int fd,
+                int serialization_fd,
+                FDSet *fds,
+                const char *log_levels,
+                const char *log_target);
+int executor_pool_receive_invocation(
+                int fd,
+                FILE **ret_serialization,
+                char **ret_log_levels,
+                char **ret_log_target);
+
+int executor_pool_invoke(
+                Manager *m,
+                int serialization_fd,
+                FDSet *fds,
+                const char *log_levels,
+                const char *log_target,
+                const char *cgroup,
+                PidRef *ret);
+int executor_pool_schedule_refill(Manager *m);
+void executor_pool_flush(Manager *m);
@@ -11,6 +11,7 @@
 #include "exec-invoke.h"
 #include "execute-serialize.h"
 #include "execute.h"
+#include "executor-pool.h"
 #include "exit-status.h"
 #include "fdset.h"
 #include "fd-util.h"
@@ -23,8 +24,10 @@
 #include "static-destruct.h"
 
 static FILE *arg_serialization = NULL;
+static int arg_pool_fd = -EBADF;
 
 STATIC_DESTRUCTOR_REGISTER(arg_serialization, fclosep);
+STATIC_DESTRUCTOR_REGISTER(arg_pool_fd, closep);
 
 static int help(void) {
         _cleanup_free_ char *link = NULL;
@@ -48,6 +51,7 @@ static int help(void) {
                "     --log-location=BOOL   Include code location in messages\n"
                "     --log-time=BOOL       Prefix messages with current time\n"
                "     --deserialize=FD      Deserialize process config from FD\n"
+               "     --pool=FD             Wait for process config on socket FD\n"
                "\nSee the %s for details.\n",
                program_invocation_short_name,
                ansi_highlight(),
@@ -62,6 +66,7 @@ static int parse_argv(int argc, char *argv[]) {
                 COMMON_GETOPT_ARGS,
                 ARG_VERSION,
                 ARG_DESERIALIZE,
+                ARG_POOL,
         };
 
         static const struct option options[] = {
@@ -73,6 +78,7 @@ static int parse_argv(int argc, char *argv[]) {
                 { "help",           no_argument,       NULL, 'h'                },
                 { "version",        no_argument,       NULL, ARG_VERSION        },
                 { "deserialize",    required_argument, NULL, ARG_DESERIALIZE    },
+                { "pool",           required_argument, NULL, ARG_POOL           },
                 {}
         };
 
@@ -159,6 +165,21 @@ static int parse_argv(int argc, char *argv[]) {
                         break;
                 }
 
+                case ARG_POOL: {
+                        _cleanup_close_ int fd = -EBADF;
+
+                        fd = parse_fd(optarg);
+                        if (fd < 0)
+                                return log_error_errno(fd, "Failed to parse pool socket fd \"%s\": %m", optarg);
+
+                        r = fd_cloexec(fd, /* cloexec= */ true);
+                        if (r < 0)
+                                return log_error_errno(r, "Failed to set pool socket fd %d to close-on-exec: %m", fd);
+
+                        close_and_replace(arg_pool_fd, fd);
+                        break;
+                }
+
                 case '?':
                         return -EINVAL;
 
@@ -166,8 +187,8 @@ static int parse_argv(int argc, char *argv[]) {
                         assert_not_reached();
                 }
 
-        if (!arg_serialization)
-                return log_error_errno(SYNTHETIC_ERRNO(EINVAL), "No serialization fd specified.");
+        if (!arg_serialization == (arg_pool_fd < 0))
+                return log_error_errno(SYNTHETIC_ERRNO(EINVAL), "Exactly one of --deserialize= and --pool= must be specified.");
 
         return 1 /* work to do */;
 }
@@ -185,6 +206,7 @@ static int run(int argc, char *argv[]) {
         _cleanup_(dynamic_creds_done) DynamicCreds dynamic_creds = {};
         _cleanup_(exec_runtime_clear) ExecRuntime runtime = {
                 .ephemeral_storage_socket = EBADF_PAIR,
+                .mount_template_storage_socket = EBADF_PAIR,
                 .shared = &shared,
                 .dynamic_creds = &dynamic_creds,
         };
@@ -202,6 +224,29 @@ static int run(int argc, char *argv[]) {
         if (r <= 0)
                 return r;
 
+        if (arg_pool_fd >= 0) {
+                _cleanup_free_ char *log_levels = NULL, *log_target = NULL;
+
+                /* We were spawned ahead of time, wait for the manager to tell us what to do. The fds are
+                 * moved to the numbers they had in the manager, hence make sure the log fds are out of
+                 * their way. */
+                log_close();
+
+                r = executor_pool_receive_invocation(TAKE_FD(arg_pool_fd), &arg_serialization, &log_levels, &log_target);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to receive invocation: %m");
+                if (r == 0) /* The manager doesn't need us anymore */
+                        return 0;
+
+                r = log_set_max_level_from_string(log_levels);
+                if (r < 0)
+                        log_warning_errno(r, "Failed to parse log level \"%s\", ignoring: %m", log_levels);
+
+                r = log_set_target_from_string(log_target);
+                if (r < 0)
+                        log_warning_errno(r, "Failed to parse log target \"%s\", ignoring: %m", log_target);
+        }
+
         /* Now that we know the intended log target, allow IPC and open the final log target. */
         log_set_prohibit_ipc(false);
         log_open();
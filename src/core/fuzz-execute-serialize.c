@@ -37,6 +37,7 @@ static void exec_fuzz_one(FILE *f, FDSet *fdset) {
         };
         ExecRuntime runtime = {
                 .ephemeral_storage_socket = EBADF_PAIR,
+                .mount_template_storage_socket = EBADF_PAIR,
                 .shared = &shared,
                 .dynamic_creds = &dynamic_creds,
         };
@@ -45,7 +46,7 @@ static void exec_fuzz_one(FILE *f, FDSet *fdset) {
         cgroup_context_init(&cgroup_context);
 
         (void) exec_deserialize_invocation(f, fdset, &exec_context, &command, &params, &runtime, &cgroup_context);
-        (void) exec_serialize_invocation(f, fdset, &exec_context, &command, &params, &runtime, &cgroup_context);
+        (void) exec_serialize_invocation(f, fdset, &exec_context, &command, &params, &runtime, &cgroup_context, /* cache= */ NULL);
         (void) exec_deserialize_invocation(f, fdset, &exec_context, &command, &params, &runtime, &cgroup_context);
 
         /* We definitely didn't provide valid FDs during deserialization, so
@@ -57,6 +58,7 @@ static void exec_fuzz_one(FILE *f, FDSet *fdset) {
         params.exec_fd = -EBADF;
         params.user_lookup_fd = -EBADF;
         params.bpf_restrict_fs_map_fd = -EBADF;
+        params.syscall_filter_fd = -EBADF;
         if (!params.fds)
                 params.n_socket_fds = params.n_storage_fds = 0;
         for (size_t i = 0; params.fds && i < params.n_socket_fds + params.n_storage_fds; i++)
@@ -69,6 +71,7 @@ static void exec_fuzz_one(FILE *f, FDSet *fdset) {
         dynamic_user_free(dynamic_creds.user);
         free(runtime.ephemeral_copy);
         safe_close_pair(runtime.ephemeral_storage_socket);
+        safe_close_pair(runtime.mount_template_storage_socket);
 }
 
 int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
@@ -0,0 +1,623 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "alloc-util.h"
+#include "conf-files.h"
+#include "copy.h"
+#include "dirent-util.h"
+#include "env-file.h"
+#include "env-util.h"
+#include "fd-util.h"
+#include "fileio.h"
+#include "generator.h"
+#include "generator-cache.h"
+#include "hexdecoct.h"
+#include "mkdir.h"
+#include "parse-util.h"
+#include "path-util.h"
+#include "process-util.h"
+#include "rm-rf.h"
+#include "sha256.h"
+#include "signal-util.h"
+#include "string-util.h"
+#include "strv.h"
+
+/* Every generator is run with output directories of its own below the cache directory, and its output is
+ * merged into the real generator directories afterwards. A generator may declare the files it reads with
+ * generator_declare_input(), which records them in a file in its cache entry. If it did so and exited
+ * successfully, a stamp consisting of these records, the state of the generator binary and a digest of its
+ * environment is kept with its output. If the stamp still matches the next time generators are run, on
+ * daemon-reload for example, the generator isn't run again, and its previous output is merged instead.
+ * Generators that don't declare their inputs are always run. */
+
+static const char* const output_subdirs[] = {
+        "normal",
+        "early",
+        "late",
+};
+
+typedef struct GeneratorRun {
+        const char *path;
+        char *entry;
+        char *header;          /* The environment digest and binary state, i.e. the first part of the stamp */
+        pid_t pid;
+        GeneratorResult result;
+} GeneratorRun;
+
+static void generator_run_free_many(GeneratorRun *runs, size_t n) {
+        FOREACH_ARRAY(run, runs, n) {
+                free(run->entry);
+                free(run->header);
+                free(run->result.name);
+        }
+
+        free(runs);
+}
+
+void generator_result_free_many(GeneratorResult *results, size_t n) {
+        FOREACH_ARRAY(result, results, n)
+                free(result->name);
+
+        free(results);
+}
+
+static int environment_digest(char **ret) {
+        _cleanup_strv_free_ char **l = NULL;
+        _cleanup_free_ char *joined = NULL;
+        uint8_t digest[SHA256_DIGEST_SIZE];
+        char *h;
+
+        assert(ret);
+
+        l = strv_copy(environ);
+        if (!l)
+                return -ENOMEM;
+
+        joined = strv_join(strv_sort(l), "\n");
+        if (!joined)
+                return -ENOMEM;
+
+        sha256_direct(joined, strlen(joined), digest);
+
+        h = hexmem(digest, sizeof(digest));
+        if (!h)
+                return -ENOMEM;
+
+        *ret = h;
+        return 0;
+}
+
+static int generator_stamp_header(const char *path, const char *env_digest, char **ret) {
+        _cleanup_free_ char *s = NULL;
+        int r;
+
+        assert(path);
+        assert(env_digest);
+        assert(ret);
+
+        s = strjoin("environment ", env_digest, "\n");
+        if (!s)
+                return -ENOMEM;
+
+        r = generator_stamp_file(&s, path);
+        if (r < 0)
+                return r;
+
+        *ret = TAKE_PTR(s);
+        return 0;
+}
+
+static int generator_cache_valid(GeneratorRun *run) {
+        _cleanup_strv_free_ char **lines = NULL;
+        _cleanup_free_ char *p = NULL, *old = NULL, *new = NULL;
+        int r;
+
+        assert(run);
+        assert(run->header);
+
+        p = path_join(run->entry, "stamp");
+        if (!p)
+                return -ENOMEM;
+
+        r = read_full_file(p, &old, NULL);
+        if (r == -ENOENT)
+                return false;
+        if (r < 0)
+                return r;
+
+        if (!startswith(old, run->header))
+                return false;
+
+        lines = strv_split_newlines(old + strlen(run->header));
+        if (!lines)
+                return -ENOMEM;
+
+        new = strdup(run->header);
+        if (!new)
+                return -ENOMEM;
+
+        /* Record the current state of all inputs listed in the stamp, and see if anything changed */
+        STRV_FOREACH(line, lines) {
+                const char *space = strchr(*line, ' ');
+
+                if (!space || !path_is_absolute(space + 1))
+                        return -EBADMSG;
+
+                r = generator_stamp_file(&new, space + 1);
+                if (r < 0)
+                        return r;
+        }
+
+        return streq(old, new);
+}
+
+static int generator_cache_update(GeneratorRun *run) {
+        _cleanup_free_ char *p = NULL, *inputs = NULL, *stamp = NULL;
+        int r;
+
+        assert(run);
+
+        if (run->result.exit_status != 0)
+                return 0;
+
+        p = path_join(run->entry, "inputs");
+        if (!p)
+                return -ENOMEM;
+
+        r = read_full_file(p, &inputs, NULL);
+        if (r == -ENOENT) /* Didn't declare its inputs, hence needs to be run every time */
+                return 0;
+        if (r < 0)
+                return r;
+
+        stamp = strjoin(run->header, inputs);
+        if (!stamp)
+                return -ENOMEM;
+
+        p = mfree(p);
+        p = path_join(run->entry, "stamp");
+        if (!p)
+                return -ENOMEM;
+
+        return write_string_file(p, stamp, WRITE_STRING_FILE_CREATE|WRITE_STRING_FILE_ATOMIC|WRITE_STRING_FILE_AVOID_NEWLINE);
+}
+
+static int generator_status_write(const char *entry, const GeneratorResult *result) {
+        _cleanup_free_ char *p = NULL;
+
+        assert(entry);
+        assert(result);
+
+        p = path_join(entry, "status");
+        if (!p)
+                return -ENOMEM;
+
+        return write_string_filef(
+                        p,
+                        WRITE_STRING_FILE_CREATE|WRITE_STRING_FILE_ATOMIC,
+                        "START_USEC=" USEC_FMT "\n"
+                        "DURATION_USEC=" USEC_FMT "\n"
+                        "EXIT_STATUS=%i\n"
+                        "REUSED=%s",
+                        result->start,
+                        result->duration,
+                        result->exit_status,
+                        one_zero(result->reused));
+}
+
+static int generator_status_read(const char *entry, GeneratorResult *result) {
+        _cleanup_free_ char *p = NULL, *start = NULL, *duration = NULL, *exit_status = NULL, *reused = NULL;
+        int r;
+
+        assert(entry);
+        assert(result);
+
+        p = path_join(entry, "status");
+        if (!p)
+                return -ENOMEM;
+
+        r = parse_env_file(NULL, p,
+                           "START_USEC", &start,
+                           "DURATION_USEC", &duration,
+                           "EXIT_STATUS", &exit_status,
+                           "REUSED", &reused);
+        if (r < 0)
+                return r;
+
+        if (!start || !duration || !exit_status || !reused)
+                return -EBADMSG;
+
+        r = safe_atou64(start, &result->start);
+        if (r < 0)
+                return r;
+
+        r = safe_atou64(duration, &result->duration);
+        if (r < 0)
+                return r;
+
+        r = safe_atoi(exit_status, &result->exit_status);
+        if (r < 0)
+                return r;
+
+        r = parse_boolean(reused);
+        if (r < 0)
+                return r;
+        result->reused = r;
+
+        return 0;
+}
+
+static int generator_cache_list(const char *cache_dir, char ***ret) {
+        _cleanup_strv_free_ char **l = NULL;
+        _cleanup_closedir_ DIR *d = NULL;
+        int r;
+
+        assert(cache_dir);
+        assert(ret);
+
+        d = opendir(cache_dir);
+        if (!d)
+                return -errno;
+
+        FOREACH_DIRENT(de, d, return -errno) {
+                if (de->d_type != DT_DIR)
+                        continue;
+
+                r = strv_extend(&l, de->d_name);
+                if (r < 0)
+                        return r;
+        }
+
+        *ret = strv_sort(TAKE_PTR(l));
+        return 0;
+}
+
+static void generator_cache_prune(const char *cache_dir, const GeneratorRun *runs, size_t n_runs) {
+        _cleanup_strv_free_ char **l = NULL;
+
+        assert(cache_dir);
+
+        /* Remove the entries of generators that are gone */
+
+        if (generator_cache_list(cache_dir, &l) < 0)
+                return;
+
+        STRV_FOREACH(name, l) {
+                bool found = false;
+
+                FOREACH_ARRAY(run, runs, n_runs)
+                        if (streq(run->result.name, *name)) {
+                                found = true;
+                                break;
+                        }
+
+                if (!found) {
+                        _cleanup_free_ char *p = path_join(cache_dir, *name);
+
+                        if (p)
+                                (void) rm_rf(p, REMOVE_ROOT|REMOVE_PHYSICAL);
+                }
+        }
+}
+
+static int generator_spawn(GeneratorRun *run) {
+        _cleanup_free_ char *inputs = NULL;
+        char *argv[ELEMENTSOF(output_subdirs) + 2] = {};
+        int r;
+
+        assert(run);
+
+        (void) rm_rf(run->entry, REMOVE_ROOT|REMOVE_PHYSICAL);
+
+        argv[0] = (char*) run->path;
+        for (size_t i = 0; i < ELEMENTSOF(output_subdirs); i++) {
+                argv[i + 1] = path_join(run->entry, output_subdirs[i]);
+                if (!argv[i + 1]) {
+                        r = log_oom();
+                        goto finish;
+                }
+
+                r = mkdir_p(argv[i + 1], 0755);
+                if (r < 0) {
+                        log_error_errno(r, "Failed to create directory '%s': %m", argv[i + 1]);
+                        goto finish;
+                }
+        }
+
+        inputs = path_join(run->entry, "inputs");
+        if (!inputs) {
+                r = log_oom();
+                goto finish;
+        }
+
+        log_debug("About to execute %s", run->path);
+
+        run->result.start = now(CLOCK_MONOTONIC);
+
+        r = safe_fork("(direxec)",
+                      FORK_RESET_SIGNALS|FORK_DEATHSIG_SIGTERM|FORK_LOG|FORK_RLIMIT_NOFILE_SAFE|FORK_CLOSE_ALL_FDS,
+                      &run->pid);
+        if (r < 0)
+                goto finish;
+        if (r == 0) {
+                if (setenv(GENERATOR_INPUTS_ENV, inputs, /* overwrite= */ true) < 0)
+                        log_warning_errno(errno, "Failed to set $" GENERATOR_INPUTS_ENV ", ignoring: %m");
+
+                r = setenv_systemd_exec_pid(false);
+                if (r < 0)
+                        log_warning_errno(r, "Failed to set $SYSTEMD_EXEC_PID, ignoring: %m");
+
+                execv(run->path, argv);
+                log_error_errno(errno, "Failed to execute %s: %m", run->path);
+                _exit(EXIT_FAILURE);
+        }
+
+        r = 0;
+
+finish:
+        for (size_t i = 1; i < ELEMENTSOF(argv); i++)
+                free(argv[i]);
+
+        return r;
+}
+
+static void generator_run_finished(GeneratorRun *run, const siginfo_t *si) {
+        assert(run);
+        assert(si);
+
+        run->pid = 0;
+        run->result.duration = usec_sub_unsigned(now(CLOCK_MONOTONIC), run->result.start);
+
+        if (si->si_code == CLD_EXITED) {
+                run->result.exit_status = si->si_status;
+
+                if (si->si_status != 0)
+                        log_warning("%s failed with exit status %i, ignoring.", run->path, si->si_status);
+        } else {
+                run->result.exit_status = -1;
+                log_warning("%s terminated by signal %s, ignoring.", run->path, signal_to_string(si->si_status));
+        }
+
+        log_debug("%s finished after %s.", run->path, FORMAT_TIMESPAN(run->result.duration, USEC_PER_MSEC));
+}
+
+static int generator_cache_execute_child(
+                char * const *paths,
+                const char *cache_dir,
+                char * const *output_dirs,
+                char * const *env,
+                usec_t timeout) {
+
+        _cleanup_free_ char *env_digest = NULL;
+        GeneratorRun *runs = NULL;
+        size_t n_runs = 0, n_running = 0;
+        sigset_t mask;
+        usec_t until;
+        int r;
+
+        CLEANUP_ARRAY(runs, n_runs, generator_run_free_many);
+
+        STRV_FOREACH(e, env)
+                if (putenv(*e) != 0)
+                        return log_error_errno(errno, "Failed to set environment variable: %m");
+
+        r = environment_digest(&env_digest);
+        if (r < 0)
+                return log_error_errno(r, "Failed to hash generator environment: %m");
+
+        r = mkdir_p(cache_dir, 0755);
+        if (r < 0)
+                return log_error_errno(r, "Failed to create directory '%s': %m", cache_dir);
+
+        runs = new0(GeneratorRun, strv_length(paths));
+        if (!runs)
+                return log_oom();
+
+        STRV_FOREACH(path, paths) {
+                GeneratorRun *run = runs + n_runs++;
+
+                run->path = *path;
+
+                r = path_extract_filename(*path, &run->result.name);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to extract filename from path '%s': %m", *path);
+
+                run->entry = path_join(cache_dir, run->result.name);
+                if (!run->entry)
+                        return log_oom();
+
+                r = generator_stamp_header(*path, env_digest, &run->header);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to stat %s: %m", *path);
+        }
+
+        generator_cache_prune(cache_dir, runs, n_runs);
+
+        assert_se(sigemptyset(&mask) >= 0);
+        assert_se(sigaddset(&mask, SIGCHLD) >= 0);
+        assert_se(sigprocmask(SIG_BLOCK, &mask, NULL) >= 0);
+
+        FOREACH_ARRAY(run, runs, n_runs) {
+                r = generator_cache_valid(run);
+                if (r < 0)
+                        log_debug_errno(r, "Failed to check whether the output of %s can be reused, running it: %m", run->path);
+                else if (r > 0) {
+                        r = generator_status_read(run->entry, &run->result);
+                        if (r >= 0) {
+                                log_debug("Inputs of %s unchanged, reusing its previous output.", run->path);
+                                run->result.reused = true;
+                                continue;
+                        }
+
+                        log_debug_errno(r, "Failed to read previous status of %s, running it: %m", run->path);
+                }
+
+                run->result.reused = false;
+                run->result.exit_status = -1;
+
+                if (generator_spawn(run) < 0)
+                        continue;
+
+                n_running++;
+        }
+
+        /* Wait for the generators in the order they finish in, so that we know how long each one took */
+        until = usec_add(now(CLOCK_MONOTONIC), timeout);
+        while (n_running > 0) {
+                siginfo_t si = {};
+                usec_t n;
+
+                if (waitid(P_ALL, 0, &si, WEXITED|WNOHANG) < 0)
+                        return log_error_errno(errno, "Failed to wait for generators: %m");
+                if (si.si_pid > 0) {
+                        FOREACH_ARRAY(run, runs, n_runs)
+                                if (run->pid == si.si_pid) {
+                                        generator_run_finished(run, &si);
+                                        n_running--;
+                                        break;
+                                }
+
+                        continue;
+                }
+
+                n = now(CLOCK_MONOTONIC);
+                if (n >= until)
+                        break;
+
+                if (sigtimedwait(&mask, NULL, until == USEC_INFINITY ? NULL : TIMESPEC_STORE(until - n)) < 0 &&
+                    !IN_SET(errno, EAGAIN, EINTR))
+                        return log_error_errno(errno, "Failed to wait for SIGCHLD: %m");
+        }
+
+        FOREACH_ARRAY(run, runs, n_runs) {
+                if (run->pid > 0) {
+                        log_error("%s timed out, killing it.", run->path);
+                        sigkill_wait(run->pid);
+
+                        run->pid = 0;
+                        run->result.duration = usec_sub_unsigned(now(CLOCK_MONOTONIC), run->result.start);
+                }
+
+                if (!run->result.reused) {
+                        r = generator_cache_update(run);
+                        if (r < 0)
+                                log_warning_errno(r, "Failed to record inputs of %s, ignoring: %m", run->path);
+                }
+
+                r = generator_status_write(run->entry, &run->result);
+                if (r < 0)
+                        log_debug_errno(r, "Failed to write status of %s, ignoring: %m", run->path);
+
+                /* Merge in the order the generators are listed in, earlier ones win if the same file is
+                 * written by more than one generator */
+                for (size_t i = 0; i < ELEMENTSOF(output_subdirs); i++) {
+                        _cleanup_free_ char *p = NULL;
+
+                        p = path_join(run->entry, output_subdirs[i]);
+                        if (!p)
+                                return log_oom();
+
+                        r = copy_tree(p, output_dirs[i], UID_INVALID, GID_INVALID,
+                                      COPY_MERGE|COPY_MERGE_EMPTY|COPY_MAC_CREATE, NULL, NULL);
+                        if (r < 0 && r != -ENOENT)
+                                log_warning_errno(r, "Failed to merge output of %s into '%s', ignoring: %m",
+                                                  run->path, output_dirs[i]);
+                }
+        }
+
+        return 0;
+}
+
+int generator_cache_execute(
+                char * const *paths,
+                const char *cache_dir,
+                char * const *output_dirs,
+                char * const *env,
+                usec_t timeout) {
+
+        _cleanup_strv_free_ char **binaries = NULL;
+        int r;
+
+        assert(!strv_isempty(paths));
+        assert(cache_dir);
+        assert(strv_length((char**) output_dirs) == ELEMENTSOF(output_subdirs));
+
+        r = conf_files_list_strv(&binaries, NULL, NULL,
+                                 CONF_FILES_EXECUTABLE|CONF_FILES_REGULAR|CONF_FILES_FILTER_MASKED,
+                                 (const char* const*) paths);
+        if (r < 0)
+                return log_error_errno(r, "Failed to enumerate executables: %m");
+
+        if (strv_isempty(binaries)) {
+                log_debug("No executables found.");
+                return 0;
+        }
+
+        /* Like execute_strv(), fork off a process first, which gets to reap the generators without
+         * interfering with anything else, and which carries their environment */
+        r = safe_fork("(sd-exec-gens)", FORK_RESET_SIGNALS|FORK_DEATHSIG_SIGTERM|FORK_LOG|FORK_WAIT, NULL);
+        if (r < 0)
+                return r;
+        if (r == 0) {
+                r = generator_cache_execute_child(binaries, cache_dir, output_dirs, env, timeout);
+                _exit(r < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+        }
+
+        return 0;
+}
+
+int generator_cache_load_results(const char *cache_dir, GeneratorResult **ret, size_t *ret_n) {
+        _cleanup_strv_free_ char **l = NULL;
+        GeneratorResult *results = NULL;
+        size_t n = 0;
+        int r;
+
+        assert(cache_dir);
+        assert(ret);
+        assert(ret_n);
+
+        CLEANUP_ARRAY(results, n, generator_result_free_many);
+
+        r = generator_cache_list(cache_dir, &l);
+        if (r == -ENOENT) {
+                *ret = NULL;
+                *ret_n = 0;
+                return 0;
+        }
+        if (r < 0)
+                return r;
+
+        STRV_FOREACH(name, l) {
+                _cleanup_free_ char *entry = NULL;
+                GeneratorResult result = {};
+
+                entry = path_join(cache_dir, *name);
+                if (!entry)
+                        return -ENOMEM;
+
+                r = generator_status_read(entry, &result);
+                if (r < 0) {
+                        log_debug_errno(r, "Failed to read status of generator %s, ignoring: %m", *name);
+                        continue;
+                }
+
+                result.name = strdup(*name);
+                if (!result.name)
+                        return -ENOMEM;
+
+                if (!GREEDY_REALLOC(results, n + 1)) {
+                        free(result.name);
+                        return -ENOMEM;
+                }
+
+                results[n++] = result;
+        }
+
+        *ret = TAKE_PTR(results);
+        *ret_n = TAKE_GENERIC(n, size_t, 0);
+        return 0;
+}
@@ -0,0 +1,26 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "time-util.h"
+
+typedef struct GeneratorResult {
+        char *name;
+        usec_t start;          /* CLOCK_MONOTONIC, of the last time it was actually run */
+        usec_t duration;
+        int exit_status;       /* or -1 if it didn't exit normally */
+        bool reused;           /* Whether the output of the previous run was reused this time */
+} GeneratorResult;
+
+void generator_result_free_many(GeneratorResult *results, size_t n);
+
+int generator_cache_execute(
+                char * const *paths,
+                const char *cache_dir,
+                char * const *dirs,
+                char * const *env,
+                usec_t timeout);
+
+int generator_cache_load_results(const char *cache_dir, GeneratorResult **ret, size_t *ret_n);
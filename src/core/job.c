@@ -300,7 +300,7 @@ int job_install_deserialized(Job *j) {
         if (j->id <= 0)
                 j->id = manager_get_new_job_id(j->manager);
 
-        r = hashmap_ensure_put(&j->manager->jobs, NULL, UINT32_TO_PTR(j->id), j);
+        r = hashmap_ensure_put(&j->manager->jobs, &trivial_hash_ops_trusted, UINT32_TO_PTR(j->id), j);
         if (r == -EEXIST)
                 return log_unit_debug_errno(j->unit, r, "Job ID %" PRIu32 " already used, cannot deserialize job.", j->id);
         if (r < 0)
@@ -126,9 +126,12 @@ struct Job {
         LIST_HEAD(JobDependency, object_list);
 
         /* Used for graph algs as a "I have been here" marker */
-        Job* marker;
         unsigned generation;
 
+        /* Used by the ordering cycle detection of transactions */
+        unsigned order_index;
+        unsigned order_lowlink;
+
         uint32_t id;
 
         JobType type;
@@ -161,6 +164,7 @@ struct Job {
         bool in_dbus_queue:1;
         bool sent_dbus_new_signal:1;
         bool ignore_order:1;
+        bool on_order_stack:1;
         bool irreversible:1;
         bool in_gc_queue:1;
         bool ref_by_private_bus:1;
@@ -5,22 +5,147 @@
 #include "load-dropin.h"
 #include "load-fragment.h"
 #include "log.h"
+#include "siphash24.h"
 #include "stat-util.h"
+#include "string-intern.h"
 #include "string-util.h"
 #include "strv.h"
 #include "unit-name.h"
 #include "unit.h"
 
-static int process_deps(Unit *u, UnitDependency dependency, const char *dir_suffix) {
+#define DEPENDENCY_DROPINS_HASH_KEY SD_ID128_MAKE(c2,5a,0f,7e,93,1d,4b,86,a4,3c,e8,51,06,bf,27,d9)
+
+static const struct {
+        const char *dir_suffix;
+        const char *file_suffix;
+} dropin_suffixes[_UNIT_DROPIN_TYPE_MAX] = {
+        [UNIT_DROPIN_WANTS]    = { ".wants",    NULL    },
+        [UNIT_DROPIN_REQUIRES] = { ".requires", NULL    },
+        [UNIT_DROPIN_UPHOLDS]  = { ".upholds",  NULL    },
+        [UNIT_DROPIN_CONF]     = { ".d",        ".conf" },
+};
+
+int unit_dropin_prefetch_new(Unit *u, Set *names, UnitDropinPrefetch **ret) {
+        _cleanup_(unit_dropin_prefetch_freep) UnitDropinPrefetch *p = NULL;
+        const char *n;
+        int r;
+
+        assert(u);
+        assert(ret);
+
+        /* Takes the names the unit is expected to carry after loading, the current id and aliases are
+         * added implicitly */
+
+        p = new(UnitDropinPrefetch, 1);
+        if (!p)
+                return -ENOMEM;
+
+        *p = (UnitDropinPrefetch) {
+                .unit_path_cache = u->manager->unit_path_cache,
+                .unit_cache_timestamp_hash = u->manager->unit_cache_timestamp_hash,
+        };
+
+        p->id = strdup(u->id);
+        if (!p->id)
+                return -ENOMEM;
+
+        SET_FOREACH(n, u->aliases) {
+                r = set_put_strdup(&p->aliases, n);
+                if (r < 0)
+                        return r;
+        }
+
+        SET_FOREACH(n, names) {
+                if (streq(n, u->id))
+                        continue;
+
+                r = set_put_strdup(&p->aliases, n);
+                if (r < 0)
+                        return r;
+        }
+
+        *ret = TAKE_PTR(p);
+        return 0;
+}
+
+UnitDropinPrefetch* unit_dropin_prefetch_free(UnitDropinPrefetch *p) {
+        if (!p)
+                return NULL;
+
+        free(p->id);
+        set_free(p->aliases);
+        FOREACH_ARRAY(paths, p->paths, _UNIT_DROPIN_TYPE_MAX)
+                strv_free(*paths);
+
+        return mfree(p);
+}
+
+void unit_dropin_prefetch_run(UnitDropinPrefetch *p, char **search_path) {
+        assert(p);
+
+        for (UnitDropinType t = 0; t < _UNIT_DROPIN_TYPE_MAX; t++)
+                p->error[t] = unit_file_find_dropin_paths(
+                                NULL,
+                                search_path,
+                                p->unit_path_cache,
+                                dropin_suffixes[t].dir_suffix, dropin_suffixes[t].file_suffix,
+                                p->id, p->aliases,
+                                p->paths + t);
+
+        p->done = true;
+}
+
+static int unit_get_dropin_paths(Unit *u, UnitDropinType t, char ***ret) {
+        UnitDropinPrefetch *p;
+
+        assert(u);
+        assert(t >= 0 && t < _UNIT_DROPIN_TYPE_MAX);
+        assert(ret);
+
+        /* Use the result of the prefetch, if it was done for the names the unit actually has, and the
+         * unit path cache didn't get rebuilt since. */
+        p = u->dropin_prefetch;
+        if (p && p->done &&
+            p->unit_cache_timestamp_hash == u->manager->unit_cache_timestamp_hash &&
+            streq(p->id, u->id) &&
+            set_equal(p->aliases, u->aliases)) {
+
+                if (p->error[t] < 0)
+                        return p->error[t];
+
+                *ret = TAKE_PTR(p->paths[t]);
+                return p->error[t];
+        }
+
+        return unit_file_find_dropin_paths(NULL,
+                                           u->manager->lookup_paths.search_path,
+                                           u->manager->unit_path_cache,
+                                           dropin_suffixes[t].dir_suffix, dropin_suffixes[t].file_suffix,
+                                           u->id, u->aliases,
+                                           ret);
+}
+
+static bool dependency_dropin_hash(const char *path, struct siphash *state) {
+        bool masked;
+
+        assert(path);
+        assert(state);
+
+        /* Everything we derive from a dependency drop-in is determined by its name and whether it is a
+         * mask, hence that's what we remember, in order to detect changes later on. */
+        masked = null_or_empty_path(path) > 0;
+
+        siphash24_compress(path, strlen(path) + 1, state);
+        siphash24_compress_boolean(masked, state);
+
+        return masked;
+}
+
+static int process_deps(Unit *u, UnitDependency dependency, UnitDropinType t, struct siphash *state) {
         _cleanup_strv_free_ char **paths = NULL;
         int r;
 
-        r = unit_file_find_dropin_paths(NULL,
-                                        u->manager->lookup_paths.search_path,
-                                        u->manager->unit_path_cache,
-                                        dir_suffix, NULL,
-                                        u->id, u->aliases,
-                                        &paths);
+        r = unit_get_dropin_paths(u, t, &paths);
         if (r < 0)
                 return r;
 
@@ -30,7 +155,7 @@ static int process_deps(Unit *u, UnitDependency dependency, const char *dir_suff
 
                 entry = basename(*p);
 
-                if (null_or_empty_path(*p) > 0) {
+                if (dependency_dropin_hash(*p, state)) {
                         /* an error usually means an invalid symlink, which is not a mask */
                         log_unit_debug(u, "%s dependency on %s is masked by %s, ignoring.",
                                        unit_dependency_to_string(dependency), entry, *p);
@@ -82,27 +207,61 @@ static int process_deps(Unit *u, UnitDependency dependency, const char *dir_suff
         return 0;
 }
 
+bool unit_dependency_dropins_changed(Unit *u) {
+        struct siphash state;
+
+        assert(u);
+
+        /* Looks up the .wants, .requires and .upholds drop-ins of the unit again, and checks whether they
+         * differ from what the unit was loaded with. Expects the unit path cache to be up-to-date. */
+
+        siphash24_init(&state, DEPENDENCY_DROPINS_HASH_KEY.bytes);
+
+        for (UnitDropinType t = 0; t < UNIT_DROPIN_CONF; t++) {
+                _cleanup_strv_free_ char **paths = NULL;
+
+                if (unit_file_find_dropin_paths(NULL,
+                                                u->manager->lookup_paths.search_path,
+                                                u->manager->unit_path_cache,
+                                                dropin_suffixes[t].dir_suffix, dropin_suffixes[t].file_suffix,
+                                                u->id, u->aliases,
+                                                &paths) < 0)
+                        return true;
+
+                STRV_FOREACH(p, paths)
+                        (void) dependency_dropin_hash(*p, &state);
+        }
+
+        return siphash24_finalize(&state) != u->dependency_dropins_hash;
+}
+
 int unit_load_dropin(Unit *u) {
         _cleanup_strv_free_ char **l = NULL;
+        struct siphash state;
         int r;
 
         assert(u);
 
+        siphash24_init(&state, DEPENDENCY_DROPINS_HASH_KEY.bytes);
+
         /* Load dependencies from .wants, .requires and .upholds directories */
-        r = process_deps(u, UNIT_WANTS, ".wants");
+        r = process_deps(u, UNIT_WANTS, UNIT_DROPIN_WANTS, &state);
         if (r < 0)
                 return r;
 
-        r = process_deps(u, UNIT_REQUIRES, ".requires");
+        r = process_deps(u, UNIT_REQUIRES, UNIT_DROPIN_REQUIRES, &state);
         if (r < 0)
                 return r;
 
-        r = process_deps(u, UNIT_UPHOLDS, ".upholds");
+        r = process_deps(u, UNIT_UPHOLDS, UNIT_DROPIN_UPHOLDS, &state);
         if (r < 0)
                 return r;
 
+        u->dependency_dropins_hash = siphash24_finalize(&state);
+
         /* Load .conf dropins */
-        r = unit_find_dropin_paths(u, &l);
+        r = unit_get_dropin_paths(u, UNIT_DROPIN_CONF, &l);
+        u->dropin_prefetch = unit_dropin_prefetch_free(u->dropin_prefetch);
         if (r <= 0)
                 return 0;
 
@@ -114,16 +273,24 @@ int unit_load_dropin(Unit *u) {
                         return log_oom();
         }
 
+        /* Drop-ins are commonly shared by many units (think template instances or top-level drop-ins),
+         * hence intern the paths. */
+        r = string_intern_strv(u->dropin_paths);
+        if (r < 0)
+                return log_oom();
+
         u->dropin_mtime = 0;
         STRV_FOREACH(f, u->dropin_paths) {
                 struct stat st;
 
-                r = config_parse(u->id, *f, NULL,
-                                 UNIT_VTABLE(u)->sections,
-                                 config_item_perf_lookup, load_fragment_gperf_lookup,
-                                 0, u, &st);
-                if (r > 0)
+                r = config_parse_full(u->id, *f, NULL,
+                                      UNIT_VTABLE(u)->sections,
+                                      config_item_perf_lookup, load_fragment_gperf_lookup,
+                                      0, u, &st, &u->manager->config_parse_cache);
+                if (r > 0) {
+                        u->manager->load_statistics.n_files_parsed++;
                         u->dropin_mtime = MAX(u->dropin_mtime, timespec_load(&st.st_mtim));
+                }
         }
 
         return 0;
@@ -17,4 +17,34 @@ static inline int unit_find_dropin_paths(Unit *u, char ***paths) {
                                            paths);
 }
 
+typedef enum UnitDropinType {
+        UNIT_DROPIN_WANTS,
+        UNIT_DROPIN_REQUIRES,
+        UNIT_DROPIN_UPHOLDS,
+        UNIT_DROPIN_CONF,
+        _UNIT_DROPIN_TYPE_MAX,
+} UnitDropinType;
+
+/* The drop-in paths of a unit, looked up ahead of loading it, possibly on a worker thread. The lookup is
+ * done for the names we expect the unit to have once its fragment is loaded, and is only used if the unit
+ * ends up with exactly these names. */
+struct UnitDropinPrefetch {
+        char *id;
+        Set *aliases;
+        Set *unit_path_cache;
+        uint64_t unit_cache_timestamp_hash;
+        char **paths[_UNIT_DROPIN_TYPE_MAX];
+        int error[_UNIT_DROPIN_TYPE_MAX];
+        bool done;
+};
+
+int unit_dropin_prefetch_new(Unit *u, Set *names, UnitDropinPrefetch **ret);
+UnitDropinPrefetch* unit_dropin_prefetch_free(UnitDropinPrefetch *p);
+DEFINE_TRIVIAL_CLEANUP_FUNC(UnitDropinPrefetch*, unit_dropin_prefetch_free);
+
+/* Doesn't touch the unit or the manager, and hence may be called from any thread */
+void unit_dropin_prefetch_run(UnitDropinPrefetch *p, char **search_path);
+
 int unit_load_dropin(Unit *u);
+
+bool unit_dependency_dropins_changed(Unit *u);
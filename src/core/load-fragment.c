@@ -65,6 +65,7 @@
 #include "socket-netlink.h"
 #include "specifier.h"
 #include "stat-util.h"
+#include "string-intern.h"
 #include "string-util.h"
 #include "strv.h"
 #include "syslog-util.h"
@@ -1057,11 +1058,16 @@ int config_parse_exec(
                 if (!nec)
                         return log_oom();
 
+                /* Binary paths are usually the same for all instances of a template, intern them. */
                 *nec = (ExecCommand) {
-                        .path = path_simplify(TAKE_PTR(path)),
+                        .path = string_intern(path_simplify(path)),
                         .argv = TAKE_PTR(args),
                         .flags = flags,
                 };
+                if (!nec->path) {
+                        free(nec);
+                        return log_oom();
+                }
 
                 exec_command_append_list(e, nec);
 
@@ -2260,6 +2266,39 @@ int config_parse_socket_service(
         return 0;
 }
 
+int config_parse_socket_reuse_port_shards(
+                const char *unit,
+                const char *filename,
+                unsigned line,
+                const char *section,
+                unsigned section_line,
+                const char *lvalue,
+                int ltype,
+                const char *rvalue,
+                void *data,
+                void *userdata) {
+
+        unsigned *n = ASSERT_PTR(data);
+        int r;
+
+        assert(filename);
+        assert(lvalue);
+        assert(rvalue);
+
+        if (isempty(rvalue)) {
+                *n = 0;
+                return 0;
+        }
+
+        r = socket_reuse_port_shards_from_string(rvalue, n);
+        if (r < 0) {
+                log_syntax(unit, LOG_WARNING, filename, line, r, "Failed to parse %s=, ignoring: %s", lvalue, rvalue);
+                return 0;
+        }
+
+        return 0;
+}
+
 int config_parse_fdname(
                 const char *unit,
                 const char *filename,
@@ -3204,7 +3243,7 @@ int config_parse_documentation(
 
         if (isempty(rvalue)) {
                 /* Empty assignment resets the list */
-                u->documentation = strv_free(u->documentation);
+                u->documentation = string_unintern_strv(u->documentation);
                 return 0;
         }
 
@@ -3219,12 +3258,17 @@ int config_parse_documentation(
                         *(b++) = *a;
                 else {
                         log_syntax(unit, LOG_WARNING, filename, line, 0, "Invalid URL, ignoring: %s", *a);
-                        free(*a);
+                        string_unintern(*a);
                 }
         }
         if (b)
                 *b = NULL;
 
+        /* Documentation URLs tend to be shared by many units (in particular template instances), hence
+         * intern them. */
+        if (string_intern_strv(u->documentation) < 0)
+                return log_oom();
+
         return 0;
 }
 
@@ -6182,11 +6226,11 @@ int unit_load_fragment(Unit *u) {
         }
 
         /* Possibly rebuild the fragment map to catch new units */
-        r = unit_file_build_name_map(&u->manager->lookup_paths,
-                                     &u->manager->unit_cache_timestamp_hash,
-                                     &u->manager->unit_id_map,
-                                     &u->manager->unit_name_map,
-                                     &u->manager->unit_path_cache);
+        r = unit_file_load_or_build_name_map(&u->manager->lookup_paths,
+                                             &u->manager->unit_cache_timestamp_hash,
+                                             &u->manager->unit_id_map,
+                                             &u->manager->unit_name_map,
+                                             &u->manager->unit_path_cache);
         if (r < 0)
                 return log_error_errno(r, "Failed to rebuild name map: %m");
 
@@ -6213,7 +6257,8 @@ int unit_load_fragment(Unit *u) {
                 if (fstat(fileno(f), &st) < 0)
                         return -errno;
 
-                r = free_and_strdup(&u->fragment_path, fragment);
+                /* All instances of a template share the fragment, hence intern the path. */
+                r = string_intern_replace(&u->fragment_path, fragment);
                 if (r < 0)
                         return r;
 
@@ -6244,12 +6289,14 @@ int unit_load_fragment(Unit *u) {
                         u->fragment_mtime = timespec_load(&st.st_mtim);
 
                         /* Now, parse the file contents */
-                        r = config_parse(u->id, fragment, f,
-                                         UNIT_VTABLE(u)->sections,
-                                         config_item_perf_lookup, load_fragment_gperf_lookup,
-                                         0,
-                                         u,
-                                         NULL);
+                        r = config_parse_full(u->id, fragment, f,
+                                              UNIT_VTABLE(u)->sections,
+                                              config_item_perf_lookup, load_fragment_gperf_lookup,
+                                              0,
+                                              u,
+                                              NULL,
+                                              &u->manager->config_parse_cache);
+                        u->manager->load_statistics.n_files_parsed++;
                         if (r == -ENOEXEC)
                                 log_unit_notice_errno(u, r, "Unit configuration has fatal error, unit will not be started.");
                         if (r < 0)
@@ -6329,6 +6376,7 @@ void unit_dump_config_items(FILE *f) {
                 { config_parse_signal,                "SIGNAL" },
                 { config_parse_socket_listen,         "SOCKET [...]" },
                 { config_parse_socket_bind,           "SOCKETBIND" },
+                { config_parse_socket_reuse_port_shards, "SHARDS" },
                 { config_parse_socket_bindtodevice,   "NETWORKINTERFACE" },
                 { config_parse_sec,                   "SECONDS" },
                 { config_parse_nsec,                  "NANOSECONDS" },
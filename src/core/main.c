@@ -156,10 +156,18 @@ static void *arg_random_seed;
 static size_t arg_random_seed_size;
 static usec_t arg_reload_limit_interval_sec;
 static unsigned arg_reload_limit_burst;
+static bool arg_dbus_signal_changed_properties_only;
+static usec_t arg_dbus_signal_coalesce_usec;
+static unsigned arg_unit_load_threads;
+static unsigned arg_executor_pool_size;
+static bool arg_reload_skip_unchanged;
 
 /* A copy of the original environment block */
 static char **saved_env = NULL;
 
+/* The configuration files we read, to detect changes on reload */
+static Hashmap *config_stats_by_path = NULL;
+
 static int parse_configuration(const struct rlimit *saved_rlimit_nofile,
                                const struct rlimit *saved_rlimit_memlock);
 
@@ -785,6 +793,11 @@ static int parse_config_file(void) {
                 { "Manager", "DefaultOOMScoreAdjust",        config_parse_oom_score_adjust,      0,                        NULL                              },
                 { "Manager", "ReloadLimitIntervalSec",       config_parse_sec,                   0,                        &arg_reload_limit_interval_sec    },
                 { "Manager", "ReloadLimitBurst",             config_parse_unsigned,              0,                        &arg_reload_limit_burst           },
+                { "Manager", "ReloadSkipUnchanged",          config_parse_bool,                  0,                        &arg_reload_skip_unchanged        },
+                { "Manager", "DBusSignalChangedPropertiesOnly", config_parse_bool,               0,                        &arg_dbus_signal_changed_properties_only },
+                { "Manager", "DBusSignalCoalesceSec",        config_parse_sec,                   0,                        &arg_dbus_signal_coalesce_usec    },
+                { "Manager", "UnitLoadThreads",              config_parse_unsigned,              0,                        &arg_unit_load_threads            },
+                { "Manager", "ExecutorPoolSize",             config_parse_unsigned,              0,                        &arg_executor_pool_size           },
 #if ENABLE_SMACK
                 { "Manager", "DefaultSmackProcessLabel",     config_parse_string,                0,                        &arg_defaults.smack_process_label },
 #else
@@ -793,13 +806,18 @@ static int parse_config_file(void) {
                 {}
         };
 
+        config_stats_by_path = hashmap_free(config_stats_by_path);
+
         if (arg_runtime_scope == RUNTIME_SCOPE_SYSTEM)
-                (void) config_parse_standard_file_with_dropins(
+                (void) config_parse_standard_file_with_dropins_full(
+                                /* root= */ NULL,
                                 "systemd/system.conf",
                                 "Manager\0",
                                 config_item_table_lookup, items,
                                 CONFIG_PARSE_WARN,
-                                /* userdata= */ NULL);
+                                /* userdata= */ NULL,
+                                &config_stats_by_path,
+                                /* ret_dropin_files= */ NULL);
         else {
                 _cleanup_strv_free_ char **files = NULL, **dirs = NULL;
                 int r;
@@ -818,7 +836,7 @@ static int parse_config_file(void) {
                                 "Manager\0",
                                 config_item_table_lookup, items,
                                 CONFIG_PARSE_WARN,
-                                NULL, NULL, NULL);
+                                NULL, &config_stats_by_path, NULL);
         }
 
         /* Traditionally "0" was used to turn off the default unit timeouts. Fix this up so that we use
@@ -870,6 +888,11 @@ static void set_manager_settings(Manager *m) {
          * counter on every daemon-reload. */
         m->reload_reexec_ratelimit.interval = arg_reload_limit_interval_sec;
         m->reload_reexec_ratelimit.burst = arg_reload_limit_burst;
+        m->dbus_signal_changed_properties_only = arg_dbus_signal_changed_properties_only;
+        m->dbus_signal_coalesce_usec = arg_dbus_signal_coalesce_usec;
+        m->unit_load_threads = arg_unit_load_threads;
+        m->executor_pool_size = arg_executor_pool_size;
+        m->reload_skip_unchanged = arg_reload_skip_unchanged;
 
         manager_set_watchdog(m, WATCHDOG_RUNTIME, arg_runtime_watchdog);
         manager_set_watchdog(m, WATCHDOG_REBOOT, arg_reboot_watchdog);
@@ -2107,6 +2130,7 @@ static int invoke_main_loop(
                 switch (objective) {
 
                 case MANAGER_RELOAD: {
+                        _cleanup_hashmap_free_ Hashmap *saved_config_stats_by_path = NULL;
                         LogTarget saved_log_target;
                         int saved_log_level;
 
@@ -2120,6 +2144,8 @@ static int invoke_main_loop(
                         saved_log_level = m->log_level_overridden ? log_get_max_level() : -1;
                         saved_log_target = m->log_target_overridden ? log_get_target() : _LOG_TARGET_INVALID;
 
+                        saved_config_stats_by_path = TAKE_PTR(config_stats_by_path);
+
                         (void) parse_configuration(saved_rlimit_nofile, saved_rlimit_memlock);
 
                         set_manager_defaults(m);
@@ -2133,6 +2159,17 @@ static int invoke_main_loop(
                         if (saved_log_target >= 0)
                                 manager_override_log_target(m, saved_log_target);
 
+                        /* The defaults from the configuration file are applied to units when they are
+                         * loaded, hence we can only skip the reload if it didn't change either. */
+                        if (m->reload_skip_unchanged &&
+                            stats_by_path_equal(saved_config_stats_by_path, config_stats_by_path) &&
+                            manager_need_reload(m) == 0) {
+                                log_info("Configuration unchanged, skipping reload.");
+                                m->objective = MANAGER_OK;
+                                manager_check_finished(m);
+                                continue;
+                        }
+
                         if (manager_reload(m) < 0)
                                 /* Reloading failed before the point of no return.
                                  * Let's continue running as if nothing happened. */
@@ -2682,6 +2719,13 @@ static void reset_arguments(void) {
 
         arg_reload_limit_interval_sec = 0;
         arg_reload_limit_burst = 0;
+
+        arg_dbus_signal_changed_properties_only = false;
+        arg_dbus_signal_coalesce_usec = 0;
+
+        arg_unit_load_threads = 0;
+        arg_executor_pool_size = 0;
+        arg_reload_skip_unchanged = false;
 }
 
 static void determine_default_oom_score_adjust(void) {
@@ -3319,6 +3363,7 @@ finish:
         fds = fdset_free(fds);
 
         saved_env = strv_free(saved_env);
+        config_stats_by_path = hashmap_free(config_stats_by_path);
 
 #if HAVE_VALGRIND_VALGRIND_H
         /* If we are PID 1 and running under valgrind, then let's exit
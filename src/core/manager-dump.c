@@ -1,5 +1,6 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
+#include "bpf-program.h"
 #include "build.h"
 #include "fd-util.h"
 #include "fileio.h"
@@ -77,6 +78,45 @@ static void manager_dump_header(Manager *m, FILE *f, const char *prefix) {
                                 timestamp_is_set(t->realtime) ? FORMAT_TIMESTAMP(t->realtime) :
                                                                 FORMAT_TIMESPAN(t->monotonic, 1));
         }
+
+        for (ManagerPhase p = 0; p < _MANAGER_PHASE_MAX; p++) {
+                const ManagerPhaseStatistics *s = m->phases + p;
+
+                if (s->n_runs > 0)
+                        fprintf(f, "%sPhase %s: %s in %" PRIu64 " runs\n",
+                                strempty(prefix),
+                                manager_phase_to_string(p),
+                                FORMAT_TIMESPAN(s->total_usec, USEC_PER_MSEC),
+                                s->n_runs);
+        }
+
+        fprintf(f, "%sUnits loaded: %u in %s, from %u files\n",
+                strempty(prefix),
+                m->load_statistics.n_loaded,
+                FORMAT_TIMESPAN(m->load_statistics.load_usec, USEC_PER_MSEC),
+                m->load_statistics.n_files_parsed);
+
+        if (m->load_statistics.n_batches > 0)
+                fprintf(f, "%sUnit drop-ins prefetched: %u in %s, in %u batches, with up to %u threads\n",
+                        strempty(prefix),
+                        m->load_statistics.n_prefetched,
+                        FORMAT_TIMESPAN(m->load_statistics.prefetch_usec, USEC_PER_MSEC),
+                        m->load_statistics.n_batches,
+                        m->load_statistics.n_threads);
+
+        fprintf(f, "%sCGroup attribute writes: %" PRIu64 ", skipped as unchanged: %" PRIu64 "\n",
+                strempty(prefix),
+                m->n_cgroup_attribute_writes,
+                m->n_cgroup_attribute_writes_skipped);
+
+        BPFProgramStatistics bpf_stats;
+        bpf_program_get_statistics(&bpf_stats);
+        fprintf(f, "%sBPF programs loaded: %" PRIu64 ", loads avoided by sharing: %" PRIu64 ", shared: %u, with %u users\n",
+                strempty(prefix),
+                bpf_stats.n_loaded,
+                bpf_stats.n_load_avoided,
+                bpf_stats.n_shared,
+                bpf_stats.n_shared_users);
 }
 
 void manager_dump(Manager *m, FILE *f, char **patterns, const char *prefix) {
@@ -3,6 +3,7 @@
 #include "clean-ipc.h"
 #include "core-varlink.h"
 #include "dbus.h"
+#include "env-util.h"
 #include "fd-util.h"
 #include "fileio.h"
 #include "format-util.h"
@@ -71,6 +72,25 @@ static void manager_serialize_gid_refs(Manager *m, FILE *f) {
         manager_serialize_uid_refs_internal(f, m->gid_refs, "destroy-ipc-gid");
 }
 
+static bool manager_serialize_binary(Manager *m) {
+        int r;
+
+        assert(m);
+
+        /* The binary format is quicker to read back, but we may only use it if we know that whoever reads
+         * the serialization understands it. That's the case when reloading, as it is us then, but the
+         * binary we reexecute might be older. $SYSTEMD_SERIALIZATION_BINARY= chooses the format explicitly,
+         * for example to get a readable serialization for debugging. */
+
+        r = getenv_bool("SYSTEMD_SERIALIZATION_BINARY");
+        if (r >= 0)
+                return r;
+        if (r != -ENXIO)
+                log_debug_errno(r, "Failed to parse $SYSTEMD_SERIALIZATION_BINARY, ignoring: %m");
+
+        return m->objective == MANAGER_RELOAD;
+}
+
 int manager_serialize(
                 Manager *m,
                 FILE *f,
@@ -86,6 +106,8 @@ int manager_serialize(
         assert(fds);
 
         _cleanup_(manager_reloading_stopp) _unused_ Manager *reloading = manager_reloading_start(m);
+        _cleanup_(serialize_binary_stopp) _unused_ FILE *binary =
+                manager_serialize_binary(m) ? serialize_binary_start(f) : NULL;
 
         (void) serialize_item_format(f, "current-job-id", "%" PRIu32, m->current_job_id);
         (void) serialize_item_format(f, "n-installed-jobs", "%u", m->n_installed_jobs);
@@ -224,9 +246,9 @@ static int manager_deserialize_units(Manager *m, FILE *f, FDSet *fds) {
                 _cleanup_free_ char *line = NULL;
 
                 /* Start marker */
-                r = read_stripped_line(f, LONG_LINE_MAX, &line);
+                r = deserialize_read_line(f, &line);
                 if (r < 0)
-                        return log_error_errno(r, "Failed to read serialization line: %m");
+                        return r;
                 if (r == 0)
                         break;
 
@@ -3,6 +3,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <linux/kd.h>
+#include <pthread.h>
 #include <sys/epoll.h>
 #include <sys/inotify.h>
 #include <sys/ioctl.h>
@@ -32,9 +33,11 @@
 #include "clean-ipc.h"
 #include "clock-util.h"
 #include "common-signal.h"
+#include "conf-parser.h"
 #include "confidential-virt.h"
 #include "constants.h"
 #include "core-varlink.h"
+#include "cpu-set-util.h"
 #include "creds-util.h"
 #include "daemon-util.h"
 #include "dbus-job.h"
@@ -47,9 +50,11 @@
 #include "event-util.h"
 #include "exec-util.h"
 #include "execute.h"
+#include "executor-pool.h"
 #include "exit-status.h"
 #include "fd-util.h"
 #include "fileio.h"
+#include "generator-cache.h"
 #include "generator-setup.h"
 #include "hashmap.h"
 #include "initrd-util.h"
@@ -58,6 +63,7 @@
 #include "io-util.h"
 #include "iovec-util.h"
 #include "label-util.h"
+#include "load-dropin.h"
 #include "load-fragment.h"
 #include "locale-setup.h"
 #include "log.h"
@@ -77,6 +83,7 @@
 #include "process-util.h"
 #include "psi-util.h"
 #include "ratelimit.h"
+#include "recurse-dir.h"
 #include "rlimit-util.h"
 #include "rm-rf.h"
 #include "selinux-util.h"
@@ -84,6 +91,7 @@
 #include "socket-util.h"
 #include "special.h"
 #include "stat-util.h"
+#include "string-intern.h"
 #include "string-table.h"
 #include "string-util.h"
 #include "strv.h"
@@ -102,6 +110,9 @@
 #include "watchdog.h"
 
 #define NOTIFY_RCVBUF_SIZE (8*1024*1024)
+
+/* How many notification messages to receive at once with a single recvmmsg() */
+#define NOTIFY_BATCH_MAX 16U
 #define CGROUPS_AGENT_RCVBUF_SIZE (8*1024*1024)
 
 /* Initial delay and the interval for printing status messages about running jobs */
@@ -117,8 +128,38 @@
 /* How many units and jobs to process of the bus queue before returning to the event loop. */
 #define MANAGER_BUS_MESSAGE_BUDGET 100U
 
+/* How many children to reap at most before returning to the event loop. */
+#define MANAGER_SIGCHLD_BUDGET 64U
+
+/* How much time to spend at most on garbage collecting and freeing units before returning to the event loop,
+ * and how many units to process between checks of the clock. */
+#define MANAGER_GC_BUDGET_USEC (10 * USEC_PER_MSEC)
+#define MANAGER_GC_BUDGET_CHECK 16U
+
+/* Look up drop-ins of queued units on worker threads only if there are at least this many, and hand each
+ * thread at least this many. By default use one thread per CPU, but no more than 8. */
+#define LOAD_QUEUE_PREFETCH_MIN 32U
+#define UNIT_LOAD_THREADS_AUTO_MAX 8U
+#define UNIT_LOAD_THREADS_MAX 64U
+
 #define DEFAULT_TASKS_MAX ((CGroupTasksMax) { 15U, 100U }) /* 15% */
 
+struct NotifyBatch {
+        struct mmsghdr messages[NOTIFY_BATCH_MAX];
+        struct iovec iovecs[NOTIFY_BATCH_MAX];
+        char buffers[NOTIFY_BATCH_MAX][NOTIFY_BUFFER_MAX+1];
+        CMSG_BUFFER_TYPE(CMSG_SPACE(sizeof(struct ucred)) +
+                         CMSG_SPACE(sizeof(int) * NOTIFY_FD_MAX)) controls[NOTIFY_BATCH_MAX];
+
+        /* The cgroups of the senders of the messages in the batch, so that we read /proc/$PID/cgroup only
+         * once per sender, even if it sent several messages. */
+        struct {
+                pid_t pid;
+                char *cgroup;
+        } senders[NOTIFY_BATCH_MAX];
+        size_t n_senders;
+};
+
 static int manager_dispatch_notify_fd(sd_event_source *source, int fd, uint32_t revents, void *userdata);
 static int manager_dispatch_cgroups_agent_fd(sd_event_source *source, int fd, uint32_t revents, void *userdata);
 static int manager_dispatch_signal_fd(sd_event_source *source, int fd, uint32_t revents, void *userdata);
@@ -981,6 +1022,10 @@ int manager_new(RuntimeScope runtime_scope, ManagerTestRunFlags test_run_flags,
         if (r < 0)
                 return r;
 
+        r = install_cache_new(runtime_scope, /* root_dir = */ NULL, &m->install_cache);
+        if (r < 0)
+                return r;
+
         r = sd_event_default(&m->event);
         if (r < 0)
                 return r;
@@ -1299,7 +1344,11 @@ static int manager_setup_handoff_timestamp_fd(Manager *m) {
         return 0;
 }
 
-static unsigned manager_dispatch_cleanup_queue(Manager *m) {
+static bool manager_gc_budget_exhausted(unsigned n, usec_t deadline) {
+        return n % MANAGER_GC_BUDGET_CHECK == 0 && deadline != USEC_INFINITY && now(CLOCK_MONOTONIC) >= deadline;
+}
+
+static unsigned manager_dispatch_cleanup_queue(Manager *m, usec_t deadline) {
         Unit *u;
         unsigned n = 0;
 
@@ -1308,6 +1357,9 @@ static unsigned manager_dispatch_cleanup_queue(Manager *m) {
         while ((u = m->cleanup_queue)) {
                 assert(u->in_cleanup_queue);
 
+                if (manager_gc_budget_exhausted(n, deadline))
+                        break;
+
                 unit_free(u);
                 n++;
         }
@@ -1412,7 +1464,7 @@ good:
         unit_gc_mark_good(u, gc_marker);
 }
 
-static unsigned manager_dispatch_gc_unit_queue(Manager *m) {
+static unsigned manager_dispatch_gc_unit_queue(Manager *m, usec_t deadline) {
         unsigned n = 0, gc_marker;
         Unit *u;
 
@@ -1420,12 +1472,17 @@ static unsigned manager_dispatch_gc_unit_queue(Manager *m) {
 
         /* log_debug("Running GC..."); */
 
+        if (!m->gc_unit_queue || manager_gc_budget_exhausted(n, deadline))
+                return 0;
+
         m->gc_marker += _GC_OFFSET_MAX;
         if (m->gc_marker + _GC_OFFSET_MAX <= _GC_OFFSET_MAX)
                 m->gc_marker = 1;
 
         gc_marker = m->gc_marker;
 
+        /* Note that we may stop half-way through the queue when we are out of time. That's fine, the marker
+         * is bumped on each invocation, hence the remaining units are simply swept in a later run. */
         while ((u = LIST_POP(gc_queue, m->gc_unit_queue))) {
                 assert(u->in_gc_queue);
 
@@ -1442,6 +1499,9 @@ static unsigned manager_dispatch_gc_unit_queue(Manager *m) {
                         u->gc_marker = gc_marker + GC_OFFSET_BAD;
                         unit_add_to_cleanup_queue(u);
                 }
+
+                if (manager_gc_budget_exhausted(n, deadline))
+                        break;
         }
 
         return n;
@@ -1641,7 +1701,7 @@ static void manager_clear_jobs_and_units(Manager *m) {
         while ((u = hashmap_first(m->units)))
                 unit_free(u);
 
-        manager_dispatch_cleanup_queue(m);
+        manager_dispatch_cleanup_queue(m, USEC_INFINITY);
 
         assert(!m->load_queue);
         assert(prioq_isempty(m->run_queue));
@@ -1715,9 +1775,13 @@ Manager* manager_free(Manager *m) {
         sd_event_source_unref(m->user_lookup_event_source);
         sd_event_source_unref(m->handoff_timestamp_event_source);
         sd_event_source_unref(m->memory_pressure_event_source);
+        sd_event_source_unref(m->dbus_signal_coalesce_event_source);
+
+        executor_pool_flush(m);
 
         safe_close(m->signal_fd);
         safe_close(m->notify_fd);
+        free(m->notify_batch);
         safe_close(m->cgroups_agent_fd);
         safe_close_pair(m->user_lookup_fds);
         safe_close_pair(m->handoff_timestamp_fds);
@@ -1734,8 +1798,12 @@ Manager* manager_free(Manager *m) {
         strv_free(m->transient_environment);
         strv_free(m->client_environment);
 
+        generator_result_free_many(m->generator_results, m->n_generator_results);
+
         hashmap_free(m->cgroup_unit);
         manager_free_unit_name_maps(m);
+        hashmap_free(m->config_parse_cache);
+        install_cache_free(m->install_cache);
 
         free(m->switch_root);
         free(m->switch_root_init);
@@ -1764,17 +1832,23 @@ Manager* manager_free(Manager *m) {
         bpf_restrict_fs_destroy(m->restrict_fs);
 #endif
 
+        hashmap_free(m->syscall_filter_cache);
+
         safe_close(m->executor_fd);
 
         return mfree(m);
 }
 
 static void manager_enumerate_perpetual(Manager *m) {
+        usec_t ts;
+
         assert(m);
 
         if (FLAGS_SET(m->test_run_flags, MANAGER_TEST_RUN_MINIMAL))
                 return;
 
+        ts = manager_phase_start(m, MANAGER_PHASE_UNITS_ENUMERATE);
+
         /* Let's ask every type to load all units from disk/kernel that it might know */
         for (UnitType c = 0; c < _UNIT_TYPE_MAX; c++) {
                 if (!unit_type_supported(c)) {
@@ -1785,14 +1859,20 @@ static void manager_enumerate_perpetual(Manager *m) {
                 if (unit_vtable[c]->enumerate_perpetual)
                         unit_vtable[c]->enumerate_perpetual(m);
         }
+
+        manager_phase_finish(m, MANAGER_PHASE_UNITS_ENUMERATE, ts);
 }
 
 static void manager_enumerate(Manager *m) {
+        usec_t ts;
+
         assert(m);
 
         if (FLAGS_SET(m->test_run_flags, MANAGER_TEST_RUN_MINIMAL))
                 return;
 
+        ts = manager_phase_start(m, MANAGER_PHASE_UNITS_ENUMERATE);
+
         /* Let's ask every type to load all units from disk/kernel that it might know */
         for (UnitType c = 0; c < _UNIT_TYPE_MAX; c++) {
                 if (!unit_type_supported(c)) {
@@ -1804,10 +1884,13 @@ static void manager_enumerate(Manager *m) {
                         unit_vtable[c]->enumerate(m);
         }
 
+        manager_phase_finish(m, MANAGER_PHASE_UNITS_ENUMERATE, ts);
+
         manager_dispatch_load_queue(m);
 }
 
 static void manager_coldplug(Manager *m) {
+        usec_t ts;
         Unit *u;
         char *k;
         int r;
@@ -1816,6 +1899,8 @@ static void manager_coldplug(Manager *m) {
 
         log_debug("Invoking unit coldplug() handlers%s", special_glyph(SPECIAL_GLYPH_ELLIPSIS));
 
+        ts = manager_phase_start(m, MANAGER_PHASE_COLDPLUG);
+
         /* Let's place the units back into their deserialized state */
         HASHMAP_FOREACH_KEY(u, k, m->units) {
 
@@ -1827,6 +1912,8 @@ static void manager_coldplug(Manager *m) {
                 if (r < 0)
                         log_warning_errno(r, "We couldn't coldplug %s, proceeding anyway: %m", u->id);
         }
+
+        manager_phase_finish(m, MANAGER_PHASE_COLDPLUG, ts);
 }
 
 static void manager_catchup(Manager *m) {
@@ -1897,8 +1984,12 @@ static bool manager_dbus_is_running(Manager *m, bool deserialized) {
 }
 
 static void manager_setup_bus(Manager *m) {
+        usec_t ts;
+
         assert(m);
 
+        ts = manager_phase_start(m, MANAGER_PHASE_BUS_SETUP);
+
         /* Let's set up our private bus connection now, unconditionally */
         (void) bus_init_private(m);
 
@@ -1913,6 +2004,8 @@ static void manager_setup_bus(Manager *m) {
                 if (MANAGER_IS_SYSTEM(m))
                         (void) bus_init_system(m);
         }
+
+        manager_phase_finish(m, MANAGER_PHASE_BUS_SETUP, ts);
 }
 
 static void manager_preset_all(Manager *m) {
@@ -1955,6 +2048,9 @@ static void manager_ready(Manager *m) {
         /* Let's finally catch up with any changes that took place while we were reloading/reexecing */
         manager_catchup(m);
 
+        /* Spawn executors ahead of time, if so configured, or drop them if no longer wanted */
+        (void) executor_pool_schedule_refill(m);
+
         /* Create a file which will indicate when the manager started loading units the last time. */
         if (MANAGER_IS_SYSTEM(m))
                 (void) touch_file("/run/systemd/systemd-units-load", false,
@@ -1976,6 +2072,7 @@ void manager_reloading_stopp(Manager **m) {
 }
 
 int manager_startup(Manager *m, FILE *serialization, FDSet *fds, const char *root) {
+        usec_t ts;
         int r;
 
         assert(m);
@@ -2021,7 +2118,9 @@ int manager_startup(Manager *m, FILE *serialization, FDSet *fds, const char *roo
 
                 /* Second, deserialize if there is something to deserialize */
                 if (serialization) {
+                        ts = manager_phase_start(m, MANAGER_PHASE_DESERIALIZE);
                         r = manager_deserialize(m, serialization, fds);
+                        manager_phase_finish(m, MANAGER_PHASE_DESERIALIZE, ts);
                         if (r < 0)
                                 return log_error_errno(r, "Deserialization failed: %m");
                 }
@@ -2075,7 +2174,9 @@ int manager_startup(Manager *m, FILE *serialization, FDSet *fds, const char *roo
                         log_warning_errno(r, "Failed to deserialized tracked clients, ignoring: %m");
                 m->deserialized_subscribed = strv_free(m->deserialized_subscribed);
 
+                ts = manager_phase_start(m, MANAGER_PHASE_VARLINK_SETUP);
                 r = manager_varlink_init(m);
+                manager_phase_finish(m, MANAGER_PHASE_VARLINK_SETUP, ts);
                 if (r < 0)
                         log_warning_errno(r, "Failed to set up Varlink, ignoring: %m");
 
@@ -2098,7 +2199,7 @@ int manager_startup(Manager *m, FILE *serialization, FDSet *fds, const char *roo
         return 0;
 }
 
-int manager_add_job(
+static int manager_add_job_impl(
                 Manager *m,
                 JobType type,
                 Unit *unit,
@@ -2175,6 +2276,27 @@ int manager_add_job(
         return 0;
 }
 
+int manager_add_job(
+                Manager *m,
+                JobType type,
+                Unit *unit,
+                JobMode mode,
+                Set *affected_jobs,
+                sd_bus_error *error,
+                Job **ret) {
+
+        usec_t ts;
+        int r;
+
+        assert(m);
+
+        ts = manager_phase_start(m, MANAGER_PHASE_TRANSACTION);
+        r = manager_add_job_impl(m, type, unit, mode, affected_jobs, error, ret);
+        manager_phase_finish(m, MANAGER_PHASE_TRANSACTION, ts);
+
+        return r;
+}
+
 int manager_add_job_by_name(Manager *m, JobType type, const char *name, JobMode mode, Set *affected_jobs, sd_bus_error *e, Job **ret) {
         Unit *unit = NULL;  /* just to appease gcc, initialization is not really necessary */
         int r;
@@ -2285,9 +2407,156 @@ static int manager_dispatch_target_deps_queue(Manager *m) {
         return r;
 }
 
+typedef struct LoadPrefetchContext {
+        Unit **units;
+        size_t n_units;
+        size_t next;
+        char **search_path;
+} LoadPrefetchContext;
+
+static void* load_prefetch_thread(void *userdata) {
+        LoadPrefetchContext *c = ASSERT_PTR(userdata);
+
+        /* Only touches the prefetch objects, never the units themselves */
+        for (;;) {
+                size_t i = __atomic_fetch_add(&c->next, 1, __ATOMIC_RELAXED);
+                if (i >= c->n_units)
+                        break;
+
+                if (c->units[i]->dropin_prefetch)
+                        unit_dropin_prefetch_run(c->units[i]->dropin_prefetch, c->search_path);
+        }
+
+        return NULL;
+}
+
+static unsigned manager_unit_load_threads(Manager *m) {
+        int r;
+
+        assert(m);
+
+        if (m->unit_load_threads > 0)
+                return MIN(m->unit_load_threads, UNIT_LOAD_THREADS_MAX);
+
+        r = cpus_in_affinity_mask();
+        if (r <= 0)
+                return 1;
+
+        return MIN((unsigned) r, UNIT_LOAD_THREADS_AUTO_MAX);
+}
+
+static int manager_prefetch_load_queue(Manager *m, unsigned n_threads) {
+        _cleanup_free_ Unit **units = NULL;
+        _cleanup_free_ pthread_t *threads = NULL;
+        size_t n_units = 0, n_started = 0;
+        sigset_t ss, saved_ss;
+        usec_t ts;
+        int r;
+
+        assert(m);
+        assert(n_threads > 1);
+
+        /* Looks up the drop-ins of the units that got added to the load queue since the last time we came
+         * here, on a couple of worker threads. Parsing unit files is not something we can do off the main
+         * thread, since the parsers modify the units and the manager liberally, but looking for drop-ins
+         * only reads the file system and the unit path cache, which doesn't change while we do that. */
+
+        /* Units are prepended to the load queue, hence the ones we haven't looked at yet are at the front */
+        LIST_FOREACH(load_queue, u, m->load_queue) {
+                if (u->load_prefetched)
+                        break;
+
+                u->load_prefetched = true;
+
+                if (u->transient || u->dropin_prefetch)
+                        continue;
+
+                if (!GREEDY_REALLOC(units, n_units + 1))
+                        return log_oom();
+
+                units[n_units++] = u;
+        }
+
+        /* Not worth the effort for a handful of units, these are looked up when they are loaded */
+        if (n_units < LOAD_QUEUE_PREFETCH_MIN)
+                return 0;
+
+        ts = now(CLOCK_MONOTONIC);
+
+        r = unit_file_load_or_build_name_map(&m->lookup_paths,
+                                             &m->unit_cache_timestamp_hash,
+                                             &m->unit_id_map,
+                                             &m->unit_name_map,
+                                             &m->unit_path_cache);
+        if (r < 0)
+                return log_error_errno(r, "Failed to rebuild name map: %m");
+
+        FOREACH_ARRAY(i, units, n_units) {
+                _cleanup_set_free_free_ Set *names = NULL;
+                const char *fragment;
+
+                /* Figure out the names the unit will have once loaded, the lookup is for those */
+                r = unit_file_find_fragment(m->unit_id_map, m->unit_name_map, (*i)->id, &fragment, &names);
+                if (r < 0 && r != -ENOENT)
+                        continue;
+
+                r = unit_dropin_prefetch_new(*i, names, &(*i)->dropin_prefetch);
+                if (r < 0)
+                        return log_oom();
+        }
+
+        n_threads = MIN(n_threads, DIV_ROUND_UP(n_units, LOAD_QUEUE_PREFETCH_MIN));
+
+        LoadPrefetchContext c = {
+                .units = units,
+                .n_units = n_units,
+                .search_path = m->lookup_paths.search_path,
+        };
+
+        threads = new(pthread_t, n_threads - 1);
+        if (!threads)
+                return log_oom();
+
+        /* No signals in the worker threads please, they are handled on the main thread */
+        assert_se(sigfillset(&ss) >= 0);
+        r = pthread_sigmask(SIG_BLOCK, &ss, &saved_ss);
+        if (r > 0)
+                return log_error_errno(r, "Failed to block signals: %m");
+
+        for (; n_started < n_threads - 1; n_started++) {
+                r = pthread_create(threads + n_started, NULL, load_prefetch_thread, &c);
+                if (r > 0) {
+                        /* Not fatal, the drop-ins of the units this thread would have taken are then looked
+                         * up by the threads already running, and by us synchronously on the main loop */
+                        log_debug_errno(r, "Failed to start drop-in lookup thread, ignoring: %m");
+                        break;
+                }
+        }
+
+        assert_se(pthread_sigmask(SIG_SETMASK, &saved_ss, NULL) == 0);
+
+        /* The main thread participates as well */
+        (void) load_prefetch_thread(&c);
+
+        FOREACH_ARRAY(t, threads, n_started)
+                assert_se(pthread_join(*t, NULL) == 0);
+
+        ts = usec_sub_unsigned(now(CLOCK_MONOTONIC), ts);
+
+        m->load_statistics.prefetch_usec += ts;
+        m->load_statistics.n_prefetched += n_units;
+        m->load_statistics.n_batches++;
+        m->load_statistics.n_threads = MAX(m->load_statistics.n_threads, (unsigned) n_started + 1);
+
+        log_debug("Looked up drop-ins of %zu queued units with %zu threads in %s.",
+                  n_units, n_started + 1, FORMAT_TIMESPAN(ts, USEC_PER_MSEC));
+        return 0;
+}
+
 unsigned manager_dispatch_load_queue(Manager *m) {
+        unsigned n = 0, n_threads;
+        usec_t ts;
         Unit *u;
-        unsigned n = 0;
 
         assert(m);
 
@@ -2300,15 +2569,27 @@ unsigned manager_dispatch_load_queue(Manager *m) {
         /* Dispatches the load queue. Takes a unit from the queue and
          * tries to load its data until the queue is empty */
 
+        ts = manager_phase_start(m, MANAGER_PHASE_UNITS_LOAD);
+        n_threads = manager_unit_load_threads(m);
+
         while ((u = m->load_queue)) {
                 assert(u->in_load_queue);
 
+                /* Loading units enqueues their dependencies. Whenever we get to a unit that was added since
+                 * the last prefetch, look up the drop-ins of the new ones in one go. */
+                if (n_threads > 1 && !u->load_prefetched)
+                        (void) manager_prefetch_load_queue(m, n_threads);
+
                 unit_load(u);
                 n++;
         }
 
         m->dispatching_load_queue = false;
 
+        m->load_statistics.load_usec += usec_sub_unsigned(now(CLOCK_MONOTONIC), ts);
+        m->load_statistics.n_loaded += n;
+        manager_phase_finish(m, MANAGER_PHASE_UNITS_LOAD, ts);
+
         /* Dispatch the units waiting for their target dependencies to be added now, as all targets that we know about
          * should be loaded and have aliases resolved */
         (void) manager_dispatch_target_deps_queue(m);
@@ -2397,7 +2678,7 @@ int manager_load_unit_prepare(
         }
 
         if (path) {
-                r = free_and_strdup(&unit->fragment_path, path);
+                r = string_intern_replace(&unit->fragment_path, path);
                 if (r < 0)
                         return r;
         }
@@ -2523,6 +2804,40 @@ void manager_trigger_run_queue(Manager *m) {
                 log_warning_errno(r, "Failed to enable job run queue event source, ignoring: %m");
 }
 
+static int manager_dispatch_dbus_signal_coalesce(sd_event_source *source, usec_t usec, void *userdata) {
+        /* Nothing to do here, the D-Bus queue is dispatched from the main loop after each iteration anyway */
+        return 0;
+}
+
+static bool manager_dbus_unit_queue_ready(Manager *m) {
+        usec_t until;
+        int r;
+
+        assert(m);
+
+        if (!m->dbus_unit_queue)
+                return false;
+
+        if (m->dbus_signal_coalesce_usec == 0)
+                return true;
+
+        until = usec_add(m->dbus_unit_queue_flushed_usec, m->dbus_signal_coalesce_usec);
+        if (now(CLOCK_MONOTONIC) >= until)
+                return true;
+
+        /* Make sure we wake up when the interval is over */
+        r = event_reset_time(m->event, &m->dbus_signal_coalesce_event_source,
+                             CLOCK_MONOTONIC, until, /* accuracy = */ 1,
+                             manager_dispatch_dbus_signal_coalesce, m,
+                             EVENT_PRIORITY_IPC, "manager-dbus-signal-coalesce", /* force_reset = */ true);
+        if (r < 0) {
+                log_warning_errno(r, "Failed to set up D-Bus signal coalescing timer, not coalescing: %m");
+                return true;
+        }
+
+        return false;
+}
+
 static unsigned manager_dispatch_dbus_queue(Manager *m) {
         unsigned n = 0, budget;
         Unit *u;
@@ -2558,15 +2873,21 @@ static unsigned manager_dispatch_dbus_queue(Manager *m) {
                 budget = MANAGER_BUS_MESSAGE_BUDGET;
         }
 
-        while (budget != 0 && (u = m->dbus_unit_queue)) {
+        if (budget == UINT_MAX || manager_dbus_unit_queue_ready(m)) {
+                while (budget != 0 && (u = m->dbus_unit_queue)) {
 
-                assert(u->in_dbus_queue);
+                        assert(u->in_dbus_queue);
 
-                bus_unit_send_change_signal(u);
-                n++;
+                        bus_unit_send_change_signal(u);
+                        n++;
 
-                if (budget != UINT_MAX)
-                        budget--;
+                        if (budget != UINT_MAX)
+                                budget--;
+                }
+
+                /* The next coalescing interval starts once everything queued so far is announced */
+                if (n > 0 && !m->dbus_unit_queue)
+                        m->dbus_unit_queue_flushed_usec = now(CLOCK_MONOTONIC);
         }
 
         while (budget != 0 && (j = m->dbus_job_queue)) {
@@ -2666,14 +2987,20 @@ static void manager_invoke_notify_message(
         }
 }
 
-static int manager_get_units_for_pidref(Manager *m, const PidRef *pidref, Unit ***ret_units) {
-        /* Determine array of every unit that is interested in the specified process */
+static int manager_get_units_for_pidref_and_cgroup(
+                Manager *m,
+                const PidRef *pidref,
+                const char *cgroup,
+                Unit ***ret_units) {
+
+        /* Determine array of every unit that is interested in the specified process, which is in the
+         * specified cgroup, if known */
 
         assert(m);
         assert(pidref_is_set(pidref));
 
         Unit *u1, *u2, **array;
-        u1 = manager_get_unit_by_pidref_cgroup(m, pidref);
+        u1 = cgroup ? manager_get_unit_by_cgroup(m, cgroup) : NULL;
         u2 = hashmap_get(m->watch_pids, pidref);
         array = hashmap_get(m->watch_pids_more, pidref);
 
@@ -2719,52 +3046,68 @@ static int manager_get_units_for_pidref(Manager *m, const PidRef *pidref, Unit *
         return (int) n;
 }
 
-static int manager_dispatch_notify_fd(sd_event_source *source, int fd, uint32_t revents, void *userdata) {
-        Manager *m = ASSERT_PTR(userdata);
-        _cleanup_fdset_free_ FDSet *fds = NULL;
-        char buf[NOTIFY_BUFFER_MAX+1];
-        struct iovec iovec = {
-                .iov_base = buf,
-                .iov_len = sizeof(buf)-1,
-        };
-        CMSG_BUFFER_TYPE(CMSG_SPACE(sizeof(struct ucred)) +
-                         CMSG_SPACE(sizeof(int) * NOTIFY_FD_MAX)) control;
-        struct msghdr msghdr = {
-                .msg_iov = &iovec,
-                .msg_iovlen = 1,
-                .msg_control = &control,
-                .msg_controllen = sizeof(control),
+static int manager_get_units_for_pidref(Manager *m, const PidRef *pidref, Unit ***ret_units) {
+        _cleanup_free_ char *cgroup = NULL;
+
+        assert(m);
+        assert(pidref_is_set(pidref));
+
+        (void) cg_pidref_get_path(SYSTEMD_CGROUP_CONTROLLER, pidref, &cgroup);
+
+        return manager_get_units_for_pidref_and_cgroup(m, pidref, cgroup, ret_units);
+}
+
+static const char* notify_batch_get_cgroup(NotifyBatch *b, const PidRef *pidref) {
+        char *cgroup = NULL;
+
+        assert(b);
+        assert(pidref_is_set(pidref));
+
+        FOREACH_ARRAY(i, b->senders, b->n_senders)
+                if (i->pid == pidref->pid)
+                        return i->cgroup;
+
+        /* Remember failures to look up the cgroup too, there is no point in retrying them */
+        (void) cg_pidref_get_path(SYSTEMD_CGROUP_CONTROLLER, pidref, &cgroup);
+
+        assert(b->n_senders < NOTIFY_BATCH_MAX);
+        b->senders[b->n_senders++] = (typeof(b->senders[0])) {
+                .pid = pidref->pid,
+                .cgroup = cgroup,
         };
 
+        return cgroup;
+}
+
+static void notify_batch_done(NotifyBatch *b) {
+        assert(b);
+
+        FOREACH_ARRAY(i, b->senders, b->n_senders)
+                free(i->cgroup);
+
+        b->n_senders = 0;
+}
+
+static void manager_process_notify_message(Manager *m, NotifyBatch *b, struct msghdr *msghdr, char *buf, size_t n) {
+        _cleanup_fdset_free_ FDSet *fds = NULL;
         struct cmsghdr *cmsg;
         struct ucred *ucred = NULL;
         _cleanup_strv_free_ char **tags = NULL;
         int r, *fd_array = NULL;
         size_t n_fds = 0;
-        ssize_t n;
-
-        assert(m->notify_fd == fd);
 
-        if (revents != EPOLLIN) {
-                log_warning("Got unexpected poll event for notify fd.");
-                return 0;
-        }
+        assert(m);
+        assert(b);
+        assert(msghdr);
+        assert(buf);
 
-        n = recvmsg_safe(m->notify_fd, &msghdr, MSG_DONTWAIT|MSG_CMSG_CLOEXEC|MSG_TRUNC);
-        if (ERRNO_IS_NEG_TRANSIENT(n))
-                return 0; /* Spurious wakeup, try again */
-        if (n == -EXFULL) {
+        if (FLAGS_SET(msghdr->msg_flags, MSG_CTRUNC)) {
+                cmsg_close_all(msghdr);
                 log_warning("Got message with truncated control data (too many fds sent?), ignoring.");
-                return 0;
+                return;
         }
-        if (n < 0)
-                /* If this is any other, real error, then stop processing this socket. This of course means
-                 * we won't take notification messages anymore, but that's still better than busy looping:
-                 * being woken up over and over again, but being unable to actually read the message from the
-                 * socket. */
-                return log_error_errno(n, "Failed to receive notification message: %m");
 
-        CMSG_FOREACH(cmsg, &msghdr)
+        CMSG_FOREACH(cmsg, msghdr)
                 if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
 
                         assert(!fd_array);
@@ -2786,25 +3129,25 @@ static int manager_dispatch_notify_fd(sd_event_source *source, int fd, uint32_t
                 if (r < 0) {
                         close_many(fd_array, n_fds);
                         log_oom();
-                        return 0;
+                        return;
                 }
         }
 
         if (!ucred || !pid_is_valid(ucred->pid)) {
                 log_warning("Received notify message without valid credentials. Ignoring.");
-                return 0;
+                return;
         }
 
-        if ((size_t) n >= sizeof(buf) || (msghdr.msg_flags & MSG_TRUNC)) {
+        if (n > NOTIFY_BUFFER_MAX || (msghdr->msg_flags & MSG_TRUNC)) {
                 log_warning("Received notify message exceeded maximum size. Ignoring.");
-                return 0;
+                return;
         }
 
         /* As extra safety check, let's make sure the string we get doesn't contain embedded NUL bytes.
          * We permit one trailing NUL byte in the message, but don't expect it. */
         if (n > 1 && memchr(buf, 0, n-1)) {
                 log_warning("Received notify message with embedded NUL bytes. Ignoring.");
-                return 0;
+                return;
         }
 
         /* Make sure it's NUL-terminated, then parse it to obtain the tags list. */
@@ -2812,13 +3155,13 @@ static int manager_dispatch_notify_fd(sd_event_source *source, int fd, uint32_t
         tags = strv_split_newlines(buf);
         if (!tags) {
                 log_oom();
-                return 0;
+                return;
         }
 
         /* Possibly a barrier fd, let's see. */
         if (manager_process_barrier_fd(tags, fds)) {
                 log_debug("Received barrier notification message from PID " PID_FMT ".", ucred->pid);
-                return 0;
+                return;
         }
 
         /* Increase the generation counter used for filtering out duplicate unit invocations. */
@@ -2827,13 +3170,15 @@ static int manager_dispatch_notify_fd(sd_event_source *source, int fd, uint32_t
         /* Generate lookup key from the PID (we have no pidfd here, after all) */
         PidRef pidref = PIDREF_MAKE_FROM_PID(ucred->pid);
 
-        /* Notify every unit that might be interested, which might be multiple. */
+        /* Notify every unit that might be interested, which might be multiple. The units watching the PID
+         * are looked up for every message, as handling one message might change them (think MAINPID=),
+         * only the cgroup of the sender is reused within the batch. */
         _cleanup_free_ Unit **array = NULL;
 
-        int n_array = manager_get_units_for_pidref(m, &pidref, &array);
+        int n_array = manager_get_units_for_pidref_and_cgroup(m, &pidref, notify_batch_get_cgroup(b, &pidref), &array);
         if (n_array < 0) {
                 log_warning_errno(n_array, "Failed to determine units for PID " PID_FMT ", ignoring: %m", ucred->pid);
-                return 0;
+                return;
         }
         if (n_array == 0)
                 log_debug("Cannot find unit for notify message of PID "PID_FMT", ignoring.", ucred->pid);
@@ -2845,6 +3190,66 @@ static int manager_dispatch_notify_fd(sd_event_source *source, int fd, uint32_t
 
         if (!fdset_isempty(fds))
                 log_warning("Got extra auxiliary fds with notification message, closing them.");
+}
+
+static int manager_dispatch_notify_fd(sd_event_source *source, int fd, uint32_t revents, void *userdata) {
+        Manager *m = ASSERT_PTR(userdata);
+        NotifyBatch *b;
+        int n;
+
+        assert(m->notify_fd == fd);
+
+        if (revents != EPOLLIN) {
+                log_warning("Got unexpected poll event for notify fd.");
+                return 0;
+        }
+
+        /* Services with a watchdog or frequent status updates may send us a lot of messages, hence receive
+         * up to NOTIFY_BATCH_MAX of them at once. Any updates of the D-Bus properties they cause are
+         * coalesced by the D-Bus queue, which is only dispatched after we returned to the event loop. */
+
+        if (!m->notify_batch) {
+                m->notify_batch = new(NotifyBatch, 1);
+                if (!m->notify_batch) {
+                        log_oom();
+                        return 0;
+                }
+        }
+
+        b = m->notify_batch;
+
+        for (size_t i = 0; i < NOTIFY_BATCH_MAX; i++) {
+                /* We pass MSG_TRUNC, hence msg_len is the full size of the datagram, and we can detect
+                 * oversized ones. One byte is left for the trailing NUL we add later. */
+                b->iovecs[i] = IOVEC_MAKE(b->buffers[i], sizeof(b->buffers[i]) - 1);
+                b->messages[i] = (struct mmsghdr) {
+                        .msg_hdr = {
+                                .msg_iov = b->iovecs + i,
+                                .msg_iovlen = 1,
+                                .msg_control = b->controls + i,
+                                .msg_controllen = sizeof(b->controls[i]),
+                        },
+                };
+        }
+
+        b->n_senders = 0;
+
+        n = recvmmsg(m->notify_fd, b->messages, NOTIFY_BATCH_MAX, MSG_DONTWAIT|MSG_CMSG_CLOEXEC|MSG_TRUNC, NULL);
+        if (n < 0) {
+                if (ERRNO_IS_TRANSIENT(errno))
+                        return 0; /* Spurious wakeup, try again */
+
+                /* If this is any other, real error, then stop processing this socket. This of course means
+                 * we won't take notification messages anymore, but that's still better than busy looping:
+                 * being woken up over and over again, but being unable to actually read the message from the
+                 * socket. */
+                return log_error_errno(errno, "Failed to receive notification message: %m");
+        }
+
+        for (int i = 0; i < n; i++)
+                manager_process_notify_message(m, b, &b->messages[i].msg_hdr, b->buffers[i], b->messages[i].msg_len);
+
+        notify_batch_done(b);
 
         return 0;
 }
@@ -2870,38 +3275,40 @@ static void manager_invoke_sigchld_event(
                 UNIT_VTABLE(u)->sigchld_event(u, si->si_pid, si->si_code, si->si_status);
 }
 
-static int manager_dispatch_sigchld(sd_event_source *source, void *userdata) {
-        Manager *m = ASSERT_PTR(userdata);
+static int manager_reap_child(Manager *m, Set **oom_checked) {
         siginfo_t si = {};
-        int r;
 
-        assert(source);
+        assert(m);
+        assert(oom_checked);
 
         /* First we call waitid() for a PID and do not reap the zombie. That way we can still access
-         * /proc/$PID for it while it is a zombie. */
+         * /proc/$PID for it while it is a zombie. Returns > 0 if a child was processed, 0 if there are no
+         * more. */
 
         if (waitid(P_ALL, 0, &si, WEXITED|WNOHANG|WNOWAIT) < 0) {
 
                 if (errno != ECHILD)
                         log_error_errno(errno, "Failed to peek for child with waitid(), ignoring: %m");
 
-                goto turn_off;
+                return 0;
         }
 
         if (si.si_pid <= 0)
-                goto turn_off;
+                return 0;
 
         if (IN_SET(si.si_code, CLD_EXITED, CLD_KILLED, CLD_DUMPED)) {
-                _cleanup_free_ char *name = NULL;
-                (void) pid_get_comm(si.si_pid, &name);
-
-                log_debug("Child "PID_FMT" (%s) died (code=%s, status=%i/%s)",
-                          si.si_pid, strna(name),
-                          sigchld_code_to_string(si.si_code),
-                          si.si_status,
-                          strna(si.si_code == CLD_EXITED
-                                ? exit_status_to_string(si.si_status, EXIT_STATUS_FULL)
-                                : signal_to_string(si.si_status)));
+                if (DEBUG_LOGGING) {
+                        _cleanup_free_ char *name = NULL;
+                        (void) pid_get_comm(si.si_pid, &name);
+
+                        log_debug("Child "PID_FMT" (%s) died (code=%s, status=%i/%s)",
+                                  si.si_pid, strna(name),
+                                  sigchld_code_to_string(si.si_code),
+                                  si.si_status,
+                                  strna(si.si_code == CLD_EXITED
+                                        ? exit_status_to_string(si.si_status, EXIT_STATUS_FULL)
+                                        : signal_to_string(si.si_status)));
+                }
 
                 /* Increase the generation counter used for filtering out duplicate unit invocations */
                 m->sigchldgen++;
@@ -2919,11 +3326,16 @@ static int manager_dispatch_sigchld(sd_event_source *source, void *userdata) {
                         log_debug("Got SIGCHLD for process " PID_FMT " we weren't interested in, ignoring.", si.si_pid);
                 else {
                         /* We check for an OOM condition, in case we got SIGCHLD before the OOM notification.
-                         * We only do this for the cgroup the PID belonged to, which is the f */
-                        (void) unit_check_oom(array[0]);
-
-                        /* We check if systemd-oomd performed a kill so that we log and notify appropriately */
-                        (void) unit_check_oomd_kill(array[0]);
+                         * We only do this for the cgroup the PID belonged to, which is the first unit in
+                         * the array. If many processes of the same unit die at once, there's no point in
+                         * checking this again for each of them. */
+                        if (set_ensure_put(oom_checked, NULL, array[0]) != 0) {
+                                (void) unit_check_oom(array[0]);
+
+                                /* We check if systemd-oomd performed a kill so that we log and notify
+                                 * appropriately */
+                                (void) unit_check_oomd_kill(array[0]);
+                        }
 
                         /* Finally, execute them all. Note that the array might contain duplicates, but that's fine,
                          * manager_invoke_sigchld_event() will ensure we only invoke the handlers once for each
@@ -2934,10 +3346,27 @@ static int manager_dispatch_sigchld(sd_event_source *source, void *userdata) {
         }
 
         /* And now, we actually reap the zombie. */
-        if (waitid(P_PID, si.si_pid, &si, WEXITED) < 0) {
+        if (waitid(P_PID, si.si_pid, &si, WEXITED) < 0)
                 log_error_errno(errno, "Failed to dequeue child, ignoring: %m");
-                return 0;
-        }
+
+        return 1;
+}
+
+static int manager_dispatch_sigchld(sd_event_source *source, void *userdata) {
+        Manager *m = ASSERT_PTR(userdata);
+        _cleanup_set_free_ Set *oom_checked = NULL;
+        int r;
+
+        assert(source);
+
+        /* Reap a bunch of children at once, so that the queues filled by the state changes they trigger (bus
+         * messages, GC, cgroup empty checks, …) are processed once for all of them rather than once per
+         * child. But don't starve the other event sources if lots of processes keep dying: if we hit the
+         * budget, leave the event source enabled and continue in the next event loop iteration. */
+
+        for (unsigned n = 0; n < MANAGER_SIGCHLD_BUDGET; n++)
+                if (manager_reap_child(m, &oom_checked) == 0)
+                        goto turn_off;
 
         return 0;
 
@@ -3314,6 +3743,7 @@ static int manager_dispatch_jobs_in_progress(sd_event_source *source, usec_t use
 
 int manager_loop(Manager *m) {
         RateLimit rl = { .interval = 1*USEC_PER_SEC, .burst = 50000 };
+        usec_t gc_deadline = USEC_INFINITY;
         int r;
 
         assert(m);
@@ -3342,10 +3772,16 @@ int manager_loop(Manager *m) {
                 if (manager_dispatch_gc_job_queue(m) > 0)
                         continue;
 
-                if (manager_dispatch_gc_unit_queue(m) > 0)
+                /* Garbage collecting and freeing thousands of units at once (e.g. after mass scope teardown)
+                 * can take a while. Hence limit how much time we spend on it per event loop iteration, and
+                 * leave the rest for the next one, so that we remain responsive in the meantime. */
+                if (gc_deadline == USEC_INFINITY)
+                        gc_deadline = usec_add(now(CLOCK_MONOTONIC), MANAGER_GC_BUDGET_USEC);
+
+                if (manager_dispatch_gc_unit_queue(m, gc_deadline) > 0)
                         continue;
 
-                if (manager_dispatch_cleanup_queue(m) > 0)
+                if (manager_dispatch_cleanup_queue(m, gc_deadline) > 0)
                         continue;
 
                 if (manager_dispatch_cgroup_realize_queue(m) > 0)
@@ -3366,10 +3802,13 @@ int manager_loop(Manager *m) {
                 if (manager_dispatch_dbus_queue(m) > 0)
                         continue;
 
-                /* Sleep for watchdog runtime wait time */
-                r = sd_event_run(m->event, watchdog_runtime_wait());
+                /* Sleep for watchdog runtime wait time, unless we ran out of time for garbage collection
+                 * above, in which case we only look for pending events and come back right away. */
+                r = sd_event_run(m->event, m->gc_unit_queue || m->cleanup_queue ? 0 : watchdog_runtime_wait());
                 if (r < 0)
                         return log_error_errno(r, "Failed to run event loop: %m");
+
+                gc_deadline = USEC_INFINITY;
         }
 
         return m->objective;
@@ -3641,6 +4080,7 @@ int manager_reload(Manager *m) {
         _unused_ _cleanup_(manager_reloading_stopp) Manager *reloading = NULL;
         _cleanup_fdset_free_ FDSet *fds = NULL;
         _cleanup_fclose_ FILE *f = NULL;
+        usec_t ts;
         int r;
 
         assert(m);
@@ -3691,14 +4131,19 @@ int manager_reload(Manager *m) {
 
         /* We flushed out generated files, for which we don't watch mtime, so we should flush the old map. */
         manager_free_unit_name_maps(m);
+        install_cache_flush(m->install_cache);
         m->unit_file_state_outdated = false;
 
+        m->load_statistics = (ManagerLoadStatistics) {};
+
         /* First, enumerate what we can from kernel and suchlike */
         manager_enumerate_perpetual(m);
         manager_enumerate(m);
 
         /* Second, deserialize our stored data */
+        ts = manager_phase_start(m, MANAGER_PHASE_DESERIALIZE);
         r = manager_deserialize(m, f, fds);
+        manager_phase_finish(m, MANAGER_PHASE_DESERIALIZE, ts);
         if (r < 0)
                 log_warning_errno(r, "Deserialization failed, proceeding anyway: %m");
 
@@ -4003,6 +4448,7 @@ static int manager_run_environment_generators(Manager *m) {
                 [STDOUT_COLLECT]  = &tmp,
                 [STDOUT_CONSUME]  = &m->transient_environment,
         };
+        usec_t ts;
         int r;
 
         if (MANAGER_IS_TEST_RUN(m) && !(m->test_run_flags & MANAGER_TEST_RUN_ENV_GENERATORS))
@@ -4015,10 +4461,14 @@ static int manager_run_environment_generators(Manager *m) {
         if (!generator_path_any((const char* const*) paths))
                 return 0;
 
+        ts = manager_phase_start(m, MANAGER_PHASE_ENVIRONMENT_GENERATORS);
+
         WITH_UMASK(0022)
                 r = execute_directories((const char* const*) paths, DEFAULT_TIMEOUT_USEC, gather_environment,
                                         args, NULL, m->transient_environment,
                                         EXEC_DIR_PARALLEL | EXEC_DIR_IGNORE_ERRORS | EXEC_DIR_SET_SYSTEMD_EXEC_PID);
+
+        manager_phase_finish(m, MANAGER_PHASE_ENVIRONMENT_GENERATORS, ts);
         return r;
 }
 
@@ -4091,21 +4541,28 @@ static int build_generator_environment(Manager *m, char ***ret) {
         return 0;
 }
 
-static int manager_execute_generators(Manager *m, char **paths, bool remount_ro) {
+static char* manager_generator_cache_dir(Manager *m) {
+        assert(m);
+
+        /* Where each generator's own output is kept, so that it can be reused if its inputs didn't change */
+        return strjoin(m->lookup_paths.generator, ".cache");
+}
+
+static int manager_execute_generators(Manager *m, char **paths, char **dirs, bool remount_ro) {
         _cleanup_strv_free_ char **ge = NULL;
-        const char *argv[] = {
-                NULL, /* Leave this empty, execute_directory() will fill something in */
-                m->lookup_paths.generator,
-                m->lookup_paths.generator_early,
-                m->lookup_paths.generator_late,
-                NULL,
-        };
+        _cleanup_free_ char *cache_dir = NULL;
         int r;
 
+        assert(strv_length(dirs) == 3);
+
         r = build_generator_environment(m, &ge);
         if (r < 0)
                 return log_error_errno(r, "Failed to build generator environment: %m");
 
+        cache_dir = manager_generator_cache_dir(m);
+        if (!cache_dir)
+                return log_oom();
+
         if (remount_ro) {
                 /* Remount most of the filesystem tree read-only. We leave /sys/ as-is, because our code
                  * checks whether it is read-only to detect containerized execution environments. We leave
@@ -4119,46 +4576,48 @@ static int manager_execute_generators(Manager *m, char **paths, bool remount_ro)
         }
 
         BLOCK_WITH_UMASK(0022);
-        return execute_directories(
-                        (const char* const*) paths,
-                        DEFAULT_TIMEOUT_USEC,
-                        /* callbacks= */ NULL, /* callback_args= */ NULL,
-                        (char**) argv,
-                        ge,
-                        EXEC_DIR_PARALLEL | EXEC_DIR_IGNORE_ERRORS | EXEC_DIR_SET_SYSTEMD_EXEC_PID);
+        return generator_cache_execute(paths, cache_dir, dirs, ge, DEFAULT_TIMEOUT_USEC);
 }
 
-static int manager_run_generators(Manager *m) {
-        ForkFlags flags = FORK_RESET_SIGNALS | FORK_WAIT | FORK_NEW_MOUNTNS | FORK_MOUNTNS_SLAVE;
-        _cleanup_strv_free_ char **paths = NULL;
+static void manager_load_generator_results(Manager *m) {
+        _cleanup_free_ char *cache_dir = NULL;
+        GeneratorResult *results;
+        size_t n, n_reused = 0;
         int r;
 
         assert(m);
 
-        if (MANAGER_IS_TEST_RUN(m) && !(m->test_run_flags & MANAGER_TEST_RUN_GENERATORS))
-                return 0;
+        cache_dir = manager_generator_cache_dir(m);
+        if (!cache_dir)
+                return (void) log_oom_debug();
 
-        paths = generator_binary_paths(m->runtime_scope);
-        if (!paths)
-                return log_oom();
+        r = generator_cache_load_results(cache_dir, &results, &n);
+        if (r < 0)
+                return (void) log_debug_errno(r, "Failed to load results of generators, ignoring: %m");
 
-        if (!generator_path_any((const char* const*) paths))
-                return 0;
+        generator_result_free_many(m->generator_results, m->n_generator_results);
+        m->generator_results = results;
+        m->n_generator_results = n;
 
-        r = lookup_paths_mkdir_generator(&m->lookup_paths);
-        if (r < 0) {
-                log_error_errno(r, "Failed to create generator directories: %m");
-                goto finish;
-        }
+        FOREACH_ARRAY(i, results, n)
+                if (i->reused)
+                        n_reused++;
+
+        log_debug("Ran %zu generators, reused the previous output of %zu of them.", n - n_reused, n_reused);
+}
+
+static int manager_fork_generators(Manager *m, char **paths, char **dirs) {
+        ForkFlags flags = FORK_RESET_SIGNALS | FORK_WAIT | FORK_NEW_MOUNTNS | FORK_MOUNTNS_SLAVE;
+        int r;
+
+        assert(m);
 
         /* If we are the system manager, we fork and invoke the generators in a sanitized mount namespace. If
          * we are the user manager, let's just execute the generators directly. We might not have the
          * necessary privileges, and the system manager has already mounted /tmp/ and everything else for us.
          */
-        if (MANAGER_IS_USER(m)) {
-                r = manager_execute_generators(m, paths, /* remount_ro= */ false);
-                goto finish;
-        }
+        if (MANAGER_IS_USER(m))
+                return manager_execute_generators(m, paths, dirs, /* remount_ro= */ false);
 
         /* On some systems /tmp/ doesn't exist, and on some other systems we cannot create it at all. Avoid
          * trying to mount a private tmpfs on it as there's no one size fits all. */
@@ -4167,14 +4626,12 @@ static int manager_run_generators(Manager *m) {
 
         r = safe_fork("(sd-gens)", flags, NULL);
         if (r == 0) {
-                r = manager_execute_generators(m, paths, /* remount_ro= */ true);
+                r = manager_execute_generators(m, paths, dirs, /* remount_ro= */ true);
                 _exit(r >= 0 ? EXIT_SUCCESS : EXIT_FAILURE);
         }
         if (r < 0) {
-                if (!ERRNO_IS_PRIVILEGE(r) && r != -EINVAL) {
-                        log_error_errno(r, "Failed to fork off sandboxing environment for executing generators: %m");
-                        goto finish;
-                }
+                if (!ERRNO_IS_PRIVILEGE(r) && r != -EINVAL)
+                        return log_error_errno(r, "Failed to fork off sandboxing environment for executing generators: %m");
 
                 /* Failed to fork with new mount namespace? Maybe, running in a container environment with
                  * seccomp or without capability.
@@ -4188,14 +4645,301 @@ static int manager_run_generators(Manager *m) {
                 log_debug_errno(r,
                                 "Failed to fork off sandboxing environment for executing generators. "
                                 "Falling back to execute generators without sandboxing: %m");
-                r = manager_execute_generators(m, paths, /* remount_ro= */ false);
+                r = manager_execute_generators(m, paths, dirs, /* remount_ro= */ false);
         }
 
+        return r;
+}
+
+static int manager_run_generators(Manager *m) {
+        _cleanup_strv_free_ char **paths = NULL;
+        usec_t ts;
+        int r;
+
+        assert(m);
+
+        if (MANAGER_IS_TEST_RUN(m) && !(m->test_run_flags & MANAGER_TEST_RUN_GENERATORS))
+                return 0;
+
+        paths = generator_binary_paths(m->runtime_scope);
+        if (!paths)
+                return log_oom();
+
+        if (!generator_path_any((const char* const*) paths))
+                return 0;
+
+        ts = manager_phase_start(m, MANAGER_PHASE_GENERATORS);
+
+        r = lookup_paths_mkdir_generator(&m->lookup_paths);
+        if (r < 0) {
+                log_error_errno(r, "Failed to create generator directories: %m");
+                goto finish;
+        }
+
+        r = manager_fork_generators(m, paths,
+                                    STRV_MAKE(m->lookup_paths.generator,
+                                              m->lookup_paths.generator_early,
+                                              m->lookup_paths.generator_late));
+
+        manager_load_generator_results(m);
+
 finish:
         lookup_paths_trim_generator(&m->lookup_paths);
+        manager_phase_finish(m, MANAGER_PHASE_GENERATORS, ts);
+        return r;
+}
+
+static int generator_dirs_equal(const char *a, const char *b, const char *root_a, const char *root_b) {
+        _cleanup_free_ DirectoryEntries *da = NULL, *db = NULL;
+        size_t n_a, n_b;
+        int r;
+
+        assert(a);
+        assert(b);
+        assert(root_a);
+        assert(root_b);
+
+        /* A missing directory is considered equal to an empty one, as we remove empty output directories
+         * after running the generators. */
+        r = readdir_all_at(AT_FDCWD, a, RECURSE_DIR_SORT|RECURSE_DIR_ENSURE_TYPE, &da);
+        if (r < 0 && r != -ENOENT)
+                return r;
+
+        r = readdir_all_at(AT_FDCWD, b, RECURSE_DIR_SORT|RECURSE_DIR_ENSURE_TYPE, &db);
+        if (r < 0 && r != -ENOENT)
+                return r;
+
+        n_a = da ? da->n_entries : 0;
+        n_b = db ? db->n_entries : 0;
+        if (n_a != n_b)
+                return false;
+
+        for (size_t i = 0; i < n_a; i++) {
+                const struct dirent *x = da->entries[i], *y = db->entries[i];
+                _cleanup_free_ char *p = NULL, *q = NULL;
+
+                if (!streq(x->d_name, y->d_name) || x->d_type != y->d_type)
+                        return false;
+
+                p = path_join(a, x->d_name);
+                q = path_join(b, y->d_name);
+                if (!p || !q)
+                        return -ENOMEM;
+
+                switch (x->d_type) {
+
+                case DT_DIR:
+                        r = generator_dirs_equal(p, q, root_a, root_b);
+                        if (r <= 0)
+                                return r;
+                        break;
+
+                case DT_LNK: {
+                        _cleanup_free_ char *target_a = NULL, *target_b = NULL;
+                        const char *e, *f;
+
+                        r = readlink_malloc(p, &target_a);
+                        if (r < 0)
+                                return r;
+
+                        r = readlink_malloc(q, &target_b);
+                        if (r < 0)
+                                return r;
+
+                        /* Generators link to the units they wrote by absolute path, too, hence compare such
+                         * links relative to the output directory. */
+                        e = path_startswith(target_a, root_a) ?: target_a;
+                        f = path_startswith(target_b, root_b) ?: target_b;
+                        if (!streq(e, f))
+                                return false;
+                        break;
+                }
+
+                case DT_REG: {
+                        _cleanup_free_ char *c = NULL, *d = NULL;
+                        size_t n_c, n_d;
+
+                        r = read_full_file(p, &c, &n_c);
+                        if (r < 0)
+                                return r;
+
+                        r = read_full_file(q, &d, &n_d);
+                        if (r < 0)
+                                return r;
+
+                        if (memcmp_nn(c, n_c, d, n_d) != 0)
+                                return false;
+                        break;
+                }
+
+                default:
+                        return false;
+                }
+        }
+
+        return true;
+}
+
+static int manager_generator_output_changed(Manager *m) {
+        _cleanup_strv_free_ char **paths = NULL, **dirs = NULL, **staging = NULL;
+        int r;
+
+        assert(m);
+
+        /* Runs the generators into directories next to the current output directories, and compares the
+         * result with what the units were loaded from. Returns > 0 if it differs. */
+
+        if (MANAGER_IS_TEST_RUN(m) && !(m->test_run_flags & MANAGER_TEST_RUN_GENERATORS))
+                return false;
+
+        if (!m->lookup_paths.generator || !m->lookup_paths.generator_early || !m->lookup_paths.generator_late)
+                return true;
+
+        paths = generator_binary_paths(m->runtime_scope);
+        if (!paths)
+                return log_oom();
+
+        dirs = strv_new(m->lookup_paths.generator,
+                        m->lookup_paths.generator_early,
+                        m->lookup_paths.generator_late);
+        if (!dirs)
+                return log_oom();
+
+        STRV_FOREACH(d, dirs) {
+                _cleanup_free_ char *s = strjoin(*d, ".new");
+                if (!s)
+                        return log_oom();
+
+                (void) rm_rf(s, REMOVE_ROOT|REMOVE_PHYSICAL);
+
+                r = strv_consume(&staging, TAKE_PTR(s));
+                if (r < 0)
+                        return log_oom();
+        }
+
+        if (generator_path_any((const char* const*) paths)) {
+                STRV_FOREACH(s, staging) {
+                        r = mkdir_p_label(*s, 0755);
+                        if (r < 0) {
+                                log_warning_errno(r, "Failed to create directory '%s': %m", *s);
+                                goto finish;
+                        }
+                }
+
+                r = manager_fork_generators(m, paths, staging);
+                if (r < 0)
+                        goto finish;
+        }
+
+        for (size_t i = 0; i < 3; i++) {
+                r = generator_dirs_equal(dirs[i], staging[i], dirs[i], staging[i]);
+                if (r < 0) {
+                        log_warning_errno(r, "Failed to compare generator output in '%s' and '%s': %m", dirs[i], staging[i]);
+                        goto finish;
+                }
+                if (r == 0) {
+                        log_debug("Output of generators in '%s' changed.", dirs[i]);
+                        r = true;
+                        goto finish;
+                }
+        }
+
+        r = false;
+
+finish:
+        STRV_FOREACH(s, staging)
+                (void) rm_rf(*s, REMOVE_ROOT|REMOVE_PHYSICAL);
+
         return r;
 }
 
+static bool manager_unit_changed(Manager *m, Unit *u) {
+        _cleanup_set_free_ Set *names = NULL;
+        const char *fragment = NULL, *n;
+        int r;
+
+        assert(m);
+        assert(u);
+
+        switch (u->load_state) {
+
+        case UNIT_STUB:
+        case UNIT_MERGED:
+                return false;
+
+        case UNIT_ERROR:
+                /* Loading might succeed this time */
+                return true;
+
+        default:
+                ;
+        }
+
+        if (unit_need_daemon_reload(u))
+                return true;
+
+        if (u->load_state == UNIT_LOADED && unit_dependency_dropins_changed(u))
+                return true;
+
+        if (u->transient)
+                return false;
+
+        /* Did a unit file appear for a unit that had none, or did a different one or a new alias show up? */
+        r = unit_file_find_fragment(m->unit_id_map, m->unit_name_map, u->id, &fragment, &names);
+        if (r < 0 && r != -ENOENT)
+                return true;
+
+        if (!streq_ptr(fragment, u->fragment_path))
+                return true;
+
+        SET_FOREACH(n, names)
+                if (!streq(n, u->id) && !set_contains(u->aliases, n))
+                        return true;
+
+        return false;
+}
+
+int manager_need_reload(Manager *m) {
+        const char *k;
+        Unit *u;
+        int r;
+
+        assert(m);
+
+        /* Checks whether reloading would change the configuration of any unit, i.e. whether any unit file,
+         * drop-in or generator output changed since the units were loaded. Returns > 0 if so, or if we
+         * cannot tell, and 0 if reloading can be skipped. */
+
+        if (m->unit_file_state_outdated)
+                return true;
+
+        /* Pick up added and removed unit files and aliases */
+        r = unit_file_load_or_build_name_map(&m->lookup_paths,
+                                             &m->unit_cache_timestamp_hash,
+                                             &m->unit_id_map,
+                                             &m->unit_name_map,
+                                             &m->unit_path_cache);
+        if (r < 0)
+                return log_warning_errno(r, "Failed to rebuild name map: %m");
+
+        HASHMAP_FOREACH_KEY(u, k, m->units) {
+                /* Skip aliases */
+                if (!streq(k, u->id))
+                        continue;
+
+                if (manager_unit_changed(m, u)) {
+                        log_unit_debug(u, "Unit configuration changed on disk.");
+                        return true;
+                }
+        }
+
+        /* The output of the generators might depend on the environment, hence update it first, like a
+         * reload does */
+        (void) manager_run_environment_generators(m);
+
+        return manager_generator_output_changed(m);
+}
+
 int manager_transient_environment_add(Manager *m, char **plus) {
         char **a;
 
@@ -4822,6 +5566,9 @@ static void manager_vacuum(Manager *m) {
 
         /* Release any runtimes no longer referenced */
         exec_shared_runtime_vacuum(m);
+
+        /* Forget about unit files that were not loaded since we last got here */
+        config_parse_cache_trim(m->config_parse_cache);
 }
 
 static int manager_dispatch_user_lookup_fd(sd_event_source *source, int fd, uint32_t revents, void *userdata) {
@@ -5028,6 +5775,35 @@ ManagerTimestamp manager_timestamp_initrd_mangle(ManagerTimestamp s) {
         return s;
 }
 
+usec_t manager_phase_start(Manager *m, ManagerPhase p) {
+        usec_t n;
+
+        assert(m);
+        assert(p >= 0 && p < _MANAGER_PHASE_MAX);
+
+        n = now(CLOCK_MONOTONIC);
+
+        if (m->phases[p].n_runs == 0)
+                m->phases[p].first_start = n;
+
+        return n;
+}
+
+void manager_phase_finish(Manager *m, ManagerPhase p, usec_t start) {
+        ManagerPhaseStatistics *s;
+        usec_t n;
+
+        assert(m);
+        assert(p >= 0 && p < _MANAGER_PHASE_MAX);
+
+        n = now(CLOCK_MONOTONIC);
+        s = m->phases + p;
+
+        s->last_finish = n;
+        s->total_usec = usec_add(s->total_usec, usec_sub_unsigned(n, start));
+        s->n_runs++;
+}
+
 int manager_allocate_idle_pipe(Manager *m) {
         int r;
 
@@ -5162,6 +5938,21 @@ static const char* const manager_timestamp_table[_MANAGER_TIMESTAMP_MAX] = {
 
 DEFINE_STRING_TABLE_LOOKUP(manager_timestamp, ManagerTimestamp);
 
+static const char* const manager_phase_table[_MANAGER_PHASE_MAX] = {
+        [MANAGER_PHASE_ENVIRONMENT_GENERATORS] = "environment-generators",
+        [MANAGER_PHASE_GENERATORS]             = "generators",
+        [MANAGER_PHASE_UNITS_ENUMERATE]        = "units-enumerate",
+        [MANAGER_PHASE_UNITS_LOAD]             = "units-load",
+        [MANAGER_PHASE_DESERIALIZE]            = "deserialize",
+        [MANAGER_PHASE_BUS_SETUP]              = "bus-setup",
+        [MANAGER_PHASE_VARLINK_SETUP]          = "varlink-setup",
+        [MANAGER_PHASE_COLDPLUG]               = "coldplug",
+        [MANAGER_PHASE_TRANSACTION]            = "transaction",
+        [MANAGER_PHASE_CGROUP_REALIZE]         = "cgroup-realize",
+};
+
+DEFINE_STRING_TABLE_LOOKUP(manager_phase, ManagerPhase);
+
 static const char* const oom_policy_table[_OOM_POLICY_MAX] = {
         [OOM_CONTINUE] = "continue",
         [OOM_STOP]     = "stop",
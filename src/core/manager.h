@@ -33,6 +33,8 @@ enum {
 assert_cc((int) _MANAGER_SIGNAL_COMMAND_MAX <= (int) _COMMON_SIGNAL_COMMAND_PRIVATE_END);
 
 typedef struct Manager Manager;
+typedef struct NotifyBatch NotifyBatch;
+typedef struct ExecutorPoolEntry ExecutorPoolEntry;
 
 /* An externally visible state. We don't actually maintain this as state variable, but derive it from various fields
  * when requested */
@@ -127,6 +129,24 @@ typedef enum ManagerTimestamp {
         _MANAGER_TIMESTAMP_INVALID = -EINVAL,
 } ManagerTimestamp;
 
+/* Stretches of work done inside the manager itself, on top of what ManagerTimestamp records for the boot
+ * as a whole. Each may run many times over the lifetime of the manager, and some nest: loading units is
+ * also part of deserializing, enumerating or building a transaction for instance. */
+typedef enum ManagerPhase {
+        MANAGER_PHASE_ENVIRONMENT_GENERATORS,
+        MANAGER_PHASE_GENERATORS,
+        MANAGER_PHASE_UNITS_ENUMERATE,
+        MANAGER_PHASE_UNITS_LOAD,
+        MANAGER_PHASE_DESERIALIZE,
+        MANAGER_PHASE_BUS_SETUP,
+        MANAGER_PHASE_VARLINK_SETUP,
+        MANAGER_PHASE_COLDPLUG,
+        MANAGER_PHASE_TRANSACTION,
+        MANAGER_PHASE_CGROUP_REALIZE,
+        _MANAGER_PHASE_MAX,
+        _MANAGER_PHASE_INVALID = -EINVAL,
+} ManagerPhase;
+
 typedef enum WatchdogType {
         WATCHDOG_RUNTIME,
         WATCHDOG_REBOOT,
@@ -136,6 +156,8 @@ typedef enum WatchdogType {
 } WatchdogType;
 
 #include "execute.h"
+#include "generator-cache.h"
+#include "install-cache.h"
 #include "job.h"
 #include "path-lookup.h"
 #include "show-status.h"
@@ -187,6 +209,23 @@ typedef struct UnitDefaults {
         struct rlimit *rlimit[_RLIMIT_MAX];
 } UnitDefaults;
 
+typedef struct ManagerLoadStatistics {
+        usec_t load_usec;      /* Time spent dispatching the load queue in total */
+        usec_t prefetch_usec;  /* … of which was spent looking up drop-ins ahead of time */
+        unsigned n_loaded;
+        unsigned n_prefetched;
+        unsigned n_batches;
+        unsigned n_threads;
+        unsigned n_files_parsed; /* Fragments and drop-ins */
+} ManagerLoadStatistics;
+
+typedef struct ManagerPhaseStatistics {
+        usec_t first_start;    /* CLOCK_MONOTONIC */
+        usec_t last_finish;    /* CLOCK_MONOTONIC */
+        usec_t total_usec;
+        uint64_t n_runs;
+} ManagerPhaseStatistics;
+
 struct Manager {
         /* Note that the set of units we know of is allowed to be
          * inconsistent. However the subset of it that is loaded may
@@ -224,8 +263,9 @@ struct Manager {
         /* Units that should be realized */
         LIST_HEAD(Unit, cgroup_realize_queue);
 
-        /* Units whose cgroup ran empty */
+        /* Units whose cgroup ran empty, the oldest entry at the tail */
         LIST_HEAD(Unit, cgroup_empty_queue);
+        Unit *cgroup_empty_queue_tail;
 
         /* Units whose memory.event fired */
         LIST_HEAD(Unit, cgroup_oom_queue);
@@ -268,6 +308,7 @@ struct Manager {
         char *notify_socket;
         int notify_fd;
         sd_event_source *notify_event_source;
+        NotifyBatch *notify_batch;
 
         int cgroups_agent_fd;
         sd_event_source *cgroups_agent_event_source;
@@ -297,6 +338,13 @@ struct Manager {
         Set *unit_path_cache;
         uint64_t unit_cache_timestamp_hash;
 
+        /* k: path -> v: the tokenized contents of unit files and drop-ins, as long as they stay unchanged,
+         * so that they needn't be read again on daemon-reload, nor for each instance of a template */
+        Hashmap *config_parse_cache;
+
+        /* The install state of unit files as clients query it, until the unit file directories change */
+        InstallCache *install_cache;
+
         /* We don't have support for atomically enabling/disabling units, and unit_file_state might become
          * outdated if such operations failed half-way. Therefore, we set this flag if changes to unit files
          * are made, and reset it after daemon-reload. If set, we report that daemon-reload is needed through
@@ -316,10 +364,23 @@ struct Manager {
         /* Data specific to the device subsystem */
         sd_device_monitor *device_monitor;
         Hashmap *devices_by_sysfs;
+        /* udev events received but not processed yet, in order of arrival, and the (1-based) index of the
+         * most recent one of each syspath in that array */
+        sd_device **device_queue;
+        size_t n_device_queue;
+        Hashmap *device_queue_by_sysfs;
+        sd_event_source *device_queue_event_source;
 
         /* Data specific to the mount subsystem */
         struct libmnt_monitor *mount_monitor;
         sd_event_source *mount_event_source;
+        /* The unique IDs of all mounts as of the last time we processed the mount table (sorted), and the
+         * mount points of those of them we learnt about via statmount(). Used to process additions and
+         * removals of mounts incrementally, without reparsing all of /proc/self/mountinfo. */
+        uint64_t *mount_ids;
+        size_t n_mount_ids;
+        Hashmap *mount_paths_by_id;
+        bool mount_statmount_supported, mount_statmount_unsupported;
 
         /* Data specific to the swap filesystem */
         FILE *proc_swaps;
@@ -358,6 +419,10 @@ struct Manager {
         CGroupMask cgroup_supported;
         char *cgroup_root;
 
+        /* Number of cgroup attribute writes done, and skipped because the attribute already had the value */
+        uint64_t n_cgroup_attribute_writes;
+        uint64_t n_cgroup_attribute_writes_skipped;
+
         /* Notifications from cgroups, when the unified hierarchy is used is done via inotify. */
         int cgroup_inotify_fd;
         sd_event_source *cgroup_inotify_event_source;
@@ -388,6 +453,20 @@ struct Manager {
         /* Flags */
         bool dispatching_load_queue;
 
+        /* Number of threads to look up drop-ins of queued units with, 0 for automatic */
+        unsigned unit_load_threads;
+        ManagerLoadStatistics load_statistics;
+
+        /* Time spent in each phase since the manager was started, kept over reloads */
+        ManagerPhaseStatistics phases[_MANAGER_PHASE_MAX];
+
+        /* How each generator fared the last time generators were run */
+        GeneratorResult *generator_results;
+        size_t n_generator_results;
+
+        /* Whether to skip daemon-reload if no unit changed on disk */
+        bool reload_skip_unchanged;
+
         /* Have we already sent out the READY=1 notification? */
         bool ready_sent;
 
@@ -496,11 +575,22 @@ struct Manager {
         /* Reference to RestrictFileSystems= BPF program */
         struct restrict_fs_bpf *restrict_fs;
 
+        /* Precompiled SystemCallFilter= programs, indexed by the filter configuration, see seccomp-cache.c */
+        Hashmap *syscall_filter_cache;
+
         /* Allow users to configure a rate limit for Reload()/Reexecute() operations */
         RateLimit reload_reexec_ratelimit;
         /* Dump*() are slow, so always rate limit them to 10 per 10 minutes */
         RateLimit dump_ratelimit;
 
+        /* If set, PropertiesChanged signals of units only carry the properties whose values changed */
+        bool dbus_signal_changed_properties_only;
+        /* If non-zero, changes of units are announced on the bus at most once per interval, i.e. all
+         * changes within one interval are coalesced into one PropertiesChanged signal per unit */
+        usec_t dbus_signal_coalesce_usec;
+        usec_t dbus_unit_queue_flushed_usec;
+        sd_event_source *dbus_signal_coalesce_event_source;
+
         sd_event_source *memory_pressure_event_source;
 
         /* For NFTSet= */
@@ -510,6 +600,12 @@ struct Manager {
          * serialization/deserialization compatibility issues during upgrades. */
         int executor_fd;
 
+        /* Executors spawned ahead of time, see executor-pool.c */
+        unsigned executor_pool_size;
+        ExecutorPoolEntry *executor_pool;
+        size_t n_executor_pool;
+        sd_event_source *executor_pool_event_source;
+
         unsigned soft_reboots_count;
 };
 
@@ -578,6 +674,7 @@ void manager_trigger_run_queue(Manager *m);
 int manager_loop(Manager *m);
 
 int manager_reload(Manager *m);
+int manager_need_reload(Manager *m);
 Manager* manager_reloading_start(Manager *m);
 void manager_reloading_stopp(Manager **m);
 
@@ -641,6 +738,12 @@ const char* manager_timestamp_to_string(ManagerTimestamp m) _const_;
 ManagerTimestamp manager_timestamp_from_string(const char *s) _pure_;
 ManagerTimestamp manager_timestamp_initrd_mangle(ManagerTimestamp s);
 
+const char* manager_phase_to_string(ManagerPhase p) _const_;
+ManagerPhase manager_phase_from_string(const char *s) _pure_;
+
+usec_t manager_phase_start(Manager *m, ManagerPhase p);
+void manager_phase_finish(Manager *m, ManagerPhase p, usec_t start);
+
 usec_t manager_get_watchdog(Manager *m, WatchdogType t);
 void manager_set_watchdog(Manager *m, WatchdogType t, usec_t timeout);
 void manager_override_watchdog(Manager *m, WatchdogType t, usec_t timeout);
@@ -674,8 +777,10 @@ enum {
         EVENT_PRIORITY_TIME_CHANGE       = SD_EVENT_PRIORITY_NORMAL-1,
         EVENT_PRIORITY_TIME_ZONE         = SD_EVENT_PRIORITY_NORMAL-1,
         EVENT_PRIORITY_IPC               = SD_EVENT_PRIORITY_NORMAL,
+        EVENT_PRIORITY_DEVICE_QUEUE      = SD_EVENT_PRIORITY_NORMAL+1,
         EVENT_PRIORITY_REWATCH_PIDS      = SD_EVENT_PRIORITY_IDLE,
         EVENT_PRIORITY_SERVICE_WATCHDOG  = SD_EVENT_PRIORITY_IDLE+1,
         EVENT_PRIORITY_RUN_QUEUE         = SD_EVENT_PRIORITY_IDLE+2,
+        EVENT_PRIORITY_EXECUTOR_POOL     = SD_EVENT_PRIORITY_IDLE+3,
         /* … to least important */
 };
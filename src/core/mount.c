@@ -13,12 +13,14 @@
 #include "device.h"
 #include "exit-status.h"
 #include "format-util.h"
+#include "hash-funcs.h"
 #include "fs-util.h"
 #include "fstab-util.h"
 #include "initrd-util.h"
 #include "libmount-util.h"
 #include "log.h"
 #include "manager.h"
+#include "missing_syscall.h"
 #include "mkdir-label.h"
 #include "mount-setup.h"
 #include "mount.h"
@@ -27,6 +29,7 @@
 #include "path-util.h"
 #include "process-util.h"
 #include "serialize.h"
+#include "sort-util.h"
 #include "special.h"
 #include "stat-util.h"
 #include "string-table.h"
@@ -1872,6 +1875,65 @@ static int mount_setup_unit(
         return 0;
 }
 
+DEFINE_PRIVATE_HASH_OPS_FULL(mount_path_by_id_hash_ops, uint64_t, uint64_hash_func, uint64_compare_func, free, char, free);
+
+static void mount_forget_ids(Manager *m) {
+        assert(m);
+
+        m->mount_ids = mfree(m->mount_ids);
+        m->n_mount_ids = 0;
+        m->mount_paths_by_id = hashmap_free(m->mount_paths_by_id);
+}
+
+static void mount_refresh_ids(Manager *m) {
+        _cleanup_free_ uint64_t *ids = NULL;
+        size_t n_ids;
+        int r;
+
+        assert(m);
+
+        /* Called right before we do a full parse of /proc/self/mountinfo, so that anything that shows up in
+         * between is considered new the next time, rather than being lost. We don't know the mount points
+         * belonging to the IDs, hence forget all we knew. */
+
+        mount_forget_ids(m);
+
+        if (m->mount_statmount_unsupported)
+                return;
+
+        r = mount_list_ids(&ids, &n_ids);
+        if (r < 0) {
+                log_debug_errno(r, "Failed to list mount IDs, will always reparse /proc/self/mountinfo: %m");
+                if (r == -EOPNOTSUPP)
+                        m->mount_statmount_unsupported = true;
+                return;
+        }
+
+        if (!m->mount_statmount_supported) {
+                /* The kernel doesn't set the flags for empty strings, hence we cannot tell from a single
+                 * mount whether the kernel knows about the source string (6.14) and everything older we
+                 * need. Let's look for any mount that has a source. */
+                FOREACH_ARRAY(id, ids, n_ids) {
+                        _cleanup_free_ struct new_statmount *sm = NULL;
+
+                        if (mount_stat(*id, STATMOUNT_SB_SOURCE, &sm) >= 0 &&
+                            FLAGS_SET(sm->mask, STATMOUNT_SB_SOURCE)) {
+                                m->mount_statmount_supported = true;
+                                break;
+                        }
+                }
+
+                if (!m->mount_statmount_supported) {
+                        log_debug("statmount() does not report mount sources, will always reparse /proc/self/mountinfo.");
+                        m->mount_statmount_unsupported = true;
+                        return;
+                }
+        }
+
+        m->mount_ids = TAKE_PTR(ids);
+        m->n_mount_ids = n_ids;
+}
+
 static int mount_load_proc_self_mountinfo(Manager *m, bool set_flags) {
         _cleanup_(mnt_free_tablep) struct libmnt_table *table = NULL;
         _cleanup_(mnt_free_iterp) struct libmnt_iter *iter = NULL;
@@ -1879,6 +1941,8 @@ static int mount_load_proc_self_mountinfo(Manager *m, bool set_flags) {
 
         assert(m);
 
+        mount_refresh_ids(m);
+
         r = libmount_parse(NULL, NULL, &table, &iter);
         if (r < 0)
                 return log_error_errno(r, "Failed to parse /proc/self/mountinfo: %m");
@@ -1909,9 +1973,205 @@ static int mount_load_proc_self_mountinfo(Manager *m, bool set_flags) {
         return 0;
 }
 
+typedef struct MountAdded {
+        uint64_t id;
+        char *what;
+        char *where;
+        char *options;
+        char *fstype;
+} MountAdded;
+
+static void mount_added_done_many(MountAdded *a, size_t n) {
+        FOREACH_ARRAY(i, a, n) {
+                free(i->what);
+                free(i->where);
+                free(i->options);
+                free(i->fstype);
+        }
+
+        free(a);
+}
+
+static int mount_added_from_id(uint64_t id, MountAdded *ret) {
+        _cleanup_free_ struct new_statmount *sm = NULL;
+        _cleanup_free_ char *what = NULL, *where = NULL, *options = NULL, *fstype = NULL;
+        const char *source, *point, *type, *subtype;
+        int r;
+
+        assert(ret);
+
+        r = mount_stat(id,
+                       STATMOUNT_SB_BASIC|STATMOUNT_MNT_BASIC|STATMOUNT_MNT_POINT|STATMOUNT_FS_TYPE|
+                       STATMOUNT_MNT_OPTS|STATMOUNT_FS_SUBTYPE|STATMOUNT_SB_SOURCE,
+                       &sm);
+        if (r < 0)
+                return r;
+
+        point = statmount_string(sm, STATMOUNT_MNT_POINT, sm->mnt_point);
+        type = statmount_string(sm, STATMOUNT_FS_TYPE, sm->fs_type);
+        source = statmount_string(sm, STATMOUNT_SB_SOURCE, sm->sb_source);
+        subtype = statmount_string(sm, STATMOUNT_FS_SUBTYPE, sm->fs_subtype);
+        if (!point || !type)
+                return -ENODATA;
+
+        r = statmount_options_to_string(sm, &options);
+        if (r < 0)
+                return r;
+
+        /* Mimic how /proc/self/mountinfo and libmount report these. Note that empty strings are not
+         * reported at all. */
+        what = strdup(isempty(source) ? "none" : source);
+        where = strdup(point);
+        fstype = isempty(subtype) ? strdup(type) : strjoin(type, ".", subtype);
+        if (!what || !where || !fstype)
+                return -ENOMEM;
+
+        *ret = (MountAdded) {
+                .id = id,
+                .what = TAKE_PTR(what),
+                .where = TAKE_PTR(where),
+                .options = TAKE_PTR(options),
+                .fstype = TAKE_PTR(fstype),
+        };
+
+        return 0;
+}
+
+static int mount_load_changes_incrementally(Manager *m) {
+        _cleanup_set_free_ Set *removed = NULL;
+        _cleanup_free_ uint64_t *ids = NULL, *added_ids = NULL;
+        MountAdded *added = NULL;
+        size_t n_ids, n_added_ids = 0, n_added = 0;
+        int r;
+
+        CLEANUP_ARRAY(added, n_added, mount_added_done_many);
+
+        assert(m);
+
+        /* Tries to process the changes to the mount table since the last time we looked at it by comparing
+         * the list of mount IDs: we only query the new mounts, and we only need to know the mount points of
+         * the removed ones. This only covers mounts being added and removed, anything else (mount
+         * attributes changing, mounts moving, mounts stacked on top of each other, …) requires the full
+         * picture. Returns > 0 if the changes have been processed, and <= 0 if the caller needs to reparse
+         * /proc/self/mountinfo fully. Before returning > 0 the proc flags of all mount units are updated the
+         * same way as mount_load_proc_self_mountinfo() would have. */
+
+        if (m->n_mount_ids == 0 || m->mount_statmount_unsupported)
+                return 0;
+
+        r = mount_list_ids(&ids, &n_ids);
+        if (r < 0) {
+                log_debug_errno(r, "Failed to list mount IDs, reparsing /proc/self/mountinfo: %m");
+                return 0;
+        }
+
+        for (size_t i = 0, j = 0; i < m->n_mount_ids || j < n_ids;) {
+                if (j >= n_ids || (i < m->n_mount_ids && m->mount_ids[i] < ids[j])) {
+                        const char *where;
+
+                        /* Only mounts we learnt about incrementally have a known mount point */
+                        where = hashmap_get(m->mount_paths_by_id, &m->mount_ids[i]);
+                        if (!where)
+                                return 0;
+
+                        r = set_put_strdup_full(&removed, &path_hash_ops_free, where);
+                        if (r < 0)
+                                return log_oom();
+                        i++;
+
+                } else if (i >= m->n_mount_ids || ids[j] < m->mount_ids[i]) {
+                        if (!GREEDY_REALLOC(added_ids, n_added_ids + 1))
+                                return log_oom();
+
+                        added_ids[n_added_ids++] = ids[j++];
+                } else {
+                        i++;
+                        j++;
+                }
+        }
+
+        /* Nothing was added or removed, hence something else changed. Also, if a large part of the
+         * table changed, we might as well parse it in one go. */
+        if (n_added_ids == 0 && set_isempty(removed))
+                return 0;
+        if (n_added_ids + set_size(removed) > MAX(n_ids / 4, 16U))
+                return 0;
+
+        /* First collect everything, so that we don't touch any unit's state until we know we can handle all
+         * the changes. */
+        FOREACH_ARRAY(id, added_ids, n_added_ids) {
+                _cleanup_free_ char *e = NULL;
+                Unit *u;
+
+                if (!GREEDY_REALLOC(added, n_added + 1))
+                        return log_oom();
+
+                r = mount_added_from_id(*id, added + n_added);
+                if (r < 0) {
+                        log_debug_errno(r, "Failed to query new mount %" PRIu64 ", reparsing /proc/self/mountinfo: %m", *id);
+                        return 0;
+                }
+                n_added++;
+
+                /* Something is added on top of (or below) an existing mount, or something is mounted and
+                 * unmounted on the same mount point at once. Let's not try to figure out what wins. */
+                if (set_contains(removed, added[n_added-1].where))
+                        return 0;
+                if (unit_name_from_path(added[n_added-1].where, ".mount", &e) >= 0 &&
+                    (u = manager_get_unit(m, e)) &&
+                    MOUNT(u)->from_proc_self_mountinfo)
+                        return 0;
+        }
+
+        log_debug("Processing %zu added and %u removed mounts incrementally.", n_added, set_size(removed));
+
+        /* Everything that was mounted before is still mounted, except for what we know has been removed */
+        LIST_FOREACH(units_by_type, u, m->units_by_type[UNIT_MOUNT]) {
+                Mount *mount = MOUNT(u);
+
+                if (mount->from_proc_self_mountinfo && !set_contains(removed, mount->where))
+                        mount->proc_flags |= MOUNT_PROC_IS_MOUNTED;
+        }
+
+        FOREACH_ARRAY(a, added, n_added) {
+                _cleanup_free_ uint64_t *key = NULL;
+                _cleanup_free_ char *where = NULL;
+
+                device_found_node(m, a->what, DEVICE_FOUND_MOUNT, DEVICE_FOUND_MOUNT);
+
+                (void) mount_setup_unit(m, a->what, a->where, a->options, a->fstype, /* set_flags= */ true);
+
+                /* Remember the mount point, so that we can handle the removal the same way */
+                key = newdup(uint64_t, &a->id, 1);
+                where = strdup(a->where);
+                if (!key || !where ||
+                    hashmap_ensure_put(&m->mount_paths_by_id, &mount_path_by_id_hash_ops, key, where) < 0)
+                        log_oom_debug(); /* Not fatal, we'll just reparse fully when it goes away */
+                else {
+                        TAKE_PTR(key);
+                        TAKE_PTR(where);
+                }
+        }
+
+        FOREACH_ARRAY(id, m->mount_ids, m->n_mount_ids)
+                if (!typesafe_bsearch(id, ids, n_ids, uint64_compare_func)) {
+                        void *key = NULL;
+
+                        free(hashmap_remove2(m->mount_paths_by_id, id, &key));
+                        free(key);
+                }
+
+        free_and_replace(m->mount_ids, ids);
+        m->n_mount_ids = n_ids;
+
+        return 1;
+}
+
 static void mount_shutdown(Manager *m) {
         assert(m);
 
+        mount_forget_ids(m);
+
         m->mount_event_source = sd_event_source_disable_unref(m->mount_event_source);
 
         mnt_unref_monitor(m->mount_monitor);
@@ -2083,11 +2343,12 @@ fail:
         mount_shutdown(m);
 }
 
-static int drain_libmount(Manager *m) {
-        bool rescan = false;
+static int drain_libmount(Manager *m, bool *ret_userspace) {
+        bool rescan = false, userspace = false;
         int r;
 
         assert(m);
+        assert(ret_userspace);
 
         /* Drain all events and verify that the event is valid.
          *
@@ -2096,28 +2357,38 @@ static int drain_libmount(Manager *m) {
          *
          * error: r < 0; valid: r == 0, false positive: r == 1 */
         do {
-                r = mnt_monitor_next_change(m->mount_monitor, NULL, NULL);
+                int type;
+
+                r = mnt_monitor_next_change(m->mount_monitor, NULL, &type);
                 if (r < 0)
                         return log_error_errno(r, "Failed to drain libmount events: %m");
-                if (r == 0)
+                if (r == 0) {
                         rescan = true;
+                        if (type == MNT_MONITOR_TYPE_USERSPACE)
+                                userspace = true;
+                }
         } while (r == 0);
 
+        *ret_userspace = userspace;
         return rescan;
 }
 
 static int mount_process_proc_self_mountinfo(Manager *m) {
         _cleanup_set_free_ Set *around = NULL, *gone = NULL;
         const char *what;
+        bool userspace;
         int r;
 
         assert(m);
 
-        r = drain_libmount(m);
+        r = drain_libmount(m, &userspace);
         if (r <= 0)
                 return r;
 
-        r = mount_load_proc_self_mountinfo(m, true);
+        /* Changes to utab carry userspace mount options, which only libmount can merge in for us */
+        r = userspace ? 0 : mount_load_changes_incrementally(m);
+        if (r <= 0)
+                r = mount_load_proc_self_mountinfo(m, true);
         if (r < 0) {
                 /* Reset flags, just in case, for later calls */
                 LIST_FOREACH(units_by_type, u, m->units_by_type[UNIT_MOUNT])
@@ -22,6 +22,8 @@
 #include "fd-util.h"
 #include "format-util.h"
 #include "glyph-util.h"
+#include "hexdecoct.h"
+#include "iovec-util.h"
 #include "label-util.h"
 #include "list.h"
 #include "lock-util.h"
@@ -38,6 +40,7 @@
 #include "os-util.h"
 #include "path-util.h"
 #include "selinux-util.h"
+#include "sha256.h"
 #include "socket-util.h"
 #include "sort-util.h"
 #include "stat-util.h"
@@ -2115,6 +2118,188 @@ static bool home_read_only(
         return false;
 }
 
+static bool namespace_parameters_use_template(const NamespaceParameters *p) {
+        assert(p);
+
+        /* Images need loop devices and locks that are specific to each invocation, and the credentials
+         * directory might have been replaced since the template was created, hence never reuse those.
+         * Joining a mount namespace requires privileges, hence only do this in the system manager. */
+
+        return p->mount_template_storage_socket &&
+                p->runtime_scope == RUNTIME_SCOPE_SYSTEM &&
+                !p->root_image &&
+                p->n_mount_images == 0 &&
+                p->n_extension_images == 0 &&
+                strv_isempty(p->extension_directories) &&
+                !p->creds_path;
+}
+
+static void sha256_process_string(const char *s, struct sha256_ctx *ctx) {
+        /* Include the trailing NUL, so that adjacent strings can't be confused, and hash NULL as a single
+         * byte that cannot be part of any string. */
+        if (s)
+                sha256_process_bytes(s, strlen(s) + 1, ctx);
+        else
+                sha256_process_bytes(&(const uint8_t) { 0xff }, 1, ctx);
+}
+
+static int mount_template_key(const MountList *ml, const NamespaceParameters *p, char **ret) {
+        uint8_t digest[SHA256_DIGEST_SIZE];
+        struct sha256_ctx ctx;
+        char *k;
+        bool b;
+        int e;
+
+        assert(ml);
+        assert(p);
+        assert(ret);
+
+        /* Hashes everything that goes into building the namespace: the normalized list of mounts, and the
+         * parameters apply_mounts() and its helpers look at. */
+
+        sha256_init_ctx(&ctx);
+
+        FOREACH_ARRAY(m, ml->mounts, ml->n_mounts) {
+                unsigned bits =
+                        m->ignore |
+                        m->has_prefix << 1 |
+                        m->read_only << 2 |
+                        m->nosuid << 3 |
+                        m->noexec << 4 |
+                        m->exec << 5 |
+                        m->create_source_dir << 6;
+
+                sha256_process_bytes(&m->mode, sizeof(m->mode), &ctx);
+                sha256_process_bytes(&bits, sizeof(bits), &ctx);
+                sha256_process_bytes(&m->source_dir_mode, sizeof(m->source_dir_mode), &ctx);
+                sha256_process_bytes(&m->flags, sizeof(m->flags), &ctx);
+                sha256_process_string(mount_entry_path(m), &ctx);
+                sha256_process_string(mount_entry_unprefixed_path(m), &ctx);
+                sha256_process_string(mount_entry_source(m), &ctx);
+                sha256_process_string(mount_entry_options(m), &ctx);
+        }
+
+        sha256_process_bytes(&p->runtime_scope, sizeof(p->runtime_scope), &ctx);
+        sha256_process_bytes(&p->mount_propagation_flag, sizeof(p->mount_propagation_flag), &ctx);
+        sha256_process_string(p->root_directory, &ctx);
+        STRV_FOREACH(s, p->symlinks)
+                sha256_process_string(*s, &ctx);
+        sha256_process_string(NULL, &ctx);
+        sha256_process_string(p->propagate_dir, &ctx);
+        sha256_process_string(p->incoming_dir, &ctx);
+        sha256_process_string(p->private_namespace_dir, &ctx);
+        sha256_process_string(p->notify_socket, &ctx);
+        sha256_process_string(p->log_namespace, &ctx);
+
+        FOREACH_ARGUMENT(b,
+                         p->ignore_protect_paths,
+                         p->protect_control_groups,
+                         p->protect_kernel_tunables,
+                         p->protect_kernel_modules,
+                         p->protect_kernel_logs,
+                         p->protect_hostname,
+                         p->private_dev,
+                         p->private_network,
+                         p->private_ipc,
+                         p->mount_apivfs,
+                         p->mount_nosuid)
+                sha256_process_bytes(&b, sizeof(b), &ctx);
+
+        FOREACH_ARGUMENT(e,
+                         (int) p->protect_home,
+                         (int) p->protect_system,
+                         (int) p->protect_proc,
+                         (int) p->proc_subset,
+                         (int) p->private_tmp)
+                sha256_process_bytes(&e, sizeof(e), &ctx);
+
+        sha256_finish_ctx(&ctx, digest);
+
+        k = hexmem(digest, sizeof(digest));
+        if (!k)
+                return -ENOMEM;
+
+        *ret = k;
+        return 0;
+}
+
+static int mount_template_join(const int storage_socket[static 2], const char *key) {
+        char buf[SHA256_DIGEST_SIZE * 2 + 1] = {};
+        _cleanup_close_ int fd = -EBADF;
+        ssize_t n;
+
+        assert(storage_socket);
+        assert(key);
+
+        /* Joins the template namespace stored in the socket, if there's one for the same configuration.
+         * Returns > 0 if so, 0 if the template needs to be (re)built. */
+
+        n = receive_one_fd_iov(storage_socket[0], &IOVEC_MAKE(buf, sizeof(buf) - 1), 1, MSG_PEEK|MSG_DONTWAIT, &fd);
+        if (n == -EAGAIN)
+                return 0;
+        if (n < 0)
+                return n;
+        if (fd < 0 || !streq(buf, key))
+                return 0;
+
+        if (setns(fd, CLONE_NEWNS) < 0)
+                return -errno;
+
+        return 1;
+}
+
+static int mount_template_store(const int storage_socket[static 2], const char *key) {
+        _cleanup_close_ int fd = -EBADF;
+        ssize_t n;
+
+        assert(storage_socket);
+        assert(key);
+
+        /* First, drop a template for a different configuration, if there's one */
+        for (;;) {
+                _cleanup_close_ int old = -EBADF;
+
+                n = receive_one_fd_iov(storage_socket[0], NULL, 0, MSG_DONTWAIT, &old);
+                if (n == -EAGAIN)
+                        break;
+                if (n < 0)
+                        return n;
+        }
+
+        fd = namespace_open_by_type(NAMESPACE_MOUNT);
+        if (fd < 0)
+                return fd;
+
+        n = send_one_fd_iov(storage_socket[1], fd, &IOVEC_MAKE_STRING(key), 1, MSG_DONTWAIT);
+        if (n < 0)
+                return n;
+
+        return 0;
+}
+
+static int mount_template_detach(const NamespaceParameters *p, unsigned long mount_propagation_flag, bool setup_propagate) {
+        assert(p);
+
+        /* Leaves the template namespace (or the one we just built, and which is now stored as template), by
+         * creating a private copy of it. Then disconnect the copy from the peer groups of the template, so
+         * that nothing mounted later on shows up in the template or its other copies, while mounts that
+         * propagate into the template from the host are still received. */
+
+        if (unshare(CLONE_NEWNS) < 0)
+                return log_debug_errno(errno, "Failed to unshare the mount namespace: %m");
+
+        if (mount(NULL, "/", NULL, MS_SLAVE|MS_REC, NULL) < 0)
+                return log_debug_errno(errno, "Failed to remount '/' as SLAVE: %m");
+
+        if (mount(NULL, "/", NULL, mount_propagation_flag | MS_REC, NULL) < 0)
+                return log_debug_errno(errno, "Failed to remount '/' with desired mount flags: %m");
+
+        if (setup_propagate && mount(NULL, p->incoming_dir, NULL, MS_SLAVE, NULL) < 0)
+                return log_debug_errno(errno, "Failed to remount %s with MS_SLAVE: %m", p->incoming_dir);
+
+        return 0;
+}
+
 int setup_namespace(const NamespaceParameters *p, char **error_path) {
 
         _cleanup_(loop_device_unrefp) LoopDevice *loop_device = NULL;
@@ -2122,7 +2307,10 @@ int setup_namespace(const NamespaceParameters *p, char **error_path) {
         _cleanup_strv_free_ char **hierarchies = NULL;
         _cleanup_(mount_list_done) MountList ml = {};
         _cleanup_close_ int userns_fd = -EBADF;
-        bool require_prefix = false;
+        _cleanup_(posix_unlockpp) int *template_lock = NULL;
+        _cleanup_free_ char *template_key = NULL;
+        bool require_prefix = false, use_template;
+        int template_lock_fd = -EBADF;
         const char *root;
         DissectImageFlags dissect_image_flags =
                 DISSECT_IMAGE_GENERIC_ROOT |
@@ -2584,6 +2772,33 @@ int setup_namespace(const NamespaceParameters *p, char **error_path) {
 
         drop_unused_mounts(&ml, root);
 
+        /* If we have a template for exactly this configuration, clone it instead of building the namespace
+         * from scratch. Keep the storage locked until we are done, so that concurrent invocations don't
+         * build the same template twice. */
+        use_template = namespace_parameters_use_template(p);
+        if (use_template) {
+                r = mount_template_key(&ml, p, &template_key);
+                if (r < 0)
+                        return r;
+
+                template_lock_fd = p->mount_template_storage_socket[0];
+                r = posix_lock(template_lock_fd, LOCK_EX);
+                if (r < 0)
+                        return log_debug_errno(r, "Failed to lock mount namespace template storage: %m");
+                template_lock = &template_lock_fd;
+
+                r = mount_template_join(p->mount_template_storage_socket, template_key);
+                if (r < 0)
+                        log_debug_errno(r, "Failed to join mount namespace template, setting up namespace from scratch: %m");
+                if (r > 0) {
+                        log_debug("Cloning mount namespace template %s.", template_key);
+                        return mount_template_detach(p, mount_propagation_flag, setup_propagate);
+                }
+                /* If we couldn't join the template for some other reason, don't replace it */
+                if (r < 0)
+                        use_template = false;
+        }
+
         /* All above is just preparation, figuring out what to do. Let's now actually start doing something. */
 
         if (unshare(CLONE_NEWNS) < 0) {
@@ -2694,6 +2909,20 @@ int setup_namespace(const NamespaceParameters *p, char **error_path) {
         if (setup_propagate && mount(NULL, p->incoming_dir, NULL, MS_SLAVE, NULL) < 0)
                 return log_debug_errno(errno, "Failed to remount %s with MS_SLAVE: %m", p->incoming_dir);
 
+        if (use_template) {
+                /* Keep the pristine namespace around as template, and continue in a copy of it */
+                r = mount_template_store(p->mount_template_storage_socket, template_key);
+                if (r < 0)
+                        log_debug_errno(r, "Failed to store mount namespace template, ignoring: %m");
+                else {
+                        log_debug("Stored mount namespace template %s.", template_key);
+
+                        r = mount_template_detach(p, mount_propagation_flag, setup_propagate);
+                        if (r < 0)
+                                return r;
+                }
+        }
+
         return 0;
 }
 
@@ -139,6 +139,10 @@ struct NamespaceParameters {
         const char *notify_socket;
         const char *host_os_release_stage;
 
+        /* If set, an AF_UNIX socket pair storing a template of the mount namespace, see
+         * ReuseMountNamespace= */
+        const int *mount_template_storage_socket;
+
         bool ignore_protect_paths;
 
         bool protect_control_groups;
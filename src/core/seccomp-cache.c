@@ -0,0 +1,143 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include "alloc-util.h"
+#include "execute.h"
+#include "fd-util.h"
+#include "hashmap.h"
+#include "manager.h"
+#include "seccomp-cache.h"
+#include "seccomp-util.h"
+#include "sort-util.h"
+#include "string-util.h"
+
+/* Compiling SystemCallFilter= to BPF is by far the most expensive part of applying the syscall sandbox, and
+ * happens for every single process we spawn, once for each architecture. Hence, compile the filters in
+ * PID 1 instead, keep the result around in memfds indexed by the filter configuration, and let the
+ * executor install the precompiled programs directly. */
+
+/* Different filter configurations are rare, but let's not grow without bounds */
+#define SYSCALL_FILTER_CACHE_MAX 64U
+
+#if HAVE_SECCOMP
+DEFINE_PRIVATE_HASH_OPS_FULL(syscall_filter_hash_ops, char, string_hash_func, string_compare_func, free, void, close_fd_ptr);
+
+typedef struct SyscallFilterItem {
+        int id;
+        int error;
+} SyscallFilterItem;
+
+static int syscall_filter_item_compare(const SyscallFilterItem *a, const SyscallFilterItem *b) {
+        return CMP(a->id, b->id);
+}
+
+static int syscall_filter_cache_key(const ExecContext *c, Hashmap *filter, char **ret) {
+        _cleanup_free_ SyscallFilterItem *items = NULL;
+        _cleanup_free_ char *s = NULL;
+        size_t n = 0;
+        void *id, *val;
+        int r;
+
+        assert(c);
+        assert(ret);
+
+        items = new(SyscallFilterItem, hashmap_size(filter));
+        if (!items)
+                return -ENOMEM;
+
+        HASHMAP_FOREACH_KEY(val, id, filter)
+                items[n++] = (SyscallFilterItem) {
+                        .id = PTR_TO_INT(id) - 1,
+                        .error = PTR_TO_INT(val),
+                };
+
+        typesafe_qsort(items, n, syscall_filter_item_compare);
+
+        r = strextendf(&s, "%s:%i:", c->syscall_allow_list ? "allow" : "deny", c->syscall_errno);
+        if (r < 0)
+                return r;
+
+        FOREACH_ARRAY(i, items, n) {
+                r = strextendf(&s, "%i=%i,", i->id, i->error);
+                if (r < 0)
+                        return r;
+        }
+
+        *ret = TAKE_PTR(s);
+        return 0;
+}
+#endif
+
+int manager_acquire_syscall_filter(Manager *m, const ExecContext *c, int *ret_fd) {
+#if HAVE_SECCOMP
+        _cleanup_hashmap_free_ Hashmap *filter = NULL;
+        uint32_t negative_action, default_action, action;
+        _cleanup_free_ char *key = NULL;
+        _cleanup_close_ int fd = -EBADF;
+        int cached, r;
+
+        assert(m);
+        assert(c);
+        assert(ret_fd);
+
+        /* Returns the precompiled SystemCallFilter= programs for the specified context, as the executor
+         * would build them, i.e. with write() added for sending over the handoff timestamp. The returned fd
+         * is owned by the manager. Returns 0 and -EBADF if there's nothing to precompile. */
+
+        if ((!c->syscall_allow_list && hashmap_isempty(c->syscall_filter)) || !is_seccomp_available()) {
+                *ret_fd = -EBADF;
+                return 0;
+        }
+
+        filter = c->syscall_filter ? hashmap_copy(c->syscall_filter) : hashmap_new(NULL);
+        if (!filter)
+                return -ENOMEM;
+
+        r = seccomp_filter_set_add_by_name(filter, c->syscall_allow_list, "write");
+        if (r < 0)
+                return r;
+
+        r = syscall_filter_cache_key(c, filter, &key);
+        if (r < 0)
+                return r;
+
+        cached = PTR_TO_FD(hashmap_get(m->syscall_filter_cache, key));
+        if (cached >= 0) {
+                *ret_fd = cached;
+                return 0;
+        }
+
+        negative_action = c->syscall_errno == SECCOMP_ERROR_NUMBER_KILL ? scmp_act_kill_process() : SCMP_ACT_ERRNO(c->syscall_errno);
+
+        if (c->syscall_allow_list) {
+                default_action = negative_action;
+                action = SCMP_ACT_ALLOW;
+        } else {
+                default_action = SCMP_ACT_ALLOW;
+                action = negative_action;
+        }
+
+        r = seccomp_compile_syscall_filter_set_raw(default_action, filter, action, false, &fd);
+        if (r < 0)
+                return r;
+        if (fd < 0) {
+                *ret_fd = -EBADF;
+                return 0;
+        }
+
+        if (hashmap_size(m->syscall_filter_cache) >= SYSCALL_FILTER_CACHE_MAX)
+                hashmap_clear(m->syscall_filter_cache);
+
+        r = hashmap_ensure_put(&m->syscall_filter_cache, &syscall_filter_hash_ops, key, FD_TO_PTR(fd));
+        if (r < 0)
+                return r;
+
+        TAKE_PTR(key);
+        *ret_fd = TAKE_FD(fd);
+        return 0;
+#else
+        assert(ret_fd);
+
+        *ret_fd = -EBADF;
+        return 0;
+#endif
+}
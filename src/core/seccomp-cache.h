@@ -0,0 +1,7 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+#pragma once
+
+typedef struct ExecContext ExecContext;
+typedef struct Manager Manager;
+
+int manager_acquire_syscall_filter(Manager *m, const ExecContext *c, int *ret_fd);
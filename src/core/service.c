@@ -251,6 +251,7 @@ void service_release_socket_fd(Service *s) {
         /* Undo the effect of service_set_socket_fd(). */
 
         s->socket_fd = asynchronous_close(s->socket_fd);
+        s->socket_fd_accepted_usec = 0;
 
         if (UNIT_ISSET(s->accept_socket)) {
                 socket_connection_unref(SOCKET(UNIT_DEREF(s->accept_socket)));
@@ -1856,6 +1857,11 @@ static int service_spawn_internal(
         s->exec_fd_event_source = TAKE_PTR(exec_fd_source);
         s->exec_fd_hot = false;
 
+        if (s->socket_fd_accepted_usec > 0 && UNIT_ISSET(s->accept_socket)) {
+                socket_connection_spawned(SOCKET(UNIT_DEREF(s->accept_socket)), s->socket_fd_accepted_usec);
+                s->socket_fd_accepted_usec = 0;
+        }
+
         r = unit_watch_pidref(UNIT(s), &pidref, /* exclusive= */ true);
         if (r < 0)
                 return r;
@@ -4486,9 +4492,10 @@ static void service_notify_message(
                 notify_dbus = true;
         }
 
-        /* Interpret STATUS= */
+        /* Interpret STATUS=. Services tend to send the same status over and over again, e.g. along with
+         * WATCHDOG=1, hence check for that first, before validating and copying it. */
         e = strv_find_startswith(tags, "STATUS=");
-        if (e) {
+        if (e && !streq_ptr(s->status_text, empty_to_null(e))) {
                 _cleanup_free_ char *t = NULL;
 
                 if (!isempty(e)) {
@@ -4823,6 +4830,7 @@ int service_set_socket_fd(
 
         s->socket_fd = fd;
         s->socket_peer = peer;
+        s->socket_fd_accepted_usec = now(CLOCK_MONOTONIC);
         s->socket_fd_selinux_context_net = selinux_context_net;
 
         unit_ref_set(&s->accept_socket, UNIT(s), UNIT(sock));
@@ -176,6 +176,7 @@ struct Service {
         int socket_fd;
         SocketPeer *socket_peer;
         UnitRef accept_socket;
+        usec_t socket_fd_accepted_usec; /* CLOCK_MONOTONIC, reset once the first process is spawned */
         bool socket_fd_selinux_context_net;
 
         bool permissions_start_only;
@@ -8,6 +8,7 @@
 #include <sys/epoll.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <linux/filter.h>
 #include <linux/sctp.h>
 
 #include "alloc-util.h"
@@ -56,6 +57,9 @@ struct SocketPeer {
         struct ucred peer_cred;
 };
 
+/* How many connections to accept() at most per wakeup of a listening socket with Accept=yes */
+#define SOCKET_ACCEPT_BATCH_MAX 16U
+
 static const UnitActiveState state_translation_table[_SOCKET_STATE_MAX] = {
         [SOCKET_DEAD]             = UNIT_INACTIVE,
         [SOCKET_START_PRE]        = UNIT_ACTIVATING,
@@ -281,6 +285,63 @@ static bool socket_has_exec(Socket *s) {
         return false;
 }
 
+static unsigned socket_n_reuse_port_shards(Socket *s) {
+        long n;
+
+        assert(s);
+
+        if (s->reuse_port_shards != SOCKET_REUSE_PORT_SHARDS_CPUS)
+                return MAX(s->reuse_port_shards, 1U);
+
+        /* The CPU steering program returns the number of the CPU, hence count all of them, not just the ones
+         * we may run on. */
+        n = sysconf(_SC_NPROCESSORS_CONF);
+        if (n <= 0)
+                return 1;
+
+        return MIN((unsigned long) n, SOCKET_REUSE_PORT_SHARDS_MAX);
+}
+
+static int socket_add_reuse_port_shards(Socket *s) {
+        unsigned n;
+
+        assert(s);
+
+        n = socket_n_reuse_port_shards(s);
+        if (n <= 1)
+                return 0;
+
+        LIST_FOREACH(port, p, s->ports) {
+                if (p->type != SOCKET_SOCKET || p->shard > 0)
+                        continue;
+
+                if (!IN_SET(socket_address_family(&p->address), AF_INET, AF_INET6))
+                        continue;
+
+                /* Insert the shards right after the port they belong to, in order, so that they are opened
+                 * and passed to the service in this order, too */
+                for (unsigned i = n - 1; i > 0; i--) {
+                        SocketPort *q;
+
+                        q = new(SocketPort, 1);
+                        if (!q)
+                                return -ENOMEM;
+
+                        *q = (SocketPort) {
+                                .socket = s,
+                                .type = SOCKET_SOCKET,
+                                .fd = -EBADF,
+                                .shard = i,
+                                .address = p->address,
+                        };
+
+                        LIST_INSERT_AFTER(port, s->ports, p, q);
+                }
+        }
+
+        return 0;
+}
+
 static int socket_add_extras(Socket *s) {
         Unit *u = UNIT(ASSERT_PTR(s));
         int r;
@@ -324,6 +385,10 @@ static int socket_add_extras(Socket *s) {
                         return r;
         }
 
+        r = socket_add_reuse_port_shards(s);
+        if (r < 0)
+                return r;
+
         r = socket_add_mount_dependencies(s);
         if (r < 0)
                 return r;
@@ -648,6 +713,15 @@ static void socket_dump(Unit *u, FILE *f, const char *prefix) {
                         "%sFlushPending: %s\n",
                          prefix, yes_no(s->flush_pending));
 
+        if (s->accept && s->n_accept_latency > 0)
+                fprintf(f,
+                        "%sAcceptLatencyLast: %s\n"
+                        "%sAcceptLatencyAverage: %s\n"
+                        "%sAcceptLatencyMax: %s\n",
+                        prefix, FORMAT_TIMESPAN(s->accept_latency_last_usec, 1),
+                        prefix, FORMAT_TIMESPAN(s->accept_latency_total_usec / s->n_accept_latency, 1),
+                        prefix, FORMAT_TIMESPAN(s->accept_latency_max_usec, 1));
+
 
         if (s->priority >= 0)
                 fprintf(f,
@@ -699,6 +773,11 @@ static void socket_dump(Unit *u, FILE *f, const char *prefix) {
                         "%sReusePort: %s\n",
                          prefix, yes_no(s->reuse_port));
 
+        if (s->reuse_port_shards > 0)
+                fprintf(f,
+                        "%sReusePortShards: %u\n",
+                        prefix, socket_n_reuse_port_shards(s));
+
         if (s->smack)
                 fprintf(f,
                         "%sSmackLabel: %s\n",
@@ -746,6 +825,9 @@ static void socket_dump(Unit *u, FILE *f, const char *prefix) {
                 switch (p->type) {
                 case SOCKET_SOCKET: {
                         _cleanup_free_ char *k = NULL;
+
+                        if (p->shard > 0)
+                                continue;
                         int r;
 
                         r = socket_address_print(&p->address, &k);
@@ -969,6 +1051,24 @@ static void socket_close_fds(Socket *s) {
         /* Note that we don't return NULL here, since s has not been freed. */
 }
 
+static int socket_attach_cpu_steering(int fd) {
+        /* Return the number of the CPU the packet was received on, which the kernel takes as the index of
+         * the socket in the SO_REUSEPORT group to hand it to. If there's no socket with that index, the
+         * kernel falls back to picking one by hash. */
+        struct sock_filter code[] = {
+                BPF_STMT(BPF_LD|BPF_W|BPF_ABS, (uint32_t) (SKF_AD_OFF + SKF_AD_CPU)),
+                BPF_STMT(BPF_RET|BPF_A, 0),
+        };
+        struct sock_fprog prog = {
+                .len = ELEMENTSOF(code),
+                .filter = code,
+        };
+
+        assert(fd >= 0);
+
+        return RET_NERRNO(setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)));
+}
+
 static void socket_apply_socket_options(Socket *s, SocketPort *p, int fd) {
         int r;
 
@@ -1455,7 +1555,7 @@ static int socket_address_listen_do(
                         s->backlog,
                         s->bind_ipv6_only,
                         s->bind_to_device,
-                        s->reuse_port,
+                        s->reuse_port || s->reuse_port_shards > 1,
                         s->free_bind,
                         s->transparent,
                         s->directory_mode,
@@ -1663,6 +1763,16 @@ static int socket_open_fds(Socket *orig_s) {
                                 return p->fd;
 
                         socket_apply_socket_options(s, p, p->fd);
+
+                        /* The sockets join the SO_REUSEPORT group in the order they are opened, hence the
+                         * first one of the group is the one to attach the program to */
+                        if (s->reuse_port_shards == SOCKET_REUSE_PORT_SHARDS_CPUS && p->shard == 0 &&
+                            IN_SET(socket_address_family(&p->address), AF_INET, AF_INET6)) {
+                                r = socket_attach_cpu_steering(p->fd);
+                                if (r < 0)
+                                        log_unit_warning_errno(UNIT(s), r, "Failed to attach CPU steering program to socket, ignoring: %m");
+                        }
+
                         socket_symlink(s);
                         break;
 
@@ -3080,13 +3190,27 @@ static int socket_dispatch_io(sd_event_source *source, int fd, uint32_t revents,
             p->type == SOCKET_SOCKET &&
             socket_address_can_accept(&p->address)) {
 
-                cfd = socket_accept_in_cgroup(p->socket, p, fd);
-                if (cfd == -EAGAIN) /* Spurious accept() */
-                        return 0;
-                if (cfd < 0)
-                        goto fail;
+                /* Take a bunch of connections off the queue in one go, so that a burst of incoming
+                 * connections doesn't cost a full event loop iteration each. We stop early once the socket
+                 * left the listening state or is at its connection limit, in which case the remaining
+                 * connections stay queued in the kernel. */
+                for (unsigned i = 0; i < SOCKET_ACCEPT_BATCH_MAX; i++) {
+                        if (i > 0 &&
+                            (p->socket->state != SOCKET_LISTENING ||
+                             p->socket->n_connections >= p->socket->max_connections))
+                                break;
+
+                        cfd = socket_accept_in_cgroup(p->socket, p, fd);
+                        if (cfd == -EAGAIN) /* Spurious accept(), or queue drained */
+                                return 0;
+                        if (cfd < 0)
+                                goto fail;
 
-                socket_apply_socket_options(p->socket, p, cfd);
+                        socket_apply_socket_options(p->socket, p, cfd);
+                        socket_enter_running(p->socket, TAKE_FD(cfd));
+                }
+
+                return 0;
         }
 
         socket_enter_running(p->socket, cfd);
@@ -3339,6 +3463,25 @@ void socket_connection_unref(Socket *s) {
         log_unit_debug(UNIT(s), "One connection closed, %u left.", s->n_connections);
 }
 
+void socket_connection_spawned(Socket *s, usec_t accepted_usec) {
+        usec_t latency;
+
+        assert(s);
+        assert(accepted_usec > 0);
+
+        /* Called once per connection, when the first process of the per-connection service instance
+         * has been forked off. Keeps track of how long it took us from accept() to get there. */
+
+        latency = usec_sub_unsigned(now(CLOCK_MONOTONIC), accepted_usec);
+
+        s->accept_latency_last_usec = latency;
+        s->accept_latency_max_usec = MAX(s->accept_latency_max_usec, latency);
+        s->accept_latency_total_usec = usec_add(s->accept_latency_total_usec, latency);
+        s->n_accept_latency++;
+
+        unit_add_to_dbus_queue(UNIT(s));
+}
+
 static void socket_trigger_notify(Unit *u, Unit *other) {
         Socket *s = ASSERT_PTR(SOCKET(u));
 
@@ -3543,6 +3686,40 @@ SocketTimestamping socket_timestamping_from_string_harder(const char *p) {
         return r ? SOCKET_TIMESTAMPING_NS : SOCKET_TIMESTAMPING_OFF; /* If boolean yes, default to ns accuracy */
 }
 
+int socket_reuse_port_shards_to_string_alloc(unsigned n, char **ret) {
+        assert(ret);
+
+        if (n == SOCKET_REUSE_PORT_SHARDS_CPUS)
+                return strdup_to(ret, "cpus");
+
+        if (n > SOCKET_REUSE_PORT_SHARDS_MAX)
+                return -EINVAL;
+
+        return asprintf(ret, "%u", n) < 0 ? -ENOMEM : 0;
+}
+
+int socket_reuse_port_shards_from_string(const char *s, unsigned *ret) {
+        unsigned n;
+        int r;
+
+        assert(s);
+        assert(ret);
+
+        if (streq(s, "cpus")) {
+                *ret = SOCKET_REUSE_PORT_SHARDS_CPUS;
+                return 0;
+        }
+
+        r = safe_atou(s, &n);
+        if (r < 0)
+                return r;
+        if (n > SOCKET_REUSE_PORT_SHARDS_MAX)
+                return -ERANGE;
+
+        *ret = n;
+        return 0;
+}
+
 const UnitVTable socket_vtable = {
         .object_size = sizeof(Socket),
         .exec_context_offset = offsetof(Socket, exec_context),
@@ -43,6 +43,11 @@ typedef enum SocketResult {
         _SOCKET_RESULT_INVALID = -EINVAL,
 } SocketResult;
 
+/* ReusePortShards=cpus, i.e. one socket per CPU, with incoming traffic steered to the socket of the CPU
+ * it is received on */
+#define SOCKET_REUSE_PORT_SHARDS_CPUS UINT_MAX
+#define SOCKET_REUSE_PORT_SHARDS_MAX 1024U
+
 typedef struct SocketPort {
         Socket *socket;
 
@@ -51,6 +56,10 @@ typedef struct SocketPort {
         int *auxiliary_fds;
         size_t n_auxiliary_fds;
 
+        /* If > 0, this is one of the additional SO_REUSEPORT sockets created for ReusePortShards=, bound to
+         * the same address as the preceding port with shard == 0 */
+        unsigned shard;
+
         SocketAddress address;
         char *path;
         sd_event_source *event_source;
@@ -76,6 +85,13 @@ struct Socket {
         unsigned n_accepted;
         unsigned n_connections;
         unsigned n_refused;
+
+        /* Time from accept() until the first process of the connection's service instance was spawned */
+        usec_t accept_latency_last_usec;
+        usec_t accept_latency_max_usec;
+        usec_t accept_latency_total_usec;
+        unsigned n_accept_latency;
+
         unsigned max_connections;
         unsigned max_connections_per_source;
 
@@ -147,6 +163,7 @@ struct Socket {
         char *bind_to_device;
         char *tcp_congestion;
         bool reuse_port;
+        unsigned reuse_port_shards;
         long mq_maxmsg;
         long mq_msgsize;
 
@@ -177,6 +194,9 @@ int socket_collect_fds(Socket *s, int **ret);
 /* Called from the service code when a per-connection service ended */
 void socket_connection_unref(Socket *s);
 
+/* Called from the service code when the first process of a per-connection service has been spawned */
+void socket_connection_spawned(Socket *s, usec_t accepted_usec);
+
 SocketPort *socket_port_free(SocketPort *p);
 DEFINE_TRIVIAL_CLEANUP_FUNC(SocketPort*, socket_port_free);
 
@@ -203,4 +223,7 @@ const char* socket_timestamping_to_string(SocketTimestamping p) _const_;
 SocketTimestamping socket_timestamping_from_string(const char *p) _pure_;
 SocketTimestamping socket_timestamping_from_string_harder(const char *p) _pure_;
 
+int socket_reuse_port_shards_to_string_alloc(unsigned n, char **ret);
+int socket_reuse_port_shards_from_string(const char *s, unsigned *ret);
+
 DEFINE_CAST(SOCKET, Socket);
@@ -366,6 +366,44 @@ static void add_random(Timer *t, usec_t *v) {
         log_unit_debug(UNIT(t), "Adding %s random time.", FORMAT_TIMESPAN(add, 0));
 }
 
+static int timer_value_calendar_next(TimerValue *v, usec_t base, usec_t *ret) {
+        int r;
+
+        assert(v);
+        assert(v->calendar_spec);
+        assert(ret);
+
+        if (base > 0 && v->calendar_cache_base == base) {
+                *ret = v->calendar_cache_next;
+                return 0;
+        }
+
+        r = calendar_spec_next_usec(v->calendar_spec, base, ret);
+        if (r < 0)
+                return r;
+
+        v->calendar_cache_base = base;
+        v->calendar_cache_next = *ret;
+        return 0;
+}
+
+static void timer_flush_calendar_cache(Timer *t) {
+        assert(t);
+
+        LIST_FOREACH(value, v, t->values)
+                v->calendar_cache_base = 0;
+}
+
+static bool timer_has_calendar_values(Timer *t) {
+        assert(t);
+
+        LIST_FOREACH(value, v, t->values)
+                if (!v->disabled && v->base == TIMER_CALENDAR)
+                        return true;
+
+        return false;
+}
+
 static void timer_enter_waiting(Timer *t, bool time_change) {
         bool found_monotonic = false, found_realtime = false;
         bool leave_around = false;
@@ -403,7 +441,7 @@ static void timer_enter_waiting(Timer *t, bool time_change) {
                         else
                                 b = ts.realtime;
 
-                        r = calendar_spec_next_usec(v->calendar_spec, b, &v->next_elapse);
+                        r = timer_value_calendar_next(v, b, &v->next_elapse);
                         if (r < 0)
                                 continue;
 
@@ -828,7 +866,14 @@ static void timer_time_change(Unit *u) {
         if (t->on_clock_change) {
                 log_unit_debug(u, "Time change, triggering activation.");
                 timer_enter_running(t);
+        } else if (!timer_has_calendar_values(t)) {
+                /* Purely monotonic timers are not affected by the realtime clock jumping, there's nothing
+                 * to recalculate. With many timer units this saves a lot of work on every clock change. */
+                log_unit_debug(u, "Time change, no calendar timers, not recalculating next elapse.");
         } else {
+                /* Note that cached calendar results stay valid, as they only depend on the base time,
+                 * not on the current time. Only timers whose last trigger was rewound above are
+                 * actually recalculated. */
                 log_unit_debug(u, "Time change, recalculating next elapse.");
                 timer_enter_waiting(t, true);
         }
@@ -837,6 +882,9 @@ static void timer_time_change(Unit *u) {
 static void timer_timezone_change(Unit *u) {
         Timer *t = ASSERT_PTR(TIMER(u));
 
+        /* Calendar specifications in local time map to different points in time now */
+        timer_flush_calendar_cache(t);
+
         if (t->state != TIMER_WAITING)
                 return;
 
@@ -26,6 +26,11 @@ typedef struct TimerValue {
         CalendarSpec *calendar_spec; /* only for calendar events */
         usec_t next_elapse;
 
+        /* Cache of the last calendar_spec_next_usec() result, only for calendar events. The result only
+         * depends on the base time and the timezone, hence is reused as long as both stay the same. */
+        usec_t calendar_cache_base; /* 0 if nothing is cached */
+        usec_t calendar_cache_next;
+
         LIST_FIELDS(struct TimerValue, value);
 } TimerValue;
 
@@ -347,100 +347,20 @@ static char* merge_unit_ids(const char* unit_log_field, char * const* pairs) {
         return TAKE_PTR(ans);
 }
 
-static int transaction_verify_order_one(Transaction *tr, Job *j, Job *from, unsigned generation, sd_bus_error *e) {
+static int job_order_successors(Transaction *tr, Job *j, Job ***ret, size_t *ret_n) {
 
         static const UnitDependencyAtom directions[] = {
                 UNIT_ATOM_BEFORE,
                 UNIT_ATOM_AFTER,
         };
 
-        int r;
+        _cleanup_free_ Job **l = NULL;
+        size_t n = 0;
 
         assert(tr);
         assert(j);
-        assert(!j->transaction_prev);
-
-        /* Does a recursive sweep through the ordering graph, looking for a cycle. If we find a cycle we try
-         * to break it. */
-
-        /* Have we seen this before? */
-        if (j->generation == generation) {
-                Job *k, *delete = NULL;
-                _cleanup_free_ char **array = NULL, *unit_ids = NULL;
-
-                /* If the marker is NULL we have been here already and decided the job was loop-free from
-                 * here. Hence shortcut things and return right-away. */
-                if (!j->marker)
-                        return 0;
-
-                /* So, the marker is not NULL and we already have been here. We have a cycle. Let's try to
-                 * break it. We go backwards in our path and try to find a suitable job to remove. We use the
-                 * marker to find our way back, since smart how we are we stored our way back in there. */
-                for (k = from; k; k = ((k->generation == generation && k->marker != k) ? k->marker : NULL)) {
-
-                        /* For logging below */
-                        if (strv_push_pair(&array, k->unit->id, (char*) job_type_to_string(k->type)) < 0)
-                                log_oom();
-
-                        if (!delete && hashmap_contains(tr->jobs, k->unit) && !job_matters_to_anchor(k))
-                                /* Ok, we can drop this one, so let's do so. */
-                                delete = k;
-
-                        /* Check if this in fact was the beginning of the cycle */
-                        if (k == j)
-                                break;
-                }
-
-                unit_ids = merge_unit_ids(j->manager->unit_log_field, array); /* ignore error */
-
-                STRV_FOREACH_PAIR(unit_id, job_type, array)
-                        /* logging for j not k here to provide a consistent narrative */
-                        log_struct(LOG_WARNING,
-                                   LOG_UNIT_MESSAGE(j->unit,
-                                                    "Found %s on %s/%s",
-                                                    unit_id == array ? "ordering cycle" : "dependency",
-                                                    *unit_id, *job_type),
-                                   "%s", strna(unit_ids));
-
-                if (delete) {
-                        const char *status;
-                        /* logging for j not k here to provide a consistent narrative */
-                        log_struct(LOG_ERR,
-                                   LOG_UNIT_MESSAGE(j->unit,
-                                                    "Job %s/%s deleted to break ordering cycle starting with %s/%s",
-                                                    delete->unit->id, job_type_to_string(delete->type),
-                                                    j->unit->id, job_type_to_string(j->type)),
-                                   "%s", strna(unit_ids));
-
-                        if (log_get_show_color())
-                                status = ANSI_HIGHLIGHT_RED " SKIP " ANSI_NORMAL;
-                        else
-                                status = " SKIP ";
-
-                        unit_status_printf(delete->unit,
-                                           STATUS_TYPE_NOTICE,
-                                           status,
-                                           "Ordering cycle found, skipping %s",
-                                           unit_status_string(delete->unit, NULL));
-                        transaction_delete_unit(tr, delete->unit);
-                        return -EAGAIN;
-                }
-
-                log_struct(LOG_ERR,
-                           LOG_UNIT_MESSAGE(j->unit, "Unable to break cycle starting with %s/%s",
-                                            j->unit->id, job_type_to_string(j->type)),
-                           "%s", strna(unit_ids));
-
-                return sd_bus_error_setf(e, BUS_ERROR_TRANSACTION_ORDER_IS_CYCLIC,
-                                         "Transaction order is cyclic. See system logs for details.");
-        }
-
-        /* Make the marker point to where we come from, so that we can
-         * find our way backwards if we want to break a cycle. We use
-         * a special marker for the beginning: we point to
-         * ourselves. */
-        j->marker = from ?: j;
-        j->generation = generation;
+        assert(ret);
+        assert(ret_n);
 
         /* Actual ordering of jobs depends on the unit ordering dependency and job types. We need to traverse
          * the graph over 'before' edges in the actual job execution order. We traverse over both unit
@@ -466,39 +386,287 @@ static int transaction_verify_order_one(Transaction *tr, Job *j, Job *from, unsi
                         if (job_compare(j, o, *d) >= 0)
                                 continue;
 
-                        r = transaction_verify_order_one(tr, o, j, generation, e);
+                        if (!GREEDY_REALLOC(l, n + 1))
+                                return -ENOMEM;
+
+                        l[n++] = o;
+                }
+        }
+
+        *ret = TAKE_PTR(l);
+        *ret_n = n;
+        return 0;
+}
+
+typedef struct OrderContext {
+        Transaction *tr;
+        unsigned generation;
+        unsigned index;
+
+        /* The stack of jobs whose strongly connected component is not determined yet */
+        Job **stack;
+        size_t n_stack;
+
+        /* The units to delete from the transaction to break the cycles found */
+        Unit **delete;
+        size_t n_delete;
+        bool unbreakable;
+} OrderContext;
+
+static void order_context_done(OrderContext *c) {
+        assert(c);
+
+        c->stack = mfree(c->stack);
+        c->delete = mfree(c->delete);
+}
+
+static int transaction_find_cycle(OrderContext *c, Job *start, Job **members, size_t n_members, Job ***ret, size_t *ret_n) {
+        _cleanup_hashmap_free_ Hashmap *parents = NULL;
+        _cleanup_set_free_ Set *scc = NULL;
+        _cleanup_free_ Job **queue = NULL, **cycle = NULL;
+        size_t n_queue = 0, n_cycle = 0;
+        int r;
+
+        assert(c);
+        assert(start);
+        assert(members);
+        assert(ret);
+        assert(ret_n);
+
+        /* Every job of a strongly connected component is on a cycle. Look for the shortest one through the
+         * root of the component with a breadth-first search, but only within the component. */
+
+        FOREACH_ARRAY(k, members, n_members) {
+                r = set_ensure_put(&scc, NULL, *k);
+                if (r < 0)
+                        return r;
+        }
+
+        queue = new(Job*, n_members);
+        if (!queue)
+                return -ENOMEM;
+
+        queue[n_queue++] = start;
+
+        for (size_t i = 0; i < n_queue; i++) {
+                _cleanup_free_ Job **next = NULL;
+                size_t n_next;
+
+                r = job_order_successors(c->tr, queue[i], &next, &n_next);
+                if (r < 0)
+                        return r;
+
+                FOREACH_ARRAY(o, next, n_next) {
+                        if (!set_contains(scc, *o))
+                                continue;
+
+                        if (*o == start) {
+                                /* Found our way back, collect the cycle backwards, starting with the job
+                                 * we came from */
+                                for (Job *k = queue[i]; k; k = hashmap_get(parents, k)) {
+                                        if (!GREEDY_REALLOC(cycle, n_cycle + 1))
+                                                return -ENOMEM;
+
+                                        cycle[n_cycle++] = k;
+                                }
+
+                                *ret = TAKE_PTR(cycle);
+                                *ret_n = n_cycle;
+                                return 0;
+                        }
+
+                        if (hashmap_contains(parents, *o))
+                                continue;
+
+                        r = hashmap_ensure_put(&parents, NULL, *o, queue[i]);
                         if (r < 0)
                                 return r;
+
+                        assert(n_queue < n_members);
+                        queue[n_queue++] = *o;
                 }
         }
 
-        /* Ok, let's backtrack, and remember that this entry is not on
-         * our path anymore. */
-        j->marker = NULL;
+        /* Not reached, the component would not be strongly connected otherwise */
+        return -EINVAL;
+}
+
+static int transaction_break_cycle(OrderContext *c, Job *j, Job **members, size_t n_members) {
+        _cleanup_free_ char **array = NULL, *unit_ids = NULL;
+        _cleanup_free_ Job **cycle = NULL;
+        Job *delete = NULL;
+        size_t n_cycle;
+        int r;
+
+        assert(c);
+        assert(j);
+
+        /* Found a strongly connected component with more than one job in it, i.e. a set of jobs with at
+         * least one ordering cycle among them. Report one cycle through the root j of the component, and
+         * pick a job to delete from it. Further cycles in the component are found in the next pass. */
+
+        r = transaction_find_cycle(c, j, members, n_members, &cycle, &n_cycle);
+        if (r < 0)
+                return r;
+
+        /* We go backwards along the cycle and try to find a suitable job to remove */
+        FOREACH_ARRAY(i, cycle, n_cycle) {
+                Job *k = *i;
+
+                /* For logging below */
+                if (strv_push_pair(&array, k->unit->id, (char*) job_type_to_string(k->type)) < 0)
+                        log_oom();
+
+                if (!delete && hashmap_contains(c->tr->jobs, k->unit) && !job_matters_to_anchor(k))
+                        /* Ok, we can drop this one, so let's do so. */
+                        delete = k;
+        }
+
+        unit_ids = merge_unit_ids(j->manager->unit_log_field, array); /* ignore error */
+
+        STRV_FOREACH_PAIR(unit_id, job_type, array)
+                /* logging for j not k here to provide a consistent narrative */
+                log_struct(LOG_WARNING,
+                           LOG_UNIT_MESSAGE(j->unit,
+                                            "Found %s on %s/%s",
+                                            unit_id == array ? "ordering cycle" : "dependency",
+                                            *unit_id, *job_type),
+                           "%s", strna(unit_ids));
 
+        if (delete) {
+                const char *status;
+                /* logging for j not k here to provide a consistent narrative */
+                log_struct(LOG_ERR,
+                           LOG_UNIT_MESSAGE(j->unit,
+                                            "Job %s/%s deleted to break ordering cycle starting with %s/%s",
+                                            delete->unit->id, job_type_to_string(delete->type),
+                                            j->unit->id, job_type_to_string(j->type)),
+                           "%s", strna(unit_ids));
+
+                if (log_get_show_color())
+                        status = ANSI_HIGHLIGHT_RED " SKIP " ANSI_NORMAL;
+                else
+                        status = " SKIP ";
+
+                unit_status_printf(delete->unit,
+                                   STATUS_TYPE_NOTICE,
+                                   status,
+                                   "Ordering cycle found, skipping %s",
+                                   unit_status_string(delete->unit, NULL));
+
+                /* Jobs are freed when deleted, possibly along with jobs of other components, hence
+                 * remember the unit, and delete its jobs once all components are processed. */
+                if (!GREEDY_REALLOC(c->delete, c->n_delete + 1))
+                        return -ENOMEM;
+
+                c->delete[c->n_delete++] = delete->unit;
+                return 0;
+        }
+
+        log_struct(LOG_ERR,
+                   LOG_UNIT_MESSAGE(j->unit, "Unable to break cycle starting with %s/%s",
+                                    j->unit->id, job_type_to_string(j->type)),
+                   "%s", strna(unit_ids));
+
+        c->unbreakable = true;
+        return 0;
+}
+
+static int transaction_verify_order_one(OrderContext *c, Job *j) {
+        _cleanup_free_ Job **next = NULL;
+        size_t n_next, i;
+        int r;
+
+        assert(c);
+        assert(j);
+
+        /* Tarjan's algorithm: a recursive sweep through the ordering graph that finds all strongly connected
+         * components, and hence all cycles, in one pass. The generation marks the jobs we have visited in
+         * this pass. */
+
+        j->generation = c->generation;
+        j->order_index = j->order_lowlink = c->index++;
+
+        if (!GREEDY_REALLOC(c->stack, c->n_stack + 1))
+                return -ENOMEM;
+
+        c->stack[c->n_stack++] = j;
+        j->on_order_stack = true;
+
+        r = job_order_successors(c->tr, j, &next, &n_next);
+        if (r < 0)
+                return r;
+
+        FOREACH_ARRAY(o, next, n_next) {
+                if ((*o)->generation != c->generation) {
+                        r = transaction_verify_order_one(c, *o);
+                        if (r < 0)
+                                return r;
+
+                        j->order_lowlink = MIN(j->order_lowlink, (*o)->order_lowlink);
+                } else if ((*o)->on_order_stack)
+                        j->order_lowlink = MIN(j->order_lowlink, (*o)->order_index);
+        }
+
+        if (j->order_lowlink != j->order_index)
+                return 0;
+
+        /* j is the root of a strongly connected component, which consists of everything above it on the
+         * stack. */
+        i = c->n_stack;
+        do {
+                i--;
+                c->stack[i]->on_order_stack = false;
+        } while (c->stack[i] != j);
+
+        if (c->n_stack - i > 1) {
+                r = transaction_break_cycle(c, j, c->stack + i, c->n_stack - i);
+                if (r < 0)
+                        return r;
+        }
+
+        c->n_stack = i;
         return 0;
 }
 
 static int transaction_verify_order(Transaction *tr, unsigned *generation, sd_bus_error *e) {
+        _cleanup_(order_context_done) OrderContext c = {
+                .tr = tr,
+        };
         Job *j;
         int r;
-        unsigned g;
 
         assert(tr);
         assert(generation);
 
-        /* Check if the ordering graph is cyclic. If it is, try to fix
-         * that up by dropping one of the jobs. */
+        /* Check if the ordering graph is cyclic. If it is, try to fix that up by dropping one job per
+         * cycle found. Returns -EAGAIN if jobs were dropped, in which case the caller should check
+         * again, as a component might contain more than one cycle. */
 
-        g = (*generation)++;
+        c.generation = (*generation)++;
 
         HASHMAP_FOREACH(j, tr->jobs) {
-                r = transaction_verify_order_one(tr, j, NULL, g, e);
+                assert(!j->transaction_prev);
+
+                if (j->generation == c.generation)
+                        continue;
+
+                r = transaction_verify_order_one(&c, j);
                 if (r < 0)
                         return r;
         }
 
-        return 0;
+        if (c.unbreakable)
+                return sd_bus_error_setf(e, BUS_ERROR_TRANSACTION_ORDER_IS_CYCLIC,
+                                         "Transaction order is cyclic. See system logs for details.");
+
+        if (c.n_delete == 0)
+                return 0;
+
+        FOREACH_ARRAY(u, c.delete, c.n_delete)
+                transaction_delete_unit(tr, *u);
+
+        return -EAGAIN;
 }
 
 static void transaction_collect_garbage(Transaction *tr) {
@@ -646,7 +814,7 @@ static int transaction_apply(
                 assert(!j->transaction_prev);
                 assert(!j->transaction_next);
 
-                r = hashmap_ensure_put(&m->jobs, NULL, UINT32_TO_PTR(j->id), j);
+                r = hashmap_ensure_put(&m->jobs, &trivial_hash_ops_trusted, UINT32_TO_PTR(j->id), j);
                 if (r < 0)
                         goto rollback;
         }
@@ -817,7 +985,6 @@ static Job* transaction_add_one_job(Transaction *tr, JobType type, Unit *unit, b
                 return NULL;
 
         j->generation = 0;
-        j->marker = NULL;
         j->matters_to_anchor = false;
         j->irreversible = tr->irreversible;
 
@@ -1232,7 +1399,7 @@ Transaction *transaction_new(bool irreversible) {
         if (!tr)
                 return NULL;
 
-        tr->jobs = hashmap_new(NULL);
+        tr->jobs = hashmap_new(&trivial_hash_ops_trusted);
         if (!tr->jobs)
                 return mfree(tr);
 
@@ -382,15 +382,11 @@ int unit_deserialize_state_skip(FILE *f) {
         for (;;) {
                 _cleanup_free_ char *line = NULL;
 
-                r = read_stripped_line(f, LONG_LINE_MAX, &line);
+                r = deserialize_read_line(f, &line);
                 if (r < 0)
-                        return log_error_errno(r, "Failed to read serialization line: %m");
-                if (r == 0)
-                        return 0;
-
-                /* End marker */
-                if (isempty(line))
-                        return 1;
+                        return r;
+                if (r == 0) /* End marker or EOF */
+                        return !feof(f);
         }
 }
 
@@ -611,7 +607,7 @@ void unit_dump(Unit *u, FILE *f, const char *prefix) {
                 UnitDependencyInfo di;
                 Unit *other;
 
-                HASHMAP_FOREACH_KEY(di.data, other, unit_get_dependencies(u, d)) {
+                UNIT_FOREACH_DEPENDENCY_OF_TYPE(other, &di, u, d) {
                         bool space = false;
 
                         fprintf(f, "%s\t%s: %s (", prefix, unit_dependency_to_string(d), other->id);
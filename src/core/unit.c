@@ -27,6 +27,7 @@
 #include "escape.h"
 #include "exec-credential.h"
 #include "execute.h"
+#include "execute-serialize.h"
 #include "fd-util.h"
 #include "fileio-label.h"
 #include "fileio.h"
@@ -45,6 +46,7 @@
 #include "path-util.h"
 #include "process-util.h"
 #include "rm-rf.h"
+#include "seccomp-cache.h"
 #include "serialize.h"
 #include "set.h"
 #include "signal-util.h"
@@ -53,6 +55,7 @@
 #include "specifier.h"
 #include "stat-util.h"
 #include "stdio-util.h"
+#include "string-intern.h"
 #include "string-table.h"
 #include "string-util.h"
 #include "strv.h"
@@ -628,26 +631,257 @@ void unit_submit_to_release_resources_queue(Unit *u) {
         u->in_release_resources_queue = true;
 }
 
+/* Iterates through the entries of a dependency list. It is safe to remove the current entry while
+ * iterating, but not to add any. */
+#define _UNIT_DEPENDENCY_LIST_FOREACH(other, info, l, i)                \
+        for (UnitDependencyIterator i = UNIT_DEPENDENCY_ITERATOR_FIRST; \
+             unit_dependency_list_iterate((l), &i, &(other), (info)); )
+
+#define UNIT_DEPENDENCY_LIST_FOREACH(other, info, l) \
+        _UNIT_DEPENDENCY_LIST_FOREACH(other, info, l, UNIQ_T(i, UNIQ))
+
+static UnitDependencyEntry* unit_dependency_list_find(const UnitDependencyList *l, const Unit *other) {
+        assert(l);
+        assert(!l->hashmap);
+
+        /* There are at most UNIT_DEPENDENCY_LIST_MAX entries, i.e. a few cache lines, a linear search is as
+         * fast as anything else here */
+        FOREACH_ARRAY(e, l->entries, l->n_entries)
+                if (e->unit == other)
+                        return e;
+
+        return NULL;
+}
+
+size_t unit_dependency_list_size(const UnitDependencyList *l) {
+        if (!l)
+                return 0;
+
+        return l->hashmap ? hashmap_size(l->hashmap) : l->n_entries;
+}
+
+void* unit_dependency_list_get(const UnitDependencyList *l, const Unit *other) {
+        UnitDependencyEntry *e;
+
+        if (!l)
+                return NULL;
+
+        if (l->hashmap)
+                return hashmap_get(l->hashmap, other);
+
+        e = unit_dependency_list_find(l, other);
+        return e ? e->info.data : NULL;
+}
+
+bool unit_dependency_list_iterate(
+                const UnitDependencyList *l,
+                UnitDependencyIterator *i,
+                Unit **ret_unit,
+                UnitDependencyInfo *ret_info) {
+
+        const UnitDependencyEntry *e;
+
+        assert(i);
+
+        if (!l)
+                return false;
+
+        if (l->hashmap)
+                return hashmap_iterate(l->hashmap, &i->hashmap_iterator, ret_info ? &ret_info->data : NULL, (const void**) ret_unit);
+
+        /* Only move on if the entry we returned last is still there, if it was removed, its successor moved
+         * into its place. */
+        if (i->index == SIZE_MAX)
+                i->index = 0;
+        else if (i->index < l->n_entries && l->entries[i->index].unit == i->current)
+                i->index++;
+
+        if (i->index >= l->n_entries)
+                return false;
+
+        e = l->entries + i->index;
+        i->current = e->unit;
+
+        if (ret_unit)
+                *ret_unit = e->unit;
+        if (ret_info)
+                *ret_info = e->info;
+
+        return true;
+}
+
+static int unit_dependency_list_to_hashmap(UnitDependencyList *l, size_t n_extra) {
+        _cleanup_hashmap_free_ Hashmap *h = NULL;
+        int r;
+
+        assert(l);
+        assert(!l->hashmap);
+
+        h = hashmap_new(&trivial_hash_ops_trusted);
+        if (!h)
+                return -ENOMEM;
+
+        r = hashmap_reserve(h, l->n_entries + n_extra);
+        if (r < 0)
+                return r;
+
+        FOREACH_ARRAY(e, l->entries, l->n_entries)
+                assert_se(hashmap_put(h, e->unit, e->info.data) > 0);
+
+        l->hashmap = TAKE_PTR(h);
+        l->entries = mfree(l->entries);
+        l->n_entries = 0;
+
+        return 0;
+}
+
+static int unit_dependency_list_reserve(UnitDependencyList *l, size_t n_extra) {
+        assert(l);
+
+        /* Makes sure n_extra more entries can be added to the list without allocating memory */
+
+        if (n_extra == 0)
+                return 0;
+
+        if (l->hashmap)
+                return hashmap_reserve(l->hashmap, n_extra);
+
+        if (l->n_entries + n_extra > UNIT_DEPENDENCY_LIST_MAX)
+                return unit_dependency_list_to_hashmap(l, n_extra);
+
+        if (!GREEDY_REALLOC(l->entries, l->n_entries + n_extra))
+                return -ENOMEM;
+
+        return 0;
+}
+
+static int unit_dependency_list_put(UnitDependencyList *l, Unit *other, UnitDependencyInfo info) {
+        UnitDependencyEntry *e;
+        int r;
+
+        assert(l);
+        assert(other);
+        assert(info.data);
+
+        /* Adds the entry, or replaces the info of an existing one. Returns 1 in the former case, 0 in the
+         * latter, which never fails. */
+
+        if (!l->hashmap) {
+                e = unit_dependency_list_find(l, other);
+                if (e) {
+                        e->info = info;
+                        return 0;
+                }
+
+                if (l->n_entries < UNIT_DEPENDENCY_LIST_MAX) {
+                        if (!GREEDY_REALLOC(l->entries, l->n_entries + 1))
+                                return -ENOMEM;
+
+                        l->entries[l->n_entries++] = (UnitDependencyEntry) {
+                                .unit = other,
+                                .info = info,
+                        };
+
+                        return 1;
+                }
+
+                r = unit_dependency_list_to_hashmap(l, 1);
+                if (r < 0)
+                        return r;
+        }
+
+        return hashmap_replace(l->hashmap, other, info.data);
+}
+
+static void* unit_dependency_list_remove(UnitDependencyList *l, const Unit *other) {
+        UnitDependencyEntry *e;
+        void *data;
+
+        assert(l);
+
+        if (l->hashmap)
+                return hashmap_remove(l->hashmap, other);
+
+        e = unit_dependency_list_find(l, other);
+        if (!e)
+                return NULL;
+
+        /* Keep the order, so that the iterator can pick up where it left off */
+        data = e->info.data;
+        memmove(e, e + 1, (l->entries + l->n_entries - (e + 1)) * sizeof(UnitDependencyEntry));
+        l->n_entries--;
+
+        return data;
+}
+
+static void unit_dependency_list_done(UnitDependencyList *l) {
+        assert(l);
+
+        l->entries = mfree(l->entries);
+        l->n_entries = 0;
+        l->hashmap = hashmap_free(l->hashmap);
+}
+
+static UnitDependencyList* unit_acquire_dependencies(Unit *u, UnitDependency d) {
+        size_t i;
+
+        assert(u);
+        assert(d >= 0 && d < _UNIT_DEPENDENCY_MAX);
+
+        /* Returns the list of dependencies of type d, and adds an empty one at the right spot if there is
+         * none yet. */
+
+        for (i = 0; i < u->n_dependencies; i++)
+                if (u->dependencies[i].type == d)
+                        return u->dependencies + i;
+                else if (u->dependencies[i].type > d)
+                        break;
+
+        if (!GREEDY_REALLOC(u->dependencies, u->n_dependencies + 1))
+                return NULL;
+
+        memmove(u->dependencies + i + 1, u->dependencies + i, (u->n_dependencies - i) * sizeof(UnitDependencyList));
+        u->dependencies[i] = (UnitDependencyList) {
+                .type = d,
+        };
+        u->n_dependencies++;
+
+        return u->dependencies + i;
+}
+
+static void unit_remove_dependency_list(Unit *u, UnitDependencyList *l) {
+        size_t i;
+
+        assert(u);
+        assert(l >= u->dependencies && l < u->dependencies + u->n_dependencies);
+
+        i = l - u->dependencies;
+
+        unit_dependency_list_done(l);
+        memmove(l, l + 1, (u->n_dependencies - i - 1) * sizeof(UnitDependencyList));
+        u->n_dependencies--;
+}
+
 static void unit_clear_dependencies(Unit *u) {
         assert(u);
 
         /* Removes all dependencies configured on u and their reverse dependencies. */
 
-        for (Hashmap *deps; (deps = hashmap_steal_first(u->dependencies));) {
+        FOREACH_ARRAY(deps, u->dependencies, u->n_dependencies) {
+                Unit *other;
 
-                for (Unit *other; (other = hashmap_steal_first_key(deps));) {
-                        Hashmap *other_deps;
-
-                        HASHMAP_FOREACH(other_deps, other->dependencies)
-                                hashmap_remove(other_deps, u);
+                UNIT_DEPENDENCY_LIST_FOREACH(other, NULL, deps) {
+                        FOREACH_ARRAY(other_deps, other->dependencies, other->n_dependencies)
+                                (void) unit_dependency_list_remove(other_deps, u);
 
                         unit_add_to_gc_queue(other);
                 }
 
-                hashmap_free(deps);
+                unit_dependency_list_done(deps);
         }
 
-        u->dependencies = hashmap_free(u->dependencies);
+        u->dependencies = mfree(u->dependencies);
+        u->n_dependencies = 0;
 }
 
 static void unit_remove_transient(Unit *u) {
@@ -756,6 +990,8 @@ Unit* unit_free(Unit *u) {
         u->match_bus_slot = sd_bus_slot_unref(u->match_bus_slot);
         u->bus_track = sd_bus_track_unref(u->bus_track);
         u->deserialized_refs = strv_free(u->deserialized_refs);
+        bus_unit_free_property_digests(u);
+        exec_serialization_cache_free(u->exec_serialization_cache);
         u->pending_freezer_invocation = sd_bus_message_unref(u->pending_freezer_invocation);
 
         unit_free_mounts_for(u);
@@ -823,8 +1059,7 @@ Unit* unit_free(Unit *u) {
         if (u->in_cgroup_realize_queue)
                 LIST_REMOVE(cgroup_realize_queue, u->manager->cgroup_realize_queue, u);
 
-        if (u->in_cgroup_empty_queue)
-                LIST_REMOVE(cgroup_empty_queue, u->manager->cgroup_empty_queue, u);
+        unit_remove_from_cgroup_empty_queue(u);
 
         if (u->in_cgroup_oom_queue)
                 LIST_REMOVE(cgroup_oom_queue, u->manager->cgroup_oom_queue, u);
@@ -850,10 +1085,11 @@ Unit* unit_free(Unit *u) {
         condition_free_list(u->asserts);
 
         free(u->description);
-        strv_free(u->documentation);
-        free(u->fragment_path);
+        string_unintern_strv(u->documentation);
+        string_unintern(u->fragment_path);
         free(u->source_path);
-        strv_free(u->dropin_paths);
+        string_unintern_strv(u->dropin_paths);
+        unit_dropin_prefetch_free(u->dropin_prefetch);
         free(u->instance);
 
         free(u->job_timeout_reboot_arg);
@@ -922,44 +1158,31 @@ static int unit_merge_names(Unit *u, Unit *other) {
 
 static int unit_reserve_dependencies(Unit *u, Unit *other) {
         size_t n_reserve;
-        Hashmap* deps;
-        void *d;
         int r;
 
         assert(u);
         assert(other);
 
-        /* Let's reserve some space in the dependency hashmaps so that later on merging the units cannot
+        /* Let's reserve some space in the dependency lists so that later on merging the units cannot
          * fail.
          *
-         * First make some room in the per dependency type hashmaps. Using the summed size of both units'
-         * hashmaps is an estimate that is likely too high since they probably use some of the same
+         * First make some room in the array of per dependency type lists. Using the summed size of both
+         * units' arrays is an estimate that is likely too high since they probably use some of the same
          * types. But it's never too low, and that's all we need. */
 
-        n_reserve = MIN(hashmap_size(other->dependencies), LESS_BY((size_t) _UNIT_DEPENDENCY_MAX, hashmap_size(u->dependencies)));
-        if (n_reserve > 0) {
-                r = hashmap_ensure_allocated(&u->dependencies, NULL);
-                if (r < 0)
-                        return r;
-
-                r = hashmap_reserve(u->dependencies, n_reserve);
-                if (r < 0)
-                        return r;
-        }
+        n_reserve = MIN(other->n_dependencies, LESS_BY((size_t) _UNIT_DEPENDENCY_MAX, u->n_dependencies));
+        if (n_reserve > 0 && !GREEDY_REALLOC(u->dependencies, u->n_dependencies + n_reserve))
+                return -ENOMEM;
 
-        /* Now, enlarge our per dependency type hashmaps by the number of entries in the same hashmap of the
-         * other unit's dependencies.
+        /* Now, enlarge our per dependency type lists by the number of entries in the same list of the other
+         * unit's dependencies.
          *
-         * NB: If u does not have a dependency set allocated for some dependency type, there is no need to
-         * reserve anything for. In that case other's set will be transferred as a whole to u by
-         * complete_move(). */
-
-        HASHMAP_FOREACH_KEY(deps, d, u->dependencies) {
-                Hashmap *other_deps;
-
-                other_deps = hashmap_get(other->dependencies, d);
+         * NB: If u does not have a dependency list for some dependency type, there is no need to reserve
+         * anything for. In that case other's list will be transferred as a whole to u by
+         * unit_merge_dependencies(). */
 
-                r = hashmap_reserve(deps, hashmap_size(other_deps));
+        FOREACH_ARRAY(deps, u->dependencies, u->n_dependencies) {
+                r = unit_dependency_list_reserve(deps, unit_dependency_list_size(unit_get_dependencies(other, deps->type)));
                 if (r < 0)
                         return r;
         }
@@ -980,8 +1203,8 @@ static bool unit_should_warn_about_dependency(UnitDependency dependency) {
                       UNIT_TRIGGERED_BY);
 }
 
-static int unit_per_dependency_type_hashmap_update(
-                Hashmap *per_type,
+static int unit_per_dependency_type_list_update(
+                UnitDependencyList *per_type,
                 Unit *other,
                 UnitDependencyMask origin_mask,
                 UnitDependencyMask destination_mask) {
@@ -989,13 +1212,14 @@ static int unit_per_dependency_type_hashmap_update(
         UnitDependencyInfo info;
         int r;
 
+        assert(per_type);
         assert(other);
         assert_cc(sizeof(void*) == sizeof(info));
 
         /* Acquire the UnitDependencyInfo entry for the Unit* we are interested in, and update it if it
          * exists, or insert it anew if not. */
 
-        info.data = hashmap_get(per_type, other);
+        info.data = unit_dependency_list_get(per_type, other);
         if (info.data) {
                 /* Entry already exists. Add in our mask. */
 
@@ -1005,16 +1229,13 @@ static int unit_per_dependency_type_hashmap_update(
 
                 info.origin_mask |= origin_mask;
                 info.destination_mask |= destination_mask;
-
-                r = hashmap_update(per_type, other, info.data);
-        } else {
+        } else
                 info = (UnitDependencyInfo) {
                         .origin_mask = origin_mask,
                         .destination_mask = destination_mask,
                 };
 
-                r = hashmap_put(per_type, other, info.data);
-        }
+        r = unit_dependency_list_put(per_type, other, info);
         if (r < 0)
                 return r;
 
@@ -1022,10 +1243,6 @@ static int unit_per_dependency_type_hashmap_update(
 }
 
 static void unit_merge_dependencies(Unit *u, Unit *other) {
-        Hashmap *deps;
-        void *dt; /* Actually of type UnitDependency, except that we don't bother casting it here,
-                   * since the hashmaps all want it as void pointer. */
-
         assert(u);
         assert(other);
 
@@ -1033,56 +1250,47 @@ static void unit_merge_dependencies(Unit *u, Unit *other) {
                 return;
 
         /* First, remove dependency to other. */
-        HASHMAP_FOREACH_KEY(deps, dt, u->dependencies) {
-                if (hashmap_remove(deps, other) && unit_should_warn_about_dependency(UNIT_DEPENDENCY_FROM_PTR(dt)))
+        for (size_t i = u->n_dependencies; i > 0; i--) {
+                UnitDependencyList *deps = u->dependencies + i - 1;
+
+                if (unit_dependency_list_remove(deps, other) && unit_should_warn_about_dependency(deps->type))
                         log_unit_warning(u, "Dependency %s=%s is dropped, as %s is merged into %s.",
-                                         unit_dependency_to_string(UNIT_DEPENDENCY_FROM_PTR(dt)),
+                                         unit_dependency_to_string(deps->type),
                                          other->id, other->id, u->id);
 
-                if (hashmap_isempty(deps))
-                        hashmap_free(hashmap_remove(u->dependencies, dt));
+                if (unit_dependency_list_size(deps) == 0)
+                        unit_remove_dependency_list(u, deps);
         }
 
-        for (;;) {
-                _cleanup_hashmap_free_ Hashmap *other_deps = NULL;
+        /* Let's focus on one dependency type at a time, that 'other' has defined. */
+        FOREACH_ARRAY(other_deps, other->dependencies, other->n_dependencies) {
+                UnitDependencyList *deps;
                 UnitDependencyInfo di_back;
                 Unit *back;
 
-                /* Let's focus on one dependency type at a time, that 'other' has defined. */
-                other_deps = hashmap_steal_first_key_and_value(other->dependencies, &dt);
-                if (!other_deps)
-                        break; /* done! */
+                /* Is there a dependency pointing back to the unit we want to merge with? Suppress it (but
+                 * warn) */
+                if (unit_dependency_list_remove(other_deps, u) && unit_should_warn_about_dependency(other_deps->type))
+                        log_unit_warning(u, "Dependency %s=%s in %s is dropped, as %s is merged into %s.",
+                                         unit_dependency_to_string(other_deps->type),
+                                         u->id, other->id, other->id, u->id);
 
-                deps = hashmap_get(u->dependencies, dt);
+                deps = unit_get_dependencies(u, other_deps->type);
 
                 /* Now iterate through all dependencies of this dependency type, of 'other'. We refer to the
                  * referenced units as 'back'. */
-                HASHMAP_FOREACH_KEY(di_back.data, back, other_deps) {
-                        Hashmap *back_deps;
-                        void *back_dt;
-
-                        if (back == u) {
-                                /* This is a dependency pointing back to the unit we want to merge with?
-                                 * Suppress it (but warn) */
-                                if (unit_should_warn_about_dependency(UNIT_DEPENDENCY_FROM_PTR(dt)))
-                                        log_unit_warning(u, "Dependency %s=%s in %s is dropped, as %s is merged into %s.",
-                                                         unit_dependency_to_string(UNIT_DEPENDENCY_FROM_PTR(dt)),
-                                                         u->id, other->id, other->id, u->id);
-
-                                hashmap_remove(other_deps, back);
-                                continue;
-                        }
+                UNIT_DEPENDENCY_LIST_FOREACH(back, &di_back, other_deps) {
 
                         /* Now iterate through all deps of 'back', and fix the ones pointing to 'other' to
                          * point to 'u' instead. */
-                        HASHMAP_FOREACH_KEY(back_deps, back_dt, back->dependencies) {
+                        FOREACH_ARRAY(back_deps, back->dependencies, back->n_dependencies) {
                                 UnitDependencyInfo di_move;
 
-                                di_move.data = hashmap_remove(back_deps, other);
+                                di_move.data = unit_dependency_list_remove(back_deps, other);
                                 if (!di_move.data)
                                         continue;
 
-                                assert_se(unit_per_dependency_type_hashmap_update(
+                                assert_se(unit_per_dependency_type_list_update(
                                                           back_deps,
                                                           u,
                                                           di_move.origin_mask,
@@ -1091,21 +1299,28 @@ static void unit_merge_dependencies(Unit *u, Unit *other) {
 
                         /* The target unit already has dependencies of this type, let's then merge this individually. */
                         if (deps)
-                                assert_se(unit_per_dependency_type_hashmap_update(
+                                assert_se(unit_per_dependency_type_list_update(
                                                           deps,
                                                           back,
                                                           di_back.origin_mask,
                                                           di_back.destination_mask) >= 0);
                 }
 
-                /* Now all references towards 'other' of the current type 'dt' are corrected to point to 'u'.
-                 * Lets's now move the deps of type 'dt' from 'other' to 'u'. If the unit does not have
-                 * dependencies of this type, let's move them per type wholesale. */
-                if (!deps)
-                        assert_se(hashmap_put(u->dependencies, dt, TAKE_PTR(other_deps)) >= 0);
+                /* Now all references towards 'other' of the current type are corrected to point to 'u'.
+                 * Lets's now move the deps of this type from 'other' to 'u'. If the unit does not have
+                 * dependencies of this type, let's move them per type wholesale. The room for that was
+                 * reserved by unit_reserve_dependencies(). */
+                if (!deps && unit_dependency_list_size(other_deps) > 0) {
+                        assert_se(deps = unit_acquire_dependencies(u, other_deps->type));
+                        *deps = TAKE_STRUCT(*other_deps);
+                }
         }
 
-        other->dependencies = hashmap_free(other->dependencies);
+        FOREACH_ARRAY(other_deps, other->dependencies, other->n_dependencies)
+                unit_dependency_list_done(other_deps);
+
+        other->dependencies = mfree(other->dependencies);
+        other->n_dependencies = 0;
 }
 
 int unit_merge(Unit *u, Unit *other) {
@@ -1661,6 +1876,7 @@ int unit_load(Unit *u) {
         }
 
         r = UNIT_VTABLE(u)->load(u);
+        u->dropin_prefetch = unit_dropin_prefetch_free(u->dropin_prefetch);
         if (r < 0)
                 goto fail;
 
@@ -3022,29 +3238,6 @@ bool unit_job_is_applicable(Unit *u, JobType j) {
         }
 }
 
-static Hashmap *unit_get_dependency_hashmap_per_type(Unit *u, UnitDependency d) {
-        Hashmap *deps;
-
-        assert(u);
-        assert(d >= 0 && d < _UNIT_DEPENDENCY_MAX);
-
-        deps = hashmap_get(u->dependencies, UNIT_DEPENDENCY_TO_PTR(d));
-        if (!deps) {
-                _cleanup_hashmap_free_ Hashmap *h = NULL;
-
-                h = hashmap_new(NULL);
-                if (!h)
-                        return NULL;
-
-                if (hashmap_ensure_put(&u->dependencies, NULL, UNIT_DEPENDENCY_TO_PTR(d), h) < 0)
-                        return NULL;
-
-                deps = TAKE_PTR(h);
-        }
-
-        return deps;
-}
-
 typedef enum NotifyDependencyFlags {
         NOTIFY_DEPENDENCY_UPDATE_FROM = 1 << 0,
         NOTIFY_DEPENDENCY_UPDATE_TO   = 1 << 1,
@@ -3090,7 +3283,7 @@ static int unit_add_dependency_impl(
                 [UNIT_SLICE_OF]               = UNIT_IN_SLICE,
         };
 
-        Hashmap *u_deps, *other_deps;
+        UnitDependencyList *u_deps, *other_deps;
         UnitDependencyInfo u_info, u_info_old, other_info, other_info_old;
         NotifyDependencyFlags flags = 0;
         int r;
@@ -3101,20 +3294,19 @@ static int unit_add_dependency_impl(
         assert(inverse_table[d] >= 0 && inverse_table[d] < _UNIT_DEPENDENCY_MAX);
         assert(mask > 0 && mask < _UNIT_DEPENDENCY_MASK_FULL);
 
-        /* Ensure the following two hashmaps for each unit exist:
-         * - the top-level dependency hashmap that maps UnitDependency → Hashmap(Unit* → UnitDependencyInfo),
-         * - the inner hashmap, that maps Unit* → UnitDependencyInfo, for the specified dependency type. */
-        u_deps = unit_get_dependency_hashmap_per_type(u, d);
+        /* Ensure the lists of dependencies of the specified type, and of its inverse on the other unit
+         * exist. */
+        u_deps = unit_acquire_dependencies(u, d);
         if (!u_deps)
                 return -ENOMEM;
 
-        other_deps = unit_get_dependency_hashmap_per_type(other, inverse_table[d]);
+        other_deps = unit_acquire_dependencies(other, inverse_table[d]);
         if (!other_deps)
                 return -ENOMEM;
 
         /* Save the original dependency info. */
-        u_info.data = u_info_old.data = hashmap_get(u_deps, other);
-        other_info.data = other_info_old.data = hashmap_get(other_deps, u);
+        u_info.data = u_info_old.data = unit_dependency_list_get(u_deps, other);
+        other_info.data = other_info_old.data = unit_dependency_list_get(other_deps, u);
 
         /* Update dependency info. */
         u_info.origin_mask |= mask;
@@ -3122,7 +3314,7 @@ static int unit_add_dependency_impl(
 
         /* Save updated dependency info. */
         if (u_info.data != u_info_old.data) {
-                r = hashmap_replace(u_deps, other, u_info.data);
+                r = unit_dependency_list_put(u_deps, other, u_info);
                 if (r < 0)
                         return r;
 
@@ -3130,14 +3322,14 @@ static int unit_add_dependency_impl(
         }
 
         if (other_info.data != other_info_old.data) {
-                r = hashmap_replace(other_deps, u, other_info.data);
+                r = unit_dependency_list_put(other_deps, u, other_info);
                 if (r < 0) {
                         if (u_info.data != u_info_old.data) {
                                 /* Restore the old dependency. */
                                 if (u_info_old.data)
-                                        (void) hashmap_update(u_deps, other, u_info_old.data);
+                                        (void) unit_dependency_list_put(u_deps, other, u_info_old);
                                 else
-                                        hashmap_remove(u_deps, other);
+                                        (void) unit_dependency_list_remove(u_deps, other);
                         }
                         return r;
                 }
@@ -4122,11 +4314,7 @@ UnitFileState unit_get_unit_file_state(Unit *u) {
         assert(u);
 
         if (u->unit_file_state < 0 && u->fragment_path) {
-                r = unit_file_get_state(
-                                u->manager->runtime_scope,
-                                NULL,
-                                u->id,
-                                &u->unit_file_state);
+                r = install_cache_get_state(u->manager->install_cache, u->id, &u->unit_file_state);
                 if (r < 0)
                         u->unit_file_state = UNIT_FILE_BAD;
         }
@@ -4675,10 +4863,12 @@ int unit_make_transient(Unit *u) {
         safe_fclose(u->transient_file);
         u->transient_file = f;
 
-        free_and_replace(u->fragment_path, path);
+        /* Transient unit files are specific to the unit, no point in interning the path. */
+        string_unintern(u->fragment_path);
+        u->fragment_path = TAKE_PTR(path);
 
         u->source_path = mfree(u->source_path);
-        u->dropin_paths = strv_free(u->dropin_paths);
+        u->dropin_paths = string_unintern_strv(u->dropin_paths);
         u->fragment_mtime = u->source_mtime = u->dropin_mtime = 0;
 
         u->load_state = UNIT_STUB;
@@ -5386,6 +5576,15 @@ int unit_set_exec_params(Unit *u, ExecParameters *p) {
         p->user_lookup_fd = u->manager->user_lookup_fds[1];
         p->handoff_timestamp_fd = u->manager->handoff_timestamp_fds[1];
 
+        /* The precompiled filter includes write() for the handoff timestamp, hence only use it if we have
+         * one. If compilation fails here, the executor will simply try again on its own. */
+        ExecContext *ec = unit_get_exec_context(u);
+        if (ec && p->handoff_timestamp_fd >= 0 && p->syscall_filter_fd < 0) {
+                r = manager_acquire_syscall_filter(u->manager, ec, &p->syscall_filter_fd);
+                if (r < 0)
+                        log_unit_debug_errno(u, r, "Failed to precompile system call filter, ignoring: %m");
+        }
+
         p->cgroup_id = crt ? crt->cgroup_id : 0;
         p->invocation_id = u->invocation_id;
         sd_id128_to_string(p->invocation_id, p->invocation_id_string);
@@ -5477,20 +5676,19 @@ int unit_fork_and_watch_rm_rf(Unit *u, char **paths, PidRef *ret_pid) {
         return 0;
 }
 
-static void unit_update_dependency_mask(Hashmap *deps, Unit *other, UnitDependencyInfo di) {
+static void unit_update_dependency_mask(UnitDependencyList *deps, Unit *other, UnitDependencyInfo di) {
         assert(deps);
         assert(other);
 
         if (di.origin_mask == 0 && di.destination_mask == 0)
                 /* No bit set anymore, let's drop the whole entry */
-                assert_se(hashmap_remove(deps, other));
+                assert_se(unit_dependency_list_remove(deps, other));
         else
                 /* Mask was reduced, let's update the entry */
-                assert_se(hashmap_update(deps, other, di.data) == 0);
+                assert_se(unit_dependency_list_put(deps, other, di) == 0);
 }
 
 void unit_remove_dependencies(Unit *u, UnitDependencyMask mask) {
-        Hashmap *deps;
         assert(u);
 
         /* Removes all dependencies u has on other units marked for ownership by 'mask'. */
@@ -5498,50 +5696,39 @@ void unit_remove_dependencies(Unit *u, UnitDependencyMask mask) {
         if (mask == 0)
                 return;
 
-        HASHMAP_FOREACH(deps, u->dependencies) {
-                bool done;
-
-                do {
-                        UnitDependencyInfo di;
-                        Unit *other;
-
-                        done = true;
-
-                        HASHMAP_FOREACH_KEY(di.data, other, deps) {
-                                Hashmap *other_deps;
-
-                                if (FLAGS_SET(~mask, di.origin_mask))
-                                        continue;
-
-                                di.origin_mask &= ~mask;
-                                unit_update_dependency_mask(deps, other, di);
+        FOREACH_ARRAY(deps, u->dependencies, u->n_dependencies) {
+                UnitDependencyInfo di;
+                Unit *other;
 
-                                /* We updated the dependency from our unit to the other unit now. But most
-                                 * dependencies imply a reverse dependency. Hence, let's delete that one
-                                 * too. For that we go through all dependency types on the other unit and
-                                 * delete all those which point to us and have the right mask set. */
+                /* Note that removing the current entry while iterating is fine */
+                UNIT_DEPENDENCY_LIST_FOREACH(other, &di, deps) {
+                        if (FLAGS_SET(~mask, di.origin_mask))
+                                continue;
 
-                                HASHMAP_FOREACH(other_deps, other->dependencies) {
-                                        UnitDependencyInfo dj;
+                        di.origin_mask &= ~mask;
+                        unit_update_dependency_mask(deps, other, di);
 
-                                        dj.data = hashmap_get(other_deps, u);
-                                        if (FLAGS_SET(~mask, dj.destination_mask))
-                                                continue;
+                        /* We updated the dependency from our unit to the other unit now. But most
+                         * dependencies imply a reverse dependency. Hence, let's delete that one too. For
+                         * that we go through all dependency types on the other unit and delete all those
+                         * which point to us and have the right mask set. */
 
-                                        dj.destination_mask &= ~mask;
-                                        unit_update_dependency_mask(other_deps, u, dj);
-                                }
+                        FOREACH_ARRAY(other_deps, other->dependencies, other->n_dependencies) {
+                                UnitDependencyInfo dj;
 
-                                unit_add_to_gc_queue(other);
-
-                                /* The unit 'other' may not be wanted by the unit 'u'. */
-                                unit_submit_to_stop_when_unneeded_queue(other);
+                                dj.data = unit_dependency_list_get(other_deps, u);
+                                if (FLAGS_SET(~mask, dj.destination_mask))
+                                        continue;
 
-                                done = false;
-                                break;
+                                dj.destination_mask &= ~mask;
+                                unit_update_dependency_mask(other_deps, u, dj);
                         }
 
-                } while (!done);
+                        unit_add_to_gc_queue(other);
+
+                        /* The unit 'other' may not be wanted by the unit 'u'. */
+                        unit_submit_to_stop_when_unneeded_queue(other);
+                }
         }
 }
 
@@ -29,6 +29,8 @@ typedef enum UnitMountDependencyType {
 #include "unit-file.h"
 
 typedef struct UnitRef UnitRef;
+typedef struct UnitDropinPrefetch UnitDropinPrefetch;
+typedef struct ExecSerializationCache ExecSerializationCache;
 
 typedef enum KillOperation {
         KILL_TERMINATE,
@@ -191,15 +193,41 @@ static inline const ActivationDetailsVTable* ACTIVATION_DETAILS_VTABLE(const Act
         return activation_details_vtable[a->trigger_unit_type];
 }
 
-/* Newer LLVM versions don't like implicit casts from large pointer types to smaller enums, hence let's add
- * explicit type-safe helpers for that. */
-static inline UnitDependency UNIT_DEPENDENCY_FROM_PTR(const void *p) {
-        return PTR_TO_INT(p);
-}
+/* The dependencies of one type a unit has. Most of these only have a handful of entries, hence they are
+ * kept in a small array in insertion order, with the UnitDependencyInfo stored inline, and looked up with a
+ * linear scan. Once an entry is added to a list that has UNIT_DEPENDENCY_LIST_MAX entries already (think:
+ * the Before= list of sysinit.target), the list is converted into a Hashmap(Unit* → UnitDependencyInfo),
+ * so that adding and looking up entries stays O(1). It is not converted back if entries are removed. */
+#define UNIT_DEPENDENCY_LIST_MAX 16U
+
+typedef struct UnitDependencyEntry {
+        Unit *unit;
+        UnitDependencyInfo info;
+} UnitDependencyEntry;
+
+typedef struct UnitDependencyList {
+        UnitDependency type;
+        unsigned n_entries;           /* Only valid as long as 'hashmap' is NULL */
+        UnitDependencyEntry *entries;
+        Hashmap *hashmap;
+} UnitDependencyList;
+
+typedef struct UnitDependencyIterator {
+        size_t index;
+        const Unit *current;
+        Iterator hashmap_iterator;
+} UnitDependencyIterator;
+
+#define UNIT_DEPENDENCY_ITERATOR_FIRST                                  \
+        ((const UnitDependencyIterator) {                               \
+                .index = SIZE_MAX,                                      \
+                .hashmap_iterator = ITERATOR_FIRST,                     \
+        })
+
+size_t unit_dependency_list_size(const UnitDependencyList *l) _pure_;
+void* unit_dependency_list_get(const UnitDependencyList *l, const Unit *other) _pure_;
+bool unit_dependency_list_iterate(const UnitDependencyList *l, UnitDependencyIterator *i, Unit **ret_unit, UnitDependencyInfo *ret_info);
 
-static inline void* UNIT_DEPENDENCY_TO_PTR(UnitDependency d) {
-        return INT_TO_PTR(d);
-}
 
 #include "job.h"
 
@@ -225,10 +253,11 @@ typedef struct Unit {
 
         Set *aliases; /* All the other names. */
 
-        /* For each dependency type we can look up another Hashmap with this, whose key is a Unit* object,
-         * and whose value encodes why the dependency exists, using the UnitDependencyInfo type. i.e. a
-         * Hashmap(UnitDependency → Hashmap(Unit* → UnitDependencyInfo)) */
-        Hashmap *dependencies;
+        /* One entry for each dependency type the unit has dependencies of, sorted by type. Each lists the
+         * Unit* objects the dependency is on, and encodes why the dependency exists, using the
+         * UnitDependencyInfo type. */
+        UnitDependencyList *dependencies;
+        size_t n_dependencies;
 
         /* Similar, for RequiresMountsFor= and WantsMountsFor= path dependencies. The key is the path, the
          * value the UnitDependencyInfo type */
@@ -245,15 +274,20 @@ typedef struct Unit {
         char *fragment_path; /* if loaded from a config file this is the primary path to it */
         char *source_path; /* if converted, the source file */
         char **dropin_paths;
+        UnitDropinPrefetch *dropin_prefetch;
 
         usec_t fragment_not_found_timestamp_hash;
         usec_t fragment_mtime;
         usec_t source_mtime;
         usec_t dropin_mtime;
+        uint64_t dependency_dropins_hash; /* of the .wants/, .requires/ and .upholds/ drop-ins */
 
         /* If this is a transient unit we are currently writing, this is where we are writing it to */
         FILE *transient_file;
 
+        /* The serialized ExecContext and CGroupContext passed to systemd-executor, see exec_spawn() */
+        ExecSerializationCache *exec_serialization_cache;
+
         /* Freezer state */
         sd_bus_message *pending_freezer_invocation;
         FreezerState freezer_state;
@@ -278,6 +312,10 @@ typedef struct Unit {
         sd_bus_track *bus_track;
         char **deserialized_refs;
 
+        /* The digests of the property values included in the last PropertiesChanged signals, if only
+         * changed properties are included in them */
+        struct BusPropertiesDigest *dbus_property_digests;
+
         /* References to this */
         LIST_HEAD(UnitRef, refs_by_target);
 
@@ -438,6 +476,9 @@ typedef struct Unit {
         bool in_stop_when_bound_queue:1;
         bool in_release_resources_queue:1;
 
+        /* Whether the drop-ins of this unit were considered for prefetching while in the load queue */
+        bool load_prefetched:1;
+
         bool sent_dbus_new_signal:1;
 
         bool job_running_timeout_set:1;
@@ -777,8 +818,14 @@ Unit* unit_has_dependency(const Unit *u, UnitDependencyAtom atom, Unit *other);
 int unit_get_dependency_array(const Unit *u, UnitDependencyAtom atom, Unit ***ret_array);
 int unit_get_transitive_dependency_set(Unit *u, UnitDependencyAtom atom, Set **ret);
 
-static inline Hashmap* unit_get_dependencies(Unit *u, UnitDependency d) {
-        return hashmap_get(u->dependencies, UNIT_DEPENDENCY_TO_PTR(d));
+static inline UnitDependencyList* unit_get_dependencies(const Unit *u, UnitDependency d) {
+        FOREACH_ARRAY(l, u->dependencies, u->n_dependencies)
+                if (l->type == d)
+                        return l;
+                else if (l->type > d)
+                        break;
+
+        return NULL;
 }
 
 static inline Unit* UNIT_TRIGGER(Unit *u) {
@@ -1143,48 +1190,70 @@ typedef struct UnitForEachDependencyData {
         /* Stores state for the FOREACH macro below for iterating through all deps that have any of the
          * specified dependency atom bits set */
         UnitDependencyAtom match_atom;
-        Hashmap *by_type, *by_unit;
-        void *current_type;
-        Iterator by_type_iterator, by_unit_iterator;
+        const Unit *unit;
+        UnitDependency current_type;
+        bool unique;
+        UnitDependencyIterator iterator;
         Unit **current_unit;
 } UnitForEachDependencyData;
 
+static inline bool unit_foreach_dependency_next_type(UnitForEachDependencyData *data) {
+        assert(data);
+
+        /* If the atom is unique, we'll directly go to the right list, and are done after that */
+        if (data->current_type < 0) {
+                UnitDependency dt;
+
+                dt = unit_dependency_from_unique_atom(data->match_atom);
+                if (dt >= 0) {
+                        data->current_type = dt;
+                        data->unique = true;
+                        return true;
+                }
+        } else if (data->unique)
+                return false;
+
+        FOREACH_ARRAY(l, data->unit->dependencies, data->unit->n_dependencies)
+                if (l->type > data->current_type &&
+                    (unit_dependency_to_atom(l->type) & data->match_atom) != 0) {
+                        data->current_type = l->type;
+                        return true;
+                }
+
+        return false;
+}
+
 /* Iterates through all dependencies that have a specific atom in the dependency type set. This tries to be
  * smart: if the atom is unique, we'll directly go to right entry. Otherwise we'll iterate through the
- * per-dependency type hashmap and match all dep that have the right atom set. */
+ * per-dependency type lists and match all dep that have the right atom set.
+ *
+ * Note that the list is looked up by its type again for each entry, and the iterator tracks its position
+ * by type and index, rather than by pointer. Hence dependencies of other types may be added to the unit
+ * while iterating, even though that moves the lists around in memory. */
 #define _UNIT_FOREACH_DEPENDENCY(other, u, ma, data)                    \
         for (UnitForEachDependencyData data = {                         \
                         .match_atom = (ma),                             \
-                        .by_type = (u)->dependencies,                   \
-                        .by_type_iterator = ITERATOR_FIRST,             \
+                        .unit = (u),                                    \
+                        .current_type = _UNIT_DEPENDENCY_INVALID,       \
                         .current_unit = &(other),                       \
                 };                                                      \
-             ({                                                         \
-                     UnitDependency _dt = _UNIT_DEPENDENCY_INVALID;     \
-                     bool _found;                                       \
-                                                                        \
-                     if (data.by_type && ITERATOR_IS_FIRST(data.by_type_iterator)) { \
-                             _dt = unit_dependency_from_unique_atom(data.match_atom); \
-                             if (_dt >= 0) {                            \
-                                     data.by_unit = hashmap_get(data.by_type, UNIT_DEPENDENCY_TO_PTR(_dt)); \
-                                     data.current_type = UNIT_DEPENDENCY_TO_PTR(_dt); \
-                                     data.by_type = NULL;               \
-                                     _found = !!data.by_unit;           \
-                             }                                          \
-                     }                                                  \
-                     if (_dt < 0)                                       \
-                             _found = hashmap_iterate(data.by_type,     \
-                                                      &data.by_type_iterator, \
-                                                      (void**)&(data.by_unit), \
-                                                      (const void**) &(data.current_type)); \
-                     _found;                                            \
-             }); )                                                      \
-                if ((unit_dependency_to_atom(UNIT_DEPENDENCY_FROM_PTR(data.current_type)) & data.match_atom) != 0) \
-                        for (data.by_unit_iterator = ITERATOR_FIRST;    \
-                                hashmap_iterate(data.by_unit,           \
-                                                &data.by_unit_iterator, \
-                                                NULL,                   \
-                                                (const void**) data.current_unit); )
+             unit_foreach_dependency_next_type(&data); )                \
+                for (data.iterator = UNIT_DEPENDENCY_ITERATOR_FIRST;    \
+                     unit_dependency_list_iterate(                      \
+                                     unit_get_dependencies(data.unit, data.current_type), \
+                                     &data.iterator,                    \
+                                     data.current_unit,                 \
+                                     NULL); )
+
+/* Iterates through all dependencies of the specified type, with the same guarantees as above. It is also
+ * safe to remove the current entry while iterating. If info is not NULL, it is set to the
+ * UnitDependencyInfo of each dependency. */
+#define _UNIT_FOREACH_DEPENDENCY_OF_TYPE(other, info, u, d, i)          \
+        for (UnitDependencyIterator i = UNIT_DEPENDENCY_ITERATOR_FIRST; \
+             unit_dependency_list_iterate(unit_get_dependencies((u), (d)), &i, &(other), (info)); )
+
+#define UNIT_FOREACH_DEPENDENCY_OF_TYPE(other, info, u, d) \
+        _UNIT_FOREACH_DEPENDENCY_OF_TYPE(other, info, u, d, UNIQ_T(i, UNIQ))
 
 /* Note: this matches deps that have *any* of the atoms specified in match_atom set */
 #define UNIT_FOREACH_DEPENDENCY(other, u, match_atom) \
@@ -1,6 +1,7 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
 #include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <sys/prctl.h>
 #include <sys/statvfs.h>
@@ -30,6 +31,7 @@
 #include "fd-util.h"
 #include "fileio.h"
 #include "fs-util.h"
+#include "io-util.h"
 #include "iovec-util.h"
 #include "journal-importer.h"
 #include "journal-send.h"
@@ -160,6 +162,7 @@ static DEFINE_CONFIG_PARSE_ENUM(config_parse_coredump_storage, coredump_storage,
 
 static CoredumpStorage arg_storage = COREDUMP_STORAGE_EXTERNAL;
 static bool arg_compress = true;
+static unsigned arg_compress_threads = 1;
 static uint64_t arg_process_size_max = PROCESS_SIZE_MAX;
 static uint64_t arg_external_size_max = EXTERNAL_SIZE_MAX;
 static uint64_t arg_journal_size_max = JOURNAL_SIZE_MAX;
@@ -170,6 +173,7 @@ static int parse_config(void) {
         static const ConfigTableItem items[] = {
                 { "Coredump", "Storage",          config_parse_coredump_storage,     0, &arg_storage           },
                 { "Coredump", "Compress",         config_parse_bool,                 0, &arg_compress          },
+                { "Coredump", "CompressThreads",  config_parse_unsigned,             0, &arg_compress_threads  },
                 { "Coredump", "ProcessSizeMax",   config_parse_iec_uint64,           0, &arg_process_size_max  },
                 { "Coredump", "ExternalSizeMax",  config_parse_iec_uint64_infinity,  0, &arg_external_size_max },
                 { "Coredump", "JournalSizeMax",   config_parse_iec_size,             0, &arg_journal_size_max  },
@@ -407,6 +411,103 @@ static int grant_user_access(int core_fd, const Context *context) {
         return ret;
 }
 
+/* Read from the kernel's pipe in large chunks, and keep the file offset at page granularity for the
+ * uncompressed copy, so that zero pages line up with the holes we punch. */
+#define COREDUMP_BUFFER_SIZE (1024U*1024U)
+
+static int write_sparse(int fd, const uint8_t *p, size_t n) {
+        const uint8_t *e = p + n;
+        size_t ps = page_size();
+        int r;
+
+        assert(fd >= 0);
+        assert(p || n == 0);
+
+        /* Large parts of most coredumps are untouched, hence zero, memory. Seek over runs of zero pages
+         * instead of writing them, so that the file ends up sparse. */
+
+        while (p < e) {
+                const uint8_t *start = p;
+                bool zero = memeqzero(p, MIN(ps, (size_t) (e - p)));
+
+                do
+                        p += MIN(ps, (size_t) (e - p));
+                while (p < e && memeqzero(p, MIN(ps, (size_t) (e - p))) == zero);
+
+                if (zero) {
+                        if (lseek(fd, p - start, SEEK_CUR) < 0)
+                                return -errno;
+                } else {
+                        r = loop_write(fd, start, p - start);
+                        if (r < 0)
+                                return r;
+                }
+        }
+
+        return 0;
+}
+
+static int stream_coredump(int input_fd, int fd, int compress_fd, uint64_t max_size, uint64_t *ret_size) {
+        _cleanup_free_ uint8_t *buf = NULL;
+        uint64_t n = 0;
+        int r;
+
+        assert(input_fd >= 0);
+        assert(fd >= 0 || compress_fd >= 0);
+        assert(ret_size);
+
+        /* Reads the core once, and writes it both to the uncompressed file 'fd' (sparsely) and to the pipe
+         * of the compressor 'compress_fd', whichever of them are set. Returns 1 if 'max_size' was reached,
+         * like copy_bytes() does, 0 otherwise. */
+
+        buf = malloc(COREDUMP_BUFFER_SIZE);
+        if (!buf)
+                return -ENOMEM;
+
+        while (n < max_size) {
+                size_t m = MIN((uint64_t) COREDUMP_BUFFER_SIZE, max_size - n);
+                ssize_t k;
+
+                k = loop_read(input_fd, buf, m, /* do_poll= */ false);
+                if (k < 0)
+                        return (int) k;
+                if (k == 0)
+                        break;
+
+                if (fd >= 0) {
+                        r = write_sparse(fd, buf, k);
+                        if (r < 0)
+                                return r;
+                }
+
+                if (compress_fd >= 0) {
+                        r = loop_write(compress_fd, buf, k);
+                        if (r < 0)
+                                return r;
+                }
+
+                n += k;
+
+                if ((size_t) k < m) /* EOF */
+                        break;
+        }
+
+        /* Make sure a trailing run of zeroes, which we only seeked over, ends up in the file size */
+        if (fd >= 0) {
+                off_t p;
+
+                p = lseek(fd, 0, SEEK_CUR);
+                if (p < 0)
+                        return -errno;
+
+                if (ftruncate(fd, p) < 0)
+                        return -errno;
+        }
+
+        *ret_size = n;
+        return n >= max_size;
+}
+
 static int save_external_coredump(
                 const Context *context,
                 int input_fd,
@@ -518,23 +619,17 @@ static int save_external_coredump(
                 log_debug("Limiting core file size to %" PRIu64 " bytes due to cgroup memory limits.", max_size);
         }
 
-        r = copy_bytes(input_fd, fd, max_size, 0);
-        if (r < 0)
-                return log_error_errno(r, "Cannot store coredump of %s (%s): %m",
-                                context->meta[META_ARGV_PID], context->meta[META_COMM]);
-        truncated = r == 1;
-
-        bool allow_user = grant_user_access(fd, context) > 0;
+        /* The kernel fills the pipe only as fast as we drain it, hence make it large */
+        (void) fcntl(input_fd, F_SETPIPE_SZ, COREDUMP_BUFFER_SIZE);
 
 #if HAVE_COMPRESSION
         if (arg_compress) {
                 _cleanup_(unlink_and_freep) char *tmp_compressed = NULL;
                 _cleanup_free_ char *fn_compressed = NULL;
                 _cleanup_close_ int fd_compressed = -EBADF;
+                _cleanup_close_pair_ int pipefd[2] = EBADF_PAIR;
                 uint64_t uncompressed_size = 0;
-
-                if (lseek(fd, 0, SEEK_SET) < 0)
-                        return log_error_errno(errno, "Failed to seek on coredump %s: %m", fn);
+                pid_t pid;
 
                 fn_compressed = strjoin(fn, default_compression_extension());
                 if (!fn_compressed)
@@ -544,25 +639,69 @@ static int save_external_coredump(
                 if (fd_compressed < 0)
                         return log_error_errno(fd_compressed, "Failed to create temporary file for coredump %s: %m", fn_compressed);
 
-                r = compress_stream(fd, fd_compressed, max_size, &uncompressed_size);
+                /* Compress in a child fed through a pipe, while we write the uncompressed copy, so that
+                 * the core is read from the kernel only once, and compression doesn't wait for the whole
+                 * core to hit the disk first. */
+                if (pipe2(pipefd, O_CLOEXEC) < 0)
+                        return log_error_errno(errno, "Failed to allocate pipe for compressor: %m");
+
+                (void) fcntl(pipefd[1], F_SETPIPE_SZ, COREDUMP_BUFFER_SIZE);
+
+                r = safe_fork_full("(sd-compress)",
+                                   /* stdio_fds= */ NULL,
+                                   (int[]) { pipefd[0], fd_compressed }, 2,
+                                   FORK_RESET_SIGNALS|FORK_CLOSE_ALL_FDS|FORK_DEATHSIG_SIGTERM|FORK_REOPEN_LOG|FORK_LOG,
+                                   &pid);
                 if (r < 0)
-                        return log_error_errno(r, "Failed to compress %s: %m", coredump_tmpfile_name(tmp_compressed));
+                        return r;
+                if (r == 0) {
+                        r = compress_stream_full(pipefd[0], fd_compressed, UINT64_MAX, arg_compress_threads, NULL);
+                        if (r < 0) {
+                                log_error_errno(r, "Failed to compress %s: %m", coredump_tmpfile_name(tmp_compressed));
+                                _exit(EXIT_FAILURE);
+                        }
+
+                        _exit(EXIT_SUCCESS);
+                }
+
+                pipefd[0] = safe_close(pipefd[0]);
+
+                /* Don't get killed by SIGPIPE if the compressor dies on us, the error is reported below */
+                (void) ignore_signals(SIGPIPE);
+
+                r = stream_coredump(input_fd, fd, pipefd[1], max_size, &uncompressed_size);
+                if (r < 0)
+                        return log_error_errno(r, "Cannot store coredump of %s (%s): %m",
+                                               context->meta[META_ARGV_PID], context->meta[META_COMM]);
+                truncated = r == 1;
+
+                bool allow_user = grant_user_access(fd, context) > 0;
 
                 if (truncated && storage_on_tmpfs) {
                         uint64_t partial_uncompressed_size = 0;
 
                         /* Uncompressed write was truncated and we are writing to tmpfs: delete
-                         * the uncompressed core, and compress the remaining part from STDIN. */
+                         * the uncompressed core, and only compress the remaining part. */
 
                         tmp = unlink_and_free(tmp);
                         fd = safe_close(fd);
 
-                        r = compress_stream(input_fd, fd_compressed, max_size, &partial_uncompressed_size);
+                        r = stream_coredump(input_fd, -EBADF, pipefd[1], max_size, &partial_uncompressed_size);
                         if (r < 0)
-                                return log_error_errno(r, "Failed to compress %s: %m", coredump_tmpfile_name(tmp_compressed));
+                                return log_error_errno(r, "Cannot store coredump of %s (%s): %m",
+                                                       context->meta[META_ARGV_PID], context->meta[META_COMM]);
                         uncompressed_size += partial_uncompressed_size;
                 }
 
+                /* Signal EOF to the compressor */
+                pipefd[1] = safe_close(pipefd[1]);
+
+                r = wait_for_terminate_and_check("(sd-compress)", pid, 0);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to wait for compressor: %m");
+                if (r != EXIT_SUCCESS)
+                        return log_error_errno(SYNTHETIC_ERRNO(EPROTO), "Compressor failed.");
+
                 r = fix_permissions(fd_compressed, tmp_compressed, fn_compressed, context, allow_user);
                 if (r < 0)
                         return r;
@@ -584,6 +723,14 @@ static int save_external_coredump(
         }
 #endif
 
+        r = stream_coredump(input_fd, fd, /* compress_fd= */ -EBADF, max_size, &(uint64_t) { 0 });
+        if (r < 0)
+                return log_error_errno(r, "Cannot store coredump of %s (%s): %m",
+                                       context->meta[META_ARGV_PID], context->meta[META_COMM]);
+        truncated = r == 1;
+
+        bool allow_user = grant_user_access(fd, context) > 0;
+
         if (truncated)
                 log_struct(LOG_INFO,
                            LOG_MESSAGE("Core file was truncated to %"PRIu64" bytes.", max_size),
@@ -770,10 +917,22 @@ static int change_uid_gid(const Context *context) {
         return drop_privileges(uid, gid, 0);
 }
 
+static void release_coredump_input(int *input_fd) {
+        assert(input_fd);
+
+        /* The kernel keeps the crashed process around until it sees us closing the pipe, let it go as soon
+         * as we have the core, rather than after the slow parts, i.e. generating the stack trace. stdin is
+         * replaced by /dev/null rather than closed, so that the fd isn't reused by accident. */
+        if (*input_fd == STDIN_FILENO)
+                (void) rearrange_stdio(-EBADF, STDOUT_FILENO, STDERR_FILENO);
+        else
+                *input_fd = safe_close(*input_fd);
+}
+
 static int submit_coredump(
                 const Context *context,
                 struct iovec_wrapper *iovw,
-                int input_fd) {
+                int *input_fd) {
 
         _cleanup_(sd_json_variant_unrefp) sd_json_variant *json_metadata = NULL;
         _cleanup_close_ int coredump_fd = -EBADF, coredump_node_fd = -EBADF;
@@ -787,16 +946,19 @@ static int submit_coredump(
 
         assert(context);
         assert(iovw);
-        assert(input_fd >= 0);
+        assert(input_fd);
+        assert(*input_fd >= 0);
 
         /* Vacuum before we write anything again */
         (void) coredump_vacuum(-1, arg_keep_free, arg_max_use);
 
         /* Always stream the coredump to disk, if that's possible */
         written = save_external_coredump(
-                        context, input_fd,
+                        context, *input_fd,
                         &filename, &coredump_node_fd, &coredump_fd,
                         &coredump_size, &coredump_compressed_size, &truncated) >= 0;
+
+        release_coredump_input(input_fd);
         if (written) {
                 /* If we could write it to disk we can now process it. */
                 /* If we don't want to keep the coredump on disk, remove it now, as later on we
@@ -1086,7 +1248,7 @@ static int process_socket(int fd) {
                         goto finish;
                 }
 
-        r = submit_coredump(&context, &iovw, input_fd);
+        r = submit_coredump(&context, &iovw, &input_fd);
 
 finish:
         iovw_free_contents(&iovw, true);
@@ -1620,7 +1782,7 @@ static int process_kernel(int argc, char* argv[]) {
         (void) iovw_put_string_field(iovw, "PRIORITY=", STRINGIFY(LOG_CRIT));
 
         if (context.is_journald || context.is_pid1)
-                return submit_coredump(&context, iovw, STDIN_FILENO);
+                return submit_coredump(&context, iovw, &(int) { STDIN_FILENO });
 
         return send_iovec(iovw, STDIN_FILENO);
 }
@@ -472,7 +472,7 @@ static int verb_cat(int argc, char **argv, void *userdata) {
                                                 arg_tpm2_signature,
                                                 uid_is_valid(arg_uid) ? arg_uid : getuid(),
                                                 &IOVEC_MAKE(data, size),
-                                                CREDENTIAL_ANY_SCOPE,
+                                                CREDENTIAL_ANY_SCOPE|CREDENTIAL_TPM2_CACHE,
                                                 &plaintext);
                         if (r < 0)
                                 return r;
@@ -1300,7 +1300,9 @@ static int vl_method_decrypt(Varlink *link, sd_json_variant *parameters, Varlink
         bool timestamp_fresh, any_scope_after_polkit = false;
         _cleanup_(iovec_done_erase) struct iovec output = {};
         Hashmap **polkit_registry = ASSERT_PTR(userdata);
-        CredentialFlags cflags = 0;
+        /* Every connection is served by a process of its own, hence keep the TPM2 context around for
+         * further calls on the same connection */
+        CredentialFlags cflags = CREDENTIAL_TPM2_CACHE;
         uid_t peer_uid;
         int r;
 
@@ -1054,6 +1054,14 @@ static int parse_fstab(bool prefix_sysroot) {
         else {
                 fstab = fstab_path();
                 assert(!arg_sysroot_check);
+
+                /* Everything else we look at on the host is fixed at boot, hence our output can be reused
+                 * for as long as the fstab is not changed */
+                if (!in_initrd()) {
+                        r = generator_declare_input(fstab);
+                        if (r < 0)
+                                log_debug_errno(r, "Failed to declare %s as input, ignoring: %m", fstab);
+                }
         }
 
         log_debug("Parsing %s...", fstab);
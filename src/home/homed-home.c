@@ -190,6 +190,15 @@ int home_new(Manager *m, UserRecord *hr, const char *sysfs, Home **ret) {
         return 0;
 }
 
+static void home_flush_augmented(Home *h) {
+        assert(h);
+
+        h->augmented_status = sd_json_variant_unref(h->augmented_status);
+        FOREACH_ARRAY(a, h->augmented, ELEMENTSOF(h->augmented))
+                *a = user_record_unref(*a);
+        h->group_record = group_record_unref(h->group_record);
+}
+
 Home *home_free(Home *h) {
 
         if (!h)
@@ -219,6 +228,7 @@ Home *home_free(Home *h) {
 
         user_record_unref(h->record);
         user_record_unref(h->secret);
+        home_flush_augmented(h);
 
         h->worker_event_source = sd_event_source_disable_unref(h->worker_event_source);
         safe_close(h->worker_stdout_fd);
@@ -301,6 +311,8 @@ int home_set_record(Home *h, UserRecord *hr) {
         h->record = user_record_ref(hr);
         h->uid = h->record->uid;
 
+        home_flush_augmented(h);
+
         /* The updated record might have a different autologin setting, trigger a PropertiesChanged event for it */
         (void) bus_manager_emit_auto_login_changed(h->manager);
         (void) bus_home_emit_change(h);
@@ -2619,6 +2631,7 @@ int home_augment_status(
         mode_t access_mode;
         HomeState state;
         sd_id128_t id;
+        size_t slot;
         int r;
 
         assert(h);
@@ -2671,6 +2684,22 @@ int home_augment_status(
         if (r < 0)
                 return r;
 
+        /* If the status didn't change since the last time we were called, then the augmented record
+         * won't either, hence return the one we built back then. */
+        slot = FLAGS_SET(flags, USER_RECORD_ALLOW_PRIVILEGED);
+        if (sd_json_variant_equal(h->augmented_status, status)) {
+                if (h->augmented[slot] && h->augmented_flags[slot] == flags) {
+                        *ret = user_record_ref(h->augmented[slot]);
+                        return 0;
+                }
+        } else {
+                FOREACH_ARRAY(a, h->augmented, ELEMENTSOF(h->augmented))
+                        *a = user_record_unref(*a);
+
+                sd_json_variant_unref(h->augmented_status);
+                h->augmented_status = sd_json_variant_ref(status);
+        }
+
         j = sd_json_variant_ref(h->record->json);
         v = sd_json_variant_ref(sd_json_variant_by_key(j, "status"));
         m = sd_json_variant_ref(sd_json_variant_by_key(v, SD_ID128_TO_STRING(id)));
@@ -2703,10 +2732,40 @@ int home_augment_status(
                 FLAGS_SET(h->record->mask, USER_RECORD_PRIVILEGED) &&
                 !FLAGS_SET(ur->mask, USER_RECORD_PRIVILEGED);
 
+        user_record_unref(h->augmented[slot]);
+        h->augmented[slot] = user_record_ref(ur);
+        h->augmented_flags[slot] = flags;
+
         *ret = TAKE_PTR(ur);
         return 0;
 }
 
+int home_get_group_record(Home *h, GroupRecord **ret) {
+        _cleanup_(group_record_unrefp) GroupRecord *g = NULL;
+        int r;
+
+        assert(h);
+        assert(ret);
+
+        /* The group record only depends on the user record, hence we can keep it around until the latter
+         * changes. */
+
+        if (!h->group_record) {
+                g = group_record_new();
+                if (!g)
+                        return -ENOMEM;
+
+                r = group_record_synthesize(g, h->record);
+                if (r < 0)
+                        return r;
+
+                h->group_record = TAKE_PTR(g);
+        }
+
+        *ret = group_record_ref(h->group_record);
+        return 0;
+}
+
 static int on_home_ref_eof(sd_event_source *s, int fd, uint32_t revents, void *userdata) {
         _cleanup_(operation_unrefp) Operation *o = NULL;
         Home *h = ASSERT_PTR(userdata);
@@ -3,6 +3,7 @@
 
 typedef struct Home Home;
 
+#include "group-record.h"
 #include "hashmap.h"
 #include "homed-manager.h"
 #include "homed-operation.h"
@@ -174,6 +175,15 @@ struct Home {
 
         /* Whether a rebalance operation is pending */
         bool rebalance_pending;
+
+        /* The status object home_augment_status() generated last, and the augmented records it built from
+         * it, one for privileged and one for unprivileged clients. These are reused as long as neither the
+         * record nor the status change, so that repeated lookups don't have to validate the whole record
+         * again each time. Similar, the group record we synthesize from the user record. */
+        sd_json_variant *augmented_status;
+        UserRecord *augmented[2];
+        UserRecordLoadFlags augmented_flags[2];
+        GroupRecord *group_record;
 };
 
 int home_new(Manager *m, UserRecord *hr, const char *sysfs, Home **ret);
@@ -217,6 +227,7 @@ void home_process_notify(Home *h, char **l, int fd);
 int home_killall(Home *h);
 
 int home_augment_status(Home *h, UserRecordLoadFlags flags, UserRecord **ret);
+int home_get_group_record(Home *h, GroupRecord **ret);
 
 int home_create_fifo(Home *h, bool please_suspend);
 int home_schedule_operation(Home *h, Operation *o, sd_bus_error *error);
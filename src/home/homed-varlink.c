@@ -156,11 +156,7 @@ static int build_group_json(Home *h, sd_json_variant **ret) {
         assert(h);
         assert(ret);
 
-        g = group_record_new();
-        if (!g)
-                return -ENOMEM;
-
-        r = group_record_synthesize(g, h->record);
+        r = home_get_group_record(h, &g);
         if (r < 0)
                 return r;
 
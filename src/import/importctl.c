@@ -12,6 +12,7 @@
 #include "discover-image.h"
 #include "fd-util.h"
 #include "format-table.h"
+#include "format-util.h"
 #include "hostname-util.h"
 #include "import-common.h"
 #include "import-util.h"
@@ -787,22 +788,23 @@ static int list_transfers(int argc, char *argv[], void *userdata) {
         if (r < 0)
                 return bus_log_parse_error(r);
 
-        t = table_new("id", "progress", "type", "class", "local", "remote");
+        t = table_new("id", "progress", "rate", "type", "class", "local", "remote");
         if (!t)
                 return log_oom();
 
-        (void) table_set_sort(t, (size_t) 4, (size_t) 0);
+        (void) table_set_sort(t, (size_t) 5, (size_t) 0);
         table_set_ersatz_string(t, TABLE_ERSATZ_DASH);
 
         for (;;) {
-                const char *type, *remote, *local, *class = "machine";
+                const char *type, *remote, *local, *class = "machine", *object;
+                uint64_t rate = UINT64_MAX;
                 double progress;
                 uint32_t id;
 
                 if (ex)
-                        r = sd_bus_message_read(reply, "(ussssdo)", &id, &type, &remote, &local, &class, &progress, NULL);
+                        r = sd_bus_message_read(reply, "(ussssdo)", &id, &type, &remote, &local, &class, &progress, &object);
                 else
-                        r = sd_bus_message_read(reply, "(usssdo)", &id, &type, &remote, &local, &progress, NULL);
+                        r = sd_bus_message_read(reply, "(usssdo)", &id, &type, &remote, &local, &progress, &object);
                 if (r < 0)
                         return bus_log_parse_error(r);
                 if (r == 0)
@@ -831,6 +833,24 @@ static int list_transfers(int argc, char *argv[], void *userdata) {
                                         TABLE_SET_ALIGN_PERCENT, 100);
                 if (r < 0)
                         return table_log_add_error(r);
+
+                /* Older versions don't know the rate, leave the column empty then */
+                (void) sd_bus_get_property_trivial(
+                                bus,
+                                bus_import_mgr->destination,
+                                object,
+                                "org.freedesktop.import1.Transfer",
+                                "Rate",
+                                /* error= */ NULL,
+                                't', &rate);
+
+                if (rate == UINT64_MAX)
+                        r = table_add_cell(t, NULL, TABLE_EMPTY, NULL);
+                else
+                        r = table_add_cell(t, NULL, TABLE_STRING, strjoina(FORMAT_BYTES(rate), "/s"));
+                if (r < 0)
+                        return table_log_add_error(r);
+
                 r = table_add_many(
                                 t,
                                 TABLE_STRING, type,
@@ -87,6 +87,7 @@ struct Transfer {
         unsigned n_canceled;
         unsigned progress_percent;
         unsigned progress_percent_sent;
+        uint64_t bytes_per_sec; /* UINT64_MAX if not known */
 
         int stdin_fd;
         int stdout_fd;
@@ -179,6 +180,7 @@ static int transfer_new(Manager *m, Transfer **ret) {
                 .verify = _IMPORT_VERIFY_INVALID,
                 .progress_percent = UINT_MAX,
                 .progress_percent_sent = UINT_MAX,
+                .bytes_per_sec = UINT64_MAX,
         };
 
         id = m->current_transfer_id + 1;
@@ -684,6 +686,17 @@ static int manager_on_notify(sd_event_source *s, int fd, uint32_t revents, void
 
         buf[n] = 0;
 
+        /* The download rate is sent along with the progress, while there is one */
+        uint64_t bytes_per_sec = UINT64_MAX;
+        p = find_line_startswith(buf, "X_IMPORT_RATE=");
+        if (p) {
+                r = safe_atou64(strndupa_safe(p, strcspn(p, NEWLINE)), &bytes_per_sec);
+                if (r < 0) {
+                        log_warning_errno(r, "Got invalid rate value, ignoring: %m");
+                        bytes_per_sec = UINT64_MAX;
+                }
+        }
+
         p = find_line_startswith(buf, "X_IMPORT_PROGRESS=");
         if (!p)
                 return 0;
@@ -697,6 +710,7 @@ static int manager_on_notify(sd_event_source *s, int fd, uint32_t revents, void
         }
 
         t->progress_percent = (unsigned) r;
+        t->bytes_per_sec = bytes_per_sec;
 
         log_debug("Got percentage from client: %u%%", t->progress_percent);
 
@@ -1503,6 +1517,7 @@ static const sd_bus_vtable transfer_vtable[] = {
         SD_BUS_PROPERTY("Type", "s", property_get_type, offsetof(Transfer, type), SD_BUS_VTABLE_PROPERTY_CONST),
         SD_BUS_PROPERTY("Verify", "s", property_get_verify, offsetof(Transfer, verify), SD_BUS_VTABLE_PROPERTY_CONST),
         SD_BUS_PROPERTY("Progress", "d", property_get_progress, 0, 0),
+        SD_BUS_PROPERTY("Rate", "t", NULL, offsetof(Transfer, bytes_per_sec), 0),
 
         SD_BUS_METHOD("Cancel", NULL, NULL, method_cancel, SD_BUS_VTABLE_UNPRIVILEGED),
 
@@ -1779,7 +1794,8 @@ static int make_transfer_json(Transfer *t, sd_json_variant **ret) {
                            SD_JSON_BUILD_PAIR("remote", SD_JSON_BUILD_STRING(t->remote)),
                            SD_JSON_BUILD_PAIR("local", SD_JSON_BUILD_STRING(t->local)),
                            SD_JSON_BUILD_PAIR("class", JSON_BUILD_STRING_UNDERSCORIFY(image_class_to_string(t->class))),
-                           SD_JSON_BUILD_PAIR("percent", SD_JSON_BUILD_REAL(transfer_percent_as_double(t))));
+                           SD_JSON_BUILD_PAIR("percent", SD_JSON_BUILD_REAL(transfer_percent_as_double(t))),
+                           SD_JSON_BUILD_PAIR_CONDITION(t->bytes_per_sec != UINT64_MAX, "rate", SD_JSON_BUILD_UNSIGNED(t->bytes_per_sec)));
         if (r < 0)
                 return log_error_errno(r, "Failed to build transfer JSON data: %m");
 
@@ -0,0 +1,293 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <unistd.h>
+
+#include "alloc-util.h"
+#include "extract-word.h"
+#include "hexdecoct.h"
+#include "io-util.h"
+#include "parse-util.h"
+#include "pull-delta.h"
+#include "sort-util.h"
+#include "string-util.h"
+#include "strv.h"
+
+#define CHUNK_SIZE_MIN (4U*1024U)
+#define CHUNK_SIZE_MAX (64U*1024U*1024U)
+
+#define DELTA_BUFFER_SIZE (256U*1024U)
+
+typedef struct BaseChunk {
+        uint8_t digest[SHA256_DIGEST_SIZE];
+        uint64_t offset;
+} BaseChunk;
+
+void chunk_index_done(ChunkIndex *x) {
+        assert(x);
+
+        x->chunks = mfree(x->chunks);
+        x->n_chunks = 0;
+}
+
+int chunk_index_parse(const void *data, size_t size, ChunkIndex *ret) {
+        _cleanup_(chunk_index_done) ChunkIndex x = {};
+        _cleanup_strv_free_ char **l = NULL;
+        _cleanup_free_ char *s = NULL;
+        size_t n_expected = 0;
+        bool have_header = false;
+        int r;
+
+        assert(data || size == 0);
+        assert(ret);
+
+        /* The format is line based: a header line with the total size of the file and the chunk size, both
+         * in bytes, followed by one line per chunk with its SHA256 sum in hexadecimal. Empty lines and lines
+         * starting with '#' are ignored. */
+
+        s = memdup_suffix0(data, size);
+        if (!s)
+                return -ENOMEM;
+        if (strlen(s) != size)
+                return -EBADMSG;
+
+        l = strv_split_newlines(s);
+        if (!l)
+                return -ENOMEM;
+
+        STRV_FOREACH(line, l) {
+                const char *p = strstrip(*line);
+
+                if (isempty(p) || *p == '#')
+                        continue;
+
+                if (!have_header) {
+                        _cleanup_free_ char *a = NULL, *b = NULL;
+
+                        r = extract_many_words(&p, NULL, 0, &a, &b);
+                        if (r < 0)
+                                return r;
+                        if (r != 2 || !isempty(p))
+                                return -EBADMSG;
+
+                        if (safe_atou64(a, &x.size) < 0 || !FILE_SIZE_VALID(x.size))
+                                return -EBADMSG;
+                        if (safe_atou64(b, &x.chunk_size) < 0 ||
+                            x.chunk_size < CHUNK_SIZE_MIN || x.chunk_size > CHUNK_SIZE_MAX)
+                                return -EBADMSG;
+
+                        /* Every chunk takes up a line of its own, refuse headers that promise more than
+                         * we could possibly have been sent, before allocating anything */
+                        n_expected = DIV_ROUND_UP(x.size, x.chunk_size);
+                        if (n_expected > size / (SHA256_DIGEST_SIZE * 2))
+                                return -EBADMSG;
+
+                        if (n_expected > 0) {
+                                x.chunks = malloc_multiply(n_expected, SHA256_DIGEST_SIZE);
+                                if (!x.chunks)
+                                        return -ENOMEM;
+                        }
+
+                        have_header = true;
+                        continue;
+                }
+
+                if (x.n_chunks >= n_expected)
+                        return -EBADMSG;
+
+                if (parse_sha256(p, x.chunks[x.n_chunks]) < 0)
+                        return -EBADMSG;
+
+                x.n_chunks++;
+        }
+
+        if (!have_header || x.n_chunks != n_expected)
+                return -EBADMSG;
+
+        *ret = TAKE_STRUCT(x);
+        return 0;
+}
+
+static int pread_full(int fd, void *buf, size_t n, uint64_t offset) {
+        uint8_t *p = ASSERT_PTR(buf);
+
+        while (n > 0) {
+                ssize_t k;
+
+                k = pread(fd, p, n, offset);
+                if (k < 0) {
+                        if (errno == EINTR)
+                                continue;
+
+                        return -errno;
+                }
+                if (k == 0)
+                        return -EIO;
+
+                p += k;
+                n -= k;
+                offset += k;
+        }
+
+        return 0;
+}
+
+static int pwrite_full(int fd, const void *buf, size_t n, uint64_t offset) {
+        const uint8_t *p = ASSERT_PTR(buf);
+
+        while (n > 0) {
+                ssize_t k;
+
+                k = pwrite(fd, p, n, offset);
+                if (k < 0) {
+                        if (errno == EINTR)
+                                continue;
+
+                        return -errno;
+                }
+                if (k == 0)
+                        return -EIO;
+
+                p += k;
+                n -= k;
+                offset += k;
+        }
+
+        return 0;
+}
+
+static int base_chunk_compare(const BaseChunk *a, const BaseChunk *b) {
+        return memcmp(a->digest, b->digest, sizeof(a->digest));
+}
+
+int chunk_index_apply(
+                const ChunkIndex *x,
+                int base_fd,
+                uint64_t base_offset,
+                uint64_t base_size,
+                int target_fd,
+                uint64_t target_offset,
+                DeltaRange **ret_missing,
+                size_t *ret_n_missing,
+                uint64_t *ret_reused) {
+
+        _cleanup_free_ DeltaRange *missing = NULL;
+        _cleanup_free_ BaseChunk *base = NULL;
+        _cleanup_free_ uint8_t *buf = NULL;
+        size_t n_base = 0, n_missing = 0;
+        uint64_t reused = 0;
+        int r;
+
+        assert(x);
+        assert(base_fd >= 0);
+        assert(target_fd >= 0);
+        assert(ret_missing);
+        assert(ret_n_missing);
+
+        /* Writes all chunks of the file described by the index that are found in the base to the target,
+         * and returns the ranges of the file that still need to be acquired some other way, relative to the
+         * beginning of the file. Chunks are only looked for at the same alignment in the base, which keeps
+         * this cheap, and is good enough for images that are updated in place rather than rebuilt. */
+
+        buf = malloc(x->chunk_size);
+        if (!buf)
+                return -ENOMEM;
+
+        for (uint64_t o = 0; o < base_size; o += x->chunk_size) {
+                size_t n = MIN(x->chunk_size, base_size - o);
+
+                r = pread_full(base_fd, buf, n, base_offset + o);
+                if (r < 0)
+                        return r;
+
+                if (!GREEDY_REALLOC(base, n_base + 1))
+                        return -ENOMEM;
+
+                base[n_base].offset = base_offset + o;
+                sha256_direct(buf, n, base[n_base].digest);
+                n_base++;
+        }
+
+        typesafe_qsort(base, n_base, base_chunk_compare);
+
+        for (size_t i = 0; i < x->n_chunks; i++) {
+                uint64_t o = i * x->chunk_size;
+                size_t n = MIN(x->chunk_size, x->size - o);
+                BaseChunk key = {}, *found;
+
+                memcpy(key.digest, x->chunks[i], SHA256_DIGEST_SIZE);
+
+                /* Identical digests imply identical sizes, hence this never reads beyond the end of the
+                 * chunk we hashed above */
+                found = typesafe_bsearch(&key, base, n_base, base_chunk_compare);
+                if (found) {
+                        r = pread_full(base_fd, buf, n, found->offset);
+                        if (r < 0)
+                                return r;
+
+                        r = pwrite_full(target_fd, buf, n, target_offset + o);
+                        if (r < 0)
+                                return r;
+
+                        reused += n;
+                        continue;
+                }
+
+                /* Merge adjacent missing chunks, so that they can be acquired in one go */
+                if (n_missing > 0 && missing[n_missing-1].offset + missing[n_missing-1].size == o) {
+                        missing[n_missing-1].size += n;
+                        continue;
+                }
+
+                if (!GREEDY_REALLOC(missing, n_missing + 1))
+                        return -ENOMEM;
+
+                missing[n_missing++] = (DeltaRange) {
+                        .offset = o,
+                        .size = n,
+                };
+        }
+
+        *ret_missing = TAKE_PTR(missing);
+        *ret_n_missing = n_missing;
+        if (ret_reused)
+                *ret_reused = reused;
+
+        return 0;
+}
+
+int delta_sha256(int fd, uint64_t offset, uint64_t size, char **ret) {
+        _cleanup_free_ uint8_t *buf = NULL;
+        uint8_t digest[SHA256_DIGEST_SIZE];
+        struct sha256_ctx ctx;
+        char *h;
+        int r;
+
+        assert(fd >= 0);
+        assert(ret);
+
+        buf = malloc(DELTA_BUFFER_SIZE);
+        if (!buf)
+                return -ENOMEM;
+
+        sha256_init_ctx(&ctx);
+
+        for (uint64_t o = 0; o < size;) {
+                size_t n = MIN(size - o, (uint64_t) DELTA_BUFFER_SIZE);
+
+                r = pread_full(fd, buf, n, offset + o);
+                if (r < 0)
+                        return r;
+
+                sha256_process_bytes(buf, n, &ctx);
+                o += n;
+        }
+
+        sha256_finish_ctx(&ctx, digest);
+
+        h = hexmem(digest, sizeof(digest));
+        if (!h)
+                return -ENOMEM;
+
+        *ret = h;
+        return 0;
+}
@@ -0,0 +1,42 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+#pragma once
+
+#include <inttypes.h>
+#include <sys/types.h>
+
+#include "sha256.h"
+
+/* A chunk index describes a file as a series of fixed size chunks, each identified by its SHA256 sum. It is
+ * published next to the file itself, with a ".chunks" suffix appended, and allows us to download only the
+ * chunks we don't already have in some older version of the file. */
+
+#define CHUNK_INDEX_SUFFIX ".chunks"
+
+typedef struct ChunkIndex {
+        uint64_t size;
+        uint64_t chunk_size;
+        uint8_t (*chunks)[SHA256_DIGEST_SIZE];
+        size_t n_chunks;
+} ChunkIndex;
+
+typedef struct DeltaRange {
+        uint64_t offset;
+        uint64_t size;
+} DeltaRange;
+
+void chunk_index_done(ChunkIndex *x);
+
+int chunk_index_parse(const void *data, size_t size, ChunkIndex *ret);
+
+int chunk_index_apply(
+                const ChunkIndex *x,
+                int base_fd,
+                uint64_t base_offset,
+                uint64_t base_size,
+                int target_fd,
+                uint64_t target_offset,
+                DeltaRange **ret_missing,
+                size_t *ret_n_missing,
+                uint64_t *ret_reused);
+
+int delta_sha256(int fd, uint64_t offset, uint64_t size, char **ret);
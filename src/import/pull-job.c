@@ -13,13 +13,29 @@
 #include "io-util.h"
 #include "machine-pool.h"
 #include "parse-util.h"
+#include "process-util.h"
 #include "pull-common.h"
 #include "pull-job.h"
+#include "stdio-util.h"
 #include "string-util.h"
 #include "strv.h"
 #include "sync-util.h"
 #include "xattr-util.h"
 
+/* The capacity of the pipe to the decompressor, i.e. how far the download may run ahead of it */
+#define PULL_JOB_DECOMPRESS_PIPE_SIZE (1024U*1024U)
+
+static void pull_job_kill_decompressor(PullJob *j) {
+        assert(j);
+
+        j->decompress_fd = safe_close(j->decompress_fd);
+
+        if (j->decompress_pid > 0) {
+                sigkill_wait(j->decompress_pid);
+                j->decompress_pid = 0;
+        }
+}
+
 void pull_job_close_disk_fd(PullJob *j) {
         if (!j)
                 return;
@@ -34,6 +50,7 @@ PullJob* pull_job_unref(PullJob *j) {
         if (!j)
                 return NULL;
 
+        pull_job_kill_decompressor(j);
         pull_job_close_disk_fd(j);
 
         curl_glue_remove_and_free(j->glue, j->curl);
@@ -70,6 +87,8 @@ static void pull_job_finish(PullJob *j, int ret) {
         } else {
                 j->state = PULL_JOB_FAILED;
                 j->error = ret;
+
+                pull_job_kill_decompressor(j);
         }
 
         if (j->on_finished)
@@ -97,6 +116,9 @@ static int pull_job_restart(PullJob *j, const char *new_url) {
         j->etag_exists = false;
         j->mtime = 0;
         j->checksum = mfree(j->checksum);
+        j->bytes_per_sec = UINT64_MAX;
+
+        pull_job_kill_decompressor(j);
 
         curl_glue_remove_and_free(j->glue, j->curl);
         j->curl = NULL;
@@ -122,6 +144,33 @@ static int pull_job_restart(PullJob *j, const char *new_url) {
         return 0;
 }
 
+static int pull_job_finish_decompressor(PullJob *j) {
+        off_t p;
+        int r;
+
+        assert(j);
+
+        if (j->decompress_pid <= 0)
+                return 0;
+
+        /* Tell the decompressor that this was all */
+        j->decompress_fd = safe_close(j->decompress_fd);
+
+        r = wait_for_terminate_and_check("(sd-decompress)", TAKE_PID(j->decompress_pid), WAIT_LOG);
+        if (r < 0)
+                return r;
+        if (r != EXIT_SUCCESS)
+                return log_error_errno(SYNTHETIC_ERRNO(EPROTO), "Failed to decompress %s.", j->url);
+
+        /* The decompressor wrote through the same file description, hence moved our file offset along */
+        p = lseek(j->disk_fd, 0, SEEK_CUR);
+        if (p < 0)
+                return log_error_errno(errno, "Failed to determine amount of data written: %m");
+
+        j->written_uncompressed = (uint64_t) p - (j->offset == UINT64_MAX ? 0 : j->offset);
+        return 0;
+}
+
 void pull_job_curl_on_finished(CurlGlue *g, CURL *curl, CURLcode result) {
         PullJob *j = NULL;
         char *scheme = NULL;
@@ -194,6 +243,9 @@ void pull_job_curl_on_finished(CurlGlue *g, CURL *curl, CURLcode result) {
                 } else if (status < 200) {
                         r = log_error_errno(SYNTHETIC_ERRNO(EIO), "HTTP request to %s finished with unexpected code %li.", j->url, status);
                         goto finish;
+                } else if (j->range_offset != UINT64_MAX && status != 206) {
+                        r = log_notice_errno(SYNTHETIC_ERRNO(EOPNOTSUPP), "Server of %s does not support range requests.", j->url);
+                        goto finish;
                 }
         }
 
@@ -208,6 +260,10 @@ void pull_job_curl_on_finished(CurlGlue *g, CURL *curl, CURLcode result) {
                 goto finish;
         }
 
+        r = pull_job_finish_decompressor(j);
+        if (r < 0)
+                goto finish;
+
         if (j->checksum_ctx) {
                 unsigned checksum_len;
 #if PREFER_OPENSSL
@@ -390,9 +446,15 @@ static int pull_job_write_compressed(PullJob *j, void *p, size_t sz) {
 #endif
         }
 
-        r = import_uncompress(&j->compress, p, sz, pull_job_write_uncompressed, j);
-        if (r < 0)
-                return r;
+        if (j->decompress_fd >= 0) {
+                r = loop_write(j->decompress_fd, p, sz);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to pass data to decompressor: %m");
+        } else {
+                r = import_uncompress(&j->compress, p, sz, pull_job_write_uncompressed, j);
+                if (r < 0)
+                        return r;
+        }
 
         j->written_compressed += sz;
 
@@ -444,6 +506,67 @@ static int pull_job_open_disk(PullJob *j) {
         return 0;
 }
 
+static int pull_job_decompress(PullJob *j, int fd) {
+        _cleanup_free_ uint8_t *buf = NULL;
+        int r;
+
+        assert(j);
+        assert(fd >= 0);
+
+        /* Runs in the decompressor child, until the parent closes the pipe */
+
+        buf = malloc(PULL_JOB_DECOMPRESS_PIPE_SIZE);
+        if (!buf)
+                return log_oom();
+
+        for (;;) {
+                ssize_t n;
+
+                n = read(fd, buf, PULL_JOB_DECOMPRESS_PIPE_SIZE);
+                if (n < 0) {
+                        if (errno == EINTR)
+                                continue;
+
+                        return log_error_errno(errno, "Failed to read compressed data: %m");
+                }
+                if (n == 0)
+                        return 0;
+
+                r = import_uncompress(&j->compress, buf, n, pull_job_write_uncompressed, j);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to decompress %s: %m", j->url);
+        }
+}
+
+static int pull_job_start_decompressor(PullJob *j) {
+        _cleanup_close_pair_ int pipefd[2] = EBADF_PAIR;
+        int r;
+
+        assert(j);
+        assert(j->disk_fd >= 0);
+
+        if (pipe2(pipefd, O_CLOEXEC) < 0)
+                return log_error_errno(errno, "Failed to allocate pipe for decompressor: %m");
+
+        (void) fcntl(pipefd[1], F_SETPIPE_SZ, PULL_JOB_DECOMPRESS_PIPE_SIZE);
+
+        r = safe_fork_full("(sd-decompress)",
+                           /* stdio_fds= */ NULL,
+                           (int[]) { pipefd[0], j->disk_fd }, 2,
+                           FORK_RESET_SIGNALS|FORK_CLOSE_ALL_FDS|FORK_DEATHSIG_SIGTERM|FORK_LOG,
+                           &j->decompress_pid);
+        if (r < 0)
+                return r;
+        if (r == 0) {
+                /* Child */
+                r = pull_job_decompress(j, pipefd[0]);
+                _exit(r < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+        }
+
+        j->decompress_fd = TAKE_FD(pipefd[1]);
+        return 0;
+}
+
 static int pull_job_detect_compression(PullJob *j) {
         _cleanup_free_ uint8_t *stub = NULL;
         size_t stub_size;
@@ -452,6 +575,10 @@ static int pull_job_detect_compression(PullJob *j) {
 
         assert(j);
 
+        /* A part of a resource cannot be decompressed by itself, hence take it as it is */
+        if (j->range_offset != UINT64_MAX)
+                import_uncompress_force_off(&j->compress);
+
         r = import_uncompress_detect(&j->compress, j->payload, j->payload_size);
         if (r < 0)
                 return log_error_errno(r, "Failed to initialize compressor: %m");
@@ -464,6 +591,15 @@ static int pull_job_detect_compression(PullJob *j) {
         if (r < 0)
                 return r;
 
+        /* The size written is determined from the file offset afterwards, which needs something seekable */
+        if (j->compress.type != IMPORT_COMPRESS_UNCOMPRESSED &&
+            j->disk_fd >= 0 && !j->force_memory &&
+            (S_ISREG(j->disk_stat.st_mode) || S_ISBLK(j->disk_stat.st_mode))) {
+                r = pull_job_start_decompressor(j);
+                if (r < 0)
+                        return r;
+        }
+
         /* Now, take the payload we read so far, and decompress it */
         stub = j->payload;
         stub_size = j->payload_size;
@@ -653,11 +789,13 @@ static int pull_job_progress_callback(void *userdata, curl_off_t dltotal, curl_o
                         done = n - j->start_usec;
                         left = (usec_t) (((double) done * (double) dltotal) / dlnow) - done;
 
+                        j->bytes_per_sec = (uint64_t) ((double) dlnow / ((double) done / (double) USEC_PER_SEC));
+
                         log_info("Got %u%% of %s. %s left at %s/s.",
                                  percent,
                                  j->url,
                                  FORMAT_TIMESPAN(left, USEC_PER_SEC),
-                                 FORMAT_BYTES((uint64_t) ((double) dlnow / ((double) done / (double) USEC_PER_SEC))));
+                                 FORMAT_BYTES(j->bytes_per_sec));
                 } else
                         log_info("Got %u%% of %s.", percent, j->url);
 
@@ -696,6 +834,8 @@ int pull_job_new(
                 .state = PULL_JOB_INIT,
                 .disk_fd = -EBADF,
                 .close_disk_fd = true,
+                .decompress_fd = -EBADF,
+                .bytes_per_sec = UINT64_MAX,
                 .userdata = userdata,
                 .glue = glue,
                 .content_length = UINT64_MAX,
@@ -704,6 +844,8 @@ int pull_job_new(
                 .uncompressed_max = 64LLU * 1024LLU * 1024LLU * 1024LLU, /* 64GB safety limit */
                 .url = TAKE_PTR(u),
                 .offset = UINT64_MAX,
+                .range_offset = UINT64_MAX,
+                .range_size = UINT64_MAX,
                 .sync = true,
         };
 
@@ -755,6 +897,21 @@ int pull_job_begin(PullJob *j) {
                         return -EIO;
         }
 
+        if (j->range_offset != UINT64_MAX) {
+                char range[DECIMAL_STR_MAX(uint64_t) * 2 + 2];
+
+                assert(j->range_size > 0);
+                assert(j->range_size <= UINT64_MAX - j->range_offset);
+
+                xsprintf(range, "%" PRIu64 "-%" PRIu64, j->range_offset, j->range_offset + j->range_size - 1);
+
+                /* libcurl copies the string */
+                if (curl_easy_setopt(j->curl, CURLOPT_RANGE, range) != CURLE_OK)
+                        return -EIO;
+
+                j->uncompressed_max = j->compressed_max = j->range_size;
+        }
+
         if (curl_easy_setopt(j->curl, CURLOPT_WRITEFUNCTION, pull_job_write_callback) != CURLE_OK)
                 return -EIO;
 
@@ -55,6 +55,11 @@ struct PullJob {
         uint64_t written_uncompressed;
         uint64_t offset;
 
+        /* If set, only this part of the resource is requested, and it is written as is, without
+         * decompressing it */
+        uint64_t range_offset;
+        uint64_t range_size;
+
         uint64_t uncompressed_max;
         uint64_t compressed_max;
 
@@ -69,7 +74,13 @@ struct PullJob {
 
         ImportCompress compress;
 
+        /* Compressed payloads that go to disk only are decompressed by a child process, fed through this
+         * pipe, so that decompressing doesn't hold up the download and vice versa */
+        int decompress_fd;
+        pid_t decompress_pid;
+
         unsigned progress_percent;
+        uint64_t bytes_per_sec; /* UINT64_MAX if not known yet */
         usec_t start_usec;
         usec_t last_status_usec;
 
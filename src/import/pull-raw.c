@@ -7,10 +7,12 @@
 #include "sd-daemon.h"
 
 #include "alloc-util.h"
+#include "blockdev-util.h"
 #include "btrfs-util.h"
 #include "copy.h"
 #include "curl-util.h"
 #include "fd-util.h"
+#include "format-util.h"
 #include "fs-util.h"
 #include "hostname-util.h"
 #include "import-common.h"
@@ -20,10 +22,12 @@
 #include "mkdir-label.h"
 #include "path-util.h"
 #include "pull-common.h"
+#include "pull-delta.h"
 #include "pull-job.h"
 #include "pull-raw.h"
 #include "qcow2-util.h"
 #include "rm-rf.h"
+#include "stat-util.h"
 #include "string-util.h"
 #include "strv.h"
 #include "tmpfile-util.h"
@@ -78,12 +82,35 @@ struct RawPull {
         char *verity_temp_path;
 
         char *checksum;
+
+        /* For delta downloads: the file or device (at the given offset) with an older version of the image,
+         * the chunk index of the new one, and the ranges of it we still need to download */
+        char *delta_base;
+        uint64_t delta_base_offset;
+        PullJob *chunks_job;
+        PullJob *range_job;
+        sd_event_source *delta_event_source;
+        ChunkIndex chunk_index;
+        DeltaRange *delta_ranges;
+        size_t n_delta_ranges;
+        size_t current_delta_range;
+        uint64_t delta_reused;
+        uint64_t delta_fetched;
+        usec_t delta_start_usec;
+        usec_t delta_fetch_usec;
 };
 
 RawPull* raw_pull_unref(RawPull *i) {
         if (!i)
                 return NULL;
 
+        sd_event_source_disable_unref(i->delta_event_source);
+        pull_job_unref(i->chunks_job);
+        pull_job_unref(i->range_job);
+        chunk_index_done(&i->chunk_index);
+        free(i->delta_ranges);
+        free(i->delta_base);
+
         pull_job_unref(i->raw_job);
         pull_job_unref(i->checksum_job);
         pull_job_unref(i->signature_job);
@@ -233,7 +260,14 @@ static void raw_pull_report_progress(RawPull *i, RawProgress p) {
                 assert_not_reached();
         }
 
-        sd_notifyf(false, "X_IMPORT_PROGRESS=%u%%", percent);
+        /* The download rate is only of interest while downloading the image itself */
+        if (p == RAW_DOWNLOADING && i->raw_job && i->raw_job->bytes_per_sec != UINT64_MAX)
+                sd_notifyf(false,
+                           "X_IMPORT_PROGRESS=%u%%\n"
+                           "X_IMPORT_RATE=%" PRIu64,
+                           percent, i->raw_job->bytes_per_sec);
+        else
+                sd_notifyf(false, "X_IMPORT_PROGRESS=%u%%", percent);
         log_debug("Combined progress %u%%", percent);
 }
 
@@ -511,6 +545,15 @@ static int raw_pull_rename_auxiliary_file(
         return 1;
 }
 
+static void raw_pull_finish(RawPull *i, int r) {
+        assert(i);
+
+        if (i->on_finished)
+                i->on_finished(i, r, i->userdata);
+        else
+                sd_event_exit(i->event, r);
+}
+
 static void raw_pull_job_on_finished(PullJob *j) {
         RawPull *i;
         int r;
@@ -693,10 +736,7 @@ static void raw_pull_job_on_finished(PullJob *j) {
         r = 0;
 
 finish:
-        if (i->on_finished)
-                i->on_finished(i, r, i->userdata);
-        else
-                sd_event_exit(i->event, r);
+        raw_pull_finish(i, r);
 }
 
 static int raw_pull_job_on_open_disk_generic(
@@ -828,6 +868,300 @@ static void raw_pull_job_on_progress(PullJob *j) {
         raw_pull_report_progress(i, RAW_DOWNLOADING);
 }
 
+static int raw_pull_delta_open_base(RawPull *i, uint64_t *ret_size) {
+        _cleanup_close_ int fd = -EBADF;
+        struct stat st, target_st;
+        uint64_t size;
+        int r;
+
+        assert(i);
+        assert(i->delta_base);
+        assert(i->local);
+        assert(ret_size);
+
+        fd = open(i->delta_base, O_RDONLY|O_NOCTTY|O_CLOEXEC);
+        if (fd < 0)
+                return log_info_errno(errno, "Failed to open delta base '%s': %m", i->delta_base);
+
+        if (fstat(fd, &st) < 0)
+                return log_info_errno(errno, "Failed to stat delta base '%s': %m", i->delta_base);
+
+        if (S_ISREG(st.st_mode))
+                size = LESS_BY((uint64_t) st.st_size, i->delta_base_offset);
+        else if (S_ISBLK(st.st_mode)) {
+                r = blockdev_get_device_size(fd, &size);
+                if (r < 0)
+                        return log_info_errno(r, "Failed to determine size of delta base '%s': %m", i->delta_base);
+
+                /* A partition is usually larger than the image it contains, don't bother with the rest */
+                size = MIN(LESS_BY(size, i->delta_base_offset), i->chunk_index.size);
+        } else
+                return log_info_errno(SYNTHETIC_ERRNO(EBADFD), "Delta base '%s' is neither a regular file nor a block device.", i->delta_base);
+
+        /* We are about to overwrite the target, hence make sure it does not overlap with the base */
+        if (stat(i->local, &target_st) >= 0 && stat_inode_same(&st, &target_st)) {
+                uint64_t target_offset = i->offset == UINT64_MAX ? 0 : i->offset;
+
+                if (target_offset < i->delta_base_offset + size &&
+                    i->delta_base_offset < target_offset + i->chunk_index.size)
+                        return log_info_errno(SYNTHETIC_ERRNO(EINVAL), "Delta base '%s' overlaps with the target, refusing.", i->delta_base);
+        }
+
+        *ret_size = size;
+        return TAKE_FD(fd);
+}
+
+static int raw_pull_delta_begin(RawPull *i) {
+        _cleanup_close_ int base_fd = -EBADF;
+        uint64_t base_size;
+        int r;
+
+        assert(i);
+        assert(i->chunks_job);
+        assert(i->raw_job);
+
+        if (i->chunks_job->error != 0)
+                return log_info_errno(i->chunks_job->error, "No chunk index for %s available.", i->raw_job->url);
+
+        r = chunk_index_parse(i->chunks_job->payload, i->chunks_job->payload_size, &i->chunk_index);
+        if (r < 0)
+                return log_info_errno(r, "Failed to parse chunk index %s: %m", i->chunks_job->url);
+
+        i->chunks_job = pull_job_unref(i->chunks_job);
+
+        if (i->chunk_index.size > i->raw_job->uncompressed_max)
+                return log_info_errno(SYNTHETIC_ERRNO(EFBIG), "Image %s is larger than permitted.", i->raw_job->url);
+
+        base_fd = raw_pull_delta_open_base(i, &base_size);
+        if (base_fd < 0)
+                return base_fd;
+
+        r = raw_pull_job_on_open_disk_raw(i->raw_job);
+        if (r < 0)
+                return r;
+
+        if (fstat(i->raw_job->disk_fd, &i->raw_job->disk_stat) < 0)
+                return log_error_errno(errno, "Failed to stat disk file: %m");
+
+        log_info("Looking for chunks of %s in '%s'.", i->raw_job->url, i->delta_base);
+
+        i->delta_start_usec = now(CLOCK_MONOTONIC);
+
+        r = chunk_index_apply(
+                        &i->chunk_index,
+                        base_fd,
+                        i->delta_base_offset,
+                        base_size,
+                        i->raw_job->disk_fd,
+                        i->offset == UINT64_MAX ? 0 : i->offset,
+                        &i->delta_ranges,
+                        &i->n_delta_ranges,
+                        &i->delta_reused);
+        if (r < 0)
+                return log_error_errno(r, "Failed to copy chunks from delta base '%s': %m", i->delta_base);
+
+        /* If nothing matched, there's nothing to gain, but a different file format, for example because the
+         * image is published compressed, is quite likely. Let the regular download sort this out. */
+        if (i->delta_reused == 0)
+                return log_info_errno(SYNTHETIC_ERRNO(ENODATA), "No chunks of %s found in '%s'.", i->raw_job->url, i->delta_base);
+
+        log_info("Found %s of %s in '%s', %s left to download.",
+                 FORMAT_BYTES(i->delta_reused), FORMAT_BYTES(i->chunk_index.size), i->delta_base,
+                 FORMAT_BYTES(i->chunk_index.size - i->delta_reused));
+        log_debug("Downloading %zu ranges of %s.", i->n_delta_ranges, i->raw_job->url);
+
+        return 0;
+}
+
+static void raw_pull_delta_job_on_finished(PullJob *j) {
+        RawPull *i = ASSERT_PTR(ASSERT_PTR(j)->userdata);
+
+        /* This might be called from within curl callbacks, hence don't start or release transfers here */
+        (void) sd_event_source_set_enabled(i->delta_event_source, SD_EVENT_ONESHOT);
+}
+
+static int raw_pull_delta_fetch(RawPull *i) {
+        const DeltaRange *d;
+        int r;
+
+        assert(i);
+        assert(i->current_delta_range < i->n_delta_ranges);
+
+        d = i->delta_ranges + i->current_delta_range;
+
+        r = pull_job_new(&i->range_job, i->raw_job->url, i->glue, i);
+        if (r < 0)
+                return log_oom();
+
+        i->range_job->range_offset = d->offset;
+        i->range_job->range_size = d->size;
+        i->range_job->disk_fd = i->raw_job->disk_fd;
+        i->range_job->close_disk_fd = false;
+        i->range_job->offset = (i->offset == UINT64_MAX ? 0 : i->offset) + d->offset;
+        i->range_job->sync = false;
+        i->range_job->on_finished = raw_pull_delta_job_on_finished;
+
+        r = pull_job_begin(i->range_job);
+        if (r < 0)
+                return log_error_errno(r, "Failed to start download of range of %s: %m", i->raw_job->url);
+
+        return 0;
+}
+
+static int raw_pull_delta_complete(RawPull *i) {
+        _cleanup_free_ char *checksum = NULL;
+        uint64_t size;
+        usec_t n;
+        int r;
+
+        assert(i);
+        assert(i->raw_job);
+
+        size = i->chunk_index.size;
+
+        /* The chunk index isn't signed, hence trust nothing but the checksum of what we assembled */
+        if (i->raw_job->calc_checksum) {
+                r = delta_sha256(i->raw_job->disk_fd, i->offset == UINT64_MAX ? 0 : i->offset, size, &checksum);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to calculate checksum of assembled image: %m");
+
+                if (i->checksum && !strcaseeq(i->checksum, checksum))
+                        return log_info_errno(SYNTHETIC_ERRNO(EBADMSG), "Checksum of image assembled from chunk index %s" CHUNK_INDEX_SUFFIX " does not check out.", i->raw_job->url);
+        }
+
+        if (S_ISREG(i->raw_job->disk_stat.st_mode) && i->offset == UINT64_MAX &&
+            ftruncate(i->raw_job->disk_fd, size) < 0)
+                return log_error_errno(errno, "Failed to truncate file: %m");
+
+        n = now(CLOCK_MONOTONIC);
+
+        log_info("Acquired %s, reusing %s and downloading %s (%" PRIu64 "%% saved) in %s.",
+                 FORMAT_BYTES(size), FORMAT_BYTES(i->delta_reused), FORMAT_BYTES(i->delta_fetched),
+                 size > 0 ? i->delta_reused * 100 / size : 0,
+                 FORMAT_TIMESPAN(usec_sub_unsigned(n, i->delta_start_usec), USEC_PER_MSEC));
+
+        /* Extrapolate from the rate we downloaded the missing ranges at how long the full download would
+         * have taken */
+        if (i->delta_fetched > 0 && i->delta_fetch_usec > 0) {
+                usec_t full = (usec_t) ((double) size * (double) i->delta_fetch_usec / (double) i->delta_fetched);
+
+                log_info("Saved an estimated %s compared to a full download.",
+                         FORMAT_TIMESPAN(usec_sub_unsigned(full, usec_sub_unsigned(n, i->delta_start_usec)), USEC_PER_MSEC));
+        }
+
+        /* Everything is in place now, let the rest of the logic treat this like a completed download */
+        i->raw_job->checksum = TAKE_PTR(checksum);
+        i->raw_job->written_compressed = i->raw_job->written_uncompressed = size;
+        i->raw_job->progress_percent = 100;
+        i->raw_job->state = PULL_JOB_DONE;
+
+        raw_pull_job_on_finished(i->raw_job);
+        return 0;
+}
+
+static int raw_pull_delta_step(RawPull *i) {
+        int r;
+
+        assert(i);
+
+        if (i->chunks_job) {
+                r = raw_pull_delta_begin(i);
+                if (r < 0)
+                        return r;
+        } else {
+                assert(i->range_job);
+
+                if (i->range_job->error != 0)
+                        return log_info_errno(i->range_job->error, "Failed to download range of %s.", i->raw_job->url);
+                if (i->range_job->written_uncompressed != i->range_job->range_size)
+                        return log_info_errno(SYNTHETIC_ERRNO(EIO), "Download of range of %s truncated.", i->raw_job->url);
+
+                i->delta_fetched += i->range_job->written_uncompressed;
+                i->delta_fetch_usec += usec_sub_unsigned(now(CLOCK_MONOTONIC), i->range_job->start_usec);
+                i->current_delta_range++;
+
+                i->range_job = pull_job_unref(i->range_job);
+        }
+
+        if (i->chunk_index.size > 0) {
+                i->raw_job->progress_percent = (i->delta_reused + i->delta_fetched) * 100 / i->chunk_index.size;
+                raw_pull_report_progress(i, RAW_DOWNLOADING);
+        }
+
+        if (i->current_delta_range < i->n_delta_ranges)
+                return raw_pull_delta_fetch(i);
+
+        return raw_pull_delta_complete(i);
+}
+
+static int raw_pull_on_delta_step(sd_event_source *s, void *userdata) {
+        RawPull *i = ASSERT_PTR(userdata);
+        int r;
+
+        r = raw_pull_delta_step(i);
+        if (r >= 0)
+                return 0;
+
+        /* Whatever went wrong, we can still download the image the regular way, into the same place. */
+        log_info("Downloading %s in full instead.", i->raw_job->url);
+
+        i->chunks_job = pull_job_unref(i->chunks_job);
+        i->range_job = pull_job_unref(i->range_job);
+        pull_job_close_disk_fd(i->raw_job);
+
+        r = pull_job_begin(i->raw_job);
+        if (r < 0)
+                raw_pull_finish(i, r);
+
+        return 0;
+}
+
+static int raw_pull_setup_delta(RawPull *i, const char *url, const char *delta_base, uint64_t delta_base_offset) {
+        const char *u;
+        int r;
+
+        assert(i);
+        assert(url);
+        assert(delta_base);
+
+        /* Only images written directly to their destination are worth it, and checksum and signature
+         * files are never split into chunks */
+        if (!FLAGS_SET(i->flags, IMPORT_DIRECT) || !i->local) {
+                log_debug("Not writing image directly to a file, not doing a delta download.");
+                return 0;
+        }
+
+        r = pull_url_needs_checksum(url);
+        if (r < 0)
+                return r;
+        if (r == 0) {
+                log_debug("Not doing a delta download of a checksum or signature file.");
+                return 0;
+        }
+
+        r = free_and_strdup(&i->delta_base, delta_base);
+        if (r < 0)
+                return r;
+
+        i->delta_base_offset = delta_base_offset;
+
+        u = strjoina(url, CHUNK_INDEX_SUFFIX);
+        r = pull_job_new(&i->chunks_job, u, i->glue, i);
+        if (r < 0)
+                return r;
+
+        i->chunks_job->on_finished = raw_pull_delta_job_on_finished;
+        i->chunks_job->uncompressed_max = i->chunks_job->compressed_max = 64LLU * 1024LLU * 1024LLU;
+
+        r = sd_event_add_defer(i->event, &i->delta_event_source, raw_pull_on_delta_step, i);
+        if (r < 0)
+                return r;
+
+        (void) sd_event_source_set_description(i->delta_event_source, "raw-pull-delta");
+
+        return sd_event_source_set_enabled(i->delta_event_source, SD_EVENT_OFF);
+}
+
 int raw_pull_start(
                 RawPull *i,
                 const char *url,
@@ -836,7 +1170,9 @@ int raw_pull_start(
                 uint64_t size_max,
                 ImportFlags flags,
                 ImportVerify verify,
-                const char *checksum) {
+                const char *checksum,
+                const char *delta_base,
+                uint64_t delta_base_offset) {
 
         int r;
 
@@ -849,6 +1185,7 @@ int raw_pull_start(
         assert(offset == UINT64_MAX || FLAGS_SET(flags, IMPORT_DIRECT));
         assert(!(flags & (IMPORT_PULL_SETTINGS|IMPORT_PULL_ROOTHASH|IMPORT_PULL_ROOTHASH_SIGNATURE|IMPORT_PULL_VERITY)) || !(flags & IMPORT_DIRECT));
         assert(!(flags & (IMPORT_PULL_SETTINGS|IMPORT_PULL_ROOTHASH|IMPORT_PULL_ROOTHASH_SIGNATURE|IMPORT_PULL_VERITY)) || !checksum);
+        assert(delta_base || delta_base_offset == 0);
 
         if (!http_url_is_valid(url) && !file_url_is_valid(url))
                 return -EINVAL;
@@ -916,6 +1253,12 @@ int raw_pull_start(
         if (r < 0)
                 return r;
 
+        if (delta_base) {
+                r = raw_pull_setup_delta(i, url, delta_base, delta_base_offset);
+                if (r < 0)
+                        return r;
+        }
+
         if (FLAGS_SET(flags, IMPORT_PULL_SETTINGS)) {
                 r = pull_make_auxiliary_job(
                                 &i->settings_job,
@@ -976,9 +1319,11 @@ int raw_pull_start(
                         return r;
         }
 
+        /* With a chunk index the image itself is only downloaded in full if the delta download fails */
         PullJob *j;
         FOREACH_ARGUMENT(j,
-                         i->raw_job,
+                         i->chunks_job ? NULL : i->raw_job,
+                         i->chunks_job,
                          i->checksum_job,
                          i->signature_job,
                          i->settings_job,
@@ -997,5 +1342,10 @@ int raw_pull_start(
                         return r;
         }
 
+        if (i->chunks_job) {
+                i->raw_job->on_progress = raw_pull_job_on_progress;
+                i->raw_job->sync = FLAGS_SET(flags, IMPORT_SYNC);
+        }
+
         return 0;
 }
@@ -193,7 +193,14 @@ static void tar_pull_report_progress(TarPull *i, TarProgress p) {
                 assert_not_reached();
         }
 
-        sd_notifyf(false, "X_IMPORT_PROGRESS=%u%%", percent);
+        /* The download rate is only of interest while downloading the image itself */
+        if (p == TAR_DOWNLOADING && i->tar_job && i->tar_job->bytes_per_sec != UINT64_MAX)
+                sd_notifyf(false,
+                           "X_IMPORT_PROGRESS=%u%%\n"
+                           "X_IMPORT_RATE=%" PRIu64,
+                           percent, i->tar_job->bytes_per_sec);
+        else
+                sd_notifyf(false, "X_IMPORT_PROGRESS=%u%%", percent);
         log_debug("Combined progress %u%%", percent);
 }
 
@@ -31,9 +31,12 @@ static ImportVerify arg_verify = IMPORT_VERIFY_SIGNATURE;
 static ImportFlags arg_import_flags = IMPORT_PULL_SETTINGS | IMPORT_PULL_ROOTHASH | IMPORT_PULL_ROOTHASH_SIGNATURE | IMPORT_PULL_VERITY | IMPORT_BTRFS_SUBVOL | IMPORT_BTRFS_QUOTA | IMPORT_CONVERT_QCOW2 | IMPORT_SYNC;
 static uint64_t arg_offset = UINT64_MAX, arg_size_max = UINT64_MAX;
 static char *arg_checksum = NULL;
+static char *arg_delta_base = NULL;
+static uint64_t arg_delta_base_offset = 0;
 static ImageClass arg_class = IMAGE_MACHINE;
 
 STATIC_DESTRUCTOR_REGISTER(arg_checksum, freep);
+STATIC_DESTRUCTOR_REGISTER(arg_delta_base, freep);
 
 static int normalize_local(const char *local, const char *url, char **ret) {
         _cleanup_free_ char *ll = NULL;
@@ -117,6 +120,9 @@ static int pull_tar(int argc, char *argv[], void *userdata) {
         const char *url, *local;
         int r;
 
+        if (arg_delta_base)
+                return log_error_errno(SYNTHETIC_ERRNO(EOPNOTSUPP), "Delta downloads are only supported for raw images.");
+
         url = argv[1];
         if (!http_url_is_valid(url) && !file_url_is_valid(url))
                 return log_error_errno(SYNTHETIC_ERRNO(EINVAL), "URL '%s' is not valid.", url);
@@ -227,7 +233,9 @@ static int pull_raw(int argc, char *argv[], void *userdata) {
                         arg_size_max,
                         arg_import_flags & IMPORT_PULL_FLAGS_MASK_RAW,
                         arg_verify,
-                        arg_checksum);
+                        arg_checksum,
+                        arg_delta_base,
+                        arg_delta_base_offset);
         if (r < 0)
                 return log_error_errno(r, "Failed to pull image: %m");
 
@@ -269,6 +277,9 @@ static int help(int argc, char *argv[], void *userdata) {
                "     --sync=BOOL              Controls whether to sync() before completing\n"
                "     --offset=BYTES           Offset to seek to in destination\n"
                "     --size-max=BYTES         Maximum number of bytes to write to destination\n"
+               "     --delta-base=PATH        Reuse chunks of an older version of the image\n"
+               "     --delta-base-offset=BYTES\n"
+               "                              Offset of the older version in the delta base\n"
                "     --class=CLASS            Select image class (machine, sysext, confext,\n"
                "                              portable)\n"
                "     --keep-download=BOOL     Keep a copy pristine copy of the downloaded file\n"
@@ -303,6 +314,8 @@ static int parse_argv(int argc, char *argv[]) {
                 ARG_SIZE_MAX,
                 ARG_CLASS,
                 ARG_KEEP_DOWNLOAD,
+                ARG_DELTA_BASE,
+                ARG_DELTA_BASE_OFFSET,
         };
 
         static const struct option options[] = {
@@ -325,6 +338,8 @@ static int parse_argv(int argc, char *argv[]) {
                 { "size-max",           required_argument, NULL, ARG_SIZE_MAX           },
                 { "class",              required_argument, NULL, ARG_CLASS              },
                 { "keep-download",      required_argument, NULL, ARG_KEEP_DOWNLOAD      },
+                { "delta-base",         required_argument, NULL, ARG_DELTA_BASE         },
+                { "delta-base-offset",  required_argument, NULL, ARG_DELTA_BASE_OFFSET  },
                 {}
         };
 
@@ -505,6 +520,26 @@ static int parse_argv(int argc, char *argv[]) {
                         auto_keep_download = false;
                         break;
 
+                case ARG_DELTA_BASE:
+                        r = parse_path_argument(optarg, /* suppress_root= */ false, &arg_delta_base);
+                        if (r < 0)
+                                return r;
+
+                        break;
+
+                case ARG_DELTA_BASE_OFFSET: {
+                        uint64_t u;
+
+                        r = safe_atou64(optarg, &u);
+                        if (r < 0)
+                                return log_error_errno(r, "Failed to parse --delta-base-offset= argument: %s", optarg);
+                        if (!FILE_SIZE_VALID(u))
+                                return log_error_errno(SYNTHETIC_ERRNO(EINVAL), "Argument to --delta-base-offset= switch too large: %s", optarg);
+
+                        arg_delta_base_offset = u;
+                        break;
+                }
+
                 case '?':
                         return -EINVAL;
 
@@ -521,6 +556,12 @@ static int parse_argv(int argc, char *argv[]) {
         if (arg_offset != UINT64_MAX && !FLAGS_SET(arg_import_flags, IMPORT_DIRECT))
                 return log_error_errno(SYNTHETIC_ERRNO(EINVAL), "File offset only supported in --direct mode.");
 
+        if (arg_delta_base && !FLAGS_SET(arg_import_flags, IMPORT_DIRECT))
+                return log_error_errno(SYNTHETIC_ERRNO(EINVAL), "Delta downloads only supported in --direct mode.");
+
+        if (arg_delta_base_offset != 0 && !arg_delta_base)
+                return log_error_errno(SYNTHETIC_ERRNO(EINVAL), "--delta-base-offset= requires --delta-base=.");
+
         if (arg_checksum && (arg_import_flags & (IMPORT_PULL_SETTINGS|IMPORT_PULL_ROOTHASH|IMPORT_PULL_ROOTHASH_SIGNATURE|IMPORT_PULL_VERITY)) != 0)
                 return log_error_errno(SYNTHETIC_ERRNO(EINVAL), "Literal checksum verification only supported if no associated files are downloaded.");
 
@@ -4,6 +4,12 @@
 
 #include "alloc-util.h"
 #include "btrfs-util.h"
+#include "copy.h"
+#include "cpu-set-util.h"
+#include "errno-util.h"
+#include "log.h"
+#include "missing_syscall.h"
+#include "process-util.h"
 #include "qcow2-util.h"
 #include "sparse-endian.h"
 
@@ -13,6 +19,10 @@
 #define QCOW2_COMPRESSED (1ULL << 62)
 #define QCOW2_ZERO (1ULL << 0)
 
+/* The L1 table entries, i.e. the L2 tables and the clusters they refer to, are converted by up to this many
+ * worker processes in parallel. That's mostly about compressed clusters, which take a while to decompress. */
+#define QCOW2_WORKERS_MAX 8U
+
 typedef struct _packed_ Header {
       be32_t magic;
       be32_t version;
@@ -60,30 +70,62 @@ static uint32_t HEADER_HEADER_LENGTH(const Header *h) {
         return be32toh(h->header_length);
 }
 
-static int copy_cluster(
+static int copy_range(
                 int sfd, uint64_t soffset,
                 int dfd, uint64_t doffset,
-                uint64_t cluster_size,
-                void *buffer) {
+                uint64_t size,
+                void *buffer,
+                size_t buffer_size) {
 
         ssize_t l;
         int r;
 
-        r = reflink_range(sfd, soffset, dfd, doffset, cluster_size);
+        /* Copies a run of clusters that are contiguous in both files, with as few calls as possible */
+
+        if (size == 0)
+                return 0;
+
+        r = reflink_range(sfd, soffset, dfd, doffset, size);
         if (r >= 0)
                 return r;
 
-        l = pread(sfd, buffer, cluster_size, soffset);
-        if (l < 0)
-                return -errno;
-        if ((uint64_t) l != cluster_size)
-                return -EIO;
+        while (size > 0) {
+                loff_t in = soffset, out = doffset;
 
-        l = pwrite(dfd, buffer, cluster_size, doffset);
-        if (l < 0)
-                return -errno;
-        if ((uint64_t) l != cluster_size)
-                return -EIO;
+                l = copy_file_range(sfd, &in, dfd, &out, MIN(size, (uint64_t) SSIZE_MAX), 0);
+                if (l < 0) {
+                        if (!ERRNO_IS_NOT_SUPPORTED(errno) && !IN_SET(errno, EXDEV, EINVAL, EBADF))
+                                return -errno;
+
+                        break; /* Do it ourselves then */
+                }
+                if (l == 0)
+                        return -EIO;
+
+                soffset += l;
+                doffset += l;
+                size -= l;
+        }
+
+        while (size > 0) {
+                size_t n = MIN(size, (uint64_t) buffer_size);
+
+                l = pread(sfd, buffer, n, soffset);
+                if (l < 0)
+                        return -errno;
+                if ((size_t) l != n)
+                        return -EIO;
+
+                l = pwrite(dfd, buffer, n, doffset);
+                if (l < 0)
+                        return -errno;
+                if ((size_t) l != n)
+                        return -EIO;
+
+                soffset += n;
+                doffset += n;
+                size -= n;
+        }
 
         return 0;
 }
@@ -225,10 +267,94 @@ static int verify_header(const Header *header) {
         return 0;
 }
 
+static int convert_l1_entries(
+                const Header *header,
+                const be64_t *l1_table,
+                int qcow2_fd,
+                int raw_fd,
+                uint64_t worker,
+                uint64_t n_workers,
+                be64_t *l2_table,
+                void *buffer1,
+                void *buffer2) {
+
+        ssize_t l;
+        int r;
+
+        /* Converts every n_workers-th L1 table entry, starting with the one at index 'worker' */
+
+        for (uint64_t i = worker; i < HEADER_L1_SIZE(header); i += n_workers) {
+                uint64_t l2_begin, run_source = 0, run_dest = 0, run_size = 0;
+
+                r = normalize_offset(header, l1_table[i], &l2_begin, NULL, NULL);
+                if (r < 0)
+                        return r;
+                if (r == 0)
+                        continue;
+
+                l = pread(qcow2_fd, l2_table, HEADER_CLUSTER_SIZE(header), l2_begin);
+                if (l < 0)
+                        return -errno;
+                if ((uint64_t) l != HEADER_CLUSTER_SIZE(header))
+                        return -EIO;
+
+                for (uint64_t j = 0; j < HEADER_L2_SIZE(header); j++) {
+                        uint64_t data_begin, p, compressed_size;
+                        bool compressed;
+
+                        p = ((i << HEADER_L2_BITS(header)) + j) << HEADER_CLUSTER_BITS(header);
+
+                        /* Zero clusters and holes are left as holes, the raw file starts out empty */
+                        r = normalize_offset(header, l2_table[j], &data_begin, &compressed, &compressed_size);
+                        if (r < 0)
+                                return r;
+                        if (r == 0)
+                                continue;
+
+                        if (compressed) {
+                                r = decompress_cluster(
+                                                qcow2_fd, data_begin,
+                                                raw_fd, p,
+                                                compressed_size, HEADER_CLUSTER_SIZE(header),
+                                                buffer1, buffer2);
+                                if (r < 0)
+                                        return r;
+
+                                continue;
+                        }
+
+                        /* Extend the current run of clusters if this one follows in both files */
+                        if (run_size > 0 &&
+                            data_begin == run_source + run_size &&
+                            p == run_dest + run_size) {
+                                run_size += HEADER_CLUSTER_SIZE(header);
+                                continue;
+                        }
+
+                        r = copy_range(qcow2_fd, run_source, raw_fd, run_dest, run_size,
+                                       buffer1, HEADER_CLUSTER_SIZE(header));
+                        if (r < 0)
+                                return r;
+
+                        run_source = data_begin;
+                        run_dest = p;
+                        run_size = HEADER_CLUSTER_SIZE(header);
+                }
+
+                r = copy_range(qcow2_fd, run_source, raw_fd, run_dest, run_size,
+                               buffer1, HEADER_CLUSTER_SIZE(header));
+                if (r < 0)
+                        return r;
+        }
+
+        return 0;
+}
+
 int qcow2_convert(int qcow2_fd, int raw_fd) {
         _cleanup_free_ void *buffer1 = NULL, *buffer2 = NULL;
         _cleanup_free_ be64_t *l1_table = NULL, *l2_table = NULL;
-        uint64_t sz, i;
+        _cleanup_free_ pid_t *pids = NULL;
+        uint64_t sz, i, n_workers;
         Header header;
         ssize_t l;
         int r;
@@ -273,50 +399,53 @@ int qcow2_convert(int qcow2_fd, int raw_fd) {
         if ((uint64_t) l != sz)
                 return -EIO;
 
-        for (i = 0; i < HEADER_L1_SIZE(&header); i++) {
-                uint64_t l2_begin, j;
-
-                r = normalize_offset(&header, l1_table[i], &l2_begin, NULL, NULL);
-                if (r < 0)
-                        return r;
-                if (r == 0)
-                        continue;
-
-                l = pread(qcow2_fd, l2_table, HEADER_CLUSTER_SIZE(&header), l2_begin);
-                if (l < 0)
-                        return -errno;
-                if ((uint64_t) l != HEADER_CLUSTER_SIZE(&header))
-                        return -EIO;
-
-                for (j = 0; j < HEADER_L2_SIZE(&header); j++) {
-                        uint64_t data_begin, p, compressed_size;
-                        bool compressed;
+        n_workers = 0;
+        for (i = 0; i < HEADER_L1_SIZE(&header); i++)
+                if (l1_table[i] != 0)
+                        n_workers++;
+
+        r = cpus_in_affinity_mask();
+        n_workers = MIN3(n_workers, (uint64_t) MAX(r, 1), (uint64_t) QCOW2_WORKERS_MAX);
+        if (n_workers <= 1)
+                return convert_l1_entries(&header, l1_table, qcow2_fd, raw_fd, /* worker= */ 0, /* n_workers= */ 1,
+                                          l2_table, buffer1, buffer2);
+
+        /* Every cluster ends up at its own place in the raw file, hence the workers don't get in each
+         * other's way */
+        pids = new(pid_t, n_workers);
+        if (!pids)
+                return -ENOMEM;
 
-                        p = ((i << HEADER_L2_BITS(&header)) + j) << HEADER_CLUSTER_BITS(&header);
+        r = 0;
+        for (uint64_t w = 0; w < n_workers; w++) {
+                r = safe_fork("(sd-qcow2)", FORK_RESET_SIGNALS|FORK_DEATHSIG_SIGTERM|FORK_LOG, pids + w);
+                if (r < 0) {
+                        n_workers = w;
+                        break;
+                }
+                if (r == 0) {
+                        r = convert_l1_entries(&header, l1_table, qcow2_fd, raw_fd, w, n_workers,
+                                               l2_table, buffer1, buffer2);
+                        if (r < 0) {
+                                log_error_errno(r, "Failed to convert qcow2 clusters: %m");
+                                _exit(EXIT_FAILURE);
+                        }
+
+                        _exit(EXIT_SUCCESS);
+                }
+        }
 
-                        r = normalize_offset(&header, l2_table[j], &data_begin, &compressed, &compressed_size);
-                        if (r < 0)
-                                return r;
-                        if (r == 0)
-                                continue;
+        for (uint64_t w = 0; w < n_workers; w++) {
+                int k;
 
-                        if (compressed)
-                                r = decompress_cluster(
-                                                qcow2_fd, data_begin,
-                                                raw_fd, p,
-                                                compressed_size, HEADER_CLUSTER_SIZE(&header),
-                                                buffer1, buffer2);
-                        else
-                                r = copy_cluster(
-                                                qcow2_fd, data_begin,
-                                                raw_fd, p,
-                                                HEADER_CLUSTER_SIZE(&header), buffer1);
-                        if (r < 0)
-                                return r;
-                }
+                k = wait_for_terminate_and_check("(sd-qcow2)", pids[w], WAIT_LOG_ABNORMAL);
+                if (k > 0)
+                        k = -EIO; /* The worker logged the actual error */
+                if (k < 0 && r >= 0)
+                        r = k;
         }
 
-        return 0;
+        return r < 0 ? r : 0;
 }
 
 int qcow2_detect(int fd) {
@@ -0,0 +1,131 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <unistd.h>
+
+#include "alloc-util.h"
+#include "fd-util.h"
+#include "hexdecoct.h"
+#include "memfd-util.h"
+#include "pull-delta.h"
+#include "random-util.h"
+#include "string-util.h"
+#include "tests.h"
+
+#define CHUNK (4U*1024U)
+
+static char* make_index(const uint8_t *data, size_t size) {
+        char *s = NULL;
+
+        ASSERT_OK(strextendf(&s, "# test\n%zu %u\n", size, CHUNK));
+
+        for (size_t o = 0; o < size; o += CHUNK) {
+                uint8_t digest[SHA256_DIGEST_SIZE];
+                _cleanup_free_ char *h = NULL;
+
+                sha256_direct(data + o, MIN((size_t) CHUNK, size - o), digest);
+                ASSERT_NOT_NULL(h = hexmem(digest, sizeof(digest)));
+                ASSERT_TRUE(strextend(&s, h, "\n"));
+        }
+
+        return s;
+}
+
+static int make_fd(const void *data, size_t size) {
+        int fd;
+
+        ASSERT_OK(fd = memfd_new("test-pull-delta"));
+        if (size > 0)
+                ASSERT_EQ(pwrite(fd, data, size, 0), (ssize_t) size);
+
+        return fd;
+}
+
+TEST(chunk_index_parse) {
+        _cleanup_(chunk_index_done) ChunkIndex x = {};
+        _cleanup_free_ char *s = NULL;
+        uint8_t data[CHUNK * 2 + 10];
+
+        random_bytes(data, sizeof(data));
+        ASSERT_NOT_NULL(s = make_index(data, sizeof(data)));
+
+        ASSERT_OK(chunk_index_parse(s, strlen(s), &x));
+        ASSERT_EQ(x.size, sizeof(data));
+        ASSERT_EQ(x.chunk_size, CHUNK);
+        ASSERT_EQ(x.n_chunks, 3u);
+
+        /* Missing chunk */
+        ASSERT_ERROR(chunk_index_parse(s, strrchr(s, '\n') - s - 64, &x), EBADMSG);
+
+        ASSERT_ERROR(chunk_index_parse("", 0, &x), EBADMSG);
+        ASSERT_ERROR(chunk_index_parse("10 4096\nfoo\n", 12, &x), EBADMSG);
+        ASSERT_ERROR(chunk_index_parse("10 17\n", 6, &x), EBADMSG);
+        ASSERT_ERROR(chunk_index_parse("1099511627776 4096\n", 19, &x), EBADMSG);
+
+        chunk_index_done(&x);
+        ASSERT_OK(chunk_index_parse("0 4096\n", 7, &x));
+        ASSERT_EQ(x.n_chunks, 0u);
+}
+
+TEST(chunk_index_apply) {
+        _cleanup_free_ uint8_t *old = NULL, *new = NULL, *result = NULL;
+        _cleanup_(chunk_index_done) ChunkIndex x = {};
+        _cleanup_close_ int base_fd = -EBADF, target_fd = -EBADF;
+        _cleanup_free_ DeltaRange *missing = NULL;
+        _cleanup_free_ char *s = NULL, *h = NULL, *expected = NULL;
+        uint8_t digest[SHA256_DIGEST_SIZE];
+        size_t size = CHUNK * 8 + 100, n_missing;
+        uint64_t reused;
+
+        ASSERT_NOT_NULL(old = malloc(size));
+        random_bytes(old, size);
+
+        /* Change chunks 1, 2 and 5, as well as the partial one at the end */
+        ASSERT_NOT_NULL(new = memdup(old, size));
+        new[CHUNK + 7] ^= 0xff;
+        new[CHUNK * 2 + 7] ^= 0xff;
+        new[CHUNK * 5] ^= 0xff;
+        new[size - 1] ^= 0xff;
+
+        ASSERT_NOT_NULL(s = make_index(new, size));
+        ASSERT_OK(chunk_index_parse(s, strlen(s), &x));
+
+        base_fd = make_fd(old, size);
+        target_fd = make_fd(NULL, 0);
+
+        /* Place the result at an offset, as if writing to a partition */
+        ASSERT_OK(chunk_index_apply(&x, base_fd, 0, size, target_fd, 512, &missing, &n_missing, &reused));
+        ASSERT_EQ(reused, (uint64_t) CHUNK * 5);
+        ASSERT_EQ(n_missing, 3u);
+        ASSERT_EQ(missing[0].offset, (uint64_t) CHUNK);
+        ASSERT_EQ(missing[0].size, (uint64_t) CHUNK * 2);
+        ASSERT_EQ(missing[1].offset, (uint64_t) CHUNK * 5);
+        ASSERT_EQ(missing[1].size, (uint64_t) CHUNK);
+        ASSERT_EQ(missing[2].offset, (uint64_t) CHUNK * 8);
+        ASSERT_EQ(missing[2].size, 100u);
+
+        /* Fill in the rest, the way the downloader would, and compare */
+        for (size_t i = 0; i < n_missing; i++)
+                ASSERT_EQ(pwrite(target_fd, new + missing[i].offset, missing[i].size, 512 + missing[i].offset),
+                          (ssize_t) missing[i].size);
+
+        ASSERT_NOT_NULL(result = malloc(size));
+        ASSERT_EQ(pread(target_fd, result, size, 512), (ssize_t) size);
+        ASSERT_EQ(memcmp(result, new, size), 0);
+
+        ASSERT_OK(delta_sha256(target_fd, 512, size, &h));
+        sha256_direct(new, size, digest);
+        ASSERT_NOT_NULL(expected = hexmem(digest, sizeof(digest)));
+        ASSERT_STREQ(h, expected);
+
+        /* Nothing in common */
+        missing = mfree(missing);
+        random_bytes(old, size);
+        ASSERT_EQ(pwrite(base_fd, old, size, 0), (ssize_t) size);
+        ASSERT_OK(chunk_index_apply(&x, base_fd, 0, size, target_fd, 0, &missing, &n_missing, &reused));
+        ASSERT_EQ(reused, 0u);
+        ASSERT_EQ(n_missing, 1u);
+        ASSERT_EQ(missing[0].offset, 0u);
+        ASSERT_EQ(missing[0].size, (uint64_t) size);
+}
+
+DEFINE_TEST_MAIN(LOG_DEBUG);
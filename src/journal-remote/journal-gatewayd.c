@@ -3,6 +3,8 @@
 #include <fcntl.h>
 #include <getopt.h>
 #include <microhttpd.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
@@ -17,13 +19,16 @@
 #include "build.h"
 #include "bus-locator.h"
 #include "bus-util.h"
+#include "compress.h"
 #include "errno-util.h"
 #include "fd-util.h"
 #include "fileio.h"
 #include "glob-util.h"
 #include "hostname-util.h"
+#include "journal-export-binary.h"
 #include "journal-internal.h"
 #include "journal-remote.h"
+#include "list.h"
 #include "log.h"
 #include "logs-show.h"
 #include "main-func.h"
@@ -34,11 +39,19 @@
 #include "pretty-print.h"
 #include "sigbus.h"
 #include "signal-util.h"
+#include "string-util.h"
+#include "strv.h"
 #include "time-util.h"
 #include "tmpfile-util.h"
 
 #define JOURNAL_WAIT_TIMEOUT (10*USEC_PER_SEC)
 
+/* How many journals that are not used by any request are kept open for later requests */
+#define JOURNAL_POOL_MAX 16U
+
+/* How much rendered output is compressed at once, if it is available right away */
+#define COMPRESS_BATCH_SIZE (64U*1024U)
+
 static char *arg_key_pem = NULL;
 static char *arg_cert_pem = NULL;
 static char *arg_trust_pem = NULL;
@@ -55,7 +68,16 @@ STATIC_DESTRUCTOR_REGISTER(arg_file, strv_freep);
 typedef struct RequestMeta {
         sd_journal *journal;
 
+        /* The filter from the URL arguments, as pairs of field and value. Unless it could not be installed,
+         * the journal is handed back to the pool for requests with the same filter in the end. */
+        char **matches;
+        bool boot;
+        bool filtered;
+
+        uint64_t watch_generation;
+
         OutputMode mode;
+        JournalBinaryExporter *exporter; /* for OUTPUT_EXPORT_BINARY, field names are sent once per response */
 
         char *cursor;
         usec_t since, until;
@@ -70,16 +92,258 @@ typedef struct RequestMeta {
 
         bool follow;
         bool discrete;
+
+        /* If the response is compressed, the output of 'reader' is compressed in batches, and handed out
+         * from 'compressed'. 'no_wait' tells the reader to not wait for new entries in follow mode. */
+        Compressor *compressor;
+        MHD_ContentReaderCallback reader;
+        uint64_t reader_pos;
+        char *raw;
+        char *compressed;
+        size_t compressed_size, compressed_pos;
+        bool compressed_end;
+        bool no_wait;
 } RequestMeta;
 
+typedef struct PooledJournal PooledJournal;
+
+struct PooledJournal {
+        sd_journal *journal;
+        char **matches;
+        bool boot;
+
+        LIST_FIELDS(PooledJournal, pool);
+};
+
+/* Requests are handled in a thread per connection, hence all of this is protected by the locks */
+static pthread_mutex_t journal_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static LIST_HEAD(PooledJournal, journal_pool) = NULL;
+static unsigned journal_pool_size = 0;
+
+static pthread_mutex_t journal_watch_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t journal_watch_cond = PTHREAD_COND_INITIALIZER;
+static uint64_t journal_watch_generation = 0;
+static int journal_watch_state = 0; /* 0: not started, 1: running, < 0: failed */
+
 static const char* const mime_types[_OUTPUT_MODE_MAX] = {
         [OUTPUT_SHORT] = "text/plain",
         [OUTPUT_JSON] = "application/json",
         [OUTPUT_JSON_SSE] = "text/event-stream",
         [OUTPUT_JSON_SEQ] = "application/json-seq",
         [OUTPUT_EXPORT] = "application/vnd.fdo.journal",
+        [OUTPUT_EXPORT_BINARY] = "application/vnd.fdo.journal.binary",
 };
 
+static int open_journal_raw(sd_journal **ret) {
+        assert(ret);
+
+        if (arg_directory)
+                return sd_journal_open_directory(ret, arg_directory, arg_journal_type);
+        else if (arg_file)
+                return sd_journal_open_files(ret, (const char**) arg_file, 0);
+        else
+                return sd_journal_open(ret, (arg_merge ? 0 : SD_JOURNAL_LOCAL_ONLY) | arg_journal_type);
+}
+
+static PooledJournal* pooled_journal_free(PooledJournal *p) {
+        if (!p)
+                return NULL;
+
+        sd_journal_close(p->journal);
+        strv_free(p->matches);
+        return mfree(p);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(PooledJournal*, pooled_journal_free);
+
+static int journal_pool_acquire(char **matches, bool boot, sd_journal **ret) {
+        PooledJournal *found = NULL;
+        int r;
+
+        assert(ret);
+
+        /* Opening a journal means opening and mapping all journal files, which is much more expensive than
+         * handing out one that was used by an earlier request with the same filter, hence those are kept
+         * around. Returns 1 if the journal came from the pool and has the filter installed, 0 otherwise. */
+
+        assert_se(pthread_mutex_lock(&journal_pool_lock) == 0);
+        LIST_FOREACH(pool, p, journal_pool)
+                if (p->boot == boot && strv_equal(p->matches, matches)) {
+                        LIST_REMOVE(pool, journal_pool, p);
+                        journal_pool_size--;
+                        found = p;
+                        break;
+                }
+        assert_se(pthread_mutex_unlock(&journal_pool_lock) == 0);
+
+        if (found) {
+                _cleanup_(pooled_journal_freep) PooledJournal *p = found;
+
+                /* Pick up journal files that were added or removed in the meantime */
+                r = sd_journal_process(p->journal);
+                if (r >= 0) {
+                        *ret = TAKE_PTR(p->journal);
+                        return 1;
+                }
+
+                log_debug_errno(r, "Failed to process pooled journal, opening a new one: %m");
+        }
+
+        r = open_journal_raw(ret);
+        if (r < 0)
+                return r;
+
+        /* Set up inotify, so that sd_journal_process() works when the journal is reused, or followed */
+        r = sd_journal_get_fd(*ret);
+        if (r < 0)
+                log_debug_errno(r, "Failed to watch journal for changes, ignoring: %m");
+
+        return 0;
+}
+
+static void journal_pool_release(sd_journal *j, char **matches, bool boot) {
+        _cleanup_(pooled_journal_freep) PooledJournal *p = NULL, *evicted = NULL;
+
+        assert(j);
+
+        p = new(PooledJournal, 1);
+        if (!p) {
+                sd_journal_close(j);
+                strv_free(matches);
+                return;
+        }
+
+        *p = (PooledJournal) {
+                .journal = j,
+                .matches = matches,
+                .boot = boot,
+        };
+
+        assert_se(pthread_mutex_lock(&journal_pool_lock) == 0);
+        LIST_PREPEND(pool, journal_pool, TAKE_PTR(p));
+        if (++journal_pool_size > JOURNAL_POOL_MAX) {
+                /* The least recently used one is at the end */
+                evicted = LIST_FIND_TAIL(pool, journal_pool);
+                LIST_REMOVE(pool, journal_pool, evicted);
+                journal_pool_size--;
+        }
+        assert_se(pthread_mutex_unlock(&journal_pool_lock) == 0);
+}
+
+static void* journal_watch_thread(void *userdata) {
+        sd_journal *j = ASSERT_PTR(userdata);
+        int r;
+
+        /* Waits for changes to the journal on behalf of all requests in follow mode, and wakes them up, so
+         * that not every one of them has to watch all journal files on its own. */
+
+        for (;;) {
+                r = sd_journal_wait(j, UINT64_MAX);
+                if (r < 0) {
+                        log_error_errno(r, "Failed to wait for journal changes: %m");
+                        break;
+                }
+                if (r == SD_JOURNAL_NOP)
+                        continue;
+
+                assert_se(pthread_mutex_lock(&journal_watch_lock) == 0);
+                journal_watch_generation++;
+                assert_se(pthread_cond_broadcast(&journal_watch_cond) == 0);
+                assert_se(pthread_mutex_unlock(&journal_watch_lock) == 0);
+        }
+
+        assert_se(pthread_mutex_lock(&journal_watch_lock) == 0);
+        journal_watch_state = r;
+        assert_se(pthread_cond_broadcast(&journal_watch_cond) == 0);
+        assert_se(pthread_mutex_unlock(&journal_watch_lock) == 0);
+
+        sd_journal_close(j);
+        return NULL;
+}
+
+static int journal_watch_start_locked(void) {
+        sigset_t ss, saved_ss;
+        pthread_attr_t attr;
+        sd_journal *j;
+        int r;
+
+        r = open_journal_raw(&j);
+        if (r < 0)
+                return r;
+
+        r = sd_journal_get_fd(j);
+        if (r < 0)
+                goto fail;
+
+        r = -pthread_attr_init(&attr);
+        if (r < 0)
+                goto fail;
+
+        r = -pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        if (r >= 0) {
+                pthread_t t;
+
+                /* Signals are handled by the main thread */
+                assert_se(sigfillset(&ss) >= 0);
+                r = -pthread_sigmask(SIG_BLOCK, &ss, &saved_ss);
+                if (r >= 0) {
+                        r = -pthread_create(&t, &attr, journal_watch_thread, j);
+                        assert_se(pthread_sigmask(SIG_SETMASK, &saved_ss, NULL) == 0);
+                }
+        }
+
+        assert_se(pthread_attr_destroy(&attr) == 0);
+        if (r < 0)
+                goto fail;
+
+        return 0;
+
+fail:
+        sd_journal_close(j);
+        return r;
+}
+
+static int journal_watch_wait(uint64_t *generation, usec_t timeout) {
+        struct timespec ts;
+        bool changed;
+        int r;
+
+        assert(generation);
+
+        /* Waits until the journal changed since the generation seen last, or the timeout elapsed. Returns
+         * > 0 in the former case, 0 on timeout, and < 0 if the shared watch is not available, in which case
+         * the caller has to wait for changes by itself. */
+
+        assert_se(pthread_mutex_lock(&journal_watch_lock) == 0);
+
+        if (journal_watch_state == 0) {
+                r = journal_watch_start_locked();
+                if (r < 0)
+                        log_warning_errno(r, "Failed to start journal watch thread, following journals individually: %m");
+                journal_watch_state = r < 0 ? r : 1;
+        }
+
+        timespec_store(&ts, usec_add(now(CLOCK_REALTIME), timeout));
+
+        while (journal_watch_state > 0 && *generation == journal_watch_generation) {
+                r = pthread_cond_timedwait(&journal_watch_cond, &journal_watch_lock, &ts);
+                if (r == ETIMEDOUT)
+                        break;
+                assert(r == 0);
+        }
+
+        r = journal_watch_state;
+        changed = *generation != journal_watch_generation;
+        *generation = journal_watch_generation;
+
+        assert_se(pthread_mutex_unlock(&journal_watch_lock) == 0);
+
+        if (r < 0)
+                return r;
+
+        return changed;
+}
+
 static RequestMeta *request_meta(void **connection_cls) {
         RequestMeta *m;
 
@@ -106,26 +370,62 @@ static void request_meta_free(
         if (!m)
                 return;
 
+        if (m->journal && m->filtered)
+                journal_pool_release(TAKE_PTR(m->journal), TAKE_PTR(m->matches), m->boot);
         sd_journal_close(m->journal);
+        strv_free(m->matches);
 
         safe_fclose(m->tmp);
+        journal_binary_exporter_free(m->exporter);
+
+        compressor_free(m->compressor);
+        free(m->raw);
+        free(m->compressed);
 
         free(m->cursor);
         free(m);
 }
 
 static int open_journal(RequestMeta *m) {
+        int r;
+
         assert(m);
 
         if (m->journal)
                 return 0;
 
-        if (arg_directory)
-                return sd_journal_open_directory(&m->journal, arg_directory, arg_journal_type);
-        else if (arg_file)
-                return sd_journal_open_files(&m->journal, (const char**) arg_file, 0);
-        else
-                return sd_journal_open(&m->journal, (arg_merge ? 0 : SD_JOURNAL_LOCAL_ONLY) | arg_journal_type);
+        r = journal_pool_acquire(m->matches, m->boot, &m->journal);
+        if (r < 0)
+                return r;
+
+        /* A journal from the pool has the filter installed already, and so has a new one if there is none */
+        m->filtered = r > 0 || (strv_isempty(m->matches) && !m->boot);
+        return 0;
+}
+
+static int request_install_filter(RequestMeta *m) {
+        int r;
+
+        assert(m);
+        assert(m->journal);
+
+        if (m->filtered)
+                return 0;
+
+        STRV_FOREACH_PAIR(field, value, m->matches) {
+                r = journal_add_match_pair(m->journal, *field, *value);
+                if (r < 0)
+                        return r;
+        }
+
+        if (m->boot) {
+                r = add_match_boot_id(m->journal, SD_ID128_NULL);
+                if (r < 0)
+                        return r;
+        }
+
+        m->filtered = true;
+        return 0;
 }
 
 static int request_meta_ensure_tmp(RequestMeta *m) {
@@ -189,14 +489,31 @@ static ssize_t request_reader_entries(
                 } else if (r == 0) {
 
                         if (m->follow) {
-                                r = sd_journal_wait(m->journal, (uint64_t) JOURNAL_WAIT_TIMEOUT);
+                                if (m->no_wait)
+                                        break;
+
+                                r = journal_watch_wait(&m->watch_generation, JOURNAL_WAIT_TIMEOUT);
                                 if (r < 0) {
-                                        log_error_errno(r, "Couldn't wait for journal event: %m");
-                                        return MHD_CONTENT_READER_END_WITH_ERROR;
+                                        r = sd_journal_wait(m->journal, (uint64_t) JOURNAL_WAIT_TIMEOUT);
+                                        if (r < 0) {
+                                                log_error_errno(r, "Couldn't wait for journal event: %m");
+                                                return MHD_CONTENT_READER_END_WITH_ERROR;
+                                        }
+                                        if (r == SD_JOURNAL_NOP)
+                                                break;
+
+                                        continue;
                                 }
-                                if (r == SD_JOURNAL_NOP)
+                                if (r == 0)
                                         break;
 
+                                /* Pick up new journal files, appended entries are visible anyway */
+                                r = sd_journal_process(m->journal);
+                                if (r < 0) {
+                                        log_error_errno(r, "Failed to process journal changes: %m");
+                                        return MHD_CONTENT_READER_END_WITH_ERROR;
+                                }
+
                                 continue;
                         }
 
@@ -241,8 +558,19 @@ static ssize_t request_reader_entries(
                         return MHD_CONTENT_READER_END_WITH_ERROR;
                 }
 
-                r = show_journal_entry(m->tmp, m->journal, m->mode, 0, OUTPUT_FULL_WIDTH,
-                                   NULL, NULL, NULL, &previous_ts, &previous_boot_id);
+                if (m->mode == OUTPUT_EXPORT_BINARY) {
+                        if (!m->exporter) {
+                                r = journal_binary_exporter_new(COMPRESSION_NONE, &m->exporter);
+                                if (r < 0) {
+                                        log_error_errno(r, "Failed to set up binary export: %m");
+                                        return MHD_CONTENT_READER_END_WITH_ERROR;
+                                }
+                        }
+
+                        r = journal_binary_exporter_add(m->exporter, m->tmp, m->journal, NULL);
+                } else
+                        r = show_journal_entry(m->tmp, m->journal, m->mode, 0, OUTPUT_FULL_WIDTH,
+                                               NULL, NULL, NULL, &previous_ts, &previous_boot_id);
                 if (r < 0) {
                         log_error_errno(r, "Failed to serialize item: %m");
                         return MHD_CONTENT_READER_END_WITH_ERROR;
@@ -302,12 +630,170 @@ static int request_parse_accept(
                 m->mode = OUTPUT_JSON_SEQ;
         else if (streq(header, mime_types[OUTPUT_EXPORT]))
                 m->mode = OUTPUT_EXPORT;
+        else if (streq(header, mime_types[OUTPUT_EXPORT_BINARY]))
+                m->mode = OUTPUT_EXPORT_BINARY;
         else
                 m->mode = OUTPUT_SHORT;
 
         return 0;
 }
 
+static int request_parse_accept_encoding(
+                RequestMeta *m,
+                struct MHD_Connection *connection) {
+
+        const char *header;
+        int r;
+
+        assert(m);
+        assert(connection);
+
+        header = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, "Accept-Encoding");
+        if (!header)
+                return 0;
+
+        for (const char *p = header;;) {
+                _cleanup_free_ char *word = NULL;
+                char *params;
+
+                r = extract_first_word(&p, &word, ",", 0);
+                if (r < 0)
+                        return r;
+                if (r == 0)
+                        return 0;
+
+                params = strchr(word, ';');
+                if (params)
+                        *params++ = '\0';
+
+                if (!strcaseeq(strstrip(word), "zstd"))
+                        continue;
+
+                if (params) {
+                        const char *q;
+
+                        /* A quality of zero means "not acceptable" */
+                        q = startswith(strstrip(params), "q=");
+                        if (q && q[strspn(q, "0.")] == '\0')
+                                continue;
+                }
+
+                /* Not being able to compress is not fatal, the response is simply sent as is */
+                r = compressor_new(COMPRESSION_ZSTD, &m->compressor);
+                if (r < 0)
+                        log_debug_errno(r, "Failed to set up response compression, ignoring: %m");
+
+                return 0;
+        }
+}
+
+static int request_compressed_append(const void *data, size_t size, void *userdata) {
+        RequestMeta *m = ASSERT_PTR(userdata);
+
+        if (!GREEDY_REALLOC(m->compressed, m->compressed_size + size))
+                return -ENOMEM;
+
+        memcpy(m->compressed + m->compressed_size, data, size);
+        m->compressed_size += size;
+        return 0;
+}
+
+static ssize_t request_reader_compressed(
+                void *cls,
+                uint64_t pos,
+                char *buf,
+                size_t max) {
+
+        RequestMeta *m = ASSERT_PTR(cls);
+        size_t n;
+        int r;
+
+        assert(buf);
+        assert(max > 0);
+        assert(m->compressor);
+        assert(m->reader);
+
+        while (m->compressed_pos >= m->compressed_size) {
+                size_t raw_size = 0;
+                bool end = false;
+
+                if (m->compressed_end)
+                        return MHD_CONTENT_READER_END_OF_STREAM;
+
+                m->compressed_size = m->compressed_pos = 0;
+
+                if (!m->raw) {
+                        m->raw = malloc(COMPRESS_BATCH_SIZE);
+                        if (!m->raw) {
+                                log_oom();
+                                return MHD_CONTENT_READER_END_WITH_ERROR;
+                        }
+                }
+
+                /* Collect as much output as is available right away, and in follow mode only wait for new
+                 * entries as long as nothing was collected yet, so that they are not held back. */
+                while (raw_size < COMPRESS_BATCH_SIZE) {
+                        ssize_t k;
+
+                        m->no_wait = raw_size > 0;
+                        k = m->reader(m, m->reader_pos, m->raw + raw_size, COMPRESS_BATCH_SIZE - raw_size);
+                        if (k == MHD_CONTENT_READER_END_WITH_ERROR)
+                                return k;
+                        if (k == MHD_CONTENT_READER_END_OF_STREAM) {
+                                end = true;
+                                break;
+                        }
+                        if (k == 0)
+                                break;
+
+                        m->reader_pos += k;
+                        raw_size += k;
+                }
+
+                if (raw_size == 0 && !end)
+                        return 0;
+
+                r = compressor_push(m->compressor, m->raw, raw_size, end, request_compressed_append, m);
+                if (r < 0) {
+                        log_error_errno(r, "Failed to compress response: %m");
+                        return MHD_CONTENT_READER_END_WITH_ERROR;
+                }
+
+                m->compressed_end = end;
+        }
+
+        n = MIN(max, m->compressed_size - m->compressed_pos);
+        memcpy(buf, m->compressed + m->compressed_pos, n);
+        m->compressed_pos += n;
+
+        return (ssize_t) n;
+}
+
+static struct MHD_Response* request_create_response(RequestMeta *m, MHD_ContentReaderCallback reader) {
+        _cleanup_(MHD_destroy_responsep) struct MHD_Response *response = NULL;
+
+        assert(m);
+        assert(reader);
+
+        if (!m->compressor)
+                response = MHD_create_response_from_callback(MHD_SIZE_UNKNOWN, 4*1024, reader, m, NULL);
+        else {
+                m->reader = reader;
+                response = MHD_create_response_from_callback(MHD_SIZE_UNKNOWN, 4*1024, request_reader_compressed, m, NULL);
+        }
+        if (!response)
+                return NULL;
+
+        if (MHD_add_response_header(response, "Vary", "Accept-Encoding") == MHD_NO)
+                return NULL;
+
+        if (m->compressor &&
+            MHD_add_response_header(response, "Content-Encoding", compression_lowercase_to_string(COMPRESSION_ZSTD)) == MHD_NO)
+                return NULL;
+
+        return TAKE_PTR(response);
+}
+
 static int request_parse_range_skip_and_n_entries(
                 RequestMeta *m,
                 const char *colon) {
@@ -515,18 +1001,12 @@ static mhd_result request_parse_arguments_iterator(
                         }
                 }
 
-                if (r) {
-                        r = add_match_boot_id(m->journal, SD_ID128_NULL);
-                        if (r < 0) {
-                                m->argument_parse_error = r;
-                                return MHD_NO;
-                        }
-                }
-
+                m->boot = r;
                 return MHD_YES;
         }
 
-        r = journal_add_match_pair(m->journal, key, strempty(value));
+        /* The matches are installed once the journal is opened, see request_install_filter() */
+        r = strv_extend_many(&m->matches, key, strempty(value));
         if (r < 0) {
                 m->argument_parse_error = r;
                 return MHD_NO;
@@ -558,19 +1038,25 @@ static int request_handler_entries(
 
         assert(connection);
 
-        r = open_journal(m);
-        if (r < 0)
-                return mhd_respondf(connection, r, MHD_HTTP_INTERNAL_SERVER_ERROR, "Failed to open journal: %m");
-
         if (request_parse_accept(m, connection) < 0)
                 return mhd_respond(connection, MHD_HTTP_BAD_REQUEST, "Failed to parse Accept header.");
 
+        if (request_parse_accept_encoding(m, connection) < 0)
+                return mhd_respond(connection, MHD_HTTP_BAD_REQUEST, "Failed to parse Accept-Encoding header.");
+
         if (request_parse_range(m, connection) < 0)
                 return mhd_respond(connection, MHD_HTTP_BAD_REQUEST, "Failed to parse Range header.");
 
         if (request_parse_arguments(m, connection) < 0)
                 return mhd_respond(connection, MHD_HTTP_BAD_REQUEST, "Failed to parse URL arguments.");
 
+        r = open_journal(m);
+        if (r < 0)
+                return mhd_respondf(connection, r, MHD_HTTP_INTERNAL_SERVER_ERROR, "Failed to open journal: %m");
+
+        if (request_install_filter(m) < 0)
+                return mhd_respond(connection, MHD_HTTP_BAD_REQUEST, "Failed to parse URL arguments.");
+
         if (m->discrete) {
                 if (!m->cursor)
                         return mhd_respond(connection, MHD_HTTP_BAD_REQUEST, "Discrete seeks require a cursor specification.");
@@ -593,7 +1079,7 @@ static int request_handler_entries(
         if (r < 0)
                 return mhd_respond(connection, MHD_HTTP_BAD_REQUEST, "Failed to seek in journal.");
 
-        response = MHD_create_response_from_callback(MHD_SIZE_UNKNOWN, 4*1024, request_reader_entries, m, NULL);
+        response = request_create_response(m, request_reader_entries);
         if (!response)
                 return respond_oom(connection);
 
@@ -717,11 +1203,14 @@ static int request_handler_fields(
         if (request_parse_accept(m, connection) < 0)
                 return mhd_respond(connection, MHD_HTTP_BAD_REQUEST, "Failed to parse Accept header.");
 
+        if (request_parse_accept_encoding(m, connection) < 0)
+                return mhd_respond(connection, MHD_HTTP_BAD_REQUEST, "Failed to parse Accept-Encoding header.");
+
         r = sd_journal_query_unique(m->journal, field);
         if (r < 0)
                 return mhd_respond(connection, MHD_HTTP_BAD_REQUEST, "Failed to query unique fields.");
 
-        response = MHD_create_response_from_callback(MHD_SIZE_UNKNOWN, 4*1024, request_reader_fields, m, NULL);
+        response = request_create_response(m, request_reader_fields);
         if (!response)
                 return respond_oom(connection);
 
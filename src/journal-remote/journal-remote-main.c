@@ -6,6 +6,7 @@
 #include "sd-daemon.h"
 
 #include "build.h"
+#include "compress.h"
 #include "conf-parser.h"
 #include "constants.h"
 #include "daemon-util.h"
@@ -26,12 +27,15 @@
 #include "socket-util.h"
 #include "stat-util.h"
 #include "string-table.h"
+#include "string-util.h"
 #include "strv.h"
 
 #define PRIV_KEY_FILE CERTIFICATE_ROOT "/private/journal-remote.pem"
 #define CERT_FILE     CERTIFICATE_ROOT "/certs/journal-remote.pem"
 #define TRUST_FILE    CERTIFICATE_ROOT "/ca/trusted.pem"
 
+#define WORKERS_MAX 1024U
+
 static const char* arg_url = NULL;
 static const char* arg_getter = NULL;
 static const char* arg_listen_raw = NULL;
@@ -59,6 +63,7 @@ static uint64_t arg_max_use = UINT64_MAX;
 static uint64_t arg_max_size = UINT64_MAX;
 static uint64_t arg_n_max_files = UINT64_MAX;
 static uint64_t arg_keep_free = UINT64_MAX;
+static unsigned arg_workers = 1;
 
 STATIC_DESTRUCTOR_REGISTER(arg_gnutls_log, strv_freep);
 STATIC_DESTRUCTOR_REGISTER(arg_key, freep);
@@ -197,6 +202,25 @@ static void request_meta_free(void *cls,
         }
 }
 
+static int process_http_upload_data(const void *data, size_t size, void *userdata) {
+        RemoteSource *source = ASSERT_PTR(userdata);
+        int r;
+
+        if (size > 0) {
+                r = journal_importer_push_data(&source->importer, data, size);
+                if (r < 0)
+                        return r;
+        }
+
+        for (;;) {
+                r = process_source(source, journal_remote_server_global->file_flags);
+                if (r == -EAGAIN)
+                        return 0;
+                if (r < 0)
+                        return r;
+        }
+}
+
 static int process_http_upload(
                 struct MHD_Connection *connection,
                 const char *upload_data,
@@ -215,31 +239,32 @@ static int process_http_upload(
         if (*upload_data_size) {
                 log_trace("Received %zu bytes", *upload_data_size);
 
-                r = journal_importer_push_data(&source->importer,
-                                               upload_data, *upload_data_size);
-                if (r < 0)
-                        return mhd_respond_oom(connection);
+                /* Compressed data is decoded piecewise, so that the decoded stream is never buffered in full */
+                if (source->decompressor)
+                        r = decompressor_push(source->decompressor,
+                                              upload_data, *upload_data_size,
+                                              process_http_upload_data, source);
+                else
+                        r = process_http_upload_data(upload_data, *upload_data_size, source);
 
                 *upload_data_size = 0;
-        } else
+        } else {
+                r = process_http_upload_data(NULL, 0, source);
                 finished = true;
-
-        for (;;) {
-                r = process_source(source, journal_remote_server_global->file_flags);
-                if (r == -EAGAIN)
-                        break;
-                if (r < 0) {
-                        if (r == -ENOBUFS)
-                                log_warning_errno(r, "Entry is above the maximum of %u, aborting connection %p.",
-                                                  DATA_SIZE_MAX, connection);
-                        else if (r == -E2BIG)
-                                log_warning_errno(r, "Entry with more fields than the maximum of %u, aborting connection %p.",
-                                                  ENTRY_FIELD_COUNT_MAX, connection);
-                        else
-                                log_warning_errno(r, "Failed to process data, aborting connection %p: %m",
-                                                  connection);
-                        return MHD_NO;
-                }
+        }
+        if (r == -ENOMEM)
+                return mhd_respond_oom(connection);
+        if (r < 0) {
+                if (r == -ENOBUFS)
+                        log_warning_errno(r, "Entry is above the maximum of %u, aborting connection %p.",
+                                          DATA_SIZE_MAX, connection);
+                else if (r == -E2BIG)
+                        log_warning_errno(r, "Entry with more fields than the maximum of %u, aborting connection %p.",
+                                          ENTRY_FIELD_COUNT_MAX, connection);
+                else
+                        log_warning_errno(r, "Failed to process data, aborting connection %p: %m",
+                                          connection);
+                return MHD_NO;
         }
 
         if (!finished)
@@ -272,6 +297,7 @@ static mhd_result request_handler(
         const char *header;
         int r, code, fd;
         _cleanup_free_ char *hostname = NULL;
+        Compression compression = COMPRESSION_NONE;
         bool chunked = false;
 
         assert(connection);
@@ -292,8 +318,9 @@ static mhd_result request_handler(
         if (!streq(url, "/upload"))
                 return mhd_respond(connection, MHD_HTTP_NOT_FOUND, "Not found.");
 
+        /* The importer tells the text and the binary format apart by itself */
         header = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, "Content-Type");
-        if (!header || !streq(header, "application/vnd.fdo.journal"))
+        if (!header || !STR_IN_SET(header, "application/vnd.fdo.journal", "application/vnd.fdo.journal.binary"))
                 return mhd_respond(connection, MHD_HTTP_UNSUPPORTED_MEDIA_TYPE,
                                    "Content-Type: application/vnd.fdo.journal is required.");
 
@@ -306,6 +333,14 @@ static mhd_result request_handler(
                 chunked = true;
         }
 
+        header = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, "Content-Encoding");
+        if (header && !strcaseeq(header, "identity")) {
+                compression = compression_lowercase_from_string(ascii_strlower(strdupa_safe(header)));
+                if (!IN_SET(compression, COMPRESSION_NONE, COMPRESSION_ZSTD) || !compression_supported(compression))
+                        return mhd_respondf(connection, 0, MHD_HTTP_UNSUPPORTED_MEDIA_TYPE,
+                                            "Unsupported Content-Encoding type: %s", header);
+        }
+
         header = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, "Content-Length");
         if (header) {
                 size_t len;
@@ -362,9 +397,59 @@ static mhd_result request_handler(
                 return mhd_respondf(connection, r, MHD_HTTP_INTERNAL_SERVER_ERROR, "%m");
 
         hostname = NULL;
+
+        if (compression != COMPRESSION_NONE) {
+                RemoteSource *source = *connection_cls;
+
+                r = decompressor_new(compression, &source->decompressor);
+                if (r == -ENOMEM)
+                        return respond_oom(connection);
+                if (r < 0)
+                        return mhd_respondf(connection, r, MHD_HTTP_INTERNAL_SERVER_ERROR,
+                                            "Failed to set up decompression: %m");
+        }
+
         return MHD_YES;
 }
 
+static int setup_microhttpd_event(RemoteServer *s, MHDDaemonWrapper *d) {
+        const union MHD_DaemonInfo *info;
+        int r, epoll_fd;
+
+        assert(s);
+        assert(d);
+
+        info = MHD_get_daemon_info(d->daemon, MHD_DAEMON_INFO_EPOLL_FD_LINUX_ONLY);
+        if (!info)
+                return log_error_errno(SYNTHETIC_ERRNO(EOPNOTSUPP), "μhttp returned NULL daemon info");
+
+        epoll_fd = info->listen_fd;
+        if (epoll_fd < 0)
+                return log_error_errno(SYNTHETIC_ERRNO(EUCLEAN), "μhttp epoll fd is invalid");
+
+        r = sd_event_add_io(s->event, &d->io_event,
+                            epoll_fd, EPOLLIN,
+                            dispatch_http_event, d);
+        if (r < 0)
+                return log_error_errno(r, "Failed to add event callback: %m");
+
+        r = sd_event_source_set_description(d->io_event, "io_event");
+        if (r < 0)
+                return log_error_errno(r, "Failed to set source name: %m");
+
+        r = sd_event_add_time(s->event, &d->timer_event,
+                              CLOCK_MONOTONIC, UINT64_MAX, 0,
+                              null_timer_event_handler, d);
+        if (r < 0)
+                return log_error_errno(r, "Failed to add timer_event: %m");
+
+        r = sd_event_source_set_description(d->timer_event, "timer_event");
+        if (r < 0)
+                return log_error_errno(r, "Failed to set source name: %m");
+
+        return 0;
+}
+
 static int setup_microhttpd_server(RemoteServer *s,
                                    int fd,
                                    const char *key,
@@ -379,6 +464,7 @@ static int setup_microhttpd_server(RemoteServer *s,
                 { MHD_OPTION_END},
                 { MHD_OPTION_END},
                 { MHD_OPTION_END},
+                { MHD_OPTION_END},
                 { MHD_OPTION_END}};
         int opts_pos = 4;
         int flags =
@@ -388,8 +474,7 @@ static int setup_microhttpd_server(RemoteServer *s,
                 MHD_USE_ITC;
 
         _cleanup_(MHDDaemonWrapper_freep) MHDDaemonWrapper *d = NULL;
-        const union MHD_DaemonInfo *info;
-        int r, epoll_fd;
+        int r;
 
         assert(fd >= 0);
 
@@ -426,7 +511,17 @@ static int setup_microhttpd_server(RemoteServer *s,
                                 {MHD_OPTION_HTTPS_MEM_TRUST, 0, (char*) trust};
         }
 
-        d = new(MHDDaemonWrapper, 1);
+        if (s->n_workers > 1) {
+                /* Let μhttpd handle the connections in a pool of threads, each with its own epoll
+                 * instance. A connection stays with the thread that accepted it, hence with
+                 * SplitMode=host the uploads from different hosts are parsed and written in parallel. */
+                opts[opts_pos++] = (struct MHD_OptionItem)
+                        {MHD_OPTION_THREAD_POOL_SIZE, s->n_workers};
+
+                flags |= MHD_USE_INTERNAL_POLLING_THREAD;
+        }
+
+        d = new0(MHDDaemonWrapper, 1);
         if (!d)
                 return log_oom();
 
@@ -440,36 +535,15 @@ static int setup_microhttpd_server(RemoteServer *s,
         if (!d->daemon)
                 return log_error_errno(SYNTHETIC_ERRNO(EINVAL), "Failed to start μhttp daemon");
 
-        log_debug("Started MHD %s daemon on fd:%d (wrapper @ %p)",
-                  key ? "HTTPS" : "HTTP", fd, d);
-
-        info = MHD_get_daemon_info(d->daemon, MHD_DAEMON_INFO_EPOLL_FD_LINUX_ONLY);
-        if (!info)
-                return log_error_errno(SYNTHETIC_ERRNO(EOPNOTSUPP), "μhttp returned NULL daemon info");
-
-        epoll_fd = info->listen_fd;
-        if (epoll_fd < 0)
-                return log_error_errno(SYNTHETIC_ERRNO(EUCLEAN), "μhttp epoll fd is invalid");
-
-        r = sd_event_add_io(s->event, &d->io_event,
-                            epoll_fd, EPOLLIN,
-                            dispatch_http_event, d);
-        if (r < 0)
-                return log_error_errno(r, "Failed to add event callback: %m");
-
-        r = sd_event_source_set_description(d->io_event, "io_event");
-        if (r < 0)
-                return log_error_errno(r, "Failed to set source name: %m");
-
-        r = sd_event_add_time(s->event, &d->timer_event,
-                              CLOCK_MONOTONIC, UINT64_MAX, 0,
-                              null_timer_event_handler, d);
-        if (r < 0)
-                return log_error_errno(r, "Failed to add timer_event: %m");
+        log_debug("Started MHD %s daemon on fd:%d with %u worker threads (wrapper @ %p)",
+                  key ? "HTTPS" : "HTTP", fd, s->n_workers > 1 ? s->n_workers : 0, d);
 
-        r = sd_event_source_set_description(d->timer_event, "timer_event");
-        if (r < 0)
-                return log_error_errno(r, "Failed to set source name: %m");
+        if (s->n_workers <= 1) {
+                /* Otherwise μhttpd runs its own threads, and there is nothing to hook into our event loop */
+                r = setup_microhttpd_event(s, d);
+                if (r < 0)
+                        return r;
+        }
 
         r = hashmap_ensure_put(&s->daemons, &uint64_hash_ops, &d->fd, d);
         if (r == -ENOMEM)
@@ -725,6 +799,7 @@ static int parse_config(void) {
                 { "Remote",  "MaxFileSize",            config_parse_iec_uint64,       0, &arg_max_size    },
                 { "Remote",  "MaxFiles",               config_parse_uint64,           0, &arg_n_max_files },
                 { "Remote",  "KeepFree",               config_parse_iec_uint64,       0, &arg_keep_free   },
+                { "Remote",  "Workers",                config_parse_unsigned,         0, &arg_workers     },
                 {}
         };
 
@@ -765,6 +840,7 @@ static int help(void) {
                "     --gnutls-log=CATEGORY...\n"
                "                            Specify a list of gnutls logging categories\n"
                "     --split-mode=none|host How many output files to create\n"
+               "     --workers=N            Number of threads handling HTTP(S) uploads\n"
                "\nNote: file descriptors from sd_listen_fds() will be consumed, too.\n"
                "\nSee the %s for details.\n",
                program_invocation_short_name,
@@ -788,6 +864,7 @@ static int parse_argv(int argc, char *argv[]) {
                 ARG_CERT,
                 ARG_TRUST,
                 ARG_GNUTLS_LOG,
+                ARG_WORKERS,
         };
 
         static const struct option options[] = {
@@ -806,6 +883,7 @@ static int parse_argv(int argc, char *argv[]) {
                 { "cert",         required_argument, NULL, ARG_CERT         },
                 { "trust",        required_argument, NULL, ARG_TRUST        },
                 { "gnutls-log",   required_argument, NULL, ARG_GNUTLS_LOG   },
+                { "workers",      required_argument, NULL, ARG_WORKERS      },
                 {}
         };
 
@@ -960,6 +1038,12 @@ static int parse_argv(int argc, char *argv[]) {
                                                "Option --gnutls-log= is not available.");
 #endif
 
+                case ARG_WORKERS:
+                        r = safe_atou(optarg, &arg_workers);
+                        if (r < 0)
+                                return log_error_errno(r, "Failed to parse --workers= argument: %s", optarg);
+                        break;
+
                 case '?':
                         return -EINVAL;
 
@@ -1008,13 +1092,18 @@ static int parse_argv(int argc, char *argv[]) {
                 return log_error_errno(SYNTHETIC_ERRNO(EINVAL),
                                        "For SplitMode=host, output must be a directory.");
 
+        if (arg_workers < 1 || arg_workers > WORKERS_MAX)
+                return log_error_errno(SYNTHETIC_ERRNO(EINVAL),
+                                       "Number of workers must be between 1 and %u.", WORKERS_MAX);
+
         if (STRPTR_IN_SET(arg_trust, "-", "all")) {
                 arg_trust_all = true;
                 arg_trust = mfree(arg_trust);
         }
 
-        log_debug("Full config: SplitMode=%s Key=%s Cert=%s Trust=%s",
+        log_debug("Full config: SplitMode=%s Workers=%u Key=%s Cert=%s Trust=%s",
                   journal_write_split_mode_to_string(arg_split_mode),
+                  arg_workers,
                   strna(arg_key),
                   strna(arg_cert),
                   strna(arg_trust));
@@ -1105,6 +1194,8 @@ static int run(int argc, char **argv) {
         s.metrics.keep_free = arg_keep_free;
         s.metrics.n_max_files = arg_n_max_files;
 
+        s.n_workers = arg_workers;
+
         r = create_remoteserver(&s, key, cert, trust);
         if (r < 0)
                 return r;
@@ -1135,9 +1226,10 @@ static int run(int argc, char **argv) {
         notify_message = NULL;
         (void) sd_notifyf(false,
                           "STOPPING=1\n"
-                          "STATUS=Shutting down after writing %" PRIu64 " entries...", s.event_count);
+                          "STATUS=Shutting down after writing %" PRIu64 " entries...",
+                          __atomic_load_n(&s.event_count, __ATOMIC_RELAXED));
 
-        log_info("Finishing after writing %" PRIu64 " entries", s.event_count);
+        log_info("Finishing after writing %" PRIu64 " entries", __atomic_load_n(&s.event_count, __ATOMIC_RELAXED));
 
         return 0;
 }
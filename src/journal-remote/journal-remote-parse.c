@@ -11,6 +11,7 @@ void source_free(RemoteSource *source) {
                 return;
 
         journal_importer_cleanup(&source->importer);
+        decompressor_free(source->decompressor);
 
         log_debug("Writer ref count %u", source->writer->n_ref);
         writer_unref(source->writer);
@@ -53,8 +54,16 @@ int process_source(RemoteSource *source, JournalFileFlags file_flags) {
         assert(source->writer);
 
         r = journal_importer_process_data(&source->importer);
-        if (r <= 0)
+        if (r <= 0) {
+                int k;
+
+                /* No complete entry is buffered anymore, hence write out what was queued so far. */
+                k = writer_flush(source->writer, file_flags);
+                if (k < 0)
+                        return log_error_errno(k, "Failed to write entries: %m");
+
                 return r;
+        }
 
         /* We have a full event */
         log_trace("Received full event from source@%p fd:%d (%s)",
@@ -3,6 +3,8 @@
 
 #include "sd-event.h"
 
+#include "compress.h"
+
 #include "journal-importer.h"
 #include "journal-remote-write.h"
 
@@ -11,6 +13,9 @@ typedef struct RemoteSource {
 
         Writer *writer;
 
+        /* Set if the HTTP upload is sent with a Content-Encoding */
+        Decompressor *decompressor;
+
         sd_event_source *event;
         sd_event_source *buffer_event;
 } RemoteSource;
@@ -3,15 +3,25 @@
 #include <libgen.h>
 
 #include "alloc-util.h"
+#include "iovec-util.h"
 #include "journal-file-util.h"
 #include "journal-remote.h"
+#include "memory-util.h"
 #include "path-util.h"
 #include "stat-util.h"
 
+/* Maximum number of entries, and their accumulated size, to queue before writing them out */
+#define WRITER_PENDING_MAX 256U
+#define WRITER_PENDING_SIZE_MAX (4U*1024U*1024U)
+
+/* Keep data buffers up to this size allocated between flushes. There may be one writer per remote
+ * host, hence not all of them should hang on to a buffer for a full batch. */
+#define WRITER_PENDING_KEEP_SIZE (64U*1024U)
+
 static int do_rotate(JournalFile **f, MMapCache *m, JournalFileFlags file_flags) {
         int r;
 
-        r = journal_file_rotate(f, m, file_flags, UINT64_MAX, NULL);
+        r = journal_file_rotate(f, m, file_flags, UINT64_MAX, NULL, NULL);
         if (r < 0) {
                 if (*f)
                         log_error_errno(r, "Failed to rotate %s: %m", (*f)->path);
@@ -22,6 +32,24 @@ static int do_rotate(JournalFile **f, MMapCache *m, JournalFileFlags file_flags)
         return r;
 }
 
+static int writer_vacuum(Writer *w) {
+        int r;
+
+        assert(w);
+
+        /* The writers for all hosts share the output directory, hence let's not vacuum it from several
+         * worker threads at once. */
+        if (w->server)
+                assert_se(pthread_mutex_lock(&w->server->vacuum_lock) == 0);
+
+        r = journal_directory_vacuum(w->output, w->metrics.max_use, w->metrics.n_max_files, 0, NULL, /* verbose = */ true);
+
+        if (w->server)
+                assert_se(pthread_mutex_unlock(&w->server->vacuum_lock) == 0);
+
+        return r;
+}
+
 int writer_new(RemoteServer *server, Writer **ret) {
         _cleanup_(writer_unrefp) Writer *w = NULL;
         int r;
@@ -34,6 +62,7 @@ int writer_new(RemoteServer *server, Writer **ret) {
                 return -ENOMEM;
 
         *w = (Writer) {
+                .mutex = PTHREAD_MUTEX_INITIALIZER,
                 .n_ref = 1,
                 .metrics = server->metrics,
                 .server = server,
@@ -57,11 +86,25 @@ int writer_new(RemoteServer *server, Writer **ret) {
         return 0;
 }
 
+static void writer_drop_pending(Writer *w) {
+        assert(w);
+
+        if (MALLOC_SIZEOF_SAFE(w->pending_data) > WRITER_PENDING_KEEP_SIZE)
+                w->pending_data = mfree(w->pending_data);
+
+        w->n_pending = 0;
+        w->n_pending_iovec = 0;
+        w->pending_size = 0;
+}
+
 static Writer* writer_free(Writer *w) {
         if (!w)
                 return NULL;
 
         if (w->journal) {
+                if (w->server)
+                        (void) writer_flush(w, w->server->file_flags);
+
                 log_debug("Closing journal file %s.", w->journal->path);
                 journal_file_offline_close(w->journal);
         }
@@ -76,73 +119,205 @@ static Writer* writer_free(Writer *w) {
 
         free(w->output);
 
+        free(w->pending);
+        free(w->pending_iovec);
+        free(w->pending_data);
+        free(w->append_entries);
+
+        assert_se(pthread_mutex_destroy(&w->mutex) == 0);
+
         return mfree(w);
 }
 
-DEFINE_TRIVIAL_REF_UNREF_FUNC(Writer, writer, writer_free);
+Writer* writer_ref_locked(Writer *w) {
+        if (!w)
+                return NULL;
+
+        assert(w->n_ref > 0);
+        w->n_ref++;
+
+        return w;
+}
+
+Writer* writer_unref_locked(Writer *w) {
+        if (!w)
+                return NULL;
+
+        assert(w->n_ref > 0);
+        if (--w->n_ref > 0)
+                return NULL;
+
+        /* This removes the writer from the hashmap, which is why the server lock is needed */
+        return writer_free(w);
+}
+
+Writer* writer_unref(Writer *w) {
+        RemoteServer *s;
+
+        if (!w)
+                return NULL;
+
+        s = w->server;
+        if (!s)
+                return writer_unref_locked(w);
+
+        assert_se(pthread_mutex_lock(&s->lock) == 0);
+        writer_unref_locked(w);
+        assert_se(pthread_mutex_unlock(&s->lock) == 0);
+
+        return NULL;
+}
+
+static int writer_flush_locked(Writer *w, JournalFileFlags file_flags) {
+        JournalAppendEntry *entries;
+        bool rotated = false;
+        size_t i = 0;
+        int r = 0;
+
+        assert(w);
+
+        if (w->n_pending == 0)
+                return 0;
+
+        if (!GREEDY_REALLOC(w->append_entries, w->n_pending)) {
+                r = -ENOMEM;
+                goto finish;
+        }
+        entries = w->append_entries;
+
+        /* The data buffer does not move anymore, resolve the offsets */
+        FOREACH_ARRAY(iovec, w->pending_iovec, w->n_pending_iovec)
+                iovec->iov_base = w->pending_data + (uintptr_t) iovec->iov_base;
+
+        for (size_t k = 0; k < w->n_pending; k++)
+                entries[k] = (JournalAppendEntry) {
+                        .ts = &w->pending[k].ts,
+                        .boot_id = &w->pending[k].boot_id,
+                        .iovec = w->pending_iovec + w->pending[k].first_iovec,
+                        .n_iovec = w->pending[k].n_iovec,
+                };
+
+        while (i < w->n_pending) {
+                size_t n = 0;
+
+                if (journal_file_rotate_suggested(w->journal, 0, LOG_DEBUG)) {
+                        log_info("%s: Journal header limits reached or header out-of-date, rotating",
+                                 w->journal->path);
+                        r = do_rotate(&w->journal, w->mmap, file_flags);
+                        if (r < 0)
+                                goto finish;
+                        r = writer_vacuum(w);
+                        if (r < 0)
+                                goto finish;
+                }
+
+                r = journal_file_append_entries(
+                                w->journal,
+                                entries + i,
+                                w->n_pending - i,
+                                &w->seqnum,
+                                /* seqnum_id= */ NULL,
+                                &n);
+                i += n;
+                if (w->server)
+                        __atomic_add_fetch(&w->server->event_count, n, __ATOMIC_RELAXED);
+                if (r >= 0)
+                        break;
+                if (n > 0)
+                        rotated = false;
+
+                /* Invalid entries are skipped right away, and so is an entry that we already failed to
+                 * write once after rotating. */
+                if (r == -EBADMSG || rotated) {
+                        if (!IN_SET(r, -EBADMSG, -EADDRNOTAVAIL))
+                                goto finish;
+
+                        log_warning_errno(r, "Entry is invalid, ignoring.");
+                        i++;
+                        rotated = false;
+                        continue;
+                }
+
+                log_debug_errno(r, "%s: Write failed, rotating: %m", w->journal->path);
+                r = do_rotate(&w->journal, w->mmap, file_flags);
+                if (r < 0)
+                        goto finish;
+                else
+                        log_debug("%s: Successfully rotated journal", w->journal->path);
+                r = writer_vacuum(w);
+                if (r < 0)
+                        goto finish;
+
+                log_debug("Retrying write.");
+                rotated = true;
+        }
+
+        r = 0;
+
+finish:
+        writer_drop_pending(w);
+        return r;
+}
+
+int writer_flush(Writer *w, JournalFileFlags file_flags) {
+        int r;
+
+        assert(w);
+
+        assert_se(pthread_mutex_lock(&w->mutex) == 0);
+        r = writer_flush_locked(w, file_flags);
+        assert_se(pthread_mutex_unlock(&w->mutex) == 0);
+
+        return r;
+}
 
 int writer_write(Writer *w,
                  const struct iovec_wrapper *iovw,
                  const dual_timestamp *ts,
                  const sd_id128_t *boot_id,
                  JournalFileFlags file_flags) {
+        size_t size;
         int r;
 
         assert(w);
         assert(!iovw_isempty(iovw));
+        assert(ts);
+        assert(boot_id);
 
-        if (journal_file_rotate_suggested(w->journal, 0, LOG_DEBUG)) {
-                log_info("%s: Journal header limits reached or header out-of-date, rotating",
-                         w->journal->path);
-                r = do_rotate(&w->journal, w->mmap, file_flags);
-                if (r < 0)
-                        return r;
-                r = journal_directory_vacuum(w->output, w->metrics.max_use, w->metrics.n_max_files, 0, NULL, /* verbose = */ true);
-                if (r < 0)
-                        return r;
+        /* The entry is only queued here, and written together with the following ones, either once
+         * enough entries have been collected, or when the caller calls writer_flush() because no further
+         * data is immediately available. */
+
+        assert_se(pthread_mutex_lock(&w->mutex) == 0);
+
+        size = iovw_size(iovw);
+
+        if (!GREEDY_REALLOC(w->pending, w->n_pending + 1) ||
+            !GREEDY_REALLOC(w->pending_iovec, w->n_pending_iovec + iovw->count) ||
+            !GREEDY_REALLOC(w->pending_data, w->pending_size + size)) {
+                r = -ENOMEM;
+                goto finish;
         }
 
-        r = journal_file_append_entry(
-                        w->journal,
-                        ts,
-                        boot_id,
-                        iovw->iovec,
-                        iovw->count,
-                        &w->seqnum,
-                        /* seqnum_id= */ NULL,
-                        /* ret_object= */ NULL,
-                        /* ret_offset= */ NULL);
-        if (r >= 0) {
-                if (w->server)
-                        w->server->event_count += 1;
-                return 0;
-        } else if (r == -EBADMSG)
-                return r;
+        w->pending[w->n_pending++] = (WriterEntry) {
+                .first_iovec = w->n_pending_iovec,
+                .n_iovec = iovw->count,
+                .ts = *ts,
+                .boot_id = *boot_id,
+        };
 
-        log_debug_errno(r, "%s: Write failed, rotating: %m", w->journal->path);
-        r = do_rotate(&w->journal, w->mmap, file_flags);
-        if (r < 0)
-                return r;
+        FOREACH_ARRAY(iovec, iovw->iovec, iovw->count) {
+                memcpy_safe(w->pending_data + w->pending_size, iovec->iov_base, iovec->iov_len);
+                w->pending_iovec[w->n_pending_iovec++] = IOVEC_MAKE((void*) (uintptr_t) w->pending_size, iovec->iov_len);
+                w->pending_size += iovec->iov_len;
+        }
+
+        if (w->n_pending < WRITER_PENDING_MAX && w->pending_size < WRITER_PENDING_SIZE_MAX)
+                r = 0;
         else
-                log_debug("%s: Successfully rotated journal", w->journal->path);
-        r = journal_directory_vacuum(w->output, w->metrics.max_use, w->metrics.n_max_files, 0, NULL, /* verbose = */ true);
-        if (r < 0)
-                return r;
-
-        log_debug("Retrying write.");
-        r = journal_file_append_entry(
-                        w->journal,
-                        ts,
-                        boot_id,
-                        iovw->iovec, iovw->count,
-                        &w->seqnum,
-                        /* seqnum_id= */ NULL,
-                        /* ret_object= */ NULL,
-                        /* ret_offset= */ NULL);
-        if (r < 0)
-                return r;
+                r = writer_flush_locked(w, file_flags);
 
-        if (w->server)
-                w->server->event_count += 1;
-        return 0;
+finish:
+        assert_se(pthread_mutex_unlock(&w->mutex) == 0);
+        return r;
 }
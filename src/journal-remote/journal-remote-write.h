@@ -1,11 +1,20 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 #pragma once
 
+#include <pthread.h>
+
 #include "journal-file.h"
 #include "journal-importer.h"
 
 typedef struct RemoteServer RemoteServer;
 
+typedef struct WriterEntry {
+        size_t first_iovec;    /* index of the first field in Writer.pending_iovec */
+        size_t n_iovec;
+        dual_timestamp ts;
+        sd_id128_t boot_id;
+} WriterEntry;
+
 typedef struct Writer {
         JournalFile *journal;
         JournalMetrics metrics;
@@ -17,13 +26,34 @@ typedef struct Writer {
 
         uint64_t seqnum;
 
+        /* Entries that have been received but not written to the journal file yet, see writer_flush(). The
+         * field data of all of them is copied into one buffer, and the iovecs refer to it by offset until
+         * the entries are written. The buffers are kept around between flushes. */
+        WriterEntry *pending;
+        size_t n_pending;
+        struct iovec *pending_iovec;
+        size_t n_pending_iovec;
+        uint8_t *pending_data;
+        size_t pending_size;
+        JournalAppendEntry *append_entries;
+
+        /* Serializes writing, as the μhttpd connections sharing this writer may be handled by different
+         * worker threads, see RemoteServer.n_workers */
+        pthread_mutex_t mutex;
+
+        /* Protected by the server lock */
         unsigned n_ref;
 } Writer;
 
 int writer_new(RemoteServer *server, Writer **ret);
-Writer* writer_ref(Writer *w);
+
+/* The reference counter is protected by the server lock. The _locked() variants are for callers which
+ * hold it already. */
+Writer* writer_ref_locked(Writer *w);
+Writer* writer_unref_locked(Writer *w);
 Writer* writer_unref(Writer *w);
 
+DEFINE_TRIVIAL_CLEANUP_FUNC(Writer*, writer_unref_locked);
 DEFINE_TRIVIAL_CLEANUP_FUNC(Writer*, writer_unref);
 
 int writer_write(Writer *s,
@@ -31,6 +61,7 @@ int writer_write(Writer *s,
                  const dual_timestamp *ts,
                  const sd_id128_t *boot_id,
                  JournalFileFlags file_flags);
+int writer_flush(Writer *w, JournalFileFlags file_flags);
 
 typedef enum JournalWriteSplitMode {
         JOURNAL_WRITE_SPLIT_NONE,
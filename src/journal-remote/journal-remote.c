@@ -114,8 +114,8 @@ static int init_writer_hashmap(RemoteServer *s) {
         return 0;
 }
 
-int journal_remote_get_writer(RemoteServer *s, const char *host, Writer **writer) {
-        _cleanup_(writer_unrefp) Writer *w = NULL;
+static int get_writer_locked(RemoteServer *s, const char *host, Writer **writer) {
+        _cleanup_(writer_unref_lockedp) Writer *w = NULL;
         const void *key;
         int r;
 
@@ -138,7 +138,7 @@ int journal_remote_get_writer(RemoteServer *s, const char *host, Writer **writer
 
         w = hashmap_get(s->writers, key);
         if (w)
-                writer_ref(w);
+                writer_ref_locked(w);
         else {
                 r = writer_new(s, &w);
                 if (r < 0)
@@ -163,6 +163,20 @@ int journal_remote_get_writer(RemoteServer *s, const char *host, Writer **writer
         return 0;
 }
 
+int journal_remote_get_writer(RemoteServer *s, const char *host, Writer **writer) {
+        int r;
+
+        assert(s);
+
+        /* The writer for a new host is created and its output opened under the lock, so that concurrent
+         * uploads from the same host end up with the same writer. */
+        assert_se(pthread_mutex_lock(&s->lock) == 0);
+        r = get_writer_locked(s, host, writer);
+        assert_se(pthread_mutex_unlock(&s->lock) == 0);
+
+        return r;
+}
+
 /**********************************************************************
  **********************************************************************
  **********************************************************************/
@@ -335,6 +349,8 @@ int journal_remote_server_init(
         assert(journal_remote_server_global == NULL);
         journal_remote_server_global = s;
 
+        s->lock = (pthread_mutex_t) PTHREAD_MUTEX_INITIALIZER;
+        s->vacuum_lock = (pthread_mutex_t) PTHREAD_MUTEX_INITIALIZER;
         s->split_mode = split_mode;
         s->file_flags = file_flags;
 
@@ -378,6 +394,9 @@ void journal_remote_server_destroy(RemoteServer *s) {
         sd_event_source_unref(s->listen_event);
         sd_event_unref(s->event);
 
+        assert_se(pthread_mutex_destroy(&s->lock) == 0);
+        assert_se(pthread_mutex_destroy(&s->vacuum_lock) == 0);
+
         if (s == journal_remote_server_global)
                 journal_remote_server_global = NULL;
 
@@ -1,6 +1,8 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 #pragma once
 
+#include <pthread.h>
+
 #include "sd-event.h"
 
 #include "hashmap.h"
@@ -32,9 +34,17 @@ struct RemoteServer {
         sd_event *event;
         sd_event_source *listen_event;
 
+        /* Protects the writers hashmap and the reference counters of the writers in it, as the μhttpd
+         * request handlers run in a pool of threads if n_workers > 1 */
+        pthread_mutex_t lock;
         Hashmap *writers;
         Writer *_single_writer;
-        uint64_t event_count;
+        uint64_t event_count;                  /* updated atomically */
+
+        /* Serializes vacuuming of the output directory */
+        pthread_mutex_t vacuum_lock;
+
+        unsigned n_workers;
 
 #if HAVE_MICROHTTPD
         Hashmap *daemons;
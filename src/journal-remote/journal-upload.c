@@ -27,6 +27,7 @@
 #include "mkdir.h"
 #include "parse-argument.h"
 #include "parse-helpers.h"
+#include "parse-util.h"
 #include "pretty-print.h"
 #include "process-util.h"
 #include "rlimit-util.h"
@@ -58,6 +59,8 @@ static bool arg_merge = false;
 static int arg_follow = -1;
 static const char *arg_save_state = NULL;
 static usec_t arg_network_timeout_usec = USEC_INFINITY;
+static Compression arg_compression = COMPRESSION_NONE;
+static uint64_t arg_batch_size = 256 * 1024;
 
 STATIC_DESTRUCTOR_REGISTER(arg_file, strv_freep);
 
@@ -65,6 +68,11 @@ static void close_fd_input(Uploader *u);
 
 #define SERVER_ANSWER_KEEP 2048
 
+/* Entries are only split between batches if they do not fit into this much extra space */
+#define BATCH_SLACK (16U * 1024U)
+#define BATCH_SIZE_MIN (4U * 1024U)
+#define BATCH_SIZE_MAX (64U * 1024U * 1024U)
+
 #define STATE_FILE "/var/lib/systemd/journal-upload/state"
 
 #define easy_setopt(curl, opt, value, level, cmd)                       \
@@ -174,11 +182,85 @@ static int load_cursor_state(Uploader *u) {
         return 0;
 }
 
+static int fill_batch(Uploader *u) {
+        int r;
+
+        assert(u);
+        assert(u->input_callback);
+
+        u->batch_size = 0;
+        u->compressed_size = u->compressed_pos = 0;
+
+        if (!u->batch) {
+                u->batch_allocated = arg_batch_size + BATCH_SLACK;
+                u->batch = malloc(u->batch_allocated);
+                if (!u->batch)
+                        return log_oom();
+        }
+
+        /* Collect input until the batch is full or the input is exhausted for now. The journal input only
+         * returns less than requested when it is done or an entry did not fit, while fd input might be a
+         * pipe in follow mode, where we should not wait for more data once it was drained. */
+        while (u->uploading && u->batch_size < arg_batch_size) {
+                size_t avail = u->batch_allocated - u->batch_size, n;
+
+                n = u->input_callback(u->batch + u->batch_size, 1, avail, u->input_userdata);
+                if (n == CURL_READFUNC_ABORT)
+                        return -EIO;
+                if (n == 0)
+                        break;
+
+                assert(n <= avail);
+                u->batch_size += n;
+
+                if (!u->journal && n < avail)
+                        break;
+        }
+
+        if (u->batch_size == 0)
+                return 0;
+
+        if (!u->compressed) {
+                /* Large enough for what zstd produces for incompressible data */
+                u->compressed_allocated = u->batch_allocated + u->batch_allocated / 128 + 1024;
+                u->compressed = malloc(u->compressed_allocated);
+                if (!u->compressed)
+                        return log_oom();
+        }
+
+        r = compress_blob(u->compression, u->batch, u->batch_size,
+                          u->compressed, u->compressed_allocated, &u->compressed_size);
+        if (r < 0)
+                return log_error_errno(r, "Failed to compress %zu bytes of upload data: %m", u->batch_size);
+
+        log_debug("Compressed %zu bytes of upload data to %zu bytes.", u->batch_size, u->compressed_size);
+        return 0;
+}
+
+static size_t compressed_input_callback(void *buf, size_t size, size_t nmemb, void *userp) {
+        Uploader *u = ASSERT_PTR(userp);
+        size_t n;
+
+        assert(!size_multiply_overflow(size, nmemb));
+
+        if (u->compressed_pos >= u->compressed_size) {
+                if (fill_batch(u) < 0)
+                        return CURL_READFUNC_ABORT;
+
+                /* Nothing left, this ends the upload */
+                if (u->compressed_size == 0)
+                        return 0;
+        }
+
+        n = MIN(size * nmemb, u->compressed_size - u->compressed_pos);
+        memcpy(buf, u->compressed + u->compressed_pos, n);
+        u->compressed_pos += n;
+
+        return n;
+}
+
 int start_upload(Uploader *u,
-                 size_t (*input_callback)(void *ptr,
-                                          size_t size,
-                                          size_t nmemb,
-                                          void *userdata),
+                 upload_input_callback_t input_callback,
                  void *data) {
         CURLcode code;
 
@@ -203,6 +285,19 @@ int start_upload(Uploader *u,
                         return log_oom();
                 h = l;
 
+                if (u->compression != COMPRESSION_NONE) {
+                        _cleanup_free_ char *t = NULL;
+
+                        t = strjoin("Content-Encoding: ", compression_lowercase_to_string(u->compression));
+                        if (!t)
+                                return log_oom();
+
+                        l = curl_slist_append(h, t);
+                        if (!l)
+                                return log_oom();
+                        h = l;
+                }
+
                 u->header = TAKE_PTR(h);
         }
 
@@ -234,12 +329,20 @@ int start_upload(Uploader *u,
                 easy_setopt(curl, CURLOPT_WRITEDATA, data,
                             LOG_ERR, return -EXFULL);
 
-                /* set where to read from */
-                easy_setopt(curl, CURLOPT_READFUNCTION, input_callback,
-                            LOG_ERR, return -EXFULL);
+                /* set where to read from, compressed input is taken from the batch buffers */
+                if (u->compression != COMPRESSION_NONE) {
+                        easy_setopt(curl, CURLOPT_READFUNCTION, compressed_input_callback,
+                                    LOG_ERR, return -EXFULL);
 
-                easy_setopt(curl, CURLOPT_READDATA, data,
-                            LOG_ERR, return -EXFULL);
+                        easy_setopt(curl, CURLOPT_READDATA, u,
+                                    LOG_ERR, return -EXFULL);
+                } else {
+                        easy_setopt(curl, CURLOPT_READFUNCTION, input_callback,
+                                    LOG_ERR, return -EXFULL);
+
+                        easy_setopt(curl, CURLOPT_READDATA, data,
+                                    LOG_ERR, return -EXFULL);
+                }
 
                 /* use our special own mime type and chunked transfer */
                 easy_setopt(curl, CURLOPT_HTTPHEADER, u->header,
@@ -286,6 +389,10 @@ int start_upload(Uploader *u,
                                        "curl_easy_setopt CURLOPT_URL failed: %s",
                                        curl_easy_strerror(code));
 
+        u->input_callback = input_callback;
+        u->input_userdata = data;
+        u->batch_size = u->compressed_size = u->compressed_pos = 0;
+
         u->uploading = true;
 
         return 0;
@@ -389,6 +496,7 @@ static int setup_uploader(Uploader *u, const char *url, const char *state_file)
 
         *u = (Uploader) {
                 .input = -1,
+                .compression = arg_compression,
         };
 
         host = STARTSWITH_SET(url, "http://", "https://");
@@ -435,6 +543,9 @@ static void destroy_uploader(Uploader *u) {
         curl_slist_free_all(u->header);
         free(u->answer);
 
+        free(u->batch);
+        free(u->compressed);
+
         free(u->last_cursor);
         free(u->current_cursor);
 
@@ -489,6 +600,9 @@ static int perform_upload(Uploader *u) {
         return update_cursor_state(u);
 }
 
+static DEFINE_CONFIG_PARSE_ENUM(config_parse_upload_compression, compression_lowercase, Compression,
+                                "Failed to parse compression");
+
 static int parse_config(void) {
         const ConfigTableItem items[] = {
                 { "Upload",  "URL",                    config_parse_string,         CONFIG_PARSE_STRING_SAFE, &arg_url                  },
@@ -496,6 +610,8 @@ static int parse_config(void) {
                 { "Upload",  "ServerCertificateFile",  config_parse_path_or_ignore, 0,                        &arg_cert                 },
                 { "Upload",  "TrustedCertificateFile", config_parse_path_or_ignore, 0,                        &arg_trust                },
                 { "Upload",  "NetworkTimeoutSec",      config_parse_sec,            0,                        &arg_network_timeout_usec },
+                { "Upload",  "Compression",            config_parse_upload_compression, 0,                    &arg_compression          },
+                { "Upload",  "BatchSize",              config_parse_iec_uint64,     0,                        &arg_batch_size           },
                 {}
         };
 
@@ -539,6 +655,9 @@ static int help(void) {
                "     --follow[=BOOL]        Do [not] wait for input\n"
                "     --save-state[=FILE]    Save uploaded cursors (default \n"
                "                            " STATE_FILE ")\n"
+               "     --compression=none|zstd\n"
+               "                            Compress the uploaded data\n"
+               "     --batch-size=BYTES     Compress this much data at once\n"
                "\nSee the %s for details.\n",
                program_invocation_short_name,
                link);
@@ -560,6 +679,8 @@ static int parse_argv(int argc, char *argv[]) {
                 ARG_FOLLOW,
                 ARG_SAVE_STATE,
                 ARG_NAMESPACE,
+                ARG_COMPRESSION,
+                ARG_BATCH_SIZE,
         };
 
         static const struct option options[] = {
@@ -580,6 +701,8 @@ static int parse_argv(int argc, char *argv[]) {
                 { "after-cursor", required_argument, NULL, ARG_AFTER_CURSOR   },
                 { "follow",       optional_argument, NULL, ARG_FOLLOW         },
                 { "save-state",   optional_argument, NULL, ARG_SAVE_STATE     },
+                { "compression",  required_argument, NULL, ARG_COMPRESSION    },
+                { "batch-size",   required_argument, NULL, ARG_BATCH_SIZE     },
                 {}
         };
 
@@ -709,6 +832,18 @@ static int parse_argv(int argc, char *argv[]) {
                         arg_save_state = optarg ?: STATE_FILE;
                         break;
 
+                case ARG_COMPRESSION:
+                        arg_compression = compression_lowercase_from_string(optarg);
+                        if (arg_compression < 0)
+                                return log_error_errno(arg_compression, "Failed to parse --compression= argument: %s", optarg);
+                        break;
+
+                case ARG_BATCH_SIZE:
+                        r = parse_size(optarg, 1024, &arg_batch_size);
+                        if (r < 0)
+                                return log_error_errno(r, "Failed to parse --batch-size= argument: %s", optarg);
+                        break;
+
                 case '?':
                         return log_error_errno(SYNTHETIC_ERRNO(EINVAL),
                                                "Unknown option %s.",
@@ -731,6 +866,21 @@ static int parse_argv(int argc, char *argv[]) {
                 return log_error_errno(SYNTHETIC_ERRNO(EINVAL),
                                        "Options --key= and --cert= must be used together.");
 
+        if (!IN_SET(arg_compression, COMPRESSION_NONE, COMPRESSION_ZSTD))
+                return log_error_errno(SYNTHETIC_ERRNO(EOPNOTSUPP),
+                                       "Compression %s is not supported for uploads.",
+                                       compression_lowercase_to_string(arg_compression));
+
+        if (!compression_supported(arg_compression))
+                return log_error_errno(SYNTHETIC_ERRNO(EOPNOTSUPP),
+                                       "Compression %s is not supported by this build.",
+                                       compression_lowercase_to_string(arg_compression));
+
+        if (arg_batch_size < BATCH_SIZE_MIN || arg_batch_size > BATCH_SIZE_MAX)
+                return log_error_errno(SYNTHETIC_ERRNO(ERANGE),
+                                       "Batch size must be between %u and %u bytes.",
+                                       BATCH_SIZE_MIN, BATCH_SIZE_MAX);
+
         if (optind < argc && (arg_directory || arg_file || arg_machine || arg_journal_type))
                 return log_error_errno(SYNTHETIC_ERRNO(EINVAL),
                                        "Input arguments make no sense with journal input.");
@@ -7,6 +7,7 @@
 #include "sd-event.h"
 #include "sd-journal.h"
 
+#include "compress.h"
 #include "time-util.h"
 
 typedef enum {
@@ -23,6 +24,8 @@ typedef enum {
         ENTRY_DONE,                 /* Need to move to a new field. */
 } entry_state;
 
+typedef size_t (*upload_input_callback_t)(void *ptr, size_t size, size_t nmemb, void *userdata);
+
 typedef struct Uploader {
         sd_event *event;
 
@@ -39,6 +42,16 @@ typedef struct Uploader {
         /* fd stuff */
         int input;
 
+        /* compression stuff: the input is collected in batches, each of which is sent as one compressed
+         * frame. Both buffers are kept around for the following batches and uploads. */
+        Compression compression;
+        upload_input_callback_t input_callback;
+        void *input_userdata;
+        char *batch;
+        size_t batch_size, batch_allocated;
+        char *compressed;
+        size_t compressed_size, compressed_pos, compressed_allocated;
+
         /* journal stuff */
         sd_journal* journal;
 
@@ -58,10 +71,7 @@ typedef struct Uploader {
 #define JOURNAL_UPLOAD_POLL_TIMEOUT (10 * USEC_PER_SEC)
 
 int start_upload(Uploader *u,
-                 size_t (*input_callback)(void *ptr,
-                                          size_t size,
-                                          size_t nmemb,
-                                          void *userdata),
+                 upload_input_callback_t input_callback,
                  void *data);
 
 int open_journal_for_upload(Uploader *u,
@@ -0,0 +1,223 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "alloc-util.h"
+#include "fileio.h"
+#include "journal-remote.h"
+#include "memstream-util.h"
+#include "parse-util.h"
+#include "path-util.h"
+#include "rm-rf.h"
+#include "strv.h"
+#include "tests.h"
+#include "time-util.h"
+#include "tmpfile-util.h"
+#include "unaligned.h"
+
+/* This program feeds export format streams through the journal-remote parser and writer the same way as
+ * uploads received via HTTP, i.e. pushed into the importer in chunks, and measures how fast they are
+ * processed. The streams are either read from the files given on the command line, which may be recorded
+ * with "journalctl -o export" or taken from the fuzzer corpus, or generated. */
+
+static uint64_t arg_n_entries = 100000;
+static size_t arg_chunk_size = 16 * 1024;
+static unsigned arg_loops = 1;
+static char **arg_files = NULL;
+
+static void generate_stream(char **ret, size_t *ret_size) {
+        _cleanup_(memstream_done) MemStream m = {};
+        static const char binary[] = "some\nbinary\ndata";
+        uint8_t le[8];
+        FILE *f;
+
+        assert_se(f = memstream_init(&m));
+
+        unaligned_write_le64(le, sizeof(binary) - 1);
+
+        for (uint64_t i = 0; i < arg_n_entries; i++) {
+                fprintf(f,
+                        "__CURSOR=s=0;i=%" PRIx64 "\n"
+                        "__REALTIME_TIMESTAMP=%" PRIu64 "\n"
+                        "__MONOTONIC_TIMESTAMP=%" PRIu64 "\n"
+                        "_BOOT_ID=1531fd22ec84429e85ae888b12fadb91\n"
+                        "_TRANSPORT=journal\n"
+                        "_HOSTNAME=benchmark\n"
+                        "SYSLOG_IDENTIFIER=bench\n"
+                        "PRIORITY=6\n"
+                        "MESSAGE=Entry number %" PRIu64 " with some text to make it look like a real message\n",
+                        i, 1478389147837945 + i, 1000000 + i, i);
+
+                fputs("BINARY\n", f);
+                fwrite(le, 1, sizeof(le), f);
+                fwrite(binary, 1, sizeof(binary) - 1, f);
+                fputs("\n\n", f);
+        }
+
+        assert_se(memstream_finalize(&m, ret, ret_size) >= 0);
+}
+
+static void process_stream(RemoteServer *s, const char *data, size_t size, uint64_t *n_entries) {
+        RemoteSource *source;
+        Writer *writer;
+        char *name;
+
+        assert_se(journal_remote_get_writer(s, NULL, &writer) >= 0);
+        assert_se(name = strdup("benchmark"));
+
+        /* Like an HTTP upload, hence the fd is not used */
+        assert_se(source = source_new(STDIN_FILENO, /* passive_fd= */ true, name, writer));
+
+        for (size_t offset = 0; offset < size; offset += arg_chunk_size) {
+                size_t n = MIN(arg_chunk_size, size - offset);
+                int r;
+
+                assert_se(journal_importer_push_data(&source->importer, data + offset, n) >= 0);
+
+                while ((r = process_source(source, s->file_flags)) != -EAGAIN) {
+                        if (r < 0) {
+                                /* The server aborts the connection too, e.g. for the broken streams in
+                                 * the fuzzer corpus */
+                                log_debug_errno(r, "Failed to process stream, stopping: %m");
+                                goto finish;
+                        }
+                        if (r > 0)
+                                (*n_entries)++;
+                }
+        }
+
+finish:
+        source_free(source);
+}
+
+static int help(void) {
+        printf("%s [OPTIONS...] [FILE...]\n\n"
+               "Benchmark the journal-remote upload processing with the given export format streams.\n\n"
+               "  -h --help               Show this help\n"
+               "     --entries=N          Number of entries to generate if no file is given\n"
+               "                          (default: %" PRIu64 ")\n"
+               "     --chunk-size=N       Number of bytes pushed into the parser at once (default: %zu)\n"
+               "     --loops=N            Number of times each stream is processed (default: %u)\n",
+               program_invocation_short_name,
+               arg_n_entries,
+               arg_chunk_size,
+               arg_loops);
+        return 0;
+}
+
+static int parse_argv(int argc, char *argv[]) {
+        enum {
+                ARG_ENTRIES = 0x1000,
+                ARG_CHUNK_SIZE,
+                ARG_LOOPS,
+        };
+
+        static const struct option options[] = {
+                { "help",       no_argument,       NULL, 'h'            },
+                { "entries",    required_argument, NULL, ARG_ENTRIES    },
+                { "chunk-size", required_argument, NULL, ARG_CHUNK_SIZE },
+                { "loops",      required_argument, NULL, ARG_LOOPS      },
+                {}
+        };
+
+        int c, r;
+
+        assert(argc >= 0);
+        assert(argv);
+
+        while ((c = getopt_long(argc, argv, "h", options, NULL)) >= 0)
+                switch (c) {
+
+                case 'h':
+                        return help();
+
+                case ARG_ENTRIES:
+                        r = safe_atou64(optarg, &arg_n_entries);
+                        if (r < 0 || arg_n_entries <= 0)
+                                return log_error_errno(r < 0 ? r : SYNTHETIC_ERRNO(EINVAL), "Invalid number of entries: %s", optarg);
+                        break;
+
+                case ARG_CHUNK_SIZE:
+                        r = safe_atozu(optarg, &arg_chunk_size);
+                        if (r < 0 || arg_chunk_size <= 0)
+                                return log_error_errno(r < 0 ? r : SYNTHETIC_ERRNO(EINVAL), "Invalid chunk size: %s", optarg);
+                        break;
+
+                case ARG_LOOPS:
+                        r = safe_atou(optarg, &arg_loops);
+                        if (r < 0 || arg_loops <= 0)
+                                return log_error_errno(r < 0 ? r : SYNTHETIC_ERRNO(EINVAL), "Invalid number of loops: %s", optarg);
+                        break;
+
+                case '?':
+                        return -EINVAL;
+
+                default:
+                        assert_not_reached();
+                }
+
+        arg_files = strv_skip(argv, optind);
+
+        return 1;
+}
+
+static void run_stream(const char *label, const char *data, size_t size) {
+        _cleanup_(rm_rf_physical_and_freep) char *tmp = NULL;
+        _cleanup_free_ char *output = NULL;
+        uint64_t n_entries = 0;
+        usec_t t;
+
+        assert_se(mkdtemp_malloc("/var/tmp/test-journal-remote-benchmark-XXXXXX", &tmp) >= 0);
+        assert_se(output = path_join(tmp, "benchmark.journal"));
+
+        t = now(CLOCK_MONOTONIC);
+
+        for (unsigned i = 0; i < arg_loops; i++) {
+                _cleanup_(journal_remote_server_destroy) RemoteServer s = {};
+
+                journal_reset_metrics(&s.metrics);
+                assert_se(journal_remote_server_init(&s, output, JOURNAL_WRITE_SPLIT_NONE, 0) >= 0);
+
+                process_stream(&s, data, size, &n_entries);
+        }
+
+        t = usec_sub_unsigned(now(CLOCK_MONOTONIC), t);
+
+        printf("%s: %" PRIu64 " entries, %zu bytes: %12.0f entries/s, %8.1f MB/s\n",
+               label, n_entries, size * arg_loops,
+               (double) n_entries * USEC_PER_SEC / MAX(t, 1u),
+               (double) size * arg_loops * USEC_PER_SEC / MAX(t, 1u) / (1024 * 1024));
+}
+
+int main(int argc, char *argv[]) {
+        int r;
+
+        test_setup_logging(LOG_INFO);
+
+        r = parse_argv(argc, argv);
+        if (r <= 0)
+                return r < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+
+        if (strv_isempty(arg_files)) {
+                _cleanup_free_ char *data = NULL;
+                size_t size;
+
+                generate_stream(&data, &size);
+                run_stream("generated", data, size);
+        }
+
+        STRV_FOREACH(f, arg_files) {
+                _cleanup_free_ char *data = NULL;
+                size_t size;
+
+                r = read_full_file(*f, &data, &size);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to read %s: %m", *f);
+
+                run_stream(*f, data, size);
+        }
+
+        return EXIT_SUCCESS;
+}
@@ -0,0 +1,292 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+
+#include "alloc-util.h"
+#include "compress.h"
+#include "cpu-set-util.h"
+#include "fd-util.h"
+#include "hashmap.h"
+#include "journal-internal.h"
+#include "journalctl.h"
+#include "journalctl-grep.h"
+#include "pcre2-util.h"
+#include "sort-util.h"
+#include "time-util.h"
+
+/* Applying --grep= to the MESSAGE= field of every entry is what takes most of the time when searching a
+ * lot of journal files. Hence, before showing anything, we search the archived journal files in parallel,
+ * one file at a time on each thread, with an sd_journal object of its own per file. The entries are then
+ * still shown by the usual sequential iteration, which takes care of ordering, --lines=, --reverse and
+ * friends, but that can skip entries right away if the search of their file found that they don't match.
+ * Files that are still written to are searched as we go, as before. */
+
+#define GREP_THREADS_MAX 64U
+
+typedef struct GrepFile {
+        JournalFile *file;   /* The file of the journal the entries are shown from */
+        int fd;              /* A copy of its fd, until the journal of the worker took possession of it */
+        uint64_t *offsets;   /* Matching entries, in the order of the file */
+        size_t n_offsets;
+        uint64_t first, last; /* The entries searched, if 'searched' is set */
+        bool searched;
+} GrepFile;
+
+struct GrepIndex {
+        sd_journal *journal;
+        GrepFile *files;
+        size_t n_files;
+        size_t next;
+        Hashmap *by_file;
+};
+
+GrepIndex* grep_index_free(GrepIndex *g) {
+        if (!g)
+                return NULL;
+
+        FOREACH_ARRAY(f, g->files, g->n_files) {
+                safe_close(f->fd);
+                free(f->offsets);
+        }
+
+        free(g->files);
+        hashmap_free(g->by_file);
+        return mfree(g);
+}
+
+static int grep_file(GrepFile *f, sd_journal *source) {
+        _cleanup_(sd_journal_closep) sd_journal *j = NULL;
+        int r;
+
+        assert(f);
+        assert(source);
+
+        r = sd_journal_open_files_fd(&j, &f->fd, 1, SD_JOURNAL_ASSUME_IMMUTABLE);
+        if (r < 0)
+                return r;
+        f->fd = -EBADF; /* owned by the journal now */
+
+        r = journal_copy_matches(j, source);
+        if (r < 0)
+                return r;
+
+        r = sd_journal_set_data_threshold(j, 0);
+        if (r < 0)
+                return r;
+
+        /* --until= is checked below, cursors are not taken into account at all. Entries outside of the
+         * range searched here are searched as we go. */
+        if (arg_since_set)
+                r = sd_journal_seek_realtime_usec(j, arg_since);
+        else
+                r = sd_journal_seek_head(j);
+        if (r < 0)
+                return r;
+
+        for (;;) {
+                const void *message;
+                uint64_t offset;
+                size_t len;
+
+                r = sd_journal_next(j);
+                if (r <= 0)
+                        return r;
+
+                if (arg_until_set) {
+                        usec_t usec;
+
+                        r = sd_journal_get_realtime_usec(j, &usec);
+                        if (r < 0)
+                                return r;
+                        if (usec > arg_until)
+                                return 0;
+                }
+
+                offset = j->current_file->current_offset;
+
+                r = sd_journal_get_data(j, "MESSAGE", &message, &len);
+                if (r < 0 && r != -ENOENT)
+                        return r;
+                if (r >= 0) {
+                        assert_se(message = startswith(message, "MESSAGE="));
+
+                        r = pattern_matches_and_log(arg_compiled_pattern, message,
+                                                    len - STRLEN("MESSAGE="), NULL);
+                        if (r < 0)
+                                return r;
+                        if (r > 0) {
+                                if (!GREEDY_REALLOC(f->offsets, f->n_offsets + 1))
+                                        return -ENOMEM;
+
+                                f->offsets[f->n_offsets++] = offset;
+                        }
+                }
+
+                if (!f->searched) {
+                        f->first = offset;
+                        f->searched = true;
+                }
+                f->last = offset;
+        }
+}
+
+static void* grep_thread(void *userdata) {
+        GrepIndex *g = ASSERT_PTR(userdata);
+        int r;
+
+        for (;;) {
+                size_t i = __atomic_fetch_add(&g->next, 1, __ATOMIC_RELAXED);
+                if (i >= g->n_files)
+                        break;
+
+                /* Not fatal, whatever wasn't searched is searched as we go */
+                r = grep_file(g->files + i, g->journal);
+                if (r < 0)
+                        log_debug_errno(r, "Failed to search journal file %s, ignoring: %m", g->files[i].file->path);
+        }
+
+        return NULL;
+}
+
+static int grep_file_compare(const GrepFile *a, const GrepFile *b) {
+        /* Largest files first, so that the threads finish at about the same time */
+        return -CMP(a->file->last_stat.st_size, b->file->last_stat.st_size);
+}
+
+int grep_index_new(sd_journal *j, GrepIndex **ret) {
+        _cleanup_(grep_index_freep) GrepIndex *g = NULL;
+        _cleanup_free_ pthread_t *threads = NULL;
+        size_t n_threads, n_started = 0;
+        sigset_t ss, saved_ss;
+        JournalFile *f;
+        usec_t ts;
+        int r;
+
+        assert(j);
+        assert(ret);
+        assert(arg_compiled_pattern);
+
+        r = cpus_in_affinity_mask();
+        if (r <= 1) {
+                *ret = NULL;
+                return 0;
+        }
+        n_threads = MIN((unsigned) r, GREP_THREADS_MAX);
+
+        g = new0(GrepIndex, 1);
+        if (!g)
+                return log_oom();
+
+        g->journal = j;
+
+        ORDERED_HASHMAP_FOREACH(f, j->files) {
+                int fd;
+
+                /* Files that are still written to are searched as we go */
+                if (f->header->state != STATE_ARCHIVED)
+                        continue;
+
+                /* Compression libraries are loaded lazily, do that before the threads need them */
+#if HAVE_XZ
+                if (JOURNAL_HEADER_COMPRESSED_XZ(f->header))
+                        (void) dlopen_lzma();
+#endif
+#if HAVE_LZ4
+                if (JOURNAL_HEADER_COMPRESSED_LZ4(f->header))
+                        (void) dlopen_lz4();
+#endif
+#if HAVE_ZSTD
+                if (JOURNAL_HEADER_COMPRESSED_ZSTD(f->header))
+                        (void) dlopen_zstd();
+#endif
+
+                if (!GREEDY_REALLOC(g->files, g->n_files + 1))
+                        return log_oom();
+
+                fd = fcntl(f->fd, F_DUPFD_CLOEXEC, 3);
+                if (fd < 0)
+                        return log_error_errno(errno, "Failed to duplicate fd of journal file %s: %m", f->path);
+
+                g->files[g->n_files++] = (GrepFile) {
+                        .file = f,
+                        .fd = fd,
+                };
+        }
+
+        /* Not worth the effort for a single file */
+        n_threads = MIN(n_threads, g->n_files);
+        if (n_threads <= 1) {
+                *ret = NULL;
+                return 0;
+        }
+
+        typesafe_qsort(g->files, g->n_files, grep_file_compare);
+
+        FOREACH_ARRAY(i, g->files, g->n_files) {
+                r = hashmap_ensure_put(&g->by_file, NULL, i->file, i);
+                if (r < 0)
+                        return log_oom();
+        }
+
+        threads = new(pthread_t, n_threads - 1);
+        if (!threads)
+                return log_oom();
+
+        ts = now(CLOCK_MONOTONIC);
+
+        /* No signals in the worker threads please, they are handled on the main thread */
+        assert_se(sigfillset(&ss) >= 0);
+        r = pthread_sigmask(SIG_BLOCK, &ss, &saved_ss);
+        if (r > 0)
+                return log_error_errno(r, "Failed to block signals: %m");
+
+        for (; n_started < n_threads - 1; n_started++) {
+                r = pthread_create(threads + n_started, NULL, grep_thread, g);
+                if (r > 0) {
+                        /* Not fatal, the files this thread would have searched are then taken by the
+                         * threads already running, and by us */
+                        log_debug_errno(r, "Failed to start journal search thread, ignoring: %m");
+                        break;
+                }
+        }
+
+        assert_se(pthread_sigmask(SIG_SETMASK, &saved_ss, NULL) == 0);
+
+        /* The main thread participates as well */
+        (void) grep_thread(g);
+
+        FOREACH_ARRAY(t, threads, n_started)
+                assert_se(pthread_join(*t, NULL) == 0);
+
+        log_debug("Searched %zu journal files with %zu threads in %s.",
+                  g->n_files, n_started + 1,
+                  FORMAT_TIMESPAN(usec_sub_unsigned(now(CLOCK_MONOTONIC), ts), USEC_PER_MSEC));
+
+        *ret = TAKE_PTR(g);
+        return 0;
+}
+
+bool grep_index_rules_out(GrepIndex *g, sd_journal *j) {
+        GrepFile *f;
+        uint64_t offset;
+
+        assert(j);
+
+        /* Returns true if the current entry is known not to match, i.e. it is in the range of entries that
+         * was searched in parallel, but wasn't found. */
+
+        if (!g || !j->current_file)
+                return false;
+
+        f = hashmap_get(g->by_file, j->current_file);
+        if (!f || !f->searched)
+                return false;
+
+        offset = j->current_file->current_offset;
+        if (offset < f->first || offset > f->last)
+                return false;
+
+        return !typesafe_bsearch(&offset, f->offsets, f->n_offsets, uint64_compare_func);
+}
@@ -0,0 +1,16 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+#pragma once
+
+#include <stdbool.h>
+
+#include "sd-journal.h"
+
+#include "macro.h"
+
+typedef struct GrepIndex GrepIndex;
+
+int grep_index_new(sd_journal *j, GrepIndex **ret);
+GrepIndex* grep_index_free(GrepIndex *g);
+DEFINE_TRIVIAL_CLEANUP_FUNC(GrepIndex*, grep_index_free);
+
+bool grep_index_rules_out(GrepIndex *g, sd_journal *j);
@@ -4,6 +4,8 @@
 #include "fd-util.h"
 #include "format-table.h"
 #include "format-util.h"
+#include "glyph-util.h"
+#include "journal-file-util.h"
 #include "journal-internal.h"
 #include "journal-verify.h"
 #include "journalctl.h"
@@ -79,6 +81,57 @@ int action_verify(void) {
         return r;
 }
 
+int action_compact(void) {
+        _cleanup_(sd_journal_closep) sd_journal *j = NULL;
+        uint64_t before = 0, after = 0;
+        unsigned n = 0;
+        int r;
+
+        assert(arg_action == ACTION_COMPACT);
+
+        r = acquire_journal(&j);
+        if (r < 0)
+                return r;
+
+        JournalFile *f;
+        ORDERED_HASHMAP_FOREACH(f, j->files) {
+                uint64_t size;
+                int k;
+
+                if (f->header->state != STATE_ARCHIVED) {
+                        log_debug("Not compacting %s, as it is not archived.", f->path);
+                        continue;
+                }
+
+                if (JOURNAL_HEADER_SEALED(f->header)) {
+                        log_notice("Not compacting %s, as it is sealed.", f->path);
+                        continue;
+                }
+
+                k = journal_file_compact(f, j->mmap, &size);
+                if (k < 0) {
+                        r = log_warning_errno(k, "Failed to compact %s: %m", f->path);
+                        continue;
+                }
+
+                log_full(arg_quiet ? LOG_DEBUG : LOG_INFO, "Compacted %s (%s %s %s).",
+                         f->path,
+                         FORMAT_BYTES((uint64_t) f->last_stat.st_blocks * 512),
+                         special_glyph(SPECIAL_GLYPH_ARROW_RIGHT),
+                         FORMAT_BYTES(size));
+
+                before += (uint64_t) f->last_stat.st_blocks * 512;
+                after += size;
+                n++;
+        }
+
+        log_full(arg_quiet ? LOG_DEBUG : LOG_INFO,
+                 "Compacted %u archived journal files, taking up %s now, previously %s.",
+                 n, FORMAT_BYTES(after), FORMAT_BYTES(before));
+
+        return r;
+}
+
 int action_disk_usage(void) {
         _cleanup_(sd_journal_closep) sd_journal *j = NULL;
         uint64_t bytes = 0;
@@ -133,11 +186,17 @@ int action_list_boots(void) {
         if (r < 0)
                 return log_error_errno(r, "Failed to set JSON field name of column 0: %m");
 
-        (void) table_set_sort(table, (size_t) 0);
-        (void) table_set_reverse(table, 0, arg_reverse);
+        /* There might be thousands of boots, hence write them out as we go. Rather than sorting the table by
+         * index, add the boots in the right order right away. */
+        r = table_stream_begin_with_pager(table, arg_json_format_flags, arg_pager_flags, !arg_quiet, TABLE_STREAM_SAMPLE_ROWS);
+        if (r < 0)
+                return r;
 
-        for (int i = 0; i < (int) n_boots; i++) {
-                int index;
+        /* With --lines=N the index decreases along the array, otherwise it increases */
+        bool backwards = arg_lines_needs_seek_end() != arg_reverse;
+
+        for (int k = 0; k < (int) n_boots; k++) {
+                int i = backwards ? (int) n_boots - 1 - k : k, index;
 
                 if (arg_lines_needs_seek_end())
                         /* With --lines=N, we only know the negative index, and the older ID is located earlier. */
@@ -166,6 +225,68 @@ int action_list_boots(void) {
         return 0;
 }
 
+int action_histogram(void) {
+        _cleanup_(sd_journal_closep) sd_journal *j = NULL;
+        _cleanup_(table_unrefp) Table *table = NULL;
+        _cleanup_free_ uint64_t *counts = NULL;
+        usec_t since, until;
+        size_t n;
+        int r;
+
+        assert(arg_action == ACTION_HISTOGRAM);
+        assert(arg_histogram_bucket > 0);
+
+        r = acquire_journal(&j);
+        if (r < 0)
+                return r;
+
+        /* Cover the last day by default, and align the range to the interval, so that journal files can
+         * answer the query from their per-minute histograms. */
+        until = arg_until_set ? usec_add(arg_until, 1) : now(CLOCK_REALTIME);
+        since = arg_since_set ? arg_since : usec_sub_unsigned(until, USEC_PER_DAY);
+
+        since -= since % arg_histogram_bucket;
+        until = usec_add(until, arg_histogram_bucket - 1);
+        until -= until % arg_histogram_bucket;
+
+        if (since >= until)
+                return log_error_errno(SYNTHETIC_ERRNO(EINVAL), "Empty time range.");
+
+        r = sd_journal_get_histogram(j, since, until, arg_histogram_bucket, &counts, &n);
+        if (r == -E2BIG)
+                return log_error_errno(r, "Too many intervals in time range, use a larger interval.");
+        if (r < 0)
+                return log_error_errno(r, "Failed to count journal entries: %m");
+
+        table = table_new("time", "emerg", "alert", "crit", "err", "warning", "notice", "info", "debug");
+        if (!table)
+                return log_oom();
+
+        (void) table_set_sort(table, (size_t) 0);
+        (void) table_set_reverse(table, 0, arg_reverse);
+
+        for (size_t i = 0; i < n; i++) {
+                r = table_add_cell(table, NULL, arg_utc ? TABLE_TIMESTAMP_UTC : TABLE_TIMESTAMP,
+                                   &(usec_t) { since + i * arg_histogram_bucket });
+                if (r < 0)
+                        return table_log_add_error(r);
+
+                for (int priority = 0; priority <= LOG_DEBUG; priority++) {
+                        r = table_add_many(table,
+                                           TABLE_UINT64, counts[i * (LOG_DEBUG + 1) + priority],
+                                           TABLE_SET_ALIGN_PERCENT, 100);
+                        if (r < 0)
+                                return table_log_add_error(r);
+                }
+        }
+
+        r = table_print_with_pager(table, arg_json_format_flags, arg_pager_flags, !arg_quiet);
+        if (r < 0)
+                return table_log_print_error(r);
+
+        return 0;
+}
+
 int action_list_fields(void) {
         _cleanup_(sd_journal_closep) sd_journal *j = NULL;
         int r, n_shown = 0;
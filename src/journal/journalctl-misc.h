@@ -5,8 +5,10 @@
 
 int action_print_header(void);
 int action_verify(void);
+int action_compact(void);
 int action_disk_usage(void);
 int action_list_boots(void);
+int action_histogram(void);
 int action_list_fields(void);
 int action_list_field_names(void);
 int action_list_namespaces(void);
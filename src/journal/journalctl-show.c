@@ -5,10 +5,13 @@
 #include "sd-event.h"
 
 #include "fileio.h"
+#include "journal-export-binary.h"
 #include "journalctl.h"
 #include "journalctl-filter.h"
+#include "journalctl-grep.h"
 #include "journalctl-show.h"
 #include "journalctl-util.h"
+#include "journalctl-varlink.h"
 #include "logs-show.h"
 #include "terminal-util.h"
 
@@ -24,12 +27,18 @@ typedef struct Context {
         sd_id128_t previous_boot_id;
         sd_id128_t previous_boot_id_output;
         dual_timestamp previous_ts_output;
+        JournalBinaryExporter *exporter;
+        Varlink *tail_link;
+        GrepIndex *grep;
 } Context;
 
 static void context_done(Context *c) {
         assert(c);
 
         sd_journal_close(c->journal);
+        journal_binary_exporter_free(c->exporter);
+        varlink_close_unref(c->tail_link);
+        grep_index_free(c->grep);
 }
 
 static int seek_journal(Context *c) {
@@ -218,6 +227,11 @@ static int show(Context *c) {
                         const void *message;
                         size_t len;
 
+                        if (grep_index_rules_out(c->grep, j)) {
+                                c->need_seek = true;
+                                continue;
+                        }
+
                         r = sd_journal_get_data(j, "MESSAGE", &message, &len);
                         if (r < 0) {
                                 if (r == -ENOENT) {
@@ -240,9 +254,13 @@ static int show(Context *c) {
                         }
                 }
 
-                r = show_journal_entry(stdout, j, arg_output, 0, flags,
-                                       arg_output_fields, highlight, &c->ellipsized,
-                                       &c->previous_ts_output, &c->previous_boot_id_output);
+                if (c->exporter)
+                        /* Field names are sent only once per stream, hence keep state across entries */
+                        r = journal_binary_exporter_add(c->exporter, stdout, j, arg_output_fields);
+                else
+                        r = show_journal_entry(stdout, j, arg_output, 0, flags,
+                                               arg_output_fields, highlight, &c->ellipsized,
+                                               &c->previous_ts_output, &c->previous_boot_id_output);
                 c->need_seek = true;
                 if (r == -EADDRNOTAVAIL)
                         break;
@@ -264,40 +282,83 @@ static int show(Context *c) {
                 }
         }
 
+        /* Write out the last, partial batch, so that nothing is held back while following */
+        if (c->exporter) {
+                r = journal_binary_exporter_flush(c->exporter, stdout);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to write exported entries: %m");
+        }
+
         return n_shown;
 }
 
-static int show_and_fflush(Context *c, sd_event_source *s) {
+static int show_and_fflush(Context *c, sd_event *e) {
         int r;
 
         assert(c);
-        assert(s);
+        assert(e);
 
         r = show(c);
         if (r < 0)
-                return sd_event_exit(sd_event_source_get_event(s), r);
+                return sd_event_exit(e, r);
 
         fflush(stdout);
         return 0;
 }
 
+static int process_and_show(Context *c, sd_event *e) {
+        int r;
+
+        assert(c);
+        assert(e);
+
+        r = sd_journal_process(c->journal);
+        if (r < 0) {
+                log_error_errno(r, "Failed to process journal events: %m");
+                return sd_event_exit(e, r);
+        }
+        if (r == SD_JOURNAL_NOP)
+                /* E.g. the entries the change was posted for have been shown when journald told us about
+                 * them already */
+                return 0;
+
+        return show_and_fflush(c, e);
+}
+
 static int on_journal_event(sd_event_source *s, int fd, uint32_t revents, void *userdata) {
+        assert(s);
+
+        return process_and_show(ASSERT_PTR(userdata), sd_event_source_get_event(s));
+}
+
+static int on_tail_notify(Varlink *link, sd_json_variant *parameters, const char *error_id, VarlinkReplyFlags flags, void *userdata) {
         Context *c = ASSERT_PTR(userdata);
         int r;
 
-        assert(s);
+        assert(link);
 
+        if (error_id) {
+                /* E.g. journald is too old, or was restarted. We still get to know about new entries through
+                 * inotify, only later. */
+                log_debug("Failed to subscribe to the journal tail, relying on inotify: %s", error_id);
+                return 0;
+        }
+
+        /* Files might have been rotated meanwhile, hence process inotify events first. Note that we need to
+         * look at the journal files even if that turns up nothing, as journald posts the change later. */
         r = sd_journal_process(c->journal);
         if (r < 0) {
                 log_error_errno(r, "Failed to process journal events: %m");
-                return sd_event_exit(sd_event_source_get_event(s), r);
+                return sd_event_exit(varlink_get_event(link), r);
         }
 
-        return show_and_fflush(c, s);
+        return show_and_fflush(c, varlink_get_event(link));
 }
 
 static int on_first_event(sd_event_source *s, void *userdata) {
-        return show_and_fflush(userdata, s);
+        assert(s);
+
+        return show_and_fflush(userdata, sd_event_source_get_event(s));
 }
 
 static int on_signal(sd_event_source *s, const struct signalfd_siginfo *si, void *userdata) {
@@ -344,6 +405,14 @@ static int setup_event(Context *c, int fd, sd_event **ret) {
                         return log_error_errno(r, "Failed to add defer event source: %m");
         }
 
+        /* This is only worth it for the journal journald writes to, and only root may subscribe */
+        if (!arg_directory && !arg_root && !arg_file_stdin && !arg_file && !arg_machine &&
+            arg_namespace_flags == 0 && geteuid() == 0) {
+                r = journal_subscribe_tail(e, on_tail_notify, c, &c->tail_link);
+                if (r < 0)
+                        log_debug_errno(r, "Failed to subscribe to the journal tail, relying on inotify: %m");
+        }
+
         *ret = TAKE_PTR(e);
         return 0;
 }
@@ -394,10 +463,24 @@ int action_show(char **matches) {
         if (r < 0)
                 return r;
 
+        /* Without a limit on the number of lines we go through all matching entries anyway, hence look at
+         * the archived files in parallel first. When following, we only look at a few of them. */
+        if (arg_compiled_pattern && arg_lines < 0 && !arg_follow) {
+                r = grep_index_new(c.journal, &c.grep);
+                if (r < 0)
+                        return r;
+        }
+
         r = seek_journal(&c);
         if (r < 0)
                 return r;
 
+        if (arg_output == OUTPUT_EXPORT_BINARY) {
+                r = journal_binary_exporter_new(arg_export_compression, &c.exporter);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to set up binary export: %m");
+        }
+
         /* Opening the fd now means the first sd_journal_wait() will actually wait */
         if (arg_follow) {
                 poll_fd = sd_journal_get_fd(c.journal);
@@ -140,3 +140,36 @@ int action_sync(void) {
 
         return varlink_call_and_log(link, "io.systemd.Journal.Synchronize", /* parameters= */ NULL, /* ret_parameters= */ NULL);
 }
+
+int journal_subscribe_tail(sd_event *e, VarlinkReply reply, void *userdata, Varlink **ret) {
+        _cleanup_(varlink_flush_close_unrefp) Varlink *link = NULL;
+        int r;
+
+        assert(e);
+        assert(reply);
+        assert(ret);
+
+        /* Asks journald to tell us whenever it wrote entries. It does so right away, while the changes it
+         * posts to the journal files, which inotify picks up, are delayed to coalesce them. */
+
+        r = varlink_connect_journal(&link);
+        if (r < 0)
+                return r;
+
+        (void) varlink_set_userdata(link, userdata);
+
+        r = varlink_bind_reply(link, reply);
+        if (r < 0)
+                return r;
+
+        r = varlink_attach_event(link, e, SD_EVENT_PRIORITY_NORMAL);
+        if (r < 0)
+                return r;
+
+        r = varlink_observe(link, "io.systemd.Journal.SubscribeTail", /* parameters= */ NULL);
+        if (r < 0)
+                return r;
+
+        *ret = TAKE_PTR(link);
+        return 0;
+}
@@ -1,9 +1,15 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 #pragma once
 
+#include "sd-event.h"
+
+#include "varlink.h"
+
 int action_flush_to_var(void);
 int action_relinquish_var(void);
 int action_rotate(void);
 int action_vacuum(void);
 int action_rotate_and_vacuum(void);
 int action_sync(void);
+
+int journal_subscribe_tail(sd_event *e, VarlinkReply reply, void *userdata, Varlink **ret);
@@ -85,7 +85,9 @@ const char *arg_namespace = NULL;
 uint64_t arg_vacuum_size = 0;
 uint64_t arg_vacuum_n_files = 0;
 usec_t arg_vacuum_time = 0;
+usec_t arg_histogram_bucket = USEC_PER_MINUTE;
 Set *arg_output_fields = NULL;
+Compression arg_export_compression = COMPRESSION_NONE;
 const char *arg_pattern = NULL;
 pcre2_code *arg_compiled_pattern = NULL;
 PatternCompileCase arg_case = PATTERN_COMPILE_CASE_AUTO;
@@ -240,8 +242,10 @@ static int help(void) {
                "                               short-iso, short-iso-precise, short-full,\n"
                "                               short-monotonic, short-unix, verbose, export,\n"
                "                               json, json-pretty, json-sse, json-seq, cat,\n"
-               "                               with-unit)\n"
+               "                               with-unit, export-binary)\n"
                "     --output-fields=LIST    Select fields to print in verbose/export/json modes\n"
+               "     --export-compression=none|zstd\n"
+               "                             Compress batches of entries in export-binary mode\n"
                "  -n --lines[=[+]INTEGER]    Number of journal entries to show\n"
                "  -r --reverse               Show the newest entries first\n"
                "     --show-cursor           Print the cursor after all the entries\n"
@@ -267,12 +271,14 @@ static int help(void) {
                "  -N --fields                List all field names currently used\n"
                "  -F --field=FIELD           List all values that a specified field takes\n"
                "     --list-boots            Show terse information about recorded boots\n"
+               "     --histogram[=TIME]      Show number of entries per priority and time interval\n"
                "     --list-namespaces       Show list of journal namespaces\n"
                "     --disk-usage            Show total disk usage of all journal files\n"
                "     --vacuum-size=BYTES     Reduce disk usage below specified size\n"
                "     --vacuum-files=INT      Leave only the specified number of journal files\n"
                "     --vacuum-time=TIME      Remove journal files older than specified time\n"
                "     --verify                Verify journal file consistency\n"
+               "     --compact               Rewrite archived journal files for faster reading\n"
                "     --sync                  Synchronize unwritten journal messages to disk\n"
                "     --relinquish-var        Stop logging to disk, log to temporary file system\n"
                "     --smart-relinquish-var  Similar, but NOP if log directory is on root mount\n"
@@ -304,6 +310,7 @@ static int parse_argv(int argc, char *argv[]) {
                 ARG_NEW_ID128,
                 ARG_THIS_BOOT,
                 ARG_LIST_BOOTS,
+                ARG_HISTOGRAM,
                 ARG_USER,
                 ARG_SYSTEM,
                 ARG_ROOT,
@@ -314,6 +321,7 @@ static int parse_argv(int argc, char *argv[]) {
                 ARG_SETUP_KEYS,
                 ARG_INTERVAL,
                 ARG_VERIFY,
+                ARG_COMPACT,
                 ARG_VERIFY_KEY,
                 ARG_DISK_USAGE,
                 ARG_AFTER_CURSOR,
@@ -337,6 +345,7 @@ static int parse_argv(int argc, char *argv[]) {
                 ARG_VACUUM_TIME,
                 ARG_NO_HOSTNAME,
                 ARG_OUTPUT_FIELDS,
+                ARG_EXPORT_COMPRESSION,
                 ARG_NAMESPACE,
                 ARG_LIST_NAMESPACES,
         };
@@ -361,6 +370,7 @@ static int parse_argv(int argc, char *argv[]) {
                 { "this-boot",            no_argument,       NULL, ARG_THIS_BOOT            }, /* deprecated */
                 { "boot",                 optional_argument, NULL, 'b'                      },
                 { "list-boots",           no_argument,       NULL, ARG_LIST_BOOTS           },
+                { "histogram",            optional_argument, NULL, ARG_HISTOGRAM            },
                 { "dmesg",                no_argument,       NULL, 'k'                      },
                 { "system",               no_argument,       NULL, ARG_SYSTEM               },
                 { "user",                 no_argument,       NULL, ARG_USER                 },
@@ -379,6 +389,7 @@ static int parse_argv(int argc, char *argv[]) {
                 { "setup-keys",           no_argument,       NULL, ARG_SETUP_KEYS           },
                 { "interval",             required_argument, NULL, ARG_INTERVAL             },
                 { "verify",               no_argument,       NULL, ARG_VERIFY               },
+                { "compact",              no_argument,       NULL, ARG_COMPACT              },
                 { "verify-key",           required_argument, NULL, ARG_VERIFY_KEY           },
                 { "disk-usage",           no_argument,       NULL, ARG_DISK_USAGE           },
                 { "cursor",               required_argument, NULL, 'c'                      },
@@ -408,6 +419,7 @@ static int parse_argv(int argc, char *argv[]) {
                 { "vacuum-time",          required_argument, NULL, ARG_VACUUM_TIME          },
                 { "no-hostname",          no_argument,       NULL, ARG_NO_HOSTNAME          },
                 { "output-fields",        required_argument, NULL, ARG_OUTPUT_FIELDS        },
+                { "export-compression",   required_argument, NULL, ARG_EXPORT_COMPRESSION   },
                 { "namespace",            required_argument, NULL, ARG_NAMESPACE            },
                 { "list-namespaces",      no_argument,       NULL, ARG_LIST_NAMESPACES      },
                 {}
@@ -456,7 +468,7 @@ static int parse_argv(int argc, char *argv[]) {
                         if (arg_output < 0)
                                 return log_error_errno(arg_output, "Unknown output format '%s'.", optarg);
 
-                        if (IN_SET(arg_output, OUTPUT_EXPORT, OUTPUT_JSON, OUTPUT_JSON_PRETTY, OUTPUT_JSON_SSE, OUTPUT_JSON_SEQ, OUTPUT_CAT))
+                        if (IN_SET(arg_output, OUTPUT_EXPORT, OUTPUT_EXPORT_BINARY, OUTPUT_JSON, OUTPUT_JSON_PRETTY, OUTPUT_JSON_SSE, OUTPUT_JSON_SEQ, OUTPUT_CAT))
                                 arg_quiet = true;
 
                         if (OUTPUT_MODE_IS_JSON(arg_output))
@@ -540,6 +552,19 @@ static int parse_argv(int argc, char *argv[]) {
                         arg_action = ACTION_LIST_BOOTS;
                         break;
 
+                case ARG_HISTOGRAM:
+                        if (optarg) {
+                                r = parse_sec(optarg, &arg_histogram_bucket);
+                                if (r < 0)
+                                        return log_error_errno(r, "Failed to parse histogram interval: %s", optarg);
+                                if (arg_histogram_bucket <= 0 || arg_histogram_bucket == USEC_INFINITY)
+                                        return log_error_errno(SYNTHETIC_ERRNO(EINVAL),
+                                                               "Histogram interval must be positive and finite: %s", optarg);
+                        }
+
+                        arg_action = ACTION_HISTOGRAM;
+                        break;
+
                 case 'k':
                         arg_boot = arg_dmesg = true;
                         break;
@@ -637,6 +662,10 @@ static int parse_argv(int argc, char *argv[]) {
                         arg_action = ACTION_VERIFY;
                         break;
 
+                case ARG_COMPACT:
+                        arg_action = ACTION_COMPACT;
+                        break;
+
                 case ARG_DISK_USAGE:
                         arg_action = ACTION_DISK_USAGE;
                         break;
@@ -922,6 +951,16 @@ static int parse_argv(int argc, char *argv[]) {
 
                         break;
                 }
+
+                case ARG_EXPORT_COMPRESSION:
+                        arg_export_compression = compression_lowercase_from_string(optarg);
+                        if (!IN_SET(arg_export_compression, COMPRESSION_NONE, COMPRESSION_ZSTD))
+                                return log_error_errno(SYNTHETIC_ERRNO(EINVAL),
+                                                       "Unsupported export compression '%s'.", optarg);
+                        if (!compression_supported(arg_export_compression))
+                                return log_error_errno(SYNTHETIC_ERRNO(EOPNOTSUPP),
+                                                       "Compression '%s' is not supported by this build.", optarg);
+                        break;
                 case '?':
                         return -EINVAL;
 
@@ -957,6 +996,10 @@ static int parse_argv(int argc, char *argv[]) {
                 return log_error_errno(SYNTHETIC_ERRNO(EINVAL),
                                        "Please specify either --reverse or --follow, not both.");
 
+        if (arg_export_compression != COMPRESSION_NONE && arg_output != OUTPUT_EXPORT_BINARY)
+                return log_error_errno(SYNTHETIC_ERRNO(EINVAL),
+                                       "--export-compression= is only supported with --output=export-binary.");
+
         if (arg_action == ACTION_SHOW && arg_lines >= 0 && arg_lines_oldest && (arg_reverse || arg_follow))
                 return log_error_errno(SYNTHETIC_ERRNO(EINVAL),
                                        "--lines=+N is unsupported when --reverse or --follow is specified.");
@@ -1025,7 +1068,7 @@ static int run(int argc, char *argv[]) {
                                 DISSECT_IMAGE_REQUIRE_ROOT |
                                 DISSECT_IMAGE_VALIDATE_OS |
                                 DISSECT_IMAGE_RELAX_VAR_CHECK |
-                                (arg_action == ACTION_UPDATE_CATALOG ? DISSECT_IMAGE_FSCK|DISSECT_IMAGE_GROWFS : DISSECT_IMAGE_READ_ONLY) |
+                                (IN_SET(arg_action, ACTION_UPDATE_CATALOG, ACTION_COMPACT) ? DISSECT_IMAGE_FSCK|DISSECT_IMAGE_GROWFS : DISSECT_IMAGE_READ_ONLY) |
                                 DISSECT_IMAGE_ALLOW_USERSPACE_VERITY,
                                 &mounted_dir,
                                 /* ret_dir_fd= */ NULL,
@@ -1062,12 +1105,18 @@ static int run(int argc, char *argv[]) {
         case ACTION_VERIFY:
                 return action_verify();
 
+        case ACTION_COMPACT:
+                return action_compact();
+
         case ACTION_DISK_USAGE:
                 return action_disk_usage();
 
         case ACTION_LIST_BOOTS:
                 return action_list_boots();
 
+        case ACTION_HISTOGRAM:
+                return action_histogram();
+
         case ACTION_LIST_FIELDS:
                 return action_list_fields();
 
@@ -7,6 +7,7 @@
 #include "sd-id128.h"
 #include "sd-json.h"
 
+#include "compress.h"
 #include "output-mode.h"
 #include "pager.h"
 #include "pcre2-util.h"
@@ -22,8 +23,10 @@ typedef enum JournalctlAction {
         ACTION_UPDATE_CATALOG,
         ACTION_PRINT_HEADER,
         ACTION_VERIFY,
+        ACTION_COMPACT,
         ACTION_DISK_USAGE,
         ACTION_LIST_BOOTS,
+        ACTION_HISTOGRAM,
         ACTION_LIST_FIELDS,
         ACTION_LIST_FIELD_NAMES,
         ACTION_LIST_NAMESPACES,
@@ -89,7 +92,9 @@ extern const char *arg_namespace;
 extern uint64_t arg_vacuum_size;
 extern uint64_t arg_vacuum_n_files;
 extern usec_t arg_vacuum_time;
+extern usec_t arg_histogram_bucket;
 extern Set *arg_output_fields;
+extern Compression arg_export_compression;
 extern const char *arg_pattern;
 extern pcre2_code *arg_compiled_pattern;
 extern PatternCompileCase arg_case;
@@ -13,168 +13,197 @@
 #include "missing_audit.h"
 #include "string-util.h"
 
+/* Upper bound for the length of the journal field name, including the "=", that we generate for an audit
+ * field: the generic prefix, the audit field name of at most 15 characters, and the "=" */
+#define AUDIT_JOURNAL_FIELD_MAX (STRLEN("_AUDIT_FIELD_") + 15 + 1)
+
+typedef struct AuditParser {
+        /* All fields are written into this buffer, which is sized beforehand so that it can hold all of
+         * them, since the iovecs point into it. */
+        char *buffer;
+        size_t used, size;
+
+        struct iovec *iovec;
+        size_t n_iovec, max_iovec;
+} AuditParser;
+
+typedef int (*map_func_t)(AuditParser *a, const char *field, const char **p, const char *end);
+
 typedef struct MapField {
         const char *audit_field;
         const char *journal_field;
-        int (*map)(const char *field, const char **p, struct iovec *iovec, size_t *n);
+        map_func_t map;
 } MapField;
 
+static char* audit_parser_begin_field(AuditParser *a, const char *field, size_t max_value) {
+        size_t l;
+
+        assert(a);
+        assert(field);
+
+        /* Returns where the value is to be written. Nothing is committed until audit_parser_end_field()
+         * is called, hence a field may be abandoned by simply not calling it. */
+
+        l = strlen(field);
+        assert(l <= AUDIT_JOURNAL_FIELD_MAX);
+        assert(a->used + l + max_value + 1 <= a->size);
+
+        return mempcpy(a->buffer + a->used, field, l);
+}
+
+static void audit_parser_end_field(AuditParser *a, char *e) {
+        char *b;
+
+        assert(a);
+        assert(e);
+        assert(a->n_iovec < a->max_iovec);
+
+        b = a->buffer + a->used;
+        *e = 0;
+
+        a->iovec[a->n_iovec++] = IOVEC_MAKE(b, e - b);
+        a->used = e + 1 - a->buffer;
+}
+
+static const char* find_field_end(const char *p, const char *end) {
+        const char *e;
+
+        assert(p);
+        assert(end);
+
+        e = memchr(p, ' ', end - p);
+        return e ?: end;
+}
+
 static int map_simple_field(
+                AuditParser *a,
                 const char *field,
                 const char **p,
-                struct iovec *iovec,
-                size_t *n) {
+                const char *end) {
 
-        _cleanup_free_ char *c = NULL;
-        size_t l = 0;
         const char *e;
+        char *c;
 
+        assert(a);
         assert(field);
         assert(p);
-        assert(iovec);
-        assert(n);
-
-        l = strlen(field);
-        c = malloc(l + 1);
-        if (!c)
-                return -ENOMEM;
-
-        memcpy(c, field, l);
-        for (e = *p; !IN_SET(*e, 0, ' '); e++) {
-                if (!GREEDY_REALLOC(c, l+2))
-                        return -ENOMEM;
 
-                c[l++] = *e;
-        }
+        e = find_field_end(*p, end);
 
-        c[l] = 0;
-
-        iovec[(*n)++] = IOVEC_MAKE(c, l);
+        c = audit_parser_begin_field(a, field, e - *p);
+        c = mempcpy(c, *p, e - *p);
+        audit_parser_end_field(a, c);
 
         *p = e;
-        c = NULL;
-
         return 1;
 }
 
 static int map_string_field_internal(
+                AuditParser *a,
                 const char *field,
                 const char **p,
-                struct iovec *iovec,
-                size_t *n,
+                const char *end,
                 bool filter_printable) {
 
-        _cleanup_free_ char *c = NULL;
         const char *s, *e;
-        size_t l;
+        char *c;
 
+        assert(a);
         assert(field);
         assert(p);
-        assert(iovec);
-        assert(n);
-
         /* The kernel formats string fields in one of two formats. */
 
+        if (*p >= end)
+                return 0;
+
         if (**p == '"') {
                 /* Normal quoted syntax */
                 s = *p + 1;
-                e = strchr(s, '"');
+                e = memchr(s, '"', end - s);
                 if (!e)
                         return 0;
 
-                l = strlen(field) + (e - s);
-                c = malloc(l+1);
-                if (!c)
-                        return -ENOMEM;
-
-                *((char*) mempcpy(stpcpy(c, field), s, e - s)) = 0;
+                c = audit_parser_begin_field(a, field, e - s);
+                c = mempcpy(c, s, e - s);
 
                 e += 1;
 
         } else if (unhexchar(**p) >= 0) {
-                /* Hexadecimal escaping */
-                l = strlen(field);
-                c = malloc(l + 2);
-                if (!c)
-                        return -ENOMEM;
-
-                memcpy(c, field, l);
-                for (e = *p; !IN_SET(*e, 0, ' '); e += 2) {
-                        int a, b;
-                        uint8_t x;
-
-                        a = unhexchar(e[0]);
-                        if (a < 0)
-                                return 0;
+                /* Hexadecimal escaping, decoded right into the output buffer */
+                e = find_field_end(*p, end);
+                if ((e - *p) % 2 != 0)
+                        return 0;
+
+                c = audit_parser_begin_field(a, field, (e - *p) / 2);
+                for (s = *p; s < e; s += 2) {
+                        int x, y;
+                        uint8_t v;
 
-                        b = unhexchar(e[1]);
-                        if (b < 0)
+                        x = unhexchar(s[0]);
+                        if (x < 0)
                                 return 0;
 
-                        x = ((uint8_t) a << 4 | (uint8_t) b);
+                        y = unhexchar(s[1]);
+                        if (y < 0)
+                                return 0;
 
-                        if (filter_printable && x < (uint8_t) ' ')
-                                x = (uint8_t) ' ';
+                        v = ((uint8_t) x << 4 | (uint8_t) y);
 
-                        if (!GREEDY_REALLOC(c, l+2))
-                                return -ENOMEM;
+                        if (filter_printable && v < (uint8_t) ' ')
+                                v = (uint8_t) ' ';
 
-                        c[l++] = (char) x;
+                        *(c++) = (char) v;
                 }
-
-                c[l] = 0;
         } else
                 return 0;
 
-        iovec[(*n)++] = IOVEC_MAKE(c, l);
+        audit_parser_end_field(a, c);
 
         *p = e;
-        c = NULL;
-
         return 1;
 }
 
-static int map_string_field(const char *field, const char **p, struct iovec *iovec, size_t *n) {
-        return map_string_field_internal(field, p, iovec, n, false);
+static int map_string_field(AuditParser *a, const char *field, const char **p, const char *end) {
+        return map_string_field_internal(a, field, p, end, false);
 }
 
-static int map_string_field_printable(const char *field, const char **p, struct iovec *iovec, size_t *n) {
-        return map_string_field_internal(field, p, iovec, n, true);
+static int map_string_field_printable(AuditParser *a, const char *field, const char **p, const char *end) {
+        return map_string_field_internal(a, field, p, end, true);
 }
 
 static int map_generic_field(
+                AuditParser *a,
                 const char *prefix,
+                const char *key,
+                size_t key_len,
                 const char **p,
-                struct iovec *iovec,
-                size_t *n) {
+                const char *end) {
 
-        const char *e, *f;
-        char *c, *t;
-        int r;
-
-        /* Implements fallback mappings for all fields we don't know */
+        const char *e;
+        char *c;
 
-        for (e = *p; e < *p + 16; e++) {
+        assert(a);
+        assert(prefix);
+        assert(key);
+        assert(p);
 
-                if (IN_SET(*e, 0, ' '))
-                        return 0;
+        /* Implements fallback mappings for all fields we don't know */
 
-                if (*e == '=')
-                        break;
+        if (key_len <= 0 || key_len >= 16)
+                return 0;
 
-                if (!(ascii_isalpha(*e) ||
-                      ascii_isdigit(*e) ||
-                      IN_SET(*e, '_', '-')))
+        for (const char *f = key; f < key + key_len; f++)
+                if (!(ascii_isalpha(*f) ||
+                      ascii_isdigit(*f) ||
+                      IN_SET(*f, '_', '-')))
                         return 0;
-        }
 
-        if (e <= *p || e >= *p + 16)
-                return 0;
-
-        c = newa(char, strlen(prefix) + (e - *p) + 2);
+        e = find_field_end(*p, end);
 
-        t = stpcpy(c, prefix);
-        for (f = *p; f < e; f++) {
+        /* We build the field name right in the output buffer, hence the prefix is passed as field name
+         * here, and the rest of the name is written as part of the value */
+        c = audit_parser_begin_field(a, prefix, key_len + 1 + (e - *p));
+        for (const char *f = key; f < key + key_len; f++) {
                 char x;
 
                 if (*f >= 'a' && *f <= 'z')
@@ -184,155 +213,176 @@ static int map_generic_field(
                 else
                         x = *f;
 
-                *(t++) = x;
+                *(c++) = x;
         }
-        strcpy(t, "=");
+        *(c++) = '=';
 
-        e++;
-
-        r = map_simple_field(c, &e, iovec, n);
-        if (r < 0)
-                return r;
+        c = mempcpy(c, *p, e - *p);
+        audit_parser_end_field(a, c);
 
         *p = e;
-        return r;
+        return 1;
 }
 
 /* Kernel fields are those occurring in the audit string before
  * msg='. All of these fields are trusted, hence carry the "_" prefix.
  * We try to translate the fields we know into our native names. The
- * other's are generically mapped to _AUDIT_FIELD_XYZ= */
+ * other's are generically mapped to _AUDIT_FIELD_XYZ=
+ *
+ * The tables are sorted by audit field name, so that we can look fields up via binary search. */
 static const MapField map_fields_kernel[] = {
-
         /* First, we map certain well-known audit fields into native
-         * well-known fields */
-        { "pid=",       "_PID=",              map_simple_field },
-        { "ppid=",      "_PPID=",             map_simple_field },
-        { "uid=",       "_UID=",              map_simple_field },
-        { "euid=",      "_EUID=",             map_simple_field },
-        { "fsuid=",     "_FSUID=",            map_simple_field },
-        { "gid=",       "_GID=",              map_simple_field },
-        { "egid=",      "_EGID=",             map_simple_field },
-        { "fsgid=",     "_FSGID=",            map_simple_field },
-        { "tty=",       "_TTY=",              map_simple_field },
-        { "ses=",       "_AUDIT_SESSION=",    map_simple_field },
-        { "auid=",      "_AUDIT_LOGINUID=",   map_simple_field },
-        { "subj=",      "_SELINUX_CONTEXT=",  map_simple_field },
-        { "comm=",      "_COMM=",             map_string_field },
-        { "exe=",       "_EXE=",              map_string_field },
-        { "proctitle=", "_CMDLINE=",          map_string_field_printable },
-
-        /* Some fields don't map to native well-known fields. However,
-         * we know that they are string fields, hence let's undo
-         * string field escaping for them, though we stick to the
-         * generic field names. */
-        { "path=",      "_AUDIT_FIELD_PATH=", map_string_field },
-        { "dev=",       "_AUDIT_FIELD_DEV=",  map_string_field },
-        { "name=",      "_AUDIT_FIELD_NAME=", map_string_field },
-        {}
+         * well-known fields. Some fields don't map to native well-known
+         * fields. However, we know that they are string fields, hence
+         * let's undo string field escaping for them, though we stick to
+         * the generic field names. */
+        { "auid",      "_AUDIT_LOGINUID=",   map_simple_field           },
+        { "comm",      "_COMM=",             map_string_field           },
+        { "dev",       "_AUDIT_FIELD_DEV=",  map_string_field           },
+        { "egid",      "_EGID=",             map_simple_field           },
+        { "euid",      "_EUID=",             map_simple_field           },
+        { "exe",       "_EXE=",              map_string_field           },
+        { "fsgid",     "_FSGID=",            map_simple_field           },
+        { "fsuid",     "_FSUID=",            map_simple_field           },
+        { "gid",       "_GID=",              map_simple_field           },
+        { "name",      "_AUDIT_FIELD_NAME=", map_string_field           },
+        { "path",      "_AUDIT_FIELD_PATH=", map_string_field           },
+        { "pid",       "_PID=",              map_simple_field           },
+        { "ppid",      "_PPID=",             map_simple_field           },
+        { "proctitle", "_CMDLINE=",          map_string_field_printable },
+        { "ses",       "_AUDIT_SESSION=",    map_simple_field           },
+        { "subj",      "_SELINUX_CONTEXT=",  map_simple_field           },
+        { "tty",       "_TTY=",              map_simple_field           },
+        { "uid",       "_UID=",              map_simple_field           },
 };
 
 /* Userspace fields are those occurring in the audit string after
  * msg='. All of these fields are untrusted, hence carry no "_"
  * prefix. We map the fields we don't know to AUDIT_FIELD_XYZ= */
 static const MapField map_fields_userspace[] = {
-        { "cwd=",       "AUDIT_FIELD_CWD=",   map_string_field },
-        { "cmd=",       "AUDIT_FIELD_CMD=",   map_string_field },
-        { "acct=",      "AUDIT_FIELD_ACCT=",  map_string_field },
-        { "exe=",       "AUDIT_FIELD_EXE=",   map_string_field },
-        { "comm=",      "AUDIT_FIELD_COMM=",  map_string_field },
-        {}
+        { "acct",      "AUDIT_FIELD_ACCT=",  map_string_field           },
+        { "cmd",       "AUDIT_FIELD_CMD=",   map_string_field           },
+        { "comm",      "AUDIT_FIELD_COMM=",  map_string_field           },
+        { "cwd",       "AUDIT_FIELD_CWD=",   map_string_field           },
+        { "exe",       "AUDIT_FIELD_EXE=",   map_string_field           },
 };
 
+static const MapField* map_field_lookup(const MapField *map_fields, size_t n_map_fields, const char *name, size_t length) {
+        size_t left = 0, right = n_map_fields;
+
+        assert(map_fields || n_map_fields == 0);
+        assert(name);
+
+        /* The name is not NUL terminated here, hence we don't use bsearch() */
+
+        while (left < right) {
+                size_t i = left + (right - left) / 2;
+                const char *f = map_fields[i].audit_field;
+                int r;
+
+                r = strncmp(name, f, length);
+                if (r == 0) {
+                        if (f[length] == 0)
+                                return map_fields + i;
+
+                        r = -1; /* name is a prefix of f, hence sorts earlier */
+                }
+
+                if (r < 0)
+                        right = i;
+                else
+                        left = i + 1;
+        }
+
+        return NULL;
+}
+
 static int map_all_fields(
+                AuditParser *a,
                 const char *p,
+                const char *end,
                 const MapField map_fields[],
+                size_t n_map_fields,
                 const char *prefix,
-                bool handle_msg,
-                struct iovec *iovec,
-                size_t *n,
-                size_t m) {
+                bool handle_msg) {
 
         int r;
 
+        assert(a);
         assert(p);
-        assert(iovec);
-        assert(n);
+        assert(end);
 
         for (;;) {
-                bool mapped = false;
                 const MapField *mf;
-                const char *v;
+                const char *k, *v;
 
-                if (*n >= m) {
+                if (a->n_iovec >= a->max_iovec) {
                         log_debug(
                                 "More fields in audit message than audit field limit (%i), skipping remaining fields",
                                 N_IOVEC_AUDIT_FIELDS);
                         return 0;
                 }
 
-                p += strspn(p, WHITESPACE);
+                while (p < end && strchr(WHITESPACE, *p))
+                        p++;
 
-                if (*p == 0)
+                if (p >= end)
                         return 0;
 
-                if (handle_msg) {
-                        v = startswith(p, "msg='");
-                        if (v) {
-                                _cleanup_free_ char *c = NULL;
-                                const char *e;
-
-                                /* Userspace message. It's enclosed in
-                                   simple quotation marks, is not
-                                   escaped, but the last field in the
-                                   line, hence let's remove the
-                                   quotation mark, and apply the
-                                   userspace mapping instead of the
-                                   kernel mapping. */
-
-                                e = endswith(v, "'");
-                                if (!e)
-                                        return 0; /* don't continue splitting up if the final quotation mark is missing */
-
-                                c = strndup(v, e - v);
-                                if (!c)
-                                        return -ENOMEM;
-
-                                return map_all_fields(c, map_fields_userspace, "AUDIT_FIELD_", false, iovec, n, m);
-                        }
+                if (handle_msg && (size_t) (end - p) >= STRLEN("msg='") && memcmp(p, "msg='", STRLEN("msg='")) == 0) {
+                        /* Userspace message. It's enclosed in
+                           simple quotation marks, is not
+                           escaped, but the last field in the
+                           line, hence let's remove the
+                           quotation mark, and apply the
+                           userspace mapping instead of the
+                           kernel mapping. */
+
+                        v = p + STRLEN("msg='");
+                        if (end <= v || end[-1] != '\'')
+                                return 0; /* don't continue splitting up if the final quotation mark is missing */
+
+                        return map_all_fields(a, v, end - 1, map_fields_userspace, ELEMENTSOF(map_fields_userspace), "AUDIT_FIELD_", false);
                 }
 
-                /* Try to map the kernel fields to our own names */
-                for (mf = map_fields; mf->audit_field; mf++) {
-                        v = startswith(p, mf->audit_field);
-                        if (!v)
-                                continue;
+                /* Split off the field name, and look it up */
+                k = p;
+                for (v = k; v < end && *v != '=' && !strchr(WHITESPACE, *v); v++)
+                        ;
+
+                if (v >= end || *v != '=') {
+                        /* Not a field, let's just skip over it */
+                        p = v;
+                        continue;
+                }
 
-                        r = mf->map(mf->journal_field, &v, iovec, n);
+                v++;
+
+                mf = map_field_lookup(map_fields, n_map_fields, k, v - 1 - k);
+                if (mf) {
+                        r = mf->map(a, mf->journal_field, &v, end);
                         if (r < 0)
                                 return log_debug_errno(r, "Failed to parse audit array: %m");
-
                         if (r > 0) {
-                                mapped = true;
                                 p = v;
-                                break;
+                                continue;
                         }
                 }
 
-                if (!mapped) {
-                        r = map_generic_field(prefix, &p, iovec, n);
-                        if (r < 0)
-                                return log_debug_errno(r, "Failed to parse audit array: %m");
-
-                        if (r == 0)
-                                /* Couldn't process as generic field, let's just skip over it */
-                                p += strcspn(p, WHITESPACE);
-                }
+                r = map_generic_field(a, prefix, k, v - 1 - k, &v, end);
+                if (r < 0)
+                        return log_debug_errno(r, "Failed to parse audit array: %m");
+                if (r > 0)
+                        p = v;
+                else
+                        /* Couldn't process as generic field, let's just skip over it */
+                        while (p < end && !strchr(WHITESPACE, *p))
+                                p++;
         }
 }
 
 void process_audit_string(Server *s, int type, const char *data, size_t size) {
-        size_t n = 0, z;
+        size_t n = 0, l;
         uint64_t seconds, msec, id;
         const char *p, *type_name;
         char id_field[STRLEN("_AUDIT_ID=") + DECIMAL_STR_MAX(uint64_t)],
@@ -392,19 +442,26 @@ void process_audit_string(Server *s, int type, const char *data, size_t size) {
         m = strjoina("MESSAGE=", type_name, " ", p);
         iovec[n++] = IOVEC_MAKE_STRING(m);
 
-        z = n;
+        /* Each field we generate consists of a journal field name, and a value no longer than the part of
+         * the string it was generated from. Hence, this is enough to hold all of them. */
+        l = strlen(p);
+        if (GREEDY_REALLOC(s->audit_fields_buffer, l + N_IOVEC_AUDIT_FIELDS * (AUDIT_JOURNAL_FIELD_MAX + 1))) {
+                AuditParser a = {
+                        .buffer = s->audit_fields_buffer,
+                        .size = MALLOC_SIZEOF_SAFE(s->audit_fields_buffer),
+                        .iovec = iovec + n,
+                        .max_iovec = N_IOVEC_AUDIT_FIELDS,
+                };
 
-        map_all_fields(p, map_fields_kernel, "_AUDIT_FIELD_", true, iovec, &n, n + N_IOVEC_AUDIT_FIELDS);
+                (void) map_all_fields(&a, p, p + l, map_fields_kernel, ELEMENTSOF(map_fields_kernel), "_AUDIT_FIELD_", true);
+                n += a.n_iovec;
+        } else
+                log_oom_debug();
 
+        s->statistics.n_received[SERVER_TRANSPORT_AUDIT]++;
         server_dispatch_message(s, iovec, n, ELEMENTSOF(iovec), NULL,
                                 TIMEVAL_STORE((usec_t) seconds * USEC_PER_SEC + (usec_t) msec * USEC_PER_MSEC),
                                 LOG_NOTICE, 0);
-
-        /* free() all entries that map_all_fields() added. All others
-         * are allocated on the stack or are constant. */
-
-        for (; z < n; z++)
-                free(iovec[z].iov_base);
 }
 
 void server_process_audit_message(
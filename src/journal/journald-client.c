@@ -9,11 +9,11 @@
 
 /* This consumes both `allow_list` and `deny_list` arguments. Hence, those arguments are not owned by the
  * caller anymore and should not be freed. */
-static void client_set_filtering_patterns(ClientContext *c, Set *allow_list, Set *deny_list) {
-        assert(c);
+static void client_set_filtering_patterns(ClientUnitContext *u, Set *allow_list, Set *deny_list) {
+        assert(u);
 
-        set_free_and_replace(c->log_filter_allowed_patterns, allow_list);
-        set_free_and_replace(c->log_filter_denied_patterns, deny_list);
+        set_free_and_replace(u->log_filter_allowed_patterns, allow_list);
+        set_free_and_replace(u->log_filter_denied_patterns, deny_list);
 }
 
 static int client_parse_log_filter_nulstr(const char *nulstr, size_t len, Set **ret) {
@@ -45,13 +45,13 @@ static int client_parse_log_filter_nulstr(const char *nulstr, size_t len, Set **
         return 0;
 }
 
-int client_context_read_log_filter_patterns(ClientContext *c, const char *cgroup) {
+int client_unit_context_read_log_filter_patterns(ClientUnitContext *u, const char *cgroup) {
         char *deny_list_xattr, *xattr_end;
         _cleanup_free_ char *xattr = NULL, *unit_cgroup = NULL;
         _cleanup_set_free_ Set *allow_list = NULL, *deny_list = NULL;
         int r;
 
-        assert(c);
+        assert(u);
 
         r = cg_path_get_unit_path(cgroup, &unit_cgroup);
         if (r < 0)
@@ -59,7 +59,7 @@ int client_context_read_log_filter_patterns(ClientContext *c, const char *cgroup
 
         r = cg_get_xattr_malloc(unit_cgroup, "user.journald_log_filter_patterns", &xattr);
         if (ERRNO_IS_NEG_XATTR_ABSENT(r)) {
-                client_set_filtering_patterns(c, NULL, NULL);
+                client_set_filtering_patterns(u, NULL, NULL);
                 return 0;
         } else if (r < 0)
                 return log_debug_errno(r, "Failed to get user.journald_log_filter_patterns xattr for %s: %m", unit_cgroup);
@@ -91,24 +91,27 @@ int client_context_read_log_filter_patterns(ClientContext *c, const char *cgroup
         if (r < 0)
                 return r;
 
-        client_set_filtering_patterns(c, TAKE_PTR(allow_list), TAKE_PTR(deny_list));
+        client_set_filtering_patterns(u, TAKE_PTR(allow_list), TAKE_PTR(deny_list));
 
         return 0;
 }
 
 int client_context_check_keep_log(ClientContext *c, const char *message, size_t len) {
+        ClientUnitContext *u;
         pcre2_code *regex;
 
-        if (!c || !message)
+        if (!c || !c->unit_context || !message)
                 return true;
 
-        SET_FOREACH(regex, c->log_filter_denied_patterns)
+        u = c->unit_context;
+
+        SET_FOREACH(regex, u->log_filter_denied_patterns)
                 if (pattern_matches_and_log(regex, message, len, NULL) > 0)
                         return false;
 
-        SET_FOREACH(regex, c->log_filter_allowed_patterns)
+        SET_FOREACH(regex, u->log_filter_allowed_patterns)
                 if (pattern_matches_and_log(regex, message, len, NULL) > 0)
                         return true;
 
-        return set_isempty(c->log_filter_allowed_patterns);
+        return set_isempty(u->log_filter_allowed_patterns);
 }
@@ -18,6 +18,7 @@
 #include "journald-context.h"
 #include "parse-util.h"
 #include "path-util.h"
+#include "pidref.h"
 #include "process-util.h"
 #include "procfs-util.h"
 #include "string-util.h"
@@ -31,10 +32,17 @@
  * log entry was originally created. We hence just increase the "window of inaccuracy" a bit.
  *
  * The cache is indexed by the PID. Entries may be "pinned" in the cache, in which case the entries are not removed
- * until they are unpinned. Unpinned entries are kept around until cache pressure is seen. Cache entries older than 5s
- * are never used (a sad attempt to deal with the UNIX weakness of PIDs reuse), cache entries older than 1s are
- * refreshed in an incremental way (meaning: data is reread from /proc, but any old data we can't refresh is not
- * flushed out). Data newer than 1s is used immediately without refresh.
+ * until they are unpinned. Unpinned entries are kept around until cache pressure is seen. Cache entries older than 1s
+ * are refreshed in an incremental way (meaning: data is reread from /proc, but any old data we can't refresh is not
+ * flushed out). Data newer than 1s is used immediately without refresh. When an entry is refreshed we compare the
+ * inode number of a pidfd for the PID with the one we saw before: if it changed the PID was reused and the entry is
+ * flushed out entirely. If the kernel does not give us unique pidfd inode numbers, cache entries older than 5s are
+ * never used instead (a sad attempt to deal with the UNIX weakness of PIDs reuse). With many clients the refresh
+ * interval is extended, see client_context_refresh_usec().
+ *
+ * Metadata that belongs to the unit rather than to the process (the invocation ID, extra fields, log level and rate
+ * limit settings and log filter patterns) is kept in a ClientUnitContext shared by all entries in the same cgroup,
+ * so that it is only read once for all processes of a service.
  *
  * Log stream clients (i.e. all clients using the AF_UNIX/SOCK_STREAM stdout/stderr transport) will pin a cache entry
  * as long as their socket is connected. Note that cache entries are shared between different transports. That means a
@@ -50,6 +58,10 @@
  *    stream connection. This should improve cases where a service process logs immediately before exiting and we
  *    previously had trouble associating the log message with the service.
  *
+ * The cache is not tied to a server: when a single process serves several namespaces, they all share it, as the
+ * metadata of a client does not depend on the namespace it logs to. Settings of the server are hence not baked into
+ * the entries, but applied when a message is dispatched.
+ *
  * NB: With and without the metadata cache: the implicitly added entry metadata in the journal (with the exception of
  *     UID/PID/GID and SELinux label) must be understood as possibly slightly out of sync (i.e. sometimes slightly older
  *     and sometimes slightly newer than what was current at the log event).
@@ -58,40 +70,212 @@
 /* We refresh every 1s */
 #define REFRESH_USEC (1*USEC_PER_SEC)
 
-/* Data older than 5s we flush out */
+/* … unless there are more entries than this, in which case the refresh interval grows proportionally */
+#define REFRESH_ENTRIES_MAX 1024U
+
+/* Data older than 5s we flush out, unless we can tell that the PID was not reused */
 #define MAX_USEC (5*USEC_PER_SEC)
 
-/* Keep at most 16K entries in the cache. (Note though that this limit may be violated if enough streams pin entries in
- * the cache, in which case we *do* permit this limit to be breached. That's safe however, as the number of stream
- * clients itself is limited.) */
+/* Keep at most 16K entries in the cache, and use at most 1/8th of memory for them. (Note though that these limits may
+ * be violated if enough streams pin entries in the cache, in which case we *do* permit them to be breached. That's
+ * safe however, as the number of stream clients itself is limited.) */
+#define CACHE_MAX (16*1024U)
 #define CACHE_MAX_FALLBACK 128U
-#define CACHE_MAX_MAX (16*1024U)
 #define CACHE_MAX_MIN 64U
 
-static size_t cache_max(void) {
-        static size_t cached = -1;
+static uint64_t cache_max_size(void) {
+        static uint64_t cached = UINT64_MAX;
 
-        if (cached == SIZE_MAX) {
+        if (cached == UINT64_MAX) {
                 uint64_t mem_total;
                 int r;
 
                 r = procfs_memory_get(&mem_total, NULL);
                 if (r < 0) {
                         log_warning_errno(r, "Cannot query /proc/meminfo for MemTotal: %m");
-                        cached = CACHE_MAX_FALLBACK;
+                        cached = (uint64_t) CACHE_MAX_FALLBACK * sc_arg_max();
                 } else
                         /* Cache entries are usually a few kB, but the process cmdline is controlled by the
-                         * user and can be up to _SC_ARG_MAX, usually 2MB. Let's say that approximately up to
-                         * 1/8th of memory may be used by the cache.
-                         *
-                         * In the common case, this formula gives 64 cache entries for each GB of RAM.
-                         */
-                        cached = CLAMP(mem_total / 8 / sc_arg_max(), CACHE_MAX_MIN, CACHE_MAX_MAX);
+                         * user and can be up to _SC_ARG_MAX, usually 2MB. We track the memory actually used
+                         * by the entries, so that the number of entries can follow the number of clients we
+                         * see, but always leave room for a few entries of the maximum size. */
+                        cached = MAX(mem_total / 8, (uint64_t) CACHE_MAX_MIN * sc_arg_max());
         }
 
         return cached;
 }
 
+int client_context_cache_new(ClientContextCache **ret) {
+        ClientContextCache *c;
+
+        assert(ret);
+
+        c = new(ClientContextCache, 1);
+        if (!c)
+                return -ENOMEM;
+
+        *c = (ClientContextCache) {
+                .n_ref = 1,
+        };
+
+        *ret = c;
+        return 0;
+}
+
+static ClientContextCache* client_context_cache_free(ClientContextCache *c) {
+        if (!c)
+                return NULL;
+
+        /* The last server using the cache flushes out the entries via client_context_flush_all() */
+        assert(hashmap_isempty(c->contexts));
+        assert(hashmap_isempty(c->unit_contexts));
+
+        prioq_free(c->lru);
+        hashmap_free(c->contexts);
+        hashmap_free(c->unit_contexts);
+        free(c->proc_buffer);
+
+        return mfree(c);
+}
+
+DEFINE_TRIVIAL_REF_UNREF_FUNC(ClientContextCache, client_context_cache, client_context_cache_free);
+
+static usec_t client_context_refresh_usec(Server *s) {
+        size_t n;
+
+        assert(s);
+
+        /* With thousands of clients logging, refreshing each of them every REFRESH_USEC means we spend most
+         * of our time reading /proc. Hence, refresh at most about REFRESH_ENTRIES_MAX entries per
+         * REFRESH_USEC, by extending the interval as the cache grows, up to MAX_USEC. */
+
+        n = hashmap_size(s->client_context_cache->contexts);
+        if (n <= REFRESH_ENTRIES_MAX)
+                return REFRESH_USEC;
+
+        return MIN(REFRESH_USEC * n / REFRESH_ENTRIES_MAX, MAX_USEC);
+}
+
+static size_t client_context_size(const ClientContext *c) {
+        assert(c);
+
+        return sizeof(ClientContext) +
+                strlen_ptr(c->comm) +
+                strlen_ptr(c->exe) +
+                strlen_ptr(c->cmdline) +
+                strlen_ptr(c->capeff) +
+                strlen_ptr(c->cgroup) +
+                strlen_ptr(c->session) +
+                strlen_ptr(c->unit) +
+                strlen_ptr(c->user_unit) +
+                strlen_ptr(c->slice) +
+                strlen_ptr(c->user_slice) +
+                c->label_size;
+}
+
+static void client_context_update_size(Server *s, ClientContext *c) {
+        assert(s);
+        assert(c);
+        assert(s->client_context_cache->size >= c->size);
+
+        s->client_context_cache->size -= c->size;
+        c->size = client_context_size(c);
+        s->client_context_cache->size += c->size;
+}
+
+static ClientUnitContext* client_unit_context_unref(Server *s, ClientUnitContext *u) {
+        assert(s);
+
+        if (!u)
+                return NULL;
+
+        assert(u->n_ref > 0);
+
+        u->n_ref--;
+        if (u->n_ref > 0)
+                return NULL;
+
+        assert_se(hashmap_remove(s->client_context_cache->unit_contexts, u->id) == u);
+
+        free(u->id);
+        free(u->extra_fields_iovec);
+        free(u->extra_fields_data);
+        set_free_free(u->log_filter_allowed_patterns);
+        set_free_free(u->log_filter_denied_patterns);
+
+        return mfree(u);
+}
+
+static int client_unit_context_acquire(Server *s, const char *id, ClientUnitContext **ret) {
+        ClientUnitContext *u;
+        int r;
+
+        assert(s);
+        assert(id);
+        assert(ret);
+
+        u = hashmap_get(s->client_context_cache->unit_contexts, id);
+        if (u) {
+                u->n_ref++;
+                *ret = u;
+                return 0;
+        }
+
+        u = new(ClientUnitContext, 1);
+        if (!u)
+                return -ENOMEM;
+
+        *u = (ClientUnitContext) {
+                .n_ref = 1,
+                .timestamp = USEC_INFINITY,
+                .extra_fields_mtime = NSEC_INFINITY,
+                .log_level_max = -1,
+                .log_ratelimit_interval = USEC_INFINITY,
+                .log_ratelimit_burst = UINT_MAX,
+        };
+
+        u->id = strdup(id);
+        if (!u->id) {
+                free(u);
+                return -ENOMEM;
+        }
+
+        r = hashmap_ensure_put(&s->client_context_cache->unit_contexts, &string_hash_ops, u->id, u);
+        if (r < 0) {
+                free(u->id);
+                free(u);
+                return r;
+        }
+
+        *ret = u;
+        return 0;
+}
+
+static uint64_t client_context_read_pidfd_id(ClientContext *c) {
+        _cleanup_(pidref_done) PidRef pidref = PIDREF_NULL;
+        static bool unsupported = false;
+        int r;
+
+        assert(c);
+
+        /* Returns the inode number of a pidfd for the PID, which identifies the process across PID reuse, or
+         * 0 if we cannot get one. */
+
+        if (unsupported)
+                return 0;
+
+        if (pidref_set_pid(&pidref, c->pid) < 0)
+                return 0;
+
+        r = pidref_acquire_pidfd_id(&pidref);
+        if (IN_SET(r, -EOPNOTSUPP, -ENOMEDIUM))
+                unsupported = true;
+        if (r < 0)
+                return 0;
+
+        return pidref.fd_id;
+}
+
 static int client_context_compare(const void *a, const void *b) {
         const ClientContext *x = a, *y = b;
         int r;
@@ -111,7 +295,7 @@ static int client_context_new(Server *s, pid_t pid, ClientContext **ret) {
         assert(pid_is_valid(pid));
         assert(ret);
 
-        r = prioq_ensure_allocated(&s->client_contexts_lru, client_context_compare);
+        r = prioq_ensure_allocated(&s->client_context_cache->lru, client_context_compare);
         if (r < 0)
                 return r;
 
@@ -128,16 +312,17 @@ static int client_context_new(Server *s, pid_t pid, ClientContext **ret) {
                 .owner_uid = UID_INVALID,
                 .lru_index = PRIOQ_IDX_NULL,
                 .timestamp = USEC_INFINITY,
-                .extra_fields_mtime = NSEC_INFINITY,
                 .log_level_max = -1,
-                .log_ratelimit_interval = s->ratelimit_interval,
-                .log_ratelimit_burst = s->ratelimit_burst,
+                .log_ratelimit_interval = USEC_INFINITY,
+                .log_ratelimit_burst = UINT_MAX,
         };
 
-        r = hashmap_ensure_put(&s->client_contexts, NULL, PID_TO_PTR(pid), c);
+        r = hashmap_ensure_put(&s->client_context_cache->contexts, NULL, PID_TO_PTR(pid), c);
         if (r < 0)
                 return r;
 
+        client_context_update_size(s, c);
+
         *ret = TAKE_PTR(c);
         return 0;
 }
@@ -147,6 +332,7 @@ static void client_context_reset(Server *s, ClientContext *c) {
         assert(c);
 
         c->timestamp = USEC_INFINITY;
+        c->pidfd_id = 0;
 
         c->uid = UID_INVALID;
         c->gid = GID_INVALID;
@@ -167,23 +353,17 @@ static void client_context_reset(Server *s, ClientContext *c) {
         c->slice = mfree(c->slice);
         c->user_slice = mfree(c->user_slice);
 
-        c->invocation_id = SD_ID128_NULL;
-
         c->label = mfree(c->label);
         c->label_size = 0;
 
-        c->extra_fields_iovec = mfree(c->extra_fields_iovec);
-        c->extra_fields_n_iovec = 0;
-        c->extra_fields_data = mfree(c->extra_fields_data);
-        c->extra_fields_mtime = NSEC_INFINITY;
+        c->unit_context = client_unit_context_unref(s, c->unit_context);
 
+        c->invocation_id = SD_ID128_NULL;
         c->log_level_max = -1;
+        c->log_ratelimit_interval = USEC_INFINITY;
+        c->log_ratelimit_burst = UINT_MAX;
 
-        c->log_ratelimit_interval = s->ratelimit_interval;
-        c->log_ratelimit_burst = s->ratelimit_burst;
-
-        c->log_filter_allowed_patterns = set_free_free(c->log_filter_allowed_patterns);
-        c->log_filter_denied_patterns = set_free_free(c->log_filter_denied_patterns);
+        client_context_update_size(s, c);
 }
 
 static ClientContext* client_context_free(Server *s, ClientContext *c) {
@@ -192,49 +372,109 @@ static ClientContext* client_context_free(Server *s, ClientContext *c) {
         if (!c)
                 return NULL;
 
-        assert_se(hashmap_remove(s->client_contexts, PID_TO_PTR(c->pid)) == c);
+        assert_se(hashmap_remove(s->client_context_cache->contexts, PID_TO_PTR(c->pid)) == c);
 
         if (c->in_lru)
-                assert_se(prioq_remove(s->client_contexts_lru, c, &c->lru_index) >= 0);
+                assert_se(prioq_remove(s->client_context_cache->lru, c, &c->lru_index) >= 0);
 
         client_context_reset(s, c);
 
+        assert(s->client_context_cache->size >= c->size);
+        s->client_context_cache->size -= c->size;
+
         return mfree(c);
 }
 
-static void client_context_read_uid_gid(ClientContext *c, const struct ucred *ucred) {
+static int client_context_read_proc_file(ClientContextCache *cache, int proc_fd, const char *filename, char **ret) {
+        int r;
+
+        assert(cache);
+        assert(proc_fd >= 0);
+        assert(filename);
+        assert(ret);
+
+        r = read_virtual_file_at_buffer(proc_fd, filename, SIZE_MAX, &cache->proc_buffer, /* ret_size= */ NULL);
+        if (r < 0)
+                return r;
+
+        *ret = cache->proc_buffer;
+        return 0;
+}
+
+static void client_context_read_status(
+                ClientContextCache *cache,
+                ClientContext *c,
+                int proc_fd,
+                const struct ucred *ucred) {
+
+        char *status, *t;
+
+        assert(cache);
         assert(c);
-        assert(pid_is_valid(c->pid));
+
+        /* Uid, Gid and CapEff all come from the same file, hence read it only once */
+        if (client_context_read_proc_file(cache, proc_fd, "status", &status) < 0)
+                status = NULL;
 
         /* The ucred data passed in is always the most current and accurate, if we have any. Use it. */
         if (ucred && uid_is_valid(ucred->uid))
                 c->uid = ucred->uid;
-        else
-                (void) pid_get_uid(c->pid, &c->uid);
+        else if (status && get_proc_field_from_string(status, "Uid", WHITESPACE, &t) >= 0) {
+                (void) parse_uid(t, &c->uid);
+                free(t);
+        }
 
         if (ucred && gid_is_valid(ucred->gid))
                 c->gid = ucred->gid;
-        else
-                (void) get_process_gid(c->pid, &c->gid);
+        else if (status && get_proc_field_from_string(status, "Gid", WHITESPACE, &t) >= 0) {
+                (void) parse_gid(t, &c->gid);
+                free(t);
+        }
+
+        if (status && get_proc_field_from_string(status, "CapEff", WHITESPACE, &t) >= 0)
+                free_and_replace(c->capeff, t);
 }
 
-static void client_context_read_basic(ClientContext *c) {
-        char *t;
+static void client_context_read_basic(ClientContextCache *cache, ClientContext *c, int proc_fd) {
+        char *comm, *t;
 
+        assert(cache);
         assert(c);
         assert(pid_is_valid(c->pid));
 
-        if (pid_get_comm(c->pid, &t) >= 0)
-                free_and_replace(c->comm, t);
+        if (client_context_read_proc_file(cache, proc_fd, "comm", &comm) >= 0) {
+                t = new(char, COMM_MAX_LEN);
+                if (t) {
+                        /* Same as pid_get_comm() */
+                        cellescape(t, COMM_MAX_LEN, truncate_nl(comm));
+                        free_and_replace(c->comm, t);
+                }
+        }
 
-        if (get_process_exe(c->pid, &t) >= 0)
+        if (readlinkat_malloc(proc_fd, "exe", &t) >= 0)
                 free_and_replace(c->exe, t);
 
         if (pid_get_cmdline(c->pid, SIZE_MAX, PROCESS_CMDLINE_QUOTE, &t) >= 0)
                 free_and_replace(c->cmdline, t);
+}
 
-        if (get_process_capeff(c->pid, &t) >= 0)
-                free_and_replace(c->capeff, t);
+static void client_context_read_audit(ClientContextCache *cache, ClientContext *c, int proc_fd) {
+        char *v;
+        uint32_t u;
+        uid_t uid;
+
+        assert(cache);
+        assert(c);
+
+        /* Same as audit_session_from_pid() and audit_loginuid_from_pid() */
+        if (client_context_read_proc_file(cache, proc_fd, "sessionid", &v) >= 0 &&
+            safe_atou32(truncate_nl(v), &u) >= 0 &&
+            audit_session_is_valid(u))
+                c->auditid = u;
+
+        if (client_context_read_proc_file(cache, proc_fd, "loginuid", &v) >= 0 &&
+            parse_uid(truncate_nl(v), &uid) >= 0)
+                c->loginuid = uid;
 }
 
 static int client_context_read_label(
@@ -294,8 +534,6 @@ static int client_context_read_cgroup(Server *s, ClientContext *c, const char *u
                 return r;
         }
 
-        (void) client_context_read_log_filter_patterns(c, t);
-
         /* Let's shortcut this if the cgroup path didn't change */
         if (streq_ptr(c->cgroup, t))
                 return 0;
@@ -323,14 +561,14 @@ static int client_context_read_cgroup(Server *s, ClientContext *c, const char *u
         return 0;
 }
 
-static int client_context_read_invocation_id(
-                Server *s,
-                ClientContext *c) {
+static int client_unit_context_read_invocation_id(
+                ClientUnitContext *u,
+                const ClientContext *c) {
 
         _cleanup_free_ char *p = NULL, *value = NULL;
         int r;
 
-        assert(s);
+        assert(u);
         assert(c);
 
         /* Read the invocation ID of a unit off a unit.
@@ -351,25 +589,36 @@ static int client_context_read_invocation_id(
         }
 
         r = readlink_malloc(p, &value);
+        if (r == -ENOENT) {
+                u->invocation_id = SD_ID128_NULL;
+                return 0;
+        }
         if (r < 0)
                 return r;
 
-        return sd_id128_from_string(value, &c->invocation_id);
+        return sd_id128_from_string(value, &u->invocation_id);
 }
 
-static int client_context_read_log_level_max(
-                Server *s,
-                ClientContext *c) {
+static int client_unit_context_read_log_level_max(
+                ClientUnitContext *u,
+                const ClientContext *c) {
 
         _cleanup_free_ char *value = NULL;
         const char *p;
         int r, ll;
 
+        assert(u);
+        assert(c);
+
         if (!c->unit)
                 return 0;
 
         p = strjoina("/run/systemd/units/log-level-max:", c->unit);
         r = readlink_malloc(p, &value);
+        if (r == -ENOENT) {
+                u->log_level_max = -1;
+                return 0;
+        }
         if (r < 0)
                 return r;
 
@@ -377,13 +626,13 @@ static int client_context_read_log_level_max(
         if (ll < 0)
                 return ll;
 
-        c->log_level_max = ll;
+        u->log_level_max = ll;
         return 0;
 }
 
-static int client_context_read_extra_fields(
-                Server *s,
-                ClientContext *c) {
+static int client_unit_context_read_extra_fields(
+                ClientUnitContext *u,
+                const ClientContext *c) {
 
         _cleanup_free_ struct iovec *iovec = NULL;
         size_t size = 0, n_iovec = 0, left;
@@ -394,12 +643,15 @@ static int client_context_read_extra_fields(
         uint8_t *q;
         int r;
 
+        assert(u);
+        assert(c);
+
         if (!c->unit)
                 return 0;
 
         p = strjoina("/run/systemd/units/log-extra-fields:", c->unit);
 
-        if (c->extra_fields_mtime != NSEC_INFINITY) {
+        if (u->extra_fields_mtime != NSEC_INFINITY) {
                 if (stat(p, &st) < 0) {
                         if (errno == ENOENT)
                                 return 0;
@@ -407,7 +659,7 @@ static int client_context_read_extra_fields(
                         return -errno;
                 }
 
-                if (timespec_load_nsec(&st.st_mtim) == c->extra_fields_mtime)
+                if (timespec_load_nsec(&st.st_mtim) == u->extra_fields_mtime)
                         return 0;
         }
 
@@ -460,22 +712,23 @@ static int client_context_read_extra_fields(
                 left -= n, q += n;
         }
 
-        free(c->extra_fields_iovec);
-        free(c->extra_fields_data);
+        free(u->extra_fields_iovec);
+        free(u->extra_fields_data);
 
-        c->extra_fields_iovec = TAKE_PTR(iovec);
-        c->extra_fields_n_iovec = n_iovec;
-        c->extra_fields_data = TAKE_PTR(data);
-        c->extra_fields_mtime = timespec_load_nsec(&st.st_mtim);
+        u->extra_fields_iovec = TAKE_PTR(iovec);
+        u->extra_fields_n_iovec = n_iovec;
+        u->extra_fields_data = TAKE_PTR(data);
+        u->extra_fields_mtime = timespec_load_nsec(&st.st_mtim);
 
         return 0;
 }
 
-static int client_context_read_log_ratelimit_interval(ClientContext *c) {
+static int client_unit_context_read_log_ratelimit_interval(ClientUnitContext *u, const ClientContext *c) {
         _cleanup_free_ char *value = NULL;
         const char *p;
         int r;
 
+        assert(u);
         assert(c);
 
         if (!c->unit)
@@ -483,17 +736,22 @@ static int client_context_read_log_ratelimit_interval(ClientContext *c) {
 
         p = strjoina("/run/systemd/units/log-rate-limit-interval:", c->unit);
         r = readlink_malloc(p, &value);
+        if (r == -ENOENT) {
+                u->log_ratelimit_interval = USEC_INFINITY;
+                return 0;
+        }
         if (r < 0)
                 return r;
 
-        return safe_atou64(value, &c->log_ratelimit_interval);
+        return safe_atou64(value, &u->log_ratelimit_interval);
 }
 
-static int client_context_read_log_ratelimit_burst(ClientContext *c) {
+static int client_unit_context_read_log_ratelimit_burst(ClientUnitContext *u, const ClientContext *c) {
         _cleanup_free_ char *value = NULL;
         const char *p;
         int r;
 
+        assert(u);
         assert(c);
 
         if (!c->unit)
@@ -501,10 +759,58 @@ static int client_context_read_log_ratelimit_burst(ClientContext *c) {
 
         p = strjoina("/run/systemd/units/log-rate-limit-burst:", c->unit);
         r = readlink_malloc(p, &value);
+        if (r == -ENOENT) {
+                u->log_ratelimit_burst = UINT_MAX;
+                return 0;
+        }
         if (r < 0)
                 return r;
 
-        return safe_atou(value, &c->log_ratelimit_burst);
+        return safe_atou(value, &u->log_ratelimit_burst);
+}
+
+static void client_context_read_unit_context(Server *s, ClientContext *c, usec_t timestamp) {
+        ClientUnitContext *u;
+        const char *id;
+
+        assert(s);
+        assert(c);
+
+        /* Processes in the same cgroup share their unit metadata, hence find the unit context for the
+         * cgroup, and only reread it if nobody else did so recently. */
+
+        id = c->cgroup ?: c->unit;
+        if (!id)
+                return;
+
+        if (c->unit_context && !streq(c->unit_context->id, id))
+                c->unit_context = client_unit_context_unref(s, c->unit_context);
+
+        if (!c->unit_context && client_unit_context_acquire(s, id, &c->unit_context) < 0)
+                return;
+
+        u = c->unit_context;
+
+        if (u->timestamp != USEC_INFINITY && u->timestamp + client_context_refresh_usec(s) >= timestamp)
+                s->client_context_cache->statistics.n_unit_hits++;
+        else {
+                if (c->cgroup)
+                        (void) client_unit_context_read_log_filter_patterns(u, c->cgroup);
+
+                (void) client_unit_context_read_invocation_id(u, c);
+                (void) client_unit_context_read_log_level_max(u, c);
+                (void) client_unit_context_read_extra_fields(u, c);
+                (void) client_unit_context_read_log_ratelimit_interval(u, c);
+                (void) client_unit_context_read_log_ratelimit_burst(u, c);
+
+                u->timestamp = timestamp;
+                s->client_context_cache->statistics.n_unit_refreshes++;
+        }
+
+        c->invocation_id = u->invocation_id;
+        c->log_level_max = u->log_level_max;
+        c->log_ratelimit_interval = u->log_ratelimit_interval;
+        c->log_ratelimit_burst = u->log_ratelimit_burst;
 }
 
 static void client_context_really_refresh(
@@ -515,6 +821,8 @@ static void client_context_really_refresh(
                 const char *unit_id,
                 usec_t timestamp) {
 
+        _cleanup_close_ int proc_fd = -EBADF;
+
         assert(s);
         assert(c);
         assert(pid_is_valid(c->pid));
@@ -522,25 +830,38 @@ static void client_context_really_refresh(
         if (timestamp == USEC_INFINITY)
                 timestamp = now(CLOCK_MONOTONIC);
 
-        client_context_read_uid_gid(c, ucred);
-        client_context_read_basic(c);
+        if (c->pidfd_id == 0)
+                c->pidfd_id = client_context_read_pidfd_id(c);
+
+        /* Resolve the /proc/PID directory once, and read the small files below it into the same buffer,
+         * instead of going through the generic helpers, which allocate and use stdio for each of them. Under
+         * a log flood this is done for each client on each refresh. We don't keep the directory open across
+         * refreshes: the fds would count against our limit, and the PID might be reused in the meantime. */
+        proc_fd = open(procfs_file_alloca(c->pid, ""), O_DIRECTORY|O_CLOEXEC|O_PATH);
+        if (proc_fd >= 0) {
+                client_context_read_status(s->client_context_cache, c, proc_fd, ucred);
+                client_context_read_basic(s->client_context_cache, c, proc_fd);
+        } else if (ucred) {
+                if (uid_is_valid(ucred->uid))
+                        c->uid = ucred->uid;
+                if (gid_is_valid(ucred->gid))
+                        c->gid = ucred->gid;
+        }
+
         (void) client_context_read_label(c, label, label_size);
 
-        (void) audit_session_from_pid(c->pid, &c->auditid);
-        (void) audit_loginuid_from_pid(c->pid, &c->loginuid);
+        if (proc_fd >= 0)
+                client_context_read_audit(s->client_context_cache, c, proc_fd);
 
         (void) client_context_read_cgroup(s, c, unit_id);
-        (void) client_context_read_invocation_id(s, c);
-        (void) client_context_read_log_level_max(s, c);
-        (void) client_context_read_extra_fields(s, c);
-        (void) client_context_read_log_ratelimit_interval(c);
-        (void) client_context_read_log_ratelimit_burst(c);
+        client_context_read_unit_context(s, c, timestamp);
 
         c->timestamp = timestamp;
+        client_context_update_size(s, c);
 
         if (c->in_lru) {
                 assert(c->n_ref == 0);
-                prioq_reshuffle(s->client_contexts_lru, c, &c->lru_index);
+                prioq_reshuffle(s->client_context_cache->lru, c, &c->lru_index);
         }
 }
 
@@ -562,16 +883,30 @@ void client_context_maybe_refresh(
         if (c->timestamp == USEC_INFINITY)
                 goto refresh;
 
-        /* If the data isn't pinned and if the cashed data is older than the upper limit, we flush it out
-         * entirely. This follows the logic that as long as an entry is pinned the PID reuse is unlikely. */
-        if (c->n_ref == 0 && c->timestamp + MAX_USEC < timestamp) {
-                client_context_reset(s, c);
-                goto refresh;
-        }
+        /* If the data is older than the lower limit, we refresh, but keep the old data for all we can't
+         * update. */
+        if (c->timestamp + client_context_refresh_usec(s) < timestamp) {
+                uint64_t pidfd_id;
+                bool reused;
+
+                /* If the pidfd tells us the PID refers to a different process now, we flush the old data out
+                 * entirely. If it cannot tell us, we do the same if the data isn't pinned and is older than
+                 * the upper limit. This follows the logic that as long as an entry is pinned the PID reuse is
+                 * unlikely. */
+                pidfd_id = client_context_read_pidfd_id(c);
+                if (pidfd_id != 0 && c->pidfd_id != 0)
+                        reused = pidfd_id != c->pidfd_id;
+                else
+                        reused = c->n_ref == 0 && c->timestamp + MAX_USEC < timestamp;
+
+                if (reused) {
+                        client_context_reset(s, c);
+                        s->client_context_cache->statistics.n_resets++;
+                }
 
-        /* If the data is older than the lower limit, we refresh, but keep the old data for all we can't update */
-        if (c->timestamp + REFRESH_USEC < timestamp)
+                c->pidfd_id = pidfd_id;
                 goto refresh;
+        }
 
         /* If the data passed along doesn't match the cached data we also do a refresh */
         if (ucred && uid_is_valid(ucred->uid) && c->uid != ucred->uid)
@@ -583,9 +918,11 @@ void client_context_maybe_refresh(
         if (label_size > 0 && (label_size != c->label_size || memcmp(label, c->label, label_size) != 0))
                 goto refresh;
 
+        s->client_context_cache->statistics.n_hits++;
         return;
 
 refresh:
+        s->client_context_cache->statistics.n_refreshes++;
         client_context_really_refresh(s, c, ucred, label, label_size, unit_id, timestamp);
 }
 
@@ -598,14 +935,14 @@ static void client_context_try_shrink_to(Server *s, size_t limit) {
         /* Flush any cache entries for PIDs that have already moved on. Don't do this
          * too often, since it's a slow process. */
         t = now(CLOCK_MONOTONIC);
-        if (s->last_cache_pid_flush + MAX_USEC < t) {
-                unsigned n = prioq_size(s->client_contexts_lru), idx = 0;
+        if (s->client_context_cache->last_pid_flush + MAX_USEC < t) {
+                unsigned n = prioq_size(s->client_context_cache->lru), idx = 0;
 
                 /* We do a number of iterations based on the initial size of the prioq.  When we remove an
                  * item, a new item is moved into its places, and items to the right might be reshuffled.
                  */
                 for (unsigned i = 0; i < n; i++) {
-                        c = prioq_peek_by_index(s->client_contexts_lru, idx);
+                        c = prioq_peek_by_index(s->client_context_cache->lru, idx);
 
                         assert(c->n_ref == 0);
 
@@ -615,15 +952,16 @@ static void client_context_try_shrink_to(Server *s, size_t limit) {
                                 idx++;
                 }
 
-                s->last_cache_pid_flush = t;
+                s->client_context_cache->last_pid_flush = t;
         }
 
         /* Bring the number of cache entries below the indicated limit, so that we can create a new entry without
-         * breaching the limit. Note that we only flush out entries that aren't pinned here. This means the number of
-         * cache entries may very well grow beyond the limit, if all entries stored remain pinned. */
+         * breaching the limit, and the memory used below the maximum. Note that we only flush out entries that aren't
+         * pinned here. This means the cache may very well grow beyond the limits, if all entries stored remain
+         * pinned. */
 
-        while (hashmap_size(s->client_contexts) > limit) {
-                c = prioq_pop(s->client_contexts_lru);
+        while (hashmap_size(s->client_context_cache->contexts) > limit || s->client_context_cache->size > cache_max_size()) {
+                c = prioq_pop(s->client_context_cache->lru);
                 if (!c)
                         break; /* All remaining entries are pinned, give up */
 
@@ -633,6 +971,7 @@ static void client_context_try_shrink_to(Server *s, size_t limit) {
                 c->in_lru = false;
 
                 client_context_free(s, c);
+                s->client_context_cache->statistics.n_evictions++;
         }
 }
 
@@ -650,11 +989,18 @@ void client_context_flush_all(Server *s) {
 
         client_context_flush_regular(s);
 
-        assert(prioq_isempty(s->client_contexts_lru));
-        assert(hashmap_isempty(s->client_contexts));
+        /* If the cache is shared with the servers of other namespaces, they might still have pinned entries */
+        if (s->client_context_cache->n_ref > 1)
+                return;
 
-        s->client_contexts_lru = prioq_free(s->client_contexts_lru);
-        s->client_contexts = hashmap_free(s->client_contexts);
+        assert(prioq_isempty(s->client_context_cache->lru));
+        assert(hashmap_isempty(s->client_context_cache->contexts));
+        assert(hashmap_isempty(s->client_context_cache->unit_contexts));
+        assert(s->client_context_cache->size == 0);
+
+        s->client_context_cache->lru = prioq_free(s->client_context_cache->lru);
+        s->client_context_cache->contexts = hashmap_free(s->client_context_cache->contexts);
+        s->client_context_cache->unit_contexts = hashmap_free(s->client_context_cache->unit_contexts);
 }
 
 static int client_context_get_internal(
@@ -675,14 +1021,14 @@ static int client_context_get_internal(
         if (!pid_is_valid(pid))
                 return -EINVAL;
 
-        c = hashmap_get(s->client_contexts, PID_TO_PTR(pid));
+        c = hashmap_get(s->client_context_cache->contexts, PID_TO_PTR(pid));
         if (c) {
 
                 if (add_ref) {
                         if (c->in_lru) {
                                 /* The entry wasn't pinned so far, let's remove it from the LRU list then */
                                 assert(c->n_ref == 0);
-                                assert_se(prioq_remove(s->client_contexts_lru, c, &c->lru_index) >= 0);
+                                assert_se(prioq_remove(s->client_context_cache->lru, c, &c->lru_index) >= 0);
                                 c->in_lru = false;
                         }
 
@@ -695,7 +1041,9 @@ static int client_context_get_internal(
                 return 0;
         }
 
-        client_context_try_shrink_to(s, cache_max()-1);
+        client_context_try_shrink_to(s, CACHE_MAX-1);
+
+        s->client_context_cache->statistics.n_misses++;
 
         r = client_context_new(s, pid, &c);
         if (r < 0)
@@ -704,7 +1052,7 @@ static int client_context_get_internal(
         if (add_ref)
                 c->n_ref++;
         else {
-                r = prioq_put(s->client_contexts_lru, c, &c->lru_index);
+                r = prioq_put(s->client_context_cache->lru, c, &c->lru_index);
                 if (r < 0) {
                         client_context_free(s, c);
                         return r;
@@ -757,7 +1105,7 @@ ClientContext *client_context_release(Server *s, ClientContext *c) {
         /* The entry is not pinned anymore, let's add it to the LRU prioq if we can. If we can't we'll drop it
          * right-away */
 
-        if (prioq_put(s->client_contexts_lru, c, &c->lru_index) < 0)
+        if (prioq_put(s->client_context_cache->lru, c, &c->lru_index) < 0)
                 client_context_free(s, c);
         else
                 c->in_lru = true;
@@ -765,6 +1113,17 @@ ClientContext *client_context_release(Server *s, ClientContext *c) {
         return NULL;
 }
 
+void client_context_get_ratelimit(const ClientContext *c, const Server *s, usec_t *ret_interval, unsigned *ret_burst) {
+        assert(c);
+        assert(s);
+        assert(ret_interval);
+        assert(ret_burst);
+
+        /* Unless the unit says otherwise, the configuration of the server the message is for applies */
+        *ret_interval = c->log_ratelimit_interval != USEC_INFINITY ? c->log_ratelimit_interval : s->ratelimit_interval;
+        *ret_burst = c->log_ratelimit_burst != UINT_MAX ? c->log_ratelimit_burst : s->ratelimit_burst;
+}
+
 void client_context_acquire_default(Server *s) {
         int r;
 
@@ -7,13 +7,68 @@
 
 #include "sd-id128.h"
 
+#include "hashmap.h"
+#include "prioq.h"
 #include "set.h"
 #include "time-util.h"
 
 typedef struct ClientContext ClientContext;
+typedef struct ClientUnitContext ClientUnitContext;
+
+typedef struct ClientContextStatistics {
+        uint64_t n_hits;            /* cached entry used as is */
+        uint64_t n_misses;          /* new entry created */
+        uint64_t n_refreshes;       /* cached entry reread from /proc */
+        uint64_t n_resets;          /* cached entry flushed because it was too old or the PID was reused */
+        uint64_t n_evictions;       /* unpinned entry dropped due to cache pressure */
+        uint64_t n_unit_hits;       /* unit metadata reused from another client in the same cgroup */
+        uint64_t n_unit_refreshes;  /* unit metadata reread */
+} ClientContextStatistics;
+
+/* The cache of client metadata. It may be shared between the servers for several namespaces in the same
+ * process, hence it is reference counted. */
+typedef struct ClientContextCache {
+        unsigned n_ref;
+
+        Hashmap *contexts;
+        Prioq *lru;
+        size_t size;
+        Hashmap *unit_contexts;
+        ClientContextStatistics statistics;
+
+        usec_t last_pid_flush;
+
+        /* Scratch buffer for the small /proc files read on each refresh, see read_virtual_file_at_buffer() */
+        char *proc_buffer;
+} ClientContextCache;
 
 #include "journald-server.h"
 
+/* Metadata that is a property of the unit rather than the process. It is shared between all clients in the same
+ * cgroup, and is refreshed once for all of them. */
+struct ClientUnitContext {
+        unsigned n_ref;
+        usec_t timestamp;
+
+        char *id; /* the cgroup path, or the unit name if we do not know the cgroup */
+
+        sd_id128_t invocation_id;
+
+        int log_level_max;
+
+        struct iovec *extra_fields_iovec;
+        size_t extra_fields_n_iovec;
+        void *extra_fields_data;
+        nsec_t extra_fields_mtime;
+
+        /* USEC_INFINITY and UINT_MAX if not configured for the unit, see client_context_get_ratelimit() */
+        usec_t log_ratelimit_interval;
+        unsigned log_ratelimit_burst;
+
+        Set *log_filter_allowed_patterns;
+        Set *log_filter_denied_patterns;
+};
+
 struct ClientContext {
         unsigned n_ref;
         unsigned lru_index;
@@ -21,6 +76,8 @@ struct ClientContext {
         bool in_lru;
 
         pid_t pid;
+        uint64_t pidfd_id; /* the inode number of the pidfd, to recognize PID reuse, 0 if unknown */
+        size_t size; /* approximate memory used by this entry */
         uid_t uid;
         gid_t gid;
 
@@ -42,25 +99,23 @@ struct ClientContext {
         char *slice;
         char *user_slice;
 
-        sd_id128_t invocation_id;
-
         char *label;
         size_t label_size;
 
-        int log_level_max;
-
-        struct iovec *extra_fields_iovec;
-        size_t extra_fields_n_iovec;
-        void *extra_fields_data;
-        nsec_t extra_fields_mtime;
+        ClientUnitContext *unit_context;
 
+        /* Copied from the unit context */
+        sd_id128_t invocation_id;
+        int log_level_max;
         usec_t log_ratelimit_interval;
         unsigned log_ratelimit_burst;
-
-        Set *log_filter_allowed_patterns;
-        Set *log_filter_denied_patterns;
 };
 
+int client_context_cache_new(ClientContextCache **ret);
+ClientContextCache* client_context_cache_ref(ClientContextCache *c);
+ClientContextCache* client_context_cache_unref(ClientContextCache *c);
+DEFINE_TRIVIAL_CLEANUP_FUNC(ClientContextCache*, client_context_cache_unref);
+
 int client_context_get(
                 Server *s,
                 pid_t pid,
@@ -91,8 +146,10 @@ void client_context_acquire_default(Server *s);
 void client_context_flush_all(Server *s);
 void client_context_flush_regular(Server *s);
 
+void client_context_get_ratelimit(const ClientContext *c, const Server *s, usec_t *ret_interval, unsigned *ret_burst);
+
 static inline size_t client_context_extra_fields_n_iovec(const ClientContext *c) {
-        return c ? c->extra_fields_n_iovec : 0;
+        return c && c->unit_context ? c->unit_context->extra_fields_n_iovec : 0;
 }
 
 static inline bool client_context_test_priority(const ClientContext *c, int priority) {
@@ -26,6 +26,90 @@
 #include "stdio-util.h"
 #include "string-util.h"
 
+/* How many records to read from /dev/kmsg per wakeup at most, so that other sources get their turn */
+#define KMSG_BATCH_MAX 64U
+
+/* Devices referenced by kernel messages are looked up at most this often, and this many are remembered */
+#define KMSG_DEVICE_CACHE_USEC (10 * USEC_PER_SEC)
+#define KMSG_DEVICE_CACHE_MAX 256U
+
+typedef struct KmsgDevice {
+        char *id;
+        sd_device *device; /* NULL if the device could not be found */
+        usec_t timestamp;
+} KmsgDevice;
+
+static KmsgDevice* kmsg_device_free(KmsgDevice *d) {
+        if (!d)
+                return NULL;
+
+        sd_device_unref(d->device);
+        free(d->id);
+        return mfree(d);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(KmsgDevice*, kmsg_device_free);
+
+DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(
+        kmsg_device_hash_ops,
+        char,
+        string_hash_func,
+        string_compare_func,
+        KmsgDevice,
+        kmsg_device_free);
+
+static sd_device* server_get_kmsg_device(Server *s, const char *id) {
+        _cleanup_(kmsg_device_freep) KmsgDevice *d = NULL;
+        usec_t n;
+        int r;
+
+        assert(s);
+        assert(id);
+
+        /* During a storm of messages from a driver, the same few devices are referenced over and over
+         * again, hence remember them for a bit rather than reading them from sysfs and the udev database for
+         * each message. */
+
+        n = now(CLOCK_MONOTONIC);
+
+        d = hashmap_get(s->kmsg_devices, id);
+        if (d) {
+                if (usec_add(d->timestamp, KMSG_DEVICE_CACHE_USEC) > n)
+                        return TAKE_PTR(d)->device;
+
+                /* Outdated, look it up again */
+                assert_se(hashmap_remove(s->kmsg_devices, id) == d);
+                d = kmsg_device_free(d);
+        }
+
+        if (hashmap_size(s->kmsg_devices) >= KMSG_DEVICE_CACHE_MAX)
+                hashmap_clear(s->kmsg_devices);
+
+        d = new(KmsgDevice, 1);
+        if (!d)
+                return NULL;
+
+        *d = (KmsgDevice) {
+                .id = strdup(id),
+                .timestamp = n,
+        };
+        if (!d->id)
+                return NULL;
+
+        r = sd_device_new_from_device_id(&d->device, id);
+        if (r < 0)
+                log_debug_errno(r, "Failed to find kernel device '%s', ignoring: %m", id);
+
+        r = hashmap_ensure_put(&s->kmsg_devices, &kmsg_device_hash_ops, d->id, d);
+        if (r < 0) {
+                /* The cache owns the device, hence go without it */
+                log_debug_errno(r, "Failed to cache kernel device '%s', ignoring: %m", id);
+                return NULL;
+        }
+
+        return TAKE_PTR(d)->device;
+}
+
 void server_forward_kmsg(
                 Server *s,
                 int priority,
@@ -214,9 +298,10 @@ void dev_kmsg_record(Server *s, char *p, size_t l) {
         }
 
         if (kernel_device) {
-                _cleanup_(sd_device_unrefp) sd_device *d = NULL;
+                sd_device *d;
 
-                if (sd_device_new_from_device_id(&d, kernel_device) >= 0) {
+                d = server_get_kmsg_device(s, kernel_device);
+                if (d) {
                         const char *g;
                         char *b;
 
@@ -305,6 +390,7 @@ void dev_kmsg_record(Server *s, char *p, size_t l) {
         if (cunescape_length_with_prefix(p, pl, "MESSAGE=", UNESCAPE_RELAX, &message) >= 0)
                 iovec[n++] = IOVEC_MAKE_STRING(message);
 
+        s->statistics.n_received[SERVER_TRANSPORT_KERNEL]++;
         server_dispatch_message(s, iovec, n, ELEMENTSOF(iovec), c, NULL, priority, 0);
 
         if (saved_log_max_level != INT_MAX)
@@ -334,7 +420,15 @@ static int server_read_dev_kmsg(Server *s) {
                         return 0;
                 }
 
-                if (ERRNO_IS_TRANSIENT(errno) || errno == EPIPE)
+                if (errno == EPIPE) {
+                        /* We did not keep up, and the kernel overwrote records we did not read yet. The
+                         * next read continues with the oldest record still around. */
+                        s->statistics.n_kmsg_overruns++;
+                        log_ratelimit_warning(JOURNAL_LOG_RATELIMIT, "/dev/kmsg buffer overrun, some messages lost.");
+                        return 1;
+                }
+
+                if (ERRNO_IS_TRANSIENT(errno))
                         return 0;
 
                 return log_ratelimit_error_errno(errno, JOURNAL_LOG_RATELIMIT, "Failed to read from /dev/kmsg: %m");
@@ -375,14 +469,25 @@ static int dispatch_dev_kmsg(sd_event_source *es, int fd, uint32_t revents, void
         assert(es);
         assert(fd == s->dev_kmsg_fd);
 
-        if (revents & EPOLLERR)
-                log_ratelimit_warning(JOURNAL_LOG_RATELIMIT,
-                                      "/dev/kmsg buffer overrun, some messages lost.");
-
-        if (!(revents & EPOLLIN))
+        /* An overrun is signalled via EPOLLERR, and reported by the next read() with EPIPE, which is where
+         * we deal with it. */
+        if (!(revents & (EPOLLIN|EPOLLERR)))
                 log_error("Got invalid event from epoll for /dev/kmsg: %"PRIx32, revents);
 
-        return server_read_dev_kmsg(s);
+        /* Drain a bunch of records at once, the kernel ring buffer overflows quickly during a storm */
+        for (unsigned i = 0; i < KMSG_BATCH_MAX; i++) {
+                int r;
+
+                r = server_read_dev_kmsg(s);
+                if (r <= 0)
+                        return r;
+
+                /* Reading might have turned out to be impossible */
+                if (!s->dev_kmsg_event_source)
+                        break;
+        }
+
+        return 0;
 }
 
 int server_open_dev_kmsg(Server *s) {
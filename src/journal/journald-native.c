@@ -278,6 +278,7 @@ static int server_process_entry(
                         server_forward_wall(s, priority, identifier, message, ucred);
         }
 
+        s->statistics.n_received[SERVER_TRANSPORT_JOURNAL]++;
         server_dispatch_message(s, iovec, n, MALLOC_ELEMENTSOF(iovec), context, tv, priority, object_pid);
 
 finish:
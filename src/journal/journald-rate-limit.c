@@ -1,14 +1,24 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
 #include "alloc-util.h"
-#include "hashmap.h"
 #include "journald-rate-limit.h"
 #include "logarithm.h"
+#include "random-util.h"
+#include "siphash24.h"
 #include "string-util.h"
 #include "time-util.h"
 
 #define POOLS_MAX 5
-#define GROUPS_MAX 2047
+
+/* The groups are kept in an open-addressed table with linear probing, which grows and shrinks with the
+ * number of units that log. Only when it would grow beyond this many groups, groups that are still in use
+ * are evicted. */
+#define GROUPS_MAX 16384U
+#define BUCKETS_MIN 64U
+
+/* Whenever a group is added, this many buckets are checked for expired groups, so that the table is swept
+ * completely every now and then without ever walking all of it at once. */
+#define SWEEP_STEP 4U
 
 static const int priority_map[] = {
         [LOG_EMERG]   = 0,
@@ -28,38 +38,149 @@ typedef struct JournalRateLimitPool {
 } JournalRateLimitPool;
 
 typedef struct JournalRateLimitGroup {
-        OrderedHashmap *groups_by_id;
-
-        char *id;
+        char *id; /* NULL if the bucket is empty */
+        uint64_t hash;
 
         /* Interval is stored to keep track of when the group expires */
         usec_t interval;
 
+        /* Messages suppressed since the group was created */
+        uint64_t n_suppressed;
+
         JournalRateLimitPool pools[POOLS_MAX];
 } JournalRateLimitGroup;
 
-static JournalRateLimitGroup* journal_ratelimit_group_free(JournalRateLimitGroup *g) {
-        if (!g)
+struct JournalRateLimit {
+        JournalRateLimitGroup *buckets;
+        size_t n_buckets; /* always a power of two */
+        size_t n_groups;
+        size_t sweep_cursor;
+
+        uint8_t hash_key[16];
+};
+
+static size_t journal_ratelimit_home(JournalRateLimit *rl, uint64_t hash) {
+        assert(rl);
+
+        return hash & (rl->n_buckets - 1);
+}
+
+JournalRateLimit* journal_ratelimit_free(JournalRateLimit *rl) {
+        if (!rl)
                 return NULL;
 
-        if (g->groups_by_id && g->id)
-                /* The group is already removed from the hashmap when this is called from the
-                 * destructor of the hashmap. Hence, do not check the return value here. */
-                ordered_hashmap_remove_value(g->groups_by_id, g->id, g);
+        for (size_t i = 0; i < rl->n_buckets; i++)
+                free(rl->buckets[i].id);
+
+        free(rl->buckets);
+        return mfree(rl);
+}
+
+static int journal_ratelimit_new(JournalRateLimit **ret) {
+        _cleanup_(journal_ratelimit_freep) JournalRateLimit *rl = NULL;
+
+        assert(ret);
+
+        rl = new(JournalRateLimit, 1);
+        if (!rl)
+                return -ENOMEM;
+
+        *rl = (JournalRateLimit) {
+                .n_buckets = BUCKETS_MIN,
+        };
+
+        rl->buckets = new0(JournalRateLimitGroup, rl->n_buckets);
+        if (!rl->buckets)
+                return -ENOMEM;
 
-        free(g->id);
-        return mfree(g);
+        random_bytes(rl->hash_key, sizeof(rl->hash_key));
+
+        *ret = TAKE_PTR(rl);
+        return 0;
 }
 
-DEFINE_TRIVIAL_CLEANUP_FUNC(JournalRateLimitGroup*, journal_ratelimit_group_free);
+static JournalRateLimitGroup* journal_ratelimit_find(JournalRateLimit *rl, const char *id, uint64_t hash) {
+        assert(rl);
+        assert(id);
+
+        for (size_t i = journal_ratelimit_home(rl, hash);; i = (i + 1) & (rl->n_buckets - 1)) {
+                JournalRateLimitGroup *g = rl->buckets + i;
 
-DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(
-        journal_ratelimit_group_hash_ops,
-        char,
-        string_hash_func,
-        string_compare_func,
-        JournalRateLimitGroup,
-        journal_ratelimit_group_free);
+                if (!g->id)
+                        return NULL;
+
+                if (g->hash == hash && streq(g->id, id))
+                        return g;
+        }
+}
+
+static JournalRateLimitGroup* journal_ratelimit_slot(JournalRateLimit *rl, uint64_t hash) {
+        size_t i;
+
+        assert(rl);
+        assert(rl->n_groups < rl->n_buckets);
+
+        /* Returns the empty bucket a new group with this hash goes into */
+        for (i = journal_ratelimit_home(rl, hash); rl->buckets[i].id; i = (i + 1) & (rl->n_buckets - 1))
+                ;
+
+        return rl->buckets + i;
+}
+
+static void journal_ratelimit_remove(JournalRateLimit *rl, size_t i) {
+        size_t mask;
+
+        assert(rl);
+        assert(i < rl->n_buckets);
+        assert(rl->buckets[i].id);
+
+        mask = rl->n_buckets - 1;
+        free(rl->buckets[i].id);
+
+        /* Move up the groups behind the removed one that would not be found anymore otherwise, so that no
+         * tombstones are needed. */
+        for (size_t j = (i + 1) & mask; rl->buckets[j].id; j = (j + 1) & mask) {
+                size_t k = journal_ratelimit_home(rl, rl->buckets[j].hash);
+
+                /* Stays if its home lies cyclically in (i, j] */
+                if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+                        continue;
+
+                rl->buckets[i] = rl->buckets[j];
+                i = j;
+        }
+
+        rl->buckets[i] = (JournalRateLimitGroup) {};
+        rl->n_groups--;
+}
+
+static int journal_ratelimit_resize(JournalRateLimit *rl, size_t n_buckets) {
+        JournalRateLimitGroup *old;
+        size_t n_old;
+
+        assert(rl);
+        assert(ISPOWEROF2(n_buckets));
+        assert(rl->n_groups < n_buckets);
+
+        old = rl->buckets;
+        n_old = rl->n_buckets;
+
+        rl->buckets = new0(JournalRateLimitGroup, n_buckets);
+        if (!rl->buckets) {
+                rl->buckets = old;
+                return -ENOMEM;
+        }
+
+        rl->n_buckets = n_buckets;
+        rl->sweep_cursor = 0;
+
+        for (size_t i = 0; i < n_old; i++)
+                if (old[i].id)
+                        *journal_ratelimit_slot(rl, old[i].hash) = old[i];
+
+        free(old);
+        return 0;
+}
 
 static bool journal_ratelimit_group_expired(JournalRateLimitGroup *g, usec_t ts) {
         assert(g);
@@ -71,74 +192,92 @@ static bool journal_ratelimit_group_expired(JournalRateLimitGroup *g, usec_t ts)
         return true;
 }
 
-static void journal_ratelimit_vacuum(OrderedHashmap *groups_by_id, usec_t ts) {
+static void journal_ratelimit_sweep(JournalRateLimit *rl, size_t n, usec_t ts) {
+        assert(rl);
 
-        /* Makes room for at least one new item, but drop all expired items too. */
+        for (; n > 0; n--) {
+                size_t i = rl->sweep_cursor;
 
-        while (ordered_hashmap_size(groups_by_id) >= GROUPS_MAX)
-                journal_ratelimit_group_free(ordered_hashmap_first(groups_by_id));
+                if (rl->buckets[i].id && journal_ratelimit_group_expired(rl->buckets + i, ts))
+                        /* Another group might have been moved into this bucket, hence check it again */
+                        journal_ratelimit_remove(rl, i);
+                else
+                        rl->sweep_cursor = (i + 1) & (rl->n_buckets - 1);
+        }
 
-        JournalRateLimitGroup *g;
-        while ((g = ordered_hashmap_first(groups_by_id)) && journal_ratelimit_group_expired(g, ts))
-                journal_ratelimit_group_free(g);
+        /* Shrink once the table is mostly empty, but only after a complete sweep, so this is no hot path */
+        if (rl->sweep_cursor == 0 && rl->n_buckets > BUCKETS_MIN && rl->n_groups < rl->n_buckets / 8)
+                (void) journal_ratelimit_resize(rl, rl->n_buckets / 2);
 }
 
-static int journal_ratelimit_group_new(
-                OrderedHashmap **groups_by_id,
-                const char *id,
-                usec_t interval,
-                usec_t ts,
-                JournalRateLimitGroup **ret) {
-
-        _cleanup_(journal_ratelimit_group_freep) JournalRateLimitGroup *g = NULL;
-        int r;
-
-        assert(groups_by_id);
-        assert(id);
-        assert(ret);
+static int journal_ratelimit_make_room(JournalRateLimit *rl, usec_t ts) {
+        assert(rl);
 
-        g = new(JournalRateLimitGroup, 1);
-        if (!g)
-                return -ENOMEM;
+        journal_ratelimit_sweep(rl, SWEEP_STEP, ts);
 
-        *g = (JournalRateLimitGroup) {
-                .id = strdup(id),
-                .interval = interval,
-        };
-        if (!g->id)
-                return -ENOMEM;
+        if (rl->n_groups >= GROUPS_MAX) {
+                /* Too many groups. Drop the expired ones, and if that does not help, whichever group comes
+                 * next. */
+                journal_ratelimit_sweep(rl, rl->n_buckets, ts);
 
-        journal_ratelimit_vacuum(*groups_by_id, ts);
+                if (rl->n_groups >= GROUPS_MAX) {
+                        while (!rl->buckets[rl->sweep_cursor].id)
+                                rl->sweep_cursor = (rl->sweep_cursor + 1) & (rl->n_buckets - 1);
 
-        r = ordered_hashmap_ensure_put(groups_by_id, &journal_ratelimit_group_hash_ops, g->id, g);
-        if (r < 0)
-                return r;
-        assert(r > 0);
+                        journal_ratelimit_remove(rl, rl->sweep_cursor);
+                }
+        }
 
-        g->groups_by_id = *groups_by_id;
+        /* Keep the load factor at 3/4 at most */
+        if ((rl->n_groups + 1) * 4 <= rl->n_buckets * 3)
+                return 0;
 
-        *ret = TAKE_PTR(g);
-        return 0;
+        return journal_ratelimit_resize(rl, rl->n_buckets * 2);
 }
 
 static int journal_ratelimit_group_acquire(
-                OrderedHashmap **groups_by_id,
+                JournalRateLimit *rl,
                 const char *id,
                 usec_t interval,
                 usec_t ts,
                 JournalRateLimitGroup **ret) {
 
         JournalRateLimitGroup *g;
+        uint64_t hash;
+        char *copy;
+        int r;
 
-        assert(groups_by_id);
+        assert(rl);
         assert(id);
         assert(ret);
 
-        g = ordered_hashmap_get(*groups_by_id, id);
-        if (!g)
-                return journal_ratelimit_group_new(groups_by_id, id, interval, ts, ret);
+        hash = siphash24_string(id, rl->hash_key);
+
+        g = journal_ratelimit_find(rl, id, hash);
+        if (g) {
+                g->interval = interval;
+
+                *ret = g;
+                return 0;
+        }
+
+        copy = strdup(id);
+        if (!copy)
+                return -ENOMEM;
+
+        r = journal_ratelimit_make_room(rl, ts);
+        if (r < 0) {
+                free(copy);
+                return r;
+        }
 
-        g->interval = interval;
+        g = journal_ratelimit_slot(rl, hash);
+        *g = (JournalRateLimitGroup) {
+                .id = copy,
+                .hash = hash,
+                .interval = interval,
+        };
+        rl->n_groups++;
 
         *ret = g;
         return 0;
@@ -173,7 +312,7 @@ static unsigned burst_modulate(unsigned burst, uint64_t available) {
 }
 
 int journal_ratelimit_test(
-                OrderedHashmap **groups_by_id,
+                JournalRateLimit **rl,
                 const char *id,
                 usec_t rl_interval,
                 unsigned rl_burst,
@@ -186,7 +325,7 @@ int journal_ratelimit_test(
         usec_t ts;
         int r;
 
-        assert(groups_by_id);
+        assert(rl);
         assert(id);
 
         /* Returns:
@@ -196,15 +335,21 @@ int journal_ratelimit_test(
          * < 0   → error
          */
 
+        if (rl_interval == 0 || rl_burst == 0)
+                return 1;
+
+        if (!*rl) {
+                r = journal_ratelimit_new(rl);
+                if (r < 0)
+                        return r;
+        }
+
         ts = now(CLOCK_MONOTONIC);
 
-        r = journal_ratelimit_group_acquire(groups_by_id, id, rl_interval, ts, &g);
+        r = journal_ratelimit_group_acquire(*rl, id, rl_interval, ts, &g);
         if (r < 0)
                 return r;
 
-        if (rl_interval == 0 || rl_burst == 0)
-                return 1;
-
         burst = burst_modulate(rl_burst, available);
 
         p = &g->pools[priority_map[priority]];
@@ -233,5 +378,46 @@ int journal_ratelimit_test(
         }
 
         p->suppressed++;
+        g->n_suppressed++;
+        return 0;
+}
+
+size_t journal_ratelimit_size(JournalRateLimit *rl) {
+        return rl ? rl->n_groups : 0;
+}
+
+int journal_ratelimit_build_json(JournalRateLimit *rl, sd_json_variant **ret) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        int r;
+
+        assert(ret);
+
+        for (size_t i = 0; rl && i < rl->n_buckets; i++) {
+                JournalRateLimitGroup *g = rl->buckets + i;
+                uint64_t suppressing = 0;
+
+                if (!g->id)
+                        continue;
+
+                FOREACH_ELEMENT(p, g->pools)
+                        suppressing += p->suppressed;
+
+                r = sd_json_variant_append_arraybo(
+                                &v,
+                                SD_JSON_BUILD_PAIR_STRING("unit", g->id),
+                                SD_JSON_BUILD_PAIR_UNSIGNED("intervalUSec", g->interval),
+                                SD_JSON_BUILD_PAIR_UNSIGNED("suppressed", g->n_suppressed),
+                                SD_JSON_BUILD_PAIR_UNSIGNED("suppressedPending", suppressing));
+                if (r < 0)
+                        return r;
+        }
+
+        if (!v) {
+                r = sd_json_variant_new_array(&v, NULL, 0);
+                if (r < 0)
+                        return r;
+        }
+
+        *ret = TAKE_PTR(v);
         return 0;
 }
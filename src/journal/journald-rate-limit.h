@@ -3,13 +3,23 @@
 
 #include <inttypes.h>
 
-#include "hashmap.h"
+#include "sd-json.h"
+
+#include "macro.h"
 #include "time-util.h"
 
+typedef struct JournalRateLimit JournalRateLimit;
+
+JournalRateLimit* journal_ratelimit_free(JournalRateLimit *rl);
+DEFINE_TRIVIAL_CLEANUP_FUNC(JournalRateLimit*, journal_ratelimit_free);
+
 int journal_ratelimit_test(
-                OrderedHashmap **groups_by_id,
+                JournalRateLimit **rl,
                 const char *id,
                 usec_t rl_interval,
                 unsigned rl_burst,
                 int priority,
                 uint64_t available);
+
+size_t journal_ratelimit_size(JournalRateLimit *rl);
+int journal_ratelimit_build_json(JournalRateLimit *rl, sd_json_variant **ret);
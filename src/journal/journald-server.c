@@ -3,6 +3,7 @@
 #if HAVE_SELINUX
 #include <selinux/selinux.h>
 #endif
+#include <fcntl.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <sys/signalfd.h>
@@ -43,6 +44,7 @@
 #include "journald-server.h"
 #include "journald-socket.h"
 #include "journald-stream.h"
+#include "journald-sync.h"
 #include "journald-syslog.h"
 #include "log.h"
 #include "memory-util.h"
@@ -64,10 +66,12 @@
 #include "uid-classification.h"
 #include "user-util.h"
 #include "varlink-io.systemd.Journal.h"
+#include "varlink-io.systemd.service.h"
 
 #define USER_JOURNALS_MAX 1024
 
 #define DEFAULT_SYNC_INTERVAL_USEC (5*USEC_PER_MINUTE)
+#define DEFAULT_FORWARD_LATENCY_USEC (10*USEC_PER_MSEC)
 #define DEFAULT_RATE_LIMIT_INTERVAL (30*USEC_PER_SEC)
 #define DEFAULT_RATE_LIMIT_BURST 10000
 #define DEFAULT_MAX_FILE_USEC USEC_PER_MONTH
@@ -88,8 +92,29 @@
 
 #define DEFERRED_CLOSES_MAX (4096)
 
+/* Number of entries copied at once when flushing the runtime journal to /var */
+#define FLUSH_BATCH_MAX (1024U)
+
+/* Maximum number of datagrams processed per wakeup of a datagram socket */
+#define DATAGRAM_BATCH_MAX (16U)
+
+/* Room for a full audit netlink message */
+#define AUDIT_DATAGRAM_SIZE (CONST_ALIGN_TO(sizeof(struct nlmsghdr), sizeof(void*)) + CONST_ALIGN_TO((size_t) MAX_AUDIT_MESSAGE_LENGTH, sizeof(void*)) + 1)
+
+struct DatagramBatch {
+        struct mmsghdr messages[DATAGRAM_BATCH_MAX];
+        struct iovec iovecs[DATAGRAM_BATCH_MAX];
+        union sockaddr_union addresses[DATAGRAM_BATCH_MAX];
+        CMSG_BUFFER_TYPE(CMSG_SPACE(sizeof(struct ucred)) +
+                         CMSG_SPACE(sizeof(int)) /* fd */) controls[DATAGRAM_BATCH_MAX];
+        char buffers[DATAGRAM_BATCH_MAX][AUDIT_DATAGRAM_SIZE];
+};
+
 #define IDLE_TIMEOUT_USEC (30*USEC_PER_SEC)
 
+/* How often statistics are sent to subscribers */
+#define STATISTICS_INTERVAL_USEC (1*USEC_PER_SEC)
+
 #define FAILED_TO_WRITE_ENTRY_RATELIMIT ((const RateLimit) { .interval = 1 * USEC_PER_SEC, .burst = 1 })
 
 static int server_schedule_sync(Server *s, int priority);
@@ -101,43 +126,26 @@ static int server_determine_path_usage(
                 uint64_t *ret_used,
                 uint64_t *ret_free) {
 
-        _cleanup_closedir_ DIR *d = NULL;
         struct statvfs ss;
+        int r;
 
         assert(s);
         assert(path);
         assert(ret_used);
         assert(ret_free);
 
-        d = opendir(path);
-        if (!d)
+        if (statvfs(path, &ss) < 0)
                 return log_ratelimit_full_errno(errno == ENOENT ? LOG_DEBUG : LOG_ERR,
-                                                errno, JOURNAL_LOG_RATELIMIT, "Failed to open %s: %m", path);
+                                                errno, JOURNAL_LOG_RATELIMIT, "Failed to statvfs(%s): %m", path);
 
-        if (fstatvfs(dirfd(d), &ss) < 0)
-                return log_ratelimit_error_errno(errno, JOURNAL_LOG_RATELIMIT,
-                                                "Failed to fstatvfs(%s): %m", path);
+        /* Archived files are mostly accounted for by the manifest vacuuming maintains, so that we don't have
+         * to stat() every single one of them here. */
+        r = journal_directory_usage(path, ret_used);
+        if (r < 0)
+                return log_ratelimit_full_errno(r == -ENOENT ? LOG_DEBUG : LOG_ERR,
+                                                r, JOURNAL_LOG_RATELIMIT, "Failed to determine disk usage of %s: %m", path);
 
         *ret_free = ss.f_bsize * ss.f_bavail;
-        *ret_used = 0;
-        FOREACH_DIRENT_ALL(de, d, break) {
-                struct stat st;
-
-                if (!endswith(de->d_name, ".journal") &&
-                    !endswith(de->d_name, ".journal~"))
-                        continue;
-
-                if (fstatat(dirfd(d), de->d_name, &st, AT_SYMLINK_NOFOLLOW) < 0) {
-                        log_debug_errno(errno, "Failed to stat %s/%s, ignoring: %m", path, de->d_name);
-                        continue;
-                }
-
-                if (!S_ISREG(st.st_mode))
-                        continue;
-
-                *ret_used += (uint64_t) st.st_blocks * 512UL;
-        }
-
         return 0;
 }
 
@@ -148,7 +156,7 @@ static void cache_space_invalidate(JournalStorageSpace *space) {
 static int cache_space_refresh(Server *s, JournalStorage *storage) {
         JournalStorageSpace *space;
         JournalMetrics *metrics;
-        uint64_t vfs_used, vfs_avail, avail;
+        uint64_t vfs_used, vfs_avail, avail, generation;
         usec_t ts;
         int r;
 
@@ -159,13 +167,18 @@ static int cache_space_refresh(Server *s, JournalStorage *storage) {
 
         ts = now(CLOCK_MONOTONIC);
 
-        if (space->timestamp != 0 && usec_add(space->timestamp, RECHECK_SPACE_USEC) > ts)
+        /* Also recheck once files were removed in the background since the last time */
+        if (space->timestamp != 0 && usec_add(space->timestamp, RECHECK_SPACE_USEC) > ts &&
+            space->vacuum_generation == journal_vacuum_generation())
                 return 0;
 
+        generation = journal_vacuum_generation();
+
         r = server_determine_path_usage(s, storage->path, &vfs_used, &vfs_avail);
         if (r < 0)
                 return r;
 
+        space->vacuum_generation = generation;
         space->vfs_used = vfs_used;
         space->vfs_available = vfs_avail;
 
@@ -283,6 +296,7 @@ static int server_open_journal(
 
         file_flags =
                 (s->compress.enabled ? JOURNAL_COMPRESS : 0) |
+                (s->compress.dictionary ? JOURNAL_ZSTD_DICTIONARY : 0) |
                 (seal ? JOURNAL_SEAL : 0) |
                 JOURNAL_STRICT_ORDER;
 
@@ -313,9 +327,26 @@ static int server_open_journal(
         if (r < 0)
                 return r;
 
-        r = journal_file_enable_post_change_timer(f, s->event, POST_CHANGE_TIMER_INTERVAL_USEC);
-        if (r < 0)
-                return r;
+        /* Without a template there's nothing to train a dictionary from, hence only use a configured one,
+         * and only if the file is new. */
+        if (iovec_is_set(&s->compress_dictionary) &&
+            JOURNAL_HEADER_ZSTD_DICTIONARY(f->header) &&
+            f->header->zstd_dictionary_offset == 0 &&
+            f->header->n_data == 0) {
+                r = journal_file_set_zstd_dictionary(f, s->compress_dictionary.iov_base, s->compress_dictionary.iov_len);
+                if (r < 0)
+                        log_ratelimit_warning_errno(r, JOURNAL_LOG_RATELIMIT,
+                                                    "Failed to set ZSTD dictionary for %s, ignoring: %m", f->path);
+        }
+
+        if (s->writer_thread)
+                /* The writer thread posts changes itself, once per batch, as the timer is not thread-safe */
+                f->post_change_deferred = true;
+        else {
+                r = journal_file_enable_post_change_timer(f, s->event, POST_CHANGE_TIMER_INTERVAL_USEC);
+                if (r < 0)
+                        return r;
+        }
 
         *ret = TAKE_PTR(f);
         return r;
@@ -543,6 +574,32 @@ static JournalFile* server_find_journal(Server *s, uid_t uid) {
         return s->system_journal;
 }
 
+static void server_pause_writer(Server *s) {
+        assert(s);
+
+        /* Keeps the writer thread from touching any journal files, so that they may be opened, rotated or
+         * closed. Entries are still queued meanwhile. Calls may be nested. */
+
+        if (s->writer.writer)
+                journal_writer_pause(s->writer.writer);
+}
+
+static void server_resume_writer(Server *s) {
+        assert(s);
+
+        if (s->writer.writer)
+                journal_writer_resume(s->writer.writer);
+}
+
+static void server_drain_writer(Server *s) {
+        assert(s);
+
+        /* Waits until everything queued so far is written. */
+
+        if (s->writer.writer)
+                journal_writer_drain(s->writer.writer);
+}
+
 static int server_do_rotate(
                 Server *s,
                 JournalFile **f,
@@ -560,10 +617,11 @@ static int server_do_rotate(
 
         file_flags =
                 (s->compress.enabled ? JOURNAL_COMPRESS : 0)|
+                (s->compress.dictionary ? JOURNAL_ZSTD_DICTIONARY : 0) |
                 (seal ? JOURNAL_SEAL : 0) |
                 JOURNAL_STRICT_ORDER;
 
-        r = journal_file_rotate(f, s->mmap, file_flags, s->compress.threshold_bytes, s->deferred_closes);
+        r = journal_file_rotate(f, s->mmap, file_flags, s->compress.threshold_bytes, &s->compress_dictionary, s->deferred_closes);
         if (r < 0) {
                 if (*f)
                         return log_ratelimit_error_errno(r, JOURNAL_LOG_RATELIMIT,
@@ -717,6 +775,8 @@ void server_rotate(Server *s) {
 
         log_debug("Rotating...");
 
+        server_pause_writer(s);
+
         /* First, rotate the system journal (either in its runtime flavour or in its runtime flavour) */
         (void) server_do_rotate(s, &s->runtime_journal, "runtime", /* seal= */ false, /* uid= */ 0);
         (void) server_do_rotate(s, &s->system_journal, "system", s->seal, /* uid= */ 0);
@@ -737,6 +797,8 @@ void server_rotate(Server *s) {
                 (void) server_archive_offline_user_journals(s);
 
         server_process_deferred_closes(s);
+
+        server_resume_writer(s);
 }
 
 static void server_rotate_journal(Server *s, JournalFile *f, uid_t uid) {
@@ -770,6 +832,8 @@ static void server_sync(Server *s, bool wait) {
         JournalFile *f;
         int r;
 
+        server_pause_writer(s);
+
         if (s->system_journal) {
                 r = journal_file_set_offline(s->system_journal, wait);
                 if (r < 0)
@@ -790,6 +854,9 @@ static void server_sync(Server *s, bool wait) {
                                             "Failed to disable sync timer source, ignoring: %m");
 
         s->sync_scheduled = false;
+        __atomic_store_n(&s->writer_sync_armed, false, __ATOMIC_SEQ_CST);
+
+        server_resume_writer(s);
 }
 
 static void server_do_vacuum(Server *s, JournalStorage *storage, bool verbose) {
@@ -804,14 +871,19 @@ static void server_do_vacuum(Server *s, JournalStorage *storage, bool verbose) {
         if (verbose)
                 server_space_usage_message(s, storage);
 
-        r = journal_directory_vacuum(storage->path, storage->space.limit,
-                                     storage->metrics.n_max_files, s->max_retention_usec,
-                                     &s->oldest_file_usec, verbose);
+        /* Files are removed in a background thread, so that we can go on processing log messages. In that
+         * case the cached space is refreshed once the thread is done, see cache_space_refresh(). Until then
+         * the files are still around and would be counted again. */
+        r = journal_directory_vacuum_full(storage->path, storage->space.limit,
+                                          storage->metrics.n_max_files, s->max_retention_usec,
+                                          &s->oldest_file_usec,
+                                          JOURNAL_VACUUM_ASYNC | (verbose ? JOURNAL_VACUUM_VERBOSE : 0));
         if (r < 0 && r != -ENOENT)
                 log_ratelimit_warning_errno(r, JOURNAL_LOG_RATELIMIT,
                                             "Failed to vacuum %s, ignoring: %m", storage->path);
 
-        cache_space_invalidate(&storage->space);
+        if (r <= 0)
+                cache_space_invalidate(&storage->space);
 }
 
 void server_vacuum(Server *s, bool verbose) {
@@ -941,6 +1013,70 @@ static bool shall_try_append_again(JournalFile *f, int r) {
         }
 }
 
+static ServerJournalType server_journal_type(Server *s, JournalFile *f) {
+        assert(s);
+        assert(f);
+
+        if (f == s->system_journal)
+                return SERVER_JOURNAL_SYSTEM;
+        if (f == s->runtime_journal)
+                return SERVER_JOURNAL_RUNTIME;
+
+        return SERVER_JOURNAL_USER;
+}
+
+static int server_append_entry(
+                Server *s,
+                JournalFile *f,
+                const dual_timestamp *ts,
+                const struct iovec *iovec,
+                size_t n) {
+
+        usec_t t;
+        int r;
+
+        assert(s);
+        assert(f);
+
+        /* Called with the append lock held from the writer thread, or with the writer thread paused,
+         * hence the statistics can be updated unlocked. */
+        t = now(CLOCK_MONOTONIC);
+
+        r = journal_file_append_entry(
+                        f,
+                        ts,
+                        /* boot_id= */ NULL,
+                        iovec, n,
+                        &s->seqnum->seqnum,
+                        &s->seqnum->id,
+                        /* ret_object= */ NULL,
+                        /* ret_offset= */ NULL);
+        if (r < 0)
+                return r;
+
+        latency_histogram_add(s->statistics.append_latency + server_journal_type(s, f),
+                              usec_sub_unsigned(now(CLOCK_MONOTONIC), t));
+        return 0;
+}
+
+static void server_schedule_tail_notify(Server *s) {
+        int r;
+
+        assert(s);
+
+        /* Followers are woken up by the posted changes only after POST_CHANGE_TIMER_INTERVAL_USEC, the
+         * subscribers right after the current event loop iteration, which coalesces all entries written
+         * during it. */
+
+        if (set_isempty(s->tail_subscribers))
+                return;
+
+        r = sd_event_source_set_enabled(s->tail_event_source, SD_EVENT_ONESHOT);
+        if (r < 0)
+                log_ratelimit_warning_errno(r, JOURNAL_LOG_RATELIMIT,
+                                            "Failed to enable tail notification event source, ignoring: %m");
+}
+
 static void server_write_to_journal(
                 Server *s,
                 uid_t uid,
@@ -994,17 +1130,10 @@ static void server_write_to_journal(
 
         s->last_realtime_clock = ts->realtime;
 
-        r = journal_file_append_entry(
-                        f,
-                        ts,
-                        /* boot_id= */ NULL,
-                        iovec, n,
-                        &s->seqnum->seqnum,
-                        &s->seqnum->id,
-                        /* ret_object= */ NULL,
-                        /* ret_offset= */ NULL);
+        r = server_append_entry(s, f, ts, iovec, n);
         if (r >= 0) {
                 server_schedule_sync(s, priority);
+                server_schedule_tail_notify(s);
                 return;
         }
 
@@ -1026,21 +1155,208 @@ static void server_write_to_journal(
                 return;
 
         log_debug_errno(r, "Retrying write.");
-        r = journal_file_append_entry(
-                        f,
-                        ts,
-                        /* boot_id= */ NULL,
-                        iovec, n,
-                        &s->seqnum->seqnum,
-                        &s->seqnum->id,
-                        /* ret_object= */ NULL,
-                        /* ret_offset= */ NULL);
+        r = server_append_entry(s, f, ts, iovec, n);
         if (r < 0)
                 log_ratelimit_error_errno(r, FAILED_TO_WRITE_ENTRY_RATELIMIT,
                                           "Failed to write entry to %s (%zu items, %zu bytes) despite vacuuming, ignoring: %m",
                                           f->path, n, iovec_total_size(iovec, n));
-        else
+        else {
                 server_schedule_sync(s, priority);
+                server_schedule_tail_notify(s);
+        }
+}
+
+static void server_post_change_journals(Server *s) {
+        JournalFile *f;
+
+        assert(s);
+
+        if (s->runtime_journal)
+                journal_file_post_change(s->runtime_journal);
+        if (s->system_journal)
+                journal_file_post_change(s->system_journal);
+        ORDERED_HASHMAP_FOREACH(f, s->user_journals)
+                journal_file_post_change(f);
+}
+
+static JournalFile* server_writer_find_journal(ServerWriter *w, uid_t uid) {
+        Server *s = ASSERT_PTR(ASSERT_PTR(w)->server);
+
+        /* Like server_find_journal(), but called from the writer thread, hence only returns journal files
+         * that are open already. Anything else is left to the main thread. */
+
+        if (s->runtime_journal)
+                return s->runtime_journal;
+
+        if (!IN_SET(s->storage, STORAGE_AUTO, STORAGE_PERSISTENT))
+                return NULL;
+
+        if (!uid_for_system_journal(uid))
+                return ordered_hashmap_get(s->user_journals, UID_TO_PTR(uid));
+
+        return s->system_journal;
+}
+
+static void server_writer_request_sync(ServerWriter *w, int priority) {
+        Server *s = ASSERT_PTR(ASSERT_PTR(w)->server);
+        int p;
+
+        /* Syncing is done by the main thread. Remember the lowest priority written, and wake up the main
+         * thread if it does not know yet that a sync is due, or if it shall sync right away. */
+
+        p = __atomic_load_n(&s->writer_sync_priority, __ATOMIC_SEQ_CST);
+        while (priority < p &&
+               !__atomic_compare_exchange_n(&s->writer_sync_priority, &p, priority, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+                ;
+
+        if (priority > LOG_CRIT && __atomic_exchange_n(&s->writer_sync_armed, true, __ATOMIC_SEQ_CST))
+                return;
+
+        journal_writer_notify(w->writer);
+}
+
+static size_t server_writer_write(JournalWriter *writer, JournalWriterEntry *const *entries, size_t n_entries, void *userdata) {
+        ServerWriter *w = ASSERT_PTR(userdata);
+        Server *s = ASSERT_PTR(w->server);
+        JournalFile *last = NULL;
+        int priority = INT_MAX;
+        size_t n = 0;
+        int r;
+
+        assert(entries || n_entries == 0);
+
+        /* Called in the writer thread. Stops at the first entry that needs the main thread, i.e. if a
+         * journal file needs to be opened or rotated, if the clock jumped backwards or if appending failed.
+         * The main thread then deals with it, including rotation and retrying. */
+
+        assert_se(pthread_mutex_lock(&s->append_lock) == 0);
+
+        for (; n < n_entries; n++) {
+                JournalWriterEntry *e = entries[n];
+                JournalFile *f;
+
+                if (e->ts.realtime < w->last_realtime_clock)
+                        break;
+
+                f = server_writer_find_journal(w, e->uid);
+                if (!f)
+                        break;
+
+                if (journal_file_rotate_suggested(f, s->max_file_usec, LOG_DEBUG))
+                        break;
+
+                r = server_append_entry(s, f, &e->ts, e->iovec, e->n_iovec);
+                if (r < 0) {
+                        log_debug_errno(r, "Failed to write entry to %s from writer thread, leaving it to the main thread: %m", f->path);
+                        break;
+                }
+
+                w->last_realtime_clock = e->ts.realtime;
+                priority = MIN(priority, e->priority);
+
+                if (last && last != f)
+                        journal_file_post_change(last);
+                last = f;
+        }
+
+        if (last)
+                journal_file_post_change(last);
+
+        assert_se(pthread_mutex_unlock(&s->append_lock) == 0);
+
+        if (n > 0) {
+                server_writer_request_sync(w, priority);
+
+                /* Wake up the main thread to tell the subscribers, unless it is about to already */
+                if (__atomic_load_n(&s->writer_tail_subscribed, __ATOMIC_SEQ_CST) &&
+                    !__atomic_exchange_n(&s->writer_tail_pending, true, __ATOMIC_SEQ_CST))
+                        journal_writer_notify(w->writer);
+        }
+
+        return n;
+}
+
+static void server_writer_write_stalled(JournalWriter *writer, JournalWriterEntry *e, void *userdata) {
+        ServerWriter *w = ASSERT_PTR(userdata);
+        Server *s = ASSERT_PTR(w->server);
+
+        assert(e);
+
+        /* Called in the main thread, for entries the writer thread left to us. The writer thread must not
+         * touch any journal files while they are opened or rotated, hence pause it meanwhile. */
+
+        server_pause_writer(s);
+
+        s->last_realtime_clock = w->last_realtime_clock;
+        server_write_to_journal(s, e->uid, e->iovec, e->n_iovec, &e->ts, e->priority);
+        w->last_realtime_clock = s->last_realtime_clock;
+
+        server_post_change_journals(s);
+
+        server_resume_writer(s);
+}
+
+static int server_dispatch_writer(sd_event_source *es, int fd, uint32_t revents, void *userdata) {
+        ServerWriter *w = ASSERT_PTR(userdata);
+        Server *s = ASSERT_PTR(w->server);
+        int priority;
+
+        journal_writer_process(w->writer);
+
+        priority = __atomic_exchange_n(&s->writer_sync_priority, INT_MAX, __ATOMIC_SEQ_CST);
+        if (priority != INT_MAX)
+                (void) server_schedule_sync(s, priority);
+
+        if (__atomic_exchange_n(&s->writer_tail_pending, false, __ATOMIC_SEQ_CST))
+                server_schedule_tail_notify(s);
+
+        return 0;
+}
+
+static int server_setup_writer(Server *s) {
+        ServerWriter *w;
+        int r;
+
+        assert(s);
+
+        /* A single thread writes to all journal files. Appending is serialized anyway by the mmap cache,
+         * its SIGBUS handling and the seqnum the files share, hence more threads would not help. */
+
+        if (!s->writer_thread || s->storage == STORAGE_NONE)
+                return 0;
+
+        w = &s->writer;
+        *w = (ServerWriter) {
+                .server = s,
+        };
+
+        r = journal_writer_new(
+                        "journal-writer",
+                        JOURNAL_WRITER_QUEUE_SIZE_DEFAULT,
+                        server_writer_write,
+                        server_writer_write_stalled,
+                        w,
+                        &w->writer);
+        if (r < 0)
+                return log_error_errno(r, "Failed to start journal writer thread: %m");
+
+        r = sd_event_add_io(s->event, &w->event_source, journal_writer_get_fd(w->writer), EPOLLIN, server_dispatch_writer, w);
+        if (r < 0)
+                return log_error_errno(r, "Failed to add journal writer event source: %m");
+
+        (void) sd_event_source_set_description(w->event_source, "journal-writer");
+
+        log_debug("Writing journal files from writer thread.");
+        return 0;
+}
+
+static void server_stop_writer(Server *s) {
+        assert(s);
+
+        /* Writes out everything still queued. Anything dispatched afterwards is written directly. */
+
+        s->writer.event_source = sd_event_source_disable_unref(s->writer.event_source);
+        s->writer.writer = journal_writer_free(s->writer.writer);
 }
 
 #define IOVEC_ADD_NUMERIC_FIELD(iovec, n, value, type, isset, format, field)  \
@@ -1123,9 +1439,9 @@ static void server_dispatch_message_real(
 
                 IOVEC_ADD_ID128_FIELD(iovec, n, c->invocation_id, "_SYSTEMD_INVOCATION_ID");
 
-                if (c->extra_fields_n_iovec > 0) {
-                        memcpy(iovec + n, c->extra_fields_iovec, c->extra_fields_n_iovec * sizeof(struct iovec));
-                        n += c->extra_fields_n_iovec;
+                if (client_context_extra_fields_n_iovec(c) > 0) {
+                        memcpy(iovec + n, c->unit_context->extra_fields_iovec, c->unit_context->extra_fields_n_iovec * sizeof(struct iovec));
+                        n += c->unit_context->extra_fields_n_iovec;
                 }
         }
 
@@ -1205,7 +1521,21 @@ static void server_dispatch_message_real(
 
         (void) server_forward_socket(s, iovec, n, &ts, priority);
 
-        server_write_to_journal(s, journal_uid, iovec, n, &ts, priority);
+        s->statistics.n_stored++;
+        s->statistics.n_bytes_stored += iovec_total_size(iovec, n);
+
+        if (s->writer.writer) {
+                JournalWriterEntry *e;
+
+                e = journal_writer_entry_new(journal_uid, iovec, n, &ts, priority);
+                if (!e) {
+                        log_oom();
+                        return;
+                }
+
+                journal_writer_enqueue(s->writer.writer, e);
+        } else
+                server_write_to_journal(s, journal_uid, iovec, n, &ts, priority);
 }
 
 void server_driver_message(Server *s, pid_t object_pid, const char *message_id, const char *format, ...) {
@@ -1233,6 +1563,8 @@ void server_driver_message(Server *s, pid_t object_pid, const char *message_id,
                 iovec[n++] = IOVEC_MAKE_STRING(message_id);
         k = n;
 
+        s->statistics.n_received[SERVER_TRANSPORT_DRIVER]++;
+
         va_start(ap, format);
         r = log_format_iovec(iovec, m, &n, false, 0, format, ap);
         /* Error handling below */
@@ -1275,8 +1607,10 @@ void server_dispatch_message(
         if (n == 0)
                 return;
 
-        if (LOG_PRI(priority) > s->max_level_store)
+        if (LOG_PRI(priority) > s->max_level_store) {
+                s->statistics.n_filtered++;
                 return;
+        }
 
         /* Stop early in case the information will not be stored
          * in a journal. */
@@ -1284,17 +1618,24 @@ void server_dispatch_message(
                 return;
 
         if (c && c->unit) {
+                usec_t interval;
+                unsigned burst;
+
                 (void) server_determine_space(s, &available, /* limit= */ NULL);
 
+                client_context_get_ratelimit(c, s, &interval, &burst);
+
                 rl = journal_ratelimit_test(
-                                &s->ratelimit_groups_by_id,
+                                &s->ratelimit,
                                 c->unit,
-                                c->log_ratelimit_interval,
-                                c->log_ratelimit_burst,
+                                interval,
+                                burst,
                                 LOG_PRI(priority),
                                 available);
-                if (rl == 0)
+                if (rl == 0) {
+                        s->statistics.n_ratelimited++;
                         return;
+                }
 
                 /* Write a suppression message if we suppressed something */
                 if (rl > 1)
@@ -1308,9 +1649,56 @@ void server_dispatch_message(
         server_dispatch_message_real(s, iovec, n, m, c, tv, priority, object_pid);
 }
 
-int server_flush_to_var(Server *s, bool require_flag_file) {
+static int server_flush_batch(Server *s, const JournalCopyEntry *entries, size_t n_entries) {
+        bool rotated = false;
+        int r;
+
+        assert(s);
+        assert(entries || n_entries == 0);
+
+        while (n_entries > 0) {
+                size_t n = 0;
+
+                r = journal_file_copy_entries(
+                                s->system_journal,
+                                entries,
+                                n_entries,
+                                &s->seqnum->seqnum,
+                                &s->seqnum->id,
+                                &n);
+                if (r >= 0)
+                        return 0;
+
+                entries += n;
+                n_entries -= n;
+
+                /* Only retry once for the same entry after rotating */
+                if ((rotated && n == 0) || !shall_try_append_again(s->system_journal, r))
+                        return log_ratelimit_error_errno(r, JOURNAL_LOG_RATELIMIT, "Can't write entry: %m");
+
+                log_ratelimit_info(JOURNAL_LOG_RATELIMIT, "Rotating system journal.");
+
+                server_rotate_journal(s, s->system_journal, /* uid = */ 0);
+                server_vacuum(s, /* verbose = */ false);
+
+                if (!s->system_journal) {
+                        log_ratelimit_notice(JOURNAL_LOG_RATELIMIT,
+                                             "Didn't flush runtime journal since rotation of system journal wasn't successful.");
+                        return -EIO;
+                }
+
+                log_debug("Retrying write.");
+                rotated = true;
+        }
+
+        return 0;
+}
+
+static int server_do_flush_to_var(Server *s, bool require_flag_file) {
+        _cleanup_free_ JournalCopyEntry *batch = NULL;
         sd_journal *j = NULL;
         const char *fn;
+        size_t n_batch = 0;
         unsigned n = 0;
         usec_t start;
         int r, k;
@@ -1353,6 +1741,12 @@ int server_flush_to_var(Server *s, bool require_flag_file) {
 
         sd_journal_set_data_threshold(j, 0);
 
+        batch = new(JournalCopyEntry, FLUSH_BATCH_MAX);
+        if (!batch) {
+                r = log_oom();
+                goto finish;
+        }
+
         SD_JOURNAL_FOREACH(j) {
                 Object *o = NULL;
                 JournalFile *f;
@@ -1368,47 +1762,25 @@ int server_flush_to_var(Server *s, bool require_flag_file) {
                         goto finish;
                 }
 
-                r = journal_file_copy_entry(
-                                f,
-                                s->system_journal,
-                                o,
-                                f->current_offset,
-                                &s->seqnum->seqnum,
-                                &s->seqnum->id);
-                if (r >= 0)
+                batch[n_batch++] = (JournalCopyEntry) {
+                        .file = f,
+                        .offset = f->current_offset,
+                };
+
+                if (n_batch < FLUSH_BATCH_MAX)
                         continue;
 
-                if (!shall_try_append_again(s->system_journal, r)) {
-                        log_ratelimit_error_errno(r, JOURNAL_LOG_RATELIMIT, "Can't write entry: %m");
+                r = server_flush_batch(s, batch, n_batch);
+                if (r < 0)
                         goto finish;
-                }
 
-                log_ratelimit_info(JOURNAL_LOG_RATELIMIT, "Rotating system journal.");
-
-                server_rotate_journal(s, s->system_journal, /* uid = */ 0);
-                server_vacuum(s, /* verbose = */ false);
-
-                if (!s->system_journal) {
-                        log_ratelimit_notice(JOURNAL_LOG_RATELIMIT,
-                                             "Didn't flush runtime journal since rotation of system journal wasn't successful.");
-                        r = -EIO;
-                        goto finish;
-                }
-
-                log_debug("Retrying write.");
-                r = journal_file_copy_entry(
-                                f,
-                                s->system_journal,
-                                o,
-                                f->current_offset,
-                                &s->seqnum->seqnum,
-                                &s->seqnum->id);
-                if (r < 0) {
-                        log_ratelimit_error_errno(r, JOURNAL_LOG_RATELIMIT, "Can't write entry: %m");
-                        goto finish;
-                }
+                n_batch = 0;
         }
 
+        r = server_flush_batch(s, batch, n_batch);
+        if (r < 0)
+                goto finish;
+
         r = 0;
 
 finish:
@@ -1462,6 +1834,18 @@ finish:
         return r;
 }
 
+int server_flush_to_var(Server *s, bool require_flag_file) {
+        int r;
+
+        assert(s);
+
+        server_pause_writer(s);
+        r = server_do_flush_to_var(s, require_flag_file);
+        server_resume_writer(s);
+
+        return r;
+}
+
 static int server_relinquish_var(Server *s) {
         assert(s);
 
@@ -1476,32 +1860,97 @@ static int server_relinquish_var(Server *s) {
 
         log_debug("Relinquishing %s...", s->system_storage.path);
 
+        /* Everything received so far still goes to /var */
+        server_drain_writer(s);
+        server_pause_writer(s);
+
         (void) server_system_journal_open(s, /* flush_requested */ false, /* relinquish_requested=*/ true);
 
         s->system_journal = journal_file_offline_close(s->system_journal);
         ordered_hashmap_clear_with_destructor(s->user_journals, journal_file_offline_close);
         set_clear_with_destructor(s->deferred_closes, journal_file_offline_close);
 
+        server_resume_writer(s);
+
         server_refresh_idle_timer(s);
         return 0;
 }
 
-int server_process_datagram(
-                sd_event_source *es,
-                int fd,
-                uint32_t revents,
-                void *userdata) {
-
-        size_t label_len = 0, m;
-        Server *s = ASSERT_PTR(userdata);
+static void server_dispatch_datagram(Server *s, int fd, struct msghdr *msghdr, char *buffer, size_t n) {
+        size_t label_len = 0;
         struct ucred *ucred = NULL;
         struct timeval tv_buf, *tv = NULL;
         struct cmsghdr *cmsg;
         char *label = NULL;
+        int *fds = NULL;
+        size_t n_fds = 0;
+
+        assert(s);
+        assert(msghdr);
+        assert(buffer);
+
+        CMSG_FOREACH(cmsg, msghdr)
+                if (cmsg->cmsg_level == SOL_SOCKET &&
+                    cmsg->cmsg_type == SCM_CREDENTIALS &&
+                    cmsg->cmsg_len == CMSG_LEN(sizeof(struct ucred))) {
+                        assert(!ucred);
+                        ucred = CMSG_TYPED_DATA(cmsg, struct ucred);
+                } else if (cmsg->cmsg_level == SOL_SOCKET &&
+                         cmsg->cmsg_type == SCM_SECURITY) {
+                        assert(!label);
+                        label = CMSG_TYPED_DATA(cmsg, char);
+                        label_len = cmsg->cmsg_len - CMSG_LEN(0);
+                } else if (cmsg->cmsg_level == SOL_SOCKET &&
+                           cmsg->cmsg_type == SCM_TIMESTAMP &&
+                           cmsg->cmsg_len == CMSG_LEN(sizeof(struct timeval))) {
+                        assert(!tv);
+                        tv = memcpy(&tv_buf, CMSG_DATA(cmsg), sizeof(struct timeval));
+                } else if (cmsg->cmsg_level == SOL_SOCKET &&
+                         cmsg->cmsg_type == SCM_RIGHTS) {
+                        assert(!fds);
+                        fds = CMSG_TYPED_DATA(cmsg, int);
+                        n_fds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                }
+
+        /* And a trailing NUL, just in case */
+        buffer[n] = 0;
+
+        if (fd == s->syslog_fd) {
+                if (n > 0 && n_fds == 0)
+                        server_process_syslog_message(s, buffer, n, ucred, tv, label, label_len);
+                else if (n_fds > 0)
+                        log_ratelimit_warning(JOURNAL_LOG_RATELIMIT,
+                                              "Got file descriptors via syslog socket. Ignoring.");
+
+        } else if (fd == s->native_fd) {
+                if (n > 0 && n_fds == 0)
+                        server_process_native_message(s, buffer, n, ucred, tv, label, label_len);
+                else if (n == 0 && n_fds == 1)
+                        (void) server_process_native_file(s, fds[0], ucred, tv, label, label_len);
+                else if (n_fds > 0)
+                        log_ratelimit_warning(JOURNAL_LOG_RATELIMIT,
+                                              "Got too many file descriptors via native socket. Ignoring.");
+
+        } else {
+                assert(fd == s->audit_fd);
+
+                if (n > 0 && n_fds == 0)
+                        server_process_audit_message(s, buffer, n, ucred, msghdr->msg_name, msghdr->msg_namelen);
+                else if (n_fds > 0)
+                        log_ratelimit_warning(JOURNAL_LOG_RATELIMIT,
+                                              "Got file descriptors via audit socket. Ignoring.");
+        }
+
+        close_many(fds, n_fds);
+}
+
+static int server_receive_datagram(Server *s, int fd) {
         struct iovec iovec;
         ssize_t n;
-        int *fds = NULL, v = 0;
-        size_t n_fds = 0;
+        size_t m;
+        int v = 0;
+
+        /* Receives and processes a single datagram. Returns 1 if one was processed, 0 if there was none. */
 
         /* We use NAME_MAX space for the SELinux label here. The kernel currently enforces no limit, but
          * according to suggestions from the SELinux people this will change and it will probably be
@@ -1526,13 +1975,6 @@ int server_process_datagram(
                 .msg_namelen = sizeof(sa),
         };
 
-        assert(fd == s->native_fd || fd == s->syslog_fd || fd == s->audit_fd);
-
-        if (revents != EPOLLIN)
-                return log_error_errno(SYNTHETIC_ERRNO(EIO),
-                                       "Got invalid event from epoll for datagram fd: %" PRIx32,
-                                       revents);
-
         /* Try to get the right size, if we can. (Not all sockets support SIOCINQ, hence we just try, but don't rely on
          * it.) */
         (void) ioctl(fd, SIOCINQ, &v);
@@ -1554,64 +1996,117 @@ int server_process_datagram(
                 if (n == -EXFULL) {
                         log_ratelimit_warning(JOURNAL_LOG_RATELIMIT,
                                               "Got message with truncated control data (too many fds sent?), ignoring.");
-                        return 0;
+                        return 1;
                 }
                 return log_ratelimit_error_errno(n, JOURNAL_LOG_RATELIMIT, "recvmsg() failed: %m");
         }
 
-        CMSG_FOREACH(cmsg, &msghdr)
-                if (cmsg->cmsg_level == SOL_SOCKET &&
-                    cmsg->cmsg_type == SCM_CREDENTIALS &&
-                    cmsg->cmsg_len == CMSG_LEN(sizeof(struct ucred))) {
-                        assert(!ucred);
-                        ucred = CMSG_TYPED_DATA(cmsg, struct ucred);
-                } else if (cmsg->cmsg_level == SOL_SOCKET &&
-                         cmsg->cmsg_type == SCM_SECURITY) {
-                        assert(!label);
-                        label = CMSG_TYPED_DATA(cmsg, char);
-                        label_len = cmsg->cmsg_len - CMSG_LEN(0);
-                } else if (cmsg->cmsg_level == SOL_SOCKET &&
-                           cmsg->cmsg_type == SCM_TIMESTAMP &&
-                           cmsg->cmsg_len == CMSG_LEN(sizeof(struct timeval))) {
-                        assert(!tv);
-                        tv = memcpy(&tv_buf, CMSG_DATA(cmsg), sizeof(struct timeval));
-                } else if (cmsg->cmsg_level == SOL_SOCKET &&
-                         cmsg->cmsg_type == SCM_RIGHTS) {
-                        assert(!fds);
-                        fds = CMSG_TYPED_DATA(cmsg, int);
-                        n_fds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
-                }
+        server_dispatch_datagram(s, fd, &msghdr, s->buffer, n);
+        return 1;
+}
 
-        /* And a trailing NUL, just in case */
-        s->buffer[n] = 0;
+static int server_receive_audit_datagrams(Server *s, int fd) {
+        DatagramBatch *b;
+        int n;
 
-        if (fd == s->syslog_fd) {
-                if (n > 0 && n_fds == 0)
-                        server_process_syslog_message(s, s->buffer, n, ucred, tv, label, label_len);
-                else if (n_fds > 0)
+        /* Audit messages are bounded in size, hence we can receive a whole batch of them with a single
+         * recvmmsg() into fixed size buffers. (This is not the case for the AF_UNIX sockets, where a
+         * datagram larger than its buffer would be truncated, and the rest of it would be lost.) Returns the
+         * number of datagrams processed. */
+
+        if (!s->audit_batch) {
+                s->audit_batch = new(DatagramBatch, 1);
+                if (!s->audit_batch)
+                        return log_oom();
+        }
+
+        b = s->audit_batch;
+
+        for (size_t i = 0; i < DATAGRAM_BATCH_MAX; i++) {
+                /* See above regarding the need to zero-initialize the control buffer. */
+                zero(b->controls[i]);
+                zero(b->addresses[i]);
+
+                b->iovecs[i] = IOVEC_MAKE(b->buffers[i], sizeof(b->buffers[i]) - 1); /* Leave room for trailing NUL */
+                b->messages[i] = (struct mmsghdr) {
+                        .msg_hdr = {
+                                .msg_iov = b->iovecs + i,
+                                .msg_iovlen = 1,
+                                .msg_control = b->controls + i,
+                                .msg_controllen = sizeof(b->controls[i]),
+                                .msg_name = b->addresses + i,
+                                .msg_namelen = sizeof(b->addresses[i]),
+                        },
+                };
+        }
+
+        n = recvmmsg(fd, b->messages, DATAGRAM_BATCH_MAX, MSG_DONTWAIT|MSG_CMSG_CLOEXEC, NULL);
+        if (n < 0) {
+                if (ERRNO_IS_TRANSIENT(errno))
+                        return 0;
+                return log_ratelimit_error_errno(errno, JOURNAL_LOG_RATELIMIT, "recvmmsg() failed: %m");
+        }
+
+        for (int i = 0; i < n; i++) {
+                struct msghdr *msghdr = &b->messages[i].msg_hdr;
+
+                if (FLAGS_SET(msghdr->msg_flags, MSG_CTRUNC)) {
+                        cmsg_close_all(msghdr);
                         log_ratelimit_warning(JOURNAL_LOG_RATELIMIT,
-                                              "Got file descriptors via syslog socket. Ignoring.");
+                                              "Got message with truncated control data, ignoring.");
+                        continue;
+                }
 
-        } else if (fd == s->native_fd) {
-                if (n > 0 && n_fds == 0)
-                        server_process_native_message(s, s->buffer, n, ucred, tv, label, label_len);
-                else if (n == 0 && n_fds == 1)
-                        (void) server_process_native_file(s, fds[0], ucred, tv, label, label_len);
-                else if (n_fds > 0)
+                if (FLAGS_SET(msghdr->msg_flags, MSG_TRUNC)) {
                         log_ratelimit_warning(JOURNAL_LOG_RATELIMIT,
-                                              "Got too many file descriptors via native socket. Ignoring.");
+                                              "Got truncated audit message, ignoring.");
+                        continue;
+                }
 
-        } else {
-                assert(fd == s->audit_fd);
+                server_dispatch_datagram(s, fd, msghdr, b->buffers[i], b->messages[i].msg_len);
+        }
 
-                if (n > 0 && n_fds == 0)
-                        server_process_audit_message(s, s->buffer, n, ucred, &sa, msghdr.msg_namelen);
-                else if (n_fds > 0)
-                        log_ratelimit_warning(JOURNAL_LOG_RATELIMIT,
-                                              "Got file descriptors via audit socket. Ignoring.");
+        return n;
+}
+
+int server_process_datagram(
+                sd_event_source *es,
+                int fd,
+                uint32_t revents,
+                void *userdata) {
+
+        Server *s = ASSERT_PTR(userdata);
+        DatagramStatistics *stats;
+        unsigned n = 0;
+        int r;
+
+        assert(fd == s->native_fd || fd == s->syslog_fd || fd == s->audit_fd);
+
+        if (revents != EPOLLIN)
+                return log_error_errno(SYNTHETIC_ERRNO(EIO),
+                                       "Got invalid event from epoll for datagram fd: %" PRIx32,
+                                       revents);
+
+        /* Process up to DATAGRAM_BATCH_MAX datagrams per wakeup. That saves an event loop iteration for most
+         * of them when there are many queued, but still lets other event sources have their turn. */
+        while (n < DATAGRAM_BATCH_MAX) {
+                if (fd == s->audit_fd)
+                        r = server_receive_audit_datagrams(s, fd);
+                else
+                        r = server_receive_datagram(s, fd);
+                if (r < 0)
+                        return r;
+                if (r == 0)
+                        break;
+
+                n += r;
         }
 
-        close_many(fds, n_fds);
+        stats = fd == s->native_fd ? &s->native_statistics :
+                fd == s->syslog_fd ? &s->syslog_statistics : &s->audit_statistics;
+        stats->n_wakeups++;
+        stats->n_datagrams += n;
+        stats->n_datagrams_max = MAX(stats->n_datagrams_max, n);
 
         server_refresh_idle_timer(s);
         return 0;
@@ -1669,7 +2164,8 @@ static int dispatch_sigusr2(sd_event_source *es, const struct signalfd_siginfo *
         Server *s = ASSERT_PTR(userdata);
 
         log_info("Received SIGUSR2 signal from PID %u, as request to rotate journal, rotating.", si->ssi_pid);
-        server_full_rotate(s);
+        SERVER_FOREACH_SIBLING(i, s)
+                server_full_rotate(i);
 
         return 0;
 }
@@ -1759,6 +2255,7 @@ static void server_full_sync(Server *s, bool wait) {
 
         assert(s);
 
+        server_drain_writer(s);
         server_sync(s, wait);
 
         /* Let clients know when the most recent sync happened. */
@@ -1773,7 +2270,8 @@ static int dispatch_sigrtmin1(sd_event_source *es, const struct signalfd_siginfo
         Server *s = ASSERT_PTR(userdata);
 
         log_debug("Received SIGRTMIN1 signal from PID %u, as request to sync.", si->ssi_pid);
-        server_full_sync(s, /* wait = */ false);
+        SERVER_FOREACH_SIBLING(i, s)
+                server_full_sync(i, /* wait = */ false);
 
         return 0;
 }
@@ -1957,6 +2455,100 @@ static int server_parse_config_file(Server *s) {
                         /* userdata= */ s);
 }
 
+void server_flush_forward(Server *s) {
+        assert(s);
+
+        server_flush_forward_socket(s);
+        server_flush_forward_syslog(s);
+
+        (void) sd_event_source_set_enabled(s->forward_defer_event_source, SD_EVENT_OFF);
+        (void) sd_event_source_set_enabled(s->forward_timer_event_source, SD_EVENT_OFF);
+}
+
+static int server_dispatch_forward(sd_event_source *es, void *userdata) {
+        server_flush_forward(ASSERT_PTR(userdata));
+        return 0;
+}
+
+static int server_dispatch_forward_timer(sd_event_source *es, usec_t t, void *userdata) {
+        server_flush_forward(ASSERT_PTR(userdata));
+        return 0;
+}
+
+static int server_schedule_forward_internal(Server *s) {
+        int r;
+
+        assert(s);
+
+        /* The deferred flush runs once everything that is ready to be read right now was dispatched, which
+         * under load is what collects the batch. The timer makes sure that a steady stream of incoming
+         * messages does not hold back the ones collected so far for longer than ForwardLatencySec=. */
+
+        if (!s->forward_defer_event_source) {
+                r = sd_event_add_defer(s->event, &s->forward_defer_event_source, server_dispatch_forward, s);
+                if (r < 0)
+                        return r;
+
+                r = sd_event_source_set_priority(s->forward_defer_event_source, SD_EVENT_PRIORITY_NORMAL+10);
+                if (r < 0)
+                        return r;
+
+                (void) sd_event_source_set_description(s->forward_defer_event_source, "forward");
+        }
+
+        r = sd_event_source_set_enabled(s->forward_defer_event_source, SD_EVENT_ONESHOT);
+        if (r < 0)
+                return r;
+
+        if (!s->forward_timer_event_source) {
+                r = sd_event_add_time_relative(
+                                s->event,
+                                &s->forward_timer_event_source,
+                                CLOCK_MONOTONIC,
+                                s->forward_latency_usec, 0,
+                                server_dispatch_forward_timer, s);
+                if (r < 0)
+                        return r;
+
+                r = sd_event_source_set_priority(s->forward_timer_event_source, SD_EVENT_PRIORITY_IMPORTANT);
+                if (r < 0)
+                        return r;
+
+                (void) sd_event_source_set_description(s->forward_timer_event_source, "forward-timer");
+                return 0;
+        }
+
+        r = sd_event_source_get_enabled(s->forward_timer_event_source, NULL);
+        if (r < 0)
+                return r;
+        if (r > 0) /* Already armed, the oldest message determines when we flush at the latest */
+                return 0;
+
+        r = sd_event_source_set_time_relative(s->forward_timer_event_source, s->forward_latency_usec);
+        if (r < 0)
+                return r;
+
+        return sd_event_source_set_enabled(s->forward_timer_event_source, SD_EVENT_ONESHOT);
+}
+
+void server_schedule_forward(Server *s) {
+        int r;
+
+        assert(s);
+
+        if (s->forward_latency_usec == 0 || !s->event || sd_event_get_state(s->event) == SD_EVENT_FINISHED) {
+                /* Batching turned off, or shutting down the server? Let's forward immediately. */
+                server_flush_forward(s);
+                return;
+        }
+
+        r = server_schedule_forward_internal(s);
+        if (r < 0) {
+                log_debug_errno(r, "Failed to schedule forwarding of messages, forwarding right away: %m");
+                server_flush_forward(s);
+        }
+}
+
 static int server_dispatch_sync(sd_event_source *es, usec_t t, void *userdata) {
         Server *s = ASSERT_PTR(userdata);
 
@@ -1964,15 +2556,61 @@ static int server_dispatch_sync(sd_event_source *es, usec_t t, void *userdata) {
         return 0;
 }
 
+static int server_sync_critical_one(Server *s, JournalFile *f) {
+        assert(s);
+        assert(f);
+
+        /* Start writeback right away, that's cheap and does not wait for the disk. The syncer thread then
+         * only has to wait for it to complete. */
+        if (sync_file_range(f->fd, 0, 0, SYNC_FILE_RANGE_WRITE) < 0)
+                log_debug_errno(errno, "Failed to start writeback of %s, ignoring: %m", f->path);
+
+        return journal_syncer_request(s->syncer, f->fd);
+}
+
+static int server_sync_critical(Server *s) {
+        JournalFile *f;
+        int r;
+
+        assert(s);
+
+        if (!s->syncer) {
+                r = journal_syncer_new(&s->syncer);
+                if (r < 0)
+                        return r;
+        }
+
+        /* Like server_sync(), the runtime journal is left alone, it is not backed by a disk anyway */
+        if (s->system_journal) {
+                r = server_sync_critical_one(s, s->system_journal);
+                if (r < 0)
+                        return r;
+        }
+
+        ORDERED_HASHMAP_FOREACH(f, s->user_journals) {
+                r = server_sync_critical_one(s, f);
+                if (r < 0)
+                        return r;
+        }
+
+        return 0;
+}
+
 static int server_schedule_sync(Server *s, int priority) {
         int r;
 
         assert(s);
 
         if (priority <= LOG_CRIT) {
-                /* Immediately sync to disk when this is of priority CRIT, ALERT, EMERG */
-                server_sync(s, /* wait = */ false);
-                return 0;
+                /* Immediately sync to disk when this is of priority CRIT, ALERT, EMERG. This is done in the
+                 * background, so that a burst of such messages does not stall us. The files are still put
+                 * offline on the regular schedule below. */
+                r = server_sync_critical(s);
+                if (r < 0) {
+                        log_debug_errno(r, "Failed to sync journal files in the background, syncing right away: %m");
+                        server_sync(s, /* wait = */ false);
+                        return 0;
+                }
         }
 
         if (!s->event || sd_event_get_state(s->event) == SD_EVENT_FINISHED) {
@@ -2176,127 +2814,510 @@ static int server_connect_notify(Server *s) {
         if (sd_watchdog_enabled(false, &s->watchdog_usec) > 0) {
                 s->send_watchdog = true;
 
-                r = sd_event_add_time_relative(s->event, &s->watchdog_event_source, CLOCK_MONOTONIC, s->watchdog_usec/2, s->watchdog_usec/4, dispatch_watchdog, s);
+                r = sd_event_add_time_relative(s->event, &s->watchdog_event_source, CLOCK_MONOTONIC, s->watchdog_usec/2, s->watchdog_usec/4, dispatch_watchdog, s);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to add watchdog time event: %m");
+        }
+
+        /* This should fire pretty soon, which we'll use to send the READY=1 event. */
+
+        return 0;
+}
+
+static int synchronize_second_half(sd_event_source *event_source, void *userdata) {
+        Varlink *link = ASSERT_PTR(userdata);
+        Server *s;
+        int r;
+
+        assert_se(s = varlink_get_userdata(link));
+
+        /* This is the "second half" of the Synchronize() varlink method. This function is called as deferred
+         * event source at a low priority to ensure the synchronization completes after all queued log
+         * messages are processed. */
+        server_full_sync(s, /* wait = */ true);
+
+        /* Let's get rid of the event source now, by marking it as non-floating again. It then has no ref
+         * anymore and is immediately destroyed after we return from this function, i.e. from this event
+         * source handler at the end. */
+        r = sd_event_source_set_floating(event_source, false);
+        if (r < 0)
+                return log_error_errno(r, "Failed to mark event source as non-floating: %m");
+
+        return varlink_reply(link, NULL);
+}
+
+static void synchronize_destroy(void *userdata) {
+        varlink_unref(userdata);
+}
+
+static int vl_method_synchronize(Varlink *link, sd_json_variant *parameters, VarlinkMethodFlags flags, void *userdata) {
+        _cleanup_(sd_event_source_unrefp) sd_event_source *event_source = NULL;
+        Server *s = ASSERT_PTR(userdata);
+        int r;
+
+        assert(link);
+
+        if (sd_json_variant_elements(parameters) > 0)
+                return varlink_error_invalid_parameter(link, parameters);
+
+        log_info("Received client request to sync journal.");
+
+        /* We don't do the main work now, but instead enqueue a deferred event loop job which will do
+         * it. That job is scheduled at low priority, so that we return from this method call only after all
+         * queued but not processed log messages are written to disk, so that this method call returning can
+         * be used as nice synchronization point. */
+        r = sd_event_add_defer(s->event, &event_source, synchronize_second_half, link);
+        if (r < 0)
+                return log_error_errno(r, "Failed to allocate defer event source: %m");
+
+        r = sd_event_source_set_destroy_callback(event_source, synchronize_destroy);
+        if (r < 0)
+                return log_error_errno(r, "Failed to set event source destroy callback: %m");
+
+        varlink_ref(link); /* The varlink object is now left to the destroy callback to unref */
+
+        r = sd_event_source_set_priority(event_source, SD_EVENT_PRIORITY_NORMAL+15);
+        if (r < 0)
+                return log_error_errno(r, "Failed to set defer event source priority: %m");
+
+        /* Give up ownership of this event source. It will now be destroyed along with event loop itself,
+         * unless it destroys itself earlier. */
+        r = sd_event_source_set_floating(event_source, true);
+        if (r < 0)
+                return log_error_errno(r, "Failed to mark event source as floating: %m");
+
+        (void) sd_event_source_set_description(event_source, "deferred-sync");
+
+        return 0;
+}
+
+static int vl_method_rotate(Varlink *link, sd_json_variant *parameters, VarlinkMethodFlags flags, void *userdata) {
+        Server *s = ASSERT_PTR(userdata);
+
+        assert(link);
+
+        if (sd_json_variant_elements(parameters) > 0)
+                return varlink_error_invalid_parameter(link, parameters);
+
+        log_info("Received client request to rotate journal, rotating.");
+        server_full_rotate(s);
+
+        return varlink_reply(link, NULL);
+}
+
+static int vl_method_flush_to_var(Varlink *link, sd_json_variant *parameters, VarlinkMethodFlags flags, void *userdata) {
+        Server *s = ASSERT_PTR(userdata);
+
+        assert(link);
+
+        if (sd_json_variant_elements(parameters) > 0)
+                return varlink_error_invalid_parameter(link, parameters);
+        if (s->namespace)
+                return varlink_error(link, "io.systemd.Journal.NotSupportedByNamespaces", NULL);
+
+        log_info("Received client request to flush runtime journal.");
+        server_full_flush(s);
+
+        return varlink_reply(link, NULL);
+}
+
+static int vl_method_relinquish_var(Varlink *link, sd_json_variant *parameters, VarlinkMethodFlags flags, void *userdata) {
+        Server *s = ASSERT_PTR(userdata);
+
+        assert(link);
+
+        if (sd_json_variant_elements(parameters) > 0)
+                return varlink_error_invalid_parameter(link, parameters);
+        if (s->namespace)
+                return varlink_error(link, "io.systemd.Journal.NotSupportedByNamespaces", NULL);
+
+        log_info("Received client request to relinquish %s access.", s->system_storage.path);
+        server_relinquish_var(s);
+
+        return varlink_reply(link, NULL);
+}
+
+static int vl_method_get_writer_statistics(Varlink *link, sd_json_variant *parameters, VarlinkMethodFlags flags, void *userdata) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        Server *s = ASSERT_PTR(userdata);
+        int r;
+
+        assert(link);
+
+        if (sd_json_variant_elements(parameters) > 0)
+                return varlink_error_invalid_parameter(link, parameters);
+
+        if (s->writer.writer) {
+                JournalWriterStats stats;
+
+                journal_writer_get_stats(s->writer.writer, &stats);
+
+                r = sd_json_variant_append_arraybo(
+                                &v,
+                                SD_JSON_BUILD_PAIR_STRING("name", journal_writer_get_name(s->writer.writer)),
+                                SD_JSON_BUILD_PAIR_UNSIGNED("queueDepth", stats.n_queued),
+                                SD_JSON_BUILD_PAIR_UNSIGNED("queueDepthMax", stats.n_queued_max),
+                                SD_JSON_BUILD_PAIR_UNSIGNED("queueSize", stats.queue_size),
+                                SD_JSON_BUILD_PAIR_UNSIGNED("written", stats.n_written),
+                                SD_JSON_BUILD_PAIR_UNSIGNED("stalled", stats.n_stalled),
+                                SD_JSON_BUILD_PAIR_UNSIGNED("blocked", stats.n_blocked));
+                if (r < 0)
+                        return r;
+        }
+
+        if (!v)
+                return varlink_replybo(link, SD_JSON_BUILD_PAIR_EMPTY_ARRAY("writers"));
+
+        return varlink_replybo(link, SD_JSON_BUILD_PAIR_VARIANT("writers", v));
+}
+
+static int vl_method_get_datagram_statistics(Varlink *link, sd_json_variant *parameters, VarlinkMethodFlags flags, void *userdata) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        Server *s = ASSERT_PTR(userdata);
+        int r;
+
+        assert(link);
+
+        if (sd_json_variant_elements(parameters) > 0)
+                return varlink_error_invalid_parameter(link, parameters);
+
+        const struct {
+                const char *name;
+                const DatagramStatistics *stats;
+        } table[] = {
+                { "native", &s->native_statistics },
+                { "syslog", &s->syslog_statistics },
+                { "audit",  &s->audit_statistics  },
+        };
+
+        FOREACH_ELEMENT(i, table) {
+                r = sd_json_variant_append_arraybo(
+                                &v,
+                                SD_JSON_BUILD_PAIR_STRING("name", i->name),
+                                SD_JSON_BUILD_PAIR_UNSIGNED("wakeups", i->stats->n_wakeups),
+                                SD_JSON_BUILD_PAIR_UNSIGNED("datagrams", i->stats->n_datagrams),
+                                SD_JSON_BUILD_PAIR_UNSIGNED("datagramsMaxPerWakeup", i->stats->n_datagrams_max));
+                if (r < 0)
+                        return r;
+        }
+
+        return varlink_replybo(link, SD_JSON_BUILD_PAIR_VARIANT("sockets", v));
+}
+
+static int vl_method_get_context_cache_statistics(Varlink *link, sd_json_variant *parameters, VarlinkMethodFlags flags, void *userdata) {
+        Server *s = ASSERT_PTR(userdata);
+        const ClientContextCache *cache = s->client_context_cache;
+        const ClientContextStatistics *st = &cache->statistics;
+
+        assert(link);
+
+        if (sd_json_variant_elements(parameters) > 0)
+                return varlink_error_invalid_parameter(link, parameters);
+
+        return varlink_replybo(
+                        link,
+                        SD_JSON_BUILD_PAIR_UNSIGNED("entries", hashmap_size(cache->contexts)),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("size", cache->size),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("unitEntries", hashmap_size(cache->unit_contexts)),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("hits", st->n_hits),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("misses", st->n_misses),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("refreshes", st->n_refreshes),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("resets", st->n_resets),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("evictions", st->n_evictions),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("unitHits", st->n_unit_hits),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("unitRefreshes", st->n_unit_refreshes));
+}
+
+static int vl_method_get_sync_statistics(Varlink *link, sd_json_variant *parameters, VarlinkMethodFlags flags, void *userdata) {
+        Server *s = ASSERT_PTR(userdata);
+        JournalSyncerStats stats = {};
+
+        assert(link);
+
+        if (sd_json_variant_elements(parameters) > 0)
+                return varlink_error_invalid_parameter(link, parameters);
+
+        if (s->syncer)
+                journal_syncer_get_stats(s->syncer, &stats);
+
+        return varlink_replybo(
+                        link,
+                        SD_JSON_BUILD_PAIR_UNSIGNED("requests", stats.n_requests),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("coalesced", stats.n_coalesced),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("syncs", stats.n_syncs),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("failed", stats.n_failed),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("passes", stats.n_passes),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("latencyP50USec", stats.latency_p50),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("latencyP90USec", stats.latency_p90),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("latencyP99USec", stats.latency_p99),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("latencyMaxUSec", stats.latency_max));
+}
+
+static void server_data_payload_bytes(Server *s, uint64_t *ret_bytes, uint64_t *ret_bytes_stored) {
+        uint64_t bytes = 0, stored = 0;
+        JournalFile *f;
+
+        assert(s);
+        assert(ret_bytes);
+        assert(ret_bytes_stored);
+
+        /* Only covers the journal files that are currently open, which is what matters for the current
+         * compression ratio anyway. */
+        if (s->runtime_journal) {
+                bytes += s->runtime_journal->data_payload_bytes;
+                stored += s->runtime_journal->data_payload_bytes_stored;
+        }
+        if (s->system_journal) {
+                bytes += s->system_journal->data_payload_bytes;
+                stored += s->system_journal->data_payload_bytes_stored;
+        }
+        ORDERED_HASHMAP_FOREACH(f, s->user_journals) {
+                bytes += f->data_payload_bytes;
+                stored += f->data_payload_bytes_stored;
+        }
+
+        *ret_bytes = bytes;
+        *ret_bytes_stored = stored;
+}
+
+static int server_build_statistics_json(Server *s, sd_json_variant **ret) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *transports = NULL, *appends = NULL;
+        LatencyHistogram append_latency[_SERVER_JOURNAL_TYPE_MAX];
+        uint64_t data_bytes, data_bytes_stored;
+        int r;
+
+        assert(s);
+        assert(ret);
+
+        for (ServerTransport t = 0; t < _SERVER_TRANSPORT_MAX; t++) {
+                r = sd_json_variant_append_arraybo(
+                                &transports,
+                                SD_JSON_BUILD_PAIR_STRING("name", server_transport_to_string(t)),
+                                SD_JSON_BUILD_PAIR_UNSIGNED("messages", s->statistics.n_received[t]));
+                if (r < 0)
+                        return r;
+        }
+
+        /* The writer thread updates these as it goes */
+        assert_se(pthread_mutex_lock(&s->append_lock) == 0);
+        memcpy(append_latency, s->statistics.append_latency, sizeof(append_latency));
+        server_data_payload_bytes(s, &data_bytes, &data_bytes_stored);
+        assert_se(pthread_mutex_unlock(&s->append_lock) == 0);
+
+        for (ServerJournalType t = 0; t < _SERVER_JOURNAL_TYPE_MAX; t++) {
+                _cleanup_(sd_json_variant_unrefp) sd_json_variant *histogram = NULL;
+
+                r = latency_histogram_build_json(append_latency + t, &histogram);
+                if (r < 0)
+                        return r;
+
+                r = sd_json_variant_append_arraybo(
+                                &appends,
+                                SD_JSON_BUILD_PAIR_STRING("name", server_journal_type_to_string(t)),
+                                SD_JSON_BUILD_PAIR_UNSIGNED("appends", append_latency[t].n),
+                                SD_JSON_BUILD_PAIR_UNSIGNED("totalUSec", append_latency[t].total),
+                                SD_JSON_BUILD_PAIR_VARIANT("histogram", histogram));
                 if (r < 0)
-                        return log_error_errno(r, "Failed to add watchdog time event: %m");
+                        return r;
         }
 
-        /* This should fire pretty soon, which we'll use to send the READY=1 event. */
-
-        return 0;
+        return sd_json_buildo(
+                        ret,
+                        SD_JSON_BUILD_PAIR_UNSIGNED("timestamp", now(CLOCK_MONOTONIC)),
+                        SD_JSON_BUILD_PAIR_VARIANT("transports", transports),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("filtered", s->statistics.n_filtered),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("ratelimited", s->statistics.n_ratelimited),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("kernelOverruns", s->statistics.n_kmsg_overruns),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("forwardSocketDropped", s->statistics.n_forward_socket_dropped),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("forwardSyslogDropped", s->statistics.n_forward_syslog_dropped),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("stored", s->statistics.n_stored),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("bytesStored", s->statistics.n_bytes_stored),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("contextCacheHits", s->client_context_cache->statistics.n_hits),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("contextCacheMisses", s->client_context_cache->statistics.n_misses),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("dataBytes", data_bytes),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("dataBytesStored", data_bytes_stored),
+                        SD_JSON_BUILD_PAIR_VARIANT("appends", appends));
 }
 
-static int synchronize_second_half(sd_event_source *event_source, void *userdata) {
-        Varlink *link = ASSERT_PTR(userdata);
-        Server *s;
+static int vl_method_get_statistics(Varlink *link, sd_json_variant *parameters, VarlinkMethodFlags flags, void *userdata) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        Server *s = ASSERT_PTR(userdata);
         int r;
 
-        assert_se(s = varlink_get_userdata(link));
+        assert(link);
 
-        /* This is the "second half" of the Synchronize() varlink method. This function is called as deferred
-         * event source at a low priority to ensure the synchronization completes after all queued log
-         * messages are processed. */
-        server_full_sync(s, /* wait = */ true);
+        if (sd_json_variant_elements(parameters) > 0)
+                return varlink_error_invalid_parameter(link, parameters);
 
-        /* Let's get rid of the event source now, by marking it as non-floating again. It then has no ref
-         * anymore and is immediately destroyed after we return from this function, i.e. from this event
-         * source handler at the end. */
-        r = sd_event_source_set_floating(event_source, false);
+        r = server_build_statistics_json(s, &v);
         if (r < 0)
-                return log_error_errno(r, "Failed to mark event source as non-floating: %m");
+                return r;
 
-        return varlink_reply(link, NULL);
+        return varlink_reply(link, v);
 }
 
-static void synchronize_destroy(void *userdata) {
-        varlink_unref(userdata);
+static int server_dispatch_statistics(sd_event_source *es, usec_t usec, void *userdata) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        Server *s = ASSERT_PTR(userdata);
+        Varlink *link;
+        int r;
+
+        if (set_isempty(s->statistics_subscribers))
+                return 0;
+
+        r = server_build_statistics_json(s, &v);
+        if (r < 0)
+                log_warning_errno(r, "Failed to build journal statistics, ignoring: %m");
+        else
+                SET_FOREACH(link, s->statistics_subscribers)
+                        (void) varlink_notify(link, v);
+
+        r = sd_event_source_set_time_relative(es, STATISTICS_INTERVAL_USEC);
+        if (r < 0)
+                return log_warning_errno(r, "Failed to rearm statistics timer: %m");
+
+        return sd_event_source_set_enabled(es, SD_EVENT_ONESHOT);
 }
 
-static int vl_method_synchronize(Varlink *link, sd_json_variant *parameters, VarlinkMethodFlags flags, void *userdata) {
-        _cleanup_(sd_event_source_unrefp) sd_event_source *event_source = NULL;
+static int vl_method_subscribe_statistics(Varlink *link, sd_json_variant *parameters, VarlinkMethodFlags flags, void *userdata) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
         Server *s = ASSERT_PTR(userdata);
         int r;
 
         assert(link);
 
+        /* if the client didn't set the more flag, it is using us incorrectly */
+        if (!FLAGS_SET(flags, VARLINK_METHOD_MORE))
+                return varlink_error(link, VARLINK_ERROR_EXPECTED_MORE, NULL);
+
         if (sd_json_variant_elements(parameters) > 0)
                 return varlink_error_invalid_parameter(link, parameters);
 
-        log_info("Received client request to sync journal.");
-
-        /* We don't do the main work now, but instead enqueue a deferred event loop job which will do
-         * it. That job is scheduled at low priority, so that we return from this method call only after all
-         * queued but not processed log messages are written to disk, so that this method call returning can
-         * be used as nice synchronization point. */
-        r = sd_event_add_defer(s->event, &event_source, synchronize_second_half, link);
+        /* Send the current statistics right away, and then periodically */
+        r = server_build_statistics_json(s, &v);
         if (r < 0)
-                return log_error_errno(r, "Failed to allocate defer event source: %m");
+                return r;
 
-        r = sd_event_source_set_destroy_callback(event_source, synchronize_destroy);
+        r = varlink_notify(link, v);
         if (r < 0)
-                return log_error_errno(r, "Failed to set event source destroy callback: %m");
+                return r;
 
-        varlink_ref(link); /* The varlink object is now left to the destroy callback to unref */
+        if (!s->statistics_event_source) {
+                r = sd_event_add_time_relative(
+                                s->event,
+                                &s->statistics_event_source,
+                                CLOCK_MONOTONIC,
+                                STATISTICS_INTERVAL_USEC, 0,
+                                server_dispatch_statistics, s);
+                if (r < 0)
+                        return r;
 
-        r = sd_event_source_set_priority(event_source, SD_EVENT_PRIORITY_NORMAL+15);
+                (void) sd_event_source_set_description(s->statistics_event_source, "statistics");
+        } else if (set_isempty(s->statistics_subscribers)) {
+                r = sd_event_source_set_time_relative(s->statistics_event_source, STATISTICS_INTERVAL_USEC);
+                if (r < 0)
+                        return r;
+
+                r = sd_event_source_set_enabled(s->statistics_event_source, SD_EVENT_ONESHOT);
+                if (r < 0)
+                        return r;
+        }
+
+        r = set_ensure_put(&s->statistics_subscribers, NULL, link);
         if (r < 0)
-                return log_error_errno(r, "Failed to set defer event source priority: %m");
+                return r;
+        varlink_ref(link);
 
-        /* Give up ownership of this event source. It will now be destroyed along with event loop itself,
-         * unless it destroys itself earlier. */
-        r = sd_event_source_set_floating(event_source, true);
+        return 1;
+}
+
+static int server_build_tail_json(Server *s, sd_json_variant **ret) {
+        assert(s);
+        assert(s->seqnum);
+        assert(ret);
+
+        /* The writer thread increases the seqnum under the append lock, hence read it atomically */
+        return sd_json_buildo(
+                        ret,
+                        SD_JSON_BUILD_PAIR_UNSIGNED("seqnum", __atomic_load_n(&s->seqnum->seqnum, __ATOMIC_SEQ_CST)),
+                        SD_JSON_BUILD_PAIR_CONDITION(!sd_id128_is_null(s->seqnum->id), "seqnumId", SD_JSON_BUILD_ID128(s->seqnum->id)));
+}
+
+static int server_dispatch_tail(sd_event_source *es, void *userdata) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        Server *s = ASSERT_PTR(userdata);
+        Varlink *link;
+        int r;
+
+        r = server_build_tail_json(s, &v);
         if (r < 0)
-                return log_error_errno(r, "Failed to mark event source as floating: %m");
+                return log_warning_errno(r, "Failed to build journal tail, ignoring: %m");
 
-        (void) sd_event_source_set_description(event_source, "deferred-sync");
+        SET_FOREACH(link, s->tail_subscribers)
+                (void) varlink_notify(link, v);
 
         return 0;
 }
 
-static int vl_method_rotate(Varlink *link, sd_json_variant *parameters, VarlinkMethodFlags flags, void *userdata) {
+static int vl_method_subscribe_tail(Varlink *link, sd_json_variant *parameters, VarlinkMethodFlags flags, void *userdata) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
         Server *s = ASSERT_PTR(userdata);
+        int r;
 
         assert(link);
 
+        if (!FLAGS_SET(flags, VARLINK_METHOD_MORE))
+                return varlink_error(link, VARLINK_ERROR_EXPECTED_MORE, NULL);
+
         if (sd_json_variant_elements(parameters) > 0)
                 return varlink_error_invalid_parameter(link, parameters);
 
-        log_info("Received client request to rotate journal, rotating.");
-        server_full_rotate(s);
+        if (!s->tail_event_source) {
+                r = sd_event_add_defer(s->event, &s->tail_event_source, server_dispatch_tail, s);
+                if (r < 0)
+                        return r;
 
-        return varlink_reply(link, NULL);
-}
+                r = sd_event_source_set_enabled(s->tail_event_source, SD_EVENT_OFF);
+                if (r < 0)
+                        return r;
 
-static int vl_method_flush_to_var(Varlink *link, sd_json_variant *parameters, VarlinkMethodFlags flags, void *userdata) {
-        Server *s = ASSERT_PTR(userdata);
+                (void) sd_event_source_set_description(s->tail_event_source, "tail");
+        }
 
-        assert(link);
+        /* Send the current tail right away, so that the client knows it is subscribed */
+        r = server_build_tail_json(s, &v);
+        if (r < 0)
+                return r;
 
-        if (sd_json_variant_elements(parameters) > 0)
-                return varlink_error_invalid_parameter(link, parameters);
-        if (s->namespace)
-                return varlink_error(link, "io.systemd.Journal.NotSupportedByNamespaces", NULL);
+        r = varlink_notify(link, v);
+        if (r < 0)
+                return r;
 
-        log_info("Received client request to flush runtime journal.");
-        server_full_flush(s);
+        r = set_ensure_put(&s->tail_subscribers, NULL, link);
+        if (r < 0)
+                return r;
+        varlink_ref(link);
 
-        return varlink_reply(link, NULL);
+        __atomic_store_n(&s->writer_tail_subscribed, true, __ATOMIC_SEQ_CST);
+
+        return 1;
 }
 
-static int vl_method_relinquish_var(Varlink *link, sd_json_variant *parameters, VarlinkMethodFlags flags, void *userdata) {
+static int vl_method_get_rate_limit_statistics(Varlink *link, sd_json_variant *parameters, VarlinkMethodFlags flags, void *userdata) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
         Server *s = ASSERT_PTR(userdata);
+        int r;
 
         assert(link);
 
         if (sd_json_variant_elements(parameters) > 0)
                 return varlink_error_invalid_parameter(link, parameters);
-        if (s->namespace)
-                return varlink_error(link, "io.systemd.Journal.NotSupportedByNamespaces", NULL);
 
-        log_info("Received client request to relinquish %s access.", s->system_storage.path);
-        server_relinquish_var(s);
+        r = journal_ratelimit_build_json(s->ratelimit, &v);
+        if (r < 0)
+                return r;
 
-        return varlink_reply(link, NULL);
+        return varlink_replybo(link, SD_JSON_BUILD_PAIR_VARIANT("units", v));
 }
 
 static int vl_connect(VarlinkServer *server, Varlink *link, void *userdata) {
@@ -2316,6 +3337,16 @@ static void vl_disconnect(VarlinkServer *server, Varlink *link, void *userdata)
         assert(server);
         assert(link);
 
+        if (set_remove(s->statistics_subscribers, link))
+                varlink_unref(link);
+
+        if (set_remove(s->tail_subscribers, link)) {
+                varlink_unref(link);
+
+                if (set_isempty(s->tail_subscribers))
+                        __atomic_store_n(&s->writer_tail_subscribed, false, __ATOMIC_SEQ_CST);
+        }
+
         (void) server_start_or_stop_idle_timer(s); /* maybe we are idle now */
 }
 
@@ -2330,16 +3361,31 @@ static int server_open_varlink(Server *s, const char *socket, int fd) {
 
         varlink_server_set_userdata(s->varlink_server, s);
 
-        r = varlink_server_add_interface(s->varlink_server, &vl_interface_io_systemd_Journal);
+        r = varlink_server_add_interface_many(
+                        s->varlink_server,
+                        &vl_interface_io_systemd_Journal,
+                        &vl_interface_io_systemd_service);
         if (r < 0)
-                return log_error_errno(r, "Failed to add Journal interface to varlink server: %m");
+                return log_error_errno(r, "Failed to add interfaces to varlink server: %m");
 
         r = varlink_server_bind_method_many(
                         s->varlink_server,
                         "io.systemd.Journal.Synchronize",   vl_method_synchronize,
                         "io.systemd.Journal.Rotate",        vl_method_rotate,
                         "io.systemd.Journal.FlushToVar",    vl_method_flush_to_var,
-                        "io.systemd.Journal.RelinquishVar", vl_method_relinquish_var);
+                        "io.systemd.Journal.RelinquishVar", vl_method_relinquish_var,
+                        "io.systemd.Journal.GetWriterStatistics", vl_method_get_writer_statistics,
+                        "io.systemd.Journal.GetDatagramStatistics", vl_method_get_datagram_statistics,
+                        "io.systemd.Journal.GetContextCacheStatistics", vl_method_get_context_cache_statistics,
+                        "io.systemd.Journal.GetSyncStatistics", vl_method_get_sync_statistics,
+                        "io.systemd.Journal.GetStatistics", vl_method_get_statistics,
+                        "io.systemd.Journal.SubscribeStatistics", vl_method_subscribe_statistics,
+                        "io.systemd.Journal.SubscribeTail", vl_method_subscribe_tail,
+                        "io.systemd.Journal.GetRateLimitStatistics", vl_method_get_rate_limit_statistics,
+                        "io.systemd.service.SetEventLoopStatistics", varlink_method_set_event_loop_statistics,
+                        "io.systemd.service.GetEventLoopStatistics", varlink_method_get_event_loop_statistics,
+                        "io.systemd.service.SetVarlinkStatistics", varlink_method_set_varlink_statistics,
+                        "io.systemd.service.GetVarlinkStatistics", varlink_method_get_varlink_statistics);
         if (r < 0)
                 return r;
 
@@ -2410,7 +3456,7 @@ static void server_unmap_seqnum_file(void *p, size_t size) {
         assert_se(munmap(p, size) >= 0);
 }
 
-static bool server_is_idle(Server *s) {
+static bool server_is_idle_one(Server *s) {
         assert(s);
 
         /* The server for the main namespace is never idle */
@@ -2433,6 +3479,17 @@ static bool server_is_idle(Server *s) {
         return true;
 }
 
+static bool server_is_idle(Server *s) {
+        assert(s);
+
+        /* Exiting takes down all namespaces served by this process, hence all of them need to be idle */
+        SERVER_FOREACH_SIBLING(i, s)
+                if (!server_is_idle_one(i))
+                        return false;
+
+        return true;
+}
+
 static int server_idle_handler(sd_event_source *source, uint64_t usec, void *userdata) {
         Server *s = ASSERT_PTR(userdata);
 
@@ -2449,6 +3506,8 @@ int server_start_or_stop_idle_timer(Server *s) {
 
         assert(s);
 
+        s = server_primary(s);
+
         if (!server_is_idle(s)) {
                 s->idle_event_source = sd_event_source_disable_unref(s->idle_event_source);
                 return 0;
@@ -2476,6 +3535,8 @@ static int server_refresh_idle_timer(Server *s) {
 
         assert(s);
 
+        s = server_primary(s);
+
         if (!s->idle_event_source)
                 return 0;
 
@@ -2515,13 +3576,17 @@ static int server_memory_pressure(sd_event_source *es, void *userdata) {
         client_context_flush_regular(s);
 
         /* Let's also close all user files (but keep the system/runtime one open) */
-        for (;;) {
-                JournalFile *first = ordered_hashmap_steal_first(s->user_journals);
+        SERVER_FOREACH_SIBLING(i, s) {
+                server_pause_writer(i);
+                for (;;) {
+                        JournalFile *first = ordered_hashmap_steal_first(i->user_journals);
 
-                if (!first)
-                        break;
+                        if (!first)
+                                break;
 
-                (void) journal_file_offline_close(first);
+                        (void) journal_file_offline_close(first);
+                }
+                server_resume_writer(i);
         }
 
         sd_event_trim_memory();
@@ -2571,8 +3636,35 @@ static void server_load_credentials(Server *s) {
         }
 }
 
+static void server_load_compress_dictionary(Server *s) {
+        _cleanup_free_ char *data = NULL;
+        size_t size;
+        int r;
+
+        assert(s);
+
+        if (!s->compress.dictionary_path)
+                return;
+
+        r = read_full_file(s->compress.dictionary_path, &data, &size);
+        if (r < 0) {
+                log_warning_errno(r, "Failed to read ZSTD dictionary %s, training dictionaries on rotation instead: %m",
+                                  s->compress.dictionary_path);
+                return;
+        }
+        if (size == 0) {
+                log_warning("ZSTD dictionary %s is empty, training dictionaries on rotation instead.",
+                            s->compress.dictionary_path);
+                return;
+        }
+
+        iovec_done(&s->compress_dictionary);
+        s->compress_dictionary = IOVEC_MAKE(TAKE_PTR(data), size);
+}
+
 int server_new(Server **ret) {
         _cleanup_(server_freep) Server *s = NULL;
+        int r;
 
         assert(ret);
 
@@ -2606,9 +3698,13 @@ int server_new(Server **ret) {
 
                 .forward_to_wall = true,
                 .forward_to_socket = { .sockaddr.sa.sa_family = AF_UNSPEC },
+                .forward_latency_usec = DEFAULT_FORWARD_LATENCY_USEC,
 
                 .max_file_usec = DEFAULT_MAX_FILE_USEC,
 
+                .append_lock = PTHREAD_MUTEX_INITIALIZER,
+                .writer_sync_priority = INT_MAX,
+
                 .max_level_store = LOG_DEBUG,
                 .max_level_syslog = LOG_DEBUG,
                 .max_level_kmsg = LOG_NOTICE,
@@ -2630,18 +3726,23 @@ int server_new(Server **ret) {
                 .sigrtmin18_info.memory_pressure_userdata = s,
         };
 
+        r = client_context_cache_new(&s->client_context_cache);
+        if (r < 0)
+                return r;
+
         *ret = TAKE_PTR(s);
         return 0;
 }
 
-int server_init(Server *s, const char *namespace) {
+static int server_init_internal(Server *s, const char *namespace, FDSet *fds) {
         const char *native_socket, *syslog_socket, *stdout_socket, *varlink_socket, *e;
-        _cleanup_fdset_free_ FDSet *fds = NULL;
-        int n, r, varlink_fd = -EBADF;
-        bool no_sockets;
+        int fd, r, varlink_fd = -EBADF;
+        bool no_sockets, shared;
 
         assert(s);
 
+        shared = server_is_shared(s);
+
         r = server_set_namespace(s, namespace);
         if (r < 0)
                 return r;
@@ -2655,6 +3756,7 @@ int server_init(Server *s, const char *namespace) {
 
         server_load_credentials(s);
         server_parse_config_file(s);
+        server_load_compress_dictionary(s);
 
         if (!s->namespace) {
                 /* Parse kernel command line, but only if we are not a namespace instance */
@@ -2669,7 +3771,9 @@ int server_init(Server *s, const char *namespace) {
                 s->ratelimit_interval = s->ratelimit_burst = 0;
         }
 
-        e = getenv("RUNTIME_DIRECTORY");
+        /* When serving several namespaces, the directories the service manager set up for us cannot be told
+         * apart, hence always use the default ones */
+        e = shared ? NULL : getenv("RUNTIME_DIRECTORY");
         if (e)
                 s->runtime_directory = strdup(e);
         else if (s->namespace)
@@ -2685,10 +3789,20 @@ int server_init(Server *s, const char *namespace) {
         if (!s->user_journals)
                 return log_oom();
 
-        s->mmap = mmap_cache_new();
+        /* The mmap cache is not thread-safe, hence only share it if no writer thread uses it */
+        if (s->primary && !s->writer_thread && !s->primary->writer_thread)
+                s->mmap = mmap_cache_ref(s->primary->mmap);
+        else
+                s->mmap = mmap_cache_new();
         if (!s->mmap)
                 return log_oom();
 
+        if (s->primary) {
+                /* The metadata of clients does not depend on the namespace they log to */
+                client_context_cache_unref(s->client_context_cache);
+                s->client_context_cache = client_context_cache_ref(s->primary->client_context_cache);
+        }
+
         s->deferred_closes = set_new(NULL);
         if (!s->deferred_closes)
                 return log_oom();
@@ -2697,16 +3811,19 @@ int server_init(Server *s, const char *namespace) {
         if (r < 0)
                 return log_error_errno(r, "Failed to create event loop: %m");
 
-        n = sd_listen_fds(true);
-        if (n < 0)
-                return log_error_errno(n, "Failed to read listening file descriptors from environment: %m");
+        /* The stdout streams and the sockets all have the same priority. When many of them are busy at
+         * once, dispatch a couple of them per event loop iteration, instead of polling again after each. */
+        r = sd_event_set_dispatch_budget(s->event, 16, 10 * USEC_PER_MSEC);
+        if (r < 0)
+                return log_error_errno(r, "Failed to set event loop dispatch budget: %m");
 
         native_socket = strjoina(s->runtime_directory, "/socket");
         stdout_socket = strjoina(s->runtime_directory, "/stdout");
         syslog_socket = strjoina(s->runtime_directory, "/dev-log");
         varlink_socket = strjoina(s->runtime_directory, "/io.systemd.journal");
 
-        for (int fd = SD_LISTEN_FDS_START; fd < SD_LISTEN_FDS_START + n; fd++)
+        /* Take the sockets that are ours, and leave the rest to the servers for other namespaces, if any */
+        FDSET_FOREACH(fd, fds)
 
                 if (sd_is_socket_unix(fd, SOCK_DGRAM, -1, native_socket, 0) > 0) {
 
@@ -2714,7 +3831,7 @@ int server_init(Server *s, const char *namespace) {
                                 return log_error_errno(SYNTHETIC_ERRNO(EINVAL),
                                                        "Too many native sockets passed.");
 
-                        s->native_fd = fd;
+                        s->native_fd = fdset_remove(fds, fd);
 
                 } else if (sd_is_socket_unix(fd, SOCK_STREAM, 1, stdout_socket, 0) > 0) {
 
@@ -2722,7 +3839,7 @@ int server_init(Server *s, const char *namespace) {
                                 return log_error_errno(SYNTHETIC_ERRNO(EINVAL),
                                                        "Too many stdout sockets passed.");
 
-                        s->stdout_fd = fd;
+                        s->stdout_fd = fdset_remove(fds, fd);
 
                 } else if (sd_is_socket_unix(fd, SOCK_DGRAM, -1, syslog_socket, 0) > 0) {
 
@@ -2730,7 +3847,7 @@ int server_init(Server *s, const char *namespace) {
                                 return log_error_errno(SYNTHETIC_ERRNO(EINVAL),
                                                        "Too many /dev/log sockets passed.");
 
-                        s->syslog_fd = fd;
+                        s->syslog_fd = fdset_remove(fds, fd);
 
                 } else if (sd_is_socket_unix(fd, SOCK_STREAM, 1, varlink_socket, 0) > 0) {
 
@@ -2738,37 +3855,24 @@ int server_init(Server *s, const char *namespace) {
                                 return log_error_errno(SYNTHETIC_ERRNO(EINVAL),
                                                        "Too many varlink sockets passed.");
 
-                        varlink_fd = fd;
+                        varlink_fd = fdset_remove(fds, fd);
+
                 } else if (sd_is_socket(fd, AF_NETLINK, SOCK_RAW, -1) > 0) {
 
                         if (s->audit_fd >= 0)
                                 return log_error_errno(SYNTHETIC_ERRNO(EINVAL),
                                                        "Too many audit sockets passed.");
 
-                        s->audit_fd = fd;
-
-                } else {
-
-                        if (!fds) {
-                                fds = fdset_new();
-                                if (!fds)
-                                        return log_oom();
-                        }
-
-                        r = fdset_put(fds, fd);
-                        if (r < 0)
-                                return log_oom();
+                        s->audit_fd = fdset_remove(fds, fd);
                 }
 
         /* Try to restore streams, but don't bother if this fails */
         (void) server_restore_streams(s, fds);
 
-        if (!fdset_isempty(fds)) {
-                log_warning("%u unknown file descriptors passed, closing.", fdset_size(fds));
-                fds = fdset_free(fds);
-        }
-
-        no_sockets = s->native_fd < 0 && s->stdout_fd < 0 && s->syslog_fd < 0 && s->audit_fd < 0 && varlink_fd < 0;
+        /* The namespaces of a shared process might not have been started via socket activation all alike,
+         * hence only collect audit messages if we are explicitly asked to */
+        no_sockets = !shared &&
+                s->native_fd < 0 && s->stdout_fd < 0 && s->syslog_fd < 0 && s->audit_fd < 0 && varlink_fd < 0;
 
         /* always open stdout, syslog, native, and kmsg sockets */
 
@@ -2818,13 +3922,16 @@ int server_init(Server *s, const char *namespace) {
         if (r < 0)
                 return r;
 
-        r = server_setup_signals(s);
-        if (r < 0)
-                return r;
+        /* Only once per process, the handlers take care of all namespaces */
+        if (!s->primary) {
+                r = server_setup_signals(s);
+                if (r < 0)
+                        return r;
 
-        r = server_setup_memory_pressure(s);
-        if (r < 0)
-                return r;
+                r = server_setup_memory_pressure(s);
+                if (r < 0)
+                        return r;
+        }
 
         r = cg_get_root_path(&s->cgroup_root);
         if (r < 0)
@@ -2841,7 +3948,7 @@ int server_init(Server *s, const char *namespace) {
         if (!s->runtime_storage.path)
                 return log_oom();
 
-        e = getenv("LOGS_DIRECTORY");
+        e = shared ? NULL : getenv("LOGS_DIRECTORY");
         if (e)
                 s->system_storage.path = strdup(e);
         else if (s->namespace)
@@ -2851,7 +3958,8 @@ int server_init(Server *s, const char *namespace) {
         if (!s->system_storage.path)
                 return log_oom();
 
-        (void) server_connect_notify(s);
+        if (!s->primary)
+                (void) server_connect_notify(s);
 
         (void) client_context_acquire_default(s);
 
@@ -2859,23 +3967,76 @@ int server_init(Server *s, const char *namespace) {
         if (r < 0)
                 return r;
 
+        r = server_setup_writer(s);
+        if (r < 0)
+                return r;
+
         server_start_or_stop_idle_timer(s);
 
         return 0;
 }
 
+int server_init(Server *s, const char *namespace) {
+        _cleanup_fdset_free_ FDSet *fds = NULL;
+        int r;
+
+        assert(s);
+
+        r = fdset_new_listen_fds(&fds, /* unset= */ true);
+        if (r < 0)
+                return log_error_errno(r, "Failed to read listening file descriptors from environment: %m");
+
+        r = server_init_internal(s, namespace, fds);
+        if (r < 0)
+                return r;
+
+        if (!fdset_isempty(fds))
+                log_warning("%u unknown file descriptors passed, closing.", fdset_size(fds));
+
+        return 0;
+}
+
+int server_init_shared(Server *s, Server *primary, const char *namespace, FDSet *fds) {
+        assert(s);
+        assert(!s->primary);
+        assert(!s->servers);
+        assert(namespace);
+        assert(fds);
+
+        /* Sets up a server for one of several namespaces served by this process. The first one is the
+         * primary, pass it as 'primary' for all others. Sockets passed in 'fds' which belong to this
+         * namespace are taken out of the set. */
+
+        if (primary) {
+                assert(!primary->primary);
+
+                s->primary = primary;
+                LIST_APPEND(servers, primary->servers, s);
+        } else
+                LIST_APPEND(servers, s->servers, s);
+
+        return server_init_internal(s, namespace, fds);
+}
+
 void server_maybe_append_tags(Server *s) {
 #if HAVE_GCRYPT
         JournalFile *f;
         usec_t n;
 
+        if (!s->seal)
+                return;
+
         n = now(CLOCK_REALTIME);
 
+        server_pause_writer(s);
+
         if (s->system_journal)
                 journal_file_maybe_append_tag(s->system_journal, n);
 
         ORDERED_HASHMAP_FOREACH(f, s->user_journals)
                 journal_file_maybe_append_tag(f, n);
+
+        server_resume_writer(s);
 #endif
 }
 
@@ -2883,6 +4044,20 @@ Server* server_free(Server *s) {
         if (!s)
                 return NULL;
 
+        /* The primary server goes last, as the others use what it owns */
+        if (s->primary)
+                LIST_REMOVE(servers, s->primary->servers, s);
+        else
+                LIST_FOREACH(servers, i, s->servers)
+                        if (i != s)
+                                server_free(i);
+
+        server_stop_writer(s);
+        s->syncer = journal_syncer_free(s->syncer);
+
+        /* Hand out whatever is still waiting to be forwarded, as far as the receivers let us */
+        server_flush_forward(s);
+
         free(s->namespace);
         free(s->namespace_field);
 
@@ -2891,7 +4066,10 @@ Server* server_free(Server *s) {
         while (s->stdout_streams)
                 stdout_stream_free(s->stdout_streams);
 
-        client_context_flush_all(s);
+        if (s->client_context_cache) {
+                client_context_flush_all(s);
+                client_context_cache_unref(s->client_context_cache);
+        }
 
         (void) journal_file_offline_close(s->system_journal);
         (void) journal_file_offline_close(s->runtime_journal);
@@ -2899,6 +4077,10 @@ Server* server_free(Server *s) {
         ordered_hashmap_free_with_destructor(s->user_journals, journal_file_offline_close);
 
         varlink_server_unref(s->varlink_server);
+        set_free(s->statistics_subscribers);
+        sd_event_source_unref(s->statistics_event_source);
+        set_free(s->tail_subscribers);
+        sd_event_source_unref(s->tail_event_source);
 
         sd_event_source_unref(s->syslog_event_source);
         sd_event_source_unref(s->native_event_source);
@@ -2915,6 +4097,9 @@ Server* server_free(Server *s) {
         sd_event_source_unref(s->notify_event_source);
         sd_event_source_unref(s->watchdog_event_source);
         sd_event_source_unref(s->idle_event_source);
+        sd_event_source_unref(s->forward_defer_event_source);
+        sd_event_source_unref(s->forward_timer_event_source);
+        sd_event_source_unref(s->forward_socket_event_source);
         sd_event_unref(s->event);
 
         safe_close(s->syslog_fd);
@@ -2926,17 +4111,24 @@ Server* server_free(Server *s) {
         safe_close(s->notify_fd);
         safe_close(s->forward_socket_fd);
 
-        ordered_hashmap_free(s->ratelimit_groups_by_id);
+        journal_ratelimit_free(s->ratelimit);
+        hashmap_free(s->kmsg_devices);
 
         server_unmap_seqnum_file(s->seqnum, sizeof(*s->seqnum));
         server_unmap_seqnum_file(s->kernel_seqnum, sizeof(*s->kernel_seqnum));
 
         free(s->buffer);
+        free(s->audit_batch);
+        free(s->audit_fields_buffer);
+        free(s->forward_socket_buffer);
+        syslog_forward_batch_free(s->forward_syslog_batch);
         free(s->tty_path);
         free(s->cgroup_root);
         free(s->hostname_field);
         free(s->runtime_storage.path);
         free(s->system_storage.path);
+        free(s->compress.dictionary_path);
+        iovec_done(&s->compress_dictionary);
         free(s->runtime_directory);
 
         mmap_cache_unref(s->mmap);
@@ -3059,6 +4251,51 @@ int config_parse_compress(
         return 0;
 }
 
+int config_parse_compress_dictionary(
+                const char* unit,
+                const char *filename,
+                unsigned line,
+                const char *section,
+                unsigned section_line,
+                const char *lvalue,
+                int ltype,
+                const char *rvalue,
+                void *data,
+                void *userdata) {
+
+        JournalCompressOptions* compress = ASSERT_PTR(data);
+        int r;
+
+        assert(filename);
+        assert(rvalue);
+
+        if (isempty(rvalue)) {
+                compress->dictionary = false;
+                compress->dictionary_path = mfree(compress->dictionary_path);
+                return 0;
+        }
+
+        r = parse_boolean(rvalue);
+        if (r >= 0) {
+                compress->dictionary = r;
+                compress->dictionary_path = mfree(compress->dictionary_path);
+                return 0;
+        }
+
+        if (!path_is_absolute(rvalue)) {
+                log_syntax(unit, LOG_WARNING, filename, line, 0,
+                           "Failed to parse CompressDictionary= value, ignoring: %s", rvalue);
+                return 0;
+        }
+
+        r = free_and_strdup_warn(&compress->dictionary_path, rvalue);
+        if (r < 0)
+                return r;
+
+        compress->dictionary = true;
+        return 0;
+}
+
 int config_parse_forward_to_socket(
                 const char* unit,
                 const char *filename,
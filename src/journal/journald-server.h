@@ -1,6 +1,7 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 #pragma once
 
+#include <pthread.h>
 #include <stdbool.h>
 #include <sys/types.h>
 
@@ -11,10 +12,15 @@ typedef struct Server Server;
 
 #include "common-signal.h"
 #include "conf-parser.h"
+#include "fdset.h"
 #include "hashmap.h"
 #include "journal-file.h"
 #include "journald-context.h"
+#include "journald-rate-limit.h"
+#include "journald-statistics.h"
 #include "journald-stream.h"
+#include "journald-sync.h"
+#include "journald-writer.h"
 #include "list.h"
 #include "prioq.h"
 #include "ratelimit.h"
@@ -41,8 +47,28 @@ typedef enum SplitMode {
 typedef struct JournalCompressOptions {
         bool enabled;
         uint64_t threshold_bytes;
+        bool dictionary;
+        char *dictionary_path; /* if unset, the dictionary is trained from the archived file on rotation */
 } JournalCompressOptions;
 
+typedef struct ServerWriter {
+        Server *server;
+        JournalWriter *writer;
+        sd_event_source *event_source;
+
+        /* Like Server.last_realtime_clock, but for the entries passing through this writer */
+        usec_t last_realtime_clock;
+} ServerWriter;
+
+typedef struct DatagramBatch DatagramBatch;
+typedef struct SyslogForwardBatch SyslogForwardBatch;
+
+typedef struct DatagramStatistics {
+        uint64_t n_wakeups;
+        uint64_t n_datagrams;
+        unsigned n_datagrams_max;
+} DatagramStatistics;
+
 typedef struct JournalStorageSpace {
         usec_t   timestamp;
 
@@ -51,6 +77,8 @@ typedef struct JournalStorageSpace {
 
         uint64_t vfs_used; /* space used by journal files */
         uint64_t vfs_available;
+
+        uint64_t vacuum_generation; /* see journal_vacuum_generation() */
 } JournalStorageSpace;
 
 typedef struct JournalStorage {
@@ -71,6 +99,13 @@ typedef struct SeqnumData {
 struct Server {
         char *namespace;
 
+        /* When one process serves several namespaces, the first server owns what exists once per process
+         * (signal handlers, the watchdog, the idle timer) and keeps a list of all of them, itself included.
+         * The others point to it. Unset if this server runs on its own. */
+        Server *primary;
+        LIST_HEAD(Server, servers);
+        LIST_FIELDS(Server, servers);
+
         int syslog_fd;
         int native_fd;
         int stdout_fd;
@@ -106,8 +141,15 @@ struct Server {
         SeqnumData *seqnum;
 
         char *buffer;
+        DatagramBatch *audit_batch;
+        char *audit_fields_buffer; /* Reused for the fields we generate from each audit record */
+
+        DatagramStatistics native_statistics;
+        DatagramStatistics syslog_statistics;
+        DatagramStatistics audit_statistics;
+        ServerStatistics statistics;
 
-        OrderedHashmap *ratelimit_groups_by_id;
+        JournalRateLimit *ratelimit;
         usec_t sync_interval_usec;
         usec_t ratelimit_interval;
         unsigned ratelimit_burst;
@@ -116,6 +158,7 @@ struct Server {
         JournalStorage system_storage;
 
         JournalCompressOptions compress;
+        struct iovec compress_dictionary;
         bool seal;
         bool read_kmsg;
         int set_audit;
@@ -129,6 +172,17 @@ struct Server {
         unsigned n_forward_syslog_missed;
         usec_t last_warn_forward_syslog_missed;
 
+        /* Messages to forward are collected and sent out in batches, once per event loop iteration, or
+         * after ForwardLatencySec= at the latest */
+        usec_t forward_latency_usec;
+        sd_event_source *forward_defer_event_source;
+        sd_event_source *forward_timer_event_source;
+        SyslogForwardBatch *forward_syslog_batch;
+        char *forward_socket_buffer;
+        size_t forward_socket_buffer_size;
+        uint64_t forward_socket_n_records;
+        sd_event_source *forward_socket_event_source;
+
         usec_t max_retention_usec;
         usec_t max_file_usec;
         usec_t oldest_file_usec;
@@ -151,9 +205,26 @@ struct Server {
 
         MMapCache *mmap;
 
+        bool writer_thread;
+        ServerWriter writer;
+        /* Held by the writer thread while appending, so that the statistics it updates may be read */
+        pthread_mutex_t append_lock;
+        /* Lowest priority written by the writer thread since the last sync, and whether the main thread
+         * has been asked to schedule a sync already */
+        int writer_sync_priority;
+        bool writer_sync_armed;
+        /* Whether there are connections subscribed to the tail, and whether the writer thread wrote entries
+         * the main thread has not told them about yet */
+        bool writer_tail_subscribed;
+        bool writer_tail_pending;
+
+        /* Syncs journal files in the background after messages of high priority */
+        JournalSyncer *syncer;
+
         Set *deferred_closes;
 
         uint64_t *kernel_seqnum;
+        Hashmap *kmsg_devices;
         bool dev_kmsg_readable:1;
         RateLimit kmsg_own_ratelimit;
 
@@ -177,19 +248,34 @@ struct Server {
         size_t line_max;
 
         /* Caching of client metadata */
-        Hashmap *client_contexts;
-        Prioq *client_contexts_lru;
-
-        usec_t last_cache_pid_flush;
+        ClientContextCache *client_context_cache;
 
         ClientContext *my_context; /* the context of journald itself */
         ClientContext *pid1_context; /* the context of PID 1 */
 
         VarlinkServer *varlink_server;
+        /* Connections that asked to be sent the statistics periodically */
+        Set *statistics_subscribers;
+        sd_event_source *statistics_event_source;
+        /* Connections that asked to be told whenever entries were written */
+        Set *tail_subscribers;
+        sd_event_source *tail_event_source;
 };
 
 #define SERVER_MACHINE_ID(s) ((s)->machine_id_field + STRLEN("_MACHINE_ID="))
 
+static inline Server* server_primary(Server *s) {
+        return ASSERT_PTR(s)->primary ?: s;
+}
+
+static inline bool server_is_shared(Server *s) {
+        return server_primary(s)->servers;
+}
+
+/* Iterates over all servers in this process, i.e. just this one, unless several namespaces are served */
+#define SERVER_FOREACH_SIBLING(i, s)                                    \
+        for (Server *i = server_primary(s)->servers ?: (s); i; i = i->servers_next)
+
 /* Extra fields for any log messages */
 #define N_IOVEC_META_FIELDS 24
 
@@ -217,6 +303,7 @@ const struct ConfigPerfItem* journald_gperf_lookup(const char *key, GPERF_LEN_TY
 CONFIG_PARSER_PROTOTYPE(config_parse_storage);
 CONFIG_PARSER_PROTOTYPE(config_parse_line_max);
 CONFIG_PARSER_PROTOTYPE(config_parse_compress);
+CONFIG_PARSER_PROTOTYPE(config_parse_compress_dictionary);
 CONFIG_PARSER_PROTOTYPE(config_parse_forward_to_socket);
 
 const char* storage_to_string(Storage s) _const_;
@@ -229,6 +316,7 @@ SplitMode split_mode_from_string(const char *s) _pure_;
 
 int server_new(Server **ret);
 int server_init(Server *s, const char *namespace);
+int server_init_shared(Server *s, Server *primary, const char *namespace, FDSet *fds);
 Server* server_free(Server *s);
 DEFINE_TRIVIAL_CLEANUP_FUNC(Server*, server_free);
 void server_vacuum(Server *s, bool verbose);
@@ -240,4 +328,7 @@ void server_space_usage_message(Server *s, JournalStorage *storage);
 
 int server_start_or_stop_idle_timer(Server *s);
 
+void server_schedule_forward(Server *s);
+void server_flush_forward(Server *s);
+
 int server_map_seqnum_file(Server *s, const char *fname, size_t size, void **ret);
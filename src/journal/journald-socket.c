@@ -4,7 +4,9 @@
 #include <sys/socket.h>
 #include <sys/uio.h>
 
+#include "alloc-util.h"
 #include "fd-util.h"
+#include "io-util.h"
 #include "iovec-util.h"
 #include "journald-socket.h"
 #include "log.h"
@@ -13,10 +15,37 @@
 #include "socket-util.h"
 #include "sparse-endian.h"
 
+/* Records are sent once this much is buffered, without waiting for the latency bound */
+#define FORWARD_SOCKET_FLUSH_BYTES (64U * 1024U)
+/* If the peer does not keep up, records are dropped once this much is buffered */
+#define FORWARD_SOCKET_BUFFER_MAX (4U * 1024U * 1024U)
+
+static int server_dispatch_forward_socket(sd_event_source *es, int fd, uint32_t revents, void *userdata) {
+        Server *s = ASSERT_PTR(userdata);
+
+        assert(fd == s->forward_socket_fd);
+
+        server_flush_forward_socket(s);
+        return 0;
+}
+
+static void server_close_forward_socket(Server *s) {
+        assert(s);
+
+        s->forward_socket_event_source = sd_event_source_disable_unref(s->forward_socket_event_source);
+        s->forward_socket_fd = safe_close(s->forward_socket_fd);
+
+        /* Whatever is still buffered was meant for this connection, a new one starts from scratch. Part of
+         * the first record might have been sent already, hence this is approximate. */
+        s->statistics.n_forward_socket_dropped += s->forward_socket_n_records;
+        s->forward_socket_buffer_size = 0;
+        s->forward_socket_n_records = 0;
+}
+
 static int server_open_forward_socket(Server *s) {
         _cleanup_close_ int socket_fd = -EBADF;
         const SocketAddress *addr;
-        int family;
+        int family, r;
 
         assert(s);
 
@@ -42,6 +71,11 @@ static int server_open_forward_socket(Server *s) {
         if (connect(socket_fd, &addr->sockaddr.sa, addr->size) < 0)
                 return log_debug_errno(errno, "Failed to connect to remote address for forwarding, ignoring: %m");
 
+        /* Never wait for the peer, buffer records instead, see below */
+        r = fd_nonblock(socket_fd, true);
+        if (r < 0)
+                return log_debug_errno(r, "Failed to make forward socket non-blocking, ignoring: %m");
+
         s->forward_socket_fd = TAKE_FD(socket_fd);
         log_debug("Successfully connected to remote address for forwarding.");
         return 1;
@@ -66,6 +100,65 @@ static inline bool must_serialize(struct iovec iov) {
         return false;
 }
 
+static void* append(void *p, const void *q, size_t l) {
+        return mempcpy_safe(p, q, l);
+}
+
+void server_flush_forward_socket(Server *s) {
+        int r;
+
+        assert(s);
+
+        if (s->forward_socket_fd < 0 || s->forward_socket_buffer_size == 0)
+                return;
+
+        while (s->forward_socket_buffer_size > 0) {
+                ssize_t n;
+
+                n = write(s->forward_socket_fd, s->forward_socket_buffer, s->forward_socket_buffer_size);
+                if (n < 0) {
+                        if (errno == EINTR)
+                                continue;
+                        if (errno == EAGAIN)
+                                break;
+
+                        log_debug_errno(errno, "Failed to forward log messages over socket: %m");
+
+                        /* If we failed to send once we will probably fail again so wait for a new
+                         * connection to establish before attempting to forward again. */
+                        server_close_forward_socket(s);
+                        return;
+                }
+
+                memmove(s->forward_socket_buffer, s->forward_socket_buffer + n, s->forward_socket_buffer_size - n);
+                s->forward_socket_buffer_size -= n;
+        }
+
+        if (s->forward_socket_buffer_size == 0) {
+                s->forward_socket_n_records = 0;
+
+                if (s->forward_socket_event_source)
+                        (void) sd_event_source_set_enabled(s->forward_socket_event_source, SD_EVENT_OFF);
+                return;
+        }
+
+        /* The peer is slow, continue once it can take more */
+        if (!s->event)
+                return;
+
+        if (!s->forward_socket_event_source) {
+                r = sd_event_add_io(s->event, &s->forward_socket_event_source, s->forward_socket_fd, EPOLLOUT,
+                                    server_dispatch_forward_socket, s);
+                if (r < 0) {
+                        log_debug_errno(r, "Failed to watch forward socket, ignoring: %m");
+                        return;
+                }
+
+                (void) sd_event_source_set_description(s->forward_socket_event_source, "forward-socket");
+        } else
+                (void) sd_event_source_set_enabled(s->forward_socket_event_source, SD_EVENT_ON);
+}
+
 int server_forward_socket(
                 Server *s,
                 const struct iovec *iovec,
@@ -73,10 +166,10 @@ int server_forward_socket(
                 const dual_timestamp *ts,
                 int priority) {
 
-        _cleanup_free_ struct iovec *iov_alloc = NULL;
-        struct iovec *iov;
-        _cleanup_free_ le64_t *len_alloc = NULL;
-        le64_t *len;
+        char realtime_buf[STRLEN("__REALTIME_TIMESTAMP=") + DECIMAL_STR_MAX(usec_t) + 1],
+             monotonic_buf[STRLEN("__MONOTONIC_TIMESTAMP=") + DECIMAL_STR_MAX(usec_t) + 2];
+        size_t size;
+        char *p;
         int r;
 
         assert(s);
@@ -91,32 +184,37 @@ int server_forward_socket(
         if (r <= 0)
                 return r;
 
-        /* We need a newline after each iovec + 4 for each we have to serialize in a binary safe way
-         * + 2 for the final __REALTIME_TIMESTAMP and __MONOTONIC_TIMESTAMP metadata fields. */
-        size_t n = n_iovec * 5 + 2;
-
-        if (n < ALLOCA_MAX / (sizeof(struct iovec) + sizeof(le64_t)) / 2) {
-                iov = newa(struct iovec, n);
-                len = newa(le64_t, n_iovec);
-        } else {
-                iov_alloc = new(struct iovec, n);
-                if (!iov_alloc)
-                        return log_oom();
+        /* Synthesise __REALTIME_TIMESTAMP and __MONOTONIC_TIMESTAMP as the last arguments so
+         * systemd-journal-upload can receive these export messages. */
+        xsprintf(realtime_buf, "__REALTIME_TIMESTAMP="USEC_FMT"\n", ts->realtime);
+        xsprintf(monotonic_buf, "__MONOTONIC_TIMESTAMP="USEC_FMT"\n\n", ts->monotonic);
 
-                iov = iov_alloc;
+        /* Serialize the record into the buffer, rather than sending it right away, so that the records of a
+         * burst go out with a single write(). At most, we need a newline after each field, plus, for fields
+         * that need binary safe serialisation, a newline after the field name and the length of the
+         * value. */
+        size = iovec_total_size(iovec, n_iovec) + n_iovec * (2 + sizeof(le64_t)) +
+                strlen(realtime_buf) + strlen(monotonic_buf);
+
+        if (s->forward_socket_buffer_size + size > FORWARD_SOCKET_BUFFER_MAX) {
+                /* The peer does not keep up, see if it did meanwhile, otherwise drop the record */
+                server_flush_forward_socket(s);
+                if (s->forward_socket_buffer_size + size > FORWARD_SOCKET_BUFFER_MAX) {
+                        s->statistics.n_forward_socket_dropped++;
+                        return 0;
+                }
+        }
 
-                len_alloc = new(le64_t, n_iovec);
-                if (!len_alloc)
-                        return log_oom();
+        if (!GREEDY_REALLOC(s->forward_socket_buffer, s->forward_socket_buffer_size + size))
+                return log_oom();
 
-                len = len_alloc;
-        }
+        p = s->forward_socket_buffer + s->forward_socket_buffer_size;
 
-        struct iovec nl = IOVEC_MAKE_STRING("\n");
-        size_t iov_idx = 0, len_idx = 0;
         FOREACH_ARRAY(i, iovec, n_iovec) {
                 if (must_serialize(*i)) {
                         const uint8_t *c;
+                        le64_t len;
+
                         c = memchr(i->iov_base, '=', i->iov_len);
 
                         /* this should never happen */
@@ -125,39 +223,33 @@ int server_forward_socket(
                                                          "Found invalid journal field, refusing to forward.");
 
                         /* write the field name */
-                        iov[iov_idx++] = IOVEC_MAKE(i->iov_base, c - (uint8_t*) i->iov_base);
-                        iov[iov_idx++] = nl;
+                        p = append(p, i->iov_base, c - (uint8_t*) i->iov_base);
+                        *(p++) = '\n';
 
                         /* write the length of the value */
-                        len[len_idx] = htole64(i->iov_len - (c - (uint8_t*) i->iov_base) - 1);
-                        iov[iov_idx++] = IOVEC_MAKE(&len[len_idx++], sizeof(le64_t));
+                        len = htole64(i->iov_len - (c - (uint8_t*) i->iov_base) - 1);
+                        p = append(p, &len, sizeof(len));
 
                         /* write the raw binary value */
-                        iov[iov_idx++] = IOVEC_MAKE(c + 1, i->iov_len - (c - (uint8_t*) i->iov_base) - 1);
+                        p = append(p, c + 1, i->iov_len - (c - (uint8_t*) i->iov_base) - 1);
                 } else
                         /* if it doesn't need special treatment just write the value out */
-                        iov[iov_idx++] = *i;
+                        p = append(p, i->iov_base, i->iov_len);
 
-                iov[iov_idx++] = nl;
+                *(p++) = '\n';
         }
 
-        /* Synthesise __REALTIME_TIMESTAMP and __MONOTONIC_TIMESTAMP as the last arguments so
-         * systemd-journal-upload can receive these export messages. */
-        char realtime_buf[STRLEN("__REALTIME_TIMESTAMP=") + DECIMAL_STR_MAX(usec_t) + 1];
-        xsprintf(realtime_buf, "__REALTIME_TIMESTAMP="USEC_FMT"\n", ts->realtime);
-        iov[iov_idx++] = IOVEC_MAKE_STRING(realtime_buf);
+        p = stpcpy(p, realtime_buf);
+        p = stpcpy(p, monotonic_buf);
 
-        char monotonic_buf[STRLEN("__MONOTONIC_TIMESTAMP=") + DECIMAL_STR_MAX(usec_t) + 2];
-        xsprintf(monotonic_buf, "__MONOTONIC_TIMESTAMP="USEC_FMT"\n\n", ts->monotonic);
-        iov[iov_idx++] = IOVEC_MAKE_STRING(monotonic_buf);
+        size = p - (s->forward_socket_buffer + s->forward_socket_buffer_size);
+        s->forward_socket_buffer_size += size;
+        s->forward_socket_n_records++;
 
-        if (writev(s->forward_socket_fd, iov, iov_idx) < 0) {
-                log_debug_errno(errno, "Failed to forward log message over socket: %m");
-
-                /* If we failed to send once we will probably fail again so wait for a new connection to
-                 * establish before attempting to forward again. */
-                s->forward_socket_fd = safe_close(s->forward_socket_fd);
-        }
+        if (s->forward_socket_buffer_size >= FORWARD_SOCKET_FLUSH_BYTES)
+                server_flush_forward_socket(s);
+        else
+                server_schedule_forward(s);
 
         return 0;
 }
@@ -5,3 +5,4 @@
 #include "socket-util.h"
 
 int server_forward_socket(Server *s, const struct iovec *iovec, size_t n, const dual_timestamp *ts, int priority);
+void server_flush_forward_socket(Server *s);
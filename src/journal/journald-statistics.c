@@ -0,0 +1,55 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include "journald-statistics.h"
+#include "string-table.h"
+
+int latency_histogram_build_json(const LatencyHistogram *h, sd_json_variant **ret) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        int r;
+
+        assert(h);
+        assert(ret);
+
+        /* Empty buckets are left out, the upper bound of a bucket is exclusive. The last bucket has no upper
+         * bound. */
+        for (unsigned i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+                if (h->buckets[i] == 0)
+                        continue;
+
+                r = sd_json_variant_append_arraybo(
+                                &v,
+                                SD_JSON_BUILD_PAIR_CONDITION(i < LATENCY_HISTOGRAM_BUCKETS - 1,
+                                                             "upperBoundUSec", SD_JSON_BUILD_UNSIGNED(UINT64_C(1) << i)),
+                                SD_JSON_BUILD_PAIR_UNSIGNED("count", h->buckets[i]));
+                if (r < 0)
+                        return r;
+        }
+
+        if (!v) {
+                r = sd_json_variant_new_array(&v, NULL, 0);
+                if (r < 0)
+                        return r;
+        }
+
+        *ret = TAKE_PTR(v);
+        return 0;
+}
+
+static const char* const server_transport_table[_SERVER_TRANSPORT_MAX] = {
+        [SERVER_TRANSPORT_JOURNAL] = "journal",
+        [SERVER_TRANSPORT_SYSLOG]  = "syslog",
+        [SERVER_TRANSPORT_STDOUT]  = "stdout",
+        [SERVER_TRANSPORT_KERNEL]  = "kernel",
+        [SERVER_TRANSPORT_AUDIT]   = "audit",
+        [SERVER_TRANSPORT_DRIVER]  = "driver",
+};
+
+DEFINE_STRING_TABLE_LOOKUP_TO_STRING(server_transport, ServerTransport);
+
+static const char* const server_journal_type_table[_SERVER_JOURNAL_TYPE_MAX] = {
+        [SERVER_JOURNAL_SYSTEM]  = "system",
+        [SERVER_JOURNAL_RUNTIME] = "runtime",
+        [SERVER_JOURNAL_USER]    = "user",
+};
+
+DEFINE_STRING_TABLE_LOOKUP_TO_STRING(server_journal_type, ServerJournalType);
@@ -0,0 +1,73 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+#pragma once
+
+#include <errno.h>
+#include <inttypes.h>
+
+#include "sd-json.h"
+
+#include "logarithm.h"
+#include "macro.h"
+#include "time-util.h"
+
+/* Counters and latency histograms of the ingestion path. These are updated for every message, hence they
+ * are plain counters, and the histograms have power-of-two buckets. */
+
+typedef enum ServerTransport {
+        SERVER_TRANSPORT_JOURNAL,
+        SERVER_TRANSPORT_SYSLOG,
+        SERVER_TRANSPORT_STDOUT,
+        SERVER_TRANSPORT_KERNEL,
+        SERVER_TRANSPORT_AUDIT,
+        SERVER_TRANSPORT_DRIVER,
+        _SERVER_TRANSPORT_MAX,
+        _SERVER_TRANSPORT_INVALID = -EINVAL,
+} ServerTransport;
+
+typedef enum ServerJournalType {
+        SERVER_JOURNAL_SYSTEM,
+        SERVER_JOURNAL_RUNTIME,
+        SERVER_JOURNAL_USER,
+        _SERVER_JOURNAL_TYPE_MAX,
+        _SERVER_JOURNAL_TYPE_INVALID = -EINVAL,
+} ServerJournalType;
+
+/* Bucket i counts latencies of less than 2^i µs, that did not fit into the bucket before. The last bucket
+ * counts everything else. */
+#define LATENCY_HISTOGRAM_BUCKETS 24U
+
+typedef struct LatencyHistogram {
+        uint64_t n;
+        usec_t total;
+        uint64_t buckets[LATENCY_HISTOGRAM_BUCKETS];
+} LatencyHistogram;
+
+static inline void latency_histogram_add(LatencyHistogram *h, usec_t t) {
+        h->n++;
+        h->total += t;
+        h->buckets[MIN(t == 0 ? 0 : log2u64(t) + 1, LATENCY_HISTOGRAM_BUCKETS - 1)]++;
+}
+
+int latency_histogram_build_json(const LatencyHistogram *h, sd_json_variant **ret);
+
+typedef struct ServerStatistics {
+        /* Messages received per transport, before any filtering */
+        uint64_t n_received[_SERVER_TRANSPORT_MAX];
+        /* Messages dropped because of MaxLevelStore= or rate limiting */
+        uint64_t n_filtered;
+        uint64_t n_ratelimited;
+        /* Times the kernel overwrote records in /dev/kmsg before we read them */
+        uint64_t n_kmsg_overruns;
+        /* Messages that could not be forwarded because the receiver did not keep up */
+        uint64_t n_forward_socket_dropped;
+        uint64_t n_forward_syslog_dropped;
+        /* Messages passed on to be written to a journal file, and the size of their fields */
+        uint64_t n_stored;
+        uint64_t n_bytes_stored;
+
+        /* Updated by the writer thread, too, hence protected by the append lock */
+        LatencyHistogram append_latency[_SERVER_JOURNAL_TYPE_MAX];
+} ServerStatistics;
+
+const char* server_transport_to_string(ServerTransport t) _const_;
+const char* server_journal_type_to_string(ServerJournalType t) _const_;
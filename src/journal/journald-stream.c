@@ -48,6 +48,10 @@
  * let's enforce a line length matching the maximum unit name length (255) */
 #define STDOUT_STREAM_SETUP_PROTOCOL_LINE_MAX (UNIT_NAME_MAX-1U)
 
+/* Streams that fill the whole buffer on every read are considered busy, and are read in chunks of this size
+ * rather than of the line size, to save on syscalls and event loop iterations */
+#define STDOUT_STREAM_BUSY_READ_MAX (128U*1024U)
+
 typedef enum StdoutStreamState {
         STDOUT_STREAM_IDENTIFIER,
         STDOUT_STREAM_UNIT_ID,
@@ -90,10 +94,13 @@ struct StdoutStream {
 
         bool fdstore:1;
         bool in_notify_queue:1;
+        bool busy:1;
 
         char *buffer;
         size_t length;
 
+        char *syslog_identifier_field;
+
         sd_event_source *event_source;
 
         char *state_file;
@@ -128,6 +135,7 @@ StdoutStream* stdout_stream_free(StdoutStream *s) {
         safe_close(s->fd);
         free(s->label);
         free(s->identifier);
+        free(s->syslog_identifier_field);
         free(s->unit_id);
         free(s->state_file);
         free(s->buffer);
@@ -248,19 +256,22 @@ fail:
 
 static int stdout_stream_log(
                 StdoutStream *s,
-                const char *p,
+                char *p,
+                size_t l,
                 LineBreak line_break) {
 
         struct iovec *iovec;
         int priority;
         char syslog_priority[] = "PRIORITY=\0";
         char syslog_facility[STRLEN("SYSLOG_FACILITY=") + DECIMAL_STR_MAX(int) + 1];
-        _cleanup_free_ char *message = NULL, *syslog_identifier = NULL;
+        _cleanup_free_ char *message = NULL;
         size_t n = 0, m;
         int r;
 
         assert(s);
         assert(p);
+        assert(p >= s->buffer && p + l < s->buffer + MALLOC_ELEMENTSOF(s->buffer));
+        assert(p[l] == 0);
 
         assert(line_break >= 0);
         assert(line_break < _LINE_BREAK_MAX);
@@ -276,16 +287,21 @@ static int stdout_stream_log(
 
         priority = s->priority;
 
-        if (s->level_prefix)
-                syslog_parse_priority(&p, &priority, false);
+        if (s->level_prefix) {
+                const char *q = p;
+
+                syslog_parse_priority(&q, &priority, false);
+                l -= q - p;
+                p += q - p;
+        }
 
         if (!client_context_test_priority(s->context, priority))
                 return 0;
 
-        if (isempty(p))
+        if (l == 0)
                 return 0;
 
-        r = client_context_check_keep_log(s->context, p, strlen(p));
+        r = client_context_check_keep_log(s->context, p, l);
         if (r <= 0)
                 return r;
 
@@ -316,9 +332,10 @@ static int stdout_stream_log(
         }
 
         if (s->identifier) {
-                syslog_identifier = strjoin("SYSLOG_IDENTIFIER=", s->identifier);
-                if (syslog_identifier)
-                        iovec[n++] = IOVEC_MAKE_STRING(syslog_identifier);
+                if (!s->syslog_identifier_field)
+                        s->syslog_identifier_field = strjoin("SYSLOG_IDENTIFIER=", s->identifier);
+                if (s->syslog_identifier_field)
+                        iovec[n++] = IOVEC_MAKE_STRING(s->syslog_identifier_field);
         }
 
         static const char * const line_break_field_table[_LINE_BREAK_MAX] = {
@@ -336,10 +353,18 @@ static int stdout_stream_log(
         if (c)
                 iovec[n++] = IOVEC_MAKE_STRING(c);
 
-        message = strjoin("MESSAGE=", p);
-        if (message)
-                iovec[n++] = IOVEC_MAKE_STRING(message);
+        if (p >= s->buffer + STRLEN("MESSAGE=")) {
+                /* Avoid copying the line: put the field name right in front of it in the buffer. Whatever is
+                 * there belongs to lines we are done with already, or to the priority prefix of this one. */
+                memcpy(p - STRLEN("MESSAGE="), "MESSAGE=", STRLEN("MESSAGE="));
+                iovec[n++] = IOVEC_MAKE(p - STRLEN("MESSAGE="), STRLEN("MESSAGE=") + l);
+        } else {
+                message = strjoin("MESSAGE=", p);
+                if (message)
+                        iovec[n++] = IOVEC_MAKE_STRING(message);
+        }
 
+        s->server->statistics.n_received[SERVER_TRANSPORT_STDOUT]++;
         server_dispatch_message(s->server, iovec, n, m, s->context, NULL, priority, 0);
         return 0;
 }
@@ -360,14 +385,22 @@ static int syslog_parse_priority_and_facility(const char *s) {
         return prio;
 }
 
-static int stdout_stream_line(StdoutStream *s, char *p, LineBreak line_break) {
-        char *orig;
+static int stdout_stream_line(StdoutStream *s, char *p, size_t l, LineBreak line_break) {
         int r;
 
         assert(s);
         assert(p);
 
-        orig = p;
+        if (s->state == STDOUT_STREAM_RUNNING) {
+                /* Log lines keep their leading whitespace, and only lose the trailing one. We know the
+                 * length already, hence no need to scan for it again. */
+                while (l > 0 && IN_SET(p[l-1], ' ', '\t', '\n', '\r'))
+                        l--;
+                p[l] = 0;
+
+                return stdout_stream_log(s, p, l, line_break);
+        }
+
         p = strstrip(p);
 
         /* line breaks by NUL, line max length or EOF are not permissible during the negotiation part of the protocol */
@@ -456,7 +489,7 @@ static int stdout_stream_line(StdoutStream *s, char *p, LineBreak line_break) {
                 return 0;
 
         case STDOUT_STREAM_RUNNING:
-                return stdout_stream_log(s, orig, line_break);
+                break; /* handled above */
         }
 
         assert_not_reached();
@@ -477,7 +510,7 @@ static int stdout_stream_found(
         /* Let's NUL terminate the specified buffer for this call, and revert back afterwards */
         saved = p[l];
         p[l] = 0;
-        r = stdout_stream_line(s, p, line_break);
+        r = stdout_stream_line(s, p, l, line_break);
         p[l] = saved;
 
         return r;
@@ -503,29 +536,34 @@ static int stdout_stream_scan(
                 size_t *ret_consumed) {
 
         size_t consumed = 0;
+        char *nul;
         int r;
 
         assert(s);
         assert(p);
 
+        /* NUL terminators are rare, hence look for the next one once rather than for every line. Knowing where
+         * it is bounds the search for a newline, so every byte is looked at once by each memchr(). */
+        nul = memchr(p, 0, remaining);
 
         for (;;) {
                 LineBreak line_break;
                 size_t skip, found;
-                char *end1, *end2;
+                char *end1;
                 size_t tmp_remaining, line_max;
 
                 line_max = stdout_stream_line_max(s);
                 tmp_remaining = MIN(remaining, line_max);
 
-                end1 = memchr(p, '\n', tmp_remaining);
-                end2 = memchr(p, 0, end1 ? (size_t) (end1 - p) : tmp_remaining);
+                end1 = memchr(p, '\n', nul ? MIN(tmp_remaining, (size_t) (nul - p)) : tmp_remaining);
 
-                if (end2) {
+                if (!end1 && nul && (size_t) (nul - p) < tmp_remaining) {
                         /* We found a NUL terminator */
-                        found = end2 - p;
+                        found = nul - p;
                         skip = found + 1;
                         line_break = LINE_BREAK_NUL;
+
+                        nul = memchr(nul + 1, 0, remaining - skip);
                 } else if (end1) {
                         /* We found a \n terminator */
                         found = end1 - p;
@@ -583,10 +621,16 @@ static int stdout_stream_process(sd_event_source *es, int fd, uint32_t revents,
                 goto terminate;
         }
 
-        /* If the buffer is almost full, add room for another 1K */
+        /* Never read more than the configured line size, unless the stream is busy, see below */
+        limit = MAX(s->server->line_max, STDOUT_STREAM_SETUP_PROTOCOL_LINE_MAX);
+        if (s->busy)
+                limit = MAX(limit, (size_t) STDOUT_STREAM_BUSY_READ_MAX);
+
+        /* If the buffer is almost full, add room for another 1K, or right away for a full read if the stream is
+         * busy */
         allocated = MALLOC_ELEMENTSOF(s->buffer);
-        if (s->length + 512 >= allocated) {
-                if (!GREEDY_REALLOC(s->buffer, s->length + 1 + 1024)) {
+        if (s->length + 512 >= allocated || (s->busy && allocated <= limit)) {
+                if (!GREEDY_REALLOC(s->buffer, s->busy ? limit + 1 : s->length + 1 + 1024)) {
                         log_oom();
                         goto terminate;
                 }
@@ -594,9 +638,9 @@ static int stdout_stream_process(sd_event_source *es, int fd, uint32_t revents,
                 allocated = MALLOC_ELEMENTSOF(s->buffer);
         }
 
-        /* Try to make use of the allocated buffer in full, but never read more than the configured line size. Also,
-         * always leave room for a terminating NUL we might need to add. */
-        limit = MIN(allocated - 1, MAX(s->server->line_max, STDOUT_STREAM_SETUP_PROTOCOL_LINE_MAX));
+        /* Try to make use of the allocated buffer in full, but always leave room for a terminating NUL we might
+         * need to add. */
+        limit = MIN(allocated - 1, limit);
         assert(s->length <= limit);
         iovec = IOVEC_MAKE(s->buffer + s->length, limit - s->length);
 
@@ -610,6 +654,22 @@ static int stdout_stream_process(sd_event_source *es, int fd, uint32_t revents,
         }
         cmsg_close_all(&msghdr);
 
+        /* A read that fills the buffer means more data is likely waiting, hence switch to larger reads. Once
+         * reads only fill a small part of the buffer again, switch back, and give the memory back. */
+        if ((size_t) l == iovec.iov_len)
+                s->busy = true;
+        else if (s->busy && (size_t) l < iovec.iov_len / 8) {
+                s->busy = false;
+
+                if (s->length + (size_t) l + 1 + 1024 < allocated / 2) {
+                        char *b;
+
+                        b = realloc(s->buffer, s->length + (size_t) l + 1 + 1024);
+                        if (b)
+                                s->buffer = b;
+                }
+        }
+
         if (l == 0) {
                 (void) stdout_stream_scan(s, s->buffer, s->length, /* force_flush = */ LINE_BREAK_EOF, NULL);
                 goto terminate;
@@ -0,0 +1,280 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "alloc-util.h"
+#include "fd-util.h"
+#include "journald-sync.h"
+#include "log.h"
+#include "sort-util.h"
+
+typedef struct SyncRequest {
+        dev_t dev;
+        ino_t ino;
+        int fd;
+        usec_t requested;
+        usec_t latency;
+} SyncRequest;
+
+struct JournalSyncer {
+        pthread_t thread;
+        bool thread_started;
+
+        /* Protects everything below, 'cond' is broadcast whenever any of it changes. */
+        pthread_mutex_t mutex;
+        pthread_cond_t cond;
+
+        /* Requests that are not picked up by the syncer thread yet, at most one per file */
+        SyncRequest *pending;
+        size_t n_pending;
+
+        bool busy;
+        bool stop;
+
+        uint64_t n_requests;
+        uint64_t n_coalesced;
+        uint64_t n_syncs;
+        uint64_t n_failed;
+        uint64_t n_passes;
+
+        usec_t latencies[JOURNAL_SYNCER_LATENCY_SAMPLES];
+};
+
+static void sync_requests_free(SyncRequest *requests, size_t n) {
+        FOREACH_ARRAY(r, requests, n)
+                safe_close(r->fd);
+
+        free(requests);
+}
+
+static void* journal_syncer_thread(void *userdata) {
+        JournalSyncer *s = ASSERT_PTR(userdata);
+
+        (void) pthread_setname_np(pthread_self(), "journal-sync");
+
+        assert_se(pthread_mutex_lock(&s->mutex) == 0);
+
+        for (;;) {
+                SyncRequest *batch;
+                size_t n;
+
+                while (!s->stop && s->n_pending == 0)
+                        assert_se(pthread_cond_wait(&s->cond, &s->mutex) == 0);
+
+                /* Pending requests are dealt with before the syncer is stopped. */
+                if (s->stop && s->n_pending == 0)
+                        break;
+
+                /* Take all pending requests at once. Whatever is requested while we sync these is collected
+                 * for the next pass. */
+                batch = TAKE_PTR(s->pending);
+                n = s->n_pending;
+                s->n_pending = 0;
+
+                s->busy = true;
+                assert_se(pthread_cond_broadcast(&s->cond) == 0);
+                assert_se(pthread_mutex_unlock(&s->mutex) == 0);
+
+                FOREACH_ARRAY(r, batch, n) {
+                        /* The writeback was kicked off by the requester already, hence this is mostly
+                         * waiting for it to complete, and for the metadata to be written. */
+                        if (fdatasync(r->fd) < 0) {
+                                log_debug_errno(errno, "Failed to sync journal file, ignoring: %m");
+                                r->latency = USEC_INFINITY;
+                        } else
+                                r->latency = usec_sub_unsigned(now(CLOCK_MONOTONIC), r->requested);
+
+                        r->fd = safe_close(r->fd);
+                }
+
+                assert_se(pthread_mutex_lock(&s->mutex) == 0);
+
+                FOREACH_ARRAY(r, batch, n) {
+                        if (r->latency == USEC_INFINITY) {
+                                s->n_failed++;
+                                continue;
+                        }
+
+                        s->latencies[s->n_syncs % JOURNAL_SYNCER_LATENCY_SAMPLES] = r->latency;
+                        s->n_syncs++;
+                }
+
+                s->n_passes++;
+                free(batch);
+
+                s->busy = false;
+                assert_se(pthread_cond_broadcast(&s->cond) == 0);
+        }
+
+        assert_se(pthread_mutex_unlock(&s->mutex) == 0);
+        return NULL;
+}
+
+int journal_syncer_new(JournalSyncer **ret) {
+        _cleanup_(journal_syncer_freep) JournalSyncer *s = NULL;
+        sigset_t ss, saved_ss;
+        int r, k;
+
+        assert(ret);
+
+        s = new(JournalSyncer, 1);
+        if (!s)
+                return -ENOMEM;
+
+        *s = (JournalSyncer) {
+                .mutex = PTHREAD_MUTEX_INITIALIZER,
+                .cond = PTHREAD_COND_INITIALIZER,
+        };
+
+        assert_se(sigfillset(&ss) >= 0);
+        /* Don't block SIGBUS, like the other threads of ours. */
+        assert_se(sigdelset(&ss, SIGBUS) >= 0);
+
+        r = pthread_sigmask(SIG_BLOCK, &ss, &saved_ss);
+        if (r > 0)
+                return -r;
+
+        r = pthread_create(&s->thread, NULL, journal_syncer_thread, s);
+
+        k = pthread_sigmask(SIG_SETMASK, &saved_ss, NULL);
+        if (r > 0)
+                return -r;
+
+        s->thread_started = true;
+
+        if (k > 0)
+                return -k;
+
+        *ret = TAKE_PTR(s);
+        return 0;
+}
+
+JournalSyncer* journal_syncer_free(JournalSyncer *s) {
+        if (!s)
+                return NULL;
+
+        if (s->thread_started) {
+                assert_se(pthread_mutex_lock(&s->mutex) == 0);
+                s->stop = true;
+                assert_se(pthread_cond_broadcast(&s->cond) == 0);
+                assert_se(pthread_mutex_unlock(&s->mutex) == 0);
+
+                assert_se(pthread_join(s->thread, NULL) == 0);
+        }
+
+        sync_requests_free(s->pending, s->n_pending);
+
+        assert_se(pthread_mutex_destroy(&s->mutex) == 0);
+        assert_se(pthread_cond_destroy(&s->cond) == 0);
+
+        return mfree(s);
+}
+
+int journal_syncer_request(JournalSyncer *s, int fd) {
+        struct stat st;
+        int copy, r = 0;
+
+        assert(s);
+        assert(fd >= 0);
+
+        if (fstat(fd, &st) < 0)
+                return -errno;
+
+        assert_se(pthread_mutex_lock(&s->mutex) == 0);
+
+        s->n_requests++;
+
+        /* If the file is pending already, the sync that is going to happen covers this request too. Note
+         * that this is not the case if the file is being synced right now, as the data we were asked about
+         * might have been written after the sync started. */
+        FOREACH_ARRAY(p, s->pending, s->n_pending)
+                if (p->dev == st.st_dev && p->ino == st.st_ino) {
+                        s->n_coalesced++;
+                        goto finish;
+                }
+
+        if (!GREEDY_REALLOC(s->pending, s->n_pending + 1)) {
+                r = -ENOMEM;
+                goto finish;
+        }
+
+        /* The file might be closed by the main thread (because it is rotated, say) before we get to it, hence
+         * keep our own reference. */
+        copy = fcntl(fd, F_DUPFD_CLOEXEC, 3);
+        if (copy < 0) {
+                r = -errno;
+                goto finish;
+        }
+
+        s->pending[s->n_pending++] = (SyncRequest) {
+                .dev = st.st_dev,
+                .ino = st.st_ino,
+                .fd = copy,
+                .requested = now(CLOCK_MONOTONIC),
+        };
+
+        assert_se(pthread_cond_broadcast(&s->cond) == 0);
+
+finish:
+        assert_se(pthread_mutex_unlock(&s->mutex) == 0);
+        return r;
+}
+
+void journal_syncer_drain(JournalSyncer *s) {
+        assert(s);
+
+        assert_se(pthread_mutex_lock(&s->mutex) == 0);
+
+        while (s->n_pending > 0 || s->busy)
+                assert_se(pthread_cond_wait(&s->cond, &s->mutex) == 0);
+
+        assert_se(pthread_mutex_unlock(&s->mutex) == 0);
+}
+
+static int usec_compare(const usec_t *a, const usec_t *b) {
+        return CMP(*a, *b);
+}
+
+static usec_t percentile(const usec_t *sorted, size_t n, unsigned p) {
+        assert(sorted || n == 0);
+        assert(p <= 100);
+
+        if (n == 0)
+                return 0;
+
+        return sorted[(n - 1) * p / 100];
+}
+
+void journal_syncer_get_stats(JournalSyncer *s, JournalSyncerStats *ret) {
+        usec_t latencies[JOURNAL_SYNCER_LATENCY_SAMPLES];
+        size_t n;
+
+        assert(s);
+        assert(ret);
+
+        assert_se(pthread_mutex_lock(&s->mutex) == 0);
+
+        *ret = (JournalSyncerStats) {
+                .n_requests = s->n_requests,
+                .n_coalesced = s->n_coalesced,
+                .n_syncs = s->n_syncs,
+                .n_failed = s->n_failed,
+                .n_passes = s->n_passes,
+        };
+
+        n = MIN(s->n_syncs, (uint64_t) JOURNAL_SYNCER_LATENCY_SAMPLES);
+        memcpy(latencies, s->latencies, n * sizeof(usec_t));
+
+        assert_se(pthread_mutex_unlock(&s->mutex) == 0);
+
+        typesafe_qsort(latencies, n, usec_compare);
+
+        ret->latency_p50 = percentile(latencies, n, 50);
+        ret->latency_p90 = percentile(latencies, n, 90);
+        ret->latency_p99 = percentile(latencies, n, 99);
+        ret->latency_max = percentile(latencies, n, 100);
+}
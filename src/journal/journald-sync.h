@@ -0,0 +1,40 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+#pragma once
+
+#include <inttypes.h>
+
+#include "macro.h"
+#include "time-util.h"
+
+/* A thread that makes journal files durable in the background, so that the main thread never waits for the
+ * disk when a message of high priority shall be synced right away. Requests for a file that come in while a
+ * sync is already under way are coalesced into a single follow-up sync, hence the rate of syncs adapts to
+ * how fast the storage is, rather than to the rate of requests. */
+
+/* The number of sync latencies kept for calculating percentiles */
+#define JOURNAL_SYNCER_LATENCY_SAMPLES 1024U
+
+typedef struct JournalSyncer JournalSyncer;
+
+typedef struct JournalSyncerStats {
+        uint64_t n_requests;
+        uint64_t n_coalesced;
+        uint64_t n_syncs;
+        uint64_t n_failed;
+        uint64_t n_passes;
+
+        /* Time from the (first) request until the file was synced, over the most recent syncs */
+        usec_t latency_p50;
+        usec_t latency_p90;
+        usec_t latency_p99;
+        usec_t latency_max;
+} JournalSyncerStats;
+
+int journal_syncer_new(JournalSyncer **ret);
+JournalSyncer* journal_syncer_free(JournalSyncer *s);
+DEFINE_TRIVIAL_CLEANUP_FUNC(JournalSyncer*, journal_syncer_free);
+
+int journal_syncer_request(JournalSyncer *s, int fd);
+void journal_syncer_drain(JournalSyncer *s);
+
+void journal_syncer_get_stats(JournalSyncer *s, JournalSyncerStats *ret);
@@ -27,86 +27,199 @@
 /* Warn once every 30s if we missed syslog message */
 #define WARN_FORWARD_SYSLOG_MISSED_USEC (30 * USEC_PER_SEC)
 
-static void forward_syslog_iovec(
-                Server *s,
-                const struct iovec *iovec,
-                unsigned n_iovec,
-                const struct ucred *ucred,
-                const struct timeval *tv) {
-
-        union sockaddr_union sa;
+/* Forwarded messages are sent with a single sendmmsg() once this many are queued, or this much data */
+#define FORWARD_SYSLOG_BATCH_MAX 64U
+#define FORWARD_SYSLOG_BATCH_BYTES (128U * 1024U)
+
+struct SyslogForwardBatch {
+        union sockaddr_union address;
+        socklen_t address_length;
+
+        size_t n_messages;
+        struct mmsghdr messages[FORWARD_SYSLOG_BATCH_MAX];
+        struct iovec iovecs[FORWARD_SYSLOG_BATCH_MAX];
+        CMSG_BUFFER_TYPE(CMSG_SPACE(sizeof(struct ucred))) controls[FORWARD_SYSLOG_BATCH_MAX];
+        bool has_ucred[FORWARD_SYSLOG_BATCH_MAX];
+
+        /* The messages, one after the other. The buffer might move while messages are added, hence the
+         * iovecs are only set up when the batch is sent. */
+        char *buffer;
+        size_t offsets[FORWARD_SYSLOG_BATCH_MAX];
+        size_t size;
+};
+
+SyslogForwardBatch* syslog_forward_batch_free(SyslogForwardBatch *b) {
+        if (!b)
+                return NULL;
+
+        free(b->buffer);
+        return mfree(b);
+}
 
-        struct msghdr msghdr = {
-                .msg_iov = (struct iovec *) iovec,
-                .msg_iovlen = n_iovec,
-        };
-        struct cmsghdr *cmsg;
-        CMSG_BUFFER_TYPE(CMSG_SPACE(sizeof(struct ucred))) control;
+static int syslog_forward_batch_new(Server *s, SyslogForwardBatch **ret) {
+        _cleanup_(syslog_forward_batch_freep) SyslogForwardBatch *b = NULL;
         const char *j;
         int r;
 
         assert(s);
-        assert(iovec);
-        assert(n_iovec > 0);
+        assert(ret);
+
+        b = new0(SyslogForwardBatch, 1);
+        if (!b)
+                return -ENOMEM;
 
         j = strjoina(s->runtime_directory, "/syslog");
-        r = sockaddr_un_set_path(&sa.un, j);
-        if (r < 0) {
-                log_debug_errno(r, "Forwarding socket path %s too long for AF_UNIX, not forwarding: %m", j);
+        r = sockaddr_un_set_path(&b->address.un, j);
+        if (r < 0)
+                return log_debug_errno(r, "Forwarding socket path %s too long for AF_UNIX, not forwarding: %m", j);
+
+        b->address_length = r;
+
+        *ret = TAKE_PTR(b);
+        return 0;
+}
+
+static void syslog_forward_batch_set_pid(SyslogForwardBatch *b, size_t i, pid_t pid) {
+        struct cmsghdr *cmsg;
+        struct ucred u;
+
+        assert(b);
+        assert(i < b->n_messages);
+        assert(b->has_ucred[i]);
+
+        cmsg = CMSG_FIRSTHDR(&b->messages[i].msg_hdr);
+        memcpy(&u, CMSG_DATA(cmsg), sizeof(struct ucred));
+        u.pid = pid;
+        memcpy(CMSG_DATA(cmsg), &u, sizeof(struct ucred));
+}
+
+void server_flush_forward_syslog(Server *s) {
+        SyslogForwardBatch *b;
+        bool fixed = false;
+        size_t i = 0;
+
+        assert(s);
+
+        b = s->forward_syslog_batch;
+        if (!b || b->n_messages == 0)
                 return;
-        }
 
-        msghdr.msg_name = &sa.sa;
-        msghdr.msg_namelen = r;
+        for (size_t k = 0; k < b->n_messages; k++) {
+                size_t end = k + 1 < b->n_messages ? b->offsets[k + 1] : b->size;
 
-        if (ucred) {
-                zero(control);
-                msghdr.msg_control = &control;
-                msghdr.msg_controllen = sizeof(control);
+                b->iovecs[k] = IOVEC_MAKE(b->buffer + b->offsets[k], end - b->offsets[k]);
 
-                cmsg = CMSG_FIRSTHDR(&msghdr);
-                cmsg->cmsg_level = SOL_SOCKET;
-                cmsg->cmsg_type = SCM_CREDENTIALS;
-                cmsg->cmsg_len = CMSG_LEN(sizeof(struct ucred));
-                memcpy(CMSG_DATA(cmsg), ucred, sizeof(struct ucred));
-                msghdr.msg_controllen = cmsg->cmsg_len;
+                b->messages[k].msg_hdr = (struct msghdr) {
+                        .msg_name = &b->address.sa,
+                        .msg_namelen = b->address_length,
+                        .msg_iov = b->iovecs + k,
+                        .msg_iovlen = 1,
+                };
+
+                if (b->has_ucred[k]) {
+                        b->messages[k].msg_hdr.msg_control = b->controls + k;
+                        b->messages[k].msg_hdr.msg_controllen = CMSG_LEN(sizeof(struct ucred));
+                }
         }
 
-        /* Forward the syslog message we received via /dev/log to /run/systemd/syslog. Unfortunately we
+        /* Forward the syslog messages we received via /dev/log to /run/systemd/syslog. Unfortunately we
          * currently can't set the SO_TIMESTAMP auxiliary data, and hence we don't. */
 
-        if (sendmsg(s->syslog_fd, &msghdr, MSG_NOSIGNAL) >= 0)
-                return;
+        while (i < b->n_messages) {
+                int n;
 
-        /* The socket is full? I guess the syslog implementation is
-         * too slow, and we shouldn't wait for that... */
-        if (errno == EAGAIN) {
-                s->n_forward_syslog_missed++;
-                return;
+                n = sendmmsg(s->syslog_fd, b->messages + i, b->n_messages - i, MSG_NOSIGNAL);
+                if (n > 0) {
+                        i += n;
+                        fixed = false;
+                        continue;
+                }
+
+                /* The socket is full? I guess the syslog implementation is too slow, and we shouldn't wait
+                 * for that... */
+                if (errno == EAGAIN) {
+                        s->n_forward_syslog_missed += b->n_messages - i;
+                        s->statistics.n_forward_syslog_dropped += b->n_messages - i;
+                        break;
+                }
+
+                if (!fixed && b->has_ucred[i] && IN_SET(errno, ESRCH, EPERM)) {
+                        /* Hmm, presumably the sender process vanished by now, or we don't have
+                         * CAP_SYS_AMDIN, so let's fix it as good as we can, and retry */
+                        syslog_forward_batch_set_pid(b, i, getpid_cached());
+                        fixed = true;
+                        continue;
+                }
+
+                /* Nobody listening, no point in trying the others */
+                if (errno == ENOENT)
+                        break;
+
+                log_debug_errno(errno, "Failed to forward syslog message: %m");
+                i++;
+                fixed = false;
         }
 
-        if (ucred && IN_SET(errno, ESRCH, EPERM)) {
-                struct ucred u;
+        b->n_messages = 0;
+        b->size = 0;
+}
 
-                /* Hmm, presumably the sender process vanished
-                 * by now, or we don't have CAP_SYS_AMDIN, so
-                 * let's fix it as good as we can, and retry */
+static void forward_syslog_iovec(
+                Server *s,
+                const struct iovec *iovec,
+                unsigned n_iovec,
+                const struct ucred *ucred,
+                const struct timeval *tv) {
 
-                u = *ucred;
-                u.pid = getpid_cached();
-                memcpy(CMSG_DATA(cmsg), &u, sizeof(struct ucred));
+        SyslogForwardBatch *b;
+        size_t size, k;
+        char *p;
 
-                if (sendmsg(s->syslog_fd, &msghdr, MSG_NOSIGNAL) >= 0)
-                        return;
+        assert(s);
+        assert(iovec);
+        assert(n_iovec > 0);
 
-                if (errno == EAGAIN) {
-                        s->n_forward_syslog_missed++;
-                        return;
-                }
+        /* The message is queued and sent along with the others received in the same go */
+
+        if (!s->forward_syslog_batch && syslog_forward_batch_new(s, &s->forward_syslog_batch) < 0)
+                return;
+
+        b = s->forward_syslog_batch;
+
+        size = iovec_total_size(iovec, n_iovec);
+        if (!GREEDY_REALLOC(b->buffer, b->size + size)) {
+                log_oom_debug();
+                return;
         }
 
-        if (errno != ENOENT)
-                log_debug_errno(errno, "Failed to forward syslog message: %m");
+        k = b->n_messages++;
+        b->offsets[k] = b->size;
+
+        p = b->buffer + b->size;
+        for (unsigned i = 0; i < n_iovec; i++)
+                p = mempcpy_safe(p, iovec[i].iov_base, iovec[i].iov_len);
+        b->size += size;
+
+        b->has_ucred[k] = ucred;
+        if (ucred) {
+                struct msghdr mh = {
+                        .msg_control = b->controls + k,
+                        .msg_controllen = sizeof(b->controls[k]),
+                };
+                struct cmsghdr *cmsg;
+
+                zero(b->controls[k]);
+                cmsg = CMSG_FIRSTHDR(&mh);
+                cmsg->cmsg_level = SOL_SOCKET;
+                cmsg->cmsg_type = SCM_CREDENTIALS;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(struct ucred));
+                memcpy(CMSG_DATA(cmsg), ucred, sizeof(struct ucred));
+        }
+
+        if (b->n_messages >= FORWARD_SYSLOG_BATCH_MAX || b->size >= FORWARD_SYSLOG_BATCH_BYTES)
+                server_flush_forward_syslog(s);
+        else
+                server_schedule_forward(s);
 }
 
 static void forward_syslog_raw(Server *s, int priority, const char *buffer, size_t buffer_len, const struct ucred *ucred, const struct timeval *tv) {
@@ -453,6 +566,7 @@ void server_process_syslog_message(
                 iovec[n++] = IOVEC_MAKE(msg_raw, hlen + raw_len);
         }
 
+        s->statistics.n_received[SERVER_TRANSPORT_SYSLOG]++;
         server_dispatch_message(s, iovec, n, m, context, tv, priority, 0);
 }
 
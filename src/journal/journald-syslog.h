@@ -13,3 +13,7 @@ void server_process_syslog_message(Server *s, const char *buf, size_t buf_len, c
 int server_open_syslog_socket(Server *s, const char *syslog_socket);
 
 void server_maybe_warn_forward_syslog_missed(Server *s);
+void server_flush_forward_syslog(Server *s);
+
+SyslogForwardBatch* syslog_forward_batch_free(SyslogForwardBatch *b);
+DEFINE_TRIVIAL_CLEANUP_FUNC(SyslogForwardBatch*, syslog_forward_batch_free);
@@ -0,0 +1,425 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <pthread.h>
+#include <signal.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "alloc-util.h"
+#include "fd-util.h"
+#include "io-util.h"
+#include "iovec-util.h"
+#include "journald-writer.h"
+#include "log.h"
+#include "memory-util.h"
+
+/* The writer thread takes up to this many entries at once, so that the main thread is not held up for long
+ * when the queue is full. */
+#define JOURNAL_WRITER_BATCH_MAX 64U
+
+struct JournalWriter {
+        char *name;
+
+        pthread_t thread;
+        bool thread_started;
+
+        /* Protects everything below, 'cond' is broadcast whenever any of it changes. */
+        pthread_mutex_t mutex;
+        pthread_cond_t cond;
+
+        LIST_HEAD(JournalWriterEntry, queue);
+        JournalWriterEntry *queue_tail;
+        size_t n_queued;
+        size_t queue_size;
+        uint64_t n_bytes_queued;
+
+        /* Entries handed back to the main thread, owned by the writer thread's current batch. */
+        JournalWriterEntry **stalled;
+        size_t n_stalled;
+
+        unsigned n_paused;
+        bool busy;
+        bool processing;
+        bool stop;
+
+        size_t n_queued_max;
+        uint64_t n_written;
+        uint64_t n_stalled_total;
+        uint64_t n_blocked;
+
+        int notify_fd;
+
+        journal_writer_write_t write;
+        journal_writer_write_stalled_t write_stalled;
+        void *userdata;
+};
+
+JournalWriterEntry* journal_writer_entry_new(
+                uid_t uid,
+                const struct iovec *iovec,
+                size_t n_iovec,
+                const dual_timestamp *ts,
+                int priority) {
+
+        JournalWriterEntry *e;
+        size_t size;
+        uint8_t *p;
+
+        assert(iovec || n_iovec == 0);
+        assert(ts);
+
+        /* The iovecs are copied, along with the data they point to, into a single allocation. The data
+         * usually lives on the stack of the main thread, or in its buffers. */
+        size = iovec_total_size(iovec, n_iovec);
+
+        e = malloc(offsetof(JournalWriterEntry, iovec) + n_iovec * sizeof(struct iovec) + size);
+        if (!e)
+                return NULL;
+
+        *e = (JournalWriterEntry) {
+                .uid = uid,
+                .priority = priority,
+                .ts = *ts,
+                .size = size,
+                .n_iovec = n_iovec,
+        };
+
+        p = (uint8_t*) (e->iovec + n_iovec);
+        for (size_t i = 0; i < n_iovec; i++) {
+                e->iovec[i] = IOVEC_MAKE(p, iovec[i].iov_len);
+                p = mempcpy_safe(p, iovec[i].iov_base, iovec[i].iov_len);
+        }
+
+        return e;
+}
+
+static void* journal_writer_thread(void *userdata) {
+        JournalWriter *w = ASSERT_PTR(userdata);
+        JournalWriterEntry *batch[JOURNAL_WRITER_BATCH_MAX];
+
+        (void) pthread_setname_np(pthread_self(), w->name);
+
+        assert_se(pthread_mutex_lock(&w->mutex) == 0);
+
+        for (;;) {
+                size_t n = 0, k;
+
+                while (!w->stop && (w->n_queued == 0 || w->n_paused > 0))
+                        assert_se(pthread_cond_wait(&w->cond, &w->mutex) == 0);
+
+                /* The queue is drained before the writer is stopped. */
+                if (w->stop && w->n_queued == 0)
+                        break;
+
+                while (n < JOURNAL_WRITER_BATCH_MAX && w->queue) {
+                        JournalWriterEntry *e = LIST_POP(queue, w->queue);
+
+                        assert(w->n_queued > 0);
+                        assert(w->n_bytes_queued >= e->size);
+                        w->n_queued--;
+                        w->n_bytes_queued -= e->size;
+
+                        batch[n++] = e;
+                }
+                if (!w->queue)
+                        w->queue_tail = NULL;
+
+                w->busy = true;
+                assert_se(pthread_cond_broadcast(&w->cond) == 0);
+                assert_se(pthread_mutex_unlock(&w->mutex) == 0);
+
+                k = w->write(w, batch, n, w->userdata);
+                assert(k <= n);
+
+                for (size_t i = 0; i < k; i++)
+                        free(batch[i]);
+
+                assert_se(pthread_mutex_lock(&w->mutex) == 0);
+
+                w->n_written += k;
+
+                if (k < n) {
+                        /* Let the main thread deal with the rest of the batch, and wait until it did. */
+                        w->stalled = batch + k;
+                        w->n_stalled = n - k;
+                        w->n_stalled_total += n - k;
+
+                        /* Wake up the main thread, both if it waits for us already, and if it is in its
+                         * event loop. */
+                        assert_se(pthread_cond_broadcast(&w->cond) == 0);
+                        journal_writer_notify(w);
+
+                        while (w->n_stalled > 0)
+                                assert_se(pthread_cond_wait(&w->cond, &w->mutex) == 0);
+
+                        w->stalled = NULL;
+                }
+
+                w->busy = false;
+                assert_se(pthread_cond_broadcast(&w->cond) == 0);
+        }
+
+        assert_se(pthread_mutex_unlock(&w->mutex) == 0);
+        return NULL;
+}
+
+int journal_writer_new(
+                const char *name,
+                size_t queue_size,
+                journal_writer_write_t write_func,
+                journal_writer_write_stalled_t write_stalled_func,
+                void *userdata,
+                JournalWriter **ret) {
+
+        _cleanup_(journal_writer_freep) JournalWriter *w = NULL;
+        sigset_t ss, saved_ss;
+        int r, k;
+
+        assert(name);
+        assert(queue_size > 0);
+        assert(write_func);
+        assert(write_stalled_func);
+        assert(ret);
+
+        w = new(JournalWriter, 1);
+        if (!w)
+                return -ENOMEM;
+
+        *w = (JournalWriter) {
+                .mutex = PTHREAD_MUTEX_INITIALIZER,
+                .cond = PTHREAD_COND_INITIALIZER,
+                .queue_size = queue_size,
+                .notify_fd = -EBADF,
+                .write = write_func,
+                .write_stalled = write_stalled_func,
+                .userdata = userdata,
+        };
+
+        /* Thread names are limited to 15 characters */
+        w->name = strndup(name, 15);
+        if (!w->name)
+                return -ENOMEM;
+
+        w->notify_fd = eventfd(0, EFD_CLOEXEC|EFD_NONBLOCK);
+        if (w->notify_fd < 0)
+                return -errno;
+
+        assert_se(sigfillset(&ss) >= 0);
+        /* Don't block SIGBUS since the writer thread accesses memory mapped files. */
+        assert_se(sigdelset(&ss, SIGBUS) >= 0);
+
+        r = pthread_sigmask(SIG_BLOCK, &ss, &saved_ss);
+        if (r > 0)
+                return -r;
+
+        r = pthread_create(&w->thread, NULL, journal_writer_thread, w);
+
+        k = pthread_sigmask(SIG_SETMASK, &saved_ss, NULL);
+        if (r > 0)
+                return -r;
+
+        w->thread_started = true;
+
+        if (k > 0)
+                return -k;
+
+        *ret = TAKE_PTR(w);
+        return 0;
+}
+
+JournalWriter* journal_writer_free(JournalWriter *w) {
+        if (!w)
+                return NULL;
+
+        if (w->thread_started) {
+                assert(w->n_paused == 0);
+
+                journal_writer_drain(w);
+
+                assert_se(pthread_mutex_lock(&w->mutex) == 0);
+                w->stop = true;
+                assert_se(pthread_cond_broadcast(&w->cond) == 0);
+                assert_se(pthread_mutex_unlock(&w->mutex) == 0);
+
+                assert_se(pthread_join(w->thread, NULL) == 0);
+        }
+
+        LIST_CLEAR(queue, w->queue, free);
+
+        assert_se(pthread_mutex_destroy(&w->mutex) == 0);
+        assert_se(pthread_cond_destroy(&w->cond) == 0);
+
+        safe_close(w->notify_fd);
+        free(w->name);
+        return mfree(w);
+}
+
+const char* journal_writer_get_name(JournalWriter *w) {
+        assert(w);
+
+        return w->name;
+}
+
+int journal_writer_get_fd(JournalWriter *w) {
+        assert(w);
+
+        return w->notify_fd;
+}
+
+void journal_writer_notify(JournalWriter *w) {
+        static const uint64_t one = 1;
+
+        assert(w);
+
+        /* Wakes up the main thread, may be called from any thread. */
+        if (write(w->notify_fd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+                log_debug_errno(errno, "Failed to notify main thread about writer %s, ignoring: %m", w->name);
+}
+
+static void journal_writer_process_stalled_locked(JournalWriter *w) {
+        assert(w);
+
+        if (w->n_stalled == 0 || w->processing)
+                return;
+
+        /* The writer thread waits for us, hence the stalled entries can be accessed without holding the
+         * mutex. The handler may enqueue further entries, e.g. driver messages, hence do not hold it. */
+        w->processing = true;
+        assert_se(pthread_mutex_unlock(&w->mutex) == 0);
+
+        for (size_t i = 0; i < w->n_stalled; i++) {
+                w->write_stalled(w, w->stalled[i], w->userdata);
+                w->stalled[i] = mfree(w->stalled[i]);
+        }
+
+        assert_se(pthread_mutex_lock(&w->mutex) == 0);
+        w->processing = false;
+        w->n_stalled = 0;
+        assert_se(pthread_cond_broadcast(&w->cond) == 0);
+}
+
+void journal_writer_process(JournalWriter *w) {
+        assert(w);
+
+        (void) flush_fd(w->notify_fd);
+
+        assert_se(pthread_mutex_lock(&w->mutex) == 0);
+        journal_writer_process_stalled_locked(w);
+        assert_se(pthread_mutex_unlock(&w->mutex) == 0);
+}
+
+static bool journal_writer_full(JournalWriter *w, const JournalWriterEntry *e) {
+        assert(w);
+        assert(e);
+
+        /* A single entry larger than the byte limit is accepted if the queue is empty. */
+        return w->n_queued >= w->queue_size ||
+                (w->n_queued > 0 && w->n_bytes_queued + e->size > JOURNAL_WRITER_QUEUE_BYTES_MAX);
+}
+
+void journal_writer_enqueue(JournalWriter *w, JournalWriterEntry *e) {
+        bool blocked = false;
+
+        assert(w);
+        assert(e);
+
+        assert_se(pthread_mutex_lock(&w->mutex) == 0);
+
+        /* If the queue is full, wait for the writer thread to catch up. This is what pushes back on the
+         * clients, as we stop reading from their sockets meanwhile. However, while the writer is paused, or
+         * waiting for us to deal with stalled entries, it cannot catch up, hence let the queue grow then. */
+        while (!w->n_paused && !w->processing && journal_writer_full(w, e)) {
+                if (w->n_stalled > 0) {
+                        journal_writer_process_stalled_locked(w);
+                        continue;
+                }
+
+                if (!blocked) {
+                        w->n_blocked++;
+                        blocked = true;
+                }
+
+                assert_se(pthread_cond_wait(&w->cond, &w->mutex) == 0);
+        }
+
+        LIST_INSERT_AFTER(queue, w->queue, w->queue_tail, e);
+        w->queue_tail = e;
+        w->n_queued++;
+        w->n_bytes_queued += e->size;
+        w->n_queued_max = MAX(w->n_queued_max, w->n_queued);
+
+        assert_se(pthread_cond_broadcast(&w->cond) == 0);
+        assert_se(pthread_mutex_unlock(&w->mutex) == 0);
+}
+
+void journal_writer_drain(JournalWriter *w) {
+        assert(w);
+
+        /* Waits until everything queued so far has been written. */
+
+        assert_se(pthread_mutex_lock(&w->mutex) == 0);
+
+        assert(w->n_paused == 0);
+
+        while (w->n_queued > 0 || w->busy) {
+                /* Called from a stalled handler? Then we cannot wait for the writer thread. */
+                if (w->processing)
+                        break;
+
+                if (w->n_stalled > 0) {
+                        journal_writer_process_stalled_locked(w);
+                        continue;
+                }
+
+                assert_se(pthread_cond_wait(&w->cond, &w->mutex) == 0);
+        }
+
+        assert_se(pthread_mutex_unlock(&w->mutex) == 0);
+}
+
+void journal_writer_pause(JournalWriter *w) {
+        assert(w);
+
+        /* Waits until the writer thread does not access any journal files anymore, and keeps it from
+         * doing so until journal_writer_resume() is called. Entries may still be enqueued meanwhile. */
+
+        assert_se(pthread_mutex_lock(&w->mutex) == 0);
+
+        w->n_paused++;
+
+        while (w->busy && w->n_stalled == 0)
+                assert_se(pthread_cond_wait(&w->cond, &w->mutex) == 0);
+
+        assert_se(pthread_mutex_unlock(&w->mutex) == 0);
+}
+
+void journal_writer_resume(JournalWriter *w) {
+        assert(w);
+
+        assert_se(pthread_mutex_lock(&w->mutex) == 0);
+
+        assert(w->n_paused > 0);
+        w->n_paused--;
+
+        assert_se(pthread_cond_broadcast(&w->cond) == 0);
+        assert_se(pthread_mutex_unlock(&w->mutex) == 0);
+}
+
+void journal_writer_get_stats(JournalWriter *w, JournalWriterStats *ret) {
+        assert(w);
+        assert(ret);
+
+        assert_se(pthread_mutex_lock(&w->mutex) == 0);
+
+        *ret = (JournalWriterStats) {
+                .n_queued = w->n_queued,
+                .n_queued_max = w->n_queued_max,
+                .queue_size = w->queue_size,
+                .n_bytes_queued = w->n_bytes_queued,
+                .n_written = w->n_written,
+                .n_stalled = w->n_stalled_total,
+                .n_blocked = w->n_blocked,
+        };
+
+        assert_se(pthread_mutex_unlock(&w->mutex) == 0);
+}
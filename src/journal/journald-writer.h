@@ -0,0 +1,77 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+#pragma once
+
+#include <inttypes.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include "list.h"
+#include "macro.h"
+#include "time-util.h"
+
+/* A writer thread with a bounded queue of entries in front of it. Entries are enqueued by the main thread
+ * and written in order by the writer thread. Entries the writer thread cannot deal with itself (because
+ * a journal file needs to be opened or rotated, say) are handed back to the main thread, which writes them
+ * while the writer thread waits, so that the order of entries is kept. */
+
+#define JOURNAL_WRITER_QUEUE_SIZE_DEFAULT 4096U
+#define JOURNAL_WRITER_QUEUE_BYTES_MAX (64U * 1024U * 1024U)
+
+typedef struct JournalWriter JournalWriter;
+typedef struct JournalWriterEntry JournalWriterEntry;
+
+struct JournalWriterEntry {
+        LIST_FIELDS(JournalWriterEntry, queue);
+
+        uid_t uid;
+        int priority;
+        dual_timestamp ts;
+
+        size_t size;
+        size_t n_iovec;
+        struct iovec iovec[];
+};
+
+JournalWriterEntry* journal_writer_entry_new(
+                uid_t uid,
+                const struct iovec *iovec,
+                size_t n_iovec,
+                const dual_timestamp *ts,
+                int priority);
+
+/* Called in the writer thread. Returns the number of entries that were dealt with, the remaining ones are
+ * passed to the stalled handler in the main thread, one by one. */
+typedef size_t (*journal_writer_write_t)(JournalWriter *w, JournalWriterEntry *const *entries, size_t n_entries, void *userdata);
+typedef void (*journal_writer_write_stalled_t)(JournalWriter *w, JournalWriterEntry *entry, void *userdata);
+
+typedef struct JournalWriterStats {
+        size_t n_queued;
+        size_t n_queued_max;
+        size_t queue_size;
+        uint64_t n_bytes_queued;
+        uint64_t n_written;
+        uint64_t n_stalled;
+        uint64_t n_blocked;
+} JournalWriterStats;
+
+int journal_writer_new(
+                const char *name,
+                size_t queue_size,
+                journal_writer_write_t write_func,
+                journal_writer_write_stalled_t write_stalled_func,
+                void *userdata,
+                JournalWriter **ret);
+JournalWriter* journal_writer_free(JournalWriter *w);
+DEFINE_TRIVIAL_CLEANUP_FUNC(JournalWriter*, journal_writer_free);
+
+const char* journal_writer_get_name(JournalWriter *w);
+int journal_writer_get_fd(JournalWriter *w);
+void journal_writer_notify(JournalWriter *w);
+void journal_writer_process(JournalWriter *w);
+
+void journal_writer_enqueue(JournalWriter *w, JournalWriterEntry *e);
+void journal_writer_drain(JournalWriter *w);
+void journal_writer_pause(JournalWriter *w);
+void journal_writer_resume(JournalWriter *w);
+
+void journal_writer_get_stats(JournalWriter *w, JournalWriterStats *ret);
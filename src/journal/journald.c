@@ -5,6 +5,7 @@
 #include "sd-daemon.h"
 #include "sd-messages.h"
 
+#include "fdset.h"
 #include "format-util.h"
 #include "journal-authenticate.h"
 #include "journald-kmsg.h"
@@ -13,17 +14,139 @@
 #include "main-func.h"
 #include "process-util.h"
 #include "sigbus.h"
+#include "strv.h"
 #include "terminal-util.h"
 
+static int setup_servers(char **namespaces, Server **ret) {
+        _cleanup_(server_freep) Server *primary = NULL;
+        _cleanup_fdset_free_ FDSet *fds = NULL;
+        int r;
+
+        assert(ret);
+
+        if (strv_length(namespaces) <= 1) {
+                r = server_new(&primary);
+                if (r < 0)
+                        return log_oom();
+
+                r = server_init(primary, namespaces ? empty_to_null(namespaces[0]) : NULL);
+                if (r < 0)
+                        return r;
+
+                *ret = TAKE_PTR(primary);
+                return 0;
+        }
+
+        /* Serve several namespaces from one process, with one server for each of them. The sockets of all
+         * of them are passed to us, and each server picks its own. */
+
+        r = fdset_new_listen_fds(&fds, /* unset= */ true);
+        if (r < 0)
+                return log_error_errno(r, "Failed to read listening file descriptors from environment: %m");
+
+        STRV_FOREACH(namespace, namespaces) {
+                _cleanup_(server_freep) Server *s = NULL;
+
+                if (isempty(*namespace))
+                        return log_error_errno(SYNTHETIC_ERRNO(EINVAL),
+                                               "The main journal cannot be served along with namespaces, refusing.");
+
+                r = server_new(&s);
+                if (r < 0)
+                        return log_oom();
+
+                /* The primary frees the others along with itself */
+                r = server_init_shared(s, primary, *namespace, fds);
+                if (!primary)
+                        primary = TAKE_PTR(s);
+                else
+                        TAKE_PTR(s);
+                if (r < 0)
+                        return r;
+        }
+
+        if (!fdset_isempty(fds))
+                log_warning("%u unknown file descriptors passed, closing.", fdset_size(fds));
+
+        *ret = TAKE_PTR(primary);
+        return 0;
+}
+
+static void server_start(Server *s) {
+        assert(s);
+
+        server_vacuum(s, /* verbose = */ false);
+        server_flush_to_var(s, /* require_flag_file = */ true);
+        server_flush_dev_kmsg(s);
+
+        if (s->namespace)
+                log_debug("systemd-journald running as PID "PID_FMT" for namespace '%s'.", getpid_cached(), s->namespace);
+        else
+                log_debug("systemd-journald running as PID "PID_FMT" for the system.", getpid_cached());
+
+        server_driver_message(s, 0,
+                              "MESSAGE_ID=" SD_MESSAGE_JOURNAL_START_STR,
+                              LOG_MESSAGE("Journal started"),
+                              NULL);
+
+        /* Make sure to send the usage message *after* flushing the
+         * journal so entries from the runtime journals are ordered
+         * before this message. See #4190 for some details. */
+        server_space_usage_message(s, NULL);
+}
+
+static void server_stop(Server *s) {
+        assert(s);
+
+        if (s->namespace)
+                log_debug("systemd-journald stopped as PID "PID_FMT" for namespace '%s'.", getpid_cached(), s->namespace);
+        else
+                log_debug("systemd-journald stopped as PID "PID_FMT" for the system.", getpid_cached());
+
+        server_driver_message(s, 0,
+                              "MESSAGE_ID=" SD_MESSAGE_JOURNAL_STOP_STR,
+                              LOG_MESSAGE("Journal stopped"),
+                              NULL);
+}
+
+static usec_t server_next_wakeup(Server *s, usec_t n) {
+        usec_t t;
+
+        assert(s);
+
+        if (s->max_retention_usec > 0 && s->oldest_file_usec > 0) {
+                /* Calculate when to rotate the next time */
+                t = usec_sub_unsigned(usec_add(s->oldest_file_usec, s->max_retention_usec), n);
+
+                /* The retention time is reached, so let's vacuum! */
+                if (t <= 0) {
+                        log_info("Retention time reached, rotating.");
+                        server_rotate(s);
+                        server_vacuum(s, /* verbose = */ false);
+                        return 0;
+                }
+        } else
+                t = USEC_INFINITY;
+
+#if HAVE_GCRYPT
+        if (s->system_journal) {
+                usec_t u;
+
+                if (journal_file_next_evolve_usec(s->system_journal, &u))
+                        t = MIN(t, usec_sub_unsigned(u, n));
+        }
+#endif
+
+        return t;
+}
+
 static int run(int argc, char *argv[]) {
         _cleanup_(server_freep) Server *s = NULL;
         const char *namespace;
         LogTarget log_target;
         int r;
 
-        if (argc > 2)
-                return log_error_errno(SYNTHETIC_ERRNO(EINVAL), "This program takes one or no arguments.");
-
+        /* Takes the namespace to serve, if any. With more than one, all of them are served by this process. */
         namespace = argc > 1 ? empty_to_null(argv[1]) : NULL;
 
         log_set_facility(LOG_SYSLOG);
@@ -48,35 +171,15 @@ static int run(int argc, char *argv[]) {
 
         sigbus_install();
 
-        r = server_new(&s);
-        if (r < 0)
-                return log_oom();
-
-        r = server_init(s, namespace);
+        r = setup_servers(strv_skip(argv, 1), &s);
         if (r < 0)
                 return r;
 
-        server_vacuum(s, /* verbose = */ false);
-        server_flush_to_var(s, /* require_flag_file = */ true);
-        server_flush_dev_kmsg(s);
-
-        if (s->namespace)
-                log_debug("systemd-journald running as PID "PID_FMT" for namespace '%s'.", getpid_cached(), s->namespace);
-        else
-                log_debug("systemd-journald running as PID "PID_FMT" for the system.", getpid_cached());
-
-        server_driver_message(s, 0,
-                              "MESSAGE_ID=" SD_MESSAGE_JOURNAL_START_STR,
-                              LOG_MESSAGE("Journal started"),
-                              NULL);
-
-        /* Make sure to send the usage message *after* flushing the
-         * journal so entries from the runtime journals are ordered
-         * before this message. See #4190 for some details. */
-        server_space_usage_message(s, NULL);
+        SERVER_FOREACH_SIBLING(i, s)
+                server_start(i);
 
         for (;;) {
-                usec_t t, n;
+                usec_t t = USEC_INFINITY, n;
 
                 r = sd_event_get_state(s->event);
                 if (r < 0)
@@ -88,46 +191,21 @@ static int run(int argc, char *argv[]) {
                 if (r < 0)
                         return log_error_errno(r, "Failed to get the current time: %m");
 
-                if (s->max_retention_usec > 0 && s->oldest_file_usec > 0) {
-                        /* Calculate when to rotate the next time */
-                        t = usec_sub_unsigned(usec_add(s->oldest_file_usec, s->max_retention_usec), n);
-
-                        /* The retention time is reached, so let's vacuum! */
-                        if (t <= 0) {
-                                log_info("Retention time reached, rotating.");
-                                server_rotate(s);
-                                server_vacuum(s, /* verbose = */ false);
-                                continue;
-                        }
-                } else
-                        t = USEC_INFINITY;
-
-#if HAVE_GCRYPT
-                if (s->system_journal) {
-                        usec_t u;
-
-                        if (journal_file_next_evolve_usec(s->system_journal, &u))
-                                t = MIN(t, usec_sub_unsigned(u, n));
-                }
-#endif
+                SERVER_FOREACH_SIBLING(i, s)
+                        t = MIN(t, server_next_wakeup(i, n));
 
                 r = sd_event_run(s->event, t);
                 if (r < 0)
                         return log_error_errno(r, "Failed to run event loop: %m");
 
-                server_maybe_append_tags(s);
-                server_maybe_warn_forward_syslog_missed(s);
+                SERVER_FOREACH_SIBLING(i, s) {
+                        server_maybe_append_tags(i);
+                        server_maybe_warn_forward_syslog_missed(i);
+                }
         }
 
-        if (s->namespace)
-                log_debug("systemd-journald stopped as PID "PID_FMT" for namespace '%s'.", getpid_cached(), s->namespace);
-        else
-                log_debug("systemd-journald stopped as PID "PID_FMT" for the system.", getpid_cached());
-
-        server_driver_message(s, 0,
-                              "MESSAGE_ID=" SD_MESSAGE_JOURNAL_STOP_STR,
-                              LOG_MESSAGE("Journal stopped"),
-                              NULL);
+        SERVER_FOREACH_SIBLING(i, s)
+                server_stop(i);
 
         return 0;
 }
@@ -0,0 +1,98 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <stdio.h>
+
+#include "sd-event.h"
+
+#include "alloc-util.h"
+#include "fileio.h"
+#include "journald-audit.h"
+#include "journald-server.h"
+#include "missing_audit.h"
+#include "parse-util.h"
+#include "strv.h"
+#include "tests.h"
+#include "time-util.h"
+
+/* Measures how fast we take apart audit records into journal fields. Invoke with the duration of each run
+ * in seconds, optionally followed by files with audit records to parse, e.g. the ones in
+ * test/fuzz/fuzz-journald-audit/. Nothing is written to disk. */
+
+static usec_t arg_duration;
+
+static const struct {
+        const char *label;
+        int type;
+        const char *data;
+} samples[] = {
+        { "syscall", AUDIT_SYSCALL,
+          "audit(1364481363.243:24287): arch=c000003e syscall=2 success=no exit=-13 a0=7fffd19c5592 a1=0 "
+          "a2=7fffd19c4b50 a3=a items=1 ppid=2686 pid=3538 auid=500 uid=500 gid=500 euid=500 suid=500 "
+          "fsuid=500 egid=500 sgid=500 fsgid=500 tty=pts0 ses=1 comm=\"cat\" exe=\"/bin/cat\" "
+          "subj=unconfined_u:unconfined_r:unconfined_t:s0-s0:c0.c1023 key=\"sshd_config\"" },
+        { "execve", AUDIT_EXECVE,
+          "audit(1364481363.243:24288): argc=4 a0=\"ls\" a1=\"-l\" a2=2F746D702F7769746820737061636573 "
+          "a3=\"/var/log\"" },
+        { "proctitle", AUDIT_PROCTITLE,
+          "audit(1364481363.243:24289): proctitle=2F7573722F62696E2F707974686F6E33002D73002F7573722F7362696E2F6669726577616C6C64" },
+        { "user", AUDIT_FIRST_USER_MSG,
+          "audit(1542398162.211:744): pid=7376 uid=1000 auid=1000 ses=6 "
+          "subj=unconfined_u:unconfined_r:unconfined_t:s0-s0:c0.c1023 msg='op=PAM:accounting "
+          "grantors=pam_unix,pam_localuser acct=\"vagrant\" exe=\"/usr/bin/sudo\" hostname=? addr=? "
+          "terminal=/dev/pts/1 res=success'" },
+};
+
+static void test_parse(Server *s, const char *label, int type, const char *data, size_t size) {
+        usec_t t, n_usec;
+        size_t n = 0;
+
+        t = now(CLOCK_MONOTONIC);
+
+        do {
+                for (unsigned i = 0; i < 1000; i++)
+                        process_audit_string(s, type, data, size);
+
+                n += 1000;
+                n_usec = usec_sub_unsigned(now(CLOCK_MONOTONIC), t);
+        } while (n_usec < arg_duration);
+
+        log_info("%s: %zu records (%zu bytes) in %s, %.2fµs per record, %.0f records/s",
+                 label, n, size, FORMAT_TIMESPAN(n_usec, 1), (double) n_usec / n,
+                 (double) n * USEC_PER_SEC / MAX(n_usec, 1u));
+}
+
+static void test_parse_file(Server *s, const char *path) {
+        _cleanup_free_ char *data = NULL;
+        size_t size;
+
+        assert_se(read_full_file(path, &data, &size) >= 0);
+        test_parse(s, path, AUDIT_USER, data, size);
+}
+
+int main(int argc, char *argv[]) {
+        _cleanup_(server_freep) Server *s = NULL;
+
+        test_setup_logging(LOG_INFO);
+
+        if (argc >= 2) {
+                unsigned x;
+
+                assert_se(safe_atou(argv[1], &x) >= 0);
+                arg_duration = x * USEC_PER_SEC;
+        } else
+                arg_duration = slow_tests_enabled() ?
+                        2 * USEC_PER_SEC : USEC_PER_SEC / 50;
+
+        assert_se(server_new(&s) >= 0);
+        s->storage = STORAGE_NONE;
+        s->ratelimit_interval = 0;
+        assert_se(sd_event_default(&s->event) >= 0);
+
+        FOREACH_ELEMENT(i, samples)
+                test_parse(s, i->label, i->type, i->data, strlen(i->data));
+
+        STRV_FOREACH(f, strv_skip(argv, 2))
+                test_parse_file(s, *f);
+
+        return 0;
+}
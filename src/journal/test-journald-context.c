@@ -0,0 +1,121 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <unistd.h>
+
+#include "journald-context.h"
+#include "journald-server.h"
+#include "process-util.h"
+#include "tests.h"
+
+TEST(cache_hit) {
+        _cleanup_(server_freep) Server *s = NULL;
+        ClientContext *c, *d;
+
+        ASSERT_OK(server_new(&s));
+
+        ASSERT_OK(client_context_get(s, getpid_cached(), NULL, NULL, 0, NULL, &c));
+        ASSERT_EQ(c->pid, getpid_cached());
+        ASSERT_EQ(s->client_context_cache->statistics.n_misses, UINT64_C(1));
+        ASSERT_EQ(s->client_context_cache->statistics.n_hits, UINT64_C(0));
+        ASSERT_GT(s->client_context_cache->size, sizeof(ClientContext));
+
+        /* The second lookup is answered from the cache */
+        ASSERT_OK(client_context_get(s, getpid_cached(), NULL, NULL, 0, NULL, &d));
+        ASSERT_TRUE(c == d);
+        ASSERT_EQ(s->client_context_cache->statistics.n_misses, UINT64_C(1));
+        ASSERT_EQ(s->client_context_cache->statistics.n_hits, UINT64_C(1));
+
+        client_context_flush_regular(s);
+        ASSERT_EQ(hashmap_size(s->client_context_cache->contexts), 0u);
+        ASSERT_EQ(s->client_context_cache->size, (size_t) 0);
+        ASSERT_EQ(s->client_context_cache->statistics.n_evictions, UINT64_C(1));
+}
+
+TEST(pinned) {
+        _cleanup_(server_freep) Server *s = NULL;
+        ClientContext *c;
+
+        ASSERT_OK(server_new(&s));
+
+        /* Pinned entries survive a flush, and are flushed as usual once released */
+        ASSERT_OK(client_context_acquire(s, getpid_cached(), NULL, NULL, 0, NULL, &c));
+        client_context_flush_regular(s);
+        ASSERT_EQ(hashmap_size(s->client_context_cache->contexts), 1u);
+
+        ASSERT_NULL(client_context_release(s, c));
+        client_context_flush_regular(s);
+        ASSERT_EQ(hashmap_size(s->client_context_cache->contexts), 0u);
+}
+
+TEST(unit_context_shared) {
+        _cleanup_(server_freep) Server *s = NULL;
+        _cleanup_(sigkill_waitp) pid_t pid = 0;
+        ClientContext *a, *b;
+        int r;
+
+        ASSERT_OK(server_new(&s));
+
+        r = safe_fork("(test-child)", FORK_DEATHSIG_SIGKILL|FORK_LOG, &pid);
+        ASSERT_OK(r);
+        if (r == 0)
+                freeze();
+
+        ASSERT_OK(client_context_acquire(s, getpid_cached(), NULL, NULL, 0, NULL, &a));
+        ASSERT_OK(client_context_acquire(s, pid, NULL, NULL, 0, NULL, &b));
+
+        /* Our child lives in our cgroup, hence the unit metadata is shared, if there is any */
+        ASSERT_TRUE(a->unit_context == b->unit_context);
+        if (a->unit_context) {
+                ASSERT_EQ(a->unit_context->n_ref, 2u);
+                ASSERT_EQ(s->client_context_cache->statistics.n_unit_refreshes, UINT64_C(1));
+                ASSERT_EQ(s->client_context_cache->statistics.n_unit_hits, UINT64_C(1));
+        }
+
+        ASSERT_NULL(client_context_release(s, a));
+        ASSERT_NULL(client_context_release(s, b));
+        client_context_flush_regular(s);
+        ASSERT_EQ(hashmap_size(s->client_context_cache->unit_contexts), 0u);
+}
+
+TEST(shared_cache) {
+        _cleanup_(server_freep) Server *a = NULL, *b = NULL;
+        ClientContext *c, *d;
+        usec_t interval;
+        unsigned burst;
+
+        ASSERT_OK(server_new(&a));
+        ASSERT_OK(server_new(&b));
+
+        /* Like the servers for two namespaces in the same process */
+        client_context_cache_unref(b->client_context_cache);
+        b->client_context_cache = client_context_cache_ref(a->client_context_cache);
+
+        ASSERT_OK(client_context_acquire(a, getpid_cached(), NULL, NULL, 0, NULL, &c));
+        ASSERT_OK(client_context_get(b, getpid_cached(), NULL, NULL, 0, NULL, &d));
+        ASSERT_TRUE(c == d);
+        ASSERT_EQ(b->client_context_cache->statistics.n_misses, UINT64_C(1));
+        ASSERT_EQ(b->client_context_cache->statistics.n_hits, UINT64_C(1));
+
+        /* The rate limit configured for each server applies, unless the unit overrides it */
+        a->ratelimit_interval = 10 * USEC_PER_SEC;
+        a->ratelimit_burst = 100;
+        b->ratelimit_interval = 20 * USEC_PER_SEC;
+        b->ratelimit_burst = 200;
+
+        if (c->log_ratelimit_interval == USEC_INFINITY) {
+                client_context_get_ratelimit(c, a, &interval, &burst);
+                ASSERT_EQ(interval, 10 * USEC_PER_SEC);
+                client_context_get_ratelimit(c, b, &interval, &burst);
+                ASSERT_EQ(interval, 20 * USEC_PER_SEC);
+        }
+        if (c->log_ratelimit_burst == UINT_MAX) {
+                client_context_get_ratelimit(c, a, &interval, &burst);
+                ASSERT_EQ(burst, 100u);
+                client_context_get_ratelimit(c, b, &interval, &burst);
+                ASSERT_EQ(burst, 200u);
+        }
+
+        ASSERT_NULL(client_context_release(a, c));
+}
+
+DEFINE_TEST_MAIN(LOG_DEBUG);
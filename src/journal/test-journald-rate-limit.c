@@ -1,10 +1,11 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
 #include "journald-rate-limit.h"
+#include "stdio-util.h"
 #include "tests.h"
 
 TEST(journal_ratelimit_test) {
-        _cleanup_ordered_hashmap_free_ OrderedHashmap *rl = NULL;
+        _cleanup_(journal_ratelimit_freep) JournalRateLimit *rl = NULL;
         int r;
 
         for (unsigned i = 0; i < 20; i++) {
@@ -37,4 +38,74 @@ TEST(journal_ratelimit_test) {
         assert_se(journal_ratelimit_test(&rl, "quux", USEC_PER_SEC, 10, LOG_DEBUG, 0) == 1);
 }
 
+TEST(journal_ratelimit_many) {
+        _cleanup_(journal_ratelimit_freep) JournalRateLimit *rl = NULL;
+        char id[STRLEN("unit-.service") + DECIMAL_STR_MAX(unsigned)];
+
+        /* Enough groups to grow the table a couple of times, all of which keep their state */
+        for (unsigned i = 0; i < 5000; i++) {
+                xsprintf(id, "unit-%u.service", i);
+                ASSERT_EQ(journal_ratelimit_test(&rl, id, USEC_PER_HOUR, 1, LOG_INFO, 0), 1);
+        }
+
+        ASSERT_EQ(journal_ratelimit_size(rl), 5000u);
+
+        for (unsigned i = 0; i < 5000; i++) {
+                xsprintf(id, "unit-%u.service", i);
+                ASSERT_EQ(journal_ratelimit_test(&rl, id, USEC_PER_HOUR, 1, LOG_INFO, 0), 0);
+        }
+
+        ASSERT_EQ(journal_ratelimit_size(rl), 5000u);
+}
+
+TEST(journal_ratelimit_expire) {
+        _cleanup_(journal_ratelimit_freep) JournalRateLimit *rl = NULL;
+        char id[STRLEN("unit-.service") + DECIMAL_STR_MAX(unsigned)];
+
+        for (unsigned i = 0; i < 1000; i++) {
+                xsprintf(id, "unit-%u.service", i);
+                ASSERT_EQ(journal_ratelimit_test(&rl, id, USEC_PER_MSEC, 10, LOG_INFO, 0), 1);
+        }
+
+        usleep_safe(10 * USEC_PER_MSEC);
+
+        /* Expired groups are dropped bit by bit as new groups are added */
+        for (unsigned i = 1000; i < 2000; i++) {
+                xsprintf(id, "unit-%u.service", i);
+                ASSERT_EQ(journal_ratelimit_test(&rl, id, USEC_PER_HOUR, 10, LOG_INFO, 0), 1);
+        }
+
+        ASSERT_LT(journal_ratelimit_size(rl), 2000u);
+        ASSERT_GE(journal_ratelimit_size(rl), 1000u);
+
+        for (unsigned i = 1000; i < 2000; i++) {
+                xsprintf(id, "unit-%u.service", i);
+                ASSERT_EQ(journal_ratelimit_test(&rl, id, USEC_PER_HOUR, 10, LOG_INFO, 0), 1);
+        }
+}
+
+TEST(journal_ratelimit_build_json) {
+        _cleanup_(journal_ratelimit_freep) JournalRateLimit *rl = NULL;
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        sd_json_variant *e;
+
+        ASSERT_OK(journal_ratelimit_build_json(rl, &v));
+        ASSERT_EQ(sd_json_variant_elements(v), 0u);
+        v = sd_json_variant_unref(v);
+
+        for (unsigned i = 0; i < 5; i++)
+                (void) journal_ratelimit_test(&rl, "foo.service", USEC_PER_HOUR, 2, LOG_INFO, 0);
+
+        /* Disabled rate limiting does not create a group */
+        ASSERT_EQ(journal_ratelimit_test(&rl, "bar.service", 0, 0, LOG_INFO, 0), 1);
+
+        ASSERT_OK(journal_ratelimit_build_json(rl, &v));
+        ASSERT_EQ(sd_json_variant_elements(v), 1u);
+
+        e = sd_json_variant_by_index(v, 0);
+        ASSERT_STREQ(sd_json_variant_string(sd_json_variant_by_key(e, "unit")), "foo.service");
+        ASSERT_EQ(sd_json_variant_unsigned(sd_json_variant_by_key(e, "suppressed")), UINT64_C(3));
+        ASSERT_EQ(sd_json_variant_unsigned(sd_json_variant_by_key(e, "suppressedPending")), UINT64_C(3));
+}
+
 DEFINE_TEST_MAIN(LOG_INFO);
@@ -0,0 +1,137 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "sd-event.h"
+
+#include "alloc-util.h"
+#include "fd-util.h"
+#include "io-util.h"
+#include "iovec-util.h"
+#include "journald-server.h"
+#include "journald-socket.h"
+#include "string-util.h"
+#include "tests.h"
+
+static void setup(Server **ret_server, int *ret_peer) {
+        _cleanup_(server_freep) Server *s = NULL;
+        int fds[2];
+
+        ASSERT_OK(server_new(&s));
+
+        ASSERT_OK_ERRNO(socketpair(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC|SOCK_NONBLOCK, 0, fds));
+
+        /* Pretend we are connected already */
+        s->forward_to_socket.sockaddr.sa.sa_family = AF_UNIX;
+        s->forward_socket_fd = fds[0];
+
+        *ret_server = TAKE_PTR(s);
+        *ret_peer = fds[1];
+}
+
+static void forward(Server *s, const char *message) {
+        struct iovec iovec[] = {
+                IOVEC_MAKE_STRING("PRIORITY=6"),
+                IOVEC_MAKE_STRING(message),
+        };
+        dual_timestamp ts = {
+                .realtime = 1000,
+                .monotonic = 2000,
+        };
+
+        ASSERT_OK(server_forward_socket(s, iovec, ELEMENTSOF(iovec), &ts, LOG_INFO));
+}
+
+TEST(serialize) {
+        _cleanup_(server_freep) Server *s = NULL;
+        _cleanup_close_ int peer = -EBADF;
+        char buf[256];
+        ssize_t n;
+
+        setup(&s, &peer);
+
+        /* No event loop, hence this is sent right away */
+        forward(s, "MESSAGE=foo\nbar");
+
+        static const char expected[] =
+                "PRIORITY=6\n"
+                "MESSAGE\n" "\x07\x00\x00\x00\x00\x00\x00\x00" "foo\nbar\n"
+                "__REALTIME_TIMESTAMP=1000\n"
+                "__MONOTONIC_TIMESTAMP=2000\n"
+                "\n";
+
+        n = read(peer, buf, sizeof(buf));
+        ASSERT_OK_ERRNO(n);
+        ASSERT_EQ((size_t) n, sizeof(expected) - 1);
+        ASSERT_EQ(memcmp(buf, expected, n), 0);
+        ASSERT_EQ(s->forward_socket_buffer_size, (size_t) 0);
+}
+
+TEST(batch) {
+        _cleanup_(server_freep) Server *s = NULL;
+        _cleanup_close_ int peer = -EBADF;
+        char buf[4096];
+        ssize_t n;
+
+        setup(&s, &peer);
+        ASSERT_OK(sd_event_default(&s->event));
+
+        for (unsigned i = 0; i < 10; i++)
+                forward(s, "MESSAGE=foo");
+
+        /* Nothing is sent before the event loop got to run */
+        ASSERT_EQ(read(peer, buf, sizeof(buf)), -1);
+        ASSERT_EQ(errno, EAGAIN);
+        ASSERT_EQ(s->forward_socket_n_records, UINT64_C(10));
+
+        ASSERT_GT(sd_event_run(s->event, 0), 0);
+
+        n = read(peer, buf, sizeof(buf));
+        ASSERT_OK_ERRNO(n);
+        ASSERT_EQ((size_t) n, 10 * strlen("PRIORITY=6\nMESSAGE=foo\n__REALTIME_TIMESTAMP=1000\n__MONOTONIC_TIMESTAMP=2000\n\n"));
+        ASSERT_EQ(s->forward_socket_buffer_size, (size_t) 0);
+        ASSERT_EQ(s->forward_socket_n_records, UINT64_C(0));
+}
+
+TEST(slow_peer) {
+        _cleanup_(server_freep) Server *s = NULL;
+        _cleanup_close_ int peer = -EBADF;
+        _cleanup_free_ char *message = NULL;
+        char buf[4096];
+        size_t total = 0;
+        ssize_t n;
+
+        setup(&s, &peer);
+        s->forward_latency_usec = 0;
+
+        ASSERT_NOT_NULL(message = strjoin("MESSAGE=", strrepa("x", 4096)));
+
+        /* Nobody reads on the other side, hence records are buffered, and eventually dropped, without ever
+         * blocking us */
+        while (s->statistics.n_forward_socket_dropped == 0)
+                forward(s, message);
+
+        ASSERT_GT(s->forward_socket_buffer_size, (size_t) 0);
+        ASSERT_GT(s->forward_socket_n_records, UINT64_C(0));
+
+        /* Once the peer is back, the rest is sent */
+        for (;;) {
+                n = read(peer, buf, sizeof(buf));
+                if (n < 0) {
+                        ASSERT_EQ(errno, EAGAIN);
+                        if (s->forward_socket_buffer_size == 0)
+                                break;
+
+                        server_flush_forward_socket(s);
+                        continue;
+                }
+
+                total += n;
+        }
+
+        ASSERT_GT(total, (size_t) 0);
+        ASSERT_EQ(s->forward_socket_n_records, UINT64_C(0));
+}
+
+DEFINE_TEST_MAIN(LOG_DEBUG);
@@ -0,0 +1,57 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include "journald-statistics.h"
+#include "tests.h"
+
+TEST(latency_histogram_add) {
+        LatencyHistogram h = {};
+
+        latency_histogram_add(&h, 0);
+        latency_histogram_add(&h, 1);
+        latency_histogram_add(&h, 2);
+        latency_histogram_add(&h, 3);
+        latency_histogram_add(&h, 4);
+        latency_histogram_add(&h, USEC_INFINITY - 1);
+
+        ASSERT_EQ(h.n, UINT64_C(6));
+        ASSERT_EQ(h.buckets[0], UINT64_C(1));
+        ASSERT_EQ(h.buckets[1], UINT64_C(1));
+        ASSERT_EQ(h.buckets[2], UINT64_C(2));
+        ASSERT_EQ(h.buckets[3], UINT64_C(1));
+        ASSERT_EQ(h.buckets[LATENCY_HISTOGRAM_BUCKETS - 1], UINT64_C(1));
+}
+
+TEST(latency_histogram_build_json) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        LatencyHistogram h = {};
+        sd_json_variant *e;
+
+        ASSERT_OK(latency_histogram_build_json(&h, &v));
+        ASSERT_TRUE(sd_json_variant_is_array(v));
+        ASSERT_EQ(sd_json_variant_elements(v), 0u);
+        v = sd_json_variant_unref(v);
+
+        latency_histogram_add(&h, 5);
+        latency_histogram_add(&h, 7);
+        latency_histogram_add(&h, 10 * USEC_PER_MINUTE);
+
+        /* Empty buckets are left out, and the last one has no upper bound */
+        ASSERT_OK(latency_histogram_build_json(&h, &v));
+        ASSERT_EQ(sd_json_variant_elements(v), 2u);
+
+        e = sd_json_variant_by_index(v, 0);
+        ASSERT_EQ(sd_json_variant_unsigned(sd_json_variant_by_key(e, "upperBoundUSec")), UINT64_C(8));
+        ASSERT_EQ(sd_json_variant_unsigned(sd_json_variant_by_key(e, "count")), UINT64_C(2));
+
+        e = sd_json_variant_by_index(v, 1);
+        ASSERT_NULL(sd_json_variant_by_key(e, "upperBoundUSec"));
+        ASSERT_EQ(sd_json_variant_unsigned(sd_json_variant_by_key(e, "count")), UINT64_C(1));
+}
+
+TEST(string_tables) {
+        ASSERT_STREQ(server_transport_to_string(SERVER_TRANSPORT_STDOUT), "stdout");
+        ASSERT_STREQ(server_journal_type_to_string(SERVER_JOURNAL_USER), "user");
+        ASSERT_NULL(server_transport_to_string(_SERVER_TRANSPORT_MAX));
+}
+
+DEFINE_TEST_MAIN(LOG_DEBUG);
@@ -0,0 +1,170 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "sd-event.h"
+
+#include "alloc-util.h"
+#include "fd-util.h"
+#include "io-util.h"
+#include "journald-server.h"
+#include "journald-stream.h"
+#include "parse-util.h"
+#include "process-util.h"
+#include "tests.h"
+#include "time-util.h"
+
+/* This program pipes a fixed workload of log lines through a stdout stream connection into the journald
+ * stream logic, and measures how fast it is taken apart into log messages. Nothing is written to disk. */
+
+static uint64_t arg_n_lines = 1000000;
+static size_t arg_line_length = 100;
+static size_t arg_write_size = 64 * 1024;
+
+static void write_workload(int fd) {
+        _cleanup_free_ char *chunk = NULL;
+        size_t n_per_chunk, chunk_size;
+        uint64_t n = 0;
+
+        /* The stream protocol header: identifier, unit, priority, level prefix, and the three forwarding
+         * flags */
+        assert_se(loop_write(fd, "bench\n\n6\n0\n0\n0\n0\n", SIZE_MAX) >= 0);
+
+        n_per_chunk = MAX(arg_write_size / (arg_line_length + 1), 1u);
+        chunk_size = n_per_chunk * (arg_line_length + 1);
+
+        assert_se(chunk = malloc(chunk_size));
+        for (size_t i = 0; i < n_per_chunk; i++) {
+                memset(chunk + i * (arg_line_length + 1), 'x', arg_line_length);
+                chunk[i * (arg_line_length + 1) + arg_line_length] = '\n';
+        }
+
+        while (n < arg_n_lines) {
+                size_t k = MIN(n_per_chunk, arg_n_lines - n);
+
+                assert_se(loop_write(fd, chunk, k * (arg_line_length + 1)) >= 0);
+                n += k;
+        }
+}
+
+static int help(void) {
+        printf("%s [OPTIONS...]\n\n"
+               "Benchmark the journald stdout stream logic.\n\n"
+               "  -h --help               Show this help\n"
+               "     --lines=N            Number of lines to send (default: %" PRIu64 ")\n"
+               "     --line-length=N      Length of each line in bytes (default: %zu)\n"
+               "     --write-size=N       Number of bytes the sender writes at once (default: %zu)\n",
+               program_invocation_short_name,
+               arg_n_lines,
+               arg_line_length,
+               arg_write_size);
+        return 0;
+}
+
+static int parse_argv(int argc, char *argv[]) {
+        enum {
+                ARG_LINES = 0x1000,
+                ARG_LINE_LENGTH,
+                ARG_WRITE_SIZE,
+        };
+
+        static const struct option options[] = {
+                { "help",        no_argument,       NULL, 'h'             },
+                { "lines",       required_argument, NULL, ARG_LINES       },
+                { "line-length", required_argument, NULL, ARG_LINE_LENGTH },
+                { "write-size",  required_argument, NULL, ARG_WRITE_SIZE  },
+                {}
+        };
+
+        int c, r;
+
+        assert(argc >= 0);
+        assert(argv);
+
+        while ((c = getopt_long(argc, argv, "h", options, NULL)) >= 0)
+                switch (c) {
+
+                case 'h':
+                        return help();
+
+                case ARG_LINES:
+                        r = safe_atou64(optarg, &arg_n_lines);
+                        if (r < 0 || arg_n_lines <= 0)
+                                return log_error_errno(r < 0 ? r : SYNTHETIC_ERRNO(EINVAL), "Invalid number of lines: %s", optarg);
+                        break;
+
+                case ARG_LINE_LENGTH:
+                        r = safe_atozu(optarg, &arg_line_length);
+                        if (r < 0 || arg_line_length <= 0)
+                                return log_error_errno(r < 0 ? r : SYNTHETIC_ERRNO(EINVAL), "Invalid line length: %s", optarg);
+                        break;
+
+                case ARG_WRITE_SIZE:
+                        r = safe_atozu(optarg, &arg_write_size);
+                        if (r < 0 || arg_write_size <= 0)
+                                return log_error_errno(r < 0 ? r : SYNTHETIC_ERRNO(EINVAL), "Invalid write size: %s", optarg);
+                        break;
+
+                case '?':
+                        return -EINVAL;
+
+                default:
+                        assert_not_reached();
+                }
+
+        return 1;
+}
+
+int main(int argc, char *argv[]) {
+        _cleanup_close_pair_ int fds[2] = EBADF_PAIR;
+        _cleanup_(server_freep) Server *s = NULL;
+        StdoutStream *stream;
+        uint64_t n_bytes;
+        pid_t pid;
+        usec_t t;
+        int r;
+
+        test_setup_logging(LOG_INFO);
+
+        r = parse_argv(argc, argv);
+        if (r <= 0)
+                return r < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+
+        assert_se(server_new(&s) >= 0);
+        s->storage = STORAGE_NONE;
+        s->ratelimit_interval = 0;
+        assert_se(sd_event_default(&s->event) >= 0);
+
+        assert_se(socketpair(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0, fds) >= 0);
+        assert_se(stdout_stream_install(s, fds[0], &stream) >= 0);
+        TAKE_FD(fds[0]); /* owned by the stream now */
+
+        t = now(CLOCK_MONOTONIC);
+
+        r = safe_fork("(bench-writer)", FORK_DEATHSIG_SIGKILL|FORK_LOG, &pid);
+        assert_se(r >= 0);
+        if (r == 0) {
+                write_workload(fds[1]);
+                _exit(EXIT_SUCCESS);
+        }
+
+        fds[1] = safe_close(fds[1]);
+
+        /* The stream is destroyed once the writer closed its end and everything was read */
+        while (s->n_stdout_streams > 0)
+                assert_se(sd_event_run(s->event, UINT64_MAX) >= 0);
+
+        t = usec_sub_unsigned(now(CLOCK_MONOTONIC), t);
+        assert_se(wait_for_terminate_and_check("(bench-writer)", pid, WAIT_LOG) == EXIT_SUCCESS);
+
+        n_bytes = arg_n_lines * (arg_line_length + 1);
+        printf("%" PRIu64 " lines of %zu bytes: %12.0f lines/s, %8.1f MB/s\n",
+               arg_n_lines, arg_line_length,
+               (double) arg_n_lines * USEC_PER_SEC / MAX(t, 1u),
+               (double) n_bytes * USEC_PER_SEC / MAX(t, 1u) / (1024 * 1024));
+
+        return EXIT_SUCCESS;
+}
@@ -0,0 +1,80 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "fd-util.h"
+#include "fs-util.h"
+#include "io-util.h"
+#include "journald-sync.h"
+#include "tests.h"
+#include "tmpfile-util.h"
+
+TEST(sync) {
+        _cleanup_(journal_syncer_freep) JournalSyncer *s = NULL;
+        _cleanup_(unlink_tempfilep) char path[] = "/tmp/test-journald-sync.XXXXXX";
+        _cleanup_close_ int fd = -EBADF;
+        JournalSyncerStats stats;
+
+        ASSERT_OK(fd = mkostemp_safe(path));
+        ASSERT_OK(journal_syncer_new(&s));
+
+        ASSERT_OK(loop_write(fd, "foo", SIZE_MAX));
+        ASSERT_OK(journal_syncer_request(s, fd));
+
+        /* The syncer keeps its own reference to the file */
+        fd = safe_close(fd);
+        journal_syncer_drain(s);
+
+        journal_syncer_get_stats(s, &stats);
+        ASSERT_EQ(stats.n_requests, UINT64_C(1));
+        ASSERT_EQ(stats.n_coalesced, UINT64_C(0));
+        ASSERT_EQ(stats.n_syncs, UINT64_C(1));
+        ASSERT_EQ(stats.n_failed, UINT64_C(0));
+        ASSERT_EQ(stats.n_passes, UINT64_C(1));
+        ASSERT_LE(stats.latency_p50, stats.latency_p99);
+        ASSERT_LE(stats.latency_p99, stats.latency_max);
+}
+
+TEST(coalesce) {
+        _cleanup_(journal_syncer_freep) JournalSyncer *s = NULL;
+        _cleanup_(unlink_tempfilep) char path[] = "/tmp/test-journald-sync.XXXXXX";
+        _cleanup_close_ int fd = -EBADF, fd2 = -EBADF;
+        JournalSyncerStats stats;
+
+        ASSERT_OK(fd = mkostemp_safe(path));
+        ASSERT_OK(fd2 = open(path, O_RDWR|O_CLOEXEC));
+        ASSERT_OK(journal_syncer_new(&s));
+
+        /* Requests for the same file, even via different fds, never result in more syncs than requests,
+         * and each is either synced or coalesced into a pending sync. */
+        for (unsigned i = 0; i < 100; i++) {
+                ASSERT_OK(loop_write(fd, "foo", SIZE_MAX));
+                ASSERT_OK(journal_syncer_request(s, i % 2 == 0 ? fd : fd2));
+        }
+
+        journal_syncer_drain(s);
+
+        journal_syncer_get_stats(s, &stats);
+        ASSERT_EQ(stats.n_requests, UINT64_C(100));
+        ASSERT_EQ(stats.n_syncs + stats.n_coalesced, UINT64_C(100));
+        ASSERT_EQ(stats.n_syncs, stats.n_passes);
+        ASSERT_EQ(stats.n_failed, UINT64_C(0));
+}
+
+TEST(free_syncs) {
+        JournalSyncer *s;
+        _cleanup_(unlink_tempfilep) char path[] = "/tmp/test-journald-sync.XXXXXX";
+        _cleanup_close_ int fd = -EBADF;
+
+        ASSERT_OK(fd = mkostemp_safe(path));
+        ASSERT_OK(journal_syncer_new(&s));
+
+        for (unsigned i = 0; i < 10; i++)
+                ASSERT_OK(journal_syncer_request(s, fd));
+
+        /* Pending requests are dealt with before the syncer goes away */
+        ASSERT_NULL(journal_syncer_free(s));
+}
+
+DEFINE_TEST_MAIN(LOG_DEBUG);
@@ -0,0 +1,228 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <poll.h>
+#include <unistd.h>
+
+#include "format-util.h"
+#include "io-util.h"
+#include "iovec-util.h"
+#include "journald-writer.h"
+#include "stdio-util.h"
+#include "tests.h"
+#include "time-util.h"
+
+#define N_ENTRIES 1000U
+
+typedef struct Recorder {
+        uid_t uids[N_ENTRIES];
+        size_t n;
+        size_t n_stalled;
+
+        /* Hand back entries whose uid is a multiple of this, if non-zero */
+        unsigned stall_modulo;
+        usec_t delay;
+} Recorder;
+
+static size_t record_write(JournalWriter *w, JournalWriterEntry *const *entries, size_t n_entries, void *userdata) {
+        Recorder *r = ASSERT_PTR(userdata);
+        size_t n = 0;
+
+        if (r->delay > 0)
+                (void) usleep_safe(r->delay);
+
+        for (; n < n_entries; n++) {
+                if (r->stall_modulo > 0 && entries[n]->uid % r->stall_modulo == 0)
+                        break;
+
+                ASSERT_LT(r->n, (size_t) N_ENTRIES);
+                r->uids[r->n++] = entries[n]->uid;
+        }
+
+        return n;
+}
+
+static void record_write_stalled(JournalWriter *w, JournalWriterEntry *e, void *userdata) {
+        Recorder *r = ASSERT_PTR(userdata);
+
+        ASSERT_LT(r->n, (size_t) N_ENTRIES);
+        r->uids[r->n++] = e->uid;
+        r->n_stalled++;
+}
+
+static void enqueue(JournalWriter *w, uid_t uid) {
+        char buf[STRLEN("UID=") + DECIMAL_STR_MAX(uid_t)];
+        JournalWriterEntry *e;
+        dual_timestamp ts;
+
+        xsprintf(buf, "UID=" UID_FMT, uid);
+
+        struct iovec iovec[] = {
+                IOVEC_MAKE_STRING("MESSAGE=foo"),
+                IOVEC_MAKE_STRING(buf),
+        };
+
+        ASSERT_NOT_NULL(e = journal_writer_entry_new(uid, iovec, ELEMENTSOF(iovec), dual_timestamp_now(&ts), LOG_INFO));
+        journal_writer_enqueue(w, e);
+}
+
+static void check_order(const Recorder *r, size_t n) {
+        ASSERT_EQ(r->n, n);
+        for (size_t i = 0; i < n; i++)
+                ASSERT_EQ(r->uids[i], (uid_t) i);
+}
+
+TEST(entry_new) {
+        _cleanup_free_ JournalWriterEntry *e = NULL;
+        char foo[] = "FOO=bar", baz[] = "BAZ=";
+        struct iovec iovec[] = {
+                IOVEC_MAKE_STRING(foo),
+                IOVEC_MAKE_STRING(baz),
+        };
+        dual_timestamp ts;
+
+        ASSERT_NOT_NULL(e = journal_writer_entry_new(1000, iovec, ELEMENTSOF(iovec), dual_timestamp_now(&ts), LOG_ERR));
+
+        /* The data is copied */
+        foo[0] = 'X';
+
+        ASSERT_EQ(e->uid, (uid_t) 1000);
+        ASSERT_EQ(e->priority, LOG_ERR);
+        ASSERT_EQ(e->ts.realtime, ts.realtime);
+        ASSERT_EQ(e->n_iovec, 2u);
+        ASSERT_EQ(e->size, strlen("FOO=bar") + strlen("BAZ="));
+        ASSERT_TRUE(memcmp(e->iovec[0].iov_base, "FOO=bar", e->iovec[0].iov_len) == 0);
+        ASSERT_TRUE(memcmp(e->iovec[1].iov_base, "BAZ=", e->iovec[1].iov_len) == 0);
+}
+
+TEST(order) {
+        _cleanup_(journal_writer_freep) JournalWriter *w = NULL;
+        Recorder r = {};
+        JournalWriterStats stats;
+
+        ASSERT_OK(journal_writer_new("test-order", JOURNAL_WRITER_QUEUE_SIZE_DEFAULT, record_write, record_write_stalled, &r, &w));
+        ASSERT_STREQ(journal_writer_get_name(w), "test-order");
+
+        for (uid_t i = 0; i < N_ENTRIES; i++)
+                enqueue(w, i);
+
+        journal_writer_drain(w);
+        check_order(&r, N_ENTRIES);
+
+        journal_writer_get_stats(w, &stats);
+        ASSERT_EQ(stats.n_queued, 0u);
+        ASSERT_EQ(stats.n_bytes_queued, UINT64_C(0));
+        ASSERT_EQ(stats.n_written, (uint64_t) N_ENTRIES);
+        ASSERT_EQ(stats.n_stalled, UINT64_C(0));
+        ASSERT_GT(stats.n_queued_max, 0u);
+}
+
+TEST(stalled) {
+        _cleanup_(journal_writer_freep) JournalWriter *w = NULL;
+        Recorder r = {
+                .stall_modulo = 10,
+        };
+        JournalWriterStats stats;
+
+        ASSERT_OK(journal_writer_new("test-stalled", JOURNAL_WRITER_QUEUE_SIZE_DEFAULT, record_write, record_write_stalled, &r, &w));
+
+        /* Entries handed back to the main thread are written in order with the others */
+        for (uid_t i = 0; i < N_ENTRIES; i++)
+                enqueue(w, i);
+
+        journal_writer_drain(w);
+        check_order(&r, N_ENTRIES);
+
+        journal_writer_get_stats(w, &stats);
+        ASSERT_GE(r.n_stalled, (size_t) (N_ENTRIES / 10));
+        ASSERT_EQ(stats.n_stalled, (uint64_t) r.n_stalled);
+        ASSERT_EQ(stats.n_written + stats.n_stalled, (uint64_t) N_ENTRIES);
+}
+
+TEST(notify) {
+        _cleanup_(journal_writer_freep) JournalWriter *w = NULL;
+        Recorder r = {
+                .stall_modulo = 1,
+        };
+
+        ASSERT_OK(journal_writer_new("test-notify", JOURNAL_WRITER_QUEUE_SIZE_DEFAULT, record_write, record_write_stalled, &r, &w));
+
+        /* A stalled entry wakes up the main thread via the notification fd */
+        enqueue(w, 0);
+        ASSERT_GT(fd_wait_for_event(journal_writer_get_fd(w), POLLIN, 10 * USEC_PER_SEC), 0);
+
+        journal_writer_process(w);
+        check_order(&r, 1);
+        ASSERT_EQ(r.n_stalled, 1u);
+
+        /* Nothing to do anymore */
+        journal_writer_process(w);
+        ASSERT_EQ(r.n_stalled, 1u);
+}
+
+TEST(backpressure) {
+        _cleanup_(journal_writer_freep) JournalWriter *w = NULL;
+        Recorder r = {
+                .delay = 100,
+        };
+        JournalWriterStats stats;
+
+        ASSERT_OK(journal_writer_new("test-bp", 4, record_write, record_write_stalled, &r, &w));
+
+        for (uid_t i = 0; i < 100; i++)
+                enqueue(w, i);
+
+        journal_writer_drain(w);
+        check_order(&r, 100);
+
+        journal_writer_get_stats(w, &stats);
+        ASSERT_EQ(stats.queue_size, 4u);
+        ASSERT_LE(stats.n_queued_max, 4u);
+        ASSERT_GT(stats.n_blocked, UINT64_C(0));
+}
+
+TEST(pause) {
+        _cleanup_(journal_writer_freep) JournalWriter *w = NULL;
+        Recorder r = {};
+        JournalWriterStats stats;
+
+        ASSERT_OK(journal_writer_new("test-pause", 4, record_write, record_write_stalled, &r, &w));
+
+        journal_writer_pause(w);
+        journal_writer_pause(w);
+
+        /* While paused the queue may grow beyond its size, and nothing is written */
+        for (uid_t i = 0; i < 10; i++)
+                enqueue(w, i);
+
+        (void) usleep_safe(10 * USEC_PER_MSEC);
+
+        journal_writer_get_stats(w, &stats);
+        ASSERT_EQ(stats.n_queued, 10u);
+        ASSERT_EQ(stats.n_written, UINT64_C(0));
+        ASSERT_EQ(r.n, 0u);
+
+        journal_writer_resume(w);
+        (void) usleep_safe(10 * USEC_PER_MSEC);
+        ASSERT_EQ(r.n, 0u);
+
+        journal_writer_resume(w);
+        journal_writer_drain(w);
+        check_order(&r, 10);
+}
+
+TEST(free_drains) {
+        JournalWriter *w;
+        Recorder r = {
+                .stall_modulo = 7,
+        };
+
+        ASSERT_OK(journal_writer_new("test-free", JOURNAL_WRITER_QUEUE_SIZE_DEFAULT, record_write, record_write_stalled, &r, &w));
+
+        for (uid_t i = 0; i < 100; i++)
+                enqueue(w, i);
+
+        ASSERT_NULL(journal_writer_free(w));
+        check_order(&r, 100);
+}
+
+DEFINE_TEST_MAIN(LOG_DEBUG);
@@ -63,6 +63,14 @@ struct sd_dhcp_server {
         Hashmap *static_leases_by_client_id;
         Hashmap *static_leases_by_address;
 
+        /* One bit per address in the pool, set if the address is bound, statically assigned, or the
+         * server's own address. Built on first use, see dhcp_server_pool_update(). */
+        uint64_t *pool_bitmap;
+
+        /* The earliest expiration of the bound leases, or USEC_INFINITY if there is none. This may be
+         * earlier than the actual one, but never later. 0 means unknown. */
+        usec_t lease_expiration_min;
+
         usec_t max_lease_time;
         usec_t default_lease_time;
         usec_t ipv6_only_preferred_usec;
@@ -78,6 +86,12 @@ struct sd_dhcp_server {
 
         int lease_dir_fd;
         char *lease_file;
+        sd_event_source *save_leases_event_source;
+
+        /* Statistics */
+        uint64_t n_offers;
+        uint64_t n_acks;
+        uint64_t n_naks;
 };
 
 typedef struct DHCPRequest {
@@ -98,6 +112,8 @@ typedef struct DHCPRequest {
         triple_timestamp timestamp;
 } DHCPRequest;
 
+void dhcp_server_pool_update(sd_dhcp_server *server, be32_t address);
+
 int dhcp_server_handle_message(sd_dhcp_server *server, DHCPMessage *message,
                                size_t length, const triple_timestamp *timestamp);
 int dhcp_server_send_packet(sd_dhcp_server *server,
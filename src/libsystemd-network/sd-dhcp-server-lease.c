@@ -16,6 +16,8 @@ static sd_dhcp_server_lease* dhcp_server_lease_free(sd_dhcp_server_lease *lease)
                 hashmap_remove_value(lease->server->bound_leases_by_client_id, &lease->client_id, lease);
                 hashmap_remove_value(lease->server->static_leases_by_address, UINT32_TO_PTR(lease->address), lease);
                 hashmap_remove_value(lease->server->static_leases_by_client_id, &lease->client_id, lease);
+
+                dhcp_server_pool_update(lease->server, lease->address);
         }
 
         free(lease->hostname);
@@ -50,6 +52,11 @@ int dhcp_server_put_lease(sd_dhcp_server *server, sd_dhcp_server_lease *lease, b
         if (r < 0)
                 return r;
 
+        dhcp_server_pool_update(server, lease->address);
+
+        if (!is_static && server->lease_expiration_min != 0)
+                server->lease_expiration_min = MIN(server->lease_expiration_min, lease->expiration);
+
         return 0;
 }
 
@@ -67,14 +74,21 @@ int dhcp_server_set_lease(sd_dhcp_server *server, be32_t address, DHCPRequest *r
         if (lease) {
                 if (lease->address != address) {
                         hashmap_remove_value(server->bound_leases_by_address, UINT32_TO_PTR(lease->address), lease);
+                        dhcp_server_pool_update(server, lease->address);
                         lease->address = address;
 
                         r = hashmap_ensure_put(&server->bound_leases_by_address, NULL, UINT32_TO_PTR(lease->address), lease);
                         if (r < 0)
                                 return r;
+
+                        dhcp_server_pool_update(server, lease->address);
                 }
 
+                /* Extending a lease may leave lease_expiration_min earlier than necessary, which only
+                 * costs one needless scan in dhcp_server_cleanup_expired_leases(). */
                 lease->expiration = expiration;
+                if (server->lease_expiration_min != 0)
+                        server->lease_expiration_min = MIN(server->lease_expiration_min, expiration);
 
                 TAKE_PTR(lease);
                 return 0;
@@ -123,12 +137,20 @@ int dhcp_server_cleanup_expired_leases(sd_dhcp_server *server) {
         if (r < 0)
                 return r;
 
+        /* This is called for every received message, hence avoid iterating over all leases unless at
+         * least one of them may have expired. */
+        if (server->lease_expiration_min != 0 && server->lease_expiration_min >= time_now)
+                return 0;
+
+        usec_t expiration_min = USEC_INFINITY;
         HASHMAP_FOREACH(lease, server->bound_leases_by_client_id)
                 if (lease->expiration < time_now) {
                         log_dhcp_server(server, "CLEAN (0x%x)", be32toh(lease->address));
                         sd_dhcp_server_lease_unref(lease);
-                }
+                } else
+                        expiration_min = MIN(expiration_min, lease->expiration);
 
+        server->lease_expiration_min = expiration_min;
         return 0;
 }
 
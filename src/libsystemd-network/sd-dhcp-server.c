@@ -16,6 +16,7 @@
 #include "dhcp-server-internal.h"
 #include "dhcp-server-lease-internal.h"
 #include "dns-domain.h"
+#include "event-util.h"
 #include "fd-util.h"
 #include "in-addr-util.h"
 #include "iovec-util.h"
@@ -31,14 +32,46 @@
 #define DHCP_DEFAULT_LEASE_TIME_USEC USEC_PER_HOUR
 #define DHCP_MAX_LEASE_TIME_USEC (USEC_PER_HOUR*12)
 
-static void server_on_lease_change(sd_dhcp_server *server) {
+#define DHCP_SERVER_SAVE_LEASES_DELAY_USEC (1 * USEC_PER_SEC)
+
+static void server_save_leases(sd_dhcp_server *server) {
         int r;
 
         assert(server);
 
+        (void) sd_event_source_set_enabled(server->save_leases_event_source, SD_EVENT_OFF);
+
         r = dhcp_server_save_leases(server);
         if (r < 0)
                 log_dhcp_server_errno(server, r, "Failed to save leases, ignoring: %m");
+}
+
+static int on_save_leases(sd_event_source *s, uint64_t usec, void *userdata) {
+        server_save_leases(ASSERT_PTR(userdata));
+        return 0;
+}
+
+static void server_on_lease_change(sd_dhcp_server *server) {
+        int r;
+
+        assert(server);
+
+        /* The whole lease file is rewritten on save. With many clients, leases change far more often than
+         * once per second, hence coalesce the changes and write them in one go. A pending save is flushed
+         * when the server is stopped. */
+        if (server->lease_file && server->event) {
+                r = event_reset_time_relative(server->event, &server->save_leases_event_source,
+                                              CLOCK_BOOTTIME,
+                                              DHCP_SERVER_SAVE_LEASES_DELAY_USEC, 0,
+                                              on_save_leases, server,
+                                              server->event_priority, "dhcp-server-save-leases",
+                                              /* force_reset = */ false);
+                if (r < 0) {
+                        log_dhcp_server_errno(server, r, "Failed to schedule saving leases, saving now: %m");
+                        server_save_leases(server);
+                }
+        } else
+                server_save_leases(server);
 
         if (server->callback)
                 server->callback(server, SD_DHCP_SERVER_EVENT_LEASE_CHANGED, server->callback_userdata);
@@ -95,6 +128,7 @@ int sd_dhcp_server_configure_pool(
 
         if (server->address != address->s_addr || server->netmask != netmask || server->pool_size != size || server->pool_offset != offset) {
 
+                server->pool_bitmap = mfree(server->pool_bitmap);
                 server->pool_offset = offset;
                 server->pool_size = size;
 
@@ -124,6 +158,7 @@ static sd_dhcp_server *dhcp_server_free(sd_dhcp_server *server) {
 
         sd_dhcp_server_stop(server);
 
+        sd_event_source_unref(server->save_leases_event_source);
         sd_event_unref(server->event);
 
         free(server->boot_server_name);
@@ -137,6 +172,7 @@ static sd_dhcp_server *dhcp_server_free(sd_dhcp_server *server) {
         server->bound_leases_by_client_id = hashmap_free(server->bound_leases_by_client_id);
         server->static_leases_by_address = hashmap_free(server->static_leases_by_address);
         server->static_leases_by_client_id = hashmap_free(server->static_leases_by_client_id);
+        free(server->pool_bitmap);
 
         ordered_set_free(server->extra_options);
         ordered_set_free(server->vendor_options);
@@ -292,6 +328,9 @@ int sd_dhcp_server_stop(sd_dhcp_server *server) {
         server->fd = safe_close(server->fd);
         server->fd_broadcast = safe_close(server->fd_broadcast);
 
+        if (sd_event_source_get_enabled(server->save_leases_event_source, NULL) > 0)
+                server_save_leases(server);
+
         if (running)
                 log_dhcp_server(server, "STOPPED");
 
@@ -493,8 +532,24 @@ int dhcp_server_send_packet(sd_dhcp_server *server,
                 destination = req->message->ciaddr;
 
         bool l2_broadcast = requested_broadcast(req->message) || type == DHCP_NAK;
-        return dhcp_server_send(server, req->message->hlen, req->message->chaddr,
-                                destination, destination_port, packet, optoffset, l2_broadcast);
+        r = dhcp_server_send(server, req->message->hlen, req->message->chaddr,
+                             destination, destination_port, packet, optoffset, l2_broadcast);
+        if (r < 0)
+                return r;
+
+        switch (type) {
+        case DHCP_OFFER:
+                server->n_offers++;
+                break;
+        case DHCP_ACK:
+                server->n_acks++;
+                break;
+        case DHCP_NAK:
+                server->n_naks++;
+                break;
+        }
+
+        return r;
 }
 
 static int server_message_init(
@@ -1015,6 +1070,99 @@ static bool address_available(sd_dhcp_server *server, be32_t address) {
         return true;
 }
 
+static bool pool_get_index(sd_dhcp_server *server, be32_t address, uint32_t *ret) {
+        uint32_t a;
+
+        assert(server);
+        assert(ret);
+
+        if ((address & server->netmask) != server->subnet)
+                return false;
+
+        a = be32toh(address) & ~be32toh(server->netmask);
+        if (a < server->pool_offset || a - server->pool_offset >= server->pool_size)
+                return false;
+
+        *ret = a - server->pool_offset;
+        return true;
+}
+
+void dhcp_server_pool_update(sd_dhcp_server *server, be32_t address) {
+        uint32_t i;
+
+        assert(server);
+
+        if (!server->pool_bitmap)
+                return;
+
+        if (!pool_get_index(server, address, &i))
+                return;
+
+        SET_FLAG(server->pool_bitmap[i / 64], UINT64_C(1) << (i % 64), !address_available(server, address));
+}
+
+static int pool_build_bitmap(sd_dhcp_server *server) {
+        sd_dhcp_server_lease *lease;
+
+        assert(server);
+        assert(server->pool_size > 0);
+
+        if (server->pool_bitmap)
+                return 0;
+
+        server->pool_bitmap = new0(uint64_t, DIV_ROUND_UP(server->pool_size, 64));
+        if (!server->pool_bitmap)
+                return -ENOMEM;
+
+        dhcp_server_pool_update(server, server->address);
+
+        HASHMAP_FOREACH(lease, server->bound_leases_by_address)
+                dhcp_server_pool_update(server, lease->address);
+
+        HASHMAP_FOREACH(lease, server->static_leases_by_address)
+                dhcp_server_pool_update(server, lease->address);
+
+        return 0;
+}
+
+static int pool_find_free_address(sd_dhcp_server *server, uint32_t start, be32_t *ret) {
+        int r;
+
+        assert(server);
+        assert(ret);
+
+        /* Returns the first free address in the pool at or after the start index, wrapping around at the
+         * end of the pool. Fully used 64-address blocks are skipped in one go. */
+
+        r = pool_build_bitmap(server);
+        if (r < 0)
+                return r;
+
+        start %= server->pool_size;
+
+        for (uint32_t n = 0; n < server->pool_size; ) {
+                uint32_t i = (start + n) % server->pool_size;
+                uint64_t free_bits = ~server->pool_bitmap[i / 64] >> (i % 64);
+
+                if (free_bits == 0) {
+                        n += 64 - i % 64;
+                        continue;
+                }
+
+                i += __builtin_ctzll(free_bits);
+                if (i < server->pool_size) {
+                        *ret = server->subnet | htobe32(server->pool_offset + i);
+                        return 1;
+                }
+
+                /* Only the bits beyond the end of the pool are clear, wrap around. */
+                n += server->pool_size - (start + n) % server->pool_size;
+        }
+
+        *ret = INADDR_ANY;
+        return 0;
+}
+
 #define HASH_KEY SD_ID128_MAKE(0d,1d,fe,bd,f1,24,bd,b3,47,f1,dd,6e,73,21,93,30)
 
 int dhcp_server_handle_message(sd_dhcp_server *server, DHCPMessage *message, size_t length, const triple_timestamp *timestamp) {
@@ -1087,15 +1235,9 @@ int dhcp_server_handle_message(sd_dhcp_server *server, DHCPMessage *message, siz
                         client_id_hash_func(&req->client_id, &state);
                         hash = htole64(siphash24_finalize(&state));
 
-                        for (unsigned i = 0; i < server->pool_size; i++) {
-                                be32_t tmp_address;
-
-                                tmp_address = server->subnet | htobe32(server->pool_offset + (hash + i) % server->pool_size);
-                                if (address_available(server, tmp_address)) {
-                                        address = tmp_address;
-                                        break;
-                                }
-                        }
+                        r = pool_find_free_address(server, hash % server->pool_size, &address);
+                        if (r < 0)
+                                return r;
                 }
 
                 if (address == INADDR_ANY)
@@ -3,12 +3,17 @@
 #include <unistd.h>
 #include <sys/types.h>
 
+#include "bus-creds.h"
 #include "bus-internal.h"
 #include "bus-message.h"
 #include "bus-signature.h"
 #include "bus-type.h"
+#include "process-util.h"
 #include "string-util.h"
 
+/* How many senders to remember the credentials of at most, before starting over */
+#define BUS_CREDS_CACHE_MAX 1024U
+
 _public_ int sd_bus_message_send(sd_bus_message *reply) {
         assert_return(reply, -EINVAL);
         assert_return(reply->bus, -EINVAL);
@@ -639,9 +644,69 @@ _public_ int sd_bus_set_property(
         return r;
 }
 
+DEFINE_PRIVATE_HASH_OPS_FULL(bus_creds_cache_hash_ops,
+                              char, string_hash_func, string_compare_func, free,
+                              sd_bus_creds, sd_bus_creds_unref);
+
+void bus_flush_creds_cache(sd_bus *bus) {
+        assert(bus);
+
+        bus->creds_cache = hashmap_free(bus->creds_cache);
+}
+
+static bool bus_creds_cache_entry_valid(sd_bus_creds *c, uint64_t mask) {
+        assert(c);
+
+        /* Everything we need must be there, and fields we may not augment must not have been augmented */
+        if ((mask & ~SD_BUS_CREDS_AUGMENT & ~c->mask) != 0)
+                return false;
+        if (!(mask & SD_BUS_CREDS_AUGMENT) && (mask & c->augmented) != 0)
+                return false;
+
+        /* Data acquired from /proc/ is only good as long as the process is still the same. */
+        if (c->augmented != 0 &&
+            (!(c->mask & SD_BUS_CREDS_PIDFD) || pidfd_verify_pid(c->pidfd, c->pid) < 0))
+                return false;
+
+        return true;
+}
+
+static void bus_creds_cache_put(sd_bus *bus, const char *key, sd_bus_creds *c) {
+        _cleanup_free_ char *k = NULL;
+        int r;
+
+        assert(bus);
+        assert(key);
+        assert(c);
+
+        /* Don't cache data we cannot validate later on, see above */
+        if (c->augmented != 0 && !(c->mask & SD_BUS_CREDS_PIDFD))
+                return;
+
+        sd_bus_creds_unref(hashmap_remove2(bus->creds_cache, key, (void**) &k));
+
+        if (hashmap_size(bus->creds_cache) >= BUS_CREDS_CACHE_MAX)
+                bus_flush_creds_cache(bus);
+
+        if (!k) {
+                k = strdup(key);
+                if (!k)
+                        return;
+        }
+
+        r = hashmap_ensure_put(&bus->creds_cache, &bus_creds_cache_hash_ops, k, c);
+        if (r < 0)
+                return;
+
+        TAKE_PTR(k);
+        sd_bus_creds_ref(c);
+}
+
 _public_ int sd_bus_query_sender_creds(sd_bus_message *call, uint64_t mask, sd_bus_creds **ret) {
         uint64_t missing;
         sd_bus_creds *c;
+        const char *key;
+        int r;
 
         assert_return(call, -EINVAL);
         assert_return(call->sealed, -EPERM);
@@ -662,13 +727,63 @@ _public_ int sd_bus_query_sender_creds(sd_bus_message *call, uint64_t mask, sd_b
                 return 0;
         }
 
-        /* There's a sender, use that */
-        if (call->sender && call->bus->bus_client)
-                return sd_bus_get_name_creds(call->bus, call->sender, mask, ret);
+        key = call->sender && call->bus->bus_client ? call->sender : "";
+
+        if (call->bus->creds_cache) {
+                c = hashmap_get(call->bus->creds_cache, key);
+                if (c && bus_creds_cache_entry_valid(c, mask)) {
+                        call->bus->n_creds_cache_hits++;
+                        *ret = sd_bus_creds_ref(c);
+                        return 0;
+                }
+        }
+
+        _cleanup_(sd_bus_creds_unrefp) sd_bus_creds *creds = NULL;
+
+        /* If we cache augmented data, we need the pidfd to validate it later on */
+        if (call->bus->creds_cache_enabled && (mask & SD_BUS_CREDS_AUGMENT))
+                mask |= SD_BUS_CREDS_PIDFD;
+
+        if (!isempty(key))
+                /* There's a sender, use that */
+                r = sd_bus_get_name_creds(call->bus, call->sender, mask, &creds);
+        else
+                /* There's no sender. For direct connections the credentials of the AF_UNIX peer matter,
+                 * which may be queried via sd_bus_get_owner_creds(). */
+                r = sd_bus_get_owner_creds(call->bus, mask, &creds);
+        if (r < 0)
+                return r;
+
+        if (call->bus->creds_cache_enabled) {
+                call->bus->n_creds_cache_misses++;
+                bus_creds_cache_put(call->bus, key, creds);
+        }
+
+        *ret = TAKE_PTR(creds);
+        return 0;
+}
+
+_public_ int sd_bus_set_creds_cache(sd_bus *bus, int b) {
+        assert_return(bus, -EINVAL);
+        assert_return(bus = bus_resolve(bus), -ENOPKG);
+        assert_return(!bus_origin_changed(bus), -ECHILD);
+
+        /* Services that check the privileges of their callers tend to get many calls in a row from the same
+         * peer. If enabled, the credentials sd_bus_query_sender_creds() looked up are remembered per sender,
+         * and reused as long as they cover the fields asked for and the process is still the same. */
+
+        if (!b)
+                bus_flush_creds_cache(bus);
+
+        bus->creds_cache_enabled = b;
+        return 0;
+}
+
+_public_ int sd_bus_get_creds_cache(sd_bus *bus) {
+        assert_return(bus, -EINVAL);
+        assert_return(bus = bus_resolve(bus), -ENOPKG);
 
-        /* There's no sender. For direct connections the credentials of the AF_UNIX peer matter, which may be
-         * queried via sd_bus_get_owner_creds(). */
-        return sd_bus_get_owner_creds(call->bus, mask, ret);
+        return bus->creds_cache_enabled;
 }
 
 _public_ int sd_bus_query_sender_privilege(sd_bus_message *call, int capability) {
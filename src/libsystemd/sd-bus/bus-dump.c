@@ -631,9 +631,9 @@ int bus_message_pcap_frame(sd_bus_message *m, size_t snaplen, FILE *f) {
         fwrite(m->header, 1, w, f);
         snaplen -= w;
 
-        /* write the dbus body */
+        /* write the dbus body, unless it was passed in a memfd */
         MESSAGE_FOREACH_PART(part, i, m) {
-                if (snaplen <= 0)
+                if (snaplen <= 0 || m->memfd_body)
                         break;
 
                 w = MIN(part->size, snaplen);
@@ -84,6 +84,10 @@ struct node_enumerator {
 
         unsigned last_iteration;
 
+        /* The result of the last call, if caching is enabled on the bus, see sd_bus_set_node_enumerator_cache() */
+        char *cached_prefix;
+        char **cached_nodes;
+
         LIST_FIELDS(struct node_enumerator, enumerators);
 };
 
@@ -191,6 +195,7 @@ struct sd_bus {
         int message_endian;
 
         bool can_fds:1;
+        bool can_memfd:1;
         bool bus_client:1;
         bool ucred_valid:1;
         bool is_server:1;
@@ -210,9 +215,12 @@ struct sd_bus {
         bool watch_bind:1;
         bool is_monitor:1;
         bool accept_fd:1;
+        bool accept_memfd:1;
         bool attach_timestamp:1;
         bool connected_signal:1;
         bool close_on_exit:1;
+        bool node_enumerator_cache:1;
+        bool creds_cache_enabled:1;
 
         RuntimeScope runtime_scope;
 
@@ -261,7 +269,7 @@ struct sd_bus {
 
         enum bus_auth auth;
         unsigned auth_index;
-        struct iovec auth_iovec[3];
+        struct iovec auth_iovec[4];
         size_t auth_rbegin;
         char *auth_buffer;
         usec_t auth_timeout;
@@ -327,6 +335,12 @@ struct sd_bus {
 
         /* zero means use value specified by $SYSTEMD_BUS_TIMEOUT= environment variable or built-in default */
         usec_t method_call_timeout;
+
+        /* Sender credentials acquired by sd_bus_query_sender_creds(), keyed by unique name, or "" for the
+         * peer of a direct connection. Only used if enabled with sd_bus_set_creds_cache(). */
+        Hashmap *creds_cache;
+        uint64_t n_creds_cache_hits;
+        uint64_t n_creds_cache_misses;
 };
 
 /* For method calls we timeout at 25s, like in the D-Bus reference implementation */
@@ -429,3 +443,5 @@ int bus_maybe_reply_error(sd_bus_message *m, int r, sd_bus_error *error);
 void bus_enter_closing(sd_bus *bus);
 
 void bus_set_state(sd_bus *bus, enum bus_state state);
+
+void bus_flush_creds_cache(sd_bus *bus);
@@ -53,9 +53,30 @@ static bool BUS_MATCH_IS_COMPARE(enum bus_match_node_type t) {
 }
 
 static bool BUS_MATCH_CAN_HASH(enum bus_match_node_type t) {
-        return (t >= BUS_MATCH_MESSAGE_TYPE && t <= BUS_MATCH_PATH) ||
-                (t >= BUS_MATCH_ARG && t <= BUS_MATCH_ARG_LAST) ||
-                (t >= BUS_MATCH_ARG_HAS && t <= BUS_MATCH_ARG_HAS_LAST);
+        return (t >= BUS_MATCH_SENDER && t <= BUS_MATCH_ARG_LAST) ||
+                (t >= BUS_MATCH_ARG_NAMESPACE && t <= BUS_MATCH_ARG_HAS_LAST);
+}
+
+static bool BUS_MATCH_IS_NAMESPACE(enum bus_match_node_type t) {
+        return t == BUS_MATCH_PATH_NAMESPACE ||
+                (t >= BUS_MATCH_ARG_NAMESPACE && t <= BUS_MATCH_ARG_NAMESPACE_LAST);
+}
+
+static bool value_is_hashed(enum bus_match_node_type parent_type, const char *value_str) {
+
+        /* Value nodes below compare nodes that can hash are kept in the hash table of the compare node,
+         * except for well-known sender names: without kdbus we cannot know the well-known names of the
+         * sender of a message, hence those nodes need to be tested individually, see value_node_test().
+         * They are kept in the child list instead. Namespace matches are looked up by each prefix of the
+         * value in the message that could match them. */
+
+        if (!BUS_MATCH_CAN_HASH(parent_type))
+                return false;
+
+        if (parent_type == BUS_MATCH_SENDER)
+                return value_str && value_str[0] == ':';
+
+        return true;
 }
 
 static void bus_match_node_free(struct bus_match_node *node) {
@@ -65,7 +86,15 @@ static void bus_match_node_free(struct bus_match_node *node) {
         assert(node->type != BUS_MATCH_ROOT);
         assert(node->type < _BUS_MATCH_NODE_TYPE_MAX);
 
-        if (node->parent->child) {
+        if (node->type == BUS_MATCH_VALUE && value_is_hashed(node->parent->type, node->value.str)) {
+                /* We are in the parent's hash table, so clean this up */
+
+                if (node->parent->type == BUS_MATCH_MESSAGE_TYPE)
+                        hashmap_remove(node->parent->compare.children, UINT_TO_PTR(node->value.u8));
+                else
+                        hashmap_remove(node->parent->compare.children, node->value.str);
+
+        } else if (node->parent->child) {
                 /* We are apparently linked into the parent's child
                  * list. Let's remove us from there. */
                 if (node->prev) {
@@ -80,17 +109,8 @@ static void bus_match_node_free(struct bus_match_node *node) {
                         node->next->prev = node->prev;
         }
 
-        if (node->type == BUS_MATCH_VALUE) {
-                /* We might be in the parent's hash table, so clean
-                 * this up */
-
-                if (node->parent->type == BUS_MATCH_MESSAGE_TYPE)
-                        hashmap_remove(node->parent->compare.children, UINT_TO_PTR(node->value.u8));
-                else if (BUS_MATCH_CAN_HASH(node->parent->type) && node->value.str)
-                        hashmap_remove(node->parent->compare.children, node->value.str);
-
+        if (node->type == BUS_MATCH_VALUE)
                 free(node->value.str);
-        }
 
         if (BUS_MATCH_IS_COMPARE(node->type)) {
                 assert(hashmap_isempty(node->compare.children));
@@ -235,6 +255,72 @@ static bool value_node_same(
         }
 }
 
+static int bus_match_run_namespace(
+                sd_bus *bus,
+                struct bus_match_node *node,
+                const char *test_str,
+                char separator,
+                sd_bus_message *m) {
+
+        _cleanup_free_ char *p = NULL;
+        size_t n;
+        int r;
+
+        assert(node);
+        assert(BUS_MATCH_IS_NAMESPACE(node->type));
+        assert(test_str);
+
+        /* A namespace matches a value if it is equal to it, or a prefix of it that is followed by the
+         * separator in it or ends in the separator itself, see simple_pattern_check(). Hence, let's look up
+         * the value itself, and the parts of it before each separator, with and without the separator. We
+         * truncate a copy of the value from the end, so that each lookup is a plain hash table lookup. */
+
+        p = strdup(test_str);
+        if (!p)
+                return -ENOMEM;
+
+        n = strlen(p);
+
+        for (size_t i = n + 1; i > 0; i--) {
+                struct bus_match_node *found;
+
+                if (i <= n) {
+                        if (p[i - 1] != separator)
+                                continue;
+
+                        if (i < n) {
+                                /* The prefix including the separator */
+                                p[i] = 0;
+
+                                found = hashmap_get(node->compare.children, p);
+                                if (found) {
+                                        r = bus_match_run(bus, found, m);
+                                        if (r != 0)
+                                                return r;
+
+                                        if (bus && bus->match_callbacks_modified)
+                                                return 0;
+                                }
+                        }
+
+                        /* The prefix before the separator */
+                        p[i - 1] = 0;
+                }
+
+                found = hashmap_get(node->compare.children, p);
+                if (found) {
+                        r = bus_match_run(bus, found, m);
+                        if (r != 0)
+                                return r;
+
+                        if (bus && bus->match_callbacks_modified)
+                                return 0;
+                }
+        }
+
+        return 0;
+}
+
 int bus_match_run(
                 sd_bus *bus,
                 struct bus_match_node *node,
@@ -375,7 +461,19 @@ int bus_match_run(
                 assert_not_reached();
         }
 
-        if (BUS_MATCH_CAN_HASH(node->type)) {
+        if (BUS_MATCH_IS_NAMESPACE(node->type)) {
+
+                /* Lookup via hash table too, but for each prefix of the value the namespace could match */
+
+                if (test_str) {
+                        r = bus_match_run_namespace(bus, node, test_str,
+                                                    node->type == BUS_MATCH_PATH_NAMESPACE ? '/' : '.',
+                                                    m);
+                        if (r != 0)
+                                return r;
+                }
+
+        } else if (BUS_MATCH_CAN_HASH(node->type)) {
                 struct bus_match_node *found;
 
                 /* Lookup via hash table, nice! So let's jump directly. */
@@ -403,19 +501,23 @@ int bus_match_run(
                         if (r != 0)
                                 return r;
                 }
-        } else
-                /* No hash table, so let's iterate manually... */
-                for (struct bus_match_node *c = node->child; c; c = c->next) {
-                        if (!value_node_test(c, node->type, test_u8, test_str, test_strv, m))
-                                continue;
+        }
 
-                        r = bus_match_run(bus, c, m);
-                        if (r != 0)
-                                return r;
+        if (bus && bus->match_callbacks_modified)
+                return 0;
 
-                        if (bus && bus->match_callbacks_modified)
-                                return 0;
-                }
+        /* Values not in the hash table, so let's iterate manually... */
+        for (struct bus_match_node *c = node->child; c; c = c->next) {
+                if (!value_node_test(c, node->type, test_u8, test_str, test_strv, m))
+                        continue;
+
+                r = bus_match_run(bus, c, m);
+                if (r != 0)
+                        return r;
+
+                if (bus && bus->match_callbacks_modified)
+                        return 0;
+        }
 
         if (bus && bus->match_callbacks_modified)
                 return 0;
@@ -447,7 +549,7 @@ static int bus_match_add_compare_value(
 
                 if (t == BUS_MATCH_MESSAGE_TYPE)
                         n = hashmap_get(c->compare.children, UINT_TO_PTR(value_u8));
-                else if (BUS_MATCH_CAN_HASH(t))
+                else if (value_is_hashed(t, value_str))
                         n = hashmap_get(c->compare.children, value_str);
                 else
                         for (n = c->child; n && !value_node_same(n, t, value_u8, value_str); n = n->next)
@@ -505,7 +607,7 @@ static int bus_match_add_compare_value(
         }
 
         n->parent = c;
-        if (c->compare.children) {
+        if (value_is_hashed(t, value_str)) {
 
                 if (t == BUS_MATCH_MESSAGE_TYPE)
                         r = hashmap_put(c->compare.children, UINT_TO_PTR(value_u8), n);
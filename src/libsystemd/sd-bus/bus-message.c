@@ -12,6 +12,7 @@
 #include "bus-signature.h"
 #include "bus-type.h"
 #include "fd-util.h"
+#include "io-util.h"
 #include "iovec-util.h"
 #include "memfd-util.h"
 #include "memory-util.h"
@@ -23,6 +24,225 @@
 static int message_append_basic(sd_bus_message *m, char type, const void *p, const void **stored);
 static int message_parse_fields(sd_bus_message *m);
 
+/* The size of the arena allocated together with messages we build, and with messages we receive. The former
+ * is large enough to hold the header, body and container stack of typical messages such as
+ * PropertiesChanged signals, the latter only needs to hold the container stack and signatures used while
+ * reading the message. */
+#define MESSAGE_ARENA_SIZE (2U*1024U)
+#define MESSAGE_ARENA_SIZE_PARSE 512U
+
+/* The initial allocation sizes of the header and of the first body part of messages we build */
+#define MESSAGE_HEADER_PREALLOC 256U
+#define MESSAGE_BODY_PREALLOC 1024U
+
+/* Every allocation from the arena of a message is preceded by this. The arena is used like a stack: when the
+ * topmost allocation is freed its space is returned to the arena, together with the space of allocations
+ * directly below it that have been freed before. */
+typedef struct MessageArenaBlock {
+        uint32_t previous;     /* offset of the block below, or UINT32_MAX */
+        uint32_t size:31;      /* size of the data, always a multiple of 8 */
+        bool freed:1;
+        uint8_t data[];
+} MessageArenaBlock;
+
+assert_cc(sizeof(MessageArenaBlock) == 8);
+
+#if BUILD_MODE_DEVELOPER
+#  define message_count_allocation(m) ((m)->n_allocations++)
+#else
+#  define message_count_allocation(m) ((void) 0)
+#endif
+
+static void message_arena_init(sd_bus_message *m, size_t offset, uint32_t size) {
+        assert(m);
+        assert(offset % 8 == 0);
+
+        m->arena = (uint8_t*) m + offset;
+        m->arena_size = size;
+        m->arena_used = 0;
+        m->arena_top = UINT32_MAX;
+}
+
+static bool message_arena_owns(sd_bus_message *m, const void *p) {
+        assert(m);
+
+        return m->arena &&
+                (const uint8_t*) p >= m->arena &&
+                (const uint8_t*) p < m->arena + m->arena_size;
+}
+
+static MessageArenaBlock* message_arena_block(const void *p) {
+        return (MessageArenaBlock*) ((uint8_t*) p - offsetof(MessageArenaBlock, data));
+}
+
+static void* message_arena_alloc(sd_bus_message *m, size_t sz) {
+        MessageArenaBlock *b;
+
+        assert(m);
+
+        if (sz > m->arena_size ||
+            sizeof(MessageArenaBlock) + ALIGN8(sz) > m->arena_size - m->arena_used)
+                return NULL;
+
+        b = (MessageArenaBlock*) (m->arena + m->arena_used);
+        *b = (MessageArenaBlock) {
+                .previous = m->arena_top,
+                .size = ALIGN8(sz),
+        };
+
+        m->arena_top = m->arena_used;
+        m->arena_used += sizeof(MessageArenaBlock) + b->size;
+
+        return b->data;
+}
+
+static void message_arena_free(sd_bus_message *m, MessageArenaBlock *b) {
+        assert(m);
+        assert(b);
+        assert(!b->freed);
+
+        b->freed = true;
+
+        while (m->arena_top != UINT32_MAX) {
+                b = (MessageArenaBlock*) (m->arena + m->arena_top);
+                if (!b->freed)
+                        break;
+
+                m->arena_used = m->arena_top;
+                m->arena_top = b->previous;
+        }
+}
+
+static void* message_malloc(sd_bus_message *m, size_t sz) {
+        void *p;
+
+        assert(m);
+
+        p = message_arena_alloc(m, sz);
+        if (p)
+                return p;
+
+        p = malloc(sz);
+        if (p)
+                message_count_allocation(m);
+
+        return p;
+}
+
+static void* message_realloc(sd_bus_message *m, void *p, size_t sz) {
+        MessageArenaBlock *b;
+        void *n;
+
+        assert(m);
+
+        if (!p)
+                return message_malloc(m, sz);
+
+        if (!message_arena_owns(m, p)) {
+                n = realloc(p, sz);
+                if (n)
+                        message_count_allocation(m);
+
+                return n;
+        }
+
+        b = message_arena_block(p);
+        if (sz <= b->size)
+                return p;
+
+        /* The topmost allocation can grow in place */
+        if ((uint8_t*) b == m->arena + m->arena_top &&
+            sz <= m->arena_size &&
+            ALIGN8(sz) - b->size <= m->arena_size - m->arena_used) {
+                m->arena_used += ALIGN8(sz) - b->size;
+                b->size = ALIGN8(sz);
+                return p;
+        }
+
+        /* Otherwise move it, with some headroom, in order not to move it again and again */
+        n = message_malloc(m, MAX(sz, 2 * (size_t) b->size));
+        if (!n)
+                return NULL;
+
+        memcpy(n, p, b->size);
+        message_arena_free(m, b);
+
+        return n;
+}
+
+static void* message_mfree(sd_bus_message *m, void *p) {
+        assert(m);
+
+        if (message_arena_owns(m, p))
+                message_arena_free(m, message_arena_block(p));
+        else
+                free(p);
+
+        return NULL;
+}
+
+static int message_free_and_strndup(sd_bus_message *m, char **p, const char *s, size_t l) {
+        char *t;
+
+        assert(m);
+        assert(p);
+        assert(s);
+
+        /* Free the old string first, so that the new one can take its space in the arena */
+        *p = message_mfree(m, *p);
+
+        l = strnlen(s, l);
+        t = message_malloc(m, l + 1);
+        if (!t)
+                return -ENOMEM;
+
+        *((char*) mempcpy(t, s, l)) = 0;
+        *p = t;
+        return 1;
+}
+
+static char* message_strdup(sd_bus_message *m, const char *s) {
+        char *t = NULL;
+
+        if (message_free_and_strndup(m, &t, s, SIZE_MAX) < 0)
+                return NULL;
+
+        return t;
+}
+
+static char* message_strextend_internal(sd_bus_message *m, char **x, ...) {
+        size_t f, l = 0;
+        va_list ap;
+        char *n, *p;
+
+        assert(m);
+        assert(x);
+
+        f = strlen_ptr(*x);
+
+        va_start(ap, x);
+        for (const char *t; (t = va_arg(ap, const char*)); )
+                l += strlen(t);
+        va_end(ap);
+
+        n = message_realloc(m, *x, f + l + 1);
+        if (!n)
+                return NULL;
+
+        *x = n;
+        p = n + f;
+
+        va_start(ap, x);
+        for (const char *t; (t = va_arg(ap, const char*)); )
+                p = stpcpy(p, t);
+        va_end(ap);
+
+        *p = 0;
+        return p;
+}
+
+#define message_strextend(m, x, ...) message_strextend_internal(m, x, __VA_ARGS__, NULL)
+
 static void *adjust_pointer(const void *p, void *old_base, size_t sz, void *new_base) {
 
         if (!p)
@@ -60,11 +280,11 @@ static void message_free_part(sd_bus_message *m, struct bus_body_part *part) {
                         explicit_bzero_safe(part->data, part->size);
 
                 if (part->free_this)
-                        free(part->data);
+                        message_mfree(m, part->data);
         }
 
         if (part != &m->body)
-                free(part);
+                message_mfree(m, part);
 }
 
 static void message_reset_parts(sd_bus_message *m) {
@@ -101,21 +321,42 @@ static void message_free_last_container(sd_bus_message *m) {
 
         c = message_get_last_container(m);
 
-        free(c->signature);
-        free(c->peeked_signature);
+        /* In reverse order of allocation, so that the arena space is returned right away */
+        message_mfree(m, c->peeked_signature);
+        message_mfree(m, c->signature);
 
         /* Move to previous container, but not if we are on root container */
         if (m->n_containers > 0)
                 m->n_containers--;
 }
 
+static int message_grow_containers(sd_bus_message *m) {
+        struct bus_container *c;
+        size_t n;
+
+        assert(m);
+
+        if (m->n_containers < m->n_containers_allocated)
+                return 0;
+
+        n = MAX(m->n_containers_allocated * 2, 4U);
+        c = message_realloc(m, m->containers, n * sizeof(struct bus_container));
+        if (!c)
+                return -ENOMEM;
+
+        m->containers = c;
+        m->n_containers_allocated = n;
+        return 0;
+}
+
 static void message_reset_containers(sd_bus_message *m) {
         assert(m);
 
         while (m->n_containers > 0)
                 message_free_last_container(m);
 
-        m->containers = mfree(m->containers);
+        m->containers = message_mfree(m, m->containers);
+        m->n_containers_allocated = 0;
         m->root_container.index = 0;
 }
 
@@ -125,7 +366,7 @@ static sd_bus_message* message_free(sd_bus_message *m) {
         message_reset_parts(m);
 
         if (m->free_header)
-                free(m->header);
+                message_mfree(m, m->header);
 
         /* Note that we don't unref m->bus here. That's already done by sd_bus_message_unref() as each user
          * reference to the bus message also is considered a reference to the bus connection itself. */
@@ -166,15 +407,13 @@ static void *message_extend_fields(sd_bus_message *m, size_t sz, bool add_offset
                 return (uint8_t*) m->header + old_size;
 
         if (m->free_header) {
-                np = realloc(m->header, ALIGN8(new_size));
+                np = message_realloc(m, m->header, ALIGN8(new_size));
                 if (!np)
                         goto poison;
         } else {
-                /* Initially, the header is allocated as part of
-                 * the sd_bus_message itself, let's replace it by
-                 * dynamic data */
+                /* The header is not ours, let's replace it by dynamic data */
 
-                np = malloc(ALIGN8(new_size));
+                np = message_malloc(m, ALIGN8(new_size));
                 if (!np)
                         goto poison;
 
@@ -362,17 +601,20 @@ static int message_from_header(
 
         /* Note that we are happy with unknown flags in the flags header! */
 
-        a = ALIGN(sizeof(sd_bus_message));
+        a = ALIGN8(sizeof(sd_bus_message));
 
         if (label) {
                 label_sz = strlen(label);
-                a += label_sz + 1;
+                a += ALIGN8(label_sz + 1);
         }
 
-        m = malloc0(a);
+        m = malloc0(a + MESSAGE_ARENA_SIZE_PARSE);
         if (!m)
                 return -ENOMEM;
 
+        message_arena_init(m, a, MESSAGE_ARENA_SIZE_PARSE);
+        message_count_allocation(m);
+
         m->creds = (sd_bus_creds) { SD_BUS_CREDS_INIT_FIELDS };
         m->sealed = true;
         m->header = buffer;
@@ -392,7 +634,7 @@ static int message_from_header(
         m->n_fds = n_fds;
 
         if (label) {
-                m->creds.label = (char*) m + ALIGN(sizeof(sd_bus_message));
+                m->creds.label = (char*) m + ALIGN8(sizeof(sd_bus_message));
                 memcpy(m->creds.label, label, label_sz + 1);
 
                 m->creds.mask |= SD_BUS_CREDS_SELINUX_CONTEXT;
@@ -445,6 +687,15 @@ int bus_message_from_malloc(
         if (r < 0)
                 return r;
 
+        /* The message only takes the fds its header asks for, see message_parse_fields(). The array stays
+         * with the caller, as it may hold the fds of further messages. */
+        if (m->n_fds > 0) {
+                m->fds = newdup(int, fds, m->n_fds);
+                if (!m->fds)
+                        return -ENOMEM;
+        } else
+                m->fds = NULL;
+
         /* We take possession of the memory and fds now */
         m->free_header = true;
         m->free_fds = true;
@@ -465,14 +716,21 @@ _public_ int sd_bus_message_new(
         /* Creation of messages with _SD_BUS_MESSAGE_TYPE_INVALID is allowed. */
         assert_return(type < _SD_BUS_MESSAGE_TYPE_MAX, -EINVAL);
 
-        sd_bus_message *t = malloc0(ALIGN(sizeof(sd_bus_message)) + sizeof(struct bus_header));
+        sd_bus_message *t = malloc0(ALIGN8(sizeof(sd_bus_message)) + MESSAGE_ARENA_SIZE);
         if (!t)
                 return -ENOMEM;
 
+        message_arena_init(t, ALIGN8(sizeof(sd_bus_message)), MESSAGE_ARENA_SIZE);
+        message_count_allocation(t);
+
+        /* Reserve some space for the header fields right away, so that the header can grow in place */
+        t->header = message_arena_alloc(t, MESSAGE_HEADER_PREALLOC);
+        assert(t->header);
+        t->free_header = true;
+
         t->n_ref = 1;
         t->creds = (sd_bus_creds) { SD_BUS_CREDS_INIT_FIELDS };
         t->bus = sd_bus_ref(bus);
-        t->header = (struct bus_header*) ((uint8_t*) t + ALIGN(sizeof(struct sd_bus_message)));
         t->header->endian = BUS_NATIVE_ENDIAN;
         t->header->type = type;
         t->header->version = bus->message_version;
@@ -1101,12 +1359,14 @@ static struct bus_body_part *message_append_part(sd_bus_message *m) {
         } else {
                 assert(m->body_end);
 
-                part = new0(struct bus_body_part, 1);
+                part = message_malloc(m, sizeof(struct bus_body_part));
                 if (!part) {
                         m->poisoned = true;
                         return NULL;
                 }
 
+                zero(*part);
+
                 m->body_end->next = part;
         }
 
@@ -1150,7 +1410,13 @@ static int part_make_space(
                 size_t new_allocated;
 
                 new_allocated = sz > 0 ? 2 * sz : 64;
-                n = realloc(part->data, new_allocated);
+
+                /* Most messages have a single body part. Give it some headroom right away, so that it
+                 * rarely needs to grow, and then usually grows in place in the arena. */
+                if (!part->data && part == &m->body)
+                        new_allocated = MAX(new_allocated, (size_t) MESSAGE_BODY_PREALLOC);
+
+                n = message_realloc(m, part->data, new_allocated);
                 if (!n) {
                         m->poisoned = true;
                         return -ENOMEM;
@@ -1330,7 +1596,7 @@ int message_append_basic(sd_bus_message *m, char type, const void *p, const void
                 if (c->enclosing != 0)
                         return -ENXIO;
 
-                e = strextend(&c->signature, CHAR_TO_STR(type));
+                e = message_strextend(m, &c->signature, CHAR_TO_STR(type));
                 if (!e) {
                         m->poisoned = true;
                         return -ENOMEM;
@@ -1471,7 +1737,7 @@ _public_ int sd_bus_message_append_string_space(
                 if (c->enclosing != 0)
                         return -ENXIO;
 
-                e = strextend(&c->signature, CHAR_TO_STR(SD_BUS_TYPE_STRING));
+                e = message_strextend(m, &c->signature, CHAR_TO_STR(SD_BUS_TYPE_STRING));
                 if (!e) {
                         m->poisoned = true;
                         return -ENOMEM;
@@ -1568,7 +1834,7 @@ static int bus_message_open_array(
 
                 /* Extend the existing signature */
 
-                e = strextend(&c->signature, CHAR_TO_STR(SD_BUS_TYPE_ARRAY), contents);
+                e = message_strextend(m, &c->signature, CHAR_TO_STR(SD_BUS_TYPE_ARRAY), contents);
                 if (!e) {
                         m->poisoned = true;
                         return -ENOMEM;
@@ -1635,7 +1901,7 @@ static int bus_message_open_variant(
                 if (c->enclosing != 0)
                         return -ENXIO;
 
-                e = strextend(&c->signature, CHAR_TO_STR(SD_BUS_TYPE_VARIANT));
+                e = message_strextend(m, &c->signature, CHAR_TO_STR(SD_BUS_TYPE_VARIANT));
                 if (!e) {
                         m->poisoned = true;
                         return -ENOMEM;
@@ -1689,7 +1955,7 @@ static int bus_message_open_struct(
                 if (c->enclosing != 0)
                         return -ENXIO;
 
-                e = strextend(&c->signature, CHAR_TO_STR(SD_BUS_TYPE_STRUCT_BEGIN), contents, CHAR_TO_STR(SD_BUS_TYPE_STRUCT_END));
+                e = message_strextend(m, &c->signature, CHAR_TO_STR(SD_BUS_TYPE_STRUCT_BEGIN), contents, CHAR_TO_STR(SD_BUS_TYPE_STRUCT_END));
                 if (!e) {
                         m->poisoned = true;
                         return -ENOMEM;
@@ -1751,7 +2017,7 @@ _public_ int sd_bus_message_open_container(
 
         struct bus_container *c;
         uint32_t *array_size = NULL;
-        _cleanup_free_ char *signature = NULL;
+        char *signature;
         size_t before, begin = 0;
         int r;
 
@@ -1761,19 +2027,14 @@ _public_ int sd_bus_message_open_container(
         assert_return(!m->poisoned, -ESTALE);
 
         /* Make sure we have space for one more container */
-        if (!GREEDY_REALLOC(m->containers, m->n_containers + 1)) {
+        r = message_grow_containers(m);
+        if (r < 0) {
                 m->poisoned = true;
-                return -ENOMEM;
+                return r;
         }
 
         c = message_get_last_container(m);
 
-        signature = strdup(contents);
-        if (!signature) {
-                m->poisoned = true;
-                return -ENOMEM;
-        }
-
         /* Save old index in the parent container, in case we have to
          * abort this container */
         c->saved_index = c->index;
@@ -1792,10 +2053,18 @@ _public_ int sd_bus_message_open_container(
         if (r < 0)
                 return r;
 
+        /* Copy the signature only now that the one of the parent container has been extended, so that the
+         * two stay in stack order in the arena */
+        signature = message_strdup(m, contents);
+        if (!signature) {
+                m->poisoned = true;
+                return -ENOMEM;
+        }
+
         /* OK, let's fill it in */
         m->containers[m->n_containers++] = (struct bus_container) {
                 .enclosing = type,
-                .signature = TAKE_PTR(signature),
+                .signature = signature,
                 .array_size = array_size,
                 .before = before,
                 .begin = begin,
@@ -1820,7 +2089,7 @@ _public_ int sd_bus_message_close_container(sd_bus_message *m) {
 
         m->n_containers--;
 
-        free(c->signature);
+        message_mfree(m, c->signature);
 
         return 0;
 }
@@ -2314,7 +2583,7 @@ _public_ int sd_bus_message_append_string_memfd(
                 if (c->enclosing != 0)
                         return -ENXIO;
 
-                e = strextend(&c->signature, CHAR_TO_STR(SD_BUS_TYPE_STRING));
+                e = message_strextend(m, &c->signature, CHAR_TO_STR(SD_BUS_TYPE_STRING));
                 if (!e) {
                         m->poisoned = true;
                         return -ENOMEM;
@@ -2366,6 +2635,74 @@ _public_ int sd_bus_message_append_strv(sd_bus_message *m, char **l) {
         return sd_bus_message_close_container(m);
 }
 
+static int message_move_body_to_memfd(sd_bus_message *m) {
+        _cleanup_close_ int fd = -EBADF;
+        struct bus_body_part *part;
+        unsigned i;
+        void *p;
+        int *f, r;
+
+        assert(m);
+        assert(!m->sealed);
+        assert(m->body_size > 0);
+
+        /* Copies the body into a sealed memfd, which is passed along with the message instead of the body
+         * itself, so that the receiver can map it rather than read it from the socket. The body parts are
+         * replaced by a read-only mapping of the memfd, so that the message may be read locally still. */
+
+        fd = memfd_new("sd-bus-body");
+        if (fd < 0)
+                return fd;
+
+        MESSAGE_FOREACH_PART(part, i, m) {
+                r = bus_body_part_map(part);
+                if (r < 0)
+                        return r;
+
+                r = loop_write(fd, part->data, part->size);
+                if (r < 0)
+                        return r;
+        }
+
+        r = memfd_set_sealed(fd);
+        if (r < 0)
+                return r;
+
+        f = reallocarray(m->fds, m->n_fds + 1, sizeof(int));
+        if (!f)
+                return -ENOMEM;
+        m->fds = f;
+        m->free_fds = true;
+
+        r = message_append_field_uint32(m, BUS_MESSAGE_HEADER_MEMFD_BODY, m->n_fds);
+        if (r < 0)
+                return r;
+
+        r = memfd_map(fd, 0, m->body_size, &p);
+        if (r < 0) {
+                m->poisoned = true;
+                return r;
+        }
+
+        m->fds[m->n_fds++] = TAKE_FD(fd);
+
+        message_reset_parts(m);
+        m->body = (struct bus_body_part) {
+                .data = p,
+                .mmap_begin = p,
+                .size = m->body_size,
+                .mapped = m->body_size,
+                .memfd = -EBADF,
+                .munmap_this = true,
+                .sealed = true,
+        };
+        m->body_end = &m->body;
+        m->n_body_parts = 1;
+        m->memfd_body = true;
+
+        return 0;
+}
+
 static int bus_message_close_header(sd_bus_message *m) {
         assert(m);
 
@@ -2373,6 +2710,10 @@ static int bus_message_close_header(sd_bus_message *m) {
          * this position, so that during parsing we know where to put the outer container end. */
         m->user_body_size = m->body_size;
 
+        /* A body passed in a memfd is not part of the message on the wire */
+        if (m->memfd_body)
+                m->body_size = 0;
+
         m->header->fields_size = m->fields_size;
         m->header->body_size = m->body_size;
 
@@ -2413,6 +2754,14 @@ _public_ int sd_bus_message_seal(sd_bus_message *m, uint64_t cookie, uint64_t ti
                         return r;
         }
 
+        /* Pass large bodies in a memfd if the peer agreed to that. Not for sensitive messages though, since
+         * we cannot erase the memfd once it is sealed. */
+        if (m->bus->can_memfd && m->body_size >= MEMFD_MIN_SIZE && !m->sensitive) {
+                r = message_move_body_to_memfd(m);
+                if (r < 0)
+                        return r;
+        }
+
         if (m->n_fds > 0) {
                 r = message_append_field_uint32(m, BUS_MESSAGE_HEADER_UNIX_FDS, m->n_fds);
                 if (r < 0)
@@ -3043,7 +3392,7 @@ _public_ int sd_bus_message_enter_container(sd_bus_message *m,
                                             const char *contents) {
         struct bus_container *c;
         uint32_t *array_size = NULL;
-        _cleanup_free_ char *signature = NULL;
+        char *signature;
         size_t before;
         int r;
 
@@ -3089,8 +3438,9 @@ _public_ int sd_bus_message_enter_container(sd_bus_message *m,
         if (m->n_containers >= BUS_CONTAINER_DEPTH)
                 return -EBADMSG;
 
-        if (!GREEDY_REALLOC(m->containers, m->n_containers + 1))
-                return -ENOMEM;
+        r = message_grow_containers(m);
+        if (r < 0)
+                return r;
 
         if (message_end_of_signature(m))
                 return -ENXIO;
@@ -3100,7 +3450,7 @@ _public_ int sd_bus_message_enter_container(sd_bus_message *m,
 
         c = message_get_last_container(m);
 
-        signature = strdup(contents);
+        signature = message_strdup(m, contents);
         if (!signature)
                 return -ENOMEM;
 
@@ -3117,13 +3467,15 @@ _public_ int sd_bus_message_enter_container(sd_bus_message *m,
                 r = bus_message_enter_dict_entry(m, c, contents);
         else
                 r = -EINVAL;
-        if (r <= 0)
+        if (r <= 0) {
+                message_mfree(m, signature);
                 return r;
+        }
 
         /* OK, let's fill it in */
         m->containers[m->n_containers++] = (struct bus_container) {
                  .enclosing = type,
-                 .signature = TAKE_PTR(signature),
+                 .signature = signature,
 
                  .before = before,
                  .begin = m->rindex,
@@ -3218,8 +3570,8 @@ _public_ int sd_bus_message_peek_type(sd_bus_message *m, char *type, const char
 
                         /* The array element must not be empty */
                         assert(l >= 1);
-                        if (free_and_strndup(&c->peeked_signature,
-                                             c->signature + c->index + 1, l) < 0)
+                        if (message_free_and_strndup(m, &c->peeked_signature,
+                                                     c->signature + c->index + 1, l) < 0)
                                 return -ENOMEM;
 
                         *contents = c->peeked_signature;
@@ -3241,8 +3593,8 @@ _public_ int sd_bus_message_peek_type(sd_bus_message *m, char *type, const char
                                 return r;
 
                         assert(l >= 3);
-                        if (free_and_strndup(&c->peeked_signature,
-                                             c->signature + c->index + 1, l - 2) < 0)
+                        if (message_free_and_strndup(m, &c->peeked_signature,
+                                                     c->signature + c->index + 1, l - 2) < 0)
                                 return -ENOMEM;
 
                         *contents = c->peeked_signature;
@@ -4025,9 +4377,54 @@ static int message_skip_fields(
         }
 }
 
+static int message_map_memfd_body(sd_bus_message *m, uint32_t idx) {
+        uint64_t sz;
+        void *p;
+        int r;
+
+        assert(m);
+
+        /* The body was passed in a memfd, see message_move_body_to_memfd(). It must be sealed, so that the
+         * sender cannot modify it anymore after we validated it. The fd stays among the fds of the message,
+         * so that the message may be forwarded as is. */
+
+        if (m->body_size != 0 || idx >= m->n_fds)
+                return -EBADMSG;
+
+        r = memfd_get_sealed(m->fds[idx]);
+        if (r <= 0)
+                return -EBADMSG;
+
+        r = memfd_get_size(m->fds[idx], &sz);
+        if (r < 0)
+                return r;
+
+        if (sz == 0 || sz >= BUS_MESSAGE_SIZE_MAX)
+                return -EBADMSG;
+
+        r = memfd_map(m->fds[idx], 0, sz, &p);
+        if (r < 0)
+                return r;
+
+        m->body = (struct bus_body_part) {
+                .data = p,
+                .mmap_begin = p,
+                .size = sz,
+                .mapped = sz,
+                .memfd = -EBADF,
+                .munmap_this = true,
+                .sealed = true,
+        };
+        m->n_body_parts = 1;
+        m->user_body_size = sz;
+        m->memfd_body = true;
+
+        return 0;
+}
+
 static int message_parse_fields(sd_bus_message *m) {
-        uint32_t unix_fds = 0;
-        bool unix_fds_set = false;
+        uint32_t unix_fds = 0, memfd_body = 0;
+        bool unix_fds_set = false, memfd_body_set = false;
         int r;
 
         assert(m);
@@ -4144,11 +4541,12 @@ static int message_parse_fields(sd_bus_message *m) {
                         if (r < 0)
                                 return r;
 
-                        c = strdup(s);
+                        c = message_strdup(m, s);
                         if (!c)
                                 return -ENOMEM;
 
-                        free_and_replace(m->root_container.signature, c);
+                        message_mfree(m, m->root_container.signature);
+                        m->root_container.signature = c;
                         break;
                 }
 
@@ -4187,6 +4585,26 @@ static int message_parse_fields(sd_bus_message *m) {
                         unix_fds_set = true;
                         break;
 
+                case BUS_MESSAGE_HEADER_MEMFD_BODY:
+                        /* Like unknown fields, ignore this unless we agreed to it */
+                        if (!m->bus->can_memfd) {
+                                r = message_skip_fields(m, &ri, UINT32_MAX, (const char **) &signature);
+                                break;
+                        }
+
+                        if (memfd_body_set)
+                                return -EBADMSG;
+
+                        if (!streq(signature, "u"))
+                                return -EBADMSG;
+
+                        r = message_peek_field_uint32(m, &ri, item_size, &memfd_body);
+                        if (r < 0)
+                                return -EBADMSG;
+
+                        memfd_body_set = true;
+                        break;
+
                 default:
                         r = message_skip_fields(m, &ri, UINT32_MAX, (const char **) &signature);
                 }
@@ -4194,8 +4612,17 @@ static int message_parse_fields(sd_bus_message *m) {
                         return r;
         }
 
-        if (m->n_fds != unix_fds)
+        /* The fds are sent along with the byte stream, hence when several messages are read at once we may
+         * have received the fds of later messages too. The first ones are ours. */
+        if (m->n_fds < unix_fds)
                 return -EBADMSG;
+        m->n_fds = unix_fds;
+
+        if (memfd_body_set) {
+                r = message_map_memfd_body(m, memfd_body);
+                if (r < 0)
+                        return r;
+        }
 
         switch (m->header->type) {
 
@@ -4285,8 +4712,9 @@ int bus_message_get_blob(sd_bus_message *m, void **buffer, size_t *sz) {
                 return -ENOMEM;
 
         e = mempcpy(p, m->header, BUS_MESSAGE_BODY_BEGIN(m));
-        MESSAGE_FOREACH_PART(part, i, m)
-                e = mempcpy(e, part->data, part->size);
+        if (!m->memfd_body)
+                MESSAGE_FOREACH_PART(part, i, m)
+                        e = mempcpy(e, part->data, part->size);
 
         assert(total == (size_t) ((uint8_t*) e - (uint8_t*) p));
 
@@ -80,6 +80,7 @@ struct sd_bus_message {
         bool free_fds:1;
         bool poisoned:1;
         bool sensitive:1;
+        bool memfd_body:1;
 
         /* The first bytes of the message */
         struct bus_header *header;
@@ -100,7 +101,7 @@ struct sd_bus_message {
         int *fds;
 
         struct bus_container root_container, *containers;
-        size_t n_containers;
+        size_t n_containers, n_containers_allocated;
 
         struct iovec *iovec;
         struct iovec iovec_fixed[2];
@@ -119,6 +120,17 @@ struct sd_bus_message {
         unsigned n_header_offsets;
 
         uint64_t read_counter;
+
+        /* The header, the first body part, the container stack and the signatures are preferably allocated
+         * from this arena, which is allocated together with the message object itself, see
+         * message_malloc() in bus-message.c. */
+        uint8_t *arena;
+        uint32_t arena_size, arena_used, arena_top;
+
+#if BUILD_MODE_DEVELOPER
+        /* The number of heap allocations made for the message object, its header, body and containers */
+        unsigned n_allocations;
+#endif
 };
 
 static inline bool BUS_MESSAGE_NEED_BSWAP(sd_bus_message *m) {
@@ -160,6 +172,8 @@ static inline void* BUS_MESSAGE_FIELDS(sd_bus_message *m) {
 
 int bus_message_get_blob(sd_bus_message *m, void **buffer, size_t *sz);
 
+/* Takes possession of the buffer on success, and of as many of the passed fds as the header of the message
+ * declares, which are the first ones. The fds array itself and the remaining fds stay with the caller. */
 int bus_message_from_malloc(
                 sd_bus *bus,
                 void *buffer,
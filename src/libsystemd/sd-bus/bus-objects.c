@@ -9,6 +9,9 @@
 #include "bus-slot.h"
 #include "bus-type.h"
 #include "missing_capability.h"
+#include "random-util.h"
+#include "set.h"
+#include "siphash24.h"
 #include "string-util.h"
 #include "strv.h"
 
@@ -94,6 +97,34 @@ static int vtable_property_get_userdata(
         return 1;
 }
 
+void bus_node_enumerator_flush(struct node_enumerator *c) {
+        assert(c);
+
+        c->cached_prefix = mfree(c->cached_prefix);
+        c->cached_nodes = strv_free(c->cached_nodes);
+}
+
+static int add_cached_to_set(struct node_enumerator *c, OrderedSet *s) {
+        int r;
+
+        assert(c);
+        assert(s);
+
+        STRV_FOREACH(k, c->cached_nodes) {
+                char *t;
+
+                t = strdup(*k);
+                if (!t)
+                        return -ENOMEM;
+
+                r = ordered_set_consume(s, t);
+                if (r < 0 && r != -EEXIST)
+                        return r;
+        }
+
+        return 0;
+}
+
 static int add_enumerated_to_set(
                 sd_bus *bus,
                 const char *prefix,
@@ -108,12 +139,22 @@ static int add_enumerated_to_set(
         assert(s);
 
         LIST_FOREACH(enumerators, c, first) {
+                _cleanup_strv_free_ char **cached = NULL;
                 char **children = NULL;
+                size_t n_cached = 0;
                 sd_bus_slot *slot;
 
                 if (bus->nodes_modified)
                         return 0;
 
+                if (bus->node_enumerator_cache && streq_ptr(c->cached_prefix, prefix)) {
+                        r = add_cached_to_set(c, s);
+                        if (r < 0)
+                                return r;
+
+                        continue;
+                }
+
                 slot = container_of(c, sd_bus_slot, node_enumerator);
 
                 bus->current_slot = sd_bus_slot_ref(slot);
@@ -144,6 +185,14 @@ static int add_enumerated_to_set(
                                 continue;
                         }
 
+                        if (bus->node_enumerator_cache) {
+                                r = strv_extend_with_size(&cached, &n_cached, *k);
+                                if (r < 0) {
+                                        free(*k);
+                                        continue;
+                                }
+                        }
+
                         r = ordered_set_consume(s, *k);
                         if (r == -EEXIST)
                                 r = 0;
@@ -152,6 +201,25 @@ static int add_enumerated_to_set(
                 free(children);
                 if (r < 0)
                         return r;
+
+                /* If the callback modified the nodes, the enumerator might be gone already, hence don't
+                 * touch it. */
+                if (bus->node_enumerator_cache && !bus->nodes_modified) {
+                        bus_node_enumerator_flush(c);
+
+                        if (!cached) {
+                                /* Distinguish "no children" from "not cached" */
+                                cached = strv_new(NULL);
+                                if (!cached)
+                                        return -ENOMEM;
+                        }
+
+                        c->cached_prefix = strdup(prefix);
+                        if (!c->cached_prefix)
+                                return -ENOMEM;
+
+                        c->cached_nodes = TAKE_PTR(cached);
+                }
         }
 
         return 0;
@@ -2058,6 +2126,81 @@ fail:
         return r;
 }
 
+static void node_flush_enumerators(struct node *n) {
+        if (!n)
+                return;
+
+        LIST_FOREACH(enumerators, c, n->enumerators)
+                bus_node_enumerator_flush(c);
+}
+
+static int bus_flush_node_enumerators(sd_bus *bus, const char *path) {
+        _cleanup_free_ char *prefix = NULL;
+        struct node *n;
+        size_t pl;
+
+        assert(bus);
+
+        /* The caches are empty anyway if caching is off */
+        if (!bus->node_enumerator_cache)
+                return 0;
+
+        if (!path) {
+                HASHMAP_FOREACH(n, bus->nodes)
+                        node_flush_enumerators(n);
+
+                return 0;
+        }
+
+        /* The object might have been returned by the enumerators on the path itself or any of its
+         * prefixes */
+        node_flush_enumerators(hashmap_get(bus->nodes, path));
+
+        pl = strlen(path);
+        assert(pl <= BUS_PATH_SIZE_MAX);
+        prefix = new(char, pl + 1);
+        if (!prefix)
+                return -ENOMEM;
+
+        OBJECT_PATH_FOREACH_PREFIX(prefix, path)
+                node_flush_enumerators(hashmap_get(bus->nodes, prefix));
+
+        return 0;
+}
+
+_public_ int sd_bus_set_node_enumerator_cache(sd_bus *bus, int b) {
+        int r;
+
+        assert_return(bus, -EINVAL);
+        assert_return(bus = bus_resolve(bus), -ENOPKG);
+        assert_return(!bus_origin_changed(bus), -ECHILD);
+
+        if (!b) {
+                r = bus_flush_node_enumerators(bus, NULL);
+                if (r < 0)
+                        return r;
+        }
+
+        bus->node_enumerator_cache = b;
+        return 0;
+}
+
+_public_ int sd_bus_get_node_enumerator_cache(sd_bus *bus) {
+        assert_return(bus, -EINVAL);
+        assert_return(bus = bus_resolve(bus), -ENOPKG);
+
+        return bus->node_enumerator_cache;
+}
+
+_public_ int sd_bus_invalidate_node_enumerators(sd_bus *bus, const char *path) {
+        assert_return(bus, -EINVAL);
+        assert_return(bus = bus_resolve(bus), -ENOPKG);
+        assert_return(!path || object_path_is_valid(path), -EINVAL);
+        assert_return(!bus_origin_changed(bus), -ECHILD);
+
+        return bus_flush_node_enumerators(bus, path);
+}
+
 static int emit_properties_changed_on_interface(
                 sd_bus *bus,
                 const char *prefix,
@@ -2322,6 +2465,377 @@ _public_ int sd_bus_emit_properties_changed_strv(
         return found_interface ? 0 : -ENOENT;
 }
 
+void bus_properties_digest_done(BusPropertiesDigest *d) {
+        assert(d);
+
+        d->values = mfree(d->values);
+        d->n_values = 0;
+}
+
+typedef struct PropertyDigest {
+        const char *name;
+        uint64_t value;
+        bool invalidate;
+} PropertyDigest;
+
+static uint64_t message_body_digest(sd_bus_message *m, size_t begin, size_t end) {
+        static uint8_t key[16];
+        static bool key_initialized = false;
+        struct bus_body_part *part;
+        struct siphash state;
+        size_t offset = 0;
+        unsigned i;
+
+        assert(m);
+        assert(begin <= end);
+
+        /* If the key is initialized concurrently in another thread, the digests calculated before that all
+         * end up different, which just means that all properties are considered changed once. */
+        if (!key_initialized) {
+                random_bytes(key, sizeof(key));
+                key_initialized = true;
+        }
+
+        siphash24_init(&state, key);
+
+        MESSAGE_FOREACH_PART(part, i, m) {
+                size_t a, b;
+
+                if (offset >= end)
+                        break;
+
+                if (offset + part->size > begin) {
+                        a = MAX(begin, offset) - offset;
+                        b = MIN(end, offset + part->size) - offset;
+
+                        if (part->is_zero)
+                                for (size_t k = a; k < b; k++)
+                                        siphash24_compress_byte(0, &state);
+                        else
+                                siphash24_compress((uint8_t*) part->data + a, b - a, &state);
+                }
+
+                offset += part->size;
+        }
+
+        return siphash24_finalize(&state);
+}
+
+static int properties_digest_on_interface(
+                sd_bus *bus,
+                sd_bus_message *m,
+                const char *prefix,
+                const char *path,
+                const char *interface,
+                bool require_fallback,
+                bool *found_interface,
+                PropertyDigest **digests,
+                size_t *n_digests) {
+
+        _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
+        struct node *n;
+        void *u = NULL;
+        int r;
+
+        assert(bus);
+        assert(m);
+        assert(prefix);
+        assert(path);
+        assert(interface);
+        assert(found_interface);
+        assert(digests);
+        assert(n_digests);
+
+        n = hashmap_get(bus->nodes, prefix);
+        if (!n)
+                return 0;
+
+        LIST_FOREACH(vtables, c, n->vtables) {
+                const sd_bus_vtable *v;
+
+                if (require_fallback && !c->is_fallback)
+                        continue;
+
+                if (!streq(c->interface, interface))
+                        continue;
+
+                r = node_vtable_get_userdata(bus, path, c, &u, &error);
+                if (r < 0)
+                        return r;
+                if (bus->nodes_modified)
+                        return 0;
+                if (r == 0)
+                        continue;
+
+                *found_interface = true;
+
+                for (v = bus_vtable_next(c->vtable, c->vtable); v->type != _SD_BUS_VTABLE_END; v = bus_vtable_next(c->vtable, v)) {
+                        PropertyDigest *d;
+                        size_t begin;
+
+                        if (!IN_SET(v->type, _SD_BUS_VTABLE_PROPERTY, _SD_BUS_VTABLE_WRITABLE_PROPERTY))
+                                continue;
+
+                        if (v->flags & SD_BUS_VTABLE_HIDDEN)
+                                continue;
+
+                        if (!(v->flags & (SD_BUS_VTABLE_PROPERTY_EMITS_CHANGE|SD_BUS_VTABLE_PROPERTY_EMITS_INVALIDATION)))
+                                continue;
+
+                        if (!GREEDY_REALLOC(*digests, *n_digests + 1))
+                                return -ENOMEM;
+
+                        d = *digests + (*n_digests)++;
+                        *d = (PropertyDigest) {
+                                .name = v->x.property.member,
+                        };
+
+                        /* Invalidated properties are not included with their value, hence don't bother
+                         * calling their getters */
+                        if (v->flags & SD_BUS_VTABLE_PROPERTY_EMITS_INVALIDATION) {
+                                d->invalidate = true;
+                                continue;
+                        }
+
+                        /* Dictionary entries are always 8 byte aligned, start there so that the digest
+                         * does not depend on the length of the previous property */
+                        begin = ALIGN8(m->body_size);
+
+                        r = vtable_append_one_property(bus, m, path, c, v, u, &error);
+                        if (r < 0)
+                                return r;
+                        if (bus->nodes_modified)
+                                return 0;
+
+                        d->value = message_body_digest(m, begin, m->body_size);
+                }
+        }
+
+        return 0;
+}
+
+int bus_properties_changed(
+                sd_bus *bus,
+                const char *path,
+                const char *interface,
+                BusPropertiesDigest *digest,
+                char ***ret_names) {
+
+        _cleanup_free_ PropertyDigest *digests = NULL;
+        _cleanup_free_ uint64_t *values = NULL;
+        _cleanup_free_ char **names = NULL;
+        _cleanup_free_ char *prefix = NULL;
+        bool found_interface = false, all;
+        size_t n_digests = 0, n_names = 0, pl;
+        int r;
+
+        assert(bus);
+        assert(object_path_is_valid(path));
+        assert(interface_name_is_valid(interface));
+        assert(digest);
+        assert(ret_names);
+
+        BUS_DONT_DESTROY(bus);
+
+        pl = strlen(path);
+        assert(pl <= BUS_PATH_SIZE_MAX);
+        prefix = new(char, pl + 1);
+        if (!prefix)
+                return -ENOMEM;
+
+        do {
+                _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
+
+                bus->nodes_modified = false;
+                found_interface = false;
+                n_digests = 0;
+
+                /* The values are serialized into a message like the one that we'd emit, and then compared
+                 * by their digests */
+                r = sd_bus_message_new_signal(bus, &m, path, "org.freedesktop.DBus.Properties", "PropertiesChanged");
+                if (r < 0)
+                        return r;
+
+                r = sd_bus_message_append(m, "s", interface);
+                if (r < 0)
+                        return r;
+
+                r = sd_bus_message_open_container(m, 'a', "{sv}");
+                if (r < 0)
+                        return r;
+
+                r = properties_digest_on_interface(bus, m, path, path, interface, false, &found_interface, &digests, &n_digests);
+                if (r < 0)
+                        return r;
+                if (bus->nodes_modified)
+                        continue;
+
+                OBJECT_PATH_FOREACH_PREFIX(prefix, path) {
+                        r = properties_digest_on_interface(bus, m, prefix, path, interface, true, &found_interface, &digests, &n_digests);
+                        if (r < 0)
+                                return r;
+                        if (bus->nodes_modified)
+                                break;
+                }
+
+        } while (bus->nodes_modified);
+
+        if (!found_interface)
+                return -ENOENT;
+
+        /* If the properties changed shape, because vtables were added or removed, compare nothing */
+        all = digest->n_values != n_digests;
+
+        if (n_digests > 0) {
+                values = new(uint64_t, n_digests);
+                if (!values)
+                        return -ENOMEM;
+        }
+
+        names = new(char*, n_digests + 1);
+        if (!names)
+                return -ENOMEM;
+
+        for (size_t i = 0; i < n_digests; i++) {
+                values[i] = digests[i].value;
+
+                if (all || digests[i].invalidate || digests[i].value != digest->values[i])
+                        names[n_names++] = (char*) digests[i].name;
+        }
+
+        names[n_names] = NULL;
+
+        free_and_replace(digest->values, values);
+        digest->n_values = n_digests;
+
+        *ret_names = TAKE_PTR(names);
+        return n_names > 0;
+}
+
+static int object_append_properties_on_node(
+                sd_bus *bus,
+                sd_bus_message *m,
+                const char *prefix,
+                const char *path,
+                bool require_fallback,
+                const Set *properties,
+                bool *found_object,
+                sd_bus_error *error) {
+
+        struct node *n;
+        int r;
+
+        assert(bus);
+        assert(m);
+        assert(prefix);
+        assert(path);
+        assert(found_object);
+
+        n = hashmap_get(bus->nodes, prefix);
+        if (!n)
+                return 0;
+
+        LIST_FOREACH(vtables, c, n->vtables) {
+                const sd_bus_vtable *v;
+                void *u;
+
+                if (require_fallback && !c->is_fallback)
+                        continue;
+
+                r = node_vtable_get_userdata(bus, path, c, &u, error);
+                if (r < 0)
+                        return r;
+                if (bus->nodes_modified)
+                        return 0;
+                if (r == 0)
+                        continue;
+
+                *found_object = true;
+
+                if (c->vtable[0].flags & SD_BUS_VTABLE_HIDDEN)
+                        continue;
+
+                for (v = bus_vtable_next(c->vtable, c->vtable); v->type != _SD_BUS_VTABLE_END; v = bus_vtable_next(c->vtable, v)) {
+                        if (!IN_SET(v->type, _SD_BUS_VTABLE_PROPERTY, _SD_BUS_VTABLE_WRITABLE_PROPERTY))
+                                continue;
+
+                        if (v->flags & SD_BUS_VTABLE_HIDDEN)
+                                continue;
+
+                        /* Same as for Get() and GetAll(): explicit properties only if asked for by name */
+                        if (properties) {
+                                if (!set_contains(properties, v->x.property.member))
+                                        continue;
+                        } else if (v->flags & SD_BUS_VTABLE_PROPERTY_EXPLICIT)
+                                continue;
+
+                        r = vtable_append_one_property(bus, m, path, c, v, u, error);
+                        if (r < 0)
+                                return r;
+                        if (bus->nodes_modified)
+                                return 0;
+                }
+        }
+
+        return 0;
+}
+
+int bus_message_append_object_properties(
+                sd_bus *bus,
+                sd_bus_message *m,
+                const char *path,
+                const Set *properties,
+                sd_bus_error *error) {
+
+        _cleanup_free_ char *prefix = NULL;
+        bool found_object = false;
+        size_t pl;
+        int r;
+
+        assert(bus);
+        assert(m);
+        assert(object_path_is_valid(path));
+
+        BUS_DONT_DESTROY(bus);
+
+        pl = strlen(path);
+        assert(pl <= BUS_PATH_SIZE_MAX);
+        prefix = new(char, pl + 1);
+        if (!prefix)
+                return -ENOMEM;
+
+        bus->nodes_modified = false;
+
+        r = sd_bus_message_open_container(m, 'a', "{sv}");
+        if (r < 0)
+                return r;
+
+        /* Like GetAll(), the properties come from the most specific node that has the object */
+        r = object_append_properties_on_node(bus, m, path, path, false, properties, &found_object, error);
+        if (r < 0)
+                return r;
+
+        if (!found_object && !bus->nodes_modified)
+                OBJECT_PATH_FOREACH_PREFIX(prefix, path) {
+                        r = object_append_properties_on_node(bus, m, prefix, path, true, properties, &found_object, error);
+                        if (r < 0)
+                                return r;
+                        if (found_object || bus->nodes_modified)
+                                break;
+                }
+
+        /* Unlike the method call dispatcher we cannot start over once some properties were appended, but
+         * none of our users modify the object tree from their find or property callbacks anyway. */
+        if (bus->nodes_modified)
+                return -EAGAIN;
+
+        r = sd_bus_message_close_container(m);
+        if (r < 0)
+                return r;
+
+        return found_object;
+}
+
 _public_ int sd_bus_emit_properties_changed(
                 sd_bus *bus,
                 const char *path,
@@ -2525,6 +3039,12 @@ _public_ int sd_bus_emit_object_added(sd_bus *bus, const char *path) {
         assert_return(object_path_is_valid(path), -EINVAL);
         assert_return(!bus_origin_changed(bus), -ECHILD);
 
+        /* The object appeared or went away, hence drop what we remember about the enumerators that might
+         * return it */
+        r = bus_flush_node_enumerators(bus, path);
+        if (r < 0)
+                return r;
+
         if (!BUS_IS_OPEN(bus->state))
                 return -ENOTCONN;
 
@@ -2705,6 +3225,12 @@ _public_ int sd_bus_emit_object_removed(sd_bus *bus, const char *path) {
         assert_return(object_path_is_valid(path), -EINVAL);
         assert_return(!bus_origin_changed(bus), -ECHILD);
 
+        /* The object appeared or went away, hence drop what we remember about the enumerators that might
+         * return it */
+        r = bus_flush_node_enumerators(bus, path);
+        if (r < 0)
+                return r;
+
         if (!BUS_IS_OPEN(bus->state))
                 return -ENOTCONN;
 
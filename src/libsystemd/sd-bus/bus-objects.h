@@ -8,6 +8,39 @@ const sd_bus_vtable* bus_vtable_next(const sd_bus_vtable *vtable, const sd_bus_v
 bool bus_vtable_has_names(const sd_bus_vtable *vtable);
 int bus_process_object(sd_bus *bus, sd_bus_message *m);
 void bus_node_gc(sd_bus *b, struct node *n);
+void bus_node_enumerator_flush(struct node_enumerator *c);
+
+/* The digests of the property values of an object's interface, in the order of the vtables */
+typedef struct BusPropertiesDigest {
+        uint64_t *values;
+        size_t n_values;
+} BusPropertiesDigest;
+
+void bus_properties_digest_done(BusPropertiesDigest *d);
+
+/* Returns the names of the properties of the given interface that would be included in a PropertiesChanged
+ * signal and have changed since the last call with the same digest, for use with
+ * sd_bus_emit_properties_changed_strv(). The strings in the returned array are borrowed from the vtables,
+ * hence only the array itself has to be freed. Properties that are only invalidated are always included,
+ * as are all of them on the first call. */
+int bus_properties_changed(
+                sd_bus *bus,
+                const char *path,
+                const char *interface,
+                BusPropertiesDigest *digest,
+                char ***ret_names);
+
+/* Appends an "a{sv}" array with the properties of all interfaces of the object at the given path to the
+ * message, i.e. what a GetAll() call with an empty interface name would return. If properties is not NULL,
+ * only the properties whose names are in the set are included. This allows services to return the
+ * properties of many objects in a single reply. Returns 0 if there is no such object, in which case the
+ * array is empty. */
+int bus_message_append_object_properties(
+                sd_bus *bus,
+                sd_bus_message *m,
+                const char *path,
+                const Set *properties,
+                sd_bus_error *error);
 
 int introspect_path(
                 sd_bus *bus,
@@ -55,7 +55,12 @@ enum {
         BUS_MESSAGE_HEADER_SENDER,
         BUS_MESSAGE_HEADER_SIGNATURE,
         BUS_MESSAGE_HEADER_UNIX_FDS,
-        _BUS_MESSAGE_HEADER_MAX
+        _BUS_MESSAGE_HEADER_MAX,
+
+        /* Our own extension, only used on connections that negotiated it during authentication: the body of
+         * the message is not sent inline, but in a sealed memfd, whose index among the passed fds this
+         * carries. Picked far away from the codes defined by the specification. */
+        BUS_MESSAGE_HEADER_MEMFD_BODY = 0x80,
 };
 
 /* RequestName parameters */
@@ -99,6 +99,8 @@ void bus_slot_disconnect(sd_bus_slot *slot, bool unref) {
                         bus_node_gc(slot->bus, slot->node_enumerator.node);
                 }
 
+                bus_node_enumerator_flush(&slot->node_enumerator);
+
                 break;
 
         case BUS_NODE_OBJECT_MANAGER:
@@ -27,11 +27,20 @@
 #include "signal-util.h"
 #include "stdio-util.h"
 #include "string-util.h"
+#include "unaligned.h"
 #include "user-util.h"
 #include "utf8.h"
 
 #define SNDBUF_SIZE (8*1024*1024)
 
+/* Queued messages without fds are written with a single syscall, up to this many iovecs and bytes */
+#define BUS_WRITE_IOV_MAX 64U
+#define BUS_WRITE_SIZE_MAX (128U*1024U)
+
+/* Unless a larger message is expected, read up to this many bytes at once, so that a burst of small messages
+ * can be read with a single syscall */
+#define BUS_READ_SIZE_MIN (64U*1024U)
+
 static void iovec_advance(struct iovec iov[], unsigned *idx, size_t size) {
 
         while (size > 0) {
@@ -74,8 +83,9 @@ static int bus_message_setup_iovec(sd_bus_message *m) {
 
         assert(!m->iovec);
 
-        n = 1 + m->n_body_parts;
-        if (n < ELEMENTSOF(m->iovec_fixed))
+        /* If the body is passed in a memfd, only the header goes through the socket */
+        n = 1 + (m->memfd_body ? 0 : m->n_body_parts);
+        if (n <= ELEMENTSOF(m->iovec_fixed))
                 m->iovec = m->iovec_fixed;
         else {
                 m->iovec = new(struct iovec, n);
@@ -89,15 +99,16 @@ static int bus_message_setup_iovec(sd_bus_message *m) {
         if (r < 0)
                 goto fail;
 
-        MESSAGE_FOREACH_PART(part, i, m)  {
-                r = bus_body_part_map(part);
-                if (r < 0)
-                        goto fail;
+        if (!m->memfd_body)
+                MESSAGE_FOREACH_PART(part, i, m)  {
+                        r = bus_body_part_map(part);
+                        if (r < 0)
+                                goto fail;
 
-                r = append_iovec(m, part->data, part->size);
-                if (r < 0)
-                        goto fail;
-        }
+                        r = append_iovec(m, part->data, part->size);
+                        if (r < 0)
+                                goto fail;
+                }
 
         assert(n == m->n_iovec);
 
@@ -126,7 +137,7 @@ bool bus_socket_auth_needs_write(sd_bus *b) {
 }
 
 static int bus_socket_auth_verify_client(sd_bus *b) {
-        char *l, *lines[4] = {};
+        char *l, *lines[5] = {};
         sd_id128_t peer;
         size_t i, n;
         int r;
@@ -138,11 +149,12 @@ static int bus_socket_auth_verify_client(sd_bus *b) {
          *   "DATA\r\n"                 (optional)
          *   "OK <server-id>\r\n"
          *   "AGREE_UNIX_FD\r\n"        (optional)
+         *   "AGREE_MEMFD_BODY\r\n"     (optional)
          */
 
         n = 0;
         lines[n] = b->rbuffer;
-        for (i = 0; i < 3; ++i) {
+        for (i = 0; i < 4; ++i) {
                 l = memmem_safe(lines[n], b->rbuffer_size - (lines[n] - (char*) b->rbuffer), "\r\n", 2);
                 if (l)
                         lines[++n] = l + 2;
@@ -157,9 +169,10 @@ static int bus_socket_auth_verify_client(sd_bus *b) {
          * challenge, reply with our own DATA, and expect an OK reply. We do
          * this for EXTERNAL.
          * If FD negotiation was requested, we additionally expect
-         * an AGREE_UNIX_FD response in all cases.
+         * an AGREE_UNIX_FD response in all cases, and the same
+         * applies to memfd body negotiation and AGREE_MEMFD_BODY.
          */
-        if (n < (b->anonymous_auth ? 1U : 2U) + !!b->accept_fd)
+        if (n < (b->anonymous_auth ? 1U : 2U) + !!b->accept_fd + !!b->accept_memfd)
                 return 0; /* wait for more data */
 
         i = 0;
@@ -220,6 +233,13 @@ static int bus_socket_auth_verify_client(sd_bus *b) {
                 b->can_fds = memory_startswith(l, lines[i] - l, "AGREE_UNIX_FD");
         }
 
+        /* And the fourth one. Memfd bodies are useless without fd passing, hence don't take a server by
+         * its word otherwise. */
+        if (b->accept_memfd) {
+                l = lines[i++];
+                b->can_memfd = b->can_fds && memory_startswith(l, lines[i] - l, "AGREE_MEMFD_BODY");
+        }
+
         assert(i == n);
 
         b->rbuffer_size -= (lines[i] - (char*) b->rbuffer);
@@ -470,6 +490,15 @@ static int bus_socket_auth_verify_server(sd_bus *b) {
                                 b->can_fds = true;
                                 r = bus_socket_auth_write(b, "AGREE_UNIX_FD\r\n");
                         }
+                } else if (line_equals(line, l, "NEGOTIATE_MEMFD_BODY")) {
+                        /* Our own extension, see BUS_MESSAGE_HEADER_MEMFD_BODY. Clients only send this
+                         * after NEGOTIATE_UNIX_FD, hence we know by now whether fds may be passed. */
+                        if (b->auth == _BUS_AUTH_INVALID || !b->accept_memfd || !b->can_fds)
+                                r = bus_socket_auth_write(b, "ERROR\r\n");
+                        else {
+                                b->can_memfd = true;
+                                r = bus_socket_auth_write(b, "AGREE_MEMFD_BODY\r\n");
+                        }
                 } else
                         r = bus_socket_auth_write(b, "ERROR\r\n");
 
@@ -714,6 +743,9 @@ static int bus_socket_start_auth_client(sd_bus *b) {
         static const char sasl_negotiate_unix_fd[] = {
                 "NEGOTIATE_UNIX_FD\r\n"
         };
+        static const char sasl_negotiate_memfd_body[] = {
+                "NEGOTIATE_MEMFD_BODY\r\n"
+        };
         static const char sasl_begin[] = {
                 "BEGIN\r\n"
         };
@@ -729,6 +761,9 @@ static int bus_socket_start_auth_client(sd_bus *b) {
         if (b->accept_fd)
                 b->auth_iovec[i++] = IOVEC_MAKE_STRING(sasl_negotiate_unix_fd);
 
+        if (b->accept_memfd)
+                b->auth_iovec[i++] = IOVEC_MAKE_STRING(sasl_negotiate_memfd_body);
+
         b->auth_iovec[i++] = IOVEC_MAKE_STRING(sasl_begin);
 
         return bus_socket_write_auth(b);
@@ -749,6 +784,11 @@ int bus_socket_start_auth(sd_bus *b) {
                 if (sd_is_socket(b->output_fd, AF_UNIX, 0, 0) <= 0)
                         b->accept_fd = false;
 
+        /* Memfd bodies need fd passing, and are only offered to peers, which are likely to be sd-bus too,
+         * never to brokers, which do not know the extension. */
+        if (!b->accept_fd || b->bus_client)
+                b->accept_memfd = false;
+
         if (b->is_server)
                 return bus_socket_read_auth(b);
         else
@@ -1181,6 +1221,45 @@ int bus_socket_take_fd(sd_bus *b) {
         return bus_socket_start_auth(b);
 }
 
+static ssize_t bus_socket_write_iovec(sd_bus *bus, struct iovec *iov, size_t n_iov, const int *fds, size_t n_fds) {
+        ssize_t k;
+
+        assert(bus);
+        assert(iov);
+
+        if (bus->prefer_writev)
+                k = writev(bus->output_fd, iov, n_iov);
+        else {
+                struct msghdr mh = {
+                        .msg_iov = iov,
+                        .msg_iovlen = n_iov,
+                };
+
+                if (n_fds > 0) {
+                        struct cmsghdr *control;
+
+                        mh.msg_controllen = CMSG_SPACE(sizeof(int) * n_fds);
+                        mh.msg_control = alloca0(mh.msg_controllen);
+                        control = CMSG_FIRSTHDR(&mh);
+                        control->cmsg_len = CMSG_LEN(sizeof(int) * n_fds);
+                        control->cmsg_level = SOL_SOCKET;
+                        control->cmsg_type = SCM_RIGHTS;
+                        memcpy(CMSG_DATA(control), fds, sizeof(int) * n_fds);
+                }
+
+                k = sendmsg(bus->output_fd, &mh, MSG_DONTWAIT|MSG_NOSIGNAL);
+                if (k < 0 && errno == ENOTSOCK) {
+                        bus->prefer_writev = true;
+                        k = writev(bus->output_fd, iov, n_iov);
+                }
+        }
+
+        if (k < 0)
+                return ERRNO_IS_TRANSIENT(errno) ? 0 : -errno;
+
+        return k;
+}
+
 int bus_socket_write_message(sd_bus *bus, sd_bus_message *m, size_t *idx) {
         struct iovec *iov;
         ssize_t k;
@@ -1207,50 +1286,86 @@ int bus_socket_write_message(sd_bus *bus, sd_bus_message *m, size_t *idx) {
         j = 0;
         iovec_advance(iov, &j, *idx);
 
-        if (bus->prefer_writev)
-                k = writev(bus->output_fd, iov, m->n_iovec);
-        else {
-                struct msghdr mh = {
-                        .msg_iov = iov,
-                        .msg_iovlen = m->n_iovec,
-                };
+        k = bus_socket_write_iovec(bus, iov, m->n_iovec, m->fds, *idx == 0 ? m->n_fds : 0);
+        if (k <= 0)
+                return (int) k;
 
-                if (m->n_fds > 0 && *idx == 0) {
-                        struct cmsghdr *control;
+        *idx += (size_t) k;
+        return 1;
+}
 
-                        mh.msg_controllen = CMSG_SPACE(sizeof(int) * m->n_fds);
-                        mh.msg_control = alloca0(mh.msg_controllen);
-                        control = CMSG_FIRSTHDR(&mh);
-                        control->cmsg_len = CMSG_LEN(sizeof(int) * m->n_fds);
-                        control->cmsg_level = SOL_SOCKET;
-                        control->cmsg_type = SCM_RIGHTS;
-                        memcpy(CMSG_DATA(control), m->fds, sizeof(int) * m->n_fds);
+/* Like bus_socket_write_message(), but writes the following messages along with the first one. *idx is the
+ * offset into all of them. */
+int bus_socket_write_messages(sd_bus *bus, sd_bus_message **messages, size_t n_messages, size_t *idx) {
+        struct iovec iov[BUS_WRITE_IOV_MAX];
+        size_t n_iov = 0, size = 0;
+        ssize_t k;
+        unsigned j;
+        int r;
+
+        assert(bus);
+        assert(messages);
+        assert(n_messages > 0);
+        assert(idx);
+        assert(IN_SET(bus->state, BUS_RUNNING, BUS_HELLO));
+
+        /* Messages with fds are written on their own, since the fds are sent along with the first byte
+         * written. So is a message that is written partially already, if it is too large to be combined
+         * with others anyway. */
+        if (n_messages == 1 || messages[0]->n_fds > 0 || BUS_MESSAGE_SIZE(messages[0]) >= BUS_WRITE_SIZE_MAX)
+                return bus_socket_write_message(bus, messages[0], idx);
+
+        if (*idx >= BUS_MESSAGE_SIZE(messages[0]))
+                return 0;
+
+        for (size_t i = 0; i < n_messages; i++) {
+                sd_bus_message *m = messages[i];
+
+                if (i > 0 && (m->n_fds > 0 || size + BUS_MESSAGE_SIZE(m) > BUS_WRITE_SIZE_MAX))
+                        break;
+
+                r = bus_message_setup_iovec(m);
+                if (r < 0) {
+                        if (i == 0)
+                                return r;
+
+                        break; /* Let's fail on it when it is first in line */
                 }
 
-                k = sendmsg(bus->output_fd, &mh, MSG_DONTWAIT|MSG_NOSIGNAL);
-                if (k < 0 && errno == ENOTSOCK) {
-                        bus->prefer_writev = true;
-                        k = writev(bus->output_fd, iov, m->n_iovec);
+                if (n_iov + m->n_iovec > ELEMENTSOF(iov)) {
+                        if (i == 0)
+                                return bus_socket_write_message(bus, m, idx);
+
+                        break;
                 }
+
+                memcpy(iov + n_iov, m->iovec, m->n_iovec * sizeof(struct iovec));
+                n_iov += m->n_iovec;
+                size += BUS_MESSAGE_SIZE(m);
         }
 
-        if (k < 0)
-                return ERRNO_IS_TRANSIENT(errno) ? 0 : -errno;
+        assert(n_iov > 0);
+
+        j = 0;
+        iovec_advance(iov, &j, *idx);
+
+        k = bus_socket_write_iovec(bus, iov + j, n_iov - j, NULL, 0);
+        if (k <= 0)
+                return (int) k;
 
         *idx += (size_t) k;
         return 1;
 }
 
-static int bus_socket_read_message_need(sd_bus *bus, size_t *need) {
+static int bus_socket_read_message_need(const void *p, size_t size, size_t *need) {
         uint32_t a, b;
         uint8_t e;
         uint64_t sum;
 
-        assert(bus);
+        assert(p || size == 0);
         assert(need);
-        assert(IN_SET(bus->state, BUS_RUNNING, BUS_HELLO));
 
-        if (bus->rbuffer_size < sizeof(struct bus_header)) {
+        if (size < sizeof(struct bus_header)) {
                 *need = sizeof(struct bus_header) + 8;
 
                 /* Minimum message size:
@@ -1272,10 +1387,10 @@ static int bus_socket_read_message_need(sd_bus *bus, size_t *need) {
                 return 0;
         }
 
-        a = ((const uint32_t*) bus->rbuffer)[1];
-        b = ((const uint32_t*) bus->rbuffer)[3];
+        a = unaligned_read_ne32((const uint8_t*) p + 4);
+        b = unaligned_read_ne32((const uint8_t*) p + 12);
 
-        e = ((const uint8_t*) bus->rbuffer)[0];
+        e = ((const uint8_t*) p)[0];
         if (e == BUS_LITTLE_ENDIAN) {
                 a = le32toh(a);
                 b = le32toh(b);
@@ -1293,54 +1408,124 @@ static int bus_socket_read_message_need(sd_bus *bus, size_t *need) {
         return 0;
 }
 
-static int bus_socket_make_message(sd_bus *bus, size_t size) {
+static int bus_socket_make_message(sd_bus *bus, size_t offset, size_t size) {
         sd_bus_message *t = NULL;
         void *b;
         int r;
 
         assert(bus);
-        assert(bus->rbuffer_size >= size);
+        assert(bus->rbuffer_size >= offset + size);
         assert(IN_SET(bus->state, BUS_RUNNING, BUS_HELLO));
 
         r = bus_rqueue_make_room(bus);
         if (r < 0)
                 return r;
 
-        if (bus->rbuffer_size > size) {
-                b = memdup((const uint8_t*) bus->rbuffer + size,
-                           bus->rbuffer_size - size);
+        if (offset == 0 && size == bus->rbuffer_size) {
+                /* The message is all there is in the buffer, let's pass the buffer on, after shrinking it
+                 * to size, which is cheap. */
+                b = realloc(bus->rbuffer, size) ?: bus->rbuffer;
+                bus->rbuffer = NULL;
+                bus->rbuffer_size = 0;
+        } else {
+                b = memdup((const uint8_t*) bus->rbuffer + offset, size);
                 if (!b)
                         return -ENOMEM;
-        } else
-                b = NULL;
+        }
 
         r = bus_message_from_malloc(bus,
-                                    bus->rbuffer, size,
+                                    b, size,
                                     bus->fds, bus->n_fds,
                                     NULL,
                                     &t);
         if (r == -EBADMSG) {
                 log_debug_errno(r, "Received invalid message from connection %s, dropping.", strna(bus->description));
-                free(bus->rbuffer); /* We want to drop current rbuffer and proceed with whatever remains in b */
-        } else if (r < 0) {
                 free(b);
+
+                /* We cannot tell which of the fds belong to the message, hence drop them all */
+                close_many(bus->fds, bus->n_fds);
+                bus->fds = mfree(bus->fds);
+                bus->n_fds = 0;
+                return 1;
+        }
+        if (r < 0) {
+                /* Put the buffer back, if we took it */
+                if (!bus->rbuffer) {
+                        bus->rbuffer = b;
+                        bus->rbuffer_size = size;
+                } else
+                        free(b);
+
                 return r;
         }
 
-        /* rbuffer ownership was either transferred to t, or we got EBADMSG and dropped it. */
-        bus->rbuffer = b;
-        bus->rbuffer_size -= size;
+        /* Drop the fds the message took ownership of */
+        if (t->n_fds > 0) {
+                assert(t->n_fds <= bus->n_fds);
+                bus->n_fds -= t->n_fds;
+                memmove(bus->fds, bus->fds + t->n_fds, sizeof(int) * bus->n_fds);
+                if (bus->n_fds == 0)
+                        bus->fds = mfree(bus->fds);
+        }
+
+        t->read_counter = ++bus->read_counter;
+        bus->rqueue[bus->rqueue_size++] = bus_message_ref_queued(t, bus);
+        sd_bus_message_unref(t);
+
+        return 1;
+}
 
-        bus->fds = NULL;
-        bus->n_fds = 0;
+static int bus_socket_make_messages(sd_bus *bus) {
+        size_t offset = 0;
+        int r = 0, ret = 0;
 
-        if (t) {
-                t->read_counter = ++bus->read_counter;
-                bus->rqueue[bus->rqueue_size++] = bus_message_ref_queued(t, bus);
-                sd_bus_message_unref(t);
+        assert(bus);
+
+        /* Turns all complete messages in the read buffer into message objects */
+
+        while (bus->rbuffer && offset < bus->rbuffer_size) {
+                size_t need;
+
+                r = bus_socket_read_message_need((const uint8_t*) bus->rbuffer + offset, bus->rbuffer_size - offset, &need);
+                if (r < 0)
+                        break;
+
+                if (bus->rbuffer_size - offset < need)
+                        break;
+
+                r = bus_socket_make_message(bus, offset, need);
+                if (r < 0)
+                        break;
+
+                offset += need;
+                ret = 1;
         }
 
-        return 1;
+        /* Move what remains to the front, or release the buffer if nothing remains */
+        if (bus->rbuffer) {
+                assert(offset <= bus->rbuffer_size);
+
+                bus->rbuffer_size -= offset;
+                if (bus->rbuffer_size == 0)
+                        bus->rbuffer = mfree(bus->rbuffer);
+                else if (offset > 0)
+                        memmove(bus->rbuffer, (uint8_t*) bus->rbuffer + offset, bus->rbuffer_size);
+        }
+
+        /* If nothing remains, any fds left over have been sent by the peer without a message asking for them */
+        if (bus->rbuffer_size == 0 && bus->n_fds > 0) {
+                log_debug("Received %zu unexpected file descriptors on connection %s, closing.",
+                          bus->n_fds, strna(bus->description));
+                close_many(bus->fds, bus->n_fds);
+                bus->fds = mfree(bus->fds);
+                bus->n_fds = 0;
+        }
+
+        /* Report errors only if we made no progress, they are hit again on the next invocation otherwise */
+        if (ret == 0 && r < 0)
+                return r;
+
+        return ret;
 }
 
 int bus_socket_read_message(sd_bus *bus) {
@@ -1356,12 +1541,17 @@ int bus_socket_read_message(sd_bus *bus) {
         assert(bus);
         assert(IN_SET(bus->state, BUS_RUNNING, BUS_HELLO));
 
-        r = bus_socket_read_message_need(bus, &need);
+        /* Process what we read previously first */
+        r = bus_socket_make_messages(bus);
+        if (r != 0)
+                return r;
+
+        r = bus_socket_read_message_need(bus->rbuffer, bus->rbuffer_size, &need);
         if (r < 0)
                 return r;
 
-        if (bus->rbuffer_size >= need)
-                return bus_socket_make_message(bus, need);
+        assert(bus->rbuffer_size < need);
+        need = MAX(need, (size_t) BUS_READ_SIZE_MIN);
 
         b = realloc(bus->rbuffer, need);
         if (!b)
@@ -1437,13 +1627,10 @@ int bus_socket_read_message(sd_bus *bus) {
                                           cmsg->cmsg_level, cmsg->cmsg_type);
         }
 
-        r = bus_socket_read_message_need(bus, &need);
+        r = bus_socket_make_messages(bus);
         if (r < 0)
                 return r;
 
-        if (bus->rbuffer_size >= need)
-                return bus_socket_make_message(bus, need);
-
         return 1;
 }
 
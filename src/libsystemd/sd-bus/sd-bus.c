@@ -234,6 +234,11 @@ static sd_bus* bus_free(sd_bus *b) {
 
         bus_flush_memfd(b);
 
+        if (b->n_creds_cache_hits > 0 || b->n_creds_cache_misses > 0)
+                log_debug("Bus %s: sender credentials cache had %" PRIu64 " hits and %" PRIu64 " misses.",
+                          strna(b->description), b->n_creds_cache_hits, b->n_creds_cache_misses);
+        bus_flush_creds_cache(b);
+
         assert_se(pthread_mutex_destroy(&b->memfd_cache_mutex) == 0);
 
         return mfree(b);
@@ -356,6 +361,16 @@ _public_ int sd_bus_negotiate_fds(sd_bus *bus, int b) {
         return 0;
 }
 
+_public_ int sd_bus_negotiate_memfd(sd_bus *bus, int b) {
+        assert_return(bus, -EINVAL);
+        assert_return(bus = bus_resolve(bus), -ENOPKG);
+        assert_return(bus->state == BUS_UNSET, -EPERM);
+        assert_return(!bus_origin_changed(bus), -ECHILD);
+
+        bus->accept_memfd = b;
+        return 0;
+}
+
 _public_ int sd_bus_negotiate_timestamp(sd_bus *bus, int b) {
         assert_return(bus, -EINVAL);
         assert_return(bus = bus_resolve(bus), -ENOPKG);
@@ -1808,6 +1823,9 @@ _public_ void sd_bus_close(sd_bus *bus) {
          * the bus object and the bus may be freed */
         bus_reset_queues(bus);
 
+        /* Unique names are only unique on one connection */
+        bus_flush_creds_cache(bus);
+
         bus_close_fds(bus);
 }
 
@@ -2017,6 +2035,10 @@ static int bus_remarshal_message(sd_bus *b, sd_bus_message **m) {
         if (b->message_endian != 0 && b->message_endian != (*m)->header->endian)
                 remarshal = true;
 
+        /* body in a memfd, but the connection doesn't know about that */
+        if ((*m)->memfd_body && !b->can_memfd)
+                remarshal = true;
+
         return remarshal ? bus_message_remarshal(b, m) : 0;
 }
 
@@ -2042,18 +2064,10 @@ int bus_seal_synthetic_message(sd_bus *b, sd_bus_message *m) {
         return sd_bus_message_seal(m, UINT32_MAX, 0);
 }
 
-static int bus_write_message(sd_bus *bus, sd_bus_message *m, size_t *idx) {
-        int r;
-
-        assert(bus);
+static void log_debug_bus_message_sent(sd_bus_message *m) {
         assert(m);
 
-        r = bus_socket_write_message(bus, m, idx);
-        if (r <= 0)
-                return r;
-
-        if (*idx >= BUS_MESSAGE_SIZE(m))
-                log_debug("Sent message type=%s sender=%s destination=%s path=%s interface=%s member=%s"
+        log_debug("Sent message type=%s sender=%s destination=%s path=%s interface=%s member=%s"
                           " cookie=%" PRIu64 " reply_cookie=%" PRIu64
                           " signature=%s error-name=%s error-message=%s",
                           bus_message_type_to_string(m->header->type),
@@ -2067,6 +2081,20 @@ static int bus_write_message(sd_bus *bus, sd_bus_message *m, size_t *idx) {
                           strna(m->root_container.signature),
                           strna(m->error.name),
                           strna(m->error.message));
+}
+
+static int bus_write_message(sd_bus *bus, sd_bus_message *m, size_t *idx) {
+        int r;
+
+        assert(bus);
+        assert(m);
+
+        r = bus_socket_write_message(bus, m, idx);
+        if (r <= 0)
+                return r;
+
+        if (*idx >= BUS_MESSAGE_SIZE(m))
+                log_debug_bus_message_sent(m);
 
         return r;
 }
@@ -2078,29 +2106,28 @@ static int dispatch_wqueue(sd_bus *bus) {
         assert(IN_SET(bus->state, BUS_RUNNING, BUS_HELLO));
 
         while (bus->wqueue_size > 0) {
+                size_t n = 0;
 
-                r = bus_write_message(bus, bus->wqueue[0], &bus->windex);
+                /* Write as many of the queued messages at once as we can */
+                r = bus_socket_write_messages(bus, bus->wqueue, bus->wqueue_size, &bus->windex);
                 if (r < 0)
                         return r;
-                else if (r == 0)
+                if (r == 0)
                         /* Didn't do anything this time */
                         return ret;
-                else if (bus->windex >= BUS_MESSAGE_SIZE(bus->wqueue[0])) {
-                        /* Fully written. Let's drop the entry from
-                         * the queue.
-                         *
-                         * This isn't particularly optimized, but
-                         * well, this is supposed to be our worst-case
-                         * buffer only, and the socket buffer is
-                         * supposed to be our primary buffer, and if
-                         * it got full, then all bets are off
-                         * anyway. */
-
-                        bus->wqueue_size--;
-                        bus_message_unref_queued(bus->wqueue[0], bus);
-                        memmove(bus->wqueue, bus->wqueue + 1, sizeof(sd_bus_message*) * bus->wqueue_size);
-                        bus->windex = 0;
 
+                /* Drop the fully written entries from the queue. The index is relative to the first entry
+                 * that is left. */
+                while (n < bus->wqueue_size && bus->windex >= BUS_MESSAGE_SIZE(bus->wqueue[n])) {
+                        bus->windex -= BUS_MESSAGE_SIZE(bus->wqueue[n]);
+                        log_debug_bus_message_sent(bus->wqueue[n]);
+                        bus_message_unref_queued(bus->wqueue[n], bus);
+                        n++;
+                }
+
+                if (n > 0) {
+                        bus->wqueue_size -= n;
+                        memmove(bus->wqueue, bus->wqueue + n, sizeof(sd_bus_message*) * bus->wqueue_size);
                         ret = 1;
                 }
         }
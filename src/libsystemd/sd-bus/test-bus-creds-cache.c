@@ -0,0 +1,142 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <sys/socket.h>
+
+#include "sd-bus.h"
+#include "sd-id128.h"
+
+#include "bus-internal.h"
+#include "fd-util.h"
+#include "tests.h"
+
+static int method_query(sd_bus_message *m, void *userdata, sd_bus_error *error) {
+        _cleanup_(sd_bus_creds_unrefp) sd_bus_creds *creds = NULL;
+        uint64_t mask;
+
+        ASSERT_OK(sd_bus_message_read(m, "t", &mask));
+        ASSERT_OK(sd_bus_query_sender_creds(m, mask, &creds));
+
+        /* Augmented fields must not be handed out to callers that didn't ask for them */
+        if (!(mask & SD_BUS_CREDS_AUGMENT))
+                ASSERT_EQ(sd_bus_creds_get_augmented_mask(creds) & mask, 0u);
+
+        return sd_bus_reply_method_return(m, "t", sd_bus_creds_get_mask(creds) & mask);
+}
+
+static const sd_bus_vtable vtable[] = {
+        SD_BUS_VTABLE_START(0),
+        SD_BUS_METHOD("Query", "t", "t", method_query, 0),
+        SD_BUS_VTABLE_END
+};
+
+static void setup(sd_bus **ret_server, sd_bus **ret_client) {
+        _cleanup_(sd_bus_flush_close_unrefp) sd_bus *server = NULL, *client = NULL;
+        _cleanup_close_pair_ int pair[2] = EBADF_PAIR;
+        sd_id128_t id;
+
+        ASSERT_OK_ERRNO(socketpair(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC|SOCK_NONBLOCK, 0, pair));
+        ASSERT_OK(sd_id128_randomize(&id));
+
+        ASSERT_OK(sd_bus_new(&server));
+        ASSERT_OK(sd_bus_set_fd(server, pair[0], pair[0]));
+        TAKE_FD(pair[0]);
+        ASSERT_OK(sd_bus_set_server(server, true, id));
+        ASSERT_OK(sd_bus_set_anonymous(server, true));
+        ASSERT_OK(sd_bus_start(server));
+
+        ASSERT_OK(sd_bus_new(&client));
+        ASSERT_OK(sd_bus_set_fd(client, pair[1], pair[1]));
+        TAKE_FD(pair[1]);
+        ASSERT_OK(sd_bus_set_anonymous(client, true));
+        ASSERT_OK(sd_bus_start(client));
+
+        while (server->state != BUS_RUNNING || client->state != BUS_RUNNING) {
+                ASSERT_OK(sd_bus_process(server, NULL));
+                ASSERT_OK(sd_bus_process(client, NULL));
+        }
+
+        *ret_server = TAKE_PTR(server);
+        *ret_client = TAKE_PTR(client);
+}
+
+static int reply_handler(sd_bus_message *m, void *userdata, sd_bus_error *error) {
+        sd_bus_message **reply = ASSERT_PTR(userdata);
+
+        ASSERT_FALSE(sd_bus_message_is_method_error(m, NULL));
+        *reply = sd_bus_message_ref(m);
+        return 0;
+}
+
+static uint64_t query(sd_bus *server, sd_bus *client, uint64_t mask) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        uint64_t got;
+
+        /* Both ends are in the same thread, hence we cannot use sd_bus_call() */
+        ASSERT_OK(sd_bus_call_method_async(client, NULL, NULL, "/org/example", "org.example.Creds", "Query",
+                                           reply_handler, &reply, "t", mask));
+
+        while (!reply) {
+                int r, k;
+
+                r = sd_bus_process(server, NULL);
+                ASSERT_OK(r);
+                k = sd_bus_process(client, NULL);
+                ASSERT_OK(k);
+
+                if (r == 0 && k == 0 && !reply)
+                        ASSERT_OK(sd_bus_wait(server, 10 * USEC_PER_MSEC));
+        }
+
+        ASSERT_OK(sd_bus_message_read(reply, "t", &got));
+        return got;
+}
+
+TEST(creds_cache) {
+        _cleanup_(sd_bus_flush_close_unrefp) sd_bus *server = NULL, *client = NULL;
+
+        setup(&server, &client);
+        ASSERT_OK(sd_bus_add_object_vtable(server, NULL, "/org/example", "org.example.Creds", vtable, NULL));
+
+        /* Without caching, nothing is remembered */
+        ASSERT_EQ(sd_bus_get_creds_cache(server), 0);
+        ASSERT_EQ(query(server, client, SD_BUS_CREDS_EUID), SD_BUS_CREDS_EUID);
+        ASSERT_EQ(query(server, client, SD_BUS_CREDS_EUID), SD_BUS_CREDS_EUID);
+        ASSERT_EQ(server->n_creds_cache_hits, 0u);
+        ASSERT_EQ(server->n_creds_cache_misses, 0u);
+
+        ASSERT_OK(sd_bus_set_creds_cache(server, true));
+        ASSERT_GT(sd_bus_get_creds_cache(server), 0);
+
+        /* The peer's credentials are acquired once, and then reused */
+        ASSERT_EQ(query(server, client, SD_BUS_CREDS_EUID), SD_BUS_CREDS_EUID);
+        ASSERT_EQ(server->n_creds_cache_misses, 1u);
+        ASSERT_EQ(query(server, client, SD_BUS_CREDS_EUID), SD_BUS_CREDS_EUID);
+        ASSERT_EQ(server->n_creds_cache_hits, 1u);
+
+        /* Asking for more than what is cached acquires them again */
+        ASSERT_EQ(query(server, client, SD_BUS_CREDS_EUID|SD_BUS_CREDS_EGID), SD_BUS_CREDS_EUID|SD_BUS_CREDS_EGID);
+        ASSERT_EQ(server->n_creds_cache_misses, 2u);
+        ASSERT_EQ(query(server, client, SD_BUS_CREDS_EGID), SD_BUS_CREDS_EGID);
+        ASSERT_EQ(server->n_creds_cache_hits, 2u);
+
+        /* Augmented data is only reused if we can validate it via the pidfd, and never handed out to
+         * callers that don't want augmented data */
+        server->is_local = true; /* Augmenting is only done for local peers */
+        ASSERT_EQ(query(server, client, SD_BUS_CREDS_COMM|SD_BUS_CREDS_AUGMENT), SD_BUS_CREDS_COMM);
+        ASSERT_EQ(server->n_creds_cache_misses, 3u);
+        ASSERT_EQ(query(server, client, SD_BUS_CREDS_COMM|SD_BUS_CREDS_AUGMENT), SD_BUS_CREDS_COMM);
+        if (server->pidfd >= 0)
+                ASSERT_EQ(server->n_creds_cache_hits, 3u);
+        else
+                ASSERT_EQ(server->n_creds_cache_misses, 4u);
+
+        server->n_creds_cache_hits = server->n_creds_cache_misses = 0;
+        (void) query(server, client, SD_BUS_CREDS_COMM);
+        ASSERT_EQ(server->n_creds_cache_hits, 0u);
+        ASSERT_EQ(server->n_creds_cache_misses, 1u);
+
+        ASSERT_OK(sd_bus_set_creds_cache(server, false));
+        ASSERT_NULL(server->creds_cache);
+}
+
+DEFINE_TEST_MAIN(LOG_DEBUG);
@@ -0,0 +1,120 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <sys/socket.h>
+
+#include "alloc-util.h"
+#include "bus-match.h"
+#include "bus-message.h"
+#include "bus-slot.h"
+#include "fd-util.h"
+#include "log.h"
+#include "parse-util.h"
+#include "stdio-util.h"
+#include "tests.h"
+#include "time-util.h"
+
+/* This program measures the cost of matching a message against the installed matches, as a function of the
+ * number of matches. The matches resemble those of a client that watches many objects, they match on the
+ * object path, the sender, a path namespace or the namespace of the first argument in turn. Only a
+ * handful of them match the message. */
+
+static unsigned arg_n_messages = 100000;
+
+static unsigned n_called = 0;
+
+static int filter(sd_bus_message *m, void *userdata, sd_bus_error *ret_error) {
+        n_called++;
+        return 0;
+}
+
+static void match_add(sd_bus_slot *s, struct bus_match_node *root, const char *match) {
+        struct bus_match_component *components;
+        size_t n_components;
+
+        ASSERT_OK(bus_match_parse(match, &components, &n_components));
+        CLEANUP_ARRAY(components, n_components, bus_match_parse_free);
+
+        s->match_callback.callback = filter;
+        ASSERT_OK(bus_match_add(root, components, n_components, &s->match_callback));
+}
+
+static void benchmark(sd_bus *bus, unsigned n_matches) {
+        _cleanup_(bus_match_free) struct bus_match_node root = {
+                .type = BUS_MATCH_ROOT,
+        };
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
+        _cleanup_free_ sd_bus_slot *slots = NULL;
+        char scenario[STRLEN("match/") + DECIMAL_STR_MAX(unsigned)];
+        usec_t start, elapsed;
+
+        ASSERT_NOT_NULL(slots = new0(sd_bus_slot, n_matches));
+
+        for (unsigned i = 0; i < n_matches; i++) {
+                _cleanup_free_ char *match = NULL;
+
+                switch (i % 4) {
+
+                case 0:
+                        ASSERT_OK(asprintf(&match,
+                                           "type='signal',interface='org.freedesktop.DBus.Properties',"
+                                           "path='/org/example/object%u'", i));
+                        break;
+
+                case 1:
+                        ASSERT_OK(asprintf(&match, "type='signal',sender=':1.%u',member='Changed'", i));
+                        break;
+
+                case 2:
+                        ASSERT_OK(asprintf(&match, "type='signal',path_namespace='/org/example/object%u'", i));
+                        break;
+
+                case 3:
+                        ASSERT_OK(asprintf(&match, "type='signal',arg0namespace='org.example.Object%u'", i));
+                        break;
+                }
+
+                match_add(slots + i, &root, match);
+        }
+
+        ASSERT_OK(sd_bus_message_new_signal(bus, &m, "/org/example/object6/child",
+                                            "org.freedesktop.DBus.Properties", "Changed"));
+        ASSERT_OK(sd_bus_message_append(m, "s", "org.example.Object11.Child"));
+        ASSERT_OK(sd_bus_message_set_sender(m, ":1.5"));
+        ASSERT_OK(sd_bus_message_seal(m, 1, 0));
+
+        n_called = 0;
+
+        start = now(CLOCK_MONOTONIC);
+        for (unsigned i = 0; i < arg_n_messages; i++)
+                ASSERT_OK(bus_match_run(NULL, &root, m));
+        elapsed = now(CLOCK_MONOTONIC) - start;
+
+        /* path_namespace='/org/example/object6', arg0namespace='org.example.Object11' and sender=':1.5' */
+        ASSERT_EQ(n_called, (n_matches > 11 ? 3u : n_matches > 6 ? 2u : n_matches > 5 ? 1u : 0u) * arg_n_messages);
+
+        xsprintf(scenario, "match/%u", n_matches);
+        benchmark_report(scenario, arg_n_messages, elapsed);
+}
+
+int main(int argc, char *argv[]) {
+        _cleanup_(sd_bus_flush_close_unrefp) sd_bus *bus = NULL;
+        _cleanup_close_pair_ int pair[2] = EBADF_PAIR;
+        unsigned n;
+
+        test_setup_logging(LOG_INFO);
+
+        if (argc >= 2)
+                ASSERT_OK(safe_atou(argv[1], &arg_n_messages));
+
+        /* Messages can only be created on a bus object that is started, but it needs no peer for that */
+        ASSERT_OK_ERRNO(socketpair(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0, pair));
+        ASSERT_OK(sd_bus_new(&bus));
+        ASSERT_OK(sd_bus_set_fd(bus, pair[0], pair[0]));
+        TAKE_FD(pair[0]);
+        ASSERT_OK(sd_bus_start(bus));
+
+        FOREACH_ARGUMENT(n, 10u, 100u, 1000u, 10000u, 50000u)
+                benchmark(bus, n);
+
+        return 0;
+}
@@ -0,0 +1,166 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <sys/socket.h>
+
+#include "sd-bus.h"
+
+#include "alloc-util.h"
+#include "bus-message.h"
+#include "fd-util.h"
+#include "string-util.h"
+#include "tests.h"
+
+static sd_bus* bus_new_started(void) {
+        _cleanup_close_pair_ int pair[2] = EBADF_PAIR;
+        sd_bus *bus;
+
+        /* Messages can only be created on a bus object that is started, but it needs no peer for that */
+        ASSERT_OK_ERRNO(socketpair(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0, pair));
+        ASSERT_OK(sd_bus_new(&bus));
+        ASSERT_OK(sd_bus_set_fd(bus, pair[0], pair[0]));
+        TAKE_FD(pair[0]);
+        ASSERT_OK(sd_bus_start(bus));
+
+        return bus;
+}
+
+static void assert_n_allocations(sd_bus_message *m, unsigned max) {
+#if BUILD_MODE_DEVELOPER
+        log_debug("Message has %u allocations.", m->n_allocations);
+        ASSERT_LE(m->n_allocations, max);
+#endif
+}
+
+static void append_properties_changed(sd_bus_message *m, unsigned n_properties) {
+        ASSERT_OK(sd_bus_message_append(m, "s", "org.freedesktop.systemd1.Unit"));
+        ASSERT_OK(sd_bus_message_open_container(m, 'a', "{sv}"));
+
+        for (unsigned i = 0; i < n_properties; i++) {
+                char name[STRLEN("Property") + DECIMAL_STR_MAX(unsigned)];
+
+                xsprintf(name, "Property%u", i);
+                ASSERT_OK(sd_bus_message_append(m, "{sv}", name, "s", "active"));
+        }
+
+        ASSERT_OK(sd_bus_message_close_container(m));
+        ASSERT_OK(sd_bus_message_append(m, "as", 2, "Conditions", "Asserts"));
+}
+
+static void read_properties_changed(sd_bus_message *m, unsigned n_properties) {
+        const char *s;
+        unsigned n = 0;
+
+        ASSERT_OK(sd_bus_message_read(m, "s", &s));
+        ASSERT_STREQ(s, "org.freedesktop.systemd1.Unit");
+        ASSERT_OK(sd_bus_message_enter_container(m, 'a', "{sv}"));
+
+        for (;;) {
+                char name[STRLEN("Property") + DECIMAL_STR_MAX(unsigned)];
+                const char *contents, *p, *v;
+                char type;
+                int r;
+
+                r = sd_bus_message_peek_type(m, &type, &contents);
+                ASSERT_OK(r);
+                if (r == 0)
+                        break;
+
+                ASSERT_EQ(type, SD_BUS_TYPE_DICT_ENTRY);
+                ASSERT_STREQ(contents, "sv");
+
+                ASSERT_GT(sd_bus_message_enter_container(m, 'e', "sv"), 0);
+                ASSERT_OK(sd_bus_message_read(m, "s", &p));
+                ASSERT_GT(sd_bus_message_peek_type(m, &type, &contents), 0);
+                ASSERT_EQ(type, SD_BUS_TYPE_VARIANT);
+                ASSERT_STREQ(contents, "s");
+                ASSERT_GT(sd_bus_message_enter_container(m, 'v', contents), 0);
+                ASSERT_OK(sd_bus_message_read(m, "s", &v));
+                ASSERT_OK(sd_bus_message_exit_container(m));
+                ASSERT_OK(sd_bus_message_exit_container(m));
+
+                xsprintf(name, "Property%u", n++);
+                ASSERT_STREQ(p, name);
+                ASSERT_STREQ(v, "active");
+        }
+
+        ASSERT_EQ(n, n_properties);
+        ASSERT_OK(sd_bus_message_exit_container(m));
+        ASSERT_OK(sd_bus_message_skip(m, "as"));
+        ASSERT_TRUE(sd_bus_message_at_end(m, true));
+}
+
+static void test_one(unsigned n_properties, unsigned max_allocations) {
+        _cleanup_(sd_bus_flush_close_unrefp) sd_bus *bus = bus_new_started();
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL, *received = NULL;
+        _cleanup_free_ void *blob = NULL;
+        size_t sz;
+
+        log_info("/* %s(%u) */", __func__, n_properties);
+
+        ASSERT_OK(sd_bus_message_new_signal(bus, &m, "/org/freedesktop/systemd1/unit/foo_2eservice",
+                                            "org.freedesktop.DBus.Properties", "PropertiesChanged"));
+        append_properties_changed(m, n_properties);
+        ASSERT_OK(sd_bus_message_seal(m, 1, 0));
+        assert_n_allocations(m, max_allocations);
+
+        /* Read it back a couple of times, which allocates the container stack and signatures again */
+        for (unsigned i = 0; i < 3; i++) {
+                ASSERT_OK(sd_bus_message_rewind(m, true));
+                read_properties_changed(m, n_properties);
+        }
+        assert_n_allocations(m, max_allocations);
+
+        /* And once more as a message we received */
+        ASSERT_OK(bus_message_get_blob(m, &blob, &sz));
+        ASSERT_OK(bus_message_from_malloc(bus, blob, sz, NULL, 0, NULL, &received));
+        TAKE_PTR(blob);
+
+        for (unsigned i = 0; i < 3; i++) {
+                ASSERT_OK(sd_bus_message_rewind(received, true));
+                read_properties_changed(received, n_properties);
+        }
+        assert_n_allocations(received, 1);
+}
+
+TEST(properties_changed) {
+        /* Typical messages are built and read back within the allocation of the message object itself */
+        test_one(0, 1);
+        test_one(1, 1);
+        test_one(20, 1);
+
+        /* Larger ones are moved to the heap, but work just the same */
+        test_one(1000, 10);
+}
+
+TEST(nested) {
+        _cleanup_(sd_bus_flush_close_unrefp) sd_bus *bus = bus_new_started();
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
+        const char *s;
+
+        /* Containers nested deeper than the arena can hold */
+        ASSERT_OK(sd_bus_message_new_signal(bus, &m, "/", "org.example.Foo", "Bar"));
+        for (unsigned i = 0; i < 64; i++)
+                ASSERT_OK(sd_bus_message_open_container(m, 'v', "v"));
+        ASSERT_OK(sd_bus_message_open_container(m, 'v', "s"));
+        ASSERT_OK(sd_bus_message_append(m, "s", "foo"));
+        for (unsigned i = 0; i < 65; i++)
+                ASSERT_OK(sd_bus_message_close_container(m));
+        ASSERT_OK(sd_bus_message_append(m, "s", "bar"));
+        ASSERT_OK(sd_bus_message_seal(m, 1, 0));
+
+        ASSERT_STREQ(m->root_container.signature, "vs");
+        ASSERT_OK(sd_bus_message_rewind(m, true));
+
+        for (unsigned i = 0; i < 64; i++)
+                ASSERT_GT(sd_bus_message_enter_container(m, 'v', "v"), 0);
+        ASSERT_GT(sd_bus_message_enter_container(m, 'v', "s"), 0);
+        ASSERT_OK(sd_bus_message_read(m, "s", &s));
+        ASSERT_STREQ(s, "foo");
+        for (unsigned i = 0; i < 65; i++)
+                ASSERT_OK(sd_bus_message_exit_container(m));
+        ASSERT_OK(sd_bus_message_read(m, "s", &s));
+        ASSERT_STREQ(s, "bar");
+        ASSERT_TRUE(sd_bus_message_at_end(m, true));
+}
+
+DEFINE_TEST_MAIN(LOG_INFO);
@@ -0,0 +1,186 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <sys/socket.h>
+
+#include "sd-bus.h"
+#include "sd-id128.h"
+
+#include "bus-internal.h"
+#include "fd-util.h"
+#include "string-util.h"
+#include "strv.h"
+#include "tests.h"
+
+static char **children = NULL;
+static unsigned n_enumerated = 0;
+
+STATIC_DESTRUCTOR_REGISTER(children, strv_freep);
+
+static int enumerator(sd_bus *bus, const char *prefix, void *userdata, char ***ret_nodes, sd_bus_error *error) {
+        n_enumerated++;
+        return strv_copy_unless_empty(children, ret_nodes);
+}
+
+static int find(sd_bus *bus, const char *path, const char *interface, void *userdata, void **ret_found, sd_bus_error *error) {
+        if (!strv_contains(children, path))
+                return 0;
+
+        *ret_found = NULL;
+        return 1;
+}
+
+static const sd_bus_vtable vtable[] = {
+        SD_BUS_VTABLE_START(0),
+        SD_BUS_VTABLE_END
+};
+
+static void setup(sd_bus **ret_server, sd_bus **ret_client) {
+        _cleanup_(sd_bus_flush_close_unrefp) sd_bus *server = NULL, *client = NULL;
+        _cleanup_close_pair_ int pair[2] = EBADF_PAIR;
+        sd_id128_t id;
+
+        ASSERT_OK_ERRNO(socketpair(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC|SOCK_NONBLOCK, 0, pair));
+        ASSERT_OK(sd_id128_randomize(&id));
+
+        ASSERT_OK(sd_bus_new(&server));
+        ASSERT_OK(sd_bus_set_fd(server, pair[0], pair[0]));
+        TAKE_FD(pair[0]);
+        ASSERT_OK(sd_bus_set_server(server, true, id));
+        ASSERT_OK(sd_bus_set_anonymous(server, true));
+        ASSERT_OK(sd_bus_start(server));
+
+        ASSERT_OK(sd_bus_new(&client));
+        ASSERT_OK(sd_bus_set_fd(client, pair[1], pair[1]));
+        TAKE_FD(pair[1]);
+        ASSERT_OK(sd_bus_set_anonymous(client, true));
+        ASSERT_OK(sd_bus_start(client));
+
+        while (server->state != BUS_RUNNING || client->state != BUS_RUNNING) {
+                ASSERT_OK(sd_bus_process(server, NULL));
+                ASSERT_OK(sd_bus_process(client, NULL));
+        }
+
+        *ret_server = TAKE_PTR(server);
+        *ret_client = TAKE_PTR(client);
+}
+
+static int reply_handler(sd_bus_message *m, void *userdata, sd_bus_error *error) {
+        sd_bus_message **reply = ASSERT_PTR(userdata);
+
+        ASSERT_FALSE(sd_bus_message_is_method_error(m, NULL));
+        *reply = sd_bus_message_ref(m);
+        return 0;
+}
+
+static sd_bus_message* call(sd_bus *server, sd_bus *client, const char *path, const char *interface, const char *member) {
+        sd_bus_message *reply = NULL;
+
+        /* Both ends are in the same thread, hence we cannot use sd_bus_call() */
+        ASSERT_OK(sd_bus_call_method_async(client, NULL, NULL, path, interface, member, reply_handler, &reply, NULL));
+
+        while (!reply) {
+                int r, k;
+
+                r = sd_bus_process(server, NULL);
+                ASSERT_OK(r);
+                k = sd_bus_process(client, NULL);
+                ASSERT_OK(k);
+
+                if (r == 0 && k == 0 && !reply)
+                        ASSERT_OK(sd_bus_wait(server, 10 * USEC_PER_MSEC));
+        }
+
+        return reply;
+}
+
+static void assert_introspected(sd_bus *server, sd_bus *client, const char *path, char * const *nodes) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        const char *xml;
+
+        reply = call(server, client, path, "org.freedesktop.DBus.Introspectable", "Introspect");
+        ASSERT_OK(sd_bus_message_read(reply, "s", &xml));
+
+        STRV_FOREACH(n, nodes) {
+                _cleanup_free_ char *s = NULL;
+
+                ASSERT_NOT_NULL(s = strjoin(" <node name=\"", *n, "\"/>"));
+                ASSERT_NOT_NULL(strstr(xml, s));
+        }
+}
+
+static void assert_managed_objects(sd_bus *server, sd_bus *client, size_t n_objects) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        size_t n = 0;
+        int r;
+
+        reply = call(server, client, "/org/example", "org.freedesktop.DBus.ObjectManager", "GetManagedObjects");
+        ASSERT_OK(sd_bus_message_enter_container(reply, 'a', "{oa{sa{sv}}}"));
+        while ((r = sd_bus_message_skip(reply, "{oa{sa{sv}}}")) > 0)
+                n++;
+        ASSERT_OK(r);
+        ASSERT_EQ(n, n_objects);
+}
+
+TEST(cache) {
+        _cleanup_(sd_bus_flush_close_unrefp) sd_bus *server = NULL, *client = NULL;
+
+        setup(&server, &client);
+
+        ASSERT_OK(sd_bus_add_object_manager(server, NULL, "/org/example"));
+        ASSERT_OK(sd_bus_add_fallback_vtable(server, NULL, "/org/example/node", "org.example.Node", vtable, find, NULL));
+        ASSERT_OK(sd_bus_add_node_enumerator(server, NULL, "/org/example/node", enumerator, NULL));
+        ASSERT_NOT_NULL(children = strv_new("/org/example/node/a", "/org/example/node/b"));
+
+        /* Without caching the enumerator is called every time */
+        ASSERT_EQ(sd_bus_get_node_enumerator_cache(server), 0);
+        n_enumerated = 0;
+        assert_introspected(server, client, "/org/example/node", STRV_MAKE("a", "b"));
+        assert_introspected(server, client, "/org/example/node", STRV_MAKE("a", "b"));
+        ASSERT_EQ(n_enumerated, 2u);
+
+        /* With caching the last result is reused, as long as the prefix is the same */
+        ASSERT_OK(sd_bus_set_node_enumerator_cache(server, true));
+        ASSERT_GT(sd_bus_get_node_enumerator_cache(server), 0);
+        n_enumerated = 0;
+        assert_introspected(server, client, "/org/example/node", STRV_MAKE("a", "b"));
+        assert_introspected(server, client, "/org/example/node", STRV_MAKE("a", "b"));
+        ASSERT_EQ(n_enumerated, 1u);
+
+        assert_managed_objects(server, client, 2);
+        assert_managed_objects(server, client, 2);
+        ASSERT_EQ(n_enumerated, 2u);
+
+        /* Announcing an object drops the cached results covering it */
+        ASSERT_OK(strv_extend(&children, "/org/example/node/c"));
+        ASSERT_OK(sd_bus_emit_object_added(server, "/org/example/node/c"));
+        n_enumerated = 0;
+        assert_managed_objects(server, client, 3);
+        assert_introspected(server, client, "/org/example/node", STRV_MAKE("a", "b", "c"));
+        ASSERT_EQ(n_enumerated, 2u);
+
+        /* Invalidating an unrelated path keeps them */
+        ASSERT_OK(sd_bus_invalidate_node_enumerators(server, "/org/other/node/c"));
+        assert_introspected(server, client, "/org/example/node", STRV_MAKE("a", "b", "c"));
+        ASSERT_EQ(n_enumerated, 2u);
+
+        /* And explicitly invalidating everything drops them too */
+        strv_remove(children, "/org/example/node/a");
+        ASSERT_OK(sd_bus_invalidate_node_enumerators(server, NULL));
+        assert_introspected(server, client, "/org/example/node", STRV_MAKE("b", "c"));
+        assert_introspected(server, client, "/org/example/node", STRV_MAKE("b", "c"));
+        ASSERT_EQ(n_enumerated, 3u);
+
+        /* An empty result is cached as well */
+        children = strv_free(children);
+        ASSERT_OK(sd_bus_invalidate_node_enumerators(server, "/org/example/node"));
+        assert_managed_objects(server, client, 0);
+        assert_managed_objects(server, client, 0);
+        ASSERT_EQ(n_enumerated, 4u);
+
+        /* Turning caching off again */
+        ASSERT_OK(sd_bus_set_node_enumerator_cache(server, false));
+        assert_managed_objects(server, client, 0);
+        ASSERT_EQ(n_enumerated, 5u);
+}
+
+DEFINE_TEST_MAIN(LOG_INFO);
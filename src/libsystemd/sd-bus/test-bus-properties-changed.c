@@ -0,0 +1,184 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <sys/socket.h>
+
+#include "sd-bus.h"
+
+#include "bus-objects.h"
+#include "fd-util.h"
+#include "set.h"
+#include "strv.h"
+#include "tests.h"
+
+typedef struct Object {
+        char *state;
+        uint32_t counter;
+        uint64_t size;
+} Object;
+
+static int property_get_size(
+                sd_bus *bus,
+                const char *path,
+                const char *interface,
+                const char *property,
+                sd_bus_message *reply,
+                void *userdata,
+                sd_bus_error *error) {
+
+        Object *o = ASSERT_PTR(userdata);
+
+        return sd_bus_message_append(reply, "t", o->size);
+}
+
+static const sd_bus_vtable vtable[] = {
+        SD_BUS_VTABLE_START(0),
+        SD_BUS_PROPERTY("State", "s", NULL, offsetof(Object, state), SD_BUS_VTABLE_PROPERTY_EMITS_CHANGE),
+        SD_BUS_PROPERTY("Counter", "u", NULL, offsetof(Object, counter), SD_BUS_VTABLE_PROPERTY_EMITS_CHANGE),
+        SD_BUS_PROPERTY("Size", "t", property_get_size, 0, SD_BUS_VTABLE_PROPERTY_EMITS_INVALIDATION),
+        SD_BUS_PROPERTY("Constant", "u", NULL, offsetof(Object, counter), SD_BUS_VTABLE_PROPERTY_CONST),
+        SD_BUS_VTABLE_END
+};
+
+static void assert_changed(sd_bus *bus, BusPropertiesDigest *digest, char * const *expected) {
+        _cleanup_free_ char **names = NULL;
+
+        ASSERT_EQ(bus_properties_changed(bus, "/foo", "org.example.Foo", digest, &names), !strv_isempty(expected));
+        ASSERT_TRUE(strv_equal(names, expected));
+}
+
+TEST(properties_changed) {
+        _cleanup_(sd_bus_flush_close_unrefp) sd_bus *bus = NULL;
+        _cleanup_(bus_properties_digest_done) BusPropertiesDigest digest = {};
+        _cleanup_close_pair_ int pair[2] = EBADF_PAIR;
+        _cleanup_free_ char **names = NULL;
+        Object o = {
+                .state = (char*) "active",
+                .counter = 1,
+        };
+
+        ASSERT_OK_ERRNO(socketpair(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0, pair));
+        ASSERT_OK(sd_bus_new(&bus));
+        ASSERT_OK(sd_bus_set_fd(bus, pair[0], pair[0]));
+        TAKE_FD(pair[0]);
+        ASSERT_OK(sd_bus_start(bus));
+
+        ASSERT_OK(sd_bus_add_object_vtable(bus, NULL, "/foo", "org.example.Foo", vtable, &o));
+
+        /* Everything on the first call, and then only what changed. Invalidated properties are always
+         * included. */
+        assert_changed(bus, &digest, STRV_MAKE("State", "Counter", "Size"));
+        assert_changed(bus, &digest, STRV_MAKE("Size"));
+
+        o.counter = 2;
+        assert_changed(bus, &digest, STRV_MAKE("Counter", "Size"));
+
+        /* A change in length of a property does not affect the next one */
+        o.state = (char*) "deactivating";
+        assert_changed(bus, &digest, STRV_MAKE("State", "Size"));
+        o.state = (char*) "inactive";
+        o.counter = 3;
+        o.size = 77;
+        assert_changed(bus, &digest, STRV_MAKE("State", "Counter", "Size"));
+        assert_changed(bus, &digest, STRV_MAKE("Size"));
+
+        /* Starting over includes everything again */
+        bus_properties_digest_done(&digest);
+        assert_changed(bus, &digest, STRV_MAKE("State", "Counter", "Size"));
+
+        ASSERT_ERROR(bus_properties_changed(bus, "/foo", "org.example.Bar", &digest, &names), ENOENT);
+        ASSERT_ERROR(bus_properties_changed(bus, "/bar", "org.example.Foo", &digest, &names), ENOENT);
+}
+
+static int object_find(sd_bus *bus, const char *path, const char *interface, void *userdata, void **ret_found, sd_bus_error *error) {
+        Object *objects = ASSERT_PTR(userdata);
+
+        if (streq(path, "/obj/a"))
+                *ret_found = objects;
+        else if (streq(path, "/obj/b"))
+                *ret_found = objects + 1;
+        else
+                return 0;
+
+        return 1;
+}
+
+static int object_find_b(sd_bus *bus, const char *path, const char *interface, void *userdata, void **ret_found, sd_bus_error *error) {
+        if (!streq(path, "/obj/b"))
+                return 0;
+
+        return object_find(bus, path, interface, userdata, ret_found, error);
+}
+
+static const sd_bus_vtable vtable_bar[] = {
+        SD_BUS_VTABLE_START(0),
+        SD_BUS_PROPERTY("Bar", "u", NULL, offsetof(Object, counter), 0),
+        SD_BUS_PROPERTY("Hidden", "u", NULL, offsetof(Object, counter), SD_BUS_VTABLE_HIDDEN),
+        SD_BUS_PROPERTY("Explicit", "u", NULL, offsetof(Object, counter), SD_BUS_VTABLE_PROPERTY_EXPLICIT),
+        SD_BUS_VTABLE_END
+};
+
+static void assert_object_properties(sd_bus *bus, const char *path, const Set *properties, int ret, char * const *expected) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
+        _cleanup_strv_free_ char **names = NULL;
+        const char *name;
+        int r;
+
+        ASSERT_OK(sd_bus_message_new_signal(bus, &m, "/", "org.example.Test", "Properties"));
+        ASSERT_EQ(bus_message_append_object_properties(bus, m, path, properties, NULL), ret);
+        ASSERT_OK(sd_bus_message_seal(m, 1, 0));
+
+        ASSERT_OK(sd_bus_message_enter_container(m, 'a', "{sv}"));
+        for (;;) {
+                r = sd_bus_message_enter_container(m, 'e', "sv");
+                ASSERT_OK(r);
+                if (r == 0)
+                        break;
+
+                ASSERT_OK(sd_bus_message_read(m, "s", &name));
+                ASSERT_OK(strv_extend(&names, name));
+                ASSERT_OK(sd_bus_message_skip(m, "v"));
+                ASSERT_OK(sd_bus_message_exit_container(m));
+        }
+        ASSERT_OK(sd_bus_message_exit_container(m));
+
+        ASSERT_TRUE(strv_equal(names, expected));
+}
+
+TEST(append_object_properties) {
+        _cleanup_(sd_bus_flush_close_unrefp) sd_bus *bus = NULL;
+        _cleanup_close_pair_ int pair[2] = EBADF_PAIR;
+        _cleanup_set_free_ Set *properties = NULL;
+        Object objects[2] = {
+                {
+                        .state = (char*) "active",
+                        .counter = 1,
+                },
+                {
+                        .state = (char*) "inactive",
+                        .counter = 2,
+                },
+        };
+
+        ASSERT_OK_ERRNO(socketpair(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0, pair));
+        ASSERT_OK(sd_bus_new(&bus));
+        ASSERT_OK(sd_bus_set_fd(bus, pair[0], pair[0]));
+        TAKE_FD(pair[0]);
+        ASSERT_OK(sd_bus_start(bus));
+
+        /* Like PID 1 does it for units: all objects have the first interface, some the second one. Like
+         * for GetAll(), the vtables registered last come first. */
+        ASSERT_OK(sd_bus_add_fallback_vtable(bus, NULL, "/obj", "org.example.Foo", vtable, object_find, objects));
+        ASSERT_OK(sd_bus_add_fallback_vtable(bus, NULL, "/obj", "org.example.Bar", vtable_bar, object_find_b, objects));
+
+        assert_object_properties(bus, "/obj/a", NULL, 1, STRV_MAKE("State", "Counter", "Size", "Constant"));
+        assert_object_properties(bus, "/obj/b", NULL, 1, STRV_MAKE("Bar", "State", "Counter", "Size", "Constant"));
+        assert_object_properties(bus, "/obj/c", NULL, 0, NULL);
+        assert_object_properties(bus, "/foo", NULL, 0, NULL);
+
+        /* Explicit properties are only included when asked for, hidden ones never */
+        ASSERT_OK(set_put_strdupv(&properties, STRV_MAKE("Counter", "Bar", "Hidden", "Explicit", "Nonexistent")));
+        assert_object_properties(bus, "/obj/a", properties, 1, STRV_MAKE("Counter"));
+        assert_object_properties(bus, "/obj/b", properties, 1, STRV_MAKE("Bar", "Explicit", "Counter"));
+}
+
+DEFINE_TEST_MAIN(LOG_INFO);
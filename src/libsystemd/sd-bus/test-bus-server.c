@@ -6,6 +6,7 @@
 #include "sd-bus.h"
 
 #include "bus-internal.h"
+#include "bus-message.h"
 #include "log.h"
 #include "macro.h"
 #include "memory-util.h"
@@ -20,8 +21,19 @@ struct context {
 
         bool client_anonymous_auth;
         bool server_anonymous_auth;
+
+        bool client_negotiate_memfd;
+        bool server_negotiate_memfd;
 };
 
+/* Large enough to be passed in a memfd, if that was negotiated */
+#define ECHO_SIZE (MEMFD_MIN_SIZE + 1)
+
+static bool context_can_memfd(const struct context *c) {
+        return c->client_negotiate_unix_fds && c->server_negotiate_unix_fds &&
+                c->client_negotiate_memfd && c->server_negotiate_memfd;
+}
+
 static int _server(struct context *c) {
         _cleanup_(sd_bus_flush_close_unrefp) sd_bus *bus = NULL;
         sd_id128_t id;
@@ -35,6 +47,7 @@ static int _server(struct context *c) {
         assert_se(sd_bus_set_server(bus, 1, id) >= 0);
         assert_se(sd_bus_set_anonymous(bus, c->server_anonymous_auth) >= 0);
         assert_se(sd_bus_negotiate_fds(bus, c->server_negotiate_unix_fds) >= 0);
+        assert_se(sd_bus_negotiate_memfd(bus, c->server_negotiate_memfd) >= 0);
         assert_se(sd_bus_start(bus) >= 0);
 
         while (!quit) {
@@ -60,6 +73,7 @@ static int _server(struct context *c) {
 
                         assert_se((sd_bus_can_send(bus, 'h') >= 1) ==
                                   (c->server_negotiate_unix_fds && c->client_negotiate_unix_fds));
+                        assert_se(bus->can_memfd == context_can_memfd(c));
 
                         r = sd_bus_message_new_method_return(m, &reply);
                         if (r < 0)
@@ -67,6 +81,26 @@ static int _server(struct context *c) {
 
                         quit = true;
 
+                } else if (sd_bus_message_is_method_call(m, "org.freedesktop.systemd.test", "Echo")) {
+                        const void *p;
+                        size_t sz;
+
+                        assert_se(m->memfd_body == context_can_memfd(c));
+
+                        r = sd_bus_message_read_array(m, 'y', &p, &sz);
+                        if (r < 0)
+                                return log_error_errno(r, "Failed to read array: %m");
+
+                        assert_se(sz == ECHO_SIZE);
+
+                        r = sd_bus_message_new_method_return(m, &reply);
+                        if (r < 0)
+                                return log_error_errno(r, "Failed to allocate return: %m");
+
+                        r = sd_bus_message_append_array(reply, 'y', p, sz);
+                        if (r < 0)
+                                return log_error_errno(r, "Failed to append array: %m");
+
                 } else if (sd_bus_message_is_method_call(m, NULL, NULL)) {
                         r = sd_bus_message_new_method_error(
                                         m,
@@ -90,6 +124,53 @@ static void* server(void *p) {
         return INT_TO_PTR(_server(p));
 }
 
+static int client_echo(struct context *c, sd_bus *bus) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL, *reply = NULL;
+        _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
+        _cleanup_free_ uint8_t *data = NULL;
+        const void *p;
+        size_t sz;
+        int r;
+
+        assert_se(data = malloc(ECHO_SIZE));
+        for (size_t i = 0; i < ECHO_SIZE; i++)
+                data[i] = i % 251;
+
+        r = sd_bus_message_new_method_call(
+                        bus,
+                        &m,
+                        "org.freedesktop.systemd.test",
+                        "/",
+                        "org.freedesktop.systemd.test",
+                        "Echo");
+        if (r < 0)
+                return log_error_errno(r, "Failed to allocate method call: %m");
+
+        r = sd_bus_message_append_array(m, 'y', data, ECHO_SIZE);
+        if (r < 0)
+                return log_error_errno(r, "Failed to append array: %m");
+
+        r = sd_bus_call(bus, m, 0, &error, &reply);
+        if (r < 0)
+                return log_error_errno(r, "Failed to issue method call: %s", bus_error_message(&error, r));
+
+        assert_se(reply->memfd_body == context_can_memfd(c));
+
+        r = sd_bus_message_read_array(reply, 'y', &p, &sz);
+        if (r < 0)
+                return log_error_errno(r, "Failed to read array: %m");
+
+        assert_se(memcmp_nn(p, sz, data, ECHO_SIZE) == 0);
+
+        /* The message we sent is still readable, even if its body was moved to a memfd */
+        assert_se(m->memfd_body == context_can_memfd(c));
+        assert_se(sd_bus_message_rewind(m, true) >= 0);
+        assert_se(sd_bus_message_read_array(m, 'y', &p, &sz) >= 0);
+        assert_se(memcmp_nn(p, sz, data, ECHO_SIZE) == 0);
+
+        return 0;
+}
+
 static int client(struct context *c) {
         _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL, *reply = NULL;
         _cleanup_(sd_bus_unrefp) sd_bus *bus = NULL;
@@ -100,8 +181,13 @@ static int client(struct context *c) {
         assert_se(sd_bus_set_fd(bus, c->fds[1], c->fds[1]) >= 0);
         assert_se(sd_bus_negotiate_fds(bus, c->client_negotiate_unix_fds) >= 0);
         assert_se(sd_bus_set_anonymous(bus, c->client_anonymous_auth) >= 0);
+        assert_se(sd_bus_negotiate_memfd(bus, c->client_negotiate_memfd) >= 0);
         assert_se(sd_bus_start(bus) >= 0);
 
+        r = client_echo(c, bus);
+        if (r < 0)
+                return r;
+
         r = sd_bus_message_new_method_call(
                         bus,
                         &m,
@@ -120,7 +206,8 @@ static int client(struct context *c) {
 }
 
 static int test_one(bool client_negotiate_unix_fds, bool server_negotiate_unix_fds,
-                    bool client_anonymous_auth, bool server_anonymous_auth) {
+                    bool client_anonymous_auth, bool server_anonymous_auth,
+                    bool client_negotiate_memfd, bool server_negotiate_memfd) {
 
         struct context c;
         pthread_t s;
@@ -135,6 +222,8 @@ static int test_one(bool client_negotiate_unix_fds, bool server_negotiate_unix_f
         c.server_negotiate_unix_fds = server_negotiate_unix_fds;
         c.client_anonymous_auth = client_anonymous_auth;
         c.server_anonymous_auth = server_anonymous_auth;
+        c.client_negotiate_memfd = client_negotiate_memfd;
+        c.server_negotiate_memfd = server_negotiate_memfd;
 
         r = pthread_create(&s, NULL, server, &c);
         if (r != 0)
@@ -160,26 +249,44 @@ int main(int argc, char *argv[]) {
 
         test_setup_logging(LOG_DEBUG);
 
-        r = test_one(true, true, false, false);
+        r = test_one(true, true, false, false, false, false);
         assert_se(r >= 0);
 
-        r = test_one(true, false, false, false);
+        r = test_one(true, false, false, false, false, false);
         assert_se(r >= 0);
 
-        r = test_one(false, true, false, false);
+        r = test_one(false, true, false, false, false, false);
         assert_se(r >= 0);
 
-        r = test_one(false, false, false, false);
+        r = test_one(false, false, false, false, false, false);
         assert_se(r >= 0);
 
-        r = test_one(true, true, true, true);
+        r = test_one(true, true, true, true, false, false);
         assert_se(r >= 0);
 
-        r = test_one(true, true, false, true);
+        r = test_one(true, true, false, true, false, false);
         assert_se(r >= 0);
 
-        r = test_one(true, true, true, false);
+        r = test_one(true, true, true, false, false, false);
         assert_se(r == -EPERM);
 
+        r = test_one(true, true, false, false, true, true);
+        assert_se(r >= 0);
+
+        r = test_one(true, true, false, false, true, false);
+        assert_se(r >= 0);
+
+        r = test_one(true, true, false, false, false, true);
+        assert_se(r >= 0);
+
+        r = test_one(false, true, false, false, true, true);
+        assert_se(r >= 0);
+
+        r = test_one(true, false, false, false, true, true);
+        assert_se(r >= 0);
+
+        r = test_one(true, true, true, true, true, true);
+        assert_se(r >= 0);
+
         return EXIT_SUCCESS;
 }
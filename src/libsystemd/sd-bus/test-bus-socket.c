@@ -0,0 +1,144 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "sd-bus.h"
+#include "sd-id128.h"
+
+#include "bus-internal.h"
+#include "bus-message.h"
+#include "fd-util.h"
+#include "stat-util.h"
+#include "string-util.h"
+#include "tests.h"
+
+/* This test sends bursts of messages from one peer to another, which are queued up on the sending side, and
+ * then written and read in batches. Every so often a message carries an fd, to check that the fds end up
+ * with the right messages. */
+
+#define N_QUEUED 2000U
+#define FD_EVERY 97U
+
+static void setup(sd_bus **ret_server, sd_bus **ret_client, bool negotiate_fds) {
+        _cleanup_(sd_bus_flush_close_unrefp) sd_bus *server = NULL, *client = NULL;
+        _cleanup_close_pair_ int pair[2] = EBADF_PAIR;
+        sd_id128_t id;
+
+        ASSERT_OK_ERRNO(socketpair(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC|SOCK_NONBLOCK, 0, pair));
+        ASSERT_OK(sd_id128_randomize(&id));
+
+        ASSERT_OK(sd_bus_new(&server));
+        ASSERT_OK(sd_bus_set_fd(server, pair[0], pair[0]));
+        TAKE_FD(pair[0]);
+        ASSERT_OK(sd_bus_set_server(server, true, id));
+        ASSERT_OK(sd_bus_set_anonymous(server, true));
+        ASSERT_OK(sd_bus_negotiate_fds(server, negotiate_fds));
+        ASSERT_OK(sd_bus_start(server));
+
+        ASSERT_OK(sd_bus_new(&client));
+        ASSERT_OK(sd_bus_set_fd(client, pair[1], pair[1]));
+        TAKE_FD(pair[1]);
+        ASSERT_OK(sd_bus_set_anonymous(client, true));
+        ASSERT_OK(sd_bus_negotiate_fds(client, negotiate_fds));
+        ASSERT_OK(sd_bus_start(client));
+
+        /* Both ends are in the same thread, hence drive the authentication from here */
+        while (server->state != BUS_RUNNING || client->state != BUS_RUNNING) {
+                ASSERT_OK(sd_bus_process(server, NULL));
+                ASSERT_OK(sd_bus_process(client, NULL));
+        }
+
+        ASSERT_EQ(sd_bus_can_send(client, SD_BUS_TYPE_UNIX_FD) > 0, negotiate_fds);
+
+        /* Keep the socket buffer small, so that messages are queued soon */
+        ASSERT_OK_ERRNO(setsockopt(client->output_fd, SOL_SOCKET, SO_SNDBUF, &(int) { 32 * 1024 }, sizeof(int)));
+
+        *ret_server = TAKE_PTR(server);
+        *ret_client = TAKE_PTR(client);
+}
+
+static void send_one(sd_bus *bus, unsigned i, int fd) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
+        char padding[128];
+
+        ASSERT_OK(sd_bus_message_new_signal(bus, &m, "/org/example/test", "org.example.Test", "Burst"));
+
+        /* Vary the size of the messages, so that they do not line up with the buffer sizes */
+        memset(padding, 'x', sizeof(padding));
+        padding[i % sizeof(padding)] = 0;
+
+        if (fd >= 0)
+                ASSERT_OK(sd_bus_message_append(m, "ush", i, padding, fd));
+        else
+                ASSERT_OK(sd_bus_message_append(m, "us", i, padding));
+
+        ASSERT_OK(sd_bus_send(bus, m, NULL));
+}
+
+static void test_burst_one(bool negotiate_fds) {
+        _cleanup_(sd_bus_flush_close_unrefp) sd_bus *server = NULL, *client = NULL;
+        _cleanup_close_pair_ int pipe_fds[2] = EBADF_PAIR;
+        unsigned n_sent = 0, n_received = 0;
+        struct stat st;
+
+        log_info("/* %s(%s) */", __func__, yes_no(negotiate_fds));
+
+        ASSERT_OK_ERRNO(pipe2(pipe_fds, O_CLOEXEC));
+        ASSERT_OK_ERRNO(fstat(pipe_fds[0], &st));
+
+        setup(&server, &client, negotiate_fds);
+
+        /* Send until a good number of messages is queued, since the socket buffer is full */
+        while (client->wqueue_size < N_QUEUED) {
+                send_one(client, n_sent, negotiate_fds && n_sent % FD_EVERY == 0 ? pipe_fds[0] : -EBADF);
+                n_sent++;
+        }
+
+        while (n_received < n_sent) {
+                _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
+                const char *padding;
+                unsigned i;
+                int r;
+
+                ASSERT_OK(sd_bus_process(client, NULL));
+
+                r = sd_bus_process(server, &m);
+                ASSERT_OK(r);
+                if (!m) {
+                        if (r == 0)
+                                ASSERT_OK(sd_bus_wait(server, USEC_PER_SEC));
+                        continue;
+                }
+
+                ASSERT_TRUE(sd_bus_message_is_signal(m, "org.example.Test", "Burst"));
+                ASSERT_OK(sd_bus_message_read(m, "us", &i, &padding));
+                ASSERT_EQ(i, n_received);
+                ASSERT_EQ(strlen(padding), i % 128);
+
+                if (negotiate_fds && i % FD_EVERY == 0) {
+                        struct stat st2;
+                        int fd;
+
+                        ASSERT_OK(sd_bus_message_read(m, "h", &fd));
+                        ASSERT_OK_ERRNO(fstat(fd, &st2));
+                        ASSERT_TRUE(stat_inode_same(&st, &st2));
+                        ASSERT_EQ(m->n_fds, 1u);
+                } else
+                        ASSERT_EQ(m->n_fds, 0u);
+
+                ASSERT_TRUE(sd_bus_message_at_end(m, true));
+                n_received++;
+        }
+
+        ASSERT_EQ(client->wqueue_size, 0u);
+        ASSERT_EQ(server->n_fds, 0u);
+}
+
+TEST(burst) {
+        test_burst_one(false);
+        test_burst_one(true);
+}
+
+DEFINE_TEST_MAIN(LOG_INFO);
@@ -34,6 +34,9 @@ struct sd_device_enumerator {
         bool scan_uptodate;
         bool sorted;
 
+        /* syspaths of the parent devices checked by the running scan, see enumerator_add_parent_devices() */
+        Set *parents_checked;
+
         char **prioritized_subsystems;
         Set *match_subsystem;
         Set *nomatch_subsystem;
@@ -82,6 +85,7 @@ static void device_enumerator_unref_devices(sd_device_enumerator *enumerator) {
         device_unref_many(enumerator->devices, enumerator->n_devices);
         enumerator->devices = mfree(enumerator->devices);
         enumerator->n_devices = 0;
+        enumerator->parents_checked = set_free(enumerator->parents_checked);
 }
 
 static sd_device_enumerator *device_enumerator_free(sd_device_enumerator *enumerator) {
@@ -637,7 +641,8 @@ static int test_matches(
 static int enumerator_add_parent_devices(
                 sd_device_enumerator *enumerator,
                 sd_device *device,
-                MatchFlag flags) {
+                MatchFlag flags,
+                Set **checked) {
 
         int r;
 
@@ -651,6 +656,22 @@ static int enumerator_add_parent_devices(
                 if (r < 0)
                         return r;
 
+                /* Siblings share their ancestors. When walking up from many devices during a scan, stop at
+                 * the first parent that was already checked, as all its ancestors were checked then, too. */
+                if (checked) {
+                        const char *syspath;
+
+                        r = sd_device_get_syspath(device, &syspath);
+                        if (r < 0)
+                                return r;
+
+                        r = set_put_strdup(checked, syspath);
+                        if (r < 0)
+                                return r;
+                        if (r == 0)
+                                return 0;
+                }
+
                 r = test_matches(enumerator, device, flags);
                 if (r < 0)
                         return r;
@@ -664,7 +685,7 @@ static int enumerator_add_parent_devices(
 }
 
 int device_enumerator_add_parent_devices(sd_device_enumerator *enumerator, sd_device *device) {
-        return enumerator_add_parent_devices(enumerator, device, MATCH_ALL & (~MATCH_PARENT));
+        return enumerator_add_parent_devices(enumerator, device, MATCH_ALL & (~MATCH_PARENT), /* checked = */ NULL);
 }
 
 static bool relevant_sysfs_subdir(const struct dirent *de) {
@@ -745,7 +766,7 @@ static int enumerator_scan_dir_and_add_devices(
                 /* Also include all potentially matching parent devices in the enumeration. These are things
                  * like root busses — e.g. /sys/devices/pci0000:00/ or /sys/devices/pnp0/, which ar not
                  * linked from /sys/class/ or /sys/bus/, hence pick them up explicitly here. */
-                k = enumerator_add_parent_devices(enumerator, device, MATCH_ALL);
+                k = enumerator_add_parent_devices(enumerator, device, MATCH_ALL, &enumerator->parents_checked);
                 if (k < 0)
                         r = k;
         }
@@ -999,6 +1020,7 @@ int device_enumerator_scan_devices(sd_device_enumerator *enumerator) {
                         r = k;
         }
 
+        enumerator->parents_checked = set_free(enumerator->parents_checked);
         enumerator->scan_uptodate = true;
         enumerator->type = DEVICE_ENUMERATION_TYPE_DEVICES;
 
@@ -1066,6 +1088,7 @@ int device_enumerator_scan_subsystems(sd_device_enumerator *enumerator) {
                         r = log_debug_errno(k, "sd-device-enumerator: Failed to scan drivers: %m");
         }
 
+        enumerator->parents_checked = set_free(enumerator->parents_checked);
         enumerator->scan_uptodate = true;
         enumerator->type = DEVICE_ENUMERATION_TYPE_SUBSYSTEMS;
 
@@ -1139,6 +1162,7 @@ int device_enumerator_scan_devices_and_subsystems(sd_device_enumerator *enumerat
                 }
         }
 
+        enumerator->parents_checked = set_free(enumerator->parents_checked);
         enumerator->scan_uptodate = true;
         enumerator->type = DEVICE_ENUMERATION_TYPE_ALL;
 
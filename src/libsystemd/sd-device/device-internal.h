@@ -10,6 +10,9 @@
 
 #define LATEST_UDEV_DATABASE_VERSION 1
 
+/* Database entries are a few hundred bytes usually, refuse anything absurdly large */
+#define DEVICE_DB_SIZE_MAX (4U*1024U*1024U)
+
 struct sd_device {
         unsigned n_ref;
 
@@ -20,6 +20,7 @@
 #include "fd-util.h"
 #include "format-util.h"
 #include "hashmap.h"
+#include "io-util.h"
 #include "iovec-util.h"
 #include "missing_socket.h"
 #include "mountpoint-util.h"
@@ -66,6 +67,9 @@ struct sd_device_monitor {
 
 #define UDEV_MONITOR_MAGIC                0xfeedcafe
 
+/* Maximum number of messages to receive in one dispatch of the event source */
+#define DEVICE_MONITOR_BATCH_MAX          32U
+
 typedef struct monitor_netlink_header {
         /* "libudev" prefix to distinguish libudev and kernel messages */
         char prefix[8];
@@ -249,10 +253,11 @@ _public_ int sd_device_monitor_stop(sd_device_monitor *m) {
         return 0;
 }
 
-static int device_monitor_event_handler(sd_event_source *s, int fd, uint32_t revents, void *userdata) {
+static int device_monitor_dispatch_one(sd_device_monitor *m) {
         _cleanup_(sd_device_unrefp) sd_device *device = NULL;
         _unused_ _cleanup_(log_context_unrefp) LogContext *c = NULL;
-        sd_device_monitor *m = ASSERT_PTR(userdata);
+
+        assert(m);
 
         if (device_monitor_receive_device(m, &device) <= 0)
                 return 0;
@@ -266,6 +271,33 @@ static int device_monitor_event_handler(sd_event_source *s, int fd, uint32_t rev
         return 0;
 }
 
+static int device_monitor_event_handler(sd_event_source *s, int fd, uint32_t revents, void *userdata) {
+        _unused_ _cleanup_(sd_device_monitor_unrefp) sd_device_monitor *m = sd_device_monitor_ref(ASSERT_PTR(userdata));
+        int r;
+
+        /* During bursts, e.g. on coldplug, receive multiple queued messages per wakeup, rather than going
+         * through the event loop again for each of them. */
+        for (unsigned i = 0;; i++) {
+                r = device_monitor_dispatch_one(m);
+                if (r < 0)
+                        return r;
+
+                if (i + 1 >= DEVICE_MONITOR_BATCH_MAX)
+                        return 0;
+
+                /* The callback may have stopped or restarted the monitor, or disabled the event source. */
+                if (m->event_source != s || sd_event_source_get_enabled(s, NULL) <= 0)
+                        return 0;
+
+                if (sd_event_get_exit_code(m->event, NULL) != -ENODATA)
+                        return 0;
+
+                r = fd_wait_for_event(fd, POLLIN, 0);
+                if (r <= 0) /* Drained, or failed to check. Either way the event loop will tell us. */
+                        return 0;
+        }
+}
+
 _public_ int sd_device_monitor_start(sd_device_monitor *m, sd_device_monitor_handler_t callback, void *userdata) {
         int r;
 
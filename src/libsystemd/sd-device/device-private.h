@@ -74,6 +74,8 @@ static inline int device_read_db(sd_device *device) {
 
 int device_read_uevent_file(sd_device *device);
 
+int device_trigger_with_args(sd_device *device, sd_device_action_t action, char * const *args, sd_id128_t *ret_uuid);
+
 int device_set_action(sd_device *device, sd_device_action_t a);
 sd_device_action_t device_action_from_string(const char *s) _pure_;
 const char* device_action_to_string(sd_device_action_t a) _const_;
@@ -3,6 +3,8 @@
 #include <ctype.h>
 #include <net/if.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 
 #include "sd-device.h"
@@ -28,6 +30,7 @@
 #include "path-util.h"
 #include "set.h"
 #include "socket-util.h"
+#include "stat-util.h"
 #include "stdio-util.h"
 #include "string-util.h"
 #include "strv.h"
@@ -1677,10 +1680,8 @@ int device_get_device_id(sd_device *device, const char **ret) {
         return 0;
 }
 
-int device_read_db_internal_filename(sd_device *device, const char *filename) {
-        _cleanup_free_ char *db = NULL;
+static void device_parse_db(sd_device *device, char *db, size_t db_len) {
         const char *value;
-        size_t db_len;
         char key = '\0';  /* Unnecessary initialization to appease gcc-12.0.0-0.4.fc36 */
         int r;
 
@@ -1693,20 +1694,7 @@ int device_read_db_internal_filename(sd_device *device, const char *filename) {
         } state = PRE_KEY;
 
         assert(device);
-        assert(filename);
-
-        r = read_full_file(filename, &db, &db_len);
-        if (r < 0) {
-                if (r == -ENOENT)
-                        return 0;
-
-                return log_device_debug_errno(device, r, "sd-device: Failed to read db '%s': %m", filename);
-        }
-
-        /* devices with a database entry are initialized */
-        device->is_initialized = true;
-
-        device->db_loaded = true;
+        assert(db || db_len == 0);
 
         for (size_t i = 0; i < db_len; i++)
                 switch (state) {
@@ -1754,8 +1742,57 @@ int device_read_db_internal_filename(sd_device *device, const char *filename) {
 
                         break;
                 default:
-                        return log_device_debug_errno(device, SYNTHETIC_ERRNO(EINVAL), "sd-device: invalid db syntax.");
+                        assert_not_reached();
                 }
+}
+
+int device_read_db_internal_filename(sd_device *device, const char *filename) {
+        _cleanup_close_ int fd = -EBADF;
+        struct stat st;
+        void *db = NULL;
+        int r;
+
+        assert(device);
+        assert(filename);
+
+        /* Enumerating devices reads the database entries of all of them, hence map the files instead of
+         * reading them into a buffer via stdio. The mapping is private, which allows the parser to
+         * terminate entries in place. Database files are always replaced atomically and never
+         * truncated, hence we don't have to be afraid of SIGBUS here. */
+
+        fd = open(filename, O_RDONLY|O_CLOEXEC|O_NOCTTY);
+        if (fd < 0) {
+                if (errno == ENOENT)
+                        return 0;
+
+                return log_device_debug_errno(device, errno, "sd-device: Failed to open db '%s': %m", filename);
+        }
+
+        if (fstat(fd, &st) < 0)
+                return log_device_debug_errno(device, errno, "sd-device: Failed to stat db '%s': %m", filename);
+
+        r = stat_verify_regular(&st);
+        if (r < 0)
+                return log_device_debug_errno(device, r, "sd-device: Database entry '%s' is not a regular file: %m", filename);
+
+        if (st.st_size > DEVICE_DB_SIZE_MAX)
+                return log_device_debug_errno(device, SYNTHETIC_ERRNO(E2BIG), "sd-device: Database entry '%s' is too large.", filename);
+
+        if (st.st_size > 0) {
+                db = mmap(NULL, st.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+                if (db == MAP_FAILED)
+                        return log_device_debug_errno(device, errno, "sd-device: Failed to map db '%s': %m", filename);
+        }
+
+        /* devices with a database entry are initialized */
+        device->is_initialized = true;
+
+        device->db_loaded = true;
+
+        device_parse_db(device, db, st.st_size);
+
+        if (db)
+                assert_se(munmap(db, st.st_size) >= 0);
 
         return 0;
 }
@@ -1765,14 +1802,19 @@ _public_ int sd_device_get_is_initialized(sd_device *device) {
 
         assert_return(device, -EINVAL);
 
-        r = device_read_db(device);
+        if (device->is_initialized || device->db_loaded || device->sealed)
+                return device->is_initialized;
+
+        /* Only the existence of the database entry matters here, hence don't parse it yet. Enumerators
+         * check this for every device, including the ones that are filtered out afterwards. */
+        r = device_has_db(device);
         if (r == -ENOENT)
                 /* The device may be already removed or renamed. */
                 return false;
         if (r < 0)
                 return r;
 
-        return device->is_initialized;
+        return r > 0;
 }
 
 _public_ int sd_device_get_usec_initialized(sd_device *device, uint64_t *ret) {
@@ -1780,6 +1822,10 @@ _public_ int sd_device_get_usec_initialized(sd_device *device, uint64_t *ret) {
 
         assert_return(device, -EINVAL);
 
+        r = device_read_db(device);
+        if (r < 0 && r != -ENOENT)
+                return r;
+
         r = sd_device_get_is_initialized(device);
         if (r < 0)
                 return r;
@@ -2590,6 +2636,50 @@ _public_ int sd_device_trigger_with_uuid(
         return 0;
 }
 
+int device_trigger_with_args(
+                sd_device *device,
+                sd_device_action_t action,
+                char * const *args,
+                sd_id128_t *ret_uuid) {
+
+        _cleanup_free_ char *j = NULL;
+        const char *s;
+        sd_id128_t u;
+        int r;
+
+        assert(device);
+
+        /* Like sd_device_trigger_with_uuid(), but also passes KEY=VALUE arguments, which show up as
+         * SYNTH_ARG_KEY=VALUE properties of the uevent. The kernel only accepts those after a UUID. */
+
+        if (strv_isempty(args))
+                return sd_device_trigger_with_uuid(device, action, ret_uuid);
+
+        s = device_action_to_string(action);
+        if (!s)
+                return -EINVAL;
+
+        r = sd_id128_randomize(&u);
+        if (r < 0)
+                return r;
+
+        j = strjoin(s, " ", SD_ID128_TO_UUID_STRING(u));
+        if (!j)
+                return -ENOMEM;
+
+        STRV_FOREACH(a, args)
+                if (!strextend(&j, " ", *a))
+                        return -ENOMEM;
+
+        r = sd_device_set_sysattr_value(device, "uevent", j);
+        if (r < 0)
+                return r;
+
+        if (ret_uuid)
+                *ret_uuid = u;
+        return 0;
+}
+
 _public_ int sd_device_open(sd_device *device, int flags) {
         _cleanup_close_ int fd = -EBADF, fd2 = -EBADF;
         const char *devname;
@@ -10,6 +10,7 @@
 #include "device-util.h"
 #include "errno-util.h"
 #include "fd-util.h"
+#include "fileio.h"
 #include "hashmap.h"
 #include "mountpoint-util.h"
 #include "nulstr-util.h"
@@ -598,6 +599,56 @@ TEST(sd_device_new_from_nulstr) {
         }
 }
 
+TEST(device_read_db_internal_filename) {
+        _cleanup_(unlink_tempfilep) char filename[] = "/tmp/test-sd-device-db.XXXXXX";
+        _cleanup_(sd_device_unrefp) sd_device *device = NULL;
+        _cleanup_close_ int fd = -EBADF;
+        uint64_t usec;
+
+        ASSERT_OK(fd = mkostemp_safe(filename));
+        ASSERT_OK(write_string_file(filename,
+                                    "S:disk/by-label/foo\n"
+                                    "L:10\n"
+                                    "I:12345\n"
+                                    "E:ID_FOO=bar\n"
+                                    "X:unknown\n"
+                                    "G:tag1\n"
+                                    "Q:tag1\n"
+                                    "G:tag2\n"
+                                    "V:1\n"
+                                    "E:ID_TRUNCATED=yes",
+                                    WRITE_STRING_FILE_AVOID_NEWLINE));
+
+        ASSERT_OK(device_new_aux(&device));
+        ASSERT_OK(device_read_db_internal_filename(device, filename));
+
+        ASSERT_TRUE(device->db_loaded);
+        ASSERT_GT(sd_device_get_is_initialized(device), 0);
+        ASSERT_OK(sd_device_get_usec_initialized(device, &usec));
+        ASSERT_EQ(usec, 12345u);
+        ASSERT_EQ(device->devlink_priority, 10);
+        ASSERT_TRUE(set_contains(device->devlinks, "/dev/disk/by-label/foo"));
+        ASSERT_STREQ(ordered_hashmap_get(device->properties_db, "ID_FOO"), "bar");
+        ASSERT_NULL(ordered_hashmap_get(device->properties_db, "ID_TRUNCATED"));
+        ASSERT_GT(sd_device_has_tag(device, "tag1"), 0);
+        ASSERT_GT(sd_device_has_tag(device, "tag2"), 0);
+        ASSERT_GT(sd_device_has_current_tag(device, "tag1"), 0);
+        ASSERT_EQ(sd_device_has_current_tag(device, "tag2"), 0);
+
+        /* An empty entry still marks the device initialized */
+        device = sd_device_unref(device);
+        ASSERT_OK(write_string_file(filename, "", WRITE_STRING_FILE_TRUNCATE|WRITE_STRING_FILE_AVOID_NEWLINE));
+        ASSERT_OK(device_new_aux(&device));
+        ASSERT_OK(device_read_db_internal_filename(device, filename));
+        ASSERT_GT(sd_device_get_is_initialized(device), 0);
+
+        /* A missing entry is not an error */
+        device = sd_device_unref(device);
+        ASSERT_OK(device_new_aux(&device));
+        ASSERT_OK(device_read_db_internal_filename(device, "/tmp/test-sd-device-db-nonexistent"));
+        ASSERT_FALSE(device->db_loaded);
+}
+
 TEST(sd_device_new_from_path) {
         _cleanup_(sd_device_enumerator_unrefp) sd_device_enumerator *e = NULL;
         _cleanup_(rm_rf_physical_and_freep) char *tmpdir = NULL;
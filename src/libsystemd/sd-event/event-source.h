@@ -7,6 +7,7 @@
 
 #include "sd-event.h"
 
+#include "event-timer-wheel.h"
 #include "hashmap.h"
 #include "inotify-util.h"
 #include "list.h"
@@ -46,6 +47,31 @@ typedef enum WakeupType {
 
 struct inode_data;
 
+/* The buffer of an I/O source created with sd_event_add_io_read(). If the event loop uses io_uring the
+ * read is done by the kernel, and the buffer may hence outlive the event source if that is freed while
+ * the read is still in flight. */
+typedef struct EventIORead {
+        sd_event_source *source; /* NULL if the event source was freed already */
+        LIST_FIELDS(struct EventIORead, orphans);
+
+        ssize_t result;
+        bool in_flight:1;        /* queued in the ring, its completion was not processed yet */
+        bool completed:1;        /* the result was not dispatched yet */
+
+        size_t size;
+        uint8_t buffer[];
+} EventIORead;
+
+/* Dispatch statistics, aggregated over all event sources of the same type and description */
+typedef struct EventStatistics {
+        EventSourceType type;
+        char *description;
+
+        uint64_t n_dispatched;
+        usec_t dispatch_usec, dispatch_max_usec;
+        usec_t pending_usec, pending_max_usec;
+} EventStatistics;
+
 struct sd_event_source {
         WakeupType wakeup;
 
@@ -64,12 +90,18 @@ struct sd_event_source {
         bool floating:1;
         bool exit_on_failure:1;
         bool ratelimited:1;
+        bool from_pool:1;
 
         int64_t priority;
         unsigned pending_index;
         unsigned prepare_index;
         uint64_t pending_iteration;
         uint64_t prepare_iteration;
+        uint64_t dispatch_iteration;
+
+        /* Only maintained while statistics are collected, see sd_event_set_statistics() */
+        EventStatistics *statistics;
+        usec_t pending_since;
 
         sd_event_destroy_t destroy_callback;
         sd_event_handler_t ratelimit_expire_callback;
@@ -86,6 +118,8 @@ struct sd_event_source {
         union {
                 struct {
                         sd_event_io_handler_t callback;
+                        sd_event_io_read_handler_t read_callback;
+                        EventIORead *read;
                         int fd;
                         uint32_t events;
                         uint32_t revents;
@@ -95,6 +129,7 @@ struct sd_event_source {
                 struct {
                         sd_event_time_handler_t callback;
                         usec_t next, accuracy;
+                        TimerWheelEntry wheel_entry;
                 } time;
                 struct {
                         sd_event_signal_handler_t callback;
@@ -159,6 +194,11 @@ struct clock_data {
         Prioq *latest;
         usec_t next;
 
+        /* Timer event sources with an accuracy of at least TIMER_WHEEL_GRANULARITY are not kept in
+         * the prioqs, but in this wheel, at the time sleep_between() would wake up for them. This makes
+         * re-arming them cheap. Ratelimited event sources always use the prioqs. */
+        TimerWheel *wheel;
+
         bool needs_rearm:1;
 };
 
@@ -0,0 +1,332 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <errno.h>
+
+#include "alloc-util.h"
+#include "event-timer-wheel.h"
+
+assert_cc(TIMER_WHEEL_SLOTS == 64); /* One bit per slot in a uint64_t */
+
+/* Entries past due, and entries off the grid or too far in the future for the last level */
+#define TIMER_WHEEL_SLOT_OVERDUE (TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS)
+#define TIMER_WHEEL_SLOT_FAR (TIMER_WHEEL_SLOT_OVERDUE + 1)
+
+struct TimerWheel {
+        usec_t now;
+        usec_t offset; /* The perturbation, modulo the granularity */
+
+        /* Grid points are numbered from 1 on. Level l holds the entries whose grid points share all but
+         * the lowest (l+1)*TIMER_WHEEL_SLOTS_BITS bits with the current one, but not the lowest
+         * l*TIMER_WHEEL_SLOTS_BITS bits, in the slot indexed by the next TIMER_WHEEL_SLOTS_BITS bits. Hence
+         * all slots of a level are after the current one, and the first used slot of the lowest used level
+         * holds the earliest entries. */
+        uint64_t used[TIMER_WHEEL_LEVELS]; /* Bit i is set if slot i of the level is not empty */
+        TimerWheelEntry *slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+
+        /* The earliest time in each slot, which is only valid if the bit of the slot is set in
+         * slot_min_valid. All entries of a slot in the first level elapse at the same time. */
+        usec_t slot_min[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+        uint64_t slot_min_valid[TIMER_WHEEL_LEVELS];
+
+        LIST_HEAD(TimerWheelEntry, overdue);
+
+        /* The earliest time in the far list is cached, and only recalculated when the entry it came from is
+         * removed. */
+        LIST_HEAD(TimerWheelEntry, far);
+        usec_t far_min;
+        bool far_min_valid;
+};
+
+int timer_wheel_new(usec_t perturb, usec_t now, TimerWheel **ret) {
+        TimerWheel *w;
+
+        assert(ret);
+
+        w = new0(TimerWheel, 1);
+        if (!w)
+                return -ENOMEM;
+
+        w->now = now;
+        w->offset = perturb % TIMER_WHEEL_GRANULARITY;
+        w->far_min = USEC_INFINITY;
+        w->far_min_valid = true;
+
+        *ret = w;
+        return 0;
+}
+
+TimerWheel* timer_wheel_free(TimerWheel *w) {
+        if (!w)
+                return NULL;
+
+        /* The entries are owned by the caller, they all must have been removed by now */
+        assert(!w->overdue);
+        assert(!w->far);
+        for (unsigned l = 0; l < TIMER_WHEEL_LEVELS; l++)
+                assert(w->used[l] == 0);
+
+        return mfree(w);
+}
+
+static uint64_t wheel_tick(TimerWheel *w, usec_t t) {
+        assert(w);
+
+        /* Returns the number of the last grid point at or before t, or 0 if there is none */
+
+        if (t < w->offset)
+                return 0;
+
+        return (t - w->offset) / TIMER_WHEEL_GRANULARITY + 1;
+}
+
+static unsigned level_shift(unsigned level) {
+        return level * TIMER_WHEEL_SLOTS_BITS;
+}
+
+static void slot_link(TimerWheel *w, unsigned level, unsigned idx, TimerWheelEntry *i) {
+        uint64_t bit = UINT64_C(1) << idx;
+
+        assert(w);
+        assert(level < TIMER_WHEEL_LEVELS);
+        assert(idx < TIMER_WHEEL_SLOTS);
+        assert(i);
+
+        if (!FLAGS_SET(w->used[level], bit)) {
+                w->slot_min[level][idx] = i->time;
+                w->slot_min_valid[level] |= bit;
+        } else if (FLAGS_SET(w->slot_min_valid[level], bit))
+                w->slot_min[level][idx] = MIN(w->slot_min[level][idx], i->time);
+
+        LIST_PREPEND(entries, w->slots[level][idx], i);
+        w->used[level] |= bit;
+        i->slot = level * TIMER_WHEEL_SLOTS + idx;
+}
+
+void timer_wheel_put(TimerWheel *w, TimerWheelEntry *i, usec_t time) {
+        uint64_t k, k_now;
+
+        assert(w);
+        assert(i);
+        assert(!timer_wheel_entry_is_linked(i));
+        assert(time != USEC_INFINITY);
+
+        i->time = time;
+
+        if (time <= w->now) {
+                LIST_PREPEND(entries, w->overdue, i);
+                i->slot = TIMER_WHEEL_SLOT_OVERDUE;
+                return;
+        }
+
+        if (time >= w->offset && (time - w->offset) % TIMER_WHEEL_GRANULARITY == 0) {
+                k = wheel_tick(w, time);
+                k_now = wheel_tick(w, w->now);
+                assert(k > k_now);
+
+                for (unsigned l = 0; l < TIMER_WHEEL_LEVELS; l++)
+                        if ((k >> level_shift(l + 1)) == (k_now >> level_shift(l + 1))) {
+                                slot_link(w, l, (k >> level_shift(l)) % TIMER_WHEEL_SLOTS, i);
+                                return;
+                        }
+        }
+
+        LIST_PREPEND(entries, w->far, i);
+        i->slot = TIMER_WHEEL_SLOT_FAR;
+
+        if (w->far_min_valid)
+                w->far_min = MIN(w->far_min, time);
+}
+
+void timer_wheel_remove(TimerWheel *w, TimerWheelEntry *i) {
+        assert(w);
+        assert(i);
+
+        if (!timer_wheel_entry_is_linked(i))
+                return;
+
+        if (i->slot == TIMER_WHEEL_SLOT_OVERDUE)
+                LIST_REMOVE(entries, w->overdue, i);
+        else if (i->slot == TIMER_WHEEL_SLOT_FAR) {
+                LIST_REMOVE(entries, w->far, i);
+
+                if (i->time == w->far_min)
+                        w->far_min_valid = false;
+        } else {
+                unsigned level = i->slot / TIMER_WHEEL_SLOTS, idx = i->slot % TIMER_WHEEL_SLOTS;
+                uint64_t bit = UINT64_C(1) << idx;
+
+                assert(level < TIMER_WHEEL_LEVELS);
+
+                LIST_REMOVE(entries, w->slots[level][idx], i);
+                if (!w->slots[level][idx])
+                        w->used[level] &= ~bit;
+                else if (level > 0 && i->time == w->slot_min[level][idx])
+                        w->slot_min_valid[level] &= ~bit;
+        }
+
+        i->slot = TIMER_WHEEL_SLOT_NULL;
+}
+
+static void relink(TimerWheel *w, TimerWheelEntry *list) {
+        assert(w);
+
+        LIST_FOREACH(entries, i, list) {
+                i->slot = TIMER_WHEEL_SLOT_NULL;
+                timer_wheel_put(w, i, i->time);
+        }
+}
+
+static void far_refresh(TimerWheel *w) {
+        TimerWheelEntry *far;
+
+        assert(w);
+
+        /* Puts all far entries again, which moves those that fit into the wheel by now there, and
+         * recalculates the earliest time of the rest. */
+
+        far = TAKE_PTR(w->far);
+        w->far_min = USEC_INFINITY;
+        w->far_min_valid = true;
+
+        relink(w, far);
+}
+
+static bool wheel_first(TimerWheel *w, unsigned *ret_level, unsigned *ret_idx, usec_t *ret_time) {
+        assert(w);
+        assert(ret_level);
+        assert(ret_idx);
+        assert(ret_time);
+
+        for (unsigned l = 0; l < TIMER_WHEEL_LEVELS; l++) {
+                unsigned idx;
+                uint64_t bit;
+
+                if (w->used[l] == 0)
+                        continue;
+
+                idx = __builtin_ctzll(w->used[l]);
+                bit = UINT64_C(1) << idx;
+
+                if (!FLAGS_SET(w->slot_min_valid[l], bit)) {
+                        usec_t m = USEC_INFINITY;
+
+                        LIST_FOREACH(entries, i, w->slots[l][idx])
+                                m = MIN(m, i->time);
+
+                        w->slot_min[l][idx] = m;
+                        w->slot_min_valid[l] |= bit;
+                }
+
+                *ret_level = l;
+                *ret_idx = idx;
+                *ret_time = w->slot_min[l][idx];
+                return true;
+        }
+
+        return false;
+}
+
+static void wheel_advance(TimerWheel *w, usec_t t) {
+        uint64_t k, k_old;
+
+        assert(w);
+        assert(t > w->now);
+
+        /* Moves the wheel forward to t. There must not be any entries before t in the wheel, the ones at t
+         * are moved to the overdue list. */
+
+        k_old = wheel_tick(w, w->now);
+        k = wheel_tick(w, t);
+        w->now = t;
+
+        if (k == k_old)
+                return;
+
+        if ((k >> level_shift(TIMER_WHEEL_LEVELS)) != (k_old >> level_shift(TIMER_WHEEL_LEVELS)))
+                far_refresh(w);
+
+        /* The slots of the grid points we reached now are split up into the levels below */
+        for (unsigned l = TIMER_WHEEL_LEVELS - 1; l > 0; l--) {
+                unsigned idx;
+                uint64_t bit;
+
+                if ((k >> level_shift(l)) == (k_old >> level_shift(l)))
+                        continue;
+
+                idx = (k >> level_shift(l)) % TIMER_WHEEL_SLOTS;
+                bit = UINT64_C(1) << idx;
+
+                if (!FLAGS_SET(w->used[l], bit))
+                        continue;
+
+                w->used[l] &= ~bit;
+                relink(w, TAKE_PTR(w->slots[l][idx]));
+        }
+}
+
+usec_t timer_wheel_next(TimerWheel *w) {
+        unsigned level, idx;
+        usec_t t, m;
+
+        assert(w);
+
+        if (!w->far_min_valid)
+                far_refresh(w);
+
+        t = w->far_min;
+
+        LIST_FOREACH(entries, i, w->overdue)
+                t = MIN(t, i->time);
+
+        if (wheel_first(w, &level, &idx, &m))
+                t = MIN(t, m);
+
+        return t;
+}
+
+TimerWheelEntry* timer_wheel_pop(TimerWheel *w, usec_t n) {
+        unsigned level, idx;
+        usec_t t;
+
+        assert(w);
+
+        for (;;) {
+                /* Overdue entries are normally all due, unless the clock jumped backwards */
+                LIST_FOREACH(entries, i, w->overdue)
+                        if (i->time <= n) {
+                                timer_wheel_remove(w, i);
+                                return i;
+                        }
+
+                if (!w->far_min_valid)
+                        far_refresh(w);
+
+                if (w->far_min <= n)
+                        LIST_FOREACH(entries, i, w->far)
+                                if (i->time <= n) {
+                                        timer_wheel_remove(w, i);
+                                        return i;
+                                }
+
+                if (!wheel_first(w, &level, &idx, &t) || t > n)
+                        break;
+
+                if (level == 0) {
+                        TimerWheelEntry *i = w->slots[0][idx];
+
+                        timer_wheel_remove(w, i);
+                        return i;
+                }
+
+                /* The earliest entry is in a slot of a higher level, move the wheel forward to it, so that
+                 * the slot is split up, and the entry ends up in the overdue list. */
+                wheel_advance(w, t);
+        }
+
+        /* Nothing is due anymore, hence the wheel may move forward. Never move it backwards though, or
+         * the slots would not match the grid points anymore. */
+        if (n > w->now)
+                wheel_advance(w, n);
+
+        return NULL;
+}
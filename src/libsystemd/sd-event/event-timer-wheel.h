@@ -0,0 +1,64 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+#pragma once
+
+#include <inttypes.h>
+#include <limits.h>
+#include <stdbool.h>
+
+#include "list.h"
+#include "macro.h"
+#include "time-util.h"
+
+/* A hierarchical timer wheel, for timers elapsing on the grid sleep_between() in sd-event.c aligns
+ * wakeups to, i.e. on a multiple of 250ms shifted by the per-system perturbation. The first level has one
+ * slot per grid point, each further level has one slot per TIMER_WHEEL_SLOTS slots of the level below,
+ * which are moved into the level below once the time reaches them. Adding, removing and popping timers is
+ * O(1) (amortized), unlike with the prioq, which makes a difference when many timers are re-armed
+ * continuously. Timers off the grid, past due, or too far in the future are kept in unordered lists
+ * instead. */
+
+#define TIMER_WHEEL_LEVELS 4U
+#define TIMER_WHEEL_SLOTS_BITS 6U
+#define TIMER_WHEEL_SLOTS (1U << TIMER_WHEEL_SLOTS_BITS)
+
+/* The distance between two grid points. Timers with less accuracy than this cannot be aligned to the
+ * grid, and should be kept in a prioq instead. */
+#define TIMER_WHEEL_GRANULARITY (250 * USEC_PER_MSEC)
+
+typedef struct TimerWheel TimerWheel;
+
+typedef struct TimerWheelEntry TimerWheelEntry;
+
+struct TimerWheelEntry {
+        LIST_FIELDS(TimerWheelEntry, entries);
+        usec_t time;
+        unsigned slot;
+};
+
+#define TIMER_WHEEL_SLOT_NULL UINT_MAX
+
+static inline void timer_wheel_entry_init(TimerWheelEntry *i) {
+        *i = (TimerWheelEntry) {
+                .slot = TIMER_WHEEL_SLOT_NULL,
+        };
+}
+
+static inline bool timer_wheel_entry_is_linked(const TimerWheelEntry *i) {
+        return i->slot != TIMER_WHEEL_SLOT_NULL;
+}
+
+/* 'now' is the current time of the clock, and only used as the starting point of the wheel, which
+ * afterwards follows the times passed to timer_wheel_pop(). */
+int timer_wheel_new(usec_t perturb, usec_t now, TimerWheel **ret);
+TimerWheel* timer_wheel_free(TimerWheel *w);
+DEFINE_TRIVIAL_CLEANUP_FUNC(TimerWheel*, timer_wheel_free);
+
+/* Neither of these can fail, hence they may be used on paths that cannot be undone */
+void timer_wheel_put(TimerWheel *w, TimerWheelEntry *i, usec_t time);
+void timer_wheel_remove(TimerWheel *w, TimerWheelEntry *i);
+
+/* Returns the time the earliest entry elapses at, or USEC_INFINITY if the wheel is empty */
+usec_t timer_wheel_next(TimerWheel *w);
+
+/* Unlinks and returns one entry that elapsed at time n, or NULL if there is none (anymore) */
+TimerWheelEntry* timer_wheel_pop(TimerWheel *w, usec_t n);
@@ -0,0 +1,326 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <endian.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if HAVE_LINUX_IO_URING_H
+#include <linux/io_uring.h>
+#endif
+
+#include "alloc-util.h"
+#include "event-uring.h"
+#include "fd-util.h"
+#include "memory-util.h"
+
+#if HAVE_LINUX_IO_URING_H && defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(IORING_ENTER_EXT_ARG)
+
+struct EventUring {
+        int fd;
+
+        void *sq_ring, *cq_ring;
+        size_t sq_ring_size, cq_ring_size;
+        struct io_uring_sqe *sqes;
+        size_t sqes_size;
+
+        unsigned sq_entries;
+        unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+        unsigned *cq_head, *cq_tail, *cq_mask;
+        struct io_uring_cqe *cqes;
+};
+
+int event_uring_new(unsigned entries, EventUring **ret) {
+        _cleanup_(event_uring_freep) EventUring *u = NULL;
+        struct io_uring_params p = {};
+        int fd;
+
+        assert(entries > 0);
+        assert(ret);
+
+        fd = syscall(__NR_io_uring_setup, entries, &p);
+        if (fd < 0)
+                return -errno;
+
+        u = new(EventUring, 1);
+        if (!u) {
+                safe_close(fd);
+                return -ENOMEM;
+        }
+
+        *u = (EventUring) {
+                .fd = fd_move_above_stdio(fd),
+                .sq_ring = MAP_FAILED,
+                .cq_ring = MAP_FAILED,
+                .sqes = MAP_FAILED,
+                .sq_entries = p.sq_entries,
+        };
+
+        /* We need the time-out in io_uring_enter() (5.11), and rely on completions never being dropped
+         * (5.5) */
+        if (!FLAGS_SET(p.features, IORING_FEAT_EXT_ARG|IORING_FEAT_NODROP))
+                return -EOPNOTSUPP;
+
+        u->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        u->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+
+        if (FLAGS_SET(p.features, IORING_FEAT_SINGLE_MMAP))
+                u->sq_ring_size = u->cq_ring_size = MAX(u->sq_ring_size, u->cq_ring_size);
+
+        u->sq_ring = mmap(NULL, u->sq_ring_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, u->fd, IORING_OFF_SQ_RING);
+        if (u->sq_ring == MAP_FAILED)
+                return -errno;
+
+        if (FLAGS_SET(p.features, IORING_FEAT_SINGLE_MMAP))
+                u->cq_ring = u->sq_ring;
+        else {
+                u->cq_ring = mmap(NULL, u->cq_ring_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, u->fd, IORING_OFF_CQ_RING);
+                if (u->cq_ring == MAP_FAILED)
+                        return -errno;
+        }
+
+        u->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+        u->sqes = mmap(NULL, u->sqes_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, u->fd, IORING_OFF_SQES);
+        if (u->sqes == MAP_FAILED)
+                return -errno;
+
+        u->sq_head = (unsigned*) ((uint8_t*) u->sq_ring + p.sq_off.head);
+        u->sq_tail = (unsigned*) ((uint8_t*) u->sq_ring + p.sq_off.tail);
+        u->sq_mask = (unsigned*) ((uint8_t*) u->sq_ring + p.sq_off.ring_mask);
+        u->sq_array = (unsigned*) ((uint8_t*) u->sq_ring + p.sq_off.array);
+        u->cq_head = (unsigned*) ((uint8_t*) u->cq_ring + p.cq_off.head);
+        u->cq_tail = (unsigned*) ((uint8_t*) u->cq_ring + p.cq_off.tail);
+        u->cq_mask = (unsigned*) ((uint8_t*) u->cq_ring + p.cq_off.ring_mask);
+        u->cqes = (struct io_uring_cqe*) ((uint8_t*) u->cq_ring + p.cq_off.cqes);
+
+        *ret = TAKE_PTR(u);
+        return 0;
+}
+
+EventUring* event_uring_free(EventUring *u) {
+        if (!u)
+                return NULL;
+
+        if (u->sqes != MAP_FAILED)
+                (void) munmap(u->sqes, u->sqes_size);
+        if (u->cq_ring != MAP_FAILED && u->cq_ring != u->sq_ring)
+                (void) munmap(u->cq_ring, u->cq_ring_size);
+        if (u->sq_ring != MAP_FAILED)
+                (void) munmap(u->sq_ring, u->sq_ring_size);
+
+        safe_close(u->fd);
+
+        return mfree(u);
+}
+
+int event_uring_get_fd(EventUring *u) {
+        assert(u);
+
+        return u->fd;
+}
+
+static unsigned uring_n_queued(EventUring *u) {
+        assert(u);
+
+        /* We are the only writer of the tail, while the kernel moves the head as it consumes entries */
+        return *u->sq_tail - __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE);
+}
+
+static int uring_get_sqe(EventUring *u, struct io_uring_sqe **ret) {
+        struct io_uring_sqe *sqe;
+        unsigned idx;
+        int r;
+
+        assert(u);
+        assert(ret);
+
+        if (uring_n_queued(u) >= u->sq_entries) {
+                /* The submission queue is full, hand what we have to the kernel right away */
+                r = event_uring_enter(u, 0);
+                if (r < 0)
+                        return r;
+
+                if (uring_n_queued(u) >= u->sq_entries)
+                        return -EBUSY;
+        }
+
+        idx = *u->sq_tail & *u->sq_mask;
+        sqe = u->sqes + idx;
+        memzero(sqe, sizeof(*sqe));
+        u->sq_array[idx] = idx;
+
+        *ret = sqe;
+        return 0;
+}
+
+static void uring_commit_sqe(EventUring *u) {
+        assert(u);
+
+        /* Make the entry visible to the kernel only once it is fully initialized */
+        __atomic_store_n(u->sq_tail, *u->sq_tail + 1, __ATOMIC_RELEASE);
+}
+
+int event_uring_queue_read(EventUring *u, int fd, void *buffer, size_t size, uint64_t user_data) {
+        struct io_uring_sqe *sqe;
+        int r;
+
+        assert(u);
+        assert(fd >= 0);
+        assert(buffer);
+        assert(size > 0 && size <= UINT32_MAX);
+
+        r = uring_get_sqe(u, &sqe);
+        if (r < 0)
+                return r;
+
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = fd;
+        sqe->addr = PTR_TO_UINT64(buffer);
+        sqe->len = size;
+        sqe->off = UINT64_MAX; /* Read from the current file position, like read() */
+        sqe->user_data = user_data;
+
+        uring_commit_sqe(u);
+        return 0;
+}
+
+int event_uring_queue_poll(EventUring *u, int fd, uint32_t events, uint64_t user_data) {
+        struct io_uring_sqe *sqe;
+        int r;
+
+        assert(u);
+        assert(fd >= 0);
+
+        r = uring_get_sqe(u, &sqe);
+        if (r < 0)
+                return r;
+
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = fd;
+#if __BYTE_ORDER == __BIG_ENDIAN
+        sqe->poll32_events = (events << 16) | (events >> 16);
+#else
+        sqe->poll32_events = events;
+#endif
+        sqe->user_data = user_data;
+
+        uring_commit_sqe(u);
+        return 0;
+}
+
+int event_uring_queue_cancel(EventUring *u, uint64_t target, uint64_t user_data) {
+        struct io_uring_sqe *sqe;
+        int r;
+
+        assert(u);
+
+        r = uring_get_sqe(u, &sqe);
+        if (r < 0)
+                return r;
+
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -EBADF;
+        sqe->addr = target;
+        sqe->user_data = user_data;
+
+        uring_commit_sqe(u);
+        return 0;
+}
+
+int event_uring_enter(EventUring *u, usec_t timeout) {
+        struct io_uring_getevents_arg arg = {};
+        struct __kernel_timespec ts;
+        unsigned flags = 0, min_complete = 0, n;
+        long r;
+
+        assert(u);
+
+        n = uring_n_queued(u);
+
+        if (timeout > 0) {
+                flags |= IORING_ENTER_GETEVENTS|IORING_ENTER_EXT_ARG;
+                min_complete = 1;
+
+                if (timeout != USEC_INFINITY) {
+                        ts = (struct __kernel_timespec) {
+                                .tv_sec = timeout / USEC_PER_SEC,
+                                .tv_nsec = (timeout % USEC_PER_SEC) * NSEC_PER_USEC,
+                        };
+                        arg.ts = PTR_TO_UINT64(&ts);
+                }
+        } else if (n == 0)
+                return 0;
+
+        r = syscall(__NR_io_uring_enter, u->fd, n, min_complete, flags, &arg, sizeof(arg));
+        if (r < 0) {
+                if (errno == ETIME)
+                        return 0;
+
+                /* The completion queue overflowed, the pending completions need to be processed first */
+                if (IN_SET(errno, EBUSY, EAGAIN))
+                        return 0;
+
+                return -errno;
+        }
+
+        return 0;
+}
+
+bool event_uring_next_completion(EventUring *u, uint64_t *ret_user_data, int32_t *ret_result) {
+        struct io_uring_cqe *cqe;
+        unsigned head;
+
+        assert(u);
+        assert(ret_user_data);
+        assert(ret_result);
+
+        head = *u->cq_head;
+        if (head == __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE))
+                return false;
+
+        cqe = u->cqes + (head & *u->cq_mask);
+        *ret_user_data = cqe->user_data;
+        *ret_result = cqe->res;
+
+        /* Hand the slot back to the kernel only after we copied the entry out */
+        __atomic_store_n(u->cq_head, head + 1, __ATOMIC_RELEASE);
+        return true;
+}
+
+#else
+
+int event_uring_new(unsigned entries, EventUring **ret) {
+        return -EOPNOTSUPP;
+}
+
+EventUring* event_uring_free(EventUring *u) {
+        assert(!u);
+        return NULL;
+}
+
+int event_uring_get_fd(EventUring *u) {
+        assert_not_reached();
+}
+
+int event_uring_queue_read(EventUring *u, int fd, void *buffer, size_t size, uint64_t user_data) {
+        assert_not_reached();
+}
+
+int event_uring_queue_poll(EventUring *u, int fd, uint32_t events, uint64_t user_data) {
+        assert_not_reached();
+}
+
+int event_uring_queue_cancel(EventUring *u, uint64_t target, uint64_t user_data) {
+        assert_not_reached();
+}
+
+int event_uring_enter(EventUring *u, usec_t timeout) {
+        assert_not_reached();
+}
+
+bool event_uring_next_completion(EventUring *u, uint64_t *ret_user_data, int32_t *ret_result) {
+        assert_not_reached();
+}
+
+#endif
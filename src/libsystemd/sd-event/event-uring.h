@@ -0,0 +1,34 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+#pragma once
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "macro.h"
+#include "time-util.h"
+
+/* A minimal io_uring wrapper on top of the raw syscalls, covering just what sd-event needs: reads into
+ * caller provided buffers, polling a single fd, cancellation, and waiting for completions with a
+ * timeout. */
+
+typedef struct EventUring EventUring;
+
+int event_uring_new(unsigned entries, EventUring **ret);
+EventUring* event_uring_free(EventUring *u);
+DEFINE_TRIVIAL_CLEANUP_FUNC(EventUring*, event_uring_free);
+
+int event_uring_get_fd(EventUring *u);
+
+/* These only queue the request, it is submitted by the next event_uring_enter(). The user_data value is
+ * passed back with the completion. */
+int event_uring_queue_read(EventUring *u, int fd, void *buffer, size_t size, uint64_t user_data);
+int event_uring_queue_poll(EventUring *u, int fd, uint32_t events, uint64_t user_data);
+int event_uring_queue_cancel(EventUring *u, uint64_t target, uint64_t user_data);
+
+/* Submits all queued requests, and waits up to the specified time for at least one completion, unless
+ * the timeout is zero. Returns -EINTR if interrupted by a signal, and 0 on time-out. */
+int event_uring_enter(EventUring *u, usec_t timeout);
+
+/* Pops the next completion, returns false if there is none */
+bool event_uring_next_completion(EventUring *u, uint64_t *ret_user_data, int32_t *ret_result);
@@ -2,9 +2,12 @@
 
 #include <errno.h>
 
+#include "sd-json.h"
+
 #include "event-source.h"
 #include "event-util.h"
 #include "fd-util.h"
+#include "json-util.h"
 #include "log.h"
 #include "string-util.h"
 
@@ -177,3 +180,33 @@ dual_timestamp* event_dual_timestamp_now(sd_event *e, dual_timestamp *ts) {
         assert_se(sd_event_now(e, CLOCK_MONOTONIC, &ts->monotonic) >= 0);
         return ts;
 }
+
+int event_log_statistics(sd_event *e, int level) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        sd_json_variant *i;
+        int r;
+
+        assert(e);
+
+        r = sd_event_get_statistics(e, &v);
+        if (r < 0)
+                return r;
+
+        if (sd_json_variant_elements(v) == 0) {
+                log_full(level, "No event loop statistics collected.");
+                return 0;
+        }
+
+        JSON_VARIANT_ARRAY_FOREACH(i, v)
+                log_full(level,
+                         "Event source %s/%s: dispatched %" PRIu64 " times, %s total, %s max, pending %s total, %s max",
+                         sd_json_variant_string(sd_json_variant_by_key(i, "type")),
+                         strna(sd_json_variant_string(sd_json_variant_by_key(i, "description"))),
+                         sd_json_variant_unsigned(sd_json_variant_by_key(i, "dispatched")),
+                         FORMAT_TIMESPAN(sd_json_variant_unsigned(sd_json_variant_by_key(i, "dispatchUSec")), USEC_PER_MSEC),
+                         FORMAT_TIMESPAN(sd_json_variant_unsigned(sd_json_variant_by_key(i, "dispatchMaxUSec")), 1),
+                         FORMAT_TIMESPAN(sd_json_variant_unsigned(sd_json_variant_by_key(i, "pendingUSec")), USEC_PER_MSEC),
+                         FORMAT_TIMESPAN(sd_json_variant_unsigned(sd_json_variant_by_key(i, "pendingMaxUSec")), 1));
+
+        return 0;
+}
@@ -38,3 +38,7 @@ int event_add_time_change(sd_event *e, sd_event_source **ret, sd_event_io_handle
 int event_add_child_pidref(sd_event *e, sd_event_source **s, const PidRef *pid, int options, sd_event_child_handler_t callback, void *userdata);
 
 dual_timestamp* event_dual_timestamp_now(sd_event *e, dual_timestamp *ts);
+
+/* Logs the statistics collected by sd_event_set_statistics(), one line per type and description of event
+ * sources, the most expensive first */
+int event_log_statistics(sd_event *e, int level);
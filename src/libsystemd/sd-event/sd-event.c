@@ -10,11 +10,14 @@
 #include "sd-daemon.h"
 #include "sd-event.h"
 #include "sd-id128.h"
+#include "sd-json.h"
 #include "sd-messages.h"
 
 #include "alloc-util.h"
 #include "env-util.h"
 #include "event-source.h"
+#include "event-timer-wheel.h"
+#include "event-uring.h"
 #include "fd-util.h"
 #include "fs-util.h"
 #include "glyph-util.h"
@@ -25,6 +28,7 @@
 #include "macro.h"
 #include "mallinfo-util.h"
 #include "memory-util.h"
+#include "mempool.h"
 #include "missing_magic.h"
 #include "missing_syscall.h"
 #include "missing_threads.h"
@@ -35,6 +39,8 @@
 #include "psi-util.h"
 #include "set.h"
 #include "signal-util.h"
+#include "siphash24.h"
+#include "sort-util.h"
 #include "socket-util.h"
 #include "stat-util.h"
 #include "string-table.h"
@@ -158,6 +164,7 @@ struct sd_event {
         bool need_process_child:1;
         bool watchdog:1;
         bool profile_delays:1;
+        bool collect_statistics:1;
 
         int exit_code;
 
@@ -166,29 +173,79 @@ struct sd_event {
 
         usec_t watchdog_last, watchdog_period;
 
+        /* How many pending event sources of the same priority to dispatch at most in one iteration, and
+         * for how long, see sd_event_set_dispatch_budget() */
+        unsigned dispatch_budget_sources;
+        usec_t dispatch_budget_usec;
+
         unsigned n_sources;
 
         struct epoll_event *event_queue;
 
+        /* Only set if the io_uring backend is enabled, see sd_event_new() */
+        EventUring *uring;
+        bool uring_epoll_polled:1; /* a poll on the epoll fd is queued in the ring */
+        bool uring_in_epoll:1;     /* the ring fd is watched by the epoll fd, as we are embedded */
+
+        /* The buffers of freed I/O read sources whose reads were still in flight */
+        LIST_HEAD(EventIORead, io_read_orphans);
+
         LIST_HEAD(sd_event_source, sources);
 
         sd_event_source *sigint_event_source, *sigterm_event_source;
 
         usec_t last_run_usec, last_log_usec;
         unsigned delays[sizeof(usec_t) * 8];
+
+        /* EventStatistics objects, kept after the event sources they were collected for are gone */
+        Set *statistics;
 };
 
 DEFINE_PRIVATE_ORIGIN_ID_HELPERS(sd_event, event);
 
+/* The number of entries of the submission queue of the ring. It only limits how many requests are queued
+ * between two iterations, not how many reads may be in flight at the same time. */
+#define EVENT_URING_ENTRIES 256U
+
+/* The user_data of ring requests not belonging to an I/O read source, which are identified by their
+ * (aligned) EventIORead pointer instead */
+#define URING_USER_DATA_EPOLL UINT64_C(1)
+#define URING_USER_DATA_CANCEL UINT64_C(2)
+
 static thread_local sd_event *default_event = NULL;
 
 static void source_disconnect(sd_event_source *s);
+static int source_set_pending(sd_event_source *s, bool b);
 static void event_gc_inode_data(sd_event *e, struct inode_data *d);
 
 static sd_event* event_resolve(sd_event *e) {
         return e == SD_EVENT_DEFAULT ? default_event : e;
 }
 
+/* The prioqs of event sources are 4-ary heaps, since they are reshuffled a lot, e.g. whenever a timer is
+ * re-armed. Most of them also store a sort key, which encodes the leading fields of the comparison of the
+ * prioq: two flags in the upper bits, and a time or priority value in the lower bits, saturated so
+ * that keys still order the same way as the comparison functions. */
+#define EVENT_PRIOQ_ARITY 4U
+#define EVENT_PRIOQ_KEY_VALUE_MAX ((UINT64_C(1) << 62) - 1)
+
+static uint64_t event_prioq_key(bool a, bool b, uint64_t value) {
+        return (uint64_t) a << 63 | (uint64_t) b << 62 | MIN(value, EVENT_PRIOQ_KEY_VALUE_MAX);
+}
+
+static uint64_t event_prioq_priority_key_value(int64_t priority) {
+        const int64_t bias = INT64_C(1) << 61;
+
+        return (uint64_t) (CLAMP(priority, -bias, bias - 1) + bias);
+}
+
+static uint64_t pending_prioq_key(const void *p) {
+        const sd_event_source *s = p;
+
+        return event_prioq_key(s->enabled == SD_EVENT_OFF, s->ratelimited,
+                               event_prioq_priority_key_value(s->priority));
+}
+
 static int pending_prioq_compare(const void *a, const void *b) {
         const sd_event_source *x = a, *y = b;
         int r;
@@ -316,6 +373,20 @@ static int latest_time_prioq_compare(const void *a, const void *b) {
         return time_prioq_compare(a, b, time_event_source_latest);
 }
 
+static uint64_t earliest_time_prioq_key(const void *p) {
+        const sd_event_source *s = p;
+
+        return event_prioq_key(s->enabled == SD_EVENT_OFF, !event_source_timer_candidate(s),
+                               time_event_source_next(s));
+}
+
+static uint64_t latest_time_prioq_key(const void *p) {
+        const sd_event_source *s = p;
+
+        return event_prioq_key(s->enabled == SD_EVENT_OFF, !event_source_timer_candidate(s),
+                               time_event_source_latest(s));
+}
+
 static int exit_prioq_compare(const void *a, const void *b) {
         const sd_event_source *x = a, *y = b;
         int r;
@@ -332,6 +403,12 @@ static int exit_prioq_compare(const void *a, const void *b) {
         return CMP(x->priority, y->priority);
 }
 
+static uint64_t exit_prioq_key(const void *p) {
+        const sd_event_source *s = p;
+
+        return event_prioq_key(s->enabled == SD_EVENT_OFF, false, event_prioq_priority_key_value(s->priority));
+}
+
 static void free_clock_data(struct clock_data *d) {
         assert(d);
         assert(d->wakeup == WAKEUP_CLOCK_DATA);
@@ -339,6 +416,45 @@ static void free_clock_data(struct clock_data *d) {
         safe_close(d->fd);
         prioq_free(d->earliest);
         prioq_free(d->latest);
+        timer_wheel_free(d->wheel);
+}
+
+static void event_free_uring(sd_event *e) {
+        uint64_t user_data;
+        int32_t result;
+
+        assert(e);
+
+        if (!e->uring)
+                return;
+
+        /* The reads of freed I/O read sources were cancelled, but the kernel may still write into their
+         * buffers until the cancellation completed, hence wait for that. Not in a forked off child though,
+         * as the ring is shared with the parent. */
+        for (unsigned i = 0; e->io_read_orphans && !event_origin_changed(e) && i < 10; i++) {
+                if (event_uring_enter(e->uring, 100 * USEC_PER_MSEC) < 0)
+                        break;
+
+                while (event_uring_next_completion(e->uring, &user_data, &result)) {
+                        EventIORead *op;
+
+                        if (IN_SET(user_data, URING_USER_DATA_EPOLL, URING_USER_DATA_CANCEL))
+                                continue;
+
+                        op = UINT64_TO_PTR(user_data);
+                        assert(!op->source);
+
+                        LIST_REMOVE(orphans, e->io_read_orphans, op);
+                        free(op);
+                }
+        }
+
+        if (event_origin_changed(e))
+                LIST_CLEAR(orphans, e->io_read_orphans, free);
+        else if (e->io_read_orphans)
+                log_debug("Reads on the io_uring could not be cancelled, leaking their buffers.");
+
+        e->uring = event_uring_free(e->uring);
 }
 
 static sd_event* event_free(sd_event *e) {
@@ -360,6 +476,8 @@ static sd_event* event_free(sd_event *e) {
         if (e->default_event_ptr)
                 *(e->default_event_ptr) = NULL;
 
+        event_free_uring(e);
+
         safe_close(e->epoll_fd);
         safe_close(e->watchdog_fd);
 
@@ -380,6 +498,7 @@ static sd_event* event_free(sd_event *e) {
 
         hashmap_free(e->child_sources);
         set_free(e->post_sources);
+        set_free(e->statistics);
 
         free(e->event_queue);
 
@@ -417,9 +536,11 @@ _public_ int sd_event_new(sd_event** ret) {
                 .boottime_alarm.next = USEC_INFINITY,
                 .perturb = USEC_INFINITY,
                 .origin_id = origin_id_query(),
+                .dispatch_budget_sources = 1,
+                .dispatch_budget_usec = USEC_INFINITY,
         };
 
-        r = prioq_ensure_allocated(&e->pending, pending_prioq_compare);
+        r = prioq_ensure_allocated_full(&e->pending, pending_prioq_compare, pending_prioq_key, EVENT_PRIOQ_ARITY);
         if (r < 0)
                 goto fail;
 
@@ -431,12 +552,29 @@ _public_ int sd_event_new(sd_event** ret) {
 
         e->epoll_fd = fd_move_above_stdio(e->epoll_fd);
 
+        r = secure_getenv_bool("SD_EVENT_IO_URING");
+        if (r < 0 && r != -ENXIO)
+                log_debug_errno(r, "Failed to parse $SD_EVENT_IO_URING, ignoring: %m");
+        if (r > 0) {
+                /* The ring is optional: if the kernel does not support it, or it is blocked, let's just
+                 * use epoll alone. */
+                r = event_uring_new(EVENT_URING_ENTRIES, &e->uring);
+                if (r < 0)
+                        log_debug_errno(r, "Failed to set up io_uring, using epoll only: %m");
+        }
+
         if (secure_getenv("SD_EVENT_PROFILE_DELAYS")) {
                 log_debug("Event loop profiling enabled. Logarithmic histogram of event loop iterations in the range 2^0 %s 2^63 us will be logged every 5s.",
                           special_glyph(SPECIAL_GLYPH_ELLIPSIS));
                 e->profile_delays = true;
         }
 
+        r = secure_getenv_bool("SD_EVENT_STATISTICS");
+        if (r < 0 && r != -ENXIO)
+                log_debug_errno(r, "Failed to parse $SD_EVENT_STATISTICS, ignoring: %m");
+        if (r > 0)
+                e->collect_statistics = true;
+
         *ret = e;
         return 0;
 
@@ -484,6 +622,71 @@ _public_ sd_event_source* sd_event_source_disable_unref(sd_event_source *s) {
         return sd_event_source_unref(s);
 }
 
+static bool source_io_read_uses_uring(sd_event_source *s) {
+        assert(s);
+        assert(s->type == SOURCE_IO);
+
+        /* I/O read sources have their reads done by the ring if there is one, rather than being watched by
+         * the epoll fd */
+        return s->io.read && s->event->uring;
+}
+
+static int source_io_read_queue(sd_event_source *s) {
+        EventIORead *op;
+        int r;
+
+        assert(s);
+        assert(source_io_read_uses_uring(s));
+
+        op = s->io.read;
+
+        /* Don't queue another read while the buffer is still in use. The read is queued once the callback
+         * returned, or the current result was dispatched. */
+        if (op->in_flight || op->completed || s->dispatching)
+                return 0;
+
+        r = event_uring_queue_read(s->event->uring, s->io.fd, op->buffer, op->size, PTR_TO_UINT64(op));
+        if (r < 0)
+                return r;
+
+        op->in_flight = true;
+        return 0;
+}
+
+static void source_io_read_cancel(sd_event_source *s) {
+        int r;
+
+        assert(s);
+        assert(source_io_read_uses_uring(s));
+
+        if (!s->io.read->in_flight)
+                return;
+
+        r = event_uring_queue_cancel(s->event->uring, PTR_TO_UINT64(s->io.read), URING_USER_DATA_CANCEL);
+        if (r < 0)
+                log_debug_errno(r, "Failed to cancel read of source %s (type %s), ignoring: %m",
+                                strna(s->description), event_source_type_to_string(s->type));
+}
+
+static void source_io_read_detach(sd_event_source *s) {
+        EventIORead *op;
+
+        assert(s);
+        assert(s->type == SOURCE_IO);
+
+        op = s->io.read;
+        if (!op || !op->in_flight || event_origin_changed(s->event))
+                return;
+
+        /* If the read is still in flight, the kernel may still write into the buffer, hence hand it over to
+         * the event loop, which keeps it around until the completion of the read was seen. The read was
+         * cancelled already when the source was unregistered. Otherwise the buffer is freed with the
+         * source, as it might still be used by the handler that is being dispatched. */
+        op->source = NULL;
+        LIST_PREPEND(orphans, s->event->io_read_orphans, op);
+        s->io.read = NULL;
+}
+
 static void source_io_unregister(sd_event_source *s) {
         assert(s);
         assert(s->type == SOURCE_IO);
@@ -494,6 +697,12 @@ static void source_io_unregister(sd_event_source *s) {
         if (!s->io.registered)
                 return;
 
+        if (source_io_read_uses_uring(s)) {
+                source_io_read_cancel(s);
+                s->io.registered = false;
+                return;
+        }
+
         if (epoll_ctl(s->event->epoll_fd, EPOLL_CTL_DEL, s->io.fd, NULL) < 0)
                 log_debug_errno(errno, "Failed to remove source %s (type %s) from epoll, ignoring: %m",
                                 strna(s->description), event_source_type_to_string(s->type));
@@ -510,6 +719,21 @@ static int source_io_register(
         assert(s->type == SOURCE_IO);
         assert(enabled != SD_EVENT_OFF);
 
+        if (source_io_read_uses_uring(s)) {
+                int r;
+
+                /* If data was read while the source was offline, dispatch that first */
+                if (s->io.read->completed)
+                        r = source_set_pending(s, true);
+                else
+                        r = source_io_read_queue(s);
+                if (r < 0)
+                        return r;
+
+                s->io.registered = true;
+                return 0;
+        }
+
         struct epoll_event ev = {
                 .events = events | (enabled == SD_EVENT_ONESHOT ? EPOLLONESHOT : 0),
                 .data.ptr = s,
@@ -884,6 +1108,33 @@ static void event_source_pp_prioq_reshuffle(sd_event_source *s) {
                 prioq_reshuffle(s->event->prepare, s, &s->prepare_index);
 }
 
+static usec_t sleep_between(sd_event *e, usec_t a, usec_t b);
+
+static bool event_source_uses_timer_wheel(const sd_event_source *s) {
+        assert(s);
+
+        /* Whether the timer event source is scheduled via the timer wheel of its clock, rather than via the
+         * prioqs, when it is not ratelimited. */
+        return EVENT_SOURCE_IS_TIME(s->type) && s->time.accuracy >= TIMER_WHEEL_GRANULARITY;
+}
+
+static void event_source_timer_wheel_update(sd_event_source *s, struct clock_data *d) {
+        assert(s);
+        assert(d);
+        assert(d->wheel);
+
+        timer_wheel_remove(d->wheel, &s->time.wheel_entry);
+
+        /* Unlike the prioqs, the wheel only contains the event sources it makes sense to wake up for */
+        if (s->enabled == SD_EVENT_OFF || s->pending || s->ratelimited || s->time.next == USEC_INFINITY)
+                return;
+
+        /* Schedule the event source at the time we'd wake up for it if it was the only one, so that
+         * wakeups are coalesced the same way as for the event sources in the prioqs. */
+        timer_wheel_put(d->wheel, &s->time.wheel_entry,
+                        sleep_between(s->event, s->time.next, usec_add(s->time.next, s->time.accuracy)));
+}
+
 static void event_source_time_prioq_reshuffle(sd_event_source *s) {
         struct clock_data *d;
 
@@ -895,9 +1146,15 @@ static void event_source_time_prioq_reshuffle(sd_event_source *s) {
 
         if (s->ratelimited)
                 d = &s->event->monotonic;
-        else if (EVENT_SOURCE_IS_TIME(s->type))
+        else if (EVENT_SOURCE_IS_TIME(s->type)) {
                 assert_se(d = event_get_clock_data(s->event, s->type));
-        else
+
+                if (event_source_uses_timer_wheel(s)) {
+                        event_source_timer_wheel_update(s, d);
+                        d->needs_rearm = true;
+                        return;
+                }
+        } else
                 return; /* no-op for an event source which is neither a timer nor ratelimited. */
 
         prioq_reshuffle(d->earliest, s, &s->earliest_index);
@@ -918,6 +1175,22 @@ static void event_source_time_prioq_remove(
         d->needs_rearm = true;
 }
 
+static void event_source_timer_remove(sd_event_source *s) {
+        struct clock_data *d;
+
+        assert(s);
+        assert(EVENT_SOURCE_IS_TIME(s->type));
+
+        /* Removes a timer event source from the scheduling of its own clock, wherever it is kept */
+
+        assert_se(d = event_get_clock_data(s->event, s->type));
+
+        if (d->wheel)
+                timer_wheel_remove(d->wheel, &s->time.wheel_entry);
+
+        event_source_time_prioq_remove(s, d);
+}
+
 static void source_disconnect(sd_event_source *s) {
         sd_event *event;
         int r;
@@ -935,6 +1208,7 @@ static void source_disconnect(sd_event_source *s) {
                 if (s->io.fd >= 0)
                         source_io_unregister(s);
 
+                source_io_read_detach(s);
                 break;
 
         case SOURCE_TIME_REALTIME:
@@ -946,11 +1220,8 @@ static void source_disconnect(sd_event_source *s) {
                  * it is ratelimited, we'll remove it below, separately. Why? Because the clock used might
                  * differ: ratelimiting always uses CLOCK_MONOTONIC, but timer events might use any clock */
 
-                if (!s->ratelimited) {
-                        struct clock_data *d;
-                        assert_se(d = event_get_clock_data(s->event, s->type));
-                        event_source_time_prioq_remove(s, d);
-                }
+                if (!s->ratelimited)
+                        event_source_timer_remove(s);
 
                 break;
 
@@ -1075,13 +1346,42 @@ static void source_disconnect(sd_event_source *s) {
                 sd_event_unref(event);
 }
 
+/* Let's allocate exactly what we need. Note that the difference of the smallest event source structure to
+ * the largest is 144 bytes on x86-64 at the time of writing, i.e. more than two cache lines. Sources are
+ * created and destroyed a lot (e.g. for each varlink connection or bus method call with a timeout), hence
+ * keep one pool per type when mempools are enabled, and use the tile sizes for malloc() otherwise. */
+#define SOURCE_POOL(name, field)                                                                        \
+        MEMPOOL_INIT("sd_event_source_" name,                                                           \
+                     CONST_ALIGN_TO(endoffsetof_field(sd_event_source, field), alignof(sd_event_source)), \
+                     16)
+
+static struct mempool source_pools[_SOURCE_EVENT_SOURCE_TYPE_MAX] = {
+        [SOURCE_IO]                  = SOURCE_POOL("io", io),
+        [SOURCE_TIME_REALTIME]       = SOURCE_POOL("time_realtime", time),
+        [SOURCE_TIME_BOOTTIME]       = SOURCE_POOL("time_boottime", time),
+        [SOURCE_TIME_MONOTONIC]      = SOURCE_POOL("time_monotonic", time),
+        [SOURCE_TIME_REALTIME_ALARM] = SOURCE_POOL("time_realtime_alarm", time),
+        [SOURCE_TIME_BOOTTIME_ALARM] = SOURCE_POOL("time_boottime_alarm", time),
+        [SOURCE_SIGNAL]              = SOURCE_POOL("signal", signal),
+        [SOURCE_CHILD]               = SOURCE_POOL("child", child),
+        [SOURCE_DEFER]               = SOURCE_POOL("defer", defer),
+        [SOURCE_POST]                = SOURCE_POOL("post", post),
+        [SOURCE_EXIT]                = SOURCE_POOL("exit", exit),
+        [SOURCE_INOTIFY]             = SOURCE_POOL("inotify", inotify),
+        [SOURCE_MEMORY_PRESSURE]     = SOURCE_POOL("memory_pressure", memory_pressure),
+};
+
 static sd_event_source* source_free(sd_event_source *s) {
         assert(s);
 
         source_disconnect(s);
 
-        if (s->type == SOURCE_IO && s->io.owned)
-                s->io.fd = safe_close(s->io.fd);
+        if (s->type == SOURCE_IO) {
+                if (s->io.owned)
+                        s->io.fd = safe_close(s->io.fd);
+
+                free(s->io.read);
+        }
 
         if (s->type == SOURCE_CHILD) {
                 /* Eventually the kernel will do this automatically for us, but for now let's emulate this (unreliably) in userspace. */
@@ -1130,6 +1430,13 @@ static sd_event_source* source_free(sd_event_source *s) {
                 s->destroy_callback(s->userdata);
 
         free(s->description);
+
+        if (s->from_pool) {
+                /* Ensure that the object didn't get migrated between threads. */
+                assert_se(is_main_thread());
+                return mempool_free_tile(&source_pools[s->type], s);
+        }
+
         return mfree(s);
 }
 DEFINE_TRIVIAL_CLEANUP_FUNC(sd_event_source*, source_free);
@@ -1148,6 +1455,9 @@ static int source_set_pending(sd_event_source *s, bool b) {
         if (b) {
                 s->pending_iteration = s->event->iteration;
 
+                if (_unlikely_(s->event->collect_statistics))
+                        s->pending_since = now(CLOCK_MONOTONIC);
+
                 r = prioq_put(s->event->pending, s, &s->pending_index);
                 if (r < 0) {
                         s->pending = false;
@@ -1184,39 +1494,26 @@ static int source_set_pending(sd_event_source *s, bool b) {
 }
 
 static sd_event_source* source_new(sd_event *e, bool floating, EventSourceType type) {
-
-        /* Let's allocate exactly what we need. Note that the difference of the smallest event source
-         * structure to the largest is 144 bytes on x86-64 at the time of writing, i.e. more than two cache
-         * lines. */
-        static const size_t size_table[_SOURCE_EVENT_SOURCE_TYPE_MAX] = {
-                [SOURCE_IO]                  = endoffsetof_field(sd_event_source, io),
-                [SOURCE_TIME_REALTIME]       = endoffsetof_field(sd_event_source, time),
-                [SOURCE_TIME_BOOTTIME]       = endoffsetof_field(sd_event_source, time),
-                [SOURCE_TIME_MONOTONIC]      = endoffsetof_field(sd_event_source, time),
-                [SOURCE_TIME_REALTIME_ALARM] = endoffsetof_field(sd_event_source, time),
-                [SOURCE_TIME_BOOTTIME_ALARM] = endoffsetof_field(sd_event_source, time),
-                [SOURCE_SIGNAL]              = endoffsetof_field(sd_event_source, signal),
-                [SOURCE_CHILD]               = endoffsetof_field(sd_event_source, child),
-                [SOURCE_DEFER]               = endoffsetof_field(sd_event_source, defer),
-                [SOURCE_POST]                = endoffsetof_field(sd_event_source, post),
-                [SOURCE_EXIT]                = endoffsetof_field(sd_event_source, exit),
-                [SOURCE_INOTIFY]             = endoffsetof_field(sd_event_source, inotify),
-                [SOURCE_MEMORY_PRESSURE]     = endoffsetof_field(sd_event_source, memory_pressure),
-        };
-
+        bool use_pool = mempool_enabled && mempool_enabled();  /* mempool_enabled is a weak symbol */
         sd_event_source *s;
 
         assert(e);
         assert(type >= 0);
         assert(type < _SOURCE_EVENT_SOURCE_TYPE_MAX);
-        assert(size_table[type] > 0);
+        assert(source_pools[type].tile_size > 0);
 
-        s = malloc0(size_table[type]);
-        if (!s)
-                return NULL;
-        /* We use expand_to_usable() here to tell gcc that it should consider this an object of the full
-         * size, even if we only allocate the initial part we need. */
-        s = expand_to_usable(s, sizeof(sd_event_source));
+        if (use_pool) {
+                s = mempool_alloc0_tile(&source_pools[type]);
+                if (!s)
+                        return NULL;
+        } else {
+                s = malloc0(source_pools[type].tile_size);
+                if (!s)
+                        return NULL;
+                /* We use expand_to_usable() here to tell gcc that it should consider this an object of the
+                 * full size, even if we only allocate the initial part we need. */
+                s = expand_to_usable(s, sizeof(sd_event_source));
+        }
 
         /* Note: we cannot use compound initialization here, because sizeof(sd_event_source) is likely larger
          * than what we allocated here. */
@@ -1226,6 +1523,7 @@ static sd_event_source* source_new(sd_event *e, bool floating, EventSourceType t
         s->type = type;
         s->pending_index = PRIOQ_IDX_NULL;
         s->prepare_index = PRIOQ_IDX_NULL;
+        s->from_pool = use_pool;
 
         if (!floating)
                 sd_event_ref(e);
@@ -1285,6 +1583,64 @@ _public_ int sd_event_add_io(
         return 0;
 }
 
+static int io_read_exit_callback(sd_event_source *s, int fd, const void *data, ssize_t size, void *userdata) {
+        assert(s);
+
+        return sd_event_exit(sd_event_source_get_event(s), PTR_TO_INT(userdata));
+}
+
+_public_ int sd_event_add_io_read(
+                sd_event *e,
+                sd_event_source **ret,
+                int fd,
+                size_t buffer_size,
+                sd_event_io_read_handler_t callback,
+                void *userdata) {
+
+        _cleanup_(source_freep) sd_event_source *s = NULL;
+        int r;
+
+        assert_return(e, -EINVAL);
+        assert_return(e = event_resolve(e), -ENOPKG);
+        assert_return(fd >= 0, -EBADF);
+        assert_return(buffer_size > 0 && buffer_size <= UINT32_MAX, -EINVAL);
+        assert_return(e->state != SD_EVENT_FINISHED, -ESTALE);
+        assert_return(!event_origin_changed(e), -ECHILD);
+
+        if (!callback)
+                callback = io_read_exit_callback;
+
+        s = source_new(e, !ret, SOURCE_IO);
+        if (!s)
+                return -ENOMEM;
+
+        s->io.read = malloc(offsetof(EventIORead, buffer) + buffer_size);
+        if (!s->io.read)
+                return -ENOMEM;
+
+        *s->io.read = (EventIORead) {
+                .source = s,
+                .size = buffer_size,
+        };
+
+        s->wakeup = WAKEUP_EVENT_SOURCE;
+        s->io.fd = fd;
+        s->io.events = EPOLLIN;
+        s->io.read_callback = callback;
+        s->userdata = userdata;
+        s->enabled = SD_EVENT_ON;
+
+        r = source_io_register(s, s->enabled, s->io.events);
+        if (r < 0)
+                return r;
+
+        if (ret)
+                *ret = s;
+        TAKE_PTR(s);
+
+        return 0;
+}
+
 static void initialize_perturb(sd_event *e) {
         sd_id128_t id = {};
 
@@ -1351,14 +1707,29 @@ static int setup_clock_data(sd_event *e, struct clock_data *d, clockid_t clock)
                         return r;
         }
 
-        r = prioq_ensure_allocated(&d->earliest, earliest_time_prioq_compare);
+        r = prioq_ensure_allocated_full(&d->earliest, earliest_time_prioq_compare, earliest_time_prioq_key,
+                                        EVENT_PRIOQ_ARITY);
         if (r < 0)
                 return r;
 
-        r = prioq_ensure_allocated(&d->latest, latest_time_prioq_compare);
+        r = prioq_ensure_allocated_full(&d->latest, latest_time_prioq_compare, latest_time_prioq_key,
+                                        EVENT_PRIOQ_ARITY);
         if (r < 0)
                 return r;
 
+        if (!d->wheel) {
+                triple_timestamp ts;
+
+                /* The wheel is aligned to the same grid as sleep_between() */
+                initialize_perturb(e);
+
+                triple_timestamp_now(&ts);
+
+                r = timer_wheel_new(e->perturb, triple_timestamp_by_clock(&ts, clock), &d->wheel);
+                if (r < 0)
+                        return r;
+        }
+
         return 0;
 }
 
@@ -1387,6 +1758,26 @@ static int event_source_time_prioq_put(
         return 0;
 }
 
+static int event_source_timer_put(sd_event_source *s) {
+        struct clock_data *d;
+
+        assert(s);
+        assert(EVENT_SOURCE_IS_TIME(s->type));
+
+        /* Adds a timer event source to the scheduling of its own clock. This cannot fail for event sources
+         * that are kept in the timer wheel. */
+
+        assert_se(d = event_get_clock_data(s->event, s->type));
+
+        if (event_source_uses_timer_wheel(s)) {
+                event_source_timer_wheel_update(s, d);
+                d->needs_rearm = true;
+                return 0;
+        }
+
+        return event_source_time_prioq_put(s, d);
+}
+
 _public_ int sd_event_add_time(
                 sd_event *e,
                 sd_event_source **ret,
@@ -1430,11 +1821,12 @@ _public_ int sd_event_add_time(
         s->time.next = usec;
         s->time.accuracy = accuracy == 0 ? DEFAULT_ACCURACY_USEC : accuracy;
         s->time.callback = callback;
+        timer_wheel_entry_init(&s->time.wheel_entry);
         s->earliest_index = s->latest_index = PRIOQ_IDX_NULL;
         s->userdata = userdata;
         s->enabled = SD_EVENT_ONESHOT;
 
-        r = event_source_time_prioq_put(s, d);
+        r = event_source_timer_put(s);
         if (r < 0)
                 return r;
 
@@ -1857,7 +2249,7 @@ _public_ int sd_event_add_exit(
         assert_return(e->state != SD_EVENT_FINISHED, -ESTALE);
         assert_return(!event_origin_changed(e), -ECHILD);
 
-        r = prioq_ensure_allocated(&e->exit, exit_prioq_compare);
+        r = prioq_ensure_allocated_full(&e->exit, exit_prioq_compare, exit_prioq_key, EVENT_PRIOQ_ARITY);
         if (r < 0)
                 return r;
 
@@ -2616,6 +3008,9 @@ _public_ int sd_event_source_set_description(sd_event_source *s, const char *des
         assert_return(s, -EINVAL);
         assert_return(!event_origin_changed(s->event), -ECHILD);
 
+        /* The statistics are collected per description, look them up again on the next dispatch */
+        s->statistics = NULL;
+
         return free_and_strdup(&s->description, description);
 }
 
@@ -2670,7 +3065,21 @@ _public_ int sd_event_source_set_io_fd(sd_event_source *s, int fd) {
 
         assert(event_source_is_offline(s) == !s->io.registered);
 
-        if (s->io.registered) {
+        if (s->io.registered && source_io_read_uses_uring(s)) {
+                /* Drop what was read from the old fd. A read still in flight on it is cancelled, and queued
+                 * again on the new fd once the cancellation completed, see process_io_read(). */
+                s->io.read->completed = false;
+
+                if (s->io.read->in_flight)
+                        source_io_read_cancel(s);
+                else {
+                        r = source_io_read_queue(s);
+                        if (r < 0) {
+                                s->io.fd = saved_fd;
+                                return r;
+                        }
+                }
+        } else if (s->io.registered) {
                 s->io.registered = false;
 
                 r = source_io_register(s, s->enabled, s->io.events);
@@ -2721,6 +3130,7 @@ _public_ int sd_event_source_set_io_events(sd_event_source *s, uint32_t events)
 
         assert_return(s, -EINVAL);
         assert_return(s->type == SOURCE_IO, -EDOM);
+        assert_return(!s->io.read, -EDOM);
         assert_return(!(events & ~(EPOLLIN|EPOLLOUT|EPOLLRDHUP|EPOLLPRI|EPOLLERR|EPOLLHUP|EPOLLET)), -EINVAL);
         assert_return(s->event->state != SD_EVENT_FINISHED, -ESTALE);
         assert_return(!event_origin_changed(s->event), -ECHILD);
@@ -3064,6 +3474,10 @@ static int event_source_online(
         if (s->type == SOURCE_EXIT)
                 prioq_reshuffle(s->event->exit, s, &s->exit.prioq_index);
 
+        /* An I/O read source with data read while it was offline was marked pending above already */
+        if (s->type == SOURCE_IO && s->pending)
+                prioq_reshuffle(s->event->pending, s, &s->pending_index);
+
         /* Always reshuffle time prioq, as the ratelimited flag may be changed. */
         event_source_time_prioq_reshuffle(s);
 
@@ -3184,6 +3598,25 @@ _public_ int sd_event_source_set_time_accuracy(sd_event_source *s, uint64_t usec
         if (usec == 0)
                 usec = DEFAULT_ACCURACY_USEC;
 
+        if (!s->ratelimited && (usec >= TIMER_WHEEL_GRANULARITY) != event_source_uses_timer_wheel(s)) {
+                usec_t old = s->time.accuracy;
+
+                /* The event source moves between the prioqs and the timer wheel */
+                event_source_timer_remove(s);
+                s->time.accuracy = usec;
+
+                r = event_source_timer_put(s);
+                if (r < 0) {
+                        /* Moving it back cannot fail, as the queue space is still allocated, or since
+                         * this is the timer wheel */
+                        s->time.accuracy = old;
+                        assert_se(event_source_timer_put(s) >= 0);
+                        return r;
+                }
+
+                return 0;
+        }
+
         s->time.accuracy = usec;
 
         event_source_time_prioq_reshuffle(s);
@@ -3348,7 +3781,8 @@ _public_ int sd_event_source_set_prepare(sd_event_source *s, sd_event_handler_t
                 return 0;
         }
 
-        r = prioq_ensure_allocated(&s->event->prepare, prepare_prioq_compare);
+        r = prioq_ensure_allocated_full(&s->event->prepare, prepare_prioq_compare, /* key_func= */ NULL,
+                                        EVENT_PRIOQ_ARITY);
         if (r < 0)
                 return r;
 
@@ -3403,7 +3837,7 @@ static int event_source_enter_ratelimited(sd_event_source *s) {
          * first remove them from the prioq appropriate for their own clock, so that we can use the prioq
          * fields of the event source then for adding it to the CLOCK_MONOTONIC prioq instead. */
         if (EVENT_SOURCE_IS_TIME(s->type))
-                event_source_time_prioq_remove(s, event_get_clock_data(s->event, s->type));
+                event_source_timer_remove(s);
 
         /* Now, let's add the event source to the monotonic clock instead */
         r = event_source_time_prioq_put(s, &s->event->monotonic);
@@ -3426,7 +3860,7 @@ fail:
         /* Reinstall time event sources in the priority queue as before. This shouldn't fail, since the queue
          * space for it should already be allocated. */
         if (EVENT_SOURCE_IS_TIME(s->type))
-                assert_se(event_source_time_prioq_put(s, event_get_clock_data(s->event, s->type)) >= 0);
+                assert_se(event_source_timer_put(s) >= 0);
 
         return r;
 }
@@ -3444,7 +3878,7 @@ static int event_source_leave_ratelimit(sd_event_source *s, bool run_callback) {
 
         /* Let's then add the event source to its native clock prioq again — if this is a timer event source */
         if (EVENT_SOURCE_IS_TIME(s->type)) {
-                r = event_source_time_prioq_put(s, event_get_clock_data(s->event, s->type));
+                r = event_source_timer_put(s);
                 if (r < 0)
                         goto fail;
         }
@@ -3454,7 +3888,7 @@ static int event_source_leave_ratelimit(sd_event_source *s, bool run_callback) {
         if (r < 0) {
                 /* Do something roughly sensible when this failed: undo the two prioq ops above */
                 if (EVENT_SOURCE_IS_TIME(s->type))
-                        event_source_time_prioq_remove(s, event_get_clock_data(s->event, s->type));
+                        event_source_timer_remove(s);
 
                 goto fail;
         }
@@ -3583,7 +4017,7 @@ static int event_arm_timer(
 
         struct itimerspec its = {};
         sd_event_source *a, *b;
-        usec_t t;
+        usec_t t, w;
 
         assert(e);
         assert(d);
@@ -3593,10 +4027,17 @@ static int event_arm_timer(
 
         d->needs_rearm = false;
 
+        w = d->wheel ? timer_wheel_next(d->wheel) : USEC_INFINITY;
+
         a = prioq_peek(d->earliest);
         assert(!a || EVENT_SOURCE_USES_TIME_PRIOQ(a->type));
         if (!a || a->enabled == SD_EVENT_OFF || time_event_source_next(a) == USEC_INFINITY) {
 
+                if (w != USEC_INFINITY) {
+                        t = w;
+                        goto arm;
+                }
+
                 if (d->fd < 0)
                         return 0;
 
@@ -3615,7 +4056,14 @@ static int event_arm_timer(
         assert(!b || EVENT_SOURCE_USES_TIME_PRIOQ(b->type));
         assert(b && b->enabled != SD_EVENT_OFF);
 
-        t = sleep_between(e, time_event_source_next(a), time_event_source_latest(b));
+        /* The wheel time is a good time to wake up for the prioq too, if it lies before the end of its
+         * window */
+        if (w <= time_event_source_latest(b))
+                t = w;
+        else
+                t = sleep_between(e, time_event_source_next(a), time_event_source_latest(b));
+
+arm:
         if (d->next == t)
                 return 0;
 
@@ -3692,6 +4140,23 @@ static int process_timer(
         assert(e);
         assert(d);
 
+        if (d->wheel) {
+                TimerWheelEntry *i;
+
+                while ((i = timer_wheel_pop(d->wheel, n))) {
+                        s = container_of(i, sd_event_source, time.wheel_entry);
+                        assert(EVENT_SOURCE_IS_TIME(s->type));
+                        assert(s->enabled != SD_EVENT_OFF && !s->pending && !s->ratelimited);
+
+                        r = source_set_pending(s, true);
+                        if (r < 0) {
+                                /* Put it back, hence we'll try again next iteration */
+                                event_source_time_prioq_reshuffle(s);
+                                return r;
+                        }
+                }
+        }
+
         for (;;) {
                 s = prioq_peek(d->earliest);
                 assert(!s || EVENT_SOURCE_USES_TIME_PRIOQ(s->type));
@@ -4155,9 +4620,131 @@ static int source_memory_pressure_initiate_dispatch(sd_event_source *s) {
         return 0; /* go on, dispatch to user callback */
 }
 
+static void event_statistics_hash_func(const EventStatistics *x, struct siphash *state) {
+        siphash24_compress_typesafe(x->type, state);
+        siphash24_compress_string(x->description, state);
+}
+
+static int event_statistics_compare_func(const EventStatistics *x, const EventStatistics *y) {
+        int r;
+
+        r = CMP(x->type, y->type);
+        if (r != 0)
+                return r;
+
+        return strcmp_ptr(x->description, y->description);
+}
+
+static EventStatistics* event_statistics_free(EventStatistics *x) {
+        if (!x)
+                return NULL;
+
+        free(x->description);
+        return mfree(x);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(EventStatistics*, event_statistics_free);
+
+DEFINE_PRIVATE_HASH_OPS_WITH_KEY_DESTRUCTOR(
+                event_statistics_hash_ops,
+                EventStatistics,
+                event_statistics_hash_func,
+                event_statistics_compare_func,
+                event_statistics_free);
+
+static EventStatistics* event_source_get_statistics(sd_event_source *s) {
+        _cleanup_(event_statistics_freep) EventStatistics *n = NULL;
+        EventStatistics *x;
+
+        assert(s);
+
+        if (s->statistics)
+                return s->statistics;
+
+        x = set_get(s->event->statistics, &(EventStatistics) { .type = s->type, .description = s->description });
+        if (x)
+                return (s->statistics = x);
+
+        n = new(EventStatistics, 1);
+        if (!n)
+                return NULL;
+
+        *n = (EventStatistics) {
+                .type = s->type,
+        };
+
+        if (s->description) {
+                n->description = strdup(s->description);
+                if (!n->description)
+                        return NULL;
+        }
+
+        if (set_ensure_put(&s->event->statistics, &event_statistics_hash_ops, n) < 0)
+                return NULL;
+
+        return (s->statistics = TAKE_PTR(n));
+}
+
+static void event_source_account_dispatch(sd_event_source *s, EventStatistics *x, usec_t start) {
+        usec_t end, d;
+
+        assert(s);
+        assert(x);
+
+        end = now(CLOCK_MONOTONIC);
+
+        x->n_dispatched++;
+
+        d = usec_sub_unsigned(end, start);
+        x->dispatch_usec = usec_add(x->dispatch_usec, d);
+        x->dispatch_max_usec = MAX(x->dispatch_max_usec, d);
+
+        /* pending_since is not set for event sources that were pending already when statistics were
+         * turned on, nor for exit event sources, which are never marked pending */
+        if (s->pending_since > 0 && s->pending_since <= start) {
+                d = start - s->pending_since;
+                x->pending_usec = usec_add(x->pending_usec, d);
+                x->pending_max_usec = MAX(x->pending_max_usec, d);
+        }
+
+        /* Defer event sources stay pending, count their pending time from now on */
+        s->pending_since = s->pending ? end : 0;
+}
+
+static int source_dispatch_io_read(sd_event_source *s) {
+        EventIORead *op;
+        ssize_t n;
+
+        assert(s);
+        assert(s->type == SOURCE_IO);
+
+        op = ASSERT_PTR(s->io.read);
+
+        if (source_io_read_uses_uring(s)) {
+                /* The kernel did the read for us already */
+                if (!op->completed)
+                        return 0;
+
+                op->completed = false;
+                n = op->result;
+        } else {
+                n = read(s->io.fd, op->buffer, op->size);
+                if (n < 0) {
+                        if (ERRNO_IS_TRANSIENT(errno))
+                                return 0;
+
+                        n = -errno;
+                }
+        }
+
+        return s->io.read_callback(s, s->io.fd, op->buffer, n, s->userdata);
+}
+
 static int source_dispatch(sd_event_source *s) {
+        EventStatistics *statistics = NULL;
         EventSourceType saved_type;
         sd_event *saved_event;
+        usec_t dispatch_start = 0;
         int r = 0;
 
         assert(s);
@@ -4219,12 +4806,20 @@ static int source_dispatch(sd_event_source *s) {
                         return r;
         }
 
+        if (_unlikely_(saved_event->collect_statistics)) {
+                statistics = event_source_get_statistics(s);
+                dispatch_start = now(CLOCK_MONOTONIC);
+        }
+
         s->dispatching = true;
 
         switch (s->type) {
 
         case SOURCE_IO:
-                r = s->io.callback(s, s->io.fd, s->io.revents, s->userdata);
+                if (s->io.read)
+                        r = source_dispatch_io_read(s);
+                else
+                        r = s->io.callback(s, s->io.fd, s->io.revents, s->userdata);
                 break;
 
         case SOURCE_TIME_REALTIME:
@@ -4311,6 +4906,9 @@ static int source_dispatch(sd_event_source *s) {
 
         s->dispatching = false;
 
+        if (_unlikely_(statistics))
+                event_source_account_dispatch(s, statistics, dispatch_start);
+
 finish:
         if (r < 0) {
                 log_debug_errno(r, "Event source %s (type %s) returned error, %s: %m",
@@ -4326,6 +4924,15 @@ finish:
                 source_free(s);
         else if (r < 0)
                 assert_se(sd_event_source_set_enabled(s, SD_EVENT_OFF) >= 0);
+        else if (saved_type == SOURCE_IO && event_source_is_online(s) && source_io_read_uses_uring(s)) {
+                /* The buffer is ours again, queue the next read */
+                r = source_io_read_queue(s);
+                if (r < 0) {
+                        log_debug_errno(r, "Failed to queue read of event source %s (type %s), disabling: %m",
+                                        strna(s->description), event_source_type_to_string(saved_type));
+                        assert_se(sd_event_source_set_enabled(s, SD_EVENT_OFF) >= 0);
+                }
+        }
 
         return 1;
 }
@@ -4607,6 +5214,99 @@ static int epoll_wait_usec(
         return RET_NERRNO(epoll_wait(fd, events, maxevents, msec));
 }
 
+static int process_io_read(sd_event *e, EventIORead *op, int32_t result, int64_t threshold, int64_t *min_priority) {
+        sd_event_source *s;
+        int r;
+
+        assert(e);
+        assert(op);
+        assert(op->in_flight);
+        assert(min_priority);
+
+        op->in_flight = false;
+
+        s = op->source;
+        if (!s) {
+                /* The source is gone already, now the buffer may go too */
+                LIST_REMOVE(orphans, e->io_read_orphans, op);
+                free(op);
+                return 0;
+        }
+
+        if (result == -ECANCELED) {
+                /* Cancelled as the source was disabled or got a new fd. If it is enabled again (still), read
+                 * again. */
+                if (!event_source_is_online(s))
+                        return 0;
+
+                r = source_io_read_queue(s);
+                return r < 0 ? r : 0;
+        }
+
+        op->completed = true;
+        op->result = result;
+
+        /* If the read completed before the cancellation took effect, the result is dispatched once the
+         * source is enabled again */
+        if (!event_source_is_online(s))
+                return 0;
+
+        if (s->priority <= threshold)
+                *min_priority = MIN(*min_priority, s->priority);
+
+        s->io.revents = EPOLLIN;
+        return source_set_pending(s, true);
+}
+
+static int process_uring(sd_event *e, usec_t timeout, int64_t threshold, int64_t *min_priority, bool *ret_epoll_ready) {
+        bool epoll_ready = false, something_new = false;
+        uint64_t user_data;
+        int32_t result;
+        int r;
+
+        assert(e);
+        assert(e->uring);
+        assert(min_priority);
+
+        /* Unless we are embedded, the ring is where we wait, hence let it watch the epoll fd for all
+         * other event sources */
+        if (!e->uring_in_epoll && !e->uring_epoll_polled) {
+                r = event_uring_queue_poll(e->uring, e->epoll_fd, EPOLLIN, URING_USER_DATA_EPOLL);
+                if (r < 0)
+                        return r;
+
+                e->uring_epoll_polled = true;
+        }
+
+        /* This submits the reads and the poll queued since the last iteration in the same syscall */
+        r = event_uring_enter(e->uring, timeout);
+        if (r < 0)
+                return r;
+
+        while (event_uring_next_completion(e->uring, &user_data, &result)) {
+
+                if (user_data == URING_USER_DATA_EPOLL) {
+                        e->uring_epoll_polled = false;
+                        epoll_ready = true;
+                        continue;
+                }
+
+                if (user_data == URING_USER_DATA_CANCEL)
+                        continue;
+
+                r = process_io_read(e, UINT64_TO_PTR(user_data), result, threshold, min_priority);
+                if (r < 0)
+                        return r;
+                if (r > 0)
+                        something_new = true;
+        }
+
+        if (ret_epoll_ready)
+                *ret_epoll_ready = epoll_ready;
+
+        return something_new;
+}
+
 static int process_epoll(sd_event *e, usec_t timeout, int64_t threshold, int64_t *ret_min_priority) {
         size_t n_event_queue, m, n_event_max;
         int64_t min_priority = threshold;
@@ -4626,6 +5326,30 @@ static int process_epoll(sd_event *e, usec_t timeout, int64_t threshold, int64_t
         if (e->buffered_inotify_data_list)
                 timeout = 0;
 
+        if (e->uring) {
+                bool epoll_ready;
+
+                /* If we are embedded, the epoll fd is what our user waits on, and it watches the ring fd,
+                 * see sd_event_get_fd(). Otherwise we wait on the ring, which watches the epoll fd, and only
+                 * look at the latter if it is ready. */
+                r = process_uring(e, e->uring_in_epoll ? 0 : timeout, threshold, &min_priority, &epoll_ready);
+                if (r < 0)
+                        return r;
+                if (r > 0) {
+                        something_new = true;
+                        timeout = 0;
+                }
+
+                if (!e->uring_in_epoll) {
+                        if (!epoll_ready) {
+                                m = 0;
+                                goto finish_wait;
+                        }
+
+                        timeout = 0;
+                }
+        }
+
         for (;;) {
                 r = epoll_wait_usec(
                                 e->epoll_fd,
@@ -4650,6 +5374,7 @@ static int process_epoll(sd_event *e, usec_t timeout, int64_t threshold, int64_t
                 timeout = 0;
         }
 
+finish_wait:
         /* Set timestamp only when this is called first time. */
         if (threshold == INT64_MAX)
                 triple_timestamp_now(&e->timestamp);
@@ -4658,6 +5383,8 @@ static int process_epoll(sd_event *e, usec_t timeout, int64_t threshold, int64_t
 
                 if (e->event_queue[i].data.ptr == INT_TO_PTR(SOURCE_WATCHDOG))
                         r = flush_timer(e, e->watchdog_fd, e->event_queue[i].events, NULL);
+                else if (e->uring && e->event_queue[i].data.ptr == e->uring)
+                        r = process_uring(e, 0, threshold, &min_priority, NULL);
                 else {
                         WakeupType *t = e->event_queue[i].data.ptr;
 
@@ -4739,6 +5466,9 @@ _public_ int sd_event_wait(sd_event *e, uint64_t timeout) {
                 return 1;
         }
 
+        /* Send out the log messages buffered in this iteration before we possibly go to sleep */
+        log_flush();
+
         for (int64_t threshold = INT64_MAX; ; threshold--) {
                 int64_t epoll_min_priority, child_min_priority;
 
@@ -4827,6 +5557,55 @@ finish:
         return r;
 }
 
+static int event_dispatch_batch(sd_event *e, sd_event_source *p) {
+        usec_t start = USEC_INFINITY;
+        int64_t priority;
+        int r;
+
+        assert(e);
+        assert(p);
+
+        /* Dispatches the specified event source, and then further pending event sources of the same
+         * priority, in the order they would have been dispatched in the following iterations, until the
+         * budget is used up. This saves the preparing, the arming of the timers and the polling between
+         * the dispatches, which otherwise dominate when many event sources are pending at once. Event
+         * sources that became pending since we polled, e.g. by the callbacks we invoke, are dispatched too,
+         * as they would have been in the following iterations. */
+
+        priority = p->priority;
+
+        if (e->dispatch_budget_sources > 1 && e->dispatch_budget_usec != USEC_INFINITY)
+                start = now(CLOCK_MONOTONIC);
+
+        for (unsigned n = 0;;) {
+                p->dispatch_iteration = e->iteration;
+
+                r = source_dispatch(p);
+                if (r < 0)
+                        return r;
+
+                if (++n >= e->dispatch_budget_sources)
+                        break;
+
+                if (e->exit_requested)
+                        break;
+
+                p = event_next_pending(e);
+                if (!p || p->priority != priority)
+                        break;
+
+                /* Defer and post event sources may still be pending after they were dispatched, never
+                 * dispatch them twice in the same iteration */
+                if (p->dispatch_iteration == e->iteration)
+                        break;
+
+                if (start != USEC_INFINITY && usec_sub_unsigned(now(CLOCK_MONOTONIC), start) >= e->dispatch_budget_usec)
+                        break;
+        }
+
+        return r;
+}
+
 _public_ int sd_event_dispatch(sd_event *e) {
         sd_event_source *p;
         int r;
@@ -4845,7 +5624,7 @@ _public_ int sd_event_dispatch(sd_event *e) {
                 PROTECT_EVENT(e);
 
                 e->state = SD_EVENT_RUNNING;
-                r = source_dispatch(p);
+                r = event_dispatch_batch(e, p);
                 e->state = SD_EVENT_INITIAL;
                 return r;
         }
@@ -4941,6 +5720,20 @@ _public_ int sd_event_get_fd(sd_event *e) {
         assert_return(e = event_resolve(e), -ENOPKG);
         assert_return(!event_origin_changed(e), -ECHILD);
 
+        if (e->uring && !e->uring_in_epoll) {
+                struct epoll_event ev = {
+                        .events = EPOLLIN,
+                        .data.ptr = e->uring,
+                };
+
+                /* We are embedded into another event loop, which only knows about the epoll fd, hence make
+                 * completions in the ring wake it up too */
+                if (epoll_ctl(e->epoll_fd, EPOLL_CTL_ADD, event_uring_get_fd(e->uring), &ev) < 0)
+                        return -errno;
+
+                e->uring_in_epoll = true;
+        }
+
         return e->epoll_fd;
 }
 
@@ -5094,6 +5887,110 @@ _public_ int sd_event_get_watchdog(sd_event *e) {
         return e->watchdog;
 }
 
+_public_ int sd_event_set_dispatch_budget(sd_event *e, unsigned n_sources, uint64_t usec) {
+        assert_return(e, -EINVAL);
+        assert_return(e = event_resolve(e), -ENOPKG);
+        assert_return(n_sources > 0, -EINVAL);
+        assert_return(usec > 0, -EINVAL);
+        assert_return(e->state != SD_EVENT_FINISHED, -ESTALE);
+        assert_return(!event_origin_changed(e), -ECHILD);
+
+        e->dispatch_budget_sources = n_sources;
+        e->dispatch_budget_usec = usec;
+        return 0;
+}
+
+_public_ int sd_event_get_dispatch_budget(sd_event *e, unsigned *ret_n_sources, uint64_t *ret_usec) {
+        assert_return(e, -EINVAL);
+        assert_return(e = event_resolve(e), -ENOPKG);
+        assert_return(!event_origin_changed(e), -ECHILD);
+
+        if (ret_n_sources)
+                *ret_n_sources = e->dispatch_budget_sources;
+        if (ret_usec)
+                *ret_usec = e->dispatch_budget_usec;
+        return 0;
+}
+
+_public_ int sd_event_set_statistics(sd_event *e, int b) {
+        assert_return(e, -EINVAL);
+        assert_return(e = event_resolve(e), -ENOPKG);
+        assert_return(e->state != SD_EVENT_FINISHED, -ESTALE);
+        assert_return(!event_origin_changed(e), -ECHILD);
+
+        if (e->collect_statistics == !!b)
+                return e->collect_statistics;
+
+        /* Forget when event sources became pending while we were not looking, so that this is not
+         * accounted as pending time later on */
+        if (b)
+                LIST_FOREACH(sources, i, e->sources)
+                        i->pending_since = 0;
+
+        e->collect_statistics = b;
+        return e->collect_statistics;
+}
+
+_public_ int sd_event_get_statistics_enabled(sd_event *e) {
+        assert_return(e, -EINVAL);
+        assert_return(e = event_resolve(e), -ENOPKG);
+        assert_return(!event_origin_changed(e), -ECHILD);
+
+        return e->collect_statistics;
+}
+
+static int event_statistics_compare_dispatch(EventStatistics * const *a, EventStatistics * const *b) {
+        /* Most expensive first */
+        return CMP((*b)->dispatch_usec, (*a)->dispatch_usec);
+}
+
+_public_ int sd_event_get_statistics(sd_event *e, sd_json_variant **ret) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        _cleanup_free_ EventStatistics **list = NULL;
+        EventStatistics *x;
+        size_t n = 0;
+        int r;
+
+        assert_return(e, -EINVAL);
+        assert_return(e = event_resolve(e), -ENOPKG);
+        assert_return(ret, -EINVAL);
+        assert_return(!event_origin_changed(e), -ECHILD);
+
+        list = new(EventStatistics*, set_size(e->statistics));
+        if (!list && set_size(e->statistics) > 0)
+                return -ENOMEM;
+
+        SET_FOREACH(x, e->statistics)
+                list[n++] = x;
+
+        typesafe_qsort(list, n, event_statistics_compare_dispatch);
+
+        FOREACH_ARRAY(i, list, n) {
+                x = *i;
+
+                r = sd_json_variant_append_arraybo(
+                                &v,
+                                SD_JSON_BUILD_PAIR_STRING("type", event_source_type_to_string(x->type)),
+                                SD_JSON_BUILD_PAIR_CONDITION(!!x->description, "description", SD_JSON_BUILD_STRING(x->description)),
+                                SD_JSON_BUILD_PAIR_UNSIGNED("dispatched", x->n_dispatched),
+                                SD_JSON_BUILD_PAIR_UNSIGNED("dispatchUSec", x->dispatch_usec),
+                                SD_JSON_BUILD_PAIR_UNSIGNED("dispatchMaxUSec", x->dispatch_max_usec),
+                                SD_JSON_BUILD_PAIR_UNSIGNED("pendingUSec", x->pending_usec),
+                                SD_JSON_BUILD_PAIR_UNSIGNED("pendingMaxUSec", x->pending_max_usec));
+                if (r < 0)
+                        return r;
+        }
+
+        if (!v) {
+                r = sd_json_variant_new_array(&v, NULL, 0);
+                if (r < 0)
+                        return r;
+        }
+
+        *ret = TAKE_PTR(v);
+        return 0;
+}
+
 _public_ int sd_event_get_iteration(sd_event *e, uint64_t *ret) {
         assert_return(e, -EINVAL);
         assert_return(e = event_resolve(e), -ENOPKG);
@@ -0,0 +1,82 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include "sd-event.h"
+
+#include "alloc-util.h"
+#include "log.h"
+#include "parse-util.h"
+#include "random-util.h"
+#include "string-util.h"
+#include "tests.h"
+#include "time-util.h"
+
+/* This program measures the cost of re-arming and dispatching timer event sources while many of them are
+ * armed at once: once with the default accuracy, i.e. with the event sources kept in the timer wheel, and
+ * once with an accuracy of 1µs, i.e. with the event sources kept in the prioqs. */
+
+static unsigned arg_n_timers = 100000;
+static unsigned arg_n_rounds = 10;
+
+static int time_handler(sd_event_source *s, uint64_t usec, void *userdata) {
+        unsigned *n = ASSERT_PTR(userdata);
+
+        (*n)++;
+        return 0;
+}
+
+static void benchmark(uint64_t accuracy) {
+        _cleanup_(sd_event_unrefp) sd_event *e = NULL;
+        _cleanup_free_ sd_event_source **sources = NULL;
+        usec_t t, start, elapsed;
+        unsigned n = 0;
+
+        ASSERT_OK(sd_event_new(&e));
+        ASSERT_OK(sd_event_now(e, CLOCK_MONOTONIC, &t));
+
+        ASSERT_NOT_NULL(sources = new(sd_event_source*, arg_n_timers));
+
+        for (unsigned i = 0; i < arg_n_timers; i++)
+                ASSERT_OK(sd_event_add_time(e, &sources[i], CLOCK_MONOTONIC,
+                                            t + USEC_PER_MINUTE + random_u64_range(USEC_PER_HOUR),
+                                            accuracy, time_handler, &n));
+
+        /* Re-arm all timers a couple of times, as is done for timeouts that are reset on activity */
+        start = now(CLOCK_MONOTONIC);
+        for (unsigned r = 0; r < arg_n_rounds; r++)
+                for (unsigned i = 0; i < arg_n_timers; i++)
+                        ASSERT_OK(sd_event_source_set_time(sources[i],
+                                                           t + USEC_PER_MINUTE + random_u64_range(USEC_PER_HOUR)));
+        ASSERT_OK(sd_event_run(e, 0));
+        elapsed = now(CLOCK_MONOTONIC) - start;
+
+        benchmark_report(strjoina("re-arm/accuracy=", FORMAT_TIMESPAN(accuracy, 1)),
+                         (uint64_t) arg_n_timers * arg_n_rounds, elapsed);
+
+        /* Then let them all elapse at once */
+        for (unsigned i = 0; i < arg_n_timers; i++)
+                ASSERT_OK(sd_event_source_set_time(sources[i], t));
+
+        start = now(CLOCK_MONOTONIC);
+        while (n < arg_n_timers)
+                ASSERT_OK(sd_event_run(e, UINT64_MAX));
+        elapsed = now(CLOCK_MONOTONIC) - start;
+
+        benchmark_report(strjoina("dispatch/accuracy=", FORMAT_TIMESPAN(accuracy, 1)), arg_n_timers, elapsed);
+
+        for (unsigned i = 0; i < arg_n_timers; i++)
+                sd_event_source_unref(sources[i]);
+}
+
+int main(int argc, char *argv[]) {
+        test_setup_logging(LOG_INFO);
+
+        if (argc >= 2)
+                ASSERT_OK(safe_atou(argv[1], &arg_n_timers));
+        if (argc >= 3)
+                ASSERT_OK(safe_atou(argv[2], &arg_n_rounds));
+
+        benchmark(/* accuracy= */ 0);
+        benchmark(/* accuracy= */ 1);
+
+        return 0;
+}
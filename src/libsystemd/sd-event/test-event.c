@@ -7,8 +7,10 @@
 #include <unistd.h>
 
 #include "sd-event.h"
+#include "sd-json.h"
 
 #include "alloc-util.h"
+#include "event-timer-wheel.h"
 #include "exec-util.h"
 #include "fd-util.h"
 #include "fs-util.h"
@@ -935,4 +937,359 @@ TEST(leave_ratelimit) {
         assert_se(manually_left_ratelimit);
 }
 
+typedef struct IOReadContext {
+        char data[64];
+        size_t size;
+        unsigned n_calls;
+        sd_event_source *defer;
+} IOReadContext;
+
+static int io_read_enable_handler(sd_event_source *s, void *userdata) {
+        sd_event_source *source = ASSERT_PTR(userdata);
+
+        ASSERT_OK(sd_event_source_set_enabled(source, SD_EVENT_ON));
+        return 0;
+}
+
+static int io_read_handler(sd_event_source *s, int fd, const void *data, ssize_t size, void *userdata) {
+        IOReadContext *c = ASSERT_PTR(userdata);
+
+        ASSERT_OK(size);
+        ASSERT_LE((size_t) size, 4U);
+
+        c->n_calls++;
+
+        if (size == 0)
+                return sd_event_exit(sd_event_source_get_event(s), 0);
+
+        ASSERT_LE(c->size + size, sizeof(c->data));
+        memcpy(c->data + c->size, data, size);
+        c->size += size;
+
+        /* Turn the source off once, anything received meanwhile must be dispatched once it is on again */
+        if (c->n_calls == 1) {
+                ASSERT_OK(sd_event_source_set_enabled(s, SD_EVENT_OFF));
+                ASSERT_OK(sd_event_add_defer(sd_event_source_get_event(s), &c->defer, io_read_enable_handler, s));
+                ASSERT_OK(sd_event_source_set_enabled(c->defer, SD_EVENT_ONESHOT));
+        }
+
+        return 0;
+}
+
+static void test_io_read_one(bool uring, bool embedded) {
+        _cleanup_(sd_event_source_unrefp) sd_event_source *s = NULL, *t = NULL;
+        _cleanup_(sd_event_unrefp) sd_event *e = NULL;
+        _cleanup_close_pair_ int pfd[2] = EBADF_PAIR, qfd[2] = EBADF_PAIR;
+        IOReadContext c = {};
+
+        log_info("/* %s(uring=%s, embedded=%s) */", __func__, yes_no(uring), yes_no(embedded));
+
+        ASSERT_OK(setenv("SD_EVENT_IO_URING", one_zero(uring), /* overwrite= */ true));
+        ASSERT_OK(sd_event_new(&e));
+        ASSERT_OK(unsetenv("SD_EVENT_IO_URING"));
+
+        if (embedded)
+                ASSERT_OK(sd_event_get_fd(e));
+
+        ASSERT_OK_ERRNO(pipe2(pfd, O_CLOEXEC));
+        ASSERT_OK(sd_event_add_io_read(e, &s, pfd[0], 4, io_read_handler, &c));
+        ASSERT_OK(sd_event_source_set_io_fd_own(s, true));
+        TAKE_FD(pfd[0]);
+
+        /* A source freed while its read is still in flight */
+        ASSERT_OK_ERRNO(pipe2(qfd, O_CLOEXEC));
+        ASSERT_OK(sd_event_add_io_read(e, &t, qfd[0], 16, io_read_handler, &c));
+        ASSERT_OK(sd_event_source_set_io_fd_own(t, true));
+        TAKE_FD(qfd[0]);
+        ASSERT_OK(sd_event_run(e, 0));
+        t = sd_event_source_unref(t);
+
+        ASSERT_EQ(write(pfd[1], "hello world", 11), (ssize_t) 11);
+        pfd[1] = safe_close(pfd[1]);
+
+        ASSERT_OK(sd_event_loop(e));
+
+        ASSERT_EQ(c.size, 11U);
+        ASSERT_TRUE(memcmp(c.data, "hello world", 11) == 0);
+        ASSERT_GE(c.n_calls, 4U);
+
+        c.defer = sd_event_source_unref(c.defer);
+}
+
+TEST(io_read) {
+        test_io_read_one(/* uring= */ false, /* embedded= */ false);
+        test_io_read_one(/* uring= */ true, /* embedded= */ false);
+        test_io_read_one(/* uring= */ true, /* embedded= */ true);
+}
+
+TEST(timer_wheel) {
+        _cleanup_(timer_wheel_freep) TimerWheel *w = NULL;
+        TimerWheelEntry a, b, c, d, f, g, o;
+        usec_t perturb = 12345678, base;
+
+        /* "base" is a point of the minute grid, hence of all grids */
+        base = 100 * USEC_PER_MINUTE + perturb;
+
+        ASSERT_OK(timer_wheel_new(perturb, base, &w));
+        ASSERT_EQ(timer_wheel_next(w), USEC_INFINITY);
+        ASSERT_NULL(timer_wheel_pop(w, USEC_INFINITY - 1));
+
+        timer_wheel_entry_init(&a);
+        timer_wheel_entry_init(&b);
+        timer_wheel_entry_init(&c);
+        timer_wheel_entry_init(&d);
+        timer_wheel_entry_init(&f);
+        timer_wheel_entry_init(&g);
+        timer_wheel_entry_init(&o);
+
+        timer_wheel_put(w, &a, base + 10 * USEC_PER_SEC);          /* 10s grid */
+        timer_wheel_put(w, &b, base + 750 * USEC_PER_MSEC);        /* 250ms grid */
+        timer_wheel_put(w, &c, base + 3 * USEC_PER_MINUTE);        /* minute grid */
+        timer_wheel_put(w, &d, base + 2 * USEC_PER_DAY);           /* in the highest level */
+        timer_wheel_put(w, &g, base + 100 * USEC_PER_DAY);         /* too far in the future */
+        timer_wheel_put(w, &f, base + 5 * USEC_PER_SEC + 1);       /* off the grid */
+        timer_wheel_put(w, &o, base - USEC_PER_SEC);               /* past due */
+        ASSERT_TRUE(timer_wheel_entry_is_linked(&a));
+        ASSERT_TRUE(timer_wheel_entry_is_linked(&d));
+
+        ASSERT_EQ(timer_wheel_next(w), base - USEC_PER_SEC);
+        ASSERT_TRUE(timer_wheel_pop(w, base) == &o);
+        ASSERT_FALSE(timer_wheel_entry_is_linked(&o));
+        ASSERT_NULL(timer_wheel_pop(w, base));
+
+        ASSERT_EQ(timer_wheel_next(w), base + 750 * USEC_PER_MSEC);
+        ASSERT_NULL(timer_wheel_pop(w, base + 749 * USEC_PER_MSEC));
+        ASSERT_TRUE(timer_wheel_pop(w, base + 750 * USEC_PER_MSEC) == &b);
+        ASSERT_NULL(timer_wheel_pop(w, base + 750 * USEC_PER_MSEC));
+
+        ASSERT_EQ(timer_wheel_next(w), base + 5 * USEC_PER_SEC + 1);
+        ASSERT_TRUE(timer_wheel_pop(w, base + 20 * USEC_PER_SEC) == &f);
+        ASSERT_TRUE(timer_wheel_pop(w, base + 20 * USEC_PER_SEC) == &a);
+        ASSERT_NULL(timer_wheel_pop(w, base + 20 * USEC_PER_SEC));
+
+        /* Re-arming moves the entry */
+        timer_wheel_remove(w, &c);
+        ASSERT_FALSE(timer_wheel_entry_is_linked(&c));
+        timer_wheel_put(w, &c, base + 30 * USEC_PER_SEC);
+        ASSERT_EQ(timer_wheel_next(w), base + 30 * USEC_PER_SEC);
+        ASSERT_TRUE(timer_wheel_pop(w, base + 30 * USEC_PER_SEC) == &c);
+        ASSERT_NULL(timer_wheel_pop(w, base + 30 * USEC_PER_SEC));
+
+        /* Entries in the higher levels move down as the time goes on, and fire on time */
+        ASSERT_EQ(timer_wheel_next(w), base + 2 * USEC_PER_DAY);
+        ASSERT_NULL(timer_wheel_pop(w, base + 2 * USEC_PER_DAY - 30 * USEC_PER_MINUTE));
+        ASSERT_EQ(timer_wheel_next(w), base + 2 * USEC_PER_DAY);
+        ASSERT_NULL(timer_wheel_pop(w, base + 2 * USEC_PER_DAY - 1));
+        ASSERT_TRUE(timer_wheel_pop(w, base + 2 * USEC_PER_DAY) == &d);
+        ASSERT_NULL(timer_wheel_pop(w, base + 2 * USEC_PER_DAY));
+
+        /* Same for the far entries */
+        ASSERT_EQ(timer_wheel_next(w), base + 100 * USEC_PER_DAY);
+        ASSERT_NULL(timer_wheel_pop(w, base + 99 * USEC_PER_DAY));
+        ASSERT_EQ(timer_wheel_next(w), base + 100 * USEC_PER_DAY);
+        ASSERT_TRUE(timer_wheel_pop(w, base + 101 * USEC_PER_DAY) == &g);
+        ASSERT_EQ(timer_wheel_next(w), USEC_INFINITY);
+
+        /* Removing unlinked entries is fine */
+        timer_wheel_remove(w, &d);
+}
+
+static int wheel_time_handler(sd_event_source *s, uint64_t usec, void *userdata) {
+        unsigned *n = ASSERT_PTR(userdata);
+        uint64_t next, accuracy;
+
+        ASSERT_OK(sd_event_source_get_time(s, &next));
+        ASSERT_OK(sd_event_source_get_time_accuracy(s, &accuracy));
+
+        /* Never early, and not later than the accuracy allows, give or take scheduling latencies */
+        ASSERT_GE(usec, next);
+        ASSERT_LE(usec, usec_add(next, accuracy) + 100 * USEC_PER_MSEC);
+
+        (*n)++;
+        return 0;
+}
+
+TEST(timer_accuracy) {
+        _cleanup_(sd_event_unrefp) sd_event *e = NULL;
+        sd_event_source *s[6];
+        unsigned n = 0;
+        usec_t t, b;
+
+        ASSERT_OK(sd_event_new(&e));
+        ASSERT_OK(sd_event_now(e, CLOCK_MONOTONIC, &t));
+        ASSERT_OK(sd_event_now(e, CLOCK_BOOTTIME, &b));
+
+        /* A mix of event sources kept in the timer wheel and in the prioqs */
+        ASSERT_OK(sd_event_add_time(e, &s[0], CLOCK_MONOTONIC, t + 10 * USEC_PER_MSEC, 0, wheel_time_handler, &n));
+        ASSERT_OK(sd_event_add_time(e, &s[1], CLOCK_MONOTONIC, t + 20 * USEC_PER_MSEC, 1, wheel_time_handler, &n));
+        ASSERT_OK(sd_event_add_time(e, &s[2], CLOCK_MONOTONIC, t + 30 * USEC_PER_MSEC, USEC_PER_SEC, wheel_time_handler, &n));
+        ASSERT_OK(sd_event_add_time(e, &s[3], CLOCK_BOOTTIME, b + 40 * USEC_PER_MSEC, 300 * USEC_PER_MSEC, wheel_time_handler, &n));
+        ASSERT_OK(sd_event_add_time(e, &s[4], CLOCK_MONOTONIC, 0, 0, wheel_time_handler, &n));
+        ASSERT_OK(sd_event_add_time(e, &s[5], CLOCK_MONOTONIC, USEC_INFINITY, 0, wheel_time_handler, &n));
+
+        /* Move event sources between the prioqs and the wheel */
+        ASSERT_OK(sd_event_source_set_time_accuracy(s[1], 500 * USEC_PER_MSEC));
+        ASSERT_OK(sd_event_source_set_time_accuracy(s[2], 10 * USEC_PER_MSEC));
+
+        /* A disabled event source is not dispatched */
+        ASSERT_OK(sd_event_source_set_time(s[5], t + 50 * USEC_PER_MSEC));
+        ASSERT_OK(sd_event_source_set_enabled(s[5], SD_EVENT_OFF));
+
+        while (n < 5)
+                ASSERT_OK(sd_event_run(e, UINT64_MAX));
+
+        /* Re-arm a oneshot source kept in the wheel */
+        ASSERT_OK(sd_event_now(e, CLOCK_MONOTONIC, &t));
+        ASSERT_OK(sd_event_source_set_time(s[0], t + 10 * USEC_PER_MSEC));
+        ASSERT_OK(sd_event_source_set_enabled(s[0], SD_EVENT_ONESHOT));
+
+        while (n < 6)
+                ASSERT_OK(sd_event_run(e, UINT64_MAX));
+
+        for (size_t i = 0; i < ELEMENTSOF(s); i++)
+                sd_event_source_unref(s[i]);
+}
+
+static int dispatch_budget_io_handler(sd_event_source *s, int fd, uint32_t revents, void *userdata) {
+        unsigned *n = ASSERT_PTR(userdata);
+        char c;
+
+        ASSERT_EQ(read(fd, &c, 1), 1);
+        (*n)++;
+        return 0;
+}
+
+static int dispatch_budget_defer_handler(sd_event_source *s, void *userdata) {
+        unsigned *n = ASSERT_PTR(userdata);
+
+        (*n)++;
+        return 0;
+}
+
+TEST(dispatch_budget) {
+        _cleanup_(sd_event_unrefp) sd_event *e = NULL;
+        sd_event_source *s[5];
+        int fds[ELEMENTSOF(s)][2];
+        unsigned n = 0, n_sources;
+        uint64_t usec;
+
+        ASSERT_OK(sd_event_new(&e));
+
+        ASSERT_OK(sd_event_get_dispatch_budget(e, &n_sources, &usec));
+        ASSERT_EQ(n_sources, 1U);
+        ASSERT_EQ(usec, USEC_INFINITY);
+
+        ASSERT_OK(sd_event_set_dispatch_budget(e, 3, USEC_INFINITY));
+
+        for (size_t i = 0; i < ELEMENTSOF(s); i++) {
+                ASSERT_OK_ERRNO(pipe2(fds[i], O_CLOEXEC|O_NONBLOCK));
+                ASSERT_OK(sd_event_add_io(e, &s[i], fds[i][0], EPOLLIN, dispatch_budget_io_handler, &n));
+                ASSERT_EQ(write(fds[i][1], "x", 1), 1);
+        }
+
+        /* The last one is of another priority, and hence dispatched in an iteration of its own */
+        ASSERT_OK(sd_event_source_set_priority(s[4], SD_EVENT_PRIORITY_IDLE));
+
+        ASSERT_OK(sd_event_run(e, 0));
+        ASSERT_EQ(n, 3U);
+        ASSERT_OK(sd_event_run(e, 0));
+        ASSERT_EQ(n, 4U);
+        ASSERT_OK(sd_event_run(e, 0));
+        ASSERT_EQ(n, 5U);
+
+        /* Without a budget, one event source is dispatched per iteration */
+        ASSERT_OK(sd_event_set_dispatch_budget(e, 1, USEC_INFINITY));
+
+        for (size_t i = 0; i < ELEMENTSOF(s); i++)
+                ASSERT_EQ(write(fds[i][1], "x", 1), 1);
+
+        for (unsigned k = 1; k <= ELEMENTSOF(s); k++) {
+                ASSERT_OK(sd_event_run(e, 0));
+                ASSERT_EQ(n, 5U + k);
+        }
+
+        /* A defer event source stays pending, but is dispatched only once per iteration */
+        ASSERT_OK(sd_event_set_dispatch_budget(e, 10, USEC_PER_SEC));
+        sd_event_source_unref(s[0]);
+        ASSERT_OK(sd_event_add_defer(e, &s[0], dispatch_budget_defer_handler, &n));
+        ASSERT_OK(sd_event_run(e, 0));
+        ASSERT_EQ(n, 11U);
+
+        for (size_t i = 0; i < ELEMENTSOF(s); i++) {
+                sd_event_source_unref(s[i]);
+                safe_close_pair(fds[i]);
+        }
+}
+
+static int statistics_defer_handler(sd_event_source *s, void *userdata) {
+        unsigned *n = ASSERT_PTR(userdata);
+
+        (*n)++;
+        return 0;
+}
+
+static int statistics_time_handler(sd_event_source *s, uint64_t usec, void *userdata) {
+        unsigned *n = ASSERT_PTR(userdata);
+
+        usleep_safe(10 * USEC_PER_MSEC);
+        (*n)++;
+        return 0;
+}
+
+TEST(statistics) {
+        _cleanup_(sd_event_unrefp) sd_event *e = NULL;
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        sd_event_source *s[3];
+        sd_json_variant *x;
+        unsigned n = 0;
+
+        ASSERT_OK(sd_event_new(&e));
+        ASSERT_OK(sd_event_set_statistics(e, true));
+        ASSERT_EQ(sd_event_get_statistics_enabled(e), 1);
+
+        /* Event sources of the same type and description are accounted together */
+        ASSERT_OK(sd_event_add_defer(e, &s[0], statistics_defer_handler, &n));
+        ASSERT_OK(sd_event_source_set_description(s[0], "foo"));
+        ASSERT_OK(sd_event_source_set_enabled(s[0], SD_EVENT_ONESHOT));
+        ASSERT_OK(sd_event_add_defer(e, &s[1], statistics_defer_handler, &n));
+        ASSERT_OK(sd_event_source_set_description(s[1], "foo"));
+        ASSERT_OK(sd_event_source_set_enabled(s[1], SD_EVENT_ONESHOT));
+        ASSERT_OK(sd_event_add_time_relative(e, &s[2], CLOCK_MONOTONIC, 0, 0, statistics_time_handler, &n));
+        ASSERT_OK(sd_event_source_set_description(s[2], "bar"));
+
+        while (n < 3)
+                ASSERT_OK(sd_event_run(e, UINT64_MAX));
+
+        ASSERT_OK(sd_event_get_statistics(e, &v));
+        ASSERT_TRUE(sd_json_variant_is_array(v));
+        ASSERT_EQ(sd_json_variant_elements(v), 2U);
+
+        /* The most expensive event source comes first */
+        x = sd_json_variant_by_index(v, 0);
+        ASSERT_STREQ(sd_json_variant_string(sd_json_variant_by_key(x, "type")), "monotonic");
+        ASSERT_STREQ(sd_json_variant_string(sd_json_variant_by_key(x, "description")), "bar");
+        ASSERT_EQ(sd_json_variant_unsigned(sd_json_variant_by_key(x, "dispatched")), 1U);
+        ASSERT_GE(sd_json_variant_unsigned(sd_json_variant_by_key(x, "dispatchUSec")), 10 * USEC_PER_MSEC);
+        ASSERT_GE(sd_json_variant_unsigned(sd_json_variant_by_key(x, "dispatchMaxUSec")), 10 * USEC_PER_MSEC);
+
+        x = sd_json_variant_by_index(v, 1);
+        ASSERT_STREQ(sd_json_variant_string(sd_json_variant_by_key(x, "type")), "defer");
+        ASSERT_STREQ(sd_json_variant_string(sd_json_variant_by_key(x, "description")), "foo");
+        ASSERT_EQ(sd_json_variant_unsigned(sd_json_variant_by_key(x, "dispatched")), 2U);
+
+        /* Nothing is collected anymore once turned off */
+        ASSERT_EQ(sd_event_set_statistics(e, false), 0);
+        ASSERT_OK(sd_event_source_set_enabled(s[0], SD_EVENT_ONESHOT));
+        ASSERT_OK(sd_event_run(e, 0));
+        ASSERT_EQ(n, 4U);
+
+        v = sd_json_variant_unref(v);
+        ASSERT_OK(sd_event_get_statistics(e, &v));
+        x = sd_json_variant_by_index(v, 1);
+        ASSERT_EQ(sd_json_variant_unsigned(sd_json_variant_by_key(x, "dispatched")), 2U);
+
+        for (size_t i = 0; i < ELEMENTSOF(s); i++)
+                sd_event_source_unref(s[i]);
+}
+
 DEFINE_TEST_MAIN(LOG_DEBUG);
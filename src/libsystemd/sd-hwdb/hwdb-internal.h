@@ -10,6 +10,14 @@
 
 #define HWDB_SIG { 'K', 'S', 'L', 'P', 'H', 'H', 'R', 'H' }
 
+/* Number of recent lookup results kept per handle */
+#define HWDB_CACHE_MAX 8U
+
+typedef struct HwdbCacheEntry {
+        char *modalias;
+        OrderedHashmap *properties;
+} HwdbCacheEntry;
+
 struct sd_hwdb {
         unsigned n_ref;
 
@@ -20,9 +28,14 @@ struct sd_hwdb {
                 const char *map;
         };
 
+        /* The result of the last lookup, owned by cache[0] */
         OrderedHashmap *properties;
         Iterator properties_iterator;
         bool properties_modified;
+
+        /* Results of the most recent lookups, most recently used first */
+        HwdbCacheEntry cache[HWDB_CACHE_MAX];
+        size_t n_cache;
 };
 
 /* on-disk trie objects */
@@ -89,22 +89,23 @@ static const char *trie_string(sd_hwdb *hwdb, le64_t off) {
         return hwdb->map + le64toh(off);
 }
 
-static int trie_children_cmp_f(const void *v1, const void *v2) {
-        const struct trie_child_entry_f *n1 = v1;
-        const struct trie_child_entry_f *n2 = v2;
-
-        return n1->c - n2->c;
-}
-
 static const struct trie_node_f *node_lookup_f(sd_hwdb *hwdb, const struct trie_node_f *node, uint8_t c) {
-        struct trie_child_entry_f *child;
-        struct trie_child_entry_f search;
-
-        search.c = c;
-        child = bsearch(&search, (const char *)node + le64toh(hwdb->head->node_size), node->children_count,
-                        le64toh(hwdb->head->child_entry_size), trie_children_cmp_f);
-        if (child)
-                return trie_node_from_off(hwdb, child->child_off);
+        size_t left = 0, right = node->children_count;
+
+        /* Child entries are sorted by their character. This is called for every character of every lookup,
+         * and three more times per node for the glob characters, hence avoid bsearch() and its callback. */
+        while (left < right) {
+                size_t mid = left + (right - left) / 2;
+                const struct trie_child_entry_f *child = trie_node_child(hwdb, node, mid);
+
+                if (child->c == c)
+                        return trie_node_from_off(hwdb, child->child_off);
+                if (child->c < c)
+                        left = mid + 1;
+                else
+                        right = mid;
+        }
+
         return NULL;
 }
 
@@ -360,20 +361,64 @@ static sd_hwdb *hwdb_free(sd_hwdb *hwdb) {
         if (hwdb->map)
                 munmap((void *)hwdb->map, hwdb->st.st_size);
         safe_fclose(hwdb->f);
-        ordered_hashmap_free(hwdb->properties);
+        FOREACH_ARRAY(e, hwdb->cache, hwdb->n_cache) {
+                free(e->modalias);
+                ordered_hashmap_free(e->properties);
+        }
         return mfree(hwdb);
 }
 
 DEFINE_PUBLIC_TRIVIAL_REF_UNREF_FUNC(sd_hwdb, sd_hwdb, hwdb_free)
 
+static void properties_cache_use(sd_hwdb *hwdb, size_t idx) {
+        HwdbCacheEntry e;
+
+        assert(hwdb);
+        assert(idx < hwdb->n_cache);
+
+        /* Move the entry to the front */
+        e = hwdb->cache[idx];
+        memmove(hwdb->cache + 1, hwdb->cache, idx * sizeof(HwdbCacheEntry));
+        hwdb->cache[0] = e;
+
+        hwdb->properties = e.properties;
+        hwdb->properties_modified = true;
+}
+
 static int properties_prepare(sd_hwdb *hwdb, const char *modalias) {
+        HwdbCacheEntry *e;
+        int r;
+
         assert(hwdb);
         assert(modalias);
 
-        ordered_hashmap_clear(hwdb->properties);
-        hwdb->properties_modified = true;
+        /* The database is mapped read-only for the lifetime of the handle, hence results never go stale. */
+        for (size_t i = 0; i < hwdb->n_cache; i++)
+                if (streq_ptr(hwdb->cache[i].modalias, modalias)) {
+                        properties_cache_use(hwdb, i);
+                        return 0;
+                }
+
+        /* Take a free slot, or reuse the least recently used one */
+        if (hwdb->n_cache < HWDB_CACHE_MAX)
+                hwdb->cache[hwdb->n_cache++] = (HwdbCacheEntry) {};
+        properties_cache_use(hwdb, hwdb->n_cache - 1);
+
+        e = &hwdb->cache[0];
+        e->modalias = mfree(e->modalias);
+        ordered_hashmap_clear(e->properties);
 
-        return trie_search_f(hwdb, modalias);
+        r = trie_search_f(hwdb, modalias);
+
+        /* hwdb_add_property() allocates the hashmap on demand */
+        e->properties = hwdb->properties;
+        if (r < 0)
+                return r;
+
+        /* If this fails, the result is only not cached */
+        e->modalias = strdup(modalias);
+
+        return 0;
 }
 
 _public_ int sd_hwdb_get(sd_hwdb *hwdb, const char *modalias, const char *key, const char **_value) {
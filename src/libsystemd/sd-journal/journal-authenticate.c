@@ -293,9 +293,18 @@ int journal_file_hmac_put_object(JournalFile *f, ObjectType type, Object *o, uin
         case OBJECT_FIELD_HASH_TABLE:
         case OBJECT_DATA_HASH_TABLE:
         case OBJECT_ENTRY_ARRAY:
+        case OBJECT_BLOOM_FILTER:
+        case OBJECT_UNIQUE_INDEX:
+        case OBJECT_HISTOGRAM:
+        case OBJECT_BOOT_INDEX:
                 /* Nothing: everything is mutable */
                 break;
 
+        case OBJECT_ZSTD_DICTIONARY:
+                /* All */
+                sym_gcry_md_write(f->hmac, o->zstd_dictionary.payload, le64toh(o->object.size) - offsetof(Object, zstd_dictionary.payload));
+                break;
+
         case OBJECT_TAG:
                 /* All but the tag itself */
                 sym_gcry_md_write(f->hmac, &o->tag.seqnum, sizeof(o->tag.seqnum));
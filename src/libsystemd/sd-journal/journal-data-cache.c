@@ -0,0 +1,210 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include "alloc-util.h"
+#include "format-util.h"
+#include "hashmap.h"
+#include "journal-data-cache.h"
+#include "list.h"
+#include "log.h"
+#include "memory-util.h"
+#include "siphash24.h"
+
+typedef struct DataCacheKey {
+        JournalFile *file;
+        uint64_t offset;
+} DataCacheKey;
+
+typedef struct DataCacheEntry DataCacheEntry;
+
+struct DataCacheEntry {
+        DataCacheKey key;
+        LIST_FIELDS(DataCacheEntry, lru);
+        size_t size;
+        uint8_t data[];
+};
+
+struct JournalDataCache {
+        Hashmap *entries;
+
+        /* Most recently used entry first */
+        LIST_HEAD(DataCacheEntry, lru);
+        DataCacheEntry *lru_tail;
+
+        size_t size;
+        size_t max_size;
+
+        unsigned n_hit;
+        unsigned n_missed;
+        unsigned n_evicted;
+};
+
+static void data_cache_key_hash_func(const DataCacheKey *k, struct siphash *state) {
+        assert(k);
+
+        siphash24_compress_typesafe(k->file, state);
+        siphash24_compress_typesafe(k->offset, state);
+}
+
+static int data_cache_key_compare_func(const DataCacheKey *x, const DataCacheKey *y) {
+        int r;
+
+        assert(x);
+        assert(y);
+
+        r = CMP(x->file, y->file);
+        if (r != 0)
+                return r;
+
+        return CMP(x->offset, y->offset);
+}
+
+DEFINE_PRIVATE_HASH_OPS(
+        data_cache_key_hash_ops,
+        DataCacheKey,
+        data_cache_key_hash_func,
+        data_cache_key_compare_func);
+
+static size_t data_cache_entry_size(const DataCacheEntry *e) {
+        assert(e);
+
+        return offsetof(DataCacheEntry, data) + e->size + 1;
+}
+
+static void data_cache_entry_free(JournalDataCache *c, DataCacheEntry *e) {
+        assert(c);
+        assert(e);
+
+        assert_se(hashmap_remove(c->entries, &e->key) == e);
+
+        if (c->lru_tail == e)
+                c->lru_tail = e->lru_prev;
+        LIST_REMOVE(lru, c->lru, e);
+
+        assert(c->size >= data_cache_entry_size(e));
+        c->size -= data_cache_entry_size(e);
+
+        free(e);
+}
+
+JournalDataCache* journal_data_cache_new(size_t max_size) {
+        JournalDataCache *c;
+
+        c = new(JournalDataCache, 1);
+        if (!c)
+                return NULL;
+
+        *c = (JournalDataCache) {
+                .max_size = max_size,
+        };
+
+        return c;
+}
+
+JournalDataCache* journal_data_cache_free(JournalDataCache *c) {
+        if (!c)
+                return NULL;
+
+        while (c->lru)
+                data_cache_entry_free(c, c->lru);
+
+        hashmap_free(c->entries);
+        return mfree(c);
+}
+
+int journal_data_cache_get(JournalDataCache *c, JournalFile *f, uint64_t offset, void **ret_data, size_t *ret_size) {
+        DataCacheEntry *e;
+
+        assert(c);
+        assert(f);
+        assert(offset > 0);
+
+        e = hashmap_get(c->entries, &(DataCacheKey) { .file = f, .offset = offset });
+        if (!e) {
+                c->n_missed++;
+                return 0;
+        }
+
+        c->n_hit++;
+
+        /* Move to the front of the LRU list */
+        if (c->lru != e) {
+                if (c->lru_tail == e)
+                        c->lru_tail = e->lru_prev;
+                LIST_REMOVE(lru, c->lru, e);
+                LIST_PREPEND(lru, c->lru, e);
+        }
+
+        if (ret_data)
+                *ret_data = e->data;
+        if (ret_size)
+                *ret_size = e->size;
+
+        return 1;
+}
+
+int journal_data_cache_put(JournalDataCache *c, JournalFile *f, uint64_t offset, const void *data, size_t size, void **ret_data) {
+        DataCacheEntry *e;
+        int r;
+
+        assert(c);
+        assert(f);
+        assert(offset > 0);
+        assert(data || size == 0);
+
+        /* A single payload may take up a quarter of the cache at most, so that one large field (think
+         * COREDUMP=) cannot flush everything else. In that case 0 is returned and nothing is cached. */
+        if (offsetof(DataCacheEntry, data) + size + 1 > c->max_size / 4)
+                return 0;
+
+        e = malloc(offsetof(DataCacheEntry, data) + size + 1);
+        if (!e)
+                return -ENOMEM;
+
+        *e = (DataCacheEntry) {
+                .key.file = f,
+                .key.offset = offset,
+                .size = size,
+        };
+        *((uint8_t*) mempcpy_safe(e->data, data, size)) = 0;
+
+        r = hashmap_ensure_put(&c->entries, &data_cache_key_hash_ops, &e->key, e);
+        if (r < 0) {
+                free(e);
+                return r == -EEXIST ? 0 : r;
+        }
+
+        LIST_PREPEND(lru, c->lru, e);
+        if (!c->lru_tail)
+                c->lru_tail = e;
+        c->size += data_cache_entry_size(e);
+
+        while (c->size > c->max_size) {
+                assert(c->lru_tail && c->lru_tail != e);
+
+                data_cache_entry_free(c, c->lru_tail);
+                c->n_evicted++;
+        }
+
+        if (ret_data)
+                *ret_data = e->data;
+
+        return 1;
+}
+
+void journal_data_cache_forget_file(JournalDataCache *c, JournalFile *f) {
+        assert(f);
+
+        if (!c)
+                return;
+
+        LIST_FOREACH(lru, e, c->lru)
+                if (e->key.file == f)
+                        data_cache_entry_free(c, e);
+}
+
+void journal_data_cache_stats_log_debug(JournalDataCache *c) {
+        assert(c);
+
+        log_debug("data cache statistics: %u hit, %u miss, %u evicted, %s of %s used",
+                  c->n_hit, c->n_missed, c->n_evicted, FORMAT_BYTES(c->size), FORMAT_BYTES(c->max_size));
+}
@@ -0,0 +1,24 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+#pragma once
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#include "journal-file.h"
+#include "macro.h"
+
+/* A bounded LRU cache of decompressed DATA object payloads, keyed by file and offset. */
+
+#define JOURNAL_DATA_CACHE_SIZE_DEFAULT (4U * 1024U * 1024U)
+
+typedef struct JournalDataCache JournalDataCache;
+
+JournalDataCache* journal_data_cache_new(size_t max_size);
+JournalDataCache* journal_data_cache_free(JournalDataCache *c);
+DEFINE_TRIVIAL_CLEANUP_FUNC(JournalDataCache*, journal_data_cache_free);
+
+int journal_data_cache_get(JournalDataCache *c, JournalFile *f, uint64_t offset, void **ret_data, size_t *ret_size);
+int journal_data_cache_put(JournalDataCache *c, JournalFile *f, uint64_t offset, const void *data, size_t size, void **ret_data);
+void journal_data_cache_forget_file(JournalDataCache *c, JournalFile *f);
+
+void journal_data_cache_stats_log_debug(JournalDataCache *c);
@@ -23,6 +23,13 @@ typedef struct EntryObject EntryObject;
 typedef struct HashTableObject HashTableObject;
 typedef struct EntryArrayObject EntryArrayObject;
 typedef struct TagObject TagObject;
+typedef struct BloomFilterObject BloomFilterObject;
+typedef struct ZstdDictionaryObject ZstdDictionaryObject;
+typedef struct UniqueIndexItem UniqueIndexItem;
+typedef struct UniqueIndexObject UniqueIndexObject;
+typedef struct HistogramObject HistogramObject;
+typedef struct BootIndexItem BootIndexItem;
+typedef struct BootIndexObject BootIndexObject;
 
 typedef struct HashItem HashItem;
 
@@ -38,6 +45,11 @@ typedef enum ObjectType {
         OBJECT_FIELD_HASH_TABLE,
         OBJECT_ENTRY_ARRAY,
         OBJECT_TAG,
+        OBJECT_BLOOM_FILTER,
+        OBJECT_ZSTD_DICTIONARY,
+        OBJECT_UNIQUE_INDEX,
+        OBJECT_HISTOGRAM,
+        OBJECT_BOOT_INDEX,
         _OBJECT_TYPE_MAX,
         _OBJECT_TYPE_INVALID = -EINVAL,
 } ObjectType;
@@ -150,6 +162,58 @@ struct TagObject {
         uint8_t tag[TAG_LENGTH]; /* SHA-256 HMAC */
 } _packed_;
 
+struct BloomFilterObject {
+        ObjectHeader object;
+        le64_t n_items;         /* number of DATA objects that were added to the filter */
+        uint8_t n_hash_functions;
+        uint8_t reserved[7];
+        uint8_t bits[];         /* indexed by the DATA object hash, see journal_file_bloom_filter_test() */
+} _packed_;
+
+struct ZstdDictionaryObject {
+        ObjectHeader object;
+        uint8_t payload[];      /* used for all ZSTD compressed DATA objects in the file */
+} _packed_;
+
+struct UniqueIndexItem {
+        le64_t offset;          /* of the field's value table, relative to the start of the object */
+        le64_t n_values;
+} _packed_;
+
+struct UniqueIndexObject {
+        ObjectHeader object;
+        le64_t tail_entry_seqnum; /* of the file when the index was written */
+        le64_t n_fields;
+        UniqueIndexItem items[]; /* sorted by field name, see journal_file_get_unique_values() */
+} _packed_;
+
+/* Entries are counted by PRIORITY= value, the last column is for entries without a valid one */
+#define HISTOGRAM_N_COLUMNS 9U
+
+struct HistogramObject {
+        ObjectHeader object;
+        le64_t next_histogram_offset;
+        le64_t start_realtime;  /* of the first bucket */
+        le64_t bucket_usec;
+        le64_t n_buckets;
+        le32_t counts[];        /* n_buckets × HISTOGRAM_N_COLUMNS */
+} _packed_;
+
+struct BootIndexItem {
+        sd_id128_t boot_id;
+        le64_t head_entry_seqnum;
+        le64_t tail_entry_seqnum;
+        le64_t head_entry_realtime;
+        le64_t tail_entry_realtime;
+} _packed_;
+
+struct BootIndexObject {
+        ObjectHeader object;
+        le64_t tail_entry_seqnum; /* of the file when the index was written */
+        le64_t n_boots;
+        BootIndexItem items[];   /* sorted by head_entry_seqnum */
+} _packed_;
+
 union Object {
         ObjectHeader object;
         DataObject data;
@@ -158,6 +222,11 @@ union Object {
         HashTableObject hash_table;
         EntryArrayObject entry_array;
         TagObject tag;
+        BloomFilterObject bloom_filter;
+        ZstdDictionaryObject zstd_dictionary;
+        UniqueIndexObject unique_index;
+        HistogramObject histogram;
+        BootIndexObject boot_index;
 };
 
 enum {
@@ -174,16 +243,18 @@ enum {
         HEADER_INCOMPATIBLE_KEYED_HASH      = 1 << 2,
         HEADER_INCOMPATIBLE_COMPRESSED_ZSTD = 1 << 3,
         HEADER_INCOMPATIBLE_COMPACT         = 1 << 4,
+        HEADER_INCOMPATIBLE_ZSTD_DICTIONARY = 1 << 5, /* if set, ZSTD compressed DATA objects use the dictionary referenced by zstd_dictionary_offset, if there is one */
 
         HEADER_INCOMPATIBLE_ANY             = HEADER_INCOMPATIBLE_COMPRESSED_XZ |
                                               HEADER_INCOMPATIBLE_COMPRESSED_LZ4 |
                                               HEADER_INCOMPATIBLE_KEYED_HASH |
                                               HEADER_INCOMPATIBLE_COMPRESSED_ZSTD |
-                                              HEADER_INCOMPATIBLE_COMPACT,
+                                              HEADER_INCOMPATIBLE_COMPACT |
+                                              HEADER_INCOMPATIBLE_ZSTD_DICTIONARY,
 
         HEADER_INCOMPATIBLE_SUPPORTED       = (HAVE_XZ ? HEADER_INCOMPATIBLE_COMPRESSED_XZ : 0) |
                                               (HAVE_LZ4 ? HEADER_INCOMPATIBLE_COMPRESSED_LZ4 : 0) |
-                                              (HAVE_ZSTD ? HEADER_INCOMPATIBLE_COMPRESSED_ZSTD : 0) |
+                                              (HAVE_ZSTD ? HEADER_INCOMPATIBLE_COMPRESSED_ZSTD | HEADER_INCOMPATIBLE_ZSTD_DICTIONARY : 0) |
                                               HEADER_INCOMPATIBLE_KEYED_HASH |
                                               HEADER_INCOMPATIBLE_COMPACT,
 };
@@ -193,12 +264,15 @@ enum {
         HEADER_COMPATIBLE_SEALED             = 1 << 0,
         HEADER_COMPATIBLE_TAIL_ENTRY_BOOT_ID = 1 << 1, /* if set, the last_entry_boot_id field in the header is exclusively refreshed when an entry is appended */
         HEADER_COMPATIBLE_SEALED_CONTINUOUS  = 1 << 2,
+        HEADER_COMPATIBLE_INDEXES            = 1 << 3, /* if set, the file may contain BLOOM_FILTER, UNIQUE_INDEX, HISTOGRAM and BOOT_INDEX objects */
         HEADER_COMPATIBLE_ANY                = HEADER_COMPATIBLE_SEALED |
                                                HEADER_COMPATIBLE_TAIL_ENTRY_BOOT_ID |
-                                               HEADER_COMPATIBLE_SEALED_CONTINUOUS,
+                                               HEADER_COMPATIBLE_SEALED_CONTINUOUS |
+                                               HEADER_COMPATIBLE_INDEXES,
 
         HEADER_COMPATIBLE_SUPPORTED          = (HAVE_GCRYPT ? HEADER_COMPATIBLE_SEALED | HEADER_COMPATIBLE_SEALED_CONTINUOUS : 0) |
-                                               HEADER_COMPATIBLE_TAIL_ENTRY_BOOT_ID,
+                                               HEADER_COMPATIBLE_TAIL_ENTRY_BOOT_ID |
+                                               HEADER_COMPATIBLE_INDEXES,
 };
 
 
@@ -244,12 +318,18 @@ enum {
         le32_t tail_entry_array_n_entries;              \
         /* Added in 254 */                              \
         le64_t tail_entry_offset;                       \
+        /* Added in 257 */                              \
+        le64_t bloom_filter_offset;                     \
+        le64_t zstd_dictionary_offset;                  \
+        le64_t unique_index_offset;                     \
+        le64_t histogram_offset;                        \
+        le64_t boot_index_offset;                       \
         }
 
 struct Header struct_Header__contents;
 struct Header__packed struct_Header__contents _packed_;
 assert_cc(sizeof(struct Header) == sizeof(struct Header__packed));
-assert_cc(sizeof(struct Header) == 272);
+assert_cc(sizeof(struct Header) == 312);
 
 #define FSS_HEADER_SIGNATURE                                            \
         ((const char[]) { 'K', 'S', 'H', 'H', 'R', 'H', 'L', 'P' })
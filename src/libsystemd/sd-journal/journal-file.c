@@ -14,6 +14,7 @@
 #include "sd-event.h"
 
 #include "alloc-util.h"
+#include "bitfield.h"
 #include "chattr-util.h"
 #include "compress.h"
 #include "env-util.h"
@@ -22,10 +23,12 @@
 #include "fs-util.h"
 #include "gcrypt-util.h"
 #include "id128-util.h"
+#include "iovec-util.h"
 #include "journal-authenticate.h"
 #include "journal-def.h"
 #include "journal-file.h"
 #include "journal-internal.h"
+#include "journal-manifest.h"
 #include "lookup3.h"
 #include "memory-util.h"
 #include "missing_threads.h"
@@ -48,6 +51,15 @@
 #define DEFAULT_COMPRESS_THRESHOLD (512ULL)
 #define MIN_COMPRESS_THRESHOLD (8ULL)
 
+/* Short field values only compress well with a dictionary, hence use a lower default threshold then */
+#define DEFAULT_COMPRESS_THRESHOLD_ZSTD_DICTIONARY (32ULL)
+
+/* Bounds for the ZSTD dictionary and the DATA objects it is trained from */
+#define ZSTD_DICTIONARY_SIZE_MAX (64U * U64_KB)
+#define ZSTD_DICTIONARY_TRAIN_SIZE (32U * U64_KB)
+#define ZSTD_DICTIONARY_SAMPLES_MAX 4096U
+#define ZSTD_DICTIONARY_SAMPLES_SIZE_MAX (1U * U64_MB)
+
 /* This is the minimum journal file size */
 #define JOURNAL_FILE_SIZE_MIN (512 * U64_KB)             /* 512 KiB */
 #define JOURNAL_COMPACT_SIZE_MAX ((uint64_t) UINT32_MAX) /* 4 GiB */
@@ -88,6 +100,21 @@
 /* Longest hash chain to rotate after */
 #define HASH_CHAIN_DEPTH_MAX 100
 
+/* Bloom filter parameters: 10 bits per DATA object and 7 probes give a false positive rate of about 1% */
+#define BLOOM_FILTER_BITS_PER_ITEM 10U
+#define BLOOM_FILTER_N_HASH_FUNCTIONS 7U
+#define BLOOM_FILTER_N_HASH_FUNCTIONS_MAX 32U
+
+/* Fields with more distinct values than this, or with longer values, are left out of the unique index */
+#define UNIQUE_INDEX_N_VALUES_MAX 1024U
+#define UNIQUE_INDEX_VALUE_SIZE_MAX 512U
+#define UNIQUE_INDEX_SIZE_MAX (64U * U64_MB)
+
+/* Each histogram object counts the entries of one day by minute, and a file gets at most this many of them */
+#define HISTOGRAM_BUCKET_USEC USEC_PER_MINUTE
+#define HISTOGRAM_N_BUCKETS 1440U
+#define HISTOGRAM_N_OBJECTS_MAX 64U
+
 #ifdef __clang__
 #  pragma GCC diagnostic ignored "-Waddress-of-packed-member"
 #endif
@@ -281,6 +308,7 @@ JournalFile* journal_file_close(JournalFile *f) {
                 return NULL;
 
         assert(f->newest_boot_id_prioq_idx == PRIOQ_IDX_NULL);
+        assert(f->location_prioq_idx == PRIOQ_IDX_NULL);
 
         sd_event_source_disable_unref(f->post_change_timer);
 
@@ -296,6 +324,7 @@ JournalFile* journal_file_close(JournalFile *f) {
 #if HAVE_COMPRESSION
         free(f->compress_buffer);
 #endif
+        zstd_dictionary_free(f->zstd_dictionary);
 
 #if HAVE_GCRYPT
         if (f->fss_file) {
@@ -348,6 +377,80 @@ static bool compact_mode_requested(void) {
         return cached;
 }
 
+static bool unique_index_requested(void) {
+        static thread_local int cached = -1;
+        int r;
+
+        if (cached < 0) {
+                r = getenv_bool("SYSTEMD_JOURNAL_UNIQUE_INDEX");
+                if (r < 0) {
+                        if (r != -ENXIO)
+                                log_debug_errno(r, "Failed to parse $SYSTEMD_JOURNAL_UNIQUE_INDEX environment variable, ignoring: %m");
+                        cached = true;
+                } else
+                        cached = r;
+        }
+
+        return cached;
+}
+
+static bool histogram_requested(void) {
+        static thread_local int cached = -1;
+        int r;
+
+        if (cached < 0) {
+                r = getenv_bool("SYSTEMD_JOURNAL_HISTOGRAM");
+                if (r < 0) {
+                        if (r != -ENXIO)
+                                log_debug_errno(r, "Failed to parse $SYSTEMD_JOURNAL_HISTOGRAM environment variable, ignoring: %m");
+                        cached = true;
+                } else
+                        cached = r;
+        }
+
+        return cached;
+}
+
+static bool boot_index_requested(void) {
+        static thread_local int cached = -1;
+        int r;
+
+        if (cached < 0) {
+                r = getenv_bool("SYSTEMD_JOURNAL_BOOT_INDEX");
+                if (r < 0) {
+                        if (r != -ENXIO)
+                                log_debug_errno(r, "Failed to parse $SYSTEMD_JOURNAL_BOOT_INDEX environment variable, ignoring: %m");
+                        cached = true;
+                } else
+                        cached = r;
+        }
+
+        return cached;
+}
+
+static bool bloom_filter_requested(void) {
+        static thread_local int cached = -1;
+        int r;
+
+        if (cached < 0) {
+                r = getenv_bool("SYSTEMD_JOURNAL_BLOOM_FILTER");
+                if (r < 0) {
+                        if (r != -ENXIO)
+                                log_debug_errno(r, "Failed to parse $SYSTEMD_JOURNAL_BLOOM_FILTER environment variable, ignoring: %m");
+                        cached = true;
+                } else
+                        cached = r;
+        }
+
+        return cached;
+}
+
+static bool indexes_requested(void) {
+        /* Whether new files are marked with HEADER_COMPATIBLE_INDEXES, which is a requirement for writing
+         * any of these. */
+        return bloom_filter_requested() || unique_index_requested() || histogram_requested() || boot_index_requested();
+}
+
 #if HAVE_COMPRESSION
 static Compression getenv_compression(void) {
         Compression c;
@@ -411,10 +514,13 @@ static int journal_file_init_header(
                 .incompatible_flags = htole32(
                                 FLAGS_SET(file_flags, JOURNAL_COMPRESS) * COMPRESSION_TO_HEADER_INCOMPATIBLE_FLAG(compression_requested()) |
                                 keyed_hash_requested() * HEADER_INCOMPATIBLE_KEYED_HASH |
-                                compact_mode_requested() * HEADER_INCOMPATIBLE_COMPACT),
+                                compact_mode_requested() * HEADER_INCOMPATIBLE_COMPACT |
+                                (FLAGS_SET(file_flags, JOURNAL_COMPRESS|JOURNAL_ZSTD_DICTIONARY) &&
+                                 compression_requested() == COMPRESSION_ZSTD) * HEADER_INCOMPATIBLE_ZSTD_DICTIONARY),
                 .compatible_flags = htole32(
                                 (seal * (HEADER_COMPATIBLE_SEALED | HEADER_COMPATIBLE_SEALED_CONTINUOUS) ) |
-                                HEADER_COMPATIBLE_TAIL_ENTRY_BOOT_ID),
+                                HEADER_COMPATIBLE_TAIL_ENTRY_BOOT_ID |
+                                indexes_requested() * HEADER_COMPATIBLE_INDEXES),
         };
 
         assert_cc(sizeof(h.signature) == sizeof(HEADER_SIGNATURE));
@@ -654,6 +760,30 @@ static int journal_file_verify_header(JournalFile *f) {
                 }
         }
 
+        if (JOURNAL_HEADER_CONTAINS(f->header, bloom_filter_offset) &&
+            !offset_is_valid(le64toh(f->header->bloom_filter_offset), header_size, tail_object_offset))
+                return -ENODATA;
+
+        if (JOURNAL_HEADER_CONTAINS(f->header, unique_index_offset) &&
+            !offset_is_valid(le64toh(f->header->unique_index_offset), header_size, tail_object_offset))
+                return -ENODATA;
+
+        if (JOURNAL_HEADER_CONTAINS(f->header, histogram_offset) &&
+            !offset_is_valid(le64toh(f->header->histogram_offset), header_size, tail_object_offset))
+                return -ENODATA;
+
+        if (JOURNAL_HEADER_CONTAINS(f->header, boot_index_offset) &&
+            !offset_is_valid(le64toh(f->header->boot_index_offset), header_size, tail_object_offset))
+                return -ENODATA;
+
+        if (JOURNAL_HEADER_CONTAINS(f->header, zstd_dictionary_offset)) {
+                if (!offset_is_valid(le64toh(f->header->zstd_dictionary_offset), header_size, tail_object_offset))
+                        return -ENODATA;
+                if (f->header->zstd_dictionary_offset != 0 && !JOURNAL_HEADER_ZSTD_DICTIONARY(f->header))
+                        return -ENODATA;
+        } else if (JOURNAL_HEADER_ZSTD_DICTIONARY(f->header))
+                return -ENODATA;
+
         /* Verify number of objects */
         uint64_t n_objects = le64toh(f->header->n_objects);
         if (n_objects > arena_size / sizeof(ObjectHeader))
@@ -869,6 +999,11 @@ static uint64_t minimum_header_size(JournalFile *f, Object *o) {
                 [OBJECT_FIELD_HASH_TABLE] = sizeof(HashTableObject),
                 [OBJECT_ENTRY_ARRAY]      = sizeof(EntryArrayObject),
                 [OBJECT_TAG]              = sizeof(TagObject),
+                [OBJECT_BLOOM_FILTER]     = sizeof(BloomFilterObject),
+                [OBJECT_ZSTD_DICTIONARY]  = sizeof(ZstdDictionaryObject),
+                [OBJECT_UNIQUE_INDEX]     = sizeof(UniqueIndexObject),
+                [OBJECT_HISTOGRAM]        = sizeof(HistogramObject),
+                [OBJECT_BOOT_INDEX]       = sizeof(BootIndexObject),
         };
 
         assert(f);
@@ -1072,6 +1207,105 @@ static int check_object(JournalFile *f, Object *o, uint64_t offset) {
                                                le64toh(o->tag.epoch), offset);
 
                 break;
+
+        case OBJECT_BLOOM_FILTER: {
+                uint64_t sz;
+
+                sz = le64toh(READ_NOW(o->object.size));
+                if (sz <= offsetof(Object, bloom_filter.bits) ||
+                    (sz - offsetof(Object, bloom_filter.bits)) % sizeof(uint64_t) != 0)
+                        return log_debug_errno(SYNTHETIC_ERRNO(EBADMSG),
+                                               "Invalid bloom filter size: %" PRIu64 ": %" PRIu64,
+                                               sz,
+                                               offset);
+
+                if (o->bloom_filter.n_hash_functions <= 0 ||
+                    o->bloom_filter.n_hash_functions > BLOOM_FILTER_N_HASH_FUNCTIONS_MAX)
+                        return log_debug_errno(SYNTHETIC_ERRNO(EBADMSG),
+                                               "Invalid number of bloom filter hash functions: %u: %" PRIu64,
+                                               o->bloom_filter.n_hash_functions,
+                                               offset);
+
+                break;
+        }
+
+        case OBJECT_ZSTD_DICTIONARY: {
+                uint64_t sz;
+
+                sz = le64toh(READ_NOW(o->object.size));
+                if (sz <= offsetof(Object, zstd_dictionary.payload) ||
+                    sz - offsetof(Object, zstd_dictionary.payload) > ZSTD_DICTIONARY_SIZE_MAX)
+                        return log_debug_errno(SYNTHETIC_ERRNO(EBADMSG),
+                                               "Invalid ZSTD dictionary size: %" PRIu64 ": %" PRIu64,
+                                               sz,
+                                               offset);
+
+                break;
+        }
+
+        case OBJECT_UNIQUE_INDEX: {
+                uint64_t sz, n;
+
+                sz = le64toh(READ_NOW(o->object.size));
+                n = le64toh(READ_NOW(o->unique_index.n_fields));
+                if (n > (sz - offsetof(Object, unique_index.items)) / sizeof(UniqueIndexItem) ||
+                    sz > UINT32_MAX)
+                        return log_debug_errno(SYNTHETIC_ERRNO(EBADMSG),
+                                               "Invalid unique index size/number of fields: %" PRIu64 "/%" PRIu64 ": %" PRIu64,
+                                               sz,
+                                               n,
+                                               offset);
+
+                break;
+        }
+
+        case OBJECT_HISTOGRAM: {
+                uint64_t sz, n, b, start, next;
+
+                sz = le64toh(READ_NOW(o->object.size));
+                n = le64toh(READ_NOW(o->histogram.n_buckets));
+                b = le64toh(READ_NOW(o->histogram.bucket_usec));
+                start = le64toh(READ_NOW(o->histogram.start_realtime));
+                if (n <= 0 || n > (UINT64_MAX - offsetof(Object, histogram.counts)) / (HISTOGRAM_N_COLUMNS * sizeof(le32_t)) ||
+                    sz != offsetof(Object, histogram.counts) + n * HISTOGRAM_N_COLUMNS * sizeof(le32_t))
+                        return log_debug_errno(SYNTHETIC_ERRNO(EBADMSG),
+                                               "Invalid histogram size/number of buckets: %" PRIu64 "/%" PRIu64 ": %" PRIu64,
+                                               sz,
+                                               n,
+                                               offset);
+
+                if (b <= 0 || b > (UINT64_MAX - start) / n)
+                        return log_debug_errno(SYNTHETIC_ERRNO(EBADMSG),
+                                               "Invalid histogram bucket size: %" PRIu64 ": %" PRIu64,
+                                               b,
+                                               offset);
+
+                /* Like entry arrays, histogram objects are chained in strictly increasing order. */
+                next = le64toh(READ_NOW(o->histogram.next_histogram_offset));
+                if (!VALID64(next) || (next > 0 && next <= offset))
+                        return log_debug_errno(SYNTHETIC_ERRNO(EBADMSG),
+                                               "Invalid histogram next_histogram_offset: %" PRIu64 ": %" PRIu64,
+                                               next,
+                                               offset);
+
+                break;
+        }
+
+        case OBJECT_BOOT_INDEX: {
+                uint64_t sz, n;
+
+                sz = le64toh(READ_NOW(o->object.size));
+                n = le64toh(READ_NOW(o->boot_index.n_boots));
+                if (n > (sz - offsetof(Object, boot_index.items)) / sizeof(BootIndexItem) ||
+                    sz != offsetof(Object, boot_index.items) + n * sizeof(BootIndexItem))
+                        return log_debug_errno(SYNTHETIC_ERRNO(EBADMSG),
+                                               "Invalid boot index size/number of boots: %" PRIu64 "/%" PRIu64 ": %" PRIu64,
+                                               sz,
+                                               n,
+                                               offset);
+
+                break;
+        }
         }
 
         return 0;
@@ -1383,135 +1617,1206 @@ int journal_file_map_field_hash_table(JournalFile *f) {
         return 0;
 }
 
-static int journal_file_link_field(
-                JournalFile *f,
-                Object *o,
-                uint64_t offset,
-                uint64_t hash) {
+static uint64_t bloom_filter_bit(uint64_t hash, unsigned i, uint64_t n_bits) {
+        /* Derive all probe positions from the two halves of the DATA object hash (Kirsch-Mitzenmacher
+         * double hashing), so that neither the writer nor the reader needs to hash the payload again. */
+        return ((hash & UINT32_MAX) + (uint64_t) i * ((hash >> 32) | 1)) % n_bits;
+}
 
-        uint64_t p, h, m;
+static int journal_file_map_bloom_filter(JournalFile *f) {
+        uint64_t p;
+        Object *o;
+        void *t;
         int r;
 
         assert(f);
         assert(f->header);
-        assert(f->field_hash_table);
-        assert(o);
-        assert(offset > 0);
-
-        if (o->object.type != OBJECT_FIELD)
-                return -EINVAL;
 
-        m = le64toh(READ_NOW(f->header->field_hash_table_size)) / sizeof(HashItem);
-        if (m <= 0)
-                return -EBADMSG;
+        if (f->bloom_filter)
+                return 1;
 
-        /* This might alter the window we are looking at */
-        o->field.next_hash_offset = o->field.head_data_offset = 0;
+        if (!JOURNAL_HEADER_CONTAINS(f->header, bloom_filter_offset))
+                return 0;
 
-        h = hash % m;
-        p = le64toh(f->field_hash_table[h].tail_hash_offset);
+        /* The bloom filter is written when the file is archived, hence check the header each time until we
+         * find it set. */
+        p = le64toh(READ_NOW(f->header->bloom_filter_offset));
         if (p == 0)
-                f->field_hash_table[h].head_hash_offset = htole64(offset);
-        else {
-                r = journal_file_move_to_object(f, OBJECT_FIELD, p, &o);
-                if (r < 0)
-                        return r;
-
-                o->field.next_hash_offset = htole64(offset);
-        }
+                return 0;
 
-        f->field_hash_table[h].tail_hash_offset = htole64(offset);
+        /* Validate the object once, then keep it mapped for the lifetime of the file. */
+        r = journal_file_move_to_object(f, OBJECT_BLOOM_FILTER, p, &o);
+        if (r < 0)
+                return r;
 
-        if (JOURNAL_HEADER_CONTAINS(f->header, n_fields))
-                f->header->n_fields = htole64(le64toh(f->header->n_fields) + 1);
+        r = journal_file_move_to(f, OBJECT_BLOOM_FILTER, true, p, le64toh(o->object.size), &t);
+        if (r < 0)
+                return r;
 
-        return 0;
+        f->bloom_filter = t;
+        return 1;
 }
 
-static int journal_file_link_data(
-                JournalFile *f,
-                Object *o,
-                uint64_t offset,
-                uint64_t hash) {
-
-        uint64_t p, h, m;
+int journal_file_bloom_filter_test(JournalFile *f, uint64_t hash) {
+        uint64_t n_bits;
         int r;
 
         assert(f);
-        assert(f->header);
-        assert(f->data_hash_table);
-        assert(o);
-        assert(offset > 0);
-
-        if (o->object.type != OBJECT_DATA)
-                return -EINVAL;
 
-        m = le64toh(READ_NOW(f->header->data_hash_table_size)) / sizeof(HashItem);
-        if (m <= 0)
-                return -EBADMSG;
+        /* Returns 0 if the file definitely contains no DATA object with the specified hash, and > 0 if it
+         * might, or if the file has no bloom filter. */
 
-        /* This might alter the window we are looking at */
-        o->data.next_hash_offset = o->data.next_field_offset = 0;
-        o->data.entry_offset = o->data.entry_array_offset = 0;
-        o->data.n_entries = 0;
+        r = journal_file_map_bloom_filter(f);
+        if (r <= 0)
+                return r < 0 ? r : 1;
 
-        h = hash % m;
-        p = le64toh(f->data_hash_table[h].tail_hash_offset);
-        if (p == 0)
-                /* Only entry in the hash table is easy */
-                f->data_hash_table[h].head_hash_offset = htole64(offset);
-        else {
-                /* Move back to the previous data object, to patch in
-                 * pointer */
+        n_bits = (le64toh(f->bloom_filter->object.size) - offsetof(Object, bloom_filter.bits)) * 8;
 
-                r = journal_file_move_to_object(f, OBJECT_DATA, p, &o);
-                if (r < 0)
-                        return r;
+        for (unsigned i = 0; i < f->bloom_filter->n_hash_functions; i++) {
+                uint64_t b = bloom_filter_bit(hash, i, n_bits);
 
-                o->data.next_hash_offset = htole64(offset);
+                if (!BIT_SET(f->bloom_filter->bits[b / 8], b % 8))
+                        return 0;
         }
 
-        f->data_hash_table[h].tail_hash_offset = htole64(offset);
+        return 1;
+}
 
-        if (JOURNAL_HEADER_CONTAINS(f->header, n_data))
-                f->header->n_data = htole64(le64toh(f->header->n_data) + 1);
+static int journal_file_append_bloom_filter(JournalFile *f) {
+        _cleanup_free_ uint8_t *bits = NULL;
+        uint64_t n_data, n_bits, n_items = 0, m, q;
+        Object *o;
+        int r;
 
-        return 0;
-}
+        assert(f);
+        assert(f->header);
 
-static int get_next_hash_offset(
-                JournalFile *f,
-                uint64_t *p,
-                le64_t *next_hash_offset,
-                uint64_t *depth,
-                le64_t *header_max_depth) {
+        if (!bloom_filter_requested() || !JOURNAL_HEADER_INDEXES(f->header))
+                return 0;
 
-        uint64_t nextp;
+        if (!JOURNAL_HEADER_CONTAINS(f->header, bloom_filter_offset) || f->header->bloom_filter_offset != 0)
+                return 0;
 
-        assert(f);
-        assert(p);
-        assert(next_hash_offset);
-        assert(depth);
+        n_data = le64toh(f->header->n_data);
+        if (n_data <= 0)
+                return 0;
 
-        nextp = le64toh(READ_NOW(*next_hash_offset));
-        if (nextp > 0) {
-                if (nextp <= *p) /* Refuse going in loops */
-                        return log_debug_errno(SYNTHETIC_ERRNO(EBADMSG),
-                                               "Detected hash item loop in %s, refusing.", f->path);
+        m = le64toh(f->header->data_hash_table_size) / sizeof(HashItem);
+        if (m <= 0)
+                return 0;
 
-                (*depth)++;
+        r = journal_file_map_data_hash_table(f);
+        if (r < 0)
+                return r;
 
-                /* If the depth of this hash chain is larger than all others we have seen so far, record it */
-                if (header_max_depth && journal_file_writable(f))
-                        *header_max_depth = htole64(MAX(*depth, le64toh(*header_max_depth)));
-        }
+        /* Round up to a multiple of 64 bits, so that the object stays 64-bit aligned */
+        n_bits = DIV_ROUND_UP(MAX(n_data * BLOOM_FILTER_BITS_PER_ITEM, 64U), 64U) * 64U;
+        bits = new0(uint8_t, n_bits / 8);
+        if (!bits)
+                return -ENOMEM;
 
-        *p = nextp;
-        return 0;
-}
+        /* Build the filter in memory first, appending the object below might remap the file. */
+        for (uint64_t i = 0; i < m; i++) {
+                uint64_t p = le64toh(f->data_hash_table[i].head_hash_offset);
 
-int journal_file_find_field_object_with_hash(
-                JournalFile *f,
+                while (p > 0) {
+                        uint64_t next;
+
+                        r = journal_file_move_to_object(f, OBJECT_DATA, p, &o);
+                        if (r < 0)
+                                return r;
+
+                        for (unsigned k = 0; k < BLOOM_FILTER_N_HASH_FUNCTIONS; k++) {
+                                uint64_t b = bloom_filter_bit(le64toh(o->data.hash), k, n_bits);
+                                SET_BIT(bits[b / 8], b % 8);
+                        }
+
+                        /* Hash chains are ordered by offset, refuse to loop forever on corrupted files. */
+                        next = le64toh(o->data.next_hash_offset);
+                        if ((next != 0 && next <= p) || ++n_items > n_data)
+                                return -EBADMSG;
+
+                        p = next;
+                }
+        }
+
+        r = journal_file_append_object(f,
+                                       OBJECT_BLOOM_FILTER,
+                                       offsetof(Object, bloom_filter.bits) + n_bits / 8,
+                                       &o, &q);
+        if (r < 0)
+                return r;
+
+        o->bloom_filter.n_items = htole64(n_items);
+        o->bloom_filter.n_hash_functions = BLOOM_FILTER_N_HASH_FUNCTIONS;
+        memcpy(o->bloom_filter.bits, bits, n_bits / 8);
+
+#if HAVE_GCRYPT
+        r = journal_file_hmac_put_object(f, OBJECT_BLOOM_FILTER, o, q);
+        if (r < 0)
+                return r;
+#endif
+
+        /* Only publish the filter once it is fully written. */
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        f->header->bloom_filter_offset = htole64(q);
+
+        log_debug("Wrote bloom filter with %"PRIu64" bits for %"PRIu64" data objects to %s.", n_bits, n_items, f->path);
+        return 0;
+}
+
+static const le32_t *unique_index_table(const UniqueIndexObject *u, uint64_t i) {
+        return (const le32_t*) ((const uint8_t*) u + le64toh(u->items[i].offset));
+}
+
+static void unique_index_string(const UniqueIndexObject *u, const le32_t *table, uint64_t k, const void **ret_data, size_t *ret_size) {
+        uint32_t a = le32toh(table[k]), b = le32toh(table[k + 1]);
+
+        *ret_data = (const uint8_t*) u + a;
+        *ret_size = b - a;
+}
+
+int journal_unique_index_validate(const UniqueIndexObject *u) {
+        uint64_t sz, n_fields;
+        const void *prev_name = NULL;
+        size_t prev_name_size = 0;
+
+        assert(u);
+
+        /* The object is validated in full once when it is mapped, so that lookups can trust it later on. */
+
+        sz = le64toh(u->object.size);
+        n_fields = le64toh(u->n_fields);
+
+        for (uint64_t i = 0; i < n_fields; i++) {
+                uint64_t p = le64toh(u->items[i].offset), n = le64toh(u->items[i].n_values), prev;
+                const void *name, *prev_value = NULL;
+                size_t name_size, prev_value_size = 0;
+                const le32_t *table;
+
+                if (p % sizeof(le32_t) != 0 ||
+                    p < offsetof(UniqueIndexObject, items) + n_fields * sizeof(UniqueIndexItem) ||
+                    p > sz ||
+                    (sz - p) / sizeof(le32_t) < 2 ||
+                    n > (sz - p) / sizeof(le32_t) - 2)
+                        return -EBADMSG;
+
+                table = unique_index_table(u, i);
+
+                prev = p + (n + 2) * sizeof(le32_t);
+                if (le32toh(table[0]) != prev)
+                        return -EBADMSG;
+                for (uint64_t k = 0; k < n + 2; k++) {
+                        if (le32toh(table[k]) < prev || le32toh(table[k]) > sz)
+                                return -EBADMSG;
+                        prev = le32toh(table[k]);
+                }
+
+                /* Fields are sorted by name, and every value carries the field name as prefix. */
+                unique_index_string(u, table, 0, &name, &name_size);
+                if (name_size <= 0 || (prev_name && memcmp_nn(prev_name, prev_name_size, name, name_size) >= 0))
+                        return -EBADMSG;
+
+                for (uint64_t k = 1; k <= n; k++) {
+                        const void *value;
+                        size_t value_size;
+
+                        unique_index_string(u, table, k, &value, &value_size);
+                        if (value_size <= name_size ||
+                            memcmp(value, name, name_size) != 0 ||
+                            ((const char*) value)[name_size] != '=')
+                                return -EBADMSG;
+
+                        if (prev_value && memcmp_nn(prev_value, prev_value_size, value, value_size) >= 0)
+                                return -EBADMSG;
+
+                        prev_value = value;
+                        prev_value_size = value_size;
+                }
+
+                prev_name = name;
+                prev_name_size = name_size;
+        }
+
+        return 0;
+}
+
+static int journal_file_map_unique_index(JournalFile *f) {
+        uint64_t p;
+        Object *o;
+        void *t;
+        int r;
+
+        assert(f);
+        assert(f->header);
+
+        if (f->unique_index)
+                return 1;
+
+        if (f->unique_index_invalid || !JOURNAL_HEADER_CONTAINS(f->header, unique_index_offset))
+                return 0;
+
+        /* Like the bloom filter, the unique index is written when the file is archived. */
+        p = le64toh(READ_NOW(f->header->unique_index_offset));
+        if (p == 0)
+                return 0;
+
+        r = journal_file_move_to_object(f, OBJECT_UNIQUE_INDEX, p, &o);
+        if (r < 0)
+                return r;
+
+        r = journal_file_move_to(f, OBJECT_UNIQUE_INDEX, true, p, le64toh(o->object.size), &t);
+        if (r < 0)
+                return r;
+
+        /* The index only describes the file as it was when the index was written. Ignore it if entries
+         * have been added since, or if it is corrupted. Readers will fall back to the hash tables. */
+        o = t;
+        if (o->unique_index.tail_entry_seqnum != f->header->tail_entry_seqnum) {
+                log_debug("Unique index of %s is stale, ignoring.", f->path);
+                f->unique_index_invalid = true;
+                return 0;
+        }
+
+        r = journal_unique_index_validate(&o->unique_index);
+        if (r < 0) {
+                log_debug_errno(r, "Unique index of %s is corrupted, ignoring: %m", f->path);
+                f->unique_index_invalid = true;
+                return 0;
+        }
+
+        f->unique_index = t;
+        return 1;
+}
+
+int journal_file_get_unique_values(JournalFile *f, const char *field, size_t size, JournalUniqueValues *ret) {
+        uint64_t a, b;
+        int r;
+
+        assert(f);
+        assert(field);
+        assert(ret);
+
+        /* Returns > 0 and the sorted list of all "FIELD=value" payloads of the specified field if the file
+         * has a unique index that covers the field, and 0 otherwise. */
+
+        r = journal_file_map_unique_index(f);
+        if (r <= 0)
+                return r;
+
+        a = 0;
+        b = le64toh(f->unique_index->n_fields);
+        while (a < b) {
+                uint64_t m = a + (b - a) / 2;
+                const le32_t *table = unique_index_table(f->unique_index, m);
+                const void *name;
+                size_t name_size;
+                int c;
+
+                unique_index_string(f->unique_index, table, 0, &name, &name_size);
+
+                c = memcmp_nn(name, name_size, field, size);
+                if (c == 0) {
+                        *ret = (JournalUniqueValues) {
+                                .object = f->unique_index,
+                                .offsets = table,
+                                .n_values = le64toh(f->unique_index->items[m].n_values),
+                        };
+                        return 1;
+                }
+                if (c < 0)
+                        a = m + 1;
+                else
+                        b = m;
+        }
+
+        return 0;
+}
+
+void journal_unique_values_get(const JournalUniqueValues *v, uint64_t i, const void **ret_data, size_t *ret_size) {
+        assert(v);
+        assert(i < v->n_values);
+        assert(ret_data);
+        assert(ret_size);
+
+        /* The first string in the table is the field name itself */
+        unique_index_string(v->object, v->offsets, i + 1, ret_data, ret_size);
+}
+
+bool journal_unique_values_contains(const JournalUniqueValues *v, const void *data, size_t size) {
+        uint64_t a = 0, b;
+
+        assert(v);
+        assert(data || size == 0);
+
+        b = v->n_values;
+        while (a < b) {
+                uint64_t m = a + (b - a) / 2;
+                const void *value;
+                size_t value_size;
+                int c;
+
+                journal_unique_values_get(v, m, &value, &value_size);
+
+                c = memcmp_nn(value, value_size, data, size);
+                if (c == 0)
+                        return true;
+                if (c < 0)
+                        a = m + 1;
+                else
+                        b = m;
+        }
+
+        return false;
+}
+
+typedef struct UniqueIndexField {
+        struct iovec name;
+        struct iovec *values;
+        size_t n_values;
+} UniqueIndexField;
+
+static void unique_index_field_done(UniqueIndexField *u) {
+        assert(u);
+
+        iovec_done(&u->name);
+        iovec_array_free(u->values, u->n_values);
+        u->values = NULL;
+        u->n_values = 0;
+}
+
+static void unique_index_field_array_free(UniqueIndexField *a, size_t n) {
+        FOREACH_ARRAY(u, a, n)
+                unique_index_field_done(u);
+        free(a);
+}
+
+static int unique_index_field_compare(const UniqueIndexField *a, const UniqueIndexField *b) {
+        return iovec_memcmp(&a->name, &b->name);
+}
+
+static int journal_file_collect_unique_values(JournalFile *f, Object *o, UniqueIndexField *ret) {
+        _cleanup_(unique_index_field_done) UniqueIndexField u = {};
+        uint64_t q;
+        int r;
+
+        assert(f);
+        assert(o);
+        assert(ret);
+
+        /* Returns 0 if the field does not qualify for the index, > 0 otherwise. */
+
+        if (!iovec_memdup(&IOVEC_MAKE(o->field.payload, le64toh(o->object.size) - offsetof(Object, field.payload)), &u.name))
+                return -ENOMEM;
+
+        q = le64toh(o->field.head_data_offset);
+        if (q == 0)
+                return 0;
+
+        while (q > 0) {
+                uint64_t next;
+                size_t l;
+                void *d;
+
+                if (u.n_values >= UNIQUE_INDEX_N_VALUES_MAX)
+                        return 0;
+
+                r = journal_file_move_to_object(f, OBJECT_DATA, q, &o);
+                if (r < 0)
+                        return r;
+
+                /* New data objects are prepended to the list of their field, hence offsets decrease. */
+                next = le64toh(o->data.next_field_offset);
+                if (next != 0 && next >= q)
+                        return -EBADMSG;
+
+                /* Don't index fields we cannot read completely, readers will see the same errors when they
+                 * fall back to the data objects. */
+                r = journal_file_data_payload(f, o, q, NULL, 0, 0, &d, &l);
+                if (IN_SET(r, -EADDRNOTAVAIL, -EBADMSG))
+                        return 0;
+                if (r < 0)
+                        return r;
+                if (l > UNIQUE_INDEX_VALUE_SIZE_MAX)
+                        return 0;
+
+                if (!GREEDY_REALLOC(u.values, u.n_values + 1))
+                        return -ENOMEM;
+
+                if (!iovec_memdup(&IOVEC_MAKE(d, l), u.values + u.n_values))
+                        return -ENOMEM;
+                u.n_values++;
+
+                q = next;
+        }
+
+        typesafe_qsort(u.values, u.n_values, iovec_memcmp);
+
+        /* Data objects are unique within a file, but let's not rely on this for corrupted files. */
+        for (size_t i = 1; i < u.n_values; i++)
+                if (iovec_memcmp(u.values + i - 1, u.values + i) == 0)
+                        return 0;
+
+        *ret = TAKE_STRUCT(u);
+        return 1;
+}
+
+static int journal_file_append_unique_index(JournalFile *f) {
+        _cleanup_free_ uint8_t *buf = NULL;
+        UniqueIndexField *fields = NULL;
+        size_t n_fields = 0;
+        uint64_t m, sz, pos, q;
+        Object *o;
+        int r;
+
+        CLEANUP_ARRAY(fields, n_fields, unique_index_field_array_free);
+
+        assert(f);
+        assert(f->header);
+
+        if (!unique_index_requested() || !JOURNAL_HEADER_INDEXES(f->header))
+                return 0;
+
+        if (!JOURNAL_HEADER_CONTAINS(f->header, unique_index_offset) || f->header->unique_index_offset != 0)
+                return 0;
+
+        if (le64toh(f->header->n_fields) <= 0)
+                return 0;
+
+        m = le64toh(f->header->field_hash_table_size) / sizeof(HashItem);
+        if (m <= 0)
+                return 0;
+
+        r = journal_file_map_field_hash_table(f);
+        if (r < 0)
+                return r;
+
+        /* Collect the values of all fields with few, short values. These are the ones that are typically
+         * enumerated (_SYSTEMD_UNIT=, _BOOT_ID=, PRIORITY=, …), while fields like MESSAGE= are not worth
+         * indexing. */
+        sz = 0;
+        for (uint64_t i = 0; i < m; i++) {
+                uint64_t p = le64toh(f->field_hash_table[i].head_hash_offset);
+
+                while (p > 0) {
+                        UniqueIndexField u;
+                        uint64_t next, usz;
+
+                        r = journal_file_move_to_object(f, OBJECT_FIELD, p, &o);
+                        if (r < 0)
+                                return r;
+
+                        next = le64toh(o->field.next_hash_offset);
+                        if (next != 0 && next <= p)
+                                return -EBADMSG;
+
+                        r = journal_file_collect_unique_values(f, o, &u);
+                        if (r < 0)
+                                return r;
+                        if (r > 0) {
+                                usz = sizeof(UniqueIndexItem) + (u.n_values + 2) * sizeof(le32_t) + sizeof(le32_t) + u.name.iov_len;
+                                FOREACH_ARRAY(v, u.values, u.n_values)
+                                        usz += v->iov_len;
+
+                                if (sz + usz > UNIQUE_INDEX_SIZE_MAX)
+                                        unique_index_field_done(&u);
+                                else {
+                                        if (!GREEDY_REALLOC(fields, n_fields + 1)) {
+                                                unique_index_field_done(&u);
+                                                return -ENOMEM;
+                                        }
+
+                                        fields[n_fields++] = u;
+                                        sz += usz;
+                                }
+                        }
+
+                        p = next;
+                }
+        }
+
+        if (n_fields <= 0)
+                return 0;
+
+        typesafe_qsort(fields, n_fields, unique_index_field_compare);
+
+        /* Build the object in memory first, appending it below might remap the file. Every field gets a
+         * table of n_values + 2 offsets (relative to the start of the object) of its name, its sorted values
+         * and the end of the last value. */
+        sz += offsetof(Object, unique_index.items);
+        buf = malloc0(sz);
+        if (!buf)
+                return -ENOMEM;
+
+        UniqueIndexObject *u = (UniqueIndexObject*) buf;
+        u->tail_entry_seqnum = f->header->tail_entry_seqnum;
+        u->n_fields = htole64(n_fields);
+
+        pos = offsetof(UniqueIndexObject, items) + n_fields * sizeof(UniqueIndexItem);
+        for (size_t i = 0; i < n_fields; i++) {
+                le32_t *table;
+                uint64_t k = 0;
+
+                pos = ALIGN_TO(pos, sizeof(le32_t));
+                u->items[i] = (UniqueIndexItem) {
+                        .offset = htole64(pos),
+                        .n_values = htole64(fields[i].n_values),
+                };
+
+                table = (le32_t*) (buf + pos);
+                pos += (fields[i].n_values + 2) * sizeof(le32_t);
+
+                table[k++] = htole32(pos);
+                pos = (uint8_t*) mempcpy(buf + pos, fields[i].name.iov_base, fields[i].name.iov_len) - buf;
+
+                FOREACH_ARRAY(v, fields[i].values, fields[i].n_values) {
+                        table[k++] = htole32(pos);
+                        pos = (uint8_t*) mempcpy(buf + pos, v->iov_base, v->iov_len) - buf;
+                }
+
+                table[k] = htole32(pos);
+        }
+
+        assert(pos <= sz);
+
+        r = journal_file_append_object(f, OBJECT_UNIQUE_INDEX, pos, &o, &q);
+        if (r < 0)
+                return r;
+
+        memcpy((uint8_t*) o + sizeof(ObjectHeader), buf + sizeof(ObjectHeader), pos - sizeof(ObjectHeader));
+
+#if HAVE_GCRYPT
+        r = journal_file_hmac_put_object(f, OBJECT_UNIQUE_INDEX, o, q);
+        if (r < 0)
+                return r;
+#endif
+
+        /* Only publish the index once it is fully written. */
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        f->header->unique_index_offset = htole64(q);
+
+        log_debug("Wrote unique index for %zu fields (%"PRIu64" bytes) to %s.", n_fields, pos, f->path);
+        return 0;
+}
+
+static unsigned histogram_column(const void *data, size_t size) {
+        const char *p;
+
+        /* Returns the syslog priority encoded in a PRIORITY= field, or the last column if this is not a
+         * valid PRIORITY= field. */
+
+        if (size != STRLEN("PRIORITY=") + 1)
+                return HISTOGRAM_N_COLUMNS - 1;
+
+        p = memory_startswith(data, size, "PRIORITY=");
+        if (!p || *p < '0' || *p > '0' + LOG_DEBUG)
+                return HISTOGRAM_N_COLUMNS - 1;
+
+        return *p - '0';
+}
+
+static bool histogram_covers(Object *o, uint64_t realtime) {
+        uint64_t start = le64toh(o->histogram.start_realtime);
+
+        return realtime >= start &&
+                (realtime - start) / le64toh(o->histogram.bucket_usec) < le64toh(o->histogram.n_buckets);
+}
+
+static int journal_file_histogram_count(JournalFile *f, uint64_t realtime, unsigned column) {
+        uint64_t p, q, tail = 0, i;
+        unsigned n = 0;
+        Object *o;
+        int r;
+
+        assert(f);
+        assert(f->header);
+        assert(column < HISTOGRAM_N_COLUMNS);
+
+        if (!histogram_requested() || !JOURNAL_HEADER_INDEXES(f->header))
+                return 0;
+
+        if (!JOURNAL_HEADER_CONTAINS(f->header, histogram_offset))
+                return 0;
+
+        /* Entries are mostly appended in order, hence try the object we counted the last entry in first. */
+        if (f->histogram_last_offset != 0) {
+                r = journal_file_move_to_object(f, OBJECT_HISTOGRAM, f->histogram_last_offset, &o);
+                if (r < 0)
+                        return r;
+
+                if (histogram_covers(o, realtime))
+                        goto found;
+        }
+
+        for (p = le64toh(f->header->histogram_offset); p > 0; p = le64toh(o->histogram.next_histogram_offset)) {
+                r = journal_file_move_to_object(f, OBJECT_HISTOGRAM, p, &o);
+                if (r < 0)
+                        return r;
+
+                if (histogram_covers(o, realtime)) {
+                        f->histogram_last_offset = p;
+                        goto found;
+                }
+
+                tail = p;
+                n++;
+        }
+
+        /* Don't let a clock that jumps around blow up the file. Without a bucket for every entry the
+         * histogram is incomplete, which readers detect by comparing the total with n_entries. */
+        if (n >= HISTOGRAM_N_OBJECTS_MAX)
+                return 0;
+
+        r = journal_file_append_object(f,
+                                       OBJECT_HISTOGRAM,
+                                       offsetof(Object, histogram.counts) + HISTOGRAM_N_BUCKETS * HISTOGRAM_N_COLUMNS * sizeof(le32_t),
+                                       &o, &q);
+        if (r < 0)
+                return r;
+
+        o->histogram.next_histogram_offset = 0;
+        o->histogram.start_realtime = htole64(realtime - realtime % (HISTOGRAM_BUCKET_USEC * HISTOGRAM_N_BUCKETS));
+        o->histogram.bucket_usec = htole64(HISTOGRAM_BUCKET_USEC);
+        o->histogram.n_buckets = htole64(HISTOGRAM_N_BUCKETS);
+        memzero(o->histogram.counts, HISTOGRAM_N_BUCKETS * HISTOGRAM_N_COLUMNS * sizeof(le32_t));
+
+#if HAVE_GCRYPT
+        r = journal_file_hmac_put_object(f, OBJECT_HISTOGRAM, o, q);
+        if (r < 0)
+                return r;
+#endif
+
+        /* Link the new object into the chain only once it is fully initialized. */
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+        if (tail > 0) {
+                r = journal_file_move_to_object(f, OBJECT_HISTOGRAM, tail, &o);
+                if (r < 0)
+                        return r;
+
+                o->histogram.next_histogram_offset = htole64(q);
+        } else
+                f->header->histogram_offset = htole64(q);
+
+        r = journal_file_move_to_object(f, OBJECT_HISTOGRAM, q, &o);
+        if (r < 0)
+                return r;
+
+        f->histogram_last_offset = q;
+
+found:
+        i = (realtime - le64toh(o->histogram.start_realtime)) / le64toh(o->histogram.bucket_usec) * HISTOGRAM_N_COLUMNS + column;
+        if (o->histogram.counts[i] != htole32(UINT32_MAX))
+                o->histogram.counts[i] = htole32(le32toh(o->histogram.counts[i]) + 1);
+
+        return 1;
+}
+
+static int journal_file_get_histogram_from_index(
+                JournalFile *f,
+                usec_t since,
+                usec_t until,
+                usec_t bucket_usec,
+                uint64_t *counts,
+                size_t n_buckets) {
+
+        _cleanup_free_ uint64_t *c = NULL;
+        uint64_t total = 0;
+        unsigned n = 0;
+        Object *o;
+        int r;
+
+        assert(f);
+        assert(f->header);
+
+        /* Returns 0 if the histogram objects of the file cannot answer the query, i.e. if they do not cover
+         * all entries, or their buckets do not line up with the requested ones. */
+
+        if (!JOURNAL_HEADER_CONTAINS(f->header, histogram_offset) || f->header->histogram_offset == 0)
+                return 0;
+
+        c = new0(uint64_t, n_buckets * (LOG_DEBUG + 1));
+        if (!c)
+                return -ENOMEM;
+
+        for (uint64_t p = le64toh(f->header->histogram_offset); p > 0; p = le64toh(o->histogram.next_histogram_offset)) {
+                uint64_t start, b, m;
+
+                if (++n > HISTOGRAM_N_OBJECTS_MAX)
+                        return -EBADMSG;
+
+                r = journal_file_move_to_object(f, OBJECT_HISTOGRAM, p, &o);
+                if (r < 0)
+                        return r;
+
+                start = le64toh(o->histogram.start_realtime);
+                b = le64toh(o->histogram.bucket_usec);
+                m = le64toh(o->histogram.n_buckets);
+
+                for (uint64_t i = 0; i < m; i++) {
+                        const le32_t *row = o->histogram.counts + i * HISTOGRAM_N_COLUMNS;
+                        uint64_t t0 = start + i * b, t1 = t0 + b, k;
+                        bool any = false;
+
+                        for (unsigned col = 0; col < HISTOGRAM_N_COLUMNS; col++) {
+                                total += le32toh(row[col]);
+                                if (col <= LOG_DEBUG && row[col] != 0)
+                                        any = true;
+                        }
+
+                        if (!any || t1 <= since || t0 >= until)
+                                continue;
+
+                        /* A bucket of the index that is not fully contained in one requested bucket? */
+                        if (t0 < since || t1 > until || (t0 - since) / bucket_usec != (t1 - 1 - since) / bucket_usec)
+                                return 0;
+
+                        k = (t0 - since) / bucket_usec;
+                        assert(k < n_buckets);
+
+                        for (unsigned col = 0; col <= LOG_DEBUG; col++)
+                                c[k * (LOG_DEBUG + 1) + col] += le32toh(row[col]);
+                }
+        }
+
+        if (total != le64toh(f->header->n_entries))
+                return 0;
+
+        for (size_t i = 0; i < n_buckets * (LOG_DEBUG + 1); i++)
+                counts[i] += c[i];
+
+        return 1;
+}
+
+int journal_file_get_histogram(
+                JournalFile *f,
+                usec_t since,
+                usec_t until,
+                usec_t bucket_usec,
+                uint64_t *counts,
+                size_t n_buckets) {
+
+        int r;
+
+        assert(f);
+        assert(f->header);
+        assert(since < until);
+        assert(bucket_usec > 0);
+        assert(counts);
+        assert(n_buckets >= DIV_ROUND_UP(until - since, bucket_usec));
+
+        /* Adds the number of entries of the file with realtime timestamps in [since, until) to 'counts', by
+         * bucket and priority, i.e. counts[bucket * (LOG_DEBUG + 1) + priority]. Entries without a valid
+         * PRIORITY= field are not counted. */
+
+        r = journal_file_get_histogram_from_index(f, since, until, bucket_usec, counts, n_buckets);
+        if (r != 0)
+                return r;
+
+        /* No usable index, look at every entry that has a PRIORITY= field instead. */
+        for (int priority = 0; priority <= LOG_DEBUG; priority++) {
+                char data[] = "PRIORITY=0";
+                uint64_t dp, q;
+                Object *d, *o;
+
+                data[STRLEN("PRIORITY=")] += priority;
+
+                r = journal_file_find_data_object(f, data, strlen(data), &d, &dp);
+                if (r < 0)
+                        return r;
+                if (r == 0)
+                        continue;
+
+                r = journal_file_move_to_entry_for_data(f, d, DIRECTION_DOWN, &o, &q);
+                while (r > 0) {
+                        uint64_t realtime = le64toh(o->entry.realtime);
+
+                        if (realtime >= since && realtime < until)
+                                counts[(realtime - since) / bucket_usec * (LOG_DEBUG + 1) + priority]++;
+
+                        r = journal_file_move_to_object(f, OBJECT_DATA, dp, &d);
+                        if (r < 0)
+                                return r;
+
+                        r = journal_file_move_to_entry_by_offset_for_data(f, d, q + 1, DIRECTION_DOWN, &o, &q);
+                }
+                if (r < 0)
+                        return r;
+        }
+
+        return 0;
+}
+
+static int journal_boot_range_compare(const JournalBootRange *a, const JournalBootRange *b) {
+        return CMP(a->head_seqnum, b->head_seqnum);
+}
+
+static int journal_file_get_boot_ranges_from_index(JournalFile *f, JournalBootRange **ret, size_t *ret_n) {
+        _cleanup_free_ JournalBootRange *ranges = NULL;
+        uint64_t p, n;
+        Object *o;
+        int r;
+
+        assert(f);
+        assert(f->header);
+        assert(ret);
+        assert(ret_n);
+
+        /* Returns 0 if the file has no usable boot index. */
+
+        if (!JOURNAL_HEADER_CONTAINS(f->header, boot_index_offset))
+                return 0;
+
+        p = le64toh(READ_NOW(f->header->boot_index_offset));
+        if (p == 0)
+                return 0;
+
+        r = journal_file_move_to_object(f, OBJECT_BOOT_INDEX, p, &o);
+        if (r < 0)
+                return r;
+
+        /* Like the unique index, the boot index only describes the file as it was when it was written. */
+        if (o->boot_index.tail_entry_seqnum != f->header->tail_entry_seqnum) {
+                log_debug("Boot index of %s is stale, ignoring.", f->path);
+                return 0;
+        }
+
+        n = le64toh(o->boot_index.n_boots);
+        if (n == 0) {
+                *ret = NULL;
+                *ret_n = 0;
+                return 1;
+        }
+
+        ranges = new(JournalBootRange, n);
+        if (!ranges)
+                return -ENOMEM;
+
+        for (uint64_t i = 0; i < n; i++) {
+                const BootIndexItem *item = o->boot_index.items + i;
+
+                ranges[i] = (JournalBootRange) {
+                        .boot_id = item->boot_id,
+                        .head_seqnum = le64toh(item->head_entry_seqnum),
+                        .tail_seqnum = le64toh(item->tail_entry_seqnum),
+                        .head_realtime = le64toh(item->head_entry_realtime),
+                        .tail_realtime = le64toh(item->tail_entry_realtime),
+                };
+
+                if (ranges[i].head_seqnum > ranges[i].tail_seqnum ||
+                    (i > 0 && ranges[i].head_seqnum <= ranges[i-1].head_seqnum)) {
+                        log_debug("Boot index of %s is corrupted, ignoring.", f->path);
+                        return 0;
+                }
+        }
+
+        *ret = TAKE_PTR(ranges);
+        *ret_n = n;
+        return 1;
+}
+
+static int journal_file_get_boot_range_for_data(JournalFile *f, uint64_t p, JournalBootRange *ret) {
+        char id[SD_ID128_STRING_MAX];
+        JournalBootRange b = {};
+        Object *d, *o;
+        size_t l;
+        void *data;
+        int r;
+
+        assert(f);
+        assert(ret);
+
+        /* Returns 0 if the data object is not a valid _BOOT_ID= field or is not referenced by any entry. */
+
+        r = journal_file_move_to_object(f, OBJECT_DATA, p, &d);
+        if (r < 0)
+                return r;
+
+        r = journal_file_data_payload(f, d, p, NULL, 0, 0, &data, &l);
+        if (IN_SET(r, -EADDRNOTAVAIL, -EBADMSG))
+                return 0;
+        if (r < 0)
+                return r;
+
+        if (l != STRLEN("_BOOT_ID=") + SD_ID128_STRING_MAX - 1 || memcmp(data, "_BOOT_ID=", STRLEN("_BOOT_ID=")) != 0)
+                return 0;
+
+        memcpy(id, (const char*) data + STRLEN("_BOOT_ID="), SD_ID128_STRING_MAX - 1);
+        id[SD_ID128_STRING_MAX - 1] = 0;
+        if (sd_id128_from_string(id, &b.boot_id) < 0)
+                return 0;
+
+        r = journal_file_move_to_entry_for_data(f, d, DIRECTION_DOWN, &o, NULL);
+        if (r <= 0)
+                return r;
+
+        b.head_seqnum = le64toh(o->entry.seqnum);
+        b.head_realtime = le64toh(o->entry.realtime);
+
+        r = journal_file_move_to_object(f, OBJECT_DATA, p, &d);
+        if (r < 0)
+                return r;
+
+        r = journal_file_move_to_entry_for_data(f, d, DIRECTION_UP, &o, NULL);
+        if (r <= 0)
+                return r;
+
+        b.tail_seqnum = le64toh(o->entry.seqnum);
+        b.tail_realtime = le64toh(o->entry.realtime);
+
+        *ret = b;
+        return 1;
+}
+
+int journal_file_get_boot_ranges(JournalFile *f, JournalBootRange **ret, size_t *ret_n) {
+        _cleanup_free_ JournalBootRange *ranges = NULL;
+        size_t n = 0;
+        uint64_t p;
+        Object *o;
+        int r;
+
+        assert(f);
+        assert(f->header);
+        assert(ret);
+        assert(ret_n);
+
+        /* Returns the boots that have entries in the file, ordered by the sequence number of their first
+         * entry. The head and tail of every boot are determined by the _BOOT_ID= field of the entries, which
+         * journald adds to every entry it writes. Returns > 0 if the ranges were read from the boot index of
+         * the file, 0 otherwise. */
+
+        r = journal_file_get_boot_ranges_from_index(f, ret, ret_n);
+        if (r != 0)
+                return r;
+
+        /* No usable index, hence look at the entries of every value of the _BOOT_ID= field. This is still
+         * much cheaper than bisecting through the entries of the file, as there are only few boots. */
+        r = journal_file_find_field_object(f, "_BOOT_ID", STRLEN("_BOOT_ID"), &o, NULL);
+        if (r < 0)
+                return r;
+        if (r == 0) {
+                *ret = NULL;
+                *ret_n = 0;
+                return 0;
+        }
+
+        for (p = le64toh(o->field.head_data_offset); p > 0; ) {
+                JournalBootRange b;
+                uint64_t next;
+
+                r = journal_file_move_to_object(f, OBJECT_DATA, p, &o);
+                if (r < 0)
+                        return r;
+
+                /* New data objects are prepended to the list of their field, hence offsets decrease. */
+                next = le64toh(o->data.next_field_offset);
+                if (next != 0 && next >= p)
+                        return -EBADMSG;
+
+                r = journal_file_get_boot_range_for_data(f, p, &b);
+                if (r < 0)
+                        return r;
+                if (r > 0) {
+                        if (!GREEDY_REALLOC(ranges, n + 1))
+                                return -ENOMEM;
+
+                        ranges[n++] = b;
+                }
+
+                p = next;
+        }
+
+        typesafe_qsort(ranges, n, journal_boot_range_compare);
+
+        *ret = TAKE_PTR(ranges);
+        *ret_n = n;
+        return 0;
+}
+
+static int journal_file_append_boot_index(JournalFile *f) {
+        _cleanup_free_ JournalBootRange *ranges = NULL;
+        uint64_t q, sz;
+        size_t n;
+        Object *o;
+        int r;
+
+        assert(f);
+        assert(f->header);
+
+        if (!boot_index_requested() || !JOURNAL_HEADER_INDEXES(f->header))
+                return 0;
+
+        if (!JOURNAL_HEADER_CONTAINS(f->header, boot_index_offset) || f->header->boot_index_offset != 0)
+                return 0;
+
+        if (le64toh(f->header->n_entries) <= 0)
+                return 0;
+
+        r = journal_file_get_boot_ranges(f, &ranges, &n);
+        if (r < 0)
+                return r;
+
+        /* Compute the ranges before appending the object, as appending might remap the file. */
+        sz = offsetof(Object, boot_index.items) + n * sizeof(BootIndexItem);
+
+        r = journal_file_append_object(f, OBJECT_BOOT_INDEX, sz, &o, &q);
+        if (r < 0)
+                return r;
+
+        o->boot_index.tail_entry_seqnum = f->header->tail_entry_seqnum;
+        o->boot_index.n_boots = htole64(n);
+        for (size_t i = 0; i < n; i++)
+                o->boot_index.items[i] = (BootIndexItem) {
+                        .boot_id = ranges[i].boot_id,
+                        .head_entry_seqnum = htole64(ranges[i].head_seqnum),
+                        .tail_entry_seqnum = htole64(ranges[i].tail_seqnum),
+                        .head_entry_realtime = htole64(ranges[i].head_realtime),
+                        .tail_entry_realtime = htole64(ranges[i].tail_realtime),
+                };
+
+#if HAVE_GCRYPT
+        r = journal_file_hmac_put_object(f, OBJECT_BOOT_INDEX, o, q);
+        if (r < 0)
+                return r;
+#endif
+
+        /* Only publish the index once it is fully written. */
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        f->header->boot_index_offset = htole64(q);
+
+        log_debug("Wrote boot index for %zu boots to %s.", n, f->path);
+        return 0;
+}
+
+static int journal_file_link_field(
+                JournalFile *f,
+                Object *o,
+                uint64_t offset,
+                uint64_t hash) {
+
+        uint64_t p, h, m;
+        int r;
+
+        assert(f);
+        assert(f->header);
+        assert(f->field_hash_table);
+        assert(o);
+        assert(offset > 0);
+
+        if (o->object.type != OBJECT_FIELD)
+                return -EINVAL;
+
+        m = le64toh(READ_NOW(f->header->field_hash_table_size)) / sizeof(HashItem);
+        if (m <= 0)
+                return -EBADMSG;
+
+        /* This might alter the window we are looking at */
+        o->field.next_hash_offset = o->field.head_data_offset = 0;
+
+        h = hash % m;
+        p = le64toh(f->field_hash_table[h].tail_hash_offset);
+        if (p == 0)
+                f->field_hash_table[h].head_hash_offset = htole64(offset);
+        else {
+                r = journal_file_move_to_object(f, OBJECT_FIELD, p, &o);
+                if (r < 0)
+                        return r;
+
+                o->field.next_hash_offset = htole64(offset);
+        }
+
+        f->field_hash_table[h].tail_hash_offset = htole64(offset);
+
+        if (JOURNAL_HEADER_CONTAINS(f->header, n_fields))
+                f->header->n_fields = htole64(le64toh(f->header->n_fields) + 1);
+
+        return 0;
+}
+
+static int journal_file_link_data(
+                JournalFile *f,
+                Object *o,
+                uint64_t offset,
+                uint64_t hash) {
+
+        uint64_t p, h, m;
+        int r;
+
+        assert(f);
+        assert(f->header);
+        assert(f->data_hash_table);
+        assert(o);
+        assert(offset > 0);
+
+        if (o->object.type != OBJECT_DATA)
+                return -EINVAL;
+
+        m = le64toh(READ_NOW(f->header->data_hash_table_size)) / sizeof(HashItem);
+        if (m <= 0)
+                return -EBADMSG;
+
+        /* This might alter the window we are looking at */
+        o->data.next_hash_offset = o->data.next_field_offset = 0;
+        o->data.entry_offset = o->data.entry_array_offset = 0;
+        o->data.n_entries = 0;
+
+        h = hash % m;
+        p = le64toh(f->data_hash_table[h].tail_hash_offset);
+        if (p == 0)
+                /* Only entry in the hash table is easy */
+                f->data_hash_table[h].head_hash_offset = htole64(offset);
+        else {
+                /* Move back to the previous data object, to patch in
+                 * pointer */
+
+                r = journal_file_move_to_object(f, OBJECT_DATA, p, &o);
+                if (r < 0)
+                        return r;
+
+                o->data.next_hash_offset = htole64(offset);
+        }
+
+        f->data_hash_table[h].tail_hash_offset = htole64(offset);
+
+        if (JOURNAL_HEADER_CONTAINS(f->header, n_data))
+                f->header->n_data = htole64(le64toh(f->header->n_data) + 1);
+
+        return 0;
+}
+
+static int get_next_hash_offset(
+                JournalFile *f,
+                uint64_t *p,
+                le64_t *next_hash_offset,
+                uint64_t *depth,
+                le64_t *header_max_depth) {
+
+        uint64_t nextp;
+
+        assert(f);
+        assert(p);
+        assert(next_hash_offset);
+        assert(depth);
+
+        nextp = le64toh(READ_NOW(*next_hash_offset));
+        if (nextp > 0) {
+                if (nextp <= *p) /* Refuse going in loops */
+                        return log_debug_errno(SYNTHETIC_ERRNO(EBADMSG),
+                                               "Detected hash item loop in %s, refusing.", f->path);
+
+                (*depth)++;
+
+                /* If the depth of this hash chain is larger than all others we have seen so far, record it */
+                if (header_max_depth && journal_file_writable(f))
+                        *header_max_depth = htole64(MAX(*depth, le64toh(*header_max_depth)));
+        }
+
+        *p = nextp;
+        return 0;
+}
+
+int journal_file_find_field_object_with_hash(
+                JournalFile *f,
                 const void *field,
                 uint64_t size,
                 uint64_t hash,
@@ -1630,6 +2935,14 @@ int journal_file_find_data_object_with_hash(
         if (le64toh(f->header->data_hash_table_size) <= 0)
                 return 0;
 
+        /* Archived files may carry a bloom filter, which lets us skip them without touching the hash
+         * table at all. If it cannot be read, just fall back to the hash table lookup. */
+        r = journal_file_bloom_filter_test(f, hash);
+        if (r == 0)
+                return 0;
+        if (r < 0)
+                log_debug_errno(r, "Failed to read bloom filter of %s, ignoring: %m", f->path);
+
         /* Map the data hash table, if it isn't mapped yet. */
         r = journal_file_map_data_hash_table(f);
         if (r < 0)
@@ -1798,6 +3111,169 @@ static int journal_file_append_field(
         return 0;
 }
 
+int journal_file_get_zstd_dictionary(JournalFile *f, ZstdDictionary **ret) {
+        uint64_t p;
+        Object *o;
+        int r;
+
+        assert(f);
+        assert(f->header);
+        assert(ret);
+
+        /* Returns > 0 and the dictionary ZSTD compressed DATA objects of this file use, or 0 if they don't
+         * use one. */
+
+        if (f->zstd_dictionary) {
+                *ret = f->zstd_dictionary;
+                return 1;
+        }
+
+        if (!JOURNAL_HEADER_ZSTD_DICTIONARY(f->header))
+                goto none;
+
+        /* The dictionary is added to a new file by journal_file_set_zstd_dictionary() before the first DATA
+         * object is, hence check the header each time until we find it set. */
+        p = le64toh(READ_NOW(f->header->zstd_dictionary_offset));
+        if (p == 0)
+                goto none;
+
+        r = journal_file_move_to_object(f, OBJECT_ZSTD_DICTIONARY, p, &o);
+        if (r < 0)
+                return r;
+
+        r = zstd_dictionary_new(o->zstd_dictionary.payload,
+                                le64toh(o->object.size) - offsetof(Object, zstd_dictionary.payload),
+                                &f->zstd_dictionary);
+        if (r < 0)
+                return r;
+
+        *ret = f->zstd_dictionary;
+        return 1;
+
+none:
+        *ret = NULL;
+        return 0;
+}
+
+int journal_file_set_zstd_dictionary(JournalFile *f, const void *dictionary, size_t size) {
+        _cleanup_(zstd_dictionary_freep) ZstdDictionary *d = NULL;
+        uint64_t p;
+        Object *o;
+        int r;
+
+        assert(f);
+        assert(f->header);
+        assert(dictionary || size == 0);
+
+        if (!journal_file_writable(f))
+                return -EPERM;
+
+        if (size == 0 || size > ZSTD_DICTIONARY_SIZE_MAX)
+                return -EINVAL;
+
+        /* The use of a dictionary has to be announced when the file is created, since the header flags are
+         * covered by the seal, and the dictionary has to be in place before the first DATA object is
+         * compressed. */
+        if (!JOURNAL_HEADER_ZSTD_DICTIONARY(f->header) ||
+            JOURNAL_FILE_COMPRESSION(f) != COMPRESSION_ZSTD)
+                return -EOPNOTSUPP;
+
+        if (f->header->zstd_dictionary_offset != 0 || f->header->n_data != 0)
+                return -EBUSY;
+
+        r = zstd_dictionary_new(dictionary, size, &d);
+        if (r < 0)
+                return r;
+
+        r = journal_file_append_object(f, OBJECT_ZSTD_DICTIONARY, offsetof(Object, zstd_dictionary.payload) + size, &o, &p);
+        if (r < 0)
+                return r;
+
+        memcpy(o->zstd_dictionary.payload, dictionary, size);
+
+#if HAVE_GCRYPT
+        r = journal_file_hmac_put_object(f, OBJECT_ZSTD_DICTIONARY, o, p);
+        if (r < 0)
+                return r;
+#endif
+
+        /* Make sure readers see the complete object before they see the reference to it. */
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        f->header->zstd_dictionary_offset = htole64(p);
+
+        if (f->compress_threshold_bytes == DEFAULT_COMPRESS_THRESHOLD)
+                f->compress_threshold_bytes = DEFAULT_COMPRESS_THRESHOLD_ZSTD_DICTIONARY;
+
+        f->zstd_dictionary = TAKE_PTR(d);
+
+        log_debug("Added %zu byte ZSTD dictionary to %s.", size, f->path);
+        return 0;
+}
+
+int journal_file_train_zstd_dictionary(JournalFile *f, void **ret, size_t *ret_size) {
+        _cleanup_free_ uint8_t *samples = NULL;
+        _cleanup_free_ size_t *sample_sizes = NULL;
+        size_t n_samples = 0, samples_size = 0;
+        uint64_t p, tail;
+        int r;
+
+        assert(f);
+        assert(f->header);
+        assert(ret);
+        assert(ret_size);
+
+        /* Trains a dictionary from the first DATA objects of the file, i.e. usually those of the values that
+         * are logged most often. Returns 0 if there's not enough data to do so. */
+
+        p = le64toh(f->header->header_size);
+        tail = le64toh(READ_NOW(f->header->tail_object_offset));
+
+        while (p > 0 && p <= tail && n_samples < ZSTD_DICTIONARY_SAMPLES_MAX) {
+                uint64_t next;
+                size_t l;
+                void *d;
+                Object *o;
+
+                r = journal_file_move_to_object(f, OBJECT_UNUSED, p, &o);
+                if (r < 0)
+                        return r;
+
+                next = p + ALIGN64(le64toh(o->object.size));
+
+                if (o->object.type == OBJECT_DATA) {
+                        r = journal_file_data_payload(f, o, p, NULL, 0, 0, &d, &l);
+                        if (r < 0)
+                                log_debug_errno(r, "Failed to read data object at %" PRIu64 ", ignoring: %m", p);
+                        else {
+                                if (l > ZSTD_DICTIONARY_SAMPLES_SIZE_MAX - samples_size)
+                                        break;
+
+                                if (!GREEDY_REALLOC(samples, samples_size + l) ||
+                                    !GREEDY_REALLOC(sample_sizes, n_samples + 1))
+                                        return -ENOMEM;
+
+                                memcpy(samples + samples_size, d, l);
+                                samples_size += l;
+                                sample_sizes[n_samples++] = l;
+                        }
+                }
+
+                p = next;
+        }
+
+        if (n_samples == 0)
+                return 0;
+
+        r = zstd_dictionary_train(samples, sample_sizes, n_samples, ZSTD_DICTIONARY_TRAIN_SIZE, ret, ret_size);
+        if (r == -ENODATA)
+                return 0;
+        if (r < 0)
+                return r;
+
+        log_debug("Trained %zu byte ZSTD dictionary from %zu data objects of %s.", *ret_size, n_samples, f->path);
+        return 1;
+}
+
 static int maybe_compress_payload(JournalFile *f, uint8_t *dst, const uint8_t *src, uint64_t size, size_t *rsize) {
         assert(f);
         assert(f->header);
@@ -1810,7 +3286,18 @@ static int maybe_compress_payload(JournalFile *f, uint8_t *dst, const uint8_t *s
         if (c == COMPRESSION_NONE || size < f->compress_threshold_bytes)
                 return 0;
 
-        r = compress_blob(c, src, size, dst, size - 1, rsize);
+        if (c == COMPRESSION_ZSTD) {
+                ZstdDictionary *d;
+
+                r = journal_file_get_zstd_dictionary(f, &d);
+                if (r < 0)
+                        return log_debug_errno(r, "Failed to load ZSTD dictionary, not compressing: %m");
+                if (r > 0)
+                        r = compress_blob_zstd_with_dictionary(src, size, dst, size - 1, rsize, d);
+                else
+                        r = compress_blob(c, src, size, dst, size - 1, rsize);
+        } else
+                r = compress_blob(c, src, size, dst, size - 1, rsize);
         if (r < 0)
                 return log_debug_errno(r, "Failed to compress data object using %s, ignoring: %m", compression_to_string(c));
 
@@ -1860,10 +3347,11 @@ static int journal_file_append_data(
         o->data.hash = htole64(hash);
 
         r = maybe_compress_payload(f, journal_file_data_payload_field(f, o), data, size, &rsize);
-        if (r <= 0)
+        if (r <= 0) {
                 /* We don't really care failures, let's continue without compression */
                 memcpy_safe(journal_file_data_payload_field(f, o), data, size);
-        else {
+                rsize = size;
+        } else {
                 Compression c = JOURNAL_FILE_COMPRESSION(f);
 
                 assert(c >= 0 && c < _COMPRESSION_MAX && c != COMPRESSION_NONE);
@@ -1872,6 +3360,9 @@ static int journal_file_append_data(
                 o->object.flags |= COMPRESSION_TO_OBJECT_FLAG(c);
         }
 
+        f->data_payload_bytes += size;
+        f->data_payload_bytes_stored += rsize;
+
         r = journal_file_link_data(f, o, p, hash);
         if (r < 0)
                 return r;
@@ -1924,12 +3415,23 @@ static int maybe_decompress_payload(
 
         if (compression != COMPRESSION_NONE) {
 #if HAVE_COMPRESSION
+                ZstdDictionary *d = NULL;
                 size_t rsize;
                 int r;
 
+                if (compression == COMPRESSION_ZSTD) {
+                        r = journal_file_get_zstd_dictionary(f, &d);
+                        if (r < 0)
+                                return log_debug_errno(r, "Failed to load ZSTD dictionary: %m");
+                }
+
                 if (field) {
-                        r = decompress_startswith(compression, payload, size, &f->compress_buffer, field,
-                                                  field_length, '=');
+                        if (d)
+                                r = decompress_startswith_zstd_with_dictionary(payload, size, &f->compress_buffer,
+                                                                               field, field_length, '=', d);
+                        else
+                                r = decompress_startswith(compression, payload, size, &f->compress_buffer, field,
+                                                          field_length, '=');
                         if (r < 0)
                                 return log_debug_errno(r,
                                                        "Cannot decompress %s object of length %" PRIu64 ": %m",
@@ -1944,7 +3446,10 @@ static int maybe_decompress_payload(
                         }
                 }
 
-                r = decompress_blob(compression, payload, size, &f->compress_buffer, &rsize, 0);
+                if (d)
+                        r = decompress_blob_zstd_with_dictionary(payload, size, &f->compress_buffer, &rsize, 0, d);
+                else
+                        r = decompress_blob(compression, payload, size, &f->compress_buffer, &rsize, 0);
                 if (r < 0)
                         return r;
 
@@ -2074,7 +3579,8 @@ static int link_entry_into_array(
                 le64_t *idx,
                 le32_t *tail,
                 le32_t *tidx,
-                uint64_t p) {
+                uint64_t p,
+                uint64_t n_reserve) {
 
         uint64_t n = 0, ap = 0, q, i, a, hidx;
         Object *o;
@@ -2117,6 +3623,11 @@ static int link_entry_into_array(
         if (n < 4)
                 n = 4;
 
+        /* If the caller told us that more entries are about to be linked into this chain right away, make
+         * sure they all fit into the new array, instead of growing the chain step by step. */
+        if (n < n_reserve + 1)
+                n = n_reserve + 1;
+
         r = journal_file_append_object(f, OBJECT_ENTRY_ARRAY,
                                        offsetof(Object, entry_array.items) + n * journal_file_entry_array_item_size(f),
                                        &o, &q);
@@ -2161,7 +3672,8 @@ static int link_entry_into_array_plus_one(
                 le64_t *idx,
                 le32_t *tail,
                 le32_t *tidx,
-                uint64_t p) {
+                uint64_t p,
+                uint64_t n_reserve) {
 
         uint64_t hidx;
         int r;
@@ -2181,7 +3693,7 @@ static int link_entry_into_array_plus_one(
                 le64_t i;
 
                 i = htole64(hidx - 1);
-                r = link_entry_into_array(f, first, &i, tail, tidx, p);
+                r = link_entry_into_array(f, first, &i, tail, tidx, p, n_reserve);
                 if (r < 0)
                         return r;
         }
@@ -2190,24 +3702,31 @@ static int link_entry_into_array_plus_one(
         return 0;
 }
 
-static int journal_file_link_entry_item(JournalFile *f, uint64_t offset, uint64_t p) {
+static int journal_file_link_entry_item(JournalFile *f, uint64_t offset, const EntryItem *item) {
+        uint64_t n;
         Object *o;
         int r;
 
         assert(f);
         assert(offset > 0);
+        assert(item);
 
-        r = journal_file_move_to_object(f, OBJECT_DATA, p, &o);
+        r = journal_file_move_to_object(f, OBJECT_DATA, item->object_offset, &o);
         if (r < 0)
                 return r;
 
+        /* The entries that are expected to follow this one, if the caller knows how many there will be */
+        n = le64toh(READ_NOW(o->data.n_entries));
+        n = item->n_entries_expected > n + 1 ? item->n_entries_expected - n - 1 : 0;
+
         return link_entry_into_array_plus_one(f,
                                               &o->data.entry_offset,
                                               &o->data.entry_array_offset,
                                               &o->data.n_entries,
                                               JOURNAL_HEADER_COMPACT(f->header) ? &o->data.compact.tail_entry_array_offset : NULL,
                                               JOURNAL_HEADER_COMPACT(f->header) ? &o->data.compact.tail_entry_array_n_entries : NULL,
-                                              offset);
+                                              offset,
+                                              n);
 }
 
 static int journal_file_link_entry(
@@ -2215,7 +3734,8 @@ static int journal_file_link_entry(
                 Object *o,
                 uint64_t offset,
                 const EntryItem items[],
-                size_t n_items) {
+                size_t n_items,
+                uint64_t n_reserve) {
 
         int r;
 
@@ -2235,7 +3755,8 @@ static int journal_file_link_entry(
                                   &f->header->n_entries,
                                   JOURNAL_HEADER_CONTAINS(f->header, tail_entry_array_offset) ? &f->header->tail_entry_array_offset : NULL,
                                   JOURNAL_HEADER_CONTAINS(f->header, tail_entry_array_n_entries) ? &f->header->tail_entry_array_n_entries : NULL,
-                                  offset);
+                                  offset,
+                                  n_reserve);
         if (r < 0)
                 return r;
 
@@ -2257,7 +3778,7 @@ static int journal_file_link_entry(
                  * immediately but try to link the other entry items since it might still be possible to link
                  * those if they don't require a new entry array to be allocated. */
 
-                k = journal_file_link_entry_item(f, offset, items[i].object_offset);
+                k = journal_file_link_entry_item(f, offset, items + i);
                 if (k == -E2BIG)
                         r = k;
                 else if (k < 0)
@@ -2287,17 +3808,19 @@ static int journal_file_append_entry_internal(
                 const sd_id128_t *boot_id,
                 const sd_id128_t *machine_id,
                 uint64_t xor_hash,
+                unsigned column,
                 const EntryItem items[],
                 size_t n_items,
                 uint64_t *seqnum,
                 sd_id128_t *seqnum_id,
+                uint64_t n_reserve,
                 Object **ret_object,
                 uint64_t *ret_offset) {
 
         uint64_t np;
         uint64_t osize;
         Object *o;
-        int r;
+        int r, k;
 
         assert(f);
         assert(f->header);
@@ -2375,10 +3898,15 @@ static int journal_file_append_entry_internal(
                 return r;
 #endif
 
-        r = journal_file_link_entry(f, o, np, items, n_items);
+        r = journal_file_link_entry(f, o, np, items, n_items, n_reserve);
         if (r < 0)
                 return r;
 
+        /* The histogram is only an optimization for readers, hence don't fail because of it. */
+        k = journal_file_histogram_count(f, ts->realtime, column);
+        if (k < 0)
+                log_debug_errno(k, "Failed to update histogram of %s, ignoring: %m", f->path);
+
         if (ret_object)
                 *ret_object = o;
 
@@ -2501,22 +4029,25 @@ static size_t remove_duplicate_entry_items(EntryItem items[], size_t n) {
         return j;
 }
 
-int journal_file_append_entry(
+static int journal_file_append_entry_full(
                 JournalFile *f,
                 const dual_timestamp *ts,
                 const sd_id128_t *boot_id,
+                const sd_id128_t *machine_id,
                 const struct iovec iovec[],
                 size_t n_iovec,
                 uint64_t *seqnum,
                 sd_id128_t *seqnum_id,
+                uint64_t n_reserve,
                 Object **ret_object,
                 uint64_t *ret_offset) {
 
         _cleanup_free_ EntryItem *items_alloc = NULL;
         EntryItem *items;
         uint64_t xor_hash = 0;
+        unsigned column = HISTOGRAM_N_COLUMNS - 1;
         struct dual_timestamp _ts;
-        sd_id128_t _boot_id, _machine_id, *machine_id;
+        sd_id128_t _boot_id;
         int r;
 
         assert(f);
@@ -2549,15 +4080,6 @@ int journal_file_append_entry(
                 boot_id = &_boot_id;
         }
 
-        r = sd_id128_get_machine(&_machine_id);
-        if (ERRNO_IS_NEG_MACHINE_ID_UNSET(r))
-                /* Gracefully handle the machine ID not being initialized yet */
-                machine_id = NULL;
-        else if (r < 0)
-                return r;
-        else
-                machine_id = &_machine_id;
-
 #if HAVE_GCRYPT
         r = journal_file_maybe_append_tag(f, ts->realtime);
         if (r < 0)
@@ -2600,6 +4122,9 @@ int journal_file_append_entry(
                         .object_offset = p,
                         .hash = le64toh(o->data.hash),
                 };
+
+                if (column == HISTOGRAM_N_COLUMNS - 1)
+                        column = histogram_column(iovec[i].iov_base, iovec[i].iov_len);
         }
 
         /* Order by the position on disk, in order to improve seek
@@ -2607,16 +4132,82 @@ int journal_file_append_entry(
         typesafe_qsort(items, n_iovec, entry_item_cmp);
         n_iovec = remove_duplicate_entry_items(items, n_iovec);
 
-        r = journal_file_append_entry_internal(
+        return journal_file_append_entry_internal(
                         f,
                         ts,
                         boot_id,
                         machine_id,
                         xor_hash,
+                        column,
                         items,
                         n_iovec,
                         seqnum,
                         seqnum_id,
+                        n_reserve,
+                        ret_object,
+                        ret_offset);
+}
+
+static int get_machine_id_for_append(sd_id128_t *ret) {
+        int r;
+
+        assert(ret);
+
+        r = sd_id128_get_machine(ret);
+        if (ERRNO_IS_NEG_MACHINE_ID_UNSET(r))
+                /* Gracefully handle the machine ID not being initialized yet */
+                return 0;
+        if (r < 0)
+                return r;
+
+        return 1;
+}
+
+static void journal_file_finish_append(JournalFile *f) {
+        assert(f);
+
+        if (f->post_change_deferred)
+                return;
+
+        if (f->post_change_timer)
+                schedule_post_change(f);
+        else
+                journal_file_post_change(f);
+}
+
+int journal_file_append_entry(
+                JournalFile *f,
+                const dual_timestamp *ts,
+                const sd_id128_t *boot_id,
+                const struct iovec iovec[],
+                size_t n_iovec,
+                uint64_t *seqnum,
+                sd_id128_t *seqnum_id,
+                Object **ret_object,
+                uint64_t *ret_offset) {
+
+        sd_id128_t machine_id;
+        int r;
+
+        assert(f);
+        assert(f->header);
+        assert(iovec);
+        assert(n_iovec > 0);
+
+        r = get_machine_id_for_append(&machine_id);
+        if (r < 0)
+                return r;
+
+        r = journal_file_append_entry_full(
+                        f,
+                        ts,
+                        boot_id,
+                        r > 0 ? &machine_id : NULL,
+                        iovec,
+                        n_iovec,
+                        seqnum,
+                        seqnum_id,
+                        /* n_reserve= */ 0,
                         ret_object,
                         ret_offset);
 
@@ -2628,14 +4219,74 @@ int journal_file_append_entry(
         if (mmap_cache_fd_got_sigbus(f->cache_fd))
                 r = -EIO;
 
-        if (f->post_change_timer)
-                schedule_post_change(f);
-        else
-                journal_file_post_change(f);
+        journal_file_finish_append(f);
 
         return r;
 }
 
+int journal_file_append_entries(
+                JournalFile *f,
+                const JournalAppendEntry entries[],
+                size_t n_entries,
+                uint64_t *seqnum,
+                sd_id128_t *seqnum_id,
+                size_t *ret_n_appended) {
+
+        sd_id128_t machine_id;
+        bool have_machine_id;
+        size_t n = 0;
+        int r;
+
+        assert(f);
+        assert(f->header);
+        assert(entries || n_entries == 0);
+
+        /* Appends the specified entries in order, stopping at the first one that fails. Unlike calling
+         * journal_file_append_entry() once per entry, the machine ID is only queried once, the global entry
+         * array is grown to fit the whole batch at once, and the change is posted only once at the end.
+         * On failure, returns the error of the entry that failed, and stores the number of entries
+         * appended before it in ret_n_appended, so that the caller may retry from there. */
+
+        if (n_entries == 0) {
+                if (ret_n_appended)
+                        *ret_n_appended = 0;
+                return 0;
+        }
+
+        r = get_machine_id_for_append(&machine_id);
+        if (r < 0)
+                goto finish;
+        have_machine_id = r > 0;
+
+        for (; n < n_entries; n++) {
+                r = journal_file_append_entry_full(
+                                f,
+                                entries[n].ts,
+                                entries[n].boot_id,
+                                have_machine_id ? &machine_id : NULL,
+                                entries[n].iovec,
+                                entries[n].n_iovec,
+                                seqnum,
+                                seqnum_id,
+                                /* n_reserve= */ n_entries - n - 1,
+                                /* ret_object= */ NULL,
+                                /* ret_offset= */ NULL);
+                if (r < 0)
+                        break;
+        }
+
+        if (mmap_cache_fd_got_sigbus(f->cache_fd))
+                r = -EIO;
+
+        journal_file_finish_append(f);
+
+finish:
+        if (ret_n_appended)
+                *ret_n_appended = n;
+
+        return r < 0 ? r : 0;
+}
+
 typedef struct ChainCacheItem {
         uint64_t first; /* The offset of the entry array object at the beginning of the chain,
                          * i.e., le64toh(f->header->entry_array_offset), or le64toh(o->data.entry_offset). */
@@ -3857,7 +5508,7 @@ void journal_file_print_header(JournalFile *f) {
                "Boot ID: %s\n"
                "Sequential number ID: %s\n"
                "State: %s\n"
-               "Compatible flags:%s%s%s%s\n"
+               "Compatible flags:%s%s%s%s%s\n"
                "Incompatible flags:%s%s%s%s%s%s\n"
                "Header size: %"PRIu64"\n"
                "Arena size: %"PRIu64"\n"
@@ -3882,6 +5533,7 @@ void journal_file_print_header(JournalFile *f) {
                JOURNAL_HEADER_SEALED(f->header) ? " SEALED" : "",
                JOURNAL_HEADER_SEALED_CONTINUOUS(f->header) ? " SEALED_CONTINUOUS" : "",
                JOURNAL_HEADER_TAIL_ENTRY_BOOT_ID(f->header) ? " TAIL_ENTRY_BOOT_ID" : "",
+               JOURNAL_HEADER_INDEXES(f->header) ? " INDEXES" : "",
                (le32toh(f->header->compatible_flags) & ~HEADER_COMPATIBLE_ANY) ? " ???" : "",
                JOURNAL_HEADER_COMPRESSED_XZ(f->header) ? " COMPRESSED-XZ" : "",
                JOURNAL_HEADER_COMPRESSED_LZ4(f->header) ? " COMPRESSED-LZ4" : "",
@@ -3929,6 +5581,26 @@ void journal_file_print_header(JournalFile *f) {
                 printf("Deepest data hash chain: %" PRIu64"\n",
                        f->header->data_hash_chain_depth);
 
+        if (JOURNAL_HEADER_CONTAINS(f->header, bloom_filter_offset))
+                printf("Bloom filter: %s\n",
+                       yes_no(f->header->bloom_filter_offset != 0));
+
+        if (JOURNAL_HEADER_CONTAINS(f->header, unique_index_offset))
+                printf("Unique index: %s\n",
+                       yes_no(f->header->unique_index_offset != 0));
+
+        if (JOURNAL_HEADER_CONTAINS(f->header, histogram_offset))
+                printf("Histogram: %s\n",
+                       yes_no(f->header->histogram_offset != 0));
+
+        if (JOURNAL_HEADER_CONTAINS(f->header, boot_index_offset))
+                printf("Boot index: %s\n",
+                       yes_no(f->header->boot_index_offset != 0));
+
+        if (JOURNAL_HEADER_CONTAINS(f->header, zstd_dictionary_offset))
+                printf("ZSTD dictionary: %s\n",
+                       yes_no(f->header->zstd_dictionary_offset != 0));
+
         if (fstat(f->fd, &st) >= 0)
                 printf("Disk usage: %s\n", FORMAT_BYTES((uint64_t) st.st_blocks * 512ULL));
 }
@@ -4096,6 +5768,7 @@ int journal_file_open(
                                             MAX(MIN_COMPRESS_THRESHOLD, compress_threshold_bytes),
                 .strict_order = FLAGS_SET(file_flags, JOURNAL_STRICT_ORDER),
                 .newest_boot_id_prioq_idx = PRIOQ_IDX_NULL,
+                .location_prioq_idx = PRIOQ_IDX_NULL,
                 .last_direction = _DIRECTION_INVALID,
         };
 
@@ -4257,6 +5930,9 @@ int journal_file_open(
                         goto fail;
         }
 
+        if (template)
+                f->post_change_deferred = template->post_change_deferred;
+
         /* The file is opened now successfully, thus we take possession of any passed in fd. */
         f->close_fd = true;
 
@@ -4332,6 +6008,8 @@ int journal_file_parse_uid_from_filename(const char *path, uid_t *ret_uid) {
 
 int journal_file_archive(JournalFile *f, char **ret_previous_path) {
         _cleanup_free_ char *p = NULL;
+        bool renamed = false;
+        int r;
 
         assert(f);
 
@@ -4355,8 +6033,27 @@ int journal_file_archive(JournalFile *f, char **ret_previous_path) {
 
         /* Try to rename the file to the archived version. If the file already was deleted, we'll get ENOENT, let's
          * ignore that case. */
-        if (rename(f->path, p) < 0 && errno != ENOENT)
-                return -errno;
+        if (rename(f->path, p) < 0) {
+                if (errno != ENOENT)
+                        return -errno;
+        } else
+                renamed = true;
+
+        /* No further DATA objects are added once a file is archived, hence this is the time to summarize
+         * them in a bloom filter and indexes for readers. Only do this once the file is sure to be
+         * archived though: if it stayed in use, lookups would miss DATA objects added later, since the
+         * filter doesn't know about them. This is just an optimization, hence failures are not fatal. */
+        r = journal_file_append_bloom_filter(f);
+        if (r < 0)
+                log_debug_errno(r, "Failed to write bloom filter to %s, ignoring: %m", f->path);
+
+        r = journal_file_append_unique_index(f);
+        if (r < 0)
+                log_debug_errno(r, "Failed to write unique index to %s, ignoring: %m", f->path);
+
+        r = journal_file_append_boot_index(f);
+        if (r < 0)
+                log_debug_errno(r, "Failed to write boot index to %s, ignoring: %m", f->path);
 
         /* Sync the rename to disk */
         (void) fsync_directory_of_file(f->fd);
@@ -4366,6 +6063,13 @@ int journal_file_archive(JournalFile *f, char **ret_previous_path) {
 
         free_and_replace(f->path, p);
 
+        /* Let vacuuming know about the file without having to look at it. */
+        if (renamed) {
+                r = journal_manifest_append_file(f);
+                if (r < 0)
+                        log_debug_errno(r, "Failed to add %s to journal manifest, ignoring: %m", f->path);
+        }
+
         /* Set as archive so offlining commits w/state=STATE_ARCHIVED. Previously we would set old_file->header->state
          * to STATE_ARCHIVED directly here, but journal_file_set_offline() short-circuits when state != STATE_ONLINE,
          * which would result in the rotated journal never getting fsync() called before closing.  Now we simply queue
@@ -4401,17 +6105,20 @@ int journal_file_dispose(int dir_fd, const char *fname) {
         return 0;
 }
 
-int journal_file_copy_entry(
+static int journal_file_copy_entry_full(
                 JournalFile *from,
                 JournalFile *to,
                 Object *o,
                 uint64_t p,
                 uint64_t *seqnum,
-                sd_id128_t *seqnum_id) {
+                sd_id128_t *seqnum_id,
+                uint64_t n_reserve,
+                bool copy_all) {
 
         _cleanup_free_ EntryItem *items_alloc = NULL;
         EntryItem *items;
         uint64_t n, m = 0, xor_hash = 0;
+        unsigned column = HISTOGRAM_N_COLUMNS - 1;
         sd_id128_t boot_id;
         dual_timestamp ts;
         int r;
@@ -4445,12 +6152,22 @@ int journal_file_copy_entry(
         }
 
         for (uint64_t i = 0; i < n; i++) {
-                uint64_t h, q;
+                uint64_t h, q, e = 0;
                 void *data;
                 size_t l;
                 Object *u;
 
                 q = journal_file_entry_item_object_offset(from, o, i);
+
+                /* If all entries of the source file are copied, the target's data object will end up being
+                 * referenced by exactly as many entries as the source's, which we can use to size its
+                 * entry array right away. */
+                if (copy_all) {
+                        r = journal_file_move_to_object(from, OBJECT_DATA, q, &u);
+                        if (r >= 0)
+                                e = le64toh(u->data.n_entries);
+                }
+
                 r = journal_file_data_payload(from, NULL, q, NULL, 0, 0, &data, &l);
                 if (IN_SET(r, -EADDRNOTAVAIL, -EBADMSG)) {
                         log_debug_errno(r, "Entry item %"PRIu64" data object is bad, skipping over it: %m", i);
@@ -4472,9 +6189,13 @@ int journal_file_copy_entry(
                 else
                         xor_hash ^= le64toh(u->data.hash);
 
+                if (column == HISTOGRAM_N_COLUMNS - 1)
+                        column = histogram_column(data, l);
+
                 items[m++] = (EntryItem) {
                         .object_offset = h,
                         .hash = le64toh(u->data.hash),
+                        .n_entries_expected = e,
                 };
         }
 
@@ -4487,10 +6208,12 @@ int journal_file_copy_entry(
                         &boot_id,
                         &from->header->machine_id,
                         xor_hash,
+                        column,
                         items,
                         m,
                         seqnum,
                         seqnum_id,
+                        n_reserve,
                         /* ret_object= */ NULL,
                         /* ret_offset= */ NULL);
 
@@ -4500,6 +6223,225 @@ int journal_file_copy_entry(
         return r;
 }
 
+int journal_file_copy_entry(
+                JournalFile *from,
+                JournalFile *to,
+                Object *o,
+                uint64_t p,
+                uint64_t *seqnum,
+                sd_id128_t *seqnum_id) {
+
+        return journal_file_copy_entry_full(from, to, o, p, seqnum, seqnum_id, /* n_reserve= */ 0, /* copy_all= */ false);
+}
+
+int journal_file_copy_entries(
+                JournalFile *to,
+                const JournalCopyEntry entries[],
+                size_t n_entries,
+                uint64_t *seqnum,
+                sd_id128_t *seqnum_id,
+                size_t *ret_n_copied) {
+
+        size_t n = 0;
+        int r = 0;
+
+        assert(to);
+        assert(entries || n_entries == 0);
+
+        /* Like journal_file_copy_entry(), but for a batch of entries, possibly from different files. The
+         * global entry array of the target file is grown to fit the whole batch at once. Stops at the first
+         * entry that fails to be copied, and stores the number of entries copied before it in
+         * ret_n_copied. Like journal_file_copy_entry(), this does not post the change, the caller has to
+         * call journal_file_post_change() when done. */
+
+        for (; n < n_entries; n++) {
+                Object *o;
+
+                assert(entries[n].file);
+                assert(entries[n].offset > 0);
+
+                r = journal_file_move_to_object(entries[n].file, OBJECT_ENTRY, entries[n].offset, &o);
+                if (r < 0)
+                        break;
+
+                r = journal_file_copy_entry_full(
+                                entries[n].file,
+                                to,
+                                o,
+                                entries[n].offset,
+                                seqnum,
+                                seqnum_id,
+                                /* n_reserve= */ n_entries - n - 1,
+                                /* copy_all= */ false);
+                if (r < 0)
+                        break;
+        }
+
+        if (ret_n_copied)
+                *ret_n_copied = n;
+
+        return r < 0 ? r : 0;
+}
+
+static int journal_file_copy_data_by_field(JournalFile *from, JournalFile *to) {
+        uint64_t n;
+        int r;
+
+        assert(from);
+        assert(to);
+
+        /* Appends all DATA objects of the source file that are referenced by any entries, grouped by field,
+         * so that the values of a field end up next to each other in the target file. */
+
+        r = journal_file_map_field_hash_table(from);
+        if (r < 0)
+                return r;
+
+        n = le64toh(READ_NOW(from->header->field_hash_table_size)) / sizeof(HashItem);
+        for (uint64_t i = 0; i < n; i++) {
+                uint64_t p;
+
+                p = le64toh(from->field_hash_table[i].head_hash_offset);
+                while (p > 0) {
+                        uint64_t next, q;
+                        Object *o;
+
+                        r = journal_file_move_to_object(from, OBJECT_FIELD, p, &o);
+                        if (r < 0)
+                                return r;
+
+                        next = le64toh(o->field.next_hash_offset);
+                        q = le64toh(o->field.head_data_offset);
+
+                        while (q > 0) {
+                                uint64_t next_data;
+                                size_t l;
+                                void *d;
+
+                                r = journal_file_move_to_object(from, OBJECT_DATA, q, &o);
+                                if (r < 0)
+                                        return r;
+
+                                next_data = le64toh(o->data.next_field_offset);
+
+                                if (o->data.n_entries != 0) {
+                                        r = journal_file_data_payload(from, o, q, NULL, 0, 0, &d, &l);
+                                        if (IN_SET(r, -EADDRNOTAVAIL, -EBADMSG))
+                                                log_debug_errno(r, "Data object at %"PRIu64" is bad, skipping over it: %m", q);
+                                        else if (r < 0)
+                                                return r;
+                                        else if (l > 0) {
+                                                r = journal_file_append_data(to, d, l, NULL, NULL);
+                                                if (r < 0)
+                                                        return r;
+                                        }
+                                }
+
+                                q = next_data;
+                        }
+
+                        p = next;
+                }
+        }
+
+        return 0;
+}
+
+int journal_file_copy_compacted(JournalFile *from, JournalFile *to) {
+        uint64_t p = 0, n, i = 0;
+        sd_id128_t seqnum_id;
+        Object *o;
+        int r;
+
+        assert(from);
+        assert(from->header);
+        assert(to);
+        assert(to->header);
+
+        /* Copies all entries of 'from' into the empty file 'to', laid out for reading rather than in the
+         * order they were written in: DATA objects are grouped by field, and all entry arrays are allocated
+         * to their final size right away, so that each of them ends up as a single contiguous array.
+         * Sequence numbers, the sequence number ID and the machine ID of the source file are kept. */
+
+        if (!journal_file_writable(to))
+                return -EPERM;
+
+        if (le64toh(to->header->n_entries) != 0 || le64toh(to->header->n_data) != 0)
+                return -EBUSY;
+
+        to->header->machine_id = from->header->machine_id;
+        seqnum_id = from->header->seqnum_id;
+
+#if HAVE_ZSTD
+        if (JOURNAL_HEADER_ZSTD_DICTIONARY(to->header)) {
+                _cleanup_free_ void *dictionary = NULL;
+                size_t size;
+
+                r = journal_file_train_zstd_dictionary(from, &dictionary, &size);
+                if (r < 0)
+                        return r;
+                if (r > 0) {
+                        r = journal_file_set_zstd_dictionary(to, dictionary, size);
+                        if (r < 0)
+                                return r;
+                }
+        }
+#endif
+
+        r = journal_file_copy_data_by_field(from, to);
+        if (r < 0)
+                return r;
+
+        n = le64toh(from->header->n_entries);
+
+        for (;;) {
+                uint64_t seqnum;
+
+                r = journal_file_next_entry(from, p, DIRECTION_DOWN, &o, &p);
+                if (r < 0)
+                        return r;
+                if (r == 0)
+                        break;
+
+                /* Make sure the entry gets the same sequence number it has in the source file */
+                seqnum = le64toh(o->entry.seqnum) - 1;
+
+                r = journal_file_copy_entry_full(
+                                from,
+                                to,
+                                o,
+                                p,
+                                &seqnum,
+                                &seqnum_id,
+                                /* n_reserve= */ n > i + 1 ? n - i - 1 : 0,
+                                /* copy_all= */ true);
+                if (r < 0)
+                        return r;
+
+                i++;
+        }
+
+        /* The file is not going to be written to anymore, hence summarize its DATA objects. This is just an
+         * optimization, hence failures are not fatal. */
+        r = journal_file_append_bloom_filter(to);
+        if (r < 0)
+                log_debug_errno(r, "Failed to write bloom filter to %s, ignoring: %m", to->path);
+
+        r = journal_file_append_unique_index(to);
+        if (r < 0)
+                log_debug_errno(r, "Failed to write unique index to %s, ignoring: %m", to->path);
+
+        r = journal_file_append_boot_index(to);
+        if (r < 0)
+                log_debug_errno(r, "Failed to write boot index to %s, ignoring: %m", to->path);
+
+        if (mmap_cache_fd_got_sigbus(to->cache_fd))
+                return -EIO;
+
+        log_debug("Copied %"PRIu64" entries from %s to %s.", i, from->path, to->path);
+        return 0;
+}
+
 void journal_reset_metrics(JournalMetrics *m) {
         assert(m);
 
@@ -4678,6 +6620,11 @@ static const char * const journal_object_type_table[] = {
         [OBJECT_FIELD_HASH_TABLE] = "field hash table",
         [OBJECT_ENTRY_ARRAY]      = "entry array",
         [OBJECT_TAG]              = "tag",
+        [OBJECT_BLOOM_FILTER]     = "bloom filter",
+        [OBJECT_ZSTD_DICTIONARY]  = "zstd dictionary",
+        [OBJECT_UNIQUE_INDEX]     = "unique index",
+        [OBJECT_HISTOGRAM]        = "histogram",
+        [OBJECT_BOOT_INDEX]       = "boot index",
 };
 
 DEFINE_STRING_TABLE_LOOKUP_TO_STRING(journal_object_type, ObjectType);
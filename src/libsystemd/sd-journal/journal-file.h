@@ -11,6 +11,7 @@
 
 #include "sd-event.h"
 #include "sd-id128.h"
+#include "sd-journal.h"
 
 #include "compress.h"
 #include "hashmap.h"
@@ -69,6 +70,7 @@ typedef struct JournalFile {
         bool close_fd:1;
         bool archive:1;
         bool strict_order:1;
+        bool unique_index_invalid:1;
 
         direction_t last_direction;
         LocationType location_type;
@@ -81,6 +83,9 @@ typedef struct JournalFile {
         Header *header;
         HashItem *data_hash_table;
         HashItem *field_hash_table;
+        BloomFilterObject *bloom_filter;
+        UniqueIndexObject *unique_index;
+        uint64_t histogram_last_offset;
 
         uint64_t current_offset;
         uint64_t current_seqnum;
@@ -93,6 +98,8 @@ typedef struct JournalFile {
 
         sd_event_source *post_change_timer;
         usec_t post_change_timer_period;
+        /* If set, appends do not post the change, the caller calls journal_file_post_change() itself. */
+        bool post_change_deferred;
 
         OrderedHashmap *chain_cache;
 
@@ -102,9 +109,14 @@ typedef struct JournalFile {
         unsigned last_seen_generation;
 
         uint64_t compress_threshold_bytes;
+        /* The size of the payload of the data objects added since the file was opened, and how much of
+         * that was actually stored, i.e. after compression */
+        uint64_t data_payload_bytes;
+        uint64_t data_payload_bytes_stored;
 #if HAVE_COMPRESSION
         void *compress_buffer;
 #endif
+        ZstdDictionary *zstd_dictionary;
 
 #if HAVE_GCRYPT
         gcry_md_hd_t hmac;
@@ -131,18 +143,32 @@ typedef struct JournalFile {
         unsigned newest_boot_id_prioq_idx;
         uint64_t newest_entry_offset;
         uint8_t newest_state;
+
+        /* When we insert this file into the 'files_by_location' priority queue in sd_journal, then by its
+         * current location. The queue's compare function needs to know about the sd_journal object. */
+        sd_journal *location_journal;
+        unsigned location_prioq_idx;
+
+        /* The tail of the file as of when sd_journal last looked at its header, to tell cheaply whether
+         * entries were added since */
+        uint64_t tail_n_entries;
+        uint64_t tail_seqnum;
+        uint8_t tail_state;
 } JournalFile;
 
 typedef enum JournalFileFlags {
         JOURNAL_COMPRESS        = 1 << 0,
         JOURNAL_SEAL            = 1 << 1,
         JOURNAL_STRICT_ORDER    = 1 << 2,
-        _JOURNAL_FILE_FLAGS_MAX = JOURNAL_COMPRESS|JOURNAL_SEAL|JOURNAL_STRICT_ORDER,
+        JOURNAL_ZSTD_DICTIONARY = 1 << 3, /* allow a ZSTD dictionary to be set for newly created files */
+        _JOURNAL_FILE_FLAGS_MAX = JOURNAL_COMPRESS|JOURNAL_SEAL|JOURNAL_STRICT_ORDER|JOURNAL_ZSTD_DICTIONARY,
 } JournalFileFlags;
 
 typedef struct {
         uint64_t object_offset;
         uint64_t hash;
+        uint64_t n_entries_expected; /* If known, the number of entries that will reference the object
+                                      * eventually. Only used to size its entry array, 0 if unknown. */
 } EntryItem;
 
 int journal_file_open(
@@ -196,6 +222,9 @@ static inline bool VALID_EPOCH(uint64_t u) {
 #define JOURNAL_HEADER_TAIL_ENTRY_BOOT_ID(h) \
         FLAGS_SET(le32toh((h)->compatible_flags), HEADER_COMPATIBLE_TAIL_ENTRY_BOOT_ID)
 
+#define JOURNAL_HEADER_INDEXES(h) \
+        FLAGS_SET(le32toh((h)->compatible_flags), HEADER_COMPATIBLE_INDEXES)
+
 #define JOURNAL_HEADER_COMPRESSED_XZ(h) \
         FLAGS_SET(le32toh((h)->incompatible_flags), HEADER_INCOMPATIBLE_COMPRESSED_XZ)
 
@@ -211,6 +240,9 @@ static inline bool VALID_EPOCH(uint64_t u) {
 #define JOURNAL_HEADER_COMPACT(h) \
         FLAGS_SET(le32toh((h)->incompatible_flags), HEADER_INCOMPATIBLE_COMPACT)
 
+#define JOURNAL_HEADER_ZSTD_DICTIONARY(h) \
+        FLAGS_SET(le32toh((h)->incompatible_flags), HEADER_INCOMPATIBLE_ZSTD_DICTIONARY)
+
 int journal_file_move_to_object(JournalFile *f, ObjectType type, uint64_t offset, Object **ret);
 int journal_file_pin_object(JournalFile *f, Object *o);
 int journal_file_read_object_header(JournalFile *f, ObjectType type, uint64_t offset, Object *ret);
@@ -281,6 +313,21 @@ int journal_file_append_entry(
                 Object **ret_object,
                 uint64_t *ret_offset);
 
+typedef struct JournalAppendEntry {
+        const dual_timestamp *ts;       /* NULL → now */
+        const sd_id128_t *boot_id;      /* NULL → current boot */
+        const struct iovec *iovec;
+        size_t n_iovec;
+} JournalAppendEntry;
+
+int journal_file_append_entries(
+                JournalFile *f,
+                const JournalAppendEntry entries[],
+                size_t n_entries,
+                uint64_t *seqnum,
+                sd_id128_t *seqnum_id,
+                size_t *ret_n_appended);
+
 int journal_file_find_data_object(JournalFile *f, const void *data, uint64_t size, Object **ret_object, uint64_t *ret_offset);
 int journal_file_find_data_object_with_hash(JournalFile *f, const void *data, uint64_t size, uint64_t hash, Object **ret_object, uint64_t *ret_offset);
 
@@ -305,6 +352,20 @@ int journal_file_move_to_entry_by_monotonic_for_data(JournalFile *f, Object *d,
 
 int journal_file_copy_entry(JournalFile *from, JournalFile *to, Object *o, uint64_t p, uint64_t *seqnum, sd_id128_t *seqnum_id);
 
+typedef struct JournalCopyEntry {
+        JournalFile *file;
+        uint64_t offset;
+} JournalCopyEntry;
+
+int journal_file_copy_entries(
+                JournalFile *to,
+                const JournalCopyEntry entries[],
+                size_t n_entries,
+                uint64_t *seqnum,
+                sd_id128_t *seqnum_id,
+                size_t *ret_n_copied);
+int journal_file_copy_compacted(JournalFile *from, JournalFile *to);
+
 void journal_file_dump(JournalFile *f);
 void journal_file_print_header(JournalFile *f);
 
@@ -326,6 +387,35 @@ bool journal_file_rotate_suggested(JournalFile *f, usec_t max_file_usec, int log
 int journal_file_map_data_hash_table(JournalFile *f);
 int journal_file_map_field_hash_table(JournalFile *f);
 
+int journal_file_bloom_filter_test(JournalFile *f, uint64_t hash);
+
+typedef struct JournalUniqueValues {
+        const UniqueIndexObject *object;
+        const le32_t *offsets;  /* n_values + 2 entries, the first one refers to the field name */
+        uint64_t n_values;
+} JournalUniqueValues;
+
+int journal_unique_index_validate(const UniqueIndexObject *u);
+int journal_file_get_unique_values(JournalFile *f, const char *field, size_t size, JournalUniqueValues *ret);
+void journal_unique_values_get(const JournalUniqueValues *v, uint64_t i, const void **ret_data, size_t *ret_size);
+bool journal_unique_values_contains(const JournalUniqueValues *v, const void *data, size_t size);
+
+int journal_file_get_histogram(JournalFile *f, usec_t since, usec_t until, usec_t bucket_usec, uint64_t *counts, size_t n_buckets);
+
+typedef struct JournalBootRange {
+        sd_id128_t boot_id;
+        uint64_t head_seqnum;
+        uint64_t tail_seqnum;
+        uint64_t head_realtime;
+        uint64_t tail_realtime;
+} JournalBootRange;
+
+int journal_file_get_boot_ranges(JournalFile *f, JournalBootRange **ret, size_t *ret_n);
+
+int journal_file_get_zstd_dictionary(JournalFile *f, ZstdDictionary **ret);
+int journal_file_set_zstd_dictionary(JournalFile *f, const void *dictionary, size_t size);
+int journal_file_train_zstd_dictionary(JournalFile *f, void **ret, size_t *ret_size);
+
 static inline Compression JOURNAL_FILE_COMPRESSION(JournalFile *f) {
         assert(f);
 
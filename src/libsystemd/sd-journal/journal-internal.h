@@ -9,6 +9,7 @@
 #include "sd-journal.h"
 
 #include "hashmap.h"
+#include "journal-data-cache.h"
 #include "journal-def.h"
 #include "journal-file.h"
 #include "list.h"
@@ -19,11 +20,13 @@
 #define JOURNAL_LOG_RATELIMIT ((const RateLimit) { .interval = 60 * USEC_PER_SEC, .burst = 3 })
 
 typedef struct Match Match;
+typedef struct MatchSetFile MatchSetFile;
 typedef struct Location Location;
 typedef struct Directory Directory;
 
 typedef enum MatchType {
         MATCH_DISCRETE,
+        MATCH_SET,
         MATCH_OR_TERM,
         MATCH_AND_TERM
 } MatchType;
@@ -38,6 +41,11 @@ struct Match {
         size_t size;
         uint64_t hash; /* old-style jenkins hash. New-style siphash is different per file, hence won't be cached here */
 
+        /* For set matches: data is the "FIELD=" prefix, values are the sorted "FIELD=value" strings, and
+         * set_files maps each JournalFile to the data objects of the values it contains */
+        char **values;
+        Hashmap *set_files;
+
         /* For terms */
         LIST_HEAD(Match, matches);
 };
@@ -94,7 +102,17 @@ struct sd_journal {
         JournalFile *current_file;
         uint64_t current_field;
 
+        /* Files with a candidate entry for the current iteration direction, ordered by that entry, and files
+         * that hit EOF but might still grow. Only valid while files_by_location_valid is set, i.e. until
+         * the location is reset or the set of files changes. */
+        Prioq *files_by_location;
+        Set *files_at_eof;
+        direction_t files_by_location_direction;
+        bool files_by_location_valid;
+
         Match *level0, *level1, *level2;
+
+        JournalDataCache *data_cache; /* decompressed DATA payloads, NULL if disabled */
         Set *exclude_syslog_identifiers;
 
         uint64_t origin_id;
@@ -108,6 +126,8 @@ struct sd_journal {
         char *unique_field;
         JournalFile *unique_file;
         uint64_t unique_offset;
+        JournalUniqueValues unique_values; /* set if unique_file has a unique index covering unique_field */
+        uint64_t unique_values_index;
 
         /* Iterating through known fields */
         JournalFile *fields_file;
@@ -137,6 +157,7 @@ struct sd_journal {
 };
 
 char* journal_make_match_string(sd_journal *j);
+int journal_copy_matches(sd_journal *j, sd_journal *source);
 void journal_print_header(sd_journal *j);
 int journal_get_directories(sd_journal *j, char ***ret);
 
@@ -0,0 +1,342 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "alloc-util.h"
+#include "fd-util.h"
+#include "fileio.h"
+#include "hash-funcs.h"
+#include "io-util.h"
+#include "journal-file.h"
+#include "journal-manifest.h"
+#include "log.h"
+#include "parse-util.h"
+#include "path-util.h"
+#include "stdio-util.h"
+#include "string-util.h"
+#include "strv.h"
+#include "tmpfile-util.h"
+
+/* The manifest is a text file with one line per archived journal file:
+ *
+ *     FILENAME INODE SEQNUM_ID HEAD_SEQNUM TAIL_SEQNUM HEAD_REALTIME TAIL_REALTIME N_ENTRIES USAGE
+ *
+ * USAGE is "-" if not known yet. New lines are appended when files are archived, and the whole file is
+ * rewritten when vacuuming. If the same file name shows up more than once, the last line wins. */
+
+#define JOURNAL_MANIFEST_LINE_MAX (4U * 1024U)
+
+JournalManifestEntry* journal_manifest_entry_free(JournalManifestEntry *e) {
+        if (!e)
+                return NULL;
+
+        free(e->filename);
+        return mfree(e);
+}
+
+DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(
+                manifest_entry_hash_ops,
+                char,
+                string_hash_func,
+                string_compare_func,
+                JournalManifestEntry,
+                journal_manifest_entry_free);
+
+JournalManifest* journal_manifest_free(JournalManifest *m) {
+        if (!m)
+                return NULL;
+
+        hashmap_free(m->entries);
+        return mfree(m);
+}
+
+static int manifest_entry_to_string(const JournalManifestEntry *e, char **ret) {
+        char usage[DECIMAL_STR_MAX(uint64_t)] = "-";
+
+        assert(e);
+        assert(e->filename);
+        assert(ret);
+
+        if (e->usage != UINT64_MAX)
+                xsprintf(usage, "%" PRIu64, e->usage);
+
+        if (asprintf(ret, "%s %" PRIu64 " " SD_ID128_FORMAT_STR " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %s\n",
+                     e->filename,
+                     (uint64_t) e->inode,
+                     SD_ID128_FORMAT_VAL(e->seqnum_id),
+                     e->head_seqnum,
+                     e->tail_seqnum,
+                     e->head_realtime,
+                     e->tail_realtime,
+                     e->n_entries,
+                     usage) < 0)
+                return -ENOMEM;
+
+        return 0;
+}
+
+static int manifest_entry_from_string(const char *line, JournalManifestEntry **ret) {
+        _cleanup_(journal_manifest_entry_freep) JournalManifestEntry *e = NULL;
+        _cleanup_strv_free_ char **words = NULL;
+        uint64_t inode;
+        int r;
+
+        assert(line);
+        assert(ret);
+
+        r = strv_split_full(&words, line, WHITESPACE, 0);
+        if (r < 0)
+                return r;
+        if (r != 9)
+                return -EBADMSG;
+
+        if (!filename_is_valid(words[0]))
+                return -EBADMSG;
+
+        e = new(JournalManifestEntry, 1);
+        if (!e)
+                return -ENOMEM;
+
+        *e = (JournalManifestEntry) {
+                .filename = TAKE_PTR(words[0]),
+                .usage = UINT64_MAX,
+        };
+
+        r = safe_atou64(words[1], &inode);
+        if (r < 0)
+                return r;
+        e->inode = (ino_t) inode;
+
+        r = sd_id128_from_string(words[2], &e->seqnum_id);
+        if (r < 0)
+                return r;
+
+        r = safe_atou64(words[3], &e->head_seqnum);
+        if (r < 0)
+                return r;
+
+        r = safe_atou64(words[4], &e->tail_seqnum);
+        if (r < 0)
+                return r;
+
+        r = safe_atou64(words[5], &e->head_realtime);
+        if (r < 0)
+                return r;
+
+        r = safe_atou64(words[6], &e->tail_realtime);
+        if (r < 0)
+                return r;
+
+        r = safe_atou64(words[7], &e->n_entries);
+        if (r < 0)
+                return r;
+
+        if (!streq(words[8], "-")) {
+                r = safe_atou64(words[8], &e->usage);
+                if (r < 0)
+                        return r;
+        }
+
+        *ret = TAKE_PTR(e);
+        return 0;
+}
+
+int journal_manifest_load(int dir_fd, JournalManifest **ret) {
+        _cleanup_(journal_manifest_freep) JournalManifest *m = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        unsigned n_lines = 0;
+        int r;
+
+        assert(dir_fd >= 0 || dir_fd == AT_FDCWD);
+        assert(ret);
+
+        m = new0(JournalManifest, 1);
+        if (!m)
+                return -ENOMEM;
+
+        r = fopen_unlocked_at(dir_fd, JOURNAL_MANIFEST_FILENAME, "re", O_NOFOLLOW, &f);
+        if (r == -ENOENT) {
+                *ret = TAKE_PTR(m);
+                return 0;
+        }
+        if (r < 0)
+                return r;
+
+        for (;;) {
+                _cleanup_(journal_manifest_entry_freep) JournalManifestEntry *e = NULL;
+                _cleanup_free_ char *l = NULL;
+
+                r = read_line(f, JOURNAL_MANIFEST_LINE_MAX, &l);
+                if (r < 0)
+                        return r;
+                if (r == 0)
+                        break;
+
+                n_lines++;
+
+                r = manifest_entry_from_string(l, &e);
+                if (r == -ENOMEM)
+                        return r;
+                if (r < 0) {
+                        /* Most likely a torn write. The file will simply be looked at again. */
+                        log_debug_errno(r, "Ignoring invalid line %u of journal manifest: %m", n_lines);
+                        continue;
+                }
+
+                r = journal_manifest_put(m, TAKE_PTR(e));
+                if (r < 0)
+                        return r;
+        }
+
+        /* Rewrite the file when saved if it contains invalid lines or duplicates. */
+        m->dirty = n_lines != hashmap_size(m->entries);
+
+        *ret = TAKE_PTR(m);
+        return 0;
+}
+
+int journal_manifest_save(JournalManifest *m, int dir_fd) {
+        _cleanup_free_ char *t = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        JournalManifestEntry *e;
+        int r;
+
+        assert(m);
+        assert(dir_fd >= 0 || dir_fd == AT_FDCWD);
+
+        if (!m->dirty)
+                return 0;
+
+        r = fopen_temporary_at(dir_fd, JOURNAL_MANIFEST_FILENAME, &f, &t);
+        if (r < 0)
+                return r;
+
+        (void) fchmod(fileno(f), 0640);
+
+        HASHMAP_FOREACH(e, m->entries) {
+                _cleanup_free_ char *l = NULL;
+
+                r = manifest_entry_to_string(e, &l);
+                if (r < 0)
+                        goto fail;
+
+                fputs(l, f);
+        }
+
+        r = fflush_and_check(f);
+        if (r < 0)
+                goto fail;
+
+        if (renameat(dir_fd, t, dir_fd, JOURNAL_MANIFEST_FILENAME) < 0) {
+                r = -errno;
+                goto fail;
+        }
+
+        m->dirty = false;
+        return 0;
+
+fail:
+        (void) unlinkat(dir_fd, t, 0);
+        return r;
+}
+
+JournalManifestEntry* journal_manifest_get(JournalManifest *m, const char *filename, ino_t inode) {
+        JournalManifestEntry *e;
+
+        assert(m);
+        assert(filename);
+
+        /* If the inode changed, this is a different file that happens to have the same name. */
+        e = hashmap_get(m->entries, filename);
+        if (!e || e->inode != inode)
+                return NULL;
+
+        return e;
+}
+
+int journal_manifest_put(JournalManifest *m, JournalManifestEntry *e) {
+        JournalManifestEntry *old;
+        int r;
+
+        assert(m);
+        assert(e);
+        assert(e->filename);
+
+        /* Takes ownership of the entry, also on failure. */
+
+        old = hashmap_remove(m->entries, e->filename);
+        journal_manifest_entry_free(old);
+
+        r = hashmap_ensure_put(&m->entries, &manifest_entry_hash_ops, e->filename, e);
+        if (r < 0) {
+                journal_manifest_entry_free(e);
+                return r;
+        }
+
+        m->dirty = true;
+        return 0;
+}
+
+void journal_manifest_remove(JournalManifest *m, const char *filename) {
+        JournalManifestEntry *e;
+
+        assert(m);
+        assert(filename);
+
+        e = hashmap_remove(m->entries, filename);
+        if (!e)
+                return;
+
+        journal_manifest_entry_free(e);
+        m->dirty = true;
+}
+
+int journal_manifest_append_file(JournalFile *f) {
+        _cleanup_free_ char *dir = NULL, *fn = NULL, *p = NULL, *l = NULL;
+        _cleanup_close_ int fd = -EBADF;
+        int r;
+
+        assert(f);
+        assert(f->header);
+
+        /* Called when a file is archived, i.e. after it got its final name. Appending a single line is
+         * cheap, and the file is only rewritten by the next vacuuming pass. If some other process rewrites
+         * the manifest concurrently the line might get lost, which is fine, as the manifest is only a
+         * cache. */
+
+        r = path_extract_directory(f->path, &dir);
+        if (r < 0 && r != -EDESTADDRREQ)
+                return r;
+
+        r = path_extract_filename(f->path, &fn);
+        if (r < 0)
+                return r;
+
+        r = manifest_entry_to_string(
+                        &(JournalManifestEntry) {
+                                .filename = fn,
+                                .inode = f->last_stat.st_ino,
+                                .seqnum_id = f->header->seqnum_id,
+                                .head_seqnum = le64toh(f->header->head_entry_seqnum),
+                                .tail_seqnum = le64toh(f->header->tail_entry_seqnum),
+                                .head_realtime = le64toh(f->header->head_entry_realtime),
+                                .tail_realtime = le64toh(f->header->tail_entry_realtime),
+                                .n_entries = le64toh(f->header->n_entries),
+                                .usage = UINT64_MAX,
+                        },
+                        &l);
+        if (r < 0)
+                return r;
+
+        p = path_join(dir ?: ".", JOURNAL_MANIFEST_FILENAME);
+        if (!p)
+                return -ENOMEM;
+
+        fd = open(p, O_WRONLY|O_APPEND|O_CREAT|O_CLOEXEC|O_NOFOLLOW|O_NOCTTY, 0640);
+        if (fd < 0)
+                return -errno;
+
+        return loop_write(fd, l, SIZE_MAX);
+}
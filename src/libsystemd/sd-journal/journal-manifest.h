@@ -0,0 +1,57 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+#pragma once
+
+#include <inttypes.h>
+#include <sys/types.h>
+
+#include "sd-id128.h"
+
+#include "hashmap.h"
+#include "macro.h"
+#include "time-util.h"
+
+/* A per-directory cache of the header fields of archived journal files, so that vacuuming and disk usage
+ * calculation don't have to stat(), open() and parse every single file of the directory each time. Archived
+ * files are not modified anymore, hence an entry stays valid as long as a file with the same name and inode
+ * exists. The manifest is only a cache: files missing from it are looked at the traditional way, and entries
+ * of files that are gone are dropped. */
+
+#define JOURNAL_MANIFEST_FILENAME ".journal-manifest"
+
+typedef struct JournalFile JournalFile;
+
+typedef struct JournalManifestEntry {
+        char *filename;
+        ino_t inode;
+
+        sd_id128_t seqnum_id;
+        uint64_t head_seqnum;
+        uint64_t tail_seqnum;
+        usec_t head_realtime;   /* vacuuming lowers this to the oldest timestamp of the file, see patch_realtime() */
+        usec_t tail_realtime;
+        uint64_t n_entries;
+
+        /* Files may still shrink when their holes are punched after archiving, hence the disk usage is only
+         * filled in when somebody looks at the file later. UINT64_MAX if not known yet. */
+        uint64_t usage;
+} JournalManifestEntry;
+
+typedef struct JournalManifest {
+        Hashmap *entries; /* filename → JournalManifestEntry */
+        bool dirty;
+} JournalManifest;
+
+JournalManifestEntry* journal_manifest_entry_free(JournalManifestEntry *e);
+DEFINE_TRIVIAL_CLEANUP_FUNC(JournalManifestEntry*, journal_manifest_entry_free);
+
+JournalManifest* journal_manifest_free(JournalManifest *m);
+DEFINE_TRIVIAL_CLEANUP_FUNC(JournalManifest*, journal_manifest_free);
+
+int journal_manifest_load(int dir_fd, JournalManifest **ret);
+int journal_manifest_save(JournalManifest *m, int dir_fd);
+
+JournalManifestEntry* journal_manifest_get(JournalManifest *m, const char *filename, ino_t inode);
+int journal_manifest_put(JournalManifest *m, JournalManifestEntry *e);
+void journal_manifest_remove(JournalManifest *m, const char *filename);
+
+int journal_manifest_append_file(JournalFile *f);
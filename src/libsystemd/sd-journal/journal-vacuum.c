@@ -1,6 +1,8 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
 #include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -14,9 +16,13 @@
 #include "journal-def.h"
 #include "journal-file.h"
 #include "journal-internal.h"
+#include "journal-manifest.h"
 #include "journal-vacuum.h"
+#include "path-util.h"
+#include "set.h"
 #include "sort-util.h"
 #include "string-util.h"
+#include "strv.h"
 #include "time-util.h"
 #include "xattr-util.h"
 
@@ -29,6 +35,8 @@ typedef struct vacuum_info {
         sd_id128_t seqnum_id;
         uint64_t seqnum;
         bool have_seqnum;
+
+        bool empty;
 } vacuum_info;
 
 static int vacuum_info_compare(const vacuum_info *a, const vacuum_info *b) {
@@ -94,12 +102,13 @@ static void patch_realtime(
                 *realtime = x;
 }
 
-static int journal_file_empty(int dir_fd, const char *name) {
+static int journal_file_read_header(int dir_fd, const char *name, Header *ret) {
         _cleanup_close_ int fd = -EBADF;
         struct stat st;
-        le64_t n_entries;
         ssize_t n;
 
+        assert(ret);
+
         fd = openat(dir_fd, name, O_RDONLY|O_CLOEXEC|O_NOFOLLOW|O_NONBLOCK|O_NOATIME);
         if (fd < 0) {
                 /* Maybe failed due to O_NOATIME and lack of privileges? */
@@ -112,35 +121,394 @@ static int journal_file_empty(int dir_fd, const char *name) {
                 return -errno;
 
         /* If an offline file doesn't even have a header we consider it empty */
-        if (st.st_size < (off_t) sizeof(Header))
+        if (st.st_size < (off_t) sizeof(Header)) {
+                *ret = (Header) {};
                 return 1;
+        }
 
-        /* If the number of entries is empty, we consider it empty, too */
-        n = pread(fd, &n_entries, sizeof(n_entries), offsetof(Header, n_entries));
+        n = pread(fd, ret, sizeof(Header), 0);
         if (n < 0)
                 return -errno;
-        if (n != sizeof(n_entries))
+        if (n != sizeof(Header))
                 return -EIO;
 
-        return le64toh(n_entries) <= 0;
+        /* If the number of entries is empty, we consider it empty, too */
+        return le64toh(ret->n_entries) <= 0;
+}
+
+static int vacuum_parse_filename(
+                const char *name,
+                sd_id128_t *ret_seqnum_id,
+                uint64_t *ret_seqnum,
+                unsigned long long *ret_realtime,
+                bool *ret_have_seqnum) {
+
+        unsigned long long seqnum, realtime, tmp;
+        size_t q;
+
+        assert(name);
+        assert(ret_seqnum_id);
+        assert(ret_seqnum);
+        assert(ret_realtime);
+        assert(ret_have_seqnum);
+
+        /* Returns 1 for archived and corrupted journal files, 0 for active ones, and -EINVAL for files
+         * that are not journal files at all. This only looks at the file name. */
+
+        q = strlen(name);
+
+        if (endswith(name, ".journal")) {
+
+                /* Vacuum archived files. Active files are
+                 * left around */
+
+                if (q < 1 + 32 + 1 + 16 + 1 + 16 + 8)
+                        return 0;
+
+                if (name[q-8-16-1] != '-' ||
+                    name[q-8-16-1-16-1] != '-' ||
+                    name[q-8-16-1-16-1-32-1] != '@')
+                        return 0;
+
+                if (sd_id128_from_string(strndupa_safe(name + q-8-16-1-16-1-32, 32), ret_seqnum_id) < 0)
+                        return 0;
+
+                if (sscanf(name + q-8-16-1-16, "%16llx-%16llx.journal", &seqnum, &realtime) != 2)
+                        return 0;
+
+                *ret_seqnum = seqnum;
+                *ret_realtime = realtime;
+                *ret_have_seqnum = true;
+                return 1;
+        }
+
+        if (endswith(name, ".journal~")) {
+
+                /* Vacuum corrupted files */
+
+                if (q < 1 + 16 + 1 + 16 + 8 + 1)
+                        return 0;
+
+                if (name[q-1-8-16-1] != '-' ||
+                    name[q-1-8-16-1-16-1] != '@')
+                        return 0;
+
+                if (sscanf(name + q-1-8-16-1-16, "%16llx-%16llx.journal~", &realtime, &tmp) != 2)
+                        return 0;
+
+                *ret_seqnum_id = SD_ID128_NULL;
+                *ret_seqnum = 0;
+                *ret_realtime = realtime;
+                *ret_have_seqnum = false;
+                return 1;
+        }
+
+        return -EINVAL;
+}
+
+static int vacuum_make_manifest_entry(
+                int dir_fd,
+                const char *name,
+                unsigned long long realtime,
+                const JournalManifestEntry *old,
+                JournalManifestEntry **ret) {
+
+        _cleanup_(journal_manifest_entry_freep) JournalManifestEntry *e = NULL;
+        struct stat st;
+        int r;
+
+        assert(dir_fd >= 0);
+        assert(name);
+        assert(ret);
+
+        /* Determines everything vacuuming needs to know about an archived file that the manifest doesn't
+         * know (fully) yet. Returns 0 and NULL if this is not a regular file. */
+
+        if (fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) < 0)
+                return -errno;
+
+        if (!S_ISREG(st.st_mode)) {
+                *ret = NULL;
+                return 0;
+        }
+
+        e = new(JournalManifestEntry, 1);
+        if (!e)
+                return -ENOMEM;
+
+        if (old && old->inode == st.st_ino)
+                /* Added when the file was archived, only the disk usage is missing. */
+                *e = (JournalManifestEntry) {
+                        .seqnum_id = old->seqnum_id,
+                        .head_seqnum = old->head_seqnum,
+                        .tail_seqnum = old->tail_seqnum,
+                        .tail_realtime = old->tail_realtime,
+                        .n_entries = old->n_entries,
+                };
+        else {
+                Header h;
+
+                r = journal_file_read_header(dir_fd, name, &h);
+                if (r < 0)
+                        return r;
+
+                *e = (JournalManifestEntry) {
+                        .seqnum_id = h.seqnum_id,
+                        .head_seqnum = le64toh(h.head_entry_seqnum),
+                        .tail_seqnum = le64toh(h.tail_entry_seqnum),
+                        .tail_realtime = le64toh(h.tail_entry_realtime),
+                        .n_entries = r > 0 ? 0 : le64toh(h.n_entries),
+                };
+        }
+
+        e->filename = strdup(name);
+        if (!e->filename)
+                return -ENOMEM;
+
+        patch_realtime(dir_fd, name, &st, &realtime);
+
+        e->inode = st.st_ino;
+        e->head_realtime = realtime;
+        e->usage = 512UL * (uint64_t) st.st_blocks;
+
+        *ret = TAKE_PTR(e);
+        return 1;
+}
+
+static uint64_t vacuum_unlink(int dir_fd, const char *directory, const vacuum_info *list, size_t n_list, bool verbose) {
+        uint64_t freed = 0;
+        int r;
+
+        assert(dir_fd >= 0);
+        assert(directory);
+        assert(list || n_list == 0);
+
+        FOREACH_ARRAY(i, list, n_list) {
+                r = unlinkat_deallocate(dir_fd, i->filename, 0);
+                if (r >= 0) {
+                        log_full(verbose ? LOG_INFO : LOG_DEBUG, "Deleted %sarchived journal %s/%s (%s).",
+                                 i->empty ? "empty " : "", directory, i->filename, FORMAT_BYTES(i->usage));
+                        freed += i->usage;
+                } else if (r != -ENOENT)
+                        log_ratelimit_warning_errno(r, JOURNAL_LOG_RATELIMIT,
+                                                    "Failed to delete %sarchived journal %s/%s: %m",
+                                                    i->empty ? "empty " : "", directory, i->filename);
+        }
+
+        return freed;
+}
+
+/* The paths of the files that background threads are still about to remove. Later vacuuming runs must
+ * neither count them nor try to remove them again. The set doesn't own the strings, the contexts of the
+ * threads do. */
+static pthread_mutex_t pending_lock = PTHREAD_MUTEX_INITIALIZER;
+static Set *pending_unlink = NULL;
+
+/* Bumped whenever a background thread is done removing files */
+static uint64_t vacuum_generation = 0;
+
+uint64_t journal_vacuum_generation(void) {
+        return __atomic_load_n(&vacuum_generation, __ATOMIC_SEQ_CST);
+}
+
+static int vacuum_pending(const char *directory, const char *filename) {
+        _cleanup_free_ char *p = NULL;
+        int r;
+
+        assert(directory);
+        assert(filename);
+
+        assert_se(pthread_mutex_lock(&pending_lock) == 0);
+
+        if (set_isempty(pending_unlink))
+                r = false;
+        else {
+                p = path_join(directory, filename);
+                r = p ? set_contains(pending_unlink, p) : -ENOMEM;
+        }
+
+        assert_se(pthread_mutex_unlock(&pending_lock) == 0);
+        return r;
+}
+
+static void vacuum_pending_forget(char **paths) {
+        assert_se(pthread_mutex_lock(&pending_lock) == 0);
+
+        STRV_FOREACH(p, paths)
+                (void) set_remove(pending_unlink, *p);
+
+        if (set_isempty(pending_unlink))
+                pending_unlink = set_free(pending_unlink);
+
+        assert_se(pthread_mutex_unlock(&pending_lock) == 0);
+}
+
+static int vacuum_pending_add(char **paths) {
+        int r = 0;
+
+        assert_se(pthread_mutex_lock(&pending_lock) == 0);
+
+        STRV_FOREACH(p, paths) {
+                r = set_ensure_put(&pending_unlink, &string_hash_ops, *p);
+                if (r < 0)
+                        break;
+        }
+
+        assert_se(pthread_mutex_unlock(&pending_lock) == 0);
+
+        if (r < 0) {
+                vacuum_pending_forget(paths);
+                return r;
+        }
+
+        return 0;
+}
+
+typedef struct VacuumUnlinkContext {
+        int dir_fd;
+        char *directory;
+        vacuum_info *list;
+        size_t n_list;
+        char **paths;
+        bool verbose;
+} VacuumUnlinkContext;
+
+static VacuumUnlinkContext* vacuum_unlink_context_free(VacuumUnlinkContext *c) {
+        if (!c)
+                return NULL;
+
+        safe_close(c->dir_fd);
+        free(c->directory);
+        vacuum_info_array_free(c->list, c->n_list);
+        strv_free(c->paths);
+        return mfree(c);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(VacuumUnlinkContext*, vacuum_unlink_context_free);
+
+static void* vacuum_unlink_thread(void *p) {
+        VacuumUnlinkContext *c = ASSERT_PTR(p);
+        uint64_t freed;
+
+        (void) pthread_setname_np(pthread_self(), "journal-vacuum");
+
+        freed = vacuum_unlink(c->dir_fd, c->directory, c->list, c->n_list, c->verbose);
+
+        log_full(c->verbose ? LOG_INFO : LOG_DEBUG, "Vacuuming in the background done, freed %s of archived journals from %s.",
+                 FORMAT_BYTES(freed), c->directory);
+
+        vacuum_pending_forget(c->paths);
+        __atomic_add_fetch(&vacuum_generation, 1, __ATOMIC_SEQ_CST);
+
+        vacuum_unlink_context_free(c);
+        return NULL;
+}
+
+static int vacuum_unlink_async(int dir_fd, const char *directory, vacuum_info **list, size_t *n_list, bool verbose) {
+        _cleanup_(vacuum_unlink_context_freep) VacuumUnlinkContext *c = NULL;
+        sigset_t ss, saved_ss;
+        pthread_attr_t attr;
+        pthread_t thread;
+        int r;
+
+        assert(dir_fd >= 0);
+        assert(directory);
+        assert(list);
+        assert(n_list);
+
+        /* Deallocating and removing files can take a while, hence let a detached thread do it, so that
+         * journald's event loop can go on. On success the list is taken over. Until the thread is done, the
+         * files are remembered as pending, see above. */
+
+        c = new(VacuumUnlinkContext, 1);
+        if (!c)
+                return -ENOMEM;
+
+        *c = (VacuumUnlinkContext) {
+                .dir_fd = fcntl(dir_fd, F_DUPFD_CLOEXEC, 3),
+                .verbose = verbose,
+        };
+        if (c->dir_fd < 0)
+                return -errno;
+
+        c->directory = strdup(directory);
+        if (!c->directory)
+                return -ENOMEM;
+
+        FOREACH_ARRAY(i, *list, *n_list) {
+                r = strv_consume(&c->paths, path_join(directory, i->filename));
+                if (r < 0)
+                        return r;
+        }
+
+        r = vacuum_pending_add(c->paths);
+        if (r < 0)
+                return r;
+
+        r = pthread_attr_init(&attr);
+        if (r > 0) {
+                vacuum_pending_forget(c->paths);
+                return -r;
+        }
+
+        r = pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        if (r > 0)
+                goto finish;
+
+        /* The thread doesn't need to handle any signals. */
+        assert_se(sigfillset(&ss) >= 0);
+
+        r = pthread_sigmask(SIG_BLOCK, &ss, &saved_ss);
+        if (r > 0)
+                goto finish;
+
+        c->list = *list;
+        c->n_list = *n_list;
+
+        r = pthread_create(&thread, &attr, vacuum_unlink_thread, c);
+
+        assert_se(pthread_sigmask(SIG_SETMASK, &saved_ss, NULL) == 0);
+
+        if (r > 0) {
+                /* Hand the list back to the caller */
+                c->list = NULL;
+                c->n_list = 0;
+                goto finish;
+        }
+
+        TAKE_PTR(c);
+        *list = NULL;
+        *n_list = 0;
+
+finish:
+        if (r > 0)
+                vacuum_pending_forget(c->paths);
+
+        (void) pthread_attr_destroy(&attr);
+        return -r;
 }
 
-int journal_directory_vacuum(
+int journal_directory_vacuum_full(
                 const char *directory,
                 uint64_t max_use,
                 uint64_t n_max_files,
                 usec_t max_retention_usec,
                 usec_t *oldest_usec,
-                bool verbose) {
+                JournalVacuumFlags flags) {
 
+        _cleanup_(journal_manifest_freep) JournalManifest *manifest = NULL;
         uint64_t sum = 0, freed = 0, n_active_files = 0;
-        size_t n_list = 0, i;
+        size_t n_list = 0, n_unlink = 0, i;
+        vacuum_info *list = NULL, *unlink_list = NULL;
+        bool verbose = FLAGS_SET(flags, JOURNAL_VACUUM_VERBOSE);
         _cleanup_closedir_ DIR *d = NULL;
-        vacuum_info *list = NULL;
+        _cleanup_set_free_ Set *seen = NULL;
         usec_t retention_limit = 0;
+        JournalManifestEntry *e;
         int r;
 
         CLEANUP_ARRAY(list, n_list, vacuum_info_array_free);
+        CLEANUP_ARRAY(unlink_list, n_unlink, vacuum_info_array_free);
 
         assert(directory);
 
@@ -154,141 +522,113 @@ int journal_directory_vacuum(
         if (!d)
                 return -errno;
 
+        /* The manifest tells us about archived files we already looked at, so that we don't have to stat()
+         * and open them again. If it can't be read we simply look at everything. */
+        r = journal_manifest_load(dirfd(d), &manifest);
+        if (r == -ENOMEM)
+                return r;
+        if (r < 0) {
+                log_debug_errno(r, "Failed to load journal manifest of %s, ignoring: %m", directory);
+
+                manifest = new0(JournalManifest, 1);
+                if (!manifest)
+                        return -ENOMEM;
+        }
+
         FOREACH_DIRENT_ALL(de, d, return -errno) {
-                unsigned long long seqnum = 0, realtime;
-                _cleanup_free_ char *p = NULL;
+                _cleanup_(journal_manifest_entry_freep) JournalManifestEntry *n = NULL;
+                unsigned long long realtime;
                 sd_id128_t seqnum_id;
                 bool have_seqnum;
-                uint64_t size;
-                struct stat st;
-                size_t q;
+                uint64_t seqnum;
 
-                if (fstatat(dirfd(d), de->d_name, &st, AT_SYMLINK_NOFOLLOW) < 0) {
-                        log_debug_errno(errno, "Failed to stat file %s while vacuuming, ignoring: %m", de->d_name);
+                if (dot_or_dot_dot(de->d_name) || streq(de->d_name, JOURNAL_MANIFEST_FILENAME))
                         continue;
-                }
 
-                if (!S_ISREG(st.st_mode))
+                r = vacuum_parse_filename(de->d_name, &seqnum_id, &seqnum, &realtime, &have_seqnum);
+                if (r < 0) {
+                        /* We do not vacuum unknown files! */
+                        log_debug("Not vacuuming unknown file %s.", de->d_name);
                         continue;
+                }
+                if (r == 0) {
+                        struct stat st;
 
-                size = 512UL * (uint64_t) st.st_blocks;
-
-                q = strlen(de->d_name);
-
-                if (endswith(de->d_name, ".journal")) {
-
-                        /* Vacuum archived files. Active files are
-                         * left around */
-
-                        if (q < 1 + 32 + 1 + 16 + 1 + 16 + 8) {
-                                n_active_files++;
-                                sum += size;
-                                continue;
-                        }
-
-                        if (de->d_name[q-8-16-1] != '-' ||
-                            de->d_name[q-8-16-1-16-1] != '-' ||
-                            de->d_name[q-8-16-1-16-1-32-1] != '@') {
-                                n_active_files++;
-                                sum += size;
-                                continue;
-                        }
-
-                        p = strdup(de->d_name);
-                        if (!p)
-                                return -ENOMEM;
-
-                        de->d_name[q-8-16-1-16-1] = 0;
-                        if (sd_id128_from_string(de->d_name + q-8-16-1-16-1-32, &seqnum_id) < 0) {
-                                n_active_files++;
-                                sum += size;
+                        if (fstatat(dirfd(d), de->d_name, &st, AT_SYMLINK_NOFOLLOW) < 0) {
+                                log_debug_errno(errno, "Failed to stat file %s while vacuuming, ignoring: %m", de->d_name);
                                 continue;
                         }
 
-                        if (sscanf(de->d_name + q-8-16-1-16, "%16llx-%16llx.journal", &seqnum, &realtime) != 2) {
-                                n_active_files++;
-                                sum += size;
+                        if (!S_ISREG(st.st_mode))
                                 continue;
-                        }
-
-                        have_seqnum = true;
 
-                } else if (endswith(de->d_name, ".journal~")) {
-                        unsigned long long tmp;
+                        n_active_files++;
+                        sum += 512UL * (uint64_t) st.st_blocks;
+                        continue;
+                }
 
-                        /* seqnum_id won't be initialised before use below, so set to 0 */
-                        seqnum_id = SD_ID128_NULL;
+                /* Files an earlier run is still removing in the background are as good as gone */
+                r = vacuum_pending(directory, de->d_name);
+                if (r < 0)
+                        return r;
+                if (r > 0)
+                        continue;
 
-                        /* Vacuum corrupted files */
+                r = set_put_strdup(&seen, de->d_name);
+                if (r < 0)
+                        return r;
 
-                        if (q < 1 + 16 + 1 + 16 + 8 + 1) {
-                                n_active_files++;
-                                sum += size;
+                e = journal_manifest_get(manifest, de->d_name, de->d_ino);
+                if (!e || e->usage == UINT64_MAX) {
+                        r = vacuum_make_manifest_entry(dirfd(d), de->d_name, realtime, e, &n);
+                        if (r < 0) {
+                                log_debug_errno(r, "Failed to check %s while vacuuming, ignoring: %m", de->d_name);
                                 continue;
                         }
-
-                        if (de->d_name[q-1-8-16-1] != '-' ||
-                            de->d_name[q-1-8-16-1-16-1] != '@') {
-                                n_active_files++;
-                                sum += size;
+                        if (r == 0)
                                 continue;
-                        }
-
-                        p = strdup(de->d_name);
-                        if (!p)
-                                return -ENOMEM;
 
-                        if (sscanf(de->d_name + q-1-8-16-1-16, "%16llx-%16llx.journal~", &realtime, &tmp) != 2) {
-                                n_active_files++;
-                                sum += size;
-                                continue;
-                        }
-
-                        have_seqnum = false;
-                } else {
-                        /* We do not vacuum unknown files! */
-                        log_debug("Not vacuuming unknown file %s.", de->d_name);
-                        continue;
+                        e = n;
+                        r = journal_manifest_put(manifest, TAKE_PTR(n));
+                        if (r < 0)
+                                return r;
                 }
 
-                r = journal_file_empty(dirfd(d), p);
-                if (r < 0) {
-                        log_debug_errno(r, "Failed check if %s is empty, ignoring: %m", p);
-                        continue;
-                }
-                if (r > 0) {
+                if (e->n_entries == 0) {
                         /* Always vacuum empty non-online files. */
 
-                        r = unlinkat_deallocate(dirfd(d), p, 0);
-                        if (r >= 0) {
-
-                                log_full(verbose ? LOG_INFO : LOG_DEBUG,
-                                         "Deleted empty archived journal %s/%s (%s).", directory, p, FORMAT_BYTES(size));
+                        if (!GREEDY_REALLOC(unlink_list, n_unlink + 1))
+                                return -ENOMEM;
 
-                                freed += size;
-                        } else if (r != -ENOENT)
-                                log_ratelimit_warning_errno(r, JOURNAL_LOG_RATELIMIT,
-                                                            "Failed to delete empty archived journal %s/%s: %m",
-                                                            directory, p);
+                        unlink_list[n_unlink] = (vacuum_info) {
+                                .filename = strdup(e->filename),
+                                .usage = e->usage,
+                                .empty = true,
+                        };
+                        if (!unlink_list[n_unlink].filename)
+                                return -ENOMEM;
+                        n_unlink++;
 
+                        journal_manifest_remove(manifest, de->d_name);
                         continue;
                 }
 
-                patch_realtime(dirfd(d), p, &st, &realtime);
-
                 if (!GREEDY_REALLOC(list, n_list + 1))
                         return -ENOMEM;
 
-                list[n_list++] = (vacuum_info) {
-                        .filename = TAKE_PTR(p),
-                        .usage = size,
+                list[n_list] = (vacuum_info) {
+                        .filename = strdup(e->filename),
+                        .usage = e->usage,
                         .seqnum = seqnum,
-                        .realtime = realtime,
+                        .realtime = e->head_realtime,
                         .seqnum_id = seqnum_id,
                         .have_seqnum = have_seqnum,
                 };
+                if (!list[n_list].filename)
+                        return -ENOMEM;
+                n_list++;
 
-                sum += size;
+                sum += e->usage;
         }
 
         typesafe_qsort(list, n_list, vacuum_info_compare);
@@ -303,28 +643,100 @@ int journal_directory_vacuum(
                     (n_max_files <= 0 || left <= n_max_files))
                         break;
 
-                r = unlinkat_deallocate(dirfd(d), list[i].filename, 0);
-                if (r >= 0) {
-                        log_full(verbose ? LOG_INFO : LOG_DEBUG, "Deleted archived journal %s/%s (%s).",
-                                 directory, list[i].filename, FORMAT_BYTES(list[i].usage));
-                        freed += list[i].usage;
+                if (!GREEDY_REALLOC(unlink_list, n_unlink + 1))
+                        return -ENOMEM;
 
-                        if (list[i].usage < sum)
-                                sum -= list[i].usage;
-                        else
-                                sum = 0;
+                journal_manifest_remove(manifest, list[i].filename);
 
-                } else if (r != -ENOENT)
-                        log_ratelimit_warning_errno(r, JOURNAL_LOG_RATELIMIT,
-                                                    "Failed to delete archived journal %s/%s: %m",
-                                                    directory, list[i].filename);
+                unlink_list[n_unlink++] = (vacuum_info) {
+                        .filename = TAKE_PTR(list[i].filename),
+                        .usage = list[i].usage,
+                };
+
+                sum = LESS_BY(sum, list[i].usage);
         }
 
         if (oldest_usec && i < n_list && (*oldest_usec == 0 || list[i].realtime < *oldest_usec))
                 *oldest_usec = list[i].realtime;
 
+        /* Forget about files that are gone, and write down what we learnt before the files are actually
+         * removed. If removing a file fails after all, it's simply looked at again next time. */
+        HASHMAP_FOREACH(e, manifest->entries)
+                if (!set_contains(seen, e->filename))
+                        journal_manifest_remove(manifest, e->filename);
+
+        r = journal_manifest_save(manifest, dirfd(d));
+        if (r < 0)
+                log_debug_errno(r, "Failed to write journal manifest of %s, ignoring: %m", directory);
+
+        if (FLAGS_SET(flags, JOURNAL_VACUUM_ASYNC) && n_unlink > 0) {
+                FOREACH_ARRAY(j, unlink_list, n_unlink)
+                        freed += j->usage;
+
+                r = vacuum_unlink_async(dirfd(d), directory, &unlink_list, &n_unlink, verbose);
+                if (r >= 0) {
+                        log_full(verbose ? LOG_INFO : LOG_DEBUG, "Vacuuming done, freeing %s of archived journals from %s in the background.",
+                                 FORMAT_BYTES(freed), directory);
+                        return 1;
+                }
+
+                log_debug_errno(r, "Failed to start vacuuming thread, removing files synchronously: %m");
+        }
+
+        freed = vacuum_unlink(dirfd(d), directory, unlink_list, n_unlink, verbose);
+
         log_full(verbose ? LOG_INFO : LOG_DEBUG, "Vacuuming done, freed %s of archived journals from %s.",
                  FORMAT_BYTES(freed), directory);
 
         return 0;
 }
+
+int journal_directory_usage(const char *directory, uint64_t *ret) {
+        _cleanup_(journal_manifest_freep) JournalManifest *manifest = NULL;
+        _cleanup_closedir_ DIR *d = NULL;
+        uint64_t sum = 0;
+        int r;
+
+        assert(directory);
+        assert(ret);
+
+        /* Sums up the disk usage of all journal files in the directory. Archived files the manifest knows
+         * about are not looked at, everything else is stat()ed. The manifest is not updated here, that's
+         * left to vacuuming. */
+
+        d = opendir(directory);
+        if (!d)
+                return -errno;
+
+        r = journal_manifest_load(dirfd(d), &manifest);
+        if (r < 0)
+                log_debug_errno(r, "Failed to load journal manifest of %s, ignoring: %m", directory);
+
+        FOREACH_DIRENT_ALL(de, d, return -errno) {
+                JournalManifestEntry *e;
+                struct stat st;
+
+                if (!endswith(de->d_name, ".journal") &&
+                    !endswith(de->d_name, ".journal~"))
+                        continue;
+
+                e = manifest ? journal_manifest_get(manifest, de->d_name, de->d_ino) : NULL;
+                if (e && e->usage != UINT64_MAX) {
+                        sum += e->usage;
+                        continue;
+                }
+
+                if (fstatat(dirfd(d), de->d_name, &st, AT_SYMLINK_NOFOLLOW) < 0) {
+                        log_debug_errno(errno, "Failed to stat %s/%s, ignoring: %m", directory, de->d_name);
+                        continue;
+                }
+
+                if (!S_ISREG(st.st_mode))
+                        continue;
+
+                sum += (uint64_t) st.st_blocks * 512UL;
+        }
+
+        *ret = sum;
+        return 0;
+}
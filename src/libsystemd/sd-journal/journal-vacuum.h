@@ -6,4 +6,17 @@
 
 #include "time-util.h"
 
-int journal_directory_vacuum(const char *directory, uint64_t max_use, uint64_t n_max_files, usec_t max_retention_usec, usec_t *oldest_usec, bool verbose);
+typedef enum JournalVacuumFlags {
+        JOURNAL_VACUUM_VERBOSE = 1 << 0,
+        JOURNAL_VACUUM_ASYNC   = 1 << 1, /* remove files in a background thread */
+} JournalVacuumFlags;
+
+/* Returns > 0 if files are still being removed in the background, see journal_vacuum_generation() */
+int journal_directory_vacuum_full(const char *directory, uint64_t max_use, uint64_t n_max_files, usec_t max_retention_usec, usec_t *oldest_usec, JournalVacuumFlags flags);
+static inline int journal_directory_vacuum(const char *directory, uint64_t max_use, uint64_t n_max_files, usec_t max_retention_usec, usec_t *oldest_usec, bool verbose) {
+        return journal_directory_vacuum_full(directory, max_use, n_max_files, max_retention_usec, oldest_usec, verbose ? JOURNAL_VACUUM_VERBOSE : 0);
+}
+
+int journal_directory_usage(const char *directory, uint64_t *ret);
+
+uint64_t journal_vacuum_generation(void);
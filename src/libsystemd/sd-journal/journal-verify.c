@@ -1,6 +1,8 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
 #include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stddef.h>
 #include <sys/mman.h>
 #include <unistd.h>
@@ -9,6 +11,7 @@
 #include "compress.h"
 #include "fd-util.h"
 #include "fileio.h"
+#include "format-util.h"
 #include "fs-util.h"
 #include "gcrypt-util.h"
 #include "journal-authenticate.h"
@@ -17,6 +20,7 @@
 #include "journal-verify.h"
 #include "lookup3.h"
 #include "macro.h"
+#include "parse-util.h"
 #include "terminal-util.h"
 #include "tmpfile-util.h"
 
@@ -123,9 +127,21 @@ static int hash_payload(JournalFile *f, Object *o, uint64_t offset, const uint8_
                 return -EBADMSG;
         if (c != COMPRESSION_NONE) {
                 _cleanup_free_ void *b = NULL;
+                ZstdDictionary *d = NULL;
                 size_t b_size;
 
-                r = decompress_blob(c, src, size, &b, &b_size, 0);
+                if (c == COMPRESSION_ZSTD) {
+                        r = journal_file_get_zstd_dictionary(f, &d);
+                        if (r < 0) {
+                                error_errno(offset, r, "Failed to load ZSTD dictionary: %m");
+                                return r;
+                        }
+                }
+
+                if (d)
+                        r = decompress_blob_zstd_with_dictionary(src, size, &b, &b_size, 0, d);
+                else
+                        r = decompress_blob(c, src, size, &b, &b_size, 0);
                 if (r < 0) {
                         error_errno(offset, r, "%s decompression failed: %m",
                                     compression_to_string(c));
@@ -139,14 +155,15 @@ static int hash_payload(JournalFile *f, Object *o, uint64_t offset, const uint8_
         return 0;
 }
 
-static int journal_file_object_verify(JournalFile *f, uint64_t offset, Object *o) {
+static int journal_file_object_verify(JournalFile *f, uint64_t offset, Object *o, bool verify_hash) {
         assert(f);
         assert(offset);
         assert(o);
 
         /* This does various superficial tests about the length an
          * possible field values. It does not follow any references to
-         * other objects. */
+         * other objects. If verify_hash is false, the payload hash of
+         * DATA objects is not checked, the caller does so later. */
 
         if ((o->object.flags & _OBJECT_COMPRESSED_MASK) != 0 &&
             o->object.type != OBJECT_DATA) {
@@ -177,16 +194,18 @@ static int journal_file_object_verify(JournalFile *f, uint64_t offset, Object *o
                         return -EBADMSG;
                 }
 
-                h1 = le64toh(o->data.hash);
-                r = hash_payload(f, o, offset, journal_file_data_payload_field(f, o),
-                                 le64toh(o->object.size) - journal_file_data_payload_offset(f),
-                                 &h2);
-                if (r < 0)
-                        return r;
+                if (verify_hash) {
+                        h1 = le64toh(o->data.hash);
+                        r = hash_payload(f, o, offset, journal_file_data_payload_field(f, o),
+                                         le64toh(o->object.size) - journal_file_data_payload_offset(f),
+                                         &h2);
+                        if (r < 0)
+                                return r;
 
-                if (h1 != h2) {
-                        error(offset, "Invalid hash (%08" PRIx64 " vs. %08" PRIx64 ")", h1, h2);
-                        return -EBADMSG;
+                        if (h1 != h2) {
+                                error(offset, "Invalid hash (%08" PRIx64 " vs. %08" PRIx64 ")", h1, h2);
+                                return -EBADMSG;
+                        }
                 }
 
                 if (!VALID64(le64toh(o->data.next_hash_offset)) ||
@@ -377,6 +396,87 @@ static int journal_file_object_verify(JournalFile *f, uint64_t offset, Object *o
                         return -EBADMSG;
                 }
 
+                break;
+
+        case OBJECT_BLOOM_FILTER:
+                if (le64toh(o->object.size) <= offsetof(Object, bloom_filter.bits) ||
+                    (le64toh(o->object.size) - offsetof(Object, bloom_filter.bits)) % sizeof(uint64_t) != 0) {
+                        error(offset,
+                              "Invalid bloom filter size: %"PRIu64,
+                              le64toh(o->object.size));
+                        return -EBADMSG;
+                }
+
+                if (o->bloom_filter.n_hash_functions <= 0) {
+                        error(offset, "Bloom filter without hash functions");
+                        return -EBADMSG;
+                }
+
+                if (!memeqzero(o->bloom_filter.reserved, sizeof(o->bloom_filter.reserved))) {
+                        error(offset, "Bloom filter reserved field is non-zero");
+                        return -EBADMSG;
+                }
+
+                break;
+
+        case OBJECT_UNIQUE_INDEX:
+                if (le64toh(o->unique_index.n_fields) >
+                    (le64toh(o->object.size) - offsetof(Object, unique_index.items)) / sizeof(UniqueIndexItem)) {
+                        error(offset,
+                              "Invalid unique index size: %"PRIu64,
+                              le64toh(o->object.size));
+                        return -EBADMSG;
+                }
+
+                break;
+
+        case OBJECT_ZSTD_DICTIONARY:
+                if (le64toh(o->object.size) <= offsetof(Object, zstd_dictionary.payload)) {
+                        error(offset,
+                              "Invalid ZSTD dictionary size: %"PRIu64,
+                              le64toh(o->object.size));
+                        return -EBADMSG;
+                }
+
+                break;
+
+        case OBJECT_HISTOGRAM:
+                if (le64toh(o->histogram.n_buckets) <= 0 ||
+                    le64toh(o->object.size) != offsetof(Object, histogram.counts) +
+                                               le64toh(o->histogram.n_buckets) * HISTOGRAM_N_COLUMNS * sizeof(le32_t)) {
+                        error(offset,
+                              "Invalid histogram size: %"PRIu64,
+                              le64toh(o->object.size));
+                        return -EBADMSG;
+                }
+
+                if (le64toh(o->histogram.bucket_usec) <= 0) {
+                        error(offset, "Histogram with empty buckets");
+                        return -EBADMSG;
+                }
+
+                break;
+
+        case OBJECT_BOOT_INDEX:
+                if (le64toh(o->object.size) != offsetof(Object, boot_index.items) +
+                                               le64toh(o->boot_index.n_boots) * sizeof(BootIndexItem)) {
+                        error(offset,
+                              "Invalid boot index size: %"PRIu64,
+                              le64toh(o->object.size));
+                        return -EBADMSG;
+                }
+
+                for (uint64_t i = 0; i < le64toh(o->boot_index.n_boots); i++) {
+                        const BootIndexItem *item = o->boot_index.items + i;
+
+                        if (sd_id128_is_null(item->boot_id) ||
+                            le64toh(item->head_entry_seqnum) > le64toh(item->tail_entry_seqnum) ||
+                            (i > 0 && le64toh(item->head_entry_seqnum) <= le64toh(item[-1].head_entry_seqnum))) {
+                                error(offset, "Invalid boot index item %"PRIu64, i);
+                                return -EBADMSG;
+                        }
+                }
+
                 break;
         }
 
@@ -581,6 +681,15 @@ static int verify_data_hash_table(
                                 return -EBADMSG;
                         }
 
+                        /* A DATA object missing from the bloom filter would make it invisible to matches. */
+                        r = journal_file_bloom_filter_test(f, le64toh(o->data.hash));
+                        if (r < 0)
+                                return r;
+                        if (r == 0) {
+                                error(p, "Data object missing from bloom filter in hash entry %"PRIu64" of %"PRIu64, i, n);
+                                return -EBADMSG;
+                        }
+
                         r = verify_data(f, o, p, cache_entry_fd, n_entries, cache_entry_array_fd, n_entry_arrays);
                         if (r < 0)
                                 return r;
@@ -810,6 +919,239 @@ static int verify_hash_table(
         return 0;
 }
 
+/* Checking the payload hashes of DATA objects means decompressing and hashing every single one of them,
+ * which dominates the runtime of the first pass. The objects are independent of each other, hence this is
+ * done by a number of threads in parallel, each taking a contiguous range of the DATA objects found. */
+
+#define VERIFY_THREADS_MAX 16U
+#define VERIFY_OBJECTS_PER_THREAD_MIN 1024U
+
+typedef struct VerifyHashWorker {
+        JournalFile *file;
+        const uint64_t *offsets;
+        uint64_t n_offsets;
+
+        pthread_t thread;
+        bool started;
+
+        uint64_t n_bytes;
+
+        /* The first failure in this range */
+        int error;
+        uint64_t error_offset;
+        uint64_t error_hash_expected, error_hash_found;
+} VerifyHashWorker;
+
+static unsigned verify_n_threads(void) {
+        const char *e;
+        unsigned n;
+        long k;
+        int r;
+
+        e = secure_getenv("SYSTEMD_JOURNAL_VERIFY_THREADS");
+        if (e) {
+                r = safe_atou(e, &n);
+                if (r >= 0)
+                        return MAX(n, 1U);
+
+                log_debug_errno(r, "Failed to parse $SYSTEMD_JOURNAL_VERIFY_THREADS, ignoring: %s", e);
+        }
+
+        k = sysconf(_SC_NPROCESSORS_ONLN);
+        if (k <= 0)
+                return 1;
+
+        return MIN((unsigned) k, VERIFY_THREADS_MAX);
+}
+
+static int verify_hash_one(VerifyHashWorker *w, uint64_t offset, uint8_t **buf) {
+        JournalFile *f = ASSERT_PTR(ASSERT_PTR(w)->file);
+        ObjectHeader h;
+        uint64_t sz, h2;
+        Object *o;
+        ssize_t n;
+        int r;
+
+        assert(buf);
+
+        /* The mmap cache is not thread safe, hence read the object with pread(). This also means we don't
+         * have to deal with SIGBUS here. The first pass already checked the object header. */
+        n = pread(f->fd, &h, sizeof(h), offset);
+        if (n < 0)
+                return -errno;
+        if ((size_t) n != sizeof(h))
+                return -EIO;
+
+        sz = le64toh(h.size);
+        if (sz <= journal_file_data_payload_offset(f) || sz > SIZE_MAX)
+                return -EBADMSG;
+
+        if (!GREEDY_REALLOC(*buf, sz))
+                return -ENOMEM;
+
+        n = pread(f->fd, *buf, sz, offset);
+        if (n < 0)
+                return -errno;
+        if ((uint64_t) n != sz)
+                return -EIO;
+
+        o = (Object*) *buf;
+        r = hash_payload(f, o, offset, journal_file_data_payload_field(f, o),
+                         sz - journal_file_data_payload_offset(f),
+                         &h2);
+        if (r < 0)
+                return r;
+
+        if (le64toh(o->data.hash) != h2) {
+                w->error_hash_expected = le64toh(o->data.hash);
+                w->error_hash_found = h2;
+                return -EBADMSG;
+        }
+
+        w->n_bytes += sz;
+        return 0;
+}
+
+static void* verify_hash_thread(void *p) {
+        VerifyHashWorker *w = ASSERT_PTR(p);
+        _cleanup_free_ uint8_t *buf = NULL;
+        int r;
+
+        for (uint64_t i = 0; i < w->n_offsets; i++) {
+                r = verify_hash_one(w, w->offsets[i], &buf);
+                if (r < 0) {
+                        w->error = r;
+                        w->error_offset = w->offsets[i];
+                        break;
+                }
+        }
+
+        return NULL;
+}
+
+static int verify_data_hashes(JournalFile *f, int data_fd, uint64_t n_data, unsigned n_threads, uint64_t *ret_offset) {
+        _cleanup_free_ VerifyHashWorker *workers = NULL;
+        sigset_t ss, saved_ss;
+        uint64_t n_bytes = 0;
+        ZstdDictionary *d;
+        bool blocked;
+        usec_t start;
+        void *offsets;
+        int r;
+
+        assert(f);
+        assert(data_fd >= 0);
+        assert(n_threads > 0);
+        assert(ret_offset);
+
+        if (n_data == 0)
+                return 0;
+
+        n_threads = MIN(n_threads, DIV_ROUND_UP(n_data, VERIFY_OBJECTS_PER_THREAD_MIN));
+
+        /* Load everything the workers share before they are started, so that they don't race on
+         * initializing it lazily. */
+        r = journal_file_get_zstd_dictionary(f, &d);
+        if (r < 0)
+                return log_error_errno(r, "Failed to load ZSTD dictionary: %m");
+        if (d) {
+                r = zstd_dictionary_prepare_decompression(d);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to prepare ZSTD dictionary: %m");
+        }
+
+#if HAVE_XZ
+        if (JOURNAL_HEADER_COMPRESSED_XZ(f->header))
+                (void) dlopen_lzma();
+#endif
+#if HAVE_LZ4
+        if (JOURNAL_HEADER_COMPRESSED_LZ4(f->header))
+                (void) dlopen_lz4();
+#endif
+#if HAVE_ZSTD
+        if (JOURNAL_HEADER_COMPRESSED_ZSTD(f->header))
+                (void) dlopen_zstd();
+#endif
+
+        offsets = mmap(NULL, n_data * sizeof(uint64_t), PROT_READ, MAP_PRIVATE, data_fd, 0);
+        if (offsets == MAP_FAILED)
+                return log_error_errno(errno, "Failed to map data file: %m");
+
+        workers = new0(VerifyHashWorker, n_threads);
+        if (!workers) {
+                r = log_oom();
+                goto finish;
+        }
+
+        for (unsigned i = 0; i < n_threads; i++) {
+                uint64_t a = n_data * i / n_threads, b = n_data * (i + 1) / n_threads;
+
+                workers[i] = (VerifyHashWorker) {
+                        .file = f,
+                        .offsets = (const uint64_t*) offsets + a,
+                        .n_offsets = b - a,
+                };
+        }
+
+        start = now(CLOCK_MONOTONIC);
+
+        /* The workers only use pread(), hence they don't need to handle any signals. */
+        assert_se(sigfillset(&ss) >= 0);
+        blocked = pthread_sigmask(SIG_BLOCK, &ss, &saved_ss) == 0;
+
+        /* The first range is processed by ourselves, as is every range we fail to start a thread for. */
+        for (unsigned i = 1; blocked && i < n_threads; i++) {
+                r = pthread_create(&workers[i].thread, NULL, verify_hash_thread, workers + i);
+                if (r > 0) {
+                        log_debug_errno(r, "Failed to start verification thread, continuing with fewer: %m");
+                        break;
+                }
+
+                workers[i].started = true;
+        }
+
+        if (blocked)
+                assert_se(pthread_sigmask(SIG_SETMASK, &saved_ss, NULL) == 0);
+
+        for (unsigned i = 0; i < n_threads; i++)
+                if (!workers[i].started)
+                        (void) verify_hash_thread(workers + i);
+
+        for (unsigned i = 0; i < n_threads; i++)
+                if (workers[i].started)
+                        assert_se(pthread_join(workers[i].thread, NULL) == 0);
+
+        r = 0;
+        for (unsigned i = 0; i < n_threads; i++) {
+                n_bytes += workers[i].n_bytes;
+
+                /* Report the failure at the lowest offset, like the sequential pass would. */
+                if (r == 0 && workers[i].error < 0) {
+                        r = workers[i].error;
+                        *ret_offset = workers[i].error_offset;
+
+                        if (workers[i].error_hash_expected != workers[i].error_hash_found)
+                                error(workers[i].error_offset, "Invalid hash (%08" PRIx64 " vs. %08" PRIx64 ")",
+                                      workers[i].error_hash_expected, workers[i].error_hash_found);
+                        else
+                                error_errno(workers[i].error_offset, r, "Invalid object contents: %m");
+                }
+        }
+
+        if (r == 0) {
+                usec_t t = usec_sub_unsigned(now(CLOCK_MONOTONIC), start);
+
+                log_debug("Verified hashes of %"PRIu64" data objects (%s) in %s using %u threads, %.0f objects/s, %s/s.",
+                          n_data, FORMAT_BYTES(n_bytes), FORMAT_TIMESPAN(t, USEC_PER_MSEC), n_threads,
+                          (double) n_data * USEC_PER_SEC / MAX(t, 1U),
+                          FORMAT_BYTES((uint64_t) ((double) n_bytes * USEC_PER_SEC / MAX(t, 1U))));
+        }
+
+finish:
+        assert_se(munmap(offsets, n_data * sizeof(uint64_t)) >= 0);
+        return r;
+}
+
 int journal_file_verify(
                 JournalFile *f,
                 const char *key,
@@ -824,13 +1166,15 @@ int journal_file_verify(
         sd_id128_t entry_boot_id = {};  /* Unnecessary initialization to appease gcc */
         bool entry_seqnum_set = false, entry_monotonic_set = false, entry_realtime_set = false, found_main_entry_array = false;
         uint64_t n_objects = 0, n_entries = 0, n_data = 0, n_fields = 0, n_data_hash_tables = 0, n_field_hash_tables = 0, n_entry_arrays = 0, n_tags = 0;
+        uint64_t n_histogram_entries = 0;
         usec_t last_usec = 0;
         _cleanup_close_ int data_fd = -EBADF, entry_fd = -EBADF, entry_array_fd = -EBADF;
         _cleanup_fclose_ FILE *data_fp = NULL, *entry_fp = NULL, *entry_array_fp = NULL;
         MMapFileDescriptor *cache_data_fd = NULL, *cache_entry_fd = NULL, *cache_entry_array_fd = NULL;
         unsigned i;
-        bool found_last = false;
+        bool found_last = false, found_bloom_filter = false, found_zstd_dictionary = false, found_unique_index = false, found_histogram = false, found_boot_index = false;
         const char *tmp_dir = NULL;
+        unsigned n_threads;
         MMapCache *m;
 
 #if HAVE_GCRYPT
@@ -931,7 +1275,10 @@ int journal_file_verify(
                         "This log file was sealed with an old journald version where the sequence of seals might not be continuous. We cannot guarantee completeness.");
 
         /* First iteration: we go through all objects, verify the
-         * superficial structure, headers, hashes. */
+         * superficial structure, headers, hashes. When using multiple
+         * threads the hashes of DATA objects are checked afterwards. */
+
+        n_threads = verify_n_threads();
 
         p = le64toh(f->header->header_size);
         for (;;) {
@@ -959,7 +1306,7 @@ int journal_file_verify(
 
                 n_objects++;
 
-                r = journal_file_object_verify(f, p, o);
+                r = journal_file_object_verify(f, p, o, /* verify_hash= */ n_threads <= 1);
                 if (r < 0) {
                         error_errno(p, r, "Invalid object contents: %m");
                         goto fail;
@@ -991,6 +1338,13 @@ int journal_file_verify(
                         goto fail;
                 }
 
+                if (IN_SET(o->object.type, OBJECT_BLOOM_FILTER, OBJECT_UNIQUE_INDEX, OBJECT_HISTOGRAM, OBJECT_BOOT_INDEX) &&
+                    !JOURNAL_HEADER_INDEXES(f->header)) {
+                        error(p, "Index object in file without indexes");
+                        r = -EBADMSG;
+                        goto fail;
+                }
+
                 switch (o->object.type) {
 
                 case OBJECT_DATA:
@@ -1242,6 +1596,104 @@ int journal_file_verify(
 
                         n_tags++;
                         break;
+
+                case OBJECT_BLOOM_FILTER:
+                        if (!JOURNAL_HEADER_CONTAINS(f->header, bloom_filter_offset) ||
+                            p != le64toh(f->header->bloom_filter_offset)) {
+                                error(p, "Bloom filter object not referenced from header");
+                                r = -EBADMSG;
+                                goto fail;
+                        }
+
+                        if (le64toh(o->bloom_filter.n_items) != le64toh(f->header->n_data)) {
+                                error(p,
+                                      "Bloom filter item number mismatch (%"PRIu64" != %"PRIu64")",
+                                      le64toh(o->bloom_filter.n_items),
+                                      le64toh(f->header->n_data));
+                                r = -EBADMSG;
+                                goto fail;
+                        }
+
+                        found_bloom_filter = true;
+                        break;
+
+                case OBJECT_ZSTD_DICTIONARY:
+                        if (!JOURNAL_HEADER_ZSTD_DICTIONARY(f->header) ||
+                            p != le64toh(f->header->zstd_dictionary_offset)) {
+                                error(p, "ZSTD dictionary object not referenced from header");
+                                r = -EBADMSG;
+                                goto fail;
+                        }
+
+                        if (n_data > 0) {
+                                error(p, "ZSTD dictionary object after data objects");
+                                r = -EBADMSG;
+                                goto fail;
+                        }
+
+                        found_zstd_dictionary = true;
+                        break;
+
+                case OBJECT_UNIQUE_INDEX:
+                        if (!JOURNAL_HEADER_CONTAINS(f->header, unique_index_offset) ||
+                            p != le64toh(f->header->unique_index_offset)) {
+                                error(p, "Unique index object not referenced from header");
+                                r = -EBADMSG;
+                                goto fail;
+                        }
+
+                        if (o->unique_index.tail_entry_seqnum != f->header->tail_entry_seqnum) {
+                                error(p,
+                                      "Unique index tail entry seqnum mismatch (%"PRIu64" != %"PRIu64")",
+                                      le64toh(o->unique_index.tail_entry_seqnum),
+                                      le64toh(f->header->tail_entry_seqnum));
+                                r = -EBADMSG;
+                                goto fail;
+                        }
+
+                        r = journal_unique_index_validate(&o->unique_index);
+                        if (r < 0) {
+                                error_errno(p, r, "Invalid unique index: %m");
+                                goto fail;
+                        }
+
+                        found_unique_index = true;
+                        break;
+
+                case OBJECT_HISTOGRAM:
+                        if (!JOURNAL_HEADER_CONTAINS(f->header, histogram_offset)) {
+                                error(p, "Histogram object in file without histogram support");
+                                r = -EBADMSG;
+                                goto fail;
+                        }
+
+                        if (p == le64toh(f->header->histogram_offset))
+                                found_histogram = true;
+
+                        for (uint64_t k = 0; k < le64toh(o->histogram.n_buckets) * HISTOGRAM_N_COLUMNS; k++)
+                                n_histogram_entries += le32toh(o->histogram.counts[k]);
+
+                        break;
+
+                case OBJECT_BOOT_INDEX:
+                        if (!JOURNAL_HEADER_CONTAINS(f->header, boot_index_offset) ||
+                            p != le64toh(f->header->boot_index_offset)) {
+                                error(p, "Boot index object not referenced from header");
+                                r = -EBADMSG;
+                                goto fail;
+                        }
+
+                        if (o->boot_index.tail_entry_seqnum != f->header->tail_entry_seqnum) {
+                                error(p,
+                                      "Boot index tail entry seqnum mismatch (%"PRIu64" != %"PRIu64")",
+                                      le64toh(o->boot_index.tail_entry_seqnum),
+                                      le64toh(f->header->tail_entry_seqnum));
+                                r = -EBADMSG;
+                                goto fail;
+                        }
+
+                        found_boot_index = true;
+                        break;
                 }
 
                 if (p == le64toh(f->header->tail_object_offset)) {
@@ -1260,6 +1712,71 @@ int journal_file_verify(
                 goto fail;
         }
 
+        if (n_threads > 1) {
+                if (fflush(data_fp) != 0) {
+                        r = log_error_errno(errno, "Failed to flush data file stream: %m");
+                        goto fail;
+                }
+
+                r = verify_data_hashes(f, fileno(data_fp), n_data, n_threads, &p);
+                if (r < 0)
+                        goto fail;
+        }
+
+        if (JOURNAL_HEADER_CONTAINS(f->header, bloom_filter_offset) &&
+            f->header->bloom_filter_offset != 0 && !found_bloom_filter) {
+                error(offsetof(Header, bloom_filter_offset),
+                      "Bloom filter pointer dead (%"PRIu64")",
+                      le64toh(f->header->bloom_filter_offset));
+                r = -EBADMSG;
+                goto fail;
+        }
+
+        if (JOURNAL_HEADER_CONTAINS(f->header, unique_index_offset) &&
+            f->header->unique_index_offset != 0 && !found_unique_index) {
+                error(offsetof(Header, unique_index_offset),
+                      "Unique index pointer dead (%"PRIu64")",
+                      le64toh(f->header->unique_index_offset));
+                r = -EBADMSG;
+                goto fail;
+        }
+
+        if (JOURNAL_HEADER_CONTAINS(f->header, histogram_offset) &&
+            f->header->histogram_offset != 0 && !found_histogram) {
+                error(offsetof(Header, histogram_offset),
+                      "Histogram pointer dead (%"PRIu64")",
+                      le64toh(f->header->histogram_offset));
+                r = -EBADMSG;
+                goto fail;
+        }
+
+        if (JOURNAL_HEADER_CONTAINS(f->header, boot_index_offset) &&
+            f->header->boot_index_offset != 0 && !found_boot_index) {
+                error(offsetof(Header, boot_index_offset),
+                      "Boot index pointer dead (%"PRIu64")",
+                      le64toh(f->header->boot_index_offset));
+                r = -EBADMSG;
+                goto fail;
+        }
+
+        /* Entries might be missing from the histogram, but none may be counted twice. */
+        if (n_histogram_entries > n_entries) {
+                error(offsetof(Header, histogram_offset),
+                      "Histogram entry number mismatch (%"PRIu64" > %"PRIu64")",
+                      n_histogram_entries, n_entries);
+                r = -EBADMSG;
+                goto fail;
+        }
+
+        if (JOURNAL_HEADER_CONTAINS(f->header, zstd_dictionary_offset) &&
+            f->header->zstd_dictionary_offset != 0 && !found_zstd_dictionary) {
+                error(offsetof(Header, zstd_dictionary_offset),
+                      "ZSTD dictionary pointer dead (%"PRIu64")",
+                      le64toh(f->header->zstd_dictionary_offset));
+                r = -EBADMSG;
+                goto fail;
+        }
+
         if (n_objects != le64toh(f->header->n_objects)) {
                 error(offsetof(Header, n_objects),
                       "Object number mismatch (%"PRIu64" != %"PRIu64")",
@@ -1,12 +1,14 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
 #include <errno.h>
+#include <fcntl.h>
 #include <stdlib.h>
 #include <sys/mman.h>
 
 #include "alloc-util.h"
 #include "errno-util.h"
 #include "fd-util.h"
+#include "format-util.h"
 #include "hashmap.h"
 #include "list.h"
 #include "log.h"
@@ -14,6 +16,7 @@
 #include "memory-util.h"
 #include "mmap-cache.h"
 #include "sigbus.h"
+#include "stat-util.h"
 
 typedef struct Window Window;
 
@@ -42,14 +45,29 @@ struct Window {
         LIST_FIELDS(Window, unused);
 };
 
+typedef struct AccessPattern {
+        /* The range of the last window we had to create for this category */
+        uint64_t offset;
+        uint64_t end;
+
+        /* Number of windows created in a row just behind the previous one */
+        unsigned n_sequential;
+} AccessPattern;
+
 struct MMapFileDescriptor {
         MMapCache *cache;
+        unsigned n_ref;
 
         int fd;
         int prot;
         bool sigbus;
+        bool owns_fd; /* fd is our own copy, because the file is shared by multiple users */
+
+        struct stat st; /* to find other users of the same file */
 
         LIST_HEAD(Window, windows);
+
+        AccessPattern access_pattern[_MMAP_CACHE_CATEGORY_MAX];
 };
 
 struct MMapCache {
@@ -59,8 +77,12 @@ struct MMapCache {
         unsigned n_category_cache_hit;
         unsigned n_window_list_hit;
         unsigned n_missed;
+        unsigned n_windows_created;
+        unsigned n_readahead;
+        uint64_t n_bytes_mapped;
 
         Hashmap *fds;
+        Hashmap *fds_by_inode;
 
         LIST_HEAD(Window, unused);
         Window *last_unused;
@@ -73,10 +95,17 @@ struct MMapCache {
 #if ENABLE_DEBUG_MMAP_CACHE
 /* Tiny windows increase mmap activity and the chance of exposing unsafe use. */
 # define WINDOW_SIZE (page_size())
+# define WINDOW_SIZE_MAX WINDOW_SIZE
 #else
 # define WINDOW_SIZE ((size_t) (UINT64_C(8) * UINT64_C(1024) * UINT64_C(1024)))
+/* Sequential readers get their windows doubled up to this size, to reduce the number of mmap() calls. */
+# define WINDOW_SIZE_MAX ((size_t) (UINT64_C(64) * UINT64_C(1024) * UINT64_C(1024)))
 #endif
 
+/* Number of windows created in a row just behind the previous one, before we consider the access pattern
+ * sequential and start to read ahead. */
+#define SEQUENTIAL_THRESHOLD 2U
+
 MMapCache* mmap_cache_new(void) {
         MMapCache *m;
 
@@ -238,6 +267,8 @@ static MMapCache* mmap_cache_free(MMapCache *m) {
 
         assert(hashmap_isempty(m->fds));
         hashmap_free(m->fds);
+        assert(hashmap_isempty(m->fds_by_inode));
+        hashmap_free(m->fds_by_inode);
 
         assert(!m->unused);
         assert(m->n_windows == 0);
@@ -272,18 +303,53 @@ static int mmap_try_harder(MMapFileDescriptor *f, void *addr, int flags, uint64_
         }
 }
 
+static unsigned access_pattern_update(AccessPattern *a, uint64_t offset) {
+        assert(a);
+
+        /* A miss within the previous window or at most one window size behind it continues a forward
+         * scan. Anything else starts over. */
+        if (a->end > a->offset &&
+            offset >= a->offset &&
+            offset - a->offset < 2 * (a->end - a->offset))
+                a->n_sequential++;
+        else
+                a->n_sequential = 0;
+
+        return a->n_sequential;
+}
+
+static size_t access_pattern_window_size(const AccessPattern *a) {
+        assert(a);
+
+        if (a->n_sequential < SEQUENTIAL_THRESHOLD)
+                return WINDOW_SIZE;
+
+        /* Double the window for every further window created in a row, up to WINDOW_SIZE_MAX. */
+        unsigned shift = MIN(a->n_sequential - SEQUENTIAL_THRESHOLD + 1, (unsigned) (sizeof(size_t) * 8 - 1));
+        if (WINDOW_SIZE > WINDOW_SIZE_MAX >> shift)
+                return WINDOW_SIZE_MAX;
+
+        return WINDOW_SIZE << shift;
+}
+
 static int add_mmap(
                 MMapFileDescriptor *f,
+                MMapCacheCategory c,
                 uint64_t offset,
                 size_t size,
                 struct stat *st,
                 Window **ret) {
 
+        MMapCache *m = mmap_cache_fd_cache(f);
+        AccessPattern *a;
+        size_t window_size;
+        bool sequential;
         Window *w;
         void *d;
         int r;
 
         assert(f);
+        assert(c >= 0 && c < _MMAP_CACHE_CATEGORY_MAX);
         assert(size > 0);
         assert(ret);
 
@@ -291,15 +357,23 @@ static int add_mmap(
         if (size > SIZE_MAX - PAGE_OFFSET_U64(offset))
                 return -EADDRNOTAVAIL;
 
+        a = f->access_pattern + c;
+        sequential = access_pattern_update(a, offset) >= SEQUENTIAL_THRESHOLD;
+        window_size = access_pattern_window_size(a);
+
         size = PAGE_ALIGN(size + PAGE_OFFSET_U64(offset));
         offset = PAGE_ALIGN_DOWN_U64(offset);
 
-        if (size < WINDOW_SIZE) {
-                uint64_t delta;
+        if (size < window_size) {
+                /* Sequential readers won't look back, hence map everything ahead of the requested offset.
+                 * Otherwise center the window around it. */
+                if (!sequential) {
+                        uint64_t delta;
 
-                delta = PAGE_ALIGN((WINDOW_SIZE - size) / 2);
-                offset = LESS_BY(offset, delta);
-                size = WINDOW_SIZE;
+                        delta = PAGE_ALIGN((window_size - size) / 2);
+                        offset = LESS_BY(offset, delta);
+                }
+                size = window_size;
         }
 
         if (st) {
@@ -320,12 +394,26 @@ static int add_mmap(
         if (r < 0)
                 return r;
 
+        if (sequential) {
+                /* Let the kernel read ahead aggressively on faults, and start reading in the whole window
+                 * right away, so that we don't have to wait for the disk for every page we touch. */
+                (void) madvise(d, size, MADV_SEQUENTIAL);
+                (void) madvise(d, size, MADV_WILLNEED);
+                m->n_readahead++;
+        }
+
         w = window_add(f, offset, size, d);
         if (!w) {
                 (void) munmap(d, size);
                 return -ENOMEM;
         }
 
+        a->offset = offset;
+        a->end = offset + size;
+
+        m->n_windows_created++;
+        m->n_bytes_mapped += size;
+
         *ret = w;
         return 0;
 }
@@ -371,7 +459,7 @@ int mmap_cache_fd_get(
         m->n_missed++;
 
         /* Create a new mmap */
-        r = add_mmap(f, offset, size, st, &w);
+        r = add_mmap(f, c, offset, size, st, &w);
         if (r < 0)
                 return r;
 
@@ -427,11 +515,27 @@ found:
         return 1;
 }
 
+void mmap_cache_get_stats(MMapCache *m, MMapCacheStats *ret) {
+        assert(m);
+        assert(ret);
+
+        *ret = (MMapCacheStats) {
+                .n_category_cache_hit = m->n_category_cache_hit,
+                .n_window_list_hit = m->n_window_list_hit,
+                .n_missed = m->n_missed,
+                .n_windows_created = m->n_windows_created,
+                .n_readahead = m->n_readahead,
+                .n_bytes_mapped = m->n_bytes_mapped,
+        };
+}
+
 void mmap_cache_stats_log_debug(MMapCache *m) {
         assert(m);
 
-        log_debug("mmap cache statistics: %u category cache hit, %u window list hit, %u miss",
-                  m->n_category_cache_hit, m->n_window_list_hit, m->n_missed);
+        log_debug("mmap cache statistics: %u category cache hit, %u window list hit, %u miss, "
+                  "%u windows created, %u readahead, %s mapped",
+                  m->n_category_cache_hit, m->n_window_list_hit, m->n_missed,
+                  m->n_windows_created, m->n_readahead, FORMAT_BYTES(m->n_bytes_mapped));
 }
 
 static void mmap_cache_process_sigbus(MMapCache *m) {
@@ -496,9 +600,39 @@ bool mmap_cache_fd_got_sigbus(MMapFileDescriptor *f) {
         return f->sigbus;
 }
 
+static int mmap_cache_fd_share(MMapFileDescriptor *f) {
+        int copy, r;
+
+        assert(f);
+
+        if (f->owns_fd)
+                return 0;
+
+        /* The file descriptor we got belongs to the first user, who might close it while others still need
+         * to create windows. Hence map the file through our own copy of it from now on. */
+
+        copy = fcntl(f->fd, F_DUPFD_CLOEXEC, 3);
+        if (copy < 0)
+                return -errno;
+
+        assert_se(hashmap_remove(f->cache->fds, FD_TO_PTR(f->fd)) == f);
+
+        r = hashmap_put(f->cache->fds, FD_TO_PTR(copy), f);
+        if (r < 0) {
+                assert_se(hashmap_put(f->cache->fds, FD_TO_PTR(f->fd), f) > 0);
+                safe_close(copy);
+                return r;
+        }
+
+        f->fd = copy;
+        f->owns_fd = true;
+        return 0;
+}
+
 int mmap_cache_add_fd(MMapCache *m, int fd, int prot, MMapFileDescriptor **ret) {
         _cleanup_free_ MMapFileDescriptor *f = NULL;
         MMapFileDescriptor *existing;
+        struct stat st;
         int r;
 
         assert(m);
@@ -508,6 +642,25 @@ int mmap_cache_add_fd(MMapCache *m, int fd, int prot, MMapFileDescriptor **ret)
         if (existing) {
                 if (existing->prot != prot)
                         return -EEXIST;
+                existing->n_ref++;
+                if (ret)
+                        *ret = existing;
+                return 0;
+        }
+
+        if (fstat(fd, &st) < 0)
+                return -errno;
+
+        /* If the same file is already mapped with the same protection, e.g. because it is opened by several
+         * journal objects sharing this cache, share its windows instead of mapping it again. Files that got
+         * truncated under our feet are not shared, their windows have been replaced by anonymous memory. */
+        existing = hashmap_get(m->fds_by_inode, &st);
+        if (existing && existing->prot == prot && !existing->sigbus) {
+                r = mmap_cache_fd_share(existing);
+                if (r < 0)
+                        return r;
+
+                existing->n_ref++;
                 if (ret)
                         *ret = existing;
                 return 0;
@@ -518,8 +671,10 @@ int mmap_cache_add_fd(MMapCache *m, int fd, int prot, MMapFileDescriptor **ret)
                 return -ENOMEM;
 
         *f = (MMapFileDescriptor) {
+                .n_ref = 1,
                 .fd = fd,
                 .prot = prot,
+                .st = st,
         };
 
         r = hashmap_ensure_put(&m->fds, NULL, FD_TO_PTR(fd), f);
@@ -527,6 +682,15 @@ int mmap_cache_add_fd(MMapCache *m, int fd, int prot, MMapFileDescriptor **ret)
                 return r;
         assert(r > 0);
 
+        /* Only the first user of an inode is registered here, that's sufficient to find it. */
+        if (!existing) {
+                r = hashmap_ensure_put(&m->fds_by_inode, &inode_hash_ops, &f->st, f);
+                if (r < 0) {
+                        assert_se(hashmap_remove(m->fds, FD_TO_PTR(fd)) == f);
+                        return r;
+                }
+        }
+
         f->cache = mmap_cache_ref(m);
 
         if (ret)
@@ -540,6 +704,11 @@ MMapFileDescriptor* mmap_cache_fd_free(MMapFileDescriptor *f) {
         if (!f)
                 return NULL;
 
+        /* This drops one user of the file. The windows are only released once the last one is gone. */
+        assert(f->n_ref > 0);
+        if (--f->n_ref > 0)
+                return NULL;
+
         /* Make sure that any queued SIGBUS are first dispatched, so that we don't end up with a SIGBUS entry
          * we cannot relate to any existing memory map. */
 
@@ -549,6 +718,10 @@ MMapFileDescriptor* mmap_cache_fd_free(MMapFileDescriptor *f) {
                 window_free(f->windows);
 
         assert_se(hashmap_remove(f->cache->fds, FD_TO_PTR(f->fd)) == f);
+        (void) hashmap_remove_value(f->cache->fds_by_inode, &f->st, f);
+
+        if (f->owns_fd)
+                safe_close(f->fd);
 
         /* Unref the cache at the end. Otherwise, the assertions in mmap_cache_free() may be triggered. */
         f->cache = mmap_cache_unref(f->cache);
@@ -19,6 +19,11 @@ typedef enum MMapCacheCategory {
         MMAP_CACHE_CATEGORY_FIELD_HASH_TABLE = OBJECT_FIELD_HASH_TABLE,
         MMAP_CACHE_CATEGORY_ENTRY_ARRAY      = OBJECT_ENTRY_ARRAY,
         MMAP_CACHE_CATEGORY_TAG              = OBJECT_TAG,
+        MMAP_CACHE_CATEGORY_BLOOM_FILTER     = OBJECT_BLOOM_FILTER,
+        MMAP_CACHE_CATEGORY_ZSTD_DICTIONARY  = OBJECT_ZSTD_DICTIONARY,
+        MMAP_CACHE_CATEGORY_UNIQUE_INDEX     = OBJECT_UNIQUE_INDEX,
+        MMAP_CACHE_CATEGORY_HISTOGRAM        = OBJECT_HISTOGRAM,
+        MMAP_CACHE_CATEGORY_BOOT_INDEX       = OBJECT_BOOT_INDEX,
         MMAP_CACHE_CATEGORY_HEADER, /* for reading file header */
         MMAP_CACHE_CATEGORY_PIN,    /* for temporary pinning a object */
         _MMAP_CACHE_CATEGORY_MAX,
@@ -55,6 +60,16 @@ int mmap_cache_add_fd(MMapCache *m, int fd, int prot, MMapFileDescriptor **ret);
 MMapCache* mmap_cache_fd_cache(MMapFileDescriptor *f);
 MMapFileDescriptor* mmap_cache_fd_free(MMapFileDescriptor *f);
 
+typedef struct MMapCacheStats {
+        unsigned n_category_cache_hit;
+        unsigned n_window_list_hit;
+        unsigned n_missed;
+        unsigned n_windows_created;
+        unsigned n_readahead;
+        uint64_t n_bytes_mapped;
+} MMapCacheStats;
+
+void mmap_cache_get_stats(MMapCache *m, MMapCacheStats *ret);
 void mmap_cache_stats_log_debug(MMapCache *m);
 
 bool mmap_cache_fd_got_sigbus(MMapFileDescriptor *f);
@@ -32,8 +32,10 @@
 #include "journal-internal.h"
 #include "list.h"
 #include "lookup3.h"
+#include "missing_threads.h"
 #include "nulstr-util.h"
 #include "origin-id.h"
+#include "parse-util.h"
 #include "path-util.h"
 #include "prioq.h"
 #include "process-util.h"
@@ -54,10 +56,15 @@
 
 #define DEFAULT_DATA_THRESHOLD (64*1024)
 
+/* Upper limit for the number of buckets sd_journal_get_histogram() returns */
+#define HISTOGRAM_N_BUCKETS_MAX (1024U*1024U)
+
 DEFINE_PRIVATE_ORIGIN_ID_HELPERS(sd_journal, journal);
 
 static void remove_file_real(sd_journal *j, JournalFile *f);
+static void journal_clear_files_by_location(sd_journal *j);
 static int journal_file_read_tail_timestamp(sd_journal *j, JournalFile *f);
+static bool journal_file_tail_changed(JournalFile *f);
 static void journal_file_unlink_newest_by_boot_id(sd_journal *j, JournalFile *f);
 
 static int journal_put_error(sd_journal *j, int r, const char *path) {
@@ -104,6 +111,8 @@ static void detach_location(sd_journal *j) {
         j->current_file = NULL;
         j->current_field = 0;
 
+        journal_clear_files_by_location(j);
+
         ORDERED_HASHMAP_FOREACH(f, j->files)
                 journal_file_reset_location(f);
 }
@@ -215,6 +224,8 @@ static Match *match_free(Match *m) {
                 LIST_REMOVE(matches, m->parent->matches, m);
 
         free(m->data);
+        strv_free(m->values);
+        hashmap_free(m->set_files);
         return mfree(m);
 }
 
@@ -225,29 +236,14 @@ static Match *match_free_if_empty(Match *m) {
         return match_free(m);
 }
 
-_public_ int sd_journal_add_match(sd_journal *j, const void *data, size_t size) {
-        Match *add_here = NULL, *m = NULL;
-        uint64_t hash;
-
-        assert_return(j, -EINVAL);
-        assert_return(!journal_origin_changed(j), -ECHILD);
-        assert_return(data, -EINVAL);
-
-        /* If the size is unspecified, assume it's a string. Note: 0 is the public value we document for
-         * this, for historical reasons. Internally, we pretty widely started using SIZE_MAX for this in
-         * similar cases however, hence accept that too. And internally we actually prefer it, to make things
-         * less surprising. */
-        if (IN_SET(size, 0, SIZE_MAX))
-                size = strlen(data);
-
-        if (!match_is_valid(data, size))
-                return -EINVAL;
+static int match_ensure_levels(sd_journal *j) {
+        assert(j);
 
         /* level 0: AND term
          * level 1: OR terms
          * level 2: AND terms
          * level 3: OR terms
-         * level 4: concrete matches */
+         * level 4: concrete matches and match sets */
 
         if (!j->level0) {
                 j->level0 = match_new(NULL, MATCH_AND_TERM);
@@ -271,6 +267,39 @@ _public_ int sd_journal_add_match(sd_journal *j, const void *data, size_t size)
         assert(j->level1->type == MATCH_OR_TERM);
         assert(j->level2->type == MATCH_AND_TERM);
 
+        return 0;
+}
+
+static void match_free_empty_levels(sd_journal *j, Match *add_here) {
+        assert(j);
+
+        match_free_if_empty(add_here);
+        j->level2 = match_free_if_empty(j->level2);
+        j->level1 = match_free_if_empty(j->level1);
+        j->level0 = match_free_if_empty(j->level0);
+}
+
+_public_ int sd_journal_add_match(sd_journal *j, const void *data, size_t size) {
+        Match *add_here = NULL, *m = NULL;
+        uint64_t hash;
+
+        assert_return(j, -EINVAL);
+        assert_return(!journal_origin_changed(j), -ECHILD);
+        assert_return(data, -EINVAL);
+
+        /* If the size is unspecified, assume it's a string. Note: 0 is the public value we document for
+         * this, for historical reasons. Internally, we pretty widely started using SIZE_MAX for this in
+         * similar cases however, hence accept that too. And internally we actually prefer it, to make things
+         * less surprising. */
+        if (IN_SET(size, 0, SIZE_MAX))
+                size = strlen(data);
+
+        if (!match_is_valid(data, size))
+                return -EINVAL;
+
+        if (match_ensure_levels(j) < 0)
+                goto fail;
+
         /* Old-style Jenkins (unkeyed) hashing only here. We do not cover new-style siphash (keyed) hashing
          * here, since it's different for each file, and thus can't be pre-calculated in the Match object. */
         hash = jenkins_hash64(data, size);
@@ -279,11 +308,12 @@ _public_ int sd_journal_add_match(sd_journal *j, const void *data, size_t size)
                 assert(l3->type == MATCH_OR_TERM);
 
                 LIST_FOREACH(matches, l4, l3->matches) {
-                        assert(l4->type == MATCH_DISCRETE);
+                        assert(IN_SET(l4->type, MATCH_DISCRETE, MATCH_SET));
 
                         /* Exactly the same match already? Then ignore
                          * this addition */
-                        if (l4->hash == hash &&
+                        if (l4->type == MATCH_DISCRETE &&
+                            l4->hash == hash &&
                             l4->size == size &&
                             memcmp(l4->data, data, size) == 0)
                                 return 0;
@@ -320,11 +350,93 @@ _public_ int sd_journal_add_match(sd_journal *j, const void *data, size_t size)
         return 0;
 
 fail:
-        match_free(m);
-        match_free_if_empty(add_here);
-        j->level2 = match_free_if_empty(j->level2);
-        j->level1 = match_free_if_empty(j->level1);
-        j->level0 = match_free_if_empty(j->level0);
+        if (m)
+                match_free(m);
+        match_free_empty_levels(j, add_here);
+
+        return -ENOMEM;
+}
+
+_public_ int sd_journal_add_match_set(sd_journal *j, const char *field, const char **values) {
+        _cleanup_strv_free_ char **l = NULL;
+        _cleanup_free_ char *prefix = NULL;
+        Match *add_here = NULL, *m = NULL;
+        size_t n;
+
+        assert_return(j, -EINVAL);
+        assert_return(!journal_origin_changed(j), -ECHILD);
+        assert_return(field, -EINVAL);
+
+        /* Adds a disjunction of matches on one field in a single step. The result is the same as calling
+         * sd_journal_add_match() for each value, but the values are resolved only once per file and their
+         * entry arrays are merged with a heap, rather than being evaluated one by one for every step of the
+         * iteration. */
+
+        prefix = strjoin(field, "=");
+        if (!prefix)
+                return -ENOMEM;
+
+        STRV_FOREACH(v, (char**) values) {
+                char *t;
+
+                t = strjoin(prefix, *v);
+                if (!t)
+                        return -ENOMEM;
+
+                if (strv_consume(&l, t) < 0)
+                        return -ENOMEM;
+
+                if (!match_is_valid(t, strlen(t)))
+                        return -EINVAL;
+        }
+
+        strv_sort_uniq(l);
+
+        n = strv_length(l);
+        if (n == 0)
+                return 0;
+        if (n == 1)
+                return sd_journal_add_match(j, l[0], SIZE_MAX);
+
+        if (match_ensure_levels(j) < 0)
+                goto fail;
+
+        /* Join an OR term of the same field, so that this combines with sd_journal_add_match() as usual. */
+        LIST_FOREACH(matches, l3, j->level2->matches) {
+                assert(l3->type == MATCH_OR_TERM);
+
+                LIST_FOREACH(matches, l4, l3->matches)
+                        if (same_field(prefix, strlen(prefix), l4->data, l4->size)) {
+                                add_here = l3;
+                                break;
+                        }
+
+                if (add_here)
+                        break;
+        }
+
+        if (!add_here) {
+                add_here = match_new(j->level2, MATCH_OR_TERM);
+                if (!add_here)
+                        goto fail;
+        }
+
+        m = match_new(add_here, MATCH_SET);
+        if (!m)
+                goto fail;
+
+        m->size = strlen(prefix);
+        m->data = TAKE_PTR(prefix);
+        m->values = TAKE_PTR(l);
+
+        detach_location(j);
+
+        return 0;
+
+fail:
+        if (m)
+                match_free(m);
+        match_free_empty_levels(j, add_here);
 
         return -ENOMEM;
 }
@@ -409,6 +521,21 @@ static char *match_make_string(Match *m) {
         if (m->type == MATCH_DISCRETE)
                 return cescape_length(m->data, m->size);
 
+        if (m->type == MATCH_SET) {
+                STRV_FOREACH(v, m->values) {
+                        _cleanup_free_ char *t = NULL;
+
+                        t = cescape(*v);
+                        if (!t)
+                                return NULL;
+
+                        if (!strextend_with_separator(&p, " OR ", t))
+                                return NULL;
+                }
+
+                return strjoin("(", p, ")");
+        }
+
         LIST_FOREACH(matches, i, m->matches) {
                 _cleanup_free_ char *t = NULL;
 
@@ -449,6 +576,63 @@ _public_ void sd_journal_flush_matches(sd_journal *j) {
         detach_location(j);
 }
 
+static Match *match_copy(Match *parent, const Match *m) {
+        Match *c;
+
+        assert(m);
+
+        c = match_new(parent, m->type);
+        if (!c)
+                return NULL;
+
+        c->hash = m->hash;
+        c->size = m->size;
+
+        if (m->data) {
+                c->data = memdup(m->data, m->size);
+                if (!c->data)
+                        goto fail;
+        }
+
+        if (m->values) {
+                c->values = strv_copy(m->values);
+                if (!c->values)
+                        goto fail;
+        }
+
+        /* match_new() prepends, hence copy the terms back to front to keep their order */
+        LIST_FOREACH_BACKWARDS(matches, i, LIST_FIND_TAIL(matches, m->matches))
+                if (!match_copy(c, i))
+                        goto fail;
+
+        return c;
+
+fail:
+        match_free(c);
+        return NULL;
+}
+
+int journal_copy_matches(sd_journal *j, sd_journal *source) {
+        Match *m = NULL;
+
+        assert(j);
+        assert(source);
+
+        /* Replaces the matches of j by the ones of source, e.g. to evaluate them on another sd_journal
+         * object that covers some of the files of source. Further matches added start a new conjunction. */
+
+        if (source->level0) {
+                m = match_copy(NULL, source->level0);
+                if (!m)
+                        return -ENOMEM;
+        }
+
+        sd_journal_flush_matches(j);
+        j->level0 = m;
+
+        return 0;
+}
+
 static int newest_by_boot_id_compare(const NewestByBootId *a, const NewestByBootId *b) {
         return id128_compare_func(&a->boot_id, &b->boot_id);
 }
@@ -668,6 +852,226 @@ static int compare_with_location(
         return 0;
 }
 
+typedef struct MatchSetCursor {
+        MatchSetFile *file;
+        uint64_t data_offset;
+        uint64_t entry_offset; /* Next entry of this value in the iteration direction, 0 if there is none */
+        unsigned prioq_idx;
+} MatchSetCursor;
+
+/* The values of a set match that occur in a specific file, with a heap of their next entries. The cursors are
+ * positioned relative to after_offset in the given direction, and remain valid as long as the iteration keeps
+ * going in that direction and the file doesn't grow. */
+struct MatchSetFile {
+        uint64_t n_entries;
+        MatchSetCursor *cursors;
+        size_t n_cursors;
+        Prioq *queue;
+        direction_t direction;
+        uint64_t after_offset;
+};
+
+static MatchSetFile* match_set_file_free(MatchSetFile *s) {
+        if (!s)
+                return NULL;
+
+        prioq_free(s->queue);
+        free(s->cursors);
+        return mfree(s);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(MatchSetFile*, match_set_file_free);
+
+DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(
+                match_set_file_hash_ops,
+                void,
+                trivial_hash_func,
+                trivial_compare_func,
+                MatchSetFile,
+                match_set_file_free);
+
+static void match_forget_file(Match *m, JournalFile *f) {
+        assert(f);
+
+        if (!m)
+                return;
+
+        if (m->type == MATCH_SET)
+                match_set_file_free(hashmap_remove(m->set_files, f));
+
+        LIST_FOREACH(matches, i, m->matches)
+                match_forget_file(i, f);
+}
+
+static int match_set_cursor_compare(const void *a, const void *b) {
+        const MatchSetCursor *x = a, *y = b;
+        int r;
+
+        assert(x->file == y->file);
+
+        r = CMP(x->entry_offset, y->entry_offset);
+        return x->file->direction == DIRECTION_DOWN ? r : -r;
+}
+
+static int match_set_file_get(Match *m, JournalFile *f, MatchSetFile **ret) {
+        _cleanup_(match_set_file_freep) MatchSetFile *s = NULL;
+        MatchSetFile *existing;
+        int r;
+
+        assert(m);
+        assert(m->type == MATCH_SET);
+        assert(f);
+        assert(ret);
+
+        /* Entries are only ever appended, and a value that shows up in a file for the first time is followed
+         * by an entry referencing it, hence the resolved values are current as long as n_entries is. */
+        existing = hashmap_get(m->set_files, f);
+        if (existing && existing->n_entries == le64toh(f->header->n_entries)) {
+                *ret = existing;
+                return 0;
+        }
+
+        s = new(MatchSetFile, 1);
+        if (!s)
+                return -ENOMEM;
+
+        *s = (MatchSetFile) {
+                .n_entries = le64toh(f->header->n_entries),
+        };
+
+        STRV_FOREACH(v, m->values) {
+                size_t size = strlen(*v);
+                uint64_t dp;
+
+                r = journal_file_find_data_object(f, *v, size, NULL, &dp);
+                if (r < 0)
+                        return r;
+                if (r == 0)
+                        continue;
+
+                if (!GREEDY_REALLOC(s->cursors, s->n_cursors + 1))
+                        return -ENOMEM;
+
+                s->cursors[s->n_cursors++] = (MatchSetCursor) {
+                        .file = s,
+                        .data_offset = dp,
+                        .prioq_idx = PRIOQ_IDX_NULL,
+                };
+        }
+
+        /* The cursors are referenced by the queue, hence only link them once the array is final. */
+        s->queue = prioq_new(match_set_cursor_compare);
+        if (!s->queue)
+                return -ENOMEM;
+
+        r = hashmap_ensure_allocated(&m->set_files, &match_set_file_hash_ops);
+        if (r < 0)
+                return r;
+
+        r = hashmap_replace(m->set_files, f, s);
+        if (r < 0)
+                return r;
+
+        match_set_file_free(existing);
+
+        *ret = TAKE_PTR(s);
+        return 0;
+}
+
+static int match_set_cursor_seek(JournalFile *f, MatchSetCursor *c, uint64_t after_offset, direction_t direction) {
+        Object *d;
+        int r;
+
+        assert(f);
+        assert(c);
+
+        r = journal_file_move_to_object(f, OBJECT_DATA, c->data_offset, &d);
+        if (r < 0)
+                return r;
+
+        r = journal_file_move_to_entry_by_offset_for_data(f, d, after_offset, direction, NULL, &c->entry_offset);
+        if (r < 0)
+                return r;
+        if (r == 0)
+                c->entry_offset = 0;
+
+        return 0;
+}
+
+static int next_for_match_set(
+                Match *m,
+                JournalFile *f,
+                uint64_t after_offset,
+                direction_t direction,
+                uint64_t *ret_offset) {
+
+        MatchSetFile *s;
+        MatchSetCursor *c;
+        int r;
+
+        assert(m);
+        assert(f);
+        assert(ret_offset);
+
+        r = match_set_file_get(m, f, &s);
+        if (r < 0)
+                return r;
+
+        if (s->after_offset == 0 || s->direction != direction ||
+            (direction == DIRECTION_DOWN ? after_offset < s->after_offset : after_offset > s->after_offset)) {
+
+                /* We moved backwards relative to the cursors, hence position all of them afresh. */
+
+                while (prioq_pop(s->queue))
+                        ;
+
+                s->direction = direction;
+
+                FOREACH_ARRAY(i, s->cursors, s->n_cursors) {
+                        i->prioq_idx = PRIOQ_IDX_NULL;
+
+                        r = match_set_cursor_seek(f, i, after_offset, direction);
+                        if (r < 0)
+                                goto fail;
+                        if (i->entry_offset == 0)
+                                continue;
+
+                        r = prioq_put(s->queue, i, &i->prioq_idx);
+                        if (r < 0)
+                                goto fail;
+                }
+        } else
+                /* Only the values whose next entry we already passed need to move, all others still point to
+                 * their first entry beyond after_offset. */
+                while ((c = prioq_peek(s->queue)) &&
+                       (direction == DIRECTION_DOWN ? c->entry_offset < after_offset : c->entry_offset > after_offset)) {
+
+                        r = match_set_cursor_seek(f, c, after_offset, direction);
+                        if (r < 0)
+                                goto fail;
+
+                        if (c->entry_offset == 0) {
+                                assert_se(prioq_remove(s->queue, c, &c->prioq_idx) > 0);
+                                c->prioq_idx = PRIOQ_IDX_NULL;
+                        } else
+                                prioq_reshuffle(s->queue, c, &c->prioq_idx);
+                }
+
+        s->after_offset = after_offset;
+
+        c = prioq_peek(s->queue);
+        if (!c)
+                return 0;
+
+        *ret_offset = c->entry_offset;
+        return 1;
+
+fail:
+        /* Make sure the queue is rebuilt from scratch next time. */
+        s->after_offset = 0;
+        return r;
+}
+
 static int next_for_match(
                 sd_journal *j,
                 Match *m,
@@ -701,6 +1105,12 @@ static int next_for_match(
 
                 return journal_file_move_to_entry_by_offset_for_data(f, d, after_offset, direction, ret, offset);
 
+        } else if (m->type == MATCH_SET) {
+
+                r = next_for_match_set(m, f, after_offset, direction, &np);
+                if (r <= 0)
+                        return r;
+
         } else if (m->type == MATCH_OR_TERM) {
 
                 /* Find the earliest match beyond after_offset */
@@ -766,6 +1176,43 @@ static int next_for_match(
         return 1;
 }
 
+static int find_location_for_data(
+                sd_journal *j,
+                JournalFile *f,
+                Object *d,
+                uint64_t dp,
+                direction_t direction,
+                Object **ret,
+                uint64_t *offset) {
+
+        int r;
+
+        assert(j);
+        assert(f);
+        assert(d);
+
+        if (j->current_location.type == LOCATION_HEAD)
+                return direction == DIRECTION_DOWN ? journal_file_move_to_entry_for_data(f, d, DIRECTION_DOWN, ret, offset) : 0;
+        if (j->current_location.type == LOCATION_TAIL)
+                return direction == DIRECTION_UP ? journal_file_move_to_entry_for_data(f, d, DIRECTION_UP, ret, offset) : 0;
+        if (j->current_location.seqnum_set && sd_id128_equal(j->current_location.seqnum_id, f->header->seqnum_id))
+                return journal_file_move_to_entry_by_seqnum_for_data(f, d, j->current_location.seqnum, direction, ret, offset);
+        if (j->current_location.monotonic_set) {
+                r = journal_file_move_to_entry_by_monotonic_for_data(f, d, j->current_location.boot_id, j->current_location.monotonic, direction, ret, offset);
+                if (r != 0)
+                        return r;
+
+                /* The data object might have been invalidated. */
+                r = journal_file_move_to_object(f, OBJECT_DATA, dp, &d);
+                if (r < 0)
+                        return r;
+        }
+        if (j->current_location.realtime_set)
+                return journal_file_move_to_entry_by_realtime_for_data(f, d, j->current_location.realtime, direction, ret, offset);
+
+        return journal_file_move_to_entry_for_data(f, d, direction, ret, offset);
+}
+
 static int find_location_for_match(
                 sd_journal *j,
                 Match *m,
@@ -793,28 +1240,46 @@ static int find_location_for_match(
                 if (r <= 0)
                         return r;
 
-                /* FIXME: missing: find by monotonic */
+                return find_location_for_data(j, f, d, dp, direction, ret, offset);
 
-                if (j->current_location.type == LOCATION_HEAD)
-                        return direction == DIRECTION_DOWN ? journal_file_move_to_entry_for_data(f, d, DIRECTION_DOWN, ret, offset) : 0;
-                if (j->current_location.type == LOCATION_TAIL)
-                        return direction == DIRECTION_UP ? journal_file_move_to_entry_for_data(f, d, DIRECTION_UP, ret, offset) : 0;
-                if (j->current_location.seqnum_set && sd_id128_equal(j->current_location.seqnum_id, f->header->seqnum_id))
-                        return journal_file_move_to_entry_by_seqnum_for_data(f, d, j->current_location.seqnum, direction, ret, offset);
-                if (j->current_location.monotonic_set) {
-                        r = journal_file_move_to_entry_by_monotonic_for_data(f, d, j->current_location.boot_id, j->current_location.monotonic, direction, ret, offset);
-                        if (r != 0)
+        } else if (m->type == MATCH_SET) {
+                MatchSetFile *s;
+                uint64_t np = 0;
+
+                r = match_set_file_get(m, f, &s);
+                if (r < 0)
+                        return r;
+
+                /* Find the earliest match of any of the values */
+
+                FOREACH_ARRAY(i, s->cursors, s->n_cursors) {
+                        Object *d;
+                        uint64_t cp;
+
+                        r = journal_file_move_to_object(f, OBJECT_DATA, i->data_offset, &d);
+                        if (r < 0)
                                 return r;
 
-                        /* The data object might have been invalidated. */
-                        r = journal_file_move_to_object(f, OBJECT_DATA, dp, &d);
+                        r = find_location_for_data(j, f, d, i->data_offset, direction, NULL, &cp);
                         if (r < 0)
                                 return r;
+                        if (r > 0 && (np == 0 || (direction == DIRECTION_DOWN ? np > cp : np < cp)))
+                                np = cp;
                 }
-                if (j->current_location.realtime_set)
-                        return journal_file_move_to_entry_by_realtime_for_data(f, d, j->current_location.realtime, direction, ret, offset);
 
-                return journal_file_move_to_entry_for_data(f, d, direction, ret, offset);
+                if (np == 0)
+                        return 0;
+
+                if (ret) {
+                        r = journal_file_move_to_object(f, OBJECT_ENTRY, np, ret);
+                        if (r < 0)
+                                return r;
+                }
+
+                if (offset)
+                        *offset = np;
+
+                return 1;
 
         } else if (m->type == MATCH_OR_TERM) {
                 uint64_t np = 0;
@@ -1044,57 +1509,208 @@ static int compare_locations(sd_journal *j, JournalFile *af, JournalFile *bf) {
         if (r != 0)
                 return r;
 
-        /* Otherwise, compare UTC time */
-        r = CMP(af->current_realtime, bf->current_realtime);
-        if (r != 0)
-                return r;
+        /* Otherwise, compare UTC time */
+        r = CMP(af->current_realtime, bf->current_realtime);
+        if (r != 0)
+                return r;
+
+        /* Finally, compare by contents */
+        return CMP(af->current_xor_hash, bf->current_xor_hash);
+}
+
+static int files_by_location_compare(const void *a, const void *b) {
+        JournalFile *x = (JournalFile*) a, *y = (JournalFile*) b;
+        sd_journal *j = ASSERT_PTR(x->location_journal);
+        int r;
+
+        assert(y->location_journal == j);
+
+        /* The head of the queue is the file whose candidate entry comes next in the iteration direction. */
+        r = compare_locations(j, x, y);
+        return j->files_by_location_direction == DIRECTION_DOWN ? r : -r;
+}
+
+static void journal_clear_files_by_location(sd_journal *j) {
+        JournalFile *f;
+
+        assert(j);
+
+        /* Don't pop the entries, that would compare them, and some of them might not carry a candidate
+         * location anymore. */
+        PRIOQ_FOREACH_ITEM(j->files_by_location, f) {
+                f->location_prioq_idx = PRIOQ_IDX_NULL;
+                f->location_journal = NULL;
+        }
+
+        j->files_by_location = prioq_free(j->files_by_location);
+        j->files_at_eof = set_free(j->files_at_eof);
+        j->files_by_location_valid = false;
+}
+
+static int journal_file_queue_by_location(sd_journal *j, JournalFile *f, direction_t direction) {
+        int r;
+
+        assert(j);
+        assert(f);
+
+        /* Moves f to its next candidate entry, and updates its position in the queue accordingly. Returns
+         * > 0 if f has a candidate entry, 0 on EOF. */
+
+        r = next_beyond_location(j, f, direction);
+        if (r < 0) {
+                log_debug_errno(r, "Can't iterate through %s, ignoring: %m", f->path);
+                remove_file_real(j, f);
+                return 0;
+        }
+        if (r == 0) {
+                f->location_type = direction == DIRECTION_DOWN ? LOCATION_TAIL : LOCATION_HEAD;
+
+                if (!j->files_by_location_valid)
+                        return 0;
+
+                if (f->location_prioq_idx != PRIOQ_IDX_NULL) {
+                        assert_se(prioq_remove(j->files_by_location, f, &f->location_prioq_idx) > 0);
+                        f->location_prioq_idx = PRIOQ_IDX_NULL;
+                        f->location_journal = NULL;
+                }
+
+                /* Archived files will not grow anymore, there's no need to look at them again until the
+                 * location is reset. */
+                if (f->header->state != STATE_ARCHIVED) {
+                        r = set_ensure_put(&j->files_at_eof, NULL, f);
+                        if (r < 0)
+                                return r;
+                }
+
+                return 0;
+        }
+
+        if (!j->files_by_location_valid)
+                return 1;
 
-        /* Finally, compare by contents */
-        return CMP(af->current_xor_hash, bf->current_xor_hash);
+        (void) set_remove(j->files_at_eof, f);
+
+        if (f->location_prioq_idx == PRIOQ_IDX_NULL) {
+                f->location_journal = j;
+                r = prioq_ensure_put(&j->files_by_location, files_by_location_compare, f, &f->location_prioq_idx);
+                if (r < 0) {
+                        f->location_journal = NULL;
+                        return r;
+                }
+        } else
+                prioq_reshuffle(j->files_by_location, f, &f->location_prioq_idx);
+
+        return 1;
 }
 
-static int real_journal_next(sd_journal *j, direction_t direction) {
-        JournalFile *new_file = NULL;
+static int journal_rebuild_files_by_location(sd_journal *j, direction_t direction) {
         unsigned n_files;
         const void **files;
-        Object *o;
         int r;
 
-        assert_return(j, -EINVAL);
-        assert_return(!journal_origin_changed(j), -ECHILD);
+        assert(j);
+
+        journal_clear_files_by_location(j);
 
         r = iterated_cache_get(j->files_cache, NULL, &files, &n_files);
         if (r < 0)
                 return r;
 
-        FOREACH_ARRAY(_f, files, n_files) {
-                JournalFile *f = (JournalFile*) *_f;
-                bool found;
+        /* Position all files first. Files that fail to iterate are removed, which invalidates the queue,
+         * hence only build it afterwards. */
+        FOREACH_ARRAY(_f, files, n_files)
+                (void) journal_file_queue_by_location(j, (JournalFile*) *_f, direction);
 
-                r = next_beyond_location(j, f, direction);
+        j->files_by_location_direction = direction;
+        j->files_by_location_valid = true;
+
+        JournalFile *f;
+        ORDERED_HASHMAP_FOREACH(f, j->files) {
+                if (f->location_type == LOCATION_SEEK && f->last_direction == direction) {
+                        f->location_journal = j;
+                        r = prioq_ensure_put(&j->files_by_location, files_by_location_compare, f, &f->location_prioq_idx);
+                } else if (f->header->state != STATE_ARCHIVED)
+                        r = set_ensure_put(&j->files_at_eof, NULL, f);
+                else
+                        r = 0;
                 if (r < 0) {
-                        log_debug_errno(r, "Can't iterate through %s, ignoring: %m", f->path);
-                        remove_file_real(j, f);
-                        continue;
-                } else if (r == 0) {
-                        f->location_type = direction == DIRECTION_DOWN ? LOCATION_TAIL : LOCATION_HEAD;
-                        continue;
+                        journal_clear_files_by_location(j);
+                        return r;
                 }
+        }
 
-                if (!new_file)
-                        found = true;
-                else {
-                        int k;
+        return 0;
+}
 
-                        k = compare_locations(j, f, new_file);
+static int journal_advance_files_by_location(sd_journal *j, direction_t direction) {
+        JournalFile *f;
+        int r;
 
-                        found = direction == DIRECTION_DOWN ? k < 0 : k > 0;
-                }
+        assert(j);
+        assert(j->files_by_location_valid);
 
-                if (found)
-                        new_file = f;
+        /* Only the file we picked the current entry from moved, all others still point to their candidate
+         * entry, hence we only need to advance that one instead of looking at all files again. */
+        if (j->current_file) {
+                r = journal_file_queue_by_location(j, j->current_file, direction);
+                if (r < 0)
+                        return r;
+                if (!j->files_by_location_valid)
+                        return 0;
+        }
+
+        /* Files that are still being written to might have grown since we hit EOF on them. */
+        SET_FOREACH(f, j->files_at_eof) {
+                r = journal_file_queue_by_location(j, f, direction);
+                if (r < 0)
+                        return r;
+                if (!j->files_by_location_valid)
+                        return 0;
+        }
+
+        /* The same entry might be stored in multiple files, skip over those that are at the entry we just
+         * returned. */
+        while ((f = prioq_peek(j->files_by_location))) {
+                int k;
+
+                if (j->current_location.type != LOCATION_DISCRETE)
+                        break;
+
+                k = compare_with_location(j, f, &j->current_location, j->current_file);
+                if (direction == DIRECTION_DOWN ? k > 0 : k < 0)
+                        break;
+
+                r = journal_file_queue_by_location(j, f, direction);
+                if (r < 0)
+                        return r;
+                if (!j->files_by_location_valid)
+                        return 0;
+        }
+
+        return 0;
+}
+
+static int real_journal_next(sd_journal *j, direction_t direction) {
+        JournalFile *new_file;
+        Object *o;
+        int r;
+
+        assert_return(j, -EINVAL);
+        assert_return(!journal_origin_changed(j), -ECHILD);
+
+        if (j->files_by_location_valid && j->files_by_location_direction == direction) {
+                r = journal_advance_files_by_location(j, direction);
+                if (r < 0)
+                        return r;
+        }
+
+        if (!j->files_by_location_valid || j->files_by_location_direction != direction) {
+                r = journal_rebuild_files_by_location(j, direction);
+                if (r < 0)
+                        return r;
         }
 
+        new_file = prioq_peek(j->files_by_location);
         if (!new_file)
                 return 0;
 
@@ -1603,9 +2219,14 @@ static int add_any_file(
 
         f->last_seen_generation = j->generation;
 
+        /* The new file needs to be positioned relative to the current location before it can take part
+         * in picking the next entry. */
+        journal_clear_files_by_location(j);
+
         track_file_disposition(j, f);
         check_network(j, f->fd);
         (void) journal_file_read_tail_timestamp(j, f);
+        (void) journal_file_tail_changed(f);
 
         j->current_invalidate_counter++;
 
@@ -1677,6 +2298,40 @@ static int add_file_by_name(
         return add_any_file(j, -1, path);
 }
 
+static int modify_file_by_name(
+                sd_journal *j,
+                const char *prefix,
+                const char *filename) {
+
+        _cleanup_free_ char *path = NULL;
+        JournalFile *f;
+
+        assert(j);
+        assert(prefix);
+        assert(filename);
+
+        /* Writing to a file doesn't replace it, hence if we track it already there's no need to open it
+         * again to compare the inode as add_file_by_name() does. journald posts a modification for every
+         * batch of entries it writes, thus this is what followers get woken up for most of the time.
+         * Returns > 0 if the file changed. */
+
+        path = path_join(prefix, filename);
+        if (!path)
+                return -ENOMEM;
+
+        f = ordered_hashmap_get(j->files, path);
+        if (!f) {
+                (void) add_file_by_name(j, prefix, filename);
+                return 1;
+        }
+
+        if (!journal_file_tail_changed(f))
+                return 0;
+
+        (void) journal_file_read_tail_timestamp(j, f);
+        return 1;
+}
+
 static int remove_file_by_name(
                 sd_journal *j,
                 const char *prefix,
@@ -1705,6 +2360,10 @@ static void remove_file_real(sd_journal *j, JournalFile *f) {
         assert(j);
         assert(f);
 
+        /* Removing an arbitrary element from the queue would compare it with the entry we just picked,
+         * whose location is not a candidate anymore. Files are rarely removed, hence simply start over. */
+        journal_clear_files_by_location(j);
+
         (void) ordered_hashmap_remove(j->files, f->path);
 
         log_debug("File %s removed.", f->path);
@@ -1718,6 +2377,7 @@ static void remove_file_real(sd_journal *j, JournalFile *f) {
                 /* Jump to the next unique_file or NULL if that one was last */
                 j->unique_file = ordered_hashmap_next(j->files, j->unique_file->path);
                 j->unique_offset = 0;
+                j->unique_values = (JournalUniqueValues) {};
                 if (!j->unique_file)
                         j->unique_file_lost = true;
         }
@@ -1729,6 +2389,9 @@ static void remove_file_real(sd_journal *j, JournalFile *f) {
                         j->fields_file_lost = true;
         }
 
+        match_forget_file(j->level0, f);
+        journal_data_cache_forget_file(j->data_cache, f);
+
         journal_file_unlink_newest_by_boot_id(j, f);
         (void) journal_file_close(f);
 
@@ -2194,8 +2857,79 @@ static int allocate_inotify(sd_journal *j) {
         return 0;
 }
 
+static size_t data_cache_size_requested(void) {
+        const char *e;
+        uint64_t sz;
+        int r;
+
+        e = secure_getenv("SYSTEMD_JOURNAL_DATA_CACHE_SIZE");
+        if (!e)
+                return JOURNAL_DATA_CACHE_SIZE_DEFAULT;
+
+        r = parse_size(e, 1024, &sz);
+        if (r < 0 || sz > SIZE_MAX) {
+                log_debug_errno(r, "Failed to parse $SYSTEMD_JOURNAL_DATA_CACHE_SIZE, ignoring: %s", e);
+                return JOURNAL_DATA_CACHE_SIZE_DEFAULT;
+        }
+
+        return (size_t) sz;
+}
+
+/* The mmap cache shared by all journal objects of this thread opened with SD_JOURNAL_SHARE_CACHE. It is not
+ * referenced here, it's freed when the last of them is closed. */
+static thread_local MMapCache *shared_mmap_cache = NULL;
+static thread_local unsigned n_shared_mmap_cache_users = 0;
+static thread_local uint64_t shared_mmap_cache_origin_id = 0;
+
+static MMapCache* journal_get_mmap_cache(int flags) {
+        MMapCache *m;
+
+        if (!FLAGS_SET(flags, SD_JOURNAL_SHARE_CACHE))
+                return mmap_cache_new();
+
+        /* After fork() the journal objects of the parent are unusable, hence don't share their cache. */
+        if (shared_mmap_cache_origin_id != origin_id_query()) {
+                shared_mmap_cache = NULL;
+                n_shared_mmap_cache_users = 0;
+                shared_mmap_cache_origin_id = origin_id_query();
+        }
+
+        if (shared_mmap_cache)
+                m = mmap_cache_ref(shared_mmap_cache);
+        else {
+                m = mmap_cache_new();
+                if (!m)
+                        return NULL;
+
+                shared_mmap_cache = m;
+        }
+
+        n_shared_mmap_cache_users++;
+        return m;
+}
+
+static void journal_put_mmap_cache(sd_journal *j) {
+        assert(j);
+
+        if (!j->mmap)
+                return;
+
+        mmap_cache_stats_log_debug(j->mmap);
+
+        if (FLAGS_SET(j->flags, SD_JOURNAL_SHARE_CACHE)) {
+                assert(j->mmap == shared_mmap_cache);
+                assert(n_shared_mmap_cache_users > 0);
+
+                if (--n_shared_mmap_cache_users == 0)
+                        shared_mmap_cache = NULL;
+        }
+
+        j->mmap = mmap_cache_unref(j->mmap);
+}
+
 static sd_journal *journal_new(int flags, const char *path, const char *namespace) {
         _cleanup_(sd_journal_closep) sd_journal *j = NULL;
+        size_t cache_size;
 
         j = new(sd_journal, 1);
         if (!j)
@@ -2233,10 +2967,17 @@ static sd_journal *journal_new(int flags, const char *path, const char *namespac
                 return NULL;
 
         j->files_cache = ordered_hashmap_iterated_cache_new(j->files);
-        j->mmap = mmap_cache_new();
+        j->mmap = journal_get_mmap_cache(flags);
         if (!j->files_cache || !j->mmap)
                 return NULL;
 
+        cache_size = data_cache_size_requested();
+        if (cache_size > 0) {
+                j->data_cache = journal_data_cache_new(cache_size);
+                if (!j->data_cache)
+                        return NULL;
+        }
+
         return TAKE_PTR(j);
 }
 
@@ -2247,7 +2988,8 @@ static sd_journal *journal_new(int flags, const char *path, const char *namespac
          SD_JOURNAL_CURRENT_USER |                      \
          SD_JOURNAL_ALL_NAMESPACES |                    \
          SD_JOURNAL_INCLUDE_DEFAULT_NAMESPACE |         \
-         SD_JOURNAL_ASSUME_IMMUTABLE)
+         SD_JOURNAL_ASSUME_IMMUTABLE |                  \
+         SD_JOURNAL_SHARE_CACHE)
 
 _public_ int sd_journal_open_namespace(sd_journal **ret, const char *namespace, int flags) {
         _cleanup_(sd_journal_closep) sd_journal *j = NULL;
@@ -2275,7 +3017,8 @@ _public_ int sd_journal_open(sd_journal **ret, int flags) {
 #define OPEN_CONTAINER_ALLOWED_FLAGS                    \
         (SD_JOURNAL_LOCAL_ONLY |                        \
          SD_JOURNAL_SYSTEM |                            \
-         SD_JOURNAL_ASSUME_IMMUTABLE)
+         SD_JOURNAL_ASSUME_IMMUTABLE |                  \
+         SD_JOURNAL_SHARE_CACHE)
 
 _public_ int sd_journal_open_container(sd_journal **ret, const char *machine, int flags) {
         _cleanup_free_ char *root = NULL, *class = NULL;
@@ -2321,7 +3064,8 @@ _public_ int sd_journal_open_container(sd_journal **ret, const char *machine, in
         (SD_JOURNAL_OS_ROOT |                           \
          SD_JOURNAL_SYSTEM |                            \
          SD_JOURNAL_CURRENT_USER |                      \
-         SD_JOURNAL_ASSUME_IMMUTABLE)
+         SD_JOURNAL_ASSUME_IMMUTABLE |                  \
+         SD_JOURNAL_SHARE_CACHE)
 
 _public_ int sd_journal_open_directory(sd_journal **ret, const char *path, int flags) {
         _cleanup_(sd_journal_closep) sd_journal *j = NULL;
@@ -2347,7 +3091,8 @@ _public_ int sd_journal_open_directory(sd_journal **ret, const char *path, int f
 }
 
 #define OPEN_FILES_ALLOWED_FLAGS                        \
-        (SD_JOURNAL_ASSUME_IMMUTABLE)
+        (SD_JOURNAL_ASSUME_IMMUTABLE |                  \
+         SD_JOURNAL_SHARE_CACHE)
 
 _public_ int sd_journal_open_files(sd_journal **ret, const char **paths, int flags) {
         _cleanup_(sd_journal_closep) sd_journal *j = NULL;
@@ -2377,7 +3122,8 @@ _public_ int sd_journal_open_files(sd_journal **ret, const char **paths, int fla
          SD_JOURNAL_SYSTEM |                            \
          SD_JOURNAL_CURRENT_USER |                      \
          SD_JOURNAL_TAKE_DIRECTORY_FD |                 \
-         SD_JOURNAL_ASSUME_IMMUTABLE)
+         SD_JOURNAL_ASSUME_IMMUTABLE |                  \
+         SD_JOURNAL_SHARE_CACHE)
 
 _public_ int sd_journal_open_directory_fd(sd_journal **ret, int fd, int flags) {
         _cleanup_(sd_journal_closep) sd_journal *j = NULL;
@@ -2416,7 +3162,8 @@ _public_ int sd_journal_open_directory_fd(sd_journal **ret, int fd, int flags) {
 }
 
 #define OPEN_FILES_FD_ALLOWED_FLAGS                        \
-        (SD_JOURNAL_ASSUME_IMMUTABLE)
+        (SD_JOURNAL_ASSUME_IMMUTABLE |                  \
+         SD_JOURNAL_SHARE_CACHE)
 
 _public_ int sd_journal_open_files_fd(sd_journal **ret, int fds[], unsigned n_fds, int flags) {
         JournalFile *f;
@@ -2473,6 +3220,7 @@ _public_ void sd_journal_close(sd_journal *j) {
                 return;
 
         journal_clear_newest_by_boot_id(j);
+        journal_clear_files_by_location(j);
 
         sd_journal_flush_matches(j);
 
@@ -2487,9 +3235,11 @@ _public_ void sd_journal_close(sd_journal *j) {
 
         safe_close(j->inotify_fd);
 
-        if (j->mmap) {
-                mmap_cache_stats_log_debug(j->mmap);
-                mmap_cache_unref(j->mmap);
+        journal_put_mmap_cache(j);
+
+        if (j->data_cache) {
+                journal_data_cache_stats_log_debug(j->data_cache);
+                journal_data_cache_free(j->data_cache);
         }
 
         hashmap_free_free(j->errors);
@@ -2504,6 +3254,29 @@ _public_ void sd_journal_close(sd_journal *j) {
         free(j);
 }
 
+static bool journal_file_tail_changed(JournalFile *f) {
+        uint64_t n_entries, seqnum;
+        uint8_t state;
+
+        assert(f);
+        assert(f->header);
+
+        /* Tells whether entries were added to the file, or its state changed, since we last looked, from
+         * the header alone. */
+
+        n_entries = le64toh(READ_NOW(f->header->n_entries));
+        seqnum = le64toh(READ_NOW(f->header->tail_entry_seqnum));
+        state = READ_NOW(f->header->state);
+
+        if (n_entries == f->tail_n_entries && seqnum == f->tail_seqnum && state == f->tail_state)
+                return false;
+
+        f->tail_n_entries = n_entries;
+        f->tail_seqnum = seqnum;
+        f->tail_state = state;
+        return true;
+}
+
 static int journal_file_read_tail_timestamp(sd_journal *j, JournalFile *f) {
         uint64_t offset, mo, rt;
         sd_id128_t id;
@@ -2736,6 +3509,65 @@ static bool field_is_valid(const char *field) {
         return true;
 }
 
+static int journal_data_payload(
+                sd_journal *j,
+                JournalFile *f,
+                uint64_t offset,
+                const char *field,
+                size_t field_length,
+                void **ret_data,
+                size_t *ret_size) {
+
+        Object *o;
+        void *d;
+        size_t l;
+        int r;
+
+        assert(j);
+        assert(f);
+
+        /* Like journal_file_data_payload(), but serves compressed objects from the data cache if we have seen
+         * them before. Uncompressed payloads are returned straight from the file mapping anyway. */
+
+        if (!j->data_cache)
+                return journal_file_data_payload(f, NULL, offset, field, field_length, j->data_threshold, ret_data, ret_size);
+
+        r = journal_file_move_to_object(f, OBJECT_DATA, offset, &o);
+        if (r < 0)
+                return r;
+
+        if (COMPRESSION_FROM_OBJECT(o) == COMPRESSION_NONE)
+                return journal_file_data_payload(f, o, offset, field, field_length, j->data_threshold, ret_data, ret_size);
+
+        r = journal_data_cache_get(j->data_cache, f, offset, &d, &l);
+        if (r > 0) {
+                if (field && (l < field_length + 1 || memcmp(d, field, field_length) != 0 || ((char*) d)[field_length] != '='))
+                        return 0;
+
+                if (ret_data)
+                        *ret_data = d;
+                if (ret_size)
+                        *ret_size = l;
+                return 1;
+        }
+
+        /* On a miss with a field given, journal_file_data_payload() only decompresses the beginning of the
+         * payload if the field doesn't match, hence only objects that are actually returned are cached. */
+        r = journal_file_data_payload(f, o, offset, field, field_length, j->data_threshold, &d, &l);
+        if (r <= 0)
+                return r;
+
+        r = journal_data_cache_put(j->data_cache, f, offset, d, l, &d);
+        if (r < 0)
+                return r;
+
+        if (ret_data)
+                *ret_data = d;
+        if (ret_size)
+                *ret_size = l;
+        return 1;
+}
+
 _public_ int sd_journal_get_data(sd_journal *j, const char *field, const void **data, size_t *size) {
         JournalFile *f;
         size_t field_length;
@@ -2769,7 +3601,7 @@ _public_ int sd_journal_get_data(sd_journal *j, const char *field, const void **
                 size_t l;
 
                 p = journal_file_entry_item_object_offset(f, o, i);
-                r = journal_file_data_payload(f, NULL, p, field, field_length, j->data_threshold, &d, &l);
+                r = journal_data_payload(j, f, p, field, field_length, &d, &l);
                 if (r == 0)
                         continue;
                 if (IN_SET(r, -EADDRNOTAVAIL, -EBADMSG)) {
@@ -2815,7 +3647,7 @@ _public_ int sd_journal_enumerate_data(sd_journal *j, const void **data, size_t
                 size_t l;
 
                 p = journal_file_entry_item_object_offset(f, o, j->current_field);
-                r = journal_file_data_payload(f, NULL, p, NULL, 0, j->data_threshold, &d, &l);
+                r = journal_data_payload(j, f, p, NULL, 0, &d, &l);
                 if (IN_SET(r, -EADDRNOTAVAIL, -EBADMSG)) {
                         log_debug_errno(r, "Entry item %"PRIu64" data object is bad, skipping over it: %m", j->current_field);
                         continue;
@@ -2978,15 +3810,18 @@ static void process_q_overflow(sd_journal *j) {
         log_debug("Reiteration complete.");
 }
 
-static void process_inotify_event(sd_journal *j, const struct inotify_event *e) {
+static bool process_inotify_event(sd_journal *j, const struct inotify_event *e) {
         Directory *d;
 
         assert(j);
         assert(e);
 
+        /* Returns false if the event turned out to change nothing, i.e. a file was modified, but no entries
+         * were added to it. */
+
         if (e->mask & IN_Q_OVERFLOW) {
                 process_q_overflow(j);
-                return;
+                return true;
         }
 
         /* Is this a subdirectory we watch? */
@@ -2998,6 +3833,8 @@ static void process_inotify_event(sd_journal *j, const struct inotify_event *e)
 
                         /* Event for a journal file */
 
+                        if ((e->mask & (IN_CREATE|IN_MOVED_TO|IN_MODIFY|IN_ATTRIB)) == IN_MODIFY)
+                                return modify_file_by_name(j, d->path, e->name) != 0;
                         if (e->mask & (IN_CREATE|IN_MOVED_TO|IN_MODIFY|IN_ATTRIB))
                                 (void) add_file_by_name(j, d->path, e->name);
                         else if (e->mask & (IN_DELETE|IN_MOVED_FROM|IN_UNMOUNT))
@@ -3018,13 +3855,14 @@ static void process_inotify_event(sd_journal *j, const struct inotify_event *e)
                                 (void) add_directory(j, d->path, e->name);
                 }
 
-                return;
+                return true;
         }
 
         if (e->mask & IN_IGNORED)
-                return;
+                return false;
 
         log_debug("Unexpected inotify event.");
+        return false;
 }
 
 static int determine_change(sd_journal *j) {
@@ -3064,10 +3902,9 @@ _public_ int sd_journal_process(sd_journal *j) {
                         return -errno;
                 }
 
-                got_something = true;
-
                 FOREACH_INOTIFY_EVENT(e, buffer, l)
-                        process_inotify_event(j, e);
+                        if (process_inotify_event(j, e))
+                                got_something = true;
         }
 }
 
@@ -3252,6 +4089,48 @@ _public_ int sd_journal_get_usage(sd_journal *j, uint64_t *ret) {
         return 0;
 }
 
+_public_ int sd_journal_get_histogram(
+                sd_journal *j,
+                uint64_t since,
+                uint64_t until,
+                uint64_t bucket_usec,
+                uint64_t **ret_counts,
+                size_t *ret_n_buckets) {
+
+        _cleanup_free_ uint64_t *counts = NULL;
+        JournalFile *f;
+        uint64_t n;
+        int r;
+
+        assert_return(j, -EINVAL);
+        assert_return(!journal_origin_changed(j), -ECHILD);
+        assert_return(since < until, -EINVAL);
+        assert_return(bucket_usec > 0, -EINVAL);
+        assert_return(ret_counts, -EINVAL);
+
+        n = DIV_ROUND_UP(until - since, bucket_usec);
+        if (n > HISTOGRAM_N_BUCKETS_MAX)
+                return -E2BIG;
+
+        counts = new0(uint64_t, n * (LOG_DEBUG + 1));
+        if (!counts)
+                return -ENOMEM;
+
+        ORDERED_HASHMAP_FOREACH(f, j->files) {
+                r = journal_file_get_histogram(f, since, until, bucket_usec, counts, n);
+                if (r == -ENOMEM)
+                        return r;
+                if (r < 0)
+                        log_debug_errno(r, "Failed to count entries of %s, ignoring: %m", f->path);
+        }
+
+        *ret_counts = TAKE_PTR(counts);
+        if (ret_n_buckets)
+                *ret_n_buckets = n;
+
+        return 0;
+}
+
 _public_ int sd_journal_query_unique(sd_journal *j, const char *field) {
         int r;
 
@@ -3267,6 +4146,7 @@ _public_ int sd_journal_query_unique(sd_journal *j, const char *field) {
 
         j->unique_file = NULL;
         j->unique_offset = 0;
+        j->unique_values = (JournalUniqueValues) {};
         j->unique_file_lost = false;
 
         return 0;
@@ -3294,72 +4174,101 @@ _public_ int sd_journal_enumerate_unique(
                         return 0;
 
                 j->unique_offset = 0;
+                j->unique_values = (JournalUniqueValues) {};
         }
 
         for (;;) {
                 JournalFile *of;
-                Object *o;
-                void *odata;
+                Object *o = NULL;
+                const void *odata;
                 size_t ol;
                 bool found;
                 int r;
 
-                /* Proceed to next data object in the field's linked list */
-                if (j->unique_offset == 0) {
-                        r = journal_file_find_field_object(j->unique_file, j->unique_field, k, &o, NULL);
-                        if (r < 0)
-                                return r;
+                if (j->unique_values.object) {
+                        /* The file has a unique index for the field, take the values from there */
+                        if (j->unique_values_index >= j->unique_values.n_values) {
+                                j->unique_values = (JournalUniqueValues) {};
+                                j->unique_file = ordered_hashmap_next(j->files, j->unique_file->path);
+                                if (!j->unique_file)
+                                        return 0;
+
+                                continue;
+                        }
 
-                        j->unique_offset = r > 0 ? le64toh(o->field.head_data_offset) : 0;
+                        journal_unique_values_get(&j->unique_values, j->unique_values_index++, &odata, &ol);
                 } else {
-                        r = journal_file_move_to_object(j->unique_file, OBJECT_DATA, j->unique_offset, &o);
-                        if (r < 0)
-                                return r;
+                        void *payload;
+
+                        /* Proceed to next data object in the field's linked list */
+                        if (j->unique_offset == 0) {
+                                r = journal_file_get_unique_values(j->unique_file, j->unique_field, k, &j->unique_values);
+                                if (r < 0)
+                                        return r;
+                                if (r > 0) {
+                                        j->unique_values_index = 0;
+                                        continue;
+                                }
 
-                        j->unique_offset = le64toh(o->data.next_field_offset);
-                }
+                                r = journal_file_find_field_object(j->unique_file, j->unique_field, k, &o, NULL);
+                                if (r < 0)
+                                        return r;
 
-                /* We reached the end of the list? Then start again, with the next file */
-                if (j->unique_offset == 0) {
-                        j->unique_file = ordered_hashmap_next(j->files, j->unique_file->path);
-                        if (!j->unique_file)
-                                return 0;
+                                j->unique_offset = r > 0 ? le64toh(o->field.head_data_offset) : 0;
+                        } else {
+                                r = journal_file_move_to_object(j->unique_file, OBJECT_DATA, j->unique_offset, &o);
+                                if (r < 0)
+                                        return r;
 
-                        continue;
-                }
+                                j->unique_offset = le64toh(o->data.next_field_offset);
+                        }
 
-                r = journal_file_move_to_object(j->unique_file, OBJECT_DATA, j->unique_offset, &o);
-                if (r < 0)
-                        return r;
+                        /* We reached the end of the list? Then start again, with the next file */
+                        if (j->unique_offset == 0) {
+                                j->unique_file = ordered_hashmap_next(j->files, j->unique_file->path);
+                                if (!j->unique_file)
+                                        return 0;
 
-                /* Let's pin the data object, so we can look at it at the same time as one on another file. */
-                r = journal_file_pin_object(j->unique_file, o);
-                if (r < 0)
-                        return r;
+                                continue;
+                        }
 
-                r = journal_file_data_payload(j->unique_file, o, j->unique_offset, NULL, 0,
-                                              j->data_threshold, &odata, &ol);
-                if (r < 0)
-                        return r;
+                        r = journal_file_move_to_object(j->unique_file, OBJECT_DATA, j->unique_offset, &o);
+                        if (r < 0)
+                                return r;
 
-                /* Check if we have at least the field name and "=". */
-                if (ol <= k)
-                        return log_debug_errno(SYNTHETIC_ERRNO(EBADMSG),
-                                               "%s:offset " OFSfmt ": object has size %zu, expected at least %zu",
-                                               j->unique_file->path,
-                                               j->unique_offset, ol, k + 1);
+                        /* Let's pin the data object, so we can look at it at the same time as one on another file. */
+                        r = journal_file_pin_object(j->unique_file, o);
+                        if (r < 0)
+                                return r;
 
-                if (memcmp(odata, j->unique_field, k) != 0 || ((const char*) odata)[k] != '=')
-                        return log_debug_errno(SYNTHETIC_ERRNO(EBADMSG),
-                                               "%s:offset " OFSfmt ": object does not start with \"%s=\"",
-                                               j->unique_file->path,
-                                               j->unique_offset,
-                                               j->unique_field);
+                        r = journal_file_data_payload(j->unique_file, o, j->unique_offset, NULL, 0,
+                                                      j->data_threshold, &payload, &ol);
+                        if (r < 0)
+                                return r;
+
+                        odata = payload;
+
+                        /* Check if we have at least the field name and "=". */
+                        if (ol <= k)
+                                return log_debug_errno(SYNTHETIC_ERRNO(EBADMSG),
+                                                       "%s:offset " OFSfmt ": object has size %zu, expected at least %zu",
+                                                       j->unique_file->path,
+                                                       j->unique_offset, ol, k + 1);
+
+                        if (memcmp(odata, j->unique_field, k) != 0 || ((const char*) odata)[k] != '=')
+                                return log_debug_errno(SYNTHETIC_ERRNO(EBADMSG),
+                                                       "%s:offset " OFSfmt ": object does not start with \"%s=\"",
+                                                       j->unique_file->path,
+                                                       j->unique_offset,
+                                                       j->unique_field);
+                }
 
                 /* OK, now let's see if we already returned this data object by checking if it exists in the
                  * earlier traversed files. */
                 found = false;
                 ORDERED_HASHMAP_FOREACH(of, j->files) {
+                        JournalUniqueValues v;
+
                         if (of == j->unique_file)
                                 break;
 
@@ -3367,10 +4276,24 @@ _public_ int sd_journal_enumerate_unique(
                         if (JOURNAL_HEADER_CONTAINS(of->header, n_fields) && le64toh(of->header->n_fields) <= 0)
                                 continue;
 
+                        /* If the other file has a unique index for the field, a binary search over it is
+                         * cheaper than a hash table lookup. */
+                        r = journal_file_get_unique_values(of, j->unique_field, k, &v);
+                        if (r < 0)
+                                return r;
+                        if (r > 0) {
+                                if (journal_unique_values_contains(&v, odata, ol)) {
+                                        found = true;
+                                        break;
+                                }
+
+                                continue;
+                        }
+
                         /* We can reuse the hash from our current file only on old-style journal files
                          * without keyed hashes. On new-style files we have to calculate the hash anew, to
                          * take the per-file hash seed into consideration. */
-                        if (!JOURNAL_HEADER_KEYED_HASH(j->unique_file->header) && !JOURNAL_HEADER_KEYED_HASH(of->header))
+                        if (o && !JOURNAL_HEADER_KEYED_HASH(j->unique_file->header) && !JOURNAL_HEADER_KEYED_HASH(of->header))
                                 r = journal_file_find_data_object_with_hash(of, odata, ol, le64toh(o->data.hash), NULL, NULL);
                         else
                                 r = journal_file_find_data_object(of, odata, ol, NULL, NULL);
@@ -3412,6 +4335,7 @@ _public_ void sd_journal_restart_unique(sd_journal *j) {
 
         j->unique_file = NULL;
         j->unique_offset = 0;
+        j->unique_values = (JournalUniqueValues) {};
         j->unique_file_lost = false;
 }
 
@@ -0,0 +1,74 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include "journal-data-cache.h"
+#include "string-util.h"
+#include "tests.h"
+
+/* The cache only uses the file as part of the key, hence fake pointers are fine here. */
+#define FILE_A ((JournalFile*) UINT_TO_PTR(0x1000))
+#define FILE_B ((JournalFile*) UINT_TO_PTR(0x2000))
+
+TEST(get_put) {
+        _cleanup_(journal_data_cache_freep) JournalDataCache *c = NULL;
+        void *d;
+        size_t l;
+
+        ASSERT_NOT_NULL(c = journal_data_cache_new(64 * 1024));
+
+        ASSERT_EQ(journal_data_cache_get(c, FILE_A, 8, &d, &l), 0);
+
+        ASSERT_EQ(journal_data_cache_put(c, FILE_A, 8, "FOO=bar", 7, &d), 1);
+        ASSERT_TRUE(memcmp(d, "FOO=bar", 7) == 0);
+
+        /* The same offset in another file is a different object */
+        ASSERT_EQ(journal_data_cache_get(c, FILE_B, 8, &d, &l), 0);
+        ASSERT_EQ(journal_data_cache_put(c, FILE_B, 8, "BAR=foo", 7, NULL), 1);
+
+        ASSERT_EQ(journal_data_cache_get(c, FILE_A, 8, &d, &l), 1);
+        ASSERT_EQ(l, 7u);
+        ASSERT_STREQ(d, "FOO=bar");
+
+        ASSERT_EQ(journal_data_cache_get(c, FILE_B, 8, &d, &l), 1);
+        ASSERT_STREQ(d, "BAR=foo");
+
+        /* Adding the same object again is a NOP */
+        ASSERT_EQ(journal_data_cache_put(c, FILE_B, 8, "BAR=foo", 7, NULL), 0);
+
+        journal_data_cache_forget_file(c, FILE_A);
+        ASSERT_EQ(journal_data_cache_get(c, FILE_A, 8, &d, &l), 0);
+        ASSERT_EQ(journal_data_cache_get(c, FILE_B, 8, &d, &l), 1);
+
+        journal_data_cache_stats_log_debug(c);
+}
+
+TEST(eviction) {
+        _cleanup_(journal_data_cache_freep) JournalDataCache *c = NULL;
+        char buf[1024];
+        void *d;
+        size_t l;
+
+        memset(buf, 'x', sizeof(buf));
+
+        ASSERT_NOT_NULL(c = journal_data_cache_new(16 * 1024));
+
+        /* Larger than a quarter of the cache, not cached */
+        ASSERT_EQ(journal_data_cache_put(c, FILE_A, 1, buf, 4096, NULL), 0);
+        ASSERT_EQ(journal_data_cache_get(c, FILE_A, 1, &d, &l), 0);
+
+        for (uint64_t i = 1; i <= 64; i++)
+                ASSERT_EQ(journal_data_cache_put(c, FILE_A, i * 8, buf, sizeof(buf), NULL), 1);
+
+        /* The most recent entries survived, the oldest ones were evicted */
+        ASSERT_EQ(journal_data_cache_get(c, FILE_A, 64 * 8, &d, &l), 1);
+        ASSERT_EQ(l, sizeof(buf));
+        ASSERT_EQ(journal_data_cache_get(c, FILE_A, 1 * 8, &d, &l), 0);
+
+        /* Using an entry protects it from eviction */
+        ASSERT_EQ(journal_data_cache_get(c, FILE_A, 60 * 8, &d, &l), 1);
+        for (uint64_t i = 65; i <= 77; i++)
+                ASSERT_EQ(journal_data_cache_put(c, FILE_A, i * 8, buf, sizeof(buf), NULL), 1);
+        ASSERT_EQ(journal_data_cache_get(c, FILE_A, 60 * 8, &d, &l), 1);
+        ASSERT_EQ(journal_data_cache_get(c, FILE_A, 61 * 8, &d, &l), 0);
+}
+
+DEFINE_TEST_MAIN(LOG_DEBUG);
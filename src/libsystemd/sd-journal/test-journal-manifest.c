@@ -0,0 +1,189 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "alloc-util.h"
+#include "dirent-util.h"
+#include "fd-util.h"
+#include "io-util.h"
+#include "iovec-util.h"
+#include "journal-file-util.h"
+#include "journal-manifest.h"
+#include "journal-vacuum.h"
+#include "mmap-cache.h"
+#include "path-util.h"
+#include "rm-rf.h"
+#include "string-util.h"
+#include "tests.h"
+#include "tmpfile-util.h"
+
+static int put_entry(JournalManifest *m, const char *filename, ino_t inode, uint64_t usage) {
+        JournalManifestEntry *e;
+
+        ASSERT_NOT_NULL(e = new(JournalManifestEntry, 1));
+        *e = (JournalManifestEntry) {
+                .filename = strdup(filename),
+                .inode = inode,
+                .seqnum_id = SD_ID128_MAKE(01,02,03,04,05,06,07,08,09,0a,0b,0c,0d,0e,0f,10),
+                .head_seqnum = 1,
+                .tail_seqnum = 10,
+                .head_realtime = 1000,
+                .tail_realtime = 2000,
+                .n_entries = 10,
+                .usage = usage,
+        };
+        ASSERT_NOT_NULL(e->filename);
+
+        return journal_manifest_put(m, e);
+}
+
+TEST(save_load) {
+        _cleanup_(rm_rf_physical_and_freep) char *t = NULL;
+        _cleanup_(journal_manifest_freep) JournalManifest *m = NULL;
+        _cleanup_close_ int fd = -EBADF, afd = -EBADF;
+        JournalManifestEntry *e;
+
+        ASSERT_OK(fd = mkdtemp_open(NULL, 0, &t));
+
+        /* No manifest yet */
+        ASSERT_OK(journal_manifest_load(fd, &m));
+        ASSERT_EQ(hashmap_size(m->entries), 0u);
+        ASSERT_FALSE(m->dirty);
+
+        ASSERT_OK(put_entry(m, "system@a.journal", 4711, UINT64_MAX));
+        ASSERT_OK(put_entry(m, "system@b.journal", 4712, 8192));
+        ASSERT_OK(put_entry(m, "system@b.journal", 4713, 4096));
+        ASSERT_TRUE(m->dirty);
+        ASSERT_OK(journal_manifest_save(m, fd));
+        ASSERT_FALSE(m->dirty);
+        m = journal_manifest_free(m);
+
+        /* A torn write is skipped, and the manifest is rewritten when saved next time */
+        ASSERT_OK(afd = openat(fd, JOURNAL_MANIFEST_FILENAME, O_WRONLY|O_APPEND|O_CLOEXEC));
+        ASSERT_OK(loop_write(afd, "system@c.journal 4714 garbage", SIZE_MAX));
+
+        ASSERT_OK(journal_manifest_load(fd, &m));
+        ASSERT_EQ(hashmap_size(m->entries), 2u);
+        ASSERT_TRUE(m->dirty);
+
+        ASSERT_NOT_NULL(e = journal_manifest_get(m, "system@a.journal", 4711));
+        ASSERT_EQ(e->usage, UINT64_MAX);
+        ASSERT_EQ(e->head_seqnum, 1u);
+        ASSERT_EQ(e->tail_seqnum, 10u);
+        ASSERT_EQ(e->head_realtime, 1000u);
+        ASSERT_EQ(e->tail_realtime, 2000u);
+        ASSERT_EQ(e->n_entries, 10u);
+        ASSERT_TRUE(sd_id128_equal(e->seqnum_id, SD_ID128_MAKE(01,02,03,04,05,06,07,08,09,0a,0b,0c,0d,0e,0f,10)));
+
+        ASSERT_NOT_NULL(e = journal_manifest_get(m, "system@b.journal", 4713));
+        ASSERT_EQ(e->usage, 4096u);
+
+        /* A different inode means a different file */
+        ASSERT_NULL(journal_manifest_get(m, "system@b.journal", 4712));
+        ASSERT_NULL(journal_manifest_get(m, "system@c.journal", 4714));
+
+        journal_manifest_remove(m, "system@a.journal");
+        ASSERT_NULL(journal_manifest_get(m, "system@a.journal", 4711));
+        ASSERT_OK(journal_manifest_save(m, fd));
+        m = journal_manifest_free(m);
+
+        ASSERT_OK(journal_manifest_load(fd, &m));
+        ASSERT_EQ(hashmap_size(m->entries), 1u);
+        ASSERT_FALSE(m->dirty);
+}
+
+static unsigned count_journal_files(const char *directory) {
+        _cleanup_closedir_ DIR *d = NULL;
+        unsigned n = 0;
+
+        ASSERT_NOT_NULL(d = opendir(directory));
+
+        FOREACH_DIRENT(de, d, assert_not_reached())
+                if (endswith(de->d_name, ".journal"))
+                        n++;
+
+        return n;
+}
+
+TEST(vacuum) {
+        _cleanup_(rm_rf_physical_and_freep) char *t = NULL;
+        _cleanup_(journal_manifest_freep) JournalManifest *m = NULL;
+        _cleanup_(mmap_cache_unrefp) MMapCache *mmap_cache = NULL;
+        _cleanup_close_ int fd = -EBADF;
+        JournalManifestEntry *e;
+        dual_timestamp ts;
+        sd_id128_t boot_id;
+        uint64_t usage, generation;
+
+        /* journal_file_open() requires a valid machine id */
+        if (sd_id128_get_machine(NULL) < 0)
+                return (void) log_tests_skipped("No valid machine ID found");
+
+        ASSERT_OK(fd = mkdtemp_open(NULL, 0, &t));
+        ASSERT_NOT_NULL(mmap_cache = mmap_cache_new());
+
+        ASSERT_OK(sd_id128_randomize(&boot_id));
+        dual_timestamp_now(&ts);
+
+        for (unsigned i = 0; i < 4; i++) {
+                _cleanup_free_ char *fn = NULL;
+                struct iovec iovec;
+                JournalFile *f;
+
+                ASSERT_NOT_NULL(fn = path_join(t, "test.journal"));
+                ASSERT_OK(journal_file_open(-EBADF, fn, O_RDWR|O_CREAT, JOURNAL_COMPRESS, 0644,
+                                            UINT64_MAX, NULL, mmap_cache, NULL, &f));
+
+                ts.monotonic++;
+                ts.realtime++;
+                iovec = IOVEC_MAKE_STRING("MESSAGE=vacuum");
+                ASSERT_OK(journal_file_append_entry(f, &ts, &boot_id, &iovec, 1, NULL, NULL, NULL, NULL));
+
+                ASSERT_OK(journal_file_archive(f, NULL));
+                (void) journal_file_offline_close(f);
+        }
+
+        ASSERT_EQ(count_journal_files(t), 4u);
+
+        /* Archiving added the files to the manifest, but their disk usage is still unknown */
+        ASSERT_OK(journal_manifest_load(fd, &m));
+        ASSERT_EQ(hashmap_size(m->entries), 4u);
+        HASHMAP_FOREACH(e, m->entries) {
+                ASSERT_EQ(e->n_entries, 1u);
+                ASSERT_EQ(e->usage, UINT64_MAX);
+        }
+        m = journal_manifest_free(m);
+
+        ASSERT_OK(journal_directory_vacuum(t, 0, 2, 0, NULL, true));
+        ASSERT_EQ(count_journal_files(t), 2u);
+
+        /* The removed files are gone from the manifest, the others are complete now */
+        ASSERT_OK(journal_manifest_load(fd, &m));
+        ASSERT_EQ(hashmap_size(m->entries), 2u);
+        HASHMAP_FOREACH(e, m->entries)
+                ASSERT_NE(e->usage, UINT64_MAX);
+
+        ASSERT_OK(journal_directory_usage(t, &usage));
+        ASSERT_GT(usage, 0u);
+        m = journal_manifest_free(m);
+
+        /* The same in the background. The manifest is updated right away, the file might still be around. */
+        generation = journal_vacuum_generation();
+        ASSERT_GT(journal_directory_vacuum_full(t, 0, 1, 0, NULL, JOURNAL_VACUUM_ASYNC), 0);
+        ASSERT_OK(journal_manifest_load(fd, &m));
+        ASSERT_EQ(hashmap_size(m->entries), 1u);
+        m = journal_manifest_free(m);
+
+        /* Vacuuming again while the file might still be around must not count or remove it again */
+        ASSERT_OK(journal_directory_vacuum_full(t, 0, 1, 0, NULL, JOURNAL_VACUUM_ASYNC));
+        ASSERT_OK(journal_manifest_load(fd, &m));
+        ASSERT_EQ(hashmap_size(m->entries), 1u);
+
+        while (journal_vacuum_generation() == generation)
+                usleep_safe(10 * USEC_PER_MSEC);
+
+        ASSERT_EQ(count_journal_files(t), 1u);
+}
+
+DEFINE_TEST_MAIN(LOG_DEBUG);
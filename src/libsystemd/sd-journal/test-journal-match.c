@@ -8,11 +8,12 @@
 #include "journal-internal.h"
 #include "log.h"
 #include "string-util.h"
+#include "strv.h"
 #include "tests.h"
 
 int main(int argc, char *argv[]) {
-        _cleanup_(sd_journal_closep) sd_journal *j = NULL;
-        _cleanup_free_ char *t;
+        _cleanup_(sd_journal_closep) sd_journal *j = NULL, *k = NULL;
+        _cleanup_free_ char *t = NULL, *u = NULL;
 
         test_setup_logging(LOG_DEBUG);
 
@@ -57,5 +58,20 @@ int main(int argc, char *argv[]) {
 
         assert_se(streq(t, "(((L3=ok OR L3=yes) OR ((L4_2=ok OR L4_2=yes) AND (L4_1=ok OR L4_1=yes))) AND ((TWO=two AND (ONE=two OR ONE=one)) OR (PIFF=paff AND (QUUX=yyyyy OR QUUX=xxxxx OR QUUX=mmmm) AND (HALLO= OR HALLO=WALDO) AND B=C\\000D AND A=\\001\\002)))"));
 
+        /* A copy results in the same expression, and is independent of the original */
+        assert_se(sd_journal_open(&k, SD_JOURNAL_ASSUME_IMMUTABLE) >= 0);
+        assert_se(sd_journal_add_match(k, "FOO=bar", SIZE_MAX) >= 0);
+        assert_se(journal_copy_matches(k, j) >= 0);
+        sd_journal_flush_matches(j);
+        ASSERT_NOT_NULL(u = journal_make_match_string(k));
+        ASSERT_STREQ(u, t);
+
+        u = mfree(u);
+        assert_se(sd_journal_add_match_set(j, "SET", (const char**) STRV_MAKE("b", "a")) >= 0);
+        assert_se(sd_journal_add_match(j, "OTHER=x", SIZE_MAX) >= 0);
+        assert_se(journal_copy_matches(k, j) >= 0);
+        ASSERT_NOT_NULL(u = journal_make_match_string(k));
+        ASSERT_STREQ(u, "(OTHER=x AND (SET=a OR SET=b))");
+
         return 0;
 }
@@ -0,0 +1,119 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "sd-journal.h"
+
+#include "alloc-util.h"
+#include "chattr-util.h"
+#include "format-util.h"
+#include "iovec-util.h"
+#include "journal-file-util.h"
+#include "mmap-cache.h"
+#include "parse-util.h"
+#include "rm-rf.h"
+#include "string-util.h"
+#include "tests.h"
+#include "time-util.h"
+#include "tmpfile-util.h"
+
+/* This program measures how fast sd_journal_next() and sd_journal_previous() walk through entries that are
+ * interleaved across a growing number of journal files. */
+
+static uint64_t arg_n_entries = 100000;
+static unsigned arg_max_files = 256;
+
+static void populate(const char *directory, unsigned n_files) {
+        _cleanup_(mmap_cache_unrefp) MMapCache *m = NULL;
+        _cleanup_free_ JournalFile **files = NULL;
+        dual_timestamp ts;
+        sd_id128_t boot_id;
+
+        m = mmap_cache_new();
+        assert_se(m);
+
+        assert_se(files = new0(JournalFile*, n_files));
+
+        for (unsigned i = 0; i < n_files; i++) {
+                _cleanup_free_ char *fn = NULL;
+
+                assert_se(asprintf(&fn, "%s/bench-%u.journal", directory, i) >= 0);
+                assert_se(journal_file_open(-EBADF, fn, O_RDWR|O_CREAT, JOURNAL_COMPRESS, 0644,
+                                            UINT64_MAX, NULL, m, NULL, &files[i]) >= 0);
+        }
+
+        assert_se(sd_id128_randomize(&boot_id) >= 0);
+        dual_timestamp_now(&ts);
+
+        /* Distribute the entries round-robin, so that every step of the iteration has to switch files. */
+        for (uint64_t k = 0; k < arg_n_entries; k++) {
+                _cleanup_free_ char *p = NULL;
+                struct iovec iovec[2];
+
+                assert_se(asprintf(&p, "NUMBER=%" PRIu64, k) >= 0);
+                iovec[0] = IOVEC_MAKE_STRING(p);
+                iovec[1] = IOVEC_MAKE_STRING("MESSAGE=benchmark");
+
+                ts.monotonic++;
+                ts.realtime++;
+
+                assert_se(journal_file_append_entry(files[k % n_files], &ts, &boot_id, iovec, ELEMENTSOF(iovec),
+                                                    NULL, NULL, NULL, NULL) >= 0);
+        }
+
+        for (unsigned i = 0; i < n_files; i++)
+                (void) journal_file_offline_close(files[i]);
+}
+
+static void run(unsigned n_files) {
+        _cleanup_(rm_rf_physical_and_freep) char *t = NULL;
+        _cleanup_(sd_journal_closep) sd_journal *j = NULL;
+        uint64_t n;
+        usec_t start, down, up;
+
+        assert_se(mkdtemp_malloc("/var/tmp/journal-next-benchmark-XXXXXX", &t) >= 0);
+        (void) chattr_path(t, FS_NOCOW_FL, FS_NOCOW_FL, NULL);
+
+        populate(t, n_files);
+
+        assert_se(sd_journal_open_directory(&j, t, SD_JOURNAL_ASSUME_IMMUTABLE) >= 0);
+
+        assert_se(sd_journal_seek_head(j) >= 0);
+        start = now(CLOCK_MONOTONIC);
+        for (n = 0; sd_journal_next(j) > 0; n++)
+                ;
+        down = usec_sub_unsigned(now(CLOCK_MONOTONIC), start);
+        assert_se(n == arg_n_entries);
+
+        assert_se(sd_journal_seek_tail(j) >= 0);
+        start = now(CLOCK_MONOTONIC);
+        for (n = 0; sd_journal_previous(j) > 0; n++)
+                ;
+        up = usec_sub_unsigned(now(CLOCK_MONOTONIC), start);
+        assert_se(n == arg_n_entries);
+
+        printf("%5u files: %12.0f entries/s forward, %12.0f entries/s backward\n",
+               n_files,
+               (double) arg_n_entries * USEC_PER_SEC / MAX(down, 1u),
+               (double) arg_n_entries * USEC_PER_SEC / MAX(up, 1u));
+}
+
+int main(int argc, char *argv[]) {
+        test_setup_logging(LOG_INFO);
+
+        if (argc > 1)
+                assert_se(safe_atou64(argv[1], &arg_n_entries) >= 0);
+        if (argc > 2)
+                assert_se(safe_atou(argv[2], &arg_max_files) >= 0);
+
+        /* journal_file_open() requires a valid machine id */
+        if (sd_id128_get_machine(NULL) < 0)
+                return log_tests_skipped("No valid machine ID found");
+
+        for (unsigned n_files = 1; n_files <= arg_max_files; n_files *= 2)
+                run(n_files);
+
+        return 0;
+}
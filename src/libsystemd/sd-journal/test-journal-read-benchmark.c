@@ -0,0 +1,312 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "sd-journal.h"
+
+#include "alloc-util.h"
+#include "chattr-util.h"
+#include "dirent-util.h"
+#include "fd-util.h"
+#include "iovec-util.h"
+#include "journal-file-util.h"
+#include "mmap-cache.h"
+#include "parse-util.h"
+#include "random-util.h"
+#include "rm-rf.h"
+#include "stdio-util.h"
+#include "string-util.h"
+#include "tests.h"
+#include "time-util.h"
+#include "tmpfile-util.h"
+
+/* This program measures the read paths of sd-journal on synthetic journal files: iteration, seeking by
+ * time, match evaluation and enumeration of field values, both with a warm and a cold page cache. */
+
+static uint64_t arg_n_entries = 100000;
+static unsigned arg_n_files = 4;
+static unsigned arg_cardinality = 100;
+static unsigned arg_n_seeks = 1000;
+static bool arg_archive = true;
+
+static void populate(const char *directory, usec_t *ret_start, usec_t *ret_end) {
+        _cleanup_(mmap_cache_unrefp) MMapCache *m = NULL;
+        _cleanup_free_ JournalFile **files = NULL;
+        dual_timestamp ts;
+        sd_id128_t boot_id;
+        usec_t start, t;
+
+        m = mmap_cache_new();
+        assert_se(m);
+
+        assert_se(files = new0(JournalFile*, arg_n_files));
+
+        for (unsigned i = 0; i < arg_n_files; i++) {
+                _cleanup_free_ char *fn = NULL;
+
+                assert_se(asprintf(&fn, "%s/bench-%u.journal", directory, i) >= 0);
+                assert_se(journal_file_open(-EBADF, fn, O_RDWR|O_CREAT, JOURNAL_COMPRESS, 0644,
+                                            UINT64_MAX, NULL, m, NULL, &files[i]) >= 0);
+        }
+
+        assert_se(sd_id128_randomize(&boot_id) >= 0);
+        dual_timestamp_now(&ts);
+        start = ts.realtime;
+
+        /* Every file covers a contiguous part of the time range, like rotated files do. */
+        t = now(CLOCK_MONOTONIC);
+        for (uint64_t k = 0; k < arg_n_entries; k++) {
+                _cleanup_free_ char *number = NULL, *unit = NULL, *priority = NULL;
+                struct iovec iovec[4];
+
+                assert_se(asprintf(&number, "NUMBER=%" PRIu64, k) >= 0);
+                assert_se(asprintf(&unit, "UNIT=unit-%" PRIu64 ".service", random_u64_range(arg_cardinality)) >= 0);
+                assert_se(asprintf(&priority, "PRIORITY=%" PRIu64, random_u64_range(8)) >= 0);
+                iovec[0] = IOVEC_MAKE_STRING(number);
+                iovec[1] = IOVEC_MAKE_STRING(unit);
+                iovec[2] = IOVEC_MAKE_STRING(priority);
+                iovec[3] = IOVEC_MAKE_STRING("MESSAGE=Lorem ipsum dolor sit amet, consectetur adipiscing elit.");
+
+                ts.monotonic += USEC_PER_MSEC;
+                ts.realtime += USEC_PER_MSEC;
+
+                assert_se(journal_file_append_entry(files[k * arg_n_files / arg_n_entries], &ts, &boot_id,
+                                                    iovec, ELEMENTSOF(iovec), NULL, NULL, NULL, NULL) >= 0);
+        }
+        benchmark_report("append", arg_n_entries, usec_sub_unsigned(now(CLOCK_MONOTONIC), t));
+
+        for (unsigned i = 0; i < arg_n_files; i++) {
+                if (arg_archive)
+                        assert_se(journal_file_archive(files[i], NULL) >= 0);
+
+                (void) journal_file_offline_close(files[i]);
+        }
+
+        *ret_start = start + USEC_PER_MSEC;
+        *ret_end = ts.realtime;
+}
+
+static void drop_caches(const char *directory) {
+        _cleanup_closedir_ DIR *d = NULL;
+
+        /* The files were fsync()ed when they were closed, hence their pages are clean and can be dropped. */
+        assert_se(d = opendir(directory));
+
+        FOREACH_DIRENT(de, d, assert_not_reached()) {
+                _cleanup_close_ int fd = -EBADF;
+
+                if (!endswith(de->d_name, ".journal"))
+                        continue;
+
+                fd = openat(dirfd(d), de->d_name, O_RDONLY|O_CLOEXEC);
+                assert_se(fd >= 0);
+
+                assert_se(posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0);
+        }
+}
+
+static void bench_next(const char *directory, const char *label) {
+        _cleanup_(sd_journal_closep) sd_journal *j = NULL;
+        uint64_t n;
+        usec_t t;
+
+        t = now(CLOCK_MONOTONIC);
+        assert_se(sd_journal_open_directory(&j, directory, SD_JOURNAL_ASSUME_IMMUTABLE) >= 0);
+
+        assert_se(sd_journal_seek_head(j) >= 0);
+        for (n = 0; sd_journal_next(j) > 0; n++)
+                ;
+        t = usec_sub_unsigned(now(CLOCK_MONOTONIC), t);
+        assert_se(n == arg_n_entries);
+
+        benchmark_report(strjoina("next/", label), n, t);
+}
+
+static void bench_seek(const char *directory, usec_t start, usec_t end) {
+        _cleanup_(sd_journal_closep) sd_journal *j = NULL;
+        usec_t t;
+
+        assert_se(sd_journal_open_directory(&j, directory, SD_JOURNAL_ASSUME_IMMUTABLE) >= 0);
+
+        t = now(CLOCK_MONOTONIC);
+        for (unsigned i = 0; i < arg_n_seeks; i++) {
+                assert_se(sd_journal_seek_realtime_usec(j, start + random_u64_range(end - start + 1)) >= 0);
+                assert_se(sd_journal_next(j) > 0);
+        }
+        t = usec_sub_unsigned(now(CLOCK_MONOTONIC), t);
+
+        benchmark_report("seek_realtime_usec", arg_n_seeks, t);
+}
+
+static void bench_match(const char *directory, unsigned n_terms) {
+        _cleanup_(sd_journal_closep) sd_journal *j = NULL;
+        char scenario[STRLEN("match/") + DECIMAL_STR_MAX(unsigned)];
+        uint64_t n;
+        usec_t t;
+
+        assert_se(sd_journal_open_directory(&j, directory, SD_JOURNAL_ASSUME_IMMUTABLE) >= 0);
+
+        /* Terms beyond the cardinality match nothing, which is the common case for unit matches. */
+        for (unsigned i = 0; i < n_terms; i++) {
+                _cleanup_free_ char *unit = NULL;
+
+                assert_se(asprintf(&unit, "UNIT=unit-%u.service", i) >= 0);
+                assert_se(sd_journal_add_match(j, unit, SIZE_MAX) >= 0);
+        }
+
+        t = now(CLOCK_MONOTONIC);
+        assert_se(sd_journal_seek_head(j) >= 0);
+        for (n = 0; sd_journal_next(j) > 0; n++)
+                ;
+        t = usec_sub_unsigned(now(CLOCK_MONOTONIC), t);
+
+        /* Reported per matching entry */
+        xsprintf(scenario, "match/%u", n_terms);
+        benchmark_report(scenario, n, t);
+}
+
+static void bench_unique(const char *directory, const char *field) {
+        _cleanup_(sd_journal_closep) sd_journal *j = NULL;
+        const void *data;
+        size_t size;
+        uint64_t n = 0;
+        usec_t t;
+
+        assert_se(sd_journal_open_directory(&j, directory, SD_JOURNAL_ASSUME_IMMUTABLE) >= 0);
+
+        t = now(CLOCK_MONOTONIC);
+        assert_se(sd_journal_query_unique(j, field) >= 0);
+        SD_JOURNAL_FOREACH_UNIQUE(j, data, size)
+                n++;
+        t = usec_sub_unsigned(now(CLOCK_MONOTONIC), t);
+
+        benchmark_report(strjoina("enumerate_unique/", field), n, t);
+}
+
+static int help(void) {
+        printf("%s [OPTIONS...]\n\n"
+               "Benchmark the read paths of sd-journal on synthetic journal files.\n\n"
+               "  -h --help               Show this help\n"
+               "     --entries=N          Number of entries to generate (default: %" PRIu64 ")\n"
+               "     --files=N            Number of journal files to spread them over (default: %u)\n"
+               "     --cardinality=N      Number of distinct values of the UNIT= field (default: %u)\n"
+               "     --seeks=N            Number of random seeks to measure (default: %u)\n"
+               "     --no-archive         Don't archive the files after writing them\n",
+               program_invocation_short_name,
+               arg_n_entries,
+               arg_n_files,
+               arg_cardinality,
+               arg_n_seeks);
+
+        return 0;
+}
+
+static int parse_argv(int argc, char *argv[]) {
+        enum {
+                ARG_ENTRIES = 0x1000,
+                ARG_FILES,
+                ARG_CARDINALITY,
+                ARG_SEEKS,
+                ARG_NO_ARCHIVE,
+        };
+
+        static const struct option options[] = {
+                { "help",        no_argument,       NULL, 'h'             },
+                { "entries",     required_argument, NULL, ARG_ENTRIES     },
+                { "files",       required_argument, NULL, ARG_FILES       },
+                { "cardinality", required_argument, NULL, ARG_CARDINALITY },
+                { "seeks",       required_argument, NULL, ARG_SEEKS       },
+                { "no-archive",  no_argument,       NULL, ARG_NO_ARCHIVE  },
+                {}
+        };
+
+        int c, r;
+
+        assert(argc >= 0);
+        assert(argv);
+
+        while ((c = getopt_long(argc, argv, "h", options, NULL)) >= 0)
+                switch (c) {
+
+                case 'h':
+                        return help();
+
+                case ARG_ENTRIES:
+                        r = safe_atou64(optarg, &arg_n_entries);
+                        if (r < 0 || arg_n_entries <= 0)
+                                return log_error_errno(r < 0 ? r : SYNTHETIC_ERRNO(EINVAL), "Invalid number of entries: %s", optarg);
+                        break;
+
+                case ARG_FILES:
+                        r = safe_atou(optarg, &arg_n_files);
+                        if (r < 0 || arg_n_files <= 0)
+                                return log_error_errno(r < 0 ? r : SYNTHETIC_ERRNO(EINVAL), "Invalid number of files: %s", optarg);
+                        break;
+
+                case ARG_CARDINALITY:
+                        r = safe_atou(optarg, &arg_cardinality);
+                        if (r < 0 || arg_cardinality <= 0)
+                                return log_error_errno(r < 0 ? r : SYNTHETIC_ERRNO(EINVAL), "Invalid cardinality: %s", optarg);
+                        break;
+
+                case ARG_SEEKS:
+                        r = safe_atou(optarg, &arg_n_seeks);
+                        if (r < 0)
+                                return log_error_errno(r, "Invalid number of seeks: %s", optarg);
+                        break;
+
+                case ARG_NO_ARCHIVE:
+                        arg_archive = false;
+                        break;
+
+                case '?':
+                        return -EINVAL;
+
+                default:
+                        assert_not_reached();
+                }
+
+        return 1;
+}
+
+int main(int argc, char *argv[]) {
+        _cleanup_(rm_rf_physical_and_freep) char *t = NULL;
+        usec_t start, end;
+        unsigned n_terms;
+        int r;
+
+        test_setup_logging(LOG_INFO);
+
+        r = parse_argv(argc, argv);
+        if (r <= 0)
+                return r < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+
+        /* journal_file_open() requires a valid machine id */
+        if (sd_id128_get_machine(NULL) < 0)
+                return log_tests_skipped("No valid machine ID found");
+
+        assert_se(mkdtemp_malloc("/var/tmp/journal-read-benchmark-XXXXXX", &t) >= 0);
+        (void) chattr_path(t, FS_NOCOW_FL, FS_NOCOW_FL, NULL);
+
+        populate(t, &start, &end);
+
+        printf("%" PRIu64 " entries in %u %s files, %u distinct units\n",
+               arg_n_entries, arg_n_files, arg_archive ? "archived" : "offline", arg_cardinality);
+
+        drop_caches(t);
+        bench_next(t, "cold");
+        bench_next(t, "warm");
+
+        bench_seek(t, start, end);
+
+        FOREACH_ARGUMENT(n_terms, 1, 10, 1000)
+                bench_match(t, n_terms);
+
+        bench_unique(t, "UNIT");
+        bench_unique(t, "PRIORITY");
+
+        return EXIT_SUCCESS;
+}
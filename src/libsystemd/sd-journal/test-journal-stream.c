@@ -14,6 +14,7 @@
 #include "macro.h"
 #include "parse-util.h"
 #include "rm-rf.h"
+#include "strv.h"
 #include "tests.h"
 
 #define N_ENTRIES 200
@@ -168,6 +169,50 @@ static void run_test(void) {
 
         verify_contents(j, 0);
 
+        printf("NEXT TEST\n");
+        sd_journal_flush_matches(j);
+        {
+                _cleanup_strv_free_ char **values = NULL;
+                unsigned n = 0;
+
+                /* Every tenth entry, plus values that don't occur in any file */
+                for (i = 0; i < N_ENTRIES + 50; i += 10)
+                        assert_se(strv_extendf(&values, "%u", i) >= 0);
+
+                assert_se(sd_journal_add_match_set(j, "NUMBER", (const char**) values) >= 0);
+
+                assert_se(z = journal_make_match_string(j));
+                printf("resulting match expression is: %s\n", z);
+                free(z);
+
+                verify_contents(j, 10);
+
+                SD_JOURNAL_FOREACH_BACKWARDS(j)
+                        n++;
+                assert_se(n == N_ENTRIES / 10);
+        }
+
+        printf("NEXT TEST\n");
+        sd_journal_flush_matches(j);
+        {
+                _cleanup_strv_free_ char **values = NULL;
+
+                /* Every fifth entry, split over a set and a discrete match on the same field, combined with
+                 * a match on another field. */
+                for (i = 5; i < N_ENTRIES; i += 5)
+                        assert_se(strv_extendf(&values, "%u", i) >= 0);
+
+                assert_se(sd_journal_add_match(j, "MAGIC=quux", SIZE_MAX) >= 0);
+                assert_se(sd_journal_add_match_set(j, "NUMBER", (const char**) values) >= 0);
+                assert_se(sd_journal_add_match(j, "NUMBER=0", SIZE_MAX) >= 0);
+
+                assert_se(z = journal_make_match_string(j));
+                printf("resulting match expression is: %s\n", z);
+                free(z);
+
+                verify_contents(j, 5);
+        }
+
         assert_se(sd_journal_query_unique(j, "NUMBER") >= 0);
         SD_JOURNAL_FOREACH_UNIQUE(j, data, l)
                 printf("%.*s\n", (int) l, (const char*) data);
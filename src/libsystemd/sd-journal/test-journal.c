@@ -3,13 +3,17 @@
 #include <fcntl.h>
 #include <unistd.h>
 
+#include "sd-journal.h"
+
 #include "chattr-util.h"
 #include "iovec-util.h"
 #include "journal-authenticate.h"
 #include "journal-file-util.h"
 #include "journal-vacuum.h"
+#include "journal-verify.h"
 #include "log.h"
 #include "rm-rf.h"
+#include "strv.h"
 #include "tests.h"
 
 static bool arg_keep = false;
@@ -100,8 +104,8 @@ static void test_non_empty_one(void) {
 
         assert_se(journal_file_move_to_entry_by_seqnum(f, 10, DIRECTION_DOWN, &o, NULL) == 0);
 
-        journal_file_rotate(&f, m, JOURNAL_SEAL|JOURNAL_COMPRESS, UINT64_MAX, NULL);
-        journal_file_rotate(&f, m, JOURNAL_SEAL|JOURNAL_COMPRESS, UINT64_MAX, NULL);
+        journal_file_rotate(&f, m, JOURNAL_SEAL|JOURNAL_COMPRESS, UINT64_MAX, NULL, NULL);
+        journal_file_rotate(&f, m, JOURNAL_SEAL|JOURNAL_COMPRESS, UINT64_MAX, NULL, NULL);
 
         (void) journal_file_offline_close(f);
 
@@ -174,6 +178,502 @@ TEST(empty) {
         test_empty_one();
 }
 
+static void test_bloom_filter_one(void) {
+        _cleanup_(mmap_cache_unrefp) MMapCache *m = NULL;
+        dual_timestamp ts;
+        JournalFile *f;
+        unsigned n_false_positives = 0;
+        char t[] = "/var/tmp/journal-XXXXXX";
+
+        m = mmap_cache_new();
+        assert_se(m != NULL);
+
+        mkdtemp_chdir_chattr(t);
+
+        assert_se(journal_file_open(-EBADF, "test.journal", O_RDWR|O_CREAT, JOURNAL_COMPRESS, 0666, UINT64_MAX, NULL, m, NULL, &f) == 0);
+
+        for (unsigned i = 0; i < 1000; i++) {
+                _cleanup_free_ char *q = NULL;
+                struct iovec iovec[2];
+
+                assert_se(asprintf(&q, "NUMBER=%u", i) >= 0);
+                iovec[0] = IOVEC_MAKE_STRING(q);
+                iovec[1] = IOVEC_MAKE_STRING(i % 2 == 0 ? "PARITY=even" : "PARITY=odd");
+
+                assert_se(dual_timestamp_now(&ts));
+                assert_se(journal_file_append_entry(f, &ts, NULL, iovec, ELEMENTSOF(iovec), NULL, NULL, NULL, NULL) == 0);
+        }
+
+        /* No filter before the file is archived */
+        assert_se(f->header->bloom_filter_offset == 0);
+        assert_se(journal_file_bloom_filter_test(f, 0) > 0);
+
+        assert_se(JOURNAL_HEADER_INDEXES(f->header));
+        assert_se(journal_file_archive(f, NULL) >= 0);
+        assert_se(f->header->bloom_filter_offset != 0);
+
+        journal_file_print_header(f);
+
+        assert_se(journal_file_find_data_object(f, "PARITY=even", STRLEN("PARITY=even"), NULL, NULL) == 1);
+        assert_se(journal_file_find_data_object(f, "PARITY=odd", STRLEN("PARITY=odd"), NULL, NULL) == 1);
+        assert_se(journal_file_find_data_object(f, "PARITY=none", STRLEN("PARITY=none"), NULL, NULL) == 0);
+
+        /* There must be no false negatives, and only few false positives. */
+        for (unsigned i = 0; i < 2000; i++) {
+                _cleanup_free_ char *q = NULL;
+                uint64_t h;
+
+                assert_se(asprintf(&q, "NUMBER=%u", i) >= 0);
+                h = journal_file_hash_data(f, q, strlen(q));
+
+                if (i < 1000)
+                        assert_se(journal_file_bloom_filter_test(f, h) > 0);
+                else if (journal_file_bloom_filter_test(f, h) > 0)
+                        n_false_positives++;
+        }
+
+        log_info("Bloom filter false positives: %u/1000", n_false_positives);
+        assert_se(n_false_positives < 50);
+
+        assert_se(journal_file_verify(f, NULL, NULL, NULL, NULL, false) >= 0);
+
+        (void) journal_file_offline_close(f);
+
+        if (arg_keep)
+                log_info("Not removing %s", t);
+        else
+                assert_se(rm_rf(t, REMOVE_ROOT|REMOVE_PHYSICAL) >= 0);
+}
+
+TEST(bloom_filter) {
+        assert_se(setenv("SYSTEMD_JOURNAL_COMPACT", "0", 1) >= 0);
+        test_bloom_filter_one();
+
+        assert_se(setenv("SYSTEMD_JOURNAL_COMPACT", "1", 1) >= 0);
+        test_bloom_filter_one();
+}
+
+static void append_unique_index_entries(JournalFile *f, unsigned from, unsigned to) {
+        dual_timestamp ts;
+
+        for (unsigned i = from; i < to; i++) {
+                _cleanup_free_ char *number = NULL, *parity = NULL;
+                struct iovec iovec[2];
+
+                assert_se(asprintf(&number, "NUMBER=%u", i) >= 0);
+                assert_se(asprintf(&parity, "PARITY=%s", i % 3 == 0 ? "three" : i % 2 == 0 ? "even" : "odd") >= 0);
+                iovec[0] = IOVEC_MAKE_STRING(number);
+                iovec[1] = IOVEC_MAKE_STRING(parity);
+
+                assert_se(dual_timestamp_now(&ts));
+                assert_se(journal_file_append_entry(f, &ts, NULL, iovec, ELEMENTSOF(iovec), NULL, NULL, NULL, NULL) == 0);
+        }
+}
+
+static unsigned count_unique(sd_journal *j, const char *field) {
+        const void *data;
+        size_t size;
+        unsigned n = 0;
+
+        assert_se(sd_journal_query_unique(j, field) >= 0);
+        while (sd_journal_enumerate_unique(j, &data, &size) > 0) {
+                assert_se(size > strlen(field));
+                assert_se(memcmp(data, field, strlen(field)) == 0);
+                n++;
+        }
+
+        return n;
+}
+
+TEST(unique_index) {
+        _cleanup_(mmap_cache_unrefp) MMapCache *m = NULL;
+        _cleanup_(sd_journal_closep) sd_journal *j = NULL;
+        JournalUniqueValues v;
+        JournalFile *f, *g;
+        const void *data;
+        size_t size;
+        char t[] = "/var/tmp/journal-XXXXXX";
+
+        m = mmap_cache_new();
+        assert_se(m != NULL);
+
+        mkdtemp_chdir_chattr(t);
+
+        assert_se(journal_file_open(-EBADF, "one.journal", O_RDWR|O_CREAT, JOURNAL_COMPRESS, 0666, UINT64_MAX, NULL, m, NULL, &f) == 0);
+        assert_se(journal_file_open(-EBADF, "two.journal", O_RDWR|O_CREAT, JOURNAL_COMPRESS, 0666, UINT64_MAX, NULL, m, NULL, &g) == 0);
+
+        append_unique_index_entries(f, 0, 2000);
+        append_unique_index_entries(g, 1000, 3000);
+
+        /* No index before the file is archived */
+        assert_se(journal_file_get_unique_values(f, "PARITY", STRLEN("PARITY"), &v) == 0);
+
+        assert_se(journal_file_archive(f, NULL) >= 0);
+        assert_se(f->header->unique_index_offset != 0);
+
+        journal_file_print_header(f);
+
+        assert_se(journal_file_get_unique_values(f, "PARITY", STRLEN("PARITY"), &v) > 0);
+        assert_se(v.n_values == 3);
+        journal_unique_values_get(&v, 0, &data, &size);
+        assert_se(memcmp_nn(data, size, "PARITY=even", STRLEN("PARITY=even")) == 0);
+        assert_se(journal_unique_values_contains(&v, "PARITY=odd", STRLEN("PARITY=odd")));
+        assert_se(journal_unique_values_contains(&v, "PARITY=three", STRLEN("PARITY=three")));
+        assert_se(!journal_unique_values_contains(&v, "PARITY=none", STRLEN("PARITY=none")));
+        assert_se(!journal_unique_values_contains(&v, "PARITY=", STRLEN("PARITY=")));
+
+        /* Fields with too many values, and fields that do not exist, are not covered */
+        assert_se(journal_file_get_unique_values(f, "NUMBER", STRLEN("NUMBER"), &v) == 0);
+        assert_se(journal_file_get_unique_values(f, "PARIT", STRLEN("PARIT"), &v) == 0);
+        assert_se(journal_file_get_unique_values(f, "PARITYX", STRLEN("PARITYX"), &v) == 0);
+
+        assert_se(journal_file_verify(f, NULL, NULL, NULL, NULL, false) >= 0);
+
+        (void) journal_file_offline_close(f);
+        (void) journal_file_offline_close(g);
+
+        /* Enumerating must give the same results whether files have an index or not */
+        assert_se(sd_journal_open_directory(&j, t, 0) >= 0);
+        assert_se(count_unique(j, "PARITY") == 3);
+        assert_se(count_unique(j, "NUMBER") == 3000);
+        assert_se(count_unique(j, "NONEXISTENT") == 0);
+
+        if (arg_keep)
+                log_info("Not removing %s", t);
+        else
+                assert_se(rm_rf(t, REMOVE_ROOT|REMOVE_PHYSICAL) >= 0);
+}
+
+TEST(histogram) {
+        _cleanup_(mmap_cache_unrefp) MMapCache *m = NULL;
+        _cleanup_(sd_journal_closep) sd_journal *j = NULL;
+        _cleanup_free_ uint64_t *counts = NULL;
+        uint64_t a[4 * (LOG_DEBUG + 1)] = {}, b[4 * (LOG_DEBUG + 1)] = {};
+        dual_timestamp ts;
+        JournalFile *f;
+        usec_t start;
+        size_t n;
+        char t[] = "/var/tmp/journal-XXXXXX";
+
+        m = mmap_cache_new();
+        assert_se(m != NULL);
+
+        mkdtemp_chdir_chattr(t);
+
+        assert_se(journal_file_open(-EBADF, "test.journal", O_RDWR|O_CREAT, JOURNAL_COMPRESS, 0666, UINT64_MAX, NULL, m, NULL, &f) == 0);
+
+        /* One entry every 10s for 4 minutes, priorities cycling, plus one entry without a priority */
+        assert_se(dual_timestamp_now(&ts));
+        start = ts.realtime - ts.realtime % USEC_PER_MINUTE;
+        for (unsigned i = 0; i < 24; i++) {
+                _cleanup_free_ char *priority = NULL;
+                struct iovec iovec[2];
+
+                assert_se(asprintf(&priority, "PRIORITY=%u", i % 8) >= 0);
+                iovec[0] = IOVEC_MAKE_STRING("MESSAGE=histogram");
+                iovec[1] = IOVEC_MAKE_STRING(priority);
+
+                ts.realtime = start + i * 10 * USEC_PER_SEC;
+                ts.monotonic++;
+                assert_se(journal_file_append_entry(f, &ts, NULL, iovec, ELEMENTSOF(iovec), NULL, NULL, NULL, NULL) == 0);
+        }
+
+        ts.monotonic++;
+        assert_se(journal_file_append_entry(f, &ts, NULL, &IOVEC_MAKE_STRING("MESSAGE=no priority"), 1, NULL, NULL, NULL, NULL) == 0);
+
+        assert_se(f->header->histogram_offset != 0);
+
+        /* Aligned to minutes, answered from the histogram */
+        assert_se(journal_file_get_histogram(f, start, start + 4 * USEC_PER_MINUTE, USEC_PER_MINUTE, a, 4) == 1);
+        for (unsigned k = 0; k < 4; k++)
+                for (unsigned priority = 0; priority <= LOG_DEBUG; priority++) {
+                        unsigned expected = 0;
+
+                        for (unsigned i = k * 6; i < (k + 1) * 6; i++)
+                                if (i % 8 == priority)
+                                        expected++;
+
+                        assert_se(a[k * (LOG_DEBUG + 1) + priority] == expected);
+                }
+
+        /* Not aligned, answered by looking at the entries. Shift by a second, which doesn't move any entry
+         * into another interval, hence the result must be the same. */
+        assert_se(journal_file_get_histogram(f, start - USEC_PER_SEC, start + 4 * USEC_PER_MINUTE - USEC_PER_SEC, USEC_PER_MINUTE, b, 4) == 0);
+        assert_se(memcmp(a, b, sizeof(a)) == 0);
+
+        assert_se(journal_file_verify(f, NULL, NULL, NULL, NULL, false) >= 0);
+
+        (void) journal_file_offline_close(f);
+
+        assert_se(sd_journal_open_directory(&j, t, 0) >= 0);
+        assert_se(sd_journal_get_histogram(j, start, start + 4 * USEC_PER_MINUTE, 2 * USEC_PER_MINUTE, &counts, &n) >= 0);
+        assert_se(n == 2);
+        for (unsigned priority = 0; priority <= LOG_DEBUG; priority++) {
+                assert_se(counts[priority] == a[priority] + a[(LOG_DEBUG + 1) + priority]);
+                assert_se(counts[(LOG_DEBUG + 1) + priority] == a[2 * (LOG_DEBUG + 1) + priority] + a[3 * (LOG_DEBUG + 1) + priority]);
+        }
+
+        if (arg_keep)
+                log_info("Not removing %s", t);
+        else
+                assert_se(rm_rf(t, REMOVE_ROOT|REMOVE_PHYSICAL) >= 0);
+}
+
+TEST(boot_index) {
+        _cleanup_(mmap_cache_unrefp) MMapCache *m = NULL;
+        _cleanup_free_ JournalBootRange *a = NULL, *b = NULL;
+        sd_id128_t boot_ids[3];
+        dual_timestamp ts;
+        size_t n_a, n_b;
+        JournalFile *f;
+        char t[] = "/var/tmp/journal-XXXXXX";
+
+        m = mmap_cache_new();
+        assert_se(m != NULL);
+
+        mkdtemp_chdir_chattr(t);
+
+        assert_se(journal_file_open(-EBADF, "test.journal", O_RDWR|O_CREAT, JOURNAL_COMPRESS, 0666, UINT64_MAX, NULL, m, NULL, &f) == 0);
+
+        FOREACH_ELEMENT(id, boot_ids)
+                assert_se(sd_id128_randomize(id) >= 0);
+
+        /* Ten entries for each boot, the second boot comes back after the third one */
+        assert_se(dual_timestamp_now(&ts));
+        for (unsigned i = 0; i < 40; i++) {
+                unsigned k = i < 30 ? i / 10 : 1;
+                _cleanup_free_ char *q = NULL;
+                struct iovec iovec[2];
+
+                assert_se(q = strjoin("_BOOT_ID=", SD_ID128_TO_STRING(boot_ids[k])));
+                iovec[0] = IOVEC_MAKE_STRING("MESSAGE=boot index");
+                iovec[1] = IOVEC_MAKE_STRING(q);
+
+                ts.realtime += USEC_PER_SEC;
+                ts.monotonic = i * USEC_PER_SEC;
+                assert_se(journal_file_append_entry(f, &ts, &boot_ids[k], iovec, ELEMENTSOF(iovec), NULL, NULL, NULL, NULL) == 0);
+        }
+
+        /* Computed from the _BOOT_ID= data objects */
+        assert_se(journal_file_get_boot_ranges(f, &a, &n_a) == 0);
+        assert_se(n_a == 3);
+        assert_se(sd_id128_equal(a[0].boot_id, boot_ids[0]));
+        assert_se(a[0].head_seqnum == 1 && a[0].tail_seqnum == 10);
+        assert_se(sd_id128_equal(a[1].boot_id, boot_ids[1]));
+        assert_se(a[1].head_seqnum == 11 && a[1].tail_seqnum == 40);
+        assert_se(sd_id128_equal(a[2].boot_id, boot_ids[2]));
+        assert_se(a[2].head_seqnum == 21 && a[2].tail_seqnum == 30);
+        assert_se(a[2].tail_realtime - a[2].head_realtime == 9 * USEC_PER_SEC);
+
+        assert_se(journal_file_archive(f, NULL) >= 0);
+        assert_se(f->header->boot_index_offset != 0);
+
+        /* Read from the index, with the same results */
+        assert_se(journal_file_get_boot_ranges(f, &b, &n_b) == 1);
+        assert_se(n_b == n_a);
+        assert_se(memcmp(a, b, n_a * sizeof(JournalBootRange)) == 0);
+
+        assert_se(journal_file_verify(f, NULL, NULL, NULL, NULL, false) >= 0);
+
+        (void) journal_file_offline_close(f);
+
+        if (arg_keep)
+                log_info("Not removing %s", t);
+        else
+                assert_se(rm_rf(t, REMOVE_ROOT|REMOVE_PHYSICAL) >= 0);
+}
+
+static void test_append_entries_one(void) {
+        _cleanup_(mmap_cache_unrefp) MMapCache *m = NULL;
+        _cleanup_free_ JournalAppendEntry *entries = NULL;
+        _cleanup_free_ JournalCopyEntry *copies = NULL;
+        _cleanup_strv_free_ char **numbers = NULL;
+        struct iovec *iovecs;
+        dual_timestamp ts;
+        JournalFile *f, *to;
+        sd_id128_t boot_id;
+        uint64_t p = 0;
+        size_t n;
+        char t[] = "/var/tmp/journal-XXXXXX";
+        unsigned i;
+        Object *o;
+
+        const unsigned n_entries = 1000;
+
+        m = mmap_cache_new();
+        assert_se(m != NULL);
+
+        mkdtemp_chdir_chattr(t);
+
+        assert_se(journal_file_open(-EBADF, "test.journal", O_RDWR|O_CREAT, JOURNAL_COMPRESS, 0666, UINT64_MAX, NULL, m, NULL, &f) == 0);
+        assert_se(journal_file_open(-EBADF, "copy.journal", O_RDWR|O_CREAT, JOURNAL_COMPRESS, 0666, UINT64_MAX, NULL, m, NULL, &to) == 0);
+
+        assert_se(entries = new(JournalAppendEntry, n_entries));
+        assert_se(iovecs = newa(struct iovec, n_entries * 2));
+        assert_se(sd_id128_randomize(&boot_id) >= 0);
+        assert_se(dual_timestamp_now(&ts));
+
+        for (i = 0; i < n_entries; i++) {
+                assert_se(strv_extendf(&numbers, "NUMBER=%u", i) >= 0);
+
+                iovecs[i * 2] = IOVEC_MAKE_STRING(numbers[i]);
+                iovecs[i * 2 + 1] = IOVEC_MAKE_STRING("MESSAGE=batch");
+
+                entries[i] = (JournalAppendEntry) {
+                        .ts = &ts,
+                        .boot_id = &boot_id,
+                        .iovec = iovecs + i * 2,
+                        .n_iovec = 2,
+                };
+        }
+
+        assert_se(journal_file_append_entries(f, entries, n_entries, NULL, NULL, &n) == 0);
+        assert_se(n == n_entries);
+        assert_se(le64toh(f->header->n_entries) == n_entries);
+
+        /* The global entry array was sized for the whole batch at once */
+        assert_se(journal_file_move_to_object(f, OBJECT_ENTRY_ARRAY, le64toh(f->header->entry_array_offset), &o) >= 0);
+        assert_se(journal_file_entry_array_n_items(f, o) >= n_entries);
+        assert_se(o->entry_array.next_entry_array_offset == 0);
+
+        /* An invalid entry stops the batch, and the entries before it are kept */
+        entries[1].boot_id = &SD_ID128_NULL;
+        assert_se(journal_file_append_entries(f, entries, 3, NULL, NULL, &n) == -EBADMSG);
+        assert_se(n == 1);
+        assert_se(le64toh(f->header->n_entries) == n_entries + 1);
+
+        assert_se(copies = new(JournalCopyEntry, n_entries + 1));
+
+        for (i = 0; journal_file_next_entry(f, p, DIRECTION_DOWN, &o, &p) > 0; i++) {
+                assert_se(i < n_entries + 1);
+                assert_se(le64toh(o->entry.seqnum) == i + 1);
+
+                copies[i] = (JournalCopyEntry) {
+                        .file = f,
+                        .offset = p,
+                };
+        }
+        assert_se(i == n_entries + 1);
+
+        assert_se(journal_file_copy_entries(to, copies, i, NULL, NULL, &n) == 0);
+        assert_se(n == i);
+        assert_se(le64toh(to->header->n_entries) == i);
+
+        assert_se(journal_file_find_data_object(to, "NUMBER=999", STRLEN("NUMBER=999"), NULL, NULL) == 1);
+        assert_se(journal_file_find_data_object(to, "NUMBER=1000", STRLEN("NUMBER=1000"), NULL, NULL) == 0);
+
+        assert_se(journal_file_verify(f, NULL, NULL, NULL, NULL, false) >= 0);
+        assert_se(journal_file_verify(to, NULL, NULL, NULL, NULL, false) >= 0);
+
+        (void) journal_file_offline_close(f);
+        (void) journal_file_offline_close(to);
+
+        if (arg_keep)
+                log_info("Not removing %s", t);
+        else
+                assert_se(rm_rf(t, REMOVE_ROOT|REMOVE_PHYSICAL) >= 0);
+}
+
+TEST(append_entries) {
+        assert_se(setenv("SYSTEMD_JOURNAL_COMPACT", "0", 1) >= 0);
+        test_append_entries_one();
+
+        assert_se(setenv("SYSTEMD_JOURNAL_COMPACT", "1", 1) >= 0);
+        test_append_entries_one();
+}
+
+static void test_compact_one(void) {
+        _cleanup_(mmap_cache_unrefp) MMapCache *m = NULL;
+        _cleanup_free_ char *path = NULL;
+        uint64_t p = 0, q = 0, size;
+        JournalFile *f, *g;
+        Object *o, *u;
+        char t[] = "/var/tmp/journal-XXXXXX";
+        unsigned i;
+
+        m = mmap_cache_new();
+        assert_se(m != NULL);
+
+        mkdtemp_chdir_chattr(t);
+
+        assert_se(journal_file_open(-EBADF, "test.journal", O_RDWR|O_CREAT, JOURNAL_COMPRESS, 0666, UINT64_MAX, NULL, m, NULL, &f) == 0);
+
+        for (i = 0; i < 1000; i++) {
+                _cleanup_free_ char *number = NULL;
+                struct iovec iovec[3];
+
+                assert_se(asprintf(&number, "NUMBER=%u", i) >= 0);
+                iovec[0] = IOVEC_MAKE_STRING(number);
+                iovec[1] = IOVEC_MAKE_STRING(i % 2 == 0 ? "PARITY=even" : "PARITY=odd");
+                iovec[2] = IOVEC_MAKE_STRING("MESSAGE=compact");
+
+                assert_se(journal_file_append_entry(f, NULL, NULL, iovec, ELEMENTSOF(iovec), NULL, NULL, NULL, NULL) == 0);
+        }
+
+        /* Only archived files may be compacted */
+        assert_se(journal_file_compact(f, m, NULL) == -EBUSY);
+
+        assert_se(journal_file_archive(f, NULL) >= 0);
+        assert_se(path = strdup(f->path));
+        (void) journal_file_offline_close(f);
+
+        assert_se(journal_file_open(-EBADF, path, O_RDONLY, 0, 0, UINT64_MAX, NULL, m, NULL, &f) == 0);
+        assert_se(journal_file_compact(f, m, &size) >= 0);
+        assert_se(size > 0);
+
+        assert_se(journal_file_open(-EBADF, path, O_RDONLY, 0, 0, UINT64_MAX, NULL, m, NULL, &g) == 0);
+        journal_file_print_header(g);
+
+        assert_se(g->header->state == STATE_ARCHIVED);
+        assert_se(sd_id128_equal(f->header->seqnum_id, g->header->seqnum_id));
+        assert_se(sd_id128_equal(f->header->machine_id, g->header->machine_id));
+        assert_se(le64toh(g->header->n_entries) == 1000);
+        assert_se(le64toh(f->header->head_entry_seqnum) == le64toh(g->header->head_entry_seqnum));
+        assert_se(le64toh(f->header->tail_entry_seqnum) == le64toh(g->header->tail_entry_seqnum));
+
+        /* The entries are identical and in the same order */
+        for (i = 0; journal_file_next_entry(f, p, DIRECTION_DOWN, &o, &p) > 0; i++) {
+                uint64_t seqnum = le64toh(o->entry.seqnum), xor_hash = le64toh(o->entry.xor_hash);
+
+                assert_se(journal_file_next_entry(g, q, DIRECTION_DOWN, &u, &q) > 0);
+                assert_se(le64toh(u->entry.seqnum) == seqnum);
+                assert_se(le64toh(u->entry.xor_hash) == xor_hash);
+        }
+        assert_se(i == 1000);
+        assert_se(journal_file_next_entry(g, q, DIRECTION_DOWN, &u, &q) == 0);
+
+        /* Both the global entry array and the one of the data object referenced by all entries don't
+         * need to be chained */
+        assert_se(journal_file_move_to_object(g, OBJECT_ENTRY_ARRAY, le64toh(g->header->entry_array_offset), &o) >= 0);
+        assert_se(o->entry_array.next_entry_array_offset == 0);
+
+        assert_se(journal_file_find_data_object(g, "MESSAGE=compact", STRLEN("MESSAGE=compact"), &u, NULL) == 1);
+        assert_se(le64toh(u->data.n_entries) == 1000);
+        assert_se(journal_file_move_to_object(g, OBJECT_ENTRY_ARRAY, le64toh(u->data.entry_array_offset), &o) >= 0);
+        assert_se(o->entry_array.next_entry_array_offset == 0);
+
+        assert_se(journal_file_find_data_object(g, "PARITY=odd", STRLEN("PARITY=odd"), &u, NULL) == 1);
+        assert_se(le64toh(u->data.n_entries) == 500);
+
+        assert_se(journal_file_verify(g, NULL, NULL, NULL, NULL, false) >= 0);
+
+        (void) journal_file_close(f);
+        (void) journal_file_close(g);
+
+        if (arg_keep)
+                log_info("Not removing %s", t);
+        else
+                assert_se(rm_rf(t, REMOVE_ROOT|REMOVE_PHYSICAL) >= 0);
+}
+
+TEST(compact) {
+        assert_se(setenv("SYSTEMD_JOURNAL_COMPACT", "0", 1) >= 0);
+        test_compact_one();
+
+        assert_se(setenv("SYSTEMD_JOURNAL_COMPACT", "1", 1) >= 0);
+        test_compact_one();
+}
+
 #if HAVE_COMPRESSION
 static bool check_compressed(uint64_t compress_threshold, uint64_t data_size) {
         _cleanup_(mmap_cache_unrefp) MMapCache *m = NULL;
@@ -265,8 +765,141 @@ TEST(min_compress_size) {
         assert_se(setenv("SYSTEMD_JOURNAL_COMPACT", "1", 1) >= 0);
         test_min_compress_size_one();
 }
+
+#if HAVE_ZSTD
+static void append_messages(JournalFile *f, unsigned n) {
+        dual_timestamp ts;
+
+        for (unsigned i = 0; i < n; i++) {
+                _cleanup_free_ char *q = NULL;
+                struct iovec iovec[2];
+
+                assert_se(asprintf(&q, "MESSAGE=Started session %u of user %s, with the default target being reached.", i, i % 3 == 0 ? "root" : "nobody") >= 0);
+                iovec[0] = IOVEC_MAKE_STRING(q);
+                iovec[1] = IOVEC_MAKE_STRING("CODE_FILE=src/login/logind-session.c");
+
+                assert_se(dual_timestamp_now(&ts));
+                assert_se(journal_file_append_entry(f, &ts, NULL, iovec, ELEMENTSOF(iovec), NULL, NULL, NULL, NULL) == 0);
+        }
+}
+
+TEST(zstd_dictionary) {
+        _cleanup_(mmap_cache_unrefp) MMapCache *m = NULL;
+        JournalFile *f;
+        char t[] = "/var/tmp/journal-XXXXXX";
+        unsigned n_compressed = 0;
+        uint64_t p;
+        Object *o;
+
+        m = mmap_cache_new();
+        assert_se(m != NULL);
+
+        mkdtemp_chdir_chattr(t);
+
+        assert_se(journal_file_open(-EBADF, "test.journal", O_RDWR|O_CREAT, JOURNAL_COMPRESS|JOURNAL_ZSTD_DICTIONARY, 0666, UINT64_MAX, NULL, m, NULL, &f) == 0);
+        if (JOURNAL_FILE_COMPRESSION(f) != COMPRESSION_ZSTD) {
+                assert_se(!JOURNAL_HEADER_ZSTD_DICTIONARY(f->header));
+                log_tests_skipped("Journal files are not compressed with ZSTD");
+                goto finish;
+        }
+        assert_se(JOURNAL_HEADER_ZSTD_DICTIONARY(f->header));
+
+        append_messages(f, 2000);
+
+        /* The dictionary has to be in place before the first DATA object */
+        assert_se(journal_file_set_zstd_dictionary(f, "x", 1) == -EBUSY);
+
+        /* The rotated file gets a dictionary trained from the archived one */
+        assert_se(journal_file_rotate(&f, m, JOURNAL_COMPRESS|JOURNAL_ZSTD_DICTIONARY, UINT64_MAX, NULL, NULL) >= 0);
+        if (f->header->zstd_dictionary_offset == 0) {
+                log_tests_skipped("Could not train a ZSTD dictionary");
+                goto finish;
+        }
+
+        journal_file_print_header(f);
+
+        append_messages(f, 100);
+
+        /* Short messages are compressed with the dictionary, and still read back fine */
+        p = le64toh(f->header->header_size);
+        for (;;) {
+                assert_se(journal_file_move_to_object(f, OBJECT_UNUSED, p, &o) >= 0);
+
+                if (o->object.type == OBJECT_DATA && COMPRESSION_FROM_OBJECT(o) == COMPRESSION_ZSTD) {
+                        void *d;
+                        size_t l;
+
+                        n_compressed++;
+                        assert_se(journal_file_data_payload(f, o, p, NULL, 0, 0, &d, &l) > 0);
+                        assert_se(memchr(d, '=', l));
+                }
+
+                if (p == le64toh(f->header->tail_object_offset))
+                        break;
+                p = p + ALIGN64(le64toh(o->object.size));
+        }
+
+        log_info("%u data objects compressed with dictionary", n_compressed);
+        assert_se(n_compressed > 0);
+
+        assert_se(journal_file_verify(f, NULL, NULL, NULL, NULL, false) >= 0);
+
+finish:
+        (void) journal_file_offline_close(f);
+
+        if (arg_keep)
+                log_info("Not removing %s", t);
+        else {
+                journal_directory_vacuum(".", 3000000, 0, 0, NULL, true);
+
+                assert_se(rm_rf(t, REMOVE_ROOT|REMOVE_PHYSICAL) >= 0);
+        }
+}
+#endif
 #endif
 
+TEST(follow) {
+        _cleanup_(mmap_cache_unrefp) MMapCache *m = NULL;
+        _cleanup_(sd_journal_closep) sd_journal *j = NULL;
+        char t[] = "/var/tmp/journal-XXXXXX";
+        JournalFile *f;
+        dual_timestamp ts;
+
+        m = mmap_cache_new();
+        assert_se(m != NULL);
+
+        mkdtemp_chdir_chattr(t);
+
+        assert_se(journal_file_open(-EBADF, "test.journal", O_RDWR|O_CREAT, JOURNAL_COMPRESS, 0666, UINT64_MAX, NULL, m, NULL, &f) == 0);
+
+        assert_se(dual_timestamp_now(&ts));
+        assert_se(journal_file_append_entry(f, &ts, NULL, &IOVEC_MAKE_STRING("NUMBER=1"), 1, NULL, NULL, NULL, NULL) == 0);
+
+        assert_se(sd_journal_open_directory(&j, t, 0) >= 0);
+        assert_se(sd_journal_get_fd(j) >= 0);
+        assert_se(sd_journal_next(j) == 1);
+        assert_se(sd_journal_next(j) == 0);
+
+        /* Posting a change without adding entries is noticed to change nothing */
+        journal_file_post_change(f);
+        assert_se(sd_journal_process(j) == SD_JOURNAL_NOP);
+        assert_se(sd_journal_next(j) == 0);
+
+        /* Appending posts the change itself */
+        assert_se(dual_timestamp_now(&ts));
+        assert_se(journal_file_append_entry(f, &ts, NULL, &IOVEC_MAKE_STRING("NUMBER=2"), 1, NULL, NULL, NULL, NULL) == 0);
+        assert_se(sd_journal_process(j) == SD_JOURNAL_APPEND);
+        assert_se(sd_journal_next(j) == 1);
+        assert_se(sd_journal_next(j) == 0);
+
+        (void) journal_file_offline_close(f);
+
+        if (arg_keep)
+                log_info("Not removing %s", t);
+        else
+                assert_se(rm_rf(t, REMOVE_ROOT|REMOVE_PHYSICAL) >= 0);
+}
+
 static int intro(void) {
         arg_keep = saved_argc > 1;
 
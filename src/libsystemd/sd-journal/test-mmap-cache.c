@@ -11,6 +11,83 @@
 #include "tests.h"
 #include "tmpfile-util.h"
 
+static void test_sequential(MMapCache *m) {
+        MMapFileDescriptor *fx;
+        MMapCacheStats before, after;
+        char px[] = "/tmp/testmmapSXXXXXX";
+        uint64_t file_size = 256ULL*1024ULL*1024ULL;
+        struct stat st;
+        void *p;
+        int x;
+
+        x = mkostemp_safe(px);
+        assert_se(x >= 0);
+        (void) unlink(px);
+
+        assert_se(ftruncate(x, file_size) >= 0);
+        assert_se(fstat(x, &st) >= 0);
+
+        assert_se(mmap_cache_add_fd(m, x, PROT_READ, &fx) > 0);
+
+        mmap_cache_get_stats(m, &before);
+
+        /* Scanning the file front to back should grow the windows, so that we need fewer of them than
+         * with the fixed default size of 8M. */
+        for (uint64_t offset = 0; offset < file_size; offset += 4096)
+                assert_se(mmap_cache_fd_get(fx, 0, false, offset, 8, &st, &p) >= 0);
+
+        mmap_cache_get_stats(m, &after);
+
+        log_info("sequential scan: %u windows created, %u readahead",
+                 after.n_windows_created - before.n_windows_created,
+                 after.n_readahead - before.n_readahead);
+
+        assert_se(after.n_bytes_mapped - before.n_bytes_mapped >= file_size);
+        assert_se(after.n_readahead > before.n_readahead);
+#if !ENABLE_DEBUG_MMAP_CACHE
+        assert_se(after.n_windows_created - before.n_windows_created < file_size / (8ULL*1024ULL*1024ULL));
+#endif
+
+        mmap_cache_fd_free(fx);
+        safe_close(x);
+}
+
+static void test_shared(MMapCache *m) {
+        MMapFileDescriptor *fa, *fb;
+        char pa[] = "/tmp/testmmapAXXXXXX";
+        uint64_t file_size = 32ULL*1024ULL*1024ULL;
+        struct stat st;
+        int a, b;
+        void *p;
+
+        a = mkostemp_safe(pa);
+        assert_se(a >= 0);
+        b = open(pa, O_RDONLY|O_CLOEXEC);
+        assert_se(b >= 0);
+        (void) unlink(pa);
+
+        assert_se(ftruncate(a, file_size) >= 0);
+        assert_se(pwrite(a, "waldo", 5, file_size - 5) == 5);
+        assert_se(fstat(a, &st) >= 0);
+
+        /* Two fds of the same file share their windows */
+        assert_se(mmap_cache_add_fd(m, a, PROT_READ, &fa) > 0);
+        assert_se(mmap_cache_add_fd(m, b, PROT_READ, &fb) == 0);
+        assert_se(fa == fb);
+
+        assert_se(mmap_cache_fd_get(fa, 0, false, 0, 8, &st, &p) >= 0);
+
+        /* The first user going away doesn't affect the other one, even for windows created later on */
+        mmap_cache_fd_free(fa);
+        safe_close(a);
+
+        assert_se(mmap_cache_fd_get(fb, 0, false, file_size - 5, 5, &st, &p) >= 0);
+        assert_se(memcmp(p, "waldo", 5) == 0);
+
+        mmap_cache_fd_free(fb);
+        safe_close(b);
+}
+
 int main(int argc, char *argv[]) {
         MMapFileDescriptor *fx;
         int x, y, z, r;
@@ -58,6 +135,10 @@ int main(int argc, char *argv[]) {
         assert_se((uint8_t*) p + 1 == (uint8_t*) q);
 
         mmap_cache_fd_free(fx);
+
+        test_sequential(m);
+        test_shared(m);
+
         mmap_cache_unref(m);
 
         safe_close(x);
@@ -0,0 +1,430 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <errno.h>
+#include <string.h>
+
+#include "alloc-util.h"
+#include "json-binary.h"
+#include "unaligned.h"
+
+/* Same limit as for sd_json_parse() */
+#define JSON_BINARY_DEPTH_MAX (2U*1024U)
+
+/* A LEB128 encoded 64-bit value takes at most 10 bytes */
+#define JSON_BINARY_VARINT_MAX 10U
+
+enum {
+        JSON_BINARY_NULL,
+        JSON_BINARY_FALSE,
+        JSON_BINARY_TRUE,
+        JSON_BINARY_UNSIGNED,
+        JSON_BINARY_NEGATIVE,
+        JSON_BINARY_REAL,
+        JSON_BINARY_STRING,
+        JSON_BINARY_ARRAY,
+        JSON_BINARY_OBJECT,
+};
+
+typedef struct JsonBinaryWriter {
+        uint8_t **buffer;
+        size_t *size;
+} JsonBinaryWriter;
+
+static uint8_t* writer_extend(JsonBinaryWriter *w, size_t n) {
+        uint8_t *p;
+
+        assert(w);
+
+        if (!GREEDY_REALLOC(*w->buffer, *w->size + n))
+                return NULL;
+
+        p = *w->buffer + *w->size;
+        *w->size += n;
+        return p;
+}
+
+static int write_varint(JsonBinaryWriter *w, uint8_t tag, bool with_tag, uint64_t u) {
+        uint8_t b[1 + JSON_BINARY_VARINT_MAX], *p;
+        size_t n = 0;
+
+        if (with_tag)
+                b[n++] = tag;
+
+        do {
+                b[n] = u & 0x7f;
+                u >>= 7;
+                if (u != 0)
+                        b[n] |= 0x80;
+                n++;
+        } while (u != 0);
+
+        p = writer_extend(w, n);
+        if (!p)
+                return -ENOMEM;
+
+        memcpy(p, b, n);
+        return 0;
+}
+
+static int write_string(JsonBinaryWriter *w, bool with_tag, const char *s) {
+        size_t n;
+        uint8_t *p;
+        int r;
+
+        assert(s);
+
+        n = strlen(s);
+
+        r = write_varint(w, JSON_BINARY_STRING, with_tag, n);
+        if (r < 0)
+                return r;
+
+        p = writer_extend(w, n);
+        if (!p)
+                return -ENOMEM;
+
+        memcpy(p, s, n);
+        return 0;
+}
+
+static int write_variant(JsonBinaryWriter *w, sd_json_variant *v, unsigned depth) {
+        uint8_t *p;
+        size_t n;
+        int r;
+
+        if (depth >= JSON_BINARY_DEPTH_MAX)
+                return -ELNRNG;
+
+        switch (sd_json_variant_type(v)) {
+
+        case SD_JSON_VARIANT_NULL:
+        case SD_JSON_VARIANT_BOOLEAN:
+                p = writer_extend(w, 1);
+                if (!p)
+                        return -ENOMEM;
+
+                *p = sd_json_variant_is_null(v) ? JSON_BINARY_NULL :
+                        sd_json_variant_boolean(v) ? JSON_BINARY_TRUE : JSON_BINARY_FALSE;
+                return 0;
+
+        case SD_JSON_VARIANT_INTEGER: {
+                int64_t i = sd_json_variant_integer(v);
+
+                if (i >= 0)
+                        return write_varint(w, JSON_BINARY_UNSIGNED, true, (uint64_t) i);
+
+                /* -(i + 1) cannot overflow, even for INT64_MIN */
+                return write_varint(w, JSON_BINARY_NEGATIVE, true, (uint64_t) -(i + 1));
+        }
+
+        case SD_JSON_VARIANT_UNSIGNED:
+                return write_varint(w, JSON_BINARY_UNSIGNED, true, sd_json_variant_unsigned(v));
+
+        case SD_JSON_VARIANT_REAL: {
+                double d = sd_json_variant_real(v);
+                uint64_t u;
+
+                memcpy(&u, &d, sizeof(u));
+
+                p = writer_extend(w, 1 + sizeof(u));
+                if (!p)
+                        return -ENOMEM;
+
+                p[0] = JSON_BINARY_REAL;
+                unaligned_write_le64(p + 1, u);
+                return 0;
+        }
+
+        case SD_JSON_VARIANT_STRING:
+                return write_string(w, /* with_tag= */ true, sd_json_variant_string(v));
+
+        case SD_JSON_VARIANT_ARRAY:
+                n = sd_json_variant_elements(v);
+
+                r = write_varint(w, JSON_BINARY_ARRAY, true, n);
+                if (r < 0)
+                        return r;
+
+                for (size_t i = 0; i < n; i++) {
+                        r = write_variant(w, sd_json_variant_by_index(v, i), depth + 1);
+                        if (r < 0)
+                                return r;
+                }
+
+                return 0;
+
+        case SD_JSON_VARIANT_OBJECT:
+                n = sd_json_variant_elements(v);
+                assert(n % 2 == 0);
+
+                r = write_varint(w, JSON_BINARY_OBJECT, true, n / 2);
+                if (r < 0)
+                        return r;
+
+                for (size_t i = 0; i < n; i += 2) {
+                        r = write_string(w, /* with_tag= */ false, sd_json_variant_string(sd_json_variant_by_index(v, i)));
+                        if (r < 0)
+                                return r;
+
+                        r = write_variant(w, sd_json_variant_by_index(v, i + 1), depth + 1);
+                        if (r < 0)
+                                return r;
+                }
+
+                return 0;
+
+        default:
+                return -EINVAL;
+        }
+}
+
+int json_variant_append_binary(sd_json_variant *v, uint8_t **buffer, size_t *size) {
+        JsonBinaryWriter w = {
+                .buffer = buffer,
+                .size = size,
+        };
+        size_t saved;
+        int r;
+
+        assert(buffer);
+        assert(size);
+
+        /* Appends the encoded variant to the buffer, which is extended as needed. *size is the number of
+         * bytes in use in the buffer. On failure the buffer is left as it was, except for its allocation. */
+
+        saved = *size;
+
+        r = write_variant(&w, v, 0);
+        if (r < 0)
+                *size = saved;
+
+        return r;
+}
+
+int json_variant_format_binary(sd_json_variant *v, uint8_t **ret, size_t *ret_size) {
+        _cleanup_free_ uint8_t *b = NULL;
+        size_t n = 0;
+        int r;
+
+        assert(ret);
+        assert(ret_size);
+
+        r = json_variant_append_binary(v, &b, &n);
+        if (r < 0)
+                return r;
+
+        *ret = TAKE_PTR(b);
+        *ret_size = n;
+        return 0;
+}
+
+typedef struct JsonBinaryReader {
+        const uint8_t *p;
+        const uint8_t *end;
+} JsonBinaryReader;
+
+static int read_varint(JsonBinaryReader *rd, uint64_t *ret) {
+        uint64_t u = 0;
+
+        assert(rd);
+        assert(ret);
+
+        for (unsigned shift = 0; shift < 7 * JSON_BINARY_VARINT_MAX; shift += 7) {
+                uint8_t b;
+
+                if (rd->p >= rd->end)
+                        return -EBADMSG;
+
+                b = *(rd->p++);
+
+                /* The 10th byte may only carry the topmost bit */
+                if (shift == 63 && b > 1)
+                        return -EBADMSG;
+
+                u |= (uint64_t) (b & 0x7f) << shift;
+
+                if (!(b & 0x80)) {
+                        *ret = u;
+                        return 0;
+                }
+        }
+
+        return -EBADMSG;
+}
+
+static int read_count(JsonBinaryReader *rd, size_t min_size, size_t *ret) {
+        uint64_t u;
+        int r;
+
+        assert(rd);
+        assert(min_size > 0);
+        assert(ret);
+
+        r = read_varint(rd, &u);
+        if (r < 0)
+                return r;
+
+        /* Every item takes at least min_size bytes, refuse counts that cannot possibly fit in the remaining
+         * input, so that a bogus count does not make us allocate huge arrays */
+        if (u > (uint64_t) (rd->end - rd->p) / min_size)
+                return -EBADMSG;
+
+        *ret = (size_t) u;
+        return 0;
+}
+
+static int read_string(JsonBinaryReader *rd, sd_json_variant **ret) {
+        size_t n;
+        int r;
+
+        r = read_count(rd, 1, &n);
+        if (r < 0)
+                return r;
+
+        if (memchr(rd->p, 0, n))
+                return -EBADMSG;
+
+        r = sd_json_variant_new_stringn(ret, (const char*) rd->p, n);
+        if (r < 0)
+                return r;
+
+        rd->p += n;
+        return 0;
+}
+
+static int read_variant(JsonBinaryReader *rd, unsigned depth, sd_json_variant **ret) {
+        sd_json_variant **items = NULL;
+        size_t n_items = 0, n;
+        uint64_t u;
+        uint8_t tag;
+        int r;
+
+        assert(rd);
+        assert(ret);
+
+        if (depth >= JSON_BINARY_DEPTH_MAX)
+                return -ELNRNG;
+
+        if (rd->p >= rd->end)
+                return -EBADMSG;
+
+        tag = *(rd->p++);
+
+        switch (tag) {
+
+        case JSON_BINARY_NULL:
+                return sd_json_variant_new_null(ret);
+
+        case JSON_BINARY_FALSE:
+        case JSON_BINARY_TRUE:
+                return sd_json_variant_new_boolean(ret, tag == JSON_BINARY_TRUE);
+
+        case JSON_BINARY_UNSIGNED:
+                r = read_varint(rd, &u);
+                if (r < 0)
+                        return r;
+
+                return sd_json_variant_new_unsigned(ret, u);
+
+        case JSON_BINARY_NEGATIVE:
+                r = read_varint(rd, &u);
+                if (r < 0)
+                        return r;
+                if (u > INT64_MAX)
+                        return -EBADMSG;
+
+                return sd_json_variant_new_integer(ret, -(int64_t) u - 1);
+
+        case JSON_BINARY_REAL: {
+                double d;
+
+                if ((size_t) (rd->end - rd->p) < sizeof(uint64_t))
+                        return -EBADMSG;
+
+                u = unaligned_read_le64(rd->p);
+                rd->p += sizeof(uint64_t);
+
+                memcpy(&d, &u, sizeof(d));
+                return sd_json_variant_new_real(ret, d);
+        }
+
+        case JSON_BINARY_STRING:
+                return read_string(rd, ret);
+
+        case JSON_BINARY_ARRAY:
+                r = read_count(rd, 1, &n);
+                if (r < 0)
+                        return r;
+
+                if (n == 0)
+                        return sd_json_variant_new_array(ret, NULL, 0);
+
+                items = new(sd_json_variant*, n);
+                if (!items)
+                        return -ENOMEM;
+
+                for (; n_items < n; n_items++) {
+                        r = read_variant(rd, depth + 1, items + n_items);
+                        if (r < 0)
+                                goto finish;
+                }
+
+                r = sd_json_variant_new_array(ret, items, n_items);
+                break;
+
+        case JSON_BINARY_OBJECT:
+                /* Every field takes at least two bytes: the length of its key and the tag of the value */
+                r = read_count(rd, 2, &n);
+                if (r < 0)
+                        return r;
+
+                if (n == 0)
+                        return sd_json_variant_new_object(ret, NULL, 0);
+
+                items = new(sd_json_variant*, n * 2);
+                if (!items)
+                        return -ENOMEM;
+
+                for (; n_items < n * 2; n_items++) {
+                        if (n_items % 2 == 0)
+                                r = read_string(rd, items + n_items);
+                        else
+                                r = read_variant(rd, depth + 1, items + n_items);
+                        if (r < 0)
+                                goto finish;
+                }
+
+                r = sd_json_variant_new_object(ret, items, n_items);
+                break;
+
+        default:
+                return -EBADMSG;
+        }
+
+finish:
+        sd_json_variant_unref_many(items, n_items);
+        return r;
+}
+
+int json_variant_parse_binary(const void *data, size_t size, sd_json_variant **ret) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        JsonBinaryReader rd = {
+                .p = data,
+                .end = (const uint8_t*) data + size,
+        };
+        int r;
+
+        assert(data || size == 0);
+        assert(ret);
+
+        r = read_variant(&rd, 0, &v);
+        if (r < 0)
+                return r;
+
+        /* Trailing garbage? */
+        if (rd.p != rd.end)
+                return -EBADMSG;
+
+        *ret = TAKE_PTR(v);
+        return 0;
+}
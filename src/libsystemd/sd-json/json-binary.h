@@ -0,0 +1,26 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+#pragma once
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#include "sd-json.h"
+
+/* A compact binary encoding of sd_json_variant objects, for use on local channels where both ends are known
+ * to understand it. Every value is encoded as a tag byte, followed by its payload:
+ *
+ *     null, false, true:  no payload
+ *     unsigned integer:   LEB128 encoded value
+ *     negative integer:   LEB128 encoded -(value + 1)
+ *     real:               IEEE 754 double, little endian
+ *     string:             LEB128 encoded length, followed by the UTF-8 bytes, no NUL byte
+ *     array:              LEB128 encoded number of elements, followed by the elements
+ *     object:             LEB128 encoded number of fields, followed by the key strings (without tag) and
+ *                         values, interleaved
+ *
+ * This avoids formatting and parsing numbers and escaping strings, and encodes the lengths of strings and
+ * containers up front, so that decoding needs no scanning for delimiters. */
+
+int json_variant_append_binary(sd_json_variant *v, uint8_t **buffer, size_t *size);
+int json_variant_format_binary(sd_json_variant *v, uint8_t **ret, size_t *ret_size);
+int json_variant_parse_binary(const void *data, size_t size, sd_json_variant **ret);
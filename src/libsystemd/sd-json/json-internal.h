@@ -74,3 +74,22 @@ enum { /* JSON tokens */
 };
 
 int json_tokenize(const char **p, char **ret_string, JsonValue *ret_value, unsigned *ret_line, unsigned *ret_column, void **state, unsigned *line, unsigned *column);
+
+/* The per-field logic of sd_json_dispatch_full(), shared with the streaming reader, which sees the fields
+ * of an object one by one rather than as a complete object. 'found' must have one entry per field in
+ * 'table'. Returns > 0 if the field was dispatched, 0 if it was skipped. */
+int json_dispatch_field(
+                const sd_json_dispatch_field table[],
+                bool *found,
+                const char *key,
+                sd_json_variant *value,
+                sd_json_dispatch_callback_t bad,
+                sd_json_dispatch_flags_t flags,
+                void *userdata,
+                const char **reterr_bad_field);
+int json_dispatch_mandatory(
+                sd_json_variant *v,
+                const sd_json_dispatch_field table[],
+                const bool *found,
+                sd_json_dispatch_flags_t flags,
+                const char **reterr_bad_field);
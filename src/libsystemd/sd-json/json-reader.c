@@ -0,0 +1,791 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <errno.h>
+#include <stdio.h>
+
+#include "alloc-util.h"
+#include "errno-util.h"
+#include "json-internal.h"
+#include "json-reader.h"
+#include "json-util.h"
+#include "memory-util.h"
+
+/* Same limit as for sd_json_parse() */
+#define JSON_READER_DEPTH_MAX (2U*1024U)
+
+/* How much to read from the FILE stream at once */
+#define JSON_READER_CHUNK_SIZE (64U*1024U)
+
+typedef enum JsonReaderExpect {
+        EXPECT_TOPLEVEL,
+        EXPECT_END,
+        EXPECT_OBJECT_FIRST_KEY,
+        EXPECT_OBJECT_NEXT_KEY,
+        EXPECT_OBJECT_COLON,
+        EXPECT_OBJECT_VALUE,
+        EXPECT_OBJECT_COMMA,
+        EXPECT_ARRAY_FIRST_ELEMENT,
+        EXPECT_ARRAY_NEXT_ELEMENT,
+        EXPECT_ARRAY_COMMA,
+} JsonReaderExpect;
+
+struct JsonReader {
+        sd_json_parse_flags_t flags;
+
+        FILE *file;                 /* If set, more input is read from here when needed. Not owned. */
+        bool eof;
+
+        char *buffer;               /* Always NUL terminated */
+        size_t size;                /* Bytes in the buffer, not counting the trailing NUL */
+        size_t offset;              /* Bytes in the buffer already tokenized */
+        size_t pinned;              /* While a snapshot is taken: where it was taken, otherwise SIZE_MAX */
+
+        void *tokenizer_state;
+        unsigned line, column;      /* Position after the last token */
+        unsigned token_line, token_column; /* Position at the start of the last token */
+
+        JsonReaderExpect *stack;    /* One entry for the top level, plus one per open object or array */
+        size_t n_stack;
+
+        /* The current token */
+        char *key;
+        sd_json_variant *value;
+};
+
+/* The reader state we need to roll back to, in order to undo reading tokens. This is used to look ahead,
+ * and to make operations consuming more than one token atomic when fed input piecemeal. Only the expect
+ * field of the innermost level can be changed by reading tokens without first going up a level, hence
+ * that's all of the stack we need to save. */
+typedef struct JsonReaderSnapshot {
+        void *tokenizer_state;
+        unsigned line, column;
+        unsigned token_line, token_column;
+        size_t n_stack;
+        JsonReaderExpect expect;
+} JsonReaderSnapshot;
+
+static int json_reader_new_internal(FILE *f, sd_json_parse_flags_t flags, JsonReader **ret) {
+        _cleanup_(json_reader_freep) JsonReader *r = NULL;
+
+        assert(ret);
+
+        r = new(JsonReader, 1);
+        if (!r)
+                return -ENOMEM;
+
+        *r = (JsonReader) {
+                .flags = flags,
+                .file = f,
+                .pinned = SIZE_MAX,
+        };
+
+        if (!GREEDY_REALLOC(r->buffer, 1))
+                return -ENOMEM;
+        r->buffer[0] = 0;
+
+        if (!GREEDY_REALLOC(r->stack, 1))
+                return -ENOMEM;
+        r->stack[r->n_stack++] = EXPECT_TOPLEVEL;
+
+        *ret = TAKE_PTR(r);
+        return 0;
+}
+
+int json_reader_new(sd_json_parse_flags_t flags, JsonReader **ret) {
+        return json_reader_new_internal(NULL, flags, ret);
+}
+
+int json_reader_new_file(FILE *f, sd_json_parse_flags_t flags, JsonReader **ret) {
+        assert(f);
+
+        return json_reader_new_internal(f, flags, ret);
+}
+
+JsonReader* json_reader_free(JsonReader *r) {
+        if (!r)
+                return NULL;
+
+        free(r->buffer);
+        free(r->stack);
+        free(r->key);
+        sd_json_variant_unref(r->value);
+
+        return mfree(r);
+}
+
+static void json_reader_compact(JsonReader *r) {
+        size_t n;
+
+        assert(r);
+
+        /* Drop what was tokenized already, but keep what we might have to roll back to */
+        n = MIN(r->offset, r->pinned);
+        if (n == 0)
+                return;
+
+        memmove(r->buffer, r->buffer + n, r->size - n + 1);
+        r->size -= n;
+        r->offset -= n;
+        if (r->pinned != SIZE_MAX)
+                r->pinned -= n;
+}
+
+static int json_reader_append(JsonReader *r, const void *data, size_t size) {
+        assert(r);
+        assert(data || size == 0);
+
+        /* The tokenizer operates on NUL terminated strings, hence we cannot accept NUL bytes in the
+         * input. They are not valid JSON anyway. */
+        if (memchr(data, 0, size))
+                return -EINVAL;
+
+        json_reader_compact(r);
+
+        if (!GREEDY_REALLOC(r->buffer, r->size + size + 1))
+                return -ENOMEM;
+
+        memcpy_safe(r->buffer + r->size, data, size);
+        r->size += size;
+        r->buffer[r->size] = 0;
+
+        return 0;
+}
+
+int json_reader_feed(JsonReader *r, const void *data, size_t size) {
+        assert(r);
+        assert(!r->file);
+        assert(!r->eof);
+
+        return json_reader_append(r, data, size);
+}
+
+void json_reader_feed_eof(JsonReader *r) {
+        assert(r);
+        assert(!r->file);
+
+        r->eof = true;
+}
+
+static int json_reader_fill(JsonReader *r) {
+        size_t n;
+
+        assert(r);
+
+        /* Returns > 0 if more input was added, 0 if we are at the end of the input, and -EAGAIN if the
+         * input is fed to us and we need to wait for more */
+
+        if (r->eof)
+                return 0;
+        if (!r->file)
+                return -EAGAIN;
+
+        json_reader_compact(r);
+
+        if (!GREEDY_REALLOC(r->buffer, r->size + JSON_READER_CHUNK_SIZE + 1))
+                return -ENOMEM;
+
+        n = fread(r->buffer + r->size, 1, JSON_READER_CHUNK_SIZE, r->file);
+        if (n == 0) {
+                if (ferror(r->file))
+                        return errno_or_else(EIO);
+
+                r->eof = true;
+                return 0;
+        }
+
+        /* No NUL bytes, see json_reader_append() */
+        if (memchr(r->buffer + r->size, 0, n))
+                return -EINVAL;
+
+        r->size += n;
+        r->buffer[r->size] = 0;
+
+        return 1;
+}
+
+static int json_reader_tokenize(JsonReader *r, char **ret_string, JsonValue *ret_value) {
+        int k;
+
+        assert(r);
+        assert(ret_string);
+        assert(ret_value);
+
+        for (;;) {
+                _cleanup_free_ char *string = NULL;
+                void *saved_state = r->tokenizer_state;
+                unsigned saved_line = r->line, saved_column = r->column;
+                const char *p = r->buffer + r->offset;
+                JsonValue value;
+                int token;
+
+                token = json_tokenize(&p, &string, &value, &r->token_line, &r->token_column, &r->tokenizer_state, &r->line, &r->column);
+
+                /* Unless we have seen the end of the input, the token might be cut off, in which case we
+                 * need more input and then try again. That's the case if we ran out of input before the
+                 * next token started, if the tokenizer failed (as it does on truncated strings and
+                 * literals), or if a number ends right at the end of what we have. Note that this means
+                 * that errors are only reported once the input as a whole has been seen. */
+                if (!r->eof &&
+                    (token < 0 ||
+                     token == JSON_TOKEN_END ||
+                     (IN_SET(token, JSON_TOKEN_REAL, JSON_TOKEN_INTEGER, JSON_TOKEN_UNSIGNED) && *p == 0))) {
+
+                        r->tokenizer_state = saved_state;
+                        r->line = saved_line;
+                        r->column = saved_column;
+
+                        k = json_reader_fill(r);
+                        if (k < 0)
+                                return k;
+
+                        continue;
+                }
+                if (token < 0)
+                        return token;
+
+                r->offset = p - r->buffer;
+
+                *ret_string = TAKE_PTR(string);
+                *ret_value = value;
+                return token;
+        }
+}
+
+static bool json_reader_expect_value(JsonReaderExpect *e) {
+        assert(e);
+
+        /* A value is about to be read, move on to what has to follow it */
+
+        switch (*e) {
+
+        case EXPECT_TOPLEVEL:
+                *e = EXPECT_END;
+                return true;
+
+        case EXPECT_OBJECT_VALUE:
+                *e = EXPECT_OBJECT_COMMA;
+                return true;
+
+        case EXPECT_ARRAY_FIRST_ELEMENT:
+        case EXPECT_ARRAY_NEXT_ELEMENT:
+                *e = EXPECT_ARRAY_COMMA;
+                return true;
+
+        default:
+                return false;
+        }
+}
+
+static int json_reader_push(JsonReader *r, JsonReaderExpect expect) {
+        assert(r);
+        assert(r->n_stack > 0);
+
+        if (!json_reader_expect_value(r->stack + r->n_stack - 1))
+                return -EINVAL;
+
+        if (r->n_stack > JSON_READER_DEPTH_MAX) /* Refuse too deep nesting */
+                return -ELNRNG;
+
+        if (!GREEDY_REALLOC(r->stack, r->n_stack + 1))
+                return -ENOMEM;
+
+        r->stack[r->n_stack++] = expect;
+        return 0;
+}
+
+static int json_reader_next_internal(JsonReader *r) {
+        int k;
+
+        assert(r);
+
+        r->key = mfree(r->key);
+        r->value = sd_json_variant_unref(r->value);
+
+        for (;;) {
+                _cleanup_free_ char *string = NULL;
+                JsonReaderExpect *current;
+                JsonValue value;
+                int token;
+
+                assert(r->n_stack > 0);
+                current = r->stack + r->n_stack - 1;
+
+                token = json_reader_tokenize(r, &string, &value);
+                if (token < 0)
+                        return token;
+
+                switch (token) {
+
+                case JSON_TOKEN_END:
+                        if (*current == EXPECT_TOPLEVEL)
+                                return -ENODATA;
+                        if (*current != EXPECT_END)
+                                return -EINVAL;
+
+                        assert(r->n_stack == 1);
+                        return JSON_READER_END;
+
+                case JSON_TOKEN_COLON:
+                        if (*current != EXPECT_OBJECT_COLON)
+                                return -EINVAL;
+
+                        *current = EXPECT_OBJECT_VALUE;
+                        continue;
+
+                case JSON_TOKEN_COMMA:
+                        if (*current == EXPECT_OBJECT_COMMA)
+                                *current = EXPECT_OBJECT_NEXT_KEY;
+                        else if (*current == EXPECT_ARRAY_COMMA)
+                                *current = EXPECT_ARRAY_NEXT_ELEMENT;
+                        else
+                                return -EINVAL;
+
+                        continue;
+
+                case JSON_TOKEN_OBJECT_OPEN:
+                        k = json_reader_push(r, EXPECT_OBJECT_FIRST_KEY);
+                        if (k < 0)
+                                return k;
+
+                        return JSON_READER_OBJECT_START;
+
+                case JSON_TOKEN_OBJECT_CLOSE:
+                        if (!IN_SET(*current, EXPECT_OBJECT_FIRST_KEY, EXPECT_OBJECT_COMMA))
+                                return -EINVAL;
+
+                        assert(r->n_stack > 1);
+                        r->n_stack--;
+                        return JSON_READER_OBJECT_END;
+
+                case JSON_TOKEN_ARRAY_OPEN:
+                        k = json_reader_push(r, EXPECT_ARRAY_FIRST_ELEMENT);
+                        if (k < 0)
+                                return k;
+
+                        return JSON_READER_ARRAY_START;
+
+                case JSON_TOKEN_ARRAY_CLOSE:
+                        if (!IN_SET(*current, EXPECT_ARRAY_FIRST_ELEMENT, EXPECT_ARRAY_COMMA))
+                                return -EINVAL;
+
+                        assert(r->n_stack > 1);
+                        r->n_stack--;
+                        return JSON_READER_ARRAY_END;
+
+                case JSON_TOKEN_STRING:
+                        if (IN_SET(*current, EXPECT_OBJECT_FIRST_KEY, EXPECT_OBJECT_NEXT_KEY)) {
+                                *current = EXPECT_OBJECT_COLON;
+                                r->key = TAKE_PTR(string);
+                                return JSON_READER_KEY;
+                        }
+
+                        if (!json_reader_expect_value(current))
+                                return -EINVAL;
+
+                        k = sd_json_variant_new_string(&r->value, string);
+                        break;
+
+                case JSON_TOKEN_REAL:
+                        if (!json_reader_expect_value(current))
+                                return -EINVAL;
+
+                        k = sd_json_variant_new_real(&r->value, value.real);
+                        break;
+
+                case JSON_TOKEN_INTEGER:
+                        if (!json_reader_expect_value(current))
+                                return -EINVAL;
+
+                        k = sd_json_variant_new_integer(&r->value, value.integer);
+                        break;
+
+                case JSON_TOKEN_UNSIGNED:
+                        if (!json_reader_expect_value(current))
+                                return -EINVAL;
+
+                        k = sd_json_variant_new_unsigned(&r->value, value.unsig);
+                        break;
+
+                case JSON_TOKEN_BOOLEAN:
+                        if (!json_reader_expect_value(current))
+                                return -EINVAL;
+
+                        k = sd_json_variant_new_boolean(&r->value, value.boolean);
+                        break;
+
+                case JSON_TOKEN_NULL:
+                        if (!json_reader_expect_value(current))
+                                return -EINVAL;
+
+                        k = sd_json_variant_new_null(&r->value);
+                        break;
+
+                default:
+                        assert_not_reached();
+                }
+                if (k < 0)
+                        return k;
+
+                if (FLAGS_SET(r->flags, SD_JSON_PARSE_SENSITIVE))
+                        sd_json_variant_sensitive(r->value);
+
+                return JSON_READER_VALUE;
+        }
+}
+
+static void json_reader_snapshot(JsonReader *r, JsonReaderSnapshot *ret) {
+        assert(r);
+        assert(ret);
+        assert(r->pinned == SIZE_MAX);
+
+        r->pinned = r->offset;
+
+        *ret = (JsonReaderSnapshot) {
+                .tokenizer_state = r->tokenizer_state,
+                .line = r->line,
+                .column = r->column,
+                .token_line = r->token_line,
+                .token_column = r->token_column,
+                .n_stack = r->n_stack,
+                .expect = r->stack[r->n_stack - 1],
+        };
+}
+
+static void json_reader_rollback(JsonReader *r, const JsonReaderSnapshot *s) {
+        assert(r);
+        assert(s);
+        assert(r->pinned != SIZE_MAX);
+
+        r->offset = r->pinned;
+        r->pinned = SIZE_MAX;
+
+        r->tokenizer_state = s->tokenizer_state;
+        r->line = s->line;
+        r->column = s->column;
+        r->token_line = s->token_line;
+        r->token_column = s->token_column;
+        r->n_stack = s->n_stack;
+        r->stack[r->n_stack - 1] = s->expect;
+
+        r->key = mfree(r->key);
+        r->value = sd_json_variant_unref(r->value);
+}
+
+static void json_reader_commit(JsonReader *r) {
+        assert(r);
+        assert(r->pinned != SIZE_MAX);
+
+        r->pinned = SIZE_MAX;
+}
+
+int json_reader_next(JsonReader *r) {
+        assert(r);
+
+        /* Returns the next token, or -EAGAIN if more input needs to be fed first, in which case the call
+         * may simply be repeated later. Separators are consumed silently. */
+
+        return json_reader_next_internal(r);
+}
+
+int json_reader_peek(JsonReader *r) {
+        JsonReaderSnapshot s;
+        int token;
+
+        assert(r);
+
+        /* Returns the next token without consuming it. This invalidates the key and value of the current
+         * token. */
+
+        json_reader_snapshot(r, &s);
+        token = json_reader_next_internal(r);
+        json_reader_rollback(r, &s);
+
+        return token;
+}
+
+const char* json_reader_key(JsonReader *r) {
+        assert(r);
+
+        /* The key of the last JSON_READER_KEY token, valid until the next token is read */
+        return r->key;
+}
+
+sd_json_variant* json_reader_value(JsonReader *r) {
+        assert(r);
+
+        /* The value of the last JSON_READER_VALUE token, valid until the next token is read. Take a
+         * reference to keep it around for longer. */
+        return r->value;
+}
+
+void json_reader_get_position(JsonReader *r, unsigned *ret_line, unsigned *ret_column) {
+        assert(r);
+
+        /* The position where the last token started, useful for error messages */
+
+        if (ret_line)
+                *ret_line = r->token_line;
+        if (ret_column)
+                *ret_column = r->token_column;
+}
+
+static int json_reader_build(JsonReader *r, int token, sd_json_variant **ret) {
+        sd_json_variant **elements = NULL;
+        size_t n_elements = 0;
+        int k;
+
+        assert(r);
+        assert(ret);
+
+        CLEANUP_ARRAY(elements, n_elements, sd_json_variant_unref_many);
+
+        /* Builds the value starting with 'token'. Returns 0 if 'token' ends the enclosing object or array,
+         * or the input, instead. */
+
+        switch (token) {
+
+        case JSON_READER_VALUE:
+                *ret = TAKE_PTR(r->value);
+                return 1;
+
+        case JSON_READER_OBJECT_START:
+        case JSON_READER_ARRAY_START:
+                break;
+
+        case JSON_READER_OBJECT_END:
+        case JSON_READER_ARRAY_END:
+        case JSON_READER_END:
+                *ret = NULL;
+                return 0;
+
+        case JSON_READER_KEY:
+                return -EINVAL;
+
+        default:
+                assert(token < 0);
+                return token;
+        }
+
+        for (;;) {
+                _cleanup_(sd_json_variant_unrefp) sd_json_variant *element = NULL;
+                int t;
+
+                t = json_reader_next_internal(r);
+                if (t < 0)
+                        return t;
+                if (IN_SET(t, JSON_READER_OBJECT_END, JSON_READER_ARRAY_END))
+                        break;
+
+                if (t == JSON_READER_KEY) {
+                        k = sd_json_variant_new_string(&element, r->key);
+                        if (k < 0)
+                                return k;
+
+                        if (FLAGS_SET(r->flags, SD_JSON_PARSE_SENSITIVE))
+                                sd_json_variant_sensitive(element);
+                } else {
+                        k = json_reader_build(r, t, &element);
+                        if (k < 0)
+                                return k;
+                        assert(k > 0);
+                }
+
+                if (!GREEDY_REALLOC(elements, n_elements + 1))
+                        return -ENOMEM;
+
+                elements[n_elements++] = TAKE_PTR(element);
+        }
+
+        if (token == JSON_READER_OBJECT_START)
+                k = sd_json_variant_new_object(ret, elements, n_elements);
+        else
+                k = sd_json_variant_new_array(ret, elements, n_elements);
+        if (k < 0)
+                return k;
+
+        if (FLAGS_SET(r->flags, SD_JSON_PARSE_SENSITIVE))
+                sd_json_variant_sensitive(*ret);
+
+        return 1;
+}
+
+int json_reader_read_variant(JsonReader *r, sd_json_variant **ret) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        JsonReaderSnapshot s;
+        int k;
+
+        assert(r);
+        assert(ret);
+
+        /* Reads the next value as a whole, i.e. a scalar, or an object or array including everything in
+         * it. Returns > 0 on success, and 0 if the enclosing object or array (whose end is consumed), or
+         * the input, ended instead. If more input needs to be fed first -EAGAIN is returned, and nothing
+         * is consumed. */
+
+        json_reader_snapshot(r, &s);
+
+        k = json_reader_build(r, json_reader_next_internal(r), &v);
+        if (k == -EAGAIN) {
+                json_reader_rollback(r, &s);
+                return k;
+        }
+
+        json_reader_commit(r);
+        if (k < 0)
+                return k;
+
+        *ret = TAKE_PTR(v);
+        return k;
+}
+
+static int json_reader_skip_internal(JsonReader *r, int token) {
+        unsigned depth = 0;
+
+        assert(r);
+
+        for (;;) {
+                switch (token) {
+
+                case JSON_READER_OBJECT_START:
+                case JSON_READER_ARRAY_START:
+                        depth++;
+                        break;
+
+                case JSON_READER_OBJECT_END:
+                case JSON_READER_ARRAY_END:
+                case JSON_READER_END:
+                        if (depth == 0)
+                                return 0;
+
+                        depth--;
+                        break;
+
+                case JSON_READER_KEY:
+                        if (depth == 0)
+                                return -EINVAL;
+                        break;
+
+                case JSON_READER_VALUE:
+                        break;
+
+                default:
+                        assert(token < 0);
+                        return token;
+                }
+
+                if (depth == 0)
+                        return 1;
+
+                token = json_reader_next_internal(r);
+        }
+}
+
+int json_reader_skip(JsonReader *r) {
+        JsonReaderSnapshot s;
+        int k;
+
+        assert(r);
+
+        /* Like json_reader_read_variant(), but just skips over the value without building it */
+
+        json_reader_snapshot(r, &s);
+
+        k = json_reader_skip_internal(r, json_reader_next_internal(r));
+        if (k == -EAGAIN)
+                json_reader_rollback(r, &s);
+        else
+                json_reader_commit(r);
+
+        return k;
+}
+
+int json_reader_dispatch_full(
+                JsonReader *r,
+                const sd_json_dispatch_field table[],
+                sd_json_dispatch_callback_t bad,
+                sd_json_dispatch_flags_t flags,
+                void *userdata,
+                const char **reterr_bad_field) {
+
+        size_t m = 0;
+        bool *found;
+        int token, k;
+
+        assert(r);
+
+        /* Reads the next value, which must be an object, and dispatches its fields via the table, like
+         * sd_json_dispatch_full() does. Only the value of one field at a time is built as variant. Returns
+         * > 0 on success, and 0 if the enclosing object or array (whose end is consumed), or the input,
+         * ended instead. */
+
+        if (!r->file && !r->eof) {
+                JsonReaderSnapshot s;
+
+                /* When fed piecemeal, make sure we have the whole object before dispatching anything, so
+                 * that -EAGAIN does not leave the dispatched data half filled in. */
+                json_reader_snapshot(r, &s);
+                k = json_reader_skip_internal(r, json_reader_next_internal(r));
+                json_reader_rollback(r, &s);
+                if (k < 0)
+                        return k;
+        }
+
+        token = json_reader_next_internal(r);
+        if (token < 0)
+                return token;
+        if (IN_SET(token, JSON_READER_OBJECT_END, JSON_READER_ARRAY_END, JSON_READER_END))
+                return 0;
+        if (token != JSON_READER_OBJECT_START) {
+                k = json_reader_skip_internal(r, token);
+                if (k < 0)
+                        return k;
+
+                json_log(NULL, flags, 0, "JSON variant is not an object.");
+
+                if (flags & SD_JSON_PERMISSIVE)
+                        return 1;
+
+                if (reterr_bad_field)
+                        *reterr_bad_field = NULL;
+
+                return -EINVAL;
+        }
+
+        for (const sd_json_dispatch_field *p = table; p->name; p++)
+                m++;
+
+        found = newa0(bool, m);
+
+        for (;;) {
+                _cleanup_(sd_json_variant_unrefp) sd_json_variant *value = NULL;
+                _cleanup_free_ char *key = NULL;
+
+                token = json_reader_next_internal(r);
+                if (token < 0)
+                        return token;
+                if (token == JSON_READER_OBJECT_END)
+                        break;
+
+                assert(token == JSON_READER_KEY);
+                key = TAKE_PTR(r->key);
+
+                k = json_reader_build(r, json_reader_next_internal(r), &value);
+                if (k < 0)
+                        return k;
+                assert(k > 0);
+
+                /* Keep the key around until the next token is read, since the dispatcher might return it
+                 * in reterr_bad_field */
+                free_and_replace(r->key, key);
+
+                k = json_dispatch_field(table, found, r->key, value, bad, flags, userdata, reterr_bad_field);
+                if (k < 0)
+                        return k;
+        }
+
+        k = json_dispatch_mandatory(NULL, table, found, flags, reterr_bad_field);
+        if (k < 0)
+                return k;
+
+        return 1;
+}
@@ -0,0 +1,61 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+#pragma once
+
+#include <stdio.h>
+
+#include "sd-json.h"
+
+#include "macro.h"
+
+/* A pull parser for JSON. Instead of building a tree of sd_json_variant objects for the whole input, the
+ * input is returned token by token, so that large documents can be processed with memory bounded by the
+ * largest value the caller asks for, rather than by the whole document. Input is either pushed into the
+ * reader piecemeal via json_reader_feed(), or pulled from a FILE stream as needed. */
+
+typedef struct JsonReader JsonReader;
+
+typedef enum JsonReaderToken {
+        JSON_READER_END,          /* The top-level value has been read completely */
+        JSON_READER_OBJECT_START,
+        JSON_READER_OBJECT_END,
+        JSON_READER_ARRAY_START,
+        JSON_READER_ARRAY_END,
+        JSON_READER_KEY,          /* An object key, see json_reader_key() */
+        JSON_READER_VALUE,        /* A string, number, boolean or null, see json_reader_value() */
+        _JSON_READER_TOKEN_MAX,
+        _JSON_READER_TOKEN_INVALID = -EINVAL,
+} JsonReaderToken;
+
+int json_reader_new(sd_json_parse_flags_t flags, JsonReader **ret);
+int json_reader_new_file(FILE *f, sd_json_parse_flags_t flags, JsonReader **ret);
+JsonReader* json_reader_free(JsonReader *r);
+DEFINE_TRIVIAL_CLEANUP_FUNC(JsonReader*, json_reader_free);
+
+int json_reader_feed(JsonReader *r, const void *data, size_t size);
+void json_reader_feed_eof(JsonReader *r);
+
+int json_reader_next(JsonReader *r);
+int json_reader_peek(JsonReader *r);
+
+const char* json_reader_key(JsonReader *r);
+sd_json_variant* json_reader_value(JsonReader *r);
+void json_reader_get_position(JsonReader *r, unsigned *ret_line, unsigned *ret_column);
+
+int json_reader_read_variant(JsonReader *r, sd_json_variant **ret);
+int json_reader_skip(JsonReader *r);
+
+int json_reader_dispatch_full(
+                JsonReader *r,
+                const sd_json_dispatch_field table[],
+                sd_json_dispatch_callback_t bad,
+                sd_json_dispatch_flags_t flags,
+                void *userdata,
+                const char **reterr_bad_field);
+static inline int json_reader_dispatch(
+                JsonReader *r,
+                const sd_json_dispatch_field table[],
+                sd_json_dispatch_flags_t flags,
+                void *userdata) {
+
+        return json_reader_dispatch_full(r, table, NULL, flags, userdata, NULL);
+}
@@ -106,6 +106,43 @@ int json_log_internal(sd_json_variant *variant, int level, int error, const char
 #define json_log_oom(variant, flags) \
         json_log(variant, flags, SYNTHETIC_ERRNO(ENOMEM), "Out of memory.")
 
+/* sd_json_dispatch_full() walks the table for every field of the object. For large tables that are used
+ * over and over again an index can be built once, so that fields are looked up by binary search instead.
+ * The index refers to the table, which hence must stay around for as long as the index is used. */
+typedef struct JsonDispatchIndex JsonDispatchIndex;
+
+int json_dispatch_index_new(const sd_json_dispatch_field table[], JsonDispatchIndex **ret);
+JsonDispatchIndex* json_dispatch_index_free(JsonDispatchIndex *index);
+DEFINE_TRIVIAL_CLEANUP_FUNC(JsonDispatchIndex*, json_dispatch_index_free);
+
+int json_dispatch_index_full(
+                sd_json_variant *v,
+                const JsonDispatchIndex *index,
+                sd_json_dispatch_callback_t bad,
+                sd_json_dispatch_flags_t flags,
+                void *userdata,
+                const char **reterr_bad_field);
+
+/* Builds the index on first use and stores it in *cache, where it is kept until the process exits. */
+int json_dispatch_cached_full(
+                sd_json_variant *v,
+                const sd_json_dispatch_field table[],
+                JsonDispatchIndex **cache,
+                sd_json_dispatch_callback_t bad,
+                sd_json_dispatch_flags_t flags,
+                void *userdata,
+                const char **reterr_bad_field);
+
+/* Drop-in replacements for sd_json_dispatch_full() and sd_json_dispatch() that keep the index in a
+ * variable private to the call site. Only use these with static tables. */
+#define json_dispatch_indexed_full(v, table, bad, flags, userdata, reterr_bad_field) \
+        ({                                                              \
+                static JsonDispatchIndex *_index = NULL;                \
+                json_dispatch_cached_full(v, table, &_index, bad, flags, userdata, reterr_bad_field); \
+        })
+#define json_dispatch_indexed(v, table, flags, userdata)                \
+        json_dispatch_indexed_full(v, table, NULL, flags, userdata, NULL)
+
 int json_dispatch_unbase64_iovec(const char *name, sd_json_variant *variant, sd_json_dispatch_flags_t flags, void *userdata);
 int json_dispatch_byte_array_iovec(const char *name, sd_json_variant *variant, sd_json_dispatch_flags_t flags, void *userdata);
 int json_dispatch_user_group_name(const char *name, sd_json_variant *variant, sd_json_dispatch_flags_t flags, void *userdata);
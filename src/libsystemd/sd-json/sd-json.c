@@ -28,10 +28,12 @@
 #include "memstream-util.h"
 #include "path-util.h"
 #include "set.h"
+#include "sort-util.h"
 #include "string-table.h"
 #include "string-util.h"
 #include "strv.h"
 #include "terminal-util.h"
+#include "unaligned.h"
 #include "user-util.h"
 #include "utf8.h"
 
@@ -106,6 +108,12 @@ struct sd_json_variant {
         /* If in addition to this object all objects referenced by it are also ordered strictly by name */
         bool normalized:1;
 
+        /* If this is a string embedded into an array/object, that is too long to be stored inline, we might
+         * store it in the same allocation as the surrounding array/object, after its elements, instead of
+         * referencing a separate string variant. In that case this bool is set, and the string is found via
+         * the .packed_string field below. For arrays/objects, this is set if any of the elements are packed. */
+        bool is_packed:1;
+
         union {
                 /* For simple types we store the value in-line. */
                 JsonValue value;
@@ -116,6 +124,10 @@ struct sd_json_variant {
                 /* If is_reference as indicated above is set, this is where the reference object is actually stored. */
                 sd_json_variant *reference;
 
+                /* If is_packed as indicated above is set, this points to the string, stored in the trailing
+                 * space of the allocation of the surrounding array/object. */
+                char *packed_string;
+
                 /* Strings are placed immediately after the structure. Note that when this is a sd_json_variant
                  * embedded into an array we might encode strings up to INLINE_STRING_LENGTH characters
                  * directly inside the element, while longer strings are stored as references. When this
@@ -126,8 +138,8 @@ struct sd_json_variant {
 };
 
 /* Inside string arrays we have a series of sd_json_variant structures one after the other. In this case, strings longer
- * than INLINE_STRING_MAX are stored as references, and all shorter ones inline. (This means — on x86-64 — strings up
- * to 7 chars are stored within the array elements, and all others in separate allocations) */
+ * than INLINE_STRING_MAX are stored as references or packed, and all shorter ones inline. (This means — on x86-64 —
+ * strings up to 7 chars are stored within the array elements, and all others after them, or in separate allocations) */
 #define INLINE_STRING_MAX (sizeof(sd_json_variant) - offsetof(sd_json_variant, string) - 1U)
 
 /* Let's make sure this structure isn't increased in size accidentally. This check is only for our most relevant arch
@@ -297,6 +309,61 @@ static sd_json_variant *json_variant_conservative_formalize(sd_json_variant *v)
         return json_variant_formalize(v);
 }
 
+static size_t json_variant_packed_size(sd_json_variant *v) {
+        const char *s;
+        size_t n;
+
+        /* Returns how much space to reserve for packing this variant into an array/object, i.e. for storing
+         * it in the allocation of the array/object. We do that for strings too long to be stored inline, if
+         * that way we don't keep a separate allocation alive: for const strings, other packed strings, and
+         * string variants only our caller holds a reference to, and which hence are likely freed right
+         * after. Sensitive strings are left alone, they are referenced as before. Returns 0 if the variant
+         * shall not be packed. */
+
+        v = json_variant_dereference(v);
+        if (!v || json_variant_is_magic(v))
+                return 0;
+
+        if (json_variant_is_regular(v)) {
+                if (v->type != SD_JSON_VARIANT_STRING || v->sensitive)
+                        return 0;
+
+                if (v->is_embedded) {
+                        if (!v->is_packed || v->parent->sensitive)
+                                return 0;
+                } else if (v->n_ref > 1)
+                        return 0;
+        }
+
+        assert_se(s = sd_json_variant_string(v));
+
+        n = strlen(s);
+        if (n <= INLINE_STRING_MAX)
+                return 0;
+
+        return n + 1;
+}
+
+static sd_json_variant* json_variant_new_container(sd_json_variant_type_t type, size_t n, size_t packed) {
+        sd_json_variant *v;
+
+        /* Allocates an array/object with room for n elements, followed by 'packed' bytes for packed strings */
+
+        if (size_multiply_overflow(sizeof(sd_json_variant), n + 1))
+                return NULL;
+
+        v = malloc(size_add(sizeof(sd_json_variant) * (n + 1), packed));
+        if (!v)
+                return NULL;
+
+        *v = (sd_json_variant) {
+                .n_ref = 1,
+                .type = type,
+        };
+
+        return v;
+}
+
 static int json_variant_new(sd_json_variant **ret, sd_json_variant_type_t type, size_t space) {
         sd_json_variant *v;
 
@@ -499,7 +566,7 @@ _public_ int sd_json_variant_new_uuid(sd_json_variant **ret, sd_id128_t id) {
         return sd_json_variant_new_string(ret, SD_ID128_TO_UUID_STRING(id));
 }
 
-static void json_variant_set(sd_json_variant *a, sd_json_variant *b) {
+static void json_variant_set(sd_json_variant *a, sd_json_variant *b, char **packed) {
         assert(a);
 
         b = json_variant_dereference(b);
@@ -538,6 +605,15 @@ static void json_variant_set(sd_json_variant *a, sd_json_variant *b) {
                         break;
                 }
 
+                /* Longer ones we pack, if the caller reserved space for that… */
+                size_t n = packed ? json_variant_packed_size(b) : 0;
+                if (n > 0) {
+                        a->is_packed = true;
+                        a->packed_string = memcpy(*packed, s, n);
+                        *packed += n;
+                        break;
+                }
+
                 /* For longer strings, use a reference… */
                 _fallthrough_;
         }
@@ -567,7 +643,7 @@ static void json_variant_copy_source(sd_json_variant *v, sd_json_variant *from)
         v->source = json_source_ref(from->source);
 }
 
-static int json_variant_array_put_element(sd_json_variant *array, sd_json_variant *element) {
+static int json_variant_array_put_element(sd_json_variant *array, sd_json_variant *element, char **packed) {
         assert(array);
         sd_json_variant *w = array + 1 + array->n_elements;
 
@@ -583,7 +659,7 @@ static int json_variant_array_put_element(sd_json_variant *array, sd_json_varian
                 .parent = array,
         };
 
-        json_variant_set(w, element);
+        json_variant_set(w, element, packed);
         json_variant_copy_source(w, element);
 
         if (!sd_json_variant_is_normalized(element))
@@ -592,29 +668,30 @@ static int json_variant_array_put_element(sd_json_variant *array, sd_json_varian
         return 0;
 }
 
-_public_ int sd_json_variant_new_array(sd_json_variant **ret, sd_json_variant **array, size_t n) {
+static int json_variant_new_array_internal(sd_json_variant **ret, sd_json_variant **array, size_t n, bool pack) {
         _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        size_t packed = 0;
+        char *p;
         int r;
 
-        assert_return(ret, -EINVAL);
-        if (n == 0) {
-                *ret = JSON_VARIANT_MAGIC_EMPTY_ARRAY;
-                return 0;
-        }
-        assert_return(array, -EINVAL);
+        assert(ret);
+        assert(array);
+        assert(n > 0);
+
+        if (pack)
+                for (size_t i = 0; i < n; i++)
+                        packed = size_add(packed, json_variant_packed_size(array[i]));
 
-        v = new(sd_json_variant, n + 1);
+        v = json_variant_new_container(SD_JSON_VARIANT_ARRAY, n, packed);
         if (!v)
                 return -ENOMEM;
 
-        *v = (sd_json_variant) {
-                .n_ref = 1,
-                .type = SD_JSON_VARIANT_ARRAY,
-                .normalized = true,
-        };
+        v->normalized = true;
+        v->is_packed = packed > 0;
 
+        p = (char*) (v + 1 + n);
         while (v->n_elements < n) {
-                r = json_variant_array_put_element(v, array[v->n_elements]);
+                r = json_variant_array_put_element(v, array[v->n_elements], pack ? &p : NULL);
                 if (r < 0)
                         return r;
         }
@@ -623,6 +700,17 @@ _public_ int sd_json_variant_new_array(sd_json_variant **ret, sd_json_variant **
         return 0;
 }
 
+_public_ int sd_json_variant_new_array(sd_json_variant **ret, sd_json_variant **array, size_t n) {
+        assert_return(ret, -EINVAL);
+        if (n == 0) {
+                *ret = JSON_VARIANT_MAGIC_EMPTY_ARRAY;
+                return 0;
+        }
+        assert_return(array, -EINVAL);
+
+        return json_variant_new_array_internal(ret, array, n, /* pack= */ true);
+}
+
 _public_ int sd_json_variant_new_array_bytes(sd_json_variant **ret, const void *p, size_t n) {
         assert_return(ret, -EINVAL);
         if (n == 0) {
@@ -661,8 +749,8 @@ _public_ int sd_json_variant_new_array_bytes(sd_json_variant **ret, const void *
 
 _public_ int sd_json_variant_new_array_strv(sd_json_variant **ret, char **l) {
         _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
-        size_t n;
-        int r;
+        size_t n, packed = 0;
+        char *p;
 
         assert(ret);
 
@@ -672,16 +760,21 @@ _public_ int sd_json_variant_new_array_strv(sd_json_variant **ret, char **l) {
                 return 0;
         }
 
-        v = new(sd_json_variant, n + 1);
+        STRV_FOREACH(i, l) {
+                size_t k = strlen(*i);
+
+                if (k > INLINE_STRING_MAX)
+                        packed = size_add(packed, k + 1);
+        }
+
+        v = json_variant_new_container(SD_JSON_VARIANT_ARRAY, n, packed);
         if (!v)
                 return -ENOMEM;
 
-        *v = (sd_json_variant) {
-                .n_ref = 1,
-                .type = SD_JSON_VARIANT_ARRAY,
-                .depth = 1,
-        };
+        v->depth = 1;
+        v->is_packed = packed > 0;
 
+        p = (char*) (v + 1 + n);
         for (v->n_elements = 0; v->n_elements < n; v->n_elements++) {
                 sd_json_variant *w = v + 1 + v->n_elements;
                 size_t k;
@@ -693,21 +786,16 @@ _public_ int sd_json_variant_new_array_strv(sd_json_variant **ret, char **l) {
                 };
 
                 k = strlen(l[v->n_elements]);
+                if (!utf8_is_valid_n(l[v->n_elements], k)) /* JSON strings must be valid UTF-8 */
+                        return -EUCLEAN;
 
                 if (k > INLINE_STRING_MAX) {
-                        /* If string is too long, store it as reference. */
-
-                        r = sd_json_variant_new_string(&w->reference, l[v->n_elements]);
-                        if (r < 0)
-                                return r;
-
-                        w->is_reference = true;
-                } else {
-                        if (!utf8_is_valid_n(l[v->n_elements], k)) /* JSON strings must be valid UTF-8 */
-                                return -EUCLEAN;
-
+                        /* If string is too long, store it after the elements. */
+                        w->is_packed = true;
+                        w->packed_string = memcpy(p, l[v->n_elements], k+1);
+                        p += k+1;
+                } else
                         memcpy(w->string, l[v->n_elements], k+1);
-                }
         }
 
         v->normalized = true;
@@ -718,7 +806,9 @@ _public_ int sd_json_variant_new_array_strv(sd_json_variant **ret, char **l) {
 
 _public_ int sd_json_variant_new_object(sd_json_variant **ret, sd_json_variant **array, size_t n) {
         _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        size_t packed = 0;
         const char *prev = NULL;
+        char *p;
         bool sorted = true, normalized = true;
 
         assert_return(ret, -EINVAL);
@@ -729,15 +819,16 @@ _public_ int sd_json_variant_new_object(sd_json_variant **ret, sd_json_variant *
         assert_return(array, -EINVAL);
         assert_return(n % 2 == 0, -EINVAL);
 
-        v = new(sd_json_variant, n + 1);
+        for (size_t i = 0; i < n; i++)
+                packed = size_add(packed, json_variant_packed_size(array[i]));
+
+        v = json_variant_new_container(SD_JSON_VARIANT_OBJECT, n, packed);
         if (!v)
                 return -ENOMEM;
 
-        *v = (sd_json_variant) {
-                .n_ref = 1,
-                .type = SD_JSON_VARIANT_OBJECT,
-        };
+        v->is_packed = packed > 0;
 
+        p = (char*) (v + 1 + n);
         for (v->n_elements = 0; v->n_elements < n; v->n_elements++) {
                 sd_json_variant *w = v + 1 + v->n_elements,
                             *c = array[v->n_elements];
@@ -769,7 +860,7 @@ _public_ int sd_json_variant_new_object(sd_json_variant **ret, sd_json_variant *
                         .parent = v,
                 };
 
-                json_variant_set(w, c);
+                json_variant_set(w, c, &p);
                 json_variant_copy_source(w, c);
         }
 
@@ -790,6 +881,9 @@ static size_t json_variant_size(sd_json_variant* v) {
         switch (v->type) {
 
         case SD_JSON_VARIANT_STRING:
+                if (v->is_packed)
+                        return offsetof(sd_json_variant, packed_string) + sizeof(char*);
+
                 return offsetof(sd_json_variant, string) + strlen(v->string) + 1;
 
         case SD_JSON_VARIANT_REAL:
@@ -840,8 +934,12 @@ static void json_variant_free_inner(sd_json_variant *v, bool force_sensitive) {
                 for (size_t i = 0; i < v->n_elements; i++)
                         json_variant_free_inner(v + 1 + i, sensitive);
 
-        if (sensitive)
+        if (sensitive) {
+                if (v->type == SD_JSON_VARIANT_STRING && v->is_packed)
+                        explicit_bzero_safe(v->packed_string, strlen(v->packed_string));
+
                 explicit_bzero_safe(v, json_variant_size(v));
+        }
 }
 
 static unsigned json_variant_n_ref(const sd_json_variant *v) {
@@ -921,6 +1019,8 @@ _public_ const char* sd_json_variant_string(sd_json_variant *v) {
                 return sd_json_variant_string(v->reference);
         if (v->type != SD_JSON_VARIANT_STRING)
                 goto mismatch;
+        if (v->is_packed)
+                return v->packed_string;
 
         return v->string;
 
@@ -1602,7 +1702,34 @@ static int print_source(FILE *f, sd_json_variant *v, sd_json_format_flags_t flag
         return 0;
 }
 
+static size_t json_string_plain_span(const char *q, size_t n) {
+        size_t i = 0;
+
+        /* Returns the number of bytes at the beginning of q that may be written out as they are, i.e. that
+         * are neither control characters, nor '"' nor '\\'. Looks at eight bytes at a time, using the usual
+         * tricks to detect whether any byte in a word is zero, or less than some value. */
+
+        const uint64_t ones = UINT64_C(0x0101010101010101), high = UINT64_C(0x8080808080808080);
+
+        for (; n - i >= sizeof(uint64_t); i += sizeof(uint64_t)) {
+                uint64_t w = unaligned_read_ne64(q + i), quote = w ^ (ones * '"'), backslash = w ^ (ones * '\\');
+
+                if ((((w - ones * ' ') & ~w) |
+                     ((quote - ones) & ~quote) |
+                     ((backslash - ones) & ~backslash)) & high)
+                        break;
+        }
+
+        for (; i < n; i++)
+                if (IN_SET(q[i], '"', '\\') || ((signed char) q[i] >= 0 && q[i] < ' '))
+                        break;
+
+        return i;
+}
+
 static void json_format_string(FILE *f, const char *q, sd_json_format_flags_t flags) {
+        size_t n;
+
         assert(q);
 
         fputc('"', f);
@@ -1610,7 +1737,18 @@ static void json_format_string(FILE *f, const char *q, sd_json_format_flags_t fl
         if (flags & SD_JSON_FORMAT_COLOR)
                 fputs(ansi_green(), f);
 
-        for (; *q; q++)
+        for (n = strlen(q);; q++, n--) {
+                size_t k;
+
+                /* Write out everything that needs no escaping in one go */
+                k = json_string_plain_span(q, n);
+                fwrite(q, 1, k, f);
+                q += k;
+                n -= k;
+
+                if (n == 0)
+                        break;
+
                 switch (*q) {
                 case '"':
                         fputs("\\\"", f);
@@ -1641,12 +1779,11 @@ static void json_format_string(FILE *f, const char *q, sd_json_format_flags_t fl
                         break;
 
                 default:
-                        if ((signed char) *q >= 0 && *q < ' ')
-                                fprintf(f, "\\u%04x", (unsigned) *q);
-                        else
-                                fputc(*q, f);
+                        /* json_string_plain_span() stops at nothing else but control characters */
+                        fprintf(f, "\\u%04x", (unsigned) *q);
                         break;
                 }
+        }
 
         if (flags & SD_JSON_FORMAT_COLOR)
                 fputs(ANSI_NORMAL, f);
@@ -2209,11 +2346,13 @@ _public_ int sd_json_variant_append_array(sd_json_variant **v, sd_json_variant *
         else
                 return -EINVAL;
 
+        /* Arrays we append to are not packed, so that we can extend them in place below, which we cannot
+         * do if the elements are followed by packed strings. */
         if (blank) {
-                r = sd_json_variant_new_array(&nv, (sd_json_variant*[]) { element }, 1);
+                r = json_variant_new_array_internal(&nv, (sd_json_variant*[]) { element }, 1, /* pack= */ false);
                 if (r < 0)
                         return r;
-        } else if (json_variant_n_ref(*v) == 1) {
+        } else if (json_variant_n_ref(*v) == 1 && !(*v)->is_packed) {
                 /* Let's bump the reference count on element. We can't do the realloc if we're appending *v
                  * to itself, or one of the objects embedded in *v to *v. If the reference count grows, we
                  * need to fall back to the other method below. */
@@ -2232,7 +2371,7 @@ _public_ int sd_json_variant_append_array(sd_json_variant **v, sd_json_variant *
                                 for (size_t i = 1; i < size; i++)
                                         (*v)[1 + i].parent = *v;
 
-                        return json_variant_array_put_element(*v, element);
+                        return json_variant_array_put_element(*v, element, /* packed= */ NULL);
                 }
         }
 
@@ -2248,7 +2387,7 @@ _public_ int sd_json_variant_append_array(sd_json_variant **v, sd_json_variant *
 
                 array[size] = element;
 
-                r = sd_json_variant_new_array(&nv, array, size + 1);
+                r = json_variant_new_array_internal(&nv, array, size + 1, /* pack= */ false);
                 if (r < 0)
                         return r;
         }
@@ -3468,7 +3607,86 @@ _public_ int sd_json_parse_file(
         return sd_json_parse_file_at(f, AT_FDCWD, path, flags, ret, reterr_line, reterr_column);
 }
 
+/* sd_json_build() doesn't allocate a string variant for each object field name, but refers to the names as
+ * const strings instead. That's safe, since the names only need to stay valid until the object they belong
+ * to is created, which copies them. Const strings need to be 2-aligned however (see above), hence names
+ * that are not are copied into a pool first, which is released when sd_json_build() is done. */
+typedef struct JsonNamePool JsonNamePool;
+
+struct JsonNamePool {
+        JsonNamePool *next;
+        size_t n_used;
+        size_t n_allocated;
+        char buffer[];
+};
+
+#define JSON_NAME_POOL_SIZE 1024U
+
+static JsonNamePool* json_name_pool_free(JsonNamePool *p) {
+        while (p) {
+                JsonNamePool *next = p->next;
+
+                free(p);
+                p = next;
+        }
+
+        return NULL;
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(JsonNamePool*, json_name_pool_free);
+
+static int json_build_name(JsonNamePool **pool, const char *name, sd_json_variant **ret) {
+        JsonNamePool *p;
+        size_t n, m;
+        char *s;
+
+        assert(pool);
+        assert(ret);
+
+        if (!name)
+                return sd_json_variant_new_null(ret);
+
+        n = strlen(name);
+        if (n == 0) {
+                *ret = JSON_VARIANT_MAGIC_EMPTY_STRING;
+                return 0;
+        }
+
+        if (!utf8_is_valid_n(name, n)) /* JSON strings must be valid UTF-8 */
+                return -EUCLEAN;
+
+        if ((((uintptr_t) name) & 1) == 0) {
+                *ret = (sd_json_variant*) ((uintptr_t) name + 1);
+                return 0;
+        }
+
+        m = ALIGN_TO(n + 1, 2);
+
+        p = *pool;
+        if (!p || p->n_allocated - p->n_used < m) {
+                size_t k = MAX(m, JSON_NAME_POOL_SIZE);
+
+                p = malloc(offsetof(JsonNamePool, buffer) + k);
+                if (!p)
+                        return -ENOMEM;
+
+                *p = (JsonNamePool) {
+                        .next = *pool,
+                        .n_allocated = k,
+                };
+
+                *pool = p;
+        }
+
+        s = memcpy(p->buffer + p->n_used, name, n + 1);
+        p->n_used += m;
+
+        *ret = (sd_json_variant*) ((uintptr_t) s + 1);
+        return 0;
+}
+
 _public_ int sd_json_buildv(sd_json_variant **ret, va_list ap) {
+        _cleanup_(json_name_pool_freep) JsonNamePool *pool = NULL;
         JsonStack *stack = NULL;
         size_t n_stack = 1;
         const char *name = NULL;
@@ -4212,7 +4430,7 @@ _public_ int sd_json_buildv(sd_json_variant **ret, va_list ap) {
                         name = va_arg(ap, const char *);
 
                         if (current->n_suppress == 0) {
-                                r = sd_json_variant_new_string(&add, name);
+                                r = json_build_name(&pool, name, &add);
                                 if (r < 0)
                                         goto finish;
                         }
@@ -4235,7 +4453,7 @@ _public_ int sd_json_buildv(sd_json_variant **ret, va_list ap) {
                         name = va_arg(ap, const char *);
 
                         if (b && current->n_suppress == 0) {
-                                r = sd_json_variant_new_string(&add, name);
+                                r = json_build_name(&pool, name, &add);
                                 if (r < 0)
                                         goto finish;
                         }
@@ -4262,7 +4480,7 @@ _public_ int sd_json_buildv(sd_json_variant **ret, va_list ap) {
                         u = va_arg(ap, uint64_t);
 
                         if (u != 0 && current->n_suppress == 0) {
-                                r = sd_json_variant_new_string(&add, n);
+                                r = json_build_name(&pool, n, &add);
                                 if (r < 0)
                                         goto finish;
 
@@ -4290,7 +4508,7 @@ _public_ int sd_json_buildv(sd_json_variant **ret, va_list ap) {
                         u = va_arg(ap, usec_t);
 
                         if (u != USEC_INFINITY && current->n_suppress == 0) {
-                                r = sd_json_variant_new_string(&add, n);
+                                r = json_build_name(&pool, n, &add);
                                 if (r < 0)
                                         goto finish;
 
@@ -4317,7 +4535,7 @@ _public_ int sd_json_buildv(sd_json_variant **ret, va_list ap) {
                         s = va_arg(ap, const char *);
 
                         if (!isempty(s) && current->n_suppress == 0) {
-                                r = sd_json_variant_new_string(&add, n);
+                                r = json_build_name(&pool, n, &add);
                                 if (r < 0)
                                         goto finish;
 
@@ -4345,7 +4563,7 @@ _public_ int sd_json_buildv(sd_json_variant **ret, va_list ap) {
                         l = va_arg(ap, char **);
 
                         if (!strv_isempty(l) && current->n_suppress == 0) {
-                                r = sd_json_variant_new_string(&add, n);
+                                r = json_build_name(&pool, n, &add);
                                 if (r < 0)
                                         goto finish;
 
@@ -4373,7 +4591,7 @@ _public_ int sd_json_buildv(sd_json_variant **ret, va_list ap) {
                         v = va_arg(ap, sd_json_variant *);
 
                         if (v && !sd_json_variant_is_null(v) && current->n_suppress == 0) {
-                                r = sd_json_variant_new_string(&add, n);
+                                r = json_build_name(&pool, n, &add);
                                 if (r < 0)
                                         goto finish;
 
@@ -4399,7 +4617,7 @@ _public_ int sd_json_buildv(sd_json_variant **ret, va_list ap) {
                         a = va_arg(ap, const struct in_addr *);
 
                         if (a && in4_addr_is_set(a) && current->n_suppress == 0) {
-                                r = sd_json_variant_new_string(&add, n);
+                                r = json_build_name(&pool, n, &add);
                                 if (r < 0)
                                         goto finish;
 
@@ -4427,7 +4645,7 @@ _public_ int sd_json_buildv(sd_json_variant **ret, va_list ap) {
                         a = va_arg(ap, const struct in6_addr *);
 
                         if (a && in6_addr_is_set(a) && current->n_suppress == 0) {
-                                r = sd_json_variant_new_string(&add, n);
+                                r = json_build_name(&pool, n, &add);
                                 if (r < 0)
                                         goto finish;
 
@@ -4457,7 +4675,7 @@ _public_ int sd_json_buildv(sd_json_variant **ret, va_list ap) {
                         f = va_arg(ap, int);
 
                         if (a && in_addr_is_set(f, a) && current->n_suppress == 0) {
-                                r = sd_json_variant_new_string(&add, n);
+                                r = json_build_name(&pool, n, &add);
                                 if (r < 0)
                                         goto finish;
 
@@ -4485,7 +4703,7 @@ _public_ int sd_json_buildv(sd_json_variant **ret, va_list ap) {
                         a = va_arg(ap, const struct ether_addr *);
 
                         if (a && !ether_addr_is_null(a) && current->n_suppress == 0) {
-                                r = sd_json_variant_new_string(&add, n);
+                                r = json_build_name(&pool, n, &add);
                                 if (r < 0)
                                         goto finish;
 
@@ -4513,7 +4731,7 @@ _public_ int sd_json_buildv(sd_json_variant **ret, va_list ap) {
                         a = va_arg(ap, const struct hw_addr_data *);
 
                         if (a && !hw_addr_is_null(a) && current->n_suppress == 0) {
-                                r = sd_json_variant_new_string(&add, n);
+                                r = json_build_name(&pool, n, &add);
                                 if (r < 0)
                                         goto finish;
 
@@ -4656,148 +4874,153 @@ static void *dispatch_userdata(const sd_json_dispatch_field *p, void *userdata)
         return SIZE_TO_PTR(p->offset);
 }
 
-_public_ int sd_json_dispatch_full(
-                sd_json_variant *v,
+static int json_dispatch_entry(
                 const sd_json_dispatch_field table[],
+                const sd_json_dispatch_field *p,
+                bool *found,
+                const char *key,
+                sd_json_variant *value,
                 sd_json_dispatch_callback_t bad,
                 sd_json_dispatch_flags_t flags,
                 void *userdata,
                 const char **reterr_bad_field) {
-        size_t m;
-        int r, done = 0;
-        bool *found;
 
-        if (!sd_json_variant_is_object(v)) {
-                json_log(v, flags, 0, "JSON variant is not an object.");
+        int r;
 
-                if (flags & SD_JSON_PERMISSIVE)
-                        return 0;
+        assert(found);
+        assert(key);
+        assert(value);
 
-                if (reterr_bad_field)
-                        *reterr_bad_field = NULL;
+        if (p) { /* Found a matching entry! 🙂 */
+                sd_json_dispatch_flags_t merged_flags;
 
-                return -EINVAL;
-        }
+                merged_flags = flags | p->flags;
 
-        m = 0;
-        for (const sd_json_dispatch_field *p = table; p->name; p++)
-                m++;
+                /* If an explicit type is specified, verify it matches */
+                if (p->type != _SD_JSON_VARIANT_TYPE_INVALID &&
+                    !sd_json_variant_has_type(value, p->type) &&
+                    !(FLAGS_SET(merged_flags, SD_JSON_NULLABLE) && sd_json_variant_is_null(value))) {
 
-        found = newa0(bool, m);
+                        json_log(value, merged_flags, 0,
+                                 "Object field '%s' has wrong type %s, expected %s.", key,
+                                 sd_json_variant_type_to_string(sd_json_variant_type(value)), sd_json_variant_type_to_string(p->type));
 
-        size_t n = sd_json_variant_elements(v);
-        for (size_t i = 0; i < n; i += 2) {
-                sd_json_variant *key, *value;
-                const sd_json_dispatch_field *p;
+                        if (merged_flags & SD_JSON_PERMISSIVE)
+                                return 0;
 
-                assert_se(key = sd_json_variant_by_index(v, i));
-                assert_se(value = sd_json_variant_by_index(v, i+1));
+                        if (reterr_bad_field)
+                                *reterr_bad_field = p->name;
+
+                        return -EINVAL;
+                }
 
-                for (p = table; p->name; p++)
-                        if (p->name == POINTER_MAX ||
-                            streq_ptr(sd_json_variant_string(key), p->name))
-                                break;
+                /* If the SD_JSON_REFUSE_NULL flag is specified, insist the field is not "null". Note
+                 * that this provides overlapping functionality with the type check above. */
+                if (FLAGS_SET(merged_flags, SD_JSON_REFUSE_NULL) && sd_json_variant_is_null(value)) {
 
-                if (p->name) { /* Found a matching entry! 🙂 */
-                        sd_json_dispatch_flags_t merged_flags;
+                        json_log(value, merged_flags, 0,
+                                 "Object field '%s' may not be null.", key);
 
-                        merged_flags = flags | p->flags;
+                        if (merged_flags & SD_JSON_PERMISSIVE)
+                                return 0;
 
-                        /* If an explicit type is specified, verify it matches */
-                        if (p->type != _SD_JSON_VARIANT_TYPE_INVALID &&
-                            !sd_json_variant_has_type(value, p->type) &&
-                            !(FLAGS_SET(merged_flags, SD_JSON_NULLABLE) && sd_json_variant_is_null(value))) {
+                        if (reterr_bad_field)
+                                *reterr_bad_field = p->name;
 
-                                json_log(value, merged_flags, 0,
-                                         "Object field '%s' has wrong type %s, expected %s.", sd_json_variant_string(key),
-                                         sd_json_variant_type_to_string(sd_json_variant_type(value)), sd_json_variant_type_to_string(p->type));
+                        return -EINVAL;
+                }
 
-                                if (merged_flags & SD_JSON_PERMISSIVE)
-                                        continue;
+                if (found[p-table]) {
+                        json_log(value, merged_flags, 0, "Duplicate object field '%s'.", key);
 
-                                if (reterr_bad_field)
-                                        *reterr_bad_field = p->name;
+                        if (merged_flags & SD_JSON_PERMISSIVE)
+                                return 0;
 
-                                return -EINVAL;
-                        }
+                        if (reterr_bad_field)
+                                *reterr_bad_field = p->name;
 
-                        /* If the SD_JSON_REFUSE_NULL flag is specified, insist the field is not "null". Note
-                         * that this provides overlapping functionality with the type check above. */
-                        if (FLAGS_SET(merged_flags, SD_JSON_REFUSE_NULL) && sd_json_variant_is_null(value)) {
+                        return -ENOTUNIQ;
+                }
 
-                                json_log(value, merged_flags, 0,
-                                         "Object field '%s' may not be null.", sd_json_variant_string(key));
+                found[p-table] = true;
 
+                if (p->callback) {
+                        r = p->callback(key, value, merged_flags, dispatch_userdata(p, userdata));
+                        if (r < 0) {
                                 if (merged_flags & SD_JSON_PERMISSIVE)
-                                        continue;
+                                        return 0;
 
                                 if (reterr_bad_field)
-                                        *reterr_bad_field = p->name;
+                                        *reterr_bad_field = key;
 
-                                return -EINVAL;
+                                return r;
                         }
+                }
 
-                        if (found[p-table]) {
-                                json_log(value, merged_flags, 0, "Duplicate object field '%s'.", sd_json_variant_string(key));
+                return 1;
 
-                                if (merged_flags & SD_JSON_PERMISSIVE)
-                                        continue;
+        } else { /* Didn't find a matching entry! ☹️ */
+
+                if (bad) {
+                        r = bad(key, value, flags, userdata);
+                        if (r < 0) {
+                                if (flags & SD_JSON_PERMISSIVE)
+                                        return 0;
 
                                 if (reterr_bad_field)
-                                        *reterr_bad_field = p->name;
+                                        *reterr_bad_field = key;
 
-                                return -ENOTUNIQ;
+                                return r;
                         }
 
-                        found[p-table] = true;
-
-                        if (p->callback) {
-                                r = p->callback(sd_json_variant_string(key), value, merged_flags, dispatch_userdata(p, userdata));
-                                if (r < 0) {
-                                        if (merged_flags & SD_JSON_PERMISSIVE)
-                                                continue;
-
-                                        if (reterr_bad_field)
-                                                *reterr_bad_field = sd_json_variant_string(key);
+                        return 1;
 
-                                        return r;
-                                }
+                } else  {
+                        if (flags & SD_JSON_ALLOW_EXTENSIONS) {
+                                json_log(value, flags|SD_JSON_DEBUG, 0, "Unrecognized object field '%s', assuming extension.", key);
+                                return 0;
                         }
 
-                        done++;
+                        json_log(value, flags, 0, "Unexpected object field '%s'.", key);
+                        if (flags & SD_JSON_PERMISSIVE)
+                                return 0;
 
-                } else { /* Didn't find a matching entry! ☹️ */
+                        if (reterr_bad_field)
+                                *reterr_bad_field = key;
 
-                        if (bad) {
-                                r = bad(sd_json_variant_string(key), value, flags, userdata);
-                                if (r < 0) {
-                                        if (flags & SD_JSON_PERMISSIVE)
-                                                continue;
+                        return -EADDRNOTAVAIL;
+                }
+        }
+}
 
-                                        if (reterr_bad_field)
-                                                *reterr_bad_field = sd_json_variant_string(key);
+int json_dispatch_field(
+                const sd_json_dispatch_field table[],
+                bool *found,
+                const char *key,
+                sd_json_variant *value,
+                sd_json_dispatch_callback_t bad,
+                sd_json_dispatch_flags_t flags,
+                void *userdata,
+                const char **reterr_bad_field) {
 
-                                        return r;
-                                } else
-                                        done++;
+        const sd_json_dispatch_field *p;
 
-                        } else  {
-                                if (flags & SD_JSON_ALLOW_EXTENSIONS) {
-                                        json_log(value, flags|SD_JSON_DEBUG, 0, "Unrecognized object field '%s', assuming extension.", sd_json_variant_string(key));
-                                        continue;
-                                }
+        for (p = table; p->name; p++)
+                if (p->name == POINTER_MAX ||
+                    streq_ptr(key, p->name))
+                        break;
 
-                                json_log(value, flags, 0, "Unexpected object field '%s'.", sd_json_variant_string(key));
-                                if (flags & SD_JSON_PERMISSIVE)
-                                        continue;
+        return json_dispatch_entry(table, p->name ? p : NULL, found, key, value, bad, flags, userdata, reterr_bad_field);
+}
 
-                                if (reterr_bad_field)
-                                        *reterr_bad_field = sd_json_variant_string(key);
+int json_dispatch_mandatory(
+                sd_json_variant *v,
+                const sd_json_dispatch_field table[],
+                const bool *found,
+                sd_json_dispatch_flags_t flags,
+                const char **reterr_bad_field) {
 
-                                return -EADDRNOTAVAIL;
-                        }
-                }
-        }
+        assert(found);
 
         for (const sd_json_dispatch_field *p = table; p->name; p++) {
                 sd_json_dispatch_flags_t merged_flags = p->flags | flags;
@@ -4815,9 +5038,211 @@ _public_ int sd_json_dispatch_full(
                 }
         }
 
+        return 0;
+}
+
+struct JsonDispatchIndex {
+        const sd_json_dispatch_field *table;
+        size_t n_fields;
+        const sd_json_dispatch_field *catch_all;  /* The first entry matching any field, if there is one */
+        bool have_mandatory;                      /* Whether any entry has SD_JSON_MANDATORY set */
+        size_t n_by_name;
+        const sd_json_dispatch_field *by_name[];  /* The named entries before 'catch_all', sorted by name */
+};
+
+static int dispatch_field_compare_name(const sd_json_dispatch_field * const *a, const sd_json_dispatch_field * const *b) {
+        return strcmp((*a)->name, (*b)->name);
+}
+
+static int dispatch_field_compare(const sd_json_dispatch_field * const *a, const sd_json_dispatch_field * const *b) {
+        int r;
+
+        r = dispatch_field_compare_name(a, b);
+        if (r != 0)
+                return r;
+
+        /* Keep entries with the same name in table order, since the first one wins */
+        return CMP(*a, *b);
+}
+
+int json_dispatch_index_new(const sd_json_dispatch_field table[], JsonDispatchIndex **ret) {
+        _cleanup_free_ JsonDispatchIndex *index = NULL;
+        size_t m = 0, k = 0;
+
+        assert(table);
+        assert(ret);
+
+        for (const sd_json_dispatch_field *p = table; p->name; p++)
+                m++;
+
+        index = malloc(offsetof(JsonDispatchIndex, by_name) + sizeof(sd_json_dispatch_field*) * m);
+        if (!index)
+                return -ENOMEM;
+
+        *index = (JsonDispatchIndex) {
+                .table = table,
+                .n_fields = m,
+        };
+
+        for (const sd_json_dispatch_field *p = table; p->name; p++) {
+                if (FLAGS_SET(p->flags, SD_JSON_MANDATORY))
+                        index->have_mandatory = true;
+
+                /* Entries after a catch-all entry are never matched by sd_json_dispatch_full() */
+                if (index->catch_all)
+                        continue;
+
+                if (p->name == POINTER_MAX)
+                        index->catch_all = p;
+                else
+                        index->by_name[index->n_by_name++] = p;
+        }
+
+        typesafe_qsort(index->by_name, index->n_by_name, dispatch_field_compare);
+
+        /* Drop all but the first of any entries with the same name */
+        for (size_t i = 0; i < index->n_by_name; i++)
+                if (k == 0 || !streq(index->by_name[k-1]->name, index->by_name[i]->name))
+                        index->by_name[k++] = index->by_name[i];
+        index->n_by_name = k;
+
+        *ret = TAKE_PTR(index);
+        return 0;
+}
+
+JsonDispatchIndex* json_dispatch_index_free(JsonDispatchIndex *index) {
+        return mfree(index);
+}
+
+static const sd_json_dispatch_field* json_dispatch_index_lookup(const JsonDispatchIndex *index, const char *key) {
+        const sd_json_dispatch_field k = { .name = key }, *kp = &k, * const *p;
+
+        assert(index);
+
+        /* All named entries in the index come before the catch-all entry, hence if we find one it wins */
+        p = typesafe_bsearch(&kp, index->by_name, index->n_by_name, dispatch_field_compare_name);
+        return p ? *p : index->catch_all;
+}
+
+static int json_dispatch_object(
+                sd_json_variant *v,
+                const sd_json_dispatch_field table[],
+                const JsonDispatchIndex *index,
+                sd_json_dispatch_callback_t bad,
+                sd_json_dispatch_flags_t flags,
+                void *userdata,
+                const char **reterr_bad_field) {
+        size_t m;
+        int r, done = 0;
+        bool *found;
+
+        if (!sd_json_variant_is_object(v)) {
+                json_log(v, flags, 0, "JSON variant is not an object.");
+
+                if (flags & SD_JSON_PERMISSIVE)
+                        return 0;
+
+                if (reterr_bad_field)
+                        *reterr_bad_field = NULL;
+
+                return -EINVAL;
+        }
+
+        if (index)
+                m = index->n_fields;
+        else {
+                m = 0;
+                for (const sd_json_dispatch_field *p = table; p->name; p++)
+                        m++;
+        }
+
+        found = newa0(bool, m);
+
+        size_t n = sd_json_variant_elements(v);
+        for (size_t i = 0; i < n; i += 2) {
+                sd_json_variant *key, *value;
+
+                assert_se(key = sd_json_variant_by_index(v, i));
+                assert_se(value = sd_json_variant_by_index(v, i+1));
+
+                if (index)
+                        r = json_dispatch_entry(table, json_dispatch_index_lookup(index, sd_json_variant_string(key)),
+                                                found, sd_json_variant_string(key), value, bad, flags, userdata, reterr_bad_field);
+                else
+                        r = json_dispatch_field(table, found, sd_json_variant_string(key), value, bad, flags, userdata, reterr_bad_field);
+                if (r < 0)
+                        return r;
+
+                done += r;
+        }
+
+        /* With an index we know whether there is anything to check at all */
+        if (!index || index->have_mandatory || FLAGS_SET(flags, SD_JSON_MANDATORY)) {
+                r = json_dispatch_mandatory(v, table, found, flags, reterr_bad_field);
+                if (r < 0)
+                        return r;
+        }
+
         return done;
 }
 
+_public_ int sd_json_dispatch_full(
+                sd_json_variant *v,
+                const sd_json_dispatch_field table[],
+                sd_json_dispatch_callback_t bad,
+                sd_json_dispatch_flags_t flags,
+                void *userdata,
+                const char **reterr_bad_field) {
+
+        return json_dispatch_object(v, table, NULL, bad, flags, userdata, reterr_bad_field);
+}
+
+int json_dispatch_index_full(
+                sd_json_variant *v,
+                const JsonDispatchIndex *index,
+                sd_json_dispatch_callback_t bad,
+                sd_json_dispatch_flags_t flags,
+                void *userdata,
+                const char **reterr_bad_field) {
+
+        assert(index);
+
+        return json_dispatch_object(v, index->table, index, bad, flags, userdata, reterr_bad_field);
+}
+
+int json_dispatch_cached_full(
+                sd_json_variant *v,
+                const sd_json_dispatch_field table[],
+                JsonDispatchIndex **cache,
+                sd_json_dispatch_callback_t bad,
+                sd_json_dispatch_flags_t flags,
+                void *userdata,
+                const char **reterr_bad_field) {
+
+        JsonDispatchIndex *index;
+
+        assert(cache);
+
+        index = __atomic_load_n(cache, __ATOMIC_ACQUIRE);
+        if (!index) {
+                JsonDispatchIndex *expected = NULL;
+
+                /* The index is only an optimization, hence if we can't allocate it dispatch without */
+                if (json_dispatch_index_new(table, &index) < 0)
+                        return sd_json_dispatch_full(v, table, bad, flags, userdata, reterr_bad_field);
+
+                /* Somebody else might have built the index in the meantime, in which case we use theirs */
+                if (!__atomic_compare_exchange_n(cache, &expected, index, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                        json_dispatch_index_free(index);
+                        index = expected;
+                }
+        }
+
+        assert(index->table == table);
+
+        return json_dispatch_index_full(v, index, bad, flags, userdata, reterr_bad_field);
+}
+
 _public_ int sd_json_dispatch(
                 sd_json_variant *v,
                 const sd_json_dispatch_field table[],
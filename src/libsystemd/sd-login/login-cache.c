@@ -0,0 +1,272 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <stdarg.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "alloc-util.h"
+#include "env-file.h"
+#include "env-util.h"
+#include "errno-util.h"
+#include "fd-util.h"
+#include "fs-util.h"
+#include "hashmap.h"
+#include "inotify-util.h"
+#include "log.h"
+#include "login-cache.h"
+#include "missing_threads.h"
+#include "path-util.h"
+#include "process-util.h"
+#include "string-util.h"
+#include "strv.h"
+
+#define LOGIN_CACHE_INOTIFY_MASK                                        \
+        (IN_CREATE|IN_DELETE|IN_MOVED_FROM|IN_MOVED_TO|IN_CLOSE_WRITE|  \
+         IN_DELETE_SELF|IN_MOVE_SELF|IN_ONLYDIR)
+
+static const char* const login_cache_dirs[] = {
+        "/run/systemd/seats",
+        "/run/systemd/sessions",
+        "/run/systemd/users",
+        "/run/systemd/machines",
+};
+
+typedef struct LoginCacheEntry {
+        char *path;
+        int error;          /* < 0 if reading the file or directory failed, and the call should fail the same way */
+        char **pairs;       /* For files: the key/value pairs */
+        char **files;       /* For directories: the listing */
+        int n_files;
+} LoginCacheEntry;
+
+static LoginCacheEntry* login_cache_entry_free(LoginCacheEntry *e) {
+        if (!e)
+                return NULL;
+
+        free(e->path);
+        strv_free(e->pairs);
+        strv_free(e->files);
+        return mfree(e);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(LoginCacheEntry*, login_cache_entry_free);
+
+DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(
+                login_cache_hash_ops,
+                char, path_hash_func, path_compare,
+                LoginCacheEntry, login_cache_entry_free);
+
+/* The cache is per thread, like the default bus and event loop objects, so that we can do without locking.
+ * Threads that want to use it will typically call into sd-login a lot, hence the little memory and the fd
+ * we keep around per thread doesn't matter. */
+static thread_local int login_cache_enabled = -1;
+static thread_local pid_t login_cache_pid = 0;
+static thread_local int login_cache_inotify_fd = -EBADF;
+static thread_local bool login_cache_watched[ELEMENTSOF(login_cache_dirs)] = {};
+static thread_local Hashmap *login_cache = NULL;
+
+static void login_cache_reset(void) {
+        login_cache = hashmap_free(login_cache);
+        login_cache_inotify_fd = safe_close(login_cache_inotify_fd);
+        zero(login_cache_watched);
+}
+
+static bool login_cache_events_pending(void) {
+        union inotify_event_buffer buffer;
+        ssize_t l;
+
+        l = read(login_cache_inotify_fd, &buffer, sizeof(buffer));
+        if (l < 0)
+                /* EAGAIN means nothing changed. On any other error, play it safe, and start from scratch. */
+                return !ERRNO_IS_TRANSIENT(errno);
+
+        return true;
+}
+
+static int login_cache_dir_index(const char *path) {
+        _cleanup_free_ char *dir = NULL;
+
+        /* Returns the index of the directory in login_cache_dirs[] that the path refers to, or a file
+         * immediately below */
+
+        for (size_t i = 0; i < ELEMENTSOF(login_cache_dirs); i++)
+                if (path_equal(path, login_cache_dirs[i]))
+                        return i;
+
+        if (path_extract_directory(path, &dir) < 0)
+                return -1;
+
+        for (size_t i = 0; i < ELEMENTSOF(login_cache_dirs); i++)
+                if (path_equal(dir, login_cache_dirs[i]))
+                        return i;
+
+        return -1;
+}
+
+static bool login_cache_prepare(const char *path) {
+        int i, r;
+
+        assert(path);
+
+        /* Returns true if the cache may be used for the specified path, after invalidating it if anything
+         * changed since the last call. */
+
+        if (login_cache_enabled < 0) {
+                r = secure_getenv_bool("SYSTEMD_LOGIN_CACHE");
+                if (r < 0 && r != -ENXIO)
+                        log_debug_errno(r, "Failed to parse $SYSTEMD_LOGIN_CACHE, ignoring: %m");
+
+                login_cache_enabled = r > 0;
+        }
+        if (!login_cache_enabled)
+                return false;
+
+        i = login_cache_dir_index(path);
+        if (i < 0)
+                return false;
+
+        /* After fork() the inotify instance is shared with the parent, and reading events from it here
+         * would steal them from the parent. Close our copy, and set up our own instead. */
+        if (login_cache_pid != getpid_cached()) {
+                login_cache_reset();
+                login_cache_pid = getpid_cached();
+        }
+
+        if (login_cache_inotify_fd >= 0 && login_cache_events_pending())
+                /* Something changed in one of the directories. That happens rarely enough for it not to be
+                 * worth figuring out what exactly, just start over. */
+                login_cache_reset();
+
+        if (login_cache_inotify_fd < 0) {
+                login_cache_inotify_fd = inotify_init1(IN_NONBLOCK|IN_CLOEXEC);
+                if (login_cache_inotify_fd < 0) {
+                        log_debug_errno(errno, "Failed to allocate inotify fd for login cache, not caching: %m");
+                        return false;
+                }
+        }
+
+        /* The directory might not exist (yet), in which case we can't watch it, and everything below it
+         * is read directly, until it shows up. */
+        if (!login_cache_watched[i]) {
+                if (inotify_add_watch(login_cache_inotify_fd, login_cache_dirs[i], LOGIN_CACHE_INOTIFY_MASK) < 0)
+                        return false;
+
+                login_cache_watched[i] = true;
+        }
+
+        return true;
+}
+
+static int login_cache_add(LoginCacheEntry **e) {
+        int r;
+
+        assert(e);
+        assert(*e);
+
+        r = hashmap_ensure_put(&login_cache, &login_cache_hash_ops, (*e)->path, *e);
+        if (r < 0)
+                return r;
+
+        TAKE_PTR(*e);
+        return 0;
+}
+
+int login_cache_parse_env_file_sentinel(const char *path, ...) {
+        _cleanup_(login_cache_entry_freep) LoginCacheEntry *n = NULL;
+        LoginCacheEntry *e;
+        const char *key;
+        va_list ap;
+        int r = 0;
+
+        assert(path);
+
+        if (!login_cache_prepare(path)) {
+                va_start(ap, path);
+                r = parse_env_filev(NULL, path, ap);
+                va_end(ap);
+                return r;
+        }
+
+        e = hashmap_get(login_cache, path);
+        if (!e) {
+                n = new0(LoginCacheEntry, 1);
+                if (!n)
+                        return -ENOMEM;
+
+                n->path = strdup(path);
+                if (!n->path)
+                        return -ENOMEM;
+
+                n->error = load_env_file_pairs(NULL, path, &n->pairs);
+                e = n;
+
+                /* Not being able to cache is not fatal */
+                (void) login_cache_add(&n);
+        }
+
+        if (e->error < 0)
+                return e->error;
+
+        va_start(ap, path);
+        while ((key = va_arg(ap, const char*))) {
+                char **v = va_arg(ap, char**);
+                const char *value = NULL;
+
+                /* Like parse_env_file() the last assignment wins */
+                STRV_FOREACH_PAIR(k, val, e->pairs)
+                        if (streq(*k, key))
+                                value = *val;
+
+                if (value) {
+                        r = free_and_strdup(v, value);
+                        if (r < 0)
+                                break;
+                }
+        }
+        va_end(ap);
+
+        return r < 0 ? r : 0;
+}
+
+int login_cache_get_files_in_directory(const char *path, char ***ret) {
+        _cleanup_(login_cache_entry_freep) LoginCacheEntry *n = NULL;
+        LoginCacheEntry *e;
+
+        assert(path);
+
+        if (!login_cache_prepare(path))
+                return get_files_in_directory(path, ret);
+
+        e = hashmap_get(login_cache, path);
+        if (!e) {
+                n = new0(LoginCacheEntry, 1);
+                if (!n)
+                        return -ENOMEM;
+
+                n->path = strdup(path);
+                if (!n->path)
+                        return -ENOMEM;
+
+                n->n_files = n->error = get_files_in_directory(path, &n->files);
+                e = n;
+
+                (void) login_cache_add(&n);
+        }
+
+        if (e->error < 0)
+                return e->error;
+
+        if (ret) {
+                char **l = NULL;
+
+                if (e->files) {
+                        l = strv_copy(e->files);
+                        if (!l)
+                                return -ENOMEM;
+                }
+
+                *ret = l;
+        }
+
+        return e->n_files;
+}
@@ -0,0 +1,14 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+#pragma once
+
+#include "macro.h"
+
+/* Drop-in replacements for parse_env_file() and get_files_in_directory() for the state files and
+ * directories logind and machined maintain in /run/systemd/, that serve repeated calls from an in-process
+ * cache, if $SYSTEMD_LOGIN_CACHE=1 is set. The cache is invalidated via inotify, much like
+ * sd_login_monitor does it, hence never returns stale data. */
+
+int login_cache_parse_env_file_sentinel(const char *path, ...) _sentinel_;
+#define login_cache_parse_env_file(path, ...) login_cache_parse_env_file_sentinel(path, __VA_ARGS__, NULL)
+
+int login_cache_get_files_in_directory(const char *path, char ***ret);
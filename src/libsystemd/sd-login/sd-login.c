@@ -18,6 +18,7 @@
 #include "fs-util.h"
 #include "hostname-util.h"
 #include "io-util.h"
+#include "login-cache.h"
 #include "login-util.h"
 #include "macro.h"
 #include "parse-util.h"
@@ -467,7 +468,7 @@ _public_ int sd_uid_get_state(uid_t uid, char**state) {
         if (r < 0)
                 return r;
 
-        r = parse_env_file(NULL, p, "STATE", &s);
+        r = login_cache_parse_env_file(p, "STATE", &s);
         if (r == -ENOENT)
                 r = free_and_strdup(&s, "offline");
         if (r < 0)
@@ -489,7 +490,7 @@ _public_ int sd_uid_get_display(uid_t uid, char **session) {
         if (r < 0)
                 return r;
 
-        r = parse_env_file(NULL, p, "DISPLAY", &s);
+        r = login_cache_parse_env_file(p, "DISPLAY", &s);
         if (r == -ENOENT)
                 return -ENODATA;
         if (r < 0)
@@ -513,7 +514,7 @@ _public_ int sd_uid_get_login_time(uid_t uid, uint64_t *usec) {
         if (r < 0)
                 return r;
 
-        r = parse_env_file(NULL, p, "STATE", &s, "REALTIME", &rt);
+        r = login_cache_parse_env_file(p, "STATE", &s, "REALTIME", &rt);
         if (r == -ENOENT)
                 return -ENXIO;
         if (r < 0)
@@ -569,9 +570,9 @@ _public_ int sd_uid_is_on_seat(uid_t uid, int require_active, const char *seat)
         if (r < 0)
                 return r;
 
-        r = parse_env_file(NULL, filename,
-                           require_active ? "ACTIVE_UID" : "UIDS",
-                           &content);
+        r = login_cache_parse_env_file(filename,
+                                       require_active ? "ACTIVE_UID" : "UIDS",
+                                       &content);
         if (r == -ENOENT)
                 return 0;
         if (r < 0)
@@ -593,7 +594,7 @@ static int uid_get_array(uid_t uid, const char *variable, char ***array) {
         if (r < 0)
                 return r;
 
-        r = parse_env_file(NULL, p, variable, &s);
+        r = login_cache_parse_env_file(p, variable, &s);
         if (r == -ENOENT || (r >= 0 && isempty(s))) {
                 if (array)
                         *array = NULL;
@@ -671,7 +672,7 @@ _public_ int sd_session_is_active(const char *session) {
         if (r < 0)
                 return r;
 
-        r = parse_env_file(NULL, p, "ACTIVE", &s);
+        r = login_cache_parse_env_file(p, "ACTIVE", &s);
         if (r == -ENOENT)
                 return -ENXIO;
         if (r < 0)
@@ -690,7 +691,7 @@ _public_ int sd_session_is_remote(const char *session) {
         if (r < 0)
                 return r;
 
-        r = parse_env_file(NULL, p, "REMOTE", &s);
+        r = login_cache_parse_env_file(p, "REMOTE", &s);
         if (r == -ENOENT)
                 return -ENXIO;
         if (r < 0)
@@ -711,7 +712,7 @@ _public_ int sd_session_get_state(const char *session, char **state) {
         if (r < 0)
                 return r;
 
-        r = parse_env_file(NULL, p, "STATE", &s);
+        r = login_cache_parse_env_file(p, "STATE", &s);
         if (r == -ENOENT)
                 return -ENXIO;
         if (r < 0)
@@ -734,7 +735,7 @@ _public_ int sd_session_get_uid(const char *session, uid_t *uid) {
         if (r < 0)
                 return r;
 
-        r = parse_env_file(NULL, p, "UID", &s);
+        r = login_cache_parse_env_file(p, "UID", &s);
         if (r == -ENOENT)
                 return -ENXIO;
         if (r < 0)
@@ -756,7 +757,7 @@ static int session_get_string(const char *session, const char *field, char **val
         if (r < 0)
                 return r;
 
-        r = parse_env_file(NULL, p, field, &s);
+        r = login_cache_parse_env_file(p, field, &s);
         if (r == -ENOENT)
                 return -ENXIO;
         if (r < 0)
@@ -787,7 +788,7 @@ _public_ int sd_session_get_start_time(const char *session, uint64_t *usec) {
         if (r < 0)
                 return r;
 
-        r = parse_env_file(NULL, p, "REALTIME", &s);
+        r = login_cache_parse_env_file(p, "REALTIME", &s);
         if (r == -ENOENT)
                 return -ENXIO;
         if (r < 0)
@@ -896,9 +897,9 @@ _public_ int sd_seat_get_active(const char *seat, char **session, uid_t *uid) {
         if (r < 0)
                 return r;
 
-        r = parse_env_file(NULL, p,
-                           "ACTIVE", &s,
-                           "ACTIVE_UID", &t);
+        r = login_cache_parse_env_file(p,
+                                       "ACTIVE", &s,
+                                       "ACTIVE_UID", &t);
         if (r == -ENOENT)
                 return -ENXIO;
         if (r < 0)
@@ -938,9 +939,9 @@ _public_ int sd_seat_get_sessions(
         if (r < 0)
                 return r;
 
-        r = parse_env_file(NULL, fname,
-                           "SESSIONS", &session_line,
-                           "UIDS", &uid_line);
+        r = login_cache_parse_env_file(fname,
+                                       "SESSIONS", &session_line,
+                                       "UIDS", &uid_line);
         if (r == -ENOENT)
                 return -ENXIO;
         if (r < 0)
@@ -998,8 +999,8 @@ static int seat_get_can(const char *seat, const char *variable) {
         if (r < 0)
                 return r;
 
-        r = parse_env_file(NULL, p,
-                           variable, &s);
+        r = login_cache_parse_env_file(p,
+                                       variable, &s);
         if (r == -ENOENT)
                 return -ENXIO;
         if (r < 0)
@@ -1025,7 +1026,7 @@ _public_ int sd_seat_can_graphical(const char *seat) {
 _public_ int sd_get_seats(char ***seats) {
         int r;
 
-        r = get_files_in_directory("/run/systemd/seats/", seats);
+        r = login_cache_get_files_in_directory("/run/systemd/seats/", seats);
         if (r == -ENOENT) {
                 if (seats)
                         *seats = NULL;
@@ -1037,7 +1038,7 @@ _public_ int sd_get_seats(char ***seats) {
 _public_ int sd_get_sessions(char ***sessions) {
         int r;
 
-        r = get_files_in_directory("/run/systemd/sessions/", sessions);
+        r = login_cache_get_files_in_directory("/run/systemd/sessions/", sessions);
         if (r == -ENOENT) {
                 if (sessions)
                         *sessions = NULL;
@@ -1102,7 +1103,7 @@ _public_ int sd_get_machine_names(char ***machines) {
         char **a, **b;
         int r;
 
-        r = get_files_in_directory("/run/systemd/machines/", &l);
+        r = login_cache_get_files_in_directory("/run/systemd/machines/", &l);
         if (r == -ENOENT) {
                 if (machines)
                         *machines = NULL;
@@ -1150,7 +1151,7 @@ _public_ int sd_machine_get_class(const char *machine, char **class) {
                         return -EINVAL;
 
                 p = strjoina("/run/systemd/machines/", machine);
-                r = parse_env_file(NULL, p, "CLASS", &c);
+                r = login_cache_parse_env_file(p, "CLASS", &c);
                 if (r == -ENOENT)
                         return -ENXIO;
                 if (r < 0)
@@ -1171,7 +1172,7 @@ _public_ int sd_machine_get_ifindices(const char *machine, int **ret_ifindices)
         assert_return(hostname_is_valid(machine, 0), -EINVAL);
 
         p = strjoina("/run/systemd/machines/", machine);
-        r = parse_env_file(NULL, p, "NETIF", &netif_line);
+        r = login_cache_parse_env_file(p, "NETIF", &netif_line);
         if (r == -ENOENT)
                 return -ENXIO;
         if (r < 0)
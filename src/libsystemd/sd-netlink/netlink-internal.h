@@ -17,6 +17,12 @@
 
 #define NETLINK_CONTAINER_DEPTH 32
 
+/* The minimum size of the receive buffer, matches the largest dump datagram the kernel creates. */
+#define NETLINK_RBUFFER_SIZE (32U * 1024U)
+
+/* The maximum number of datagrams read in one go while waiting for a complete message. */
+#define NETLINK_READ_BATCH_MAX 64U
+
 struct reply_callback {
         sd_netlink_message_handler_t callback;
         usec_t timeout;
@@ -123,7 +129,9 @@ struct sd_netlink_message {
         struct netlink_container containers[NETLINK_CONTAINER_DEPTH];
         unsigned n_containers; /* number of containers */
         uint32_t multicast_group;
+        size_t header_size; /* size of the family specific header, used when parsing attributes lazily */
         bool sealed:1;
+        bool parse_pending:1; /* top-level attributes are parsed on first access */
 
         sd_netlink_message *next; /* next in a chain of multi-part messages */
 };
@@ -718,6 +718,8 @@ int sd_netlink_message_cancel_array(sd_netlink_message *m) {
         return 0;
 }
 
+static int netlink_message_parse_top_level(sd_netlink_message *m);
+
 static int netlink_message_read_internal(
                 sd_netlink_message *m,
                 uint16_t attr_type,
@@ -732,6 +734,14 @@ static int netlink_message_read_internal(
 
         assert(m->n_containers < NETLINK_CONTAINER_DEPTH);
 
+        if (m->n_containers == 0) {
+                int r;
+
+                r = netlink_message_parse_top_level(m);
+                if (r < 0)
+                        return r;
+        }
+
         if (!m->containers[m->n_containers].attributes)
                 return -ENODATA;
 
@@ -1298,6 +1308,14 @@ int sd_netlink_message_get_max_attribute(sd_netlink_message *m, uint16_t *ret) {
         assert_return(m->sealed, -EINVAL);
         assert_return(ret, -EINVAL);
 
+        if (m->n_containers == 0) {
+                int r;
+
+                r = netlink_message_parse_top_level(m);
+                if (r < 0)
+                        return r;
+        }
+
         *ret = m->containers[m->n_containers].max_attribute;
         return 0;
 }
@@ -1344,8 +1362,31 @@ static int netlink_message_parse_error(sd_netlink_message *m) {
                                        NLMSG_PAYLOAD(m->hdr, hlen));
 }
 
+static int netlink_message_parse_top_level(sd_netlink_message *m) {
+        int r;
+
+        assert(m);
+        assert(m->hdr);
+        assert(m->n_containers == 0);
+
+        if (!m->parse_pending)
+                return 0;
+
+        if (sd_netlink_message_is_error(m))
+                r = netlink_message_parse_error(m);
+        else
+                r = netlink_container_parse(m,
+                                            &m->containers[0],
+                                            (struct rtattr*)((uint8_t*) NLMSG_DATA(m->hdr) + NLMSG_ALIGN(m->header_size)),
+                                            NLMSG_PAYLOAD(m->hdr, m->header_size));
+        if (r < 0)
+                return r;
+
+        m->parse_pending = false;
+        return 0;
+}
+
 int sd_netlink_message_rewind(sd_netlink_message *m, sd_netlink *nl) {
-        size_t size;
         int r;
 
         assert_return(m, -EINVAL);
@@ -1359,24 +1400,21 @@ int sd_netlink_message_rewind(sd_netlink_message *m, sd_netlink *nl) {
 
         m->n_containers = 0;
 
-        if (m->containers[0].attributes)
-                /* top-level attributes have already been parsed */
+        if (m->parse_pending || m->containers[0].attributes)
+                /* top-level attributes have already been looked up */
                 return 0;
 
         assert(m->hdr);
 
         r = netlink_get_policy_set_and_header_size(nl, m->hdr->nlmsg_type,
-                                                   &m->containers[0].policy_set, &size);
+                                                   &m->containers[0].policy_set, &m->header_size);
         if (r < 0)
                 return r;
 
-        if (sd_netlink_message_is_error(m))
-                return netlink_message_parse_error(m);
-
-        return netlink_container_parse(m,
-                                       &m->containers[0],
-                                       (struct rtattr*)((uint8_t*) NLMSG_DATA(m->hdr) + NLMSG_ALIGN(size)),
-                                       NLMSG_PAYLOAD(m->hdr, size));
+        /* The attribute table is built on first access. Messages from large dumps are often dropped by
+         * the consumer after only looking at the header, so there is no point in indexing them upfront. */
+        m->parse_pending = true;
+        return 0;
 }
 
 void message_seal(sd_netlink_message *m) {
@@ -368,12 +368,27 @@ finalize:
         return 0;
 }
 
-/* On success, the number of bytes received is returned and *ret points to the received message
- * which has a valid header and the correct size.
- * If nothing useful was received 0 is returned.
- * On failure, a negative error code is returned.
- */
-int socket_read_message(sd_netlink *nl) {
+static sd_netlink_message* message_chain_reverse(sd_netlink_message *m) {
+        sd_netlink_message *prev = NULL;
+
+        /* Partially received multi-part messages are chained in reverse order, so that appending a part
+         * is O(1) even for dumps with a huge number of parts. Restore the order once complete. */
+
+        while (m) {
+                sd_netlink_message *next = m->next;
+
+                m->next = prev;
+                prev = m;
+                m = next;
+        }
+
+        return prev;
+}
+
+/* Reads one datagram from the socket and queues the messages it contains.
+ * Returns 0 if nothing was read, 1 if a datagram was consumed but no message is complete yet, and 2 if at
+ * least one complete message was put into the read queue. On failure, a negative error code is returned. */
+static int socket_read_datagram(sd_netlink *nl) {
         bool done = false;
         uint32_t group;
         size_t len;
@@ -387,8 +402,10 @@ int socket_read_message(sd_netlink *nl) {
                 return r;
         len = (size_t) r;
 
-        /* make room for the pending message */
-        if (!greedy_realloc((void**) &nl->rbuffer, len, sizeof(uint8_t)))
+        /* Make room for the pending message. Always provide at least NETLINK_RBUFFER_SIZE bytes: the kernel
+         * sizes dump datagrams by the largest buffer we passed to recvmsg() so far, hence a large buffer
+         * means far fewer datagrams (and wakeups) per dump. */
+        if (!greedy_realloc((void**) &nl->rbuffer, MAX(len, (size_t) NETLINK_RBUFFER_SIZE), sizeof(uint8_t)))
                 return -ENOMEM;
 
         /* read the pending message */
@@ -399,7 +416,7 @@ int socket_read_message(sd_netlink *nl) {
 
         if (!NLMSG_OK(nl->rbuffer, len)) {
                 log_debug("sd-netlink: received invalid message, discarding %zu bytes of incoming message", len);
-                return 0;
+                return 1;
         }
 
         for (struct nlmsghdr *hdr = nl->rbuffer; NLMSG_OK(hdr, len); hdr = NLMSG_NEXT(hdr, len)) {
@@ -416,7 +433,8 @@ int socket_read_message(sd_netlink *nl) {
                                 _cleanup_(sd_netlink_message_unrefp) sd_netlink_message *existing = NULL;
 
                                 /* finished reading multi-part message */
-                                existing = hashmap_remove(nl->rqueue_partial_by_serial, UINT32_TO_PTR(hdr->nlmsg_seq));
+                                existing = message_chain_reverse(
+                                                hashmap_remove(nl->rqueue_partial_by_serial, UINT32_TO_PTR(hdr->nlmsg_seq)));
 
                                 /* if we receive only NLMSG_DONE, put it into the receive queue. */
                                 r = netlink_queue_received_message(nl, existing ?: m);
@@ -429,11 +447,16 @@ int socket_read_message(sd_netlink *nl) {
 
                                 existing = hashmap_get(nl->rqueue_partial_by_serial, UINT32_TO_PTR(hdr->nlmsg_seq));
                                 if (existing) {
-                                        /* This is the continuation of the previously read messages.
-                                         * Let's append this message at the end. */
-                                        while (existing->next)
-                                                existing = existing->next;
-                                        existing->next = TAKE_PTR(m);
+                                        /* This is the continuation of the previously read messages. Prepend
+                                         * it to the chain, the reference held by the queue is passed on to
+                                         * the new head. */
+                                        m->next = existing;
+                                        r = hashmap_update(nl->rqueue_partial_by_serial, UINT32_TO_PTR(hdr->nlmsg_seq), m);
+                                        if (r < 0) {
+                                                m->next = NULL;
+                                                return r;
+                                        }
+                                        TAKE_PTR(m);
                                 } else {
                                         /* This is the first message. Put it into the queue for partially
                                          * received messages. */
@@ -455,5 +478,25 @@ int socket_read_message(sd_netlink *nl) {
         if (len > 0)
                 log_debug("sd-netlink: discarding trailing %zu bytes of incoming message", len);
 
-        return done;
+        return done ? 2 : 1;
+}
+
+/* Reads from the socket until at least one complete message is queued, nothing more is pending, or
+ * NETLINK_READ_BATCH_MAX datagrams were consumed. The latter avoids a poll() roundtrip for every single
+ * datagram of a large dump, while not starving other event sources.
+ * Returns 1 if a complete message was received, 0 if not. On failure, a negative error code is returned. */
+int socket_read_message(sd_netlink *nl) {
+        int r;
+
+        assert(nl);
+
+        for (unsigned i = 0; i < NETLINK_READ_BATCH_MAX; i++) {
+                r = socket_read_datagram(nl);
+                if (r <= 0)
+                        return r;
+                if (r > 1)
+                        return 1;
+        }
+
+        return 0;
 }
@@ -235,6 +235,28 @@ int manager_add_inhibitor(Manager *m, const char* id, Inhibitor **ret) {
         return 0;
 }
 
+void manager_flush_save_queue(Manager *m) {
+        Session *session;
+        User *user;
+
+        assert(m);
+
+        /* Writes out the state files of all sessions and users that changed since the last time. This is
+         * called once per event loop iteration, as well as before we tell clients about a session they might
+         * then look up via sd-login, so that state changes that come in bulk (e.g. while a session is being
+         * set up) result in a single write. */
+
+        while ((session = LIST_POP(save_queue, m->session_save_queue))) {
+                session->in_save_queue = false;
+                (void) session_save_now(session);
+        }
+
+        while ((user = LIST_POP(save_queue, m->user_save_queue))) {
+                user->in_save_queue = false;
+                (void) user_save_now(user);
+        }
+}
+
 int manager_add_button(Manager *m, const char *name, Button **ret_button) {
         Button *b;
 
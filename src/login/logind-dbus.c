@@ -998,6 +998,8 @@ static int create_session(
         if (r < 0)
                 goto fail;
 
+        session->create_usec = now(CLOCK_MONOTONIC);
+
         session_set_user(session, user);
         r = session_set_leader_consume(session, TAKE_PIDREF(leader));
         if (r < 0)
@@ -4284,6 +4286,9 @@ int match_reloading(sd_bus_message *message, void *userdata, sd_bus_error *error
         HASHMAP_FOREACH(session, m->sessions)
                 session_add_to_gc_queue(session);
 
+        /* We might be talking to a different version of PID 1 now */
+        m->scope_pidfd_supported = -1;
+
         return 0;
 }
 
@@ -4301,7 +4306,7 @@ int manager_send_changed(Manager *manager, const char *property, ...) {
                         l);
 }
 
-int manager_start_scope(
+static int manager_new_start_scope_message(
                 Manager *manager,
                 const char *scope,
                 const PidRef *pidref,
@@ -4312,17 +4317,15 @@ int manager_start_scope(
                 const char * const *extra_after,
                 const char *requires_mounts_for,
                 sd_bus_message *more_properties,
-                sd_bus_error *error,
-                char **ret_job) {
+                sd_bus_message **ret) {
 
-        _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL, *reply = NULL;
-        _cleanup_(sd_bus_error_free) sd_bus_error e = SD_BUS_ERROR_NULL;
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
         int r;
 
         assert(manager);
         assert(scope);
         assert(pidref_is_set(pidref));
-        assert(ret_job);
+        assert(ret);
 
         r = bus_message_new_method_call(manager->bus, &m, bus_systemd_mgr, "StartTransientUnit");
         if (r < 0)
@@ -4406,12 +4409,55 @@ int manager_start_scope(
         if (r < 0)
                 return r;
 
+        *ret = TAKE_PTR(m);
+        return 0;
+}
+
+int manager_start_scope(
+                Manager *manager,
+                const char *scope,
+                const PidRef *pidref,
+                bool allow_pidfd,
+                const char *slice,
+                const char *description,
+                const char * const *requires,
+                const char * const *extra_after,
+                const char *requires_mounts_for,
+                sd_bus_message *more_properties,
+                sd_bus_error *error,
+                char **ret_job) {
+
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL, *reply = NULL;
+        _cleanup_(sd_bus_error_free) sd_bus_error e = SD_BUS_ERROR_NULL;
+        int r;
+
+        assert(manager);
+        assert(ret_job);
+
+        r = manager_new_start_scope_message(
+                        manager,
+                        scope,
+                        pidref,
+                        allow_pidfd,
+                        slice,
+                        description,
+                        requires,
+                        extra_after,
+                        requires_mounts_for,
+                        more_properties,
+                        &m);
+        if (r < 0)
+                return r;
+
         r = sd_bus_call(manager->bus, m, 0, &e, &reply);
         if (r < 0) {
                 /* If this failed with a property we couldn't write, this is quite likely because the server
                  * doesn't support PIDFDs yet, let's try without. */
                 if (allow_pidfd &&
-                    sd_bus_error_has_names(&e, SD_BUS_ERROR_UNKNOWN_PROPERTY, SD_BUS_ERROR_PROPERTY_READ_ONLY))
+                    sd_bus_error_has_names(&e, SD_BUS_ERROR_UNKNOWN_PROPERTY, SD_BUS_ERROR_PROPERTY_READ_ONLY)) {
+                        if (pidref->fd >= 0)
+                                manager->scope_pidfd_supported = false;
+
                         return manager_start_scope(
                                         manager,
                                         scope,
@@ -4425,13 +4471,61 @@ int manager_start_scope(
                                         more_properties,
                                         error,
                                         ret_job);
+                }
 
                 return sd_bus_error_move(error, &e);
         }
 
+        if (allow_pidfd && pidref->fd >= 0)
+                manager->scope_pidfd_supported = true;
+
         return strdup_job(reply, ret_job);
 }
 
+int manager_start_scope_async(
+                Manager *manager,
+                const char *scope,
+                const PidRef *pidref,
+                bool allow_pidfd,
+                const char *slice,
+                const char *description,
+                const char * const *requires,
+                const char * const *extra_after,
+                const char *requires_mounts_for,
+                sd_bus_message *more_properties,
+                sd_bus_slot **ret_slot,
+                sd_bus_message_handler_t callback,
+                void *userdata) {
+
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
+        int r;
+
+        assert(manager);
+        assert(ret_slot);
+        assert(callback);
+
+        /* Like manager_start_scope(), but doesn't wait for PID 1 to reply, so that we can process other
+         * requests in the meantime. Since we can't retry without PIDFDs here, this should only be used once
+         * we know whether PID 1 supports them, i.e. after manager_start_scope() succeeded once. */
+
+        r = manager_new_start_scope_message(
+                        manager,
+                        scope,
+                        pidref,
+                        allow_pidfd,
+                        slice,
+                        description,
+                        requires,
+                        extra_after,
+                        requires_mounts_for,
+                        more_properties,
+                        &m);
+        if (r < 0)
+                return r;
+
+        return sd_bus_call_async(manager->bus, ret_slot, m, callback, userdata, 0);
+}
+
 int manager_start_unit(Manager *manager, const char *unit, sd_bus_error *error, char **ret_job) {
         _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
         int r;
@@ -37,6 +37,20 @@ int manager_start_scope(
                 sd_bus_message *more_properties,
                 sd_bus_error *error,
                 char **ret_job);
+int manager_start_scope_async(
+                Manager *manager,
+                const char *scope,
+                const PidRef *pidref,
+                bool allow_pidfd,
+                const char *slice,
+                const char *description,
+                const char * const *requires,
+                const char * const *extra_after,
+                const char *requires_mounts_for,
+                sd_bus_message *more_properties,
+                sd_bus_slot **ret_slot,
+                sd_bus_message_handler_t callback,
+                void *userdata);
 int manager_start_unit(Manager *manager, const char *unit, sd_bus_error *error, char **ret_job);
 int manager_stop_unit(Manager *manager, const char *unit, const char *job_mode, sd_bus_error *error, char **ret_job);
 int manager_abandon_scope(Manager *manager, const char *scope, sd_bus_error *error);
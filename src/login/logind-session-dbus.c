@@ -798,6 +798,10 @@ int session_send_signal(Session *s, bool new_session) {
 
         assert(s);
 
+        /* Clients might look at the session via sd-login as soon as they hear about it */
+        if (new_session)
+                manager_flush_save_queue(s->manager);
+
         p = session_bus_path(s);
         if (!p)
                 return -ENOMEM;
@@ -877,6 +881,7 @@ static bool session_job_pending(Session *s) {
          * Note that we don't care about job result here. */
 
         return s->scope_job ||
+               s->scope_start_slot ||
                s->user->runtime_dir_job ||
                (SESSION_CLASS_WANTS_SERVICE_MANAGER(s->class) && s->user->service_manager_job);
 }
@@ -885,6 +890,7 @@ int session_send_create_reply(Session *s, sd_bus_error *error) {
         _cleanup_(sd_bus_message_unrefp) sd_bus_message *c = NULL;
         _cleanup_close_ int fifo_fd = -EBADF;
         _cleanup_free_ char *p = NULL;
+        usec_t setup_usec;
 
         assert(s);
 
@@ -909,21 +915,28 @@ int session_send_create_reply(Session *s, sd_bus_error *error) {
 
         /* Update the session state file before we notify the client about the result. */
         session_save(s);
+        manager_flush_save_queue(s->manager);
 
         p = session_bus_path(s);
         if (!p)
                 return -ENOMEM;
 
+        setup_usec = usec_sub_unsigned(now(CLOCK_MONOTONIC), s->create_usec);
+        s->manager->n_sessions_created++;
+        s->manager->session_setup_usec_total = usec_add(s->manager->session_setup_usec_total, setup_usec);
+        s->manager->session_setup_usec_max = MAX(s->manager->session_setup_usec_max, setup_usec);
+
         log_debug("Sending reply about created session: "
                   "id=%s object_path=%s uid=%u runtime_path=%s "
-                  "session_fd=%d seat=%s vtnr=%u",
+                  "session_fd=%d seat=%s vtnr=%u setup_time=%s",
                   s->id,
                   p,
                   (uint32_t) s->user->user_record->uid,
                   s->user->runtime_path,
                   fifo_fd,
                   s->seat ? s->seat->id : "",
-                  (uint32_t) s->vtnr);
+                  (uint32_t) s->vtnr,
+                  FORMAT_TIMESPAN(setup_usec, USEC_PER_MSEC));
 
         return sd_bus_reply_method_return(
                         c, "soshusub",
@@ -953,6 +966,7 @@ int session_send_upgrade_reply(Session *s, sd_bus_error *error) {
                 return sd_bus_reply_method_error(c, error);
 
         session_save(s);
+        manager_flush_save_queue(s->manager);
 
         return sd_bus_reply_method_return(c, NULL);
 }
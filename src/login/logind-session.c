@@ -152,6 +152,11 @@ Session* session_free(Session *s) {
                 LIST_REMOVE(gc_queue, s->manager->session_gc_queue, s);
         }
 
+        if (s->in_save_queue) {
+                assert(s->manager);
+                LIST_REMOVE(save_queue, s->manager->session_save_queue, s);
+        }
+
         sd_event_source_unref(s->timer_event_source);
 
         session_drop_controller(s);
@@ -186,6 +191,7 @@ Session* session_free(Session *s) {
         }
 
         free(s->scope_job);
+        sd_bus_slot_unref(s->scope_start_slot);
 
         session_reset_leader(s, /* keep_fdstore = */ true);
 
@@ -271,6 +277,27 @@ static void session_save_devices(Session *s, FILE *f) {
 }
 
 int session_save(Session *s) {
+        assert(s);
+
+        /* Queues writing out the state file, see manager_flush_save_queue() */
+
+        if (!s->user)
+                return -ESTALE;
+
+        if (!s->started)
+                return 0;
+
+        if (s->in_save_queue) {
+                s->manager->n_state_file_saves_coalesced++;
+                return 0;
+        }
+
+        LIST_PREPEND(save_queue, s->manager->session_save_queue, s);
+        s->in_save_queue = true;
+        return 0;
+}
+
+int session_save_now(Session *s) {
         _cleanup_(unlink_and_freep) char *temp_path = NULL;
         _cleanup_fclose_ FILE *f = NULL;
         int r;
@@ -421,6 +448,7 @@ int session_save(Session *s) {
         }
 
         temp_path = mfree(temp_path);
+        s->manager->n_state_files_written++;
         return 0;
 
 fail:
@@ -719,6 +747,62 @@ int session_activate(Session *s) {
         return 0;
 }
 
+static int session_start_scope_handler(sd_bus_message *reply, void *userdata, sd_bus_error *ret_error) {
+        _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
+        Session *s = ASSERT_PTR(userdata);
+        const sd_bus_error *e;
+        const char *job;
+        int r;
+
+        assert(reply);
+
+        s->scope_start_slot = sd_bus_slot_unref(s->scope_start_slot);
+
+        if (s->stopping) {
+                /* The session was stopped before PID 1 got around to creating the scope, which
+                 * session_stop_scope() took care of. Nothing left to do but to get rid of the session. */
+                session_add_to_gc_queue(s);
+                return 0;
+        }
+
+        e = sd_bus_message_get_error(reply);
+        if (e) {
+                r = sd_bus_error_get_errno(e);
+                log_error_errno(r, "Failed to start session scope %s: %s", s->scope, bus_error_message(e, r));
+                (void) sd_bus_error_copy(&error, e);
+                goto fail;
+        }
+
+        r = sd_bus_message_read(reply, "o", &job);
+        if (r < 0) {
+                bus_log_parse_error(r);
+                goto fail;
+        }
+
+        r = free_and_strdup_warn(&s->scope_job, job);
+        if (r < 0)
+                goto fail;
+
+        /* Now wait for the job to complete, see match_job_removed() */
+        (void) session_save(s);
+        return 0;
+
+fail:
+        if (!sd_bus_error_is_set(&error))
+                (void) sd_bus_error_set_errnof(&error, r, "Failed to start session scope %s: %m", s->scope);
+
+        (void) session_send_create_reply(s, &error);
+
+        /* Without a scope the session is useless, hence tear it down right-away, as if
+         * session_start() had failed in the first place */
+        hashmap_remove(s->manager->session_units, s->scope);
+        s->scope = mfree(s->scope);
+
+        (void) session_stop(s, /* force = */ true);
+        (void) session_finalize(s);
+        return 0;
+}
+
 static int session_start_scope(Session *s, sd_bus_message *properties, sd_bus_error *error) {
         _cleanup_free_ char *scope = NULL;
         const char *description;
@@ -741,30 +825,58 @@ static int session_start_scope(Session *s, sd_bus_message *properties, sd_bus_er
 
         description = strjoina("Session ", s->id, " of User ", s->user->user_record->user_name);
 
-        r = manager_start_scope(
-                        s->manager,
-                        scope,
-                        &s->leader,
-                        /* allow_pidfd = */ true,
-                        s->user->slice,
-                        description,
-                        /* These should have been pulled in explicitly in user_start(). Just to be sure. */
-                        STRV_MAKE_CONST(s->user->runtime_dir_unit,
-                                        SESSION_CLASS_WANTS_SERVICE_MANAGER(s->class) ? s->user->service_manager_unit : NULL),
-                        /* We usually want to order session scopes after systemd-user-sessions.service
-                         * since the unit is used as login session barrier for unprivileged users. However
-                         * the barrier doesn't apply for root as sysadmin should always be able to log in
-                         * (and without waiting for any timeout to expire) in case something goes wrong
-                         * during the boot process. */
-                        STRV_MAKE_CONST("systemd-logind.service",
-                                        SESSION_CLASS_IS_EARLY(s->class) ? NULL : "systemd-user-sessions.service"),
-                        user_record_home_directory(s->user->user_record),
-                        properties,
-                        error,
-                        &s->scope_job);
-        if (r < 0)
-                return log_error_errno(r, "Failed to start session scope %s: %s",
-                                       scope, bus_error_message(error, r));
+        /* These should have been pulled in explicitly in user_start(). Just to be sure. */
+        const char * const *requires = STRV_MAKE_CONST(
+                        s->user->runtime_dir_unit,
+                        SESSION_CLASS_WANTS_SERVICE_MANAGER(s->class) ? s->user->service_manager_unit : NULL);
+
+        /* We usually want to order session scopes after systemd-user-sessions.service since the unit is
+         * used as login session barrier for unprivileged users. However the barrier doesn't apply for root
+         * as sysadmin should always be able to log in (and without waiting for any timeout to expire) in
+         * case something goes wrong during the boot process. */
+        const char * const *extra_after = STRV_MAKE_CONST(
+                        "systemd-logind.service",
+                        SESSION_CLASS_IS_EARLY(s->class) ? NULL : "systemd-user-sessions.service");
+
+        if (s->manager->scope_pidfd_supported >= 0) {
+                /* Once we know what PID 1 supports, don't block on it: during login storms creating the
+                 * scope is the most expensive part of setting up a session, and we'd rather process the
+                 * next CreateSession() call in the meantime. The reply to the client is delayed until the
+                 * scope job is complete anyway. */
+                r = manager_start_scope_async(
+                                s->manager,
+                                scope,
+                                &s->leader,
+                                s->manager->scope_pidfd_supported,
+                                s->user->slice,
+                                description,
+                                requires,
+                                extra_after,
+                                user_record_home_directory(s->user->user_record),
+                                properties,
+                                &s->scope_start_slot,
+                                session_start_scope_handler,
+                                s);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to start session scope %s: %m", scope);
+        } else {
+                r = manager_start_scope(
+                                s->manager,
+                                scope,
+                                &s->leader,
+                                /* allow_pidfd = */ true,
+                                s->user->slice,
+                                description,
+                                requires,
+                                extra_after,
+                                user_record_home_directory(s->user->user_record),
+                                properties,
+                                error,
+                                &s->scope_job);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to start session scope %s: %s",
+                                               scope, bus_error_message(error, r));
+        }
 
         s->scope = TAKE_PTR(scope);
 
@@ -1335,6 +1447,9 @@ bool session_may_gc(Session *s, bool drop_not_started) {
         if (s->fifo_fd >= 0 && pipe_eof(s->fifo_fd) <= 0)
                 return false;
 
+        if (s->scope_start_slot)
+                return false;
+
         if (s->scope_job) {
                 _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
 
@@ -1375,7 +1490,7 @@ SessionState session_get_state(Session *s) {
         if (s->stopping || s->timer_event_source)
                 return SESSION_CLOSING;
 
-        if (s->scope_job || (!pidref_is_set(&s->leader) && s->fifo_fd < 0))
+        if (s->scope_job || s->scope_start_slot || (!pidref_is_set(&s->leader) && s->fifo_fd < 0))
                 return SESSION_OPENING;
 
         if (session_is_active(s))
@@ -120,6 +120,7 @@ struct Session {
 
         char *scope;
         char *scope_job;
+        sd_bus_slot *scope_start_slot; /* StartTransientUnit() call for the scope still in flight */
 
         Seat *seat;
         unsigned vtnr;
@@ -137,6 +138,7 @@ struct Session {
         sd_event_source *leader_pidfd_event_source;
 
         bool in_gc_queue;
+        bool in_save_queue;
         bool started;
         bool stopping;
 
@@ -148,6 +150,7 @@ struct Session {
         dual_timestamp idle_hint_timestamp;
 
         sd_bus_message *create_message;   /* The D-Bus message used to create the session, which we haven't responded to yet */
+        usec_t create_usec;               /* When create_message was received (CLOCK_MONOTONIC) */
         sd_bus_message *upgrade_message;  /* The D-Bus message used to upgrade the session class user-incomplete → user, which we haven't responded to yet */
 
         /* Set up when a client requested to release the session via the bus */
@@ -163,6 +166,7 @@ struct Session {
         LIST_FIELDS(Session, sessions_by_seat);
 
         LIST_FIELDS(Session, gc_queue);
+        LIST_FIELDS(Session, save_queue);
 };
 
 int session_new(Manager *m, const char *id, Session **ret);
@@ -190,6 +194,7 @@ int session_stop(Session *s, bool force);
 int session_finalize(Session *s);
 int session_release(Session *s);
 int session_save(Session *s);
+int session_save_now(Session *s);
 int session_load(Session *s);
 int session_kill(Session *s, KillWhom whom, int signo);
 
@@ -388,6 +388,9 @@ int user_send_signal(User *u, bool new_user) {
 
         assert(u);
 
+        if (new_user)
+                manager_flush_save_queue(u->manager);
+
         p = user_bus_path(u);
         if (!p)
                 return -ENOMEM;
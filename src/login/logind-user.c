@@ -109,6 +109,9 @@ User *user_free(User *u) {
         if (u->in_gc_queue)
                 LIST_REMOVE(gc_queue, u->manager->user_gc_queue, u);
 
+        if (u->in_save_queue)
+                LIST_REMOVE(save_queue, u->manager->user_save_queue, u);
+
         while (u->sessions)
                 session_free(u->sessions);
 
@@ -290,6 +293,7 @@ static int user_save_internal(User *u) {
         }
 
         temp_path = mfree(temp_path);
+        u->manager->n_state_files_written++;
         return 0;
 
 fail:
@@ -301,6 +305,24 @@ fail:
 int user_save(User *u) {
         assert(u);
 
+        /* Queues writing out the state file, see manager_flush_save_queue() */
+
+        if (!u->started)
+                return 0;
+
+        if (u->in_save_queue) {
+                u->manager->n_state_file_saves_coalesced++;
+                return 0;
+        }
+
+        LIST_PREPEND(save_queue, u->manager->user_save_queue, u);
+        u->in_save_queue = true;
+        return 0;
+}
+
+int user_save_now(User *u) {
+        assert(u);
+
         if (!u->started)
                 return 0;
 
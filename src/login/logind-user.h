@@ -56,6 +56,7 @@ struct User {
 
         UserGCMode gc_mode;
         bool in_gc_queue:1;
+        bool in_save_queue:1;
 
         bool started:1;       /* Whenever the user being started, has been started or is being stopped again
                                  (tracked through user-runtime-dir@.service) */
@@ -63,6 +64,7 @@ struct User {
 
         LIST_HEAD(Session, sessions);
         LIST_FIELDS(User, gc_queue);
+        LIST_FIELDS(User, save_queue);
 };
 
 int user_new(Manager *m, UserRecord *ur, User **ret);
@@ -80,6 +82,7 @@ int user_finalize(User *u);
 UserState user_get_state(User *u);
 int user_get_idle_hint(User *u, dual_timestamp *t);
 int user_save(User *u);
+int user_save_now(User *u);
 int user_load(User *u);
 int user_kill(User *u, int signo);
 int user_check_linger_file(const User *u);
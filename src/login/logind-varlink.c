@@ -0,0 +1,214 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include "json-util.h"
+#include "logind-seat.h"
+#include "logind-session.h"
+#include "logind-user.h"
+#include "logind-varlink.h"
+#include "logind.h"
+#include "strv.h"
+#include "user-record.h"
+#include "varlink-io.systemd.Login.h"
+
+static int session_build_json(Session *s, sd_json_variant **ret) {
+        assert(s);
+        assert(ret);
+
+        return sd_json_buildo(
+                        ret,
+                        SD_JSON_BUILD_PAIR_STRING("Id", s->id),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("UID", s->user->user_record->uid),
+                        SD_JSON_BUILD_PAIR_STRING("Name", s->user->user_record->user_name),
+                        JSON_BUILD_PAIR_UNSIGNED_NON_ZERO("Timestamp", s->timestamp.realtime),
+                        JSON_BUILD_PAIR_UNSIGNED_NON_ZERO("TimestampMonotonic", s->timestamp.monotonic),
+                        JSON_BUILD_PAIR_UNSIGNED_NON_ZERO("VTNr", s->vtnr),
+                        SD_JSON_BUILD_PAIR_CONDITION(!!s->seat, "Seat", SD_JSON_BUILD_STRING(s->seat ? s->seat->id : NULL)),
+                        JSON_BUILD_PAIR_STRING_NON_EMPTY("TTY", s->tty),
+                        JSON_BUILD_PAIR_STRING_NON_EMPTY("Display", s->display),
+                        SD_JSON_BUILD_PAIR_BOOLEAN("Remote", s->remote),
+                        JSON_BUILD_PAIR_STRING_NON_EMPTY("RemoteHost", s->remote_host),
+                        JSON_BUILD_PAIR_STRING_NON_EMPTY("RemoteUser", s->remote_user),
+                        JSON_BUILD_PAIR_STRING_NON_EMPTY("Service", s->service),
+                        JSON_BUILD_PAIR_STRING_NON_EMPTY("Desktop", s->desktop),
+                        JSON_BUILD_PAIR_STRING_NON_EMPTY("Scope", s->scope),
+                        SD_JSON_BUILD_PAIR_CONDITION(pidref_is_set(&s->leader), "Leader", SD_JSON_BUILD_UNSIGNED(s->leader.pid)),
+                        SD_JSON_BUILD_PAIR_STRING("Type", session_type_to_string(s->type)),
+                        SD_JSON_BUILD_PAIR_STRING("Class", session_class_to_string(s->class)),
+                        SD_JSON_BUILD_PAIR_BOOLEAN("Active", session_is_active(s)),
+                        SD_JSON_BUILD_PAIR_STRING("State", session_state_to_string(session_get_state(s))),
+                        SD_JSON_BUILD_PAIR_BOOLEAN("IdleHint", session_get_idle_hint(s, NULL) > 0),
+                        SD_JSON_BUILD_PAIR_BOOLEAN("LockedHint", session_get_locked_hint(s) > 0));
+}
+
+static int user_build_json(User *u, sd_json_variant **ret) {
+        _cleanup_strv_free_ char **sessions = NULL;
+        int r;
+
+        assert(u);
+        assert(ret);
+
+        LIST_FOREACH(sessions_by_user, s, u->sessions) {
+                r = strv_extend(&sessions, s->id);
+                if (r < 0)
+                        return r;
+        }
+
+        return sd_json_buildo(
+                        ret,
+                        SD_JSON_BUILD_PAIR_UNSIGNED("UID", u->user_record->uid),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("GID", user_record_gid(u->user_record)),
+                        SD_JSON_BUILD_PAIR_STRING("Name", u->user_record->user_name),
+                        JSON_BUILD_PAIR_UNSIGNED_NON_ZERO("Timestamp", u->timestamp.realtime),
+                        JSON_BUILD_PAIR_UNSIGNED_NON_ZERO("TimestampMonotonic", u->timestamp.monotonic),
+                        SD_JSON_BUILD_PAIR_STRING("State", user_state_to_string(user_get_state(u))),
+                        SD_JSON_BUILD_PAIR_CONDITION(!!u->display, "Display", SD_JSON_BUILD_STRING(u->display ? u->display->id : NULL)),
+                        SD_JSON_BUILD_PAIR_STRV("Sessions", sessions));
+}
+
+static int seat_build_json(Seat *s, sd_json_variant **ret) {
+        _cleanup_strv_free_ char **sessions = NULL;
+        int r;
+
+        assert(s);
+        assert(ret);
+
+        LIST_FOREACH(sessions_by_seat, i, s->sessions) {
+                r = strv_extend(&sessions, i->id);
+                if (r < 0)
+                        return r;
+        }
+
+        return sd_json_buildo(
+                        ret,
+                        SD_JSON_BUILD_PAIR_STRING("Id", s->id),
+                        SD_JSON_BUILD_PAIR_CONDITION(!!s->active, "ActiveSession", SD_JSON_BUILD_STRING(s->active ? s->active->id : NULL)),
+                        SD_JSON_BUILD_PAIR_BOOLEAN("CanTTY", seat_can_tty(s)),
+                        SD_JSON_BUILD_PAIR_BOOLEAN("CanGraphical", seat_can_graphical(s)),
+                        SD_JSON_BUILD_PAIR_STRV("Sessions", sessions));
+}
+
+typedef int (*build_json_t)(void *object, sd_json_variant **ret);
+
+static int build_json_array(Hashmap *h, build_json_t build, sd_json_variant **ret) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *array = NULL;
+        void *object;
+        int r;
+
+        assert(build);
+        assert(ret);
+
+        /* Start out with an empty array, so that we never return null */
+        r = sd_json_variant_new_array(&array, NULL, 0);
+        if (r < 0)
+                return r;
+
+        HASHMAP_FOREACH(object, h) {
+                _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+
+                r = build(object, &v);
+                if (r < 0)
+                        return r;
+
+                r = sd_json_variant_append_array(&array, v);
+                if (r < 0)
+                        return r;
+        }
+
+        *ret = TAKE_PTR(array);
+        return 0;
+}
+
+static int vl_method_describe(Varlink *link, sd_json_variant *parameters, VarlinkMethodFlags flags, void *userdata) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *sessions = NULL, *users = NULL, *seats = NULL;
+        Manager *m = ASSERT_PTR(userdata);
+        int r;
+
+        assert(link);
+
+        /* Returns everything loginctl list-sessions, list-users and list-seats would show, and then some, in
+         * one go, for clients that would otherwise have to do many calls (or read many state files) to get
+         * the same. Only covers what is world-readable in /run/systemd/ anyway, hence needs no privileges. */
+
+        if (sd_json_variant_elements(parameters) > 0)
+                return varlink_error_invalid_parameter(link, parameters);
+
+        r = build_json_array(m->sessions, (build_json_t) session_build_json, &sessions);
+        if (r < 0)
+                return r;
+
+        r = build_json_array(m->users, (build_json_t) user_build_json, &users);
+        if (r < 0)
+                return r;
+
+        r = build_json_array(m->seats, (build_json_t) seat_build_json, &seats);
+        if (r < 0)
+                return r;
+
+        return varlink_replybo(
+                        link,
+                        SD_JSON_BUILD_PAIR_VARIANT("Sessions", sessions),
+                        SD_JSON_BUILD_PAIR_VARIANT("Users", users),
+                        SD_JSON_BUILD_PAIR_VARIANT("Seats", seats));
+}
+
+static int vl_method_get_statistics(Varlink *link, sd_json_variant *parameters, VarlinkMethodFlags flags, void *userdata) {
+        Manager *m = ASSERT_PTR(userdata);
+
+        assert(link);
+
+        if (sd_json_variant_elements(parameters) > 0)
+                return varlink_error_invalid_parameter(link, parameters);
+
+        return varlink_replybo(
+                        link,
+                        SD_JSON_BUILD_PAIR_UNSIGNED("SessionsCreated", m->n_sessions_created),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("SessionSetupAverageUSec",
+                                                    m->n_sessions_created > 0 ? m->session_setup_usec_total / m->n_sessions_created : 0),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("SessionSetupMaxUSec", m->session_setup_usec_max),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("StateFilesWritten", m->n_state_files_written),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("StateFileSavesCoalesced", m->n_state_file_saves_coalesced));
+}
+
+int manager_varlink_init(Manager *m) {
+        _cleanup_(varlink_server_unrefp) VarlinkServer *s = NULL;
+        int r;
+
+        assert(m);
+
+        if (m->varlink_server)
+                return 0;
+
+        r = varlink_server_new(&s, VARLINK_SERVER_ACCOUNT_UID|VARLINK_SERVER_INHERIT_USERDATA);
+        if (r < 0)
+                return log_error_errno(r, "Failed to allocate varlink server object: %m");
+
+        varlink_server_set_userdata(s, m);
+
+        r = varlink_server_add_interface(s, &vl_interface_io_systemd_Login);
+        if (r < 0)
+                return log_error_errno(r, "Failed to add Login interface to varlink server: %m");
+
+        r = varlink_server_bind_method_many(
+                        s,
+                        "io.systemd.Login.Describe",      vl_method_describe,
+                        "io.systemd.Login.GetStatistics", vl_method_get_statistics);
+        if (r < 0)
+                return log_error_errno(r, "Failed to register varlink methods: %m");
+
+        r = varlink_server_listen_address(s, "/run/systemd/io.systemd.Login", 0666);
+        if (r < 0)
+                return log_error_errno(r, "Failed to bind to varlink socket: %m");
+
+        r = varlink_server_attach_event(s, m->event, SD_EVENT_PRIORITY_NORMAL);
+        if (r < 0)
+                return log_error_errno(r, "Failed to attach varlink connection to event loop: %m");
+
+        m->varlink_server = TAKE_PTR(s);
+        return 0;
+}
+
+void manager_varlink_done(Manager *m) {
+        assert(m);
+
+        m->varlink_server = varlink_server_unref(m->varlink_server);
+}
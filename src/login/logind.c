@@ -28,6 +28,7 @@
 #include "logind-seat-dbus.h"
 #include "logind-session-dbus.h"
 #include "logind-user-dbus.h"
+#include "logind-varlink.h"
 #include "logind.h"
 #include "main-func.h"
 #include "mkdir-label.h"
@@ -67,6 +68,7 @@ static int manager_new(Manager **ret) {
                 .enable_wall_messages = true,
                 .idle_action_not_before_usec = now(CLOCK_MONOTONIC),
                 .scheduled_shutdown_action = _HANDLE_ACTION_INVALID,
+                .scope_pidfd_supported = -1,
 
                 .devices = hashmap_new(&device_hash_ops),
                 .seats = hashmap_new(&seat_hash_ops),
@@ -114,6 +116,9 @@ static Manager* manager_free(Manager *m) {
         if (!m)
                 return NULL;
 
+        /* Sessions and users survive us, make sure their state files are current */
+        manager_flush_save_queue(m);
+
         hashmap_free(m->devices);
         hashmap_free(m->seats);
         hashmap_free(m->sessions);
@@ -157,6 +162,8 @@ static Manager* manager_free(Manager *m) {
 
         hashmap_free(m->polkit_registry);
 
+        manager_varlink_done(m);
+
         sd_bus_flush_close_unref(m->bus);
         sd_event_unref(m->event);
 
@@ -689,6 +696,10 @@ static int manager_connect_bus(Manager *m) {
         if (r < 0)
                 return log_error_errno(r, "Failed to connect to system bus: %m");
 
+        r = sd_bus_set_creds_cache(m->bus, true);
+        if (r < 0)
+                log_warning_errno(r, "Failed to enable sender credentials cache, ignoring: %m");
+
         r = bus_add_implementation(m->bus, &manager_object, m);
         if (r < 0)
                 return r;
@@ -1119,6 +1130,11 @@ static int manager_startup(Manager *m) {
         if (r < 0)
                 return r;
 
+        /* Start the varlink server */
+        r = manager_varlink_init(m);
+        if (r < 0)
+                return r;
+
         /* Instantiate magic seat 0 */
         r = manager_add_seat(m, "seat0", &m->seat0);
         if (r < 0)
@@ -1212,6 +1228,8 @@ static int manager_run(Manager *m) {
                 if (r > 0)
                         continue;
 
+                manager_flush_save_queue(m);
+
                 r = sd_event_run(m->event, UINT64_MAX);
                 if (r < 0)
                         return r;
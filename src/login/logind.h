@@ -15,6 +15,7 @@
 #include "set.h"
 #include "time-util.h"
 #include "user-record.h"
+#include "varlink.h"
 
 typedef struct Manager Manager;
 
@@ -26,6 +27,7 @@ typedef struct Manager Manager;
 struct Manager {
         sd_event *event;
         sd_bus *bus;
+        VarlinkServer *varlink_server;
 
         Hashmap *devices;
         Hashmap *seats;
@@ -40,6 +42,10 @@ struct Manager {
         LIST_HEAD(Session, session_gc_queue);
         LIST_HEAD(User, user_gc_queue);
 
+        /* Sessions and users whose state files need to be written out, see manager_flush_save_queue() */
+        LIST_HEAD(Session, session_save_queue);
+        LIST_HEAD(User, user_save_queue);
+
         sd_device_monitor *device_seat_monitor, *device_monitor, *device_vcsa_monitor, *device_button_monitor;
 
         sd_event_source *console_active_event_source;
@@ -63,6 +69,16 @@ struct Manager {
         uint64_t session_counter;
         uint64_t inhibit_counter;
 
+        /* Statistics, as exposed via io.systemd.Login.GetStatistics() */
+        uint64_t n_sessions_created;
+        usec_t session_setup_usec_total;
+        usec_t session_setup_usec_max;
+        uint64_t n_state_files_written;
+        uint64_t n_state_file_saves_coalesced;
+
+        /* Whether PID 1 accepts PIDFDs when creating scopes, or negative if we don't know yet */
+        int scope_pidfd_supported;
+
         Hashmap *session_units;
         Hashmap *user_units;
 
@@ -159,6 +175,8 @@ int manager_add_user_by_name(Manager *m, const char *name, User **ret_user);
 int manager_add_user_by_uid(Manager *m, uid_t uid, User **ret_user);
 int manager_add_inhibitor(Manager *m, const char* id, Inhibitor **ret_inhibitor);
 
+void manager_flush_save_queue(Manager *m);
+
 int manager_process_seat_device(Manager *m, sd_device *d);
 int manager_process_button_device(Manager *m, sd_device *d);
 
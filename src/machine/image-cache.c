@@ -0,0 +1,222 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "hashmap.h"
+#include "image-cache.h"
+#include "log.h"
+#include "machined.h"
+#include "nulstr-util.h"
+#include "path-util.h"
+#include "set.h"
+#include "string-util.h"
+#include "strv.h"
+
+/* machined keeps the images it found around, so that listing them or looking at their properties doesn't
+ * require stat()ing, opening and possibly dissecting every single image again. The cache is invalidated
+ * whenever something changes in one of the directories images are discovered in, as reported by inotify. */
+
+#define IMAGE_DIRECTORY_INOTIFY_MASK \
+        (IN_CREATE|IN_DELETE|IN_MOVED_FROM|IN_MOVED_TO|IN_CLOSE_WRITE|IN_ATTRIB|IN_DELETE_SELF|IN_MOVE_SELF|IN_ONLYDIR)
+
+DEFINE_PRIVATE_HASH_OPS_WITH_KEY_DESTRUCTOR(
+                event_source_hash_ops,
+                sd_event_source,
+                (void (*)(const sd_event_source*, struct siphash*)) trivial_hash_func,
+                (int (*)(const sd_event_source*, const sd_event_source*)) trivial_compare_func,
+                sd_event_source_disable_unref);
+
+static int on_image_directory_inotify(sd_event_source *s, const struct inotify_event *event, void *userdata) {
+        Manager *m = ASSERT_PTR(userdata);
+
+        assert(event);
+
+        /* Don't rediscover right away, more changes are likely to follow (e.g. while an image is being
+         * downloaded), just make sure the next lookup does. */
+        if (m->image_cache_complete)
+                log_debug("Image directory changed, invalidating image cache.");
+
+        m->image_cache_complete = false;
+        return 0;
+}
+
+static int image_directory_watch(Manager *m, Set **watches, const char *path) {
+        _cleanup_(sd_event_source_unrefp) sd_event_source *s = NULL;
+        int r;
+
+        assert(m);
+        assert(watches);
+        assert(path);
+
+        r = sd_event_add_inotify(m->event, &s, path, IMAGE_DIRECTORY_INOTIFY_MASK, on_image_directory_inotify, m);
+        if (r < 0)
+                return r;
+
+        /* Make sure we learn about changes before processing any requests that might have been queued
+         * at the same time */
+        r = sd_event_source_set_priority(s, SD_EVENT_PRIORITY_IMPORTANT);
+        if (r < 0)
+                return r;
+
+        (void) sd_event_source_set_description(s, "image-directory-inotify");
+
+        r = set_ensure_consume(watches, &event_source_hash_ops, TAKE_PTR(s));
+        if (r < 0)
+                return r;
+
+        return 0;
+}
+
+static bool image_cache_entry_is_current(const Image *cached, const Image *found) {
+        assert(found);
+
+        if (!cached)
+                return false;
+
+        if (cached->type != found->type || !path_equal(cached->path, found->path))
+                return false;
+
+        /* The stamp of what we read the metadata from. We cannot cheaply tell whether anything changed
+         * inside of directory trees, hence only keep what we know about disk images. */
+        if (!IN_SET(found->type, IMAGE_RAW, IMAGE_BLOCK))
+                return false;
+
+        return cached->mtime == found->mtime && cached->crtime == found->crtime;
+}
+
+static bool image_cache_is_current(Manager *m) {
+        assert(m);
+
+        if (!m->image_cache_complete)
+                return false;
+
+        /* We cannot watch directories that don't exist, hence check whether any of them appeared */
+        STRV_FOREACH(d, m->image_cache_missing_directories)
+                if (access(*d, F_OK) >= 0) {
+                        log_debug("Image directory %s appeared, invalidating image cache.", *d);
+                        return false;
+                }
+
+        return true;
+}
+
+int manager_discover_images(Manager *m) {
+        _cleanup_hashmap_free_ Hashmap *images = NULL, *cache = NULL;
+        _cleanup_strv_free_ char **missing = NULL;
+        _cleanup_set_free_ Set *watches = NULL;
+        bool watched = true;
+        Image *image;
+        int r;
+
+        assert(m);
+
+        if (image_cache_is_current(m))
+                return 0;
+
+        /* Set up the watches first, so that we don't miss any changes while enumerating */
+        NULSTR_FOREACH(path, image_search_path[IMAGE_MACHINE]) {
+                r = image_directory_watch(m, &watches, path);
+                if (r == -ENOENT) {
+                        if (strv_extend(&missing, path) < 0)
+                                return -ENOMEM;
+                        continue;
+                }
+                if (r < 0) {
+                        log_debug_errno(r, "Failed to watch image directory %s, not caching images: %m", path);
+                        watched = false;
+                }
+        }
+
+        images = hashmap_new(&image_hash_ops);
+        if (!images)
+                return -ENOMEM;
+
+        r = image_discover(IMAGE_MACHINE, NULL, images);
+        if (r < 0)
+                return r;
+
+        HASHMAP_FOREACH(image, images) {
+                Image *cached, *keep;
+
+                /* Versioned images are picked from the contents of the "….v/" directory, watch that too */
+                if (image->path) {
+                        _cleanup_free_ char *parent = NULL;
+
+                        r = path_extract_directory(image->path, &parent);
+                        if (r >= 0 && endswith(parent, ".v")) {
+                                r = image_directory_watch(m, &watches, parent);
+                                if (r < 0) {
+                                        log_debug_errno(r, "Failed to watch image directory %s, not caching images: %m", parent);
+                                        watched = false;
+                                }
+                        }
+                }
+
+                cached = hashmap_get(m->image_cache, image->name);
+                if (image_cache_entry_is_current(cached, image)) {
+                        /* Keep the metadata we already read, but take the freshly acquired stat data */
+                        cached->read_only = image->read_only;
+                        cached->usage = image->usage;
+                        cached->usage_exclusive = image->usage_exclusive;
+                        cached->limit = image->limit;
+                        cached->limit_exclusive = image->limit_exclusive;
+                        cached->discoverable = image->discoverable;
+                        keep = cached;
+                } else
+                        keep = image;
+
+                keep->userdata = m;
+
+                r = hashmap_ensure_put(&cache, &image_hash_ops, keep->name, keep);
+                if (r < 0)
+                        return r;
+
+                image_ref(keep);
+        }
+
+        log_debug("Discovered %u images, %u directories watched.", hashmap_size(cache), set_size(watches));
+
+        hashmap_free_and_replace(m->image_cache, cache);
+        set_free_and_replace(m->image_cache_watches, watches);
+        strv_free_and_replace(m->image_cache_missing_directories, missing);
+        m->image_cache_complete = watched;
+
+        return 0;
+}
+
+int manager_acquire_image(Manager *m, const char *name, Image **ret) {
+        _cleanup_(image_unrefp) Image *image = NULL;
+        Image *existing;
+        int r;
+
+        assert(m);
+        assert(name);
+
+        r = manager_discover_images(m);
+        if (r < 0)
+                log_debug_errno(r, "Failed to discover images, ignoring: %m");
+
+        existing = hashmap_get(m->image_cache, name);
+        if (existing) {
+                if (ret)
+                        *ret = existing;
+                return 0;
+        }
+
+        r = image_find(IMAGE_MACHINE, name, NULL, &image);
+        if (r < 0)
+                return r;
+
+        image->userdata = m;
+
+        r = hashmap_ensure_put(&m->image_cache, &image_hash_ops, image->name, image);
+        if (r < 0)
+                return r;
+
+        if (ret)
+                *ret = image;
+
+        TAKE_PTR(image);
+        return 0;
+}
@@ -0,0 +1,9 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+#pragma once
+
+#include "discover-image.h"
+
+typedef struct Manager Manager;
+
+int manager_acquire_image(Manager *m, const char *name, Image **ret);
+int manager_discover_images(Manager *m);
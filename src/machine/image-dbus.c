@@ -377,60 +377,6 @@ int bus_image_method_get_os_release(
         return bus_reply_pair_array(message, image->os_release);
 }
 
-static int image_flush_cache(sd_event_source *s, void *userdata) {
-        Manager *m = ASSERT_PTR(userdata);
-
-        assert(s);
-
-        hashmap_clear(m->image_cache);
-        return 0;
-}
-
-int manager_acquire_image(Manager *m, const char *name, Image **ret) {
-        int r;
-
-        assert(m);
-        assert(name);
-
-        Image *existing = hashmap_get(m->image_cache, name);
-        if (existing) {
-                if (ret)
-                        *ret = existing;
-                return 0;
-        }
-
-        if (!m->image_cache_defer_event) {
-                r = sd_event_add_defer(m->event, &m->image_cache_defer_event, image_flush_cache, m);
-                if (r < 0)
-                        return r;
-
-                r = sd_event_source_set_priority(m->image_cache_defer_event, SD_EVENT_PRIORITY_IDLE);
-                if (r < 0)
-                        return r;
-        }
-
-        r = sd_event_source_set_enabled(m->image_cache_defer_event, SD_EVENT_ONESHOT);
-        if (r < 0)
-                return r;
-
-        _cleanup_(image_unrefp) Image *image = NULL;
-        r = image_find(IMAGE_MACHINE, name, NULL, &image);
-        if (r < 0)
-                return r;
-
-        image->userdata = m;
-
-        r = hashmap_ensure_put(&m->image_cache, &image_hash_ops, image->name, image);
-        if (r < 0)
-                return r;
-
-        if (ret)
-                *ret = image;
-
-        TAKE_PTR(image);
-        return 0;
-}
-
 static int image_object_find(sd_bus *bus, const char *path, const char *interface, void *userdata, void **found, sd_bus_error *error) {
         _cleanup_free_ char *e = NULL;
         Manager *m = userdata;
@@ -457,6 +403,9 @@ static int image_object_find(sd_bus *bus, const char *path, const char *interfac
         if (r < 0)
                 return r;
 
+        /* The image object might have been cached for a while, make sure the usage we report is current */
+        (void) image_update_usage(image);
+
         *found = image;
         return 1;
 }
@@ -474,8 +423,8 @@ char* image_bus_path(const char *name) {
 }
 
 static int image_node_enumerator(sd_bus *bus, const char *path, void *userdata, char ***nodes, sd_bus_error *error) {
-        _cleanup_hashmap_free_ Hashmap *images = NULL;
         _cleanup_strv_free_ char **l = NULL;
+        Manager *m = ASSERT_PTR(userdata);
         Image *image;
         int r;
 
@@ -483,15 +432,11 @@ static int image_node_enumerator(sd_bus *bus, const char *path, void *userdata,
         assert(path);
         assert(nodes);
 
-        images = hashmap_new(&image_hash_ops);
-        if (!images)
-                return -ENOMEM;
-
-        r = image_discover(IMAGE_MACHINE, NULL, images);
+        r = manager_discover_images(m);
         if (r < 0)
                 return r;
 
-        HASHMAP_FOREACH(image, images) {
+        HASHMAP_FOREACH(image, m->image_cache) {
                 char *p;
 
                 p = image_bus_path(image->name);
@@ -113,7 +113,7 @@ static int method_get_machine(sd_bus_message *message, void *userdata, sd_bus_er
 
 static int method_get_image(sd_bus_message *message, void *userdata, sd_bus_error *error) {
         _cleanup_free_ char *p = NULL;
-        _unused_ Manager *m = ASSERT_PTR(userdata);
+        Manager *m = ASSERT_PTR(userdata);
         const char *name;
         int r;
 
@@ -123,7 +123,7 @@ static int method_get_image(sd_bus_message *message, void *userdata, sd_bus_erro
         if (r < 0)
                 return r;
 
-        r = image_find(IMAGE_MACHINE, name, NULL, NULL);
+        r = manager_acquire_image(m, name, NULL);
         if (r == -ENOENT)
                 return sd_bus_error_setf(error, BUS_ERROR_NO_SUCH_IMAGE, "No image '%s' known", name);
         if (r < 0)
@@ -462,18 +462,13 @@ static int method_get_machine_os_release(sd_bus_message *message, void *userdata
 
 static int method_list_images(sd_bus_message *message, void *userdata, sd_bus_error *error) {
         _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
-        _cleanup_hashmap_free_ Hashmap *images = NULL;
-        _unused_ Manager *m = ASSERT_PTR(userdata);
+        Manager *m = ASSERT_PTR(userdata);
         Image *image;
         int r;
 
         assert(message);
 
-        images = hashmap_new(&image_hash_ops);
-        if (!images)
-                return -ENOMEM;
-
-        r = image_discover(IMAGE_MACHINE, NULL, images);
+        r = manager_discover_images(m);
         if (r < 0)
                 return r;
 
@@ -485,9 +480,12 @@ static int method_list_images(sd_bus_message *message, void *userdata, sd_bus_er
         if (r < 0)
                 return r;
 
-        HASHMAP_FOREACH(image, images) {
+        HASHMAP_FOREACH(image, m->image_cache) {
                 _cleanup_free_ char *p = NULL;
 
+                /* The usage is part of the reply, hence refresh it, the rest is kept current via inotify */
+                (void) image_update_usage(image);
+
                 p = image_bus_path(image->name);
                 if (!p)
                         return -ENOMEM;
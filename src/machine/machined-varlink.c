@@ -1,7 +1,9 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
+#include "discover-image.h"
 #include "format-util.h"
 #include "hostname-util.h"
+#include "image-policy.h"
 #include "json-util.h"
 #include "machine-varlink.h"
 #include "machined-varlink.h"
@@ -10,6 +12,7 @@
 #include "user-util.h"
 #include "varlink.h"
 #include "varlink-io.systemd.Machine.h"
+#include "varlink-io.systemd.MachineImage.h"
 #include "varlink-io.systemd.UserDatabase.h"
 
 typedef struct LookupParameters {
@@ -462,6 +465,128 @@ static int vl_method_list(Varlink *link, sd_json_variant *parameters, VarlinkMet
         return varlink_error(link, "io.systemd.Machine.NoSuchMachine", NULL);
 }
 
+typedef struct ImageListParameters {
+        const char *name;
+        bool acquire_usage;
+        bool acquire_metadata;
+} ImageListParameters;
+
+static int list_image_one(Varlink *link, Image *image, const ImageListParameters *p, bool more) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        bool usage = false, metadata = false;
+        int r;
+
+        assert(link);
+        assert(image);
+        assert(p);
+
+        /* The cached usage might be out of date, hence only report it if explicitly asked for, after
+         * refreshing it */
+        if (p->acquire_usage) {
+                (void) image_update_usage(image);
+                usage = true;
+        }
+
+        if (p->acquire_metadata) {
+                if (!image->metadata_valid) {
+                        r = image_read_metadata(image, &image_policy_container);
+                        if (r < 0)
+                                log_debug_errno(r, "Failed to read metadata of image '%s', ignoring: %m", image->name);
+                }
+
+                metadata = image->metadata_valid;
+        }
+
+        r = sd_json_buildo(
+                        &v,
+                        SD_JSON_BUILD_PAIR_STRING("name", image->name),
+                        SD_JSON_BUILD_PAIR_CONDITION(!!image->path, "path", SD_JSON_BUILD_STRING(image->path)),
+                        SD_JSON_BUILD_PAIR_STRING("type", image_type_to_string(image->type)),
+                        SD_JSON_BUILD_PAIR_BOOLEAN("readOnly", image->read_only),
+                        SD_JSON_BUILD_PAIR_CONDITION(image->crtime != 0, "creationTimestamp", SD_JSON_BUILD_UNSIGNED(image->crtime)),
+                        SD_JSON_BUILD_PAIR_CONDITION(image->mtime != 0, "modificationTimestamp", SD_JSON_BUILD_UNSIGNED(image->mtime)),
+                        SD_JSON_BUILD_PAIR_CONDITION(usage && image->usage != UINT64_MAX, "usage", SD_JSON_BUILD_UNSIGNED(image->usage)),
+                        SD_JSON_BUILD_PAIR_CONDITION(usage && image->usage_exclusive != UINT64_MAX, "usageExclusive", SD_JSON_BUILD_UNSIGNED(image->usage_exclusive)),
+                        SD_JSON_BUILD_PAIR_CONDITION(usage && image->limit != UINT64_MAX, "limit", SD_JSON_BUILD_UNSIGNED(image->limit)),
+                        SD_JSON_BUILD_PAIR_CONDITION(usage && image->limit_exclusive != UINT64_MAX, "limitExclusive", SD_JSON_BUILD_UNSIGNED(image->limit_exclusive)),
+                        SD_JSON_BUILD_PAIR_CONDITION(metadata && !!image->hostname, "hostname", SD_JSON_BUILD_STRING(image->hostname)),
+                        SD_JSON_BUILD_PAIR_CONDITION(metadata && !sd_id128_is_null(image->machine_id), "machineId", SD_JSON_BUILD_ID128(image->machine_id)),
+                        SD_JSON_BUILD_PAIR_CONDITION(metadata && !strv_isempty(image->machine_info), "machineInfo", JSON_BUILD_STRV_ENV_PAIR(image->machine_info)),
+                        SD_JSON_BUILD_PAIR_CONDITION(metadata && !strv_isempty(image->os_release), "OSRelease", JSON_BUILD_STRV_ENV_PAIR(image->os_release)));
+        if (r < 0)
+                return r;
+
+        if (more)
+                return varlink_notify(link, v);
+
+        return varlink_reply(link, v);
+}
+
+static int vl_method_list_images(Varlink *link, sd_json_variant *parameters, VarlinkMethodFlags flags, void *userdata) {
+
+        static const sd_json_dispatch_field dispatch_table[] = {
+                { "name",            SD_JSON_VARIANT_STRING,  sd_json_dispatch_const_string, offsetof(ImageListParameters, name),             0 },
+                { "acquireUsage",    SD_JSON_VARIANT_BOOLEAN, sd_json_dispatch_stdbool,      offsetof(ImageListParameters, acquire_usage),    0 },
+                { "acquireMetadata", SD_JSON_VARIANT_BOOLEAN, sd_json_dispatch_stdbool,      offsetof(ImageListParameters, acquire_metadata), 0 },
+                {}
+        };
+
+        Manager *m = ASSERT_PTR(userdata);
+        ImageListParameters p = {};
+        Image *image;
+        int r;
+
+        assert(parameters);
+
+        r = varlink_dispatch(link, parameters, dispatch_table, &p);
+        if (r != 0)
+                return r;
+
+        if (p.name) {
+                if (!image_name_is_valid(p.name))
+                        return varlink_error_invalid_parameter_name(link, "name");
+
+                r = manager_acquire_image(m, p.name, &image);
+                if (r == -ENOENT)
+                        return varlink_error(link, "io.systemd.MachineImage.NoSuchImage", NULL);
+                if (r < 0)
+                        return r;
+
+                return list_image_one(link, image, &p, /* more= */ false);
+        }
+
+        if (!FLAGS_SET(flags, VARLINK_METHOD_MORE))
+                return varlink_error(link, VARLINK_ERROR_EXPECTED_MORE, NULL);
+
+        r = manager_discover_images(m);
+        if (r < 0)
+                return r;
+
+        /* Dissecting disk images is slow, hence do all that are not cached yet in parallel */
+        if (p.acquire_metadata) {
+                r = image_read_metadata_parallel(m->image_cache, &image_policy_container);
+                if (r < 0)
+                        log_debug_errno(r, "Failed to read image metadata in parallel, ignoring: %m");
+        }
+
+        /* Send each image as soon as we have it, rather than collecting everything into one reply */
+        Image *previous = NULL;
+        HASHMAP_FOREACH(image, m->image_cache) {
+                if (previous) {
+                        r = list_image_one(link, previous, &p, /* more= */ true);
+                        if (r < 0)
+                                return r;
+                }
+
+                previous = image;
+        }
+
+        if (previous)
+                return list_image_one(link, previous, &p, /* more= */ false);
+
+        return varlink_error(link, "io.systemd.MachineImage.NoSuchImage", NULL);
+}
+
 static int manager_varlink_init_userdb(Manager *m) {
         _cleanup_(varlink_server_unrefp) VarlinkServer *s = NULL;
         int r;
@@ -518,14 +643,18 @@ static int manager_varlink_init_machine(Manager *m) {
 
         varlink_server_set_userdata(s, m);
 
-        r = varlink_server_add_interface(s, &vl_interface_io_systemd_Machine);
+        r = varlink_server_add_interface_many(
+                        s,
+                        &vl_interface_io_systemd_Machine,
+                        &vl_interface_io_systemd_MachineImage);
         if (r < 0)
-                return log_error_errno(r, "Failed to add UserDatabase interface to varlink server: %m");
+                return log_error_errno(r, "Failed to add Machine interfaces to varlink server: %m");
 
         r = varlink_server_bind_method_many(
                         s,
                         "io.systemd.Machine.Register", vl_method_register,
-                        "io.systemd.Machine.List",     vl_method_list);
+                        "io.systemd.Machine.List",     vl_method_list,
+                        "io.systemd.MachineImage.List", vl_method_list_images);
         if (r < 0)
                 return log_error_errno(r, "Failed to register varlink methods: %m");
 
@@ -535,6 +664,10 @@ static int manager_varlink_init_machine(Manager *m) {
         if (r < 0)
                 return log_error_errno(r, "Failed to bind to varlink socket: %m");
 
+        r = varlink_server_listen_address(s, "/run/systemd/machine/io.systemd.MachineImage", 0666);
+        if (r < 0)
+                return log_error_errno(r, "Failed to bind to varlink socket: %m");
+
         r = varlink_server_attach_event(s, m->event, SD_EVENT_PRIORITY_NORMAL);
         if (r < 0)
                 return log_error_errno(r, "Failed to attach varlink connection to event loop: %m");
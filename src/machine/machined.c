@@ -91,8 +91,9 @@ static Manager* manager_unref(Manager *m) {
         hashmap_free(m->machine_units);
         hashmap_free(m->machine_leaders);
         hashmap_free(m->image_cache);
+        set_free(m->image_cache_watches);
+        strv_free(m->image_cache_missing_directories);
 
-        sd_event_source_unref(m->image_cache_defer_event);
 #if ENABLE_NSCD
         sd_event_source_unref(m->nscd_cache_flush_event);
 #endif
@@ -220,6 +221,10 @@ static int manager_connect_bus(Manager *m) {
         if (r < 0)
                 return log_error_errno(r, "Failed to connect to system bus: %m");
 
+        r = sd_bus_set_creds_cache(m->bus, true);
+        if (r < 0)
+                log_warning_errno(r, "Failed to enable sender credentials cache, ignoring: %m");
+
         r = bus_add_implementation(m->bus, &manager_object, m);
         if (r < 0)
                 return r;
@@ -9,6 +9,7 @@
 typedef struct Manager Manager;
 
 #include "hashmap.h"
+#include "image-cache.h"
 #include "image-dbus.h"
 #include "list.h"
 #include "machine-dbus.h"
@@ -29,7 +30,9 @@ struct Manager {
         Hashmap *polkit_registry;
 
         Hashmap *image_cache;
-        sd_event_source *image_cache_defer_event;
+        Set *image_cache_watches;
+        char **image_cache_missing_directories;
+        bool image_cache_complete;
 
         LIST_HEAD(Machine, machine_gc_queue);
 
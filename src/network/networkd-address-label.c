@@ -132,8 +132,10 @@ static int address_label_process_request(Request *req, Link *link, void *userdat
         assert(req);
         assert(link);
 
-        if (!link_is_ready_to_configure(link, false))
+        if (!link_is_ready_to_configure(link, false)) {
+                request_wait(req, /* any_link = */ false);
                 return 0;
+        }
 
         r = address_label_configure(label, link, req);
         if (r < 0)
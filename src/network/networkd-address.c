@@ -13,6 +13,7 @@
 #include "networkd-dhcp-prefix-delegation.h"
 #include "networkd-dhcp-server.h"
 #include "networkd-ipv4acd.h"
+#include "networkd-json.h"
 #include "networkd-manager.h"
 #include "networkd-ndisc.h"
 #include "networkd-netlabel.h"
@@ -1616,16 +1617,23 @@ static int address_process_request(Request *req, Link *link, Address *address) {
         assert(link);
         assert(address);
 
-        if (!link_is_ready_to_configure(link, false))
+        if (!link_is_ready_to_configure(link, false)) {
+                request_wait(req, /* any_link = */ false);
                 return 0;
+        }
 
         /* Refuse adding more than the limit */
-        if (set_size(link->addresses) >= ADDRESSES_PER_LINK_MAX)
+        if (set_size(link->addresses) >= ADDRESSES_PER_LINK_MAX) {
+                request_wait(req, /* any_link = */ false);
                 return 0;
+        }
 
         r = address_requeue_request(req, link, address);
-        if (r == -EBUSY)
+        if (r == -EBUSY) {
+                /* The address pool is exhausted, wait for addresses to be released on any link. */
+                request_wait(req, /* any_link = */ true);
                 return 0;
+        }
         if (r != 0)
                 return r;
 
@@ -1635,8 +1643,10 @@ static int address_process_request(Request *req, Link *link, Address *address) {
         if (r < 0)
                 return r;
 
-        if (!ipv4acd_bound(link, address))
+        if (!ipv4acd_bound(link, address)) {
+                request_wait(req, /* any_link = */ false);
                 return 0;
+        }
 
         address_set_cinfo(link->manager, address, &c);
         if (c.ifa_valid == 0) {
@@ -1823,6 +1833,9 @@ int manager_rtnl_process_address(sd_netlink *rtnl, sd_netlink_message *message,
                 return 0;
         }
 
+        link_wakeup_requests(link);
+        link_invalidate_json(link);
+
         r = address_new(&tmp);
         if (r < 0)
                 return log_oom();
@@ -5,6 +5,7 @@
 #include "bus-util.h"
 #include "dhcp-server-lease-internal.h"
 #include "networkd-dhcp-server-bus.h"
+#include "networkd-json.h"
 #include "networkd-link-bus.h"
 #include "networkd-manager.h"
 #include "strv.h"
@@ -72,6 +73,26 @@ static int property_get_leases(
         return sd_bus_message_close_container(reply);
 }
 
+static int property_get_statistics(
+                sd_bus *bus,
+                const char *path,
+                const char *interface,
+                const char *property,
+                sd_bus_message *reply,
+                void *userdata,
+                sd_bus_error *error) {
+        Link *l = ASSERT_PTR(userdata);
+        sd_dhcp_server *s;
+
+        assert(reply);
+
+        s = l->dhcp_server;
+        if (!s)
+                return sd_bus_error_setf(error, SD_BUS_ERROR_NOT_SUPPORTED, "Link %s has no DHCP server.", l->ifname);
+
+        return sd_bus_message_append(reply, "(ttt)", s->n_offers, s->n_acks, s->n_naks);
+}
+
 static int dhcp_server_emit_changed(Link *link, const char *property, ...) {
         _cleanup_free_ char *path = NULL;
         char **l;
@@ -97,14 +118,17 @@ static int dhcp_server_emit_changed(Link *link, const char *property, ...) {
 void dhcp_server_callback(sd_dhcp_server *s, uint64_t event, void *data) {
         Link *l = ASSERT_PTR(data);
 
-        if (event & SD_DHCP_SERVER_EVENT_LEASE_CHANGED)
+        if (event & SD_DHCP_SERVER_EVENT_LEASE_CHANGED) {
+                link_invalidate_json(l);
                 (void) dhcp_server_emit_changed(l, "Leases", NULL);
+        }
 }
 
 static const sd_bus_vtable dhcp_server_vtable[] = {
         SD_BUS_VTABLE_START(0),
 
         SD_BUS_PROPERTY("Leases", "a(uayayayayt)", property_get_leases, 0, SD_BUS_VTABLE_PROPERTY_EMITS_CHANGE),
+        SD_BUS_PROPERTY("Statistics", "(ttt)", property_get_statistics, 0, 0),
 
         SD_BUS_VTABLE_END
 };
@@ -12,6 +12,7 @@
 #include "networkd-ipv4acd.h"
 #include "networkd-link.h"
 #include "networkd-manager.h"
+#include "networkd-queue.h"
 
 DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(
         ipv4acd_hash_ops,
@@ -140,6 +141,9 @@ static void on_acd(sd_ipv4acd *acd, int event, void *userdata) {
 
         (void) link_get_ipv4_address(link, &a, 0, &address);
 
+        /* Requests for the address wait for the address being claimed. */
+        link_wakeup_requests(link);
+
         switch (event) {
         case SD_IPV4ACD_EVENT_STOP:
                 if (!address)
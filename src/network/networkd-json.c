@@ -15,6 +15,7 @@
 #include "networkd-json.h"
 #include "networkd-link.h"
 #include "networkd-manager.h"
+#include "networkd-manager-varlink.h"
 #include "networkd-neighbor.h"
 #include "networkd-network.h"
 #include "networkd-nexthop.h"
@@ -275,6 +276,66 @@ static int routes_append_json(Manager *manager, int ifindex, sd_json_variant **v
         return json_variant_set_field_non_null(v, "Routes", array);
 }
 
+static int route_statistics_append_json(Manager *manager, sd_json_variant **v) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *w = NULL;
+        int r;
+
+        assert(manager);
+        assert(v);
+
+        r = sd_json_buildo(
+                        &w,
+                        SD_JSON_BUILD_PAIR_UNSIGNED("Routes", set_size(manager->routes)),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("MemoryBytes", manager_routes_memory(manager)),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("Messages", manager->n_route_messages),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("IgnoredForeignRoutes", manager->n_foreign_routes_ignored),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("ProcessingUSec", manager->route_processing_usec));
+        if (r < 0)
+                return r;
+
+        return json_variant_set_field_non_null(v, "RouteStatistics", w);
+}
+
+static int enumeration_statistics_append_json(Manager *manager, sd_json_variant **v) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *array = NULL;
+        int r;
+
+        assert(manager);
+        assert(v);
+
+        for (ManagerEnumeration e = 0; e < _MANAGER_ENUMERATION_MAX; e++) {
+                r = sd_json_variant_append_arraybo(
+                                &array,
+                                SD_JSON_BUILD_PAIR_STRING("Type", manager_enumeration_to_string(e)),
+                                SD_JSON_BUILD_PAIR_UNSIGNED("Messages", manager->enumeration_n_messages[e]),
+                                SD_JSON_BUILD_PAIR_UNSIGNED("TimeUSec", manager->enumeration_usec[e]));
+                if (r < 0)
+                        return r;
+        }
+
+        return json_variant_set_field_non_null(v, "EnumerationStatistics", array);
+}
+
+static int request_queue_statistics_append_json(Manager *manager, sd_json_variant **v) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *w = NULL;
+        int r;
+
+        assert(manager);
+        assert(v);
+
+        r = sd_json_buildo(
+                        &w,
+                        SD_JSON_BUILD_PAIR_UNSIGNED("Requests", ordered_set_size(manager->request_queue)),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("Passes", manager->n_request_passes),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("Evaluated", manager->n_requests_evaluated),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("Skipped", manager->n_requests_skipped),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("EvaluatedLastPass", manager->n_requests_evaluated_last_pass));
+        if (r < 0)
+                return r;
+
+        return json_variant_set_field_non_null(v, "RequestQueueStatistics", w);
+}
+
 static int routing_policy_rule_append_json(RoutingPolicyRule *rule, sd_json_variant **array) {
         _cleanup_free_ char *table = NULL, *protocol = NULL, *state = NULL;
         int r;
@@ -1200,7 +1261,7 @@ static int dhcp_client_append_json(Link *link, sd_json_variant **v) {
         return json_variant_set_field_non_null(v, "DHCPv4Client", w);
 }
 
-int link_build_json(Link *link, sd_json_variant **ret) {
+static int link_build_json_uncached(Link *link, sd_json_variant **ret) {
         _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
         _cleanup_free_ char *type = NULL, *flags = NULL;
         int r;
@@ -1332,6 +1393,43 @@ int link_build_json(Link *link, sd_json_variant **ret) {
         return 0;
 }
 
+int link_build_json(Link *link, sd_json_variant **ret) {
+        int r;
+
+        assert(link);
+        assert(ret);
+
+        /* Building the description walks all addresses, neighbors, nexthops, and routes, hence keep the
+         * result until something about the link changes, see link_invalidate_json(). */
+
+        if (!link->json) {
+                r = link_build_json_uncached(link, &link->json);
+                if (r < 0)
+                        return r;
+        }
+
+        *ret = sd_json_variant_ref(link->json);
+        return 0;
+}
+
+void link_invalidate_json(Link *link) {
+        assert(link);
+        assert(link->manager);
+
+        link->json = sd_json_variant_unref(link->json);
+
+        manager_varlink_link_changed(link->manager, link->ifindex);
+}
+
+void manager_invalidate_link_json(Manager *manager, int ifindex) {
+        Link *link;
+
+        assert(manager);
+
+        if (link_get_by_index(manager, ifindex, &link) >= 0)
+                link_invalidate_json(link);
+}
+
 static int links_append_json(Manager *manager, sd_json_variant **v) {
         _cleanup_(sd_json_variant_unrefp) sd_json_variant *array = NULL;
         _cleanup_free_ Link **links = NULL;
@@ -1379,6 +1477,18 @@ int manager_build_json(Manager *manager, sd_json_variant **ret) {
         if (r < 0)
                 return r;
 
+        r = route_statistics_append_json(manager, &v);
+        if (r < 0)
+                return r;
+
+        r = request_queue_statistics_append_json(manager, &v);
+        if (r < 0)
+                return r;
+
+        r = enumeration_statistics_append_json(manager, &v);
+        if (r < 0)
+                return r;
+
         r = routing_policy_rules_append_json(manager->rules, &v);
         if (r < 0)
                 return r;
@@ -7,4 +7,6 @@ typedef struct Link Link;
 typedef struct Manager Manager;
 
 int link_build_json(Link *link, sd_json_variant **ret);
+void link_invalidate_json(Link *link);
+void manager_invalidate_link_json(Manager *manager, int ifindex);
 int manager_build_json(Manager *manager, sd_json_variant **ret);
@@ -44,6 +44,7 @@
 #include "networkd-ipv4acd.h"
 #include "networkd-ipv4ll.h"
 #include "networkd-ipv6-proxy-ndp.h"
+#include "networkd-json.h"
 #include "networkd-link-bus.h"
 #include "networkd-link.h"
 #include "networkd-lldp-tx.h"
@@ -287,6 +288,8 @@ static Link *link_free(Link *link) {
 
         sd_event_source_disable_unref(link->carrier_lost_timer);
 
+        sd_json_variant_unref(link->json);
+
         return mfree(link);
 }
 
@@ -361,6 +364,7 @@ void link_set_state(Link *link, LinkState state) {
                        link_state_to_string(state));
 
         link->state = state;
+        link_wakeup_requests(link);
 
         link_send_changed(link, "AdministrativeState", NULL);
         link_dirty(link);
@@ -1051,6 +1055,7 @@ static Link *link_drop(Link *link) {
         assert(link->manager);
 
         link_set_state(link, LINK_STATE_LINGER);
+        manager_wakeup_requests(link->manager);
 
         /* Drop all references from other links and manager. Note that async netlink calls may have
          * references to the link, and they will be dropped when we receive replies. */
@@ -1670,6 +1675,8 @@ int manager_udev_process_link(Manager *m, sd_device *device, sd_device_action_t
                 return 0;
         }
 
+        link_invalidate_json(link);
+
         /* Let's unref the sd-device object assigned to the corresponding Link object, but keep the Link
          * object here. It will be removed only when rtnetlink says so. */
         if (action == SD_DEVICE_REMOVE) {
@@ -2591,6 +2598,10 @@ static int link_update(Link *link, sd_netlink_message *message) {
         assert(link);
         assert(message);
 
+        /* The carrier state or so may change, which requests may wait for. */
+        link_wakeup_requests(link);
+        link_invalidate_json(link);
+
         r = link_update_name(link, message);
         if (r < 0)
                 return r;
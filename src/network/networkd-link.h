@@ -11,6 +11,7 @@
 #include "sd-dhcp6-client.h"
 #include "sd-ipv4acd.h"
 #include "sd-ipv4ll.h"
+#include "sd-json.h"
 #include "sd-lldp-rx.h"
 #include "sd-lldp-tx.h"
 #include "sd-ndisc.h"
@@ -57,6 +58,12 @@ typedef struct Link {
         int sr_iov_phys_port_ifindex;
         Set *sr_iov_virt_port_ifindices;
 
+        /* Bumped by link_wakeup_requests() */
+        uint64_t request_generation;
+
+        /* The result of link_build_json(), dropped by link_invalidate_json() */
+        sd_json_variant *json;
+
         char *ifname;
         char **alternative_names;
         char *kind;
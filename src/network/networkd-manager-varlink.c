@@ -7,6 +7,7 @@
 #include "json-util.h"
 #include "lldp-rx-internal.h"
 #include "networkd-dhcp-server.h"
+#include "networkd-json.h"
 #include "networkd-manager-varlink.h"
 #include "stat-util.h"
 #include "varlink.h"
@@ -260,6 +261,117 @@ static int on_connect(VarlinkServer *s, Varlink *vlink, void *userdata) {
         return 0;
 }
 
+static int link_description_notify(Manager *m, Varlink *vlink, int ifindex) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        Link *link;
+        int r;
+
+        assert(m);
+        assert(vlink);
+
+        if (link_get_by_index(m, ifindex, &link) >= 0) {
+                r = link_build_json(link, &v);
+                if (r < 0)
+                        return r;
+        }
+
+        return varlink_notifybo(
+                        vlink,
+                        SD_JSON_BUILD_PAIR_INTEGER("InterfaceIndex", ifindex),
+                        SD_JSON_BUILD_PAIR_CONDITION(!!v, "Description", SD_JSON_BUILD_VARIANT(v)));
+}
+
+static int on_notify_link_descriptions(sd_event_source *s, void *userdata) {
+        Manager *m = ASSERT_PTR(userdata);
+        void *p;
+
+        while ((p = set_steal_first(m->varlink_changed_links))) {
+                Varlink *vlink;
+
+                SET_FOREACH(vlink, m->varlink_link_subscribers) {
+                        int r;
+
+                        r = link_description_notify(m, vlink, PTR_TO_INT(p));
+                        if (r < 0)
+                                log_debug_errno(r, "Failed to send description of interface %i to subscriber, ignoring: %m",
+                                                PTR_TO_INT(p));
+                }
+        }
+
+        return 0;
+}
+
+void manager_varlink_link_changed(Manager *m, int ifindex) {
+        int r;
+
+        assert(m);
+        assert(ifindex > 0);
+
+        /* Changes are coalesced and sent from a defer event source, as a link usually changes in several
+         * steps while a single netlink message or DHCP lease is processed. */
+
+        if (set_isempty(m->varlink_link_subscribers))
+                return;
+
+        r = set_ensure_put(&m->varlink_changed_links, NULL, INT_TO_PTR(ifindex));
+        if (r < 0)
+                return (void) log_oom_debug();
+
+        if (m->varlink_notify_event_source) {
+                r = sd_event_source_set_enabled(m->varlink_notify_event_source, SD_EVENT_ONESHOT);
+                if (r < 0)
+                        log_debug_errno(r, "Failed to enable varlink notification event source, ignoring: %m");
+                return;
+        }
+
+        r = sd_event_add_defer(m->event, &m->varlink_notify_event_source, on_notify_link_descriptions, m);
+        if (r < 0)
+                return (void) log_debug_errno(r, "Failed to add varlink notification event source, ignoring: %m");
+
+        (void) sd_event_source_set_enabled(m->varlink_notify_event_source, SD_EVENT_ONESHOT);
+        (void) sd_event_source_set_description(m->varlink_notify_event_source, "varlink-link-descriptions");
+}
+
+static int vl_method_subscribe_link_descriptions(Varlink *vlink, sd_json_variant *parameters, VarlinkMethodFlags flags, void *userdata) {
+        Manager *m = ASSERT_PTR(userdata);
+        Link *link;
+        int r;
+
+        assert(vlink);
+
+        if (!FLAGS_SET(flags, VARLINK_METHOD_MORE))
+                return varlink_error(vlink, VARLINK_ERROR_EXPECTED_MORE, NULL);
+
+        if (sd_json_variant_elements(parameters) > 0)
+                return varlink_error_invalid_parameter(vlink, parameters);
+
+        HASHMAP_FOREACH(link, m->links_by_index) {
+                r = link_description_notify(m, vlink, link->ifindex);
+                if (r < 0)
+                        return r;
+        }
+
+        r = varlink_notifybo(vlink, SD_JSON_BUILD_PAIR_BOOLEAN("Ready", true));
+        if (r < 0)
+                return r;
+
+        r = set_ensure_put(&m->varlink_link_subscribers, NULL, vlink);
+        if (r < 0)
+                return r;
+        varlink_ref(vlink);
+
+        log_debug("%u clients now subscribed to interface descriptions.", set_size(m->varlink_link_subscribers));
+        return 1;
+}
+
+static void on_disconnect(VarlinkServer *s, Varlink *vlink, void *userdata) {
+        Manager *m = ASSERT_PTR(userdata);
+
+        assert(vlink);
+
+        varlink_unref(set_remove(m->varlink_link_subscribers, vlink));
+}
+
 int manager_connect_varlink(Manager *m) {
         _cleanup_(varlink_server_unrefp) VarlinkServer *s = NULL;
         int r;
@@ -286,7 +398,8 @@ int manager_connect_varlink(Manager *m) {
                         "io.systemd.Network.GetStates", vl_method_get_states,
                         "io.systemd.Network.GetNamespaceId", vl_method_get_namespace_id,
                         "io.systemd.Network.GetLLDPNeighbors", vl_method_get_lldp_neighbors,
-                        "io.systemd.Network.SetPersistentStorage", vl_method_set_persistent_storage);
+                        "io.systemd.Network.SetPersistentStorage", vl_method_set_persistent_storage,
+                        "io.systemd.Network.SubscribeLinkDescriptions", vl_method_subscribe_link_descriptions);
         if (r < 0)
                 return log_error_errno(r, "Failed to register varlink methods: %m");
 
@@ -302,6 +415,10 @@ int manager_connect_varlink(Manager *m) {
         if (r < 0)
                 return log_error_errno(r, "Failed to set on-connect callback for varlink: %m");
 
+        r = varlink_server_bind_disconnect(s, on_disconnect);
+        if (r < 0)
+                return log_error_errno(r, "Failed to set on-disconnect callback for varlink: %m");
+
         m->varlink_server = TAKE_PTR(s);
         return 0;
 }
@@ -309,6 +426,10 @@ int manager_connect_varlink(Manager *m) {
 void manager_varlink_done(Manager *m) {
         assert(m);
 
+        m->varlink_link_subscribers = set_free_with_destructor(m->varlink_link_subscribers, varlink_unref);
+        m->varlink_changed_links = set_free(m->varlink_changed_links);
+        m->varlink_notify_event_source = sd_event_source_disable_unref(m->varlink_notify_event_source);
+
         m->varlink_server = varlink_server_unref(m->varlink_server);
         (void) unlink("/run/systemd/netif/io.systemd.Network");
 }
@@ -5,3 +5,5 @@
 
 int manager_connect_varlink(Manager *m);
 void manager_varlink_done(Manager *m);
+
+void manager_varlink_link_changed(Manager *m, int ifindex);
@@ -1,5 +1,6 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
+#include <net/if.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <unistd.h>
@@ -27,6 +28,7 @@
 #include "fd-util.h"
 #include "fileio.h"
 #include "firewall-util.h"
+#include "format-util.h"
 #include "fs-util.h"
 #include "initrd-util.h"
 #include "local-addresses.h"
@@ -58,6 +60,7 @@
 #include "set.h"
 #include "signal-util.h"
 #include "stat-util.h"
+#include "string-table.h"
 #include "strv.h"
 #include "sysctl-util.h"
 #include "tclass.h"
@@ -649,6 +652,9 @@ Manager* manager_free(Manager *m) {
         hashmap_free(m->route_table_names_by_number);
         hashmap_free(m->route_table_numbers_by_name);
 
+        set_free(m->ignore_foreign_route_protocols);
+        set_free(m->ignore_foreign_route_tables);
+
         set_free(m->rules);
 
         sd_netlink_unref(m->rtnl);
@@ -759,8 +765,10 @@ int manager_enumerate_internal(
                 return r;
 
         m->enumerating = true;
-        for (sd_netlink_message *reply_one = reply; reply_one; reply_one = sd_netlink_message_next(reply_one))
+        for (sd_netlink_message *reply_one = reply; reply_one; reply_one = sd_netlink_message_next(reply_one)) {
                 RET_GATHER(r, process(nl, reply_one, m));
+                m->n_enumerated_messages++;
+        }
         m->enumerating = false;
 
         return r;
@@ -815,10 +823,16 @@ static int manager_enumerate_tclass(Manager *m) {
         assert(m);
         assert(m->rtnl);
 
-        /* TC class can be enumerated only per link. See tc_dump_tclass() in net/sched/sched_api.c. */
+        /* TC class can be enumerated only per link. See tc_dump_tclass() in net/sched/sched_api.c.
+         * Skip links without any classful qdisc, e.g. veth and other noqueue interfaces, as they cannot
+         * have a class. On container hosts with thousands of veths this saves as many roundtrips. */
+
+        HASHMAP_FOREACH(link, m->links_by_index) {
+                if (!link_has_classful_qdisc(link))
+                        continue;
 
-        HASHMAP_FOREACH(link, m->links_by_index)
                 RET_GATHER(r, link_enumerate_tclass(link, 0));
+        }
 
         return r;
 }
@@ -865,7 +879,15 @@ static int manager_enumerate_routes(Manager *m) {
         if (r < 0)
                 return r;
 
-        return manager_enumerate_internal(m, m->rtnl, req, manager_rtnl_process_route);
+        r = manager_enumerate_internal(m, m->rtnl, req, manager_rtnl_process_route);
+        if (r < 0)
+                return r;
+
+        log_debug("Enumerated %u routes, ignored %" PRIu64 " foreign routes, in %s, using about %s of memory.",
+                  set_size(m->routes), m->n_foreign_routes_ignored,
+                  FORMAT_TIMESPAN(m->route_processing_usec, USEC_PER_MSEC),
+                  FORMAT_BYTES(manager_routes_memory(m)));
+        return 0;
 }
 
 static int manager_enumerate_rules(Manager *m) {
@@ -959,73 +981,117 @@ static int manager_enumerate_nl80211_mlme(Manager *m) {
         return 0;
 }
 
+static int manager_enumerate_one(Manager *m, ManagerEnumeration e, int (*enumerate)(Manager *m)) {
+        uint64_t n_messages;
+        usec_t start;
+        int r;
+
+        assert(m);
+        assert(e >= 0 && e < _MANAGER_ENUMERATION_MAX);
+        assert(enumerate);
+
+        n_messages = m->n_enumerated_messages;
+        start = now(CLOCK_MONOTONIC);
+
+        r = enumerate(m);
+
+        m->enumeration_usec[e] = usec_sub_unsigned(now(CLOCK_MONOTONIC), start);
+        m->enumeration_n_messages[e] = m->n_enumerated_messages - n_messages;
+        m->enumeration_total_usec = usec_add(m->enumeration_total_usec, m->enumeration_usec[e]);
+
+        log_debug("Enumerated %s: %" PRIu64 " messages in %s.",
+                  manager_enumeration_to_string(e),
+                  m->enumeration_n_messages[e],
+                  FORMAT_TIMESPAN(m->enumeration_usec[e], USEC_PER_MSEC));
+        return r;
+}
+
 int manager_enumerate(Manager *m) {
         int r;
 
-        r = manager_enumerate_links(m);
+        m->enumeration_total_usec = 0;
+
+        r = manager_enumerate_one(m, MANAGER_ENUMERATION_LINKS, manager_enumerate_links);
         if (r < 0)
                 return log_error_errno(r, "Could not enumerate links: %m");
 
-        r = manager_enumerate_qdisc(m);
+        r = manager_enumerate_one(m, MANAGER_ENUMERATION_QDISCS, manager_enumerate_qdisc);
         if (r == -EOPNOTSUPP)
                 log_debug_errno(r, "Could not enumerate QDiscs, ignoring: %m");
         else if (r < 0)
                 return log_error_errno(r, "Could not enumerate QDisc: %m");
 
-        r = manager_enumerate_tclass(m);
+        r = manager_enumerate_one(m, MANAGER_ENUMERATION_TCLASSES, manager_enumerate_tclass);
         if (r == -EOPNOTSUPP)
                 log_debug_errno(r, "Could not enumerate TClasses, ignoring: %m");
         else if (r < 0)
                 return log_error_errno(r, "Could not enumerate TClass: %m");
 
-        r = manager_enumerate_addresses(m);
+        r = manager_enumerate_one(m, MANAGER_ENUMERATION_ADDRESSES, manager_enumerate_addresses);
         if (r < 0)
                 return log_error_errno(r, "Could not enumerate addresses: %m");
 
-        r = manager_enumerate_neighbors(m);
+        r = manager_enumerate_one(m, MANAGER_ENUMERATION_NEIGHBORS, manager_enumerate_neighbors);
         if (r < 0)
                 return log_error_errno(r, "Could not enumerate neighbors: %m");
 
         /* NextHop support is added in kernel v5.3 (65ee00a9409f751188a8cdc0988167858eb4a536),
          * and older kernels return -EOPNOTSUPP, or -EINVAL if SELinux is enabled. */
-        r = manager_enumerate_nexthop(m);
+        r = manager_enumerate_one(m, MANAGER_ENUMERATION_NEXTHOPS, manager_enumerate_nexthop);
         if (r == -EOPNOTSUPP || (r == -EINVAL && mac_selinux_enforcing()))
                 log_debug_errno(r, "Could not enumerate nexthops, ignoring: %m");
         else if (r < 0)
                 return log_error_errno(r, "Could not enumerate nexthops: %m");
 
-        r = manager_enumerate_routes(m);
+        r = manager_enumerate_one(m, MANAGER_ENUMERATION_ROUTES, manager_enumerate_routes);
         if (r < 0)
                 return log_error_errno(r, "Could not enumerate routes: %m");
 
         /* If kernel is built with CONFIG_FIB_RULES=n, it returns -EOPNOTSUPP. */
-        r = manager_enumerate_rules(m);
+        r = manager_enumerate_one(m, MANAGER_ENUMERATION_RULES, manager_enumerate_rules);
         if (r == -EOPNOTSUPP)
                 log_debug_errno(r, "Could not enumerate routing policy rules, ignoring: %m");
         else if (r < 0)
                 return log_error_errno(r, "Could not enumerate routing policy rules: %m");
 
-        r = manager_enumerate_nl80211_wiphy(m);
+        r = manager_enumerate_one(m, MANAGER_ENUMERATION_NL80211_WIPHY, manager_enumerate_nl80211_wiphy);
         if (r == -EOPNOTSUPP)
                 log_debug_errno(r, "Could not enumerate wireless LAN phy, ignoring: %m");
         else if (r < 0)
                 return log_error_errno(r, "Could not enumerate wireless LAN phy: %m");
 
-        r = manager_enumerate_nl80211_config(m);
+        r = manager_enumerate_one(m, MANAGER_ENUMERATION_NL80211_CONFIG, manager_enumerate_nl80211_config);
         if (r == -EOPNOTSUPP)
                 log_debug_errno(r, "Could not enumerate wireless LAN interfaces, ignoring: %m");
         else if (r < 0)
                 return log_error_errno(r, "Could not enumerate wireless LAN interfaces: %m");
 
-        r = manager_enumerate_nl80211_mlme(m);
+        r = manager_enumerate_one(m, MANAGER_ENUMERATION_NL80211_MLME, manager_enumerate_nl80211_mlme);
         if (r == -EOPNOTSUPP)
                 log_debug_errno(r, "Could not enumerate wireless LAN stations, ignoring: %m");
         else if (r < 0)
                 return log_error_errno(r, "Could not enumerate wireless LAN stations: %m");
 
+        log_debug("Enumeration finished in %s.", FORMAT_TIMESPAN(m->enumeration_total_usec, USEC_PER_MSEC));
         return 0;
 }
 
+static const char* const manager_enumeration_table[_MANAGER_ENUMERATION_MAX] = {
+        [MANAGER_ENUMERATION_LINKS]          = "links",
+        [MANAGER_ENUMERATION_QDISCS]         = "qdiscs",
+        [MANAGER_ENUMERATION_TCLASSES]       = "tclasses",
+        [MANAGER_ENUMERATION_ADDRESSES]      = "addresses",
+        [MANAGER_ENUMERATION_NEIGHBORS]      = "neighbors",
+        [MANAGER_ENUMERATION_NEXTHOPS]       = "nexthops",
+        [MANAGER_ENUMERATION_ROUTES]         = "routes",
+        [MANAGER_ENUMERATION_RULES]          = "rules",
+        [MANAGER_ENUMERATION_NL80211_WIPHY]  = "nl80211-wiphy",
+        [MANAGER_ENUMERATION_NL80211_CONFIG] = "nl80211-config",
+        [MANAGER_ENUMERATION_NL80211_MLME]   = "nl80211-mlme",
+};
+
+DEFINE_STRING_TABLE_LOOKUP_TO_STRING(manager_enumeration, ManagerEnumeration);
+
 static int set_hostname_handler(sd_bus_message *m, void *userdata, sd_bus_error *ret_error) {
         const sd_bus_error *e;
         int r;
@@ -19,6 +19,22 @@
 #include "time-util.h"
 #include "varlink.h"
 
+typedef enum ManagerEnumeration {
+        MANAGER_ENUMERATION_LINKS,
+        MANAGER_ENUMERATION_QDISCS,
+        MANAGER_ENUMERATION_TCLASSES,
+        MANAGER_ENUMERATION_ADDRESSES,
+        MANAGER_ENUMERATION_NEIGHBORS,
+        MANAGER_ENUMERATION_NEXTHOPS,
+        MANAGER_ENUMERATION_ROUTES,
+        MANAGER_ENUMERATION_RULES,
+        MANAGER_ENUMERATION_NL80211_WIPHY,
+        MANAGER_ENUMERATION_NL80211_CONFIG,
+        MANAGER_ENUMERATION_NL80211_MLME,
+        _MANAGER_ENUMERATION_MAX,
+        _MANAGER_ENUMERATION_INVALID = -EINVAL,
+} ManagerEnumeration;
+
 struct Manager {
         sd_netlink *rtnl;
         /* lazy initialized */
@@ -27,6 +43,10 @@ struct Manager {
         sd_resolve *resolve;
         sd_bus *bus;
         VarlinkServer *varlink_server;
+        /* Clients of io.systemd.Network.SubscribeLinkDescriptions, and the interfaces to notify them about */
+        Set *varlink_link_subscribers;
+        Set *varlink_changed_links;
+        sd_event_source *varlink_notify_event_source;
         sd_device_monitor *device_monitor;
         Hashmap *polkit_registry;
         int ethtool_fd;
@@ -88,6 +108,22 @@ struct Manager {
         unsigned route_remove_messages;
         Set *routes;
 
+        /* Foreign routes with these protocols or in these tables are not tracked, see
+         * IgnoreForeignRouteProtocols= and IgnoreForeignRouteTables= */
+        Set *ignore_foreign_route_protocols;
+        Set *ignore_foreign_route_tables;
+
+        /* Statistics about received route messages */
+        uint64_t n_route_messages;
+        uint64_t n_foreign_routes_ignored;
+        usec_t route_processing_usec;
+
+        /* Statistics about manager_enumerate(), the number of dump replies and the time taken by each step */
+        uint64_t n_enumerated_messages;
+        uint64_t enumeration_n_messages[_MANAGER_ENUMERATION_MAX];
+        usec_t enumeration_usec[_MANAGER_ENUMERATION_MAX];
+        usec_t enumeration_total_usec;
+
         /* Route table name */
         Hashmap *route_table_numbers_by_name;
         Hashmap *route_table_names_by_number;
@@ -111,6 +147,16 @@ struct Manager {
         OrderedSet *request_queue;
         OrderedSet *remove_request_queue;
 
+        /* Bumped by manager_wakeup_requests(), and the latter also by link_wakeup_requests(). */
+        uint64_t request_generation;
+        uint64_t request_generation_any;
+
+        /* Statistics about manager_process_requests() */
+        uint64_t n_request_passes;
+        uint64_t n_requests_evaluated;
+        uint64_t n_requests_skipped;
+        unsigned n_requests_evaluated_last_pass;
+
         Hashmap *tuntap_fds_by_name;
 
         unsigned reloading;
@@ -134,6 +180,8 @@ int manager_enumerate_internal(
                 int (*process)(sd_netlink *, sd_netlink_message *, Manager *));
 int manager_enumerate(Manager *m);
 
+const char* manager_enumeration_to_string(ManagerEnumeration e) _const_;
+
 int manager_set_hostname(Manager *m, const char *hostname);
 int manager_set_timezone(Manager *m, const char *timezone);
 
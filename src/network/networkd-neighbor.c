@@ -3,6 +3,7 @@
 #include "alloc-util.h"
 #include "hashmap.h"
 #include "netlink-util.h"
+#include "networkd-json.h"
 #include "networkd-link.h"
 #include "networkd-manager.h"
 #include "networkd-neighbor.h"
@@ -288,8 +289,10 @@ static int neighbor_process_request(Request *req, Link *link, Neighbor *neighbor
         assert(link);
         assert(neighbor);
 
-        if (!link_is_ready_to_configure(link, false))
+        if (!link_is_ready_to_configure(link, false)) {
+                request_wait(req, /* any_link = */ false);
                 return 0;
+        }
 
         r = neighbor_configure(neighbor, link, req);
         if (r < 0)
@@ -585,6 +588,8 @@ int manager_rtnl_process_neighbor(sd_netlink *rtnl, sd_netlink_message *message,
                  * kernel sends messages about neighbors after a link is removed. So, just ignore it. */
                 return 0;
 
+        link_invalidate_json(link);
+
         r = neighbor_new(&tmp);
         if (r < 0)
                 return log_oom();
@@ -8,6 +8,7 @@
 
 #include "alloc-util.h"
 #include "netlink-util.h"
+#include "networkd-json.h"
 #include "networkd-link.h"
 #include "networkd-manager.h"
 #include "networkd-network.h"
@@ -1030,6 +1031,9 @@ int manager_rtnl_process_nexthop(sd_netlink *rtnl, sd_netlink_message *message,
                 return 0;
         }
 
+        /* Routes of any link may use the nexthop. */
+        manager_wakeup_requests(m);
+
         r = sd_netlink_message_read_u32(message, NHA_ID, &id);
         if (r == -ENODATA) {
                 log_warning_errno(r, "rtnl: received nexthop message without NHA_ID attribute, ignoring: %m");
@@ -1047,6 +1051,7 @@ int manager_rtnl_process_nexthop(sd_netlink *rtnl, sd_netlink_message *message,
 
         if (type == RTM_DELNEXTHOP) {
                 if (nexthop) {
+                        manager_invalidate_link_json(m, nexthop->ifindex);
                         nexthop_enter_removed(nexthop);
                         log_nexthop_debug(nexthop, "Forgetting removed", m);
                         (void) nexthop_remove_dependents(nexthop, m);
@@ -1106,6 +1111,9 @@ int manager_rtnl_process_nexthop(sd_netlink *rtnl, sd_netlink_message *message,
         else
                 nexthop->blackhole = r;
 
+        /* The nexthop may move to another interface, hence refresh the descriptions of both. */
+        manager_invalidate_link_json(m, nexthop->ifindex);
+
         r = sd_netlink_message_read_u32(message, NHA_OIF, &ifindex);
         if (r == -ENODATA)
                 nexthop->ifindex = 0;
@@ -35,9 +35,13 @@ static Request *request_free(Request *req) {
         if (req->free_func)
                 req->free_func(req->userdata);
 
-        if (req->counter)
+        if (req->counter) {
                 (*req->counter)--;
 
+                if (req->link)
+                        link_wakeup_requests(req->link);
+        }
+
         link_unref(req->link); /* link may be NULL, but link_unref() can handle it gracefully. */
 
         return mfree(req);
@@ -233,7 +237,64 @@ int link_requeue_request(Link *link, Request *req, void *userdata, Request **ret
                         ret);
 }
 
+void request_wait(Request *req, bool any_link) {
+        assert(req);
+        assert(req->manager);
+
+        /* May be called by the 'process' function of a request before it returns 0, to tell that the request
+         * cannot be processed until something changes on its link, or with 'any_link' on any link. It is then
+         * not processed again before link_wakeup_requests() or manager_wakeup_requests() is called. Requests
+         * whose 'process' function does not call this are processed on every pass, as before. With many
+         * links, each with many pending addresses and routes, this saves re-evaluating all of them whenever
+         * anything happens. */
+
+        req->blocked = true;
+        req->blocked_on_any_link = any_link || !req->link;
+        req->blocked_generation = req->blocked_on_any_link ? req->manager->request_generation_any : req->manager->request_generation;
+        req->blocked_link_generation = req->link ? req->link->request_generation : 0;
+}
+
+static bool request_is_blocked(Request *req) {
+        assert(req);
+        assert(req->manager);
+
+        if (!req->blocked)
+                return false;
+
+        if (req->blocked_on_any_link)
+                return req->blocked_generation == req->manager->request_generation_any;
+
+        return req->blocked_generation == req->manager->request_generation &&
+                req->blocked_link_generation == req->link->request_generation;
+}
+
+void link_wakeup_requests(Link *link) {
+        assert(link);
+        assert(link->manager);
+
+        /* Something changed on the link, e.g. its state, carrier, or an address or route on it. */
+
+        /* The readiness of SR-IOV ports depends on all other ports, see check_ready_for_all_sr_iov_ports(). */
+        if (link->sr_iov_phys_port_ifindex > 0 || !set_isempty(link->sr_iov_virt_port_ifindices)) {
+                manager_wakeup_requests(link->manager);
+                return;
+        }
+
+        link->request_generation++;
+        link->manager->request_generation_any++;
+}
+
+void manager_wakeup_requests(Manager *manager) {
+        assert(manager);
+
+        /* Something changed that requests of all links may wait for. */
+
+        manager->request_generation++;
+        manager->request_generation_any++;
+}
+
 int manager_process_requests(Manager *manager) {
+        unsigned n_evaluated = 0;
         Request *req;
         int r;
 
@@ -244,11 +305,17 @@ int manager_process_requests(Manager *manager) {
                 return 0;
 
         manager->request_queued = false;
+        manager->n_request_passes++;
 
         ORDERED_SET_FOREACH(req, manager->request_queue) {
                 if (req->waiting_reply)
                         continue; /* Already processed, and waiting for netlink reply. */
 
+                if (request_is_blocked(req)) {
+                        manager->n_requests_skipped++;
+                        continue; /* Nothing changed it waits for since it was processed last time. */
+                }
+
                 /* Typically, requests send netlink message asynchronously. If there are many requests
                  * queued, then this event may make reply callback queue in sd-netlink full. */
                 if (netlink_get_reply_callback_count(manager->rtnl) >= REPLY_CALLBACK_COUNT_THRESHOLD ||
@@ -260,6 +327,9 @@ int manager_process_requests(Manager *manager) {
                 _unused_ _cleanup_(request_unrefp) Request *req_unref = request_ref(req);
                 _cleanup_(link_unrefp) Link *link = link_ref(req->link);
 
+                req->blocked = false;
+                n_evaluated++;
+
                 assert(req->process);
                 r = req->process(req, link, req->userdata);
                 if (r < 0) {
@@ -282,6 +352,8 @@ int manager_process_requests(Manager *manager) {
                         break; /* New request is queued. Exit from the loop. */
         }
 
+        manager->n_requests_evaluated += n_evaluated;
+        manager->n_requests_evaluated_last_pass = n_evaluated;
         return 0;
 }
 
@@ -294,6 +366,12 @@ static int request_netlink_handler(sd_netlink *nl, sd_netlink_message *m, Reques
                 req->counter = NULL; /* To prevent double decrement on free. */
         }
 
+        /* Other requests may wait for this one to finish, e.g. through link->set_link_messages. */
+        if (req->link)
+                link_wakeup_requests(req->link);
+        else if (req->manager)
+                manager_wakeup_requests(req->manager);
+
         if (req->link && IN_SET(req->link->state, LINK_STATE_FAILED, LINK_STATE_LINGER))
                 return 0;
 
@@ -82,6 +82,12 @@ struct Request {
         request_netlink_handler_t netlink_handler;
 
         bool waiting_reply;
+
+        /* Set by request_wait(), when 'process' found that the request cannot be processed yet. */
+        bool blocked;
+        bool blocked_on_any_link;
+        uint64_t blocked_generation;
+        uint64_t blocked_link_generation;
 };
 
 Request *request_ref(Request *req);
@@ -137,6 +143,10 @@ static inline int link_queue_request(
                                         ret);                           \
         })
 
+void request_wait(Request *req, bool any_link);
+void link_wakeup_requests(Link *link);
+void manager_wakeup_requests(Manager *manager);
+
 int manager_process_requests(Manager *manager);
 int request_call_netlink_async(sd_netlink *nl, sd_netlink_message *m, Request *req);
 
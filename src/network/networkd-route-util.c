@@ -598,3 +598,73 @@ int config_parse_route_table_names(
                 TAKE_PTR(name);
         }
 }
+
+int config_parse_ignore_foreign_routes(
+                const char *unit,
+                const char *filename,
+                unsigned line,
+                const char *section,
+                unsigned section_line,
+                const char *lvalue,
+                int ltype,
+                const char *rvalue,
+                void *data,
+                void *userdata) {
+
+        Manager *m = ASSERT_PTR(userdata);
+        Set **s = ASSERT_PTR(data);
+        int r;
+
+        /* ltype is true for IgnoreForeignRouteProtocols=, false for IgnoreForeignRouteTables= */
+
+        assert(filename);
+        assert(lvalue);
+        assert(rvalue);
+
+        if (isempty(rvalue)) {
+                *s = set_free(*s);
+                return 0;
+        }
+
+        for (const char *p = rvalue;;) {
+                _cleanup_free_ char *word = NULL;
+                uint32_t k;
+
+                r = extract_first_word(&p, &word, NULL, 0);
+                if (r == -ENOMEM)
+                        return log_oom();
+                if (r < 0) {
+                        log_syntax(unit, LOG_WARNING, filename, line, r,
+                                   "Invalid %s=, ignoring assignment: %s", lvalue, rvalue);
+                        return 0;
+                }
+                if (r == 0)
+                        return 0;
+
+                if (ltype) {
+                        r = route_protocol_full_from_string(word);
+                        if (r == 0)
+                                r = -ERANGE;
+                        if (r < 0) {
+                                log_syntax(unit, LOG_WARNING, filename, line, r,
+                                           "Failed to parse route protocol '%s', ignoring assignment: %m", word);
+                                continue;
+                        }
+                        k = r;
+                } else {
+                        r = manager_get_route_table_from_string(m, word, &k);
+                        if (r < 0) {
+                                log_syntax(unit, LOG_WARNING, filename, line, r,
+                                           "Failed to parse route table '%s', ignoring assignment: %m", word);
+                                continue;
+                        }
+                }
+
+                r = set_ensure_put(s, NULL, UINT32_TO_PTR(k));
+                if (r == -ENOMEM)
+                        return log_oom();
+                if (r < 0)
+                        log_syntax(unit, LOG_WARNING, filename, line, r,
+                                   "Failed to store %s '%s', ignoring assignment: %m", lvalue, word);
+        }
+}
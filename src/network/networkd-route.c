@@ -8,6 +8,7 @@
 #include "netlink-util.h"
 #include "networkd-address.h"
 #include "networkd-ipv4ll.h"
+#include "networkd-json.h"
 #include "networkd-manager.h"
 #include "networkd-network.h"
 #include "networkd-nexthop.h"
@@ -807,6 +808,33 @@ static int route_is_ready_to_configure(const Route *route, Link *link) {
         return route_nexthops_is_ready_to_configure(route, link->manager);
 }
 
+static bool route_is_ready_only_on_link(const Route *route, Link *link) {
+        assert(route);
+        assert(link);
+
+        /* Returns true if route_is_ready_to_configure() only depends on the state of the link itself,
+         * i.e. the route needs no address or nexthop elsewhere, and all its gateways are on the link. */
+
+        if (in_addr_is_set(route->family, &route->prefsrc) > 0)
+                return false;
+
+        if (route->nexthop_id != 0)
+                return false;
+
+        if (route_type_is_reject(route))
+                return true;
+
+        if (ordered_set_isempty(route->nexthops))
+                return route->nexthop.ifindex == link->ifindex;
+
+        RouteNextHop *nh;
+        ORDERED_SET_FOREACH(nh, route->nexthops)
+                if (nh->ifindex != link->ifindex)
+                        return false;
+
+        return true;
+}
+
 static int route_process_request(Request *req, Link *link, Route *route) {
         Route *existing;
         int r;
@@ -819,8 +847,10 @@ static int route_process_request(Request *req, Link *link, Route *route) {
         r = route_is_ready_to_configure(route, link);
         if (r < 0)
                 return log_link_warning_errno(link, r, "Failed to check if route is ready to configure: %m");
-        if (r == 0)
+        if (r == 0) {
+                request_wait(req, /* any_link = */ !route_is_ready_only_on_link(route, link));
                 return 0;
+        }
 
         usec_t now_usec;
         assert_se(sd_event_now(link->manager->event, CLOCK_BOOTTIME, &now_usec) >= 0);
@@ -1004,6 +1034,25 @@ int link_request_static_routes(Link *link, bool only_ipv4) {
         return 0;
 }
 
+static bool route_is_ignored_foreign(Manager *manager, const Route *route) {
+        assert(manager);
+        assert(route);
+
+        /* Returns true if we should not remember the route, when it is not one we configure ourselves. With
+         * a full BGP table there may be a million of such routes, which we'd otherwise all keep in memory. */
+
+        if (!manager->manage_foreign_routes)
+                return true;
+
+        if (set_contains(manager->ignore_foreign_route_protocols, UINT32_TO_PTR(route->protocol)))
+                return true;
+
+        if (set_contains(manager->ignore_foreign_route_tables, UINT32_TO_PTR(route->table)))
+                return true;
+
+        return false;
+}
+
 static int process_route_one(
                 Manager *manager,
                 uint16_t type,
@@ -1024,14 +1073,23 @@ static int process_route_one(
         (void) route_get_request(manager, tmp, &req);
         (void) route_get_link(manager, tmp, &link);
 
+        /* Requests may wait for a gateway to become reachable through this route. */
+        if (link)
+                link_wakeup_requests(link);
+        else
+                manager_wakeup_requests(manager);
+
+        manager_invalidate_link_json(manager, tmp->nexthop.ifindex);
+
         update_dhcp4 = link && tmp->family == AF_INET6 && tmp->dst_prefixlen == 0;
 
         switch (type) {
         case RTM_NEWROUTE:
                 if (!route) {
-                        if (!manager->manage_foreign_routes && !(req && req->waiting_reply)) {
+                        if (!(req && req->waiting_reply) && route_is_ignored_foreign(manager, tmp)) {
                                 route_enter_configured(tmp);
                                 log_route_debug(tmp, "Ignoring received", manager);
+                                manager->n_foreign_routes_ignored++;
                                 return 0;
                         }
 
@@ -1072,7 +1130,7 @@ static int process_route_one(
                         route_detach(route);
                 } else
                         log_route_debug(tmp,
-                                        manager->manage_foreign_routes ? "Kernel removed unknown" : "Ignoring received",
+                                        route_is_ignored_foreign(manager, tmp) ? "Ignoring received" : "Kernel removed unknown",
                                         manager);
 
                 if (req)
@@ -1095,11 +1153,10 @@ static int process_route_one(
         return 1;
 }
 
-int manager_rtnl_process_route(sd_netlink *rtnl, sd_netlink_message *message, Manager *m) {
+static int process_route(sd_netlink_message *message, Manager *m) {
         _cleanup_(route_unrefp) Route *tmp = NULL;
         int r;
 
-        assert(rtnl);
         assert(message);
         assert(m);
 
@@ -1257,6 +1314,42 @@ int manager_rtnl_process_route(sd_netlink *rtnl, sd_netlink_message *message, Ma
         return 1;
 }
 
+int manager_rtnl_process_route(sd_netlink *rtnl, sd_netlink_message *message, Manager *m) {
+        usec_t start;
+        int r;
+
+        assert(rtnl);
+        assert(message);
+        assert(m);
+
+        start = now(CLOCK_MONOTONIC);
+
+        r = process_route(message, m);
+
+        m->n_route_messages++;
+        m->route_processing_usec += usec_sub_unsigned(now(CLOCK_MONOTONIC), start);
+
+        return r;
+}
+
+size_t manager_routes_memory(Manager *manager) {
+        size_t n = 0;
+        Route *route;
+
+        assert(manager);
+
+        /* An estimate of the memory used for the routes we remember, without the overhead of the hash
+         * table and of the allocator. */
+
+        SET_FOREACH(route, manager->routes)
+                n += sizeof(Route) +
+                        ordered_set_size(route->nexthops) * sizeof(RouteNextHop) +
+                        route->metric.n_metrics * sizeof(uint32_t) +
+                        strlen_ptr(route->metric.tcp_congestion_control_algo);
+
+        return n;
+}
+
 void manager_mark_routes(Manager *manager, Link *link, NetworkConfigSource source) {
         Route *route;
 
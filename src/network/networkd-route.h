@@ -117,6 +117,7 @@ int link_request_route(
 int link_request_static_routes(Link *link, bool only_ipv4);
 
 int manager_rtnl_process_route(sd_netlink *rtnl, sd_netlink_message *message, Manager *m);
+size_t manager_routes_memory(Manager *manager);
 
 int network_add_ipv4ll_route(Network *network);
 int network_add_default_route_on_device(Network *network);
@@ -11,6 +11,7 @@
 #include "fs-util.h"
 #include "network-internal.h"
 #include "networkd-dhcp-common.h"
+#include "networkd-json.h"
 #include "networkd-link.h"
 #include "networkd-manager-bus.h"
 #include "networkd-manager.h"
@@ -828,6 +829,8 @@ void link_dirty(Link *link) {
         /* Also mark manager dirty as link is dirty */
         link->manager->dirty = true;
 
+        link_invalidate_json(link);
+
         r = set_ensure_put(&link->manager->dirty_links, NULL, link);
         if (r <= 0)
                 /* Ignore allocation errors and don't take another ref if the link was already dirty */
@@ -850,6 +853,8 @@ int link_save_and_clean_full(Link *link, bool also_save_manager) {
         assert(link);
         assert(link->manager);
 
+        link_invalidate_json(link);
+
         if (also_save_manager)
                 k = manager_save(link->manager);
 
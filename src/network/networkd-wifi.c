@@ -5,6 +5,7 @@
 
 #include "ether-addr-util.h"
 #include "netlink-util.h"
+#include "networkd-json.h"
 #include "networkd-link.h"
 #include "networkd-manager.h"
 #include "networkd-wifi.h"
@@ -108,6 +109,8 @@ int manager_genl_process_nl80211_config(sd_netlink *genl, sd_netlink_message *me
                 return 0;
         }
 
+        link_invalidate_json(link);
+
         r = sd_netlink_message_read_string(message, NL80211_ATTR_IFNAME, &ifname);
         if (r < 0) {
                 log_link_debug_errno(link, r, "nl80211: received %s(%u) message without valid interface name, ignoring: %m",
@@ -216,6 +219,8 @@ int manager_genl_process_nl80211_mlme(sd_netlink *genl, sd_netlink_message *mess
                 return 0;
         }
 
+        link_invalidate_json(link);
+
         switch (cmd) {
         case NL80211_CMD_NEW_STATION:
         case NL80211_CMD_DEL_STATION: {
@@ -262,6 +262,26 @@ static void log_qdisc_debug(QDisc *qdisc, Link *link, const char *str) {
                        strna(qdisc_get_tca_kind(qdisc)));
 }
 
+static bool qdisc_is_classless(const QDisc *qdisc) {
+        assert(qdisc);
+
+        /* These do not implement class operations in the kernel, hence no class can be attached to them. */
+        return STRPTR_IN_SET(qdisc_get_tca_kind(qdisc),
+                             "noqueue", "noop", "blackhole", "pfifo_fast", "pfifo", "bfifo", "pfifo_head_drop");
+}
+
+bool link_has_classful_qdisc(Link *link) {
+        QDisc *qdisc;
+
+        assert(link);
+
+        SET_FOREACH(qdisc, link->qdiscs)
+                if (!qdisc_is_classless(qdisc))
+                        return true;
+
+        return false;
+}
+
 int link_find_qdisc(Link *link, uint32_t handle, const char *kind, QDisc **ret) {
         QDisc *qdisc;
 
@@ -560,7 +580,7 @@ int manager_rtnl_process_qdisc(sd_netlink *rtnl, sd_netlink_message *message, Ma
                         qdisc = TAKE_PTR(tmp);
                 }
 
-                if (!m->enumerating) {
+                if (!m->enumerating && !qdisc_is_classless(qdisc)) {
                         /* Some kind of QDisc (e.g. tbf) also create an implicit class under the qdisc, but
                          * the kernel may not notify about the class. Hence, we need to enumerate classes. */
                         r = link_enumerate_tclass(link, qdisc->handle);
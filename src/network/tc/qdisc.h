@@ -82,6 +82,7 @@ QDisc* qdisc_drop(QDisc *qdisc);
 void link_qdisc_drop_marked(Link *link);
 
 int link_find_qdisc(Link *link, uint32_t handle, const char *kind, QDisc **qdisc);
+bool link_has_classful_qdisc(Link *link);
 
 int link_request_qdisc(Link *link, QDisc *qdisc);
 
@@ -163,6 +163,29 @@ static void test_route_tables(Manager *manager) {
         test_route_tables_one(manager, "local", 255);
 }
 
+static void test_ignore_foreign_routes(Manager *manager) {
+        assert_se(config_parse_route_table_names("manager", "filename", 1, "section", 1, "RouteTable", 0, "hoge:123", manager, manager) >= 0);
+
+        assert_se(config_parse_ignore_foreign_routes("manager", "filename", 1, "section", 1, "IgnoreForeignRouteProtocols", true, "bgp zebra 99 0 foo 256", &manager->ignore_foreign_route_protocols, manager) >= 0);
+        assert_se(set_size(manager->ignore_foreign_route_protocols) == 3);
+        assert_se(set_contains(manager->ignore_foreign_route_protocols, UINT32_TO_PTR(RTPROT_BGP)));
+        assert_se(set_contains(manager->ignore_foreign_route_protocols, UINT32_TO_PTR(RTPROT_ZEBRA)));
+        assert_se(set_contains(manager->ignore_foreign_route_protocols, UINT32_TO_PTR(99)));
+
+        assert_se(config_parse_ignore_foreign_routes("manager", "filename", 1, "section", 1, "IgnoreForeignRouteTables", false, "main hoge 1000 0 bar", &manager->ignore_foreign_route_tables, manager) >= 0);
+        assert_se(set_size(manager->ignore_foreign_route_tables) == 3);
+        assert_se(set_contains(manager->ignore_foreign_route_tables, UINT32_TO_PTR(RT_TABLE_MAIN)));
+        assert_se(set_contains(manager->ignore_foreign_route_tables, UINT32_TO_PTR(123)));
+        assert_se(set_contains(manager->ignore_foreign_route_tables, UINT32_TO_PTR(1000)));
+
+        assert_se(config_parse_ignore_foreign_routes("manager", "filename", 1, "section", 1, "IgnoreForeignRouteProtocols", true, "", &manager->ignore_foreign_route_protocols, manager) >= 0);
+        assert_se(!manager->ignore_foreign_route_protocols);
+        assert_se(config_parse_ignore_foreign_routes("manager", "filename", 1, "section", 1, "IgnoreForeignRouteTables", false, "", &manager->ignore_foreign_route_tables, manager) >= 0);
+        assert_se(!manager->ignore_foreign_route_tables);
+
+        assert_se(config_parse_route_table_names("manager", "filename", 1, "section", 1, "RouteTable", 0, "", manager, manager) >= 0);
+}
+
 static int test_load_config(Manager *manager) {
         int r;
 /*  TODO: should_reload, is false if the config dirs do not exist, so
@@ -239,6 +262,7 @@ int main(void) {
         assert_se(manager_setup(manager) >= 0);
 
         test_route_tables(manager);
+        test_ignore_foreign_routes(manager);
 
         r = test_load_config(manager);
         if (r == -EPERM)
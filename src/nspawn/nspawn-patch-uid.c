@@ -3,16 +3,21 @@
 #include <fcntl.h>
 #include <sys/statvfs.h>
 #include <sys/vfs.h>
+#include <sys/xattr.h>
 #include <unistd.h>
 
 #include "acl-util.h"
+#include "alloc-util.h"
+#include "cpu-set-util.h"
 #include "dirent-util.h"
+#include "errno-util.h"
 #include "fd-util.h"
 #include "fileio.h"
 #include "fs-util.h"
 #include "missing_magic.h"
 #include "nspawn-def.h"
 #include "nspawn-patch-uid.h"
+#include "process-util.h"
 #include "stat-util.h"
 #include "stdio-util.h"
 #include "string-util.h"
@@ -21,6 +26,32 @@
 
 #if HAVE_ACL
 
+static int has_acl(int fd, const char *name, acl_type_t type) {
+        const char *xattr;
+        ssize_t n;
+
+        assert(fd >= 0);
+
+        /* Most inodes have no ACL, i.e. no ACL xattr at all. Checking for that is a lot cheaper than
+         * acl_get_file(), which needs an fd of its own for the inode, and synthesizes an ACL from the
+         * access mode in that case. */
+
+        xattr = type == ACL_TYPE_ACCESS ? "system.posix_acl_access" : "system.posix_acl_default";
+
+        if (name)
+                n = lgetxattr(strjoina(FORMAT_PROC_FD_PATH(fd), "/", name), xattr, NULL, 0);
+        else
+                n = fgetxattr(fd, xattr, NULL, 0);
+        if (n < 0) {
+                if (errno == ENODATA || ERRNO_IS_NOT_SUPPORTED(errno))
+                        return false;
+
+                return -errno;
+        }
+
+        return true;
+}
+
 static int get_acl(int fd, const char *name, acl_type_t type, acl_t *ret) {
         acl_t acl;
 
@@ -162,31 +193,40 @@ static int patch_acls(int fd, const char *name, const struct stat *st, uid_t shi
         if (S_ISLNK(st->st_mode))
                 return 0;
 
-        r = get_acl(fd, name, ACL_TYPE_ACCESS, &acl);
-        if (r == -EOPNOTSUPP)
-                return 0;
-        if (r < 0)
-                return r;
-
-        r = shift_acl(acl, shift, &shifted);
+        r = has_acl(fd, name, ACL_TYPE_ACCESS);
         if (r < 0)
                 return r;
         if (r > 0) {
-                r = set_acl(fd, name, ACL_TYPE_ACCESS, shifted);
+                r = get_acl(fd, name, ACL_TYPE_ACCESS, &acl);
+                if (r == -EOPNOTSUPP)
+                        return 0;
                 if (r < 0)
                         return r;
 
-                changed = true;
+                r = shift_acl(acl, shift, &shifted);
+                if (r < 0)
+                        return r;
+                if (r > 0) {
+                        r = set_acl(fd, name, ACL_TYPE_ACCESS, shifted);
+                        if (r < 0)
+                                return r;
+
+                        changed = true;
+                }
         }
 
         if (S_ISDIR(st->st_mode)) {
-                acl_free(acl);
-
+                if (acl)
+                        acl_free(acl);
                 if (shifted)
                         acl_free(shifted);
 
                 acl = shifted = NULL;
 
+                r = has_acl(fd, name, ACL_TYPE_DEFAULT);
+                if (r <= 0)
+                        return r < 0 ? r : changed;
+
                 r = get_acl(fd, name, ACL_TYPE_DEFAULT, &acl);
                 if (r < 0)
                         return r;
@@ -286,12 +326,113 @@ static int is_fs_fully_userns_compatible(const struct statfs *sfs) {
                F_TYPE_EQUAL(sfs->f_type, SYSFS_MAGIC);
 }
 
-static int recurse_fd(int fd, bool donate_fd, const struct stat *st, uid_t shift, bool is_toplevel) {
+/* The subtrees of the directories right below the top-level directory, e.g. usr/lib/ or usr/share/, are
+ * patched by up to this many worker processes in parallel. */
+#define PATCH_WORKERS_MAX 16U
+
+/* Exit status of a worker that changed something. Failures are passed on as errno, which are smaller. */
+#define PATCH_WORKER_CHANGED 255
+
+typedef struct PatchContext {
+        uid_t shift;
+
+        pid_t *workers;
+        size_t n_workers;
+        size_t n_workers_max;
+} PatchContext;
+
+static void patch_context_done(PatchContext *c) {
+        assert(c);
+
+        /* All workers have been reaped by the time the top-level directory is done */
+        assert(c->n_workers == 0);
+
+        c->workers = mfree(c->workers);
+}
+
+static int reap_worker(PatchContext *c) {
+        pid_t pid;
+        int r;
+
+        assert(c);
+        assert(c->n_workers > 0);
+
+        /* Waits for the oldest one, which is the most likely one to be done */
+        pid = c->workers[0];
+        memmove(c->workers, c->workers + 1, --c->n_workers * sizeof(pid_t));
+
+        r = wait_for_terminate_and_check("(sd-patch-uid)", pid, WAIT_LOG_ABNORMAL);
+        if (r < 0)
+                return r;
+        if (r == PATCH_WORKER_CHANGED)
+                return 1;
+        if (r != EXIT_SUCCESS)
+                return -r;
+
+        return 0;
+}
+
+static int reap_workers(PatchContext *c) {
+        bool changed = false;
+        int r = 0;
+
+        assert(c);
+
+        while (c->n_workers > 0) {
+                int k;
+
+                k = reap_worker(c);
+                if (k < 0 && r >= 0)
+                        r = k;
+                if (k > 0)
+                        changed = true;
+        }
+
+        return r < 0 ? r : changed;
+}
+
+static int recurse_fd(PatchContext *c, int fd, bool donate_fd, const struct stat *st, unsigned depth);
+
+static int fork_worker(PatchContext *c, int fd, const struct stat *st, unsigned depth) {
+        _cleanup_close_ int fd_close = fd;
+        bool changed = false;
+        pid_t pid;
+        int r;
+
+        assert(c);
+        assert(fd >= 0);
+        assert(st);
+
+        if (c->n_workers >= c->n_workers_max) {
+                r = reap_worker(c);
+                if (r < 0)
+                        return r;
+                if (r > 0)
+                        changed = true;
+        }
+
+        r = safe_fork("(sd-patch-uid)", FORK_RESET_SIGNALS|FORK_DEATHSIG_SIGTERM|FORK_LOG, &pid);
+        if (r < 0)
+                return r;
+        if (r == 0) {
+                /* Child, the other workers are not ours to wait for */
+                c->n_workers = 0;
+
+                r = recurse_fd(c, TAKE_FD(fd_close), true, st, depth);
+                _exit(r < 0 ? -r : r > 0 ? PATCH_WORKER_CHANGED : EXIT_SUCCESS);
+        }
+
+        c->workers[c->n_workers++] = pid;
+        return changed;
+}
+
+static int recurse_fd(PatchContext *c, int fd, bool donate_fd, const struct stat *st, unsigned depth) {
         _cleanup_closedir_ DIR *d = NULL;
         bool changed = false;
         struct statfs sfs;
         int r;
 
+        assert(c);
         assert(fd >= 0);
 
         if (fstatfs(fd, &sfs) < 0)
@@ -355,14 +496,20 @@ static int recurse_fd(int fd, bool donate_fd, const struct stat *st, uid_t shift
 
                                 }
 
-                                r = recurse_fd(subdir_fd, true, &fst, shift, false);
+                                /* Only the process that walks the top-level directory forks workers,
+                                 * hence the workers are done with a directory before its parent is
+                                 * patched. */
+                                if (depth == 1 && c->n_workers_max > 1)
+                                        r = fork_worker(c, subdir_fd, &fst, depth + 1);
+                                else
+                                        r = recurse_fd(c, subdir_fd, true, &fst, depth + 1);
                                 if (r < 0)
                                         goto finish;
                                 if (r > 0)
                                         changed = true;
 
                         } else {
-                                r = patch_fd(dirfd(d), de->d_name, &fst, shift);
+                                r = patch_fd(dirfd(d), de->d_name, &fst, c->shift);
                                 if (r < 0)
                                         goto finish;
                                 if (r > 0)
@@ -371,10 +518,16 @@ static int recurse_fd(int fd, bool donate_fd, const struct stat *st, uid_t shift
                 }
         }
 
+        r = reap_workers(c);
+        if (r < 0)
+                goto finish;
+        if (r > 0)
+                changed = true;
+
         /* After we descended, also patch the directory itself. It's key to do this in this order so that the top-level
          * directory is patched as very last object in the tree, so that we can use it as quick indicator whether the
          * tree is properly chown()ed already. */
-        r = patch_fd(d ? dirfd(d) : fd, NULL, st, shift);
+        r = patch_fd(d ? dirfd(d) : fd, NULL, st, c->shift);
         if (r == -EROFS)
                 goto read_only;
         if (r > 0)
@@ -384,7 +537,7 @@ static int recurse_fd(int fd, bool donate_fd, const struct stat *st, uid_t shift
         goto finish;
 
 read_only:
-        if (!is_toplevel) {
+        if (depth > 0) {
                 _cleanup_free_ char *name = NULL;
 
                 /* When we hit a ready-only subtree we simply skip it, but log about it. */
@@ -394,12 +547,32 @@ read_only:
         }
 
 finish:
+        /* Don't leave workers behind on failure */
+        (void) reap_workers(c);
+
         if (donate_fd)
                 safe_close(fd);
 
         return r;
 }
 
+static int recurse_fd_toplevel(int fd, bool donate_fd, const struct stat *st, uid_t shift) {
+        _cleanup_(patch_context_done) PatchContext c = {
+                .shift = shift,
+        };
+        int n;
+
+        n = cpus_in_affinity_mask();
+        if (n > 1) {
+                c.n_workers_max = MIN((unsigned) n, PATCH_WORKERS_MAX);
+                c.workers = new(pid_t, c.n_workers_max);
+                if (!c.workers) /* Do without */
+                        c.n_workers_max = 0;
+        }
+
+        return recurse_fd(&c, fd, donate_fd, st, 0);
+}
+
 static int fd_patch_uid_internal(int fd, bool donate_fd, uid_t shift, uid_t range) {
         struct stat st;
         int r;
@@ -457,7 +630,7 @@ static int fd_patch_uid_internal(int fd, bool donate_fd, uid_t shift, uid_t rang
                 }
         }
 
-        return recurse_fd(fd, donate_fd, &st, shift, true);
+        return recurse_fd_toplevel(fd, donate_fd, &st, shift);
 
 finish:
         if (donate_fd)
@@ -5,6 +5,7 @@
 #include <nss.h>
 #include <pthread.h>
 #include <stdlib.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
@@ -15,12 +16,47 @@
 #include "json-util.h"
 #include "macro.h"
 #include "nss-util.h"
+#include "pthread-util.h"
 #include "resolved-def.h"
 #include "signal-util.h"
+#include "stat-util.h"
 #include "string-util.h"
 #include "strv.h"
+#include "time-util.h"
 #include "varlink.h"
 
+/* Connections to systemd-resolved are kept around between lookups, so that programs doing many lookups
+ * don't pay for a connect() each time. A connection can only carry one call at a time, hence keep a few
+ * of them, so that concurrently resolving threads don't have to wait for each other. Not too many though,
+ * since every process with this module loaded might keep that many connected, and resolved limits the number
+ * of connections per UID. */
+#define LINK_POOL_MAX 4U
+
+/* Successful replies may optionally be cached locally, bounded by the TTL resolved returned, as well as by
+ * this, so that we never hold on to stale data for long, and changes in resolved propagate quickly. */
+#define ANSWER_CACHE_MAX 16U
+#define ANSWER_CACHE_USEC_MAX (5 * USEC_PER_SEC)
+
+typedef struct CachedAnswer {
+        char *key;
+        char *reply;
+        usec_t received;
+        usec_t until;
+        uint32_t ttl;
+} CachedAnswer;
+
+typedef struct PooledLink {
+        Varlink *link;
+        struct stat st;
+} PooledLink;
+
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static PooledLink link_pool[LINK_POOL_MAX] = {};
+static size_t link_pool_n = 0;
+static CachedAnswer answer_cache[ANSWER_CACHE_MAX] = {};
+static size_t answer_cache_next = 0;
+static bool pool_usable = false, pool_stale = false;
+
 static sd_json_dispatch_flags_t json_dispatch_flags = SD_JSON_ALLOW_EXTENSIONS;
 
 static void setup_logging(void) {
@@ -35,9 +71,35 @@ static void setup_logging_once(void) {
         assert_se(pthread_once(&once, setup_logging) == 0);
 }
 
+static void pool_atfork_prepare(void) {
+        assert_se(pthread_mutex_lock(&pool_mutex) == 0);
+}
+
+static void pool_atfork_parent(void) {
+        assert_se(pthread_mutex_unlock(&pool_mutex) == 0);
+}
+
+static void pool_atfork_child(void) {
+        /* The connections are shared with the parent now, don't use them here. They are released on the
+         * next lookup, rather than in here, so that we don't do any real work between fork() and exec(). */
+        pool_stale = true;
+        assert_se(pthread_mutex_unlock(&pool_mutex) == 0);
+}
+
+static void setup_pool(void) {
+        /* If we can't make sure the pool is dropped in child processes, don't keep connections around */
+        pool_usable = pthread_atfork(pool_atfork_prepare, pool_atfork_parent, pool_atfork_child) == 0;
+}
+
+static void setup_pool_once(void) {
+        static pthread_once_t once = PTHREAD_ONCE_INIT;
+        assert_se(pthread_once(&once, setup_pool) == 0);
+}
+
 #define NSS_ENTRYPOINT_BEGIN                    \
         BLOCK_SIGNALS(NSS_SIGNALS_BLOCK);       \
-        setup_logging_once()
+        setup_logging_once();                   \
+        setup_pool_once()
 
 NSS_GETHOSTBYNAME_PROTOTYPES(resolve);
 NSS_GETHOSTBYADDR_PROTOTYPES(resolve);
@@ -81,6 +143,302 @@ static int connect_to_resolved(Varlink **ret) {
         return 0;
 }
 
+static void cached_answer_done(CachedAnswer *a) {
+        assert(a);
+
+        a->key = mfree(a->key);
+        a->reply = mfree(a->reply);
+}
+
+static void pool_flush_stale_unlocked(void) {
+        if (!pool_stale)
+                return;
+
+        FOREACH_ARRAY(l, link_pool, link_pool_n)
+                l->link = varlink_unref(l->link);
+        link_pool_n = 0;
+
+        FOREACH_ELEMENT(a, answer_cache)
+                cached_answer_done(a);
+
+        pool_stale = false;
+}
+
+static int link_stat(Varlink *link, struct stat *ret) {
+        int fd;
+
+        fd = varlink_get_fd(link);
+        if (fd < 0)
+                return fd;
+
+        return RET_NERRNO(fstat(fd, ret));
+}
+
+static int acquire_link(Varlink **ret, bool *ret_pooled) {
+        assert(ret);
+        assert(ret_pooled);
+
+        while (pool_usable) {
+                PooledLink l;
+
+                {
+                        _cleanup_(pthread_mutex_unlock_assertp) pthread_mutex_t *_l = pthread_mutex_lock_assert(&pool_mutex);
+
+                        pool_flush_stale_unlocked();
+
+                        if (link_pool_n == 0)
+                                break;
+
+                        l = link_pool[--link_pool_n];
+                }
+
+                /* Programs might close all fds behind our back (for example via close_range()), and reuse
+                 * the fd number for something else. Check that this is still the socket we connected, and if
+                 * not, forget about the connection without closing the fd, as it is not ours anymore. */
+                struct stat st;
+                if (link_stat(l.link, &st) < 0 || !stat_inode_same(&st, &l.st)) {
+                        log_debug("Pooled connection to systemd-resolved was closed behind our back, not using it.");
+                        TAKE_PTR(l.link);
+                        continue;
+                }
+
+                *ret = l.link;
+                *ret_pooled = true;
+                return 0;
+        }
+
+        *ret_pooled = false;
+        return connect_to_resolved(ret);
+}
+
+static Varlink* release_link(Varlink *link) {
+        struct stat st;
+
+        if (!link)
+                return NULL;
+
+        if (pool_usable && link_stat(link, &st) >= 0) {
+                _cleanup_(pthread_mutex_unlock_assertp) pthread_mutex_t *_l = pthread_mutex_lock_assert(&pool_mutex);
+
+                pool_flush_stale_unlocked();
+
+                if (link_pool_n < LINK_POOL_MAX) {
+                        link_pool[link_pool_n++] = (PooledLink) {
+                                .link = link,
+                                .st = st,
+                        };
+                        return NULL;
+                }
+        }
+
+        return varlink_unref(link);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(Varlink*, release_link);
+
+static bool answer_cache_enabled(uint64_t flags) {
+        int r;
+
+        if (!pool_usable || FLAGS_SET(flags, SD_RESOLVED_NO_CACHE))
+                return false;
+
+        r = secure_getenv_bool("SYSTEMD_NSS_RESOLVE_LOCAL_CACHE");
+        if (r < 0 && r != -ENXIO)
+                log_debug_errno(r, "Failed to parse $SYSTEMD_NSS_RESOLVE_LOCAL_CACHE, ignoring.");
+
+        return r > 0;
+}
+
+static int answer_cache_get(const char *key, sd_json_variant **ret, uint32_t *ret_ttl) {
+        _cleanup_free_ char *text = NULL;
+        uint32_t ttl = 0;
+
+        assert(key);
+        assert(ret);
+        assert(ret_ttl);
+
+        /* Replies are stored in formatted form, and parsed again for each hit, so that every thread gets its
+         * own copy: JSON variants are not reference counted atomically. */
+
+        {
+                _cleanup_(pthread_mutex_unlock_assertp) pthread_mutex_t *_l = pthread_mutex_lock_assert(&pool_mutex);
+                usec_t n = now(CLOCK_MONOTONIC);
+
+                pool_flush_stale_unlocked();
+
+                FOREACH_ELEMENT(a, answer_cache) {
+                        if (!streq_ptr(a->key, key))
+                                continue;
+
+                        if (n >= a->until) {
+                                cached_answer_done(a);
+                                return 0;
+                        }
+
+                        text = strdup(a->reply);
+                        if (!text)
+                                return -ENOMEM;
+
+                        /* Report the time that is left, as resolved would */
+                        ttl = a->ttl - (uint32_t) MIN((n - a->received) / USEC_PER_SEC, (usec_t) a->ttl);
+                        break;
+                }
+        }
+
+        if (!text)
+                return 0;
+
+        if (sd_json_parse(text, 0, ret, NULL, NULL) < 0)
+                return 0;
+
+        *ret_ttl = ttl;
+        return 1;
+}
+
+static void answer_cache_put(const char *key, sd_json_variant *reply, uint32_t ttl) {
+        _cleanup_free_ char *k = NULL, *text = NULL;
+        CachedAnswer *a = NULL;
+        usec_t n;
+
+        assert(key);
+        assert(reply);
+
+        if (ttl == 0)
+                return;
+
+        k = strdup(key);
+        if (!k)
+                return;
+
+        if (sd_json_variant_format(reply, 0, &text) < 0)
+                return;
+
+        _cleanup_(pthread_mutex_unlock_assertp) pthread_mutex_t *_l = pthread_mutex_lock_assert(&pool_mutex);
+
+        pool_flush_stale_unlocked();
+
+        /* Replace an older entry for the same key if there is one, and the oldest entry otherwise */
+        FOREACH_ELEMENT(i, answer_cache)
+                if (streq_ptr(i->key, key)) {
+                        a = i;
+                        break;
+                }
+        if (!a) {
+                a = answer_cache + answer_cache_next;
+                answer_cache_next = (answer_cache_next + 1) % ANSWER_CACHE_MAX;
+        }
+
+        cached_answer_done(a);
+
+        n = now(CLOCK_MONOTONIC);
+        *a = (CachedAnswer) {
+                .key = TAKE_PTR(k),
+                .reply = TAKE_PTR(text),
+                .received = n,
+                .until = usec_add(n, MIN((usec_t) ttl * USEC_PER_SEC, ANSWER_CACHE_USEC_MAX)),
+                .ttl = ttl,
+        };
+}
+
+static uint32_t reply_ttl(sd_json_variant *reply) {
+        sd_json_variant *v;
+
+        /* Older versions of resolved don't tell us the TTL, treat that as "don't cache" */
+        v = sd_json_variant_by_key(reply, "ttl");
+        if (!v || !sd_json_variant_is_unsigned(v))
+                return 0;
+
+        return (uint32_t) MIN(sd_json_variant_unsigned(v), (uint64_t) UINT32_MAX);
+}
+
+static int resolve_call(
+                const char *method,
+                sd_json_variant *cparams,
+                uint64_t flags,
+                Varlink **ret_link,
+                sd_json_variant **ret_rparams,
+                const char **ret_error_id,
+                uint32_t *ret_ttl) {
+
+        _cleanup_(release_linkp) Varlink *link = NULL;
+        _cleanup_free_ char *key = NULL;
+        sd_json_variant *rparams;
+        const char *error_id;
+        bool use_cache;
+        int r;
+
+        assert(method);
+        assert(cparams);
+        assert(ret_link);
+        assert(ret_rparams);
+        assert(ret_error_id);
+        assert(ret_ttl);
+
+        /* Issues a call to resolved, on a pooled connection if there is one. The reply parameters and error
+         * ID are owned by the returned connection, which has to be released with release_link() only after
+         * they are not needed anymore. Replies from the local cache are returned with a NULL connection,
+         * and a reference the caller owns. Either way, the caller has to unref the reply parameters. */
+
+        use_cache = answer_cache_enabled(flags);
+        if (use_cache) {
+                _cleanup_free_ char *j = NULL;
+
+                r = sd_json_variant_format(cparams, 0, &j);
+                if (r < 0)
+                        return r;
+
+                key = strjoin(method, " ", j);
+                if (!key)
+                        return -ENOMEM;
+
+                r = answer_cache_get(key, ret_rparams, ret_ttl);
+                if (r < 0)
+                        return r;
+                if (r > 0) {
+                        *ret_link = NULL;
+                        *ret_error_id = NULL;
+                        return 0;
+                }
+        }
+
+        for (unsigned attempt = 0;; attempt++) {
+                bool pooled;
+
+                r = acquire_link(&link, &pooled);
+                if (r < 0)
+                        return r;
+
+                r = varlink_call(link, method, cparams, &rparams, &error_id);
+                if (r >= 0)
+                        break;
+
+                /* Transport failures leave the connection unusable, don't return it to the pool */
+                link = varlink_unref(link);
+
+                /* A pooled connection might have been closed by resolved in the meantime (for example because
+                 * it was restarted), in which case try again once, with a fresh connection. */
+                if (!pooled || attempt > 0)
+                        return r;
+
+                log_debug_errno(r, "Pooled connection to systemd-resolved failed, reconnecting: %m");
+        }
+
+        if (!isempty(error_id)) {
+                *ret_rparams = NULL;
+                *ret_ttl = 0;
+        } else {
+                *ret_rparams = sd_json_variant_ref(rparams);
+                *ret_ttl = reply_ttl(rparams);
+
+                if (use_cache)
+                        answer_cache_put(key, rparams, *ret_ttl);
+        }
+
+        *ret_error_id = error_id;
+        *ret_link = TAKE_PTR(link);
+        return 0;
+}
+
 static uint32_t ifindex_to_scopeid(int family, const void *a, int ifindex) {
         struct in6_addr in6;
 
@@ -232,10 +590,12 @@ enum nss_status _nss_resolve_gethostbyname4_r(
                 int *errnop, int *h_errnop,
                 int32_t *ttlp) {
 
-        _cleanup_(varlink_unrefp) Varlink *link = NULL;
-        _cleanup_(sd_json_variant_unrefp) sd_json_variant *cparams = NULL;
+        _cleanup_(release_linkp) Varlink *link = NULL;
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *cparams = NULL, *rparams = NULL;
         _cleanup_(resolve_hostname_reply_destroy) ResolveHostnameReply p = {};
-        sd_json_variant *rparams, *entry;
+        sd_json_variant *entry;
+        uint64_t flags;
+        uint32_t ttl;
         int r;
 
         PROTECT_ERRNO;
@@ -247,14 +607,12 @@ enum nss_status _nss_resolve_gethostbyname4_r(
         assert(errnop);
         assert(h_errnop);
 
-        r = connect_to_resolved(&link);
-        if (r < 0)
-                goto fail;
+        flags = query_flags();
 
         r = sd_json_buildo(
                         &cparams,
                         SD_JSON_BUILD_PAIR("name", SD_JSON_BUILD_STRING(name)),
-                        SD_JSON_BUILD_PAIR("flags", SD_JSON_BUILD_UNSIGNED(query_flags())));
+                        SD_JSON_BUILD_PAIR("flags", SD_JSON_BUILD_UNSIGNED(flags)));
         if (r < 0)
                 goto fail;
 
@@ -264,7 +622,7 @@ enum nss_status _nss_resolve_gethostbyname4_r(
          * configuration can distinguish such executed but negative replies from complete failure to
          * talk to resolved). */
         const char *error_id;
-        r = varlink_call(link, "io.systemd.Resolve.ResolveHostname", cparams, &rparams, &error_id);
+        r = resolve_call("io.systemd.Resolve.ResolveHostname", cparams, flags, &link, &rparams, &error_id, &ttl);
         if (r < 0)
                 goto fail;
         if (!isempty(error_id)) {
@@ -353,7 +711,7 @@ enum nss_status _nss_resolve_gethostbyname4_r(
                 *pat = r_tuple_first;
 
         if (ttlp)
-                *ttlp = 0;
+                *ttlp = (int32_t) MIN(ttl, (uint32_t) INT32_MAX);
 
         /* Explicitly reset both *h_errnop and h_errno to work around
          * https://bugzilla.redhat.com/show_bug.cgi?id=1125975 */
@@ -392,10 +750,12 @@ enum nss_status _nss_resolve_gethostbyname3_r(
                 int32_t *ttlp,
                 char **canonp) {
 
-        _cleanup_(varlink_unrefp) Varlink *link = NULL;
-        _cleanup_(sd_json_variant_unrefp) sd_json_variant *cparams = NULL;
+        _cleanup_(release_linkp) Varlink *link = NULL;
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *cparams = NULL, *rparams = NULL;
         _cleanup_(resolve_hostname_reply_destroy) ResolveHostnameReply p = {};
-        sd_json_variant *rparams, *entry;
+        sd_json_variant *entry;
+        uint64_t flags;
+        uint32_t ttl;
         int r;
 
         PROTECT_ERRNO;
@@ -415,20 +775,18 @@ enum nss_status _nss_resolve_gethostbyname3_r(
                 goto fail;
         }
 
-        r = connect_to_resolved(&link);
-        if (r < 0)
-                goto fail;
+        flags = query_flags();
 
         r = sd_json_buildo(
                         &cparams,
                         SD_JSON_BUILD_PAIR("name", SD_JSON_BUILD_STRING(name)),
                         SD_JSON_BUILD_PAIR("family", SD_JSON_BUILD_INTEGER(af)),
-                        SD_JSON_BUILD_PAIR("flags", SD_JSON_BUILD_UNSIGNED(query_flags())));
+                        SD_JSON_BUILD_PAIR("flags", SD_JSON_BUILD_UNSIGNED(flags)));
         if (r < 0)
                 goto fail;
 
         const char *error_id;
-        r = varlink_call(link, "io.systemd.Resolve.ResolveHostname", cparams, &rparams, &error_id);
+        r = resolve_call("io.systemd.Resolve.ResolveHostname", cparams, flags, &link, &rparams, &error_id, &ttl);
         if (r < 0)
                 goto fail;
         if (!isempty(error_id)) {
@@ -533,7 +891,7 @@ enum nss_status _nss_resolve_gethostbyname3_r(
         result->h_addr_list = (char**) r_addr_list;
 
         if (ttlp)
-                *ttlp = 0;
+                *ttlp = (int32_t) MIN(ttl, (uint32_t) INT32_MAX);
 
         if (canonp)
                 *canonp = r_name;
@@ -608,10 +966,12 @@ enum nss_status _nss_resolve_gethostbyaddr2_r(
                 int *errnop, int *h_errnop,
                 int32_t *ttlp) {
 
-        _cleanup_(varlink_unrefp) Varlink *link = NULL;
-        _cleanup_(sd_json_variant_unrefp) sd_json_variant *cparams = NULL;
+        _cleanup_(release_linkp) Varlink *link = NULL;
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *cparams = NULL, *rparams = NULL;
         _cleanup_(resolve_address_reply_destroy) ResolveAddressReply p = {};
-        sd_json_variant *rparams, *entry;
+        sd_json_variant *entry;
+        uint64_t flags;
+        uint32_t ttl;
         int r;
 
         PROTECT_ERRNO;
@@ -635,20 +995,18 @@ enum nss_status _nss_resolve_gethostbyaddr2_r(
                 goto fail;
         }
 
-        r = connect_to_resolved(&link);
-        if (r < 0)
-                goto fail;
+        flags = query_flags();
 
         r = sd_json_buildo(
                         &cparams,
                         SD_JSON_BUILD_PAIR("address", SD_JSON_BUILD_BYTE_ARRAY(addr, len)),
                         SD_JSON_BUILD_PAIR("family", SD_JSON_BUILD_INTEGER(af)),
-                        SD_JSON_BUILD_PAIR("flags", SD_JSON_BUILD_UNSIGNED(query_flags())));
+                        SD_JSON_BUILD_PAIR("flags", SD_JSON_BUILD_UNSIGNED(flags)));
         if (r < 0)
                 goto fail;
 
         const char* error_id;
-        r = varlink_call(link, "io.systemd.Resolve.ResolveAddress", cparams, &rparams, &error_id);
+        r = resolve_call("io.systemd.Resolve.ResolveAddress", cparams, flags, &link, &rparams, &error_id, &ttl);
         if (r < 0)
                 goto fail;
         if (!isempty(error_id)) {
@@ -736,7 +1094,7 @@ enum nss_status _nss_resolve_gethostbyaddr2_r(
         result->h_addr_list = (char**) r_addr_list;
 
         if (ttlp)
-                *ttlp = 0;
+                *ttlp = (int32_t) MIN(ttl, (uint32_t) INT32_MAX);
 
         /* Explicitly reset both *h_errnop and h_errno to work around
          * https://bugzilla.redhat.com/show_bug.cgi?id=1125975 */
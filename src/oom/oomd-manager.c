@@ -1,5 +1,8 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
+#include <sys/epoll.h>
+#include <sys/inotify.h>
+
 #include "sd-daemon.h"
 #include "sd-json.h"
 
@@ -34,6 +37,191 @@ static void managed_oom_message_destroy(ManagedOOMMessage *message) {
 
 static JSON_DISPATCH_ENUM_DEFINE(dispatch_managed_oom_mode, ManagedOOMMode, managed_oom_mode_from_string);
 
+typedef struct PendingKill {
+        Manager *manager;
+        char *path;
+        const char *reason;
+        usec_t start_usec;
+        sd_event_source *event_source;
+} PendingKill;
+
+static PendingKill* pending_kill_free(PendingKill *k) {
+        if (!k)
+                return NULL;
+
+        sd_event_source_disable_unref(k->event_source);
+        free(k->path);
+        return mfree(k);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(PendingKill*, pending_kill_free);
+
+DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(
+                pending_kill_hash_ops,
+                char,
+                string_hash_func,
+                string_compare_func,
+                PendingKill,
+                pending_kill_free);
+
+DEFINE_PRIVATE_HASH_OPS_FULL(
+                cgroup_watch_hash_ops,
+                char,
+                string_hash_func,
+                string_compare_func,
+                free,
+                sd_event_source,
+                sd_event_source_disable_unref);
+
+DEFINE_PRIVATE_HASH_OPS_FULL(
+                mem_pressure_trigger_hash_ops,
+                char,
+                string_hash_func,
+                string_compare_func,
+                free,
+                sd_event_source,
+                sd_event_source_disable_unref);
+
+static void manager_drop_mem_pressure_trigger(Manager *m, const char *path) {
+        _cleanup_free_ char *key = NULL;
+
+        assert(m);
+        assert(path);
+
+        sd_event_source_disable_unref(hashmap_remove2(m->mem_pressure_triggers, path, (void**) &key));
+}
+
+static void manager_start_mem_pressure_sampling(Manager *m) {
+        int r;
+
+        assert(m);
+
+        m->mem_pressure_quiet_start = 0;
+
+        if (m->mem_pressure_sampling)
+                return;
+
+        log_debug("Memory pressure is rising, sampling monitored cgroups every %s.",
+                  FORMAT_TIMESPAN(MEM_PRESSURE_INTERVAL_USEC, USEC_PER_SEC));
+
+        m->mem_pressure_sampling = true;
+
+        /* Don't wait for the idle interval to pass, sample right away. */
+        r = sd_event_source_set_time_relative(m->mem_pressure_context_event_source, 0);
+        if (r < 0)
+                log_debug_errno(r, "Failed to reschedule memory pressure timer, ignoring: %m");
+}
+
+static int on_mem_pressure_trigger(sd_event_source *s, int fd, uint32_t revents, void *userdata) {
+        Manager *m = ASSERT_PTR(userdata);
+
+        assert(s);
+
+        if (revents & (EPOLLERR|EPOLLHUP)) {
+                const char *path;
+                sd_event_source *t;
+
+                /* The cgroup is gone. Drop the trigger, a new one is registered if the cgroup is monitored
+                 * again once it is recreated. */
+                HASHMAP_FOREACH_KEY(t, path, m->mem_pressure_triggers)
+                        if (t == s) {
+                                log_debug("Memory pressure trigger of %s reported an error, dropping it.", path);
+                                manager_drop_mem_pressure_trigger(m, path);
+                                break;
+                        }
+
+                m->mem_pressure_triggers_armed = false;
+        }
+
+        manager_start_mem_pressure_sampling(m);
+        return 0;
+}
+
+static int manager_update_mem_pressure_triggers(Manager *m) {
+        OomdCGroupContext *ctx;
+        sd_event_source *s;
+        const char *path;
+        bool armed = true;
+        int r;
+
+        assert(m);
+
+        HASHMAP_FOREACH_KEY(s, path, m->mem_pressure_triggers)
+                if (!hashmap_contains(m->monitored_mem_pressure_cgroup_contexts, path))
+                        manager_drop_mem_pressure_trigger(m, path);
+
+        HASHMAP_FOREACH(ctx, m->monitored_mem_pressure_cgroup_contexts) {
+                _cleanup_(sd_event_source_unrefp) sd_event_source *t = NULL;
+                _cleanup_close_ int fd = -EBADF;
+                _cleanup_free_ char *key = NULL;
+                usec_t threshold;
+
+                if (hashmap_contains(m->mem_pressure_triggers, ctx->path))
+                        continue;
+
+                /* Trigger on "some" pressure, which is always at least as high as the "full" pressure the
+                 * limit refers to, at half the limit, so that sampling starts well before the limit is hit.
+                 * Capped at the threshold used by sd-event, which is good enough for high limits. */
+                threshold = MIN(MEMORY_PRESSURE_DEFAULT_THRESHOLD_USEC,
+                                (usec_t) (MEM_PRESSURE_TRIGGER_WINDOW_USEC * ctx->mem_pressure_limit /
+                                          (100 * LOADAVG_FIXED_POINT_1_0) / 2));
+                if (threshold == 0) {
+                        armed = false;
+                        continue;
+                }
+
+                fd = oomd_cgroup_pressure_trigger_open(ctx->path, PRESSURE_TYPE_SOME, threshold, MEM_PRESSURE_TRIGGER_WINDOW_USEC);
+                if (fd == -ENOMEM)
+                        return fd;
+                if (fd < 0) {
+                        armed = false;
+                        continue;
+                }
+
+                r = sd_event_add_io(m->event, &t, fd, EPOLLPRI, on_mem_pressure_trigger, m);
+                if (r < 0)
+                        return r;
+
+                r = sd_event_source_set_io_fd_own(t, true);
+                if (r < 0)
+                        return r;
+                TAKE_FD(fd);
+
+                (void) sd_event_source_set_description(t, "oomd-memory-pressure-trigger");
+
+                key = strdup(ctx->path);
+                if (!key)
+                        return -ENOMEM;
+
+                r = hashmap_ensure_put(&m->mem_pressure_triggers, &mem_pressure_trigger_hash_ops, key, t);
+                if (r < 0)
+                        return r;
+
+                TAKE_PTR(key);
+                TAKE_PTR(t);
+        }
+
+        if (armed != m->mem_pressure_triggers_armed)
+                log_debug(armed ? "Memory pressure triggers registered for all monitored cgroups." :
+                                  "Failed to register memory pressure triggers for some monitored cgroups, polling them.");
+
+        m->mem_pressure_triggers_armed = armed;
+        return 0;
+}
+
+static bool manager_mem_pressure_is_quiet(Manager *m) {
+        OomdCGroupContext *ctx;
+
+        assert(m);
+
+        HASHMAP_FOREACH(ctx, m->monitored_mem_pressure_cgroup_contexts)
+                if (ctx->mem_pressure_limit_hit_start > 0 ||
+                    ctx->memory_pressure.avg10 > ctx->mem_pressure_limit / 2)
+                        return false;
+
+        return true;
+}
+
 static int process_managed_oom_message(Manager *m, uid_t uid, sd_json_variant *parameters) {
         sd_json_variant *c, *cgroups;
         int r;
@@ -113,10 +301,21 @@ static int process_managed_oom_message(Manager *m, uid_t uid, sd_json_variant *p
                 /* Always update the limit in case it was changed. For non-memory pressure detection the value is
                  * ignored so always updating it here is not a problem. */
                 ctx = hashmap_get(monitor_hm, empty_to_root(message.path));
-                if (ctx)
+                if (ctx && ctx->mem_pressure_limit != limit) {
                         ctx->mem_pressure_limit = limit;
+
+                        /* The trigger threshold depends on the limit, register a new one. */
+                        if (monitor_hm == m->monitored_mem_pressure_cgroup_contexts)
+                                manager_drop_mem_pressure_trigger(m, ctx->path);
+                }
         }
 
+        r = manager_update_mem_pressure_triggers(m);
+        if (r == -ENOMEM)
+                return r;
+        if (r < 0)
+                log_debug_errno(r, "Failed to update memory pressure triggers, ignoring: %m");
+
         /* Toggle wake-ups for "ManagedOOMSwap" if entries are present. */
         r = sd_event_source_set_enabled(m->swap_context_event_source,
                                         hashmap_isempty(m->monitored_swap_cgroup_contexts) ? SD_EVENT_OFF : SD_EVENT_ON);
@@ -173,20 +372,105 @@ finish:
         return r;
 }
 
-/* Fill 'new_h' with 'path's descendant OomdCGroupContexts. Only include descendant cgroups that are possible
- * candidates for action. That is, only leaf cgroups or cgroups with memory.oom.group set to "1".
+static int on_cgroup_tree_changed(sd_event_source *s, const struct inotify_event *event, void *userdata) {
+        Manager *m = ASSERT_PTR(userdata);
+
+        assert(s);
+        assert(event);
+
+        if (FLAGS_SET(event->mask, IN_IGNORED))
+                /* The cgroup is gone and the kernel dropped the watch. A new one is added if a cgroup with
+                 * the same path shows up again. */
+                (void) sd_event_source_set_enabled(s, SD_EVENT_OFF);
+        else if (!FLAGS_SET(event->mask, IN_Q_OVERFLOW) &&
+                 !FLAGS_SET(event->mask, IN_ISDIR) &&
+                 !(event->len > 0 && streq(event->name, "memory.oom.group")))
+                /* Some other attribute of the cgroup was written to, which has no effect on candidates. */
+                return 0;
+
+        if (!hashmap_isempty(m->candidate_paths))
+                log_debug("Cgroup tree changed, dropping cached kill candidates.");
+
+        hashmap_clear(m->candidate_paths);
+        return 0;
+}
+
+static int manager_watch_cgroup(Manager *m, const char *path) {
+        _cleanup_(sd_event_source_unrefp) sd_event_source *s = NULL;
+        _cleanup_free_ char *p = NULL, *key = NULL;
+        sd_event_source *existing;
+        char *existing_key;
+        int r;
+
+        assert(m);
+        assert(path);
+
+        path = empty_to_root(path);
+
+        existing = hashmap_get2(m->candidate_watches, path, (void**) &existing_key);
+        if (existing && sd_event_source_get_enabled(existing, NULL) > 0)
+                return 0;
+
+        r = cg_get_path(SYSTEMD_CGROUP_CONTROLLER, path, NULL, &p);
+        if (r < 0)
+                return r;
+
+        r = sd_event_add_inotify(m->event, &s, p,
+                                 IN_CREATE|IN_DELETE|IN_MOVED_FROM|IN_MOVED_TO|IN_MODIFY|IN_ONLYDIR,
+                                 on_cgroup_tree_changed, m);
+        if (r < 0)
+                return r;
+
+        (void) sd_event_source_set_description(s, "oomd-cgroup-watch");
+
+        if (existing) {
+                /* The cgroup was removed and created again. */
+                r = hashmap_replace(m->candidate_watches, existing_key, s);
+                if (r < 0)
+                        return r;
+
+                sd_event_source_disable_unref(existing);
+                TAKE_PTR(s);
+                return 0;
+        }
+
+        key = strdup(path);
+        if (!key)
+                return -ENOMEM;
+
+        r = hashmap_ensure_put(&m->candidate_watches, &cgroup_watch_hash_ops, key, s);
+        if (r < 0)
+                return r;
+
+        TAKE_PTR(key);
+        TAKE_PTR(s);
+        return 0;
+}
+
+/* Add the paths of 'path's descendant cgroups that are possible candidates for action to 'candidates'. That
+ * is, only leaf cgroups or cgroups with memory.oom.group set to "1". Every directory we enumerate is watched
+ * via inotify before enumerating it, so that the result can be cached until the tree changes. 'watched' is
+ * set to false if a watch could not be added, in which case the result must not be cached.
  *
  * This function ignores most errors in order to handle cgroups that may have been cleaned up while
- * populating the hashmap.
- *
- * 'new_h' is of the form { key: cgroup paths -> value: OomdCGroupContext } */
-static int recursively_get_cgroup_context(Hashmap *new_h, const char *path) {
+ * walking the tree. */
+static int recursively_get_cgroup_candidates(Manager *m, const char *path, char ***candidates, bool *watched) {
         _cleanup_free_ char *subpath = NULL;
         _cleanup_closedir_ DIR *d = NULL;
         int r;
 
-        assert(new_h);
+        assert(m);
         assert(path);
+        assert(candidates);
+        assert(watched);
+
+        r = manager_watch_cgroup(m, path);
+        if (r == -ENOMEM)
+                return r;
+        if (r < 0) {
+                log_debug_errno(r, "Failed to watch cgroup %s, not caching kill candidates: %m", path);
+                *watched = false;
+        }
 
         r = cg_enumerate_subgroups(SYSTEMD_CGROUP_CONTROLLER, path, &d);
         if (r < 0)
@@ -195,14 +479,8 @@ static int recursively_get_cgroup_context(Hashmap *new_h, const char *path) {
         r = cg_read_subgroup(d, &subpath);
         if (r < 0)
                 return r;
-        else if (r == 0) { /* No subgroups? We're a leaf node */
-                r = oomd_insert_cgroup_context(NULL, new_h, path);
-                if (r == -ENOMEM)
-                        return r;
-                if (r < 0)
-                        log_debug_errno(r, "Failed to insert context for %s, ignoring: %m", path);
-                return 0;
-        }
+        else if (r == 0) /* No subgroups? We're a leaf node */
+                return strv_extend(candidates, empty_to_root(path));
 
         do {
                 _cleanup_free_ char *cg_path = NULL;
@@ -223,19 +501,77 @@ static int recursively_get_cgroup_context(Hashmap *new_h, const char *path) {
                         return 0;
                 }
 
-                if (oom_group)
-                        r = oomd_insert_cgroup_context(NULL, new_h, cg_path);
-                else
-                        r = recursively_get_cgroup_context(new_h, cg_path);
+                if (oom_group) {
+                        /* memory.oom.group might be turned off again, hence watch this cgroup too. */
+                        r = manager_watch_cgroup(m, cg_path);
+                        if (r == -ENOMEM)
+                                return r;
+                        if (r < 0) {
+                                log_debug_errno(r, "Failed to watch cgroup %s, not caching kill candidates: %m", cg_path);
+                                *watched = false;
+                        }
+
+                        r = strv_extend(candidates, cg_path);
+                } else
+                        r = recursively_get_cgroup_candidates(m, cg_path, candidates, watched);
                 if (r == -ENOMEM)
                         return r;
                 if (r < 0)
-                        log_debug_errno(r, "Failed to insert or recursively get from %s, ignoring: %m", cg_path);
+                        log_debug_errno(r, "Failed to recursively get candidates from %s, ignoring: %m", cg_path);
         } while ((r = cg_read_subgroup(d, &subpath)) > 0);
 
         return 0;
 }
 
+/* Returns the paths of the kill candidates below the monitored cgroup 'path' in 'ret'. The list is owned by
+ * the manager, and remains valid until this is called again or the event loop processes the next event. */
+static int manager_get_cgroup_candidates(Manager *m, const char *path, char ***ret) {
+        _cleanup_strv_free_ char **candidates = NULL;
+        _cleanup_free_ char *key = NULL;
+        bool watched = true;
+        char **cached;
+        int r;
+
+        assert(m);
+        assert(path);
+        assert(ret);
+
+        cached = hashmap_get(m->candidate_paths, path);
+        if (cached) {
+                *ret = cached;
+                return 0;
+        }
+
+        r = recursively_get_cgroup_candidates(m, path, &candidates, &watched);
+        if (r < 0)
+                return r;
+
+        /* Without a watch on each directory we could miss new cgroups, walk the tree again next time then. */
+        if (!watched) {
+                strv_free_and_replace(m->uncached_candidate_paths, candidates);
+                *ret = m->uncached_candidate_paths;
+                return 0;
+        }
+
+        if (!candidates) {
+                candidates = strv_new(NULL);
+                if (!candidates)
+                        return -ENOMEM;
+        }
+
+        key = strdup(path);
+        if (!key)
+                return -ENOMEM;
+
+        r = hashmap_ensure_put(&m->candidate_paths, &string_hash_ops_free_strv_free, key, candidates);
+        if (r < 0)
+                return r;
+
+        TAKE_PTR(key);
+        *ret = TAKE_PTR(candidates);
+        return 0;
+}
+
 static int update_monitored_cgroup_contexts(Hashmap **monitored_cgroups) {
         _cleanup_hashmap_free_ Hashmap *new_base = NULL;
         OomdCGroupContext *ctx;
@@ -262,11 +598,12 @@ static int update_monitored_cgroup_contexts(Hashmap **monitored_cgroups) {
         return 0;
 }
 
-static int get_monitored_cgroup_contexts_candidates(Hashmap *monitored_cgroups, Hashmap **ret_candidates) {
+static int get_monitored_cgroup_contexts_candidates(Manager *m, Hashmap *monitored_cgroups, Hashmap **ret_candidates) {
         _cleanup_hashmap_free_ Hashmap *candidates = NULL;
         OomdCGroupContext *ctx;
         int r;
 
+        assert(m);
         assert(monitored_cgroups);
         assert(ret_candidates);
 
@@ -275,11 +612,23 @@ static int get_monitored_cgroup_contexts_candidates(Hashmap *monitored_cgroups,
                 return -ENOMEM;
 
         HASHMAP_FOREACH(ctx, monitored_cgroups) {
-                r = recursively_get_cgroup_context(candidates, ctx->path);
+                char **paths;
+
+                r = manager_get_cgroup_candidates(m, ctx->path, &paths);
                 if (r == -ENOMEM)
                         return r;
-                if (r < 0)
-                        log_debug_errno(r, "Failed to recursively get contexts for %s, ignoring: %m", ctx->path);
+                if (r < 0) {
+                        log_debug_errno(r, "Failed to recursively get candidates for %s, ignoring: %m", ctx->path);
+                        continue;
+                }
+
+                STRV_FOREACH(p, paths) {
+                        r = oomd_insert_cgroup_context(NULL, candidates, *p);
+                        if (r == -ENOMEM)
+                                return r;
+                        if (r < 0 && r != -EEXIST)
+                                log_debug_errno(r, "Failed to insert context for %s, ignoring: %m", *p);
+                }
         }
 
         *ret_candidates = TAKE_PTR(candidates);
@@ -287,15 +636,16 @@ static int get_monitored_cgroup_contexts_candidates(Hashmap *monitored_cgroups,
         return 0;
 }
 
-static int update_monitored_cgroup_contexts_candidates(Hashmap *monitored_cgroups, Hashmap **candidates) {
+static int update_monitored_cgroup_contexts_candidates(Manager *m, Hashmap *monitored_cgroups, Hashmap **candidates) {
         _cleanup_hashmap_free_ Hashmap *new_candidates = NULL;
         int r;
 
+        assert(m);
         assert(monitored_cgroups);
         assert(candidates);
         assert(*candidates);
 
-        r = get_monitored_cgroup_contexts_candidates(monitored_cgroups, &new_candidates);
+        r = get_monitored_cgroup_contexts_candidates(m, monitored_cgroups, &new_candidates);
         if (r < 0)
                 return log_debug_errno(r, "Failed to get candidate contexts: %m");
 
@@ -307,6 +657,116 @@ static int update_monitored_cgroup_contexts_candidates(Hashmap *monitored_cgroup
         return 0;
 }
 
+static void manager_kill_done(Manager *m, const char *path, const char *reason, usec_t start_usec) {
+        usec_t latency;
+
+        assert(m);
+        assert(path);
+        assert(reason);
+
+        latency = usec_sub_unsigned(now(CLOCK_MONOTONIC), start_usec);
+
+        m->n_kills++;
+        m->last_kill_latency_usec = latency;
+        m->max_kill_latency_usec = MAX(m->max_kill_latency_usec, latency);
+
+        log_info("All processes of %s are gone, %s after the kill was started.",
+                 path, FORMAT_TIMESPAN(latency, USEC_PER_MSEC));
+
+        /* send dbus signal */
+        (void) sd_bus_emit_signal(m->bus,
+                                  "/org/freedesktop/oom1",
+                                  "org.freedesktop.oom1.Manager",
+                                  "Killed",
+                                  "ss",
+                                  path,
+                                  reason);
+}
+
+static int on_pending_kill_event(sd_event_source *s, const struct inotify_event *event, void *userdata) {
+        PendingKill *k = ASSERT_PTR(userdata);
+        Manager *m = ASSERT_PTR(k->manager);
+        int r;
+
+        assert(event);
+
+        if (!FLAGS_SET(event->mask, IN_IGNORED)) {
+                r = cg_is_empty_recursive(SYSTEMD_CGROUP_CONTROLLER, k->path);
+                if (r == 0)
+                        return 0;
+                if (r < 0)
+                        log_debug_errno(r, "Failed to check if %s is populated, assuming the kill completed: %m", k->path);
+        }
+
+        manager_kill_done(m, k->path, k->reason, k->start_usec);
+        pending_kill_free(hashmap_remove(m->pending_kills, k->path));
+        return 0;
+}
+
+/* The kernel may still be tearing down the processes of a cgroup killed via cgroup.kill. Watch its
+ * cgroup.events to report the kill once the cgroup is empty, without blocking the sampling loop. */
+static int manager_track_kill(Manager *m, const char *path, const char *reason, usec_t start_usec) {
+        _cleanup_(pending_kill_freep) PendingKill *k = NULL;
+        _cleanup_free_ char *p = NULL;
+        int r;
+
+        assert(m);
+        assert(path);
+        assert(reason);
+
+        /* We only kill again after the post action delay, so a previous kill of the same cgroup is stuck
+         * and won't be reported anymore. */
+        k = hashmap_remove(m->pending_kills, path);
+        if (k)
+                log_debug("Processes of %s are still around %s after the previous kill, killed again.",
+                          path, FORMAT_TIMESPAN(usec_sub_unsigned(now(CLOCK_MONOTONIC), k->start_usec), USEC_PER_MSEC));
+        k = pending_kill_free(k);
+
+        r = cg_get_path(SYSTEMD_CGROUP_CONTROLLER, path, "cgroup.events", &p);
+        if (r < 0)
+                return r;
+
+        k = new(PendingKill, 1);
+        if (!k)
+                return -ENOMEM;
+
+        *k = (PendingKill) {
+                .manager = m,
+                .reason = reason,
+                .start_usec = start_usec,
+        };
+
+        k->path = strdup(path);
+        if (!k->path)
+                return -ENOMEM;
+
+        r = sd_event_add_inotify(m->event, &k->event_source, p, IN_MODIFY, on_pending_kill_event, k);
+        if (r < 0 && r != -ENOENT)
+                log_debug_errno(r, "Failed to watch %s, not waiting for the kill to complete: %m", p);
+        if (r < 0) {
+                manager_kill_done(m, path, reason, start_usec);
+                return 0;
+        }
+
+        (void) sd_event_source_set_description(k->event_source, "oomd-kill-watch");
+
+        /* Check once after adding the watch, in case the processes were gone before we started watching. */
+        r = cg_is_empty_recursive(SYSTEMD_CGROUP_CONTROLLER, path);
+        if (r != 0) {
+                if (r < 0)
+                        log_debug_errno(r, "Failed to check if %s is populated, assuming the kill completed: %m", path);
+                manager_kill_done(m, path, reason, start_usec);
+                return 0;
+        }
+
+        r = hashmap_ensure_put(&m->pending_kills, &pending_kill_hash_ops, k->path, k);
+        if (r < 0)
+                return r;
+
+        TAKE_PTR(k);
+        return 0;
+}
+
 static int acquire_managed_oom_connect(Manager *m) {
         _cleanup_(varlink_close_unrefp) Varlink *link = NULL;
         int r;
@@ -379,6 +839,7 @@ static int monitor_swap_contexts_handler(sd_event_source *s, uint64_t usec, void
                 _cleanup_hashmap_free_ Hashmap *candidates = NULL;
                 _cleanup_free_ char *selected = NULL;
                 uint64_t threshold;
+                usec_t kill_start;
 
                 log_debug("Memory used (%"PRIu64") / total (%"PRIu64") and "
                           "swap used (%"PRIu64") / total (%"PRIu64") is more than " PERMYRIAD_AS_PERCENT_FORMAT_STR,
@@ -386,13 +847,14 @@ static int monitor_swap_contexts_handler(sd_event_source *s, uint64_t usec, void
                           m->system_context.swap_used, m->system_context.swap_total,
                           PERMYRIAD_AS_PERCENT_FORMAT_VAL(m->swap_used_limit_permyriad));
 
-                r = get_monitored_cgroup_contexts_candidates(m->monitored_swap_cgroup_contexts, &candidates);
+                r = get_monitored_cgroup_contexts_candidates(m, m->monitored_swap_cgroup_contexts, &candidates);
                 if (r == -ENOMEM)
                         return log_oom();
                 if (r < 0)
                         log_debug_errno(r, "Failed to get monitored swap cgroup candidates, ignoring: %m");
 
                 threshold = m->system_context.swap_total * THRESHOLD_SWAP_USED_PERCENT / 100;
+                kill_start = now(CLOCK_MONOTONIC);
                 r = oomd_kill_by_swap_usage(candidates, threshold, m->dry_run, &selected);
                 if (r == -ENOMEM)
                         return log_oom();
@@ -408,14 +870,11 @@ static int monitor_swap_contexts_handler(sd_event_source *s, uint64_t usec, void
                                            m->system_context.swap_used, m->system_context.swap_total,
                                            PERMYRIAD_AS_PERCENT_FORMAT_VAL(m->swap_used_limit_permyriad));
 
-                                /* send dbus signal */
-                                (void) sd_bus_emit_signal(m->bus,
-                                                          "/org/freedesktop/oom1",
-                                                          "org.freedesktop.oom1.Manager",
-                                                          "Killed",
-                                                          "ss",
-                                                          selected,
-                                                          "memory-used");
+                                r = manager_track_kill(m, selected, "memory-used", kill_start);
+                                if (r == -ENOMEM)
+                                        return log_oom();
+                                if (r < 0)
+                                        log_debug_errno(r, "Failed to track kill of %s, ignoring: %m", selected);
                         }
                         return 0;
                 }
@@ -446,7 +905,9 @@ static int monitor_memory_pressure_contexts_handler(sd_event_source *s, uint64_t
         if (r < 0)
                 return log_error_errno(r, "Failed to reset event timer: %m");
 
-        r = sd_event_source_set_time_relative(s, MEM_PRESSURE_INTERVAL_USEC);
+        r = sd_event_source_set_time_relative(s,
+                                              m->mem_pressure_sampling || !m->mem_pressure_triggers_armed ?
+                                              MEM_PRESSURE_INTERVAL_USEC : MEM_PRESSURE_IDLE_INTERVAL_USEC);
         if (r < 0)
                 return log_error_errno(r, "Failed to set relative time for timer: %m");
 
@@ -461,6 +922,20 @@ static int monitor_memory_pressure_contexts_handler(sd_event_source *s, uint64_t
         if (hashmap_isempty(m->monitored_mem_pressure_cgroup_contexts))
                 return 0;
 
+        /* Cgroups may have been created since we last tried to register a trigger on them. */
+        if (!m->mem_pressure_triggers_armed) {
+                r = manager_update_mem_pressure_triggers(m);
+                if (r == -ENOMEM)
+                        return log_oom();
+                if (r < 0)
+                        log_debug_errno(r, "Failed to update memory pressure triggers, ignoring: %m");
+        }
+
+        /* Nothing to do until a trigger fires, if all monitored cgroups have one. This avoids reading the
+         * pressure and memory statistics of all monitored cgroups on every interval. */
+        if (!m->mem_pressure_sampling && m->mem_pressure_triggers_armed)
+                return 0;
+
         /* Update the cgroups used for detection/action */
         r = update_monitored_cgroup_contexts(&m->monitored_mem_pressure_cgroup_contexts);
         if (r == -ENOMEM)
@@ -477,6 +952,19 @@ static int monitor_memory_pressure_contexts_handler(sd_event_source *s, uint64_t
                         m->mem_pressure_post_action_delay_start = 0;
         }
 
+        if (m->mem_pressure_triggers_armed && !in_post_action_delay && manager_mem_pressure_is_quiet(m)) {
+                if (m->mem_pressure_quiet_start == 0)
+                        m->mem_pressure_quiet_start = usec_now;
+                else if (usec_now - m->mem_pressure_quiet_start >= MEM_PRESSURE_QUIET_USEC) {
+                        log_debug("Memory pressure stayed low for %s, waiting for memory pressure triggers.",
+                                  FORMAT_TIMESPAN(MEM_PRESSURE_QUIET_USEC, USEC_PER_SEC));
+                        m->mem_pressure_sampling = false;
+                        m->mem_pressure_quiet_start = 0;
+                        return 0;
+                }
+        } else
+                m->mem_pressure_quiet_start = 0;
+
         r = oomd_pressure_above(m->monitored_mem_pressure_cgroup_contexts, m->default_mem_pressure_duration_usec, &targets);
         if (r == -ENOMEM)
                 return log_oom();
@@ -486,6 +974,7 @@ static int monitor_memory_pressure_contexts_handler(sd_event_source *s, uint64_t
                 OomdCGroupContext *t;
                 SET_FOREACH(t, targets) {
                         _cleanup_free_ char *selected = NULL;
+                        usec_t kill_start;
 
                         /* Check if there was reclaim activity in the given interval. The concern is the following case:
                          * Pressure climbed, a lot of high-frequency pages were reclaimed, and we killed the offending
@@ -502,7 +991,7 @@ static int monitor_memory_pressure_contexts_handler(sd_event_source *s, uint64_t
                                   FORMAT_TIMESPAN(m->default_mem_pressure_duration_usec, USEC_PER_SEC));
 
                         r = update_monitored_cgroup_contexts_candidates(
-                                        m->monitored_mem_pressure_cgroup_contexts, &m->monitored_mem_pressure_cgroup_contexts_candidates);
+                                        m, m->monitored_mem_pressure_cgroup_contexts, &m->monitored_mem_pressure_cgroup_contexts_candidates);
                         if (r == -ENOMEM)
                                 return log_oom();
                         if (r < 0)
@@ -510,10 +999,17 @@ static int monitor_memory_pressure_contexts_handler(sd_event_source *s, uint64_t
                         else
                                 clear_candidates = NULL;
 
-                        r = oomd_kill_by_pgscan_rate(m->monitored_mem_pressure_cgroup_contexts_candidates,
-                                                     /* prefix= */ t->path,
-                                                     /* dry_run= */ m->dry_run,
-                                                     &selected);
+                        kill_start = now(CLOCK_MONOTONIC);
+                        if (m->mem_pressure_kill_selection == OOMD_KILL_SELECTION_GROWTH)
+                                r = oomd_kill_by_growth(m->monitored_mem_pressure_cgroup_contexts_candidates,
+                                                        /* prefix= */ t->path,
+                                                        /* dry_run= */ m->dry_run,
+                                                        &selected);
+                        else
+                                r = oomd_kill_by_pgscan_rate(m->monitored_mem_pressure_cgroup_contexts_candidates,
+                                                             /* prefix= */ t->path,
+                                                             /* dry_run= */ m->dry_run,
+                                                             &selected);
                         if (r == -ENOMEM)
                                 return log_oom();
                         if (r < 0)
@@ -533,14 +1029,11 @@ static int monitor_memory_pressure_contexts_handler(sd_event_source *s, uint64_t
                                                    LOADAVG_INT_SIDE(t->mem_pressure_limit), LOADAVG_DECIMAL_SIDE(t->mem_pressure_limit),
                                                    FORMAT_TIMESPAN(m->default_mem_pressure_duration_usec, USEC_PER_SEC));
 
-                                        /* send dbus signal */
-                                        (void) sd_bus_emit_signal(m->bus,
-                                                                  "/org/freedesktop/oom1",
-                                                                  "org.freedesktop.oom1.Manager",
-                                                                  "Killed",
-                                                                  "ss",
-                                                                  selected,
-                                                                  "memory-pressure");
+                                        r = manager_track_kill(m, selected, "memory-pressure", kill_start);
+                                        if (r == -ENOMEM)
+                                                return log_oom();
+                                        if (r < 0)
+                                                log_debug_errno(r, "Failed to track kill of %s, ignoring: %m", selected);
                                 }
                                 return 0;
                         }
@@ -557,7 +1050,7 @@ static int monitor_memory_pressure_contexts_handler(sd_event_source *s, uint64_t
                                 continue;
 
                         r = update_monitored_cgroup_contexts_candidates(
-                                        m->monitored_mem_pressure_cgroup_contexts, &m->monitored_mem_pressure_cgroup_contexts_candidates);
+                                        m, m->monitored_mem_pressure_cgroup_contexts, &m->monitored_mem_pressure_cgroup_contexts_candidates);
                         if (r == -ENOMEM)
                                 return log_oom();
                         if (r < 0)
@@ -629,6 +1122,11 @@ Manager* manager_free(Manager *m) {
         varlink_close_unref(m->varlink_client);
         sd_event_source_unref(m->swap_context_event_source);
         sd_event_source_unref(m->mem_pressure_context_event_source);
+        hashmap_free(m->mem_pressure_triggers);
+        hashmap_free(m->pending_kills);
+        hashmap_free(m->candidate_paths);
+        hashmap_free(m->candidate_watches);
+        strv_free(m->uncached_candidate_paths);
         sd_event_unref(m->event);
 
         hashmap_free(m->polkit_registry);
@@ -677,6 +1175,9 @@ int manager_new(Manager **ret) {
         if (!m->monitored_mem_pressure_cgroup_contexts_candidates)
                 return -ENOMEM;
 
+        /* Sample until we know that triggers are registered for all monitored cgroups. */
+        m->mem_pressure_sampling = true;
+
         *ret = TAKE_PTR(m);
         return 0;
 }
@@ -754,6 +1255,7 @@ int manager_start(
                 int swap_used_limit_permyriad,
                 int mem_pressure_limit_permyriad,
                 usec_t mem_pressure_usec,
+                OomdKillSelection mem_pressure_kill_selection,
                 int fd) {
 
         unsigned long l, f;
@@ -781,6 +1283,9 @@ int manager_start(
 
         m->default_mem_pressure_duration_usec = mem_pressure_usec ?: DEFAULT_MEM_PRESSURE_DURATION_USEC;
 
+        assert(mem_pressure_kill_selection >= 0 && mem_pressure_kill_selection < _OOMD_KILL_SELECTION_MAX);
+        m->mem_pressure_kill_selection = mem_pressure_kill_selection;
+
         r = manager_connect_bus(m);
         if (r < 0)
                 return r;
@@ -807,6 +1312,8 @@ int manager_start(
 int manager_get_dump_string(Manager *m, char **ret) {
         _cleanup_(memstream_done) MemStream ms = {};
         OomdCGroupContext *c;
+        PendingKill *k;
+        usec_t n;
         FILE *f;
 
         assert(m);
@@ -821,13 +1328,33 @@ int manager_get_dump_string(Manager *m, char **ret) {
                 "Swap Used Limit: " PERMYRIAD_AS_PERCENT_FORMAT_STR "\n"
                 "Default Memory Pressure Limit: %lu.%02lu%%\n"
                 "Default Memory Pressure Duration: %s\n"
+                "Memory Pressure Kill Selection: %s\n"
+                "Memory Pressure Sampling: %s\n"
+                "Kills: %u\n"
+                "Last Kill Latency: %s\n"
+                "Max Kill Latency: %s\n"
                 "System Context:\n",
                 yes_no(m->dry_run),
                 PERMYRIAD_AS_PERCENT_FORMAT_VAL(m->swap_used_limit_permyriad),
                 LOADAVG_INT_SIDE(m->default_mem_pressure_limit), LOADAVG_DECIMAL_SIDE(m->default_mem_pressure_limit),
-                FORMAT_TIMESPAN(m->default_mem_pressure_duration_usec, USEC_PER_SEC));
+                FORMAT_TIMESPAN(m->default_mem_pressure_duration_usec, USEC_PER_SEC),
+                oomd_kill_selection_to_string(m->mem_pressure_kill_selection),
+                !m->mem_pressure_triggers_armed ? "polling" :
+                m->mem_pressure_sampling ? "triggered" : "waiting for triggers",
+                m->n_kills,
+                FORMAT_TIMESPAN(m->last_kill_latency_usec, USEC_PER_MSEC),
+                FORMAT_TIMESPAN(m->max_kill_latency_usec, USEC_PER_MSEC));
         oomd_dump_system_context(&m->system_context, f, "\t");
 
+        if (!hashmap_isempty(m->pending_kills)) {
+                n = now(CLOCK_MONOTONIC);
+
+                fprintf(f, "Pending Kills:\n");
+                HASHMAP_FOREACH(k, m->pending_kills)
+                        fprintf(f, "\t%s (%s, started %s ago)\n",
+                                k->path, k->reason, FORMAT_TIMESPAN(usec_sub_unsigned(n, k->start_usec), USEC_PER_MSEC));
+        }
+
         fprintf(f, "Swap Monitored CGroups:\n");
         HASHMAP_FOREACH(c, m->monitored_swap_cgroup_contexts)
                 oomd_dump_swap_cgroup_context(c, f, "\t");
@@ -12,6 +12,13 @@
 #define SWAP_INTERVAL_USEC 150000 /* 0.15 seconds */
 /* Pressure counters are lagging (~2 seconds) compared to swap so polling too frequently just wastes CPU */
 #define MEM_PRESSURE_INTERVAL_USEC (1 * USEC_PER_SEC)
+/* While PSI triggers are armed on all cgroups monitored for memory pressure, we only wake up this often to
+ * keep the connection to PID1 alive, and sample the cgroups only after a trigger fired. We go back to
+ * waiting for the triggers once pressure stayed low for a while. */
+#define MEM_PRESSURE_IDLE_INTERVAL_USEC (5 * USEC_PER_SEC)
+#define MEM_PRESSURE_QUIET_USEC (60 * USEC_PER_SEC)
+/* The window of the PSI triggers. 2s is the shortest window the kernel may allow unprivileged users. */
+#define MEM_PRESSURE_TRIGGER_WINDOW_USEC (2 * USEC_PER_SEC)
 
 /* Take action if 10s of memory pressure > 60 for more than 30s. We use the "full" value from PSI so this is the
  * percentage of time all tasks were delayed (i.e. unproductive).
@@ -39,6 +46,7 @@ struct Manager {
         int swap_used_limit_permyriad;
         loadavg_t default_mem_pressure_limit;
         usec_t default_mem_pressure_duration_usec;
+        OomdKillSelection mem_pressure_kill_selection;
 
         /* k: cgroup paths -> v: OomdCGroupContext
          * Used to detect when to take action. */
@@ -46,10 +54,32 @@ struct Manager {
         Hashmap *monitored_mem_pressure_cgroup_contexts;
         Hashmap *monitored_mem_pressure_cgroup_contexts_candidates;
 
+        /* k: monitored cgroup paths -> v: strv of the paths of its kill candidates. Cached until inotify
+         * reports a change in the cgroup tree, so that the tree is not walked on every interval. */
+        Hashmap *candidate_paths;
+        /* Candidates of the last walk that could not be cached since not every cgroup could be watched */
+        char **uncached_candidate_paths;
+        /* k: cgroup paths -> v: sd_event_source watching the cgroup directory via inotify */
+        Hashmap *candidate_watches;
+
         OomdSystemContext system_context;
 
         usec_t mem_pressure_post_action_delay_start;
 
+        /* k: cgroup paths -> v: sd_event_source watching a PSI trigger on the cgroup's memory.pressure */
+        Hashmap *mem_pressure_triggers;
+        /* true if a trigger could be registered for each cgroup in monitored_mem_pressure_cgroup_contexts */
+        bool mem_pressure_triggers_armed;
+        /* true while cgroups are sampled every MEM_PRESSURE_INTERVAL_USEC, false while waiting for triggers */
+        bool mem_pressure_sampling;
+        usec_t mem_pressure_quiet_start;
+
+        /* k: cgroup paths -> v: PendingKill, for kills whose processes are not gone yet */
+        Hashmap *pending_kills;
+        unsigned n_kills;
+        usec_t last_kill_latency_usec;
+        usec_t max_kill_latency_usec;
+
         sd_event_source *swap_context_event_source;
         sd_event_source *mem_pressure_context_event_source;
 
@@ -66,7 +96,14 @@ DEFINE_TRIVIAL_CLEANUP_FUNC(Manager*, manager_free);
 
 int manager_new(Manager **ret);
 
-int manager_start(Manager *m, bool dry_run, int swap_used_limit_permyriad, int mem_pressure_limit_permyriad, usec_t mem_pressure_usec, int fd);
+int manager_start(
+                Manager *m,
+                bool dry_run,
+                int swap_used_limit_permyriad,
+                int mem_pressure_limit_permyriad,
+                usec_t mem_pressure_usec,
+                OomdKillSelection mem_pressure_kill_selection,
+                int fd);
 
 int manager_get_dump_string(Manager *m, char **ret);
 
@@ -1,5 +1,6 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
+#include <fcntl.h>
 #include <sys/xattr.h>
 #include <unistd.h>
 
@@ -16,6 +17,7 @@
 #include "sort-util.h"
 #include "stat-util.h"
 #include "stdio-util.h"
+#include "string-table.h"
 #include "user-util.h"
 
 DEFINE_HASH_OPS_WITH_VALUE_DESTRUCTOR(
@@ -125,6 +127,68 @@ uint64_t oomd_pgscan_rate(const OomdCGroupContext *c) {
         return c->pgscan - last_pgscan;
 }
 
+static uint64_t growth_avg_u64(uint64_t avg, uint64_t sample) {
+        return sample >= avg ?
+                avg + ((sample - avg) >> GROWTH_AVG_SHIFT) :
+                avg - ((avg - sample) >> GROWTH_AVG_SHIFT);
+}
+
+void oomd_update_growth(OomdCGroupContext *c, const OomdCGroupContext *old) {
+        uint64_t pgscan_rate;
+        int64_t memory_growth;
+        usec_t pressure_growth;
+
+        assert(c);
+        assert(old);
+
+        c->last_memory_usage = old->current_memory_usage;
+        c->last_pressure_total = old->memory_pressure.total;
+
+        memory_growth = (int64_t) (c->current_memory_usage - old->current_memory_usage);
+        pgscan_rate = oomd_pgscan_rate(c);
+        /* Like pgscan, the total stall time only decreases if the cgroup was recreated. */
+        pressure_growth = c->memory_pressure.total >= old->memory_pressure.total ?
+                c->memory_pressure.total - old->memory_pressure.total : c->memory_pressure.total;
+
+        if (old->n_growth_samples == 0) {
+                c->memory_growth_avg = memory_growth;
+                c->pgscan_rate_avg = pgscan_rate;
+                c->pressure_growth_avg = pressure_growth;
+        } else {
+                c->memory_growth_avg = old->memory_growth_avg + (memory_growth - old->memory_growth_avg) / (1 << GROWTH_AVG_SHIFT);
+                c->pgscan_rate_avg = growth_avg_u64(old->pgscan_rate_avg, pgscan_rate);
+                c->pressure_growth_avg = growth_avg_u64(old->pressure_growth_avg, pressure_growth);
+        }
+
+        c->n_growth_samples = old->n_growth_samples < UINT_MAX ? old->n_growth_samples + 1 : UINT_MAX;
+}
+
+uint64_t oomd_growth_score(const OomdCGroupContext *c) {
+        uint64_t score, pgscan_bytes, stalled, weight;
+
+        assert(c);
+
+        if (c->n_growth_samples == 0)
+                return 0;
+
+        /* pgscan counts pages, turn it into bytes so that it can be added to the memory growth. */
+        pgscan_bytes = c->pgscan_rate_avg > UINT64_MAX / page_size() ? UINT64_MAX : c->pgscan_rate_avg * page_size();
+        score = saturate_add(c->memory_growth_avg > 0 ? (uint64_t) c->memory_growth_avg : 0, pgscan_bytes, UINT64_MAX);
+
+        /* Samples are taken about once per second, hence the stall time per sample is roughly the fraction
+         * of time the cgroup stalled. */
+        stalled = MIN(c->pressure_growth_avg, USEC_PER_SEC);
+        score = saturate_add(score,
+                             score <= UINT64_MAX / USEC_PER_SEC ? score * stalled / USEC_PER_SEC : score / USEC_PER_SEC * stalled,
+                             UINT64_MAX);
+
+        weight = c->kill_weight > 0 ? c->kill_weight : DEFAULT_KILL_WEIGHT;
+        if (score <= UINT64_MAX / KILL_WEIGHT_MAX)
+                return score * weight / 100;
+
+        return score / 100 > UINT64_MAX / weight ? UINT64_MAX : score / 100 * weight;
+}
+
 bool oomd_mem_available_below(const OomdSystemContext *ctx, int threshold_permyriad) {
         uint64_t mem_threshold;
 
@@ -193,6 +257,74 @@ int oomd_fetch_cgroup_oom_preference(OomdCGroupContext *ctx, const char *prefix)
         return 0;
 }
 
+int oomd_fetch_cgroup_kill_weight(OomdCGroupContext *ctx, const char *prefix) {
+        _cleanup_free_ char *path = NULL;
+        uid_t prefix_uid = UID_INVALID;
+        int r;
+
+        assert(ctx);
+
+        prefix = empty_to_root(prefix);
+
+        if (!path_startswith(ctx->path, prefix))
+                return log_debug_errno(SYNTHETIC_ERRNO(EINVAL),
+                                       "%s is not a descendant of %s", ctx->path, prefix);
+
+        ctx->kill_weight = DEFAULT_KILL_WEIGHT;
+
+        path = strdup(ctx->path);
+        if (!path)
+                return log_oom_debug();
+
+        for (;;) {
+                _cleanup_free_ char *value = NULL, *parent = NULL;
+                bool trusted = true;
+                unsigned weight;
+                uid_t uid;
+
+                r = cg_get_owner(path, &uid);
+                if (r < 0)
+                        return log_debug_errno(r, "Failed to get owner/group from %s: %m", path);
+
+                /* Like for the other xattrs, only trust cgroups owned by root or by the owner of the prefix. */
+                if (uid != 0) {
+                        if (!uid_is_valid(prefix_uid)) {
+                                r = cg_get_owner(prefix, &prefix_uid);
+                                if (r < 0)
+                                        return log_debug_errno(r, "Failed to get owner/group from %s: %m", prefix);
+                        }
+
+                        trusted = uid == prefix_uid;
+                }
+
+                if (trusted) {
+                        r = cg_get_xattr_malloc(path, "user.oomd_weight", &value);
+                        if (r == -ENOMEM)
+                                return log_oom_debug();
+                        if (r < 0 && !ERRNO_IS_XATTR_ABSENT(r))
+                                log_debug_errno(r, "Failed to get xattr user.oomd_weight, ignoring: %m");
+                        if (r >= 0) {
+                                r = safe_atou(value, &weight);
+                                if (r < 0 || weight == 0 || weight > KILL_WEIGHT_MAX)
+                                        log_debug("Invalid user.oomd_weight xattr on %s, ignoring: %s", path, value);
+                                else {
+                                        ctx->kill_weight = weight;
+                                        return 0;
+                                }
+                        }
+                }
+
+                if (path_equal(path, prefix))
+                        return 0;
+
+                r = path_extract_directory(path, &parent);
+                if (r < 0)
+                        return log_debug_errno(r, "Failed to get parent cgroup of %s: %m", path);
+
+                free_and_replace(path, parent);
+        }
+}
+
 int oomd_sort_cgroup_contexts(Hashmap *h, oomd_compare_t compare_func, const char *prefix, OomdCGroupContext ***ret) {
         _cleanup_free_ OomdCGroupContext **sorted = NULL;
         OomdCGroupContext *item;
@@ -230,6 +362,57 @@ int oomd_sort_cgroup_contexts(Hashmap *h, oomd_compare_t compare_func, const cha
         return (int) k;
 }
 
+static int oomd_cgroup_kill_kernel(const char *path) {
+        _cleanup_free_ char *self = NULL;
+        uint64_t n_tasks = 0;
+        int r;
+
+        assert(path);
+
+        /* cgroup.kill takes the whole subtree down with a single write, without us having to enumerate and
+         * signal every process. It cannot exclude ourselves though, so only use it if we are not part of the
+         * subtree. Returns -EOPNOTSUPP if the kernel interface can't be used. */
+
+        if (!cg_kill_supported())
+                return -EOPNOTSUPP;
+
+        r = cg_pid_get_path(SYSTEMD_CGROUP_CONTROLLER, 0, &self);
+        if (r < 0)
+                return r;
+        if (path_startswith(self, path))
+                return -EOPNOTSUPP;
+
+        r = cg_is_empty_recursive(SYSTEMD_CGROUP_CONTROLLER, path);
+        if (r < 0)
+                return r;
+        if (r > 0)
+                return 0;
+
+        /* We never see the individual processes, hence go by the number of tasks for user.oomd_kill, if the
+         * pids controller is enabled. PID1 reads the xattrs once the cgroup is empty, so they need to be set
+         * before the kill. */
+        r = cg_get_attribute_as_uint64("pids", path, "pids.current", &n_tasks);
+        if (r < 0)
+                log_debug_errno(r, "Failed to read pids.current of %s, ignoring: %m", path);
+
+        r = increment_oomd_xattr(path, "user.oomd_ooms", 1);
+        if (r < 0)
+                log_debug_errno(r, "Failed to set user.oomd_ooms before kill: %m");
+
+        if (n_tasks > 0) {
+                r = increment_oomd_xattr(path, "user.oomd_kill", n_tasks);
+                if (r < 0)
+                        log_debug_errno(r, "Failed to set user.oomd_kill before kill: %m");
+        }
+
+        r = cg_kill_kernel_sigkill(path);
+        if (r < 0)
+                return r;
+
+        log_debug("oomd killed %s via cgroup.kill", path);
+        return 1;
+}
+
 int oomd_cgroup_kill(const char *path, bool recurse, bool dry_run) {
         _cleanup_set_free_ Set *pids_killed = NULL;
         int r;
@@ -247,6 +430,19 @@ int oomd_cgroup_kill(const char *path, bool recurse, bool dry_run) {
                 return 0;
         }
 
+        if (recurse) {
+                r = oomd_cgroup_kill_kernel(path);
+                if (IN_SET(r, -ENOENT, -ENODEV)) {
+                        log_debug_errno(r, "Cgroup %s vanished before it could be killed, ignoring: %m", path);
+                        return 0;
+                }
+                if (r != -EOPNOTSUPP) {
+                        if (r == 0)
+                                log_debug("Nothing killed when attempting to kill %s", path);
+                        return r;
+                }
+        }
+
         pids_killed = set_new(NULL);
         if (!pids_killed)
                 return -ENOMEM;
@@ -339,6 +535,57 @@ int oomd_kill_by_pgscan_rate(Hashmap *h, const char *prefix, bool dry_run, char
         return ret;
 }
 
+int oomd_kill_by_growth(Hashmap *h, const char *prefix, bool dry_run, char **ret_selected) {
+        _cleanup_free_ OomdCGroupContext **sorted = NULL;
+        OomdCGroupContext *item;
+        int n, r, ret = 0;
+        int dump_until;
+
+        assert(h);
+        assert(ret_selected);
+
+        HASHMAP_FOREACH(item, h) {
+                if (item->path && prefix && !path_startswith(item->path, prefix))
+                        continue;
+
+                r = oomd_fetch_cgroup_kill_weight(item, prefix);
+                if (r == -ENOMEM)
+                        return r;
+        }
+
+        n = oomd_sort_cgroup_contexts(h, compare_growth_score, prefix, &sorted);
+        if (n < 0)
+                return n;
+
+        dump_until = MIN(n, DUMP_ON_KILL_COUNT);
+        for (int i = 0; i < n; i++) {
+                /* Skip cgroups that neither grow nor use any memory; it won't alleviate pressure.
+                 * Continue since there might be "avoid" cgroups at the end. */
+                if (oomd_growth_score(sorted[i]) == 0 && sorted[i]->current_memory_usage == 0)
+                        continue;
+
+                r = oomd_cgroup_kill(sorted[i]->path, /* recurse= */ true, /* dry_run= */ dry_run);
+                if (r == -ENOMEM)
+                        return r; /* Treat oom as a hard error */
+                if (r < 0) {
+                        RET_GATHER(ret, r);
+                        continue; /* Try to find something else to kill */
+                }
+
+                dump_until = MAX(dump_until, i + 1);
+
+                ret = r;
+                r = strdup_to(ret_selected, sorted[i]->path);
+                if (r < 0)
+                        return r;
+                break;
+        }
+
+        dump_kill_candidates(sorted, n, dump_until, oomd_dump_growth_cgroup_context);
+
+        return ret;
+}
+
 int oomd_kill_by_swap_usage(Hashmap *h, uint64_t threshold_usage, bool dry_run, char **ret_selected) {
         _cleanup_free_ OomdCGroupContext **sorted = NULL;
         int n, r, ret = 0;
@@ -384,7 +631,8 @@ int oomd_kill_by_swap_usage(Hashmap *h, uint64_t threshold_usage, bool dry_run,
 
 int oomd_cgroup_context_acquire(const char *path, OomdCGroupContext **ret) {
         _cleanup_(oomd_cgroup_context_freep) OomdCGroupContext *ctx = NULL;
-        _cleanup_free_ char *p = NULL, *val = NULL;
+        _cleanup_free_ char *p = NULL, *val = NULL, *buf = NULL;
+        _cleanup_close_ int fd = -EBADF;
         bool is_root;
         int r;
 
@@ -411,19 +659,26 @@ int oomd_cgroup_context_acquire(const char *path, OomdCGroupContext **ret) {
                 if (r < 0)
                         return log_debug_errno(r, "Error getting memory used from procfs: %m");
         } else {
-                r = cg_get_attribute_as_uint64(SYSTEMD_CGROUP_CONTROLLER, path, "memory.current", &ctx->current_memory_usage);
+                /* This is called for each monitored cgroup and each of their kill candidates on every
+                 * interval, hence resolve the cgroup path only once, and read all attributes into the same
+                 * buffer. */
+                fd = cg_path_open(SYSTEMD_CGROUP_CONTROLLER, path);
+                if (fd < 0)
+                        return log_debug_errno(fd, "Error opening cgroup %s: %m", path);
+
+                r = cg_get_attribute_as_uint64_at(fd, "memory.current", &buf, &ctx->current_memory_usage);
                 if (r < 0)
                         return log_debug_errno(r, "Error getting memory.current from %s: %m", path);
 
-                r = cg_get_attribute_as_uint64(SYSTEMD_CGROUP_CONTROLLER, path, "memory.min", &ctx->memory_min);
+                r = cg_get_attribute_as_uint64_at(fd, "memory.min", &buf, &ctx->memory_min);
                 if (r < 0)
                         return log_debug_errno(r, "Error getting memory.min from %s: %m", path);
 
-                r = cg_get_attribute_as_uint64(SYSTEMD_CGROUP_CONTROLLER, path, "memory.low", &ctx->memory_low);
+                r = cg_get_attribute_as_uint64_at(fd, "memory.low", &buf, &ctx->memory_low);
                 if (r < 0)
                         return log_debug_errno(r, "Error getting memory.low from %s: %m", path);
 
-                r = cg_get_attribute_as_uint64(SYSTEMD_CGROUP_CONTROLLER, path, "memory.swap.current", &ctx->swap_usage);
+                r = cg_get_attribute_as_uint64_at(fd, "memory.swap.current", &buf, &ctx->swap_usage);
                 if (r == -ENODATA)
                         /* The kernel can be compiled without support for memory.swap.* files,
                          * or it can be disabled with boot param 'swapaccount=0' */
@@ -431,7 +686,7 @@ int oomd_cgroup_context_acquire(const char *path, OomdCGroupContext **ret) {
                 else if (r < 0)
                         return log_debug_errno(r, "Error getting memory.swap.current from %s: %m", path);
 
-                r = cg_get_keyed_attribute(SYSTEMD_CGROUP_CONTROLLER, path, "memory.stat", STRV_MAKE("pgscan"), &val);
+                r = cg_get_keyed_attribute_at(fd, "memory.stat", STRV_MAKE("pgscan"), &val, /* mode= */ 0, &buf);
                 if (r < 0)
                         return log_debug_errno(r, "Error getting pgscan from memory.stat under %s: %m", path);
 
@@ -448,6 +703,39 @@ int oomd_cgroup_context_acquire(const char *path, OomdCGroupContext **ret) {
         return 0;
 }
 
+int oomd_cgroup_pressure_trigger_open(const char *path, PressureType type, usec_t threshold_usec, usec_t window_usec) {
+        _cleanup_free_ char *p = NULL, *trigger = NULL;
+        _cleanup_close_ int fd = -EBADF;
+        ssize_t n;
+        int r;
+
+        assert(path);
+        assert(IN_SET(type, PRESSURE_TYPE_SOME, PRESSURE_TYPE_FULL));
+        assert(threshold_usec > 0);
+        assert(threshold_usec <= window_usec);
+
+        r = cg_get_path(SYSTEMD_CGROUP_CONTROLLER, path, "memory.pressure", &p);
+        if (r < 0)
+                return log_debug_errno(r, "Error getting cgroup memory pressure path from %s: %m", path);
+
+        fd = open(p, O_RDWR|O_NONBLOCK|O_CLOEXEC|O_NOCTTY);
+        if (fd < 0)
+                return log_debug_errno(errno, "Failed to open %s: %m", p);
+
+        if (asprintf(&trigger, "%s " USEC_FMT " " USEC_FMT,
+                     type == PRESSURE_TYPE_FULL ? "full" : "some", threshold_usec, window_usec) < 0)
+                return -ENOMEM;
+
+        /* The kernel wants the trigger in a single write, including the trailing NUL. */
+        n = write(fd, trigger, strlen(trigger) + 1);
+        if (n < 0)
+                return log_debug_errno(errno, "Failed to register memory pressure trigger on %s: %m", p);
+        if ((size_t) n != strlen(trigger) + 1)
+                return log_debug_errno(SYNTHETIC_ERRNO(EIO), "Short write while registering memory pressure trigger on %s.", p);
+
+        return TAKE_FD(fd);
+}
+
 int oomd_system_context_acquire(const char *proc_meminfo_path, OomdSystemContext *ret) {
         _cleanup_fclose_ FILE *f = NULL;
         unsigned field_filled = 0;
@@ -546,6 +834,7 @@ int oomd_insert_cgroup_context(Hashmap *old_h, Hashmap *new_h, const char *path)
                 curr_ctx->mem_pressure_limit = old_ctx->mem_pressure_limit;
                 curr_ctx->mem_pressure_limit_hit_start = old_ctx->mem_pressure_limit_hit_start;
                 curr_ctx->last_had_mem_reclaim = old_ctx->last_had_mem_reclaim;
+                oomd_update_growth(curr_ctx, old_ctx);
         }
 
         if (oomd_pgscan_rate(curr_ctx) > 0)
@@ -576,6 +865,7 @@ void oomd_update_cgroup_contexts_between_hashmaps(Hashmap *old_h, Hashmap *curr_
                 ctx->mem_pressure_limit = old_ctx->mem_pressure_limit;
                 ctx->mem_pressure_limit_hit_start = old_ctx->mem_pressure_limit_hit_start;
                 ctx->last_had_mem_reclaim = old_ctx->last_had_mem_reclaim;
+                oomd_update_growth(ctx, old_ctx);
 
                 if (oomd_pgscan_rate(ctx) > 0)
                         ctx->last_had_mem_reclaim = now(CLOCK_MONOTONIC);
@@ -630,6 +920,26 @@ void oomd_dump_memory_pressure_cgroup_context(const OomdCGroupContext *ctx, FILE
                         strempty(prefix), ctx->last_pgscan);
 }
 
+void oomd_dump_growth_cgroup_context(const OomdCGroupContext *ctx, FILE *f, const char *prefix) {
+        assert(ctx);
+        assert(f);
+
+        oomd_dump_memory_pressure_cgroup_context(ctx, f, prefix);
+
+        fprintf(f,
+                "%s\tMemory Growth: %s%s (average per sample)\n"
+                "%s\tPgscan Rate: %" PRIu64 " (average per sample)\n"
+                "%s\tStalled: %s (average per sample)\n"
+                "%s\tKill Weight: %u%%\n"
+                "%s\tGrowth Score: %" PRIu64 " (from %u samples)\n",
+                strempty(prefix), ctx->memory_growth_avg < 0 ? "-" : "",
+                FORMAT_BYTES(ctx->memory_growth_avg < 0 ? (uint64_t) -ctx->memory_growth_avg : (uint64_t) ctx->memory_growth_avg),
+                strempty(prefix), ctx->pgscan_rate_avg,
+                strempty(prefix), FORMAT_TIMESPAN(ctx->pressure_growth_avg, USEC_PER_MSEC),
+                strempty(prefix), ctx->kill_weight > 0 ? ctx->kill_weight : DEFAULT_KILL_WEIGHT,
+                strempty(prefix), oomd_growth_score(ctx), ctx->n_growth_samples);
+}
+
 void oomd_dump_system_context(const OomdSystemContext *ctx, FILE *f, const char *prefix) {
         assert(ctx);
         assert(f);
@@ -644,3 +954,10 @@ void oomd_dump_system_context(const OomdSystemContext *ctx, FILE *f, const char
                 FORMAT_BYTES(ctx->swap_used),
                 FORMAT_BYTES(ctx->swap_total));
 }
+
+static const char* const oomd_kill_selection_table[_OOMD_KILL_SELECTION_MAX] = {
+        [OOMD_KILL_SELECTION_RECLAIM] = "reclaim",
+        [OOMD_KILL_SELECTION_GROWTH]  = "growth",
+};
+
+DEFINE_STRING_TABLE_LOOKUP(oomd_kill_selection, OomdKillSelection);
@@ -10,6 +10,19 @@
 #define DUMP_ON_KILL_COUNT 10
 #define GROWING_SIZE_PERCENTILE 80
 
+/* Weight of a new sample in the smoothed growth rates, as a power of two: each sample counts 1/4. */
+#define GROWTH_AVG_SHIFT 2
+/* The kill weight of cgroups without the user.oomd_weight xattr, in percent. */
+#define DEFAULT_KILL_WEIGHT 100U
+#define KILL_WEIGHT_MAX 10000U
+
+typedef enum OomdKillSelection {
+        OOMD_KILL_SELECTION_RECLAIM, /* largest pgscan rate since the previous sample, then memory usage */
+        OOMD_KILL_SELECTION_GROWTH,  /* largest smoothed growth of memory usage and pgscan, see oomd_growth_score() */
+        _OOMD_KILL_SELECTION_MAX,
+        _OOMD_KILL_SELECTION_INVALID = -EINVAL,
+} OomdKillSelection;
+
 extern const struct hash_ops oomd_cgroup_ctx_hash_ops;
 
 typedef struct OomdCGroupContext OomdCGroupContext;
@@ -37,6 +50,18 @@ struct OomdCGroupContext {
         loadavg_t mem_pressure_limit;
         usec_t mem_pressure_limit_hit_start;
         usec_t last_had_mem_reclaim;
+
+        /* Exponentially weighted moving averages of the per-sample growth of memory.current, pgscan and
+         * the time stalled on memory, carried over between samples. Used when killing by growth. */
+        uint64_t last_memory_usage;
+        usec_t last_pressure_total;
+        int64_t memory_growth_avg;
+        uint64_t pgscan_rate_avg;
+        usec_t pressure_growth_avg;
+        unsigned n_growth_samples;
+
+        /* From the user.oomd_weight xattr, in percent. Only used when killing by growth. */
+        unsigned kill_weight;
 };
 
 struct OomdSystemContext {
@@ -69,6 +94,14 @@ bool oomd_swap_free_below(const OomdSystemContext *ctx, int threshold_permyriad)
 /* Returns pgscan - last_pgscan, accounting for corner cases. */
 uint64_t oomd_pgscan_rate(const OomdCGroupContext *c);
 
+/* Updates the smoothed growth rates of `c` from the previous sample `old`. */
+void oomd_update_growth(OomdCGroupContext *c, const OomdCGroupContext *old);
+
+/* Returns the score used when killing by growth: the smoothed memory growth plus the smoothed amount of
+ * memory scanned for reclaim, both in bytes per sample, boosted by up to a factor of two by the fraction of
+ * time the cgroup stalled on memory, and scaled by the kill weight. */
+uint64_t oomd_growth_score(const OomdCGroupContext *c);
+
 /* The compare functions will sort from largest to smallest, putting all the contexts with "avoid" at the end
  * (after the smallest values). */
 static inline int compare_pgscan_rate_and_memory_usage(OomdCGroupContext * const *c1, OomdCGroupContext * const *c2) {
@@ -104,6 +137,23 @@ static inline int compare_swap_usage(OomdCGroupContext * const *c1, OomdCGroupCo
         return CMP((*c2)->swap_usage, (*c1)->swap_usage);
 }
 
+static inline int compare_growth_score(OomdCGroupContext * const *c1, OomdCGroupContext * const *c2) {
+        int r;
+
+        assert(c1);
+        assert(c2);
+
+        r = CMP((*c1)->preference, (*c2)->preference);
+        if (r != 0)
+                return r;
+
+        r = CMP(oomd_growth_score(*c2), oomd_growth_score(*c1));
+        if (r != 0)
+                return r;
+
+        return CMP((*c2)->current_memory_usage, (*c1)->current_memory_usage);
+}
+
 /* Get an array of OomdCGroupContexts from `h`, qsorted from largest to smallest values according to `compare_func`.
  * If `prefix` is not NULL, only include OomdCGroupContexts whose paths start with prefix. Otherwise all paths are sorted.
  * Returns the number of sorted items; negative on error. */
@@ -119,7 +169,14 @@ int oomd_sort_cgroup_contexts(Hashmap *h, oomd_compare_t compare_func, const cha
  * negative on all other errors. */
 int oomd_fetch_cgroup_oom_preference(OomdCGroupContext *ctx, const char *prefix);
 
-/* Returns a negative value on error, 0 if no processes were killed, or 1 if processes were killed. */
+/* Set `ctx->kill_weight` from the user.oomd_weight xattr of the closest cgroup between `ctx` and `prefix`
+ * (both inclusive) that has one, honoring the same ownership rules as oomd_fetch_cgroup_oom_preference(),
+ * or DEFAULT_KILL_WEIGHT if there is none. */
+int oomd_fetch_cgroup_kill_weight(OomdCGroupContext *ctx, const char *prefix);
+
+/* Returns a negative value on error, 0 if no processes were killed, or 1 if processes were killed.
+ * If `recurse` is true and cgroup.kill is available, the kill is delegated to the kernel, in which case
+ * processes may still be exiting by the time this returns. Watch cgroup.events to learn when they're gone. */
 int oomd_cgroup_kill(const char *path, bool recurse, bool dry_run);
 
 /* The following oomd_kill_by_* functions return 1 if processes were killed, or negative otherwise. */
@@ -127,11 +184,17 @@ int oomd_cgroup_kill(const char *path, bool recurse, bool dry_run);
  * everything in `h` is a candidate.
  * Returns the killed cgroup in ret_selected. */
 int oomd_kill_by_pgscan_rate(Hashmap *h, const char *prefix, bool dry_run, char **ret_selected);
+int oomd_kill_by_growth(Hashmap *h, const char *prefix, bool dry_run, char **ret_selected);
 int oomd_kill_by_swap_usage(Hashmap *h, uint64_t threshold_usage, bool dry_run, char **ret_selected);
 
 int oomd_cgroup_context_acquire(const char *path, OomdCGroupContext **ret);
 int oomd_system_context_acquire(const char *proc_swaps_path, OomdSystemContext *ret);
 
+/* Registers a PSI trigger on the memory.pressure file of the cgroup `path`. The returned fd reports EPOLLPRI
+ * once tasks of the cgroup were stalled for more than `threshold_usec` within `window_usec`, so that callers
+ * can wait for memory pressure instead of polling for it. Returns the fd on success, negative on error. */
+int oomd_cgroup_pressure_trigger_open(const char *path, PressureType type, usec_t threshold_usec, usec_t window_usec);
+
 /* Get the OomdCGroupContext of `path` and insert it into `new_h`. The key for the inserted context will be `path`.
  *
  * `old_h` is used to get data used to calculate prior interval information. `old_h` can be NULL in which case there
@@ -143,4 +206,8 @@ void oomd_update_cgroup_contexts_between_hashmaps(Hashmap *old_h, Hashmap *curr_
 
 void oomd_dump_swap_cgroup_context(const OomdCGroupContext *ctx, FILE *f, const char *prefix);
 void oomd_dump_memory_pressure_cgroup_context(const OomdCGroupContext *ctx, FILE *f, const char *prefix);
+void oomd_dump_growth_cgroup_context(const OomdCGroupContext *ctx, FILE *f, const char *prefix);
 void oomd_dump_system_context(const OomdSystemContext *ctx, FILE *f, const char *prefix);
+
+const char* oomd_kill_selection_to_string(OomdKillSelection s) _const_;
+OomdKillSelection oomd_kill_selection_from_string(const char *s) _pure_;
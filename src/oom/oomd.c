@@ -22,12 +22,16 @@ static bool arg_dry_run = false;
 static int arg_swap_used_limit_permyriad = -1;
 static int arg_mem_pressure_limit_permyriad = -1;
 static usec_t arg_mem_pressure_usec = 0;
+static OomdKillSelection arg_mem_pressure_kill_selection = OOMD_KILL_SELECTION_RECLAIM;
+
+static DEFINE_CONFIG_PARSE_ENUM(config_parse_kill_selection, oomd_kill_selection, OomdKillSelection, "Failed to parse kill selection");
 
 static int parse_config(void) {
         static const ConfigTableItem items[] = {
-                { "OOM", "SwapUsedLimit",                    config_parse_permyriad, 0, &arg_swap_used_limit_permyriad    },
-                { "OOM", "DefaultMemoryPressureLimit",       config_parse_permyriad, 0, &arg_mem_pressure_limit_permyriad },
-                { "OOM", "DefaultMemoryPressureDurationSec", config_parse_sec,       0, &arg_mem_pressure_usec            },
+                { "OOM", "SwapUsedLimit",                    config_parse_permyriad,      0, &arg_swap_used_limit_permyriad    },
+                { "OOM", "DefaultMemoryPressureLimit",       config_parse_permyriad,      0, &arg_mem_pressure_limit_permyriad },
+                { "OOM", "DefaultMemoryPressureDurationSec", config_parse_sec,            0, &arg_mem_pressure_usec            },
+                { "OOM", "MemoryPressureKillSelection",      config_parse_kill_selection, 0, &arg_mem_pressure_kill_selection  },
                 {}
         };
 
@@ -182,6 +186,7 @@ static int run(int argc, char *argv[]) {
                         arg_swap_used_limit_permyriad,
                         arg_mem_pressure_limit_permyriad,
                         arg_mem_pressure_usec,
+                        arg_mem_pressure_kill_selection,
                         fd);
         if (r < 0)
                 return log_error_errno(r, "Failed to start up daemon: %m");
@@ -406,6 +406,73 @@ static void test_oomd_sort_cgroups(void) {
         sorted_cgroups = mfree(sorted_cgroups);
 }
 
+static void test_oomd_growth(void) {
+        OomdCGroupContext old = {
+                .path = (char*) "/herp.slice",
+                .current_memory_usage = 1000,
+                .pgscan = 10,
+                .memory_pressure.total = 100,
+        };
+        OomdCGroupContext c = {
+                .path = (char*) "/herp.slice",
+                .current_memory_usage = 5000,
+                .pgscan = 30,
+                .last_pgscan = 10,
+                .memory_pressure.total = 500,
+        };
+        OomdCGroupContext idle = {
+                .path = (char*) "/derp.slice",
+                .current_memory_usage = 5000,
+                .n_growth_samples = 1,
+        };
+        OomdCGroupContext next;
+
+        /* Without samples there is nothing to go by */
+        assert_se(oomd_growth_score(&c) == 0);
+
+        /* The first sample is taken as is */
+        oomd_update_growth(&c, &old);
+        assert_se(c.last_memory_usage == 1000);
+        assert_se(c.last_pressure_total == 100);
+        assert_se(c.memory_growth_avg == 4000);
+        assert_se(c.pgscan_rate_avg == 20);
+        assert_se(c.pressure_growth_avg == 400);
+        assert_se(c.n_growth_samples == 1);
+        assert_se(oomd_growth_score(&c) > 4000 + 20 * page_size());
+
+        /* Later samples only move the average by a fraction, shrinking memory decreases it */
+        next = (OomdCGroupContext) {
+                .path = (char*) "/herp.slice",
+                .current_memory_usage = 1000,
+                .pgscan = 30,
+                .last_pgscan = 30,
+                .memory_pressure.total = 500,
+        };
+        oomd_update_growth(&next, &c);
+        assert_se(next.memory_growth_avg == 4000 + (-4000 - 4000) / (1 << GROWTH_AVG_SHIFT));
+        assert_se(next.pgscan_rate_avg == 20 - (20 >> GROWTH_AVG_SHIFT));
+        assert_se(next.pressure_growth_avg == 400 - (400 >> GROWTH_AVG_SHIFT));
+        assert_se(next.n_growth_samples == 2);
+
+        /* A cgroup that does not grow is not picked over one that does, regardless of its size */
+        assert_se(oomd_growth_score(&idle) == 0);
+        assert_se(compare_growth_score(&(OomdCGroupContext*) { &c }, &(OomdCGroupContext*) { &idle }) < 0);
+
+        /* The weight scales the score */
+        idle = c;
+        idle.kill_weight = 2 * DEFAULT_KILL_WEIGHT;
+        assert_se(oomd_growth_score(&idle) == 2 * oomd_growth_score(&c));
+        assert_se(compare_growth_score(&(OomdCGroupContext*) { &idle }, &(OomdCGroupContext*) { &c }) < 0);
+        idle.kill_weight = KILL_WEIGHT_MAX;
+        idle.memory_growth_avg = INT64_MAX;
+        assert_se(oomd_growth_score(&idle) == UINT64_MAX);
+
+        assert_se(oomd_kill_selection_from_string("reclaim") == OOMD_KILL_SELECTION_RECLAIM);
+        assert_se(oomd_kill_selection_from_string("growth") == OOMD_KILL_SELECTION_GROWTH);
+        assert_se(oomd_kill_selection_from_string("foo") < 0);
+        assert_se(streq(oomd_kill_selection_to_string(OOMD_KILL_SELECTION_GROWTH), "growth"));
+}
+
 static void test_oomd_fetch_cgroup_oom_preference(void) {
         _cleanup_(oomd_cgroup_context_freep) OomdCGroupContext *ctx = NULL;
         _cleanup_free_ char *cgroup = NULL;
@@ -488,6 +555,39 @@ static void test_oomd_fetch_cgroup_oom_preference(void) {
         }
 }
 
+static void test_oomd_cgroup_pressure_trigger_open(void) {
+        _cleanup_free_ char *cgroup = NULL;
+        _cleanup_close_ int fd = -EBADF;
+        CGroupMask mask;
+
+        if (geteuid() != 0)
+                return (void) log_tests_skipped("not root");
+
+        if (!is_pressure_supported())
+                return (void) log_tests_skipped("system does not support pressure");
+
+        if (cg_all_unified() <= 0)
+                return (void) log_tests_skipped("cgroups are not running in unified mode");
+
+        assert_se(cg_mask_supported(&mask) >= 0);
+
+        if (!FLAGS_SET(mask, CGROUP_MASK_MEMORY))
+                return (void) log_tests_skipped("cgroup memory controller is not available");
+
+        assert_se(cg_pid_get_path(NULL, 0, &cgroup) >= 0);
+
+        fd = oomd_cgroup_pressure_trigger_open(cgroup, PRESSURE_TYPE_SOME, 150 * USEC_PER_MSEC, 2 * USEC_PER_SEC);
+        if (ERRNO_IS_NEG_NOT_SUPPORTED(fd) || fd == -EACCES)
+                return (void) log_tests_skipped_errno(fd, "memory pressure triggers are not supported");
+        assert_se(fd >= 0);
+        fd = safe_close(fd);
+
+        /* The window is out of the range the kernel accepts. */
+        assert_se(oomd_cgroup_pressure_trigger_open(cgroup, PRESSURE_TYPE_FULL, 1, 1) < 0);
+
+        assert_se(oomd_cgroup_pressure_trigger_open("/oomd-test-nonexistent", PRESSURE_TYPE_SOME, 150 * USEC_PER_MSEC, 2 * USEC_PER_SEC) == -ENOENT);
+}
+
 int main(void) {
         int r;
 
@@ -498,6 +598,7 @@ int main(void) {
         test_oomd_pressure_above();
         test_oomd_mem_and_swap_free_below();
         test_oomd_sort_cgroups();
+        test_oomd_growth();
 
         /* The following tests operate on live cgroups */
 
@@ -508,6 +609,7 @@ int main(void) {
         test_oomd_cgroup_kill();
         test_oomd_cgroup_context_acquire_and_insert();
         test_oomd_fetch_cgroup_oom_preference();
+        test_oomd_cgroup_pressure_trigger_open();
 
         return 0;
 }
@@ -10,6 +10,7 @@
 #include <linux/loop.h>
 #include <sys/file.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 
 #include "sd-device.h"
@@ -168,6 +169,7 @@ static uint64_t arg_sector_size = 0;
 static ImagePolicy *arg_image_policy = NULL;
 static Architecture arg_architecture = _ARCHITECTURE_INVALID;
 static int arg_offline = -1;
+static unsigned arg_jobs = 1;
 static char **arg_copy_from = NULL;
 static char *arg_copy_source = NULL;
 static char *arg_make_ddi = NULL;
@@ -318,6 +320,8 @@ typedef struct Partition {
 
         struct iovec roothash;
 
+        usec_t write_usec;
+
         char *split_name_format;
         char *split_path;
 
@@ -437,6 +441,7 @@ static Partition *partition_new(void) {
                 .growfs = -1,
                 .verity_data_block_size = UINT64_MAX,
                 .verity_hash_block_size = UINT64_MAX,
+                .write_usec = USEC_INFINITY,
         };
 
         return p;
@@ -2980,8 +2985,8 @@ static int context_dump_partitions(Context *context) {
         _cleanup_(table_unrefp) Table *t = NULL;
         uint64_t sum_padding = 0, sum_size = 0;
         int r;
-        const size_t roothash_col = 14, dropin_files_col = 15, split_path_col = 16;
-        bool has_roothash = false, has_dropin_files = false, has_split_path = false;
+        const size_t roothash_col = 14, dropin_files_col = 15, split_path_col = 16, write_time_col = 17;
+        bool has_roothash = false, has_dropin_files = false, has_split_path = false, has_write_time = false;
 
         if ((arg_json_format_flags & SD_JSON_FORMAT_OFF) && context->n_partitions == 0) {
                 log_info("Empty partition table.");
@@ -3004,7 +3009,8 @@ static int context_dump_partitions(Context *context) {
                       "activity",
                       "roothash",
                       "drop-in files",
-                      "split path");
+                      "split path",
+                      "write time");
         if (!t)
                 return log_oom();
 
@@ -3017,7 +3023,7 @@ static int context_dump_partitions(Context *context) {
                         (void) table_set_display(t, (size_t) 0, (size_t) 1, (size_t) 2, (size_t) 3, (size_t) 4,
                                                     (size_t) 5, (size_t) 6, (size_t) 7, (size_t) 8, (size_t) 10,
                                                     (size_t) 11, (size_t) 13, roothash_col, dropin_files_col,
-                                                    split_path_col);
+                                                    split_path_col, write_time_col);
         }
 
         (void) table_set_align_percent(t, table_get_cell(t, 0, 5), 100);
@@ -3083,13 +3089,15 @@ static int context_dump_partitions(Context *context) {
                                 TABLE_STRING, activity ?: "unchanged",
                                 TABLE_STRING, rh,
                                 TABLE_STRV, p->drop_in_files,
-                                TABLE_STRING, empty_to_null(p->split_path) ?: "-");
+                                TABLE_STRING, empty_to_null(p->split_path) ?: "-",
+                                TABLE_TIMESPAN_MSEC, p->write_usec);
                 if (r < 0)
                         return table_log_add_error(r);
 
                 has_roothash = has_roothash || !isempty(rh);
                 has_dropin_files = has_dropin_files || !strv_isempty(p->drop_in_files);
                 has_split_path = has_split_path || !isempty(p->split_path);
+                has_write_time = has_write_time || p->write_usec != USEC_INFINITY;
         }
 
         if ((arg_json_format_flags & SD_JSON_FORMAT_OFF) && (sum_padding > 0 || sum_size > 0)) {
@@ -3116,6 +3124,7 @@ static int context_dump_partitions(Context *context) {
                                 TABLE_EMPTY,
                                 TABLE_EMPTY,
                                 TABLE_EMPTY,
+                                TABLE_EMPTY,
                                 TABLE_EMPTY);
                 if (r < 0)
                         return table_log_add_error(r);
@@ -3139,6 +3148,12 @@ static int context_dump_partitions(Context *context) {
                         return log_error_errno(r, "Failed to set columns to display: %m");
         }
 
+        if (!has_write_time) {
+                r = table_hide_column_from_display(t, write_time_col);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to set columns to display: %m");
+        }
+
         return table_print_with_pager(t, arg_json_format_flags, arg_pager_flags, arg_legend);
 }
 
@@ -4520,99 +4535,113 @@ static int progress_bytes(uint64_t n_bytes, void *userdata) {
         return 0;
 }
 
-static int context_copy_blocks(Context *context) {
+static bool partition_wants_copy_blocks(const Partition *p) {
+        assert(p);
+
+        return p->copy_blocks_fd >= 0 &&
+                !p->dropped &&
+                !PARTITION_EXISTS(p) && /* Never copy over existing partitions */
+                !partition_type_defer(&p->type);
+}
+
+static int partition_copy_blocks(Context *context, Partition *p) {
+        _cleanup_(partition_target_freep) PartitionTarget *t = NULL;
         int r;
 
         assert(context);
+        assert(p);
+        assert(partition_wants_copy_blocks(p));
+        assert(p->new_size != UINT64_MAX);
 
-        /* Copy in file systems on the block level */
+        size_t extra = p->encrypt != ENCRYPT_OFF ? LUKS2_METADATA_KEEP_FREE : 0;
 
-        LIST_FOREACH(partitions, p, context->partitions) {
-                _cleanup_(partition_target_freep) PartitionTarget *t = NULL;
+        if (p->copy_blocks_size == UINT64_MAX)
+                p->copy_blocks_size = LESS_BY(p->new_size, extra);
 
-                if (p->copy_blocks_fd < 0)
-                        continue;
-
-                if (p->dropped)
-                        continue;
+        assert(p->new_size >= p->copy_blocks_size + extra);
 
-                if (PARTITION_EXISTS(p)) /* Never copy over existing partitions */
-                        continue;
+        usec_t start_timestamp = now(CLOCK_MONOTONIC);
 
-                if (partition_type_defer(&p->type))
-                        continue;
+        r = partition_target_prepare(context, p, p->new_size,
+                                     /*need_path=*/ p->encrypt != ENCRYPT_OFF || p->siblings[VERITY_HASH],
+                                     &t);
+        if (r < 0)
+                return r;
 
-                assert(p->new_size != UINT64_MAX);
+        if (p->encrypt != ENCRYPT_OFF && t->loop) {
+                r = partition_encrypt(context, p, t, /* offline = */ false);
+                if (r < 0)
+                        return r;
+        }
 
-                size_t extra = p->encrypt != ENCRYPT_OFF ? LUKS2_METADATA_KEEP_FREE : 0;
+        if (p->copy_blocks_offset == UINT64_MAX)
+                log_info("Copying in '%s' (%s) on block level into future partition %" PRIu64 ".",
+                         p->copy_blocks_path, FORMAT_BYTES(p->copy_blocks_size), p->partno);
+        else {
+                log_info("Copying in '%s' @ %" PRIu64 " (%s) on block level into future partition %" PRIu64 ".",
+                         p->copy_blocks_path, p->copy_blocks_offset, FORMAT_BYTES(p->copy_blocks_size), p->partno);
 
-                if (p->copy_blocks_size == UINT64_MAX)
-                        p->copy_blocks_size = LESS_BY(p->new_size, extra);
+                if (lseek(p->copy_blocks_fd, p->copy_blocks_offset, SEEK_SET) < 0)
+                        return log_error_errno(errno, "Failed to seek to copy blocks offset in %s: %m", p->copy_blocks_path);
+        }
 
-                assert(p->new_size >= p->copy_blocks_size + extra);
+        /* No progress bar if other partitions are written at the same time, they'd overwrite each other */
+        r = copy_bytes_full(p->copy_blocks_fd, partition_target_fd(t), p->copy_blocks_size, COPY_REFLINK, /* ret_remains= */ NULL, /* ret_remains_size= */ NULL, arg_jobs > 1 ? NULL : progress_bytes, p);
+        clear_progress_bar(/* prefix= */ NULL);
+        if (r < 0)
+                return log_error_errno(r, "Failed to copy in data from '%s': %m", p->copy_blocks_path);
 
-                usec_t start_timestamp = now(CLOCK_MONOTONIC);
+        log_info("Copying in of '%s' on block level completed.", p->copy_blocks_path);
 
-                r = partition_target_prepare(context, p, p->new_size,
-                                             /*need_path=*/ p->encrypt != ENCRYPT_OFF || p->siblings[VERITY_HASH],
-                                             &t);
+        if (p->encrypt != ENCRYPT_OFF && !t->loop) {
+                r = partition_encrypt(context, p, t, /* offline = */ true);
                 if (r < 0)
                         return r;
+        }
 
-                if (p->encrypt != ENCRYPT_OFF && t->loop) {
-                        r = partition_encrypt(context, p, t, /* offline = */ false);
-                        if (r < 0)
-                                return r;
-                }
+        r = partition_target_sync(context, p, t);
+        if (r < 0)
+                return r;
 
-                if (p->copy_blocks_offset == UINT64_MAX)
-                        log_info("Copying in '%s' (%s) on block level into future partition %" PRIu64 ".",
-                                 p->copy_blocks_path, FORMAT_BYTES(p->copy_blocks_size), p->partno);
-                else {
-                        log_info("Copying in '%s' @ %" PRIu64 " (%s) on block level into future partition %" PRIu64 ".",
-                                 p->copy_blocks_path, p->copy_blocks_offset, FORMAT_BYTES(p->copy_blocks_size), p->partno);
+        usec_t time_spent = usec_sub_unsigned(now(CLOCK_MONOTONIC), start_timestamp);
+        if (time_spent > 250 * USEC_PER_MSEC) /* Show throughput, but not if we spent too little time on it, since it's just noise then */
+                log_info("Block level copying and synchronization of partition %" PRIu64 " complete in %s (%s/s).",
+                         p->partno, FORMAT_TIMESPAN(time_spent, 0), FORMAT_BYTES((uint64_t) ((double) p->copy_blocks_size / time_spent * USEC_PER_SEC)));
+        else
+                log_info("Block level copying and synchronization of partition %" PRIu64 " complete in %s.",
+                         p->partno, FORMAT_TIMESPAN(time_spent, 0));
 
-                        if (lseek(p->copy_blocks_fd, p->copy_blocks_offset, SEEK_SET) < 0)
-                                return log_error_errno(errno, "Failed to seek to copy blocks offset in %s: %m", p->copy_blocks_path);
-                }
+        if (p->siblings[VERITY_HASH] && !partition_type_defer(&p->siblings[VERITY_HASH]->type)) {
+                r = partition_format_verity_hash(context, p->siblings[VERITY_HASH],
+                                                 /* node = */ NULL, partition_target_path(t));
+                if (r < 0)
+                        return r;
+        }
 
-                r = copy_bytes_full(p->copy_blocks_fd, partition_target_fd(t), p->copy_blocks_size, COPY_REFLINK, /* ret_remains= */ NULL, /* ret_remains_size= */ NULL, progress_bytes, p);
-                clear_progress_bar(/* prefix= */ NULL);
+        if (p->siblings[VERITY_SIG] && !partition_type_defer(&p->siblings[VERITY_SIG]->type)) {
+                r = partition_format_verity_sig(context, p->siblings[VERITY_SIG]);
                 if (r < 0)
-                        return log_error_errno(r, "Failed to copy in data from '%s': %m", p->copy_blocks_path);
+                        return r;
+        }
 
-                log_info("Copying in of '%s' on block level completed.", p->copy_blocks_path);
+        p->write_usec = usec_sub_unsigned(now(CLOCK_MONOTONIC), start_timestamp);
+        return 0;
+}
 
-                if (p->encrypt != ENCRYPT_OFF && !t->loop) {
-                        r = partition_encrypt(context, p, t, /* offline = */ true);
-                        if (r < 0)
-                                return r;
-                }
+static int context_copy_blocks(Context *context) {
+        int r;
 
-                r = partition_target_sync(context, p, t);
-                if (r < 0)
-                        return r;
+        assert(context);
 
-                usec_t time_spent = usec_sub_unsigned(now(CLOCK_MONOTONIC), start_timestamp);
-                if (time_spent > 250 * USEC_PER_MSEC) /* Show throughput, but not if we spent too little time on it, since it's just noise then */
-                        log_info("Block level copying and synchronization of partition %" PRIu64 " complete in %s (%s/s).",
-                                 p->partno, FORMAT_TIMESPAN(time_spent, 0), FORMAT_BYTES((uint64_t) ((double) p->copy_blocks_size / time_spent * USEC_PER_SEC)));
-                else
-                        log_info("Block level copying and synchronization of partition %" PRIu64 " complete in %s.",
-                                 p->partno, FORMAT_TIMESPAN(time_spent, 0));
+        /* Copy in file systems on the block level */
 
-                if (p->siblings[VERITY_HASH] && !partition_type_defer(&p->siblings[VERITY_HASH]->type)) {
-                        r = partition_format_verity_hash(context, p->siblings[VERITY_HASH],
-                                                         /* node = */ NULL, partition_target_path(t));
-                        if (r < 0)
-                                return r;
-                }
+        LIST_FOREACH(partitions, p, context->partitions) {
+                if (!partition_wants_copy_blocks(p))
+                        continue;
 
-                if (p->siblings[VERITY_SIG] && !partition_type_defer(&p->siblings[VERITY_SIG]->type)) {
-                        r = partition_format_verity_sig(context, p->siblings[VERITY_SIG]);
-                        if (r < 0)
-                                return r;
-                }
+                r = partition_copy_blocks(context, p);
+                if (r < 0)
+                        return r;
         }
 
         return 0;
@@ -4914,14 +4943,14 @@ static int do_copy_files(Context *context, Partition *p, const char *root) {
                                                 sfd, ".",
                                                 pfd, fn,
                                                 UID_INVALID, GID_INVALID,
-                                                COPY_REFLINK|COPY_HOLES|COPY_MERGE|COPY_REPLACE|COPY_SIGINT|COPY_HARDLINKS|COPY_ALL_XATTRS|COPY_GRACEFUL_WARN|COPY_TRUNCATE,
+                                                COPY_REFLINK|COPY_HOLES|COPY_MERGE|COPY_REPLACE|COPY_SIGINT|COPY_HARDLINKS|COPY_ALL_XATTRS|COPY_GRACEFUL_WARN|COPY_TRUNCATE|COPY_PARALLEL,
                                                 denylist, subvolumes_by_source_inode);
                         } else
                                 r = copy_tree_at(
                                                 sfd, ".",
                                                 tfd, ".",
                                                 UID_INVALID, GID_INVALID,
-                                                COPY_REFLINK|COPY_HOLES|COPY_MERGE|COPY_REPLACE|COPY_SIGINT|COPY_HARDLINKS|COPY_ALL_XATTRS|COPY_GRACEFUL_WARN|COPY_TRUNCATE,
+                                                COPY_REFLINK|COPY_HOLES|COPY_MERGE|COPY_REPLACE|COPY_SIGINT|COPY_HARDLINKS|COPY_ALL_XATTRS|COPY_GRACEFUL_WARN|COPY_TRUNCATE|COPY_PARALLEL,
                                                 denylist, subvolumes_by_source_inode);
                         if (r < 0)
                                 return log_error_errno(r, "Failed to copy '%s%s' to '%s%s': %m",
@@ -5101,138 +5130,151 @@ static int partition_populate_filesystem(Context *context, Partition *p, const c
         return 0;
 }
 
-static int context_mkfs(Context *context) {
+static bool partition_wants_mkfs(const Partition *p) {
+        assert(p);
+
+        return p->format &&
+                p->copy_blocks_fd < 0 && /* Minimized partitions will use the copy blocks logic */
+                !p->dropped &&
+                !PARTITION_EXISTS(p) && /* Never format existing partitions */
+                !partition_type_defer(&p->type);
+}
+
+static int partition_mkfs(Context *context, Partition *p) {
+        _cleanup_(rm_rf_physical_and_freep) char *root = NULL;
+        _cleanup_(partition_target_freep) PartitionTarget *t = NULL;
+        _cleanup_strv_free_ char **extra_mkfs_options = NULL;
+        usec_t start_timestamp;
         int r;
 
         assert(context);
+        assert(p);
+        assert(partition_wants_mkfs(p));
+        assert(p->offset != UINT64_MAX);
+        assert(p->new_size != UINT64_MAX);
+        assert(p->new_size >= (p->encrypt != ENCRYPT_OFF ? LUKS2_METADATA_KEEP_FREE : 0));
 
-        /* Make a file system */
+        start_timestamp = now(CLOCK_MONOTONIC);
 
-        LIST_FOREACH(partitions, p, context->partitions) {
-                _cleanup_(rm_rf_physical_and_freep) char *root = NULL;
-                _cleanup_(partition_target_freep) PartitionTarget *t = NULL;
-                _cleanup_strv_free_ char **extra_mkfs_options = NULL;
+        /* If we're doing encryption, keep free space at the end which is required
+         * for cryptsetup's offline encryption. */
+        r = partition_target_prepare(context, p,
+                                     p->new_size - (p->encrypt != ENCRYPT_OFF ? LUKS2_METADATA_KEEP_FREE : 0),
+                                     /*need_path=*/ true,
+                                     &t);
+        if (r < 0)
+                return r;
 
-                if (p->dropped)
-                        continue;
+        if (p->encrypt != ENCRYPT_OFF && t->loop) {
+                r = partition_target_grow(t, p->new_size);
+                if (r < 0)
+                        return r;
 
-                if (PARTITION_EXISTS(p)) /* Never format existing partitions */
-                        continue;
+                r = partition_encrypt(context, p, t, /* offline = */ false);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to encrypt device: %m");
+        }
 
-                if (!p->format)
-                        continue;
+        log_info("Formatting future partition %" PRIu64 ".", p->partno);
 
-                /* Minimized partitions will use the copy blocks logic so skip those here. */
-                if (p->copy_blocks_fd >= 0)
-                        continue;
+        /* If we're not writing to a loop device or if we're populating a read-only filesystem, we
+         * have to populate using the filesystem's mkfs's --root (or equivalent) option. To do that,
+         * we need to set up the final directory tree beforehand. */
 
-                if (partition_type_defer(&p->type))
-                        continue;
+        if (partition_needs_populate(p) && (!t->loop || fstype_is_ro(p->format))) {
+                if (!mkfs_supports_root_option(p->format))
+                        return log_error_errno(SYNTHETIC_ERRNO(ENODEV),
+                                                "Loop device access is required to populate %s filesystems.",
+                                                p->format);
 
-                assert(p->offset != UINT64_MAX);
-                assert(p->new_size != UINT64_MAX);
-                assert(p->new_size >= (p->encrypt != ENCRYPT_OFF ? LUKS2_METADATA_KEEP_FREE : 0));
-
-                /* If we're doing encryption, keep free space at the end which is required
-                 * for cryptsetup's offline encryption. */
-                r = partition_target_prepare(context, p,
-                                             p->new_size - (p->encrypt != ENCRYPT_OFF ? LUKS2_METADATA_KEEP_FREE : 0),
-                                             /*need_path=*/ true,
-                                             &t);
+                r = partition_populate_directory(context, p, &root);
                 if (r < 0)
                         return r;
+        }
 
-                if (p->encrypt != ENCRYPT_OFF && t->loop) {
-                        r = partition_target_grow(t, p->new_size);
-                        if (r < 0)
-                                return r;
+        r = mkfs_options_from_env("REPART", p->format, &extra_mkfs_options);
+        if (r < 0)
+                return log_error_errno(r,
+                                       "Failed to determine mkfs command line options for '%s': %m",
+                                       p->format);
 
-                        r = partition_encrypt(context, p, t, /* offline = */ false);
-                        if (r < 0)
-                                return log_error_errno(r, "Failed to encrypt device: %m");
-                }
+        r = make_filesystem(partition_target_path(t), p->format, strempty(p->new_label), root,
+                            p->fs_uuid, arg_discard, /* quiet = */ false,
+                            context->fs_sector_size, extra_mkfs_options);
+        if (r < 0)
+                return r;
 
-                log_info("Formatting future partition %" PRIu64 ".", p->partno);
+        /* The mkfs binary we invoked might have removed our temporary file when we're not operating
+         * on a loop device, so open the file again to make sure our file descriptor points to actual
+         * new file. */
 
-                /* If we're not writing to a loop device or if we're populating a read-only filesystem, we
-                 * have to populate using the filesystem's mkfs's --root (or equivalent) option. To do that,
-                 * we need to set up the final directory tree beforehand. */
+        if (t->fd >= 0 && t->path && !t->loop) {
+                safe_close(t->fd);
+                t->fd = open(t->path, O_RDWR|O_CLOEXEC);
+                if (t->fd < 0)
+                        return log_error_errno(errno, "Failed to reopen temporary file: %m");
+        }
 
-                if (partition_needs_populate(p) && (!t->loop || fstype_is_ro(p->format))) {
-                        if (!mkfs_supports_root_option(p->format))
-                                return log_error_errno(SYNTHETIC_ERRNO(ENODEV),
-                                                        "Loop device access is required to populate %s filesystems.",
-                                                        p->format);
+        log_info("Successfully formatted future partition %" PRIu64 ".", p->partno);
 
-                        r = partition_populate_directory(context, p, &root);
-                        if (r < 0)
-                                return r;
-                }
+        /* If we're writing to a loop device, we can now mount the empty filesystem and populate it. */
+        if (partition_needs_populate(p) && !root) {
+                assert(t->loop);
 
-                r = mkfs_options_from_env("REPART", p->format, &extra_mkfs_options);
+                r = partition_populate_filesystem(context, p, partition_target_path(t));
                 if (r < 0)
-                        return log_error_errno(r,
-                                               "Failed to determine mkfs command line options for '%s': %m",
-                                               p->format);
+                        return r;
+        }
 
-                r = make_filesystem(partition_target_path(t), p->format, strempty(p->new_label), root,
-                                    p->fs_uuid, arg_discard, /* quiet = */ false,
-                                    context->fs_sector_size, extra_mkfs_options);
+        if (p->encrypt != ENCRYPT_OFF && !t->loop) {
+                r = partition_target_grow(t, p->new_size);
                 if (r < 0)
                         return r;
 
-                /* The mkfs binary we invoked might have removed our temporary file when we're not operating
-                 * on a loop device, so open the file again to make sure our file descriptor points to actual
-                 * new file. */
+                r = partition_encrypt(context, p, t, /* offline = */ true);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to encrypt device: %m");
+        }
 
-                if (t->fd >= 0 && t->path && !t->loop) {
-                        safe_close(t->fd);
-                        t->fd = open(t->path, O_RDWR|O_CLOEXEC);
-                        if (t->fd < 0)
-                                return log_error_errno(errno, "Failed to reopen temporary file: %m");
-                }
+        /* Note that we always sync explicitly here, since mkfs.fat doesn't do that on its own, and
+         * if we don't sync before detaching a block device the in-flight sectors possibly won't hit
+         * the disk. */
 
-                log_info("Successfully formatted future partition %" PRIu64 ".", p->partno);
+        r = partition_target_sync(context, p, t);
+        if (r < 0)
+                return r;
 
-                /* If we're writing to a loop device, we can now mount the empty filesystem and populate it. */
-                if (partition_needs_populate(p) && !root) {
-                        assert(t->loop);
+        if (p->siblings[VERITY_HASH] && !partition_type_defer(&p->siblings[VERITY_HASH]->type)) {
+                r = partition_format_verity_hash(context, p->siblings[VERITY_HASH],
+                                                 /* node = */ NULL, partition_target_path(t));
+                if (r < 0)
+                        return r;
+        }
 
-                        r = partition_populate_filesystem(context, p, partition_target_path(t));
-                        if (r < 0)
-                                return r;
-                }
+        if (p->siblings[VERITY_SIG] && !partition_type_defer(&p->siblings[VERITY_SIG]->type)) {
+                r = partition_format_verity_sig(context, p->siblings[VERITY_SIG]);
+                if (r < 0)
+                        return r;
+        }
 
-                if (p->encrypt != ENCRYPT_OFF && !t->loop) {
-                        r = partition_target_grow(t, p->new_size);
-                        if (r < 0)
-                                return r;
+        p->write_usec = usec_sub_unsigned(now(CLOCK_MONOTONIC), start_timestamp);
+        return 0;
+}
 
-                        r = partition_encrypt(context, p, t, /* offline = */ true);
-                        if (r < 0)
-                                return log_error_errno(r, "Failed to encrypt device: %m");
-                }
+static int context_mkfs(Context *context) {
+        int r;
 
-                /* Note that we always sync explicitly here, since mkfs.fat doesn't do that on its own, and
-                 * if we don't sync before detaching a block device the in-flight sectors possibly won't hit
-                 * the disk. */
+        assert(context);
 
-                r = partition_target_sync(context, p, t);
-                if (r < 0)
-                        return r;
+        /* Make a file system */
 
-                if (p->siblings[VERITY_HASH] && !partition_type_defer(&p->siblings[VERITY_HASH]->type)) {
-                        r = partition_format_verity_hash(context, p->siblings[VERITY_HASH],
-                                                         /* node = */ NULL, partition_target_path(t));
-                        if (r < 0)
-                                return r;
-                }
+        LIST_FOREACH(partitions, p, context->partitions) {
+                if (!partition_wants_mkfs(p))
+                        continue;
 
-                if (p->siblings[VERITY_SIG] && !partition_type_defer(&p->siblings[VERITY_SIG]->type)) {
-                        r = partition_format_verity_sig(context, p->siblings[VERITY_SIG]);
-                        if (r < 0)
-                                return r;
-                }
+                r = partition_mkfs(context, p);
+                if (r < 0)
+                        return r;
         }
 
         return 0;
@@ -5836,6 +5878,200 @@ static int context_split(Context *context) {
         return 0;
 }
 
+/* What a worker process writing a partition found out, that the rest of the run relies on */
+typedef struct PartitionWriteResult {
+        usec_t write_usec;
+        sd_id128_t new_uuid, hash_new_uuid;
+        bool new_uuid_is_set, hash_new_uuid_is_set;
+        size_t roothash_size;
+        uint8_t roothash[SHA256_DIGEST_SIZE]; /* We always ask for sha256 verity hashes */
+} PartitionWriteResult;
+
+static int partition_write(Context *context, Partition *p, PartitionWriteResult *ret) {
+        Partition *hp;
+        int fd, r;
+
+        assert(context);
+        assert(p);
+        assert(ret);
+
+        /* Runs in a worker process of its own, which uses a file description of its own for the image,
+         * as other workers seek around in it concurrently. */
+
+        assert_se((fd = fdisk_get_devfd(context->fdisk_context)) >= 0);
+
+        r = fd_reopen(fd, O_RDWR|O_CLOEXEC);
+        if (r < 0)
+                return log_error_errno(r, "Failed to reopen '%s': %m", context->node);
+
+        if (dup3(r, fd, O_CLOEXEC) < 0) {
+                safe_close(r);
+                return log_error_errno(errno, "Failed to replace file descriptor of '%s': %m", context->node);
+        }
+        safe_close(r);
+
+        if (partition_wants_copy_blocks(p))
+                r = partition_copy_blocks(context, p);
+        else
+                r = partition_mkfs(context, p);
+        if (r < 0)
+                return r;
+
+        *ret = (PartitionWriteResult) {
+                .write_usec = p->write_usec,
+                .new_uuid = p->new_uuid,
+                .new_uuid_is_set = p->new_uuid_is_set,
+        };
+
+        hp = p->siblings[VERITY_HASH];
+        if (hp && iovec_is_set(&hp->roothash)) {
+                if (hp->roothash.iov_len > sizeof(ret->roothash))
+                        return log_error_errno(SYNTHETIC_ERRNO(E2BIG), "Verity root hash too long.");
+
+                memcpy(ret->roothash, hp->roothash.iov_base, hp->roothash.iov_len);
+                ret->roothash_size = hp->roothash.iov_len;
+                ret->hash_new_uuid = hp->new_uuid;
+                ret->hash_new_uuid_is_set = hp->new_uuid_is_set;
+        }
+
+        return 0;
+}
+
+static int partition_apply_write_result(Partition *p, const PartitionWriteResult *result) {
+        Partition *hp;
+
+        assert(p);
+        assert(result);
+
+        p->write_usec = result->write_usec;
+
+        if (result->new_uuid_is_set && !p->new_uuid_is_set) {
+                p->new_uuid = result->new_uuid;
+                p->new_uuid_is_set = true;
+        }
+
+        if (result->roothash_size == 0)
+                return 0;
+
+        assert_se(hp = p->siblings[VERITY_HASH]);
+
+        if (!iovec_memdup(&IOVEC_MAKE((void*) result->roothash, result->roothash_size), &hp->roothash))
+                return log_oom();
+
+        if (result->hash_new_uuid_is_set && !hp->new_uuid_is_set) {
+                hp->new_uuid = result->hash_new_uuid;
+                hp->new_uuid_is_set = true;
+        }
+
+        return 0;
+}
+
+static int context_write_partitions_parallel(Context *context, PartitionWriteResult *results) {
+        _cleanup_free_ pid_t *pids = NULL;
+        size_t i = 0, n_running = 0, next = 0;
+        int r = 0;
+
+        assert(context);
+        assert(results);
+
+        /* Partitions are written by up to --jobs= worker processes at once, one partition (together with
+         * its verity hash and signature partitions) each. Workers are waited for in the order they were
+         * started, which is good enough here. */
+
+        pids = new0(pid_t, context->n_partitions);
+        if (!pids)
+                return log_oom();
+
+        LIST_FOREACH(partitions, p, context->partitions) {
+                size_t k = i++;
+
+                assert(k < context->n_partitions);
+
+                if (!partition_wants_copy_blocks(p) && !partition_wants_mkfs(p))
+                        continue;
+
+                for (; n_running >= arg_jobs; next++) {
+                        if (pids[next] == 0)
+                                continue;
+
+                        r = wait_for_terminate_and_check("(sd-repart)", TAKE_PID(pids[next]), WAIT_LOG);
+                        n_running--;
+                        if (r != EXIT_SUCCESS)
+                                break;
+                }
+                if (r != EXIT_SUCCESS)
+                        break;
+
+                r = safe_fork("(sd-repart)", FORK_RESET_SIGNALS|FORK_DEATHSIG_SIGTERM|FORK_LOG, pids + k);
+                if (r < 0)
+                        break;
+                if (r == 0) {
+                        r = partition_write(context, p, results + k);
+                        _exit(r < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+                }
+
+                n_running++;
+                r = EXIT_SUCCESS;
+        }
+
+        /* Even if something failed, wait for everything still running, so that nothing writes to the image
+         * anymore when we return */
+        for (; next < context->n_partitions; next++) {
+                int k;
+
+                if (pids[next] == 0)
+                        continue;
+
+                k = wait_for_terminate_and_check("(sd-repart)", TAKE_PID(pids[next]), WAIT_LOG);
+                if (r == EXIT_SUCCESS)
+                        r = k;
+        }
+        if (r < 0)
+                return r;
+        if (r != EXIT_SUCCESS)
+                return log_error_errno(SYNTHETIC_ERRNO(EPROTO), "Failed to write partitions.");
+
+        i = 0;
+        LIST_FOREACH(partitions, p, context->partitions) {
+                const PartitionWriteResult *result = results + i++;
+
+                if (!partition_wants_copy_blocks(p) && !partition_wants_mkfs(p))
+                        continue;
+
+                r = partition_apply_write_result(p, result);
+                if (r < 0)
+                        return r;
+        }
+
+        return 0;
+}
+
+static int context_write_partitions(Context *context) {
+        PartitionWriteResult *results;
+        size_t sz;
+        int r;
+
+        assert(context);
+
+        if (arg_jobs <= 1) {
+                r = context_copy_blocks(context);
+                if (r < 0)
+                        return r;
+
+                return context_mkfs(context);
+        }
+
+        /* Shared with the workers, each saves its results in the entry of its partition */
+        sz = PAGE_ALIGN(MAX(context->n_partitions, 1U) * sizeof(PartitionWriteResult));
+        results = mmap(NULL, sz, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+        if (results == MAP_FAILED)
+                return log_error_errno(errno, "Failed to allocate memory for partition write results: %m");
+
+        r = context_write_partitions_parallel(context, results);
+        (void) munmap(results, sz);
+        return r;
+}
+
 static int context_write_partition_table(Context *context) {
         _cleanup_(fdisk_unref_tablep) struct fdisk_table *original_table = NULL;
         int capable, r;
@@ -5883,11 +6119,7 @@ static int context_write_partition_table(Context *context) {
         if (r < 0)
                 return r;
 
-        r = context_copy_blocks(context);
-        if (r < 0)
-                return r;
-
-        r = context_mkfs(context);
+        r = context_write_partitions(context);
         if (r < 0)
                 return r;
 
@@ -6987,6 +7219,7 @@ static int help(void) {
                "     --sector-size=SIZE   Set the logical sector size for the image\n"
                "     --architecture=ARCH  Set the generic architecture for the image\n"
                "     --offline=BOOL       Whether to build the image offline\n"
+               "     --jobs=N             Write up to N partitions in parallel\n"
                "  -s --copy-source=PATH   Specify the primary source tree to copy files from\n"
                "     --copy-from=IMAGE    Copy partitions from the given image(s)\n"
                "  -S --make-ddi=sysext    Make a system extension DDI\n"
@@ -7048,6 +7281,7 @@ static int parse_argv(int argc, char *argv[]) {
                 ARG_MAKE_DDI,
                 ARG_GENERATE_FSTAB,
                 ARG_GENERATE_CRYPTTAB,
+                ARG_JOBS,
         };
 
         static const struct option options[] = {
@@ -7091,6 +7325,7 @@ static int parse_argv(int argc, char *argv[]) {
                 { "make-ddi",             required_argument, NULL, ARG_MAKE_DDI             },
                 { "generate-fstab",       required_argument, NULL, ARG_GENERATE_FSTAB       },
                 { "generate-crypttab",    required_argument, NULL, ARG_GENERATE_CRYPTTAB    },
+                { "jobs",                 required_argument, NULL, ARG_JOBS                 },
                 {}
         };
 
@@ -7482,6 +7717,14 @@ static int parse_argv(int argc, char *argv[]) {
                                 return r;
                         break;
 
+                case ARG_JOBS:
+                        r = safe_atou(optarg, &arg_jobs);
+                        if (r < 0)
+                                return log_error_errno(r, "Failed to parse --jobs= argument: %s", optarg);
+                        if (arg_jobs < 1)
+                                return log_error_errno(SYNTHETIC_ERRNO(EINVAL), "--jobs= must be at least 1.");
+                        break;
+
                 case '?':
                         return -EINVAL;
 
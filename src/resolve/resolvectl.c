@@ -1104,6 +1104,82 @@ static int verb_tlsa(int argc, char **argv, void *userdata) {
         return r;
 }
 
+static usec_t latency_percentile(sd_json_variant *buckets, uint64_t count, unsigned percent) {
+        uint64_t seen = 0, needed;
+        sd_json_variant *i;
+
+        /* Returns the upper limit of the bucket the given percentile of replies falls into, or USEC_INFINITY
+         * if that's the last, unbounded one */
+
+        needed = DIV_ROUND_UP(count * percent, 100U);
+
+        JSON_VARIANT_ARRAY_FOREACH(i, buckets) {
+                sd_json_variant *max;
+
+                seen += sd_json_variant_unsigned(sd_json_variant_by_key(i, "count"));
+                if (seen < needed)
+                        continue;
+
+                max = sd_json_variant_by_key(i, "maxUSec");
+                return max ? sd_json_variant_unsigned(max) : USEC_INFINITY;
+        }
+
+        return USEC_INFINITY;
+}
+
+static int table_add_latency(Table *table, sd_json_variant *latency) {
+        sd_json_variant *i;
+        int r;
+
+        assert(table);
+
+        JSON_VARIANT_ARRAY_FOREACH(i, latency) {
+                struct histogram {
+                        const char *protocol;
+                        uint64_t count;
+                        sd_json_variant *buckets;
+                } h = {};
+
+                static const sd_json_dispatch_field dispatch_table[] = {
+                        { "protocol", SD_JSON_VARIANT_STRING,        sd_json_dispatch_const_string,  offsetof(struct histogram, protocol), SD_JSON_MANDATORY },
+                        { "count",    _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64,        offsetof(struct histogram, count),    SD_JSON_MANDATORY },
+                        { "buckets",  SD_JSON_VARIANT_ARRAY,         sd_json_dispatch_variant_noref, offsetof(struct histogram, buckets),  SD_JSON_MANDATORY },
+                        {},
+                };
+
+                _cleanup_free_ char *field = NULL, *text = NULL;
+                usec_t p50, p90, p99;
+
+                r = sd_json_dispatch(i, dispatch_table, SD_JSON_LOG|SD_JSON_ALLOW_EXTENSIONS, &h);
+                if (r < 0)
+                        return r;
+
+                field = strjoin(h.protocol, " replies");
+                if (!field)
+                        return log_oom();
+                ascii_strupper(field);
+
+                p50 = latency_percentile(h.buckets, h.count, 50);
+                p90 = latency_percentile(h.buckets, h.count, 90);
+                p99 = latency_percentile(h.buckets, h.count, 99);
+
+                if (asprintf(&text, "%" PRIu64 " (50%% %s %s, 90%% %s %s, 99%% %s %s)",
+                             h.count,
+                             p50 == USEC_INFINITY ? ">" : "<=", p50 == USEC_INFINITY ? "max" : FORMAT_TIMESPAN(p50, USEC_PER_MSEC),
+                             p90 == USEC_INFINITY ? ">" : "<=", p90 == USEC_INFINITY ? "max" : FORMAT_TIMESPAN(p90, USEC_PER_MSEC),
+                             p99 == USEC_INFINITY ? ">" : "<=", p99 == USEC_INFINITY ? "max" : FORMAT_TIMESPAN(p99, USEC_PER_MSEC)) < 0)
+                        return log_oom();
+
+                r = table_add_many(table,
+                                   TABLE_FIELD, field,
+                                   TABLE_STRING, text);
+                if (r < 0)
+                        return table_log_add_error(r);
+        }
+
+        return 0;
+}
+
 static int show_statistics(int argc, char **argv, void *userdata) {
         _cleanup_(table_unrefp) Table *table = NULL;
         sd_json_variant *reply = NULL;
@@ -1125,12 +1201,14 @@ static int show_statistics(int argc, char **argv, void *userdata) {
                 sd_json_variant *transactions;
                 sd_json_variant *cache;
                 sd_json_variant *dnssec;
-        } statistics;
+                sd_json_variant *latency;
+        } statistics = {};
 
         static const sd_json_dispatch_field statistics_dispatch_table[] = {
                 { "transactions", SD_JSON_VARIANT_OBJECT, sd_json_dispatch_variant_noref, offsetof(struct statistics, transactions), SD_JSON_MANDATORY },
                 { "cache",        SD_JSON_VARIANT_OBJECT, sd_json_dispatch_variant_noref, offsetof(struct statistics, cache),        SD_JSON_MANDATORY },
                 { "dnssec",       SD_JSON_VARIANT_OBJECT, sd_json_dispatch_variant_noref, offsetof(struct statistics, dnssec),       SD_JSON_MANDATORY },
+                { "latency",      SD_JSON_VARIANT_ARRAY,  sd_json_dispatch_variant_noref, offsetof(struct statistics, latency),      0                 },
                 {},
         };
 
@@ -1165,12 +1243,16 @@ static int show_statistics(int argc, char **argv, void *userdata) {
                 uint64_t cache_size;
                 uint64_t n_cache_hit;
                 uint64_t n_cache_miss;
-        } cache;
+                uint64_t n_cache_prefetch;
+                uint64_t n_cache_synthesized;
+        } cache = {};
 
         static const sd_json_dispatch_field cache_dispatch_table[] = {
-                { "size",   _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64, offsetof(struct cache, cache_size),   SD_JSON_MANDATORY },
-                { "hits",   _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64, offsetof(struct cache, n_cache_hit),  SD_JSON_MANDATORY },
-                { "misses", _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64, offsetof(struct cache, n_cache_miss), SD_JSON_MANDATORY },
+                { "size",        _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64, offsetof(struct cache, cache_size),          SD_JSON_MANDATORY },
+                { "hits",        _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64, offsetof(struct cache, n_cache_hit),         SD_JSON_MANDATORY },
+                { "misses",      _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64, offsetof(struct cache, n_cache_miss),        SD_JSON_MANDATORY },
+                { "prefetches",  _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64, offsetof(struct cache, n_cache_prefetch),    0                 },
+                { "synthesized", _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64, offsetof(struct cache, n_cache_synthesized), 0                 },
                 {},
         };
 
@@ -1224,6 +1306,10 @@ static int show_statistics(int argc, char **argv, void *userdata) {
                            TABLE_UINT64, cache.n_cache_hit,
                            TABLE_FIELD, "Cache Misses",
                            TABLE_UINT64, cache.n_cache_miss,
+                           TABLE_FIELD, "Cache Prefetches",
+                           TABLE_UINT64, cache.n_cache_prefetch,
+                           TABLE_FIELD, "Cache Synthesized from NSEC",
+                           TABLE_UINT64, cache.n_cache_synthesized,
                            TABLE_EMPTY, TABLE_EMPTY,
                            TABLE_STRING, "Failure Transactions",
                            TABLE_SET_COLOR, ansi_highlight(),
@@ -1256,6 +1342,21 @@ static int show_statistics(int argc, char **argv, void *userdata) {
         if (r < 0)
                 return table_log_add_error(r);
 
+        if (!sd_json_variant_is_blank_array(statistics.latency)) {
+                r = table_add_many(table,
+                                   TABLE_EMPTY, TABLE_EMPTY,
+                                   TABLE_STRING, "Reply Latency",
+                                   TABLE_SET_COLOR, ansi_highlight(),
+                                   TABLE_SET_ALIGN_PERCENT, 0,
+                                   TABLE_EMPTY);
+                if (r < 0)
+                        return table_log_add_error(r);
+
+                r = table_add_latency(table, statistics.latency);
+                if (r < 0)
+                        return r;
+        }
+
         r = table_print(table, NULL);
         if (r < 0)
                 return table_log_print_error(r);
@@ -2949,19 +3050,25 @@ static int dump_cache_scope(sd_json_variant *scope) {
                 int family;
                 int ifindex;
                 const char *ifname;
+                uint64_t cache_memory;
+                uint64_t cache_memory_max;
                 sd_json_variant *cache;
         } scope_info = {
                 .family = AF_UNSPEC,
+                .cache_memory = UINT64_MAX,
+                .cache_memory_max = UINT64_MAX,
         };
         sd_json_variant *i;
         int r, c = 0;
 
         static const sd_json_dispatch_field dispatch_table[] = {
-                { "protocol", SD_JSON_VARIANT_STRING,        sd_json_dispatch_const_string,  offsetof(struct scope_info, protocol), SD_JSON_MANDATORY },
-                { "family",   _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_int,           offsetof(struct scope_info, family),   0                 },
-                { "ifindex",  _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_int,           offsetof(struct scope_info, ifindex),  0                 },
-                { "ifname",   SD_JSON_VARIANT_STRING,        sd_json_dispatch_const_string,  offsetof(struct scope_info, ifname),   0                 },
-                { "cache",    SD_JSON_VARIANT_ARRAY,         sd_json_dispatch_variant_noref, offsetof(struct scope_info, cache),    SD_JSON_MANDATORY },
+                { "protocol",       SD_JSON_VARIANT_STRING,        sd_json_dispatch_const_string,  offsetof(struct scope_info, protocol),         SD_JSON_MANDATORY },
+                { "family",         _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_int,           offsetof(struct scope_info, family),           0                 },
+                { "ifindex",        _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_int,           offsetof(struct scope_info, ifindex),          0                 },
+                { "ifname",         SD_JSON_VARIANT_STRING,        sd_json_dispatch_const_string,  offsetof(struct scope_info, ifname),           0                 },
+                { "cacheMemory",    _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64,        offsetof(struct scope_info, cache_memory),     0                 },
+                { "cacheMemoryMax", _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64,        offsetof(struct scope_info, cache_memory_max), 0                 },
+                { "cache",          SD_JSON_VARIANT_ARRAY,         sd_json_dispatch_variant_noref, offsetof(struct scope_info, cache),            SD_JSON_MANDATORY },
                 {},
         };
 
@@ -2978,6 +3085,10 @@ static int dump_cache_scope(sd_json_variant *scope) {
                 printf(" ifindex=%i", scope_info.ifindex);
         if (scope_info.ifname)
                 printf(" ifname=%s", scope_info.ifname);
+        if (scope_info.cache_memory != UINT64_MAX)
+                printf(" memory=%s", FORMAT_BYTES(scope_info.cache_memory));
+        if (scope_info.cache_memory_max != UINT64_MAX)
+                printf(" memory-max=%s", FORMAT_BYTES(scope_info.cache_memory_max));
 
         printf("%s\n", ansi_normal());
 
@@ -3034,6 +3145,78 @@ static int verb_show_cache(int argc, char *argv[], void *userdata) {
         return sd_json_variant_dump(d, arg_json_format_flags, NULL, NULL);
 }
 
+static int dump_server_connection(Table *table, size_t idx, sd_json_variant *connection) {
+        struct connection {
+                bool encrypted;
+                uint64_t n_pending;
+                uint64_t n_queued;
+                uint64_t n_replies;
+                uint64_t average_reply_usec;
+                int session_resumed;
+        } c = {
+                .average_reply_usec = USEC_INFINITY,
+                .session_resumed = -1,
+        };
+
+        static const sd_json_dispatch_field dispatch_table[] = {
+                { "Encrypted",         SD_JSON_VARIANT_BOOLEAN,       sd_json_dispatch_stdbool,  offsetof(struct connection, encrypted),          SD_JSON_MANDATORY },
+                { "PendingQueries",    _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64,   offsetof(struct connection, n_pending),          SD_JSON_MANDATORY },
+                { "QueuedPackets",     _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64,   offsetof(struct connection, n_queued),           SD_JSON_MANDATORY },
+                { "Replies",           _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64,   offsetof(struct connection, n_replies),          SD_JSON_MANDATORY },
+                { "AverageReplyUSec",  _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64,   offsetof(struct connection, average_reply_usec), 0                 },
+                { "TLSSessionResumed", SD_JSON_VARIANT_BOOLEAN,       sd_json_dispatch_tristate, offsetof(struct connection, session_resumed),    0                 },
+                {},
+        };
+
+        int r;
+
+        assert(table);
+        assert(connection);
+
+        r = sd_json_dispatch(connection, dispatch_table, SD_JSON_LOG|SD_JSON_ALLOW_EXTENSIONS, &c);
+        if (r < 0)
+                return r;
+
+        r = table_add_cell_stringf(table, NULL, "Connection %zu", idx + 1);
+        if (r < 0)
+                return table_log_add_error(r);
+
+        r = table_add_many(table,
+                           TABLE_EMPTY,
+                           TABLE_FIELD, "Encrypted",
+                           TABLE_STRING, yes_no(c.encrypted),
+                           TABLE_FIELD, "Pending queries",
+                           TABLE_UINT64, c.n_pending,
+                           TABLE_FIELD, "Queued packets",
+                           TABLE_UINT64, c.n_queued,
+                           TABLE_FIELD, "Replies received",
+                           TABLE_UINT64, c.n_replies);
+        if (r < 0)
+                return table_log_add_error(r);
+
+        if (c.average_reply_usec != USEC_INFINITY) {
+                r = table_add_many(table,
+                                   TABLE_FIELD, "Average reply time",
+                                   TABLE_TIMESPAN_MSEC, c.average_reply_usec);
+                if (r < 0)
+                        return table_log_add_error(r);
+        }
+
+        if (c.session_resumed >= 0) {
+                r = table_add_many(table,
+                                   TABLE_FIELD, "TLS session resumed",
+                                   TABLE_STRING, yes_no(c.session_resumed));
+                if (r < 0)
+                        return table_log_add_error(r);
+        }
+
+        r = table_add_many(table, TABLE_EMPTY, TABLE_EMPTY);
+        if (r < 0)
+                return table_log_add_error(r);
+
+        return 0;
+}
+
 static int dump_server_state(sd_json_variant *server) {
         _cleanup_(table_unrefp) Table *table = NULL;
         TableCell *cell;
@@ -3055,8 +3238,12 @@ static int dump_server_state(sd_json_variant *server) {
                 bool packet_rrsig_missing;
                 bool packet_invalid;
                 bool packet_do_off;
+                sd_json_variant *connections;
+                uint64_t rtt_usec;
+                sd_json_variant *latency;
         } server_state = {
                 .ifindex = -1,
+                .rtt_usec = USEC_INFINITY,
         };
 
         int r;
@@ -3078,6 +3265,9 @@ static int dump_server_state(sd_json_variant *server) {
                 { "PacketRRSIGMissing",     SD_JSON_VARIANT_BOOLEAN,       sd_json_dispatch_stdbool,       offsetof(struct server_state, packet_rrsig_missing),      SD_JSON_MANDATORY },
                 { "PacketInvalid",          SD_JSON_VARIANT_BOOLEAN,       sd_json_dispatch_stdbool,       offsetof(struct server_state, packet_invalid),            SD_JSON_MANDATORY },
                 { "PacketDoOff",            SD_JSON_VARIANT_BOOLEAN,       sd_json_dispatch_stdbool,       offsetof(struct server_state, packet_do_off),             SD_JSON_MANDATORY },
+                { "Connections",            SD_JSON_VARIANT_ARRAY,         sd_json_dispatch_variant_noref, offsetof(struct server_state, connections),               0                 },
+                { "SmoothedRTTUSec",        _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64,        offsetof(struct server_state, rtt_usec),                  0                 },
+                { "Latency",                SD_JSON_VARIANT_ARRAY,         sd_json_dispatch_variant_noref, offsetof(struct server_state, latency),                   0                 },
                 {},
         };
 
@@ -3158,12 +3348,32 @@ static int dump_server_state(sd_json_variant *server) {
                            TABLE_STRING, yes_no(server_state.packet_invalid),
                            TABLE_FIELD, "Server dropped DO flag",
                            TABLE_STRING, yes_no(server_state.packet_do_off),
-                           TABLE_SET_ALIGN_PERCENT, 0,
-                           TABLE_EMPTY, TABLE_EMPTY);
+                           TABLE_SET_ALIGN_PERCENT, 0);
+        if (r < 0)
+                return table_log_add_error(r);
 
+        if (server_state.rtt_usec != USEC_INFINITY) {
+                r = table_add_many(table,
+                                   TABLE_FIELD, "Smoothed round trip time",
+                                   TABLE_TIMESPAN_MSEC, server_state.rtt_usec);
+                if (r < 0)
+                        return table_log_add_error(r);
+        }
+
+        r = table_add_latency(table, server_state.latency);
+        if (r < 0)
+                return r;
+
+        r = table_add_many(table, TABLE_EMPTY, TABLE_EMPTY);
         if (r < 0)
                 return table_log_add_error(r);
 
+        for (size_t i = 0; i < sd_json_variant_elements(server_state.connections); i++) {
+                r = dump_server_connection(table, i, sd_json_variant_by_index(server_state.connections, i));
+                if (r < 0)
+                        return r;
+        }
+
         r = table_print(table, NULL);
         if (r < 0)
                 return table_log_print_error(r);
@@ -6,6 +6,8 @@
 #include "alloc-util.h"
 #include "dns-domain.h"
 #include "format-util.h"
+#include "iovec-util.h"
+#include "json-util.h"
 #include "resolved-dns-answer.h"
 #include "resolved-dns-cache.h"
 #include "resolved-dns-packet.h"
@@ -27,8 +29,18 @@
 
 #define CACHEABLE_QUERY_FLAGS (SD_RESOLVED_AUTHENTICATED|SD_RESOLVED_CONFIDENTIAL)
 
+/* Positive entries which are looked up at least this often are refreshed before their TTL expires, if
+ * CachePrefetch= is enabled. The refresh is requested once the last 1/CACHE_PREFETCH_TTL_DIVISOR of the TTL
+ * has been entered. */
+#define CACHE_PREFETCH_HITS_MIN 2U
+#define CACHE_PREFETCH_TTL_DIVISOR 10U
+
+/* Never look at more than this many wildcard names when trying to synthesize a negative response from the
+ * cached NSEC RRs of a zone, see dns_cache_synthesize_from_nsec() */
+#define CACHE_NSEC_SYNTHESIZE_LABELS_MAX 16U
+
 typedef enum DnsCacheItemType DnsCacheItemType;
-typedef struct DnsCacheItem DnsCacheItem;
+typedef struct DnsCacheNsecZone DnsCacheNsecZone;
 
 enum DnsCacheItemType {
         DNS_CACHE_POSITIVE,
@@ -47,6 +59,8 @@ struct DnsCacheItem {
 
         usec_t until;            /* If StaleRetentionSec is greater than zero, until is set to a duration of StaleRetentionSec from the time of TTL expiry. If StaleRetentionSec is zero, both until and until_valid will be set to ttl. */
         usec_t until_valid;      /* The key is for storing the time when the TTL set to expire. */
+        usec_t prefetch_after;   /* For positive entries, when a refresh may be requested before until_valid */
+        unsigned n_hit;          /* How often this entry was looked up, for deciding whether to prefetch it */
         uint64_t query_flags;    /* SD_RESOLVED_AUTHENTICATED and/or SD_RESOLVED_CONFIDENTIAL */
         DnssecResult dnssec_result;
 
@@ -56,6 +70,11 @@ struct DnsCacheItem {
 
         unsigned prioq_idx;
         LIST_FIELDS(DnsCacheItem, by_key);
+        LIST_FIELDS(DnsCacheItem, by_lru);
+
+        DnsCacheNsecZone *nsec_zone; /* If this is a validated NSEC RR, the zone index it is linked into */
+
+        size_t memory;           /* Estimated memory used by this item, see dns_cache_item_memory() */
 
         bool shared_owner;
 };
@@ -66,6 +85,32 @@ struct DnsCacheItem {
  * immediate RR data for the specified RR key, but nothing else. */
 #define DNS_CACHE_ITEM_IS_PRIMARY(item) (!!(item)->answer)
 
+/* All validated NSEC RRs we have in the cache for a specific zone, sorted by owner name in canonical DNS
+ * order, so that we can quickly find the ones that cover a name we have no cache entry for (RFC 8198) */
+struct DnsCacheNsecZone {
+        char *zone;
+        DnsCacheItem **items;
+        size_t n_items;
+};
+
+static DnsCacheNsecZone* dns_cache_nsec_zone_free(DnsCacheNsecZone *z) {
+        if (!z)
+                return NULL;
+
+        free(z->zone);
+        free(z->items);
+        return mfree(z);
+}
+DEFINE_TRIVIAL_CLEANUP_FUNC(DnsCacheNsecZone*, dns_cache_nsec_zone_free);
+
+DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(
+                nsec_zone_hash_ops,
+                char,
+                dns_name_hash_func,
+                dns_name_compare_func,
+                DnsCacheNsecZone,
+                dns_cache_nsec_zone_free);
+
 static const char *dns_cache_item_type_to_string(DnsCacheItem *item) {
         assert(item);
 
@@ -99,6 +144,196 @@ static DnsCacheItem* dns_cache_item_free(DnsCacheItem *i) {
 }
 DEFINE_TRIVIAL_CLEANUP_FUNC(DnsCacheItem*, dns_cache_item_free);
 
+static size_t dns_cache_rr_memory(DnsResourceRecord *rr) {
+        _cleanup_(dns_packet_unref) DnsPacket packet = {
+                .n_ref = 1,
+                .protocol = DNS_PROTOCOL_DNS,
+                .on_stack = true,
+                .refuse_compression = true,
+        };
+
+        assert(rr);
+
+        /* The parsed form of an RR takes roughly as much space as its wire format, so use the latter as
+         * estimate. Serializing is cheap compared to the upstream lookup that got us the RR. */
+
+        if (rr->wire_format)
+                return sizeof(DnsResourceRecord) + rr->wire_format_size;
+
+        if (dns_packet_append_rr(&packet, rr, 0, NULL, NULL) < 0)
+                return sizeof(DnsResourceRecord);
+
+        return sizeof(DnsResourceRecord) + packet.size;
+}
+
+static size_t dns_cache_item_memory(DnsResourceRecord *rr, DnsAnswer *answer, DnsPacket *full_packet) {
+        size_t m = sizeof(DnsCacheItem);
+
+        /* Estimates the memory used by an item. Packets shared between the items of one RRset are counted
+         * for each of them, hence this rather overestimates. For positive entries the answer mostly
+         * references the RRs of the other items of the RRset, hence only the RR itself is counted. For
+         * negative entries the answer carries the SOA and NSEC RRs. */
+
+        if (rr)
+                m += dns_cache_rr_memory(rr);
+        else {
+                DnsResourceRecord *j;
+
+                DNS_ANSWER_FOREACH(j, answer)
+                        m += dns_cache_rr_memory(j);
+        }
+
+        if (full_packet)
+                m += full_packet->size;
+
+        return m;
+}
+
+static void dns_cache_item_lru_add(DnsCache *c, DnsCacheItem *i) {
+        assert(c);
+        assert(i);
+
+        LIST_INSERT_AFTER(by_lru, c->by_lru, c->by_lru_tail, i);
+        c->by_lru_tail = i;
+        c->memory += i->memory;
+}
+
+static void dns_cache_item_lru_remove(DnsCache *c, DnsCacheItem *i) {
+        assert(c);
+        assert(i);
+
+        if (c->by_lru_tail == i)
+                c->by_lru_tail = i->by_lru_prev;
+        LIST_REMOVE(by_lru, c->by_lru, i);
+
+        assert(c->memory >= i->memory);
+        c->memory -= i->memory;
+}
+
+/* Returns the index of the first item whose owner name is ordered after the specified name */
+static size_t dns_cache_nsec_zone_bisect(DnsCacheNsecZone *z, const char *name) {
+        size_t lo = 0, hi;
+
+        assert(z);
+        assert(name);
+
+        hi = z->n_items;
+        while (lo < hi) {
+                size_t m = lo + (hi - lo) / 2;
+
+                if (dns_name_compare_func(dns_resource_key_name(z->items[m]->rr->key), name) <= 0)
+                        lo = m + 1;
+                else
+                        hi = m;
+        }
+
+        return lo;
+}
+
+static int dns_cache_item_nsec_add(DnsCache *c, DnsCacheItem *i) {
+        _cleanup_(dns_cache_nsec_zone_freep) DnsCacheNsecZone *new_zone = NULL;
+        DnsCacheNsecZone *z;
+        const char *zone;
+        size_t idx;
+        int r;
+
+        assert(c);
+        assert(i);
+        assert(i->rr);
+        assert(i->rr->key->type == DNS_TYPE_NSEC);
+        assert(!i->nsec_zone);
+
+        r = dns_resource_record_signer(i->rr, &zone);
+        if (r < 0)
+                return r;
+
+        z = hashmap_get(c->nsec_by_zone, zone);
+        if (!z) {
+                new_zone = new0(DnsCacheNsecZone, 1);
+                if (!new_zone)
+                        return -ENOMEM;
+
+                new_zone->zone = strdup(zone);
+                if (!new_zone->zone)
+                        return -ENOMEM;
+
+                z = new_zone;
+        }
+
+        if (!GREEDY_REALLOC(z->items, z->n_items + 1))
+                return -ENOMEM;
+
+        if (new_zone) {
+                r = hashmap_ensure_put(&c->nsec_by_zone, &nsec_zone_hash_ops, new_zone->zone, new_zone);
+                if (r < 0)
+                        return r;
+
+                TAKE_PTR(new_zone);
+        }
+
+        idx = dns_cache_nsec_zone_bisect(z, dns_resource_key_name(i->rr->key));
+        memmove(z->items + idx + 1, z->items + idx, (z->n_items - idx) * sizeof(DnsCacheItem*));
+        z->items[idx] = i;
+        z->n_items++;
+
+        i->nsec_zone = z;
+        return 0;
+}
+
+static void dns_cache_item_nsec_remove(DnsCache *c, DnsCacheItem *i) {
+        DnsCacheNsecZone *z;
+        size_t idx;
+
+        assert(c);
+        assert(i);
+
+        z = TAKE_PTR(i->nsec_zone);
+        if (!z)
+                return;
+
+        /* Items with the same owner name are adjacent, right before the bisection point */
+        idx = dns_cache_nsec_zone_bisect(z, dns_resource_key_name(i->rr->key));
+        while (idx > 0 && z->items[idx - 1] != i)
+                idx--;
+        assert(idx > 0);
+        idx--;
+
+        memmove(z->items + idx, z->items + idx + 1, (z->n_items - idx - 1) * sizeof(DnsCacheItem*));
+        z->n_items--;
+
+        if (z->n_items == 0)
+                dns_cache_nsec_zone_free(hashmap_remove(c->nsec_by_zone, z->zone));
+}
+
+static void dns_cache_item_nsec_update(DnsCache *c, DnsCacheItem *i, bool add) {
+        int r;
+
+        assert(c);
+        assert(i);
+
+        /* Only NSEC RRs that were validated are useful for synthesizing answers, hence only index those */
+        add = add && FLAGS_SET(i->query_flags, SD_RESOLVED_AUTHENTICATED);
+
+        if (!add)
+                dns_cache_item_nsec_remove(c, i);
+        else if (!i->nsec_zone) {
+                r = dns_cache_item_nsec_add(c, i);
+                if (r < 0)
+                        log_debug_errno(r, "Failed to index NSEC RR, ignoring: %m");
+        }
+}
+
+static void dns_cache_item_lru_touch(DnsCache *c, DnsCacheItem *i) {
+        assert(c);
+        assert(i);
+
+        if (c->by_lru_tail == i)
+                return;
+
+        dns_cache_item_lru_remove(c, i);
+        dns_cache_item_lru_add(c, i);
+}
+
 static void dns_cache_item_unlink_and_free(DnsCache *c, DnsCacheItem *i) {
         DnsCacheItem *first;
 
@@ -116,6 +351,8 @@ static void dns_cache_item_unlink_and_free(DnsCache *c, DnsCacheItem *i) {
                 hashmap_remove(c->by_key, i->key);
 
         prioq_remove(c->by_expiry, i, &i->prioq_idx);
+        dns_cache_item_lru_remove(c, i);
+        dns_cache_item_nsec_remove(c, i);
 
         dns_cache_item_free(i);
 }
@@ -150,6 +387,8 @@ static bool dns_cache_remove_by_key(DnsCache *c, DnsResourceKey *key) {
 
         LIST_FOREACH(by_key, i, first) {
                 prioq_remove(c->by_expiry, i, &i->prioq_idx);
+                dns_cache_item_lru_remove(c, i);
+                dns_cache_item_nsec_remove(c, i);
                 dns_cache_item_free(i);
         }
 
@@ -166,21 +405,29 @@ void dns_cache_flush(DnsCache *c) {
 
         assert(hashmap_isempty(c->by_key));
         assert(prioq_isempty(c->by_expiry));
+        assert(!c->by_lru);
+        assert(c->memory == 0);
+        assert(hashmap_isempty(c->nsec_by_zone));
 
         c->by_key = hashmap_free(c->by_key);
+        c->nsec_by_zone = hashmap_free(c->nsec_by_zone);
         c->by_expiry = prioq_free(c->by_expiry);
 }
 
-static void dns_cache_make_space(DnsCache *c, unsigned add) {
+static void dns_cache_make_space(DnsCache *c, unsigned add, uint64_t add_memory) {
         assert(c);
 
         if (add <= 0)
                 return;
 
-        /* Makes space for n new entries. Note that we actually allow
-         * the cache to grow beyond CACHE_MAX, but only when we shall
-         * add more RRs to the cache than CACHE_MAX at once. In that
-         * case the cache will be emptied completely otherwise. */
+        /* Makes space for n new entries, which take approximately add_memory bytes. Note that we actually
+         * allow the cache to grow beyond CACHE_MAX (or the memory limit), but only when we shall add more
+         * RRs to the cache than CACHE_MAX at once. In that case the cache will be emptied completely
+         * otherwise.
+         *
+         * If a memory limit is set, it replaces the CACHE_MAX limit. Entries are evicted in least recently
+         * used order, RRsets of the same key together. Expired entries are removed by dns_cache_prune()
+         * anyway. */
 
         for (;;) {
                 _cleanup_(dns_resource_key_unrefp) DnsResourceKey *key = NULL;
@@ -189,10 +436,13 @@ static void dns_cache_make_space(DnsCache *c, unsigned add) {
                 if (prioq_isempty(c->by_expiry))
                         break;
 
-                if (prioq_size(c->by_expiry) + add < CACHE_MAX)
+                if (c->memory_max > 0) {
+                        if (c->memory + add_memory <= c->memory_max)
+                                break;
+                } else if (prioq_size(c->by_expiry) + add < CACHE_MAX)
                         break;
 
-                i = prioq_peek(c->by_expiry);
+                i = c->by_lru;
                 assert(i);
 
                 /* Take an extra reference to the key so that it
@@ -317,6 +567,7 @@ static int dns_cache_link_item(DnsCache *c, DnsCacheItem *i) {
                 }
         }
 
+        dns_cache_item_lru_add(c, i);
         return 0;
 }
 
@@ -377,6 +628,12 @@ static usec_t calculate_until(
         return stale_retention_usec > 0 ? usec_add(until_valid, stale_retention_usec) : until_valid;
 }
 
+static usec_t calculate_prefetch_after(usec_t until_valid, usec_t timestamp) {
+        assert(until_valid >= timestamp);
+
+        return until_valid - (until_valid - timestamp) / CACHE_PREFETCH_TTL_DIVISOR;
+}
+
 static void dns_cache_item_update_positive(
                 DnsCache *c,
                 DnsCacheItem *i,
@@ -416,6 +673,8 @@ static void dns_cache_item_update_positive(
 
         i->until_valid = calculate_until_valid(rr, min_ttl, UINT32_MAX, timestamp, false);
         i->until = calculate_until(i->until_valid, stale_retention_usec);
+        i->prefetch_after = calculate_prefetch_after(i->until_valid, timestamp);
+        i->n_hit = 0;
         i->query_flags = query_flags & CACHEABLE_QUERY_FLAGS;
         i->shared_owner = shared_owner;
         i->dnssec_result = dnssec_result;
@@ -426,6 +685,10 @@ static void dns_cache_item_update_positive(
         i->owner_address = *owner_address;
 
         prioq_reshuffle(c->by_expiry, i, &i->prioq_idx);
+
+        dns_cache_item_lru_remove(c, i);
+        i->memory = dns_cache_item_memory(rr, answer, full_packet);
+        dns_cache_item_lru_add(c, i);
 }
 
 static int dns_cache_put_positive(
@@ -502,7 +765,8 @@ static int dns_cache_put_positive(
         if (r < 0)
                 return r;
 
-        dns_cache_make_space(c, 1);
+        size_t memory = dns_cache_item_memory(rr, answer, full_packet);
+        dns_cache_make_space(c, 1, memory);
 
         _cleanup_(dns_cache_item_freep) DnsCacheItem *i = new(DnsCacheItem, 1);
         if (!i)
@@ -521,6 +785,7 @@ static int dns_cache_put_positive(
                 .full_packet = dns_packet_ref(full_packet),
                 .until = calculate_until(until_valid, stale_retention_usec),
                 .until_valid = until_valid,
+                .prefetch_after = calculate_prefetch_after(until_valid, timestamp),
                 .query_flags = query_flags & CACHEABLE_QUERY_FLAGS,
                 .shared_owner = shared_owner,
                 .dnssec_result = dnssec_result,
@@ -528,6 +793,7 @@ static int dns_cache_put_positive(
                 .owner_family = owner_family,
                 .owner_address = *owner_address,
                 .prioq_idx = PRIOQ_IDX_NULL,
+                .memory = memory,
         };
 
         r = dns_cache_link_item(c, i);
@@ -611,7 +877,8 @@ static int dns_cache_put_negative(
         if (r < 0)
                 return r;
 
-        dns_cache_make_space(c, 1);
+        size_t memory = dns_cache_item_memory(NULL, answer, full_packet);
+        dns_cache_make_space(c, 1, memory);
 
         i = new(DnsCacheItem, 1);
         if (!i)
@@ -629,6 +896,7 @@ static int dns_cache_put_negative(
                 .rcode = rcode,
                 .answer = dns_answer_ref(answer),
                 .full_packet = dns_packet_ref(full_packet),
+                .memory = memory,
         };
 
         /* Determine how long to cache this entry. In case we have some RRs in the answer use the lowest TTL
@@ -778,8 +1046,9 @@ int dns_cache_put(
         if (key)
                 cache_keys++;
 
-        /* Make some space for our new entries */
-        dns_cache_make_space(c, cache_keys);
+        /* Make some space for our new entries. The memory of the entries is accounted for when making space
+         * for each of them below. */
+        dns_cache_make_space(c, cache_keys, 0);
 
         timestamp = now(CLOCK_BOOTTIME);
 
@@ -833,6 +1102,16 @@ int dns_cache_put(
                                 stale_retention_usec);
                 if (r < 0)
                         goto fail;
+
+                /* Remember validated NSEC RRs by zone, so that we can use them to answer queries for other
+                 * names they cover, too. But not if we shall not do negative caching at all. */
+                if (item->rr->key->type == DNS_TYPE_NSEC) {
+                        DnsCacheItem *i;
+
+                        i = dns_cache_get(c, item->rr);
+                        if (i)
+                                dns_cache_item_nsec_update(c, i, cache_mode != DNS_CACHE_MODE_NO_NEGATIVE);
+                }
         }
 
         if (!key) /* mDNS doesn't know negative caching, really */
@@ -1018,6 +1297,170 @@ static int answer_add_clamp_ttl(
         return 0;
 }
 
+static int answer_add_nsec_floor(
+                DnsAnswer **answer,
+                DnsCacheNsecZone *z,
+                const char *name,
+                uint64_t query_flags,
+                usec_t current,
+                uint64_t *ret_query_flags) {
+
+        DnsCacheItem *i;
+        size_t idx;
+
+        assert(answer);
+        assert(z);
+        assert(name);
+        assert(ret_query_flags);
+
+        /* Adds the NSEC RR with the closest owner name ordered before or equal to the specified name, i.e.
+         * the one that would match or cover it, if there is any. */
+
+        idx = dns_cache_nsec_zone_bisect(z, name);
+        if (idx == 0)
+                return 0;
+
+        i = z->items[idx - 1];
+
+        /* Never synthesize anything from stale data */
+        if (i->until_valid < current)
+                return 0;
+
+        *ret_query_flags &= i->query_flags;
+
+        return answer_add_clamp_ttl(
+                        answer,
+                        i->rr,
+                        i->ifindex,
+                        DNS_ANSWER_AUTHENTICATED|DNS_ANSWER_SECTION_AUTHORITY,
+                        NULL,
+                        query_flags,
+                        i->until_valid,
+                        current);
+}
+
+static int dns_cache_synthesize_from_nsec(
+                DnsCache *c,
+                DnsResourceKey *key,
+                uint64_t query_flags,
+                int *ret_rcode,
+                DnsAnswer **ret_answer,
+                uint64_t *ret_query_flags) {
+
+        _cleanup_(dns_answer_unrefp) DnsAnswer *answer = NULL;
+        uint64_t flags = CACHEABLE_QUERY_FLAGS;
+        DnsCacheNsecZone *z = NULL;
+        DnssecNsecResult result;
+        bool authenticated;
+        const char *name, *n;
+        DnsCacheItem *soa;
+        usec_t current;
+        int r;
+
+        assert(c);
+        assert(key);
+
+        /* Implements "Aggressive Use of DNSSEC-Validated Cache" (RFC 8198): if we have no cache entry for a
+         * key, but validated NSEC RRs that prove that the name or type does not exist, synthesize a negative
+         * response from them. Returns > 0 and the rcode plus the NSEC RRs used if that worked. */
+
+        if (hashmap_isempty(c->nsec_by_zone))
+                return 0;
+
+        /* Clients that want the primary answer want the RRSIGs too, but we keep none for indexed NSEC RRs */
+        if (FLAGS_SET(query_flags, SD_RESOLVED_REQUIRE_PRIMARY))
+                return 0;
+
+        /* DS RRs live in the parent zone, but we only index the NSEC RRs of the child zone */
+        if (IN_SET(key->type, DNS_TYPE_NSEC, DNS_TYPE_DS))
+                return 0;
+
+        /* Find the closest zone we have NSEC RRs for */
+        name = dns_resource_key_name(key);
+        for (n = name;;) {
+                z = hashmap_get(c->nsec_by_zone, n);
+                if (z)
+                        break;
+
+                r = dns_name_parent(&n);
+                if (r < 0)
+                        return r;
+                if (r == 0)
+                        return 0;
+        }
+
+        current = now(CLOCK_BOOTTIME);
+
+        /* First, the NSEC RR that matches or covers the name itself… */
+        r = answer_add_nsec_floor(&answer, z, name, query_flags, current, &flags);
+        if (r < 0)
+                return r;
+
+        /* …then the ones matching or covering the wildcards at all possible closest enclosers */
+        n = name;
+        for (unsigned k = 0; k < CACHE_NSEC_SYNTHESIZE_LABELS_MAX; k++) {
+                _cleanup_free_ char *wc = NULL;
+
+                r = dns_name_equal(n, z->zone);
+                if (r < 0)
+                        return r;
+                if (r > 0)
+                        break;
+
+                r = dns_name_parent(&n);
+                if (r < 0)
+                        return r;
+                if (r == 0)
+                        break;
+
+                wc = strjoin("*.", n);
+                if (!wc)
+                        return -ENOMEM;
+
+                r = answer_add_nsec_floor(&answer, z, wc, query_flags, current, &flags);
+                if (r < 0)
+                        return r;
+        }
+
+        if (!FLAGS_SET(flags, SD_RESOLVED_AUTHENTICATED))
+                return 0;
+
+        r = dnssec_nsec_test(answer, key, &result, &authenticated, NULL);
+        if (r == -EOPNOTSUPP)
+                return 0;
+        if (r < 0)
+                return r;
+        if (!authenticated || !IN_SET(result, DNSSEC_NSEC_NXDOMAIN, DNSSEC_NSEC_NODATA))
+                return 0;
+
+        /* Include the validated SOA of the zone, if we have it, so that our clients can cache the response */
+        soa = hashmap_get(c->by_key, &DNS_RESOURCE_KEY_CONST(key->class, DNS_TYPE_SOA, z->zone));
+        if (soa && soa->rr &&
+            FLAGS_SET(soa->query_flags, SD_RESOLVED_AUTHENTICATED) &&
+            soa->until_valid >= current) {
+                r = answer_add_clamp_ttl(
+                                &answer,
+                                soa->rr,
+                                soa->ifindex,
+                                DNS_ANSWER_AUTHENTICATED|DNS_ANSWER_SECTION_AUTHORITY,
+                                NULL,
+                                query_flags,
+                                soa->until_valid,
+                                current);
+                if (r < 0)
+                        return r;
+        }
+
+        if (ret_rcode)
+                *ret_rcode = result == DNSSEC_NSEC_NXDOMAIN ? DNS_RCODE_NXDOMAIN : DNS_RCODE_SUCCESS;
+        if (ret_answer)
+                *ret_answer = TAKE_PTR(answer);
+        if (ret_query_flags)
+                *ret_query_flags = flags;
+
+        return 1;
+}
+
 int dns_cache_lookup(
                 DnsCache *c,
                 DnsResourceKey *key,
@@ -1026,7 +1469,8 @@ int dns_cache_lookup(
                 DnsAnswer **ret_answer,
                 DnsPacket **ret_full_packet,
                 uint64_t *ret_query_flags,
-                DnssecResult *ret_dnssec_result) {
+                DnssecResult *ret_dnssec_result,
+                bool *ret_prefetch) {
 
         _cleanup_(dns_packet_unrefp) DnsPacket *full_packet = NULL;
         _cleanup_(dns_answer_unrefp) DnsAnswer *answer = NULL;
@@ -1040,6 +1484,7 @@ int dns_cache_lookup(
         int found_rcode = -1;
         DnssecResult dnssec_result = -1;
         int have_dnssec_result = -1;
+        bool prefetch = false;
 
         assert(c);
         assert(key);
@@ -1055,6 +1500,36 @@ int dns_cache_lookup(
 
         first = dns_cache_get_by_key_follow_cname_dname_nsec(c, key);
         if (!first) {
+                int rcode;
+                uint64_t synthesized_flags;
+
+                /* Maybe the cached NSEC RRs of the zone prove that the name or type doesn't exist? */
+                r = dns_cache_synthesize_from_nsec(c, key, query_flags, &rcode, &answer, &synthesized_flags);
+                if (r < 0)
+                        log_debug_errno(r, "Failed to synthesize response from cached NSEC RRs, ignoring: %m");
+                if (r > 0) {
+                        log_debug("%s synthesized from cached NSEC RRs for %s",
+                                  rcode == DNS_RCODE_NXDOMAIN ? "NXDOMAIN" : "NODATA",
+                                  dns_resource_key_to_string(key, key_str, sizeof key_str));
+
+                        if (ret_rcode)
+                                *ret_rcode = rcode;
+                        if (ret_answer)
+                                *ret_answer = TAKE_PTR(answer);
+                        if (ret_full_packet)
+                                *ret_full_packet = NULL;
+                        if (ret_query_flags)
+                                *ret_query_flags = synthesized_flags;
+                        if (ret_dnssec_result)
+                                *ret_dnssec_result = DNSSEC_VALIDATED;
+                        if (ret_prefetch)
+                                *ret_prefetch = false;
+
+                        c->n_hit++;
+                        c->n_synthesized++;
+                        return 1;
+                }
+
                 /* If one question cannot be answered we need to refresh */
 
                 log_debug("Cache miss for %s",
@@ -1062,14 +1537,29 @@ int dns_cache_lookup(
                 goto miss;
         }
 
-        if ((query_flags & (SD_RESOLVED_CLAMP_TTL | SD_RESOLVED_NO_STALE)) != 0) {
+        if ((query_flags & (SD_RESOLVED_CLAMP_TTL | SD_RESOLVED_NO_STALE)) != 0 || ret_prefetch) {
                 /* 'current' is always passed to answer_add_clamp_ttl(), but is only used conditionally.
                  * We'll do the same assert there to make sure that it was initialized properly.
-                 * 'current' is also used below when SD_RESOLVED_NO_STALE is set. */
+                 * 'current' is also used below when SD_RESOLVED_NO_STALE is set, and for the prefetch
+                 * logic. */
                 current = now(CLOCK_BOOTTIME);
                 assert(current > 0);
         }
 
+        /* Let's refresh popular entries shortly before they expire, so that the clients looking them up do
+         * not have to wait for the upstream servers when the TTL expires. Stale entries are not prefetched:
+         * those are refreshed by the regular lookup anyway. */
+        LIST_FOREACH(by_key, j, first)
+                dns_cache_item_lru_touch(c, j);
+
+        first->n_hit++;
+        if (ret_prefetch &&
+            first->type == DNS_CACHE_POSITIVE &&
+            first->n_hit >= CACHE_PREFETCH_HITS_MIN &&
+            current >= first->prefetch_after &&
+            current < first->until_valid)
+                prefetch = true;
+
         LIST_FOREACH(by_key, j, first) {
                 /* If the caller doesn't allow us to answer questions from cache data learned from
                  * "side-effect", skip this entry. */
@@ -1188,6 +1678,8 @@ int dns_cache_lookup(
                         *ret_query_flags = 0;
                 if (ret_dnssec_result)
                         *ret_dnssec_result = dnssec_result;
+                if (ret_prefetch)
+                        *ret_prefetch = false;
 
                 c->n_hit++;
                 return 1;
@@ -1213,6 +1705,8 @@ int dns_cache_lookup(
                         *ret_query_flags = nsec->query_flags;
                 if (ret_dnssec_result)
                         *ret_dnssec_result = nsec->dnssec_result;
+                if (ret_prefetch)
+                        *ret_prefetch = false;
 
                 if (!bitmap_isset(nsec->rr->nsec.types, key->type) &&
                     !bitmap_isset(nsec->rr->nsec.types, DNS_TYPE_CNAME) &&
@@ -1245,6 +1739,8 @@ int dns_cache_lookup(
                                 ((have_confidential && !have_non_confidential) ? SD_RESOLVED_CONFIDENTIAL : 0);
                 if (ret_dnssec_result)
                         *ret_dnssec_result = dnssec_result;
+                if (ret_prefetch)
+                        *ret_prefetch = prefetch;
 
                 return 1;
         }
@@ -1263,6 +1759,8 @@ int dns_cache_lookup(
                         ((have_confidential && !have_non_confidential) ? SD_RESOLVED_CONFIDENTIAL : 0);
         if (ret_dnssec_result)
                 *ret_dnssec_result = dnssec_result;
+        if (ret_prefetch)
+                *ret_prefetch = prefetch;
 
         return n;
 
@@ -1277,6 +1775,8 @@ miss:
                 *ret_query_flags = 0;
         if (ret_dnssec_result)
                 *ret_dnssec_result = _DNSSEC_RESULT_INVALID;
+        if (ret_prefetch)
+                *ret_prefetch = false;
 
         c->n_miss++;
         return 0;
@@ -1502,6 +2002,293 @@ int dns_cache_dump_to_json(DnsCache *cache, sd_json_variant **ret) {
         return 0;
 }
 
+static int dns_cache_item_to_snapshot(DnsCacheItem *i, usec_t timestamp, sd_json_variant **ret) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *k = NULL, *a = NULL;
+        DnsAnswerItem *item;
+        int r;
+
+        assert(i);
+        assert(ret);
+
+        r = dns_resource_key_to_json(i->key, &k);
+        if (r < 0)
+                return r;
+
+        if (i->rr) {
+                r = dns_resource_record_to_wire_format(i->rr, /* canonical= */ false);
+                if (r < 0)
+                        return r;
+        }
+
+        DNS_ANSWER_FOREACH_ITEM(item, i->answer) {
+                r = dns_resource_record_to_wire_format(item->rr, /* canonical= */ false);
+                if (r < 0)
+                        return r;
+
+                r = sd_json_variant_append_arraybo(
+                                &a,
+                                SD_JSON_BUILD_PAIR_BASE64("rr", item->rr->wire_format, item->rr->wire_format_size),
+                                SD_JSON_BUILD_PAIR_UNSIGNED("flags", item->flags),
+                                SD_JSON_BUILD_PAIR_CONDITION(item->ifindex != 0, "ifindex", SD_JSON_BUILD_INTEGER(item->ifindex)));
+                if (r < 0)
+                        return r;
+        }
+
+        return sd_json_buildo(
+                        ret,
+                        SD_JSON_BUILD_PAIR_STRING("type", dns_cache_item_type_to_string(i)),
+                        SD_JSON_BUILD_PAIR_VARIANT("key", k),
+                        SD_JSON_BUILD_PAIR_CONDITION(!!i->rr, "rr", SD_JSON_BUILD_BASE64(i->rr ? i->rr->wire_format : NULL, i->rr ? i->rr->wire_format_size : 0)),
+                        SD_JSON_BUILD_PAIR_CONDITION(!!a, "answer", SD_JSON_BUILD_VARIANT(a)),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("validUSec", i->until_valid - timestamp),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("staleUSec", i->until - i->until_valid),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("flags", i->query_flags),
+                        SD_JSON_BUILD_PAIR_CONDITION(i->dnssec_result >= 0, "dnssec", SD_JSON_BUILD_STRING(dnssec_result_to_string(i->dnssec_result))),
+                        SD_JSON_BUILD_PAIR_CONDITION(i->ifindex != 0, "ifindex", SD_JSON_BUILD_INTEGER(i->ifindex)),
+                        SD_JSON_BUILD_PAIR_CONDITION(i->shared_owner, "shared", SD_JSON_BUILD_BOOLEAN(true)));
+}
+
+int dns_cache_save_snapshot(DnsCache *cache, sd_json_variant **ret) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *c = NULL;
+        usec_t timestamp;
+        int r;
+
+        assert(cache);
+        assert(ret);
+
+        /* Serializes the positive and negative entries of the cache, with their remaining lifetime, in least
+         * recently used order, so that they can be restored with dns_cache_load_snapshot() after a restart.
+         * Full packets are not included, they are only used for the rare bypass mode. */
+
+        timestamp = now(CLOCK_BOOTTIME);
+
+        LIST_FOREACH(by_lru, i, cache->by_lru) {
+                _cleanup_(sd_json_variant_unrefp) sd_json_variant *d = NULL;
+
+                if (i->type == DNS_CACHE_RCODE)
+                        continue;
+                if (i->until_valid <= timestamp)
+                        continue;
+
+                r = dns_cache_item_to_snapshot(i, timestamp, &d);
+                if (r < 0)
+                        return r;
+
+                r = sd_json_variant_append_array(&c, d);
+                if (r < 0)
+                        return r;
+        }
+
+        if (!c)
+                return sd_json_variant_new_array(ret, NULL, 0);
+
+        *ret = TAKE_PTR(c);
+        return 0;
+}
+
+static int dns_cache_answer_from_snapshot(sd_json_variant *v, DnsAnswer **ret) {
+        _cleanup_(dns_answer_unrefp) DnsAnswer *answer = NULL;
+        sd_json_variant *e;
+        int r;
+
+        assert(ret);
+
+        if (!v) {
+                *ret = NULL;
+                return 0;
+        }
+
+        if (!sd_json_variant_is_array(v))
+                return -EBADMSG;
+
+        answer = dns_answer_new(sd_json_variant_elements(v));
+        if (!answer)
+                return -ENOMEM;
+
+        JSON_VARIANT_ARRAY_FOREACH(e, v) {
+                _cleanup_(dns_resource_record_unrefp) DnsResourceRecord *rr = NULL;
+                _cleanup_(iovec_done) struct iovec raw = {};
+                uint64_t flags = 0;
+                int ifindex = 0;
+
+                sd_json_dispatch_field dispatch_table[] = {
+                        { "rr",      SD_JSON_VARIANT_STRING,        json_dispatch_unbase64_iovec, PTR_TO_SIZE(&raw),     SD_JSON_MANDATORY },
+                        { "flags",   _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64,      PTR_TO_SIZE(&flags),   0                 },
+                        { "ifindex", _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_int32,       PTR_TO_SIZE(&ifindex), 0                 },
+                        {}
+                };
+
+                r = sd_json_dispatch(e, dispatch_table, SD_JSON_ALLOW_EXTENSIONS, NULL);
+                if (r < 0)
+                        return r;
+
+                r = dns_resource_record_new_from_raw(&rr, raw.iov_base, raw.iov_len);
+                if (r < 0)
+                        return r;
+
+                r = dns_answer_add(answer, rr, ifindex, flags, NULL);
+                if (r < 0)
+                        return r;
+        }
+
+        *ret = TAKE_PTR(answer);
+        return 0;
+}
+
+static int dns_cache_item_from_snapshot(DnsCache *c, sd_json_variant *v, usec_t elapsed, bool validated_only, usec_t timestamp) {
+        _cleanup_(dns_resource_record_unrefp) DnsResourceRecord *rr = NULL;
+        _cleanup_(dns_resource_key_unrefp) DnsResourceKey *key = NULL;
+        _cleanup_(dns_cache_item_freep) DnsCacheItem *i = NULL;
+        _cleanup_(dns_answer_unrefp) DnsAnswer *answer = NULL;
+        _cleanup_(iovec_done) struct iovec raw = {};
+        sd_json_variant *key_json = NULL, *answer_json = NULL;
+        uint64_t valid_usec = 0, stale_usec = 0, query_flags = 0;
+        const char *type = NULL, *dnssec = NULL;
+        DnsCacheItemType t;
+        DnssecResult dnssec_result;
+        bool shared_owner = false;
+        int ifindex = 0, r;
+
+        sd_json_dispatch_field dispatch_table[] = {
+                { "type",      SD_JSON_VARIANT_STRING,        sd_json_dispatch_const_string,   PTR_TO_SIZE(&type),         SD_JSON_MANDATORY },
+                { "key",       SD_JSON_VARIANT_OBJECT,        sd_json_dispatch_variant_noref,  PTR_TO_SIZE(&key_json),     SD_JSON_MANDATORY },
+                { "rr",        SD_JSON_VARIANT_STRING,        json_dispatch_unbase64_iovec,    PTR_TO_SIZE(&raw),          0                 },
+                { "answer",    SD_JSON_VARIANT_ARRAY,         sd_json_dispatch_variant_noref,  PTR_TO_SIZE(&answer_json),  0                 },
+                { "validUSec", _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64,         PTR_TO_SIZE(&valid_usec),   SD_JSON_MANDATORY },
+                { "staleUSec", _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64,         PTR_TO_SIZE(&stale_usec),   0                 },
+                { "flags",     _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64,         PTR_TO_SIZE(&query_flags),  0                 },
+                { "dnssec",    SD_JSON_VARIANT_STRING,        sd_json_dispatch_const_string,   PTR_TO_SIZE(&dnssec),       0                 },
+                { "ifindex",   _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_int32,          PTR_TO_SIZE(&ifindex),      0                 },
+                { "shared",    SD_JSON_VARIANT_BOOLEAN,       sd_json_dispatch_stdbool,        PTR_TO_SIZE(&shared_owner), 0                 },
+                {}
+        };
+
+        assert(c);
+        assert(v);
+
+        r = sd_json_dispatch(v, dispatch_table, SD_JSON_ALLOW_EXTENSIONS, NULL);
+        if (r < 0)
+                return r;
+
+        if (streq(type, "POSITIVE"))
+                t = DNS_CACHE_POSITIVE;
+        else if (streq(type, "NODATA"))
+                t = DNS_CACHE_NODATA;
+        else if (streq(type, "NXDOMAIN"))
+                t = DNS_CACHE_NXDOMAIN;
+        else
+                return -EBADMSG;
+
+        if (dnssec) {
+                dnssec_result = dnssec_result_from_string(dnssec);
+                if (dnssec_result < 0)
+                        return -EBADMSG;
+        } else
+                dnssec_result = _DNSSEC_RESULT_INVALID;
+
+        /* Expired in the meantime? */
+        if (valid_usec <= elapsed)
+                return 0;
+
+        /* Only restore entries that were either validated successfully, or found to be unsigned, or (if the
+         * scope doesn't do DNSSEC now) were never validated at all. We cannot repeat the validation here, as
+         * we don't keep the auxiliary RRs around needed for that. */
+        if (!IN_SET(dnssec_result, DNSSEC_VALIDATED, DNSSEC_UNSIGNED) &&
+            (dnssec_result != _DNSSEC_RESULT_INVALID || validated_only))
+                return 0;
+
+        r = dns_resource_key_from_json(key_json, &key);
+        if (r < 0)
+                return r;
+
+        if (t == DNS_CACHE_POSITIVE) {
+                if (!iovec_is_set(&raw))
+                        return -EBADMSG;
+
+                r = dns_resource_record_new_from_raw(&rr, raw.iov_base, raw.iov_len);
+                if (r < 0)
+                        return r;
+
+                if (dns_cache_get(c, rr))
+                        return 0;
+        } else if (hashmap_contains(c->by_key, key))
+                return 0;
+
+        r = dns_cache_answer_from_snapshot(answer_json, &answer);
+        if (r < 0)
+                return r;
+
+        r = dns_cache_init(c);
+        if (r < 0)
+                return r;
+
+        size_t memory = dns_cache_item_memory(rr, answer, NULL);
+        dns_cache_make_space(c, 1, memory);
+
+        i = new(DnsCacheItem, 1);
+        if (!i)
+                return -ENOMEM;
+
+        if (rr)
+                DNS_RESOURCE_KEY_REPLACE(key, dns_resource_key_ref(rr->key));
+
+        usec_t until_valid = timestamp + valid_usec - elapsed;
+        *i = (DnsCacheItem) {
+                .type = t,
+                .rcode = t == DNS_CACHE_NXDOMAIN ? DNS_RCODE_NXDOMAIN : DNS_RCODE_SUCCESS,
+                .key = TAKE_PTR(key),
+                .rr = TAKE_PTR(rr),
+                .answer = TAKE_PTR(answer),
+                .until = usec_add(until_valid, stale_usec),
+                .until_valid = until_valid,
+                .prefetch_after = calculate_prefetch_after(until_valid, timestamp),
+                .query_flags = query_flags & CACHEABLE_QUERY_FLAGS,
+                .shared_owner = shared_owner,
+                .dnssec_result = dnssec_result,
+                .ifindex = ifindex,
+                .owner_family = AF_UNSPEC,
+                .prioq_idx = PRIOQ_IDX_NULL,
+                .memory = memory,
+        };
+
+        r = dns_cache_link_item(c, i);
+        if (r < 0)
+                return r;
+
+        if (i->rr && i->rr->key->type == DNS_TYPE_NSEC)
+                dns_cache_item_nsec_update(c, i, /* add= */ true);
+
+        TAKE_PTR(i);
+        return 1;
+}
+
+int dns_cache_load_snapshot(DnsCache *cache, sd_json_variant *v, usec_t elapsed, bool validated_only) {
+        sd_json_variant *e;
+        usec_t timestamp;
+        int n = 0, r;
+
+        assert(cache);
+
+        /* Restores a snapshot made with dns_cache_save_snapshot() 'elapsed' µs ago. Entries that expired
+         * since, or that would not pass DNSSEC validation in this scope are skipped. Entries already in the
+         * cache take precedence. Returns the number of restored items. */
+
+        if (!sd_json_variant_is_array(v))
+                return -EBADMSG;
+
+        timestamp = now(CLOCK_BOOTTIME);
+
+        JSON_VARIANT_ARRAY_FOREACH(e, v) {
+                r = dns_cache_item_from_snapshot(cache, e, elapsed, validated_only, timestamp);
+                if (r < 0)
+                        log_debug_errno(r, "Failed to restore cache entry from snapshot, ignoring: %m");
+                else if (r > 0)
+                        n++;
+        }
+
+        return n;
+}
+
 bool dns_cache_is_empty(DnsCache *cache) {
         if (!cache)
                 return true;
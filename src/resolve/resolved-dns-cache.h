@@ -8,11 +8,20 @@
 #include "resolved-dns-dnssec.h"
 #include "time-util.h"
 
+typedef struct DnsCacheItem DnsCacheItem;
+
 typedef struct DnsCache {
         Hashmap *by_key;
+        Hashmap *nsec_by_zone;           /* Validated NSEC RRs, indexed by their signer zone, for RFC 8198 */
         Prioq *by_expiry;
+        LIST_HEAD(DnsCacheItem, by_lru); /* Least recently used first */
+        DnsCacheItem *by_lru_tail;
+        uint64_t memory;                 /* Estimated memory used by the cache items, in bytes */
+        uint64_t memory_max;             /* If non-zero, limit for 'memory', replacing the CACHE_MAX entry limit */
         unsigned n_hit;
         unsigned n_miss;
+        unsigned n_prefetch;
+        unsigned n_synthesized;          /* Negative answers synthesized from cached NSEC RRs */
 } DnsCache;
 
 #include "resolved-dns-answer.h"
@@ -46,13 +55,17 @@ int dns_cache_lookup(
                 DnsAnswer **ret_answer,
                 DnsPacket **ret_full_packet,
                 uint64_t *ret_query_flags,
-                DnssecResult *ret_dnssec_result);
+                DnssecResult *ret_dnssec_result,
+                bool *ret_prefetch);
 
 int dns_cache_check_conflicts(DnsCache *cache, DnsResourceRecord *rr, int owner_family, const union in_addr_union *owner_address);
 
 void dns_cache_dump(DnsCache *cache, FILE *f);
 int dns_cache_dump_to_json(DnsCache *cache, sd_json_variant **ret);
 
+int dns_cache_save_snapshot(DnsCache *cache, sd_json_variant **ret);
+int dns_cache_load_snapshot(DnsCache *cache, sd_json_variant *v, usec_t elapsed, bool validated_only);
+
 bool dns_cache_is_empty(DnsCache *cache);
 
 unsigned dns_cache_size(DnsCache *cache);
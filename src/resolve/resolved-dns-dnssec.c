@@ -11,6 +11,7 @@
 #include "openssl-util.h"
 #include "resolved-dns-dnssec.h"
 #include "resolved-dns-packet.h"
+#include "sha256.h"
 #include "sort-util.h"
 #include "string-table.h"
 
@@ -32,6 +33,9 @@ DEFINE_TRIVIAL_CLEANUP_FUNC_FULL(EC_KEY*, EC_KEY_free, NULL);
  * RFC9276 § 3.2 says that we should reduce the acceptable iteration count */
 #define NSEC3_ITERATIONS_MAX 100
 
+/* Maximum number of signature verification results we remember */
+#define VERIFY_CACHE_MAX 4096U
+
 /*
  * The DNSSEC Chain of trust:
  *
@@ -975,12 +979,92 @@ static int dnssec_rrset_verify_sig(
         }
 }
 
-int dnssec_verify_rrset(
+typedef struct VerifyCacheEntry {
+        uint8_t digest[SHA256_DIGEST_SIZE]; /* must be first */
+        bool valid;
+} VerifyCacheEntry;
+
+static void verify_cache_entry_hash_func(const VerifyCacheEntry *e, struct siphash *state) {
+        siphash24_compress(e->digest, sizeof(e->digest), state);
+}
+
+static int verify_cache_entry_compare_func(const VerifyCacheEntry *x, const VerifyCacheEntry *y) {
+        return memcmp(x->digest, y->digest, sizeof(x->digest));
+}
+
+DEFINE_PRIVATE_HASH_OPS_WITH_KEY_DESTRUCTOR(
+                verify_cache_hash_ops,
+                VerifyCacheEntry,
+                verify_cache_entry_hash_func,
+                verify_cache_entry_compare_func,
+                free);
+
+static int dnssec_rrset_verify_sig_cached(
+                Set **verify_cache,
+                DnsResourceRecord *rrsig,
+                DnsResourceRecord *dnskey,
+                const char *sig_data,
+                size_t sig_size) {
+
+        _cleanup_free_ VerifyCacheEntry *e = NULL;
+        struct sha256_ctx ctx;
+        VerifyCacheEntry lookup = {};
+        int r;
+
+        assert(rrsig);
+        assert(dnskey);
+
+        if (!verify_cache)
+                return dnssec_rrset_verify_sig(rrsig, dnskey, sig_data, sig_size);
+
+        /* The signed data covers the RRSIG RDATA (minus the signature itself, but including the validity
+         * period) and the canonical form of the RRset. Together with the signature and the public key
+         * that fully determines the outcome of the verification, hence remember it under a digest of all
+         * three. The validity period is checked by our callers on each use, so entries never go stale, and
+         * RRsets we see again (because they were refetched after their TTL ran out, or are looked up on
+         * multiple links, or as the DNSKEY self-signature in every chain ending in the zone) only cost us
+         * a hash instead of a public key operation. */
+
+        sha256_init_ctx(&ctx);
+        sha256_process_bytes(&rrsig->rrsig.algorithm, sizeof(rrsig->rrsig.algorithm), &ctx);
+        sha256_process_bytes_and_size(sig_data, sig_size, &ctx);
+        sha256_process_bytes_and_size(rrsig->rrsig.signature, rrsig->rrsig.signature_size, &ctx);
+        sha256_process_bytes_and_size(dnskey->dnskey.key, dnskey->dnskey.key_size, &ctx);
+        sha256_finish_ctx(&ctx, lookup.digest);
+
+        VerifyCacheEntry *found = set_get(*verify_cache, &lookup);
+        if (found)
+                return found->valid;
+
+        r = dnssec_rrset_verify_sig(rrsig, dnskey, sig_data, sig_size);
+        if (r < 0)
+                return r;
+
+        /* Keep this bounded, and simply start over when full: the entries that matter are reinstated
+         * quickly. */
+        if (set_size(*verify_cache) >= VERIFY_CACHE_MAX)
+                set_clear(*verify_cache);
+
+        e = newdup(VerifyCacheEntry, &lookup, 1);
+        if (!e)
+                return r;
+
+        e->valid = r > 0;
+
+        /* Failing to remember the result is not fatal */
+        if (set_ensure_put(verify_cache, &verify_cache_hash_ops, e) > 0)
+                TAKE_PTR(e);
+
+        return r;
+}
+
+int dnssec_verify_rrset_full(
                 DnsAnswer *a,
                 const DnsResourceKey *key,
                 DnsResourceRecord *rrsig,
                 DnsResourceRecord *dnskey,
                 usec_t realtime,
+                Set **verify_cache,
                 DnssecResult *result) {
 
         DnsResourceRecord **list, *rr;
@@ -1096,7 +1180,7 @@ int dnssec_verify_rrset(
         if (r < 0)
                 return r;
 
-        r = dnssec_rrset_verify_sig(rrsig, dnskey, sig_data, sig_size);
+        r = dnssec_rrset_verify_sig_cached(verify_cache, rrsig, dnskey, sig_data, sig_size);
         if (r == -EOPNOTSUPP) {
                 *result = DNSSEC_UNSUPPORTED_ALGORITHM;
                 return 0;
@@ -1169,6 +1253,7 @@ int dnssec_verify_rrset_search(
                 const DnsResourceKey *key,
                 DnsAnswer *validated_dnskeys,
                 usec_t realtime,
+                Set **verify_cache,
                 DnssecResult *result,
                 DnsResourceRecord **ret_rrsig) {
 
@@ -1232,7 +1317,7 @@ int dnssec_verify_rrset_search(
                          * the RRSet against the RRSIG and DNSKEY
                          * combination. */
 
-                        r = dnssec_verify_rrset(a, key, rrsig, dnskey, realtime, &one_result);
+                        r = dnssec_verify_rrset_full(a, key, rrsig, dnskey, realtime, verify_cache, &one_result);
                         if (r < 0)
                                 return r;
 
@@ -2506,12 +2591,13 @@ int dnssec_test_positive_wildcard(
 
 #else
 
-int dnssec_verify_rrset(
+int dnssec_verify_rrset_full(
                 DnsAnswer *a,
                 const DnsResourceKey *key,
                 DnsResourceRecord *rrsig,
                 DnsResourceRecord *dnskey,
                 usec_t realtime,
+                Set **verify_cache,
                 DnssecResult *result) {
 
         return -EOPNOTSUPP;
@@ -2532,6 +2618,7 @@ int dnssec_verify_rrset_search(
                 const DnsResourceKey *key,
                 DnsAnswer *validated_dnskeys,
                 usec_t realtime,
+                Set **verify_cache,
                 DnssecResult *result,
                 DnsResourceRecord **ret_rrsig) {
 
@@ -220,6 +220,7 @@ static void dns_packet_free(DnsPacket *p) {
         while ((s = hashmap_steal_first_key(p->names)))
                 free(s);
         hashmap_free(p->names);
+        hashmap_free(p->read_names);
 
         free(p->_data);
 
@@ -425,6 +426,9 @@ void dns_packet_truncate(DnsPacket *p, size_t sz) {
                 free(s);
         }
 
+        /* Names may extend beyond the new end of the packet, hence forget all of them */
+        hashmap_clear(p->read_names);
+
         p->size = sz;
 }
 
@@ -1494,6 +1498,17 @@ int dns_packet_read_raw_string(DnsPacket *p, const void **ret, size_t *size, siz
         return 0;
 }
 
+DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(
+                read_name_hash_ops,
+                void,
+                trivial_hash_func,
+                trivial_compare_func,
+                char,
+                free);
+
+/* How many of the compression pointers followed while reading a single name we remember the targets of */
+#define READ_NAME_JUMPS_MAX 8U
+
 int dns_packet_read_name(
                 DnsPacket *p,
                 char **ret,
@@ -1505,6 +1520,11 @@ int dns_packet_read_name(
         _cleanup_(rewind_dns_packet) DnsPacketRewinder rewinder = REWINDER_INIT(p);
         size_t after_rindex = 0, jump_barrier = p->rindex;
         _cleanup_free_ char *name = NULL;
+        struct {
+                uint16_t ptr;
+                size_t offset;
+        } jumps[READ_NAME_JUMPS_MAX];
+        size_t n_jumps = 0;
         bool first = true;
         size_t n = 0;
         int r;
@@ -1559,6 +1579,37 @@ int dns_packet_read_name(
                         if (after_rindex == 0)
                                 after_rindex = p->rindex;
 
+                        /* Responses typically point to the same few names (the question, the owner of the
+                         * RRset, the zone) over and over again, hence remember what we decoded at the
+                         * targets of pointers, and use that instead of walking and escaping the labels
+                         * again. What a pointer target decodes to doesn't depend on how we got there, as
+                         * any further jumps from there are limited by the target's own offset. */
+                        const char *suffix = hashmap_get(p->read_names, UINT_TO_PTR(ptr));
+                        if (suffix) {
+                                size_t l = strlen(suffix);
+
+                                if (l > 0) {
+                                        if (!GREEDY_REALLOC(name, n + !first + l))
+                                                return -ENOMEM;
+
+                                        if (first)
+                                                first = false;
+                                        else
+                                                name[n++] = '.';
+
+                                        memcpy(name + n, suffix, l);
+                                        n += l;
+                                }
+
+                                break;
+                        }
+
+                        if (n_jumps < READ_NAME_JUMPS_MAX)
+                                jumps[n_jumps++] = (typeof(jumps[0])) {
+                                        .ptr = ptr,
+                                        .offset = n + !first,
+                                };
+
                         /* Jumps are limited to a "prior occurrence" (RFC-1035 4.1.4) */
                         jump_barrier = ptr;
                         p->rindex = ptr;
@@ -1571,6 +1622,21 @@ int dns_packet_read_name(
 
         name[n] = 0;
 
+        FOREACH_ARRAY(j, jumps, n_jumps) {
+                _cleanup_free_ char *s = NULL;
+
+                /* If nothing followed the pointer, the target is the root domain */
+                s = strdup(j->offset <= n ? name + j->offset : "");
+                if (!s)
+                        return -ENOMEM;
+
+                r = hashmap_ensure_put(&p->read_names, &read_name_hash_ops, UINT_TO_PTR(j->ptr), s);
+                if (r < 0)
+                        return r;
+
+                TAKE_PTR(s);
+        }
+
         if (after_rindex != 0)
                 p->rindex= after_rindex;
 
@@ -64,6 +64,7 @@ struct DnsPacket {
         size_t size, allocated, rindex, max_size, fragsize;
         void *_data; /* don't access directly, use DNS_PACKET_DATA()! */
         Hashmap *names; /* For name compression */
+        Hashmap *read_names; /* For name decompression: offset of a compression pointer target → name */
         size_t opt_start, opt_size;
 
         /* Parsed data */
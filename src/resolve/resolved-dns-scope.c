@@ -26,6 +26,9 @@
 #define MULTICAST_RESEND_TIMEOUT_MIN_USEC (100 * USEC_PER_MSEC)
 #define MULTICAST_RESEND_TIMEOUT_MAX_USEC (1 * USEC_PER_SEC)
 
+/* How often to send a transaction to another DNS server than the current one, with PreferFastestServer=yes */
+#define DNS_SERVER_PROBE_INTERVAL_USEC (1 * USEC_PER_MINUTE)
+
 int dns_scope_new(Manager *m, DnsScope **ret, Link *l, DnsProtocol protocol, int family) {
         DnsScope *s;
 
@@ -75,6 +78,9 @@ int dns_scope_new(Manager *m, DnsScope **ret, Link *l, DnsProtocol protocol, int
         /* Enforce ratelimiting for the multicast protocols */
         s->ratelimit = (const RateLimit) { MULTICAST_RATELIMIT_INTERVAL_USEC, MULTICAST_RATELIMIT_BURST };
 
+        /* Restore what the previous instance of resolved had cached for this scope, if anything */
+        manager_apply_cache_snapshot(m, s);
+
         *ret = s;
         return 0;
 }
@@ -173,6 +179,40 @@ void dns_scope_next_dns_server(DnsScope *s, DnsServer *if_current) {
                 manager_next_dns_server(s->manager, if_current);
 }
 
+DnsServer* dns_scope_probe_dns_server(DnsScope *s, DnsServer *current) {
+        DnsServer *first;
+        usec_t n;
+
+        assert(s);
+        assert(current);
+
+        /* With PreferFastestServer=yes, returns the DNS server to send the next transaction to instead of
+         * the current one, once in a while, so that we know the round trip times of all servers. */
+
+        if (s->protocol != DNS_PROTOCOL_DNS || !s->manager->prefer_fastest_server)
+                return NULL;
+
+        n = now(CLOCK_BOOTTIME);
+        if (s->next_server_probe_usec == 0) {
+                /* Don't probe right away, we haven't even heard from the current server yet */
+                s->next_server_probe_usec = usec_add(n, DNS_SERVER_PROBE_INTERVAL_USEC);
+                return NULL;
+        }
+        if (n < s->next_server_probe_usec)
+                return NULL;
+
+        s->next_server_probe_usec = usec_add(n, DNS_SERVER_PROBE_INTERVAL_USEC);
+
+        if (s->link)
+                first = s->link->dns_servers;
+        else if (current->type == DNS_SERVER_FALLBACK)
+                first = s->manager->fallback_dns_servers;
+        else
+                first = s->manager->dns_servers;
+
+        return dns_server_pick_probe(first, current);
+}
+
 void dns_scope_packet_received(DnsScope *s, usec_t rtt) {
         assert(s);
 
@@ -1732,6 +1772,8 @@ int dns_scope_dump_cache_to_json(DnsScope *scope, sd_json_variant **ret) {
                         SD_JSON_BUILD_PAIR_CONDITION(scope->family != AF_UNSPEC, "family", SD_JSON_BUILD_INTEGER(scope->family)),
                         SD_JSON_BUILD_PAIR_CONDITION(!!scope->link, "ifindex", SD_JSON_BUILD_INTEGER(scope->link ? scope->link->ifindex : 0)),
                         SD_JSON_BUILD_PAIR_CONDITION(!!scope->link, "ifname", SD_JSON_BUILD_STRING(scope->link ? scope->link->ifname : NULL)),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("cacheMemory", scope->cache.memory),
+                        SD_JSON_BUILD_PAIR_CONDITION(scope->cache.memory_max > 0, "cacheMemoryMax", SD_JSON_BUILD_UNSIGNED(scope->cache.memory_max)),
                         SD_JSON_BUILD_PAIR_VARIANT("cache", cache));
 }
 
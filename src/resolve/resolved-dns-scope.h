@@ -53,6 +53,9 @@ struct DnsScope {
         usec_t resend_timeout;
         usec_t max_rtt;
 
+        /* When to send a transaction to another DNS server than the current one next, with PreferFastestServer=yes */
+        usec_t next_server_probe_usec;
+
         LIST_HEAD(DnsQueryCandidate, query_candidates);
 
         /* Note that we keep track of ongoing transactions in two ways: once in a hashmap, indexed by the rr
@@ -85,6 +88,7 @@ bool dns_scope_good_key(DnsScope *s, const DnsResourceKey *key);
 DnsServer *dns_scope_get_dns_server(DnsScope *s);
 unsigned dns_scope_get_n_dns_servers(DnsScope *s);
 void dns_scope_next_dns_server(DnsScope *s, DnsServer *if_current);
+DnsServer* dns_scope_probe_dns_server(DnsScope *s, DnsServer *current);
 
 int dns_scope_llmnr_membership(DnsScope *s, bool b);
 int dns_scope_mdns_membership(DnsScope *s, bool b);
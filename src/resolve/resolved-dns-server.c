@@ -19,6 +19,15 @@
 /* The number of times we will attempt a certain feature set before degrading */
 #define DNS_SERVER_FEATURE_RETRY_ATTEMPTS 3
 
+/* The round trip time of a server is smoothed like TCP does it (RFC 6298), i.e. each new sample makes up
+ * 1/DNS_SERVER_RTT_SMOOTHING of it. A lost packet counts like a reply after DNS_SERVER_RTT_LOST_USEC. */
+#define DNS_SERVER_RTT_SMOOTHING 8U
+#define DNS_SERVER_RTT_LOST_USEC (5 * USEC_PER_SEC)
+
+/* With PreferFastestServer=yes, switch to another server only if its round trip time is at most
+ * 1/DNS_SERVER_RTT_PREFER_FACTOR of the current one's, so that we don't flip-flop between servers */
+#define DNS_SERVER_RTT_PREFER_FACTOR 2U
+
 int dns_server_new(
                 Manager *m,
                 DnsServer **ret,
@@ -114,7 +123,7 @@ int dns_server_new(
 static DnsServer* dns_server_free(DnsServer *s)  {
         assert(s);
 
-        dns_server_unref_stream(s);
+        dns_server_unref_streams(s);
 
 #if ENABLE_DNS_OVER_TLS
         dnstls_server_free(s);
@@ -171,8 +180,8 @@ void dns_server_unlink(DnsServer *s) {
         if (s->manager->current_dns_server == s)
                 manager_set_dns_server(s->manager, NULL);
 
-        /* No need to keep a default stream around anymore */
-        dns_server_unref_stream(s);
+        /* No need to keep the streams around anymore */
+        dns_server_unref_streams(s);
 
         dns_server_unref(s);
 }
@@ -257,9 +266,31 @@ static void dns_server_reset_counters(DnsServer *s) {
          * incomplete. */
 }
 
-void dns_server_packet_received(DnsServer *s, int protocol, DnsServerFeatureLevel level, size_t fragsize) {
+static void dns_server_rtt_update(DnsServer *s, usec_t rtt) {
         assert(s);
 
+        rtt = MAX(rtt, UINT64_C(1));
+
+        if (s->rtt_usec == 0)
+                s->rtt_usec = rtt;
+        else
+                s->rtt_usec = s->rtt_usec - s->rtt_usec / DNS_SERVER_RTT_SMOOTHING + rtt / DNS_SERVER_RTT_SMOOTHING;
+
+        s->rtt_timestamp = now(CLOCK_BOOTTIME);
+}
+
+void dns_server_packet_received(DnsServer *s, int protocol, DnsServerFeatureLevel level, size_t fragsize, usec_t rtt) {
+        DnsServerRttProtocol rtt_protocol;
+
+        assert(s);
+
+        rtt_protocol = protocol == IPPROTO_UDP ? DNS_SERVER_RTT_UDP :
+                DNS_SERVER_FEATURE_LEVEL_IS_TLS(level) ? DNS_SERVER_RTT_TLS : DNS_SERVER_RTT_TCP;
+
+        dns_server_rtt_histogram_add(s->rtt_histogram, rtt_protocol, rtt);
+        dns_server_rtt_histogram_add(s->manager->rtt_histogram, rtt_protocol, rtt);
+        dns_server_rtt_update(s, rtt);
+
         if (protocol == IPPROTO_UDP) {
                 if (s->possible_feature_level == level)
                         s->n_failed_udp = 0;
@@ -290,12 +321,16 @@ void dns_server_packet_received(DnsServer *s, int protocol, DnsServerFeatureLeve
          * can always announce support for packets with at least this size. */
         if (protocol == IPPROTO_UDP && s->received_udp_fragment_max < fragsize)
                 s->received_udp_fragment_max = fragsize;
+
+        dns_server_maybe_prefer(s);
 }
 
 void dns_server_packet_lost(DnsServer *s, int protocol, DnsServerFeatureLevel level) {
         assert(s);
         assert(s->manager);
 
+        dns_server_rtt_update(s, DNS_SERVER_RTT_LOST_USEC);
+
         if (s->possible_feature_level != level)
                 return;
 
@@ -932,6 +967,18 @@ void manager_next_dns_server(Manager *m, DnsServer *if_current) {
         if (!m->current_dns_server)
                 return;
 
+        if (m->prefer_fastest_server) {
+                DnsServer *s;
+
+                s = dns_server_pick_fastest(
+                                m->current_dns_server->type == DNS_SERVER_FALLBACK ? m->fallback_dns_servers : m->dns_servers,
+                                m->current_dns_server);
+                if (s) {
+                        manager_set_dns_server(m, s);
+                        return;
+                }
+        }
+
         /* Change to the next one, but make sure to follow the linked list only if the server is still
          * linked. */
         if (m->current_dns_server->linked && m->current_dns_server->servers_next) {
@@ -1001,8 +1048,8 @@ void dns_server_reset_features(DnsServer *s) {
 
         dns_server_reset_counters(s);
 
-        /* Let's close the default stream, so that we reprobe with the new features */
-        dns_server_unref_stream(s);
+        /* Let's close the streams, so that we reprobe with the new features */
+        dns_server_unref_streams(s);
 }
 
 void dns_server_reset_features_all(DnsServer *s) {
@@ -1065,18 +1112,78 @@ void dns_server_dump(DnsServer *s, FILE *f) {
                 yes_no(s->packet_do_off));
 }
 
-void dns_server_unref_stream(DnsServer *s) {
-        DnsStream *ref;
+DnsStream* dns_server_pick_stream(DnsServer *s, bool encrypted) {
+        DnsStream *best = NULL;
 
         assert(s);
 
-        /* Detaches the default stream of this server. Some special care needs to be taken here, as that stream and
-         * this server reference each other. First, take the stream out of the server. It's destructor will check if it
-         * is registered with us, hence let's invalidate this separately, so that it is already unregistered. */
-        ref = TAKE_PTR(s->stream);
+        /* Returns the least busy stream of the pool that we can pipeline another query on. Returns NULL if
+         * there is none, or if all are busy and there's room for opening another one. Replies are matched to
+         * transactions by their ID, hence a slow reply doesn't hold up the other queries on a stream, but
+         * spreading the load still avoids head-of-line blocking on the TCP and TLS level. */
+
+        LIST_FOREACH(streams_by_server, i, s->streams) {
+                if (i->encrypted != encrypted || i->fd < 0)
+                        continue;
+
+                if (!best || i->n_transactions < best->n_transactions)
+                        best = i;
+        }
+
+        if (best &&
+            best->n_transactions >= DNS_STREAM_PIPELINE_MAX &&
+            s->n_streams < DNS_SERVER_STREAMS_MAX)
+                return NULL;
+
+        return best;
+}
+
+void dns_server_add_stream(DnsServer *s, DnsStream *stream) {
+        assert(s);
+        assert(stream);
+        assert(!stream->pooled);
+
+        /* Streams with a different encryption state were opened for another feature level, drop them */
+        LIST_FOREACH(streams_by_server, i, s->streams)
+                if (i->encrypted != stream->encrypted) {
+                        dns_server_unref_streams(s);
+                        break;
+                }
+
+        /* Make room by dropping the oldest stream, queries that are still pending on it are finished on it */
+        if (s->n_streams >= DNS_SERVER_STREAMS_MAX) {
+                DnsStream *oldest = LIST_FIND_TAIL(streams_by_server, s->streams);
+                dns_server_remove_stream(s, oldest);
+        }
 
-        /* And then, unref it */
-        dns_stream_unref(ref);
+        LIST_PREPEND(streams_by_server, s->streams, stream);
+        dns_stream_ref(stream);
+        stream->pooled = true;
+        s->n_streams++;
+}
+
+void dns_server_remove_stream(DnsServer *s, DnsStream *stream) {
+        assert(s);
+        assert(stream);
+
+        if (!stream->pooled)
+                return;
+
+        /* Some special care needs to be taken here, as the stream and this server reference each other. First,
+         * take the stream out of the server, and only then unref it, as that might free it. */
+        LIST_REMOVE(streams_by_server, s->streams, stream);
+        stream->pooled = false;
+        assert(s->n_streams > 0);
+        s->n_streams--;
+
+        dns_stream_unref(stream);
+}
+
+void dns_server_unref_streams(DnsServer *s) {
+        assert(s);
+
+        while (s->streams)
+                dns_server_remove_stream(s, s->streams);
 }
 
 DnsScope *dns_server_scope(DnsServer *s) {
@@ -1096,6 +1203,13 @@ static const char* const dns_server_type_table[_DNS_SERVER_TYPE_MAX] = {
 };
 DEFINE_STRING_TABLE_LOOKUP(dns_server_type, DnsServerType);
 
+static const char* const dns_server_rtt_protocol_table[_DNS_SERVER_RTT_PROTOCOL_MAX] = {
+        [DNS_SERVER_RTT_UDP] = "udp",
+        [DNS_SERVER_RTT_TCP] = "tcp",
+        [DNS_SERVER_RTT_TLS] = "tls",
+};
+DEFINE_STRING_TABLE_LOOKUP_TO_STRING(dns_server_rtt_protocol, DnsServerRttProtocol);
+
 static const char* const dns_server_feature_level_table[_DNS_SERVER_FEATURE_LEVEL_MAX] = {
         [DNS_SERVER_FEATURE_LEVEL_TCP]       = "TCP",
         [DNS_SERVER_FEATURE_LEVEL_UDP]       = "UDP",
@@ -1106,11 +1220,53 @@ static const char* const dns_server_feature_level_table[_DNS_SERVER_FEATURE_LEVE
 };
 DEFINE_STRING_TABLE_LOOKUP(dns_server_feature_level, DnsServerFeatureLevel);
 
+static int dns_server_dump_streams_to_json(DnsServer *server, sd_json_variant **ret) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        int r;
+
+        assert(server);
+        assert(ret);
+
+        LIST_FOREACH(streams_by_server, i, server->streams) {
+                usec_t average = i->n_replies > 0 ? i->reply_usec_sum / i->n_replies : 0;
+                bool resumed = false;
+
+#if ENABLE_DNS_OVER_TLS
+                if (i->encrypted)
+                        resumed = dnstls_stream_session_resumed(i);
+#endif
+
+                r = sd_json_variant_append_arraybo(
+                                &v,
+                                SD_JSON_BUILD_PAIR_BOOLEAN("Encrypted", i->encrypted),
+                                SD_JSON_BUILD_PAIR_UNSIGNED("PendingQueries", i->n_transactions),
+                                SD_JSON_BUILD_PAIR_UNSIGNED("QueuedPackets", ordered_set_size(i->write_queue)),
+                                SD_JSON_BUILD_PAIR_UNSIGNED("Replies", i->n_replies),
+                                SD_JSON_BUILD_PAIR_CONDITION(i->n_replies > 0, "AverageReplyUSec", SD_JSON_BUILD_UNSIGNED(average)),
+                                SD_JSON_BUILD_PAIR_CONDITION(i->encrypted, "TLSSessionResumed", SD_JSON_BUILD_BOOLEAN(resumed)));
+                if (r < 0)
+                        return r;
+        }
+
+        *ret = TAKE_PTR(v);
+        return 0;
+}
+
 int dns_server_dump_state_to_json(DnsServer *server, sd_json_variant **ret) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *streams = NULL, *latency = NULL;
+        int r;
 
         assert(server);
         assert(ret);
 
+        r = dns_server_dump_streams_to_json(server, &streams);
+        if (r < 0)
+                return r;
+
+        r = dns_server_rtt_histogram_to_json(server->rtt_histogram, &latency);
+        if (r < 0)
+                return r;
+
         return sd_json_buildo(
                         ret,
                         SD_JSON_BUILD_PAIR_STRING("Server", strna(dns_server_string_full(server))),
@@ -1128,5 +1284,130 @@ int dns_server_dump_state_to_json(DnsServer *server, sd_json_variant **ret) {
                         SD_JSON_BUILD_PAIR_BOOLEAN("PacketBadOpt", server->packet_bad_opt),
                         SD_JSON_BUILD_PAIR_BOOLEAN("PacketRRSIGMissing", server->packet_rrsig_missing),
                         SD_JSON_BUILD_PAIR_BOOLEAN("PacketInvalid", server->packet_invalid),
-                        SD_JSON_BUILD_PAIR_BOOLEAN("PacketDoOff", server->packet_do_off));
+                        SD_JSON_BUILD_PAIR_BOOLEAN("PacketDoOff", server->packet_do_off),
+                        SD_JSON_BUILD_PAIR_CONDITION(!!streams, "Connections", SD_JSON_BUILD_VARIANT(streams)),
+                        SD_JSON_BUILD_PAIR_CONDITION(server->rtt_usec > 0, "SmoothedRTTUSec", SD_JSON_BUILD_UNSIGNED(server->rtt_usec)),
+                        SD_JSON_BUILD_PAIR_CONDITION(!sd_json_variant_is_blank_array(latency), "Latency", SD_JSON_BUILD_VARIANT(latency)));
+}
+
+void dns_server_rtt_histogram_add(DnsServerRttHistogram h, DnsServerRttProtocol protocol, usec_t rtt) {
+        size_t i = 0;
+
+        assert(h);
+        assert(protocol >= 0 && protocol < _DNS_SERVER_RTT_PROTOCOL_MAX);
+
+        for (usec_t limit = DNS_SERVER_RTT_BUCKET_FIRST_USEC; i < DNS_SERVER_RTT_BUCKETS - 1 && rtt > limit; limit *= 2)
+                i++;
+
+        h[protocol][i]++;
+}
+
+int dns_server_rtt_histogram_to_json(DnsServerRttHistogram h, sd_json_variant **ret) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        int r;
+
+        assert(h);
+        assert(ret);
+
+        /* Only the non-empty buckets are listed, each with the upper limit of the round trip times it
+         * counts, or without one for the last bucket. */
+
+        for (DnsServerRttProtocol p = 0; p < _DNS_SERVER_RTT_PROTOCOL_MAX; p++) {
+                _cleanup_(sd_json_variant_unrefp) sd_json_variant *buckets = NULL;
+                uint64_t total = 0;
+
+                for (size_t i = 0; i < DNS_SERVER_RTT_BUCKETS; i++) {
+                        if (h[p][i] == 0)
+                                continue;
+
+                        r = sd_json_variant_append_arraybo(
+                                        &buckets,
+                                        SD_JSON_BUILD_PAIR_CONDITION(i < DNS_SERVER_RTT_BUCKETS - 1, "maxUSec",
+                                                                     SD_JSON_BUILD_UNSIGNED(DNS_SERVER_RTT_BUCKET_FIRST_USEC << i)),
+                                        SD_JSON_BUILD_PAIR_UNSIGNED("count", h[p][i]));
+                        if (r < 0)
+                                return r;
+
+                        total += h[p][i];
+                }
+
+                if (total == 0)
+                        continue;
+
+                r = sd_json_variant_append_arraybo(
+                                &v,
+                                SD_JSON_BUILD_PAIR_STRING("protocol", dns_server_rtt_protocol_to_string(p)),
+                                SD_JSON_BUILD_PAIR_UNSIGNED("count", total),
+                                SD_JSON_BUILD_PAIR_VARIANT("buckets", buckets));
+                if (r < 0)
+                        return r;
+        }
+
+        if (!v)
+                return sd_json_variant_new_array(ret, NULL, 0);
+
+        *ret = TAKE_PTR(v);
+        return 0;
+}
+
+DnsServer* dns_server_pick_fastest(DnsServer *first, DnsServer *exclude) {
+        DnsServer *best = NULL;
+
+        /* Returns the server of the list with the lowest round trip time, other than 'exclude'. Servers we
+         * haven't heard from yet are preferred, so that we learn about them. */
+
+        LIST_FOREACH(servers, s, first) {
+                if (s == exclude || manager_server_is_stub(s->manager, s))
+                        continue;
+
+                if (!best || s->rtt_usec < best->rtt_usec)
+                        best = s;
+        }
+
+        return best;
+}
+
+DnsServer* dns_server_pick_probe(DnsServer *first, DnsServer *current) {
+        DnsServer *best = NULL;
+
+        /* Returns the server of the list, other than the current one, whose round trip time we know least
+         * about, i.e. which we haven't heard from for the longest time. */
+
+        LIST_FOREACH(servers, s, first) {
+                if (s == current || manager_server_is_stub(s->manager, s))
+                        continue;
+
+                if (!best || s->rtt_timestamp < best->rtt_timestamp)
+                        best = s;
+        }
+
+        return best;
+}
+
+void dns_server_maybe_prefer(DnsServer *s) {
+        DnsServer *current;
+
+        assert(s);
+
+        /* With PreferFastestServer=yes, switches to this server if it answers a lot faster than the one we
+         * currently use for its scope */
+
+        if (!s->manager->prefer_fastest_server || !s->linked)
+                return;
+
+        current = s->link ? s->link->current_dns_server : s->manager->current_dns_server;
+        if (!current || current == s || current->type != s->type)
+                return;
+
+        if (current->rtt_usec == 0 || s->rtt_usec * DNS_SERVER_RTT_PREFER_FACTOR > current->rtt_usec)
+                return;
+
+        log_debug("DNS server %s answers faster (%s) than %s (%s), switching.",
+                  strna(dns_server_string_full(s)), FORMAT_TIMESPAN(s->rtt_usec, USEC_PER_MSEC),
+                  strna(dns_server_string_full(current)), FORMAT_TIMESPAN(current->rtt_usec, USEC_PER_MSEC));
+
+        if (s->link)
+                link_set_dns_server(s->link, s);
+        else
+                manager_set_dns_server(s->manager, s);
 }
@@ -51,6 +51,24 @@ typedef enum DnsServerFeatureLevel {
 const char* dns_server_feature_level_to_string(DnsServerFeatureLevel i) _const_;
 DnsServerFeatureLevel dns_server_feature_level_from_string(const char *s) _pure_;
 
+typedef enum DnsServerRttProtocol {
+        DNS_SERVER_RTT_UDP,
+        DNS_SERVER_RTT_TCP,
+        DNS_SERVER_RTT_TLS,
+        _DNS_SERVER_RTT_PROTOCOL_MAX,
+        _DNS_SERVER_RTT_PROTOCOL_INVALID = -EINVAL,
+} DnsServerRttProtocol;
+
+const char* dns_server_rtt_protocol_to_string(DnsServerRttProtocol i) _const_;
+
+/* Round trip times are counted in buckets of exponentially growing size: the first one counts replies
+ * received within 1ms, the next one those within 2ms, and so on. The last one counts everything slower
+ * than 8s. */
+#define DNS_SERVER_RTT_BUCKETS 15U
+#define DNS_SERVER_RTT_BUCKET_FIRST_USEC USEC_PER_MSEC
+
+typedef unsigned DnsServerRttHistogram[_DNS_SERVER_RTT_PROTOCOL_MAX][DNS_SERVER_RTT_BUCKETS];
+
 struct DnsServer {
         Manager *manager;
 
@@ -68,8 +86,9 @@ struct DnsServer {
         char *server_string;
         char *server_string_full;
 
-        /* The long-lived stream towards this server. */
-        DnsStream *stream;
+        /* The pool of long-lived streams towards this server, see dns_server_pick_stream(). */
+        LIST_HEAD(DnsStream, streams);
+        unsigned n_streams;
 
 #if ENABLE_DNS_OVER_TLS
         DnsTlsServerData dnstls_data;
@@ -84,6 +103,11 @@ struct DnsServer {
         unsigned n_failed_tcp;
         unsigned n_failed_tls;
 
+        /* Round trip times of the replies from this server, see dns_server_rtt_add() */
+        DnsServerRttHistogram rtt_histogram;
+        usec_t rtt_usec;                /* smoothed, 0 if not measured yet */
+        usec_t rtt_timestamp;           /* when rtt_usec was last updated */
+
         bool packet_truncated:1;        /* Set when TC bit was set on reply */
         bool packet_bad_opt:1;          /* Set when OPT was missing or otherwise bad on reply */
         bool packet_rrsig_missing:1;    /* Set when RRSIG was missing */
@@ -126,7 +150,7 @@ DnsServer* dns_server_unref(DnsServer *s);
 void dns_server_unlink(DnsServer *s);
 void dns_server_move_back_and_unmark(DnsServer *s);
 
-void dns_server_packet_received(DnsServer *s, int protocol, DnsServerFeatureLevel level, size_t fragsize);
+void dns_server_packet_received(DnsServer *s, int protocol, DnsServerFeatureLevel level, size_t fragsize, usec_t rtt);
 void dns_server_packet_lost(DnsServer *s, int protocol, DnsServerFeatureLevel level);
 void dns_server_packet_truncated(DnsServer *s, DnsServerFeatureLevel level);
 void dns_server_packet_rrsig_missing(DnsServer *s, DnsServerFeatureLevel level);
@@ -178,8 +202,23 @@ void dns_server_reset_features_all(DnsServer *s);
 
 void dns_server_dump(DnsServer *s, FILE *f);
 
-void dns_server_unref_stream(DnsServer *s);
+/* Up to this many queries are pipelined on a stream before another one is opened to the same server, and up
+ * to this many streams are kept open to each server. */
+#define DNS_STREAM_PIPELINE_MAX 16U
+#define DNS_SERVER_STREAMS_MAX 4U
+
+DnsStream* dns_server_pick_stream(DnsServer *s, bool encrypted);
+void dns_server_add_stream(DnsServer *s, DnsStream *stream);
+void dns_server_remove_stream(DnsServer *s, DnsStream *stream);
+void dns_server_unref_streams(DnsServer *s);
 
 DnsScope *dns_server_scope(DnsServer *s);
 
 int dns_server_dump_state_to_json(DnsServer *server, sd_json_variant **ret);
+
+void dns_server_rtt_histogram_add(DnsServerRttHistogram h, DnsServerRttProtocol protocol, usec_t rtt);
+int dns_server_rtt_histogram_to_json(DnsServerRttHistogram h, sd_json_variant **ret);
+
+DnsServer* dns_server_pick_fastest(DnsServer *first, DnsServer *exclude);
+DnsServer* dns_server_pick_probe(DnsServer *first, DnsServer *current);
+void dns_server_maybe_prefer(DnsServer *s);
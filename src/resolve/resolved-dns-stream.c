@@ -588,10 +588,7 @@ void dns_stream_detach(DnsStream *s) {
         if (!s->server)
                 return;
 
-        if (s->server->stream != s)
-                return;
-
-        dns_server_unref_stream(s->server);
+        dns_server_remove_stream(s->server, s);
 }
 
 DEFINE_PRIVATE_HASH_OPS_WITH_KEY_DESTRUCTOR(
@@ -84,7 +84,11 @@ struct DnsStream {
         int (*complete)(DnsStream *s, int error);
 
         LIST_HEAD(DnsTransaction, transactions); /* when used by the transaction logic */
+        unsigned n_transactions;                 /* when used by the transaction logic */
         DnsServer *server;                       /* when used by the transaction logic */
+        bool pooled;                             /* when used by the transaction logic: linked into 'server' */
+        uint64_t n_replies;                      /* when used by the transaction logic */
+        usec_t reply_usec_sum;                   /* when used by the transaction logic: for the average latency */
         Set *queries;                            /* when used by the DNS stub logic */
 
         /* used when DNS-over-TLS is enabled */
@@ -93,6 +97,7 @@ struct DnsStream {
         DnsStubListenerExtra *stub_listener_extra;
 
         LIST_FIELDS(DnsStream, streams);
+        LIST_FIELDS(DnsStream, streams_by_server);
 };
 
 int dns_stream_new(
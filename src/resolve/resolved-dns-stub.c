@@ -21,6 +21,12 @@
 /* On the extra stubs, use a more conservative choice */
 #define ADVERTISE_EXTRA_DATAGRAM_SIZE_MAX DNS_PACKET_UNICAST_SIZE_LARGE_MAX
 
+/* How many UDP queries to read from a stub socket in one go, before returning to the event loop */
+#define DNS_STUB_UDP_BATCH_MAX 64U
+
+/* Receive buffer size for the UDP stub sockets, so that query bursts are not dropped */
+#define DNS_STUB_UDP_RCVBUF_SIZE (4U*1024U*1024U)
+
 static int manager_dns_stub_fd_extra(Manager *m, DnsStubListenerExtra *l, int type);
 static int manager_dns_stub_fd(Manager *m, int family, const union in_addr_union *listen_address, int type);
 
@@ -1026,19 +1032,28 @@ static void dns_stub_process_query(Manager *m, DnsStubListenerExtra *l, DnsStrea
 }
 
 static int on_dns_stub_packet_internal(sd_event_source *s, int fd, uint32_t revents, Manager *m, DnsStubListenerExtra *l) {
-        _cleanup_(dns_packet_unrefp) DnsPacket *p = NULL;
         int r;
 
-        r = manager_recv(m, fd, DNS_PROTOCOL_DNS, &p);
-        if (r <= 0)
-                return r;
+        /* Process a number of queued queries per wakeup, so that under load we do not have to go through
+         * the event loop for every single query. The limit ensures that other event sources, e.g. the
+         * replies from upstream servers, are not starved. */
 
-        if (dns_packet_validate_query(p) > 0) {
-                log_debug("Got DNS stub UDP query packet for id %u", DNS_PACKET_ID(p));
+        for (unsigned n = 0; n < DNS_STUB_UDP_BATCH_MAX; n++) {
+                _cleanup_(dns_packet_unrefp) DnsPacket *p = NULL;
 
-                dns_stub_process_query(m, l, NULL, p);
-        } else
-                log_debug("Invalid DNS stub UDP packet, ignoring.");
+                r = manager_recv(m, fd, DNS_PROTOCOL_DNS, &p);
+                if (n > 0 && ERRNO_IS_NEG_TRANSIENT(r))
+                        break; /* Queue drained */
+                if (r <= 0)
+                        return r;
+
+                if (dns_packet_validate_query(p) > 0) {
+                        log_debug("Got DNS stub UDP query packet for id %u", DNS_PACKET_ID(p));
+
+                        dns_stub_process_query(m, l, NULL, p);
+                } else
+                        log_debug("Invalid DNS stub UDP packet, ignoring.");
+        }
 
         return 0;
 }
@@ -1206,6 +1221,12 @@ static int manager_dns_stub_fd(
                         log_debug_errno(r, "Failed to enable fragment size reception, ignoring: %m");
         }
 
+        if (type == SOCK_DGRAM) {
+                r = fd_increase_rxbuf(fd, DNS_STUB_UDP_RCVBUF_SIZE);
+                if (r < 0)
+                        log_debug_errno(r, "Failed to increase receive buffer size of stub socket, ignoring: %m");
+        }
+
         r = sockaddr_set_in_addr(&sa, family, listen_addr, 53);
         if (r < 0)
                 return r;
@@ -1297,6 +1318,10 @@ static int manager_dns_stub_fd_extra(Manager *m, DnsStubListenerExtra *l, int ty
                 r = socket_set_recvfragsize(fd, l->family, true);
                 if (r < 0)
                         log_debug_errno(r, "Failed to enable fragment size reception, ignoring: %m");
+
+                r = fd_increase_rxbuf(fd, DNS_STUB_UDP_RCVBUF_SIZE);
+                if (r < 0)
+                        log_debug_errno(r, "Failed to increase receive buffer size of stub socket, ignoring: %m");
         }
 
         r = RET_NERRNO(bind(fd, &sa.sa, SOCKADDR_LEN(sa)));
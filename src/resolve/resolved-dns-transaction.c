@@ -62,6 +62,8 @@ static void dns_transaction_close_connection(
         if (t->stream) {
                 /* Let's detach the stream from our transaction, in case something else keeps a reference to it. */
                 LIST_REMOVE(transactions_by_stream, t->stream->transactions, t);
+                assert(t->stream->n_transactions > 0);
+                t->stream->n_transactions--;
 
                 /* Remove packet in case it's still in the queue */
                 dns_packet_unref(ordered_set_remove(t->stream->write_queue, t->sent));
@@ -471,6 +473,43 @@ static void dns_transaction_complete_errno(DnsTransaction *t, int error) {
         dns_transaction_complete(t, DNS_TRANSACTION_ERRNO);
 }
 
+static void dns_transaction_prefetch(DnsTransaction *t) {
+        char key_str[DNS_RESOURCE_KEY_STRING_MAX];
+        DnsTransaction *p;
+        uint64_t query_flags;
+        int r;
+
+        assert(t);
+
+        /* The cached answer for this transaction is about to expire. Let's refresh it in the background, so
+         * that the next lookups can still be answered from the cache. The new transaction has no owner, it
+         * lives until the answer arrives, just like abandoned transactions, see dns_query_candidate_abandon(). */
+
+        query_flags = t->query_flags | SD_RESOLVED_NO_CACHE;
+
+        if (dns_scope_find_transaction(t->scope, dns_transaction_key(t), query_flags))
+                return; /* Already refreshing */
+
+        r = dns_transaction_new(&p, t->scope, dns_transaction_key(t), NULL, query_flags);
+        if (r < 0) {
+                log_debug_errno(r, "Failed to create transaction for prefetching %s, ignoring: %m",
+                                dns_resource_key_to_string(dns_transaction_key(t), key_str, sizeof key_str));
+                return;
+        }
+
+        p->wait_for_answer = true;
+        t->scope->cache.n_prefetch++;
+
+        log_debug("Prefetching %s in transaction %" PRIu16 ".",
+                  dns_resource_key_to_string(dns_transaction_key(t), key_str, sizeof key_str), p->id);
+
+        r = dns_transaction_go(p);
+        if (r < 0) {
+                log_debug_errno(r, "Failed to start prefetch transaction, ignoring: %m");
+                dns_transaction_complete_errno(p, r);
+        }
+}
+
 static int dns_transaction_pick_server(DnsTransaction *t) {
         DnsServer *server;
 
@@ -483,6 +522,16 @@ static int dns_transaction_pick_server(DnsTransaction *t) {
         if (!server)
                 return -ESRCH;
 
+        /* When a transaction starts anew, this might be the time to send it to another server than the
+         * current one, to learn how fast that one is. If it fails, we'll retry on the current one. */
+        if (!t->server) {
+                DnsServer *probe;
+
+                probe = dns_scope_probe_dns_server(t->scope, server);
+                if (probe)
+                        server = probe;
+        }
+
         /* If we changed the server invalidate the feature level clamping, as the new server might have completely
          * different properties. */
         if (server != t->server)
@@ -602,6 +651,11 @@ static int dns_transaction_on_stream_packet(DnsTransaction *t, DnsStream *s, Dns
 
         encrypted = s->encrypted;
 
+        if (p->timestamp >= t->start_usec) {
+                s->n_replies++;
+                s->reply_usec_sum += p->timestamp - t->start_usec;
+        }
+
         dns_transaction_close_connection(t, true);
 
         if (dns_packet_validate_reply(p) <= 0) {
@@ -717,9 +771,8 @@ static int dns_transaction_emit_tcp(DnsTransaction *t) {
                                 return r;
                 }
 
-                if (t->server->stream && (DNS_SERVER_FEATURE_LEVEL_IS_TLS(t->current_feature_level) == t->server->stream->encrypted))
-                        s = dns_stream_ref(t->server->stream);
-                else
+                s = dns_stream_ref(dns_server_pick_stream(t->server, DNS_SERVER_FEATURE_LEVEL_IS_TLS(t->current_feature_level)));
+                if (!s)
                         fd = dns_scope_socket_tcp(t->scope, AF_UNSPEC, NULL, t->server, dns_transaction_port(t), &sa);
 
                 /* Lower timeout in DNS-over-TLS opportunistic mode. In environments where DoT is blocked
@@ -786,9 +839,8 @@ static int dns_transaction_emit_tcp(DnsTransaction *t) {
 #endif
 
                 if (t->server) {
-                        dns_server_unref_stream(t->server);
                         s->server = dns_server_ref(t->server);
-                        t->server->stream = dns_stream_ref(s);
+                        dns_server_add_stream(t->server, s);
                 }
 
                 /* The interface index is difficult to determine if we are
@@ -799,6 +851,7 @@ static int dns_transaction_emit_tcp(DnsTransaction *t) {
 
         t->stream = TAKE_PTR(s);
         LIST_PREPEND(transactions_by_stream, t->stream->transactions, t);
+        t->stream->n_transactions++;
 
         r = dns_stream_write_packet(t->stream, t->sent);
         if (r < 0) {
@@ -834,6 +887,8 @@ static void dns_transaction_cache_answer(DnsTransaction *t) {
             in_addr_is_localhost(t->received->family, &t->received->sender) != 0)
                 return;
 
+        manager_update_cache_memory_max(t->scope->manager);
+
         dns_cache_put(&t->scope->cache,
                       t->scope->manager->enable_cache,
                       t->scope->protocol,
@@ -1384,8 +1439,9 @@ void dns_transaction_process_reply(DnsTransaction *t, DnsPacket *p, bool encrypt
 
                 /* Report that we successfully received a packet. We keep track of the largest packet
                  * size/fragment size we got. Which is useful for announcing the EDNS(0) packet size we can
-                 * receive to our server. */
-                dns_server_packet_received(t->server, p->ipproto, t->current_feature_level, dns_packet_size_unfragmented(p));
+                 * receive to our server. We also keep track of how long the server took to reply. */
+                dns_server_packet_received(t->server, p->ipproto, t->current_feature_level, dns_packet_size_unfragmented(p),
+                                           usec_sub_unsigned(p->timestamp, t->start_usec));
         }
 
         /* See if we know things we didn't know before that indicate we better restart the lookup immediately. */
@@ -1802,6 +1858,7 @@ static int dns_transaction_prepare(DnsTransaction *t, usec_t ts) {
                 if (t->n_attempts == 1 || t->scope->manager->stale_retention_usec == 0)
                         query_flags |= SD_RESOLVED_NO_STALE;
 
+                bool prefetch = false;
                 r = dns_cache_lookup(
                                 &t->scope->cache,
                                 dns_transaction_key(t),
@@ -1810,7 +1867,9 @@ static int dns_transaction_prepare(DnsTransaction *t, usec_t ts) {
                                 &t->answer,
                                 &t->received,
                                 &t->answer_query_flags,
-                                &t->answer_dnssec_result);
+                                &t->answer_dnssec_result,
+                                t->scope->protocol == DNS_PROTOCOL_DNS &&
+                                t->scope->manager->cache_prefetch ? &prefetch : NULL);
                 if (r < 0)
                         return r;
                 if (r > 0) {
@@ -1836,6 +1895,9 @@ static int dns_transaction_prepare(DnsTransaction *t, usec_t ts) {
                                                 dns_resource_key_to_string(dns_transaction_key(t), key_str, sizeof key_str));
                                 }
 
+                                if (prefetch)
+                                        dns_transaction_prefetch(t);
+
                                 t->answer_source = DNS_TRANSACTION_CACHE;
                                 if (t->answer_rcode == DNS_RCODE_SUCCESS)
                                         dns_transaction_complete(t, DNS_TRANSACTION_SUCCESS);
@@ -3320,6 +3382,7 @@ static int dnssec_validate_records(
                                 rr->key,
                                 t->validated_keys,
                                 USEC_INFINITY,
+                                &t->scope->manager->dnssec_verify_cache,
                                 &result,
                                 &rrsig);
                 if (r < 0)
@@ -94,6 +94,14 @@ int dnstls_stream_connect_tls(DnsStream *stream, DnsServer *server) {
         return 0;
 }
 
+static void dnstls_stream_save_session(DnsStream *stream) {
+        assert(stream);
+
+        /* Store TLS Ticket for faster successive TLS handshakes */
+        if (stream->server && stream->server->dnstls_data.session_data.size == 0 && stream->dnstls_data.handshake == GNUTLS_E_SUCCESS)
+                gnutls_session_get_data2(stream->dnstls_data.session, &stream->server->dnstls_data.session_data);
+}
+
 void dnstls_stream_free(DnsStream *stream) {
         assert(stream);
         assert(stream->encrypted);
@@ -145,9 +153,7 @@ int dnstls_stream_shutdown(DnsStream *stream, int error) {
         assert(stream->encrypted);
         assert(stream->dnstls_data.session);
 
-        /* Store TLS Ticket for faster successive TLS handshakes */
-        if (stream->server && stream->server->dnstls_data.session_data.size == 0 && stream->dnstls_data.handshake == GNUTLS_E_SUCCESS)
-                gnutls_session_get_data2(stream->dnstls_data.session, &stream->server->dnstls_data.session_data);
+        dnstls_stream_save_session(stream);
 
         if (IN_SET(error, ETIMEDOUT, 0)) {
                 r = gnutls_bye(stream->dnstls_data.session, GNUTLS_SHUT_RDWR);
@@ -220,9 +226,25 @@ ssize_t dnstls_stream_read(DnsStream *stream, void *buf, size_t count) {
                                                gnutls_strerror(ss));
                 }
 
+        /* With TLS 1.3 the session tickets are only sent after the handshake, hence remember the session
+         * once we got the first data, so that further connections to the server, including the ones opened
+         * while this one is still in use, can resume it. */
+        if (ss > 0 && !stream->dnstls_data.session_saved) {
+                dnstls_stream_save_session(stream);
+                stream->dnstls_data.session_saved = true;
+        }
+
         return ss;
 }
 
+bool dnstls_stream_session_resumed(DnsStream *stream) {
+        assert(stream);
+        assert(stream->encrypted);
+        assert(stream->dnstls_data.session);
+
+        return gnutls_session_is_resumed(stream->dnstls_data.session) != 0;
+}
+
 void dnstls_server_free(DnsServer *server) {
         assert(server);
 
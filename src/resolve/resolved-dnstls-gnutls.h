@@ -21,4 +21,5 @@ struct DnsTlsStreamData {
         gnutls_typed_vdata_st validation;
         int handshake;
         bool shutdown;
+        bool session_saved;
 };
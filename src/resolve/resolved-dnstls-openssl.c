@@ -136,6 +136,24 @@ int dnstls_stream_connect_tls(DnsStream *stream, DnsServer *server) {
         return 0;
 }
 
+static void dnstls_stream_save_session(DnsStream *stream) {
+        SSL_SESSION *s;
+
+        assert(stream);
+
+        if (!stream->server)
+                return;
+
+        s = SSL_get1_session(stream->dnstls_data.ssl);
+        if (!s)
+                return;
+
+        if (stream->server->dnstls_data.session)
+                SSL_SESSION_free(stream->server->dnstls_data.session);
+
+        stream->server->dnstls_data.session = s;
+}
+
 void dnstls_stream_free(DnsStream *stream) {
         assert(stream);
         assert(stream->encrypted);
@@ -224,21 +242,12 @@ int dnstls_stream_on_io(DnsStream *stream, uint32_t revents) {
 
 int dnstls_stream_shutdown(DnsStream *stream, int error) {
         int ssl_error, r;
-        SSL_SESSION *s;
 
         assert(stream);
         assert(stream->encrypted);
         assert(stream->dnstls_data.ssl);
 
-        if (stream->server) {
-                s = SSL_get1_session(stream->dnstls_data.ssl);
-                if (s) {
-                        if (stream->server->dnstls_data.session)
-                                SSL_SESSION_free(stream->server->dnstls_data.session);
-
-                        stream->server->dnstls_data.session = s;
-                }
-        }
+        dnstls_stream_save_session(stream);
 
         if (error == ETIMEDOUT) {
                 ERR_clear_error();
@@ -369,9 +378,18 @@ ssize_t dnstls_stream_read(DnsStream *stream, void *buf, size_t count) {
                         stream->dnstls_events = 0;
                         ss = -EPIPE;
                 }
-        } else
+        } else {
                 stream->dnstls_events = 0;
 
+                /* With TLS 1.3 the session tickets are only sent after the handshake, hence remember the
+                 * session once we got the first data, so that further connections to the server, including
+                 * the ones opened while this one is still in use, can resume it. */
+                if (!stream->dnstls_data.session_saved) {
+                        dnstls_stream_save_session(stream);
+                        stream->dnstls_data.session_saved = true;
+                }
+        }
+
         /* flush write buffer in cache of renegotiation */
         r = dnstls_flush_write_buffer(stream);
         if (r < 0)
@@ -380,6 +398,14 @@ ssize_t dnstls_stream_read(DnsStream *stream, void *buf, size_t count) {
         return ss;
 }
 
+bool dnstls_stream_session_resumed(DnsStream *stream) {
+        assert(stream);
+        assert(stream->encrypted);
+        assert(stream->dnstls_data.ssl);
+
+        return SSL_session_reused(stream->dnstls_data.ssl) > 0;
+}
+
 void dnstls_server_free(DnsServer *server) {
         assert(server);
 
@@ -19,6 +19,7 @@ struct DnsTlsServerData {
 struct DnsTlsStreamData {
         int handshake;
         bool shutdown;
+        bool session_saved;
         SSL *ssl;
         BUF_MEM *write_buffer;
         size_t buffer_offset;
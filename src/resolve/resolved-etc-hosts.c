@@ -6,10 +6,12 @@
 
 #include "fd-util.h"
 #include "fileio.h"
+#include "format-util.h"
 #include "hostname-util.h"
 #include "resolved-dns-synthesize.h"
 #include "resolved-etc-hosts.h"
 #include "socket-netlink.h"
+#include "sort-util.h"
 #include "stat-util.h"
 #include "string-util.h"
 #include "strv.h"
@@ -18,61 +20,173 @@
 /* Recheck /etc/hosts at most once every 2s */
 #define ETC_HOSTS_RECHECK_USEC (2*USEC_PER_SEC)
 
-static EtcHostsItemByAddress *etc_hosts_item_by_address_free(EtcHostsItemByAddress *item) {
-        if (!item)
+/* When re-reading /etc/hosts, parse this many lines per event loop iteration, so that we keep answering
+ * lookups from the previous contents meanwhile, even if the file is huge */
+#define ETC_HOSTS_RELOAD_LINES 4096U
+
+struct EtcHostsReload {
+        sd_event_source *event_source;
+        FILE *file;
+        struct stat st;
+        unsigned nr;
+        EtcHosts hosts;
+};
+
+void etc_hosts_clear(EtcHosts *hosts) {
+        assert(hosts);
+
+        hosts->names = mfree(hosts->names);
+        hosts->entries = mfree(hosts->entries);
+        hosts->by_name = mfree(hosts->by_name);
+        hosts->by_address = mfree(hosts->by_address);
+        hosts->names_size = hosts->n_entries = hosts->n_by_name = hosts->n_by_address = 0;
+}
+
+static EtcHostsReload* etc_hosts_reload_free(EtcHostsReload *reload) {
+        if (!reload)
                 return NULL;
 
-        set_free(item->names);
-        return mfree(item);
+        sd_event_source_disable_unref(reload->event_source);
+        safe_fclose(reload->file);
+        etc_hosts_clear(&reload->hosts);
+        return mfree(reload);
 }
 
-DEFINE_TRIVIAL_CLEANUP_FUNC(EtcHostsItemByAddress*, etc_hosts_item_by_address_free);
+DEFINE_TRIVIAL_CLEANUP_FUNC(EtcHostsReload*, etc_hosts_reload_free);
 
-DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(
-        by_address_hash_ops,
-        struct in_addr_data,
-        in_addr_data_hash_func,
-        in_addr_data_compare_func,
-        EtcHostsItemByAddress,
-        etc_hosts_item_by_address_free);
+void manager_etc_hosts_flush(Manager *m) {
+        m->etc_hosts_reload = etc_hosts_reload_free(m->etc_hosts_reload);
+        etc_hosts_clear(&m->etc_hosts);
+        m->etc_hosts_stat = (struct stat) {};
+}
 
-static EtcHostsItemByName *etc_hosts_item_by_name_free(EtcHostsItemByName *item) {
-        if (!item)
-                return NULL;
+/* Compares host names like dns_name_equal() does for the LDH names we accept, but much cheaper */
+static int etc_hosts_name_compare(const char *a, const char *b) {
+        for (;; a++, b++) {
+                char x = *a == '.' && a[1] == 0 ? 0 : ascii_tolower(*a),
+                     y = *b == '.' && b[1] == 0 ? 0 : ascii_tolower(*b);
 
-        free(item->name);
-        set_free(item->addresses);
-        return mfree(item);
+                if (x != y || x == 0)
+                        return CMP((uint8_t) x, (uint8_t) y);
+        }
 }
 
-DEFINE_TRIVIAL_CLEANUP_FUNC(EtcHostsItemByName*, etc_hosts_item_by_name_free);
+static int etc_hosts_address_compare(const struct in_addr_data *a, const struct in_addr_data *b) {
+        int r;
 
-DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(
-        by_name_hash_ops,
-        char,
-        dns_name_hash_func,
-        dns_name_compare_func,
-        EtcHostsItemByName,
-        etc_hosts_item_by_name_free);
+        r = CMP(a->family, b->family);
+        if (r != 0)
+                return r;
+        if (a->family == AF_UNSPEC)
+                return 0;
+
+        return memcmp(&a->address, &b->address, FAMILY_ADDRESS_SIZE(a->family));
+}
+
+static int by_name_compare(const uint32_t *a, const uint32_t *b, EtcHosts *hosts) {
+        const EtcHostsEntry *x = hosts->entries + *a, *y = hosts->entries + *b;
+        int r;
+
+        r = etc_hosts_name_compare(etc_hosts_entry_name(hosts, x), etc_hosts_entry_name(hosts, y));
+        if (r != 0)
+                return r;
+
+        r = etc_hosts_address_compare(&x->address, &y->address);
+        if (r != 0)
+                return r;
+
+        return CMP(*a, *b);
+}
+
+static int by_address_compare(const uint32_t *a, const uint32_t *b, EtcHosts *hosts) {
+        int r;
+
+        r = etc_hosts_address_compare(&hosts->entries[*a].address, &hosts->entries[*b].address);
+        if (r != 0)
+                return r;
+
+        return CMP(*a, *b);
+}
+
+size_t etc_hosts_find_by_name(const EtcHosts *hosts, const char *name, size_t *ret_idx) {
+        size_t lo = 0, hi, end;
 
-void etc_hosts_clear(EtcHosts *hosts) {
         assert(hosts);
+        assert(name);
+        assert(ret_idx);
+
+        hi = hosts->n_by_name;
+        while (lo < hi) {
+                size_t m = lo + (hi - lo) / 2;
 
-        hosts->by_address = hashmap_free(hosts->by_address);
-        hosts->by_name = hashmap_free(hosts->by_name);
-        hosts->no_address = set_free(hosts->no_address);
+                if (etc_hosts_name_compare(etc_hosts_entry_name(hosts, hosts->entries + hosts->by_name[m]), name) < 0)
+                        lo = m + 1;
+                else
+                        hi = m;
+        }
+
+        for (end = lo; end < hosts->n_by_name; end++)
+                if (etc_hosts_name_compare(etc_hosts_entry_name(hosts, hosts->entries + hosts->by_name[end]), name) != 0)
+                        break;
+
+        *ret_idx = lo;
+        return end - lo;
 }
 
-void manager_etc_hosts_flush(Manager *m) {
-        etc_hosts_clear(&m->etc_hosts);
-        m->etc_hosts_stat = (struct stat) {};
+size_t etc_hosts_find_by_address(const EtcHosts *hosts, const struct in_addr_data *address, size_t *ret_idx) {
+        size_t lo = 0, hi, end;
+
+        assert(hosts);
+        assert(address);
+        assert(ret_idx);
+
+        hi = hosts->n_by_address;
+        while (lo < hi) {
+                size_t m = lo + (hi - lo) / 2;
+
+                if (etc_hosts_address_compare(&hosts->entries[hosts->by_address[m]].address, address) < 0)
+                        lo = m + 1;
+                else
+                        hi = m;
+        }
+
+        for (end = lo; end < hosts->n_by_address; end++)
+                if (etc_hosts_address_compare(&hosts->entries[hosts->by_address[end]].address, address) != 0)
+                        break;
+
+        *ret_idx = lo;
+        return end - lo;
+}
+
+static int etc_hosts_add(EtcHosts *hosts, const struct in_addr_data *address, const char *name) {
+        size_t l;
+
+        assert(hosts);
+        assert(address);
+        assert(name);
+
+        l = strlen(name) + 1;
+        if (hosts->names_size + l > UINT32_MAX || hosts->n_entries >= UINT32_MAX)
+                return -E2BIG;
+
+        if (!GREEDY_REALLOC(hosts->names, hosts->names_size + l) ||
+            !GREEDY_REALLOC(hosts->entries, hosts->n_entries + 1))
+                return -ENOMEM;
+
+        memcpy(hosts->names + hosts->names_size, name, l);
+        hosts->entries[hosts->n_entries++] = (EtcHostsEntry) {
+                .address = *address,
+                .name = hosts->names_size,
+        };
+        hosts->names_size += l;
+
+        return 0;
 }
 
 static int parse_line(EtcHosts *hosts, unsigned nr, const char *line) {
         _cleanup_free_ char *address_str = NULL;
         struct in_addr_data address = {};
         bool found = false;
-        EtcHostsItemByAddress *item;
         int r;
 
         assert(hosts);
@@ -97,33 +211,12 @@ static int parse_line(EtcHosts *hosts, unsigned nr, const char *line) {
         if (r > 0)
                 /* This is an 0.0.0.0 or :: item, which we assume means that we shall map the specified hostname to
                  * nothing. */
-                item = NULL;
-        else {
-                /* If this is a normal address, then simply add entry mapping it to the specified names */
-
-                item = hashmap_get(hosts->by_address, &address);
-                if (!item) {
-                        _cleanup_(etc_hosts_item_by_address_freep) EtcHostsItemByAddress *new_item = NULL;
-
-                        new_item = new(EtcHostsItemByAddress, 1);
-                        if (!new_item)
-                                return log_oom();
-
-                        *new_item = (EtcHostsItemByAddress) {
-                                .address = address,
-                        };
-
-                        r = hashmap_ensure_put(&hosts->by_address, &by_address_hash_ops, &new_item->address, new_item);
-                        if (r < 0)
-                                return log_oom();
-
-                        item = TAKE_PTR(new_item);
-                }
-        }
+                address = (struct in_addr_data) {
+                        .family = AF_UNSPEC,
+                };
 
         for (;;) {
                 _cleanup_free_ char *name = NULL;
-                EtcHostsItemByName *bn;
 
                 r = extract_first_word(&line, &name, NULL, EXTRACT_RELAX);
                 if (r < 0)
@@ -142,74 +235,72 @@ static int parse_line(EtcHosts *hosts, unsigned nr, const char *line) {
 
                 found = true;
 
-                if (!item) {
-                        /* Optimize the case where we don't need to store any addresses, by storing
-                         * only the name in a dedicated Set instead of the hashmap */
-
-                        r = set_ensure_consume(&hosts->no_address, &dns_name_hash_ops_free, TAKE_PTR(name));
-                        if (r < 0)
-                                return log_oom();
-
-                        continue;
-                }
+                /* Duplicates are removed when building the index, see etc_hosts_build_index() */
+                r = etc_hosts_add(hosts, &address, name);
+                if (r == -E2BIG)
+                        return log_error_errno(r, "/etc/hosts:%u: too many entries.", nr);
+                if (r < 0)
+                        return log_oom();
+        }
 
-                bn = hashmap_get(hosts->by_name, name);
-                if (!bn) {
-                        _cleanup_(etc_hosts_item_by_name_freep) EtcHostsItemByName *new_item = NULL;
-                        _cleanup_free_ char *name_copy = NULL;
+        if (!found)
+                log_warning("/etc/hosts:%u: line is missing any valid hostnames", nr);
 
-                        name_copy = strdup(name);
-                        if (!name_copy)
-                                return log_oom();
+        return 0;
+}
 
-                        new_item = new(EtcHostsItemByName, 1);
-                        if (!new_item)
-                                return log_oom();
+/* Returns > 0 once the end of the file is reached */
+static int etc_hosts_parse_lines(EtcHosts *hosts, FILE *f, unsigned *nr, unsigned max_lines) {
+        int r;
 
-                        *new_item = (EtcHostsItemByName) {
-                                .name = TAKE_PTR(name_copy),
-                        };
+        assert(hosts);
+        assert(f);
+        assert(nr);
 
-                        r = hashmap_ensure_put(&hosts->by_name, &by_name_hash_ops, new_item->name, new_item);
-                        if (r < 0)
-                                return log_oom();
+        for (unsigned n = 0; n < max_lines; n++) {
+                _cleanup_free_ char *line = NULL;
+                char *l;
 
-                        bn = TAKE_PTR(new_item);
-                }
+                r = read_line(f, LONG_LINE_MAX, &line);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to read /etc/hosts: %m");
+                if (r == 0)
+                        return 1;
 
-                if (!set_contains(bn->addresses, &address)) {
-                        _cleanup_free_ struct in_addr_data *address_copy = NULL;
+                (*nr)++;
 
-                        address_copy = newdup(struct in_addr_data, &address, 1);
-                        if (!address_copy)
-                                return log_oom();
+                l = strchr(line, '#');
+                if (l)
+                        *l = '\0';
 
-                        r = set_ensure_consume(&bn->addresses, &in_addr_data_hash_ops_free, TAKE_PTR(address_copy));
-                        if (r < 0)
-                                return log_oom();
-                }
+                l = strstrip(line);
+                if (isempty(l))
+                        continue;
 
-                r = set_ensure_put(&item->names, &dns_name_hash_ops_free, name);
+                r = parse_line(hosts, *nr, l);
                 if (r < 0)
-                        return log_oom();
-                if (r == 0) /* the name is already listed */
-                        continue;
-                /*
-                 * Keep track of the first name listed for this address.
-                 * This name will be used in responses as the canonical name.
-                 */
-                if (!item->canonical_name)
-                        item->canonical_name = name;
-                TAKE_PTR(name);
+                        return r;
         }
 
-        if (!found)
-                log_warning("/etc/hosts:%u: line is missing any valid hostnames", nr);
-
         return 0;
 }
 
-static void strip_localhost(EtcHosts *hosts) {
+enum {
+        STRIP_BY_NAME    = 1 << 0,
+        STRIP_BY_ADDRESS = 1 << 1,
+};
+
+static size_t strip_index(uint32_t *index, size_t n, const uint8_t *strip, uint8_t flag) {
+        size_t k = 0;
+
+        for (size_t i = 0; i < n; i++)
+                if (!FLAGS_SET(strip[index[i]], flag))
+                        index[k++] = index[i];
+
+        return k;
+}
+
+static int strip_localhost(EtcHosts *hosts) {
         static const struct in_addr_data local_in_addrs[] = {
                 {
                         .family = AF_INET,
@@ -226,6 +317,8 @@ static void strip_localhost(EtcHosts *hosts) {
                 },
         };
 
+        _cleanup_free_ uint8_t *strip = NULL;
+
         assert(hosts);
 
         /* Removes the 'localhost' entry from what we loaded. But only if the mapping is exclusively between
@@ -236,18 +329,16 @@ static void strip_localhost(EtcHosts *hosts) {
          * mappings.  */
 
         for (size_t j = 0; j < ELEMENTSOF(local_in_addrs); j++) {
-                bool all_localhost, all_local_address;
-                EtcHostsItemByAddress *item;
-                const char *name;
+                bool all_localhost = true, all_local_address = true;
+                size_t idx, n;
 
-                item = hashmap_get(hosts->by_address, local_in_addrs + j);
-                if (!item)
+                n = etc_hosts_find_by_address(hosts, local_in_addrs + j, &idx);
+                if (n == 0)
                         continue;
 
                 /* Check whether all hostnames the loopback address points to are localhost ones */
-                all_localhost = true;
-                SET_FOREACH(name, item->names)
-                        if (!is_localhost(name)) {
+                for (size_t i = idx; i < idx + n; i++)
+                        if (!is_localhost(etc_hosts_entry_name(hosts, hosts->entries + hosts->by_address[i]))) {
                                 all_localhost = false;
                                 break;
                         }
@@ -256,37 +347,101 @@ static void strip_localhost(EtcHosts *hosts) {
                         continue;
 
                 /* Now check if the names listed for this address actually all point back just to this
-                 * address (or the other loopback address). If not, let's stay away from this too. */
-                all_local_address = true;
-                SET_FOREACH(name, item->names) {
-                        EtcHostsItemByName *n;
-                        struct in_addr_data *a;
-
-                        n = hashmap_get(hosts->by_name, name);
-                        if (!n) /* No reverse entry? Then almost certainly the entry already got deleted from
-                                 * the previous iteration of this loop, i.e. via the other protocol */
-                                break;
-
-                        /* Now check if the addresses of this item are all localhost addresses */
-                        SET_FOREACH(a, n->addresses)
-                                if (!in_addr_is_localhost(a->family, &a->address)) {
+                 * address (or the other loopback address). If not, let's stay away from this too. Entries
+                 * that got already removed in the previous iteration of this loop, i.e. via the other
+                 * protocol, don't count. */
+                for (size_t i = idx; i < idx + n && all_local_address; i++) {
+                        const char *name = etc_hosts_entry_name(hosts, hosts->entries + hosts->by_address[i]);
+                        size_t name_idx, name_n;
+
+                        name_n = etc_hosts_find_by_name(hosts, name, &name_idx);
+                        for (size_t k = name_idx; k < name_idx + name_n; k++) {
+                                uint32_t e = hosts->by_name[k];
+
+                                if (hosts->entries[e].address.family == AF_UNSPEC ||
+                                    (strip && FLAGS_SET(strip[e], STRIP_BY_NAME)))
+                                        continue;
+
+                                if (!in_addr_is_localhost(hosts->entries[e].address.family, &hosts->entries[e].address.address)) {
                                         all_local_address = false;
                                         break;
                                 }
-
-                        if (!all_local_address)
-                                break;
+                        }
                 }
 
                 if (!all_local_address)
                         continue;
 
-                SET_FOREACH(name, item->names)
-                        etc_hosts_item_by_name_free(hashmap_remove(hosts->by_name, name));
+                if (!strip) {
+                        strip = new0(uint8_t, hosts->n_entries);
+                        if (!strip)
+                                return log_oom();
+                }
+
+                for (size_t i = idx; i < idx + n; i++) {
+                        const char *name = etc_hosts_entry_name(hosts, hosts->entries + hosts->by_address[i]);
+                        size_t name_idx, name_n;
+
+                        name_n = etc_hosts_find_by_name(hosts, name, &name_idx);
+                        for (size_t k = name_idx; k < name_idx + name_n; k++)
+                                if (hosts->entries[hosts->by_name[k]].address.family != AF_UNSPEC)
+                                        strip[hosts->by_name[k]] |= STRIP_BY_NAME;
+
+                        strip[hosts->by_address[i]] |= STRIP_BY_ADDRESS;
+                }
+        }
+
+        if (strip) {
+                hosts->n_by_name = strip_index(hosts->by_name, hosts->n_by_name, strip, STRIP_BY_NAME);
+                hosts->n_by_address = strip_index(hosts->by_address, hosts->n_by_address, strip, STRIP_BY_ADDRESS);
+        }
+
+        return 0;
+}
+
+static int etc_hosts_build_index(EtcHosts *hosts) {
+        size_t k = 0;
+
+        assert(hosts);
+        assert(!hosts->by_name);
+        assert(!hosts->by_address);
+
+        if (hosts->n_entries == 0)
+                return 0;
+
+        hosts->by_name = new(uint32_t, hosts->n_entries);
+        hosts->by_address = new(uint32_t, hosts->n_entries);
+        if (!hosts->by_name || !hosts->by_address)
+                return log_oom();
+
+        for (size_t i = 0; i < hosts->n_entries; i++)
+                hosts->by_name[i] = i;
+
+        typesafe_qsort_r(hosts->by_name, hosts->n_entries, by_name_compare, hosts);
 
-                assert_se(hashmap_remove(hosts->by_address, local_in_addrs + j) == item);
-                etc_hosts_item_by_address_free(item);
+        /* Drop names listed more than once for the same address, but keep the first one, as the first name
+         * listed for an address is its canonical name */
+        for (size_t i = 0; i < hosts->n_entries; i++) {
+                const EtcHostsEntry *e = hosts->entries + hosts->by_name[i];
+
+                if (k > 0) {
+                        const EtcHostsEntry *p = hosts->entries + hosts->by_name[k - 1];
+
+                        if (etc_hosts_address_compare(&p->address, &e->address) == 0 &&
+                            etc_hosts_name_compare(etc_hosts_entry_name(hosts, p), etc_hosts_entry_name(hosts, e)) == 0)
+                                continue;
+                }
+
+                hosts->by_name[k++] = hosts->by_name[i];
+
+                if (e->address.family != AF_UNSPEC)
+                        hosts->by_address[hosts->n_by_address++] = hosts->by_name[i];
         }
+        hosts->n_by_name = k;
+
+        typesafe_qsort_r(hosts->by_address, hosts->n_by_address, by_address_compare, hosts);
+
+        return strip_localhost(hosts);
 }
 
 int etc_hosts_parse(EtcHosts *hosts, FILE *f) {
@@ -296,39 +451,123 @@ int etc_hosts_parse(EtcHosts *hosts, FILE *f) {
 
         assert(hosts);
 
-        for (;;) {
-                _cleanup_free_ char *line = NULL;
-                char *l;
+        r = etc_hosts_parse_lines(&t, f, &nr, UINT_MAX);
+        if (r < 0)
+                return r;
 
-                r = read_line(f, LONG_LINE_MAX, &line);
-                if (r < 0)
-                        return log_error_errno(r, "Failed to read /etc/hosts: %m");
-                if (r == 0)
-                        break;
+        r = etc_hosts_build_index(&t);
+        if (r < 0)
+                return r;
 
-                nr++;
+        etc_hosts_clear(hosts);
+        *hosts = TAKE_STRUCT(t);
+        return 0;
+}
 
-                l = strchr(line, '#');
-                if (l)
-                        *l = '\0';
+size_t etc_hosts_memory(const EtcHosts *hosts) {
+        assert(hosts);
 
-                l = strstrip(line);
-                if (isempty(l))
-                        continue;
+        return MALLOC_SIZEOF_SAFE(hosts->names) +
+                MALLOC_SIZEOF_SAFE(hosts->entries) +
+                MALLOC_SIZEOF_SAFE(hosts->by_name) +
+                MALLOC_SIZEOF_SAFE(hosts->by_address);
+}
 
-                r = parse_line(&t, nr, l);
-                if (r < 0)
-                        return r;
-        }
+void etc_hosts_dump(const EtcHosts *hosts, FILE *f) {
+        size_t n_names = 0;
 
-        strip_localhost(&t);
+        assert(hosts);
 
-        etc_hosts_clear(hosts);
-        *hosts = TAKE_STRUCT(t);
+        if (!f)
+                f = stdout;
+
+        for (size_t i = 0; i < hosts->n_by_name; i++)
+                if (i == 0 ||
+                    etc_hosts_name_compare(etc_hosts_entry_name(hosts, hosts->entries + hosts->by_name[i - 1]),
+                                           etc_hosts_entry_name(hosts, hosts->entries + hosts->by_name[i])) != 0)
+                        n_names++;
+
+        fprintf(f,
+                "/etc/hosts: %zu names, %zu addresses, %zu entries, %s of memory\n",
+                n_names,
+                hosts->n_by_address,
+                hosts->n_by_name,
+                FORMAT_BYTES(etc_hosts_memory(hosts)));
+}
+
+static void manager_etc_hosts_loaded(Manager *m, EtcHosts *hosts, const struct stat *st) {
+        assert(m);
+        assert(hosts);
+        assert(st);
+
+        etc_hosts_clear(&m->etc_hosts);
+        m->etc_hosts = TAKE_STRUCT(*hosts);
+        m->etc_hosts_stat = *st;
+
+        log_debug("Read /etc/hosts with %zu entries, using %s of memory.",
+                  m->etc_hosts.n_by_name, FORMAT_BYTES(etc_hosts_memory(&m->etc_hosts)));
+}
+
+static int on_etc_hosts_reload(sd_event_source *s, void *userdata) {
+        Manager *m = ASSERT_PTR(userdata);
+        EtcHostsReload *reload = ASSERT_PTR(m->etc_hosts_reload);
+        int r;
+
+        r = etc_hosts_parse_lines(&reload->hosts, reload->file, &reload->nr, ETC_HOSTS_RELOAD_LINES);
+        if (r == 0) /* More to read, continue in the next iteration */
+                return 0;
+        if (r > 0)
+                r = etc_hosts_build_index(&reload->hosts);
+        if (r < 0)
+                log_warning_errno(r, "Failed to re-read /etc/hosts, keeping previous contents: %m");
+        else
+                manager_etc_hosts_loaded(m, &reload->hosts, &reload->st);
+
+        m->etc_hosts_reload = etc_hosts_reload_free(m->etc_hosts_reload);
+        return 0;
+}
+
+static int manager_etc_hosts_reload_start(Manager *m, FILE **f, const struct stat *st) {
+        _cleanup_(etc_hosts_reload_freep) EtcHostsReload *reload = NULL;
+        int r;
+
+        assert(m);
+        assert(f);
+        assert(st);
+        assert(!m->etc_hosts_reload);
+
+        /* Parses /etc/hosts in chunks from the event loop, and only replaces what we have when the whole
+         * file was read, so that lookups are not blocked while a huge file is re-read. */
+
+        reload = new(EtcHostsReload, 1);
+        if (!reload)
+                return log_oom();
+
+        *reload = (EtcHostsReload) {
+                .file = TAKE_PTR(*f),
+                .st = *st,
+        };
+
+        r = sd_event_add_defer(m->event, &reload->event_source, on_etc_hosts_reload, m);
+        if (r < 0)
+                return log_error_errno(r, "Failed to add event source for re-reading /etc/hosts: %m");
+
+        r = sd_event_source_set_priority(reload->event_source, SD_EVENT_PRIORITY_IDLE);
+        if (r < 0)
+                return log_error_errno(r, "Failed to set priority of event source for re-reading /etc/hosts: %m");
+
+        r = sd_event_source_set_enabled(reload->event_source, SD_EVENT_ON);
+        if (r < 0)
+                return log_error_errno(r, "Failed to enable event source for re-reading /etc/hosts: %m");
+
+        (void) sd_event_source_set_description(reload->event_source, "etc-hosts-reload");
+
+        m->etc_hosts_reload = TAKE_PTR(reload);
         return 0;
 }
 
 static int manager_etc_hosts_read(Manager *m) {
+        _cleanup_(etc_hosts_clear) EtcHosts hosts = {};
         _cleanup_fclose_ FILE *f = NULL;
         struct stat st;
         usec_t ts;
@@ -340,6 +579,10 @@ static int manager_etc_hosts_read(Manager *m) {
         if (m->etc_hosts_last != USEC_INFINITY && m->etc_hosts_last + ETC_HOSTS_RECHECK_USEC > ts)
                 return 0;
 
+        /* Still busy re-reading it? Then continue to use what we have until that's done */
+        if (m->etc_hosts_reload)
+                return 0;
+
         m->etc_hosts_last = ts;
 
         if (stat_is_set(&m->etc_hosts_stat)) {
@@ -371,11 +614,16 @@ static int manager_etc_hosts_read(Manager *m) {
         if (r < 0)
                 return log_error_errno(errno, "Failed to fstat() /etc/hosts: %m");
 
-        r = etc_hosts_parse(&m->etc_hosts, f);
+        /* If we have read the file before, continue to use the old contents while we re-read it. Otherwise,
+         * read it right-away, as we don't want to answer lookups without it. */
+        if (stat_is_set(&m->etc_hosts_stat))
+                return manager_etc_hosts_reload_start(m, &f, &st);
+
+        r = etc_hosts_parse(&hosts, f);
         if (r < 0)
                 return r;
 
-        m->etc_hosts_stat = st;
+        manager_etc_hosts_loaded(m, &hosts, &st);
         m->etc_hosts_last = ts;
 
         return 1;
@@ -428,7 +676,7 @@ static int etc_hosts_lookup_by_address(
                 DnsAnswer **answer) {
 
         DnsResourceKey *t, *found_ptr = NULL;
-        EtcHostsItemByAddress *item;
+        size_t idx, n;
         int r;
 
         assert(hosts);
@@ -437,8 +685,8 @@ static int etc_hosts_lookup_by_address(
         assert(address);
         assert(answer);
 
-        item = hashmap_get(hosts->by_address, address);
-        if (!item)
+        n = etc_hosts_find_by_address(hosts, address, &idx);
+        if (n == 0)
                 return 0;
 
         /* We have an address in /etc/hosts that matches the queried name. Let's return successful. Actual data
@@ -460,23 +708,13 @@ static int etc_hosts_lookup_by_address(
         }
 
         if (found_ptr) {
-                const char *n;
-
-                r = dns_answer_reserve(answer, set_size(item->names));
+                r = dns_answer_reserve(answer, n);
                 if (r < 0)
                         return r;
 
-                if (item->canonical_name) {
-                        r = answer_add_ptr(*answer, found_ptr, item->canonical_name);
-                        if (r < 0)
-                                return r;
-                }
-
-                SET_FOREACH(n, item->names) {
-                        if (n == item->canonical_name)
-                                continue;
-
-                        r = answer_add_ptr(*answer, found_ptr, n);
+                /* The entries are in the order they are listed in, hence the canonical name comes first */
+                for (size_t i = idx; i < idx + n; i++) {
+                        r = answer_add_ptr(*answer, found_ptr, etc_hosts_entry_name(hosts, hosts->entries + hosts->by_address[i]));
                         if (r < 0)
                                 return r;
                 }
@@ -492,9 +730,8 @@ static int etc_hosts_lookup_by_name(
                 DnsAnswer **answer) {
 
         bool question_for_a = false, question_for_aaaa = false;
-        const struct in_addr_data *a;
-        EtcHostsItemByName *item;
         DnsResourceKey *t;
+        size_t idx, n;
         int r;
 
         assert(hosts);
@@ -502,16 +739,14 @@ static int etc_hosts_lookup_by_name(
         assert(name);
         assert(answer);
 
-        item = hashmap_get(hosts->by_name, name);
-        if (item) {
-                r = dns_answer_reserve(answer, set_size(item->addresses));
-                if (r < 0)
-                        return r;
-        } else {
-                /* Check if name was listed with no address. If yes, continue to return an answer. */
-                if (!set_contains(hosts->no_address, name))
-                        return 0;
-        }
+        /* If the name is only listed with no address, we still continue to return an answer. */
+        n = etc_hosts_find_by_name(hosts, name, &idx);
+        if (n == 0)
+                return 0;
+
+        r = dns_answer_reserve(answer, n);
+        if (r < 0)
+                return r;
 
         /* Determine whether we are looking for A and/or AAAA RRs */
         DNS_QUESTION_FOREACH(t, q) {
@@ -535,27 +770,30 @@ static int etc_hosts_lookup_by_name(
                         break; /* We are looking for both, no need to continue loop */
         }
 
-        SET_FOREACH(a, item ? item->addresses : NULL) {
-                EtcHostsItemByAddress *item_by_addr;
-                const char *canonical_name;
+        for (size_t i = idx; i < idx + n; i++) {
+                const EtcHostsEntry *e = hosts->entries + hosts->by_name[i];
+                const char *item_name, *canonical_name;
+                size_t address_idx;
 
-                if ((!question_for_a && a->family == AF_INET) ||
-                    (!question_for_aaaa && a->family == AF_INET6))
+                if ((!question_for_a && e->address.family == AF_INET) ||
+                    (!question_for_aaaa && e->address.family == AF_INET6) ||
+                    e->address.family == AF_UNSPEC)
                         continue;
 
-                item_by_addr = hashmap_get(hosts->by_address, a);
-                if (item_by_addr && item_by_addr->canonical_name)
-                        canonical_name = item_by_addr->canonical_name;
+                item_name = etc_hosts_entry_name(hosts, e);
+
+                if (etc_hosts_find_by_address(hosts, &e->address, &address_idx) > 0)
+                        canonical_name = etc_hosts_entry_name(hosts, hosts->entries + hosts->by_address[address_idx]);
                 else
-                        canonical_name = item->name;
+                        canonical_name = item_name;
 
-                if (!streq(item->name, canonical_name)) {
-                        r = answer_add_cname(*answer, item->name, canonical_name);
+                if (!streq(item_name, canonical_name)) {
+                        r = answer_add_cname(*answer, item_name, canonical_name);
                         if (r < 0)
                                 return r;
                 }
 
-                r = answer_add_addr(*answer, canonical_name, a);
+                r = answer_add_addr(*answer, canonical_name, &e->address);
                 if (r < 0)
                         return r;
         }
@@ -5,19 +5,20 @@
 #include "resolved-dns-question.h"
 #include "resolved-dns-answer.h"
 
-typedef struct EtcHostsItemByAddress {
-        struct in_addr_data address;
-        Set *names;
-        const char *canonical_name;
-} EtcHostsItemByAddress;
-
-typedef struct EtcHostsItemByName {
-        char *name;
-        Set *addresses;
-} EtcHostsItemByName;
-
 int etc_hosts_parse(EtcHosts *hosts, FILE *f);
 void etc_hosts_clear(EtcHosts *hosts);
 
+/* Return the number of entries for the name or address, and the position of the first in 'by_name' resp.
+ * 'by_address'. For each address, the first entry is the one with the canonical name. */
+size_t etc_hosts_find_by_name(const EtcHosts *hosts, const char *name, size_t *ret_idx);
+size_t etc_hosts_find_by_address(const EtcHosts *hosts, const struct in_addr_data *address, size_t *ret_idx);
+
+static inline const char* etc_hosts_entry_name(const EtcHosts *hosts, const EtcHostsEntry *e) {
+        return hosts->names + e->name;
+}
+
+size_t etc_hosts_memory(const EtcHosts *hosts);
+void etc_hosts_dump(const EtcHosts *hosts, FILE *f);
+
 void manager_etc_hosts_flush(Manager *m);
 int manager_etc_hosts_lookup(Manager *m, DnsQuestion* q, DnsAnswer **answer);
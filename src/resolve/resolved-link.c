@@ -755,6 +755,16 @@ void link_next_dns_server(Link *l, DnsServer *if_current) {
         if (!l->current_dns_server)
                 return;
 
+        if (l->manager->prefer_fastest_server) {
+                DnsServer *s;
+
+                s = dns_server_pick_fastest(l->dns_servers, l->current_dns_server);
+                if (s) {
+                        link_set_dns_server(l, s);
+                        return;
+                }
+        }
+
         /* Change to the next one, but make sure to follow the linked list only if this server is actually
          * still linked. */
         if (l->current_dns_server->linked && l->current_dns_server->servers_next) {
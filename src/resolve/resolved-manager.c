@@ -518,6 +518,9 @@ static int manager_sigusr1(sd_event_source *s, const struct signalfd_siginfo *si
                 LIST_FOREACH(servers, server, l->dns_servers)
                         dns_server_dump(server, f);
 
+        if (m->read_etc_hosts)
+                etc_hosts_dump(&m->etc_hosts, f);
+
         return memstream_dump(LOG_INFO, &ms);
 }
 
@@ -578,6 +581,10 @@ static void manager_set_defaults(Manager *m) {
         m->read_etc_hosts = true;
         m->resolve_unicast_single_label = false;
         m->cache_from_localhost = false;
+        m->cache_prefetch = false;
+        m->cache_snapshot = false;
+        m->prefer_fastest_server = false;
+        m->cache_memory_max = 0;
         m->stale_retention_usec = 0;
 }
 
@@ -694,6 +701,8 @@ int manager_new(Manager **ret) {
         if (r < 0)
                 log_warning_errno(r, "Failed to load DNS-SD configuration files: %m");
 
+        (void) manager_load_cache_snapshot(m);
+
         r = dns_scope_new(m, &m->unicast_scope, NULL, DNS_PROTOCOL_DNS, AF_UNSPEC);
         if (r < 0)
                 return r;
@@ -779,6 +788,8 @@ Manager *manager_free(Manager *m) {
         hashmap_free(m->links);
         hashmap_free(m->dns_transactions);
 
+        sd_json_variant_unref(m->cache_snapshot_data);
+
         sd_event_source_unref(m->network_event_source);
         sd_network_monitor_unref(m->network_monitor);
 
@@ -824,6 +835,8 @@ Manager *manager_free(Manager *m) {
         dns_trust_anchor_flush(&m->trust_anchor);
         manager_etc_hosts_flush(m);
 
+        set_free(m->dnssec_verify_cache);
+
         return mfree(m);
 }
 
@@ -1692,6 +1705,8 @@ void manager_flush_caches(Manager *m, int log_level) {
         LIST_FOREACH(scopes, scope, m->dns_scopes)
                 dns_cache_flush(&scope->cache);
 
+        set_clear(m->dnssec_verify_cache);
+
         log_full(log_level, "Flushed all caches.");
 }
 
@@ -1877,15 +1892,23 @@ int socket_disable_pmtud(int fd, int af) {
 }
 
 int dns_manager_dump_statistics_json(Manager *m, sd_json_variant **ret) {
-        uint64_t size = 0, hit = 0, miss = 0;
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *latency = NULL;
+        uint64_t size = 0, hit = 0, miss = 0, prefetch = 0, synthesized = 0;
+        int r;
 
         assert(m);
         assert(ret);
 
+        r = dns_server_rtt_histogram_to_json(m->rtt_histogram, &latency);
+        if (r < 0)
+                return r;
+
         LIST_FOREACH(scopes, s, m->dns_scopes) {
                 size += dns_cache_size(&s->cache);
                 hit += s->cache.n_hit;
                 miss += s->cache.n_miss;
+                prefetch += s->cache.n_prefetch;
+                synthesized += s->cache.n_synthesized;
         }
 
         return sd_json_buildo(ret,
@@ -1900,14 +1923,17 @@ int dns_manager_dump_statistics_json(Manager *m, sd_json_variant **ret) {
                               SD_JSON_BUILD_PAIR("cache", SD_JSON_BUILD_OBJECT(
                                                                  SD_JSON_BUILD_PAIR_UNSIGNED("size", size),
                                                                  SD_JSON_BUILD_PAIR_UNSIGNED("hits", hit),
-                                                                 SD_JSON_BUILD_PAIR_UNSIGNED("misses", miss)
+                                                                 SD_JSON_BUILD_PAIR_UNSIGNED("misses", miss),
+                                                                 SD_JSON_BUILD_PAIR_UNSIGNED("prefetches", prefetch),
+                                                                 SD_JSON_BUILD_PAIR_UNSIGNED("synthesized", synthesized)
                                                  )),
                               SD_JSON_BUILD_PAIR("dnssec", SD_JSON_BUILD_OBJECT(
                                                                  SD_JSON_BUILD_PAIR_UNSIGNED("secure", m->n_dnssec_verdict[DNSSEC_SECURE]),
                                                                  SD_JSON_BUILD_PAIR_UNSIGNED("insecure", m->n_dnssec_verdict[DNSSEC_INSECURE]),
                                                                  SD_JSON_BUILD_PAIR_UNSIGNED("bogus", m->n_dnssec_verdict[DNSSEC_BOGUS]),
                                                                  SD_JSON_BUILD_PAIR_UNSIGNED("indeterminate", m->n_dnssec_verdict[DNSSEC_INDETERMINATE])
-                                                 )));
+                                                 )),
+                              SD_JSON_BUILD_PAIR_VARIANT("latency", latency));
 }
 
 void dns_manager_reset_statistics(Manager *m) {
@@ -1915,7 +1941,7 @@ void dns_manager_reset_statistics(Manager *m) {
         assert(m);
 
         LIST_FOREACH(scopes, s, m->dns_scopes)
-                s->cache.n_hit = s->cache.n_miss = 0;
+                s->cache.n_hit = s->cache.n_miss = s->cache.n_prefetch = s->cache.n_synthesized = 0;
 
         m->n_transactions_total = 0;
         m->n_timeouts_total = 0;
@@ -1923,4 +1949,197 @@ void dns_manager_reset_statistics(Manager *m) {
         m->n_failure_responses_total = 0;
         m->n_failure_responses_served_stale_total = 0;
         zero(m->n_dnssec_verdict);
+        zero(m->rtt_histogram);
+}
+
+void manager_update_cache_memory_max(Manager *m) {
+        uint64_t n = 0, hits = 0;
+
+        assert(m);
+
+        /* Splits CacheMemoryMax= between the caches of all scopes. Half of the budget is split evenly, so
+         * that new or rarely used scopes still can cache something, the other half is split by the number
+         * of cache hits, so that busy scopes get the bulk of the memory. Caches exceeding their share are
+         * shrunk when the next entry is added to them. */
+
+        LIST_FOREACH(scopes, s, m->dns_scopes) {
+                n++;
+                hits += s->cache.n_hit;
+        }
+
+        LIST_FOREACH(scopes, s, m->dns_scopes) {
+                if (m->cache_memory_max == 0) {
+                        s->cache.memory_max = 0;
+                        continue;
+                }
+
+                uint64_t even = m->cache_memory_max / 2 / n,
+                        by_hits = (uint64_t) ((double) (m->cache_memory_max / 2) * (s->cache.n_hit + 1) / (hits + n));
+
+                s->cache.memory_max = MAX(even + by_hits, UINT64_C(1));
+        }
+}
+
+static int cache_snapshot_add_scope(sd_json_variant **scopes, DnsScope *s, const char *name) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *c = NULL;
+        int r;
+
+        assert(scopes);
+        assert(name);
+
+        if (!s || dns_cache_is_empty(&s->cache))
+                return 0;
+
+        r = dns_cache_save_snapshot(&s->cache, &c);
+        if (r < 0)
+                return r;
+
+        return sd_json_variant_set_field(scopes, name, c);
+}
+
+int manager_save_cache_snapshot(Manager *m) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *scopes = NULL, *v = NULL;
+        _cleanup_free_ char *text = NULL;
+        sd_id128_t boot_id;
+        Link *l;
+        int r;
+
+        assert(m);
+
+        /* Saves the contents of the unicast DNS caches on shutdown, so that they can be restored by
+         * manager_load_cache_snapshot() when we are started again, and the first lookups after a restart
+         * don't all have to go to the network. The cache of the global scope is stored under the empty
+         * interface name. */
+
+        if (!m->cache_snapshot || m->enable_cache == DNS_CACHE_MODE_NO)
+                return 0;
+
+        r = sd_id128_get_boot(&boot_id);
+        if (r < 0)
+                return log_warning_errno(r, "Failed to get boot ID, not saving cache snapshot: %m");
+
+        r = cache_snapshot_add_scope(&scopes, m->unicast_scope, "");
+        if (r < 0)
+                return log_warning_errno(r, "Failed to serialize cache: %m");
+
+        HASHMAP_FOREACH(l, m->links) {
+                if (!l->ifname)
+                        continue;
+
+                r = cache_snapshot_add_scope(&scopes, l->unicast_scope, l->ifname);
+                if (r < 0)
+                        return log_warning_errno(r, "Failed to serialize cache of %s: %m", l->ifname);
+        }
+
+        if (!scopes) {
+                (void) unlink(CACHE_SNAPSHOT_PATH);
+                return 0;
+        }
+
+        r = sd_json_buildo(
+                        &v,
+                        SD_JSON_BUILD_PAIR_ID128("bootId", boot_id),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("timestamp", now(CLOCK_BOOTTIME)),
+                        SD_JSON_BUILD_PAIR_VARIANT("scopes", scopes));
+        if (r < 0)
+                return log_oom();
+
+        r = sd_json_variant_format(v, /* flags= */ 0, &text);
+        if (r < 0)
+                return log_oom();
+
+        r = write_string_file(CACHE_SNAPSHOT_PATH, text,
+                              WRITE_STRING_FILE_CREATE|WRITE_STRING_FILE_ATOMIC|WRITE_STRING_FILE_MODE_0600);
+        if (r < 0)
+                return log_warning_errno(r, "Failed to write %s: %m", CACHE_SNAPSHOT_PATH);
+
+        log_debug("Saved cache snapshot to %s.", CACHE_SNAPSHOT_PATH);
+        return 1;
+}
+
+int manager_load_cache_snapshot(Manager *m) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        sd_id128_t boot_id, snapshot_boot_id = SD_ID128_NULL;
+        sd_json_variant *scopes = NULL;
+        uint64_t timestamp = 0;
+        int r;
+
+        sd_json_dispatch_field dispatch_table[] = {
+                { "bootId",    SD_JSON_VARIANT_STRING,        sd_json_dispatch_id128,         PTR_TO_SIZE(&snapshot_boot_id), SD_JSON_MANDATORY },
+                { "timestamp", _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64,        PTR_TO_SIZE(&timestamp),        SD_JSON_MANDATORY },
+                { "scopes",    SD_JSON_VARIANT_OBJECT,        sd_json_dispatch_variant_noref, PTR_TO_SIZE(&scopes),           SD_JSON_MANDATORY },
+                {}
+        };
+
+        assert(m);
+
+        r = sd_json_parse_file(/* f= */ NULL, CACHE_SNAPSHOT_PATH, /* flags= */ 0, &v, /* reterr_line= */ NULL, /* reterr_column= */ NULL);
+        if (r == -ENOENT)
+                return 0;
+
+        /* A snapshot is used only once, no matter whether we can make use of it or not */
+        (void) unlink(CACHE_SNAPSHOT_PATH);
+
+        if (r < 0)
+                return log_warning_errno(r, "Failed to parse %s, ignoring: %m", CACHE_SNAPSHOT_PATH);
+
+        if (!m->cache_snapshot || m->enable_cache == DNS_CACHE_MODE_NO)
+                return 0;
+
+        r = sd_json_dispatch(v, dispatch_table, SD_JSON_ALLOW_EXTENSIONS, NULL);
+        if (r < 0)
+                return log_warning_errno(r, "Failed to parse %s, ignoring: %m", CACHE_SNAPSHOT_PATH);
+
+        /* The cache uses CLOCK_BOOTTIME, hence a snapshot is only useful in the same boot */
+        r = sd_id128_get_boot(&boot_id);
+        if (r < 0)
+                return log_warning_errno(r, "Failed to get boot ID, ignoring cache snapshot: %m");
+        if (!sd_id128_equal(boot_id, snapshot_boot_id) || timestamp > now(CLOCK_BOOTTIME)) {
+                log_debug("Cache snapshot is from a different boot, ignoring.");
+                return 0;
+        }
+
+        /* The caches of the individual scopes are restored once they are created, see
+         * manager_apply_cache_snapshot() */
+        m->cache_snapshot_data = sd_json_variant_ref(scopes);
+        m->cache_snapshot_timestamp = timestamp;
+        return 1;
+}
+
+void manager_apply_cache_snapshot(Manager *m, DnsScope *s) {
+        sd_json_variant *c;
+        const char *name;
+        int r;
+
+        assert(m);
+        assert(s);
+
+        if (!m->cache_snapshot_data || s->protocol != DNS_PROTOCOL_DNS)
+                return;
+
+        if (s->link) {
+                name = s->link->ifname;
+                if (!name)
+                        return;
+        } else
+                name = "";
+
+        c = sd_json_variant_by_key(m->cache_snapshot_data, name);
+        if (!c)
+                return;
+
+        r = dns_cache_load_snapshot(
+                        &s->cache,
+                        c,
+                        usec_sub_unsigned(now(CLOCK_BOOTTIME), m->cache_snapshot_timestamp),
+                        /* validated_only= */ s->dnssec_mode != DNSSEC_NO);
+        if (r < 0)
+                log_warning_errno(r, "Failed to restore cache of scope on %s, ignoring: %m", s->link ? name : "*");
+        else
+                log_debug("Restored %i cache entries of scope on %s from snapshot.", r, s->link ? name : "*");
+
+        /* Every part of the snapshot is used only once */
+        r = sd_json_variant_filter(&m->cache_snapshot_data, STRV_MAKE(name));
+        if (r < 0 || sd_json_variant_is_blank_object(m->cache_snapshot_data))
+                m->cache_snapshot_data = sd_json_variant_unref(m->cache_snapshot_data);
 }
@@ -27,12 +27,27 @@ typedef struct Manager Manager;
 #define MANAGER_SEARCH_DOMAINS_MAX 256
 #define MANAGER_DNS_SERVERS_MAX 256
 
+#define CACHE_SNAPSHOT_PATH "/run/systemd/resolve/cache-snapshot.json"
+
+typedef struct EtcHostsEntry {
+        struct in_addr_data address; /* AF_UNSPEC if the name was listed for 0.0.0.0 or :: only */
+        uint32_t name;               /* Offset into EtcHosts.names */
+} EtcHostsEntry;
+
+/* The contents of /etc/hosts, in a compact form, since it might be a huge block list. */
 typedef struct EtcHosts {
-        Hashmap *by_address;
-        Hashmap *by_name;
-        Set *no_address;
+        char *names;            /* All host names, NUL separated */
+        size_t names_size;
+        EtcHostsEntry *entries; /* One per name and address, in the order they are listed in the file */
+        size_t n_entries;
+        uint32_t *by_name;      /* Indexes into 'entries', sorted by name, then address */
+        size_t n_by_name;
+        uint32_t *by_address;   /* Indexes into 'entries' with an address, sorted by address, then file order */
+        size_t n_by_address;
 } EtcHosts;
 
+typedef struct EtcHostsReload EtcHostsReload;
+
 struct Manager {
         sd_event *event;
 
@@ -42,6 +57,10 @@ struct Manager {
         DnsOverTlsMode dns_over_tls_mode;
         DnsCacheMode enable_cache;
         bool cache_from_localhost;
+        bool cache_prefetch;
+        bool cache_snapshot;
+        bool prefer_fastest_server;
+        uint64_t cache_memory_max;
         DnsStubListenerMode dns_stub_listener_mode;
         usec_t stale_retention_usec;
 
@@ -135,8 +154,19 @@ struct Manager {
 
         unsigned n_dnssec_verdict[_DNSSEC_VERDICT_MAX];
 
+        /* Reply latency of all upstream servers */
+        DnsServerRttHistogram rtt_histogram;
+
+        /* Results of previous DNSSEC signature verifications */
+        Set *dnssec_verify_cache;
+
+        /* Cache contents saved by the previous instance, by interface name, not yet restored */
+        sd_json_variant *cache_snapshot_data;
+        usec_t cache_snapshot_timestamp;
+
         /* Data from /etc/hosts */
         EtcHosts etc_hosts;
+        EtcHostsReload *etc_hosts_reload;
         usec_t etc_hosts_last;
         struct stat etc_hosts_stat;
         bool read_etc_hosts;
@@ -229,3 +259,9 @@ int socket_disable_pmtud(int fd, int af);
 int dns_manager_dump_statistics_json(Manager *m, sd_json_variant **ret);
 
 void dns_manager_reset_statistics(Manager *m);
+
+void manager_update_cache_memory_max(Manager *m);
+
+int manager_save_cache_snapshot(Manager *m);
+int manager_load_cache_snapshot(Manager *m);
+void manager_apply_cache_snapshot(Manager *m, DnsScope *s);
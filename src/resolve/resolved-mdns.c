@@ -477,6 +477,8 @@ static int on_mdns_packet(sd_event_source *s, int fd, uint32_t revents, void *us
                         }
                 }
 
+                manager_update_cache_memory_max(scope->manager);
+
                 dns_cache_put(
                         &scope->cache,
                         scope->manager->enable_cache,
@@ -186,7 +186,8 @@ static int find_addr_records(
                 DnsQuestion *question,
                 DnsQuery *q,
                 DnsResourceRecord **canonical,
-                const char *search_domain) {
+                const char *search_domain,
+                uint32_t *ttl) {
         DnsResourceRecord *rr;
         int ifindex, r;
 
@@ -225,6 +226,9 @@ static int find_addr_records(
 
                 if (canonical && !*canonical)
                         *canonical = dns_resource_record_ref(rr);
+
+                if (ttl)
+                        *ttl = MIN(*ttl, rr->ttl);
         }
 
         return 0;
@@ -235,6 +239,7 @@ static void vl_method_resolve_hostname_complete(DnsQuery *query) {
         _cleanup_(sd_json_variant_unrefp) sd_json_variant *array = NULL;
         _cleanup_(dns_query_freep) DnsQuery *q = query;
         _cleanup_free_ char *normalized = NULL;
+        uint32_t ttl = UINT32_MAX;
         DnsQuestion *question;
         int r;
 
@@ -260,7 +265,7 @@ static void vl_method_resolve_hostname_complete(DnsQuery *query) {
 
         question = dns_query_question_for_protocol(q, q->answer_protocol);
 
-        r = find_addr_records(&array, question, q, &canonical, DNS_SEARCH_DOMAIN_NAME(q->answer_search_domain));
+        r = find_addr_records(&array, question, q, &canonical, DNS_SEARCH_DOMAIN_NAME(q->answer_search_domain), &ttl);
         if (r < 0)
                 goto finish;
 
@@ -278,7 +283,8 @@ static void vl_method_resolve_hostname_complete(DnsQuery *query) {
                         q->varlink_request,
                         SD_JSON_BUILD_PAIR("addresses", SD_JSON_BUILD_VARIANT(array)),
                         SD_JSON_BUILD_PAIR("name", SD_JSON_BUILD_STRING(normalized)),
-                        SD_JSON_BUILD_PAIR("flags", SD_JSON_BUILD_INTEGER(dns_query_reply_flags_make(q))));
+                        SD_JSON_BUILD_PAIR("flags", SD_JSON_BUILD_INTEGER(dns_query_reply_flags_make(q))),
+                        SD_JSON_BUILD_PAIR("ttl", SD_JSON_BUILD_UNSIGNED(ttl)));
 finish:
         if (r < 0) {
                 log_full_errno(ERRNO_IS_DISCONNECT(r) ? LOG_DEBUG : LOG_ERR, r, "Failed to send hostname reply: %m");
@@ -380,7 +386,9 @@ static int vl_method_resolve_hostname(Varlink *link, sd_json_variant *parameters
         if (r < 0 && r != -EALREADY)
                 return r;
 
-        r = dns_query_new(m, &q, question_utf8, question_idna ?: question_utf8, NULL, p.ifindex, p.flags);
+        /* Let's request that the TTL is fixed up for locally cached entries, so that the TTL we return
+         * is the time left, and clients may cache the reply for that long. */
+        r = dns_query_new(m, &q, question_utf8, question_idna ?: question_utf8, NULL, p.ifindex, p.flags|SD_RESOLVED_CLAMP_TTL);
         if (r < 0)
                 return r;
 
@@ -436,6 +444,7 @@ static int json_dispatch_address(const char *name, sd_json_variant *variant, sd_
 static void vl_method_resolve_address_complete(DnsQuery *query) {
         _cleanup_(sd_json_variant_unrefp) sd_json_variant *array = NULL;
         _cleanup_(dns_query_freep) DnsQuery *q = query;
+        uint32_t ttl = UINT32_MAX;
         DnsQuestion *question;
         DnsResourceRecord *rr;
         int ifindex, r;
@@ -481,6 +490,8 @@ static void vl_method_resolve_address_complete(DnsQuery *query) {
                                 SD_JSON_BUILD_PAIR("name", SD_JSON_BUILD_STRING(normalized)));
                 if (r < 0)
                         goto finish;
+
+                ttl = MIN(ttl, rr->ttl);
         }
 
         if (sd_json_variant_is_blank_object(array)) {
@@ -491,7 +502,8 @@ static void vl_method_resolve_address_complete(DnsQuery *query) {
         r = varlink_replybo(
                         q->varlink_request,
                         SD_JSON_BUILD_PAIR("names", SD_JSON_BUILD_VARIANT(array)),
-                        SD_JSON_BUILD_PAIR("flags", SD_JSON_BUILD_INTEGER(dns_query_reply_flags_make(q))));
+                        SD_JSON_BUILD_PAIR("flags", SD_JSON_BUILD_INTEGER(dns_query_reply_flags_make(q))),
+                        SD_JSON_BUILD_PAIR("ttl", SD_JSON_BUILD_UNSIGNED(ttl)));
 finish:
         if (r < 0) {
                 log_full_errno(ERRNO_IS_DISCONNECT(r) ? LOG_DEBUG : LOG_ERR, r, "Failed to send address reply: %m");
@@ -544,7 +556,7 @@ static int vl_method_resolve_address(Varlink *link, sd_json_variant *parameters,
         if (r < 0)
                 return r;
 
-        r = dns_query_new(m, &q, question, question, NULL, p.ifindex, p.flags|SD_RESOLVED_NO_SEARCH);
+        r = dns_query_new(m, &q, question, question, NULL, p.ifindex, p.flags|SD_RESOLVED_NO_SEARCH|SD_RESOLVED_CLAMP_TTL);
         if (r < 0)
                 return r;
 
@@ -693,7 +705,7 @@ static int append_srv(
                         if (r == 0)
                                 continue;
 
-                        r = find_addr_records(&addresses, question, aux, NULL, NULL);
+                        r = find_addr_records(&addresses, question, aux, NULL, NULL, NULL);
                         if (r < 0)
                                 return r;
                 }
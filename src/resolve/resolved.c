@@ -93,6 +93,8 @@ static int run(int argc, char *argv[]) {
         if (r < 0)
                 return log_error_errno(r, "Event loop failed: %m");
 
+        (void) manager_save_cache_snapshot(m);
+
         return 0;
 }
 
@@ -0,0 +1,197 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include "alloc-util.h"
+#include "fileio.h"
+#include "glob-util.h"
+#include "parse-util.h"
+#include "resolved-dns-packet.h"
+#include "resolved-dns-rr.h"
+#include "stdio-util.h"
+#include "strv.h"
+#include "tests.h"
+#include "time-util.h"
+#include "unaligned.h"
+
+/* Measures how fast we parse DNS packets. Invoke with the duration of each run in seconds, optionally
+ * followed by raw DNS packets to parse, e.g. the ones in test/fuzz/fuzz-dns-packet/. */
+
+static usec_t arg_duration;
+
+static void report(const char *label, size_t n, size_t total, usec_t t) {
+        log_info("%s: %zu packets (%zu bytes) in %s, %.2fµs per packet",
+                 label, n, total, FORMAT_TIMESPAN(t, 1), (double) t / n);
+}
+
+static int packet_new_from_data(DnsPacket **ret, const void *data, size_t size, bool with_header) {
+        _cleanup_(dns_packet_unrefp) DnsPacket *p = NULL;
+        int r;
+
+        r = dns_packet_new(&p, DNS_PROTOCOL_DNS, 0, DNS_PACKET_SIZE_MAX);
+        if (r < 0)
+                return r;
+
+        if (with_header)
+                p->size = 0; /* by default append starts after the header, undo that */
+
+        r = dns_packet_append_blob(p, data, size, NULL);
+        if (r < 0)
+                return r;
+
+        *ret = TAKE_PTR(p);
+        return 0;
+}
+
+/* A response to a query for a name that resolves via a chain of CNAMEs to many addresses, as it is
+ * common for CDNs, with all names compressed. */
+static void make_cname_chain(DnsPacket **ret, DnsAnswer **ret_answer) {
+        _cleanup_(dns_packet_unrefp) DnsPacket *p = NULL;
+        _cleanup_(dns_answer_unrefp) DnsAnswer *answer = NULL;
+        _cleanup_(dns_resource_key_unrefp) DnsResourceKey *key = NULL;
+        char name[64], target[64];
+
+        assert_se(dns_packet_new(&p, DNS_PROTOCOL_DNS, 0, DNS_PACKET_SIZE_MAX) >= 0);
+        DNS_PACKET_HEADER(p)->flags = htobe16(DNS_PACKET_MAKE_FLAGS(1 /* qr */, 0 /* opcode */, 0 /* aa */, 0 /* tc */,
+                                                                    1 /* rd */, 1 /* ra */, 0 /* ad */, 0 /* cd */,
+                                                                    DNS_RCODE_SUCCESS));
+
+        xsprintf(name, "www.service.example.com");
+        assert_se(key = dns_resource_key_new(DNS_CLASS_IN, DNS_TYPE_A, name));
+        assert_se(dns_packet_append_key(p, key, 0, NULL) >= 0);
+        DNS_PACKET_HEADER(p)->qdcount = htobe16(1);
+
+        for (unsigned i = 0; i < 8; i++) {
+                _cleanup_(dns_resource_record_unrefp) DnsResourceRecord *rr = NULL;
+
+                xsprintf(target, "edge%u.region-%u.cdn.example.com", i, i % 3);
+
+                assert_se(rr = dns_resource_record_new_full(DNS_CLASS_IN, DNS_TYPE_CNAME, name));
+                assert_se(rr->cname.name = strdup(target));
+                rr->ttl = 300;
+
+                assert_se(dns_answer_add_extend(&answer, rr, 0, 0, NULL) >= 0);
+                strcpy(name, target);
+        }
+
+        for (unsigned i = 0; i < 40; i++) {
+                _cleanup_(dns_resource_record_unrefp) DnsResourceRecord *rr = NULL;
+
+                assert_se(rr = dns_resource_record_new_full(DNS_CLASS_IN, DNS_TYPE_A, name));
+                rr->a.in_addr.s_addr = htobe32(UINT32_C(0x0a000000) + i);
+                rr->ttl = 60;
+
+                assert_se(dns_answer_add_extend(&answer, rr, 0, 0, NULL) >= 0);
+        }
+
+        DnsResourceRecord *rr;
+        DNS_ANSWER_FOREACH(rr, answer)
+                assert_se(dns_packet_append_rr(p, rr, 0, NULL, NULL) >= 0);
+        DNS_PACKET_HEADER(p)->ancount = htobe16(dns_answer_size(answer));
+
+        *ret = TAKE_PTR(p);
+        *ret_answer = TAKE_PTR(answer);
+}
+
+static void verify_answer(DnsAnswer *a, DnsAnswer *expected) {
+        DnsResourceRecord *rr;
+
+        assert_se(dns_answer_size(a) == dns_answer_size(expected));
+        DNS_ANSWER_FOREACH(rr, expected)
+                assert_se(dns_answer_contains(a, rr));
+}
+
+static void test_extract(const char *label, DnsPacket *packet, DnsAnswer *expected) {
+        size_t n = 0;
+        usec_t t = 0, start;
+
+        start = now(CLOCK_MONOTONIC);
+        for (; t < arg_duration; n++, t = now(CLOCK_MONOTONIC) - start) {
+                _cleanup_(dns_packet_unrefp) DnsPacket *p = NULL;
+
+                assert_se(packet_new_from_data(&p, DNS_PACKET_DATA(packet), packet->size, /* with_header= */ true) >= 0);
+                assert_se(dns_packet_extract(p) >= 0);
+
+                if (n == 0 && expected)
+                        verify_answer(p->answer, expected);
+        }
+
+        report(label, n, n * packet->size, t);
+}
+
+/* The .pkts files contain a sequence of RRs in wire format, each prefixed by its size */
+static void test_read_rrs(const char *filename) {
+        _cleanup_free_ char *data = NULL;
+        size_t data_size, n = 0, total = 0;
+        usec_t t = 0, start;
+
+        assert_se(read_full_file(filename, &data, &data_size) >= 0);
+
+        start = now(CLOCK_MONOTONIC);
+        for (; t < arg_duration; t = now(CLOCK_MONOTONIC) - start)
+                for (size_t offset = 0, packet_size; offset + 8 <= data_size; offset += 8 + packet_size) {
+                        _cleanup_(dns_packet_unrefp) DnsPacket *p = NULL;
+                        _cleanup_(dns_resource_record_unrefp) DnsResourceRecord *rr = NULL;
+
+                        packet_size = unaligned_read_le64(data + offset);
+                        assert_se(offset + 8 + packet_size <= data_size);
+
+                        assert_se(packet_new_from_data(&p, data + offset + 8, packet_size, /* with_header= */ false) >= 0);
+                        assert_se(dns_packet_read_rr(p, &rr, NULL, NULL) >= 0);
+
+                        n++;
+                        total += packet_size;
+                }
+
+        report(filename, n, total, t);
+}
+
+static void test_extract_file(const char *filename) {
+        _cleanup_(dns_packet_unrefp) DnsPacket *p = NULL;
+        _cleanup_free_ char *data = NULL;
+        size_t data_size;
+
+        assert_se(read_full_file(filename, &data, &data_size) >= 0);
+
+        if (data_size < DNS_PACKET_HEADER_SIZE) {
+                log_info("%s: too short, skipping.", filename);
+                return;
+        }
+
+        assert_se(packet_new_from_data(&p, data, data_size, /* with_header= */ true) >= 0);
+        if (dns_packet_extract(p) < 0) {
+                log_info("%s: not a valid packet, skipping.", filename);
+                return;
+        }
+
+        test_extract(filename, p, p->answer);
+}
+
+int main(int argc, char *argv[]) {
+        _cleanup_(dns_packet_unrefp) DnsPacket *p = NULL;
+        _cleanup_(dns_answer_unrefp) DnsAnswer *answer = NULL;
+        _cleanup_globfree_ glob_t g = {};
+        _cleanup_free_ char *pkts_glob = NULL;
+
+        test_setup_logging(LOG_INFO);
+
+        if (argc >= 2) {
+                unsigned x;
+
+                assert_se(safe_atou(argv[1], &x) >= 0);
+                arg_duration = x * USEC_PER_SEC;
+        } else
+                arg_duration = slow_tests_enabled() ?
+                        2 * USEC_PER_SEC : USEC_PER_SEC / 50;
+
+        make_cname_chain(&p, &answer);
+        test_extract("cname-chain", p, answer);
+
+        assert_se(get_testdata_dir("test-resolve/*.pkts", &pkts_glob) >= 0);
+        assert_se(glob(pkts_glob, GLOB_NOSORT, NULL, &g) == 0);
+        for (size_t i = 0; i < g.gl_pathc; i++)
+                test_read_rrs(g.gl_pathv[i]);
+
+        STRV_FOREACH(f, strv_skip(argv, 2))
+                test_extract_file(*f);
+
+        return 0;
+}
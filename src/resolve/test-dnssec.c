@@ -480,6 +480,7 @@ TEST(dnssec_verify_rrset) {
 
         _cleanup_(dns_resource_record_unrefp) DnsResourceRecord *a = NULL, *rrsig = NULL, *dnskey = NULL;
         _cleanup_(dns_answer_unrefp) DnsAnswer *answer = NULL;
+        _cleanup_set_free_ Set *verify_cache = NULL;
         DnssecResult result;
 
         a = dns_resource_record_new_full(DNS_CLASS_IN, DNS_TYPE_A, "nAsA.gov");
@@ -530,6 +531,19 @@ TEST(dnssec_verify_rrset) {
         /* Validate the RR as it if was 2015-12-2 today */
         assert_se(dnssec_verify_rrset(answer, a->key, rrsig, dnskey, 1449092754*USEC_PER_SEC, &result) >= 0);
         assert_se(result == DNSSEC_VALIDATED);
+
+        /* Once more with a verification cache, the second time around the result comes from there */
+        for (unsigned i = 0; i < 2; i++) {
+                assert_se(dnssec_verify_rrset_full(answer, a->key, rrsig, dnskey, 1449092754*USEC_PER_SEC, &verify_cache, &result) >= 0);
+                assert_se(result == DNSSEC_VALIDATED);
+                assert_se(set_size(verify_cache) == 1);
+        }
+
+        /* A different signature must not be taken for the one we already verified */
+        ((uint8_t*) rrsig->rrsig.signature)[0] ^= 1;
+        assert_se(dnssec_verify_rrset_full(answer, a->key, rrsig, dnskey, 1449092754*USEC_PER_SEC, &verify_cache, &result) >= 0);
+        assert_se(result == DNSSEC_INVALID);
+        assert_se(set_size(verify_cache) == 2);
 }
 
 TEST(dnssec_verify_rrset2) {
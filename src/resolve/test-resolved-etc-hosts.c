@@ -8,6 +8,7 @@
 #include "fd-util.h"
 #include "fileio.h"
 #include "fs-util.h"
+#include "in-addr-util.h"
 #include "log.h"
 #include "resolved-etc-hosts.h"
 #include "strv.h"
@@ -33,11 +34,61 @@ TEST(parse_etc_hosts_system) {
 #define in_addr_6(...)                                           \
         (&(struct in_addr_data) { .family = AF_INET6, .address.in6 = { .s6_addr = __VA_ARGS__ } })
 
-#define has_4(_set, _address_str)                                       \
-        set_contains(_set, in_addr_4(_address_str))
+static size_t n_addresses(const EtcHosts *hosts, const char *name) {
+        size_t idx, n, k = 0;
 
-#define has_6(_set, ...)                                           \
-        set_contains(_set, in_addr_6(__VA_ARGS__))
+        n = etc_hosts_find_by_name(hosts, name, &idx);
+        for (size_t i = idx; i < idx + n; i++)
+                if (hosts->entries[hosts->by_name[i]].address.family != AF_UNSPEC)
+                        k++;
+
+        return k;
+}
+
+static bool has_address(const EtcHosts *hosts, const char *name, const struct in_addr_data *a) {
+        size_t idx, n;
+
+        n = etc_hosts_find_by_name(hosts, name, &idx);
+        for (size_t i = idx; i < idx + n; i++) {
+                const struct in_addr_data *b = &hosts->entries[hosts->by_name[i]].address;
+
+                if (b->family == a->family &&
+                    (a->family == AF_UNSPEC || in_addr_equal(a->family, &a->address, &b->address)))
+                        return true;
+        }
+
+        return false;
+}
+
+static bool has_no_address(const EtcHosts *hosts, const char *name) {
+        return has_address(hosts, name, &(struct in_addr_data) { .family = AF_UNSPEC });
+}
+
+static size_t n_names(const EtcHosts *hosts, const struct in_addr_data *a) {
+        size_t idx;
+
+        return etc_hosts_find_by_address(hosts, a, &idx);
+}
+
+static bool has_name(const EtcHosts *hosts, const struct in_addr_data *a, const char *name) {
+        size_t idx, n;
+
+        n = etc_hosts_find_by_address(hosts, a, &idx);
+        for (size_t i = idx; i < idx + n; i++)
+                if (streq(etc_hosts_entry_name(hosts, hosts->entries + hosts->by_address[i]), name))
+                        return true;
+
+        return false;
+}
+
+static const char* canonical_name(const EtcHosts *hosts, const struct in_addr_data *a) {
+        size_t idx;
+
+        if (etc_hosts_find_by_address(hosts, a, &idx) == 0)
+                return NULL;
+
+        return etc_hosts_entry_name(hosts, hosts->entries + hosts->by_address[idx]);
+}
 
 TEST(parse_etc_hosts) {
         _cleanup_(unlink_tempfilep) char
@@ -74,66 +125,96 @@ TEST(parse_etc_hosts) {
         _cleanup_(etc_hosts_clear) EtcHosts hosts = {};
         assert_se(etc_hosts_parse(&hosts, f) == 0);
 
-        EtcHostsItemByName *bn;
-        assert_se(bn = hashmap_get(hosts.by_name, "some.where"));
-        assert_se(set_size(bn->addresses) == 3);
-        assert_se(has_4(bn->addresses, "1.2.3.4"));
-        assert_se(has_4(bn->addresses, "1.2.3.5"));
-        assert_se(has_6(bn->addresses, {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 5}));
+        assert_se(n_addresses(&hosts, "some.where") == 3);
+        assert_se(has_address(&hosts, "some.where", in_addr_4("1.2.3.4")));
+        assert_se(has_address(&hosts, "some.where", in_addr_4("1.2.3.5")));
+        assert_se(has_address(&hosts, "some.where", in_addr_6({0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 5})));
 
-        assert_se(bn = hashmap_get(hosts.by_name, "dash"));
-        assert_se(set_size(bn->addresses) == 1);
-        assert_se(has_4(bn->addresses, "1.2.3.6"));
+        assert_se(n_addresses(&hosts, "dash") == 1);
+        assert_se(has_address(&hosts, "dash", in_addr_4("1.2.3.6")));
 
-        assert_se(bn = hashmap_get(hosts.by_name, "dash-dash.where-dash"));
-        assert_se(set_size(bn->addresses) == 1);
-        assert_se(has_4(bn->addresses, "1.2.3.6"));
+        assert_se(n_addresses(&hosts, "dash-dash.where-dash") == 1);
+        assert_se(has_address(&hosts, "dash-dash.where-dash", in_addr_4("1.2.3.6")));
 
         /* See https://tools.ietf.org/html/rfc1035#section-2.3.1 */
         FOREACH_STRING(s, "bad-dash-", "-bad-dash", "-bad-dash.bad-")
-                assert_se(!hashmap_get(hosts.by_name, s));
-
-        assert_se(bn = hashmap_get(hosts.by_name, "before.comment"));
-        assert_se(set_size(bn->addresses) == 4);
-        assert_se(has_4(bn->addresses, "1.2.3.9"));
-        assert_se(has_4(bn->addresses, "1.2.3.10"));
-        assert_se(has_4(bn->addresses, "1.2.3.11"));
-        assert_se(has_4(bn->addresses, "1.2.3.12"));
-
-        assert_se(!hashmap_get(hosts.by_name, "within.comment"));
-        assert_se(!hashmap_get(hosts.by_name, "within.comment2"));
-        assert_se(!hashmap_get(hosts.by_name, "within.comment3"));
-        assert_se(!hashmap_get(hosts.by_name, "#"));
-
-        assert_se(!hashmap_get(hosts.by_name, "short.address"));
-        assert_se(!hashmap_get(hosts.by_name, "long.address"));
-        assert_se(!hashmap_get(hosts.by_name, "multi.colon"));
-        assert_se(!set_contains(hosts.no_address, "short.address"));
-        assert_se(!set_contains(hosts.no_address, "long.address"));
-        assert_se(!set_contains(hosts.no_address, "multi.colon"));
-
-        assert_se(bn = hashmap_get(hosts.by_name, "some.other"));
-        assert_se(set_size(bn->addresses) == 1);
-        assert_se(has_6(bn->addresses, {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 5}));
-
-        EtcHostsItemByAddress *ba;
-        assert_se(ba = hashmap_get(hosts.by_address, in_addr_4("1.2.3.6")));
-        assert_se(set_size(ba->names) == 2);
-        assert_se(set_contains(ba->names, "dash"));
-        assert_se(set_contains(ba->names, "dash-dash.where-dash"));
-        assert_se(streq(ba->canonical_name, "dash"));
-
-        assert_se(ba = hashmap_get(hosts.by_address, in_addr_6({0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 5})));
-        assert_se(set_size(ba->names) == 3);
-        assert_se(set_contains(ba->names, "some.where"));
-        assert_se(set_contains(ba->names, "some.other"));
-        assert_se(set_contains(ba->names, "foobar.foo.foo"));
-        assert_se(streq(ba->canonical_name, "some.where"));
-
-        assert_se( set_contains(hosts.no_address, "some.where"));
-        assert_se( set_contains(hosts.no_address, "some.other"));
-        assert_se( set_contains(hosts.no_address, "deny.listed"));
-        assert_se(!set_contains(hosts.no_address, "foobar.foo.foo"));
+                assert_se(n_addresses(&hosts, s) == 0);
+
+        assert_se(n_addresses(&hosts, "before.comment") == 4);
+        assert_se(has_address(&hosts, "before.comment", in_addr_4("1.2.3.9")));
+        assert_se(has_address(&hosts, "before.comment", in_addr_4("1.2.3.10")));
+        assert_se(has_address(&hosts, "before.comment", in_addr_4("1.2.3.11")));
+        assert_se(has_address(&hosts, "before.comment", in_addr_4("1.2.3.12")));
+
+        assert_se(n_addresses(&hosts, "within.comment") == 0);
+        assert_se(n_addresses(&hosts, "within.comment2") == 0);
+        assert_se(n_addresses(&hosts, "within.comment3") == 0);
+        assert_se(n_addresses(&hosts, "#") == 0);
+
+        assert_se(n_addresses(&hosts, "short.address") == 0);
+        assert_se(n_addresses(&hosts, "long.address") == 0);
+        assert_se(n_addresses(&hosts, "multi.colon") == 0);
+        assert_se(!has_no_address(&hosts, "short.address"));
+        assert_se(!has_no_address(&hosts, "long.address"));
+        assert_se(!has_no_address(&hosts, "multi.colon"));
+
+        assert_se(n_addresses(&hosts, "some.other") == 1);
+        assert_se(has_address(&hosts, "some.other", in_addr_6({0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 5})));
+
+        assert_se(n_names(&hosts, in_addr_4("1.2.3.6")) == 2);
+        assert_se(has_name(&hosts, in_addr_4("1.2.3.6"), "dash"));
+        assert_se(has_name(&hosts, in_addr_4("1.2.3.6"), "dash-dash.where-dash"));
+        assert_se(streq(canonical_name(&hosts, in_addr_4("1.2.3.6")), "dash"));
+
+        assert_se(n_names(&hosts, in_addr_6({0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 5})) == 3);
+        assert_se(has_name(&hosts, in_addr_6({0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 5}), "some.where"));
+        assert_se(has_name(&hosts, in_addr_6({0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 5}), "some.other"));
+        assert_se(has_name(&hosts, in_addr_6({0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 5}), "foobar.foo.foo"));
+        assert_se(streq(canonical_name(&hosts, in_addr_6({0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 5})), "some.where"));
+
+        assert_se( has_no_address(&hosts, "some.where"));
+        assert_se( has_no_address(&hosts, "some.other"));
+        assert_se( has_no_address(&hosts, "deny.listed"));
+        assert_se(!has_no_address(&hosts, "foobar.foo.foo"));
+
+        /* Names are looked up case-insensitively, and with or without trailing dot */
+        assert_se(n_addresses(&hosts, "SOME.Where") == 3);
+        assert_se(n_addresses(&hosts, "some.where.") == 3);
+}
+
+TEST(parse_etc_hosts_duplicates_and_localhost) {
+        _cleanup_(unlink_tempfilep) char
+                t[] = "/tmp/test-resolved-etc-hosts.XXXXXX";
+        _cleanup_fclose_ FILE *f = NULL;
+        int fd;
+
+        fd = mkostemp_safe(t);
+        assert_se(fd >= 0);
+
+        assert_se(f = fdopen(fd, "r+"));
+        fputs("127.0.0.1 localhost localhost.localdomain\n"
+              "::1 localhost\n"
+              "127.0.0.2 other\n"
+              "1.2.3.4 first second FIRST\n"
+              "1.2.3.4 second third\n", f);
+        assert_se(fflush_and_check(f) >= 0);
+        rewind(f);
+
+        _cleanup_(etc_hosts_clear) EtcHosts hosts = {};
+        assert_se(etc_hosts_parse(&hosts, f) == 0);
+
+        /* Plain localhost mappings are left to the synthesizing logic */
+        assert_se(n_addresses(&hosts, "localhost") == 0);
+        assert_se(n_addresses(&hosts, "localhost.localdomain") == 0);
+        assert_se(n_names(&hosts, in_addr_4("127.0.0.1")) == 0);
+        assert_se(n_addresses(&hosts, "other") == 1);
+
+        /* Each name is listed once per address, and the first one is the canonical name */
+        assert_se(n_names(&hosts, in_addr_4("1.2.3.4")) == 3);
+        assert_se(streq(canonical_name(&hosts, in_addr_4("1.2.3.4")), "first"));
+        assert_se(n_addresses(&hosts, "first") == 1);
+        assert_se(n_addresses(&hosts, "second") == 1);
+        assert_se(has_address(&hosts, "third", in_addr_4("1.2.3.4")));
 }
 
 static void test_parse_file_one(const char *fname) {
@@ -14,6 +14,8 @@
 #include "missing_syscall.h"
 #include "path-util.h"
 #include "serialize.h"
+#include "set.h"
+#include "siphash24.h"
 #include "string-table.h"
 
 static const char *const bpf_cgroup_attach_type_table[__MAX_BPF_ATTACH_TYPE] = {
@@ -41,6 +43,179 @@ DEFINE_STRING_TABLE_LOOKUP(bpf_cgroup_attach_type, int);
 
 DEFINE_HASH_OPS_WITH_KEY_DESTRUCTOR(bpf_program_hash_ops, void, trivial_hash_func, trivial_compare_func, bpf_program_free);
 
+/* A program that doesn't refer to any maps is fully defined by its type, name and code. Hence, if the very
+ * same program is loaded again, e.g. because many units have identical DeviceAllow= settings, we can just
+ * use the one we loaded before, and attach it to as many cgroups as needed. This saves kernel memory, and
+ * the time the verifier takes for each load. Programs are looked up by their code, and stay loaded for as
+ * long as any BPFProgram object refers to them. Like the rest of this, this is not thread-safe. */
+struct BPFSharedProgram {
+        unsigned n_ref;
+        int kernel_fd;
+        uint32_t prog_type;
+        char *prog_name;
+        size_t n_instructions;
+        struct bpf_insn *instructions;
+};
+
+static Set *shared_programs = NULL;
+static uint64_t n_programs_loaded = 0, n_program_loads_avoided = 0;
+
+static void bpf_shared_program_hash_func(const BPFSharedProgram *s, struct siphash *state) {
+        siphash24_compress_typesafe(s->prog_type, state);
+        siphash24_compress_string(s->prog_name, state);
+        siphash24_compress_typesafe(s->n_instructions, state);
+        siphash24_compress(s->instructions, s->n_instructions * sizeof(struct bpf_insn), state);
+}
+
+static int bpf_shared_program_compare_func(const BPFSharedProgram *a, const BPFSharedProgram *b) {
+        int r;
+
+        r = CMP(a->prog_type, b->prog_type);
+        if (r != 0)
+                return r;
+
+        r = strcmp_ptr(a->prog_name, b->prog_name);
+        if (r != 0)
+                return r;
+
+        r = CMP(a->n_instructions, b->n_instructions);
+        if (r != 0)
+                return r;
+
+        return memcmp_nn(a->instructions, a->n_instructions * sizeof(struct bpf_insn),
+                         b->instructions, b->n_instructions * sizeof(struct bpf_insn));
+}
+
+DEFINE_PRIVATE_HASH_OPS(
+                bpf_shared_program_hash_ops,
+                BPFSharedProgram,
+                bpf_shared_program_hash_func,
+                bpf_shared_program_compare_func);
+
+static BPFSharedProgram* bpf_shared_program_unref(BPFSharedProgram *s) {
+        if (!s)
+                return NULL;
+
+        assert(s->n_ref > 0);
+        if (--s->n_ref > 0)
+                return NULL;
+
+        set_remove(shared_programs, s);
+        if (set_isempty(shared_programs))
+                shared_programs = set_free(shared_programs);
+
+        safe_close(s->kernel_fd);
+        free(s->prog_name);
+        free(s->instructions);
+        return mfree(s);
+}
+
+static bool bpf_program_is_shareable(const BPFProgram *p) {
+        assert(p);
+
+        if (p->n_instructions == 0)
+                return false;
+
+        /* Programs referring to maps by fd can't be shared, as the same fd number doesn't imply the same
+         * map, and maps usually carry per-cgroup state anyway. */
+        FOREACH_ARRAY(i, p->instructions, p->n_instructions)
+                if (i->code == (BPF_LD | BPF_IMM | BPF_DW) && i->src_reg != 0)
+                        return false;
+
+        return true;
+}
+
+static int bpf_program_use_shared(BPFProgram *p) {
+        BPFSharedProgram *s;
+        int fd;
+
+        assert(p);
+        assert(p->kernel_fd < 0);
+
+        s = set_get(shared_programs, &(BPFSharedProgram) {
+                        .prog_type = p->prog_type,
+                        .prog_name = p->prog_name,
+                        .n_instructions = p->n_instructions,
+                        .instructions = p->instructions,
+                });
+        if (!s)
+                return 0;
+
+        fd = fcntl(s->kernel_fd, F_DUPFD_CLOEXEC, 3);
+        if (fd < 0)
+                return -errno;
+
+        s->n_ref++;
+        p->shared = s;
+        p->kernel_fd = fd;
+        n_program_loads_avoided++;
+
+        return 1;
+}
+
+static int bpf_program_make_shared(BPFProgram *p) {
+        _cleanup_free_ struct bpf_insn *instructions = NULL;
+        _cleanup_free_ char *name = NULL;
+        _cleanup_close_ int fd = -EBADF;
+        _cleanup_free_ BPFSharedProgram *s = NULL;
+        int r;
+
+        assert(p);
+        assert(p->kernel_fd >= 0);
+        assert(!p->shared);
+
+        fd = fcntl(p->kernel_fd, F_DUPFD_CLOEXEC, 3);
+        if (fd < 0)
+                return -errno;
+
+        instructions = newdup(struct bpf_insn, p->instructions, p->n_instructions);
+        if (!instructions)
+                return -ENOMEM;
+
+        r = strdup_to(&name, p->prog_name);
+        if (r < 0)
+                return r;
+
+        s = new(BPFSharedProgram, 1);
+        if (!s)
+                return -ENOMEM;
+
+        *s = (BPFSharedProgram) {
+                .n_ref = 1,
+                .kernel_fd = TAKE_FD(fd),
+                .prog_type = p->prog_type,
+                .prog_name = TAKE_PTR(name),
+                .n_instructions = p->n_instructions,
+                .instructions = TAKE_PTR(instructions),
+        };
+
+        r = set_ensure_put(&shared_programs, &bpf_shared_program_hash_ops, s);
+        if (r < 0) {
+                safe_close(s->kernel_fd);
+                free(s->prog_name);
+                free(s->instructions);
+                return r;
+        }
+
+        p->shared = TAKE_PTR(s);
+        return 0;
+}
+
+void bpf_program_get_statistics(BPFProgramStatistics *ret) {
+        BPFSharedProgram *s;
+
+        assert(ret);
+
+        *ret = (BPFProgramStatistics) {
+                .n_shared = set_size(shared_programs),
+                .n_loaded = n_programs_loaded,
+                .n_load_avoided = n_program_loads_avoided,
+        };
+
+        SET_FOREACH(s, shared_programs)
+                ret->n_shared_users += s->n_ref;
+}
+
 BPFProgram *bpf_program_free(BPFProgram *p) {
         if (!p)
                 return NULL;
@@ -55,6 +230,7 @@ BPFProgram *bpf_program_free(BPFProgram *p) {
         (void) bpf_program_cgroup_detach(p);
 
         safe_close(p->kernel_fd);
+        bpf_shared_program_unref(p->shared);
         free(p->prog_name);
         free(p->instructions);
         free(p->attached_path);
@@ -157,6 +333,8 @@ int bpf_program_add_instructions(BPFProgram *p, const struct bpf_insn *instructi
 
 int bpf_program_load_kernel(BPFProgram *p, char *log_buf, size_t log_size) {
         union bpf_attr attr;
+        bool shareable;
+        int r;
 
         assert(p);
 
@@ -165,6 +343,17 @@ int bpf_program_load_kernel(BPFProgram *p, char *log_buf, size_t log_size) {
                 return 0;
         }
 
+        shareable = bpf_program_is_shareable(p);
+        if (shareable) {
+                r = bpf_program_use_shared(p);
+                if (r < 0)
+                        return r;
+                if (r > 0) {
+                        memzero(log_buf, log_size);
+                        return 0;
+                }
+        }
+
         // FIXME: Clang doesn't 0-pad with structured initialization, causing
         // the kernel to reject the bpf_attr as invalid. See:
         // https://github.com/torvalds/linux/blob/v5.9/kernel/bpf/syscall.c#L65
@@ -184,6 +373,15 @@ int bpf_program_load_kernel(BPFProgram *p, char *log_buf, size_t log_size) {
         if (p->kernel_fd < 0)
                 return -errno;
 
+        n_programs_loaded++;
+
+        if (shareable) {
+                /* Not being able to share this is not fatal, we just may load the same thing again later */
+                r = bpf_program_make_shared(p);
+                if (r < 0)
+                        log_debug_errno(r, "Failed to register BPF program for sharing, ignoring: %m");
+        }
+
         return 0;
 }
 
@@ -267,6 +465,37 @@ int bpf_program_cgroup_attach(BPFProgram *p, int type, const char *path, uint32_
         return 0;
 }
 
+bool bpf_program_is_attached_same(const BPFProgram *installed, const BPFProgram *p, int type, const char *path, uint32_t flags) {
+        assert(p);
+        assert(path);
+
+        /* Returns true if 'installed' is attached to the specified cgroup in the specified way, and has the
+         * very same code as 'p', i.e. attaching 'p' instead would not change anything. In
+         * BPF_F_ALLOW_OVERRIDE mode someone else might have replaced our program, see above, hence we never
+         * consider it the same in that case. */
+
+        if (!installed || !installed->attached_path)
+                return false;
+
+        if (flags == BPF_F_ALLOW_OVERRIDE)
+                return false;
+
+        if (installed->attached_type != type || installed->attached_flags != flags)
+                return false;
+
+        if (!path_equal(installed->attached_path, path))
+                return false;
+
+        if (installed->prog_type != p->prog_type)
+                return false;
+
+        /* If we don't know the code, e.g. because the program was deserialized, be conservative */
+        if (installed->n_instructions == 0 || installed->n_instructions != p->n_instructions)
+                return false;
+
+        return memcmp(installed->instructions, p->instructions, p->n_instructions * sizeof(struct bpf_insn)) == 0;
+}
+
 int bpf_program_cgroup_detach(BPFProgram *p) {
         _cleanup_close_ int fd = -EBADF;
 
@@ -11,6 +11,7 @@
 #include "macro.h"
 
 typedef struct BPFProgram BPFProgram;
+typedef struct BPFSharedProgram BPFSharedProgram;
 
 /* This encapsulates three different concepts: the loaded BPF program, the BPF code, and the attachment to a
  * cgroup. Typically our BPF programs go through all three stages: we build the code, we load it, and finally
@@ -26,6 +27,9 @@ struct BPFProgram {
         size_t n_instructions;
         struct bpf_insn *instructions;
 
+        /* If kernel_fd refers to a loaded program shared with other BPFProgram objects with the same code */
+        BPFSharedProgram *shared;
+
         /* The cgroup path the program is attached to, if it is attached. If non-NULL bpf_program_unref()
          * will detach on destruction. */
         char *attached_path;
@@ -42,8 +46,18 @@ int bpf_program_load_kernel(BPFProgram *p, char *log_buf, size_t log_size);
 int bpf_program_load_from_bpf_fs(BPFProgram *p, const char *path);
 
 int bpf_program_cgroup_attach(BPFProgram *p, int type, const char *path, uint32_t flags);
+bool bpf_program_is_attached_same(const BPFProgram *installed, const BPFProgram *p, int type, const char *path, uint32_t flags);
 int bpf_program_cgroup_detach(BPFProgram *p);
 
+typedef struct BPFProgramStatistics {
+        unsigned n_shared;        /* Distinct programs currently loaded that may be shared */
+        unsigned n_shared_users;  /* Program objects currently referring to them */
+        uint64_t n_loaded;        /* Total number of programs loaded into the kernel */
+        uint64_t n_load_avoided;  /* Total number of times we could use an already loaded program instead */
+} BPFProgramStatistics;
+
+void bpf_program_get_statistics(BPFProgramStatistics *ret);
+
 int bpf_program_pin(int prog_fd, const char *bpffs_path);
 int bpf_program_get_id_by_fd(int prog_fd, uint32_t *ret_id);
 
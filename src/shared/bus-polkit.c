@@ -4,10 +4,17 @@
 #include "bus-message.h"
 #include "bus-polkit.h"
 #include "bus-util.h"
+#include "escape.h"
 #include "process-util.h"
 #include "strv.h"
 #include "user-util.h"
 
+/* How long to remember that a sender was authorized for an action non-interactively. Polkit tells us
+ * about changes of its configuration, but not about changes of the sender's session state, which implicit
+ * authorizations depend on. Hence keep this short. */
+#define POLKIT_CACHE_USEC (5 * USEC_PER_SEC)
+#define POLKIT_CACHE_MAX 1024U
+
 static int bus_message_check_good_user(sd_bus_message *m, uid_t good_user) {
         _cleanup_(sd_bus_creds_unrefp) sd_bus_creds *creds = NULL;
         uid_t sender_uid;
@@ -163,9 +170,189 @@ int bus_test_polkit(
 
 #if ENABLE_POLKIT
 
+typedef struct PolkitCache {
+        sd_bus *bus;            /* not referenced, the cache goes away together with the match slot */
+        sd_id128_t bus_id;
+        Hashmap *entries;       /* "sender action details…" → usec_t (CLOCK_MONOTONIC) until valid */
+} PolkitCache;
+
+/* sd_bus → PolkitCache, for all buses we made polkit queries on */
+static Hashmap *polkit_caches = NULL;
+
+static PolkitCache* polkit_cache_free(PolkitCache *c) {
+        if (!c)
+                return NULL;
+
+        hashmap_free(c->entries);
+        return mfree(c);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(PolkitCache*, polkit_cache_free);
+
+static void polkit_cache_destroy(void *userdata) {
+        PolkitCache *c = ASSERT_PTR(userdata);
+
+        /* Called when the bus goes away, and the match slot with it */
+        assert_se(hashmap_remove(polkit_caches, c->bus) == c);
+        if (hashmap_isempty(polkit_caches))
+                polkit_caches = hashmap_free(polkit_caches);
+
+        polkit_cache_free(c);
+}
+
+static int polkit_cache_on_changed(sd_bus_message *m, void *userdata, sd_bus_error *error) {
+        PolkitCache *c = ASSERT_PTR(userdata);
+
+        log_debug("Polkit configuration changed, flushing %u cached authorizations.", hashmap_size(c->entries));
+        hashmap_clear(c->entries);
+        return 0;
+}
+
+static int polkit_cache_key(const char *sender, const char *action, const char **details, char **ret) {
+        _cleanup_free_ char *k = NULL;
+
+        assert(sender);
+        assert(action);
+        assert(ret);
+
+        k = strjoin(sender, "\n", action);
+        if (!k)
+                return -ENOMEM;
+
+        /* Escape the details, so that we can use a separator that can't show up otherwise. (Bus names
+         * and action ids can't contain newlines anyway.) */
+        STRV_FOREACH(d, details) {
+                _cleanup_free_ char *e = NULL;
+
+                e = cescape(*d);
+                if (!e || !strextend(&k, "\n", e))
+                        return -ENOMEM;
+        }
+
+        *ret = TAKE_PTR(k);
+        return 0;
+}
+
+static PolkitCache* polkit_cache_get(sd_bus *bus) {
+        PolkitCache *c;
+        sd_id128_t id;
+
+        assert(bus);
+
+        c = hashmap_get(polkit_caches, bus);
+        if (!c)
+                return NULL;
+
+        /* Unique names are only unique on one bus instance, hence flush everything if we reconnected */
+        if (sd_bus_get_bus_id(bus, &id) < 0 || !sd_id128_equal(id, c->bus_id)) {
+                hashmap_clear(c->entries);
+                c->bus_id = id;
+        }
+
+        return c;
+}
+
+static bool polkit_cache_lookup(sd_bus_message *call, const char *action, const char **details) {
+        _cleanup_free_ char *k = NULL;
+        PolkitCache *c;
+        usec_t *until;
+
+        assert(call);
+        assert(action);
+
+        if (!sd_bus_message_get_sender(call))
+                return false;
+
+        c = polkit_cache_get(call->bus);
+        if (!c)
+                return false;
+
+        if (polkit_cache_key(sd_bus_message_get_sender(call), action, details, &k) < 0)
+                return false;
+
+        until = hashmap_get(c->entries, k);
+        if (!until)
+                return false;
+
+        if (now(CLOCK_MONOTONIC) < *until)
+                return true;
+
+        free(hashmap_remove(c->entries, k));
+        return false;
+}
+
+static int polkit_cache_add(sd_bus *bus, const char *sender, const char *action, const char **details) {
+        _cleanup_(sd_bus_slot_unrefp) sd_bus_slot *slot = NULL;
+        _cleanup_free_ usec_t *until = NULL;
+        _cleanup_free_ char *k = NULL;
+        PolkitCache *c;
+        int r;
+
+        assert(bus);
+        assert(sender);
+        assert(action);
+
+        c = polkit_cache_get(bus);
+        if (!c) {
+                _cleanup_(polkit_cache_freep) PolkitCache *n = NULL;
+
+                n = new0(PolkitCache, 1);
+                if (!n)
+                        return -ENOMEM;
+
+                n->bus = bus;
+                (void) sd_bus_get_bus_id(bus, &n->bus_id);
+
+                r = sd_bus_match_signal_async(
+                                bus,
+                                &slot,
+                                "org.freedesktop.PolicyKit1",
+                                "/org/freedesktop/PolicyKit1/Authority",
+                                "org.freedesktop.PolicyKit1.Authority",
+                                "Changed",
+                                polkit_cache_on_changed,
+                                /* install_callback= */ NULL,
+                                n);
+                if (r < 0)
+                        return r;
+
+                r = hashmap_ensure_put(&polkit_caches, NULL, bus, n);
+                if (r < 0)
+                        return r;
+
+                /* From now on the cache is owned by the match slot, which in turn is owned by the bus */
+                c = TAKE_PTR(n);
+                assert_se(sd_bus_slot_set_destroy_callback(slot, polkit_cache_destroy) >= 0);
+                assert_se(sd_bus_slot_set_floating(slot, true) >= 0);
+        }
+
+        r = polkit_cache_key(sender, action, details, &k);
+        if (r < 0)
+                return r;
+
+        until = new(usec_t, 1);
+        if (!until)
+                return -ENOMEM;
+        *until = usec_add(now(CLOCK_MONOTONIC), POLKIT_CACHE_USEC);
+
+        if (hashmap_size(c->entries) >= POLKIT_CACHE_MAX)
+                hashmap_clear(c->entries);
+
+        free(hashmap_remove(c->entries, k));
+
+        r = hashmap_ensure_put(&c->entries, &string_hash_ops_free_free, k, until);
+        if (r < 0)
+                return r;
+
+        TAKE_PTR(k);
+        TAKE_PTR(until);
+        return 0;
+}
+
 typedef struct AsyncPolkitQueryAction {
         char *action;
         char **details;
+        bool interactive;
 
         LIST_FIELDS(struct AsyncPolkitQueryAction, authorized);
 } AsyncPolkitQueryAction;
@@ -258,6 +445,33 @@ static int async_polkit_defer(sd_event_source *s, void *userdata) {
         return 0;
 }
 
+static int async_polkit_read_temporary(sd_bus_message *reply) {
+        const char *k, *v;
+        bool temporary = false;
+        int r;
+
+        assert(reply);
+
+        /* Checks whether the authorization was granted because of a temporary authorization, i.e. one the
+         * user acquired by authenticating earlier on. Those may be revoked at any time. */
+
+        r = sd_bus_message_enter_container(reply, 'a', "{ss}");
+        if (r < 0)
+                return r;
+
+        while ((r = sd_bus_message_read(reply, "{ss}", &k, &v)) > 0)
+                if (streq(k, "polkit.temporary_authorization_id"))
+                        temporary = true;
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_exit_container(reply);
+        if (r < 0)
+                return r;
+
+        return temporary;
+}
+
 static int async_polkit_read_reply(sd_bus_message *reply, AsyncPolkitQuery *q) {
         _cleanup_(async_polkit_query_action_freep) AsyncPolkitQueryAction *a = NULL;
         int authorized, challenge, r;
@@ -312,6 +526,20 @@ static int async_polkit_read_reply(sd_bus_message *reply, AsyncPolkitQuery *q) {
 
         if (authorized) {
                 log_debug("Polkit authorization for action '%s' succeeded.", a->action);
+
+                /* Remember authorizations polkit granted without asking, unless they are based on a
+                 * temporary authorization, so that we don't have to ask again for each call. */
+                if (q->request && !a->interactive) {
+                        r = async_polkit_read_temporary(reply);
+                        if (r < 0)
+                                log_debug_errno(r, "Failed to parse polkit authorization details, not caching: %m");
+                        else if (r == 0) {
+                                r = polkit_cache_add(q->bus, sd_bus_message_get_sender(q->request), a->action, (const char**) a->details);
+                                if (r < 0)
+                                        log_debug_errno(r, "Failed to cache polkit authorization, ignoring: %m");
+                        }
+                }
+
                 LIST_PREPEND(authorized, q->authorized_actions, TAKE_PTR(a));
         } else if (challenge) {
                 log_debug("Polkit authorization for action requires '%s' interactive authentication, which we didn't allow.", a->action);
@@ -576,6 +804,11 @@ int bus_verify_polkit_async_full(
         if (c > 0)
                 interactive = true;
 
+        if (polkit_cache_lookup(call, action, details)) {
+                log_debug("Found cached polkit authorization for '%s'.", action);
+                return 1;
+        }
+
         _cleanup_(sd_bus_message_unrefp) sd_bus_message *pk = NULL;
         r = bus_message_new_polkit_auth_call_for_bus(call, action, details, interactive, &pk);
         if (r < 0)
@@ -601,6 +834,7 @@ int bus_verify_polkit_async_full(
         *q->action = (AsyncPolkitQueryAction) {
                 .action = strdup(action),
                 .details = strv_copy((char**) details),
+                .interactive = interactive,
         };
         if (!q->action->action || !q->action->details)
                 return -ENOMEM;
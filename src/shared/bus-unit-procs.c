@@ -1,5 +1,6 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
+#include "bus-error.h"
 #include "bus-locator.h"
 #include "bus-unit-procs.h"
 #include "glyph-util.h"
@@ -12,6 +13,10 @@
 #include "string-util.h"
 #include "terminal-util.h"
 
+/* Unless all processes are asked for, show at most this many. Units with many more, e.g. build servers,
+ * would otherwise take long to show, and it's unlikely anyone can make sense of so many anyway. */
+#define PROCESSES_MAX 1024U
+
 struct CGroupInfo {
         char *cgroup_path;
         bool is_const; /* If false, cgroup_path should be free()'d */
@@ -330,7 +335,10 @@ int unit_show_processes(
                 OutputFlags flags,
                 sd_bus_error *error) {
 
+        _cleanup_(sd_bus_error_free) sd_bus_error e = SD_BUS_ERROR_NULL;
         _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        uint64_t n_processes = 0, n_listed = 0;
+        bool with_count = true;
         Hashmap *cgroups = NULL;
         struct CGroupInfo *cg;
         int r;
@@ -348,13 +356,30 @@ int unit_show_processes(
         r = bus_call_method(
                         bus,
                         bus_systemd_mgr,
-                        "GetUnitProcesses",
-                        error,
+                        "GetUnitProcessesWithLimit",
+                        &e,
                         &reply,
-                        "s",
-                        unit);
-        if (r < 0)
+                        "st",
+                        unit,
+                        FLAGS_SET(flags, OUTPUT_SHOW_ALL) ? UINT64_MAX : (uint64_t) PROCESSES_MAX);
+        if (r < 0 && sd_bus_error_has_name(&e, SD_BUS_ERROR_UNKNOWN_METHOD)) {
+                /* Fallback for older systemd versions where the call is not yet available */
+                sd_bus_error_free(&e);
+                with_count = false;
+
+                r = bus_call_method(
+                                bus,
+                                bus_systemd_mgr,
+                                "GetUnitProcesses",
+                                &e,
+                                &reply,
+                                "s",
+                                unit);
+        }
+        if (r < 0) {
+                (void) sd_bus_error_move(error, &e);
                 return r;
+        }
 
         cgroups = hashmap_new(&path_hash_ops);
         if (!cgroups)
@@ -374,6 +399,8 @@ int unit_show_processes(
                 if (r == 0)
                         break;
 
+                n_listed++;
+
                 r = add_process(cgroups, path, pid, name);
                 if (r == -ENOMEM)
                         goto finish;
@@ -386,11 +413,27 @@ int unit_show_processes(
         if (r < 0)
                 goto finish;
 
+        if (with_count) {
+                r = sd_bus_message_read(reply, "t", &n_processes);
+                if (r < 0)
+                        goto finish;
+        }
+
         r = dump_processes(cgroups, cgroup_path, prefix, n_columns, flags);
         if (r < 0)
                 goto finish;
 
         r = dump_extra_processes(cgroups, prefix, n_columns, flags);
+        if (r < 0)
+                goto finish;
+
+        if (n_processes > n_listed)
+                fprintf(stdout, "%s%s%s %" PRIu64 " more processes not shown%s\n",
+                        prefix,
+                        ansi_grey(),
+                        special_glyph(SPECIAL_GLYPH_ELLIPSIS),
+                        n_processes - n_listed,
+                        ansi_normal());
 
 finish:
         while ((cg = hashmap_first(cgroups)))
@@ -1073,6 +1073,7 @@ static int bus_append_execute_property(sd_bus_message *m, const char *field, con
                               "ProtectKernelTunables",
                               "ProtectKernelModules",
                               "ProtectKernelLogs",
+                              "ReuseMountNamespace",
                               "ProtectClock",
                               "ProtectControlGroups",
                               "MountAPIVFS",
@@ -2520,6 +2521,24 @@ static int bus_append_socket_property(sd_bus_message *m, const char *field, cons
         if (streq(field, "SocketProtocol"))
                 return bus_append_parse_ip_protocol(m, field, eq);
 
+        if (streq(field, "ReusePortShards")) {
+                uint32_t n;
+
+                if (streq(eq, "cpus"))
+                        n = UINT32_MAX;
+                else {
+                        r = safe_atou32(eq, &n);
+                        if (r < 0)
+                                return log_error_errno(r, "Failed to parse %s=%s: %m", field, eq);
+                }
+
+                r = sd_bus_message_append(m, "(sv)", field, "u", n);
+                if (r < 0)
+                        return bus_log_create_error(r);
+
+                return 1;
+        }
+
         if (STR_IN_SET(field, "ListenStream",
                               "ListenDatagram",
                               "ListenSequentialPacket",
@@ -25,10 +25,12 @@
 #include "env-util.h"
 #include "fd-util.h"
 #include "format-util.h"
+#include "mempool.h"
 #include "memstream-util.h"
 #include "path-util.h"
 #include "socket-util.h"
 #include "stdio-util.h"
+#include "string-intern.h"
 #include "uid-classification.h"
 
 static int name_owner_change_callback(sd_bus_message *m, void *userdata, sd_bus_error *ret_error) {
@@ -242,6 +244,10 @@ int bus_connect_system_systemd(sd_bus **ret_bus) {
         if (r < 0)
                 return r;
 
+        r = sd_bus_negotiate_memfd(bus, true);
+        if (r < 0)
+                return r;
+
         r = sd_bus_start(bus);
         if (r < 0)
                 return sd_bus_default_system(ret_bus);
@@ -278,6 +284,10 @@ int bus_connect_user_systemd(sd_bus **ret_bus) {
         if (!bus->address)
                 return -ENOMEM;
 
+        r = sd_bus_negotiate_memfd(bus, true);
+        if (r < 0)
+                return r;
+
         r = sd_bus_start(bus);
         if (r < 0)
                 return sd_bus_default_user(ret_bus);
@@ -771,7 +781,7 @@ static int method_dump_memory_state_by_fd(sd_bus_message *message, void *userdat
         _cleanup_(memstream_done) MemStream m = {};
         _cleanup_free_ char *dump = NULL;
         _cleanup_close_ int fd = -EBADF;
-        size_t dump_size;
+        size_t dump_size, n_strings, n_refs, bytes_saved;
         FILE *f;
         int r;
 
@@ -785,6 +795,16 @@ static int method_dump_memory_state_by_fd(sd_bus_message *message, void *userdat
         if (r < 0)
                 return r;
 
+        /* Also report how much memory string interning saved, if the process makes use of it. As XML
+         * comment, so that the dump still is a single well-formed malloc_info() document. */
+        string_intern_stats(&n_strings, &n_refs, &bytes_saved);
+        if (n_strings > 0)
+                fprintf(f, "<!-- string-intern strings=\"%zu\" references=\"%zu\" bytes-saved=\"%zu\" -->\n",
+                        n_strings, n_refs, bytes_saved);
+
+        /* Same for our own memory pools, which malloc_info() only sees as opaque allocations. */
+        mempool_dump_stats(f);
+
         r = memstream_finalize(&m, &dump, &dump_size);
         if (r < 0)
                 return r;
@@ -1214,19 +1214,73 @@ static int tm_within_bounds(struct tm *tm, bool utc) {
         return cmp == 0;
 }
 
-static bool matches_weekday(int weekdays_bits, const struct tm *tm, bool utc) {
-        struct tm t;
-        int k;
+static int tm_weekday(const struct tm *tm) {
+        static const int offsets[12] = { 0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4 };
+        int y, k;
+
+        assert(tm);
+        assert(tm->tm_mon >= 0 && tm->tm_mon < 12);
+
+        /* Calculates the day of the week of the (normalized) date in tm, with Monday being 0, purely
+         * arithmetically. The weekday of a calendar date doesn't depend on the timezone, hence there's no
+         * need to go through mktime() for this. */
+
+        y = tm->tm_year + 1900 - (tm->tm_mon < 2);
+        k = (y + y/4 - y/100 + y/400 + offsets[tm->tm_mon] + tm->tm_mday) % 7; /* 0 is Sunday */
+
+        return k == 0 ? 6 : k - 1;
+}
+
+static int tm_days_in_month(const struct tm *tm) {
+        static const int days[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+        int y;
 
+        assert(tm);
+        assert(tm->tm_mon >= 0 && tm->tm_mon < 12);
+
+        y = tm->tm_year + 1900;
+        if (tm->tm_mon == 1 && ((y % 4 == 0 && y % 100 != 0) || y % 400 == 0))
+                return 29;
+
+        return days[tm->tm_mon];
+}
+
+static bool matches_weekday(int weekdays_bits, const struct tm *tm) {
         if (weekdays_bits < 0 || weekdays_bits >= BITS_WEEKDAYS)
                 return true;
 
-        t = *tm;
-        if (mktime_or_timegm(&t, utc) < 0)
-                return false;
+        return weekdays_bits & (1 << tm_weekday(tm));
+}
+
+static int find_matching_weekday(const CalendarSpec *spec, struct tm *tm) {
+        int n;
+
+        assert(spec);
+        assert(tm);
+
+        /* Finds the next day in the month of tm after tm->tm_mday that matches both the day and the weekday
+         * components. This allows us to skip directly to it, instead of going through the whole find_next()
+         * loop once for each day that doesn't match. If there's no such day in this month, returns
+         * -ENOENT. */
+
+        n = tm_days_in_month(tm);
+
+        for (int d = tm->tm_mday + 1; d <= n; d++) {
+                struct tm t = *tm;
+                int r;
 
-        k = t.tm_wday == 0 ? 6 : t.tm_wday - 1;
-        return (weekdays_bits & (1 << k));
+                r = find_matching_component(spec, spec->day, &t, &d);
+                if (r < 0 || d > n)
+                        return -ENOENT;
+
+                t.tm_mday = d;
+                if (matches_weekday(spec->weekdays_bits, &t)) {
+                        tm->tm_mday = d;
+                        return 0;
+                }
+        }
+
+        return -ENOENT;
 }
 
 /* A safety valve: if we get stuck in the calculation, return an error.
@@ -1295,8 +1349,11 @@ static int find_next(const CalendarSpec *spec, struct tm *tm, usec_t *usec) {
                 if (r == 0)
                         continue;
 
-                if (!matches_weekday(spec->weekdays_bits, &c, spec->utc)) {
-                        c.tm_mday++;
+                if (!matches_weekday(spec->weekdays_bits, &c)) {
+                        if (find_matching_weekday(spec, &c) < 0) {
+                                c.tm_mon++;
+                                c.tm_mday = 1;
+                        }
                         c.tm_hour = c.tm_min = c.tm_sec = tm_usec = 0;
                         continue;
                 }
@@ -26,6 +26,7 @@
 #include "in-addr-util.h"
 #include "log.h"
 #include "macro.h"
+#include "memory-util.h"
 #include "missing_network.h"
 #include "nulstr-util.h"
 #include "parse-helpers.h"
@@ -170,165 +171,165 @@ static int next_assignment(
         return 0;
 }
 
-/* Parse a single logical line */
-static int parse_line(
-                const char *unit,
-                const char *filename,
+/* A configuration file split into its logical lines, with section headers and assignments already
+ * tokenized. This is independent of the unit, the section list, the lookup table and the flags the file is
+ * parsed with, hence may be cached and replayed as long as the file doesn't change. All strings are kept in
+ * a single buffer, and referenced by their offset into it. */
+typedef enum ConfigLineType {
+        CONFIG_LINE_SECTION,            /* key: section name */
+        CONFIG_LINE_ASSIGNMENT,         /* key: lvalue, value: rvalue */
+        CONFIG_LINE_INVALID_UTF8,       /* value: the line */
+        CONFIG_LINE_INVALID_SECTION,    /* value: the line */
+        CONFIG_LINE_UNSAFE_SECTION,     /* value: the line */
+        CONFIG_LINE_MISSING_EQUAL,
+        CONFIG_LINE_MISSING_KEY,
+} ConfigLineType;
+
+typedef struct ConfigLine {
+        unsigned line;
+        ConfigLineType type;
+        size_t key;
+        size_t value;
+} ConfigLine;
+
+typedef struct ConfigFile {
+        char *path;
+        struct stat st;
+        bool used;              /* parsed since the last config_parse_cache_trim() */
+
+        ConfigLine *lines;
+        size_t n_lines;
+
+        char *strings;
+        size_t n_strings;
+} ConfigFile;
+
+static ConfigFile* config_file_free(ConfigFile *f) {
+        if (!f)
+                return NULL;
+
+        free(f->path);
+        free(f->lines);
+        free(f->strings);
+        return mfree(f);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(ConfigFile*, config_file_free);
+
+DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(config_parse_cache_hash_ops,
+                                              char, path_hash_func, path_compare,
+                                              ConfigFile, config_file_free);
+
+static int config_file_add_string(ConfigFile *f, const char *s, size_t n, size_t *ret) {
+        assert(f);
+        assert(s || n == 0);
+        assert(ret);
+
+        if (!GREEDY_REALLOC(f->strings, f->n_strings + n + 1))
+                return -ENOMEM;
+
+        memcpy_safe(f->strings + f->n_strings, s, n);
+        f->strings[f->n_strings + n] = 0;
+        *ret = f->n_strings;
+        f->n_strings += n + 1;
+        return 0;
+}
+
+static int config_file_add_line(
+                ConfigFile *f,
                 unsigned line,
-                const char *sections,
-                ConfigItemLookup lookup,
-                const void *table,
-                ConfigParseFlags flags,
-                char **section,
-                unsigned *section_line,
-                bool *section_ignored,
-                char *l, /* is modified */
-                void *userdata) {
+                ConfigLineType type,
+                const char *key,
+                size_t key_len,
+                const char *value) {
+
+        ConfigLine l = {
+                .line = line,
+                .type = type,
+        };
+        int r;
+
+        assert(f);
+
+        if (key) {
+                r = config_file_add_string(f, key, key_len, &l.key);
+                if (r < 0)
+                        return r;
+        }
+
+        if (value) {
+                r = config_file_add_string(f, value, strlen(value), &l.value);
+                if (r < 0)
+                        return r;
+        }
+
+        if (!GREEDY_REALLOC(f->lines, f->n_lines + 1))
+                return -ENOMEM;
 
+        f->lines[f->n_lines++] = l;
+        return 0;
+}
+
+/* Tokenize a single logical line */
+static int config_file_tokenize_line(ConfigFile *f, unsigned line, char *l /* is modified */) {
         char *e;
 
-        assert(filename);
+        assert(f);
         assert(line > 0);
-        assert(lookup);
         assert(l);
 
         l = strstrip(l);
         if (isempty(l))
                 return 0;
 
-        if (l[0] == '\n')
-                return 0;
-
         if (!utf8_is_valid(l))
-                return log_syntax_invalid_utf8(unit, LOG_WARNING, filename, line, l);
+                return config_file_add_line(f, line, CONFIG_LINE_INVALID_UTF8, NULL, 0, l);
 
         if (l[0] == '[') {
-                _cleanup_free_ char *n = NULL;
+                ConfigLineType type;
                 size_t k;
 
                 k = strlen(l);
                 assert(k > 0);
 
                 if (l[k-1] != ']')
-                        return log_syntax(unit, LOG_ERR, filename, line, SYNTHETIC_ERRNO(EBADMSG), "Invalid section header '%s'", l);
-
-                n = strndup(l+1, k-2);
-                if (!n)
-                        return log_oom();
-
-                if (!string_is_safe(n))
-                        return log_syntax(unit, LOG_ERR, filename, line, SYNTHETIC_ERRNO(EBADMSG), "Bad characters in section header '%s'", l);
-
-                if (sections && !nulstr_contains(sections, n)) {
-                        bool ignore;
-
-                        ignore = (flags & CONFIG_PARSE_RELAXED) || startswith(n, "X-");
-
-                        if (!ignore)
-                                NULSTR_FOREACH(t, sections)
-                                        if (streq_ptr(n, startswith(t, "-"))) { /* Ignore sections prefixed with "-" in valid section list */
-                                                ignore = true;
-                                                break;
-                                        }
+                        return config_file_add_line(f, line, CONFIG_LINE_INVALID_SECTION, NULL, 0, l);
 
-                        if (!ignore)
-                                log_syntax(unit, LOG_WARNING, filename, line, 0, "Unknown section '%s'. Ignoring.", n);
-
-                        *section = mfree(*section);
-                        *section_line = 0;
-                        *section_ignored = true;
-                } else {
-                        free_and_replace(*section, n);
-                        *section_line = line;
-                        *section_ignored = false;
-                }
+                l[k-1] = 0;
+                type = string_is_safe(l+1) ? CONFIG_LINE_SECTION : CONFIG_LINE_UNSAFE_SECTION;
+                l[k-1] = ']';
 
-                return 0;
-        }
-
-        if (sections && !*section) {
-                if (!(flags & CONFIG_PARSE_RELAXED) && !*section_ignored)
-                        log_syntax(unit, LOG_WARNING, filename, line, 0, "Assignment outside of section. Ignoring.");
-
-                return 0;
+                return config_file_add_line(f, line, type, l+1, k-2, l);
         }
 
         e = strchr(l, '=');
         if (!e)
-                return log_syntax(unit, LOG_WARNING, filename, line, 0,
-                                  "Missing '=', ignoring line.");
+                return config_file_add_line(f, line, CONFIG_LINE_MISSING_EQUAL, NULL, 0, NULL);
         if (e == l)
-                return log_syntax(unit, LOG_WARNING, filename, line, 0,
-                                  "Missing key name before '=', ignoring line.");
+                return config_file_add_line(f, line, CONFIG_LINE_MISSING_KEY, NULL, 0, NULL);
 
         *e = 0;
         e++;
 
-        return next_assignment(unit,
-                               filename,
-                               line,
-                               lookup,
-                               table,
-                               *section,
-                               *section_line,
-                               strstrip(l),
-                               strstrip(e),
-                               flags,
-                               userdata);
+        l = strstrip(l);
+        return config_file_add_line(f, line, CONFIG_LINE_ASSIGNMENT, l, strlen(l), strstrip(e));
 }
 
-/* Go through the file and parse each line */
-int config_parse(
-                const char *unit,
-                const char *filename,
-                FILE *f,
-                const char *sections,
-                ConfigItemLookup lookup,
-                const void *table,
-                ConfigParseFlags flags,
-                void *userdata,
-                struct stat *ret_stat) {
-
-        _cleanup_free_ char *section = NULL, *continuation = NULL;
-        _cleanup_fclose_ FILE *ours = NULL;
-        unsigned line = 0, section_line = 0;
-        bool section_ignored = false, bom_seen = false;
-        struct stat st;
-        int r, fd;
+/* Go through the file and tokenize each line */
+static int config_file_read(const char *filename, FILE *f, ConfigParseFlags flags, ConfigFile **ret) {
+        _cleanup_(config_file_freep) ConfigFile *cf = NULL;
+        _cleanup_free_ char *continuation = NULL;
+        unsigned line = 0;
+        bool bom_seen = false;
+        int r;
 
         assert(filename);
-        assert(lookup);
-
-        if (!f) {
-                f = ours = fopen(filename, "re");
-                if (!f) {
-                        /* Only log on request, except for ENOENT,
-                         * since we return 0 to the caller. */
-                        if ((flags & CONFIG_PARSE_WARN) || errno == ENOENT)
-                                log_full_errno(errno == ENOENT ? LOG_DEBUG : LOG_ERR, errno,
-                                               "Failed to open configuration file '%s': %m", filename);
-
-                        if (errno == ENOENT) {
-                                if (ret_stat)
-                                        *ret_stat = (struct stat) {};
-
-                                return 0;
-                        }
-
-                        return -errno;
-                }
-        }
-
-        fd = fileno(f);
-        if (fd >= 0) { /* stream might not have an fd, let's be careful hence */
-
-                if (fstat(fd, &st) < 0)
-                        return log_full_errno(FLAGS_SET(flags, CONFIG_PARSE_WARN) ? LOG_ERR : LOG_DEBUG, errno,
-                                              "Failed to fstat(%s): %m", filename);
+        assert(f);
+        assert(ret);
 
-                (void) stat_warn_permissions(filename, &st);
-        } else
-                st = (struct stat) {};
+        cf = new0(ConfigFile, 1);
+        if (!cf)
+                return -ENOMEM;
 
         for (;;) {
                 _cleanup_free_ char *buf = NULL;
@@ -407,21 +408,10 @@ int config_parse(
                         continue;
                 }
 
-                r = parse_line(unit,
-                               filename,
-                               line,
-                               sections,
-                               lookup,
-                               table,
-                               flags,
-                               &section,
-                               &section_line,
-                               &section_ignored,
-                               p,
-                               userdata);
+                r = config_file_tokenize_line(cf, line, p);
                 if (r < 0) {
                         if (flags & CONFIG_PARSE_WARN)
-                                log_warning_errno(r, "%s:%u: Failed to parse file: %m", filename, line);
+                                log_oom();
                         return r;
                 }
 
@@ -429,9 +419,145 @@ int config_parse(
         }
 
         if (continuation) {
+                r = config_file_tokenize_line(cf, ++line, continuation);
+                if (r < 0) {
+                        if (flags & CONFIG_PARSE_WARN)
+                                log_oom();
+                        return r;
+                }
+        }
+
+        *ret = TAKE_PTR(cf);
+        return 0;
+}
+
+/* Parse a single tokenized line */
+static int parse_line(
+                const char *unit,
+                const char *filename,
+                const ConfigFile *cf,
+                const ConfigLine *l,
+                const char *sections,
+                ConfigItemLookup lookup,
+                const void *table,
+                ConfigParseFlags flags,
+                const char **section,
+                unsigned *section_line,
+                bool *section_ignored,
+                void *userdata) {
+
+        const char *key = NULL, *value = NULL;
+
+        assert(filename);
+        assert(cf);
+        assert(l);
+        assert(lookup);
+
+        if (IN_SET(l->type, CONFIG_LINE_SECTION, CONFIG_LINE_ASSIGNMENT))
+                key = cf->strings + l->key;
+        if (!IN_SET(l->type, CONFIG_LINE_MISSING_EQUAL, CONFIG_LINE_MISSING_KEY))
+                value = cf->strings + l->value;
+
+        switch (l->type) {
+
+        case CONFIG_LINE_INVALID_UTF8:
+                return log_syntax_invalid_utf8(unit, LOG_WARNING, filename, l->line, value);
+
+        case CONFIG_LINE_INVALID_SECTION:
+                return log_syntax(unit, LOG_ERR, filename, l->line, SYNTHETIC_ERRNO(EBADMSG), "Invalid section header '%s'", value);
+
+        case CONFIG_LINE_UNSAFE_SECTION:
+                return log_syntax(unit, LOG_ERR, filename, l->line, SYNTHETIC_ERRNO(EBADMSG), "Bad characters in section header '%s'", value);
+
+        case CONFIG_LINE_SECTION:
+                if (sections && !nulstr_contains(sections, key)) {
+                        bool ignore;
+
+                        ignore = (flags & CONFIG_PARSE_RELAXED) || startswith(key, "X-");
+
+                        if (!ignore)
+                                NULSTR_FOREACH(t, sections)
+                                        if (streq_ptr(key, startswith(t, "-"))) { /* Ignore sections prefixed with "-" in valid section list */
+                                                ignore = true;
+                                                break;
+                                        }
+
+                        if (!ignore)
+                                log_syntax(unit, LOG_WARNING, filename, l->line, 0, "Unknown section '%s'. Ignoring.", key);
+
+                        *section = NULL;
+                        *section_line = 0;
+                        *section_ignored = true;
+                } else {
+                        *section = key;
+                        *section_line = l->line;
+                        *section_ignored = false;
+                }
+
+                return 0;
+
+        default:
+                break;
+        }
+
+        if (sections && !*section) {
+                if (!(flags & CONFIG_PARSE_RELAXED) && !*section_ignored)
+                        log_syntax(unit, LOG_WARNING, filename, l->line, 0, "Assignment outside of section. Ignoring.");
+
+                return 0;
+        }
+
+        switch (l->type) {
+
+        case CONFIG_LINE_MISSING_EQUAL:
+                return log_syntax(unit, LOG_WARNING, filename, l->line, 0,
+                                  "Missing '=', ignoring line.");
+
+        case CONFIG_LINE_MISSING_KEY:
+                return log_syntax(unit, LOG_WARNING, filename, l->line, 0,
+                                  "Missing key name before '=', ignoring line.");
+
+        case CONFIG_LINE_ASSIGNMENT:
+                return next_assignment(unit,
+                                       filename,
+                                       l->line,
+                                       lookup,
+                                       table,
+                                       *section,
+                                       *section_line,
+                                       key,
+                                       value,
+                                       flags,
+                                       userdata);
+
+        default:
+                assert_not_reached();
+        }
+}
+
+static int config_file_parse(
+                const char *unit,
+                const char *filename,
+                const ConfigFile *cf,
+                const char *sections,
+                ConfigItemLookup lookup,
+                const void *table,
+                ConfigParseFlags flags,
+                void *userdata) {
+
+        const char *section = NULL;
+        unsigned section_line = 0;
+        bool section_ignored = false;
+        int r;
+
+        assert(filename);
+        assert(cf);
+
+        FOREACH_ARRAY(l, cf->lines, cf->n_lines) {
                 r = parse_line(unit,
                                filename,
-                               ++line,
+                               cf,
+                               l,
                                sections,
                                lookup,
                                table,
@@ -439,15 +565,147 @@ int config_parse(
                                &section,
                                &section_line,
                                &section_ignored,
-                               continuation,
                                userdata);
                 if (r < 0) {
                         if (flags & CONFIG_PARSE_WARN)
-                                log_warning_errno(r, "%s:%u: Failed to parse file: %m", filename, line);
+                                log_warning_errno(r, "%s:%u: Failed to parse file: %m", filename, l->line);
                         return r;
                 }
         }
 
+        return 0;
+}
+
+static int config_parse_cache_put(Hashmap **cache, const char *filename, ConfigFile *cf) {
+        int r;
+
+        assert(cache);
+        assert(filename);
+        assert(cf);
+        assert(!cf->path);
+
+        cf->path = strdup(filename);
+        if (!cf->path)
+                return -ENOMEM;
+
+        /* Shrink the buffers to what is actually used, the file might be kept around for a while */
+        if (cf->n_lines > 0) {
+                ConfigLine *lines = realloc(cf->lines, cf->n_lines * sizeof(ConfigLine));
+                if (lines)
+                        cf->lines = lines;
+        }
+        if (cf->n_strings > 0) {
+                char *strings = realloc(cf->strings, cf->n_strings);
+                if (strings)
+                        cf->strings = strings;
+        }
+
+        config_file_free(hashmap_remove(*cache, filename));
+
+        r = hashmap_ensure_put(cache, &config_parse_cache_hash_ops, cf->path, cf);
+        if (r < 0) {
+                cf->path = mfree(cf->path);
+                return r;
+        }
+
+        return 0;
+}
+
+void config_parse_cache_trim(Hashmap *cache) {
+        ConfigFile *cf;
+
+        HASHMAP_FOREACH(cf, cache) {
+                if (!cf->used)
+                        config_file_free(hashmap_remove(cache, cf->path));
+                else
+                        cf->used = false;
+        }
+}
+
+int config_parse_full(
+                const char *unit,
+                const char *filename,
+                FILE *f,
+                const char *sections,
+                ConfigItemLookup lookup,
+                const void *table,
+                ConfigParseFlags flags,
+                void *userdata,
+                struct stat *ret_stat,
+                Hashmap **cache) {
+
+        _cleanup_(config_file_freep) ConfigFile *ours_cf = NULL;
+        _cleanup_fclose_ FILE *ours = NULL;
+        ConfigFile *cf = NULL;
+        struct stat st;
+        int r, fd;
+
+        assert(filename);
+        assert(lookup);
+
+        if (!f) {
+                f = ours = fopen(filename, "re");
+                if (!f) {
+                        /* Only log on request, except for ENOENT,
+                         * since we return 0 to the caller. */
+                        if ((flags & CONFIG_PARSE_WARN) || errno == ENOENT)
+                                log_full_errno(errno == ENOENT ? LOG_DEBUG : LOG_ERR, errno,
+                                               "Failed to open configuration file '%s': %m", filename);
+
+                        if (errno == ENOENT) {
+                                if (ret_stat)
+                                        *ret_stat = (struct stat) {};
+
+                                return 0;
+                        }
+
+                        return -errno;
+                }
+        }
+
+        fd = fileno(f);
+        if (fd >= 0) { /* stream might not have an fd, let's be careful hence */
+
+                if (fstat(fd, &st) < 0)
+                        return log_full_errno(FLAGS_SET(flags, CONFIG_PARSE_WARN) ? LOG_ERR : LOG_DEBUG, errno,
+                                              "Failed to fstat(%s): %m", filename);
+
+                (void) stat_warn_permissions(filename, &st);
+        } else
+                st = (struct stat) {};
+
+        /* Only regular files may be cached, we can't tell whether anything else changed. Note that the
+         * stream isn't read from at all if we find the file in the cache. */
+        if (cache && fd >= 0 && S_ISREG(st.st_mode)) {
+                cf = hashmap_get(*cache, filename);
+                if (cf && !stat_inode_unmodified(&cf->st, &st))
+                        cf = NULL;
+        }
+
+        if (!cf) {
+                r = config_file_read(filename, f, flags, &ours_cf);
+                if (r < 0)
+                        return r;
+
+                cf = ours_cf;
+
+                if (cache && fd >= 0 && S_ISREG(st.st_mode)) {
+                        cf->st = st;
+
+                        r = config_parse_cache_put(cache, filename, cf);
+                        if (r < 0)
+                                log_debug_errno(r, "Failed to cache parsed configuration file '%s', ignoring: %m", filename);
+                        else
+                                TAKE_PTR(ours_cf);
+                }
+        }
+
+        cf->used = true;
+
+        r = config_file_parse(unit, filename, cf, sections, lookup, table, flags, userdata);
+        if (r < 0)
+                return r;
+
         if (ret_stat)
                 *ret_stat = st;
 
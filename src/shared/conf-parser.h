@@ -82,7 +82,10 @@ int config_item_table_lookup(const void *table, const char *section, const char
  * ConfigPerfItem tables */
 int config_item_perf_lookup(const void *table, const char *section, const char *lvalue, ConfigParserCallback *ret_func, int *ret_ltype, void **ret_data, void *userdata);
 
-int config_parse(
+/* If a cache is specified, the tokenized contents of regular files are stored in it, keyed by path, and reused
+ * instead of reading the file again as long as its inode, mtime and size stay the same. Free it with
+ * hashmap_free(). */
+int config_parse_full(
                 const char *unit,
                 const char *filename,
                 FILE *f,
@@ -91,7 +94,24 @@ int config_parse(
                 const void *table,
                 ConfigParseFlags flags,
                 void *userdata,
-                struct stat *ret_stat);     /* possibly NULL */
+                struct stat *ret_stat,      /* possibly NULL */
+                Hashmap **cache);           /* possibly NULL */
+
+static inline int config_parse(
+                const char *unit,
+                const char *filename,
+                FILE *f,
+                const char *sections,       /* nulstr */
+                ConfigItemLookup lookup,
+                const void *table,
+                ConfigParseFlags flags,
+                void *userdata,
+                struct stat *ret_stat) {    /* possibly NULL */
+        return config_parse_full(unit, filename, f, sections, lookup, table, flags, userdata, ret_stat, /* cache= */ NULL);
+}
+
+/* Drops all files from the cache that were not parsed since the previous call */
+void config_parse_cache_trim(Hashmap *cache);
 
 int config_parse_many(
                 const char* const* conf_files,  /* possibly empty */
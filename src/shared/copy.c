@@ -12,6 +12,8 @@
 #include <sys/xattr.h>
 #include <unistd.h>
 
+#include "sd-event.h"
+
 #include "alloc-util.h"
 #include "btrfs-util.h"
 #include "chattr-util.h"
@@ -35,6 +37,7 @@
 #include "string-util.h"
 #include "strv.h"
 #include "sync-util.h"
+#include "thread-pool.h"
 #include "time-util.h"
 #include "tmpfile-util.h"
 #include "umask-util.h"
@@ -53,6 +56,12 @@
  * case of bind mount cycles and suchlike. */
 #define COPY_DEPTH_MAX 2048U
 
+/* With COPY_PARALLEL, copy the contents of this many regular files concurrently. Copying trees is bound by I/O
+ * latency rather than CPU, hence this isn't derived from the number of CPUs. Each file queued for copying
+ * holds three fds, hence bound the queue, too, so that we stay well below the default RLIMIT_NOFILE. */
+#define COPY_PARALLEL_THREADS 16U
+#define COPY_PARALLEL_QUEUE_SIZE (2U*COPY_PARALLEL_THREADS)
+
 static ssize_t try_copy_file_range(
                 int fd_in, loff_t *off_in,
                 int fd_out, loff_t *off_out,
@@ -765,6 +774,35 @@ static int memorize_hardlink(
         return 1;
 }
 
+/* Encapsulates the worker threads regular files are copied in with COPY_PARALLEL. The tree itself is still
+ * walked in the calling thread, which creates all inodes, so that directories are always created before their
+ * children, and the hardlink context and the denylist are only ever accessed from there. The workers only copy
+ * the contents and metadata of the regular files created that way. */
+typedef struct CopyParallel {
+        sd_event *event;
+        ThreadPool *pool;
+
+        /* Only updated in the calling thread, from the completion callbacks */
+        int error;
+        copy_progress_bytes_t progress;
+        void *userdata;
+} CopyParallel;
+
+typedef struct CopyParallelFile {
+        CopyParallel *parallel;
+
+        int fdf;
+        int fdt;
+        int dt;
+        char *to;
+        struct stat st;
+        uid_t override_uid;
+        gid_t override_gid;
+        CopyFlags copy_flags;
+
+        uint64_t n_bytes;
+} CopyParallelFile;
+
 static int fd_copy_tree_generic(
                 int df,
                 const char *from,
@@ -779,14 +817,15 @@ static int fd_copy_tree_generic(
                 Hashmap *denylist,
                 Set *subvolumes,
                 HardlinkContext *hardlink_context,
+                CopyParallel *parallel,
                 const char *display_path,
                 copy_progress_path_t progress_path,
                 copy_progress_bytes_t progress_bytes,
                 void *userdata);
 
-static int fd_copy_regular(
-                int df,
-                const char *from,
+static int fd_copy_regular_contents(
+                int fdf,
+                int *fdt,
                 const struct stat *st,
                 int dt,
                 const char *to,
@@ -797,47 +836,31 @@ static int fd_copy_regular(
                 copy_progress_bytes_t progress,
                 void *userdata) {
 
-        _cleanup_close_ int fdf = -EBADF, fdt = -EBADF;
         int r, q;
 
+        assert(fdf >= 0);
+        assert(fdt);
+        assert(*fdt >= 0);
         assert(st);
         assert(to);
 
-        r = try_hardlink(hardlink_context, st, dt, to);
-        if (r < 0)
-                return r;
-        if (r > 0) /* worked! */
-                return 0;
-
-        fdf = xopenat(df, from, O_RDONLY|O_CLOEXEC|O_NOCTTY|O_NOFOLLOW);
-        if (fdf < 0)
-                return fdf;
-
-        if (copy_flags & COPY_MAC_CREATE) {
-                r = mac_selinux_create_file_prepare_at(dt, to, S_IFREG);
-                if (r < 0)
-                        return r;
-        }
-        fdt = openat(dt, to, O_WRONLY|O_CREAT|O_EXCL|O_CLOEXEC|O_NOCTTY|O_NOFOLLOW, st->st_mode & 07777);
-        if (copy_flags & COPY_MAC_CREATE)
-                mac_selinux_create_file_clear();
-        if (fdt < 0)
-                return -errno;
+        /* Copies the contents and metadata of a regular file to a new file <to> in <dt>, which is open as
+         * *fdt. The latter is closed on success, and the file removed again on failure. */
 
-        r = copy_bytes_full(fdf, fdt, UINT64_MAX, copy_flags, NULL, NULL, progress, userdata);
+        r = copy_bytes_full(fdf, *fdt, UINT64_MAX, copy_flags, NULL, NULL, progress, userdata);
         if (r < 0)
                 goto fail;
 
-        if (fchown(fdt,
+        if (fchown(*fdt,
                    uid_is_valid(override_uid) ? override_uid : st->st_uid,
                    gid_is_valid(override_gid) ? override_gid : st->st_gid) < 0)
                 r = -errno;
 
-        if (fchmod(fdt, st->st_mode & 07777) < 0)
+        if (fchmod(*fdt, st->st_mode & 07777) < 0)
                 r = -errno;
 
-        (void) futimens(fdt, (struct timespec[]) { st->st_atim, st->st_mtim });
-        (void) copy_xattr(fdf, NULL, fdt, NULL, copy_flags);
+        (void) futimens(*fdt, (struct timespec[]) { st->st_atim, st->st_mtim });
+        (void) copy_xattr(fdf, NULL, *fdt, NULL, copy_flags);
 
         if (FLAGS_SET(copy_flags, COPY_VERIFY_LINKED)) {
                 r = fd_verify_linked(fdf);
@@ -846,13 +869,13 @@ static int fd_copy_regular(
         }
 
         if (copy_flags & COPY_FSYNC) {
-                if (fsync(fdt) < 0) {
+                if (fsync(*fdt) < 0) {
                         r = -errno;
                         goto fail;
                 }
         }
 
-        q = close_nointr(TAKE_FD(fdt)); /* even if this fails, the fd is now invalidated */
+        q = close_nointr(TAKE_FD(*fdt)); /* even if this fails, the fd is now invalidated */
         if (q < 0) {
                 r = q;
                 goto fail;
@@ -866,6 +889,237 @@ fail:
         return r;
 }
 
+static CopyParallelFile* copy_parallel_file_free(CopyParallelFile *f) {
+        if (!f)
+                return NULL;
+
+        safe_close(f->fdf);
+        safe_close(f->fdt);
+        safe_close(f->dt);
+        free(f->to);
+
+        return mfree(f);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(CopyParallelFile*, copy_parallel_file_free);
+
+static int copy_parallel_file_count_bytes(uint64_t n_bytes, void *userdata) {
+        CopyParallelFile *f = ASSERT_PTR(userdata);
+
+        f->n_bytes += n_bytes;
+        return 0;
+}
+
+static int copy_parallel_file_work(void *userdata) {
+        CopyParallelFile *f = ASSERT_PTR(userdata);
+
+        /* Called in a worker thread. The byte progress callback of the caller is invoked from the completion
+         * callback below, in the calling thread, hence only count the bytes here. If hardlinks are
+         * reproduced, the file was already memorized when it was created. */
+        return fd_copy_regular_contents(
+                        f->fdf, &f->fdt,
+                        &f->st,
+                        f->dt, f->to,
+                        f->override_uid, f->override_gid,
+                        f->copy_flags,
+                        /* hardlink_context= */ NULL,
+                        f->parallel->progress ? copy_parallel_file_count_bytes : NULL,
+                        f);
+}
+
+static void copy_parallel_file_done(ThreadPool *pool, int result, void *userdata) {
+        _cleanup_(copy_parallel_file_freep) CopyParallelFile *f = ASSERT_PTR(userdata);
+        CopyParallel *c = ASSERT_PTR(f->parallel);
+
+        if (result == -ECANCELED) /* Not started, because we failed elsewhere. Don't leave an empty file. */
+                (void) unlinkat(f->dt, f->to, 0);
+        else if (result >= 0 && c->progress)
+                result = c->progress(f->n_bytes, c->userdata);
+
+        (void) RET_GATHER(c->error, result);
+}
+
+static int copy_parallel_setup(
+                CopyParallel *c,
+                CopyFlags copy_flags,
+                copy_progress_bytes_t progress,
+                void *userdata) {
+
+        int r;
+
+        assert(c);
+        assert(!c->event);
+        assert(!c->pool);
+
+        if (!FLAGS_SET(copy_flags, COPY_PARALLEL))
+                return 0;
+
+        /* The pool dispatches its completion callbacks on an event loop, use a private one that we only run
+         * while waiting for the workers. */
+        r = sd_event_new(&c->event);
+        if (r < 0)
+                return r;
+
+        r = thread_pool_new(c->event, "copy", COPY_PARALLEL_THREADS, COPY_PARALLEL_QUEUE_SIZE, &c->pool);
+        if (r < 0)
+                return r;
+
+        c->progress = progress;
+        c->userdata = userdata;
+        return 1;
+}
+
+static int copy_parallel_wait(CopyParallel *c) {
+        int r;
+
+        assert(c);
+
+        while (thread_pool_get_n_pending(c->pool) > 0) {
+                r = sd_event_run(c->event, UINT64_MAX);
+                if (r < 0)
+                        return r;
+        }
+
+        return c->error;
+}
+
+static void copy_parallel_done(CopyParallel *c) {
+        assert(c);
+
+        /* Waits for the files being copied, and removes the ones not started yet again */
+        c->pool = thread_pool_unref(c->pool);
+        c->event = sd_event_unref(c->event);
+}
+
+static int copy_parallel_submit_regular(
+                CopyParallel *c,
+                int *fdf,
+                int *fdt,
+                const struct stat *st,
+                int dt,
+                const char *to,
+                uid_t override_uid,
+                gid_t override_gid,
+                CopyFlags copy_flags) {
+
+        _cleanup_(copy_parallel_file_freep) CopyParallelFile *f = NULL;
+        int r;
+
+        assert(c);
+        assert(fdf);
+        assert(fdt);
+        assert(st);
+        assert(dt >= 0);
+        assert(to);
+
+        /* Takes possession of *fdf and *fdt, and queues copying the contents of the file. The file is
+         * removed again if that fails. */
+
+        f = new(CopyParallelFile, 1);
+        if (!f) {
+                r = -ENOMEM;
+                goto fail;
+        }
+
+        *f = (CopyParallelFile) {
+                .parallel = c,
+                .fdf = TAKE_FD(*fdf),
+                .fdt = TAKE_FD(*fdt),
+                .dt = fcntl(dt, F_DUPFD_CLOEXEC, 3),
+                .to = strdup(to),
+                .st = *st,
+                .override_uid = override_uid,
+                .override_gid = override_gid,
+                .copy_flags = copy_flags,
+        };
+        if (f->dt < 0) {
+                r = -errno;
+                goto fail;
+        }
+        if (!f->to) {
+                r = -ENOMEM;
+                goto fail;
+        }
+
+        for (;;) {
+                /* Propagate SIGINT/SIGTERM seen by the workers instantly */
+                if (c->error == -EINTR) {
+                        r = -EINTR;
+                        goto fail;
+                }
+
+                r = thread_pool_submit(c->pool, copy_parallel_file_work, copy_parallel_file_done, f);
+                if (r != -ENOBUFS)
+                        break;
+
+                /* The queue is full, wait until at least one of the files is copied */
+                r = sd_event_run(c->event, UINT64_MAX);
+                if (r < 0)
+                        goto fail;
+        }
+        if (r < 0)
+                goto fail;
+
+        TAKE_PTR(f);
+        return 0;
+
+fail:
+        (void) unlinkat(dt, to, 0);
+        return r;
+}
+
+static int fd_copy_regular(
+                int df,
+                const char *from,
+                const struct stat *st,
+                int dt,
+                const char *to,
+                uid_t override_uid,
+                gid_t override_gid,
+                CopyFlags copy_flags,
+                HardlinkContext *hardlink_context,
+                CopyParallel *parallel,
+                copy_progress_bytes_t progress,
+                void *userdata) {
+
+        _cleanup_close_ int fdf = -EBADF, fdt = -EBADF;
+        int r;
+
+        assert(st);
+        assert(to);
+
+        r = try_hardlink(hardlink_context, st, dt, to);
+        if (r < 0)
+                return r;
+        if (r > 0) /* worked! */
+                return 0;
+
+        fdf = xopenat(df, from, O_RDONLY|O_CLOEXEC|O_NOCTTY|O_NOFOLLOW);
+        if (fdf < 0)
+                return fdf;
+
+        if (copy_flags & COPY_MAC_CREATE) {
+                r = mac_selinux_create_file_prepare_at(dt, to, S_IFREG);
+                if (r < 0)
+                        return r;
+        }
+        fdt = openat(dt, to, O_WRONLY|O_CREAT|O_EXCL|O_CLOEXEC|O_NOCTTY|O_NOFOLLOW, st->st_mode & 07777);
+        if (copy_flags & COPY_MAC_CREATE)
+                mac_selinux_create_file_clear();
+        if (fdt < 0)
+                return -errno;
+
+        if (parallel) {
+                /* Memorize the inode right away, so that further hardlinks to it are created as such while
+                 * its contents are still being copied. */
+                (void) memorize_hardlink(hardlink_context, st, dt, to);
+
+                return copy_parallel_submit_regular(parallel, &fdf, &fdt, st, dt, to, override_uid, override_gid, copy_flags);
+        }
+
+        return fd_copy_regular_contents(fdf, &fdt, st, dt, to, override_uid, override_gid, copy_flags, hardlink_context, progress, userdata);
+}
+
 static int fd_copy_fifo(
                 int df,
                 const char *from,
@@ -986,6 +1240,7 @@ static int fd_copy_directory(
                 Hashmap *denylist,
                 Set *subvolumes,
                 HardlinkContext *hardlink_context,
+                CopyParallel *parallel,
                 const char *display_path,
                 copy_progress_path_t progress_path,
                 copy_progress_bytes_t progress_bytes,
@@ -1118,8 +1373,8 @@ static int fd_copy_directory(
 
                 q = fd_copy_tree_generic(dirfd(d), de->d_name, &buf, fdt, de->d_name, original_device,
                                          depth_left-1, override_uid, override_gid, copy_flags & ~COPY_LOCK_BSD,
-                                         denylist, subvolumes, hardlink_context, child_display_path, progress_path,
-                                         progress_bytes, userdata);
+                                         denylist, subvolumes, hardlink_context, parallel, child_display_path,
+                                         progress_path, progress_bytes, userdata);
 
                 if (q == -EINTR) /* Propagate SIGINT/SIGTERM up instantly */
                         return q;
@@ -1164,13 +1419,14 @@ static int fd_copy_leaf(
                 gid_t override_gid,
                 CopyFlags copy_flags,
                 HardlinkContext *hardlink_context,
+                CopyParallel *parallel,
                 const char *display_path,
                 copy_progress_bytes_t progress_bytes,
                 void *userdata) {
         int r;
 
         if (S_ISREG(st->st_mode))
-                r = fd_copy_regular(df, from, st, dt, to, override_uid, override_gid, copy_flags, hardlink_context, progress_bytes, userdata);
+                r = fd_copy_regular(df, from, st, dt, to, override_uid, override_gid, copy_flags, hardlink_context, parallel, progress_bytes, userdata);
         else if (S_ISLNK(st->st_mode))
                 r = fd_copy_symlink(df, from, st, dt, to, override_uid, override_gid, copy_flags);
         else if (S_ISFIFO(st->st_mode))
@@ -1197,6 +1453,7 @@ static int fd_copy_tree_generic(
                 Hashmap *denylist,
                 Set *subvolumes,
                 HardlinkContext *hardlink_context,
+                CopyParallel *parallel,
                 const char *display_path,
                 copy_progress_path_t progress_path,
                 copy_progress_bytes_t progress_bytes,
@@ -1209,7 +1466,7 @@ static int fd_copy_tree_generic(
         if (S_ISDIR(st->st_mode))
                 return fd_copy_directory(df, from, st, dt, to, original_device, depth_left-1, override_uid,
                                          override_gid, copy_flags, denylist, subvolumes, hardlink_context,
-                                         display_path, progress_path, progress_bytes, userdata);
+                                         parallel, display_path, progress_path, progress_bytes, userdata);
 
         DenyType t = PTR_TO_INT(hashmap_get(denylist, st));
         if (t == DENY_INODE) {
@@ -1218,14 +1475,14 @@ static int fd_copy_tree_generic(
         } else if (t == DENY_CONTENTS)
                 log_debug("%s is configured to have its contents excluded, but is not a directory", from ?: "file to copy");
 
-        r = fd_copy_leaf(df, from, st, dt, to, override_uid, override_gid, copy_flags, hardlink_context, display_path, progress_bytes, userdata);
+        r = fd_copy_leaf(df, from, st, dt, to, override_uid, override_gid, copy_flags, hardlink_context, parallel, display_path, progress_bytes, userdata);
         /* We just tried to copy a leaf node of the tree. If it failed because the node already exists *and* the COPY_REPLACE flag has been provided, we should unlink the node and re-copy. */
         if (r == -EEXIST && (copy_flags & COPY_REPLACE)) {
                 /* This codepath is us trying to address an error to copy, if the unlink fails, lets just return the original error. */
                 if (unlinkat(dt, to, 0) < 0)
                         return r;
 
-                r = fd_copy_leaf(df, from, st, dt, to, override_uid, override_gid, copy_flags, hardlink_context, display_path, progress_bytes, userdata);
+                r = fd_copy_leaf(df, from, st, dt, to, override_uid, override_gid, copy_flags, hardlink_context, parallel, display_path, progress_bytes, userdata);
         }
 
         return r;
@@ -1245,6 +1502,7 @@ int copy_tree_at_full(
                 copy_progress_bytes_t progress_bytes,
                 void *userdata) {
 
+        _cleanup_(copy_parallel_done) CopyParallel parallel = {};
         struct stat st;
         int r;
 
@@ -1254,12 +1512,26 @@ int copy_tree_at_full(
         if (fstatat(fdf, strempty(from), &st, AT_SYMLINK_NOFOLLOW | (isempty(from) ? AT_EMPTY_PATH : 0)) < 0)
                 return -errno;
 
+        /* There's nothing to parallelize if we copy a single inode */
+        if (S_ISDIR(st.st_mode)) {
+                r = copy_parallel_setup(&parallel, copy_flags, progress_bytes, userdata);
+                if (r < 0)
+                        return r;
+        }
+
         r = fd_copy_tree_generic(fdf, from, &st, fdt, to, st.st_dev, COPY_DEPTH_MAX, override_uid,
-                                 override_gid, copy_flags, denylist, subvolumes, NULL, NULL, progress_path,
+                                 override_gid, copy_flags, denylist, subvolumes, NULL,
+                                 parallel.pool ? &parallel : NULL, NULL, progress_path,
                                  progress_bytes, userdata);
         if (r < 0)
                 return r;
 
+        if (parallel.pool) {
+                r = copy_parallel_wait(&parallel);
+                if (r < 0)
+                        return r;
+        }
+
         if (S_ISDIR(st.st_mode) && (copy_flags & COPY_SYNCFS)) {
                 /* If the top-level inode is a directory run syncfs() now. */
                 r = syncfs_path(fdt, to);
@@ -1301,6 +1573,7 @@ int copy_directory_at_full(
                 copy_progress_bytes_t progress_bytes,
                 void *userdata) {
 
+        _cleanup_(copy_parallel_done) CopyParallel parallel = {};
         _cleanup_close_ int fdt = -EBADF;
         struct stat st;
         int r;
@@ -1316,6 +1589,10 @@ int copy_directory_at_full(
         if (r < 0)
                 return r;
 
+        r = copy_parallel_setup(&parallel, copy_flags, progress_bytes, userdata);
+        if (r < 0)
+                return r;
+
         r = fd_copy_directory(
                         dir_fdf, from,
                         &st,
@@ -1324,7 +1601,9 @@ int copy_directory_at_full(
                         COPY_DEPTH_MAX,
                         UID_INVALID, GID_INVALID,
                         copy_flags,
-                        NULL, NULL, NULL, NULL,
+                        NULL, NULL, NULL,
+                        parallel.pool ? &parallel : NULL,
+                        NULL,
                         progress_path,
                         progress_bytes,
                         userdata);
@@ -1334,6 +1613,12 @@ int copy_directory_at_full(
         if (FLAGS_SET(copy_flags, COPY_LOCK_BSD))
                 fdt = r;
 
+        if (parallel.pool) {
+                r = copy_parallel_wait(&parallel);
+                if (r < 0)
+                        return r;
+        }
+
         r = sync_dir_by_flags(dir_fdt, to, copy_flags);
         if (r < 0)
                 return r;
@@ -31,6 +31,7 @@ typedef enum CopyFlags {
         COPY_TRUNCATE      = 1 << 16, /* Truncate to current file offset after copying */
         COPY_LOCK_BSD      = 1 << 17, /* Return a BSD exclusively locked file descriptor referring to the copied image/directory. */
         COPY_VERIFY_LINKED = 1 << 18, /* Check the source file is still linked after copying. */
+        COPY_PARALLEL      = 1 << 19, /* Copy the contents of regular files of trees in worker threads, reporting byte progress per file */
 } CopyFlags;
 
 typedef enum DenyType {
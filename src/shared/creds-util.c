@@ -1170,6 +1170,52 @@ int encrypt_credential_and_warn(
         return 0;
 }
 
+#if HAVE_TPM2
+/* With CREDENTIAL_TPM2_CACHE, the TPM2 context used for decrypting is kept around, so that decrypting a series
+ * of credentials (e.g. all credentials of a service) doesn't pay for setting up the TPM connection and
+ * recreating the primary key each time. Released with decrypt_credential_flush_cache(). */
+static Tpm2Context *cached_tpm2_context = NULL;
+static char *cached_tpm2_device = NULL;
+
+static int acquire_tpm2_context(const char *device, CredentialFlags flags, Tpm2Context **ret) {
+        _cleanup_(tpm2_context_unrefp) Tpm2Context *c = NULL;
+        _cleanup_free_ char *d = NULL;
+        int r;
+
+        assert(ret);
+
+        if (!FLAGS_SET(flags, CREDENTIAL_TPM2_CACHE))
+                return tpm2_context_new(device, ret);
+
+        if (cached_tpm2_context && streq_ptr(cached_tpm2_device, device)) {
+                *ret = tpm2_context_ref(cached_tpm2_context);
+                return 0;
+        }
+
+        r = tpm2_context_new(device, &c);
+        if (r < 0)
+                return r;
+
+        c->cache_primary = true;
+
+        if (device) {
+                d = strdup(device);
+                if (!d) {
+                        /* Not fatal, just don't cache */
+                        *ret = TAKE_PTR(c);
+                        return 0;
+                }
+        }
+
+        tpm2_context_unref(cached_tpm2_context);
+        cached_tpm2_context = tpm2_context_ref(c);
+        free_and_replace(cached_tpm2_device, d);
+
+        *ret = TAKE_PTR(c);
+        return 0;
+}
+#endif
+
 int decrypt_credential_and_warn(
                 const char *validate_name,
                 usec_t validate_timestamp,
@@ -1325,7 +1371,7 @@ int decrypt_credential_and_warn(
                 }
 
                 _cleanup_(tpm2_context_unrefp) Tpm2Context *tpm2_context = NULL;
-                r = tpm2_context_new(tpm2_device, &tpm2_context);
+                r = acquire_tpm2_context(tpm2_device, flags, &tpm2_context);
                 if (r < 0)
                         return r;
 
@@ -1525,6 +1571,13 @@ int decrypt_credential_and_warn(const char *validate_name, usec_t validate_times
 
 #endif
 
+void decrypt_credential_flush_cache(void) {
+#if HAVE_OPENSSL && HAVE_TPM2
+        cached_tpm2_context = tpm2_context_unref(cached_tpm2_context);
+        cached_tpm2_device = mfree(cached_tpm2_device);
+#endif
+}
+
 int ipc_encrypt_credential(const char *name, usec_t timestamp, usec_t not_after, uid_t uid, const struct iovec *input, CredentialFlags flags, struct iovec *ret) {
         _cleanup_(varlink_unrefp) Varlink *vl = NULL;
         int r;
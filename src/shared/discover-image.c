@@ -18,6 +18,7 @@
 #include "chase.h"
 #include "chattr-util.h"
 #include "copy.h"
+#include "cpu-set-util.h"
 #include "dirent-util.h"
 #include "discover-image.h"
 #include "dissect-image.h"
@@ -25,19 +26,24 @@
 #include "env-util.h"
 #include "extension-util.h"
 #include "fd-util.h"
+#include "fileio.h"
 #include "fs-util.h"
 #include "hashmap.h"
 #include "hostname-setup.h"
 #include "id128-util.h"
 #include "initrd-util.h"
+#include "io-util.h"
+#include "json-util.h"
 #include "lock-util.h"
 #include "log.h"
 #include "loop-util.h"
 #include "macro.h"
+#include "memfd-util.h"
 #include "mkdir.h"
 #include "nulstr-util.h"
 #include "os-util.h"
 #include "path-util.h"
+#include "process-util.h"
 #include "rm-rf.h"
 #include "stat-util.h"
 #include "string-table.h"
@@ -320,6 +326,40 @@ static int image_update_quota(Image *i, int fd) {
         return 1;
 }
 
+int image_update_usage(Image *i) {
+        struct stat st;
+        usec_t mtime;
+
+        assert(i);
+
+        /* Refreshes the disk usage of an image object that might have been around for a while. Returns > 0
+         * if the usage fields are now current, 0 if there's no cheap way to tell for this type of image. */
+
+        switch (i->type) {
+
+        case IMAGE_SUBVOLUME:
+                return image_update_quota(i, -EBADF);
+
+        case IMAGE_RAW:
+                if (stat(i->path, &st) < 0)
+                        return -errno;
+
+                /* The file was modified since we looked at it last, hence the metadata might be out of date */
+                mtime = timespec_load(&st.st_mtim);
+                if (mtime != i->mtime) {
+                        i->mtime = mtime;
+                        i->metadata_valid = false;
+                }
+
+                i->usage = i->usage_exclusive = st.st_blocks * 512;
+                i->limit = i->limit_exclusive = st.st_size;
+                return 1;
+
+        default:
+                return 0;
+        }
+}
+
 static int image_make(
                 ImageClass c,
                 const char *pretty,
@@ -1447,6 +1487,49 @@ int image_set_limit(Image *i, uint64_t referenced_max) {
         return 0;
 }
 
+static int image_dissect_verity(
+                Image *i,
+                LoopDevice *d,
+                const ImagePolicy *image_policy,
+                DissectImageFlags flags,
+                DissectedImage **ret) {
+
+        _cleanup_(verity_settings_done) VeritySettings verity = VERITY_SETTINGS_DEFAULT;
+        _cleanup_(dissected_image_unrefp) DissectedImage *m = NULL;
+        int r;
+
+        assert(i);
+        assert(d);
+        assert(ret);
+
+        /* Dissects the image and sets up Verity, if the image comes with a root hash, so that the metadata
+         * is read from authenticated contents, and can be cached by the root hash. The Verity devices are
+         * shared with everyone else using the same image at the same time. */
+
+        r = verity_settings_load(&verity, i->path, /* root_hash_path= */ NULL, /* root_hash_sig_path= */ NULL);
+        if (r < 0)
+                return r;
+        if (verity.data_path) /* Needs to be dissected without partition table, which we don't do here */
+                return -EOPNOTSUPP;
+
+        r = dissect_loop_device(d, &verity, /* mount_options= */ NULL, image_policy, flags, &m);
+        if (r < 0)
+                return r;
+
+        r = dissected_image_load_verity_sig_partition(m, d->fd, &verity);
+        if (r < 0)
+                return r;
+
+        if (verity.root_hash) {
+                r = dissected_image_decrypt(m, /* passphrase= */ NULL, &verity, flags);
+                if (r < 0)
+                        return r;
+        }
+
+        *ret = TAKE_PTR(m);
+        return 0;
+}
+
 int image_read_metadata(Image *i, const ImagePolicy *image_policy) {
         _cleanup_(release_lock_file) LockFile global_lock = LOCK_FILE_INIT, local_lock = LOCK_FILE_INIT;
         int r;
@@ -1546,15 +1629,20 @@ int image_read_metadata(Image *i, const ImagePolicy *image_policy) {
                 if (r < 0)
                         return r;
 
-                r = dissect_loop_device(
-                                d,
-                                /* verity= */ NULL,
-                                /* mount_options= */ NULL,
-                                image_policy,
-                                flags,
-                                &m);
-                if (r < 0)
-                        return r;
+                r = image_dissect_verity(i, d, image_policy, flags, &m);
+                if (r < 0) {
+                        log_debug_errno(r, "Failed to set up Verity for image %s, reading metadata without: %m", i->path);
+
+                        r = dissect_loop_device(
+                                        d,
+                                        /* verity= */ NULL,
+                                        /* mount_options= */ NULL,
+                                        image_policy,
+                                        flags,
+                                        &m);
+                        if (r < 0)
+                                return r;
+                }
 
                 r = dissected_image_acquire_metadata(
                                 m,
@@ -1582,6 +1670,222 @@ int image_read_metadata(Image *i, const ImagePolicy *image_policy) {
         return 0;
 }
 
+#define IMAGE_METADATA_WORKERS_MAX 16U
+
+typedef struct ImageMetadata {
+        uint64_t index;
+        char *hostname;
+        sd_id128_t machine_id;
+        char **machine_info;
+        char **os_release;
+        char **sysext_release;
+        char **confext_release;
+} ImageMetadata;
+
+static void image_metadata_done(ImageMetadata *md) {
+        assert(md);
+
+        free(md->hostname);
+        strv_free(md->machine_info);
+        strv_free(md->os_release);
+        strv_free(md->sysext_release);
+        strv_free(md->confext_release);
+}
+
+static int image_metadata_to_json(const Image *i, uint64_t index, sd_json_variant **ret) {
+        assert(i);
+        assert(ret);
+
+        return sd_json_buildo(
+                        ret,
+                        SD_JSON_BUILD_PAIR_UNSIGNED("index", index),
+                        SD_JSON_BUILD_PAIR_CONDITION(!!i->hostname, "hostname", SD_JSON_BUILD_STRING(i->hostname)),
+                        SD_JSON_BUILD_PAIR_CONDITION(!sd_id128_is_null(i->machine_id), "machineId", SD_JSON_BUILD_ID128(i->machine_id)),
+                        JSON_BUILD_PAIR_STRV_NON_EMPTY("machineInfo", i->machine_info),
+                        JSON_BUILD_PAIR_STRV_NON_EMPTY("osRelease", i->os_release),
+                        JSON_BUILD_PAIR_STRV_NON_EMPTY("sysextRelease", i->sysext_release),
+                        JSON_BUILD_PAIR_STRV_NON_EMPTY("confextRelease", i->confext_release));
+}
+
+static int image_metadata_from_json(sd_json_variant *v, Image **images, size_t n_images) {
+
+        static const sd_json_dispatch_field table[] = {
+                { "index",          _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64, offsetof(ImageMetadata, index),           SD_JSON_MANDATORY },
+                { "hostname",       SD_JSON_VARIANT_STRING,        sd_json_dispatch_string, offsetof(ImageMetadata, hostname),        0                 },
+                { "machineId",      SD_JSON_VARIANT_STRING,        sd_json_dispatch_id128,  offsetof(ImageMetadata, machine_id),      0                 },
+                { "machineInfo",    SD_JSON_VARIANT_ARRAY,         sd_json_dispatch_strv,   offsetof(ImageMetadata, machine_info),    0                 },
+                { "osRelease",      SD_JSON_VARIANT_ARRAY,         sd_json_dispatch_strv,   offsetof(ImageMetadata, os_release),      0                 },
+                { "sysextRelease",  SD_JSON_VARIANT_ARRAY,         sd_json_dispatch_strv,   offsetof(ImageMetadata, sysext_release),  0                 },
+                { "confextRelease", SD_JSON_VARIANT_ARRAY,         sd_json_dispatch_strv,   offsetof(ImageMetadata, confext_release), 0                 },
+                {}
+        };
+
+        _cleanup_(image_metadata_done) ImageMetadata md = {};
+        Image *i;
+        int r;
+
+        assert(v);
+        assert(images || n_images == 0);
+
+        r = sd_json_dispatch(v, table, /* flags= */ 0, &md);
+        if (r < 0)
+                return r;
+        if (md.index >= n_images)
+                return -EBADMSG;
+
+        i = images[md.index];
+
+        free_and_replace(i->hostname, md.hostname);
+        i->machine_id = md.machine_id;
+        strv_free_and_replace(i->machine_info, md.machine_info);
+        strv_free_and_replace(i->os_release, md.os_release);
+        strv_free_and_replace(i->sysext_release, md.sysext_release);
+        strv_free_and_replace(i->confext_release, md.confext_release);
+        i->metadata_valid = true;
+
+        return 0;
+}
+
+static int image_read_metadata_worker(
+                Image **images,
+                size_t n_images,
+                size_t worker,
+                size_t n_workers,
+                const ImagePolicy *image_policy,
+                int fd) {
+
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *array = NULL;
+        _cleanup_free_ char *text = NULL;
+        int r;
+
+        assert(images);
+        assert(fd >= 0);
+
+        /* Reads the metadata of every n_workers-th image, starting with the one at index 'worker' */
+
+        for (size_t k = worker; k < n_images; k += n_workers) {
+                _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+
+                r = image_read_metadata(images[k], image_policy);
+                if (r < 0) {
+                        log_debug_errno(r, "Failed to read metadata of image %s, leaving it to the caller: %m", images[k]->name);
+                        continue;
+                }
+
+                r = image_metadata_to_json(images[k], k, &v);
+                if (r < 0)
+                        return r;
+
+                r = sd_json_variant_append_array(&array, v);
+                if (r < 0)
+                        return r;
+        }
+
+        if (!array)
+                return 0;
+
+        r = sd_json_variant_format(array, /* flags= */ 0, &text);
+        if (r < 0)
+                return r;
+
+        return loop_write(fd, text, SIZE_MAX);
+}
+
+int image_read_metadata_parallel(Hashmap *images, const ImagePolicy *image_policy) {
+        _cleanup_free_ Image **list = NULL;
+        _cleanup_free_ pid_t *pids = NULL;
+        size_t n = 0, n_workers, n_fds = 0;
+        int *fds = NULL;
+        Image *i;
+        int r;
+
+        CLEANUP_ARRAY(fds, n_fds, close_many_and_free);
+
+        /* Reads the metadata of all images at once in a number of worker processes, since for disk images
+         * that means dissecting and mounting them. Images whose metadata couldn't be read this way are left
+         * alone, so that the caller can read them with image_read_metadata() and report errors properly. */
+
+        list = new(Image*, hashmap_size(images));
+        if (!list)
+                return -ENOMEM;
+
+        HASHMAP_FOREACH(i, images)
+                if (!i->metadata_valid)
+                        list[n++] = i;
+
+        r = cpus_in_affinity_mask();
+        n_workers = MIN3(n, (size_t) MAX(r, 1), (size_t) IMAGE_METADATA_WORKERS_MAX);
+        if (n_workers <= 1)
+                return 0;
+
+        fds = new(int, n_workers);
+        if (!fds)
+                return -ENOMEM;
+
+        pids = new(pid_t, n_workers);
+        if (!pids)
+                return -ENOMEM;
+
+        r = 0;
+        for (size_t w = 0; w < n_workers; w++) {
+                fds[w] = memfd_new("image-metadata");
+                if (fds[w] < 0) {
+                        r = fds[w];
+                        n_workers = w;
+                        break;
+                }
+                n_fds++;
+
+                r = safe_fork("(sd-metadata)", FORK_RESET_SIGNALS|FORK_DEATHSIG_SIGTERM|FORK_LOG, pids + w);
+                if (r < 0) {
+                        n_workers = w;
+                        break;
+                }
+                if (r == 0) {
+                        r = image_read_metadata_worker(list, n, w, n_workers, image_policy, fds[w]);
+                        _exit(r < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+                }
+        }
+
+        for (size_t w = 0; w < n_workers; w++) {
+                _cleanup_(sd_json_variant_unrefp) sd_json_variant *array = NULL;
+                _cleanup_fclose_ FILE *f = NULL;
+                sd_json_variant *e;
+                int k;
+
+                k = wait_for_terminate_and_check("(sd-metadata)", pids[w], WAIT_LOG_ABNORMAL);
+                if (k != EXIT_SUCCESS)
+                        continue;
+
+                if (lseek(fds[w], 0, SEEK_SET) < 0) {
+                        log_debug_errno(errno, "Failed to seek to beginning of image metadata, ignoring: %m");
+                        continue;
+                }
+
+                f = take_fdopen(fds + w, "r");
+                if (!f) {
+                        log_debug_errno(errno, "Failed to open image metadata, ignoring: %m");
+                        continue;
+                }
+
+                k = sd_json_parse_file(f, /* path= */ NULL, /* flags= */ 0, &array, /* reterr_line= */ NULL, /* reterr_column= */ NULL);
+                if (k == -ENODATA) /* Didn't read anything */
+                        continue;
+                if (k < 0) {
+                        log_debug_errno(k, "Failed to parse image metadata read by worker, ignoring: %m");
+                        continue;
+                }
+
+                JSON_VARIANT_ARRAY_FOREACH(e, array) {
+                        k = image_metadata_from_json(e, list, n);
+                        if (k < 0)
+                                log_debug_errno(k, "Failed to apply image metadata read by worker, ignoring: %m");
+                }
+        }
+
+        return r < 0 ? r : 0;
+}
+
 int image_name_lock(const char *name, int operation, LockFile *ret) {
         const char *p;
 
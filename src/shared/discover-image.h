@@ -77,8 +77,10 @@ int image_path_lock(const char *path, int operation, LockFile *global, LockFile
 int image_name_lock(const char *name, int operation, LockFile *ret);
 
 int image_set_limit(Image *i, uint64_t referenced_max);
+int image_update_usage(Image *i);
 
 int image_read_metadata(Image *i, const ImagePolicy *image_policy);
+int image_read_metadata_parallel(Hashmap *images, const ImagePolicy *image_policy);
 
 bool image_in_search_path(ImageClass class, const char *root, const char *image);
 
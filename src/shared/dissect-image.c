@@ -1712,6 +1712,7 @@ DissectedImage* dissected_image_unref(DissectedImage *m) {
         loop_device_unref(m->loop);
 
         free(m->image_name);
+        free(m->verity_root_hash);
         free(m->hostname);
         strv_free(m->machine_info);
         strv_free(m->os_release);
@@ -2968,7 +2969,7 @@ success:
         m->decrypted_node = TAKE_PTR(node);
         close_and_replace(m->mount_node_fd, mount_node_fd);
 
-        return 0;
+        return 1;
 }
 #endif
 
@@ -3024,6 +3025,16 @@ int dissected_image_decrypt(
                         r = verity_partition(i, p, m->partitions + k, verity, flags, d);
                         if (r < 0)
                                 return r;
+                        if (r > 0) {
+                                void *h;
+
+                                h = memdup(verity->root_hash, verity->root_hash_size);
+                                if (!h)
+                                        return -ENOMEM;
+
+                                free_and_replace(m->verity_root_hash, h);
+                                m->verity_root_hash_size = verity->root_hash_size;
+                        }
                 }
 
                 if (!p->decrypted_fstype && p->mount_node_fd >= 0 && p->decrypted_node) {
@@ -3442,6 +3453,163 @@ int dissected_image_load_verity_sig_partition(
         return 1;
 }
 
+#define METADATA_CACHE_DIR "/run/systemd/dissect-metadata"
+
+typedef struct MetadataCacheEntry {
+        char *image_name;
+        uint64_t flags;
+        char *hostname;
+        sd_id128_t machine_id;
+        char **machine_info;
+        char **os_release;
+        char **initrd_release;
+        char **sysext_release;
+        char **confext_release;
+        int has_init_system;
+} MetadataCacheEntry;
+
+static void metadata_cache_entry_done(MetadataCacheEntry *e) {
+        assert(e);
+
+        free(e->image_name);
+        free(e->hostname);
+        strv_free(e->machine_info);
+        strv_free(e->os_release);
+        strv_free(e->initrd_release);
+        strv_free(e->sysext_release);
+        strv_free(e->confext_release);
+}
+
+static int metadata_cache_path(const DissectedImage *m, int userns_fd, char **ret) {
+        _cleanup_free_ char *h = NULL;
+        int r;
+
+        assert(m);
+        assert(ret);
+
+        /* The metadata is only cached for images whose contents are authenticated by Verity, keyed by the
+         * root hash, as only then we know it is the same image the next time around. Not for images mounted
+         * on behalf of unprivileged users either, which is what the user namespace is for. */
+        if (!m->verity_root_hash || userns_fd >= 0)
+                return 0;
+
+        r = getenv_bool("SYSTEMD_DISSECT_METADATA_CACHE");
+        if (r < 0 && r != -ENXIO)
+                log_debug_errno(r, "Failed to parse $SYSTEMD_DISSECT_METADATA_CACHE, ignoring: %m");
+        if (r == 0)
+                return 0;
+
+        h = hexmem(m->verity_root_hash, m->verity_root_hash_size);
+        if (!h)
+                return -ENOMEM;
+
+        *ret = strjoin(METADATA_CACHE_DIR "/", h, ".json");
+        if (!*ret)
+                return -ENOMEM;
+
+        return 1;
+}
+
+static int metadata_cache_load(DissectedImage *m, const char *path, DissectImageFlags flags) {
+
+        static const sd_json_dispatch_field table[] = {
+                { "imageName",      SD_JSON_VARIANT_STRING,        sd_json_dispatch_string,   offsetof(MetadataCacheEntry, image_name),      0                 },
+                { "flags",          _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64,   offsetof(MetadataCacheEntry, flags),           SD_JSON_MANDATORY },
+                { "hostname",       SD_JSON_VARIANT_STRING,        sd_json_dispatch_string,   offsetof(MetadataCacheEntry, hostname),        0                 },
+                { "machineId",      SD_JSON_VARIANT_STRING,        sd_json_dispatch_id128,    offsetof(MetadataCacheEntry, machine_id),      0                 },
+                { "machineInfo",    SD_JSON_VARIANT_ARRAY,         sd_json_dispatch_strv,     offsetof(MetadataCacheEntry, machine_info),    0                 },
+                { "osRelease",      SD_JSON_VARIANT_ARRAY,         sd_json_dispatch_strv,     offsetof(MetadataCacheEntry, os_release),      0                 },
+                { "initrdRelease",  SD_JSON_VARIANT_ARRAY,         sd_json_dispatch_strv,     offsetof(MetadataCacheEntry, initrd_release),  0                 },
+                { "sysextRelease",  SD_JSON_VARIANT_ARRAY,         sd_json_dispatch_strv,     offsetof(MetadataCacheEntry, sysext_release),  0                 },
+                { "confextRelease", SD_JSON_VARIANT_ARRAY,         sd_json_dispatch_strv,     offsetof(MetadataCacheEntry, confext_release), 0                 },
+                { "hasInitSystem",  SD_JSON_VARIANT_BOOLEAN,       sd_json_dispatch_tristate, offsetof(MetadataCacheEntry, has_init_system), 0                 },
+                {}
+        };
+
+        _cleanup_(metadata_cache_entry_done) MetadataCacheEntry e = {
+                .has_init_system = -1,
+        };
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        int r;
+
+        assert(m);
+        assert(path);
+
+        r = sd_json_parse_file(/* f= */ NULL, path, /* flags= */ 0, &v, /* reterr_line= */ NULL, /* reterr_column= */ NULL);
+        if (r < 0)
+                return r;
+
+        r = sd_json_dispatch(v, table, SD_JSON_ALLOW_EXTENSIONS, &e);
+        if (r < 0)
+                return r;
+
+        /* The extension release files are looked up by image name, and the flags decide which checks are
+         * done when mounting, hence both have to match, too */
+        if (!streq_ptr(e.image_name, m->image_name) || e.flags != (uint64_t) flags)
+                return -ESTALE;
+
+        free_and_replace(m->hostname, e.hostname);
+        m->machine_id = e.machine_id;
+        strv_free_and_replace(m->machine_info, e.machine_info);
+        strv_free_and_replace(m->os_release, e.os_release);
+        strv_free_and_replace(m->initrd_release, e.initrd_release);
+        strv_free_and_replace(m->sysext_release, e.sysext_release);
+        strv_free_and_replace(m->confext_release, e.confext_release);
+        m->has_init_system = e.has_init_system;
+
+        return 0;
+}
+
+static int metadata_cache_save(const DissectedImage *m, const char *path, DissectImageFlags flags) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        _cleanup_(unlink_and_freep) char *t = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        int r;
+
+        assert(m);
+        assert(path);
+
+        r = sd_json_buildo(
+                        &v,
+                        SD_JSON_BUILD_PAIR_CONDITION(!!m->image_name, "imageName", SD_JSON_BUILD_STRING(m->image_name)),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("flags", (uint64_t) flags),
+                        SD_JSON_BUILD_PAIR_CONDITION(!!m->hostname, "hostname", SD_JSON_BUILD_STRING(m->hostname)),
+                        SD_JSON_BUILD_PAIR_CONDITION(!sd_id128_is_null(m->machine_id), "machineId", SD_JSON_BUILD_ID128(m->machine_id)),
+                        JSON_BUILD_PAIR_STRV_NON_EMPTY("machineInfo", m->machine_info),
+                        JSON_BUILD_PAIR_STRV_NON_EMPTY("osRelease", m->os_release),
+                        JSON_BUILD_PAIR_STRV_NON_EMPTY("initrdRelease", m->initrd_release),
+                        JSON_BUILD_PAIR_STRV_NON_EMPTY("sysextRelease", m->sysext_release),
+                        JSON_BUILD_PAIR_STRV_NON_EMPTY("confextRelease", m->confext_release),
+                        SD_JSON_BUILD_PAIR_CONDITION(m->has_init_system >= 0, "hasInitSystem", SD_JSON_BUILD_BOOLEAN(m->has_init_system > 0)));
+        if (r < 0)
+                return r;
+
+        r = mkdir_parents(path, 0755);
+        if (r < 0)
+                return r;
+
+        r = fopen_temporary(path, &f, &t);
+        if (r < 0)
+                return r;
+
+        if (fchmod(fileno(f), 0644) < 0)
+                return -errno;
+
+        r = sd_json_variant_dump(v, SD_JSON_FORMAT_NEWLINE, f, /* prefix= */ NULL);
+        if (r < 0)
+                return r;
+
+        r = fflush_and_check(f);
+        if (r < 0)
+                return r;
+
+        if (rename(t, path) < 0)
+                return -errno;
+
+        t = mfree(t);
+        return 0;
+}
+
 int dissected_image_acquire_metadata(
                 DissectedImage *m,
                 int userns_fd,
@@ -3473,7 +3641,7 @@ int dissected_image_acquire_metadata(
         };
 
         _cleanup_strv_free_ char **machine_info = NULL, **os_release = NULL, **initrd_release = NULL, **sysext_release = NULL, **confext_release = NULL;
-        _cleanup_free_ char *hostname = NULL, *t = NULL;
+        _cleanup_free_ char *hostname = NULL, *t = NULL, *cache_path = NULL;
         _cleanup_close_pair_ int error_pipe[2] = EBADF_PAIR;
         _cleanup_(sigkill_waitp) pid_t child = 0;
         sd_id128_t machine_id = SD_ID128_NULL;
@@ -3486,6 +3654,19 @@ int dissected_image_acquire_metadata(
 
         assert(m);
 
+        r = metadata_cache_path(m, userns_fd, &cache_path);
+        if (r < 0)
+                return r;
+        if (r > 0) {
+                r = metadata_cache_load(m, cache_path, extra_flags);
+                if (r >= 0) {
+                        log_debug("Loaded image metadata from %s.", cache_path);
+                        return 0;
+                }
+                if (r != -ENOENT)
+                        log_debug_errno(r, "Failed to load image metadata from %s, ignoring: %m", cache_path);
+        }
+
         for (; n_meta_initialized < _META_MAX; n_meta_initialized++) {
                 assert(paths[n_meta_initialized]);
 
@@ -3764,6 +3945,13 @@ int dissected_image_acquire_metadata(
         strv_free_and_replace(m->confext_release, confext_release);
         m->has_init_system = has_init_system;
 
+        if (cache_path) {
+                r = metadata_cache_save(m, cache_path, extra_flags);
+                if (r < 0)
+                        log_debug_errno(r, "Failed to save image metadata to %s, ignoring: %m", cache_path);
+                r = 0;
+        }
+
 finish:
         for (unsigned k = 0; k < n_meta_initialized; k++)
                 safe_close_pair(fds + 2*k);
@@ -109,6 +109,11 @@ struct DissectedImage {
         char *image_name;
         sd_id128_t image_uuid;
 
+        /* Root hash of the Verity device set up for the root or /usr/ partition, if any, i.e. if the contents
+         * of the image are authenticated */
+        void *verity_root_hash;
+        size_t verity_root_hash_size;
+
         /* Meta information extracted from /etc/os-release and similar */
         char *hostname;
         sd_id128_t machine_id;
@@ -117,17 +117,6 @@ typedef struct TableData {
         };
 } TableData;
 
-static size_t TABLE_CELL_TO_INDEX(TableCell *cell) {
-        size_t i;
-
-        assert(cell);
-
-        i = PTR_TO_SIZE(cell);
-        assert(i > 0);
-
-        return i-1;
-}
-
 static TableCell* TABLE_INDEX_TO_CELL(size_t index) {
         assert(index != SIZE_MAX);
         return SIZE_TO_PTR(index + 1);
@@ -158,8 +147,41 @@ struct Table {
         size_t n_json_fields;
 
         bool *reverse_map;
+
+        /* In streaming mode rows are written out as they are added, rather than all at once in
+         * table_print(), and dropped afterwards. See table_stream_begin(). */
+        FILE *stream;
+        sd_json_format_flags_t stream_json_format_flags;
+        size_t stream_n_sample_rows;
+        size_t *stream_width;                   /* Column widths, once determined from the sampled rows */
+        sd_json_variant **stream_json_elements; /* Field names and values of a JSON row, 2 per displayed column */
+        size_t n_stream_rows;                   /* Rows written out so far, not counting the header */
+        size_t n_dropped_cells;
+        bool stream_finished;
 };
 
+static size_t TABLE_CELL_TO_INDEX(Table *t, TableCell *cell) {
+        size_t i;
+
+        assert(t);
+        assert(cell);
+
+        i = PTR_TO_SIZE(cell);
+        assert(i > 0);
+        i--;
+
+        /* In streaming mode the cells of rows already written out are dropped, except for the header row's
+         * and the last row's. Returns SIZE_MAX for dropped cells. */
+        if (i >= t->n_columns) {
+                if (i - t->n_columns < t->n_dropped_cells)
+                        return SIZE_MAX;
+
+                i -= t->n_dropped_cells;
+        }
+
+        return i;
+}
+
 Table *table_new_raw(size_t n_columns) {
         _cleanup_(table_unrefp) Table *t = NULL;
 
@@ -258,6 +280,15 @@ static TableData *table_data_free(TableData *d) {
 DEFINE_PRIVATE_TRIVIAL_REF_UNREF_FUNC(TableData, table_data, table_data_free);
 DEFINE_TRIVIAL_CLEANUP_FUNC(TableData*, table_data_unref);
 
+static size_t table_get_display_columns(Table *t) {
+        assert(t);
+
+        return t->display_map ? t->n_display_map : t->n_columns;
+}
+
+static int table_stream_flush(Table *t, bool finish);
+static int table_stream_finish(Table *t);
+
 Table *table_unref(Table *t) {
         if (!t)
                 return NULL;
@@ -275,6 +306,10 @@ Table *table_unref(Table *t) {
 
         free(t->json_fields);
 
+        free(t->stream_width);
+        if (t->stream_json_elements)
+                sd_json_variant_unref_many(t->stream_json_elements, table_get_display_columns(t) * 2);
+
         return mfree(t);
 }
 
@@ -468,11 +503,18 @@ int table_add_cell_full(
         _cleanup_(table_data_unrefp) TableData *d = NULL;
         bool uppercase;
         TableData *p;
+        int r;
 
         assert(t);
         assert(type >= 0);
         assert(type < _TABLE_DATA_TYPE_MAX);
 
+        /* When streaming, write out the previous rows once we start a new one. (Not earlier, so that the
+         * formatting of the last cell may still be changed after adding it.) */
+        r = table_stream_flush(t, /* finish= */ false);
+        if (r < 0)
+                return r;
+
         /* Special rule: patch NULL data fields to the empty field */
         if (!data)
                 type = TABLE_EMPTY;
@@ -516,7 +558,7 @@ int table_add_cell_full(
                 return -ENOMEM;
 
         if (ret_cell)
-                *ret_cell = TABLE_INDEX_TO_CELL(t->n_cells);
+                *ret_cell = TABLE_INDEX_TO_CELL(t->n_cells + t->n_dropped_cells);
 
         t->data[t->n_cells++] = TAKE_PTR(d);
 
@@ -563,12 +605,17 @@ int table_fill_empty(Table *t, size_t until_column) {
 
 int table_dup_cell(Table *t, TableCell *cell) {
         size_t i;
+        int r;
 
         assert(t);
 
         /* Add the data of the specified cell a second time as a new cell to the end. */
 
-        i = TABLE_CELL_TO_INDEX(cell);
+        r = table_stream_flush(t, /* finish= */ false);
+        if (r < 0)
+                return r;
+
+        i = TABLE_CELL_TO_INDEX(t, cell);
         if (i >= t->n_cells)
                 return -ENXIO;
 
@@ -589,7 +636,7 @@ static int table_dedup_cell(Table *t, TableCell *cell) {
         /* Helper call that ensures the specified cell's data object has a ref count of 1, which we can use before
          * changing a cell's formatting without effecting every other cell's formatting that shares the same data */
 
-        i = TABLE_CELL_TO_INDEX(cell);
+        i = TABLE_CELL_TO_INDEX(t, cell);
         if (i >= t->n_cells)
                 return -ENXIO;
 
@@ -639,7 +686,7 @@ static TableData *table_get_data(Table *t, TableCell *cell) {
 
         /* Get the data object of the specified cell, or NULL if it doesn't exist */
 
-        i = TABLE_CELL_TO_INDEX(cell);
+        i = TABLE_CELL_TO_INDEX(t, cell);
         if (i >= t->n_cells)
                 return NULL;
 
@@ -852,7 +899,7 @@ int table_update(Table *t, TableCell *cell, TableDataType type, const void *data
         assert(t);
         assert(cell);
 
-        i = TABLE_CELL_TO_INDEX(cell);
+        i = TABLE_CELL_TO_INDEX(t, cell);
         if (i >= t->n_cells)
                 return -ENXIO;
 
@@ -1269,6 +1316,9 @@ int table_set_display_internal(Table *t, size_t first_column, ...) {
 
         assert(t);
 
+        if (t->stream)
+                return -EBUSY;
+
         column = first_column;
 
         va_start(ap, first_column);
@@ -1298,6 +1348,9 @@ int table_set_sort_internal(Table *t, size_t first_column, ...) {
 
         assert(t);
 
+        if (t->stream)
+                return -EBUSY;
+
         column = first_column;
 
         va_start(ap, first_column);
@@ -1326,6 +1379,9 @@ int table_hide_column_from_display_internal(Table *t, ...) {
 
         assert(t);
 
+        if (t->stream)
+                return -EBUSY;
+
         /* If the display map is empty, initialize it with all available columns */
         if (!t->display_map) {
                 r = table_set_display_all(t);
@@ -2235,44 +2291,19 @@ static const char* table_data_rgap_underline(TableData *d) {
         return NULL;
 }
 
-int table_print(Table *t, FILE *f) {
-        size_t n_rows, *minimum_width, *maximum_width, display_columns, *requested_width,
-                table_minimum_width, table_maximum_width, table_requested_width, table_effective_width,
-                *width = NULL;
-        _cleanup_free_ size_t *sorted = NULL;
+static int table_compute_widths(Table *t, size_t n_rows, size_t display_columns, size_t *width) {
+        size_t *minimum_width, *maximum_width, *requested_width,
+                table_minimum_width, table_maximum_width, table_requested_width, table_effective_width;
         uint64_t *column_weight, weight_sum;
+        bool have_width = false;
         int r;
 
         assert(t);
-
-        if (!f)
-                f = stdout;
-
-        /* Ensure we have no incomplete rows */
-        assert(t->n_cells % t->n_columns == 0);
-
-        n_rows = t->n_cells / t->n_columns;
-        assert(n_rows > 0); /* at least the header row must be complete */
-
-        if (t->sort_map) {
-                /* If sorting is requested, let's calculate an index table we use to lookup the actual index to display with. */
-
-                sorted = new(size_t, n_rows);
-                if (!sorted)
-                        return -ENOMEM;
-
-                for (size_t i = 0; i < n_rows; i++)
-                        sorted[i] = i * t->n_columns;
-
-                typesafe_qsort_r(sorted, n_rows, table_data_compare, t);
-        }
-
-        if (t->display_map)
-                display_columns = t->n_display_map;
-        else
-                display_columns = t->n_columns;
-
+        assert(n_rows > 0);
         assert(display_columns > 0);
+        assert(width);
+
+        /* Determines the width of each displayed column, from the first n_rows rows of the table */
 
         minimum_width = newa(size_t, display_columns);
         maximum_width = newa(size_t, display_columns);
@@ -2285,8 +2316,6 @@ int table_print(Table *t, FILE *f) {
         }
 
         for (unsigned pass = 0; pass < 2; pass++) {
-                /* First pass: determine column sizes */
-
                 for (size_t j = 0; j < display_columns; j++)
                         requested_width[j] = SIZE_MAX;
 
@@ -2306,7 +2335,7 @@ int table_print(Table *t, FILE *f) {
                                 assert_se(d = row[t->display_map ? t->display_map[j] : j]);
 
                                 r = table_data_requested_width_height(t, d,
-                                                                      width ? width[j] : SIZE_MAX,
+                                                                      have_width ? width[j] : SIZE_MAX,
                                                                       &req_width, &req_height, &any_soft);
                                 if (r < 0)
                                         return r;
@@ -2320,7 +2349,7 @@ int table_print(Table *t, FILE *f) {
                                          * length plus ellipsis. */
 
                                         field = table_data_format(t, d, false,
-                                                                  width ? width[j] : SIZE_MAX,
+                                                                  have_width ? width[j] : SIZE_MAX,
                                                                   &any_soft);
                                         if (!field)
                                                 return -ENOMEM;
@@ -2388,8 +2417,7 @@ int table_print(Table *t, FILE *f) {
                 if (table_effective_width < table_minimum_width)
                         table_effective_width = table_minimum_width;
 
-                if (!width)
-                        width = newa(size_t, display_columns);
+                have_width = true;
 
                 if (table_effective_width >= table_requested_width) {
                         size_t extra;
@@ -2493,147 +2521,200 @@ int table_print(Table *t, FILE *f) {
                 }
         }
 
-        /* Second pass: show output */
-        for (size_t i = t->header ? 0 : 1; i < n_rows; i++) {
-                size_t n_subline = 0;
-                bool more_sublines;
-                TableData **row;
+        return 0;
+}
 
-                if (sorted)
-                        row = t->data + sorted[i];
-                else
-                        row = t->data + i * t->n_columns;
+static int table_print_row(Table *t, TableData **row, size_t display_columns, const size_t *width, FILE *f) {
+        size_t n_subline = 0;
+        bool more_sublines;
+        int r;
 
-                do {
-                        const char *gap_color = NULL, *gap_underline = NULL;
-                        more_sublines = false;
+        assert(t);
+        assert(row);
+        assert(width);
+        assert(f);
 
-                        for (size_t j = 0; j < display_columns; j++) {
-                                _cleanup_free_ char *buffer = NULL, *extracted = NULL;
-                                bool lines_truncated = false;
-                                const char *field, *color = NULL, *underline = NULL;
-                                TableData *d;
-                                size_t l;
+        do {
+                const char *gap_color = NULL, *gap_underline = NULL;
+                more_sublines = false;
 
-                                assert_se(d = row[t->display_map ? t->display_map[j] : j]);
+                for (size_t j = 0; j < display_columns; j++) {
+                        _cleanup_free_ char *buffer = NULL, *extracted = NULL;
+                        bool lines_truncated = false;
+                        const char *field, *color = NULL, *underline = NULL;
+                        TableData *d;
+                        size_t l;
 
-                                field = table_data_format(t, d, false, width[j], NULL);
-                                if (!field)
+                        assert_se(d = row[t->display_map ? t->display_map[j] : j]);
+
+                        field = table_data_format(t, d, false, width[j], NULL);
+                        if (!field)
+                                return -ENOMEM;
+
+                        r = string_extract_line(field, n_subline, &extracted);
+                        if (r < 0)
+                                return r;
+                        if (r > 0) {
+                                /* There are more lines to come */
+                                if ((t->cell_height_max == SIZE_MAX || n_subline + 1 < t->cell_height_max))
+                                        more_sublines = true; /* There are more lines to come */
+                                else
+                                        lines_truncated = true;
+                        }
+                        if (extracted)
+                                field = extracted;
+
+                        l = utf8_console_width(field);
+                        if (l > width[j] && !(t->stream && t->width == 0)) {
+                                /* Field is wider than allocated space. Let's ellipsize. (Unless we are
+                                 * streaming, and hence determined the widths from the first rows only, but
+                                 * are supposed to show everything in full.) */
+
+                                buffer = ellipsize(field, width[j], /* ellipsize at the end if we truncated coming lines, otherwise honour configuration */
+                                                   lines_truncated ? 100 : d->ellipsize_percent);
+                                if (!buffer)
                                         return -ENOMEM;
 
-                                r = string_extract_line(field, n_subline, &extracted);
-                                if (r < 0)
-                                        return r;
-                                if (r > 0) {
-                                        /* There are more lines to come */
-                                        if ((t->cell_height_max == SIZE_MAX || n_subline + 1 < t->cell_height_max))
-                                                more_sublines = true; /* There are more lines to come */
-                                        else
-                                                lines_truncated = true;
-                                }
-                                if (extracted)
-                                        field = extracted;
+                                field = buffer;
+                        } else {
+                                if (lines_truncated) {
+                                        _cleanup_free_ char *padded = NULL;
+
+                                        /* We truncated more lines of this cell, let's add an
+                                         * ellipsis. We first append it, but that might make our
+                                         * string grow above what we have space for, hence ellipsize
+                                         * right after. This will truncate the ellipsis and add a new
+                                         * one. */
 
-                                l = utf8_console_width(field);
-                                if (l > width[j]) {
-                                        /* Field is wider than allocated space. Let's ellipsize */
+                                        padded = strjoin(field, special_glyph(SPECIAL_GLYPH_ELLIPSIS));
+                                        if (!padded)
+                                                return -ENOMEM;
 
-                                        buffer = ellipsize(field, width[j], /* ellipsize at the end if we truncated coming lines, otherwise honour configuration */
-                                                           lines_truncated ? 100 : d->ellipsize_percent);
+                                        buffer = ellipsize(padded, width[j], 100);
                                         if (!buffer)
                                                 return -ENOMEM;
 
                                         field = buffer;
-                                } else {
-                                        if (lines_truncated) {
-                                                _cleanup_free_ char *padded = NULL;
-
-                                                /* We truncated more lines of this cell, let's add an
-                                                 * ellipsis. We first append it, but that might make our
-                                                 * string grow above what we have space for, hence ellipsize
-                                                 * right after. This will truncate the ellipsis and add a new
-                                                 * one. */
-
-                                                padded = strjoin(field, special_glyph(SPECIAL_GLYPH_ELLIPSIS));
-                                                if (!padded)
-                                                        return -ENOMEM;
-
-                                                buffer = ellipsize(padded, width[j], 100);
-                                                if (!buffer)
-                                                        return -ENOMEM;
-
-                                                field = buffer;
-                                                l = utf8_console_width(field);
-                                        }
-
-                                        if (l < width[j]) {
-                                                _cleanup_free_ char *aligned = NULL;
-                                                /* Field is shorter than allocated space. Let's align with spaces */
-
-                                                aligned = align_string_mem(field, d->url, width[j], d->align_percent);
-                                                if (!aligned)
-                                                        return -ENOMEM;
-
-                                                /* Drop trailing white spaces of last column when no cosmetics is set. */
-                                                if (j == display_columns - 1 &&
-                                                    (!colors_enabled() || !table_data_color(d)) &&
-                                                    (!underline_enabled() || !table_data_underline(d)) &&
-                                                    (!urlify_enabled() || !d->url))
-                                                        delete_trailing_chars(aligned, NULL);
-
-                                                free_and_replace(buffer, aligned);
-                                                field = buffer;
-                                        }
+                                        l = utf8_console_width(field);
                                 }
 
-                                if (l >= width[j] && d->url) {
-                                        _cleanup_free_ char *clickable = NULL;
+                                if (l < width[j]) {
+                                        _cleanup_free_ char *aligned = NULL;
+                                        /* Field is shorter than allocated space. Let's align with spaces */
 
-                                        r = terminal_urlify(d->url, field, &clickable);
-                                        if (r < 0)
-                                                return r;
+                                        aligned = align_string_mem(field, d->url, width[j], d->align_percent);
+                                        if (!aligned)
+                                                return -ENOMEM;
 
-                                        free_and_replace(buffer, clickable);
+                                        /* Drop trailing white spaces of last column when no cosmetics is set. */
+                                        if (j == display_columns - 1 &&
+                                            (!colors_enabled() || !table_data_color(d)) &&
+                                            (!underline_enabled() || !table_data_underline(d)) &&
+                                            (!urlify_enabled() || !d->url))
+                                                delete_trailing_chars(aligned, NULL);
+
+                                        free_and_replace(buffer, aligned);
                                         field = buffer;
                                 }
+                        }
 
-                                if (colors_enabled() && gap_color)
-                                        fputs(gap_color, f);
-                                if (underline_enabled() && gap_underline)
-                                        fputs(gap_underline, f);
+                        if (l >= width[j] && d->url) {
+                                _cleanup_free_ char *clickable = NULL;
 
-                                if (j > 0)
-                                        fputc(' ', f); /* column separator left of cell */
+                                r = terminal_urlify(d->url, field, &clickable);
+                                if (r < 0)
+                                        return r;
 
-                                /* Undo gap color/underline */
-                                if ((colors_enabled() && gap_color) ||
-                                    (underline_enabled() && gap_underline))
-                                        fputs(ANSI_NORMAL, f);
+                                free_and_replace(buffer, clickable);
+                                field = buffer;
+                        }
 
-                                if (colors_enabled()) {
-                                        color = table_data_color(d);
-                                        if (color)
-                                                fputs(color, f);
-                                }
+                        if (colors_enabled() && gap_color)
+                                fputs(gap_color, f);
+                        if (underline_enabled() && gap_underline)
+                                fputs(gap_underline, f);
 
-                                if (underline_enabled()) {
-                                        underline = table_data_underline(d);
-                                        if (underline)
-                                                fputs(underline, f);
-                                }
+                        if (j > 0)
+                                fputc(' ', f); /* column separator left of cell */
 
-                                fputs(field, f);
+                        /* Undo gap color/underline */
+                        if ((colors_enabled() && gap_color) ||
+                            (underline_enabled() && gap_underline))
+                                fputs(ANSI_NORMAL, f);
 
-                                if (color || underline)
-                                        fputs(ANSI_NORMAL, f);
+                        if (colors_enabled()) {
+                                color = table_data_color(d);
+                                if (color)
+                                        fputs(color, f);
+                        }
 
-                                gap_color = table_data_rgap_color(d);
-                                gap_underline = table_data_rgap_underline(d);
+                        if (underline_enabled()) {
+                                underline = table_data_underline(d);
+                                if (underline)
+                                        fputs(underline, f);
                         }
 
-                        fputc('\n', f);
-                        n_subline++;
-                } while (more_sublines);
+                        fputs(field, f);
+
+                        if (color || underline)
+                                fputs(ANSI_NORMAL, f);
+
+                        gap_color = table_data_rgap_color(d);
+                        gap_underline = table_data_rgap_underline(d);
+                }
+
+                fputc('\n', f);
+                n_subline++;
+        } while (more_sublines);
+
+        return 0;
+}
+
+int table_print(Table *t, FILE *f) {
+        size_t n_rows, display_columns, *width;
+        _cleanup_free_ size_t *sorted = NULL;
+        int r;
+
+        assert(t);
+
+        if (t->stream)
+                return table_stream_finish(t);
+
+        if (!f)
+                f = stdout;
+
+        /* Ensure we have no incomplete rows */
+        assert(t->n_cells % t->n_columns == 0);
+
+        n_rows = t->n_cells / t->n_columns;
+        assert(n_rows > 0); /* at least the header row must be complete */
+
+        if (t->sort_map) {
+                /* If sorting is requested, let's calculate an index table we use to lookup the actual index to display with. */
+
+                sorted = new(size_t, n_rows);
+                if (!sorted)
+                        return -ENOMEM;
+
+                for (size_t i = 0; i < n_rows; i++)
+                        sorted[i] = i * t->n_columns;
+
+                typesafe_qsort_r(sorted, n_rows, table_data_compare, t);
+        }
+
+        display_columns = table_get_display_columns(t);
+        width = newa(size_t, display_columns);
+
+        /* First pass: determine column sizes */
+        r = table_compute_widths(t, n_rows, display_columns, width);
+        if (r < 0)
+                return r;
+
+        /* Second pass: show output */
+        for (size_t i = t->header ? 0 : 1; i < n_rows; i++) {
+                r = table_print_row(t, t->data + (sorted ? sorted[i] : i * t->n_columns), display_columns, width, f);
+                if (r < 0)
+                        return r;
         }
 
         return fflush_and_check(f);
@@ -2663,7 +2744,7 @@ size_t table_get_rows(Table *t) {
                 return 0;
 
         assert(t->n_columns > 0);
-        return t->n_cells / t->n_columns;
+        return (t->n_cells + t->n_dropped_cells) / t->n_columns;
 }
 
 size_t table_get_columns(Table *t) {
@@ -2708,8 +2789,10 @@ TableCell *table_get_cell(Table *t, size_t row, size_t column) {
                 return NULL;
 
         i = row * t->n_columns + column;
-        if (i >= t->n_cells)
+        if (i >= t->n_cells + t->n_dropped_cells)
                 return NULL;
+        if (i >= t->n_columns && i - t->n_columns < t->n_dropped_cells)
+                return NULL; /* Already written out and dropped in streaming mode */
 
         return TABLE_INDEX_TO_CELL(i);
 }
@@ -2927,6 +3010,66 @@ static const char *table_get_json_field_name(Table *t, size_t idx) {
         return idx < t->n_json_fields ? t->json_fields[idx] : NULL;
 }
 
+static int table_make_json_field_names(Table *t, size_t display_columns, sd_json_variant **elements) {
+        int r;
+
+        assert(t);
+        assert(elements);
+
+        /* Fills in the field names of a row object, i.e. every other element, starting from the first */
+
+        for (size_t j = 0; j < display_columns; j++) {
+                _cleanup_free_ char *mangled = NULL;
+                const char *n;
+                size_t c;
+
+                c = t->display_map ? t->display_map[j] : j;
+
+                /* Use explicitly set JSON field name, if we have one. Otherwise mangle the column field value. */
+                n = table_get_json_field_name(t, c);
+                if (!n) {
+                        r = table_make_json_field_name(t, ASSERT_PTR(t->data[c]), &mangled);
+                        if (r < 0)
+                                return r;
+
+                        n = mangled;
+                }
+
+                r = sd_json_variant_new_string(elements + j*2, n);
+                if (r < 0)
+                        return r;
+        }
+
+        return 0;
+}
+
+static int table_row_to_json(Table *t, TableData **row, size_t display_columns, sd_json_variant **elements, sd_json_variant **ret) {
+        int r;
+
+        assert(t);
+        assert(row);
+        assert(elements);
+        assert(ret);
+
+        /* Fills in the values of a row object, i.e. every other element, starting from the second */
+
+        for (size_t j = 0; j < display_columns; j++) {
+                TableData *d;
+                size_t k;
+
+                assert_se(d = row[t->display_map ? t->display_map[j] : j]);
+
+                k = j*2+1;
+                elements[k] = sd_json_variant_unref(elements[k]);
+
+                r = table_data_to_json(d, elements + k);
+                if (r < 0)
+                        return r;
+        }
+
+        return sd_json_variant_new_object(ret, elements, display_columns * 2);
+}
+
 static int table_to_json_regular(Table *t, sd_json_variant **ret) {
         sd_json_variant **rows = NULL, **elements = NULL;
         _cleanup_free_ size_t *sorted = NULL;
@@ -2956,10 +3099,7 @@ static int table_to_json_regular(Table *t, sd_json_variant **ret) {
                 typesafe_qsort_r(sorted, n_rows, table_data_compare, t);
         }
 
-        if (t->display_map)
-                display_columns = t->n_display_map;
-        else
-                display_columns = t->n_columns;
+        display_columns = table_get_display_columns(t);
         assert(display_columns > 0);
 
         elements = new0(sd_json_variant*, display_columns * 2);
@@ -2968,27 +3108,9 @@ static int table_to_json_regular(Table *t, sd_json_variant **ret) {
 
         CLEANUP_ARRAY(elements, (size_t) { display_columns * 2 }, sd_json_variant_unref_many);
 
-        for (size_t j = 0; j < display_columns; j++) {
-                _cleanup_free_ char *mangled = NULL;
-                const char *n;
-                size_t c;
-
-                c = t->display_map ? t->display_map[j] : j;
-
-                /* Use explicitly set JSON field name, if we have one. Otherwise mangle the column field value. */
-                n = table_get_json_field_name(t, c);
-                if (!n) {
-                        r = table_make_json_field_name(t, ASSERT_PTR(t->data[c]), &mangled);
-                        if (r < 0)
-                                return r;
-
-                        n = mangled;
-                }
-
-                r = sd_json_variant_new_string(elements + j*2, n);
-                if (r < 0)
-                        return r;
-        }
+        r = table_make_json_field_names(t, display_columns, elements);
+        if (r < 0)
+                return r;
 
         rows = new0(sd_json_variant*, n_rows-1);
         if (!rows)
@@ -2997,28 +3119,11 @@ static int table_to_json_regular(Table *t, sd_json_variant **ret) {
         CLEANUP_ARRAY(rows, (size_t) { n_rows - 1 }, sd_json_variant_unref_many);
 
         for (size_t i = 1; i < n_rows; i++) {
-                TableData **row;
-
-                if (sorted)
-                        row = t->data + sorted[i];
-                else
-                        row = t->data + i * t->n_columns;
-
-                for (size_t j = 0; j < display_columns; j++) {
-                        TableData *d;
-                        size_t k;
-
-                        assert_se(d = row[t->display_map ? t->display_map[j] : j]);
-
-                        k = j*2+1;
-                        elements[k] = sd_json_variant_unref(elements[k]);
-
-                        r = table_data_to_json(d, elements + k);
-                        if (r < 0)
-                                return r;
-                }
-
-                r = sd_json_variant_new_object(rows + i - 1, elements, display_columns * 2);
+                r = table_row_to_json(t,
+                                      t->data + (sorted ? sorted[i] : i * t->n_columns),
+                                      display_columns,
+                                      elements,
+                                      rows + i - 1);
                 if (r < 0)
                         return r;
         }
@@ -3076,6 +3181,10 @@ static int table_to_json_vertical(Table *t, sd_json_variant **ret) {
 int table_to_json(Table *t, sd_json_variant **ret) {
         assert(t);
 
+        /* In streaming mode most rows are gone already */
+        if (t->stream)
+                return -EBUSY;
+
         if (t->vertical)
                 return table_to_json_vertical(t, ret);
 
@@ -3088,6 +3197,9 @@ int table_print_json(Table *t, FILE *f, sd_json_format_flags_t flags) {
 
         assert(t);
 
+        if (t->stream)
+                return table_stream_finish(t);
+
         if (flags & SD_JSON_FORMAT_OFF) /* If JSON output is turned off, use regular output */
                 return table_print(t, f);
 
@@ -3117,6 +3229,15 @@ int table_print_with_pager(
         /* An all-in-one solution for showing tables, and turning on a pager first. Also optionally suppresses
          * the table header and logs about any error. */
 
+        if (t->stream) {
+                /* The pager and the header were already taken care of by table_stream_begin_with_pager() */
+                r = table_stream_finish(t);
+                if (r < 0)
+                        return table_log_print_error(r);
+
+                return 0;
+        }
+
         if (json_format_flags & (SD_JSON_FORMAT_OFF|SD_JSON_FORMAT_PRETTY|SD_JSON_FORMAT_PRETTY_AUTO))
                 pager_open(pager_flags);
 
@@ -3156,3 +3277,250 @@ int table_set_json_field_name(Table *t, size_t idx, const char *name) {
                 return 1;
         }
 }
+
+int table_stream_begin(Table *t, FILE *f, sd_json_format_flags_t json_format_flags, size_t n_sample_rows) {
+        assert(t);
+
+        /* Switches the table into streaming mode: from now on rows are written out to the specified stream
+         * as they are added, rather than all at once by table_print() and friends, which then only finish
+         * the output. Column widths are determined from the header row and the first n_sample_rows rows
+         * (which are buffered until then), and are fixed afterwards. JSON output is written row by row right
+         * away. Rows that were written out are dropped from the table, hence cells of earlier rows may not
+         * be accessed anymore (except for the header row and the last row added). Sorting and changing the
+         * displayed columns is not supported in streaming mode, since that would require all rows. */
+
+        if (t->vertical || t->sort_map)
+                return -EINVAL;
+        if (t->stream)
+                return -EBUSY;
+
+        /* Ensure we start right after the header row */
+        if (t->n_cells != t->n_columns)
+                return -EBUSY;
+
+        /* Resolve the automatic flags once for the whole output, as sd_json_variant_dump() would */
+        if (!(json_format_flags & SD_JSON_FORMAT_OFF)) {
+                if ((json_format_flags & (SD_JSON_FORMAT_COLOR_AUTO|SD_JSON_FORMAT_COLOR)) == SD_JSON_FORMAT_COLOR_AUTO && colors_enabled())
+                        json_format_flags |= SD_JSON_FORMAT_COLOR;
+                if ((json_format_flags & (SD_JSON_FORMAT_PRETTY_AUTO|SD_JSON_FORMAT_PRETTY)) == SD_JSON_FORMAT_PRETTY_AUTO)
+                        json_format_flags |= on_tty() ? SD_JSON_FORMAT_PRETTY : SD_JSON_FORMAT_NEWLINE;
+        }
+
+        t->stream = f ?: stdout;
+        t->stream_json_format_flags = json_format_flags;
+        t->stream_n_sample_rows = n_sample_rows;
+
+        return 0;
+}
+
+int table_stream_begin_with_pager(
+                Table *t,
+                sd_json_format_flags_t json_format_flags,
+                PagerFlags pager_flags,
+                bool show_header,
+                size_t n_sample_rows) {
+
+        int r;
+
+        assert(t);
+
+        /* Like table_print_with_pager(), but for streaming: the pager needs to be running before the first
+         * row is written out, and whether the header is shown needs to be known by then, too. Finish the
+         * output with table_print_with_pager() later on. */
+
+        if (json_format_flags & (SD_JSON_FORMAT_OFF|SD_JSON_FORMAT_PRETTY|SD_JSON_FORMAT_PRETTY_AUTO))
+                pager_open(pager_flags);
+
+        table_set_header(t, show_header);
+
+        r = table_stream_begin(t, stdout, json_format_flags, n_sample_rows);
+        if (r < 0)
+                return log_error_errno(r, "Failed to set up table output: %m");
+
+        return 0;
+}
+
+static void table_stream_drop_rows(Table *t) {
+        size_t n_rows, n;
+
+        assert(t);
+        assert(t->n_cells % t->n_columns == 0);
+
+        /* Drops all rows written out already, except for the header row and the last row, which new cells
+         * copy their formatting from */
+
+        n_rows = t->n_cells / t->n_columns;
+        if (n_rows <= 2)
+                return;
+
+        n = (n_rows - 2) * t->n_columns;
+
+        for (size_t i = t->n_columns; i < t->n_columns + n; i++)
+                table_data_unref(t->data[i]);
+
+        memmove(t->data + t->n_columns, t->data + t->n_columns + n, t->n_columns * sizeof(TableData*));
+
+        t->n_cells -= n;
+        t->n_dropped_cells += n;
+}
+
+static int table_stream_json_row(Table *t, TableData **row, size_t display_columns) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        _cleanup_(memstream_done) MemStream m = {};
+        sd_json_format_flags_t flags = t->stream_json_format_flags;
+        bool pretty = flags & SD_JSON_FORMAT_PRETTY;
+        _cleanup_free_ char *s = NULL;
+        size_t sz;
+        FILE *f;
+        int r;
+
+        assert(t);
+        assert(row);
+
+        if (!t->stream_json_elements) {
+                t->stream_json_elements = new0(sd_json_variant*, display_columns * 2);
+                if (!t->stream_json_elements)
+                        return -ENOMEM;
+
+                r = table_make_json_field_names(t, display_columns, t->stream_json_elements);
+                if (r < 0)
+                        return r;
+        }
+
+        r = table_row_to_json(t, row, display_columns, t->stream_json_elements, &v);
+        if (r < 0)
+                return r;
+
+        /* Format the row as an element of the array, as sd_json_variant_dump() would when dumping the
+         * whole array at once, which means without the trailing newline in pretty mode. */
+        f = memstream_init(&m);
+        if (!f)
+                return -ENOMEM;
+
+        r = sd_json_variant_dump(v, flags & ~(SD_JSON_FORMAT_NEWLINE|SD_JSON_FORMAT_SEQ|SD_JSON_FORMAT_SSE|SD_JSON_FORMAT_FLUSH),
+                                 f, pretty ? "\t" : NULL);
+        if (r < 0)
+                return r;
+
+        r = memstream_finalize(&m, &s, &sz);
+        if (r < 0)
+                return r;
+
+        if (pretty && sz > 0 && s[sz-1] == '\n')
+                s[sz-1] = 0;
+
+        if (t->n_stream_rows == 0) {
+                if (flags & SD_JSON_FORMAT_SSE)
+                        fputs("data: ", t->stream);
+                if (flags & SD_JSON_FORMAT_SEQ)
+                        fputc('\x1e', t->stream); /* ASCII Record Separator */
+
+                fputs(pretty ? "[\n\t" : "[", t->stream);
+        } else
+                fputs(pretty ? ",\n\t" : ",", t->stream);
+
+        fputs(s, t->stream);
+        return 0;
+}
+
+static int table_stream_flush(Table *t, bool finish) {
+        size_t n_rows, first, display_columns;
+        int r;
+
+        assert(t);
+
+        /* Writes out all complete rows not written yet, once the column widths are known, i.e. the sample
+         * rows were collected, or we are told that no more rows will come */
+
+        if (!t->stream || t->stream_finished || t->n_cells % t->n_columns != 0)
+                return 0;
+
+        n_rows = t->n_cells / t->n_columns;
+        first = t->n_stream_rows > 0 ? 2 : 1; /* Skip the header row, and the last row written, if any */
+        display_columns = table_get_display_columns(t);
+
+        if (!(t->stream_json_format_flags & SD_JSON_FORMAT_OFF)) {
+                for (size_t i = first; i < n_rows; i++) {
+                        r = table_stream_json_row(t, t->data + i * t->n_columns, display_columns);
+                        if (r < 0)
+                                return r;
+
+                        t->n_stream_rows++;
+                }
+
+                table_stream_drop_rows(t);
+                return 0;
+        }
+
+        if (!t->stream_width) {
+                if (!finish && n_rows - 1 < t->stream_n_sample_rows)
+                        return 0;
+
+                t->stream_width = new(size_t, display_columns);
+                if (!t->stream_width)
+                        return -ENOMEM;
+
+                r = table_compute_widths(t, n_rows, display_columns, t->stream_width);
+                if (r < 0)
+                        return r;
+
+                if (t->header) {
+                        r = table_print_row(t, t->data, display_columns, t->stream_width, t->stream);
+                        if (r < 0)
+                                return r;
+                }
+        }
+
+        for (size_t i = first; i < n_rows; i++) {
+                r = table_print_row(t, t->data + i * t->n_columns, display_columns, t->stream_width, t->stream);
+                if (r < 0)
+                        return r;
+
+                t->n_stream_rows++;
+        }
+
+        table_stream_drop_rows(t);
+        return 0;
+}
+
+static int table_stream_finish(Table *t) {
+        sd_json_format_flags_t flags;
+        int r;
+
+        assert(t);
+        assert(t->stream);
+
+        /* Ensure we have no incomplete rows */
+        assert(t->n_cells % t->n_columns == 0);
+
+        if (t->stream_finished)
+                return 0;
+
+        r = table_stream_flush(t, /* finish= */ true);
+        if (r < 0)
+                return r;
+
+        flags = t->stream_json_format_flags;
+        if (!(flags & SD_JSON_FORMAT_OFF)) {
+                if (t->n_stream_rows == 0) {
+                        if (flags & SD_JSON_FORMAT_SSE)
+                                fputs("data: ", t->stream);
+                        if (flags & SD_JSON_FORMAT_SEQ)
+                                fputc('\x1e', t->stream); /* ASCII Record Separator */
+
+                        fputs("[]", t->stream);
+                } else if (flags & SD_JSON_FORMAT_PRETTY)
+                        fputs("\n]", t->stream);
+                else
+                        fputc(']', t->stream);
+
+                if (flags & (SD_JSON_FORMAT_PRETTY|SD_JSON_FORMAT_SEQ|SD_JSON_FORMAT_SSE|SD_JSON_FORMAT_NEWLINE))
+                        fputc('\n', t->stream);
+                if (flags & SD_JSON_FORMAT_SSE)
+                        fputc('\n', t->stream); /* In case of SSE add a second newline */
+        }
+
+        t->stream_finished = true;
+
+        return fflush_and_check(t->stream);
+}
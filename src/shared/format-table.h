@@ -165,6 +165,13 @@ int table_print_json(Table *t, FILE *f, sd_json_format_flags_t json_flags);
 
 int table_print_with_pager(Table *t, sd_json_format_flags_t json_format_flags, PagerFlags pager_flags, bool show_header);
 
+/* Streaming mode, for tables with huge numbers of rows: rows are written out as they are added, with column
+ * widths determined from the first n_sample_rows rows, and dropped afterwards. Finish the output with
+ * table_print(), table_print_json() or table_print_with_pager(), which ignore their other arguments then. */
+#define TABLE_STREAM_SAMPLE_ROWS 1024U
+int table_stream_begin(Table *t, FILE *f, sd_json_format_flags_t json_format_flags, size_t n_sample_rows);
+int table_stream_begin_with_pager(Table *t, sd_json_format_flags_t json_format_flags, PagerFlags pager_flags, bool show_header, size_t n_sample_rows);
+
 int table_set_json_field_name(Table *t, size_t idx, const char *name);
 
 #define table_log_add_error(r) \
@@ -1,6 +1,8 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
 #include <errno.h>
+#include <stdlib.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include "alloc-util.h"
@@ -960,6 +962,65 @@ int generator_write_veritysetup_service_section(
         return 0;
 }
 
+int generator_stamp_file(char **s, const char *path) {
+        struct stat st;
+
+        assert(s);
+        assert(path);
+
+        /* Appends a line describing the current state of the file to the string, enough to notice it being
+         * modified, replaced or removed. The path comes last, as it might contain spaces. */
+
+        if (stat(path, &st) < 0) {
+                if (errno != ENOENT)
+                        return -errno;
+
+                return strextendf(s, "- %s\n", path);
+        }
+
+        return strextendf(s, "%" PRIu64 ":%" PRIu64 ":%o:%" PRIu64 ":" NSEC_FMT ":" NSEC_FMT " %s\n",
+                          (uint64_t) st.st_dev,
+                          (uint64_t) st.st_ino,
+                          (unsigned) st.st_mode,
+                          (uint64_t) st.st_size,
+                          timespec_load_nsec(&st.st_mtim),
+                          timespec_load_nsec(&st.st_ctim),
+                          path);
+}
+
+int generator_declare_input(const char *path) {
+        _cleanup_fclose_ FILE *f = NULL;
+        _cleanup_free_ char *line = NULL;
+        const char *e;
+        int r;
+
+        assert(path);
+
+        /* Tells the service manager that our output is derived from the specified file. The state of the
+         * file is recorded right away, hence call this before reading it. If a generator declares all the
+         * files it reads this way, and none of them changed the next time generators are run, e.g. on
+         * daemon-reload, its previous output is reused instead of running it again. */
+
+        e = secure_getenv(GENERATOR_INPUTS_ENV);
+        if (!e)
+                return 0;
+
+        if (!path_is_absolute(path) || !path_is_valid(path) || strchr(path, '\n'))
+                return -EINVAL;
+
+        r = generator_stamp_file(&line, path);
+        if (r < 0)
+                return r;
+
+        f = fopen(e, "ae");
+        if (!f)
+                return -errno;
+
+        fputs(line, f);
+
+        return fflush_and_check(f);
+}
+
 void log_setup_generator(void) {
         if (invoked_by_systemd()) {
                 /* Disable talking to syslog/journal (i.e. the two IPC-based loggers) if we run in system context. */
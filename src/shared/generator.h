@@ -98,6 +98,12 @@ int generator_hook_up_quotaon(
 
 int generator_enable_remount_fs_service(const char *dir);
 
+/* Set by the service manager to the file generators may declare the files they read in */
+#define GENERATOR_INPUTS_ENV "SYSTEMD_GENERATOR_INPUTS"
+
+int generator_stamp_file(char **s, const char *path);
+int generator_declare_input(const char *path);
+
 void log_setup_generator(void);
 
 /* Similar to DEFINE_MAIN_FUNCTION, but initializes logging and assigns positional arguments. */
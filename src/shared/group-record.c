@@ -112,7 +112,7 @@ static int dispatch_per_machine(const char *name, sd_json_variant *variant, sd_j
                 if (r == 0)
                         continue;
 
-                r = sd_json_dispatch(e, per_machine_dispatch_table, flags, userdata);
+                r = json_dispatch_indexed(e, per_machine_dispatch_table, flags, userdata);
                 if (r < 0)
                         return r;
         }
@@ -211,7 +211,7 @@ int group_record_load(
         if (r < 0)
                 return r;
 
-        r = sd_json_dispatch(h->json, group_dispatch_table, json_flags | SD_JSON_ALLOW_EXTENSIONS, h);
+        r = json_dispatch_indexed(h->json, group_dispatch_table, json_flags | SD_JSON_ALLOW_EXTENSIONS, h);
         if (r < 0)
                 return r;
 
@@ -0,0 +1,319 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "alloc-util.h"
+#include "dirent-util.h"
+#include "errno-util.h"
+#include "fd-util.h"
+#include "inotify-util.h"
+#include "install-cache.h"
+#include "log.h"
+#include "path-lookup.h"
+#include "path-util.h"
+#include "string-util.h"
+#include "strv.h"
+
+/* Events on the directories of the search path, and their .wants/, .requires/, .d/ … subdirectories */
+#define INSTALL_CACHE_DIRECTORY_MASK                                    \
+        (IN_CREATE|IN_DELETE|IN_MOVED_FROM|IN_MOVED_TO|IN_CLOSE_WRITE|IN_ATTRIB| \
+         IN_DELETE_SELF|IN_MOVE_SELF|IN_ONLYDIR)
+
+/* Events on the closest existing parent of a directory of the search path that doesn't exist */
+#define INSTALL_CACHE_PARENT_MASK                                       \
+        (IN_CREATE|IN_MOVED_TO|IN_DELETE_SELF|IN_MOVE_SELF|IN_ONLYDIR)
+
+struct InstallCache {
+        RuntimeScope scope;
+        char *root_dir;
+
+        LookupPaths lookup_paths;
+        bool lookup_paths_valid;
+
+        /* Only set while results are cached, any event on it means they are outdated */
+        int inotify_fd;
+
+        /* unit name → result of unit_file_lookup_state(), as the state + 1, or as negative errno */
+        Hashmap *states;
+        /* unit name → UnitFileList, as returned by unit_file_lookup_list() */
+        Hashmap *list;
+        bool list_valid;
+};
+
+int install_cache_new(RuntimeScope scope, const char *root_dir, InstallCache **ret) {
+        _cleanup_(install_cache_freep) InstallCache *c = NULL;
+
+        assert(scope >= 0);
+        assert(scope < _RUNTIME_SCOPE_MAX);
+        assert(ret);
+
+        c = new(InstallCache, 1);
+        if (!c)
+                return -ENOMEM;
+
+        *c = (InstallCache) {
+                .scope = scope,
+                .inotify_fd = -EBADF,
+        };
+
+        if (strdup_to(&c->root_dir, root_dir) < 0)
+                return -ENOMEM;
+
+        *ret = TAKE_PTR(c);
+        return 0;
+}
+
+static void install_cache_invalidate(InstallCache *c) {
+        assert(c);
+
+        c->states = hashmap_free(c->states);
+        c->list = hashmap_free(c->list);
+        c->list_valid = false;
+        c->inotify_fd = safe_close(c->inotify_fd);
+}
+
+InstallCache* install_cache_free(InstallCache *c) {
+        if (!c)
+                return NULL;
+
+        install_cache_invalidate(c);
+        lookup_paths_done(&c->lookup_paths);
+        free(c->root_dir);
+
+        return mfree(c);
+}
+
+void install_cache_flush(InstallCache *c) {
+        if (!c)
+                return;
+
+        install_cache_invalidate(c);
+        lookup_paths_done(&c->lookup_paths);
+        c->lookup_paths_valid = false;
+}
+
+static void install_cache_check(InstallCache *c) {
+        union inotify_event_buffer buffer;
+        ssize_t l;
+
+        assert(c);
+
+        if (c->inotify_fd < 0)
+                return;
+
+        /* Checked before every lookup, instead of from an event loop, so that changes made right before the
+         * query are always taken into account. Any event means the cached results might be outdated,
+         * there's no need to look at what it is about. */
+        l = read(c->inotify_fd, &buffer, sizeof(buffer));
+        if (l < 0 && ERRNO_IS_TRANSIENT(errno))
+                return;
+        if (l < 0)
+                log_debug_errno(errno, "Failed to read inotify events of unit file directories, flushing install cache: %m");
+        else
+                log_debug("Unit file directories changed, flushing install cache.");
+
+        install_cache_invalidate(c);
+}
+
+static int watch_parent(int fd, const char *path) {
+        _cleanup_free_ char *p = NULL;
+        int r;
+
+        assert(fd >= 0);
+        assert(path);
+
+        r = path_extract_directory(path, &p);
+        if (r < 0)
+                return r;
+
+        for (;;) {
+                _cleanup_free_ char *parent = NULL;
+
+                if (inotify_add_watch(fd, p, INSTALL_CACHE_PARENT_MASK) >= 0)
+                        return 0;
+                if (errno != ENOENT)
+                        return -errno;
+
+                r = path_extract_directory(p, &parent);
+                if (r == -EADDRNOTAVAIL) /* "/" doesn't exist? */
+                        return -ENOENT;
+                if (r < 0)
+                        return r;
+
+                free_and_replace(p, parent);
+        }
+}
+
+static int watch_directory(int fd, const char *path) {
+        _cleanup_closedir_ DIR *d = NULL;
+        int r;
+
+        assert(fd >= 0);
+        assert(path);
+
+        d = opendir(path);
+        if (!d) {
+                if (errno == ENOENT)
+                        return watch_parent(fd, path);
+
+                return -errno;
+        }
+
+        r = inotify_add_watch_fd(fd, dirfd(d), INSTALL_CACHE_DIRECTORY_MASK);
+        if (r < 0)
+                return r;
+
+        FOREACH_DIRENT(de, d, return -errno) {
+                _cleanup_free_ char *p = NULL;
+
+                if (dirent_ensure_type(dirfd(d), de) < 0 || de->d_type != DT_DIR)
+                        continue;
+
+                p = path_join(path, de->d_name);
+                if (!p)
+                        return -ENOMEM;
+
+                if (inotify_add_watch(fd, p, INSTALL_CACHE_DIRECTORY_MASK) < 0 && errno != ENOENT)
+                        return -errno;
+        }
+
+        return 0;
+}
+
+static int install_cache_prepare(InstallCache *c) {
+        _cleanup_close_ int fd = -EBADF;
+        int r;
+
+        assert(c);
+
+        /* Returns > 0 if results may be cached, 0 if not, because we can't tell when they become outdated */
+
+        if (!c->lookup_paths_valid) {
+                r = lookup_paths_init(&c->lookup_paths, c->scope, 0, c->root_dir);
+                if (r < 0)
+                        return r;
+
+                c->lookup_paths_valid = true;
+        }
+
+        if (c->inotify_fd >= 0)
+                return 1;
+
+        /* The watches are set up before looking at the unit files, so that nothing that changes meanwhile
+         * goes unnoticed */
+        fd = inotify_init1(IN_NONBLOCK|IN_CLOEXEC);
+        if (fd < 0) {
+                log_debug_errno(errno, "Failed to allocate inotify fd for unit file directories, not caching install state: %m");
+                return 0;
+        }
+
+        STRV_FOREACH(p, c->lookup_paths.search_path) {
+                r = watch_directory(fd, *p);
+                if (r < 0) {
+                        log_debug_errno(r, "Failed to watch %s, not caching install state: %m", *p);
+                        return 0;
+                }
+        }
+
+        c->inotify_fd = TAKE_FD(fd);
+        return 1;
+}
+
+int install_cache_get_state(InstallCache *c, const char *name, UnitFileState *ret) {
+        UnitFileState state;
+        int r, v;
+
+        assert(c);
+        assert(name);
+
+        install_cache_check(c);
+
+        v = PTR_TO_INT(hashmap_get(c->states, name));
+        if (v < 0)
+                return v;
+        if (v > 0) {
+                if (ret)
+                        *ret = v - 1;
+                return 0;
+        }
+
+        r = install_cache_prepare(c);
+        if (r < 0)
+                return r;
+
+        v = unit_file_lookup_state(c->scope, &c->lookup_paths, name, &state);
+
+        /* Missing units are asked for as much as existing ones, other errors are not cached */
+        if (r > 0 && (v >= 0 || v == -ENOENT)) {
+                _cleanup_free_ char *n = NULL;
+
+                n = strdup(name);
+                if (!n)
+                        return -ENOMEM;
+
+                if (hashmap_ensure_put(&c->states, &string_hash_ops_free, n, INT_TO_PTR(v < 0 ? v : (int) state + 1)) < 0)
+                        return -ENOMEM;
+
+                TAKE_PTR(n);
+        }
+
+        if (v < 0)
+                return v;
+
+        if (ret)
+                *ret = state;
+        return 0;
+}
+
+int install_cache_get_list(InstallCache *c, Hashmap **ret) {
+        UnitFileList *item;
+        const char *name;
+        int r;
+
+        assert(c);
+        assert(ret);
+
+        install_cache_check(c);
+
+        if (c->list_valid) {
+                *ret = c->list;
+                return 0;
+        }
+
+        c->list = hashmap_free(c->list);
+
+        r = install_cache_prepare(c);
+        if (r < 0)
+                return r;
+
+        r = unit_file_lookup_list(c->scope, &c->lookup_paths, /* states= */ NULL, /* patterns= */ NULL, &c->list);
+        if (r < 0)
+                return r;
+
+        /* Also answers the state queries of the units listed, except for those whose state couldn't be
+         * determined, as unit_file_lookup_state() returns an error then. If the results can't be cached,
+         * the list is kept only until the next call. */
+        if (c->inotify_fd >= 0)
+                HASHMAP_FOREACH_KEY(item, name, c->list) {
+                        _cleanup_free_ char *n = NULL;
+
+                        if (item->state == UNIT_FILE_BAD || hashmap_contains(c->states, name))
+                                continue;
+
+                        n = strdup(name);
+                        if (!n)
+                                return -ENOMEM;
+
+                        r = hashmap_ensure_put(&c->states, &string_hash_ops_free, n, INT_TO_PTR((int) item->state + 1));
+                        if (r < 0)
+                                return r;
+
+                        TAKE_PTR(n);
+                }
+
+        c->list_valid = c->inotify_fd >= 0;
+
+        *ret = c->list;
+        return 0;
+}
@@ -0,0 +1,27 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+#pragma once
+
+#include "hashmap.h"
+#include "install.h"
+#include "macro.h"
+#include "runtime-scope.h"
+
+/* Caches what unit_file_get_state() and unit_file_get_list() return, until a unit file, drop-in or symlink
+ * in the unit search path changes, which is noticed through inotify. Meant for long-running processes that
+ * answer such queries over and over, i.e. the service manager. */
+
+typedef struct InstallCache InstallCache;
+
+int install_cache_new(RuntimeScope scope, const char *root_dir, InstallCache **ret);
+InstallCache* install_cache_free(InstallCache *c);
+DEFINE_TRIVIAL_CLEANUP_FUNC(InstallCache*, install_cache_free);
+
+/* Drops everything, including the search path, e.g. on daemon-reload, or because unit files were changed in
+ * ways inotify might not tell, such as by linking unit files from outside the search path */
+void install_cache_flush(InstallCache *c);
+
+int install_cache_get_state(InstallCache *c, const char *name, UnitFileState *ret);
+
+/* Returns all unit files, as a hashmap of unit names to UnitFileList, owned by the cache, and valid until it
+ * is used the next time. */
+int install_cache_get_list(InstallCache *c, Hashmap **ret);
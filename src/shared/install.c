@@ -95,6 +95,10 @@ void unit_file_presets_done(UnitFilePresets *p) {
         if (!p)
                 return;
 
+        p->literal_rules = hashmap_free(p->literal_rules);
+        p->other_rules = mfree(p->other_rules);
+        p->n_other_rules = 0;
+
         FOREACH_ARRAY(rule, p->rules, p->n_rules)
                 unit_file_preset_rule_done(rule);
 
@@ -3303,6 +3307,43 @@ static int presets_find_config(RuntimeScope scope, const char *root_dir, char **
         return conf_files_list_strv(files, ".preset", root_dir, 0, dirs);
 }
 
+static bool preset_rule_is_literal(const UnitFilePresetRule *rule) {
+        assert(rule);
+
+        /* Whether the rule matches a single unit name only, by plain string comparison. (We match with
+         * FNM_NOESCAPE, hence backslashes are not special.) */
+        return !rule->instances && !strpbrk(rule->pattern, "*?[");
+}
+
+static int presets_build_index(UnitFilePresets *presets) {
+        assert(presets);
+
+        /* Rules for individual unit names are looked up via a hash table, all others are tried in order,
+         * but only as long as they come before the rule found in the table, so that the first matching
+         * rule still wins. Typically, large preset policies are mostly made of the former. */
+
+        for (size_t i = 0; i < presets->n_rules; i++) {
+                UnitFilePresetRule *rule = presets->rules + i;
+                int r;
+
+                if (preset_rule_is_literal(rule)) {
+                        /* Only the first rule for a name can ever match */
+                        r = hashmap_ensure_put(&presets->literal_rules, &string_hash_ops, rule->pattern, SIZE_TO_PTR(i + 1));
+                        if (r < 0 && r != -EEXIST)
+                                return r;
+
+                        continue;
+                }
+
+                if (!GREEDY_REALLOC(presets->other_rules, presets->n_other_rules + 1))
+                        return -ENOMEM;
+
+                presets->other_rules[presets->n_other_rules++] = i;
+        }
+
+        return 0;
+}
+
 static int read_presets(RuntimeScope scope, const char *root_dir, UnitFilePresets *presets) {
         _cleanup_(unit_file_presets_done) UnitFilePresets ps = {};
         _cleanup_strv_free_ char **files = NULL;
@@ -3405,6 +3446,10 @@ static int read_presets(RuntimeScope scope, const char *root_dir, UnitFilePreset
                 }
         }
 
+        r = presets_build_index(&ps);
+        if (r < 0)
+                return r;
+
         ps.initialized = true;
         *presets = TAKE_STRUCT(ps);
 
@@ -3466,6 +3511,7 @@ static int pattern_match_multiple_instances(
 
 static int query_presets(const char *name, const UnitFilePresets *presets, char ***instance_name_list) {
         PresetAction action = PRESET_UNKNOWN;
+        size_t best;
 
         assert(name);
         assert(presets);
@@ -3473,12 +3519,26 @@ static int query_presets(const char *name, const UnitFilePresets *presets, char
         if (!unit_name_is_valid(name, UNIT_NAME_ANY))
                 return -EINVAL;
 
-        FOREACH_ARRAY(i, presets->rules, presets->n_rules)
+        /* The first rule for exactly this name, if there is any. Zero means none. */
+        best = PTR_TO_SIZE(hashmap_get(presets->literal_rules, name));
+        if (best > 0)
+                action = presets->rules[best - 1].action;
+
+        /* Then check if any of the other rules that precede it matches */
+        FOREACH_ARRAY(j, presets->other_rules, presets->n_other_rules) {
+                const UnitFilePresetRule *i = presets->rules + *j;
+
+                if (best > 0 && *j >= best - 1)
+                        break;
+
+                /* Skip the fnmatch() call if the literal prefix of the pattern doesn't match already */
                 if (pattern_match_multiple_instances(*i, name, instance_name_list) > 0 ||
-                    fnmatch(i->pattern, name, FNM_NOESCAPE) == 0) {
+                    (strneq(i->pattern, name, strcspn(i->pattern, "*?[")) &&
+                     fnmatch(i->pattern, name, FNM_NOESCAPE) == 0)) {
                         action = i->action;
                         break;
                 }
+        }
 
         switch (action) {
 
@@ -3750,26 +3810,22 @@ DEFINE_PRIVATE_HASH_OPS_FULL(unit_file_list_hash_ops_free_free,
                              char, string_hash_func, string_compare_func, free,
                              UnitFileList, unit_file_list_free);
 
-int unit_file_get_list(
+int unit_file_lookup_list(
                 RuntimeScope scope,
-                const char *root_dir,
+                const LookupPaths *lp,
                 char * const *states,
                 char * const *patterns,
                 Hashmap **ret) {
 
-        _cleanup_(lookup_paths_done) LookupPaths lp = {};
         _cleanup_hashmap_free_ Hashmap *h = NULL;
         int r;
 
         assert(scope >= 0);
         assert(scope < _RUNTIME_SCOPE_MAX);
+        assert(lp);
         assert(ret);
 
-        r = lookup_paths_init(&lp, scope, 0, root_dir);
-        if (r < 0)
-                return r;
-
-        STRV_FOREACH(dirname, lp.search_path) {
+        STRV_FOREACH(dirname, lp->search_path) {
                 _cleanup_closedir_ DIR *d = NULL;
 
                 d = opendir(*dirname);
@@ -3799,7 +3855,7 @@ int unit_file_get_list(
 
                         UnitFileState state;
 
-                        r = unit_file_lookup_state(scope, &lp, de->d_name, &state);
+                        r = unit_file_lookup_state(scope, lp, de->d_name, &state);
                         if (r < 0)
                                 state = UNIT_FILE_BAD;
 
@@ -3836,6 +3892,27 @@ int unit_file_get_list(
         return 0;
 }
 
+int unit_file_get_list(
+                RuntimeScope scope,
+                const char *root_dir,
+                char * const *states,
+                char * const *patterns,
+                Hashmap **ret) {
+
+        _cleanup_(lookup_paths_done) LookupPaths lp = {};
+        int r;
+
+        assert(scope >= 0);
+        assert(scope < _RUNTIME_SCOPE_MAX);
+        assert(ret);
+
+        r = lookup_paths_init(&lp, scope, 0, root_dir);
+        if (r < 0)
+                return r;
+
+        return unit_file_lookup_list(scope, &lp, states, patterns, ret);
+}
+
 static const char* const unit_file_state_table[_UNIT_FILE_STATE_MAX] = {
         [UNIT_FILE_ENABLED]         = "enabled",
         [UNIT_FILE_ENABLED_RUNTIME] = "enabled-runtime",
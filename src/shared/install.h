@@ -199,6 +199,7 @@ static inline int unit_file_exists(RuntimeScope scope, const LookupPaths *paths,
         return unit_file_exists_full(scope, paths, name, NULL);
 }
 
+int unit_file_lookup_list(RuntimeScope scope, const LookupPaths *lp, char * const *states, char * const *patterns, Hashmap **ret);
 int unit_file_get_list(RuntimeScope scope, const char *root_dir, char * const *states, char * const *patterns, Hashmap **ret);
 
 InstallChangeType install_changes_add(InstallChange **changes, size_t *n_changes, InstallChangeType type, const char *path, const char *source);
@@ -224,6 +225,12 @@ typedef struct UnitFilePresetRule UnitFilePresetRule;
 typedef struct {
         UnitFilePresetRule *rules;
         size_t n_rules;
+
+        /* Index over the rules above, so that we don't have to try each of them for each unit */
+        Hashmap *literal_rules;    /* unit name → index + 1 of the first rule matching only that name */
+        size_t *other_rules;       /* indices of all other rules, i.e. globs and rules with instances */
+        size_t n_other_rules;
+
         bool initialized;
 } UnitFilePresets;
 
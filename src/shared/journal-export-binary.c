@@ -0,0 +1,361 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include "alloc-util.h"
+#include "errno-util.h"
+#include "hashmap.h"
+#include "journal-export-binary.h"
+#include "journal-internal.h"
+#include "journal-util.h"
+#include "stdio-util.h"
+#include "string-util.h"
+#include "unaligned.h"
+
+struct JournalBinaryExporter {
+        Hashmap *names;            /* field name → index in the dictionary + 1 */
+        bool header_written;
+
+        Compressor *compressor;    /* NULL if the stream is not compressed */
+
+        /* The blocks not written yet: a single entry block if the stream is not compressed, otherwise
+         * the current batch */
+        uint8_t *buffer;
+        size_t buffer_size;
+
+        uint8_t *compressed;
+        size_t compressed_size;
+};
+
+int journal_binary_exporter_new(Compression compression, JournalBinaryExporter **ret) {
+        _cleanup_(journal_binary_exporter_freep) JournalBinaryExporter *e = NULL;
+        int r;
+
+        assert(ret);
+
+        e = new0(JournalBinaryExporter, 1);
+        if (!e)
+                return -ENOMEM;
+
+        if (compression != COMPRESSION_NONE) {
+                /* Only zstd is defined for batches */
+                if (compression != COMPRESSION_ZSTD)
+                        return -EOPNOTSUPP;
+
+                r = compressor_new(compression, &e->compressor);
+                if (r < 0)
+                        return r;
+        }
+
+        *ret = TAKE_PTR(e);
+        return 0;
+}
+
+JournalBinaryExporter* journal_binary_exporter_free(JournalBinaryExporter *e) {
+        if (!e)
+                return NULL;
+
+        hashmap_free(e->names);
+        compressor_free(e->compressor);
+        free(e->buffer);
+        free(e->compressed);
+
+        return mfree(e);
+}
+
+static void block_header_write(uint8_t *p, const char *type, size_t size) {
+        memcpy(p, type, JOURNAL_EXPORT_BINARY_TYPE_SIZE);
+        unaligned_write_le32(p + JOURNAL_EXPORT_BINARY_TYPE_SIZE, size);
+}
+
+static uint8_t* exporter_extend(JournalBinaryExporter *e, size_t size) {
+        uint8_t *p;
+
+        assert(e);
+
+        if (!GREEDY_REALLOC(e->buffer, e->buffer_size + size))
+                return NULL;
+
+        p = e->buffer + e->buffer_size;
+        e->buffer_size += size;
+
+        return p;
+}
+
+static int exporter_add_field(
+                JournalBinaryExporter *e,
+                const char *name,
+                size_t name_len,
+                const void *value,
+                size_t value_len) {
+
+        unsigned idx;
+        uint8_t *p;
+        char *n;
+        int r;
+
+        assert(e);
+        assert(name);
+        assert(name_len > 0 && name_len <= 64);
+        assert(value || value_len == 0);
+
+        if (value_len > UINT32_MAX)
+                return -E2BIG;
+
+        n = strndupa_safe(name, name_len);
+
+        idx = PTR_TO_UINT(hashmap_get(e->names, n));
+        if (idx > 0) {
+                p = exporter_extend(e, sizeof(uint16_t) + sizeof(uint32_t) + value_len);
+                if (!p)
+                        return -ENOMEM;
+
+                unaligned_write_le16(p, idx - 1);
+                p += sizeof(uint16_t);
+        } else {
+                p = exporter_extend(e, 2 * sizeof(uint16_t) + name_len + sizeof(uint32_t) + value_len);
+                if (!p)
+                        return -ENOMEM;
+
+                unaligned_write_le16(p, JOURNAL_EXPORT_BINARY_NAME_NEW);
+                unaligned_write_le16(p + sizeof(uint16_t), name_len);
+                p = mempcpy(p + 2 * sizeof(uint16_t), name, name_len);
+
+                /* Once the dictionary is full, further names are sent inline every time */
+                if (hashmap_size(e->names) < JOURNAL_EXPORT_BINARY_NAMES_MAX) {
+                        _cleanup_free_ char *k = NULL;
+
+                        k = strdup(n);
+                        if (!k)
+                                return -ENOMEM;
+
+                        r = hashmap_ensure_put(&e->names, &string_hash_ops_free, k, UINT_TO_PTR(hashmap_size(e->names) + 1));
+                        if (r < 0)
+                                return r;
+
+                        TAKE_PTR(k);
+                }
+        }
+
+        unaligned_write_le32(p, value_len);
+        memcpy_safe(p + sizeof(uint32_t), value, value_len);
+
+        return 0;
+}
+
+static int exporter_add_field_string(JournalBinaryExporter *e, const char *name, const char *value) {
+        return exporter_add_field(e, name, strlen(name), value, strlen(value));
+}
+
+static int exporter_add_field_uint64(JournalBinaryExporter *e, const char *name, uint64_t value) {
+        char buf[DECIMAL_STR_MAX(uint64_t)];
+
+        xsprintf(buf, "%" PRIu64, value);
+        return exporter_add_field_string(e, name, buf);
+}
+
+static void exporter_forget_names(JournalBinaryExporter *e, unsigned n_names) {
+        void *v;
+        char *k;
+
+        assert(e);
+
+        /* Drops the names added to the dictionary since it had n_names entries, if the entry that
+         * introduced them is not written after all. */
+
+        HASHMAP_FOREACH_KEY(v, k, e->names)
+                if (PTR_TO_UINT(v) > n_names)
+                        free(hashmap_remove(e->names, k));
+}
+
+static int exporter_write(const void *p, size_t size, FILE *f) {
+        assert(p || size == 0);
+        assert(f);
+
+        if (size > 0 && fwrite(p, 1, size, f) != size)
+                return errno_or_else(EIO);
+
+        return 0;
+}
+
+static int compressed_append(const void *data, size_t size, void *userdata) {
+        JournalBinaryExporter *e = ASSERT_PTR(userdata);
+
+        if (!GREEDY_REALLOC(e->compressed, e->compressed_size + size))
+                return -ENOMEM;
+
+        memcpy(e->compressed + e->compressed_size, data, size);
+        e->compressed_size += size;
+
+        return 0;
+}
+
+int journal_binary_exporter_flush(JournalBinaryExporter *e, FILE *f) {
+        int r;
+
+        assert(e);
+        assert(f);
+
+        if (e->buffer_size == 0)
+                return 0;
+
+        if (!e->compressor) {
+                r = exporter_write(e->buffer, e->buffer_size, f);
+                e->buffer_size = 0;
+                return r;
+        }
+
+        /* Each batch is a separate frame, hence it may be decompressed as soon as it was received */
+        e->compressed_size = JOURNAL_EXPORT_BINARY_BLOCK_HEADER_SIZE;
+        if (!GREEDY_REALLOC(e->compressed, e->compressed_size))
+                return -ENOMEM;
+
+        r = compressor_push(e->compressor, e->buffer, e->buffer_size, /* end= */ true, compressed_append, e);
+        if (r < 0)
+                return r;
+
+        e->buffer_size = 0;
+
+        if (e->compressed_size - JOURNAL_EXPORT_BINARY_BLOCK_HEADER_SIZE > UINT32_MAX)
+                return -E2BIG;
+
+        block_header_write(e->compressed, JOURNAL_EXPORT_BINARY_ZSTD,
+                           e->compressed_size - JOURNAL_EXPORT_BINARY_BLOCK_HEADER_SIZE);
+
+        return exporter_write(e->compressed, e->compressed_size, f);
+}
+
+int journal_binary_exporter_add(JournalBinaryExporter *e, FILE *f, sd_journal *j, const Set *output_fields) {
+        sd_id128_t journal_boot_id, seqnum_id;
+        _cleanup_free_ char *cursor = NULL;
+        usec_t monotonic, realtime;
+        size_t start, length;
+        unsigned n_names;
+        uint32_t n_fields = 0;
+        const void *data;
+        uint64_t seqnum;
+        int r;
+
+        assert(e);
+        assert(f);
+        assert(j);
+
+        (void) sd_journal_set_data_threshold(j, 0);
+
+        r = sd_journal_get_cursor(j, &cursor);
+        if (r < 0)
+                return log_error_errno(r, "Failed to get cursor: %m");
+
+        r = sd_journal_get_realtime_usec(j, &realtime);
+        if (r < 0)
+                return log_error_errno(r, "Failed to get realtime timestamp: %m");
+
+        r = sd_journal_get_monotonic_usec(j, &monotonic, &journal_boot_id);
+        if (r < 0)
+                return log_error_errno(r, "Failed to get monotonic timestamp: %m");
+
+        r = sd_journal_get_seqnum(j, &seqnum, &seqnum_id);
+        if (r < 0)
+                return log_error_errno(r, "Failed to get seqnum: %m");
+
+        if (!e->header_written) {
+                uint8_t header[JOURNAL_EXPORT_BINARY_BLOCK_HEADER_SIZE + sizeof(uint32_t)];
+
+                /* The header is never part of a compressed batch, so that the stream type can be told
+                 * right away */
+                block_header_write(header, JOURNAL_EXPORT_BINARY_HEADER, sizeof(uint32_t));
+                unaligned_write_le32(header + JOURNAL_EXPORT_BINARY_BLOCK_HEADER_SIZE, JOURNAL_EXPORT_BINARY_VERSION);
+
+                r = exporter_write(header, sizeof(header), f);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to write export stream header: %m");
+
+                e->header_written = true;
+        }
+
+        start = e->buffer_size;
+        n_names = hashmap_size(e->names);
+
+        /* The block header and the field count are filled in once all fields are known */
+        if (!exporter_extend(e, JOURNAL_EXPORT_BINARY_BLOCK_HEADER_SIZE + sizeof(uint32_t)))
+                return log_oom();
+
+        r = exporter_add_field_string(e, "__CURSOR", cursor);
+        if (r >= 0)
+                r = exporter_add_field_uint64(e, "__REALTIME_TIMESTAMP", realtime);
+        if (r >= 0)
+                r = exporter_add_field_uint64(e, "__MONOTONIC_TIMESTAMP", monotonic);
+        if (r >= 0)
+                r = exporter_add_field_uint64(e, "__SEQNUM", seqnum);
+        if (r >= 0)
+                r = exporter_add_field_string(e, "__SEQNUM_ID", SD_ID128_TO_STRING(seqnum_id));
+        if (r >= 0)
+                r = exporter_add_field_string(e, "_BOOT_ID", SD_ID128_TO_STRING(journal_boot_id));
+        if (r < 0) {
+                r = log_error_errno(r, "Failed to export entry metadata: %m");
+                goto fail;
+        }
+        n_fields += 6;
+
+        JOURNAL_FOREACH_DATA_RETVAL(j, data, length, r) {
+                size_t fieldlen;
+                const char *c;
+
+                /* We already added the boot id from the data in the header, hence let's suppress it here */
+                if (memory_startswith(data, length, "_BOOT_ID="))
+                        continue;
+
+                c = memchr(data, '=', length);
+                if (!c) {
+                        r = log_error_errno(SYNTHETIC_ERRNO(EINVAL), "Invalid field.");
+                        goto fail;
+                }
+
+                fieldlen = c - (const char*) data;
+                if (!journal_field_valid(data, fieldlen, true)) {
+                        r = log_error_errno(SYNTHETIC_ERRNO(EINVAL), "Invalid field.");
+                        goto fail;
+                }
+
+                if (output_fields && !set_contains(output_fields, strndupa_safe(data, fieldlen)))
+                        continue;
+
+                r = exporter_add_field(e, data, fieldlen, c + 1, length - fieldlen - 1);
+                if (r < 0) {
+                        r = log_error_errno(r, "Failed to export field: %m");
+                        goto fail;
+                }
+
+                n_fields++;
+        }
+        if (IN_SET(r, -EADDRNOTAVAIL, -EBADMSG)) {
+                log_debug_errno(r, "Skipping message we can't read: %m");
+                r = 0;
+                goto fail;
+        }
+        if (r < 0)
+                goto fail;
+
+        if (e->buffer_size - start - JOURNAL_EXPORT_BINARY_BLOCK_HEADER_SIZE > UINT32_MAX) {
+                r = log_error_errno(SYNTHETIC_ERRNO(E2BIG), "Entry too large for the binary export format.");
+                goto fail;
+        }
+
+        block_header_write(e->buffer + start, JOURNAL_EXPORT_BINARY_ENTRY,
+                           e->buffer_size - start - JOURNAL_EXPORT_BINARY_BLOCK_HEADER_SIZE);
+        unaligned_write_le32(e->buffer + start + JOURNAL_EXPORT_BINARY_BLOCK_HEADER_SIZE, n_fields);
+
+        if (e->compressor && e->buffer_size < JOURNAL_EXPORT_BINARY_BATCH_SIZE)
+                return 0;
+
+        r = journal_binary_exporter_flush(e, f);
+        if (r < 0)
+                return log_error_errno(r, "Failed to write exported entries: %m");
+
+        return 0;
+
+fail:
+        /* Drop the partial entry, and the names only it would have introduced */
+        e->buffer_size = start;
+        exporter_forget_names(e, n_names);
+
+        return r;
+}
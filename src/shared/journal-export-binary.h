@@ -0,0 +1,46 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+#pragma once
+
+#include <stdio.h>
+
+#include "sd-journal.h"
+
+#include "compress.h"
+#include "macro.h"
+#include "set.h"
+
+/* The binary variant of the journal export format, see docs/JOURNAL_EXPORT_FORMATS.md for details. A stream
+ * is a sequence of blocks, each starting with a four byte type and a le32 payload size. All block types
+ * start with the 0x1E byte, which never starts a stream in the text format, hence the two formats may be
+ * told apart by the first byte of a stream. */
+
+#define JOURNAL_EXPORT_BINARY_MAGIC_BYTE '\036'
+#define JOURNAL_EXPORT_BINARY_TYPE_SIZE 4U
+#define JOURNAL_EXPORT_BINARY_BLOCK_HEADER_SIZE 8U
+
+/* Starts the stream, and resets the field name dictionary. Its payload is the le32 format version. */
+#define JOURNAL_EXPORT_BINARY_HEADER "\036JXH"
+/* A single entry: le32 field count, followed by that many fields. */
+#define JOURNAL_EXPORT_BINARY_ENTRY "\036JXE"
+/* A zstd frame, which decompresses to a sequence of entry blocks. */
+#define JOURNAL_EXPORT_BINARY_ZSTD "\036JXZ"
+
+#define JOURNAL_EXPORT_BINARY_VERSION 1U
+
+/* Each field starts with the le16 index of its name in the dictionary, or with this value, followed by the
+ * le16 name length and the name itself, which is then appended to the dictionary, unless it is full
+ * already. The le32 value size and the value follow. */
+#define JOURNAL_EXPORT_BINARY_NAME_NEW UINT16_MAX
+#define JOURNAL_EXPORT_BINARY_NAMES_MAX ((size_t) UINT16_MAX)
+
+/* Entries are collected into batches of about this size before they are compressed */
+#define JOURNAL_EXPORT_BINARY_BATCH_SIZE (256U*1024U)
+
+typedef struct JournalBinaryExporter JournalBinaryExporter;
+
+int journal_binary_exporter_new(Compression compression, JournalBinaryExporter **ret);
+JournalBinaryExporter* journal_binary_exporter_free(JournalBinaryExporter *e);
+DEFINE_TRIVIAL_CLEANUP_FUNC(JournalBinaryExporter*, journal_binary_exporter_free);
+
+int journal_binary_exporter_add(JournalBinaryExporter *e, FILE *f, sd_journal *j, const Set *output_fields);
+int journal_binary_exporter_flush(JournalBinaryExporter *e, FILE *f);
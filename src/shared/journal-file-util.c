@@ -8,6 +8,8 @@
 #include "errno-util.h"
 #include "fd-util.h"
 #include "format-util.h"
+#include "fs-util.h"
+#include "iovec-util.h"
 #include "journal-authenticate.h"
 #include "journal-file-util.h"
 #include "path-util.h"
@@ -15,6 +17,7 @@
 #include "set.h"
 #include "stat-util.h"
 #include "sync-util.h"
+#include "tmpfile-util.h"
 
 #define PAYLOAD_BUFFER_SIZE (16U * 1024U)
 #define MINIMUM_HOLE_SIZE (1U * 1024U * 1024U / 2U)
@@ -429,11 +432,39 @@ JournalFile* journal_file_initiate_close(JournalFile *f, Set *deferred_closes) {
         return journal_file_offline_close(f);
 }
 
+static int journal_file_rotate_zstd_dictionary(
+                JournalFile *f,
+                JournalFile *template,
+                const struct iovec *zstd_dictionary) {
+
+        _cleanup_free_ void *trained = NULL;
+        size_t size;
+        int r;
+
+        assert(f);
+        assert(template);
+
+        if (!JOURNAL_HEADER_ZSTD_DICTIONARY(f->header))
+                return 0;
+
+        /* Use the dictionary we have been told to use, otherwise train a new one from the file we just
+         * archived, as the new file is likely to contain similar data. */
+        if (iovec_is_set(zstd_dictionary))
+                return journal_file_set_zstd_dictionary(f, zstd_dictionary->iov_base, zstd_dictionary->iov_len);
+
+        r = journal_file_train_zstd_dictionary(template, &trained, &size);
+        if (r <= 0)
+                return r;
+
+        return journal_file_set_zstd_dictionary(f, trained, size);
+}
+
 int journal_file_rotate(
                 JournalFile **f,
                 MMapCache *mmap_cache,
                 JournalFileFlags file_flags,
                 uint64_t compress_threshold_bytes,
+                const struct iovec *zstd_dictionary,
                 Set *deferred_closes) {
 
         _cleanup_free_ char *path = NULL;
@@ -461,6 +492,13 @@ int journal_file_rotate(
                         mmap_cache,
                         /* template= */ *f,
                         &new_file);
+        if (r >= 0) {
+                int k;
+
+                k = journal_file_rotate_zstd_dictionary(new_file, *f, zstd_dictionary);
+                if (k < 0)
+                        log_debug_errno(k, "Failed to set up ZSTD dictionary for %s, ignoring: %m", new_file->path);
+        }
 
         journal_file_initiate_close(*f, deferred_closes);
         *f = new_file;
@@ -468,6 +506,101 @@ int journal_file_rotate(
         return r;
 }
 
+int journal_file_compact(JournalFile *from, MMapCache *mmap_cache, uint64_t *ret_size) {
+        _cleanup_(unlink_and_freep) char *tmp = NULL;
+        _cleanup_(journal_file_closep) JournalFile *to = NULL;
+        _cleanup_close_ int fd = -EBADF;
+        JournalFileFlags file_flags = JOURNAL_COMPRESS;
+        JournalMetrics metrics;
+        struct stat st;
+        int r;
+
+        assert(from);
+        assert(from->header);
+        assert(mmap_cache);
+
+        /* Rewrites an archived journal file for faster reading, see journal_file_copy_compacted(), and
+         * atomically replaces the original file with the result. */
+
+        if (from->header->state != STATE_ARCHIVED)
+                return log_debug_errno(SYNTHETIC_ERRNO(EBUSY), "%s is not archived, refusing to compact.", from->path);
+
+        /* We cannot re-seal the file, and dropping the seal would defeat its purpose. */
+        if (JOURNAL_HEADER_SEALED(from->header))
+                return log_debug_errno(SYNTHETIC_ERRNO(EPERM), "%s is sealed, refusing to compact.", from->path);
+
+        if (path_startswith(from->path, "/proc/self/fd"))
+                return log_debug_errno(SYNTHETIC_ERRNO(EINVAL), "Path of %s is not known, refusing to compact.", from->path);
+
+        fd = open_tmpfile_linkable(from->path, O_RDWR|O_CLOEXEC, &tmp);
+        if (fd < 0)
+                return log_debug_errno(fd, "Failed to create temporary file next to %s: %m", from->path);
+
+        r = fchmod_and_chown(fd, from->last_stat.st_mode & 07777, from->last_stat.st_uid, from->last_stat.st_gid);
+        if (r < 0)
+                log_debug_errno(r, "Failed to copy access mode and ownership of %s, ignoring: %m", from->path);
+
+        /* This copies the ACLs that journald sets on user journal files, too. */
+        r = copy_xattr(from->fd, NULL, fd, NULL, COPY_ALL_XATTRS);
+        if (r < 0)
+                log_debug_errno(r, "Failed to copy extended attributes of %s, ignoring: %m", from->path);
+
+        /* Archived files are supposed to have copy-on-write enabled, see journal_file_set_offline().
+         * Clearing the flag is only reliable while the file is still empty. */
+        r = chattr_fd(fd, 0, FS_NOCOW_FL, NULL);
+        if (r < 0)
+                log_debug_errno(r, "Failed to enable copy-on-write for the compacted version of %s, ignoring: %m", from->path);
+
+        if (JOURNAL_HEADER_ZSTD_DICTIONARY(from->header))
+                file_flags |= JOURNAL_ZSTD_DICTIONARY;
+
+        /* The data hash table gets one item per 768 bytes of the maximum file size. The compacted file is
+         * not going to grow after we are done with it, hence size the table after the actual contents
+         * instead of the configured maximum, while leaving plenty of room for the copy. */
+        journal_reset_metrics(&metrics);
+        metrics.max_size = (uint64_t) from->last_stat.st_size * 2;
+        if (JOURNAL_HEADER_CONTAINS(from->header, n_data))
+                metrics.max_size = MAX(metrics.max_size, le64toh(from->header->n_data) * 768);
+
+        r = journal_file_open(
+                        fd,
+                        from->path,
+                        O_RDWR,
+                        file_flags,
+                        from->last_stat.st_mode & 07777,
+                        /* compress_threshold_bytes= */ UINT64_MAX,
+                        &metrics,
+                        mmap_cache,
+                        /* template= */ NULL,
+                        &to);
+        if (r < 0)
+                return log_debug_errno(r, "Failed to open compacted version of %s: %m", from->path);
+        TAKE_FD(fd);
+
+        r = journal_file_copy_compacted(from, to);
+        if (r < 0)
+                return log_debug_errno(r, "Failed to copy entries of %s: %m", from->path);
+
+        to->archive = true;
+        r = journal_file_set_offline(to, /* wait= */ true);
+        if (r < 0)
+                return log_debug_errno(r, "Failed to set compacted version of %s offline: %m", from->path);
+
+        r = link_tmpfile(to->fd, tmp, from->path, LINK_TMPFILE_REPLACE|LINK_TMPFILE_SYNC);
+        if (r < 0)
+                return log_debug_errno(r, "Failed to replace %s by its compacted version: %m", from->path);
+        tmp = mfree(tmp);
+
+        if (ret_size) {
+                if (fstat(to->fd, &st) < 0)
+                        return -errno;
+
+                *ret_size = (uint64_t) st.st_blocks * 512;
+        }
+
+        return 0;
+}
+
 int journal_file_open_reliably(
                 const char *fname,
                 int open_flags,
@@ -25,4 +25,7 @@ int journal_file_rotate(
                 MMapCache *mmap_cache,
                 JournalFileFlags file_flags,
                 uint64_t compress_threshold_bytes,
+                const struct iovec *zstd_dictionary,
                 Set *deferred_closes);
+
+int journal_file_compact(JournalFile *from, MMapCache *mmap_cache, uint64_t *ret_size);
@@ -9,6 +9,7 @@
 #include "escape.h"
 #include "fd-util.h"
 #include "io-util.h"
+#include "journal-export-binary.h"
 #include "journal-file.h"
 #include "journal-importer.h"
 #include "journal-util.h"
@@ -18,10 +19,13 @@
 #include "unaligned.h"
 
 enum {
-        IMPORTER_STATE_LINE = 0,    /* waiting to read, or reading line */
+        IMPORTER_STATE_START = 0,   /* waiting for the first byte, to tell the format of the stream */
+        IMPORTER_STATE_LINE,        /* waiting to read, or reading line */
         IMPORTER_STATE_DATA_START,  /* reading binary data header */
         IMPORTER_STATE_DATA,        /* reading binary data */
         IMPORTER_STATE_DATA_FINISH, /* expecting newline */
+        IMPORTER_STATE_BINARY,      /* reading a block of the binary format */
+        IMPORTER_STATE_BATCH,       /* processing the entries of a decompressed batch */
         IMPORTER_STATE_EOF,         /* done */
 };
 
@@ -34,6 +38,17 @@ void journal_importer_cleanup(JournalImporter *imp) {
         free(imp->name);
         free(imp->buf);
         iovw_free_contents(&imp->iovw, false);
+
+        FOREACH_ARRAY(n, imp->names, imp->n_names)
+                free(*n);
+        free(imp->names);
+        free(imp->fields);
+        free(imp->batch);
+        decompressor_free(imp->decompressor);
+}
+
+static bool importer_is_binary(const JournalImporter *imp) {
+        return IN_SET(imp->state, IMPORTER_STATE_BINARY, IMPORTER_STATE_BATCH);
 }
 
 static char* realloc_buffer(JournalImporter *imp, size_t size) {
@@ -43,7 +58,9 @@ static char* realloc_buffer(JournalImporter *imp, size_t size) {
         if (!b)
                 return NULL;
 
-        iovw_rebase(&imp->iovw, old, imp->buf);
+        /* In the binary format, the iovw points to the separate field buffer instead */
+        if (!importer_is_binary(imp))
+                iovw_rebase(&imp->iovw, old, imp->buf);
 
         return b;
 }
@@ -79,10 +96,12 @@ static int get_line(JournalImporter *imp, char **line, size_t *size) {
                         return -EAGAIN;
 
                 /* We know that imp->filled is at most DATA_SIZE_MAX, so if
-                   we reallocate it, we'll increase the size at least a bit. */
+                   we reallocate it, we'll increase the size at least a bit.
+                   Make room for an entry of the size seen recently right away,
+                   so that it can be read in one go. */
                 assert_cc(DATA_SIZE_MAX < ENTRY_SIZE_MAX);
                 if (MALLOC_SIZEOF_SAFE(imp->buf) - imp->filled < LINE_CHUNK &&
-                    !realloc_buffer(imp, MIN(imp->filled + LINE_CHUNK, ENTRY_SIZE_MAX)))
+                    !realloc_buffer(imp, MIN(imp->filled + MAX(LINE_CHUNK, imp->entry_size), ENTRY_SIZE_MAX)))
                                 return log_oom();
 
                 assert(imp->buf);
@@ -116,15 +135,15 @@ static int get_line(JournalImporter *imp, char **line, size_t *size) {
         return 1;
 }
 
-static int fill_fixed_size(JournalImporter *imp, void **data, size_t size) {
+static int fill_buffer(JournalImporter *imp, size_t size) {
+
+        /* Makes sure that at least size bytes of live data are in the buffer, without consuming them */
 
         assert(imp);
-        assert(IN_SET(imp->state, IMPORTER_STATE_DATA_START, IMPORTER_STATE_DATA, IMPORTER_STATE_DATA_FINISH));
-        assert(size <= DATA_SIZE_MAX);
+        assert(size <= ENTRY_SIZE_MAX);
         assert(imp->offset <= imp->filled);
         assert(imp->filled <= MALLOC_SIZEOF_SAFE(imp->buf));
         assert(imp->fd >= 0);
-        assert(data);
 
         while (imp->filled - imp->offset < size) {
                 ssize_t n;
@@ -154,6 +173,21 @@ static int fill_fixed_size(JournalImporter *imp, void **data, size_t size) {
                 imp->filled += n;
         }
 
+        return 1;
+}
+
+static int fill_fixed_size(JournalImporter *imp, void **data, size_t size) {
+        int r;
+
+        assert(imp);
+        assert(IN_SET(imp->state, IMPORTER_STATE_DATA_START, IMPORTER_STATE_DATA, IMPORTER_STATE_DATA_FINISH));
+        assert(size <= DATA_SIZE_MAX);
+        assert(data);
+
+        r = fill_buffer(imp, size);
+        if (r <= 0)
+                return r;
+
         *data = imp->buf + imp->offset;
         imp->offset += size;
 
@@ -288,10 +322,384 @@ static int process_special_field(JournalImporter *imp, char *line) {
         return 0;
 }
 
+static int binary_take(const uint8_t **p, size_t *left, size_t n, const uint8_t **ret) {
+        assert(p);
+        assert(left);
+        assert(ret);
+
+        if (*left < n)
+                return log_warning_errno(SYNTHETIC_ERRNO(EBADMSG), "Truncated entry in binary export stream.");
+
+        *ret = *p;
+        *p += n;
+        *left -= n;
+
+        return 0;
+}
+
+static int binary_block_split(
+                const uint8_t *p,
+                size_t size,
+                const char **ret_type,
+                const uint8_t **ret_payload,
+                size_t *ret_payload_size) {
+
+        size_t n;
+
+        assert(p);
+        assert(size >= JOURNAL_EXPORT_BINARY_BLOCK_HEADER_SIZE);
+        assert(ret_type);
+        assert(ret_payload);
+        assert(ret_payload_size);
+
+        if (p[0] != JOURNAL_EXPORT_BINARY_MAGIC_BYTE)
+                return log_warning_errno(SYNTHETIC_ERRNO(EBADMSG), "Invalid block in binary export stream.");
+
+        /* Including the block header, a block may be as large as an entry in the text format */
+        n = unaligned_read_le32(p + JOURNAL_EXPORT_BINARY_TYPE_SIZE);
+        if (n > ENTRY_SIZE_MAX - JOURNAL_EXPORT_BINARY_BLOCK_HEADER_SIZE)
+                return log_warning_errno(SYNTHETIC_ERRNO(E2BIG),
+                                         "Stream declares block with size %zu > %u",
+                                         n, ENTRY_SIZE_MAX - JOURNAL_EXPORT_BINARY_BLOCK_HEADER_SIZE);
+        *ret_payload_size = n;
+
+        if (size - JOURNAL_EXPORT_BINARY_BLOCK_HEADER_SIZE < n)
+                return 0; /* not complete yet, only the payload size is returned */
+
+        *ret_type = (const char*) p;
+        *ret_payload = p + JOURNAL_EXPORT_BINARY_BLOCK_HEADER_SIZE;
+
+        return 1;
+}
+
+static bool binary_block_is(const char *type, const char *expected) {
+        return memcmp(type, expected, JOURNAL_EXPORT_BINARY_TYPE_SIZE) == 0;
+}
+
+static void importer_reset_names(JournalImporter *imp) {
+        assert(imp);
+
+        FOREACH_ARRAY(n, imp->names, imp->n_names)
+                free(*n);
+        imp->names = mfree(imp->names);
+        imp->n_names = 0;
+}
+
+static int importer_add_name(JournalImporter *imp, const uint8_t *name, size_t len) {
+        char *n = NULL;
+
+        assert(imp);
+
+        if (imp->n_names >= JOURNAL_EXPORT_BINARY_NAMES_MAX)
+                return 0; /* The dictionary is full, the name is used for this field only */
+
+        if (!GREEDY_REALLOC(imp->names, imp->n_names + 1))
+                return log_oom();
+
+        /* Invalid names are remembered too, so that the indices of the following names stay right, and
+         * fields using them are ignored, like in the text format. */
+        if (journal_field_valid((const char*) name, len, true)) {
+                n = memdup_suffix0(name, len);
+                if (!n)
+                        return log_oom();
+        } else {
+                char buf[64], *t;
+
+                t = strndupa_safe((const char*) name, len);
+                log_debug("Ignoring invalid field: \"%s\"", cellescape(buf, sizeof buf, t));
+        }
+
+        imp->names[imp->n_names++] = n;
+        return 0;
+}
+
+static int process_binary_entry(JournalImporter *imp, const uint8_t *payload, size_t size) {
+        const uint8_t *p, *q;
+        size_t left, total = 0;
+        uint32_t n_fields;
+        int r;
+
+        assert(imp);
+        assert(payload || size == 0);
+
+        /* The first pass validates the entry, extends the name dictionary and determines the size of the
+         * "FIELD=value" items, which the second pass then puts together. */
+
+        p = payload;
+        left = size;
+
+        r = binary_take(&p, &left, sizeof(uint32_t), &q);
+        if (r < 0)
+                return r;
+
+        n_fields = unaligned_read_le32(q);
+        if (n_fields > ENTRY_FIELD_COUNT_MAX)
+                return log_warning_errno(SYNTHETIC_ERRNO(E2BIG),
+                                         "Entry has %" PRIu32 " fields, more than the maximum of %u.",
+                                         n_fields, ENTRY_FIELD_COUNT_MAX);
+
+        for (uint32_t i = 0; i < n_fields; i++) {
+                size_t name_len, value_len;
+                uint16_t idx;
+
+                r = binary_take(&p, &left, sizeof(uint16_t), &q);
+                if (r < 0)
+                        return r;
+
+                idx = unaligned_read_le16(q);
+                if (idx == JOURNAL_EXPORT_BINARY_NAME_NEW) {
+                        r = binary_take(&p, &left, sizeof(uint16_t), &q);
+                        if (r < 0)
+                                return r;
+
+                        name_len = unaligned_read_le16(q);
+
+                        r = binary_take(&p, &left, name_len, &q);
+                        if (r < 0)
+                                return r;
+
+                        r = importer_add_name(imp, q, name_len);
+                        if (r < 0)
+                                return r;
+                } else if (idx >= imp->n_names)
+                        return log_warning_errno(SYNTHETIC_ERRNO(EBADMSG),
+                                                 "Entry refers to unknown field name %u.", idx);
+                else
+                        name_len = strlen_ptr(imp->names[idx]);
+
+                r = binary_take(&p, &left, sizeof(uint32_t), &q);
+                if (r < 0)
+                        return r;
+
+                value_len = unaligned_read_le32(q);
+                if (value_len > DATA_SIZE_MAX)
+                        return log_warning_errno(SYNTHETIC_ERRNO(EINVAL),
+                                                 "Stream declares field with size %zu > DATA_SIZE_MAX = %u",
+                                                 value_len, DATA_SIZE_MAX);
+
+                r = binary_take(&p, &left, value_len, &q);
+                if (r < 0)
+                        return r;
+
+                total += name_len + 1 + value_len + 1;
+        }
+
+        if (left > 0)
+                return log_warning_errno(SYNTHETIC_ERRNO(EBADMSG), "Trailing garbage after entry in binary export stream.");
+
+        if (total > 0) {
+                char *old = imp->fields;
+
+                if (!GREEDY_REALLOC(imp->fields, imp->fields_size + total))
+                        return log_oom();
+                iovw_rebase(&imp->iovw, old, imp->fields);
+        }
+
+        p = payload + sizeof(uint32_t);
+
+        for (uint32_t i = 0; i < n_fields; i++) {
+                const char *name;
+                size_t name_len, value_len;
+                char *item, *e;
+                uint16_t idx;
+
+                idx = unaligned_read_le16(p);
+                p += sizeof(uint16_t);
+
+                if (idx == JOURNAL_EXPORT_BINARY_NAME_NEW) {
+                        name_len = unaligned_read_le16(p);
+                        name = (const char*) p + sizeof(uint16_t);
+                        p += sizeof(uint16_t) + name_len;
+
+                        /* The name was validated when it was added to the dictionary, unless that was full */
+                        if (!journal_field_valid(name, name_len, true))
+                                name = NULL;
+                } else {
+                        name = imp->names[idx];
+                        name_len = strlen_ptr(name);
+                }
+
+                value_len = unaligned_read_le32(p);
+                p += sizeof(uint32_t);
+
+                if (!name) {
+                        p += value_len;
+                        continue;
+                }
+
+                item = imp->fields + imp->fields_size;
+                e = mempcpy(item, name, name_len);
+                *(e++) = '=';
+                e = mempcpy(e, p, value_len);
+                *e = '\0';
+                p += value_len;
+
+                r = process_special_field(imp, item);
+                if (r < 0)
+                        return r;
+                if (r > 0)
+                        continue;
+
+                r = iovw_put(&imp->iovw, item, e - item);
+                if (r < 0)
+                        return r;
+
+                imp->fields_size += e - item + 1;
+        }
+
+        log_trace("Received binary entry with %" PRIu32 " fields", n_fields);
+
+        return 1;
+}
+
+static int batch_append(const void *data, size_t size, void *userdata) {
+        JournalImporter *imp = ASSERT_PTR(userdata);
+
+        if (imp->batch_size + size > ENTRY_SIZE_MAX + JOURNAL_EXPORT_BINARY_BATCH_SIZE)
+                return log_warning_errno(SYNTHETIC_ERRNO(E2BIG),
+                                         "Batch is bigger than %u bytes.",
+                                         ENTRY_SIZE_MAX + JOURNAL_EXPORT_BINARY_BATCH_SIZE);
+
+        if (!GREEDY_REALLOC(imp->batch, imp->batch_size + size))
+                return log_oom();
+
+        memcpy(imp->batch + imp->batch_size, data, size);
+        imp->batch_size += size;
+
+        return 0;
+}
+
+static int process_binary_block(JournalImporter *imp) {
+        const uint8_t *payload;
+        const char *type;
+        size_t size;
+        int r;
+
+        assert(imp);
+        assert(imp->state == IMPORTER_STATE_BINARY);
+
+        r = fill_buffer(imp, JOURNAL_EXPORT_BINARY_BLOCK_HEADER_SIZE);
+        if (r < 0)
+                return r;
+        if (r == 0) {
+                imp->state = IMPORTER_STATE_EOF;
+                return 0;
+        }
+
+        r = binary_block_split((const uint8_t*) imp->buf + imp->offset, imp->filled - imp->offset,
+                               &type, &payload, &size);
+        if (r < 0)
+                return r;
+        if (r == 0) {
+                r = fill_buffer(imp, JOURNAL_EXPORT_BINARY_BLOCK_HEADER_SIZE + size);
+                if (r < 0)
+                        return r;
+                if (r == 0) {
+                        imp->state = IMPORTER_STATE_EOF;
+                        return 0;
+                }
+
+                /* The buffer might have been moved */
+                r = binary_block_split((const uint8_t*) imp->buf + imp->offset, imp->filled - imp->offset,
+                                       &type, &payload, &size);
+                if (r < 0)
+                        return r;
+                assert(r > 0);
+        }
+
+        imp->offset += JOURNAL_EXPORT_BINARY_BLOCK_HEADER_SIZE + size;
+
+        if (binary_block_is(type, JOURNAL_EXPORT_BINARY_ENTRY))
+                return process_binary_entry(imp, payload, size);
+
+        if (binary_block_is(type, JOURNAL_EXPORT_BINARY_HEADER)) {
+                uint32_t version;
+
+                if (size < sizeof(uint32_t))
+                        return log_warning_errno(SYNTHETIC_ERRNO(EBADMSG), "Truncated binary export stream header.");
+
+                version = unaligned_read_le32(payload);
+                if (version != JOURNAL_EXPORT_BINARY_VERSION)
+                        return log_warning_errno(SYNTHETIC_ERRNO(EPROTONOSUPPORT),
+                                                 "Unsupported binary export format version %" PRIu32 ".", version);
+
+                importer_reset_names(imp);
+                return 0;
+        }
+
+        if (binary_block_is(type, JOURNAL_EXPORT_BINARY_ZSTD)) {
+                if (!imp->decompressor) {
+                        r = decompressor_new(COMPRESSION_ZSTD, &imp->decompressor);
+                        if (r < 0)
+                                return log_warning_errno(r, "Cannot decompress batch in binary export stream: %m");
+                }
+
+                imp->batch_size = imp->batch_offset = 0;
+
+                r = decompressor_push(imp->decompressor, payload, size, batch_append, imp);
+                if (r < 0)
+                        return log_warning_errno(r, "Failed to decompress batch in binary export stream: %m");
+
+                imp->state = IMPORTER_STATE_BATCH;
+                return 0;
+        }
+
+        return log_warning_errno(SYNTHETIC_ERRNO(EBADMSG), "Unknown block type in binary export stream.");
+}
+
+static int process_batch_entry(JournalImporter *imp) {
+        const uint8_t *payload;
+        const char *type;
+        size_t size;
+        int r;
+
+        assert(imp);
+        assert(imp->state == IMPORTER_STATE_BATCH);
+        assert(imp->batch_offset <= imp->batch_size);
+
+        if (imp->batch_offset == imp->batch_size) {
+                imp->state = IMPORTER_STATE_BINARY;
+                return 0;
+        }
+
+        if (imp->batch_size - imp->batch_offset < JOURNAL_EXPORT_BINARY_BLOCK_HEADER_SIZE)
+                return log_warning_errno(SYNTHETIC_ERRNO(EBADMSG), "Truncated block in batch.");
+
+        r = binary_block_split((const uint8_t*) imp->batch + imp->batch_offset, imp->batch_size - imp->batch_offset,
+                               &type, &payload, &size);
+        if (r < 0)
+                return r;
+        if (r == 0)
+                return log_warning_errno(SYNTHETIC_ERRNO(EBADMSG), "Truncated block in batch.");
+
+        /* Batches only carry entries */
+        if (!binary_block_is(type, JOURNAL_EXPORT_BINARY_ENTRY))
+                return log_warning_errno(SYNTHETIC_ERRNO(EBADMSG), "Unexpected block type in batch.");
+
+        imp->batch_offset += JOURNAL_EXPORT_BINARY_BLOCK_HEADER_SIZE + size;
+
+        return process_binary_entry(imp, payload, size);
+}
+
 int journal_importer_process_data(JournalImporter *imp) {
         int r;
 
         switch (imp->state) {
+        case IMPORTER_STATE_START:
+                /* Every block of the binary format starts with a byte that starts no valid line */
+                r = fill_buffer(imp, 1);
+                if (r < 0)
+                        return r;
+                if (r == 0) {
+                        imp->state = IMPORTER_STATE_EOF;
+                        return 0;
+                }
+
+                imp->state = imp->buf[imp->offset] == JOURNAL_EXPORT_BINARY_MAGIC_BYTE ?
+                        IMPORTER_STATE_BINARY : IMPORTER_STATE_LINE;
+
+                return 0; /* continue */
+
         case IMPORTER_STATE_LINE: {
                 char *line, *sep;
                 size_t n = 0;
@@ -426,6 +834,13 @@ int journal_importer_process_data(JournalImporter *imp) {
                 imp->state = IMPORTER_STATE_LINE;
 
                 return 0; /* continue */
+
+        case IMPORTER_STATE_BINARY:
+                return process_binary_block(imp);
+
+        case IMPORTER_STATE_BATCH:
+                return process_batch_entry(imp);
+
         default:
                 assert_not_reached();
         }
@@ -450,9 +865,17 @@ int journal_importer_push_data(JournalImporter *imp, const char *data, size_t si
 void journal_importer_drop_iovw(JournalImporter *imp) {
         size_t remain, target;
 
-        /* This function drops processed data that along with the iovw that points at it */
+        /* This function drops processed data that along with the iovw that points at it. The iovec
+         * array itself is kept around for the next entry. */
 
-        iovw_free_contents(&imp->iovw, false);
+        imp->iovw.count = 0;
+        imp->fields_size = 0;
+
+        /* Remember how large entries are, so that the buffer is not shrunk below what the next one
+         * likely needs. Let the estimate decay slowly, so that a single huge entry does not pin a
+         * large buffer forever. */
+        assert(imp->entry_start <= imp->offset);
+        imp->entry_size = MAX(imp->offset - imp->entry_start, imp->entry_size - imp->entry_size / 16);
 
         /* possibly reset buffer position */
         remain = imp->filled - imp->offset;
@@ -466,8 +889,10 @@ void journal_importer_drop_iovw(JournalImporter *imp) {
                 imp->filled = remain;
         }
 
+        imp->entry_start = imp->offset;
+
         target = MALLOC_SIZEOF_SAFE(imp->buf);
-        while (target > 16 * LINE_CHUNK && imp->filled < target / 2)
+        while (target > 16 * LINE_CHUNK && target / 2 > 2 * imp->entry_size && imp->filled < target / 2)
                 target /= 2;
         if (target < MALLOC_SIZEOF_SAFE(imp->buf)) {
                 char *tmp;
@@ -8,6 +8,7 @@
 
 #include "sd-id128.h"
 
+#include "compress.h"
 #include "io-util.h"
 #include "iovec-wrapper.h"
 #include "time-util.h"
@@ -36,9 +37,22 @@ typedef struct JournalImporter {
         size_t scanned;    /* number of bytes since the beginning of data without a newline */
         size_t filled;     /* total number of bytes in the buffer */
 
+        size_t entry_start; /* offset of the beginning of the current entry in the buffer */
+        size_t entry_size;  /* size of the largest entry seen recently, used to size the buffer */
+
         size_t field_len;  /* used for binary fields: the field name length */
         size_t data_size;  /* and the size of the binary data chunk being processed */
 
+        /* used for the binary export format */
+        char **names;          /* the field name dictionary, with NULL for invalid names */
+        size_t n_names;
+        char *fields;          /* the "FIELD=value" items of the current entry, which iovw points to */
+        size_t fields_size;
+        char *batch;           /* the decompressed batch being processed */
+        size_t batch_size;
+        size_t batch_offset;
+        Decompressor *decompressor;
+
         struct iovec_wrapper iovw;
 
         int state;
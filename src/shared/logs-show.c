@@ -17,18 +17,24 @@
 #include "format-util.h"
 #include "glyph-util.h"
 #include "hashmap.h"
+#include "hexdecoct.h"
 #include "hostname-util.h"
 #include "id128-util.h"
 #include "io-util.h"
+#include "journal-export-binary.h"
 #include "journal-internal.h"
 #include "journal-util.h"
 #include "locale-util.h"
 #include "log.h"
 #include "logs-show.h"
 #include "macro.h"
+#include "missing_threads.h"
 #include "output-mode.h"
 #include "parse-util.h"
 #include "pretty-print.h"
+#include "random-util.h"
+#include "siphash24.h"
+#include "sort-util.h"
 #include "sparse-endian.h"
 #include "stdio-util.h"
 #include "string-table.h"
@@ -993,6 +999,33 @@ static int output_export(
         return 0;
 }
 
+static int output_export_binary(
+                FILE *f,
+                sd_journal *j,
+                OutputMode mode,
+                unsigned n_columns,
+                OutputFlags flags,
+                const Set *output_fields,
+                const size_t highlight[2],
+                dual_timestamp *previous_display_ts, /* unused */
+                sd_id128_t *previous_boot_id) {      /* unused */
+
+        _cleanup_(journal_binary_exporter_freep) JournalBinaryExporter *e = NULL;
+        int r;
+
+        assert(j);
+
+        /* Without a context carried from one entry to the next, each entry is a stream of its own, with its
+         * own header and field names. Callers which output many entries should keep a
+         * JournalBinaryExporter around instead, like journalctl does. */
+
+        r = journal_binary_exporter_new(COMPRESSION_NONE, &e);
+        if (r < 0)
+                return log_oom();
+
+        return journal_binary_exporter_add(e, f, j, output_fields);
+}
+
 void json_escape(
                 FILE *f,
                 const char* p,
@@ -1122,19 +1155,20 @@ static int update_json_data(
         return 0;
 }
 
-static int update_json_data_split(
-                Hashmap *h,
-                OutputFlags flags,
+static int json_field_split(
                 const Set *output_fields,
                 const void *data,
-                size_t size) {
+                size_t size,
+                size_t *ret_fieldlen) {
 
-        size_t fieldlen;
         const char *eq;
-        char *name;
+        size_t fieldlen;
+        int r;
 
-        assert(h);
         assert(data || size == 0);
+        assert(ret_fieldlen);
+
+        /* Returns > 0 and the length of the field name if the field shall be included in JSON output */
 
         if (memory_startswith(data, size, "_BOOT_ID="))
                 return 0;
@@ -1147,11 +1181,425 @@ static int update_json_data_split(
         if (!journal_field_valid(data, fieldlen, true))
                 return log_error_errno(SYNTHETIC_ERRNO(EINVAL), "Invalid field.");
 
-        name = strndupa_safe(data, fieldlen);
-        if (output_fields && !set_contains(output_fields, name))
-                return 0;
+        r = field_set_test(output_fields, data, fieldlen);
+        if (r <= 0)
+                return r;
+
+        *ret_fieldlen = fieldlen;
+        return 1;
+}
+
+static int update_json_data_split(
+                Hashmap *h,
+                OutputFlags flags,
+                const Set *output_fields,
+                const void *data,
+                size_t size) {
+
+        size_t fieldlen;
+        int r;
+
+        assert(h);
+
+        r = json_field_split(output_fields, data, size, &fieldlen);
+        if (r <= 0)
+                return r;
+
+        return update_json_data(h, flags, strndupa_safe(data, fieldlen), (const char*) data + fieldlen + 1, size - fieldlen - 1);
+}
+
+/* The direct formatter for the compact JSON modes writes every entry into a buffer that is kept from one
+ * entry to the next, and then out in one go, so that usually nothing is allocated per entry. Fields that
+ * occur more than once are found through a small hash table over the names, and are output as an array of
+ * all their values, as the generic path does. */
+
+typedef struct JsonField {
+        size_t name, name_size;   /* The quoted name, as offset into JsonEntry.buf and size */
+        size_t value, value_size; /* The formatted value, likewise */
+        size_t next;              /* The index of the next field of the same name, or SIZE_MAX */
+        size_t last;              /* The index of the last field of the same name, only set for the first one */
+        size_t slot;              /* The slot in JsonEntry.slots, only set for the first one of a name */
+        bool duplicate;           /* Whether a field of the same name came before */
+} JsonField;
+
+typedef struct JsonEntry {
+        char *buf;
+        size_t size;
+        JsonField *fields;
+        size_t n_fields;
+        size_t *slots;            /* The index of the first field of a name + 1, or 0 if unused */
+        size_t n_slots;
+        uint8_t hash_key[16];
+} JsonEntry;
+
+static thread_local JsonEntry json_entry = {};
+
+static void json_entry_reset(JsonEntry *e) {
+        assert(e);
+
+        FOREACH_ARRAY(field, e->fields, e->n_fields)
+                if (!field->duplicate)
+                        e->slots[field->slot] = 0;
+
+        e->size = e->n_fields = 0;
+}
+
+static char* json_entry_reserve(JsonEntry *e, size_t n) {
+        assert(e);
+
+        if (!GREEDY_REALLOC(e->buf, size_add(e->size, n)))
+                return NULL;
+
+        return e->buf + e->size;
+}
+
+static int json_entry_append_string(JsonEntry *e, const char *p, size_t n) {
+        char *begin, *q;
+
+        assert(e);
+        assert(p || n == 0);
+
+        /* Escapes like json_format_string() does. "\u00XX" is the longest escape sequence. */
+        if (n > (SIZE_MAX - 2) / STRLEN("\\u00XX"))
+                return -ENOMEM;
+
+        begin = q = json_entry_reserve(e, n * STRLEN("\\u00XX") + 2);
+        if (!q)
+                return -ENOMEM;
+
+        *q++ = '"';
+
+        for (const char *end = p + n; p < end; p++)
+                switch (*p) {
+
+                case '"':
+                case '\\':
+                        *q++ = '\\';
+                        *q++ = *p;
+                        break;
+
+                case '\b':
+                        q = stpcpy(q, "\\b");
+                        break;
+
+                case '\f':
+                        q = stpcpy(q, "\\f");
+                        break;
 
-        return update_json_data(h, flags, name, eq + 1, size - fieldlen - 1);
+                case '\n':
+                        q = stpcpy(q, "\\n");
+                        break;
+
+                case '\r':
+                        q = stpcpy(q, "\\r");
+                        break;
+
+                case '\t':
+                        q = stpcpy(q, "\\t");
+                        break;
+
+                default:
+                        if ((signed char) *p >= 0 && *p < ' ') {
+                                q = stpcpy(q, "\\u00");
+                                *q++ = hexchar(*p >> 4);
+                                *q++ = hexchar(*p);
+                        } else
+                                *q++ = *p;
+                }
+
+        *q++ = '"';
+
+        e->size += q - begin;
+        return 0;
+}
+
+static int json_entry_append_bytes(JsonEntry *e, const uint8_t *p, size_t n) {
+        char *begin, *q;
+
+        assert(e);
+        assert(p || n == 0);
+
+        /* Like sd_json_variant_new_array_bytes() formats */
+        if (n > (SIZE_MAX - 2) / STRLEN("255,"))
+                return -ENOMEM;
+
+        begin = q = json_entry_reserve(e, n * STRLEN("255,") + 2);
+        if (!q)
+                return -ENOMEM;
+
+        *q++ = '[';
+
+        for (size_t i = 0; i < n; i++) {
+                if (i > 0)
+                        *q++ = ',';
+
+                if (p[i] >= 100)
+                        *q++ = '0' + p[i] / 100;
+                if (p[i] >= 10)
+                        *q++ = '0' + p[i] / 10 % 10;
+                *q++ = '0' + p[i] % 10;
+        }
+
+        *q++ = ']';
+
+        e->size += q - begin;
+        return 0;
+}
+
+static uint64_t json_entry_hash(JsonEntry *e, const JsonField *field) {
+        return siphash24(e->buf + field->name, field->name_size, e->hash_key);
+}
+
+static int json_entry_index(JsonEntry *e, size_t i) {
+        JsonField *field;
+        size_t mask;
+
+        assert(e);
+        assert(i < e->n_fields);
+
+        /* Keep the table at most half full */
+        if (e->n_slots < e->n_fields * 2) {
+                size_t n_slots = MAX(64U, e->n_slots * 2);
+                size_t *slots;
+
+                slots = new0(size_t, n_slots);
+                if (!slots)
+                        return -ENOMEM;
+
+                if (e->n_slots == 0)
+                        random_bytes(e->hash_key, sizeof(e->hash_key));
+
+                free_and_replace(e->slots, slots);
+                e->n_slots = n_slots;
+
+                FOREACH_ARRAY(other, e->fields, i) {
+                        if (other->duplicate)
+                                continue;
+
+                        for (other->slot = json_entry_hash(e, other) & (n_slots - 1);
+                             e->slots[other->slot] != 0;
+                             other->slot = (other->slot + 1) & (n_slots - 1))
+                                ;
+
+                        e->slots[other->slot] = other - e->fields + 1;
+                }
+        }
+
+        field = e->fields + i;
+        mask = e->n_slots - 1;
+
+        for (size_t s = json_entry_hash(e, field) & mask;; s = (s + 1) & mask) {
+                JsonField *first;
+
+                if (e->slots[s] == 0) {
+                        e->slots[s] = i + 1;
+                        field->slot = s;
+                        return 0;
+                }
+
+                first = e->fields + e->slots[s] - 1;
+                if (first->name_size == field->name_size &&
+                    memcmp(e->buf + first->name, e->buf + field->name, field->name_size) == 0) {
+                        e->fields[first->last].next = i;
+                        first->last = i;
+                        field->duplicate = true;
+                        return 0;
+                }
+        }
+}
+
+static int json_entry_add(
+                JsonEntry *e,
+                OutputFlags flags,
+                const char *name,
+                size_t name_size,
+                const void *value,
+                size_t size) {
+
+        JsonField *field;
+        size_t i;
+        int r;
+
+        assert(e);
+        assert(name);
+        assert(value);
+
+        if (size == SIZE_MAX)
+                size = strlen(value);
+
+        if (!GREEDY_REALLOC(e->fields, e->n_fields + 1))
+                return log_oom();
+
+        i = e->n_fields;
+        field = e->fields + i;
+        *field = (JsonField) {
+                .name = e->size,
+                .next = SIZE_MAX,
+                .last = i,
+        };
+
+        r = json_entry_append_string(e, name, name_size);
+        if (r < 0)
+                return log_oom();
+
+        field->name_size = e->size - field->name;
+        field->value = e->size;
+
+        /* Same as update_json_data() */
+        if (!(flags & OUTPUT_SHOW_ALL) && name_size + 1 + size >= JSON_THRESHOLD) {
+                char *q = json_entry_reserve(e, STRLEN("null"));
+                if (!q)
+                        return log_oom();
+
+                memcpy(q, "null", STRLEN("null"));
+                e->size += STRLEN("null");
+        } else if (utf8_is_printable(value, size))
+                r = json_entry_append_string(e, value, size);
+        else
+                r = json_entry_append_bytes(e, value, size);
+        if (r < 0)
+                return log_oom();
+
+        field->value_size = e->size - field->value;
+        e->n_fields++;
+
+        r = json_entry_index(e, i);
+        if (r < 0) {
+                e->n_fields--;
+                return log_oom();
+        }
+
+        return 0;
+}
+
+static int json_entry_write(JsonEntry *e, FILE *f, OutputMode mode) {
+        bool first = true;
+
+        assert(e);
+        assert(f);
+
+        /* The same as sd_json_variant_dump() prints for the format flags of these modes */
+        if (mode == OUTPUT_JSON_SSE)
+                fputs("data: ", f);
+        else if (mode == OUTPUT_JSON_SEQ)
+                fputc('\x1e', f);
+
+        fputc('{', f);
+
+        FOREACH_ARRAY(field, e->fields, e->n_fields) {
+                if (field->duplicate)
+                        continue;
+
+                if (!first)
+                        fputc(',', f);
+                first = false;
+
+                fwrite(e->buf + field->name, 1, field->name_size, f);
+                fputc(':', f);
+
+                if (field->next == SIZE_MAX) {
+                        fwrite(e->buf + field->value, 1, field->value_size, f);
+                        continue;
+                }
+
+                fputc('[', f);
+                for (const JsonField *v = field;; v = e->fields + v->next) {
+                        if (v != field)
+                                fputc(',', f);
+
+                        fwrite(e->buf + v->value, 1, v->value_size, f);
+
+                        if (v->next == SIZE_MAX)
+                                break;
+                }
+                fputc(']', f);
+        }
+
+        fputs("}\n", f);
+
+        if (mode == OUTPUT_JSON_SSE)
+                fputc('\n', f);
+
+        return 0;
+}
+
+static int output_json_direct(
+                FILE *f,
+                sd_journal *j,
+                OutputMode mode,
+                OutputFlags flags,
+                const Set *output_fields,
+                const char *cursor,
+                usec_t realtime,
+                usec_t monotonic,
+                sd_id128_t journal_boot_id,
+                uint64_t seqnum,
+                sd_id128_t seqnum_id) {
+
+        char usecbuf[CONST_MAX(DECIMAL_STR_MAX(usec_t), DECIMAL_STR_MAX(uint64_t))];
+        JsonEntry *e = &json_entry;
+        int r;
+
+        assert(f);
+        assert(j);
+        assert(IN_SET(mode, OUTPUT_JSON, OUTPUT_JSON_SEQ, OUTPUT_JSON_SSE));
+        assert(cursor);
+
+        json_entry_reset(e);
+
+        r = json_entry_add(e, flags, "__CURSOR", STRLEN("__CURSOR"), cursor, SIZE_MAX);
+        if (r < 0)
+                return r;
+
+        xsprintf(usecbuf, USEC_FMT, realtime);
+        r = json_entry_add(e, flags, "__REALTIME_TIMESTAMP", STRLEN("__REALTIME_TIMESTAMP"), usecbuf, SIZE_MAX);
+        if (r < 0)
+                return r;
+
+        xsprintf(usecbuf, USEC_FMT, monotonic);
+        r = json_entry_add(e, flags, "__MONOTONIC_TIMESTAMP", STRLEN("__MONOTONIC_TIMESTAMP"), usecbuf, SIZE_MAX);
+        if (r < 0)
+                return r;
+
+        r = json_entry_add(e, flags, "_BOOT_ID", STRLEN("_BOOT_ID"), SD_ID128_TO_STRING(journal_boot_id), SIZE_MAX);
+        if (r < 0)
+                return r;
+
+        xsprintf(usecbuf, USEC_FMT, seqnum);
+        r = json_entry_add(e, flags, "__SEQNUM", STRLEN("__SEQNUM"), usecbuf, SIZE_MAX);
+        if (r < 0)
+                return r;
+
+        r = json_entry_add(e, flags, "__SEQNUM_ID", STRLEN("__SEQNUM_ID"), SD_ID128_TO_STRING(seqnum_id), SIZE_MAX);
+        if (r < 0)
+                return r;
+
+        for (;;) {
+                const void *data;
+                size_t size, fieldlen;
+
+                r = sd_journal_enumerate_data(j, &data, &size);
+                if (IN_SET(r, -EBADMSG, -EADDRNOTAVAIL)) {
+                        log_debug_errno(r, "Skipping message we can't read: %m");
+                        return 0;
+                }
+                if (r < 0)
+                        return log_error_errno(r, "Failed to read journal: %m");
+                if (r == 0)
+                        break;
+
+                r = json_field_split(output_fields, data, size, &fieldlen);
+                if (r < 0)
+                        return r;
+                if (r == 0)
+                        continue;
+
+                r = json_entry_add(e, flags, data, fieldlen, (const char*) data + fieldlen + 1, size - fieldlen - 1);
+                if (r < 0)
+                        return r;
+        }
+
+        return json_entry_write(e, f, mode);
 }
 
 static int output_json(
@@ -1197,6 +1645,12 @@ static int output_json(
         if (r < 0)
                 return log_error_errno(r, "Failed to get seqnum: %m");
 
+        /* The compact modes are the ones used for exporting large amounts of entries, they are formatted
+         * directly, without building a JSON object first */
+        if (IN_SET(mode, OUTPUT_JSON, OUTPUT_JSON_SEQ, OUTPUT_JSON_SSE) && !FLAGS_SET(flags, OUTPUT_COLOR))
+                return output_json_direct(f, j, mode, flags, output_fields, cursor,
+                                          realtime, monotonic, journal_boot_id, seqnum, seqnum_id);
+
         h = hashmap_new(&json_data_hash_ops_free);
         if (!h)
                 return log_oom();
@@ -1409,6 +1863,7 @@ static output_func_t output_funcs[_OUTPUT_MODE_MAX] = {
         [OUTPUT_SHORT_FULL]        = output_short,
         [OUTPUT_VERBOSE]           = output_verbose,
         [OUTPUT_EXPORT]            = output_export,
+        [OUTPUT_EXPORT_BINARY]     = output_export_binary,
         [OUTPUT_JSON]              = output_json,
         [OUTPUT_JSON_PRETTY]       = output_json,
         [OUTPUT_JSON_SSE]          = output_json,
@@ -1915,6 +2370,102 @@ static int discover_next_boot(
         }
 }
 
+static int boot_id_compare(const BootId *a, const BootId *b) {
+        return CMP(a->first_usec, b->first_usec);
+}
+
+static int journal_get_boots_from_files(sd_journal *j, BootId **ret_boots, size_t *ret_n_boots) {
+        _cleanup_free_ BootId *boots = NULL;
+        size_t n_boots = 0;
+        JournalFile *f;
+        int r;
+
+        assert(j);
+        assert(ret_boots);
+        assert(ret_n_boots);
+
+        /* Collects the boots of all files from their boot indexes (or their _BOOT_ID= fields if they have
+         * none), ordered from the oldest to the newest one. This avoids bisecting through the entries of
+         * every boot, which is slow on large journals with many boots. */
+
+        ORDERED_HASHMAP_FOREACH(f, j->files) {
+                _cleanup_free_ JournalBootRange *ranges = NULL;
+                size_t n = 0;
+
+                r = journal_file_get_boot_ranges(f, &ranges, &n);
+                if (r < 0)
+                        return log_debug_errno(r, "Failed to get boots of %s: %m", f->path);
+                if (n == 0 && le64toh(f->header->n_entries) > 0)
+                        /* Entries not written by journald might lack the _BOOT_ID= field. */
+                        return log_debug_errno(SYNTHETIC_ERRNO(ENODATA), "No entries with _BOOT_ID= field in %s.", f->path);
+
+                FOREACH_ARRAY(b, ranges, n) {
+                        BootId *found = NULL;
+
+                        FOREACH_ARRAY(i, boots, n_boots)
+                                if (sd_id128_equal(i->id, b->boot_id)) {
+                                        found = i;
+                                        break;
+                                }
+
+                        if (found) {
+                                found->first_usec = MIN(found->first_usec, b->head_realtime);
+                                found->last_usec = MAX(found->last_usec, b->tail_realtime);
+                                continue;
+                        }
+
+                        if (!GREEDY_REALLOC(boots, n_boots + 1))
+                                return -ENOMEM;
+
+                        boots[n_boots++] = (BootId) {
+                                .id = b->boot_id,
+                                .first_usec = b->head_realtime,
+                                .last_usec = b->tail_realtime,
+                        };
+                }
+        }
+
+        typesafe_qsort(boots, n_boots, boot_id_compare);
+
+        *ret_boots = TAKE_PTR(boots);
+        *ret_n_boots = n_boots;
+        return 0;
+}
+
+static int journal_find_boot_from_files(sd_journal *j, sd_id128_t boot_id, int offset, sd_id128_t *ret) {
+        _cleanup_free_ BootId *boots = NULL;
+        size_t n_boots;
+        int64_t idx;
+        int r;
+
+        assert(j);
+        assert(ret);
+
+        r = journal_get_boots_from_files(j, &boots, &n_boots);
+        if (r < 0)
+                return r;
+
+        if (sd_id128_is_null(boot_id))
+                /* Offset 0 is the last boot, 1 is the first one. */
+                idx = offset <= 0 ? (int64_t) n_boots - 1 + offset : (int64_t) offset - 1;
+        else {
+                idx = -1;
+                for (size_t i = 0; i < n_boots; i++)
+                        if (sd_id128_equal(boots[i].id, boot_id)) {
+                                idx = (int64_t) i + offset;
+                                break;
+                        }
+        }
+
+        if (idx < 0 || (uint64_t) idx >= n_boots) {
+                *ret = SD_ID128_NULL;
+                return false;
+        }
+
+        *ret = boots[idx].id;
+        return true;
+}
+
 int journal_find_boot(sd_journal *j, sd_id128_t boot_id, int offset, sd_id128_t *ret) {
         bool advance_older;
         int r, offset_start;
@@ -1922,6 +2473,12 @@ int journal_find_boot(sd_journal *j, sd_id128_t boot_id, int offset, sd_id128_t
         assert(j);
         assert(ret);
 
+        r = journal_find_boot_from_files(j, boot_id, offset, ret);
+        if (r >= 0 || r == -ENOMEM)
+                return r;
+
+        /* Let's fall back to looking at the entries, which copes better with corrupted files. */
+
         /* Adjust for the asymmetry that offset 0 is the last (and current) boot, while 1 is considered the
          * (chronological) first boot in the journal. */
         advance_older = offset <= 0;
@@ -2007,6 +2564,21 @@ int journal_get_boots(
         assert(ret_boots);
         assert(ret_n_boots);
 
+        r = journal_get_boots_from_files(j, &boots, &n_boots);
+        if (r == -ENOMEM)
+                return r;
+        if (r >= 0) {
+                if (advance_older)
+                        for (size_t i = 0; i < n_boots / 2; i++)
+                                SWAP_TWO(boots[i], boots[n_boots - 1 - i]);
+
+                n_boots = MIN(n_boots, max_ids);
+
+                *ret_boots = TAKE_PTR(boots);
+                *ret_n_boots = n_boots;
+                return n_boots > 0;
+        }
+
         sd_journal_flush_matches(j);
 
         if (advance_older)
@@ -2,12 +2,14 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <linux/filter.h>
 #include <linux/seccomp.h>
 #include <stddef.h>
 #include <sys/mman.h>
 #include <sys/prctl.h>
 #include <sys/shm.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 /* include missing_syscall_def.h earlier to make __SNR_foo mapped to __NR_foo. */
 #include "missing_syscall_def.h"
@@ -17,7 +19,9 @@
 #include "alloc-util.h"
 #include "env-util.h"
 #include "errno-list.h"
+#include "fd-util.h"
 #include "macro.h"
+#include "memfd-util.h"
 #include "namespace-util.h"
 #include "nsflags.h"
 #include "nulstr-util.h"
@@ -1157,84 +1161,106 @@ int seccomp_load_syscall_filter_set(uint32_t default_action, const SyscallFilter
         return 0;
 }
 
-int seccomp_load_syscall_filter_set_raw(uint32_t default_action, Hashmap* filter, uint32_t action, bool log_missing) {
-        uint32_t arch, default_action_override;
+static int seccomp_build_syscall_filter_set_raw(
+                uint32_t arch,
+                uint32_t default_action,
+                Hashmap *filter,
+                uint32_t action,
+                bool log_missing,
+                scmp_filter_ctx *ret) {
+
+        _cleanup_(seccomp_releasep) scmp_filter_ctx seccomp = NULL;
+        uint32_t default_action_override;
+        void *syscall_id, *val;
         int r;
 
-        /* Similar to seccomp_load_syscall_filter_set(), but takes a raw Hashmap* of syscalls, instead
-         * of a SyscallFilterSet* table. */
+        assert(ret);
 
-        if (hashmap_isempty(filter) && default_action == SCMP_ACT_ALLOW)
-                return 0;
+        log_trace("Operating on architecture: %s", seccomp_arch_to_string(arch));
 
         default_action_override = override_default_action(default_action);
 
-        SECCOMP_FOREACH_LOCAL_ARCH(arch) {
-                _cleanup_(seccomp_releasep) scmp_filter_ctx seccomp = NULL;
-                void *syscall_id, *val;
-
-                log_trace("Operating on architecture: %s", seccomp_arch_to_string(arch));
-
-                r = seccomp_init_for_arch(&seccomp, arch, default_action_override);
-                if (r < 0)
-                        return r;
+        r = seccomp_init_for_arch(&seccomp, arch, default_action_override);
+        if (r < 0)
+                return r;
 
-                HASHMAP_FOREACH_KEY(val, syscall_id, filter) {
-                        uint32_t a = action;
-                        int id = PTR_TO_INT(syscall_id) - 1;
-                        int error = PTR_TO_INT(val);
+        HASHMAP_FOREACH_KEY(val, syscall_id, filter) {
+                uint32_t a = action;
+                int id = PTR_TO_INT(syscall_id) - 1;
+                int error = PTR_TO_INT(val);
 
-                        if (error == SECCOMP_ERROR_NUMBER_KILL)
-                                a = scmp_act_kill_process();
+                if (error == SECCOMP_ERROR_NUMBER_KILL)
+                        a = scmp_act_kill_process();
 #ifdef SCMP_ACT_LOG
-                        else if (action == SCMP_ACT_LOG)
-                                a = SCMP_ACT_LOG;
+                else if (action == SCMP_ACT_LOG)
+                        a = SCMP_ACT_LOG;
 #endif
-                        else if (error >= 0)
-                                a = SCMP_ACT_ERRNO(error);
+                else if (error >= 0)
+                        a = SCMP_ACT_ERRNO(error);
 
-                        r = seccomp_rule_add_exact(seccomp, a, id, 0);
-                        if (r < 0) {
-                                /* If the system call is not known on this architecture, then that's
-                                 * fine, let's ignore it */
-                                _cleanup_free_ char *n = NULL;
-                                bool ignore;
-
-                                n = seccomp_syscall_resolve_num_arch(SCMP_ARCH_NATIVE, id);
-                                ignore = r == -EDOM;
-                                if (!ignore || log_missing)
-                                        log_debug_errno(r, "Failed to add rule for system call %s() / %d%s: %m",
-                                                        strna(n), id, ignore ? ", ignoring" : "");
-                                if (!ignore)
-                                        return r;
-                        }
+                r = seccomp_rule_add_exact(seccomp, a, id, 0);
+                if (r < 0) {
+                        /* If the system call is not known on this architecture, then that's
+                         * fine, let's ignore it */
+                        _cleanup_free_ char *n = NULL;
+                        bool ignore;
+
+                        n = seccomp_syscall_resolve_num_arch(SCMP_ARCH_NATIVE, id);
+                        ignore = r == -EDOM;
+                        if (!ignore || log_missing)
+                                log_debug_errno(r, "Failed to add rule for system call %s() / %d%s: %m",
+                                                strna(n), id, ignore ? ", ignoring" : "");
+                        if (!ignore)
+                                return r;
                 }
+        }
 
-                if (default_action != default_action_override)
-                        NULSTR_FOREACH(name, syscall_filter_sets[SYSCALL_FILTER_SET_KNOWN].value) {
-                                int id;
+        if (default_action != default_action_override)
+                NULSTR_FOREACH(name, syscall_filter_sets[SYSCALL_FILTER_SET_KNOWN].value) {
+                        int id;
 
-                                id = seccomp_syscall_resolve_name(name);
-                                if (id < 0)
-                                        continue;
+                        id = seccomp_syscall_resolve_name(name);
+                        if (id < 0)
+                                continue;
 
-                                /* Ignore the syscall if it was already handled above */
-                                if (hashmap_contains(filter, INT_TO_PTR(id + 1)))
-                                        continue;
+                        /* Ignore the syscall if it was already handled above */
+                        if (hashmap_contains(filter, INT_TO_PTR(id + 1)))
+                                continue;
 
-                                r = seccomp_rule_add_exact(seccomp, default_action, id, 0);
-                                if (r < 0 && r != -EDOM)  /* EDOM means that the syscall is not available for arch */
-                                        return log_debug_errno(r, "Failed to add rule for system call %s() / %d: %m",
-                                                               name, id);
-                        }
+                        r = seccomp_rule_add_exact(seccomp, default_action, id, 0);
+                        if (r < 0 && r != -EDOM)  /* EDOM means that the syscall is not available for arch */
+                                return log_debug_errno(r, "Failed to add rule for system call %s() / %d: %m",
+                                                       name, id);
+                }
 
 #if (SCMP_VER_MAJOR == 2 && SCMP_VER_MINOR >= 5) || SCMP_VER_MAJOR > 2
-                /* We have a large filter here, so let's turn on the binary tree mode if possible. */
-                r = seccomp_attr_set(seccomp, SCMP_FLTATR_CTL_OPTIMIZE, 2);
-                if (r < 0)
-                        log_warning_errno(r, "Failed to set SCMP_FLTATR_CTL_OPTIMIZE, ignoring: %m");
+        /* We have a large filter here, so let's turn on the binary tree mode if possible. */
+        r = seccomp_attr_set(seccomp, SCMP_FLTATR_CTL_OPTIMIZE, 2);
+        if (r < 0)
+                log_warning_errno(r, "Failed to set SCMP_FLTATR_CTL_OPTIMIZE, ignoring: %m");
 #endif
 
+        *ret = TAKE_PTR(seccomp);
+        return 0;
+}
+
+int seccomp_load_syscall_filter_set_raw(uint32_t default_action, Hashmap* filter, uint32_t action, bool log_missing) {
+        uint32_t arch;
+        int r;
+
+        /* Similar to seccomp_load_syscall_filter_set(), but takes a raw Hashmap* of syscalls, instead
+         * of a SyscallFilterSet* table. */
+
+        if (hashmap_isempty(filter) && default_action == SCMP_ACT_ALLOW)
+                return 0;
+
+        SECCOMP_FOREACH_LOCAL_ARCH(arch) {
+                _cleanup_(seccomp_releasep) scmp_filter_ctx seccomp = NULL;
+
+                r = seccomp_build_syscall_filter_set_raw(arch, default_action, filter, action, log_missing, &seccomp);
+                if (r < 0)
+                        return r;
+
                 r = seccomp_load(seccomp);
                 if (ERRNO_IS_NEG_SECCOMP_FATAL(r))
                         return r;
@@ -1246,6 +1272,133 @@ int seccomp_load_syscall_filter_set_raw(uint32_t default_action, Hashmap* filter
         return 0;
 }
 
+int seccomp_compile_syscall_filter_set_raw(uint32_t default_action, Hashmap* filter, uint32_t action, bool log_missing, int *ret_fd) {
+        _cleanup_close_ int fd = -EBADF;
+        uint32_t arch;
+        int r;
+
+        assert(ret_fd);
+
+        /* Like seccomp_load_syscall_filter_set_raw(), but instead of installing the filters, compiles them
+         * to BPF and writes the programs for all local architectures into a sealed memfd, which may then
+         * be installed any number of times with seccomp_load_compiled_filter(). Each program is prefixed by
+         * its length in instructions, as uint32_t. Returns 0 and -EBADF if there's nothing to install. */
+
+        if (hashmap_isempty(filter) && default_action == SCMP_ACT_ALLOW) {
+                *ret_fd = -EBADF;
+                return 0;
+        }
+
+        fd = memfd_new("seccomp-filter");
+        if (fd < 0)
+                return fd;
+
+        SECCOMP_FOREACH_LOCAL_ARCH(arch) {
+                _cleanup_(seccomp_releasep) scmp_filter_ctx seccomp = NULL;
+                off_t start, end;
+                uint32_t n;
+
+                r = seccomp_build_syscall_filter_set_raw(arch, default_action, filter, action, log_missing, &seccomp);
+                if (r < 0)
+                        return r;
+
+                start = lseek(fd, sizeof(n), SEEK_CUR);
+                if (start < 0)
+                        return -errno;
+
+                r = seccomp_export_bpf(seccomp, fd);
+                if (r < 0)
+                        return log_debug_errno(r, "Failed to compile system call filter for architecture %s: %m",
+                                               seccomp_arch_to_string(arch));
+
+                end = lseek(fd, 0, SEEK_CUR);
+                if (end < 0)
+                        return -errno;
+
+                if ((end - start) % sizeof(struct sock_filter) != 0 ||
+                    (end - start) / sizeof(struct sock_filter) > BPF_MAXINSNS)
+                        return -EBADMSG;
+
+                n = (end - start) / sizeof(struct sock_filter);
+                if (pwrite(fd, &n, sizeof(n), start - sizeof(n)) != sizeof(n))
+                        return -EIO;
+        }
+
+        r = memfd_set_sealed(fd);
+        if (r < 0)
+                return r;
+
+        *ret_fd = TAKE_FD(fd);
+        return 0;
+}
+
+int seccomp_load_compiled_filter(int fd) {
+        _cleanup_free_ uint8_t *p = NULL;
+        uint64_t size;
+        size_t offset = 0;
+        ssize_t l;
+        int r;
+
+        assert(fd >= 0);
+
+        /* Installs the programs previously generated by seccomp_compile_syscall_filter_set_raw(), without
+         * involving libseccomp. Note that the fd might be shared with other processes, hence we never touch
+         * the file offset. Returns -EOPNOTSUPP if seccomp event logging is requested, since that requires
+         * a filter flag we cannot pass via prctl(), in which case the caller should compile the filter
+         * itself. */
+
+        if (getenv_bool("SYSTEMD_LOG_SECCOMP") > 0)
+                return -EOPNOTSUPP;
+
+        r = memfd_get_size(fd, &size);
+        if (r < 0)
+                return r;
+        if (size == 0)
+                return 0;
+        if (size > SIZE_MAX)
+                return -EFBIG;
+
+        p = malloc(size);
+        if (!p)
+                return -ENOMEM;
+
+        l = pread(fd, p, size, 0);
+        if (l < 0)
+                return -errno;
+        if ((uint64_t) l != size)
+                return -EIO;
+
+        while (offset < size) {
+                struct sock_fprog prog = {};
+                uint32_t n;
+
+                if (size - offset < sizeof(n))
+                        return -EBADMSG;
+
+                memcpy(&n, p + offset, sizeof(n));
+                offset += sizeof(n);
+
+                if (n == 0 || n > BPF_MAXINSNS || (size - offset) / sizeof(struct sock_filter) < n)
+                        return -EBADMSG;
+
+                prog = (struct sock_fprog) {
+                        .len = n,
+                        .filter = (struct sock_filter*) (p + offset),
+                };
+                offset += n * sizeof(struct sock_filter);
+
+                if (prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &prog, 0, 0) < 0) {
+                        r = -errno;
+                        if (ERRNO_IS_NEG_SECCOMP_FATAL(r))
+                                return r;
+
+                        log_debug_errno(r, "Failed to install precompiled system call filter, skipping: %m");
+                }
+        }
+
+        return 0;
+}
+
 int seccomp_parse_syscall_filter(
                 const char *name,
                 int errno_num,
@@ -11,12 +11,66 @@
 #include "memfd-util.h"
 #include "missing_mman.h"
 #include "missing_syscall.h"
+#include "missing_threads.h"
 #include "parse-util.h"
 #include "process-util.h"
 #include "serialize.h"
 #include "strv.h"
 #include "tmpfile-util.h"
 
+/* The tag byte of a record of the binary format. It never starts a line of the text format, which is how
+ * readers tell the two apart. */
+#define SERIALIZE_RECORD_V1 0x1e
+
+static thread_local FILE *binary_file = NULL;
+
+FILE* serialize_binary_start(FILE *f) {
+        assert(f);
+        assert(!binary_file);
+
+        return binary_file = f;
+}
+
+FILE* serialize_binary_stop(FILE *f) {
+        assert(f);
+        assert(binary_file == f);
+
+        binary_file = NULL;
+        return NULL;
+}
+
+static void serialize_write_item(FILE *f, const char *key, const char *value) {
+        size_t k, v;
+
+        assert(f);
+        assert(key);
+        assert(value);
+
+        if (f != binary_file) {
+                fputs(key, f);
+                fputc('=', f);
+                fputs(value, f);
+                fputc('\n', f);
+                return;
+        }
+
+        k = strlen(key);
+        v = strlen(value);
+
+        fputc(SERIALIZE_RECORD_V1, f);
+        for (size_t n = k + 1 + v;; ) {
+                uint8_t b = n & 0x7f;
+
+                n >>= 7;
+                fputc(n > 0 ? b | 0x80 : b, f);
+                if (n == 0)
+                        break;
+        }
+        fwrite(key, 1, k, f);
+        fputc('=', f);
+        fwrite(value, 1, v, f);
+}
+
 int serialize_item(FILE *f, const char *key, const char *value) {
         assert(f);
         assert(key);
@@ -29,11 +83,7 @@ int serialize_item(FILE *f, const char *key, const char *value) {
         if (strlen(key) + 1 + strlen(value) + 1 > LONG_LINE_MAX)
                 return log_warning_errno(SYNTHETIC_ERRNO(EINVAL), "Attempted to serialize overly long item '%s', refusing.", key);
 
-        fputs(key, f);
-        fputc('=', f);
-        fputs(value, f);
-        fputc('\n', f);
-
+        serialize_write_item(f, key, value);
         return 1;
 }
 
@@ -91,11 +141,7 @@ int serialize_item_format(FILE *f, const char *key, const char *format, ...) {
                 b = allocated;
         }
 
-        fputs(key, f);
-        fputc('=', f);
-        fputs(b, f);
-        fputc('\n', f);
-
+        serialize_write_item(f, key, b);
         return 1;
 }
 
@@ -309,14 +355,64 @@ int serialize_image_policy(FILE *f, const char *key, const ImagePolicy *p) {
         return 1;
 }
 
+static int read_record(FILE *f, char **ret) {
+        _cleanup_free_ char *s = NULL;
+        size_t n = 0;
+
+        assert(f);
+        assert(ret);
+
+        /* Reads the rest of a record of the binary format, after its tag byte */
+
+        for (unsigned shift = 0;; shift += 7) {
+                int c;
+
+                /* Records are never longer than lines of the text format */
+                if (shift >= 28)
+                        return -EBADMSG;
+
+                c = getc(f);
+                if (c == EOF)
+                        return ferror(f) ? -EIO : -EBADMSG;
+
+                n |= (size_t) (c & 0x7f) << shift;
+                if (!(c & 0x80))
+                        break;
+        }
+
+        if (n >= LONG_LINE_MAX)
+                return -EBADMSG;
+
+        s = new(char, n + 1);
+        if (!s)
+                return -ENOMEM;
+
+        if (fread(s, 1, n, f) != n)
+                return ferror(f) ? -EIO : -EBADMSG;
+
+        if (memchr(s, 0, n))
+                return -EBADMSG;
+
+        s[n] = 0;
+        *ret = TAKE_PTR(s);
+        return 1;
+}
+
 int deserialize_read_line(FILE *f, char **ret) {
         _cleanup_free_ char *line = NULL;
-        int r;
+        int c, r;
 
         assert(f);
         assert(ret);
 
-        r = read_stripped_line(f, LONG_LINE_MAX, &line);
+        /* Items may have been written in the text or the binary format, tell them apart by the first byte */
+        c = getc(f);
+        if (c == SERIALIZE_RECORD_V1)
+                r = read_record(f, &line);
+        else if (c != EOF && ungetc(c, f) == EOF)
+                r = -EIO;
+        else
+                r = read_stripped_line(f, LONG_LINE_MAX, &line);
         if (r < 0)
                 return log_error_errno(r, "Failed to read serialization line: %m");
         if (r == 0) { /* eof */
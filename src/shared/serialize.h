@@ -12,6 +12,15 @@
 #include "string-util.h"
 #include "time-util.h"
 
+/* By default items are serialized as lines of text, "key=value\n". Items serialized to a FILE object
+ * between serialize_binary_start() and serialize_binary_stop() on the same thread are written as binary
+ * records instead: a tag byte, the LEB128 encoded length of "key=value", followed by that string. These can
+ * be read back without scanning for the end of the line and stripping whitespace. deserialize_read_line()
+ * understands both, hence the formats may be mixed, and readers do not need to know which one was used. */
+FILE* serialize_binary_start(FILE *f);
+FILE* serialize_binary_stop(FILE *f);
+DEFINE_TRIVIAL_CLEANUP_FUNC(FILE*, serialize_binary_stop);
+
 int serialize_item(FILE *f, const char *key, const char *value);
 int serialize_item_escaped(FILE *f, const char *key, const char *value);
 int serialize_item_format(FILE *f, const char *key, const char *value, ...) _printf_(3,4);
@@ -8,8 +8,10 @@
 #include <sys/wait.h>
 
 #include "sd-bus.h"
+#include "sd-json.h"
 
 #include "alloc-util.h"
+#include "architecture.h"
 #include "bus-error.h"
 #include "bus-locator.h"
 #include "bus-util.h"
@@ -19,6 +21,7 @@
 #include "env-file.h"
 #include "env-util.h"
 #include "fd-util.h"
+#include "fileio.h"
 #include "fs-util.h"
 #include "log.h"
 #include "mountpoint-util.h"
@@ -29,6 +32,7 @@
 #include "strv.h"
 #include "tests.h"
 #include "tmpfile-util.h"
+#include "version.h"
 
 char* setup_fake_runtime_dir(void) {
         char t[] = "/tmp/fake-xdg-runtime-XXXXXX", *p;
@@ -349,3 +353,48 @@ const char* ci_environment(void) {
 
         return (ans = NULL);
 }
+
+void benchmark_report(const char *scenario, uint64_t n, usec_t t) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        const char *e;
+        double ns;
+        int r;
+
+        assert(scenario);
+
+        ns = n > 0 ? (double) t * NSEC_PER_USEC / n : 0;
+
+        log_info("%s: %" PRIu64 " in %s (%.1fns each)", scenario, n, FORMAT_TIMESPAN(t, 1), ns);
+
+        e = secure_getenv("SYSTEMD_BENCHMARK_JSON");
+        if (isempty(e))
+                return;
+
+        r = sd_json_buildo(
+                        &v,
+                        SD_JSON_BUILD_PAIR_STRING("benchmark", program_invocation_short_name),
+                        SD_JSON_BUILD_PAIR_STRING("scenario", scenario),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("count", n),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("usec", t),
+                        SD_JSON_BUILD_PAIR_REAL("nsecPerOperation", ns),
+                        SD_JSON_BUILD_PAIR_STRING("version", PROJECT_VERSION_FULL " (" GIT_VERSION ")"),
+                        SD_JSON_BUILD_PAIR_STRING("architecture", architecture_to_string(uname_architecture())),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("timestamp", now(CLOCK_REALTIME)));
+        if (r < 0)
+                return (void) log_warning_errno(r, "Failed to build benchmark result, ignoring: %m");
+
+        if (!streq(e, "-")) {
+                f = fopen(e, "ae");
+                if (!f)
+                        return (void) log_warning_errno(errno, "Failed to open %s, ignoring: %m", e);
+        }
+
+        r = sd_json_variant_dump(v, SD_JSON_FORMAT_NEWLINE, f ?: stdout, /* prefix= */ NULL);
+        if (r < 0)
+                return (void) log_warning_errno(r, "Failed to write benchmark result, ignoring: %m");
+
+        r = fflush_and_check(f ?: stdout);
+        if (r < 0)
+                log_warning_errno(r, "Failed to write benchmark result, ignoring: %m");
+}
@@ -15,6 +15,7 @@
 #include "signal-util.h"
 #include "static-destruct.h"
 #include "strv.h"
+#include "time-util.h"
 
 static inline void log_set_assert_return_is_criticalp(bool *p) {
         log_set_assert_return_is_critical(*p);
@@ -97,6 +98,17 @@ bool can_memlock(void);
 /* Provide a convenient way to check if we're running in CI. */
 const char* ci_environment(void);
 
+/* Benchmarks report their results with this. If $SYSTEMD_BENCHMARK_JSON is set to a path, each result is
+ * also appended there as one JSON object per line ("-" for stdout), for comparing builds and hosts. */
+void benchmark_report(const char *scenario, uint64_t n, usec_t t);
+
+#define BENCHMARK(scenario, n, expr)                                    \
+        ({                                                              \
+                usec_t _t = now(CLOCK_MONOTONIC);                       \
+                expr;                                                   \
+                benchmark_report(scenario, n, now(CLOCK_MONOTONIC) - _t); \
+        })
+
 typedef struct TestFunc {
         union f {
                 void (*void_func)(void);
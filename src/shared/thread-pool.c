@@ -0,0 +1,389 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <pthread.h>
+#include <signal.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "alloc-util.h"
+#include "cpu-set-util.h"
+#include "fd-util.h"
+#include "io-util.h"
+#include "list.h"
+#include "log.h"
+#include "string-util.h"
+#include "thread-pool.h"
+
+typedef struct ThreadPoolItem ThreadPoolItem;
+
+struct ThreadPoolItem {
+        LIST_FIELDS(ThreadPoolItem, items);
+
+        thread_pool_work_t work;
+        thread_pool_done_t done;
+        void *userdata;
+        int result;
+};
+
+typedef struct ThreadPoolWorker {
+        ThreadPool *pool;
+        unsigned index;
+        pthread_t thread;
+
+        /* Protects the queue. The owning worker takes items from its head, others steal from its tail. */
+        pthread_mutex_t mutex;
+        LIST_HEAD(ThreadPoolItem, queue);
+        ThreadPoolItem *queue_tail;
+} ThreadPoolWorker;
+
+struct ThreadPool {
+        unsigned n_ref;
+        char *name;
+
+        sd_event *event;
+        sd_event_source *event_source;
+        int notify_fd;
+
+        /* Protects everything below. 'cond' is signalled when items are queued, and broadcast when the
+         * pool is stopped. Lock order: the pool's mutex first, then the workers' ones. */
+        pthread_mutex_t mutex;
+        pthread_cond_t cond;
+        size_t n_queued; /* Never less than the number of items in the workers' queues */
+        unsigned n_idle;
+        bool stop;
+        LIST_HEAD(ThreadPoolItem, done);
+        ThreadPoolItem *done_tail;
+
+        /* Only accessed by the loop thread */
+        size_t queue_size;
+        size_t n_pending;
+        unsigned n_started;
+        unsigned next_worker;
+
+        unsigned n_threads;
+        ThreadPoolWorker workers[];
+};
+
+static ThreadPoolItem* worker_pop(ThreadPoolWorker *w, bool steal) {
+        ThreadPoolItem *i;
+
+        assert(w);
+
+        assert_se(pthread_mutex_lock(&w->mutex) == 0);
+
+        i = steal ? w->queue_tail : w->queue;
+        if (i) {
+                if (i == w->queue_tail)
+                        w->queue_tail = i->items_prev;
+                LIST_REMOVE(items, w->queue, i);
+        }
+
+        assert_se(pthread_mutex_unlock(&w->mutex) == 0);
+        return i;
+}
+
+static ThreadPoolItem* worker_take(ThreadPoolWorker *w) {
+        ThreadPool *p = ASSERT_PTR(ASSERT_PTR(w)->pool);
+        ThreadPoolItem *i;
+
+        i = worker_pop(w, /* steal= */ false);
+        if (i)
+                return i;
+
+        /* Our own queue is empty, help out the others. The queues of all workers are initialized when the
+         * pool is created, hence this is safe even for the ones not started yet, whose queues are empty. */
+        for (unsigned k = 1; k < p->n_threads; k++) {
+                i = worker_pop(&p->workers[(w->index + k) % p->n_threads], /* steal= */ true);
+                if (i)
+                        return i;
+        }
+
+        return NULL;
+}
+
+static void thread_pool_notify(ThreadPool *p) {
+        static const uint64_t one = 1;
+
+        assert(p);
+
+        if (write(p->notify_fd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+                log_debug_errno(errno, "Failed to notify event loop about completed work of thread pool %s, ignoring: %m", p->name);
+}
+
+static void* thread_pool_worker_thread(void *userdata) {
+        ThreadPoolWorker *w = ASSERT_PTR(userdata);
+        ThreadPool *p = ASSERT_PTR(w->pool);
+
+        (void) pthread_setname_np(pthread_self(), p->name);
+
+        assert_se(pthread_mutex_lock(&p->mutex) == 0);
+
+        for (;;) {
+                ThreadPoolItem *i;
+
+                while (!p->stop && p->n_queued == 0) {
+                        p->n_idle++;
+                        assert_se(pthread_cond_wait(&p->cond, &p->mutex) == 0);
+                        p->n_idle--;
+                }
+
+                /* Items not started yet are cancelled by thread_pool_free() */
+                if (p->stop)
+                        break;
+
+                assert_se(pthread_mutex_unlock(&p->mutex) == 0);
+                i = worker_take(w);
+                assert_se(pthread_mutex_lock(&p->mutex) == 0);
+
+                /* Another worker took the item we were woken up for, but did not account for it yet */
+                if (!i)
+                        continue;
+
+                assert(p->n_queued > 0);
+                p->n_queued--;
+
+                assert_se(pthread_mutex_unlock(&p->mutex) == 0);
+                i->result = i->work(i->userdata);
+                assert_se(pthread_mutex_lock(&p->mutex) == 0);
+
+                /* The loop thread is only woken up once for all items completed until it gets to them */
+                if (!p->done)
+                        thread_pool_notify(p);
+
+                LIST_INSERT_AFTER(items, p->done, p->done_tail, i);
+                p->done_tail = i;
+        }
+
+        assert_se(pthread_mutex_unlock(&p->mutex) == 0);
+        return NULL;
+}
+
+static void thread_pool_dispatch_list(ThreadPool *p, ThreadPoolItem *list, int result) {
+        ThreadPoolItem *i;
+
+        assert(p);
+
+        /* A negative result overrides the results of the items, i.e. cancels them */
+
+        while ((i = LIST_POP(items, list))) {
+                assert(p->n_pending > 0);
+                p->n_pending--;
+
+                i->done(p, result < 0 ? result : i->result, i->userdata);
+                free(i);
+        }
+}
+
+static int on_notify(sd_event_source *s, int fd, uint32_t revents, void *userdata) {
+        _unused_ _cleanup_(thread_pool_unrefp) ThreadPool *ref = thread_pool_ref(userdata);
+        ThreadPool *p = ASSERT_PTR(userdata);
+        ThreadPoolItem *list;
+
+        (void) flush_fd(fd);
+
+        assert_se(pthread_mutex_lock(&p->mutex) == 0);
+        list = TAKE_PTR(p->done);
+        p->done_tail = NULL;
+        assert_se(pthread_mutex_unlock(&p->mutex) == 0);
+
+        /* The completion callbacks may drop the last reference to the pool, hence we hold one */
+        thread_pool_dispatch_list(p, list, 0);
+        return 0;
+}
+
+static ThreadPool* thread_pool_free(ThreadPool *p) {
+        ThreadPoolItem *cancelled = NULL, *done;
+
+        if (!p)
+                return NULL;
+
+        assert_se(pthread_mutex_lock(&p->mutex) == 0);
+        p->stop = true;
+        assert_se(pthread_cond_broadcast(&p->cond) == 0);
+        assert_se(pthread_mutex_unlock(&p->mutex) == 0);
+
+        for (unsigned k = 0; k < p->n_started; k++)
+                assert_se(pthread_join(p->workers[k].thread, NULL) == 0);
+
+        /* All workers are gone, no need to lock anything anymore */
+        for (unsigned k = 0; k < p->n_threads; k++) {
+                ThreadPoolWorker *w = p->workers + k;
+
+                if (w->queue)
+                        LIST_JOIN(items, cancelled, w->queue);
+
+                assert_se(pthread_mutex_destroy(&w->mutex) == 0);
+        }
+
+        /* Let the owners of the items release their resources. Items that completed already get their
+         * results, before the others are cancelled. */
+        done = TAKE_PTR(p->done);
+        thread_pool_dispatch_list(p, done, 0);
+        thread_pool_dispatch_list(p, cancelled, -ECANCELED);
+        assert(p->n_pending == 0);
+
+        assert_se(pthread_mutex_destroy(&p->mutex) == 0);
+        assert_se(pthread_cond_destroy(&p->cond) == 0);
+
+        sd_event_source_disable_unref(p->event_source);
+        sd_event_unref(p->event);
+        safe_close(p->notify_fd);
+        free(p->name);
+
+        return mfree(p);
+}
+
+DEFINE_TRIVIAL_REF_UNREF_FUNC(ThreadPool, thread_pool, thread_pool_free);
+
+int thread_pool_new(sd_event *e, const char *name, unsigned n_threads, size_t queue_size, ThreadPool **ret) {
+        _cleanup_(thread_pool_unrefp) ThreadPool *p = NULL;
+        int r;
+
+        assert(e);
+        assert(name);
+        assert(ret);
+
+        if (n_threads == 0) {
+                r = cpus_in_affinity_mask();
+                n_threads = r > 0 ? (unsigned) r : 1;
+        }
+        n_threads = MIN(n_threads, THREAD_POOL_THREADS_MAX);
+
+        p = malloc0(offsetof(ThreadPool, workers) + n_threads * sizeof(ThreadPoolWorker));
+        if (!p)
+                return -ENOMEM;
+
+        p->n_ref = 1;
+        p->notify_fd = -EBADF;
+        p->mutex = (pthread_mutex_t) PTHREAD_MUTEX_INITIALIZER;
+        p->cond = (pthread_cond_t) PTHREAD_COND_INITIALIZER;
+        p->queue_size = queue_size > 0 ? queue_size : THREAD_POOL_QUEUE_SIZE_DEFAULT;
+        p->n_threads = n_threads;
+        p->event = sd_event_ref(e);
+
+        for (unsigned k = 0; k < n_threads; k++)
+                p->workers[k] = (ThreadPoolWorker) {
+                        .pool = p,
+                        .index = k,
+                        .mutex = PTHREAD_MUTEX_INITIALIZER,
+                };
+
+        /* Thread names are limited to 15 characters */
+        p->name = strndup(name, 15);
+        if (!p->name)
+                return -ENOMEM;
+
+        p->notify_fd = eventfd(0, EFD_CLOEXEC|EFD_NONBLOCK);
+        if (p->notify_fd < 0)
+                return -errno;
+
+        r = sd_event_add_io(e, &p->event_source, p->notify_fd, EPOLLIN, on_notify, p);
+        if (r < 0)
+                return r;
+
+        (void) sd_event_source_set_description(p->event_source, p->name);
+
+        *ret = TAKE_PTR(p);
+        return 0;
+}
+
+int thread_pool_set_priority(ThreadPool *p, int64_t priority) {
+        assert(p);
+
+        return sd_event_source_set_priority(p->event_source, priority);
+}
+
+static int thread_pool_start_worker(ThreadPool *p) {
+        ThreadPoolWorker *w;
+        sigset_t ss, saved_ss;
+        int r, k;
+
+        assert(p);
+        assert(p->n_started < p->n_threads);
+
+        w = p->workers + p->n_started;
+
+        assert_se(sigfillset(&ss) >= 0);
+        /* Don't block SIGBUS, the work items might access memory mapped files. */
+        assert_se(sigdelset(&ss, SIGBUS) >= 0);
+
+        r = pthread_sigmask(SIG_BLOCK, &ss, &saved_ss);
+        if (r > 0)
+                return -r;
+
+        r = pthread_create(&w->thread, NULL, thread_pool_worker_thread, w);
+
+        k = pthread_sigmask(SIG_SETMASK, &saved_ss, NULL);
+        if (r > 0)
+                return -r;
+
+        p->n_started++;
+
+        if (k > 0)
+                return -k;
+
+        return 0;
+}
+
+int thread_pool_submit(ThreadPool *p, thread_pool_work_t work, thread_pool_done_t done, void *userdata) {
+        ThreadPoolItem *i;
+        ThreadPoolWorker *w;
+        bool start;
+        int r;
+
+        assert(p);
+        assert(work);
+        assert(done);
+
+        assert_se(pthread_mutex_lock(&p->mutex) == 0);
+        if (p->n_queued >= p->queue_size) {
+                assert_se(pthread_mutex_unlock(&p->mutex) == 0);
+                return -ENOBUFS;
+        }
+
+        /* Start another worker if the idle ones are busy with the items queued already */
+        start = p->n_started < p->n_threads && p->n_idle <= p->n_queued;
+        assert_se(pthread_mutex_unlock(&p->mutex) == 0);
+
+        if (start) {
+                r = thread_pool_start_worker(p);
+                if (r < 0) {
+                        if (p->n_started == 0)
+                                return log_debug_errno(r, "Failed to start worker thread of thread pool %s: %m", p->name);
+
+                        log_debug_errno(r, "Failed to start another worker thread of thread pool %s, ignoring: %m", p->name);
+                }
+        }
+
+        i = new(ThreadPoolItem, 1);
+        if (!i)
+                return -ENOMEM;
+
+        *i = (ThreadPoolItem) {
+                .work = work,
+                .done = done,
+                .userdata = userdata,
+        };
+
+        w = p->workers + (p->next_worker++ % p->n_started);
+
+        assert_se(pthread_mutex_lock(&p->mutex) == 0);
+
+        assert_se(pthread_mutex_lock(&w->mutex) == 0);
+        LIST_INSERT_AFTER(items, w->queue, w->queue_tail, i);
+        w->queue_tail = i;
+        assert_se(pthread_mutex_unlock(&w->mutex) == 0);
+
+        p->n_queued++;
+        assert_se(pthread_cond_signal(&p->cond) == 0);
+        assert_se(pthread_mutex_unlock(&p->mutex) == 0);
+
+        p->n_pending++;
+        return 0;
+}
+
+size_t thread_pool_get_n_pending(ThreadPool *p) {
+        assert(p);
+
+        return p->n_pending;
+}
@@ -0,0 +1,44 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+#pragma once
+
+#include <stddef.h>
+
+#include "sd-event.h"
+
+#include "macro.h"
+
+/* A pool of worker threads bound to an event loop, for CPU-heavy work that should not block the loop. Work
+ * items are submitted from the loop thread, run in one of the worker threads, and their completion
+ * callbacks are dispatched back on the loop thread. Each worker has a queue of its own, which items are
+ * distributed to round-robin, and idle workers take items from the queues of busy ones. Workers are
+ * started on demand, up to the number of threads the pool was created with.
+ *
+ * Note that processes using a pool must not use the clone() based helpers from async.h, see there. */
+
+#define THREAD_POOL_THREADS_MAX 64U
+#define THREAD_POOL_QUEUE_SIZE_DEFAULT 1024U
+
+typedef struct ThreadPool ThreadPool;
+
+/* Called in a worker thread. Must not touch any state of the loop thread without synchronization. */
+typedef int (*thread_pool_work_t)(void *userdata);
+
+/* Called in the loop thread, with the return value of the work function, or -ECANCELED if the pool was
+ * freed before the work item was started. When the pool is freed, the callbacks of all outstanding work
+ * items are called from thread_pool_unref(), after waiting for the running ones. */
+typedef void (*thread_pool_done_t)(ThreadPool *p, int result, void *userdata);
+
+/* If n_threads is zero, one thread per CPU is used, up to THREAD_POOL_THREADS_MAX. queue_size limits the
+ * number of work items that are not started yet, zero selects THREAD_POOL_QUEUE_SIZE_DEFAULT. */
+int thread_pool_new(sd_event *e, const char *name, unsigned n_threads, size_t queue_size, ThreadPool **ret);
+ThreadPool* thread_pool_ref(ThreadPool *p);
+ThreadPool* thread_pool_unref(ThreadPool *p);
+DEFINE_TRIVIAL_CLEANUP_FUNC(ThreadPool*, thread_pool_unref);
+
+int thread_pool_set_priority(ThreadPool *p, int64_t priority);
+
+/* Returns -ENOBUFS if the queue is full */
+int thread_pool_submit(ThreadPool *p, thread_pool_work_t work, thread_pool_done_t done, void *userdata);
+
+/* The number of work items submitted whose completion callbacks have not been dispatched yet */
+size_t thread_pool_get_n_pending(ThreadPool *p);
@@ -606,8 +606,12 @@ static Tpm2Context *tpm2_context_free(Tpm2Context *c) {
         if (!c)
                 return NULL;
 
-        if (c->esys_context)
+        if (c->esys_context) {
+                if (c->cached_primary != ESYS_TR_NONE)
+                        (void) sym_Esys_FlushContext(c->esys_context, c->cached_primary);
+
                 sym_Esys_Finalize(&c->esys_context);
+        }
 
         c->tcti_context = mfree(c->tcti_context);
         c->tcti_dl = safe_dlclose(c->tcti_dl);
@@ -640,6 +644,7 @@ int tpm2_context_new(const char *device, Tpm2Context **ret_context) {
 
         *context = (Tpm2Context) {
                 .n_ref = 1,
+                .cached_primary = ESYS_TR_NONE,
         };
 
         r = dlopen_tpm2();
@@ -5581,6 +5586,60 @@ int tpm2_seal(Tpm2Context *c,
 
 #define RETRY_UNSEAL_MAX 30u
 
+static int tpm2_get_legacy_primary(Tpm2Context *c, TPMI_ALG_PUBLIC alg, Tpm2Handle **ret_handle) {
+        _cleanup_(tpm2_handle_freep) Tpm2Handle *handle = NULL;
+        int r;
+
+        assert(c);
+        assert(ret_handle);
+
+        /* Creating a primary key is by far the slowest part of unsealing on many TPMs, hence if the context
+         * is set up for it, create it only once, and hand out non-flushing handles to it afterwards. */
+
+        if (c->cache_primary && c->cached_primary != ESYS_TR_NONE && c->cached_primary_alg == alg) {
+                r = tpm2_handle_new(c, &handle);
+                if (r < 0)
+                        return r;
+
+                handle->esys_handle = c->cached_primary;
+                handle->flush = false;
+
+                log_debug("Reusing cached primary key on TPM.");
+
+                *ret_handle = TAKE_PTR(handle);
+                return 0;
+        }
+
+        TPM2B_PUBLIC template = {
+                .size = sizeof(TPMT_PUBLIC),
+        };
+        r = tpm2_get_legacy_template(alg, &template.publicArea);
+        if (r < 0)
+                return log_debug_errno(r, "Could not get legacy template: %m");
+
+        r = tpm2_create_primary(
+                        c,
+                        /* session= */ NULL,
+                        &template,
+                        /* sensitive= */ NULL,
+                        /* ret_public= */ NULL,
+                        &handle);
+        if (r < 0)
+                return r;
+
+        if (c->cache_primary) {
+                /* Only keep one around, transient object slots are scarce on some TPMs */
+                tpm2_handle_cleanup(c->esys_context, c->cached_primary, /* flush= */ true);
+
+                c->cached_primary = handle->esys_handle;
+                c->cached_primary_alg = alg;
+                handle->flush = false;
+        }
+
+        *ret_handle = TAKE_PTR(handle);
+        return 0;
+}
+
 int tpm2_unseal(Tpm2Context *c,
                 uint32_t hash_pcr_mask,
                 uint16_t pcr_bank,
@@ -5637,20 +5696,7 @@ int tpm2_unseal(Tpm2Context *c,
                 if (r < 0)
                         return r;
         } else if (primary_alg != 0) {
-                TPM2B_PUBLIC template = {
-                        .size = sizeof(TPMT_PUBLIC),
-                };
-                r = tpm2_get_legacy_template(primary_alg, &template.publicArea);
-                if (r < 0)
-                        return log_debug_errno(r, "Could not get legacy template: %m");
-
-                r = tpm2_create_primary(
-                                c,
-                                /* session= */ NULL,
-                                &template,
-                                /* sensitive= */ NULL,
-                                /* ret_public= */ NULL,
-                                &primary_handle);
+                r = tpm2_get_legacy_primary(c, primary_alg, &primary_handle);
                 if (r < 0)
                         return r;
         } else
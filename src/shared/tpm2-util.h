@@ -69,6 +69,12 @@ typedef struct {
         TPM2_ECC_CURVE *capability_ecc_curves;
         size_t n_capability_ecc_curves;
         TPML_PCR_SELECTION capability_pcrs;
+
+        /* If enabled, the transient primary key created from a legacy template when unsealing is kept
+         * loaded, so that unsealing further objects with this context doesn't have to create it again. */
+        bool cache_primary;
+        TPMI_ALG_PUBLIC cached_primary_alg;
+        ESYS_TR cached_primary;
 } Tpm2Context;
 
 int tpm2_context_new(const char *device, Tpm2Context **ret_context);
@@ -1351,7 +1351,7 @@ static int dispatch_per_machine(const char *name, sd_json_variant *variant, sd_j
                 if (r == 0)
                         continue;
 
-                r = sd_json_dispatch(e, per_machine_dispatch_table, flags, userdata);
+                r = json_dispatch_indexed(e, per_machine_dispatch_table, flags, userdata);
                 if (r < 0)
                         return r;
         }
@@ -1403,7 +1403,7 @@ static int dispatch_status(const char *name, sd_json_variant *variant, sd_json_d
         if (!m)
                 return 0;
 
-        return sd_json_dispatch(m, status_dispatch_table, flags, userdata);
+        return json_dispatch_indexed(m, status_dispatch_table, flags, userdata);
 }
 
 int user_record_build_image_path(UserStorage storage, const char *user_name_and_realm, char **ret) {
@@ -1701,7 +1701,7 @@ int user_record_load(UserRecord *h, sd_json_variant *v, UserRecordLoadFlags load
         if (r < 0)
                 return r;
 
-        r = sd_json_dispatch(h->json, user_dispatch_table, json_flags | SD_JSON_ALLOW_EXTENSIONS, h);
+        r = json_dispatch_indexed(h->json, user_dispatch_table, json_flags | SD_JSON_ALLOW_EXTENSIONS, h);
         if (r < 0)
                 return r;
 
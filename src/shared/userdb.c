@@ -8,11 +8,15 @@
 #include "errno-util.h"
 #include "fd-util.h"
 #include "format-util.h"
+#include "io-util.h"
 #include "json-util.h"
 #include "missing_syscall.h"
+#include "missing_threads.h"
 #include "parse-util.h"
+#include "process-util.h"
 #include "set.h"
 #include "socket-util.h"
+#include "stat-util.h"
 #include "strv.h"
 #include "user-record-nss.h"
 #include "user-util.h"
@@ -22,6 +26,17 @@
 
 DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(link_hash_ops, void, trivial_hash_func, trivial_compare_func, Varlink, varlink_unref);
 
+/* After a single record lookup the connection to the multiplexer is kept around for this long, so that
+ * the next lookup from the same thread can skip the connection setup. systemd-userdbd dedicates a worker
+ * process to each connection and lets it go after 15s of idleness, hence stay well below that, so that we
+ * don't race against the worker closing the connection, and don't hold on to workers for long. */
+#define MULTIPLEXER_REUSE_USEC (5 * USEC_PER_SEC)
+
+static thread_local Varlink *multiplexer_link = NULL;
+static thread_local struct stat multiplexer_link_stat = {};
+static thread_local pid_t multiplexer_link_pid = 0;
+static thread_local usec_t multiplexer_link_timestamp = 0;
+
 typedef enum LookupWhat {
         LOOKUP_USER,
         LOOKUP_GROUP,
@@ -33,6 +48,8 @@ struct UserDBIterator {
         LookupWhat what;
         UserDBFlags flags;
         Set *links;
+        Varlink *reusable_link;
+        bool multiplexer_reusable:1;
         bool nss_covered:1;
         bool nss_iterating:1;
         bool dropin_covered:1;
@@ -53,10 +70,72 @@ struct UserDBIterator {
         char *filter_user_name, *filter_group_name;
 };
 
+static void multiplexer_link_store(Varlink *link) {
+        struct stat st;
+        int fd;
+
+        if (!link)
+                return;
+
+        /* Only keep the connection if the last call on it completed fully and we don't have one already */
+        if (multiplexer_link || varlink_is_idle(link) <= 0) {
+                varlink_unref(link);
+                return;
+        }
+
+        fd = varlink_get_fd(link);
+        if (fd < 0 || fstat(fd, &st) < 0) {
+                varlink_unref(link);
+                return;
+        }
+
+        varlink_detach_event(link);
+        varlink_set_userdata(link, NULL);
+
+        multiplexer_link = link;
+        multiplexer_link_stat = st;
+        multiplexer_link_pid = getpid_cached();
+        multiplexer_link_timestamp = now(CLOCK_MONOTONIC);
+}
+
+static Varlink* multiplexer_link_take(void) {
+        _cleanup_(varlink_unrefp) Varlink *link = TAKE_PTR(multiplexer_link);
+        struct stat st;
+        int fd;
+
+        if (!link)
+                return NULL;
+
+        fd = varlink_get_fd(link);
+        if (fd < 0 || fstat(fd, &st) < 0 || !stat_inode_same(&st, &multiplexer_link_stat)) {
+                /* Somebody closed the fd behind our back, for example via close_all_fds() after fork(),
+                 * and the fd number might refer to something else by now. Don't close that, but forget
+                 * about the connection object (and leak it). */
+                TAKE_PTR(link);
+                return NULL;
+        }
+
+        /* After fork() parent and child share the socket, and they must not interleave their calls on it.
+         * Close our copy of the fd, the parent's copy remains untouched. */
+        if (multiplexer_link_pid != getpid_cached())
+                return NULL;
+
+        if (usec_sub_unsigned(now(CLOCK_MONOTONIC), multiplexer_link_timestamp) > MULTIPLEXER_REUSE_USEC)
+                return NULL;
+
+        /* The server never sends anything while no call is pending, hence if the socket is readable now
+         * the server closed the connection (or is confused), and we shouldn't reuse it. */
+        if (fd_wait_for_event(fd, POLLIN, 0) != 0)
+                return NULL;
+
+        return TAKE_PTR(link);
+}
+
 UserDBIterator* userdb_iterator_free(UserDBIterator *iterator) {
         if (!iterator)
                 return NULL;
 
+        multiplexer_link_store(TAKE_PTR(iterator->reusable_link));
         set_free(iterator->links);
         strv_free(iterator->dropins);
 
@@ -336,7 +415,15 @@ finish:
                 iterator->error = -r;
 
         assert_se(set_remove(iterator->links, link) == link);
-        link = varlink_unref(link);
+
+        /* Keep the connection to the multiplexer around for the next lookup, unless it failed on the
+         * transport level */
+        if (iterator->multiplexer_reusable &&
+            !iterator->reusable_link &&
+            !STRPTR_IN_SET(error_id, VARLINK_ERROR_DISCONNECTED, VARLINK_ERROR_TIMEOUT, VARLINK_ERROR_PROTOCOL))
+                iterator->reusable_link = TAKE_PTR(link);
+        else
+                link = varlink_unref(link);
         return 0;
 }
 
@@ -345,6 +432,7 @@ static int userdb_connect(
                 const char *path,
                 const char *method,
                 bool more,
+                bool reuse,
                 sd_json_variant *query) {
 
         _cleanup_(varlink_unrefp) Varlink *vl = NULL;
@@ -354,9 +442,21 @@ static int userdb_connect(
         assert(path);
         assert(method);
 
-        r = varlink_connect_address(&vl, path);
-        if (r < 0)
-                return log_debug_errno(r, "Unable to connect to %s: %m", path);
+        /* Connections are only reused for calls that are answered with a single reply. Enumerations and
+         * other calls with "more" set get a connection of their own. */
+        reuse = reuse && !more;
+
+        if (reuse)
+                vl = multiplexer_link_take();
+        if (vl)
+                log_debug("Reusing existing connection to %s.", path);
+        else {
+                r = varlink_connect_address(&vl, path);
+                if (r < 0)
+                        return log_debug_errno(r, "Unable to connect to %s: %m", path);
+
+                (void) varlink_set_description(vl, path);
+        }
 
         varlink_set_userdata(vl, iterator);
 
@@ -370,8 +470,6 @@ static int userdb_connect(
         if (r < 0)
                 return log_debug_errno(r, "Failed to attach varlink connection to event loop: %m");
 
-        (void) varlink_set_description(vl, path);
-
         r = varlink_bind_reply(vl, userdb_on_query_reply);
         if (r < 0)
                 return log_debug_errno(r, "Failed to bind reply callback: %m");
@@ -386,6 +484,8 @@ static int userdb_connect(
         r = set_ensure_consume(&iterator->links, &link_hash_ops, TAKE_PTR(vl));
         if (r < 0)
                 return log_debug_errno(r, "Failed to add varlink connection to set: %m");
+
+        iterator->multiplexer_reusable = reuse;
         return r;
 }
 
@@ -436,7 +536,7 @@ static int userdb_start_query(
                 if (r < 0)
                         return log_debug_errno(r, "Unable to set service JSON field: %m");
 
-                r = userdb_connect(iterator, "/run/systemd/userdb/io.systemd.Multiplexer", method, more, patched_query);
+                r = userdb_connect(iterator, "/run/systemd/userdb/io.systemd.Multiplexer", method, more, /* reuse= */ true, patched_query);
                 if (r >= 0) {
                         iterator->nss_covered = true; /* The multiplexer does NSS */
                         iterator->dropin_covered = true; /* It also handles drop-in stuff */
@@ -492,7 +592,7 @@ static int userdb_start_query(
                 if (r < 0)
                         return log_debug_errno(r, "Unable to set service JSON field: %m");
 
-                r = userdb_connect(iterator, p, method, more, patched_query);
+                r = userdb_connect(iterator, p, method, more, /* reuse= */ false, patched_query);
                 if (is_nss && r >= 0) /* Turn off fallback NSS + dropin if we found the NSS/dropin service
                                        * and could connect to it */
                         iterator->nss_covered = true;
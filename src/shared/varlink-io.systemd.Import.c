@@ -68,7 +68,9 @@ static VARLINK_DEFINE_METHOD(
                 VARLINK_FIELD_COMMENT("The class of the image"),
                 VARLINK_DEFINE_OUTPUT_BY_TYPE(class, ImageClass, 0),
                 VARLINK_FIELD_COMMENT("Progress in percent"),
-                VARLINK_DEFINE_OUTPUT(percent, VARLINK_FLOAT, 0));
+                VARLINK_DEFINE_OUTPUT(percent, VARLINK_FLOAT, 0),
+                VARLINK_FIELD_COMMENT("Current download rate in bytes per second, if known"),
+                VARLINK_DEFINE_OUTPUT(rate, VARLINK_INT, VARLINK_NULLABLE));
 
 static VARLINK_DEFINE_METHOD(
                 Pull,
@@ -7,6 +7,198 @@ static VARLINK_DEFINE_METHOD(Rotate);
 static VARLINK_DEFINE_METHOD(FlushToVar);
 static VARLINK_DEFINE_METHOD(RelinquishVar);
 
+static VARLINK_DEFINE_STRUCT_TYPE(
+                WriterStatistics,
+                VARLINK_FIELD_COMMENT("The name of the writer thread"),
+                VARLINK_DEFINE_FIELD(name, VARLINK_STRING, 0),
+                VARLINK_FIELD_COMMENT("The number of entries currently queued"),
+                VARLINK_DEFINE_FIELD(queueDepth, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The largest number of entries ever queued at once"),
+                VARLINK_DEFINE_FIELD(queueDepthMax, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of entries that may be queued before reading from clients is paused"),
+                VARLINK_DEFINE_FIELD(queueSize, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of entries written by the writer thread"),
+                VARLINK_DEFINE_FIELD(written, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of entries handed back to the main thread, e.g. because a journal file had to be rotated"),
+                VARLINK_DEFINE_FIELD(stalled, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of times reading from clients was paused because the queue was full"),
+                VARLINK_DEFINE_FIELD(blocked, VARLINK_INT, 0));
+
+static VARLINK_DEFINE_METHOD(
+                GetWriterStatistics,
+                VARLINK_FIELD_COMMENT("Statistics of the writer thread, empty if WriterThread= is off"),
+                VARLINK_DEFINE_OUTPUT_BY_TYPE(writers, WriterStatistics, VARLINK_ARRAY));
+
+static VARLINK_DEFINE_STRUCT_TYPE(
+                DatagramStatistics,
+                VARLINK_FIELD_COMMENT("The name of the datagram socket"),
+                VARLINK_DEFINE_FIELD(name, VARLINK_STRING, 0),
+                VARLINK_FIELD_COMMENT("The number of times the socket became readable"),
+                VARLINK_DEFINE_FIELD(wakeups, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of datagrams received"),
+                VARLINK_DEFINE_FIELD(datagrams, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The largest number of datagrams received in a single wakeup"),
+                VARLINK_DEFINE_FIELD(datagramsMaxPerWakeup, VARLINK_INT, 0));
+
+static VARLINK_DEFINE_METHOD(
+                GetDatagramStatistics,
+                VARLINK_FIELD_COMMENT("Statistics of the native, syslog and audit sockets"),
+                VARLINK_DEFINE_OUTPUT_BY_TYPE(sockets, DatagramStatistics, VARLINK_ARRAY));
+
+static VARLINK_DEFINE_METHOD(
+                GetContextCacheStatistics,
+                VARLINK_FIELD_COMMENT("The number of client metadata entries currently cached"),
+                VARLINK_DEFINE_OUTPUT(entries, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The approximate memory used by the cached entries in bytes"),
+                VARLINK_DEFINE_OUTPUT(size, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of cached unit metadata entries, shared by the clients of a unit"),
+                VARLINK_DEFINE_OUTPUT(unitEntries, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of times cached metadata was used without rereading it"),
+                VARLINK_DEFINE_OUTPUT(hits, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of times there was no cached metadata for a client"),
+                VARLINK_DEFINE_OUTPUT(misses, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of times cached metadata was reread because it was outdated"),
+                VARLINK_DEFINE_OUTPUT(refreshes, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of times cached metadata was flushed because the PID was reused or might have been"),
+                VARLINK_DEFINE_OUTPUT(resets, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of entries dropped from the cache to make room"),
+                VARLINK_DEFINE_OUTPUT(evictions, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of times unit metadata read for another client of the same unit was used"),
+                VARLINK_DEFINE_OUTPUT(unitHits, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of times unit metadata was reread"),
+                VARLINK_DEFINE_OUTPUT(unitRefreshes, VARLINK_INT, 0));
+
+static VARLINK_DEFINE_METHOD(
+                GetSyncStatistics,
+                VARLINK_FIELD_COMMENT("The number of times journal files were asked to be synced after a message of high priority"),
+                VARLINK_DEFINE_OUTPUT(requests, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of requests that were covered by a sync that was pending already"),
+                VARLINK_DEFINE_OUTPUT(coalesced, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of journal files synced"),
+                VARLINK_DEFINE_OUTPUT(syncs, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of journal files that failed to be synced"),
+                VARLINK_DEFINE_OUTPUT(failed, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of times the syncer thread woke up to sync files"),
+                VARLINK_DEFINE_OUTPUT(passes, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The median time from a request until the file was synced, over the most recent syncs, in µs"),
+                VARLINK_DEFINE_OUTPUT(latencyP50USec, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The 90th percentile of the sync latency in µs"),
+                VARLINK_DEFINE_OUTPUT(latencyP90USec, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The 99th percentile of the sync latency in µs"),
+                VARLINK_DEFINE_OUTPUT(latencyP99USec, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The maximum sync latency in µs"),
+                VARLINK_DEFINE_OUTPUT(latencyMaxUSec, VARLINK_INT, 0));
+
+static VARLINK_DEFINE_STRUCT_TYPE(
+                TransportStatistics,
+                VARLINK_FIELD_COMMENT("The name of the transport, as in the _TRANSPORT= field"),
+                VARLINK_DEFINE_FIELD(name, VARLINK_STRING, 0),
+                VARLINK_FIELD_COMMENT("The number of messages received via this transport"),
+                VARLINK_DEFINE_FIELD(messages, VARLINK_INT, 0));
+
+static VARLINK_DEFINE_STRUCT_TYPE(
+                HistogramBucket,
+                VARLINK_FIELD_COMMENT("The exclusive upper bound of the bucket in µs, unset for the last bucket"),
+                VARLINK_DEFINE_FIELD(upperBoundUSec, VARLINK_INT, VARLINK_NULLABLE),
+                VARLINK_FIELD_COMMENT("The number of samples in this bucket that did not fit in the previous one"),
+                VARLINK_DEFINE_FIELD(count, VARLINK_INT, 0));
+
+static VARLINK_DEFINE_STRUCT_TYPE(
+                AppendStatistics,
+                VARLINK_FIELD_COMMENT("The type of journal file, one of 'system', 'runtime' or 'user'"),
+                VARLINK_DEFINE_FIELD(name, VARLINK_STRING, 0),
+                VARLINK_FIELD_COMMENT("The number of entries appended"),
+                VARLINK_DEFINE_FIELD(appends, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The total time spent appending them in µs"),
+                VARLINK_DEFINE_FIELD(totalUSec, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The distribution of the time spent per append, empty buckets are left out"),
+                VARLINK_DEFINE_FIELD_BY_TYPE(histogram, HistogramBucket, VARLINK_ARRAY));
+
+static VARLINK_DEFINE_METHOD(
+                GetStatistics,
+                VARLINK_FIELD_COMMENT("The CLOCK_MONOTONIC timestamp the statistics were taken at, for calculating rates"),
+                VARLINK_DEFINE_OUTPUT(timestamp, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of messages received per transport, before any filtering"),
+                VARLINK_DEFINE_OUTPUT_BY_TYPE(transports, TransportStatistics, VARLINK_ARRAY),
+                VARLINK_FIELD_COMMENT("The number of messages dropped because of MaxLevelStore="),
+                VARLINK_DEFINE_OUTPUT(filtered, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of messages dropped because of rate limiting"),
+                VARLINK_DEFINE_OUTPUT(ratelimited, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of times kernel messages were lost because /dev/kmsg was not read quickly enough"),
+                VARLINK_DEFINE_OUTPUT(kernelOverruns, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of messages not forwarded to ForwardToSocket= because the receiver did not keep up"),
+                VARLINK_DEFINE_OUTPUT(forwardSocketDropped, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of messages not forwarded to ForwardToSyslog= because the receiver did not keep up"),
+                VARLINK_DEFINE_OUTPUT(forwardSyslogDropped, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of messages passed on to be written to a journal file"),
+                VARLINK_DEFINE_OUTPUT(stored, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The total size of the fields of these messages in bytes"),
+                VARLINK_DEFINE_OUTPUT(bytesStored, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of times cached client metadata was used"),
+                VARLINK_DEFINE_OUTPUT(contextCacheHits, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of times client metadata had to be read because it was not cached"),
+                VARLINK_DEFINE_OUTPUT(contextCacheMisses, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The size of the data added to the currently open journal files in bytes"),
+                VARLINK_DEFINE_OUTPUT(dataBytes, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The size of that data as stored, i.e. after compression, in bytes"),
+                VARLINK_DEFINE_OUTPUT(dataBytesStored, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("Latencies of appending entries, per type of journal file"),
+                VARLINK_DEFINE_OUTPUT_BY_TYPE(appends, AppendStatistics, VARLINK_ARRAY));
+
+static VARLINK_DEFINE_METHOD(
+                SubscribeStatistics,
+                VARLINK_FIELD_COMMENT("The CLOCK_MONOTONIC timestamp the statistics were taken at, for calculating rates"),
+                VARLINK_DEFINE_OUTPUT(timestamp, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of messages received per transport, before any filtering"),
+                VARLINK_DEFINE_OUTPUT_BY_TYPE(transports, TransportStatistics, VARLINK_ARRAY),
+                VARLINK_FIELD_COMMENT("The number of messages dropped because of MaxLevelStore="),
+                VARLINK_DEFINE_OUTPUT(filtered, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of messages dropped because of rate limiting"),
+                VARLINK_DEFINE_OUTPUT(ratelimited, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of times kernel messages were lost because /dev/kmsg was not read quickly enough"),
+                VARLINK_DEFINE_OUTPUT(kernelOverruns, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of messages not forwarded to ForwardToSocket= because the receiver did not keep up"),
+                VARLINK_DEFINE_OUTPUT(forwardSocketDropped, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of messages not forwarded to ForwardToSyslog= because the receiver did not keep up"),
+                VARLINK_DEFINE_OUTPUT(forwardSyslogDropped, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of messages passed on to be written to a journal file"),
+                VARLINK_DEFINE_OUTPUT(stored, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The total size of the fields of these messages in bytes"),
+                VARLINK_DEFINE_OUTPUT(bytesStored, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of times cached client metadata was used"),
+                VARLINK_DEFINE_OUTPUT(contextCacheHits, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of times client metadata had to be read because it was not cached"),
+                VARLINK_DEFINE_OUTPUT(contextCacheMisses, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The size of the data added to the currently open journal files in bytes"),
+                VARLINK_DEFINE_OUTPUT(dataBytes, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The size of that data as stored, i.e. after compression, in bytes"),
+                VARLINK_DEFINE_OUTPUT(dataBytesStored, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("Latencies of appending entries, per type of journal file"),
+                VARLINK_DEFINE_OUTPUT_BY_TYPE(appends, AppendStatistics, VARLINK_ARRAY));
+
+static VARLINK_DEFINE_METHOD(
+                SubscribeTail,
+                VARLINK_FIELD_COMMENT("The sequence number of the most recently written entry, sent right away, and then whenever entries were written"),
+                VARLINK_DEFINE_OUTPUT(seqnum, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The ID of the sequence number, unset if no journal file was opened yet"),
+                VARLINK_DEFINE_OUTPUT(seqnumId, VARLINK_STRING, VARLINK_NULLABLE));
+
+static VARLINK_DEFINE_STRUCT_TYPE(
+                RateLimitStatistics,
+                VARLINK_FIELD_COMMENT("The unit the messages were logged by"),
+                VARLINK_DEFINE_FIELD(unit, VARLINK_STRING, 0),
+                VARLINK_FIELD_COMMENT("The rate limit interval of the unit in µs, see LogRateLimitIntervalSec="),
+                VARLINK_DEFINE_FIELD(intervalUSec, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of messages of the unit suppressed since it is tracked"),
+                VARLINK_DEFINE_FIELD(suppressed, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of suppressed messages not reported in the journal yet"),
+                VARLINK_DEFINE_FIELD(suppressedPending, VARLINK_INT, 0));
+
+static VARLINK_DEFINE_METHOD(
+                GetRateLimitStatistics,
+                VARLINK_FIELD_COMMENT("Units currently tracked for rate limiting"),
+                VARLINK_DEFINE_OUTPUT_BY_TYPE(units, RateLimitStatistics, VARLINK_ARRAY));
+
 static VARLINK_DEFINE_ERROR(NotSupportedByNamespaces);
 
 VARLINK_DEFINE_INTERFACE(
@@ -16,4 +208,18 @@ VARLINK_DEFINE_INTERFACE(
                 &vl_method_Rotate,
                 &vl_method_FlushToVar,
                 &vl_method_RelinquishVar,
+                &vl_method_GetWriterStatistics,
+                &vl_type_WriterStatistics,
+                &vl_method_GetDatagramStatistics,
+                &vl_type_DatagramStatistics,
+                &vl_method_GetContextCacheStatistics,
+                &vl_method_GetSyncStatistics,
+                &vl_method_GetStatistics,
+                &vl_method_SubscribeStatistics,
+                &vl_method_SubscribeTail,
+                &vl_type_TransportStatistics,
+                &vl_type_HistogramBucket,
+                &vl_type_AppendStatistics,
+                &vl_method_GetRateLimitStatistics,
+                &vl_type_RateLimitStatistics,
                 &vl_error_NotSupportedByNamespaces);
@@ -0,0 +1,75 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include "varlink-io.systemd.Login.h"
+
+static VARLINK_DEFINE_STRUCT_TYPE(
+                Session,
+                VARLINK_DEFINE_FIELD(Id, VARLINK_STRING, 0),
+                VARLINK_DEFINE_FIELD(UID, VARLINK_INT, 0),
+                VARLINK_DEFINE_FIELD(Name, VARLINK_STRING, 0),
+                VARLINK_DEFINE_FIELD(Timestamp, VARLINK_INT, VARLINK_NULLABLE),
+                VARLINK_DEFINE_FIELD(TimestampMonotonic, VARLINK_INT, VARLINK_NULLABLE),
+                VARLINK_DEFINE_FIELD(VTNr, VARLINK_INT, VARLINK_NULLABLE),
+                VARLINK_DEFINE_FIELD(Seat, VARLINK_STRING, VARLINK_NULLABLE),
+                VARLINK_DEFINE_FIELD(TTY, VARLINK_STRING, VARLINK_NULLABLE),
+                VARLINK_DEFINE_FIELD(Display, VARLINK_STRING, VARLINK_NULLABLE),
+                VARLINK_DEFINE_FIELD(Remote, VARLINK_BOOL, 0),
+                VARLINK_DEFINE_FIELD(RemoteHost, VARLINK_STRING, VARLINK_NULLABLE),
+                VARLINK_DEFINE_FIELD(RemoteUser, VARLINK_STRING, VARLINK_NULLABLE),
+                VARLINK_DEFINE_FIELD(Service, VARLINK_STRING, VARLINK_NULLABLE),
+                VARLINK_DEFINE_FIELD(Desktop, VARLINK_STRING, VARLINK_NULLABLE),
+                VARLINK_DEFINE_FIELD(Scope, VARLINK_STRING, VARLINK_NULLABLE),
+                VARLINK_DEFINE_FIELD(Leader, VARLINK_INT, VARLINK_NULLABLE),
+                VARLINK_DEFINE_FIELD(Type, VARLINK_STRING, 0),
+                VARLINK_DEFINE_FIELD(Class, VARLINK_STRING, 0),
+                VARLINK_DEFINE_FIELD(Active, VARLINK_BOOL, 0),
+                VARLINK_DEFINE_FIELD(State, VARLINK_STRING, 0),
+                VARLINK_DEFINE_FIELD(IdleHint, VARLINK_BOOL, 0),
+                VARLINK_DEFINE_FIELD(LockedHint, VARLINK_BOOL, 0));
+
+static VARLINK_DEFINE_STRUCT_TYPE(
+                User,
+                VARLINK_DEFINE_FIELD(UID, VARLINK_INT, 0),
+                VARLINK_DEFINE_FIELD(GID, VARLINK_INT, 0),
+                VARLINK_DEFINE_FIELD(Name, VARLINK_STRING, 0),
+                VARLINK_DEFINE_FIELD(Timestamp, VARLINK_INT, VARLINK_NULLABLE),
+                VARLINK_DEFINE_FIELD(TimestampMonotonic, VARLINK_INT, VARLINK_NULLABLE),
+                VARLINK_DEFINE_FIELD(State, VARLINK_STRING, 0),
+                VARLINK_DEFINE_FIELD(Display, VARLINK_STRING, VARLINK_NULLABLE),
+                VARLINK_DEFINE_FIELD(Sessions, VARLINK_STRING, VARLINK_ARRAY));
+
+static VARLINK_DEFINE_STRUCT_TYPE(
+                Seat,
+                VARLINK_DEFINE_FIELD(Id, VARLINK_STRING, 0),
+                VARLINK_DEFINE_FIELD(ActiveSession, VARLINK_STRING, VARLINK_NULLABLE),
+                VARLINK_DEFINE_FIELD(CanTTY, VARLINK_BOOL, 0),
+                VARLINK_DEFINE_FIELD(CanGraphical, VARLINK_BOOL, 0),
+                VARLINK_DEFINE_FIELD(Sessions, VARLINK_STRING, VARLINK_ARRAY));
+
+static VARLINK_DEFINE_METHOD(
+                Describe,
+                VARLINK_DEFINE_OUTPUT_BY_TYPE(Sessions, Session, VARLINK_ARRAY),
+                VARLINK_DEFINE_OUTPUT_BY_TYPE(Users, User, VARLINK_ARRAY),
+                VARLINK_DEFINE_OUTPUT_BY_TYPE(Seats, Seat, VARLINK_ARRAY));
+
+static VARLINK_DEFINE_METHOD(
+                GetStatistics,
+                VARLINK_FIELD_COMMENT("Number of sessions successfully created since logind was started"),
+                VARLINK_DEFINE_OUTPUT(SessionsCreated, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("Average time from receiving a CreateSession() call until replying to it"),
+                VARLINK_DEFINE_OUTPUT(SessionSetupAverageUSec, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("Longest time from receiving a CreateSession() call until replying to it"),
+                VARLINK_DEFINE_OUTPUT(SessionSetupMaxUSec, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("Number of session and user state files written"),
+                VARLINK_DEFINE_OUTPUT(StateFilesWritten, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("Number of state file updates that were merged into one that was already pending"),
+                VARLINK_DEFINE_OUTPUT(StateFileSavesCoalesced, VARLINK_INT, 0));
+
+VARLINK_DEFINE_INTERFACE(
+                io_systemd_Login,
+                "io.systemd.Login",
+                &vl_method_Describe,
+                &vl_method_GetStatistics,
+                &vl_type_Session,
+                &vl_type_User,
+                &vl_type_Seat);
@@ -0,0 +1,49 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include "varlink-idl.h"
+#include "varlink-io.systemd.MachineImage.h"
+
+static VARLINK_DEFINE_METHOD(
+                List,
+                VARLINK_FIELD_COMMENT("If non-null the name of an image to report details on. If null/unspecified enumerates all images."),
+                VARLINK_DEFINE_INPUT(name, VARLINK_STRING, VARLINK_NULLABLE),
+                VARLINK_FIELD_COMMENT("If true the current disk usage and limits of the image(s) are reported, which might be expensive to acquire."),
+                VARLINK_DEFINE_INPUT(acquireUsage, VARLINK_BOOL, VARLINK_NULLABLE),
+                VARLINK_FIELD_COMMENT("If true the host name, machine ID and OS release data of the image(s) are reported, which requires looking into the image(s)."),
+                VARLINK_DEFINE_INPUT(acquireMetadata, VARLINK_BOOL, VARLINK_NULLABLE),
+                VARLINK_FIELD_COMMENT("Name of the image"),
+                VARLINK_DEFINE_OUTPUT(name, VARLINK_STRING, 0),
+                VARLINK_FIELD_COMMENT("The path to the image"),
+                VARLINK_DEFINE_OUTPUT(path, VARLINK_STRING, VARLINK_NULLABLE),
+                VARLINK_FIELD_COMMENT("The type of the image, one of 'directory', 'subvolume', 'raw', 'block'"),
+                VARLINK_DEFINE_OUTPUT(type, VARLINK_STRING, 0),
+                VARLINK_FIELD_COMMENT("Whether the image is read-only"),
+                VARLINK_DEFINE_OUTPUT(readOnly, VARLINK_BOOL, 0),
+                VARLINK_FIELD_COMMENT("Creation time of the image in µs since the epoch, if known"),
+                VARLINK_DEFINE_OUTPUT(creationTimestamp, VARLINK_INT, VARLINK_NULLABLE),
+                VARLINK_FIELD_COMMENT("Last modification time of the image in µs since the epoch, if known"),
+                VARLINK_DEFINE_OUTPUT(modificationTimestamp, VARLINK_INT, VARLINK_NULLABLE),
+                VARLINK_FIELD_COMMENT("Disk space used by the image in bytes, if requested and known"),
+                VARLINK_DEFINE_OUTPUT(usage, VARLINK_INT, VARLINK_NULLABLE),
+                VARLINK_FIELD_COMMENT("Disk space used exclusively by the image in bytes, if requested and known"),
+                VARLINK_DEFINE_OUTPUT(usageExclusive, VARLINK_INT, VARLINK_NULLABLE),
+                VARLINK_FIELD_COMMENT("Size limit of the image in bytes, if requested and known"),
+                VARLINK_DEFINE_OUTPUT(limit, VARLINK_INT, VARLINK_NULLABLE),
+                VARLINK_FIELD_COMMENT("Limit on the exclusive disk space used by the image in bytes, if requested and known"),
+                VARLINK_DEFINE_OUTPUT(limitExclusive, VARLINK_INT, VARLINK_NULLABLE),
+                VARLINK_FIELD_COMMENT("The host name of the image, if requested and known"),
+                VARLINK_DEFINE_OUTPUT(hostname, VARLINK_STRING, VARLINK_NULLABLE),
+                VARLINK_FIELD_COMMENT("The machine ID of the image, formatted in hexadecimal, if requested and known"),
+                VARLINK_DEFINE_OUTPUT(machineId, VARLINK_STRING, VARLINK_NULLABLE),
+                VARLINK_FIELD_COMMENT("The machine-info data of the image, as KEY=VALUE strings, if requested and known"),
+                VARLINK_DEFINE_OUTPUT(machineInfo, VARLINK_STRING, VARLINK_ARRAY|VARLINK_NULLABLE),
+                VARLINK_FIELD_COMMENT("The os-release data of the image, as KEY=VALUE strings, if requested and known"),
+                VARLINK_DEFINE_OUTPUT(OSRelease, VARLINK_STRING, VARLINK_ARRAY|VARLINK_NULLABLE));
+
+static VARLINK_DEFINE_ERROR(NoSuchImage);
+
+VARLINK_DEFINE_INTERFACE(
+                io_systemd_MachineImage,
+                "io.systemd.MachineImage",
+                &vl_method_List,
+                &vl_error_NoSuchImage);
@@ -0,0 +1,33 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include "varlink-io.systemd.Manager.h"
+
+static VARLINK_DEFINE_METHOD(
+                ListUnitTimes,
+                VARLINK_FIELD_COMMENT("If specified, only units that changed state at or after the specified manager timestamp are returned, e.g. 'units-load-finish'"),
+                VARLINK_DEFINE_INPUT(since, VARLINK_STRING, VARLINK_NULLABLE),
+                VARLINK_FIELD_COMMENT("The primary name of the unit"),
+                VARLINK_DEFINE_OUTPUT(Id, VARLINK_STRING, 0),
+                VARLINK_FIELD_COMMENT("CLOCK_MONOTONIC timestamp of when the unit last left the inactive state"),
+                VARLINK_DEFINE_OUTPUT(InactiveExitTimestampMonotonic, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("CLOCK_MONOTONIC timestamp of when the unit last entered the active state"),
+                VARLINK_DEFINE_OUTPUT(ActiveEnterTimestampMonotonic, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("CLOCK_MONOTONIC timestamp of when the unit last left the active state"),
+                VARLINK_DEFINE_OUTPUT(ActiveExitTimestampMonotonic, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("CLOCK_MONOTONIC timestamp of when the unit last entered the inactive state"),
+                VARLINK_DEFINE_OUTPUT(InactiveEnterTimestampMonotonic, VARLINK_INT, 0),
+                VARLINK_DEFINE_OUTPUT(After, VARLINK_STRING, VARLINK_ARRAY|VARLINK_NULLABLE),
+                VARLINK_DEFINE_OUTPUT(Before, VARLINK_STRING, VARLINK_ARRAY|VARLINK_NULLABLE),
+                VARLINK_DEFINE_OUTPUT(Requires, VARLINK_STRING, VARLINK_ARRAY|VARLINK_NULLABLE),
+                VARLINK_DEFINE_OUTPUT(Requisite, VARLINK_STRING, VARLINK_ARRAY|VARLINK_NULLABLE),
+                VARLINK_DEFINE_OUTPUT(Wants, VARLINK_STRING, VARLINK_ARRAY|VARLINK_NULLABLE),
+                VARLINK_DEFINE_OUTPUT(Conflicts, VARLINK_STRING, VARLINK_ARRAY|VARLINK_NULLABLE),
+                VARLINK_DEFINE_OUTPUT(Upholds, VARLINK_STRING, VARLINK_ARRAY|VARLINK_NULLABLE));
+
+static VARLINK_DEFINE_ERROR(NoMatchingUnits);
+
+VARLINK_DEFINE_INTERFACE(
+                io_systemd_Manager,
+                "io.systemd.Manager",
+                &vl_method_ListUnitTimes,
+                &vl_error_NoMatchingUnits);
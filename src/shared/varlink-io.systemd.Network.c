@@ -44,6 +44,15 @@ static VARLINK_DEFINE_METHOD(
                 SetPersistentStorage,
                 VARLINK_DEFINE_INPUT(Ready, VARLINK_BOOL, 0));
 
+static VARLINK_DEFINE_METHOD(
+                SubscribeLinkDescriptions,
+                /* One reply per interface: the description of a new or changed interface, or no description if
+                 * the interface has been removed. The current state of all interfaces is sent first, followed by
+                 * a reply with Ready set, after which only changes are sent. */
+                VARLINK_DEFINE_OUTPUT(InterfaceIndex, VARLINK_INT, VARLINK_NULLABLE),
+                VARLINK_DEFINE_OUTPUT(Description, VARLINK_OBJECT, VARLINK_NULLABLE),
+                VARLINK_DEFINE_OUTPUT(Ready, VARLINK_BOOL, VARLINK_NULLABLE));
+
 static VARLINK_DEFINE_ERROR(StorageReadOnly);
 
 VARLINK_DEFINE_INTERFACE(
@@ -53,6 +62,7 @@ VARLINK_DEFINE_INTERFACE(
                 &vl_method_GetNamespaceId,
                 &vl_method_GetLLDPNeighbors,
                 &vl_method_SetPersistentStorage,
+                &vl_method_SubscribeLinkDescriptions,
                 &vl_type_LLDPNeighbor,
                 &vl_type_LLDPNeighborsByInterface,
                 &vl_error_StorageReadOnly);
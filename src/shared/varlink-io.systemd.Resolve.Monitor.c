@@ -45,12 +45,34 @@ static VARLINK_DEFINE_STRUCT_TYPE(
                 VARLINK_DEFINE_FIELD(family, VARLINK_INT, VARLINK_NULLABLE),
                 VARLINK_DEFINE_FIELD(ifindex, VARLINK_INT, VARLINK_NULLABLE),
                 VARLINK_DEFINE_FIELD(ifname, VARLINK_STRING, VARLINK_NULLABLE),
+                VARLINK_DEFINE_FIELD(cacheMemory, VARLINK_INT, VARLINK_NULLABLE),
+                VARLINK_DEFINE_FIELD(cacheMemoryMax, VARLINK_INT, VARLINK_NULLABLE),
                 VARLINK_DEFINE_FIELD_BY_TYPE(cache, CacheEntry, VARLINK_ARRAY));
 
 static VARLINK_DEFINE_METHOD(
                 DumpCache,
                 VARLINK_DEFINE_OUTPUT_BY_TYPE(dump, ScopeCache, VARLINK_ARRAY));
 
+static VARLINK_DEFINE_STRUCT_TYPE(
+                ServerConnection,
+                VARLINK_DEFINE_FIELD(Encrypted, VARLINK_BOOL, 0),
+                VARLINK_DEFINE_FIELD(PendingQueries, VARLINK_INT, 0),
+                VARLINK_DEFINE_FIELD(QueuedPackets, VARLINK_INT, 0),
+                VARLINK_DEFINE_FIELD(Replies, VARLINK_INT, 0),
+                VARLINK_DEFINE_FIELD(AverageReplyUSec, VARLINK_INT, VARLINK_NULLABLE),
+                VARLINK_DEFINE_FIELD(TLSSessionResumed, VARLINK_BOOL, VARLINK_NULLABLE));
+
+static VARLINK_DEFINE_STRUCT_TYPE(
+                LatencyBucket,
+                VARLINK_DEFINE_FIELD(maxUSec, VARLINK_INT, VARLINK_NULLABLE),
+                VARLINK_DEFINE_FIELD(count, VARLINK_INT, 0));
+
+static VARLINK_DEFINE_STRUCT_TYPE(
+                LatencyHistogram,
+                VARLINK_DEFINE_FIELD(protocol, VARLINK_STRING, 0),
+                VARLINK_DEFINE_FIELD(count, VARLINK_INT, 0),
+                VARLINK_DEFINE_FIELD_BY_TYPE(buckets, LatencyBucket, VARLINK_ARRAY));
+
 static VARLINK_DEFINE_STRUCT_TYPE(
                 ServerState,
                 VARLINK_DEFINE_FIELD(Server, VARLINK_STRING, 0),
@@ -68,7 +90,10 @@ static VARLINK_DEFINE_STRUCT_TYPE(
                 VARLINK_DEFINE_FIELD(PacketBadOpt, VARLINK_BOOL, 0),
                 VARLINK_DEFINE_FIELD(PacketRRSIGMissing, VARLINK_BOOL, 0),
                 VARLINK_DEFINE_FIELD(PacketInvalid, VARLINK_BOOL, 0),
-                VARLINK_DEFINE_FIELD(PacketDoOff, VARLINK_BOOL, 0));
+                VARLINK_DEFINE_FIELD(PacketDoOff, VARLINK_BOOL, 0),
+                VARLINK_DEFINE_FIELD_BY_TYPE(Connections, ServerConnection, VARLINK_ARRAY|VARLINK_NULLABLE),
+                VARLINK_DEFINE_FIELD(SmoothedRTTUSec, VARLINK_INT, VARLINK_NULLABLE),
+                VARLINK_DEFINE_FIELD_BY_TYPE(Latency, LatencyHistogram, VARLINK_ARRAY|VARLINK_NULLABLE));
 
 static VARLINK_DEFINE_METHOD(
                 DumpServerState,
@@ -87,7 +112,9 @@ static VARLINK_DEFINE_STRUCT_TYPE(
                 CacheStatistics,
                 VARLINK_DEFINE_FIELD(size, VARLINK_INT, 0),
                 VARLINK_DEFINE_FIELD(hits, VARLINK_INT, 0),
-                VARLINK_DEFINE_FIELD(misses, VARLINK_INT, 0));
+                VARLINK_DEFINE_FIELD(misses, VARLINK_INT, 0),
+                VARLINK_DEFINE_FIELD(prefetches, VARLINK_INT, VARLINK_NULLABLE),
+                VARLINK_DEFINE_FIELD(synthesized, VARLINK_INT, VARLINK_NULLABLE));
 
 static VARLINK_DEFINE_STRUCT_TYPE(
                 DnssecStatistics,
@@ -100,7 +127,8 @@ static VARLINK_DEFINE_METHOD(
                 DumpStatistics,
                 VARLINK_DEFINE_OUTPUT_BY_TYPE(transactions, TransactionStatistics, 0),
                 VARLINK_DEFINE_OUTPUT_BY_TYPE(cache, CacheStatistics, 0),
-                VARLINK_DEFINE_OUTPUT_BY_TYPE(dnssec, DnssecStatistics, 0));
+                VARLINK_DEFINE_OUTPUT_BY_TYPE(dnssec, DnssecStatistics, 0),
+                VARLINK_DEFINE_OUTPUT_BY_TYPE(latency, LatencyHistogram, VARLINK_ARRAY|VARLINK_NULLABLE));
 
 static VARLINK_DEFINE_METHOD(ResetStatistics);
 
@@ -121,4 +149,7 @@ VARLINK_DEFINE_INTERFACE(
                 &vl_type_TransactionStatistics,
                 &vl_type_CacheStatistics,
                 &vl_type_DnssecStatistics,
+                &vl_type_ServerConnection,
+                &vl_type_LatencyBucket,
+                &vl_type_LatencyHistogram,
                 &vl_type_ServerState);
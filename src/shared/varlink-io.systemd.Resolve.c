@@ -83,7 +83,8 @@ static VARLINK_DEFINE_METHOD(
                 VARLINK_DEFINE_INPUT(flags, VARLINK_INT, VARLINK_NULLABLE),
                 VARLINK_DEFINE_OUTPUT_BY_TYPE(addresses, ResolvedAddress, VARLINK_ARRAY),
                 VARLINK_DEFINE_OUTPUT(name, VARLINK_STRING, 0),
-                VARLINK_DEFINE_OUTPUT(flags, VARLINK_INT, 0));
+                VARLINK_DEFINE_OUTPUT(flags, VARLINK_INT, 0),
+                VARLINK_DEFINE_OUTPUT(ttl, VARLINK_INT, VARLINK_NULLABLE));
 
 static VARLINK_DEFINE_STRUCT_TYPE(
                 ResolvedName,
@@ -97,7 +98,8 @@ static VARLINK_DEFINE_METHOD(
                 VARLINK_DEFINE_INPUT(address, VARLINK_INT, VARLINK_ARRAY),
                 VARLINK_DEFINE_INPUT(flags, VARLINK_INT, VARLINK_NULLABLE),
                 VARLINK_DEFINE_OUTPUT_BY_TYPE(names, ResolvedName, VARLINK_ARRAY),
-                VARLINK_DEFINE_OUTPUT(flags, VARLINK_INT, 0));
+                VARLINK_DEFINE_OUTPUT(flags, VARLINK_INT, 0),
+                VARLINK_DEFINE_OUTPUT(ttl, VARLINK_INT, VARLINK_NULLABLE));
 
 static VARLINK_DEFINE_STRUCT_TYPE(
                 ResolvedService,
@@ -2,6 +2,9 @@
 
 #include <unistd.h>
 
+#include "sd-event.h"
+
+#include "string-util.h"
 #include "varlink-io.systemd.service.h"
 
 static VARLINK_DEFINE_METHOD(Ping);
@@ -12,12 +15,94 @@ static VARLINK_DEFINE_METHOD(
                 SetLogLevel,
                 VARLINK_DEFINE_INPUT(level, VARLINK_INT, 0));
 
+static VARLINK_DEFINE_METHOD(
+                SetEventLoopStatistics,
+                VARLINK_FIELD_COMMENT("Whether to collect dispatch statistics of the event sources of the service's event loop"),
+                VARLINK_DEFINE_INPUT(collect, VARLINK_BOOL, 0));
+
+static VARLINK_DEFINE_STRUCT_TYPE(
+                EventSourceStatistics,
+                VARLINK_FIELD_COMMENT("The type of the event sources"),
+                VARLINK_DEFINE_FIELD(type, VARLINK_STRING, 0),
+                VARLINK_FIELD_COMMENT("The description of the event sources, unset if they have none"),
+                VARLINK_DEFINE_FIELD(description, VARLINK_STRING, VARLINK_NULLABLE),
+                VARLINK_FIELD_COMMENT("The number of times the callbacks of the event sources were invoked"),
+                VARLINK_DEFINE_FIELD(dispatched, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The total time spent in the callbacks in µs"),
+                VARLINK_DEFINE_FIELD(dispatchUSec, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The longest time spent in a single callback in µs"),
+                VARLINK_DEFINE_FIELD(dispatchMaxUSec, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The total time the event sources were pending before being dispatched in µs"),
+                VARLINK_DEFINE_FIELD(pendingUSec, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The longest time an event source was pending before being dispatched in µs"),
+                VARLINK_DEFINE_FIELD(pendingMaxUSec, VARLINK_INT, 0));
+
+static VARLINK_DEFINE_METHOD(
+                GetEventLoopStatistics,
+                VARLINK_FIELD_COMMENT("Whether dispatch statistics are currently collected"),
+                VARLINK_DEFINE_OUTPUT(collect, VARLINK_BOOL, 0),
+                VARLINK_FIELD_COMMENT("The statistics collected so far, per type and description of event sources, the most expensive first"),
+                VARLINK_DEFINE_OUTPUT_BY_TYPE(sources, EventSourceStatistics, VARLINK_ARRAY));
+
+static VARLINK_DEFINE_METHOD(
+                SetVarlinkStatistics,
+                VARLINK_FIELD_COMMENT("Whether to collect per method call statistics of the service's Varlink server"),
+                VARLINK_DEFINE_INPUT(collect, VARLINK_BOOL, 0));
+
+static VARLINK_DEFINE_STRUCT_TYPE(
+                VarlinkMethodStatistics,
+                VARLINK_FIELD_COMMENT("The fully qualified name of the method"),
+                VARLINK_DEFINE_FIELD(method, VARLINK_STRING, 0),
+                VARLINK_FIELD_COMMENT("The number of completed calls of the method"),
+                VARLINK_DEFINE_FIELD(calls, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of calls that were answered with an error, or not answered at all"),
+                VARLINK_DEFINE_FIELD(errors, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of calls currently being processed"),
+                VARLINK_DEFINE_FIELD(inFlight, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The total time between receiving calls and replying to them in µs"),
+                VARLINK_DEFINE_FIELD(latencyUSec, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The longest time a single call took in µs"),
+                VARLINK_DEFINE_FIELD(latencyMaxUSec, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of calls by latency: the first entry counts calls that took less than 1µs, entry i those that took at least 2^(i-1)µs but less than 2^iµs, the last one all that took longer"),
+                VARLINK_DEFINE_FIELD(latencyHistogram, VARLINK_INT, VARLINK_ARRAY));
+
+static VARLINK_DEFINE_STRUCT_TYPE(
+                VarlinkConnectionStatistics,
+                VARLINK_FIELD_COMMENT("The description of the connection"),
+                VARLINK_DEFINE_FIELD(description, VARLINK_STRING, VARLINK_NULLABLE),
+                VARLINK_FIELD_COMMENT("The PID of the peer, if known"),
+                VARLINK_DEFINE_FIELD(pid, VARLINK_INT, VARLINK_NULLABLE),
+                VARLINK_FIELD_COMMENT("The UID of the peer, if known"),
+                VARLINK_DEFINE_FIELD(uid, VARLINK_INT, VARLINK_NULLABLE),
+                VARLINK_FIELD_COMMENT("The number of method calls received on the connection"),
+                VARLINK_DEFINE_FIELD(calls, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of bytes received on the connection"),
+                VARLINK_DEFINE_FIELD(bytesIn, VARLINK_INT, 0),
+                VARLINK_FIELD_COMMENT("The number of bytes sent on the connection"),
+                VARLINK_DEFINE_FIELD(bytesOut, VARLINK_INT, 0));
+
+static VARLINK_DEFINE_METHOD(
+                GetVarlinkStatistics,
+                VARLINK_FIELD_COMMENT("Whether per method call statistics are currently collected"),
+                VARLINK_DEFINE_OUTPUT(collect, VARLINK_BOOL, 0),
+                VARLINK_FIELD_COMMENT("The statistics collected so far, per method, the most expensive first"),
+                VARLINK_DEFINE_OUTPUT_BY_TYPE(methods, VarlinkMethodStatistics, VARLINK_ARRAY),
+                VARLINK_FIELD_COMMENT("The currently open connections to the server"),
+                VARLINK_DEFINE_OUTPUT_BY_TYPE(connections, VarlinkConnectionStatistics, VARLINK_ARRAY));
+
 VARLINK_DEFINE_INTERFACE(
                 io_systemd_service,
                 "io.systemd.service",
                 &vl_method_Ping,
                 &vl_method_Reload,
-                &vl_method_SetLogLevel);
+                &vl_method_SetLogLevel,
+                &vl_method_SetEventLoopStatistics,
+                &vl_method_GetEventLoopStatistics,
+                &vl_type_EventSourceStatistics,
+                &vl_method_SetVarlinkStatistics,
+                &vl_method_GetVarlinkStatistics,
+                &vl_type_VarlinkMethodStatistics,
+                &vl_type_VarlinkConnectionStatistics);
 
 int varlink_method_ping(Varlink *link, sd_json_variant *parameters, VarlinkMethodFlags flags, void *userdata) {
         assert(link);
@@ -68,3 +153,130 @@ int varlink_method_set_log_level(Varlink *link, sd_json_variant *parameters, Var
 
         return varlink_reply(link, NULL);
 }
+
+static int varlink_check_privileged_peer(Varlink *link, sd_json_variant *parameters) {
+        uid_t uid;
+        int r;
+
+        assert(link);
+
+        r = varlink_get_peer_uid(link, &uid);
+        if (r < 0)
+                return r;
+
+        if (uid != getuid() && uid != 0)
+                return varlink_error(link, VARLINK_ERROR_PERMISSION_DENIED, parameters);
+
+        return 0;
+}
+
+int varlink_method_set_event_loop_statistics(Varlink *link, sd_json_variant *parameters, VarlinkMethodFlags flags, void *userdata) {
+        static const sd_json_dispatch_field dispatch_table[] = {
+                { "collect", SD_JSON_VARIANT_BOOLEAN, sd_json_dispatch_stdbool, 0, SD_JSON_MANDATORY },
+                {}
+        };
+
+        bool collect;
+        int r;
+
+        assert(link);
+        assert(parameters);
+
+        r = varlink_dispatch(link, parameters, dispatch_table, &collect);
+        if (r != 0)
+                return r;
+
+        r = varlink_check_privileged_peer(link, parameters);
+        if (r != 0)
+                return r;
+
+        log_debug("Received io.systemd.service.SetEventLoopStatistics(%s)", yes_no(collect));
+
+        r = sd_event_set_statistics(varlink_get_event(link), collect);
+        if (r < 0)
+                return r;
+
+        return varlink_reply(link, NULL);
+}
+
+int varlink_method_get_event_loop_statistics(Varlink *link, sd_json_variant *parameters, VarlinkMethodFlags flags, void *userdata) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        sd_event *e;
+        int r;
+
+        assert(link);
+
+        if (sd_json_variant_elements(parameters) > 0)
+                return varlink_error_invalid_parameter(link, parameters);
+
+        r = varlink_check_privileged_peer(link, parameters);
+        if (r != 0)
+                return r;
+
+        e = varlink_get_event(link);
+
+        r = sd_event_get_statistics(e, &v);
+        if (r < 0)
+                return r;
+
+        return varlink_replybo(
+                        link,
+                        SD_JSON_BUILD_PAIR_BOOLEAN("collect", sd_event_get_statistics_enabled(e) > 0),
+                        SD_JSON_BUILD_PAIR_VARIANT("sources", v));
+}
+
+int varlink_method_set_varlink_statistics(Varlink *link, sd_json_variant *parameters, VarlinkMethodFlags flags, void *userdata) {
+        static const sd_json_dispatch_field dispatch_table[] = {
+                { "collect", SD_JSON_VARIANT_BOOLEAN, sd_json_dispatch_stdbool, 0, SD_JSON_MANDATORY },
+                {}
+        };
+
+        bool collect;
+        int r;
+
+        assert(link);
+        assert(parameters);
+
+        r = varlink_dispatch(link, parameters, dispatch_table, &collect);
+        if (r != 0)
+                return r;
+
+        r = varlink_check_privileged_peer(link, parameters);
+        if (r != 0)
+                return r;
+
+        log_debug("Received io.systemd.service.SetVarlinkStatistics(%s)", yes_no(collect));
+
+        r = varlink_server_set_statistics(varlink_get_server(link), collect);
+        if (r < 0)
+                return r;
+
+        return varlink_reply(link, NULL);
+}
+
+int varlink_method_get_varlink_statistics(Varlink *link, sd_json_variant *parameters, VarlinkMethodFlags flags, void *userdata) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *methods = NULL, *connections = NULL;
+        VarlinkServer *s;
+        int r;
+
+        assert(link);
+
+        if (sd_json_variant_elements(parameters) > 0)
+                return varlink_error_invalid_parameter(link, parameters);
+
+        r = varlink_check_privileged_peer(link, parameters);
+        if (r != 0)
+                return r;
+
+        s = varlink_get_server(link);
+
+        r = varlink_server_get_statistics(s, &methods, &connections);
+        if (r < 0)
+                return r;
+
+        return varlink_replybo(
+                        link,
+                        SD_JSON_BUILD_PAIR_BOOLEAN("collect", varlink_server_get_statistics_enabled(s)),
+                        SD_JSON_BUILD_PAIR_VARIANT("methods", methods),
+                        SD_JSON_BUILD_PAIR_VARIANT("connections", connections));
+}
@@ -8,3 +8,7 @@ extern const VarlinkInterface vl_interface_io_systemd_service;
 
 int varlink_method_ping(Varlink *link, sd_json_variant *parameters, VarlinkMethodFlags flags, void *userdata);
 int varlink_method_set_log_level(Varlink *link, sd_json_variant *parameters, VarlinkMethodFlags flags, void *userdata);
+int varlink_method_set_event_loop_statistics(Varlink *link, sd_json_variant *parameters, VarlinkMethodFlags flags, void *userdata);
+int varlink_method_get_event_loop_statistics(Varlink *link, sd_json_variant *parameters, VarlinkMethodFlags flags, void *userdata);
+int varlink_method_set_varlink_statistics(Varlink *link, sd_json_variant *parameters, VarlinkMethodFlags flags, void *userdata);
+int varlink_method_get_varlink_statistics(Varlink *link, sd_json_variant *parameters, VarlinkMethodFlags flags, void *userdata);
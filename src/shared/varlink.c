@@ -2,6 +2,8 @@
 
 #include <malloc.h>
 #include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
 
 #include <sd-daemon.h>
 
@@ -12,20 +14,24 @@
 #include "glyph-util.h"
 #include "hashmap.h"
 #include "io-util.h"
+#include "json-binary.h"
 #include "iovec-util.h"
 #include "json-util.h"
 #include "list.h"
+#include "logarithm.h"
 #include "path-util.h"
 #include "process-util.h"
 #include "selinux-util.h"
 #include "serialize.h"
 #include "set.h"
 #include "socket-util.h"
+#include "sort-util.h"
 #include "string-table.h"
 #include "string-util.h"
 #include "strv.h"
 #include "time-util.h"
 #include "umask-util.h"
+#include "unaligned.h"
 #include "user-util.h"
 #include "varlink.h"
 #include "varlink-internal.h"
@@ -38,8 +44,22 @@
 
 #define VARLINK_DEFAULT_TIMEOUT_USEC (45U*USEC_PER_SEC)
 #define VARLINK_BUFFER_MAX (16U*1024U*1024U)
+
+/* Messages in the binary encoding (see json-binary.h) are prefixed by this byte, which can never appear in
+ * UTF-8 and hence not in JSON text, and the size of the encoded message as 32-bit little endian value. */
+#define VARLINK_BINARY_MAGIC 0xFFU
+#define VARLINK_BINARY_HEADER_SIZE (1U + sizeof(uint32_t))
+
+/* A systemd extension: after a successful call of this method, the peer may send messages in the binary
+ * encoding. If the peer does not know it, it replies with an error and we stick to JSON. */
+#define VARLINK_METHOD_ENABLE_BINARY "io.systemd.Varlink.EnableBinaryEncoding"
 #define VARLINK_READ_SIZE (64U*1024U)
 #define VARLINK_COLLECT_MAX 1024U
+#define VARLINK_WORKER_THREADS_MAX 64U
+
+/* Method call latencies are counted in buckets of powers of two µs, the last one also counts everything
+ * slower than that, i.e. ≥ 2^(N-2) µs ≈ 8s */
+#define VARLINK_LATENCY_BUCKETS 25U
 
 typedef enum VarlinkState {
         /* Client side states */
@@ -107,10 +127,32 @@ struct VarlinkJsonQueueItem {
         int fds[];
 };
 
+typedef struct VarlinkPendingCall VarlinkPendingCall;
+
+/* A method call issued via varlink_invoke_full() that we still wait for the reply to. Replies arrive in the
+ * order the calls were issued in, hence these are kept in a simple FIFO, and each reply is matched up with
+ * the oldest entry. */
+struct VarlinkPendingCall {
+        LIST_FIELDS(VarlinkPendingCall, pending);
+        VarlinkReply callback;
+        void *userdata;
+};
+
+typedef struct VarlinkMethodStatistics {
+        char *method;
+        uint64_t n_calls;
+        uint64_t n_errors;
+        unsigned n_in_flight;
+        usec_t latency_usec;
+        usec_t latency_max_usec;
+        uint64_t latency_histogram[VARLINK_LATENCY_BUCKETS];
+} VarlinkMethodStatistics;
+
 struct Varlink {
         unsigned n_ref;
 
         VarlinkServer *server;
+        LIST_FIELDS(Varlink, connections); /* Only for connections of a server */
 
         VarlinkState state;
         bool connecting; /* This boolean indicates whether the socket fd we are operating on is currently
@@ -176,11 +218,21 @@ struct Varlink {
 
         VarlinkReply reply_callback;
 
+        /* Calls issued via varlink_invoke() we haven't seen the reply to yet, oldest first */
+        LIST_HEAD(VarlinkPendingCall, pending_calls);
+        VarlinkPendingCall *pending_calls_tail;
+
         sd_json_variant *current;
         sd_json_variant *current_collected;
         VarlinkReplyFlags current_reply_flags;
         VarlinkSymbol *current_method;
 
+        VarlinkMethodStatistics *current_statistics; /* Set while a method call is accounted for */
+        usec_t current_started_usec;
+        uint64_t n_calls;
+        uint64_t n_bytes_read;
+        uint64_t n_bytes_written;
+
         int peer_pidfd;
         struct ucred ucred;
         bool ucred_acquired:1;
@@ -196,6 +248,9 @@ struct Varlink {
 
         bool output_buffer_sensitive:1; /* whether to erase the output buffer after writing it to the socket */
         bool input_sensitive:1; /* Whether incoming messages might be sensitive */
+        bool worker_busy:1; /* Whether a method call of ours is being processed by a worker thread */
+        bool allow_binary_input:1; /* Whether we accept messages in the binary encoding */
+        bool output_binary:1; /* Whether we send messages in the binary encoding */
 
         int af; /* address family if socket; AF_UNSPEC if not socket; negative if not known */
 
@@ -216,6 +271,32 @@ struct Varlink {
 };
 
 typedef struct VarlinkServerSocket VarlinkServerSocket;
+typedef struct VarlinkWorkerJob VarlinkWorkerJob;
+
+/* A method call handed off to a worker thread. While the job is queued or being processed the worker
+ * thread owns 'parameters' and the fields after it, everything else is only ever touched from the event
+ * loop thread. The job also owns the message the parameters are part of, since JSON variants may share
+ * their reference counter with the object they are embedded in. */
+struct VarlinkWorkerJob {
+        LIST_FIELDS(VarlinkWorkerJob, jobs);
+
+        VarlinkServer *server;
+        Varlink *link;
+        sd_json_variant *message;
+        char *method;
+        usec_t queued_usec;
+
+        VarlinkMethodThreaded callback;
+        void *userdata;
+        VarlinkMethodFlags flags;
+
+        sd_json_variant *parameters;
+        sd_json_variant *reply;
+        const char *error_id;
+        int error;
+        usec_t started_usec;
+        usec_t finished_usec;
+};
 
 struct VarlinkServerSocket {
         VarlinkServer *server;
@@ -235,6 +316,7 @@ struct VarlinkServer {
         LIST_HEAD(VarlinkServerSocket, sockets);
 
         Hashmap *methods;              /* Fully qualified symbol name of a method → VarlinkMethod */
+        Hashmap *threaded_methods;     /* Fully qualified symbol name of a method → VarlinkMethodThreaded */
         Hashmap *interfaces;           /* Fully qualified interface name → VarlinkInterface* */
         Hashmap *symbols;              /* Fully qualified symbol name of method/error → VarlinkSymbol* */
         VarlinkConnect connect_callback;
@@ -245,6 +327,10 @@ struct VarlinkServer {
 
         unsigned n_connections;
         Hashmap *by_uid;               /* UID_TO_PTR(uid) → UINT_TO_PTR(n_connections) */
+        LIST_HEAD(Varlink, connections);
+
+        bool collect_statistics;
+        Hashmap *statistics;           /* Fully qualified symbol name of a method → VarlinkMethodStatistics* */
 
         void *userdata;
         char *description;
@@ -253,6 +339,23 @@ struct VarlinkServer {
         unsigned connections_per_uid_max;
 
         bool exit_on_idle;
+
+        /* Worker threads for methods bound via varlink_server_bind_method_threaded(). Everything from
+         * worker_queue on is protected by worker_mutex. */
+        unsigned worker_threads_max;
+        pthread_t *worker_threads;
+        unsigned n_worker_threads;
+        int worker_notify_fd;
+        sd_event_source *worker_event_source;
+        unsigned n_worker_jobs;        /* Jobs queued, being processed, or waiting to be collected */
+        bool worker_initialized;
+
+        pthread_mutex_t worker_mutex;
+        pthread_cond_t worker_cond;
+        LIST_HEAD(VarlinkWorkerJob, worker_queue);
+        LIST_HEAD(VarlinkWorkerJob, worker_done);
+        unsigned n_worker_threads_idle;
+        bool worker_exit;
 };
 
 static const char* const varlink_state_table[_VARLINK_STATE_MAX] = {
@@ -334,6 +437,22 @@ static VarlinkJsonQueueItem *varlink_json_queue_item_new(sd_json_variant *m, con
         return TAKE_PTR(q);
 }
 
+static VarlinkPendingCall* varlink_pop_pending_call(Varlink *v) {
+        VarlinkPendingCall *c;
+
+        assert(v);
+
+        c = v->pending_calls;
+        if (!c)
+                return NULL;
+
+        LIST_REMOVE(pending, v->pending_calls, c);
+        if (!v->pending_calls)
+                v->pending_calls_tail = NULL;
+
+        return c;
+}
+
 static void varlink_set_state(Varlink *v, VarlinkState state) {
         assert(v);
         assert(state >= 0 && state < _VARLINK_STATE_MAX);
@@ -821,6 +940,93 @@ static void varlink_detach_event_sources(Varlink *v) {
         v->defer_event_source = sd_event_source_disable_unref(v->defer_event_source);
 }
 
+static VarlinkMethodStatistics* varlink_method_statistics_free(VarlinkMethodStatistics *x) {
+        if (!x)
+                return NULL;
+
+        free(x->method);
+        return mfree(x);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(VarlinkMethodStatistics*, varlink_method_statistics_free);
+
+DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(
+                varlink_method_statistics_hash_ops,
+                char,
+                string_hash_func,
+                string_compare_func,
+                VarlinkMethodStatistics,
+                varlink_method_statistics_free);
+
+static VarlinkMethodStatistics* varlink_server_get_method_statistics(VarlinkServer *s, const char *method) {
+        _cleanup_(varlink_method_statistics_freep) VarlinkMethodStatistics *n = NULL;
+        VarlinkMethodStatistics *x;
+
+        assert(s);
+        assert(method);
+
+        x = hashmap_get(s->statistics, method);
+        if (x)
+                return x;
+
+        n = new(VarlinkMethodStatistics, 1);
+        if (!n)
+                return NULL;
+
+        *n = (VarlinkMethodStatistics) {};
+
+        n->method = strdup(method);
+        if (!n->method)
+                return NULL;
+
+        if (hashmap_ensure_put(&s->statistics, &varlink_method_statistics_hash_ops, n->method, n) < 0)
+                return NULL;
+
+        return TAKE_PTR(n);
+}
+
+static void varlink_account_call_start(Varlink *v, const char *method) {
+        assert(v);
+        assert(v->server);
+        assert(method);
+
+        /* Only called for methods we know, so that clients cannot make us allocate statistics for arbitrary
+         * method names */
+
+        if (!v->server->collect_statistics)
+                return;
+
+        v->current_statistics = varlink_server_get_method_statistics(v->server, method);
+        if (!v->current_statistics)
+                return;
+
+        v->current_statistics->n_in_flight++;
+        v->current_started_usec = now(CLOCK_MONOTONIC);
+}
+
+static void varlink_account_call_end(Varlink *v, bool failed) {
+        VarlinkMethodStatistics *x;
+        usec_t d;
+
+        assert(v);
+
+        x = TAKE_PTR(v->current_statistics);
+        if (!x)
+                return;
+
+        d = usec_sub_unsigned(now(CLOCK_MONOTONIC), v->current_started_usec);
+
+        assert(x->n_in_flight > 0);
+        x->n_in_flight--;
+        x->n_calls++;
+        if (failed)
+                x->n_errors++;
+
+        x->latency_usec = usec_add(x->latency_usec, d);
+        x->latency_max_usec = MAX(x->latency_max_usec, d);
+        x->latency_histogram[d == 0 ? 0 : MIN(log2u64(d) + 1, VARLINK_LATENCY_BUCKETS - 1)]++;
+}
+
 static void varlink_clear_current(Varlink *v) {
         assert(v);
 
@@ -865,6 +1071,9 @@ static void varlink_clear(Varlink *v) {
         LIST_CLEAR(queue, v->output_queue, varlink_json_queue_item_free);
         v->output_queue_tail = NULL;
 
+        LIST_CLEAR(pending, v->pending_calls, free);
+        v->pending_calls_tail = NULL;
+
         v->event = sd_event_unref(v->event);
 
         if (v->exec_pid > 0) {
@@ -1013,6 +1222,7 @@ static int varlink_write(Varlink *v) {
                 explicit_bzero_safe(v->output_buffer + v->output_buffer_index, n);
 
         v->output_buffer_size -= n;
+        v->n_bytes_written += n;
 
         if (v->output_buffer_size == 0) {
                 v->output_buffer_index = 0;
@@ -1161,6 +1371,7 @@ static int varlink_read(Varlink *v) {
         }
 
         v->input_buffer_size += n;
+        v->n_bytes_read += n;
         v->input_buffer_unscanned += n;
 
         return 1;
@@ -1184,22 +1395,45 @@ static int varlink_parse_message(Varlink *v) {
 
         begin = v->input_buffer + v->input_buffer_index;
 
-        e = memchr(begin + v->input_buffer_size - v->input_buffer_unscanned, 0, v->input_buffer_unscanned);
-        if (!e) {
-                v->input_buffer_unscanned = 0;
-                return 0;
-        }
+        if (v->allow_binary_input && (uint8_t) begin[0] == VARLINK_BINARY_MAGIC) {
+                uint32_t n;
+
+                if (v->input_buffer_size < VARLINK_BINARY_HEADER_SIZE) {
+                        v->input_buffer_unscanned = 0;
+                        return 0;
+                }
+
+                n = unaligned_read_le32(begin + 1);
+                if (n > VARLINK_BUFFER_MAX - VARLINK_BINARY_HEADER_SIZE) {
+                        v->input_buffer_index = v->input_buffer_size = v->input_buffer_unscanned = 0;
+                        return varlink_log_errno(v, SYNTHETIC_ERRNO(EBADMSG), "Binary message too large, refusing.");
+                }
+
+                sz = VARLINK_BINARY_HEADER_SIZE + n;
+                if (v->input_buffer_size < sz) { /* Not complete yet */
+                        v->input_buffer_unscanned = 0;
+                        return 0;
+                }
+
+                r = json_variant_parse_binary(begin + VARLINK_BINARY_HEADER_SIZE, n, &v->current);
+        } else {
+                e = memchr(begin + v->input_buffer_size - v->input_buffer_unscanned, 0, v->input_buffer_unscanned);
+                if (!e) {
+                        v->input_buffer_unscanned = 0;
+                        return 0;
+                }
 
-        sz = e - begin + 1;
+                sz = e - begin + 1;
 
-        r = sd_json_parse(begin, 0, &v->current, NULL, NULL);
+                r = sd_json_parse(begin, 0, &v->current, NULL, NULL);
+        }
         if (v->input_sensitive)
                 explicit_bzero_safe(begin, sz);
         if (r < 0) {
                 /* If we encounter a parse failure flush all data. We cannot possibly recover from this,
                  * hence drop all buffered data now. */
                 v->input_buffer_index = v->input_buffer_size = v->input_buffer_unscanned = 0;
-                return varlink_log_errno(v, r, "Failed to parse JSON: %m");
+                return varlink_log_errno(v, r, "Failed to parse message: %m");
         }
 
         if (v->input_sensitive) {
@@ -1248,13 +1482,28 @@ static int varlink_test_timeout(Varlink *v) {
 }
 
 static int varlink_dispatch_local_error(Varlink *v, const char *error) {
-        int r;
+        int r, ret = 0;
 
         assert(v);
         assert(error);
 
+        /* Calls that came with their own reply callback won't see a reply anymore either, let them know */
+        for (;;) {
+                _cleanup_free_ VarlinkPendingCall *c = varlink_pop_pending_call(v);
+                if (!c)
+                        break;
+                if (!c->callback)
+                        continue;
+
+                r = c->callback(v, NULL, error, VARLINK_REPLY_ERROR|VARLINK_REPLY_LOCAL, c->userdata);
+                if (r < 0)
+                        varlink_log_errno(v, r, "Reply callback returned error, ignoring: %m");
+
+                ret = 1;
+        }
+
         if (!v->reply_callback)
-                return 0;
+                return ret;
 
         r = v->reply_callback(v, NULL, error, VARLINK_REPLY_ERROR|VARLINK_REPLY_LOCAL, v->userdata);
         if (r < 0)
@@ -1381,10 +1630,24 @@ static int varlink_dispatch_reply(Varlink *v) {
         v->current_reply_flags = flags;
 
         if (IN_SET(v->state, VARLINK_AWAITING_REPLY, VARLINK_AWAITING_REPLY_MORE)) {
+                _cleanup_free_ VarlinkPendingCall *c = NULL;
+                VarlinkReply callback = v->reply_callback;
+                void *userdata = v->userdata;
+
+                /* Only varlink_invoke() may have multiple calls in flight, and it always puts them in the
+                 * FIFO. This is the reply to the oldest one. */
+                if (v->state == VARLINK_AWAITING_REPLY) {
+                        c = varlink_pop_pending_call(v);
+                        if (c && c->callback) {
+                                callback = c->callback;
+                                userdata = c->userdata;
+                        }
+                }
+
                 varlink_set_state(v, VARLINK_PROCESSING_REPLY);
 
-                if (v->reply_callback) {
-                        r = v->reply_callback(v, parameters, error, flags, v->userdata);
+                if (callback) {
+                        r = callback(v, parameters, error, flags, userdata);
                         if (r < 0)
                                 varlink_log_errno(v, r, "Reply callback returned error, ignoring: %m");
                 }
@@ -1455,6 +1718,29 @@ static int generic_method_get_info(
                         SD_JSON_BUILD_PAIR_STRV("interfaces", interfaces));
 }
 
+static int generic_method_enable_binary(
+                Varlink *link,
+                sd_json_variant *parameters,
+                VarlinkMethodFlags flags,
+                void *userdata) {
+
+        int r;
+
+        assert(link);
+
+        if (sd_json_variant_elements(parameters) != 0)
+                return varlink_error_invalid_parameter(link, parameters);
+
+        r = varlink_reply(link, NULL);
+        if (r < 0)
+                return r;
+
+        /* The client accepts binary messages as soon as it asked for them, hence the reply itself may
+         * already be binary, if it hasn't been formatted yet */
+        link->output_binary = true;
+        return 0;
+}
+
 static int generic_method_get_interface_description(
                 Varlink *link,
                 sd_json_variant *parameters,
@@ -1492,12 +1778,335 @@ static int generic_method_get_interface_description(
                         SD_JSON_BUILD_PAIR_STRING("description", text));
 }
 
+static VarlinkWorkerJob* varlink_worker_job_free(VarlinkWorkerJob *j) {
+        if (!j)
+                return NULL;
+
+        sd_json_variant_unref(j->parameters);
+        sd_json_variant_unref(j->reply);
+        sd_json_variant_unref(j->message);
+        free(j->method);
+
+        varlink_unref(j->link);
+        varlink_server_unref(j->server);
+
+        return mfree(j);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(VarlinkWorkerJob*, varlink_worker_job_free);
+
+static void* varlink_worker_thread(void *p) {
+        VarlinkServer *s = ASSERT_PTR(p);
+
+        (void) pthread_setname_np(pthread_self(), "varlink-worker");
+
+        assert_se(pthread_mutex_lock(&s->worker_mutex) == 0);
+
+        for (;;) {
+                VarlinkWorkerJob *j;
+
+                while (!s->worker_queue && !s->worker_exit) {
+                        s->n_worker_threads_idle++;
+                        assert_se(pthread_cond_wait(&s->worker_cond, &s->worker_mutex) == 0);
+                        s->n_worker_threads_idle--;
+                }
+
+                if (s->worker_exit)
+                        break;
+
+                j = s->worker_queue;
+                LIST_REMOVE(jobs, s->worker_queue, j);
+
+                assert_se(pthread_mutex_unlock(&s->worker_mutex) == 0);
+
+                j->started_usec = now(CLOCK_MONOTONIC);
+                j->error = j->callback(j->parameters, j->flags, j->userdata, &j->reply, &j->error_id);
+                j->finished_usec = now(CLOCK_MONOTONIC);
+
+                assert_se(pthread_mutex_lock(&s->worker_mutex) == 0);
+
+                LIST_APPEND(jobs, s->worker_done, j);
+                (void) eventfd_write(s->worker_notify_fd, 1);
+        }
+
+        assert_se(pthread_mutex_unlock(&s->worker_mutex) == 0);
+        return NULL;
+}
+
+static int varlink_server_start_worker_thread(VarlinkServer *s) {
+        sigset_t ss, saved_ss;
+        int r, k;
+
+        assert(s);
+
+        if (!GREEDY_REALLOC(s->worker_threads, s->n_worker_threads + 1))
+                return -ENOMEM;
+
+        /* No signals in the worker threads please, see sd-resolve */
+        assert_se(sigfillset(&ss) >= 0);
+        r = pthread_sigmask(SIG_BLOCK, &ss, &saved_ss);
+        if (r > 0)
+                return -r;
+
+        r = pthread_create(s->worker_threads + s->n_worker_threads, NULL, varlink_worker_thread, s);
+        if (r == 0)
+                s->n_worker_threads++;
+
+        k = pthread_sigmask(SIG_SETMASK, &saved_ss, NULL);
+        if (r > 0)
+                return -r;
+        if (k > 0)
+                return -k;
+
+        return 0;
+}
+
+static void varlink_server_stop_worker_threads(VarlinkServer *s) {
+        assert(s);
+
+        if (!s->worker_initialized)
+                return;
+
+        assert_se(pthread_mutex_lock(&s->worker_mutex) == 0);
+        s->worker_exit = true;
+        assert_se(pthread_cond_broadcast(&s->worker_cond) == 0);
+        assert_se(pthread_mutex_unlock(&s->worker_mutex) == 0);
+
+        FOREACH_ARRAY(t, s->worker_threads, s->n_worker_threads)
+                (void) pthread_join(*t, NULL);
+
+        s->worker_threads = mfree(s->worker_threads);
+        s->n_worker_threads = 0;
+
+        /* Jobs keep a reference to the server, hence there can't be any left */
+        assert(!s->worker_queue);
+        assert(!s->worker_done);
+
+        s->worker_event_source = sd_event_source_disable_unref(s->worker_event_source);
+        s->worker_notify_fd = safe_close(s->worker_notify_fd);
+
+        assert_se(pthread_cond_destroy(&s->worker_cond) == 0);
+        assert_se(pthread_mutex_destroy(&s->worker_mutex) == 0);
+        s->worker_initialized = false;
+}
+
+static void varlink_worker_job_finish(VarlinkWorkerJob *j) {
+        Varlink *v;
+        int r;
+
+        assert(j);
+
+        v = ASSERT_PTR(j->link);
+        v->worker_busy = false;
+
+        varlink_log(v, "Worker thread processed %s() in %s, after %s in queue.",
+                    j->method,
+                    FORMAT_TIMESPAN(usec_sub_unsigned(j->finished_usec, j->started_usec), 1),
+                    FORMAT_TIMESPAN(usec_sub_unsigned(j->started_usec, j->queued_usec), 1));
+
+        /* The connection might have gone away in the meantime, or the method call was a oneway one */
+        if (IN_SET(v->state, VARLINK_PENDING_METHOD, VARLINK_PENDING_METHOD_MORE)) {
+                if (j->error < 0) {
+                        varlink_log_errno(v, j->error, "Callback for %s returned error: %m", j->method);
+                        r = varlink_error_errno(v, j->error);
+                } else if (j->error_id)
+                        r = varlink_error(v, j->error_id, j->reply);
+                else
+                        r = varlink_reply(v, j->reply);
+                if (r < 0)
+                        varlink_log_errno(v, r, "Failed to reply to %s(): %m", j->method);
+        }
+
+        /* Continue with whatever the client sent in the meantime */
+        if (v->defer_event_source) {
+                r = sd_event_source_set_enabled(v->defer_event_source, SD_EVENT_ON);
+                if (r < 0)
+                        varlink_log_errno(v, r, "Failed to enable deferred event source: %m");
+        }
+}
+
+static int worker_callback(sd_event_source *source, int fd, uint32_t revents, void *userdata) {
+        VarlinkServer *s = ASSERT_PTR(userdata);
+        LIST_HEAD(VarlinkWorkerJob, done);
+        eventfd_t x;
+
+        (void) eventfd_read(fd, &x);
+
+        assert_se(pthread_mutex_lock(&s->worker_mutex) == 0);
+        done = TAKE_PTR(s->worker_done);
+        assert_se(pthread_mutex_unlock(&s->worker_mutex) == 0);
+
+        /* The jobs might hold the last reference to the server, keep it around until we are done */
+        varlink_server_ref(s);
+
+        while (done) {
+                _cleanup_(varlink_worker_job_freep) VarlinkWorkerJob *j = done;
+
+                LIST_REMOVE(jobs, done, j);
+
+                assert(s->n_worker_jobs > 0);
+                s->n_worker_jobs--;
+
+                varlink_worker_job_finish(j);
+        }
+
+        varlink_server_unref(s);
+        return 0;
+}
+
+static int varlink_server_setup_workers(VarlinkServer *s) {
+        int r;
+
+        assert(s);
+        assert(s->event);
+
+        if (!s->worker_initialized) {
+                _cleanup_close_ int fd = -EBADF;
+
+                fd = eventfd(0, EFD_CLOEXEC|EFD_NONBLOCK);
+                if (fd < 0)
+                        return -errno;
+
+                r = pthread_mutex_init(&s->worker_mutex, NULL);
+                if (r > 0)
+                        return -r;
+
+                r = pthread_cond_init(&s->worker_cond, NULL);
+                if (r > 0) {
+                        assert_se(pthread_mutex_destroy(&s->worker_mutex) == 0);
+                        return -r;
+                }
+
+                s->worker_notify_fd = TAKE_FD(fd);
+                s->worker_initialized = true;
+        }
+
+        if (!s->worker_event_source) {
+                r = sd_event_add_io(s->event, &s->worker_event_source, s->worker_notify_fd, EPOLLIN, worker_callback, s);
+                if (r < 0)
+                        return r;
+
+                r = sd_event_source_set_priority(s->worker_event_source, s->event_priority);
+                if (r < 0)
+                        return r;
+
+                (void) sd_event_source_set_description(s->worker_event_source, "varlink-worker");
+        }
+
+        return 0;
+}
+
+static int varlink_enqueue_worker_job(
+                Varlink *v,
+                VarlinkMethodThreaded callback,
+                const char *method,
+                sd_json_variant *parameters,
+                VarlinkMethodFlags flags) {
+
+        _cleanup_(varlink_worker_job_freep) VarlinkWorkerJob *j = NULL;
+        VarlinkServer *s;
+        int r;
+
+        assert(v);
+        assert(callback);
+        assert(method);
+        assert(parameters);
+
+        s = ASSERT_PTR(v->server);
+
+        r = varlink_server_setup_workers(s);
+        if (r < 0)
+                return r;
+
+        j = new(VarlinkWorkerJob, 1);
+        if (!j)
+                return -ENOMEM;
+
+        *j = (VarlinkWorkerJob) {
+                .callback = callback,
+                .userdata = v->userdata,
+                .flags = flags,
+                .queued_usec = now(CLOCK_MONOTONIC),
+        };
+
+        j->method = strdup(method);
+        if (!j->method)
+                return -ENOMEM;
+
+        assert_se(pthread_mutex_lock(&s->worker_mutex) == 0);
+
+        if (s->n_worker_threads_idle == 0 && s->n_worker_threads < s->worker_threads_max) {
+                r = varlink_server_start_worker_thread(s);
+                if (r < 0 && s->n_worker_threads == 0) {
+                        assert_se(pthread_mutex_unlock(&s->worker_mutex) == 0);
+                        return r;
+                }
+                if (r < 0)
+                        varlink_server_log_errno(s, r, "Failed to start additional worker thread, ignoring: %m");
+        }
+
+        /* The message stays in v->current until we reply, so that no further message is read from the
+         * connection in the meantime. We keep our own references too, for oneway calls. Reference counting
+         * of JSON variants is not thread-safe, hence this is only ever done on the event loop thread. A
+         * connection only ever has one method call in flight, hence the queue is fair among clients. */
+        j->link = varlink_ref(v);
+        j->server = varlink_server_ref(s);
+        j->message = sd_json_variant_ref(v->current);
+        j->parameters = sd_json_variant_ref(parameters);
+
+        LIST_APPEND(jobs, s->worker_queue, j);
+        assert_se(pthread_cond_signal(&s->worker_cond) == 0);
+
+        assert_se(pthread_mutex_unlock(&s->worker_mutex) == 0);
+
+        TAKE_PTR(j);
+        s->n_worker_jobs++;
+        v->worker_busy = true;
+
+        varlink_log(v, "Queued %s() for worker thread, %u method calls in flight.", method, s->n_worker_jobs);
+        return 0;
+}
+
+static int varlink_dispatch_threaded(
+                Varlink *v,
+                VarlinkMethodThreaded callback,
+                const char *method,
+                sd_json_variant *parameters,
+                VarlinkMethodFlags flags) {
+
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *reply = NULL;
+        const char *error_id = NULL;
+        int r;
+
+        assert(v);
+        assert(v->server);
+        assert(callback);
+        assert(parameters);
+
+        if (v->server->worker_threads_max > 0 && v->server->event)
+                return varlink_enqueue_worker_job(v, callback, method, parameters, flags);
+
+        /* No worker threads, hence run the method right away */
+        r = callback(parameters, flags, v->userdata, &reply, &error_id);
+        if (r < 0)
+                return r;
+
+        if (!IN_SET(v->state, VARLINK_PROCESSING_METHOD, VARLINK_PROCESSING_METHOD_MORE))
+                return 0;
+
+        if (error_id)
+                return varlink_error(v, error_id, reply);
+
+        return varlink_reply(v, reply);
+}
+
 static int varlink_dispatch_method(Varlink *v) {
         _cleanup_(sd_json_variant_unrefp) sd_json_variant *parameters = NULL;
         VarlinkMethodFlags flags = 0;
         const char *method = NULL;
         sd_json_variant *e;
         VarlinkMethod callback;
+        VarlinkMethodThreaded threaded = NULL;
         const char *k;
         int r;
 
@@ -1507,6 +2116,8 @@ static int varlink_dispatch_method(Varlink *v) {
                 return 0;
         if (!v->current)
                 return 0;
+        if (v->worker_busy) /* A oneway call of ours is still being processed */
+                return 0;
 
         if (!sd_json_variant_is_object(v->current))
                 goto invalid;
@@ -1558,6 +2169,8 @@ static int varlink_dispatch_method(Varlink *v) {
         if (!method)
                 goto invalid;
 
+        v->n_calls++;
+
         r = varlink_sanitize_parameters(&parameters);
         if (r < 0)
                 goto fail;
@@ -1575,11 +2188,17 @@ static int varlink_dispatch_method(Varlink *v) {
                         callback = generic_method_get_info;
                 else if (streq(method, "org.varlink.service.GetInterfaceDescription"))
                         callback = generic_method_get_interface_description;
+                else if (streq(method, VARLINK_METHOD_ENABLE_BINARY) && v->allow_binary_input)
+                        callback = generic_method_enable_binary;
+                else
+                        threaded = hashmap_get(v->server->threaded_methods, method);
         }
 
-        if (callback) {
+        if (callback || threaded) {
                 bool invalid = false;
 
+                varlink_account_call_start(v, method);
+
                 v->current_method = hashmap_get(v->server->symbols, method);
                 if (!v->current_method)
                         varlink_log(v, "No interface description defined for method '%s', not validating.", method);
@@ -1602,7 +2221,10 @@ static int varlink_dispatch_method(Varlink *v) {
                 }
 
                 if (!invalid) {
-                        r = callback(v, parameters, flags, v->userdata);
+                        if (threaded)
+                                r = varlink_dispatch_threaded(v, threaded, method, parameters, flags);
+                        else
+                                r = callback(v, parameters, flags, v->userdata);
                         if (r < 0) {
                                 varlink_log_errno(v, r, "Callback for %s returned error: %m", method);
 
@@ -1624,6 +2246,7 @@ static int varlink_dispatch_method(Varlink *v) {
 
         case VARLINK_PROCESSED_METHOD: /* Method call is fully processed */
         case VARLINK_PROCESSING_METHOD_ONEWAY: /* ditto */
+                varlink_account_call_end(v, /* failed= */ false);
                 varlink_clear_current(v);
                 varlink_set_state(v, VARLINK_IDLE_SERVER);
                 break;
@@ -1994,6 +2617,11 @@ static void varlink_detach_server(Varlink *v) {
         assert(v->server->n_connections > 0);
         v->server->n_connections--;
 
+        LIST_REMOVE(connections, v->server->connections, v);
+
+        /* A method call we never replied to counts as failed */
+        varlink_account_call_end(v, /* failed= */ true);
+
         /* If this is a connection associated to a server, then let's disconnect the server and the
          * connection from each other. This drops the dangling reference that connect_callback() set up. But
          * before we release the references, let's call the disconnection callback if it is defined. */
@@ -2042,6 +2670,56 @@ Varlink* varlink_flush_close_unref(Varlink *v) {
         return varlink_close_unref(v);
 }
 
+static int varlink_format_binary(Varlink *v, sd_json_variant *m) {
+        size_t saved;
+        int r;
+
+        assert(v);
+        assert(m);
+
+        if (DEBUG_LOGGING) {
+                _cleanup_(erase_and_freep) char *censored_text = NULL;
+
+                r = sd_json_variant_format(m, SD_JSON_FORMAT_CENSOR_SENSITIVE, &censored_text);
+                if (r < 0)
+                        return r;
+
+                varlink_log(v, "Sending binary message: %s", censored_text);
+        }
+
+        if (v->output_buffer_index > 0) {
+                /* See below */
+                memmove(v->output_buffer, v->output_buffer + v->output_buffer_index, v->output_buffer_size);
+                if (v->output_buffer_sensitive)
+                        explicit_bzero_safe(v->output_buffer + v->output_buffer_size, v->output_buffer_index);
+                v->output_buffer_index = 0;
+        }
+
+        /* Encode right into the output buffer, after the header, which we fill in once we know the size */
+        saved = v->output_buffer_size;
+
+        if (!GREEDY_REALLOC(v->output_buffer, saved + VARLINK_BINARY_HEADER_SIZE))
+                return -ENOMEM;
+
+        v->output_buffer_size += VARLINK_BINARY_HEADER_SIZE;
+
+        r = json_variant_append_binary(m, (uint8_t**) &v->output_buffer, &v->output_buffer_size);
+        if (r >= 0 && v->output_buffer_size > VARLINK_BUFFER_MAX)
+                r = -ENOBUFS;
+        if (r < 0) {
+                v->output_buffer_size = saved;
+                return r;
+        }
+
+        v->output_buffer[saved] = (char) VARLINK_BINARY_MAGIC;
+        unaligned_write_le32(v->output_buffer + saved + 1, v->output_buffer_size - saved - VARLINK_BINARY_HEADER_SIZE);
+
+        if (sd_json_variant_is_sensitive_recursive(m))
+                v->output_buffer_sensitive = true; /* Propagate sensitive flag */
+
+        return 0;
+}
+
 static int varlink_format_json(Varlink *v, sd_json_variant *m) {
         _cleanup_(erase_and_freep) char *text = NULL;
         int sz, r;
@@ -2049,6 +2727,9 @@ static int varlink_format_json(Varlink *v, sd_json_variant *m) {
         assert(v);
         assert(m);
 
+        if (v->output_binary)
+                return varlink_format_binary(v, m);
+
         sz = sd_json_variant_format(m, /* flags= */ 0, &text);
         if (sz < 0)
                 return sz;
@@ -2075,26 +2756,22 @@ static int varlink_format_json(Varlink *v, sd_json_variant *m) {
                 v->output_buffer_size = sz + 1;
                 v->output_buffer_index = 0;
 
-        } else if (v->output_buffer_index == 0) {
+        } else {
+                if (v->output_buffer_index > 0) {
+                        /* Move what is left to write to the front, rather than copying it into a new buffer,
+                         * so that a peer that reads slowly doesn't make us copy the whole backlog for every
+                         * message we append. */
+                        memmove(v->output_buffer, v->output_buffer + v->output_buffer_index, v->output_buffer_size);
+                        if (v->output_buffer_sensitive)
+                                explicit_bzero_safe(v->output_buffer + v->output_buffer_size, v->output_buffer_index);
+                        v->output_buffer_index = 0;
+                }
 
                 if (!GREEDY_REALLOC(v->output_buffer, v->output_buffer_size + sz + 1))
                         return -ENOMEM;
 
                 memcpy(v->output_buffer + v->output_buffer_size, text, sz + 1);
                 v->output_buffer_size += sz + 1;
-        } else {
-                char *n;
-                const size_t new_size = v->output_buffer_size + sz + 1;
-
-                n = new(char, new_size);
-                if (!n)
-                        return -ENOMEM;
-
-                memcpy(mempcpy(n, v->output_buffer + v->output_buffer_index, v->output_buffer_size), text, sz + 1);
-
-                free_and_replace(v->output_buffer, n);
-                v->output_buffer_size = new_size;
-                v->output_buffer_index = 0;
         }
 
         if (sd_json_variant_is_sensitive_recursive(m))
@@ -2221,8 +2898,9 @@ int varlink_sendb(Varlink *v, const char *method, ...) {
         return varlink_send(v, method, parameters);
 }
 
-int varlink_invoke(Varlink *v, const char *method, sd_json_variant *parameters) {
+int varlink_invoke_full(Varlink *v, const char *method, sd_json_variant *parameters, VarlinkReply callback, void *userdata) {
         _cleanup_(sd_json_variant_unrefp) sd_json_variant *m = NULL;
+        _cleanup_free_ VarlinkPendingCall *c = NULL;
         int r;
 
         assert_return(v, -EINVAL);
@@ -2235,6 +2913,11 @@ int varlink_invoke(Varlink *v, const char *method, sd_json_variant *parameters)
         if (!IN_SET(v->state, VARLINK_IDLE_CLIENT, VARLINK_AWAITING_REPLY))
                 return varlink_log_errno(v, SYNTHETIC_ERRNO(EBUSY), "Connection busy.");
 
+        /* If there was still a reply pinned from a previous synchronous call, get rid of it now, or we'd
+         * mistake it for the reply to this one. */
+        if (v->state == VARLINK_IDLE_CLIENT)
+                varlink_clear_current(v);
+
         r = varlink_sanitize_parameters(&parameters);
         if (r < 0)
                 return varlink_log_errno(v, r, "Failed to sanitize parameters: %m");
@@ -2246,10 +2929,23 @@ int varlink_invoke(Varlink *v, const char *method, sd_json_variant *parameters)
         if (r < 0)
                 return varlink_log_errno(v, r, "Failed to build json message: %m");
 
+        /* Allocate this first, so that we can't fail anymore once the message is enqueued */
+        c = new(VarlinkPendingCall, 1);
+        if (!c)
+                return log_oom_debug();
+
+        *c = (VarlinkPendingCall) {
+                .callback = callback,
+                .userdata = userdata,
+        };
+
         r = varlink_enqueue_json(v, m);
         if (r < 0)
                 return varlink_log_errno(v, r, "Failed to enqueue json message: %m");
 
+        LIST_INSERT_AFTER(pending, v->pending_calls, v->pending_calls_tail, c);
+        v->pending_calls_tail = TAKE_PTR(c);
+
         varlink_set_state(v, VARLINK_AWAITING_REPLY);
         v->n_pending++;
         v->timestamp = now(CLOCK_MONOTONIC);
@@ -2257,6 +2953,10 @@ int varlink_invoke(Varlink *v, const char *method, sd_json_variant *parameters)
         return 0;
 }
 
+int varlink_invoke(Varlink *v, const char *method, sd_json_variant *parameters) {
+        return varlink_invoke_full(v, method, parameters, NULL, NULL);
+}
+
 int varlink_invokeb(Varlink *v, const char *method, ...) {
         _cleanup_(sd_json_variant_unrefp) sd_json_variant *parameters = NULL;
         va_list ap;
@@ -2289,6 +2989,9 @@ int varlink_observe(Varlink *v, const char *method, sd_json_variant *parameters)
         if (v->state != VARLINK_IDLE_CLIENT)
                 return varlink_log_errno(v, SYNTHETIC_ERRNO(EBUSY), "Connection busy.");
 
+        /* Get rid of any reply still pinned from a previous synchronous call, see varlink_invoke_full() */
+        varlink_clear_current(v);
+
         r = varlink_sanitize_parameters(&parameters);
         if (r < 0)
                 return varlink_log_errno(v, r, "Failed to sanitize parameters: %m");
@@ -2677,6 +3380,8 @@ int varlink_reply(Varlink *v, sd_json_variant *parameters) {
         if (r < 0)
                 return varlink_log_errno(v, r, "Failed to enqueue json message: %m");
 
+        varlink_account_call_end(v, /* failed= */ false);
+
         if (IN_SET(v->state, VARLINK_PENDING_METHOD, VARLINK_PENDING_METHOD_MORE)) {
                 /* We just replied to a method call that was let hanging for a while (i.e. we were outside of
                  * the varlink_dispatch_method() stack frame), which means with this reply we are ready to
@@ -2757,6 +3462,8 @@ int varlink_error(Varlink *v, const char *error_id, sd_json_variant *parameters)
         if (r < 0)
                 return varlink_log_errno(v, r, "Failed to enqueue json message: %m");
 
+        varlink_account_call_end(v, /* failed= */ true);
+
         if (IN_SET(v->state, VARLINK_PENDING_METHOD, VARLINK_PENDING_METHOD_MORE)) {
                 varlink_clear_current(v);
                 varlink_set_state(v, VARLINK_IDLE_SERVER);
@@ -3401,6 +4108,32 @@ static int verify_unix_socket(Varlink *v) {
                 v->af == AF_UNSPEC ? -ENOTSOCK : -ENOMEDIUM;
 }
 
+int varlink_negotiate_binary(Varlink *v) {
+        sd_json_variant *reply = NULL;
+        const char *error_id = NULL;
+        int r;
+
+        assert_return(v, -EINVAL);
+
+        if (v->output_binary)
+                return 1;
+
+        /* The server may switch right away, even for its reply to this call */
+        v->allow_binary_input = true;
+
+        r = varlink_call(v, VARLINK_METHOD_ENABLE_BINARY, NULL, &reply, &error_id);
+        if (r < 0)
+                return r;
+        if (error_id) {
+                varlink_log(v, "Peer does not support the binary encoding (%s), using JSON.", error_id);
+                return 0;
+        }
+
+        varlink_log(v, "Switched to the binary encoding.");
+        v->output_binary = true;
+        return 1;
+}
+
 int varlink_set_allow_fd_passing_input(Varlink *v, bool b) {
         int r;
 
@@ -3466,6 +4199,7 @@ int varlink_server_new(VarlinkServer **ret, VarlinkServerFlags flags) {
                 .flags = flags,
                 .connections_max = varlink_server_connections_max(NULL),
                 .connections_per_uid_max = varlink_server_connections_per_uid_max(NULL),
+                .worker_notify_fd = -EBADF,
         };
 
         r = varlink_server_add_interface_many(
@@ -3486,11 +4220,16 @@ static VarlinkServer* varlink_server_destroy(VarlinkServer *s) {
                 return NULL;
 
         varlink_server_shutdown(s);
+        varlink_server_stop_worker_threads(s);
 
         while ((m = hashmap_steal_first_key(s->methods)))
                 free(m);
+        while ((m = hashmap_steal_first_key(s->threaded_methods)))
+                free(m);
 
         hashmap_free(s->methods);
+        hashmap_free(s->threaded_methods);
+        hashmap_free(s->statistics);
         hashmap_free(s->interfaces);
         hashmap_free(s->symbols);
         hashmap_free(s->by_uid);
@@ -3627,6 +4366,9 @@ int varlink_server_add_connection_pair(
         if (server->flags & VARLINK_SERVER_INHERIT_USERDATA)
                 v->userdata = server->userdata;
 
+        if (server->flags & VARLINK_SERVER_ALLOW_BINARY)
+                v->allow_binary_input = true;
+
         if (ucred_acquired) {
                 v->ucred = ucred;
                 v->ucred_acquired = true;
@@ -3642,6 +4384,8 @@ int varlink_server_add_connection_pair(
         v->server = varlink_server_ref(server);
         varlink_ref(v);
 
+        LIST_PREPEND(connections, server->connections, v);
+
         varlink_set_state(v, VARLINK_IDLE_SERVER);
 
         if (server->event) {
@@ -4070,6 +4814,8 @@ int varlink_server_detach_event(VarlinkServer *s) {
         LIST_FOREACH(sockets, ss, s->sockets)
                 ss->event_source = sd_event_source_disable_unref(ss->event_source);
 
+        s->worker_event_source = sd_event_source_disable_unref(s->worker_event_source);
+
         s->event = sd_event_unref(s->event);
         return 0;
 }
@@ -4108,6 +4854,9 @@ int varlink_server_bind_method(VarlinkServer *s, const char *method, VarlinkMeth
             varlink_symbol_in_interface(method, "io.systemd"))
                 return varlink_server_log_errno(s, SYNTHETIC_ERRNO(EEXIST), "Cannot bind server to '%s'.", method);
 
+        if (hashmap_contains(s->threaded_methods, method))
+                return varlink_server_log_errno(s, SYNTHETIC_ERRNO(EEXIST), "Method '%s' is already bound as threaded method.", method);
+
         m = strdup(method);
         if (!m)
                 return log_oom_debug();
@@ -4123,6 +4872,36 @@ int varlink_server_bind_method(VarlinkServer *s, const char *method, VarlinkMeth
         return 0;
 }
 
+int varlink_server_bind_method_threaded(VarlinkServer *s, const char *method, VarlinkMethodThreaded callback) {
+        _cleanup_free_ char *m = NULL;
+        int r;
+
+        assert_return(s, -EINVAL);
+        assert_return(method, -EINVAL);
+        assert_return(callback, -EINVAL);
+
+        if (varlink_symbol_in_interface(method, "org.varlink.service") ||
+            varlink_symbol_in_interface(method, "io.systemd"))
+                return varlink_server_log_errno(s, SYNTHETIC_ERRNO(EEXIST), "Cannot bind server to '%s'.", method);
+
+        if (hashmap_contains(s->methods, method))
+                return varlink_server_log_errno(s, SYNTHETIC_ERRNO(EEXIST), "Method '%s' is already bound.", method);
+
+        m = strdup(method);
+        if (!m)
+                return log_oom_debug();
+
+        r = hashmap_ensure_put(&s->threaded_methods, &string_hash_ops, m, callback);
+        if (r == -ENOMEM)
+                return log_oom_debug();
+        if (r < 0)
+                return varlink_server_log_errno(s, r, "Failed to register threaded callback: %m");
+        if (r > 0)
+                TAKE_PTR(m);
+
+        return 0;
+}
+
 int varlink_server_bind_method_many_internal(VarlinkServer *s, ...) {
         va_list ap;
         int r = 0;
@@ -4273,6 +5052,112 @@ int varlink_server_set_connections_max(VarlinkServer *s, unsigned m) {
         return 0;
 }
 
+int varlink_server_set_statistics(VarlinkServer *s, bool b) {
+        assert_return(s, -EINVAL);
+
+        /* Calls already in flight when this is turned on are not accounted for, those in flight when it is
+         * turned off still are, once they finish */
+        s->collect_statistics = b;
+        return 0;
+}
+
+bool varlink_server_get_statistics_enabled(VarlinkServer *s) {
+        return s && s->collect_statistics;
+}
+
+static int varlink_method_statistics_compare_latency(VarlinkMethodStatistics * const *a, VarlinkMethodStatistics * const *b) {
+        /* Most expensive first */
+        return CMP((*b)->latency_usec, (*a)->latency_usec);
+}
+
+int varlink_server_get_statistics(VarlinkServer *s, sd_json_variant **ret_methods, sd_json_variant **ret_connections) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *methods = NULL, *connections = NULL;
+        _cleanup_free_ VarlinkMethodStatistics **list = NULL;
+        VarlinkMethodStatistics *x;
+        size_t n = 0;
+        int r;
+
+        assert_return(s, -EINVAL);
+
+        if (ret_methods) {
+                list = new(VarlinkMethodStatistics*, hashmap_size(s->statistics));
+                if (!list && hashmap_size(s->statistics) > 0)
+                        return -ENOMEM;
+
+                HASHMAP_FOREACH(x, s->statistics)
+                        list[n++] = x;
+
+                typesafe_qsort(list, n, varlink_method_statistics_compare_latency);
+
+                FOREACH_ARRAY(i, list, n) {
+                        _cleanup_(sd_json_variant_unrefp) sd_json_variant *h = NULL;
+
+                        x = *i;
+
+                        for (size_t k = 0; k < VARLINK_LATENCY_BUCKETS; k++) {
+                                r = sd_json_variant_append_arrayb(&h, SD_JSON_BUILD_UNSIGNED(x->latency_histogram[k]));
+                                if (r < 0)
+                                        return r;
+                        }
+
+                        r = sd_json_variant_append_arraybo(
+                                        &methods,
+                                        SD_JSON_BUILD_PAIR_STRING("method", x->method),
+                                        SD_JSON_BUILD_PAIR_UNSIGNED("calls", x->n_calls),
+                                        SD_JSON_BUILD_PAIR_UNSIGNED("errors", x->n_errors),
+                                        SD_JSON_BUILD_PAIR_UNSIGNED("inFlight", x->n_in_flight),
+                                        SD_JSON_BUILD_PAIR_UNSIGNED("latencyUSec", x->latency_usec),
+                                        SD_JSON_BUILD_PAIR_UNSIGNED("latencyMaxUSec", x->latency_max_usec),
+                                        SD_JSON_BUILD_PAIR_VARIANT("latencyHistogram", h));
+                        if (r < 0)
+                                return r;
+                }
+
+                if (!methods) {
+                        r = sd_json_variant_new_array(&methods, NULL, 0);
+                        if (r < 0)
+                                return r;
+                }
+        }
+
+        if (ret_connections) {
+                LIST_FOREACH(connections, c, s->connections) {
+                        r = sd_json_variant_append_arraybo(
+                                        &connections,
+                                        SD_JSON_BUILD_PAIR_CONDITION(!!c->description, "description", SD_JSON_BUILD_STRING(c->description)),
+                                        SD_JSON_BUILD_PAIR_CONDITION(c->ucred_acquired && pid_is_valid(c->ucred.pid), "pid", SD_JSON_BUILD_UNSIGNED(c->ucred.pid)),
+                                        SD_JSON_BUILD_PAIR_CONDITION(c->ucred_acquired && uid_is_valid(c->ucred.uid), "uid", SD_JSON_BUILD_UNSIGNED(c->ucred.uid)),
+                                        SD_JSON_BUILD_PAIR_UNSIGNED("calls", c->n_calls),
+                                        SD_JSON_BUILD_PAIR_UNSIGNED("bytesIn", c->n_bytes_read),
+                                        SD_JSON_BUILD_PAIR_UNSIGNED("bytesOut", c->n_bytes_written));
+                        if (r < 0)
+                                return r;
+                }
+
+                if (!connections) {
+                        r = sd_json_variant_new_array(&connections, NULL, 0);
+                        if (r < 0)
+                                return r;
+                }
+        }
+
+        if (ret_methods)
+                *ret_methods = TAKE_PTR(methods);
+        if (ret_connections)
+                *ret_connections = TAKE_PTR(connections);
+
+        return 0;
+}
+
+int varlink_server_set_worker_threads(VarlinkServer *s, unsigned n) {
+        assert_return(s, -EINVAL);
+        assert_return(n <= VARLINK_WORKER_THREADS_MAX, -ERANGE);
+
+        /* Already running threads are kept around, this only limits how many we start */
+        s->worker_threads_max = n;
+        return 0;
+}
+
 unsigned varlink_server_current_connections(VarlinkServer *s) {
 
         if (!s) /* Unallocated servers have zero connections */
@@ -51,10 +51,16 @@ typedef enum VarlinkServerFlags {
         VARLINK_SERVER_ACCOUNT_UID      = 1 << 2, /* Do per user accounting */
         VARLINK_SERVER_INHERIT_USERDATA = 1 << 3, /* Initialize Varlink connection userdata from VarlinkServer userdata */
         VARLINK_SERVER_INPUT_SENSITIVE  = 1 << 4, /* Automatically mark al connection input as sensitive */
-        _VARLINK_SERVER_FLAGS_ALL = (1 << 5) - 1,
+        VARLINK_SERVER_ALLOW_BINARY     = 1 << 5, /* Allow clients to switch to the binary encoding */
+        _VARLINK_SERVER_FLAGS_ALL = (1 << 6) - 1,
 } VarlinkServerFlags;
 
 typedef int (*VarlinkMethod)(Varlink *link, sd_json_variant *parameters, VarlinkMethodFlags flags, void *userdata);
+/* A method implementation that may run on a worker thread. It must neither access the Varlink connection nor
+ * anything else owned by the event loop thread, and must not take references to the parameters. The reply
+ * (or error parameters) is returned in ret_reply, an error is indicated by setting ret_error_id to a static
+ * string, or by returning a negative errno. */
+typedef int (*VarlinkMethodThreaded)(sd_json_variant *parameters, VarlinkMethodFlags flags, void *userdata, sd_json_variant **ret_reply, const char **ret_error_id);
 typedef int (*VarlinkReply)(Varlink *link, sd_json_variant *parameters, const char *error_id, VarlinkReplyFlags flags, void *userdata);
 typedef int (*VarlinkConnect)(VarlinkServer *server, Varlink *link, void *userdata);
 typedef void (*VarlinkDisconnect)(VarlinkServer *server, Varlink *link, void *userdata);
@@ -136,7 +142,10 @@ int varlink_collectb(Varlink *v, const char *method, sd_json_variant **ret_param
 #define varlink_collectbo(v, method, ret_parameters, ret_error_id, ...) \
         varlink_collectb((v), (method), (ret_parameters), (ret_error_id), SD_JSON_BUILD_OBJECT(__VA_ARGS__))
 
-/* Enqueue method call, expect a reply, which is eventually delivered to the reply callback */
+/* Enqueue method call, expect a reply, which is eventually delivered to the reply callback. Multiple calls
+ * may be in flight at the same time, their replies are delivered in the order the calls were made. If a
+ * callback is specified for the call it gets its reply instead of the one bound via varlink_bind_reply(). */
+int varlink_invoke_full(Varlink *v, const char *method, sd_json_variant *parameters, VarlinkReply callback, void *userdata);
 int varlink_invoke(Varlink *v, const char *method, sd_json_variant *parameters);
 int varlink_invokeb(Varlink *v, const char *method, ...);
 #define varlink_invokebo(v, method, ...)                                \
@@ -189,6 +198,11 @@ int varlink_peek_dup_fd(Varlink *v, size_t i);
 int varlink_take_fd(Varlink *v, size_t i);
 
 int varlink_set_allow_fd_passing_input(Varlink *v, bool b);
+
+/* Ask the server to use the binary encoding (see json-binary.h) from now on, in both directions. This is a
+ * synchronous call, hence should be done right after connecting. Returns 0 if the server does not support
+ * it, in which case JSON is used as before, and > 0 if it does. */
+int varlink_negotiate_binary(Varlink *v);
 int varlink_set_allow_fd_passing_output(Varlink *v, bool b);
 
 /* Bind a disconnect, reply or timeout callback */
@@ -227,6 +241,7 @@ int varlink_server_add_connection_stdio(VarlinkServer *s, Varlink **ret);
 /* Bind callbacks */
 int varlink_server_bind_method(VarlinkServer *s, const char *method, VarlinkMethod callback);
 int varlink_server_bind_method_many_internal(VarlinkServer *s, ...);
+int varlink_server_bind_method_threaded(VarlinkServer *s, const char *method, VarlinkMethodThreaded callback);
 #define varlink_server_bind_method_many(s, ...) varlink_server_bind_method_many_internal(s, __VA_ARGS__, NULL)
 int varlink_server_bind_connect(VarlinkServer *s, VarlinkConnect connect);
 int varlink_server_bind_disconnect(VarlinkServer *s, VarlinkDisconnect disconnect);
@@ -255,6 +270,15 @@ unsigned varlink_server_connections_per_uid_max(VarlinkServer *s);
 int varlink_server_set_connections_per_uid_max(VarlinkServer *s, unsigned m);
 int varlink_server_set_connections_max(VarlinkServer *s, unsigned m);
 
+/* Per method call counts and latencies, collected only while enabled, and per connection traffic */
+int varlink_server_set_statistics(VarlinkServer *s, bool b);
+bool varlink_server_get_statistics_enabled(VarlinkServer *s);
+int varlink_server_get_statistics(VarlinkServer *s, sd_json_variant **ret_methods, sd_json_variant **ret_connections);
+
+/* Run methods bound with varlink_server_bind_method_threaded() on up to this many threads. If zero (the
+ * default) they are executed synchronously on the event loop, like any other method. */
+int varlink_server_set_worker_threads(VarlinkServer *s, unsigned n);
+
 unsigned varlink_server_current_connections(VarlinkServer *s);
 
 int varlink_server_set_description(VarlinkServer *s, const char *description);
@@ -6,6 +6,7 @@
 #include <netdb.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/mman.h>
 #include <sys/un.h>
 #include <unistd.h>
 
@@ -17,22 +18,41 @@
 #include "build.h"
 #include "daemon-util.h"
 #include "errno-util.h"
+#include "event-util.h"
 #include "fd-util.h"
+#include "format-util.h"
 #include "log.h"
 #include "main-func.h"
 #include "parse-util.h"
 #include "path-util.h"
+#include "pidref.h"
 #include "pretty-print.h"
+#include "process-util.h"
 #include "resolve-private.h"
 #include "set.h"
+#include "signal-util.h"
 #include "socket-util.h"
 #include "string-util.h"
 
-#define BUFFER_SIZE (256 * 1024)
+/* Pipes start out with the kernel's default size, and are grown up to this whenever they fill up */
+#define BUFFER_SIZE_MAX (1024 * 1024)
+
+#define STATS_INTERVAL_USEC (5 * USEC_PER_SEC)
 
 static unsigned arg_connections_max = 256;
-static const char *arg_remote_host = NULL;
+static char *arg_remote_host = NULL;
 static usec_t arg_exit_idle_time = USEC_INFINITY;
+static unsigned arg_workers = 1;
+
+STATIC_DESTRUCTOR_REGISTER(arg_remote_host, freep);
+
+/* Counters of one process serving connections. With --workers= these live in memory shared with the
+ * main process, which sums them up. */
+typedef struct Stats {
+        uint64_t connections_active;
+        uint64_t connections;
+        uint64_t bytes;
+} Stats;
 
 typedef struct Context {
         sd_event *event;
@@ -41,6 +61,18 @@ typedef struct Context {
 
         Set *listen;
         Set *connections;
+
+        Stats *stats;
+
+        /* Only used by the process that reports the stats */
+        const Stats *stats_all;
+        size_t n_stats_all;
+        sd_event_source *stats_time;
+        Stats stats_last;
+        usec_t stats_last_usec;
+
+        /* Only used by the main process with --workers= */
+        unsigned n_workers;
 } Context;
 
 typedef struct Connection {
@@ -52,6 +84,7 @@ typedef struct Connection {
 
         size_t server_to_client_buffer_full, client_to_server_buffer_full;
         size_t server_to_client_buffer_size, client_to_server_buffer_size;
+        bool buffer_size_max_reached;
 
         sd_event_source *server_event_source, *client_event_source;
 
@@ -61,8 +94,10 @@ typedef struct Connection {
 static void connection_free(Connection *c) {
         assert(c);
 
-        if (c->context)
+        if (c->context) {
                 set_remove(c->context->connections, c);
+                c->context->stats->connections_active = set_size(c->context->connections);
+        }
 
         sd_event_source_unref(c->server_event_source);
         sd_event_source_unref(c->client_event_source);
@@ -95,44 +130,112 @@ static int idle_time_cb(sd_event_source *s, uint64_t usec, void *userdata) {
         return 0;
 }
 
-static int connection_release(Connection *c) {
-        Context *context = ASSERT_PTR(ASSERT_PTR(c)->context);
+static int context_arm_idle_time(Context *context) {
         int r;
 
-        connection_free(c);
+        assert(context);
 
-        if (arg_exit_idle_time < USEC_INFINITY && set_isempty(context->connections)) {
-                if (context->idle_time) {
-                        r = sd_event_source_set_time_relative(context->idle_time, arg_exit_idle_time);
-                        if (r < 0)
-                                return log_error_errno(r, "Error while setting idle time: %m");
+        if (arg_exit_idle_time == USEC_INFINITY || !set_isempty(context->connections))
+                return 0;
 
-                        r = sd_event_source_set_enabled(context->idle_time, SD_EVENT_ONESHOT);
-                        if (r < 0)
-                                return log_error_errno(r, "Error while enabling idle time: %m");
-                } else {
-                        r = sd_event_add_time_relative(
-                                        context->event, &context->idle_time, CLOCK_MONOTONIC,
-                                        arg_exit_idle_time, 0, idle_time_cb, context);
-                        if (r < 0)
-                                return log_error_errno(r, "Failed to create idle timer: %m");
-                }
+        if (context->idle_time) {
+                r = sd_event_source_set_time_relative(context->idle_time, arg_exit_idle_time);
+                if (r < 0)
+                        return log_error_errno(r, "Error while setting idle time: %m");
+
+                r = sd_event_source_set_enabled(context->idle_time, SD_EVENT_ONESHOT);
+                if (r < 0)
+                        return log_error_errno(r, "Error while enabling idle time: %m");
+        } else {
+                r = sd_event_add_time_relative(
+                                context->event, &context->idle_time, CLOCK_MONOTONIC,
+                                arg_exit_idle_time, 0, idle_time_cb, context);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to create idle timer: %m");
         }
 
         return 0;
 }
 
+static int connection_release(Connection *c) {
+        Context *context = ASSERT_PTR(ASSERT_PTR(c)->context);
+
+        connection_free(c);
+
+        return context_arm_idle_time(context);
+}
+
 static void context_clear(Context *context) {
         assert(context);
 
         set_free_with_destructor(context->listen, sd_event_source_unref);
         set_free_with_destructor(context->connections, connection_free);
 
+        sd_event_source_unref(context->stats_time);
         sd_event_unref(context->event);
         sd_resolve_unref(context->resolve);
         sd_event_source_unref(context->idle_time);
 }
 
+static int stats_time_cb(sd_event_source *s, uint64_t usec, void *userdata) {
+        Context *context = ASSERT_PTR(userdata);
+        Stats sum = {};
+        usec_t n;
+        int r;
+
+        FOREACH_ARRAY(i, context->stats_all, context->n_stats_all) {
+                sum.connections_active += i->connections_active;
+                sum.connections += i->connections;
+                sum.bytes += i->bytes;
+        }
+
+        n = usec_sub_unsigned(usec, context->stats_last_usec);
+        if (n > 0)
+                (void) sd_notifyf(/* unset_environment= */ false,
+                                  "STATUS=%" PRIu64 " connections active, %" PRIu64 " new/s, %s/s",
+                                  sum.connections_active,
+                                  (sum.connections - context->stats_last.connections) * USEC_PER_SEC / n,
+                                  FORMAT_BYTES((sum.bytes - context->stats_last.bytes) * USEC_PER_SEC / n));
+
+        context->stats_last = sum;
+        context->stats_last_usec = usec;
+
+        r = sd_event_source_set_time(s, usec + STATS_INTERVAL_USEC);
+        if (r < 0)
+                return log_error_errno(r, "Failed to reset stats timer: %m");
+
+        return 0;
+}
+
+static int context_report_stats(Context *context, const Stats *stats, size_t n_stats) {
+        int r;
+
+        assert(context);
+        assert(stats || n_stats == 0);
+
+        /* Only the main process may tell the service manager about its status */
+
+        context->stats_all = stats;
+        context->n_stats_all = n_stats;
+
+        r = sd_event_now(context->event, CLOCK_MONOTONIC, &context->stats_last_usec);
+        if (r < 0)
+                return log_error_errno(r, "Failed to get current time: %m");
+
+        r = sd_event_add_time(
+                        context->event, &context->stats_time, CLOCK_MONOTONIC,
+                        context->stats_last_usec + STATS_INTERVAL_USEC, 0, stats_time_cb, context);
+        if (r < 0)
+                return log_error_errno(r, "Failed to create stats timer: %m");
+
+        /* Rearmed by moving the time only */
+        r = sd_event_source_set_enabled(context->stats_time, SD_EVENT_ON);
+        if (r < 0)
+                return log_error_errno(r, "Failed to enable stats timer: %m");
+
+        return 0;
+}
+
 static int connection_create_pipes(Connection *c, int buffer[static 2], size_t *sz) {
         int r;
 
@@ -147,8 +250,6 @@ static int connection_create_pipes(Connection *c, int buffer[static 2], size_t *
         if (r < 0)
                 return log_error_errno(errno, "Failed to allocate pipe buffer: %m");
 
-        (void) fcntl(buffer[0], F_SETPIPE_SZ, BUFFER_SIZE);
-
         r = fcntl(buffer[0], F_GETPIPE_SZ);
         if (r < 0)
                 return log_error_errno(errno, "Failed to get pipe buffer size: %m");
@@ -159,6 +260,31 @@ static int connection_create_pipes(Connection *c, int buffer[static 2], size_t *
         return 0;
 }
 
+static void connection_grow_pipe(Connection *c, int buffer[static 2], size_t *sz) {
+        int r;
+
+        assert(c);
+        assert(buffer);
+        assert(sz);
+
+        /* The pipe filled up in one go, i.e. data comes in faster than it goes out. Give it more room, so
+         * that busy connections are moved with fewer, larger splices, while idle ones stay small. */
+
+        if (c->buffer_size_max_reached || *sz >= BUFFER_SIZE_MAX)
+                return;
+
+        if (fcntl(buffer[0], F_SETPIPE_SZ, MIN(*sz * 2, (size_t) BUFFER_SIZE_MAX)) < 0) {
+                /* EPERM if we hit the limits of pipe buffers per user, don't try again */
+                log_debug_errno(errno, "Failed to grow pipe buffer, ignoring: %m");
+                c->buffer_size_max_reached = true;
+                return;
+        }
+
+        r = fcntl(buffer[0], F_GETPIPE_SZ);
+        if (r > 0)
+                *sz = r;
+}
+
 static int connection_shovel(
                 Connection *c,
                 int *from, int buffer[2], int *to,
@@ -188,6 +314,9 @@ static int connection_shovel(
                         if (z > 0) {
                                 *full += z;
                                 shoveled = true;
+
+                                if (*full >= *sz)
+                                        connection_grow_pipe(c, buffer, sz);
                         } else if (z == 0 || ERRNO_IS_DISCONNECT(errno)) {
                                 *from_source = sd_event_source_unref(*from_source);
                                 *from = safe_close(*from);
@@ -200,6 +329,8 @@ static int connection_shovel(
                         if (z > 0) {
                                 *full -= z;
                                 shoveled = true;
+
+                                c->context->stats->bytes += z;
                         } else if (z == 0 || ERRNO_IS_DISCONNECT(errno)) {
                                 *to_source = sd_event_source_unref(*to_source);
                                 *to = safe_close(*to);
@@ -497,6 +628,9 @@ static int add_connection_socket(Context *context, int fd) {
                 return 0;
         }
 
+        context->stats->connections++;
+        context->stats->connections_active = set_size(context->connections);
+
         return resolve_remote(c);
 }
 
@@ -590,6 +724,7 @@ static int help(void) {
                "  -c --connections-max=  Set the maximum number of connections to be accepted\n"
                "     --exit-idle-time=   Exit when without a connection for this duration. See\n"
                "                         the %3$s for time span format\n"
+               "     --workers=N         Accept and serve connections in N processes\n"
                "  -h --help              Show this help\n"
                "     --version           Show package version\n"
                "\nSee the %2$s for details.\n",
@@ -605,12 +740,14 @@ static int parse_argv(int argc, char *argv[]) {
         enum {
                 ARG_VERSION = 0x100,
                 ARG_EXIT_IDLE,
-                ARG_IGNORE_ENV
+                ARG_IGNORE_ENV,
+                ARG_WORKERS,
         };
 
         static const struct option options[] = {
                 { "connections-max", required_argument, NULL, 'c'           },
                 { "exit-idle-time",  required_argument, NULL, ARG_EXIT_IDLE },
+                { "workers",         required_argument, NULL, ARG_WORKERS   },
                 { "help",            no_argument,       NULL, 'h'           },
                 { "version",         no_argument,       NULL, ARG_VERSION   },
                 {}
@@ -650,6 +787,15 @@ static int parse_argv(int argc, char *argv[]) {
                                 return log_error_errno(r, "Failed to parse --exit-idle-time= argument: %s", optarg);
                         break;
 
+                case ARG_WORKERS:
+                        r = safe_atou(optarg, &arg_workers);
+                        if (r < 0)
+                                return log_error_errno(r, "Failed to parse --workers= argument: %s", optarg);
+                        if (arg_workers < 1)
+                                return log_error_errno(SYNTHETIC_ERRNO(EINVAL),
+                                                       "Number of workers must be at least 1.");
+                        break;
+
                 case '?':
                         return -EINVAL;
 
@@ -665,26 +811,26 @@ static int parse_argv(int argc, char *argv[]) {
                 return log_error_errno(SYNTHETIC_ERRNO(EINVAL),
                                        "Too many parameters.");
 
-        arg_remote_host = argv[optind];
+        /* Copied, as naming worker processes overwrites the command line */
+        arg_remote_host = strdup(argv[optind]);
+        if (!arg_remote_host)
+                return log_oom();
+
         return 1;
 }
 
-static int run(int argc, char *argv[]) {
-        _cleanup_(context_clear) Context context = {};
-        _unused_ _cleanup_(notify_on_cleanup) const char *notify_stop = NULL;
-        int r, n, fd;
-
-        log_setup();
-
-        r = parse_argv(argc, argv);
-        if (r <= 0)
-                return r;
+static int serve(Stats *stats, int n_fds, bool report_stats) {
+        _cleanup_(context_clear) Context context = {
+                .stats = ASSERT_PTR(stats),
+        };
+        int r;
 
-        r = sd_event_default(&context.event);
+        /* Not the default ones, which a worker would inherit from the main process */
+        r = sd_event_new(&context.event);
         if (r < 0)
                 return log_error_errno(r, "Failed to allocate event loop: %m");
 
-        r = sd_resolve_default(&context.resolve);
+        r = sd_resolve_new(&context.resolve);
         if (r < 0)
                 return log_error_errno(r, "Failed to allocate resolver: %m");
 
@@ -694,21 +840,23 @@ static int run(int argc, char *argv[]) {
 
         sd_event_set_watchdog(context.event, true);
 
-        r = sd_listen_fds(1);
-        if (r < 0)
-                return log_error_errno(r, "Failed to receive sockets from parent.");
-        if (r == 0)
-                return log_error_errno(SYNTHETIC_ERRNO(EINVAL), "Didn't get any sockets passed in.");
+        for (int fd = SD_LISTEN_FDS_START; fd < SD_LISTEN_FDS_START + n_fds; fd++) {
+                r = add_listen_socket(&context, fd);
+                if (r < 0)
+                        return r;
+        }
 
-        n = r;
+        /* With --workers= not every worker necessarily gets a connection, so start counting right away */
+        r = context_arm_idle_time(&context);
+        if (r < 0)
+                return r;
 
-        for (fd = SD_LISTEN_FDS_START; fd < SD_LISTEN_FDS_START + n; fd++) {
-                r = add_listen_socket(&context, fd);
+        if (report_stats) {
+                r = context_report_stats(&context, stats, 1);
                 if (r < 0)
                         return r;
         }
 
-        notify_stop = notify_start(NOTIFY_READY, NOTIFY_STOPPING);
         r = sd_event_loop(context.event);
         if (r < 0)
                 return log_error_errno(r, "Failed to run event loop: %m");
@@ -716,4 +864,107 @@ static int run(int argc, char *argv[]) {
         return 0;
 }
 
+static int worker_exit_cb(sd_event_source *s, const siginfo_t *si, void *userdata) {
+        Context *context = ASSERT_PTR(userdata);
+
+        assert(si);
+
+        if (si->si_code != CLD_EXITED || si->si_status != EXIT_SUCCESS) {
+                log_error("Worker process " PID_FMT " failed, exiting.", si->si_pid);
+                return sd_event_exit(context->event, -EPROTO);
+        }
+
+        /* Workers exit on their own only if idle for --exit-idle-time= */
+        assert(context->n_workers > 0);
+        if (--context->n_workers == 0)
+                return sd_event_exit(context->event, 0);
+
+        return 0;
+}
+
+static int run_workers(Stats *stats, int n_fds) {
+        _cleanup_(context_clear) Context context = {};
+        int r;
+
+        assert(stats);
+
+        /* All workers accept connections on the same listening sockets, and each serves the ones it got
+         * with its own event loop. FORK_DEATHSIG_SIGTERM takes care of stopping them when we exit. */
+
+        assert_se(sigprocmask_many(SIG_BLOCK, NULL, SIGCHLD) >= 0);
+
+        r = sd_event_default(&context.event);
+        if (r < 0)
+                return log_error_errno(r, "Failed to allocate event loop: %m");
+
+        sd_event_set_watchdog(context.event, true);
+
+        for (unsigned i = 0; i < arg_workers; i++) {
+                pid_t pid;
+
+                r = safe_fork("(sd-worker)", FORK_RESET_SIGNALS|FORK_DEATHSIG_SIGTERM|FORK_LOG, &pid);
+                if (r < 0)
+                        return r;
+                if (r == 0) {
+                        r = serve(stats + i, n_fds, /* report_stats= */ false);
+                        _exit(r < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+                }
+
+                r = event_add_child_pidref(context.event, NULL, &PIDREF_MAKE_FROM_PID(pid), WEXITED, worker_exit_cb, &context);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to watch worker process: %m");
+
+                context.n_workers++;
+        }
+
+        r = context_report_stats(&context, stats, arg_workers);
+        if (r < 0)
+                return r;
+
+        r = sd_event_loop(context.event);
+        if (r < 0)
+                return log_error_errno(r, "Failed to run event loop: %m");
+
+        return r;
+}
+
+static int run(int argc, char *argv[]) {
+        _unused_ _cleanup_(notify_on_cleanup) const char *notify_stop = NULL;
+        Stats *stats;
+        size_t sz;
+        int r, n;
+
+        log_setup();
+
+        r = parse_argv(argc, argv);
+        if (r <= 0)
+                return r;
+
+        r = sd_listen_fds(1);
+        if (r < 0)
+                return log_error_errno(r, "Failed to receive sockets from parent.");
+        if (r == 0)
+                return log_error_errno(SYNTHETIC_ERRNO(EINVAL), "Didn't get any sockets passed in.");
+
+        n = r;
+
+        if (arg_workers <= 1) {
+                Stats single = {};
+
+                notify_stop = notify_start(NOTIFY_READY, NOTIFY_STOPPING);
+                return serve(&single, n, /* report_stats= */ true);
+        }
+
+        /* Shared with the workers, which only ever write their own entry */
+        sz = PAGE_ALIGN(sizeof(Stats) * arg_workers);
+        stats = mmap(NULL, sz, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+        if (stats == MAP_FAILED)
+                return log_error_errno(errno, "Failed to allocate memory for stats: %m");
+
+        notify_stop = notify_start(NOTIFY_READY, NOTIFY_STOPPING);
+        r = run_workers(stats, n);
+        (void) munmap(stats, sz);
+        return r;
+}
+
 DEFINE_MAIN_FUNCTION(run);
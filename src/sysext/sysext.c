@@ -4,6 +4,7 @@
 #include <getopt.h>
 #include <linux/loop.h>
 #include <sys/file.h>
+#include <sys/mman.h>
 #include <sys/mount.h>
 #include <unistd.h>
 
@@ -17,6 +18,7 @@
 #include "capability-util.h"
 #include "chase.h"
 #include "constants.h"
+#include "cpu-set-util.h"
 #include "devnum-util.h"
 #include "discover-image.h"
 #include "dissect-image.h"
@@ -29,8 +31,10 @@
 #include "fs-util.h"
 #include "hashmap.h"
 #include "initrd-util.h"
+#include "json-util.h"
 #include "log.h"
 #include "main-func.h"
+#include "memory-util.h"
 #include "missing_magic.h"
 #include "mkdir.h"
 #include "mount-util.h"
@@ -47,6 +51,7 @@
 #include "string-table.h"
 #include "string-util.h"
 #include "terminal-util.h"
+#include "time-util.h"
 #include "user-util.h"
 #include "varlink.h"
 #include "varlink-io.systemd.sysext.h"
@@ -476,7 +481,67 @@ static int vl_method_unmerge(Varlink *link, sd_json_variant *parameters, Varlink
         return varlink_reply(link, NULL);
 }
 
+static int read_timing_file(const char *resolved, sd_json_variant **ret) {
+        _cleanup_free_ char *f = NULL;
+        int r;
+
+        assert(resolved);
+        assert(ret);
+
+        f = path_join(resolved, image_class_info[arg_image_class].dot_directory_name, "timing");
+        if (!f)
+                return log_oom();
+
+        /* Not there if merged by an older version */
+        r = sd_json_parse_file(/* f= */ NULL, f, /* flags= */ 0, ret, /* reterr_line= */ NULL, /* reterr_column= */ NULL);
+        if (r == -ENOENT) {
+                *ret = NULL;
+                return 0;
+        }
+        if (r < 0)
+                return log_error_errno(r, "Failed to read '%s': %m", f);
+
+        return 0;
+}
+
+static int print_status_json(Table *t, sd_json_variant *timings) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *jt = NULL, *array = NULL;
+        sd_json_variant *e;
+        int r;
+
+        assert(t);
+
+        /* Like the table, but with the time each extension took to set up, per hierarchy */
+
+        r = table_to_json(t, &jt);
+        if (r < 0)
+                return log_error_errno(r, "Failed to convert table to JSON: %m");
+
+        JSON_VARIANT_ARRAY_FOREACH(e, jt) {
+                _cleanup_(sd_json_variant_unrefp) sd_json_variant *row = sd_json_variant_ref(e);
+                sd_json_variant *h, *timing = NULL;
+
+                h = sd_json_variant_by_key(e, "hierarchy");
+                if (h && sd_json_variant_is_string(h))
+                        timing = sd_json_variant_by_key(timings, sd_json_variant_string(h));
+                if (timing) {
+                        r = sd_json_variant_set_field(&row, "timing", timing);
+                        if (r < 0)
+                                return log_oom();
+                }
+
+                r = sd_json_variant_append_array(&array, row);
+                if (r < 0)
+                        return log_oom();
+        }
+
+        pager_open(arg_pager_flags);
+
+        return sd_json_variant_dump(array ?: jt, arg_json_format_flags, stdout, NULL);
+}
+
 static int verb_status(int argc, char **argv, void *userdata) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *timings = NULL;
         _cleanup_(table_unrefp) Table *t = NULL;
         int r, ret = 0;
 
@@ -540,6 +605,20 @@ static int verb_status(int argc, char **argv, void *userdata) {
                 if (r < 0)
                         return table_log_add_error(r);
 
+                if (!FLAGS_SET(arg_json_format_flags, SD_JSON_FORMAT_OFF)) {
+                        _cleanup_(sd_json_variant_unrefp) sd_json_variant *timing = NULL;
+
+                        r = read_timing_file(resolved, &timing);
+                        if (r < 0)
+                                return r;
+
+                        if (timing) {
+                                r = sd_json_variant_set_field(&timings, *p, timing);
+                                if (r < 0)
+                                        return log_oom();
+                        }
+                }
+
                 continue;
 
         inner_fail:
@@ -549,7 +628,10 @@ static int verb_status(int argc, char **argv, void *userdata) {
 
         (void) table_set_sort(t, (size_t) 0);
 
-        r = table_print_with_pager(t, arg_json_format_flags, arg_pager_flags, arg_legend);
+        if (timings)
+                r = print_status_json(t, timings);
+        else
+                r = table_print_with_pager(t, arg_json_format_flags, arg_pager_flags, arg_legend);
         if (r < 0)
                 return r;
 
@@ -1277,6 +1359,31 @@ static int write_dev_file(ImageClass image_class, const char *meta_path, const c
         return 0;
 }
 
+static int write_timing_file(ImageClass image_class, sd_json_variant *timing, const char *meta_path) {
+        _cleanup_free_ char *f = NULL, *text = NULL;
+        int r;
+
+        assert(meta_path);
+
+        if (!timing)
+                return 0;
+
+        /* Let's also record how long setting up each extension took, for "status --json" */
+        f = path_join(meta_path, image_class_info[image_class].dot_directory_name, "timing");
+        if (!f)
+                return log_oom();
+
+        r = sd_json_variant_format(timing, /* flags= */ 0, &text);
+        if (r < 0)
+                return log_error_errno(r, "Failed to format timing data: %m");
+
+        r = write_string_file(f, text, WRITE_STRING_FILE_CREATE);
+        if (r < 0)
+                return log_error_errno(r, "Failed to write '%s': %m", f);
+
+        return 0;
+}
+
 static int write_work_dir_file(ImageClass image_class, const char *meta_path, const char *work_dir) {
         _cleanup_free_ char *escaped_work_dir_in_root = NULL, *f = NULL;
         char *work_dir_in_root = NULL;
@@ -1314,6 +1421,7 @@ static int write_work_dir_file(ImageClass image_class, const char *meta_path, co
 static int store_info_in_meta(
                 ImageClass image_class,
                 char **extensions,
+                sd_json_variant *timing,
                 const char *meta_path,
                 const char *overlay_path,
                 const char *work_dir) {
@@ -1333,6 +1441,10 @@ static int store_info_in_meta(
         if (r < 0)
                 return r;
 
+        r = write_timing_file(image_class, timing, meta_path);
+        if (r < 0)
+                return r;
+
         r = write_work_dir_file(image_class, meta_path, work_dir);
         if (r < 0)
                 return r;
@@ -1382,6 +1494,7 @@ static int merge_hierarchy(
                 const char *hierarchy,
                 int noexec,
                 char **extensions,
+                sd_json_variant *timing,
                 char **paths,
                 const char *meta_path,
                 const char *overlay_path,
@@ -1426,7 +1539,7 @@ static int merge_hierarchy(
         if (r < 0)
                 return r;
 
-        r = store_info_in_meta(image_class, extensions, meta_path, overlay_path, op->work_dir);
+        r = store_info_in_meta(image_class, extensions, timing, meta_path, overlay_path, op->work_dir);
         if (r < 0)
                 return r;
 
@@ -1468,6 +1581,275 @@ static const ImagePolicy *pick_image_policy(const Image *img) {
         return image_class_info[img->class].default_image_policy;
 }
 
+typedef struct ImageMountResult {
+        int result;             /* > 0 if mounted, 0 if ignored, < 0 on error */
+        usec_t dissect_usec;    /* Setting up the loopback device and dissecting the image */
+        usec_t verity_usec;     /* Setting up Verity and decryption */
+        usec_t mount_usec;
+        usec_t validate_usec;   /* Checking the extension release file */
+} ImageMountResult;
+
+#define IMAGE_MOUNT_RESULT_NULL                 \
+        (ImageMountResult) {                    \
+                .dissect_usec = USEC_INFINITY,  \
+                .verity_usec = USEC_INFINITY,   \
+                .mount_usec = USEC_INFINITY,    \
+                .validate_usec = USEC_INFINITY, \
+        }
+
+/* Images are dissected and mounted by this many worker processes at most at once */
+#define MOUNT_WORKERS_MAX 16U
+
+static int mount_image(
+                ImageClass image_class,
+                Image *img,
+                bool force,
+                const char *workspace,
+                ImageMountResult *result) {
+
+        _cleanup_free_ char *p = NULL;
+        usec_t ts;
+        int r;
+
+        assert(img);
+        assert(workspace);
+        assert(result);
+
+        /* Returns > 0 if the image has been mounted, 0 if it is to be ignored */
+
+        p = path_join(workspace, image_class_info[image_class].short_identifier_plural, img->name);
+        if (!p)
+                return log_oom();
+
+        r = mkdir_p(p, 0700);
+        if (r < 0)
+                return log_error_errno(r, "Failed to create %s: %m", p);
+
+        ts = now(CLOCK_MONOTONIC);
+
+        switch (img->type) {
+        case IMAGE_DIRECTORY:
+        case IMAGE_SUBVOLUME:
+
+                if (!force) {
+                        r = extension_has_forbidden_content(p);
+                        if (r < 0)
+                                return r;
+                        if (r > 0)
+                                return 0;
+                }
+
+                r = mount_nofollow_verbose(LOG_ERR, img->path, p, NULL, MS_BIND, NULL);
+                if (r < 0)
+                        return r;
+
+                /* Make this a read-only bind mount */
+                r = bind_remount_recursive(p, MS_RDONLY, MS_RDONLY, NULL);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to make bind mount '%s' read-only: %m", p);
+
+                result->mount_usec = usec_sub_unsigned(now(CLOCK_MONOTONIC), ts);
+                break;
+
+        case IMAGE_RAW:
+        case IMAGE_BLOCK: {
+                _cleanup_(dissected_image_unrefp) DissectedImage *m = NULL;
+                _cleanup_(loop_device_unrefp) LoopDevice *d = NULL;
+                _cleanup_(verity_settings_done) VeritySettings verity_settings = VERITY_SETTINGS_DEFAULT;
+                DissectImageFlags flags =
+                        DISSECT_IMAGE_READ_ONLY |
+                        DISSECT_IMAGE_GENERIC_ROOT |
+                        DISSECT_IMAGE_REQUIRE_ROOT |
+                        DISSECT_IMAGE_MOUNT_ROOT_ONLY |
+                        DISSECT_IMAGE_USR_NO_ROOT |
+                        DISSECT_IMAGE_ADD_PARTITION_DEVICES |
+                        DISSECT_IMAGE_PIN_PARTITION_DEVICES |
+                        DISSECT_IMAGE_ALLOW_USERSPACE_VERITY;
+
+                r = verity_settings_load(&verity_settings, img->path, NULL, NULL);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to read verity artifacts for %s: %m", img->path);
+
+                if (verity_settings.data_path)
+                        flags |= DISSECT_IMAGE_NO_PARTITION_TABLE;
+
+                if (!force)
+                        flags |= DISSECT_IMAGE_VALIDATE_OS_EXT;
+
+                r = loop_device_make_by_path(
+                                img->path,
+                                O_RDONLY,
+                                /* sector_size= */ UINT32_MAX,
+                                FLAGS_SET(flags, DISSECT_IMAGE_NO_PARTITION_TABLE) ? 0 : LO_FLAGS_PARTSCAN,
+                                LOCK_SH,
+                                &d);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to set up loopback device for %s: %m", img->path);
+
+                r = dissect_loop_device_and_warn(
+                                d,
+                                &verity_settings,
+                                /* mount_options= */ NULL,
+                                pick_image_policy(img),
+                                flags,
+                                &m);
+                if (r < 0)
+                        return r;
+
+                r = dissected_image_load_verity_sig_partition(
+                                m,
+                                d->fd,
+                                &verity_settings);
+                if (r < 0)
+                        return r;
+
+                result->dissect_usec = usec_sub_unsigned(now(CLOCK_MONOTONIC), ts);
+                ts = now(CLOCK_MONOTONIC);
+
+                r = dissected_image_decrypt_interactively(
+                                m, NULL,
+                                &verity_settings,
+                                flags);
+                if (r < 0)
+                        return r;
+
+                result->verity_usec = usec_sub_unsigned(now(CLOCK_MONOTONIC), ts);
+                ts = now(CLOCK_MONOTONIC);
+
+                r = dissected_image_mount_and_warn(
+                                m,
+                                p,
+                                /* uid_shift= */ UID_INVALID,
+                                /* uid_range= */ UID_INVALID,
+                                /* userns_fd= */ -EBADF,
+                                flags);
+                if (r < 0 && r != -ENOMEDIUM)
+                        return r;
+                if (r == -ENOMEDIUM && !force)
+                        return 0;
+
+                r = dissected_image_relinquish(m);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to relinquish DM and loopback block devices: %m");
+
+                result->mount_usec = usec_sub_unsigned(now(CLOCK_MONOTONIC), ts);
+                break;
+        }
+        default:
+                assert_not_reached();
+        }
+
+        return 1;
+}
+
+static int mount_images(
+                ImageClass image_class,
+                Image **images,
+                size_t n_images,
+                bool force,
+                const char *workspace,
+                ImageMountResult *results) {
+
+        _cleanup_free_ pid_t *pids = NULL;
+        ImageMountResult *shared;
+        size_t n_workers, sz;
+        bool failed = false;
+        int r;
+
+        assert(images || n_images == 0);
+        assert(workspace);
+        assert(results);
+
+        for (size_t k = 0; k < n_images; k++)
+                results[k] = IMAGE_MOUNT_RESULT_NULL;
+
+        r = cpus_in_affinity_mask();
+        n_workers = MIN3(n_images, (size_t) MAX(r, 1), (size_t) MOUNT_WORKERS_MAX);
+        if (n_workers <= 1) {
+                for (size_t k = 0; k < n_images; k++) {
+                        results[k].result = mount_image(image_class, images[k], force, workspace, results + k);
+                        if (results[k].result < 0)
+                                return results[k].result;
+                }
+
+                return 0;
+        }
+
+        /* The images are independent of each other, hence dissect and mount them in a number of worker
+         * processes at once. They share our mount namespace, hence whatever they mount shows up here, and
+         * report back through shared memory. Errors have been logged by the workers already. */
+        sz = PAGE_ALIGN(n_images * sizeof(ImageMountResult));
+        shared = mmap(NULL, sz, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+        if (shared == MAP_FAILED)
+                return log_error_errno(errno, "Failed to allocate shared memory: %m");
+
+        memcpy(shared, results, n_images * sizeof(ImageMountResult));
+
+        pids = new(pid_t, n_workers);
+        if (!pids) {
+                r = log_oom();
+                goto finish;
+        }
+
+        r = 0;
+        for (size_t w = 0; w < n_workers; w++) {
+                r = safe_fork("(sd-mount)", FORK_RESET_SIGNALS|FORK_DEATHSIG_SIGTERM|FORK_LOG, pids + w);
+                if (r < 0) {
+                        n_workers = w;
+                        break;
+                }
+                if (r == 0) {
+                        for (size_t k = w; k < n_images; k += n_workers) {
+                                shared[k].result = mount_image(image_class, images[k], force, workspace, shared + k);
+                                if (shared[k].result < 0)
+                                        _exit(EXIT_FAILURE);
+                        }
+
+                        _exit(EXIT_SUCCESS);
+                }
+        }
+
+        for (size_t w = 0; w < n_workers; w++) {
+                int k;
+
+                k = wait_for_terminate_and_check("(sd-mount)", pids[w], WAIT_LOG_ABNORMAL);
+                if (k < 0 && r >= 0)
+                        r = k;
+                if (k > 0)
+                        failed = true;
+        }
+
+        memcpy(results, shared, n_images * sizeof(ImageMountResult));
+
+        /* A worker that failed recorded the error for its image, like in the serial case return the one of
+         * the first image that failed. */
+        if (failed && r >= 0) {
+                r = -EPROTO;
+
+                for (size_t k = 0; k < n_images; k++)
+                        if (results[k].result < 0) {
+                                r = results[k].result;
+                                break;
+                        }
+        }
+
+finish:
+        assert_se(munmap(shared, sz) >= 0);
+        return r < 0 ? r : 0;
+}
+
+static int image_mount_result_to_json(const ImageMountResult *result, sd_json_variant **ret) {
+        assert(result);
+        assert(ret);
+
+        return sd_json_buildo(
+                        ret,
+                        JSON_BUILD_PAIR_FINITE_USEC("dissectUSec", result->dissect_usec),
+                        JSON_BUILD_PAIR_FINITE_USEC("verityUSec", result->verity_usec),
+                        JSON_BUILD_PAIR_FINITE_USEC("mountUSec", result->mount_usec),
+                        JSON_BUILD_PAIR_FINITE_USEC("validateUSec", result->validate_usec));
+}
+
 static int merge_subprocess(
                 ImageClass image_class,
                 char **hierarchies,
@@ -1478,7 +1860,10 @@ static int merge_subprocess(
 
         _cleanup_free_ char *host_os_release_id = NULL, *host_os_release_version_id = NULL, *host_os_release_api_level = NULL, *buf = NULL;
         _cleanup_strv_free_ char **extensions = NULL, **paths = NULL;
-        size_t n_extensions = 0;
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *timing = NULL;
+        _cleanup_free_ ImageMountResult *results = NULL;
+        _cleanup_free_ Image **list = NULL;
+        size_t n_extensions = 0, n_images = 0;
         unsigned n_ignored = 0;
         Image *img;
         int r;
@@ -1516,127 +1901,36 @@ static int merge_subprocess(
                                        empty_to_root(arg_root));
 
         /* Let's now mount all images */
-        HASHMAP_FOREACH(img, images) {
-                _cleanup_free_ char *p = NULL;
-
-                p = path_join(workspace, image_class_info[image_class].short_identifier_plural, img->name);
-                if (!p)
-                        return log_oom();
-
-                r = mkdir_p(p, 0700);
-                if (r < 0)
-                        return log_error_errno(r, "Failed to create %s: %m", p);
-
-                switch (img->type) {
-                case IMAGE_DIRECTORY:
-                case IMAGE_SUBVOLUME:
-
-                        if (!force) {
-                                r = extension_has_forbidden_content(p);
-                                if (r < 0)
-                                        return r;
-                                if (r > 0) {
-                                        n_ignored++;
-                                        continue;
-                                }
-                        }
-
-                        r = mount_nofollow_verbose(LOG_ERR, img->path, p, NULL, MS_BIND, NULL);
-                        if (r < 0)
-                                return r;
-
-                        /* Make this a read-only bind mount */
-                        r = bind_remount_recursive(p, MS_RDONLY, MS_RDONLY, NULL);
-                        if (r < 0)
-                                return log_error_errno(r, "Failed to make bind mount '%s' read-only: %m", p);
-
-                        break;
-
-                case IMAGE_RAW:
-                case IMAGE_BLOCK: {
-                        _cleanup_(dissected_image_unrefp) DissectedImage *m = NULL;
-                        _cleanup_(loop_device_unrefp) LoopDevice *d = NULL;
-                        _cleanup_(verity_settings_done) VeritySettings verity_settings = VERITY_SETTINGS_DEFAULT;
-                        DissectImageFlags flags =
-                                DISSECT_IMAGE_READ_ONLY |
-                                DISSECT_IMAGE_GENERIC_ROOT |
-                                DISSECT_IMAGE_REQUIRE_ROOT |
-                                DISSECT_IMAGE_MOUNT_ROOT_ONLY |
-                                DISSECT_IMAGE_USR_NO_ROOT |
-                                DISSECT_IMAGE_ADD_PARTITION_DEVICES |
-                                DISSECT_IMAGE_PIN_PARTITION_DEVICES |
-                                DISSECT_IMAGE_ALLOW_USERSPACE_VERITY;
-
-                        r = verity_settings_load(&verity_settings, img->path, NULL, NULL);
-                        if (r < 0)
-                                return log_error_errno(r, "Failed to read verity artifacts for %s: %m", img->path);
-
-                        if (verity_settings.data_path)
-                                flags |= DISSECT_IMAGE_NO_PARTITION_TABLE;
+        list = new(Image*, hashmap_size(images));
+        if (!list)
+                return log_oom();
 
-                        if (!force)
-                                flags |= DISSECT_IMAGE_VALIDATE_OS_EXT;
+        HASHMAP_FOREACH(img, images)
+                list[n_images++] = img;
 
-                        r = loop_device_make_by_path(
-                                        img->path,
-                                        O_RDONLY,
-                                        /* sector_size= */ UINT32_MAX,
-                                        FLAGS_SET(flags, DISSECT_IMAGE_NO_PARTITION_TABLE) ? 0 : LO_FLAGS_PARTSCAN,
-                                        LOCK_SH,
-                                        &d);
-                        if (r < 0)
-                                return log_error_errno(r, "Failed to set up loopback device for %s: %m", img->path);
-
-                        r = dissect_loop_device_and_warn(
-                                        d,
-                                        &verity_settings,
-                                        /* mount_options= */ NULL,
-                                        pick_image_policy(img),
-                                        flags,
-                                        &m);
-                        if (r < 0)
-                                return r;
+        results = new(ImageMountResult, n_images);
+        if (!results)
+                return log_oom();
 
-                        r = dissected_image_load_verity_sig_partition(
-                                        m,
-                                        d->fd,
-                                        &verity_settings);
-                        if (r < 0)
-                                return r;
+        r = mount_images(image_class, list, n_images, force, workspace, results);
+        if (r < 0)
+                return r;
 
-                        r = dissected_image_decrypt_interactively(
-                                        m, NULL,
-                                        &verity_settings,
-                                        flags);
-                        if (r < 0)
-                                return r;
+        for (size_t k = 0; k < n_images; k++) {
+                _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
 
-                        r = dissected_image_mount_and_warn(
-                                        m,
-                                        p,
-                                        /* uid_shift= */ UID_INVALID,
-                                        /* uid_range= */ UID_INVALID,
-                                        /* userns_fd= */ -EBADF,
-                                        flags);
-                        if (r < 0 && r != -ENOMEDIUM)
-                                return r;
-                        if (r == -ENOMEDIUM && !force) {
-                                n_ignored++;
-                                continue;
-                        }
+                img = list[k];
 
-                        r = dissected_image_relinquish(m);
-                        if (r < 0)
-                                return log_error_errno(r, "Failed to relinquish DM and loopback block devices: %m");
-                        break;
-                }
-                default:
-                        assert_not_reached();
+                if (results[k].result == 0) {
+                        n_ignored++;
+                        continue;
                 }
 
                 if (force)
                         log_debug("Force mode enabled, skipping version validation.");
                 else {
+                        usec_t ts = now(CLOCK_MONOTONIC);
+
                         r = extension_release_validate(
                                         img->name,
                                         host_os_release_id,
@@ -1651,6 +1945,8 @@ static int merge_subprocess(
                                 n_ignored++;
                                 continue;
                         }
+
+                        results[k].validate_usec = usec_sub_unsigned(now(CLOCK_MONOTONIC), ts);
                 }
 
                 /* Nice! This one is an extension we want. */
@@ -1658,6 +1954,14 @@ static int merge_subprocess(
                 if (r < 0)
                         return log_oom();
 
+                r = image_mount_result_to_json(results + k, &v);
+                if (r < 0)
+                        return log_oom();
+
+                r = sd_json_variant_set_field(&timing, img->name, v);
+                if (r < 0)
+                        return log_oom();
+
                 n_extensions++;
         }
 
@@ -1732,6 +2036,7 @@ static int merge_subprocess(
                                 *h,
                                 noexec,
                                 extensions,
+                                timing,
                                 paths,
                                 meta_path,
                                 overlay_path,
@@ -1820,10 +2125,133 @@ static int merge(ImageClass image_class,
         return 1;
 }
 
+typedef struct ManifestEntry {
+        uint64_t dev;
+        uint64_t ino;
+        uint64_t size;
+        uint64_t ctime;
+        char **release;
+} ManifestEntry;
+
+static void manifest_entry_done(ManifestEntry *e) {
+        assert(e);
+
+        strv_free(e->release);
+}
+
+static char* manifest_path(ImageClass image_class) {
+        return strjoin("/run/systemd/", image_class_info[image_class].short_identifier, "-manifest.json");
+}
+
+static int manifest_stat(const Image *img, sd_json_variant **ret) {
+        struct stat st;
+
+        assert(img);
+        assert(ret);
+
+        /* Only regular image files are covered by the manifest, since their ctime changes whenever their
+         * contents do, unlike that of directories or block devices. */
+        if (img->type != IMAGE_RAW)
+                return 0;
+
+        if (stat(img->path, &st) < 0)
+                return -errno;
+        if (!S_ISREG(st.st_mode))
+                return 0;
+
+        return sd_json_buildo(
+                        ret,
+                        SD_JSON_BUILD_PAIR_UNSIGNED("dev", st.st_dev),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("ino", st.st_ino),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("size", st.st_size),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("ctime", timespec_load_nsec(&st.st_ctim)));
+}
+
+static int manifest_lookup(ImageClass image_class, sd_json_variant *manifest, Image *img, sd_json_variant *st) {
+
+        static const sd_json_dispatch_field table[] = {
+                { "dev",     _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64, offsetof(ManifestEntry, dev),     SD_JSON_MANDATORY },
+                { "ino",     _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64, offsetof(ManifestEntry, ino),     SD_JSON_MANDATORY },
+                { "size",    _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64, offsetof(ManifestEntry, size),    SD_JSON_MANDATORY },
+                { "ctime",   _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64, offsetof(ManifestEntry, ctime),   SD_JSON_MANDATORY },
+                { "release", SD_JSON_VARIANT_ARRAY,         sd_json_dispatch_strv,   offsetof(ManifestEntry, release), 0                 },
+                {}
+        };
+
+        _cleanup_(manifest_entry_done) ManifestEntry a = {}, b = {};
+        sd_json_variant *e;
+        int r;
+
+        assert(img);
+        assert(st);
+
+        e = sd_json_variant_by_key(manifest, img->path);
+        if (!e)
+                return 0;
+
+        r = sd_json_dispatch(e, table, /* flags= */ 0, &a);
+        if (r < 0)
+                return r;
+
+        r = sd_json_dispatch(st, table, /* flags= */ 0, &b);
+        if (r < 0)
+                return r;
+
+        if (a.dev != b.dev || a.ino != b.ino || a.size != b.size || a.ctime != b.ctime)
+                return 0;
+
+        if (image_class == IMAGE_SYSEXT)
+                strv_free_and_replace(img->sysext_release, a.release);
+        else
+                strv_free_and_replace(img->confext_release, a.release);
+
+        img->metadata_valid = true;
+        return 1;
+}
+
+static int manifest_save(ImageClass image_class, Hashmap *images, sd_json_variant *stats, const char *path) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *manifest = NULL;
+        _cleanup_free_ char *text = NULL;
+        Image *img;
+        int r;
+
+        assert(path);
+
+        HASHMAP_FOREACH(img, images) {
+                _cleanup_(sd_json_variant_unrefp) sd_json_variant *e = NULL;
+                sd_json_variant *st;
+
+                st = sd_json_variant_by_key(stats, img->path);
+                if (!st || !img->metadata_valid)
+                        continue;
+
+                e = sd_json_variant_ref(st);
+
+                r = sd_json_variant_set_field_strv(&e, "release", image_extension_release(img, image_class));
+                if (r < 0)
+                        return r;
+
+                r = sd_json_variant_set_field(&manifest, img->path, e);
+                if (r < 0)
+                        return r;
+        }
+
+        if (!manifest)
+                return 0;
+
+        r = sd_json_variant_format(manifest, /* flags= */ 0, &text);
+        if (r < 0)
+                return r;
+
+        return write_string_file(path, text, WRITE_STRING_FILE_CREATE|WRITE_STRING_FILE_ATOMIC);
+}
+
 static int image_discover_and_read_metadata(
                 ImageClass image_class,
                 Hashmap **ret_images) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *manifest = NULL, *stats = NULL;
         _cleanup_hashmap_free_ Hashmap *images = NULL;
+        _cleanup_free_ char *path = NULL;
         Image *img;
         int r;
 
@@ -1837,12 +2265,55 @@ static int image_discover_and_read_metadata(
         if (r < 0)
                 return log_error_errno(r, "Failed to discover images: %m");
 
+        /* Reading the metadata means mounting disk images, hence skip that for image files that haven't
+         * changed since the last time around, according to the manifest. */
+        path = manifest_path(image_class);
+        if (!path)
+                return log_oom();
+
+        r = sd_json_parse_file(/* f= */ NULL, path, /* flags= */ 0, &manifest, /* reterr_line= */ NULL, /* reterr_column= */ NULL);
+        if (r < 0 && r != -ENOENT)
+                log_debug_errno(r, "Failed to read manifest '%s', ignoring: %m", path);
+
         HASHMAP_FOREACH(img, images) {
+                _cleanup_(sd_json_variant_unrefp) sd_json_variant *st = NULL;
+
+                /* Taken before the metadata is read, so that changes made meanwhile are noticed next time */
+                r = manifest_stat(img, &st);
+                if (r < 0)
+                        log_debug_errno(r, "Failed to stat image %s, not using manifest: %m", img->path);
+                if (r <= 0)
+                        continue;
+
+                r = manifest_lookup(image_class, manifest, img, st);
+                if (r < 0)
+                        log_debug_errno(r, "Failed to look up image %s in manifest, ignoring: %m", img->path);
+                else if (r > 0)
+                        log_debug("Image %s unchanged, using metadata from manifest.", img->path);
+
+                r = sd_json_variant_set_field(&stats, img->path, st);
+                if (r < 0)
+                        return log_oom();
+        }
+
+        /* Whatever fails here is tried again below, so that the error is reported. */
+        r = image_read_metadata_parallel(images, image_class_info[image_class].default_image_policy);
+        if (r < 0)
+                log_debug_errno(r, "Failed to read image metadata in parallel, ignoring: %m");
+
+        HASHMAP_FOREACH(img, images) {
+                if (img->metadata_valid)
+                        continue;
+
                 r = image_read_metadata(img, image_class_info[image_class].default_image_policy);
                 if (r < 0)
                         return log_error_errno(r, "Failed to read metadata for image %s: %m", img->name);
         }
 
+        r = manifest_save(image_class, images, stats, path);
+        if (r < 0)
+                log_debug_errno(r, "Failed to save manifest '%s', ignoring: %m", path);
+
         *ret_images = TAKE_PTR(images);
 
         return 0;
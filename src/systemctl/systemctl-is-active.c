@@ -2,6 +2,7 @@
 
 #include "bus-error.h"
 #include "bus-locator.h"
+#include "bus-map-properties.h"
 #include "pretty-print.h"
 #include "syslog-util.h"
 #include "systemctl-is-active.h"
@@ -9,11 +10,60 @@
 #include "systemctl-util.h"
 #include "systemctl.h"
 
+typedef struct CheckUnitContext {
+        const UnitActiveState *good_states;
+        size_t n_good_states;
+        bool not_found;
+        bool ok;
+} CheckUnitContext;
+
+static int check_unit_one(sd_bus_message *m, const char *unit, void *userdata) {
+        struct {
+                const char *active_state;
+                const char *load_state;
+        } states = {};
+        static const struct bus_properties_map map[] = {
+                { "ActiveState", "s", NULL, offsetof(typeof(states), active_state) },
+                { "LoadState",   "s", NULL, offsetof(typeof(states), load_state)   },
+                {}
+        };
+
+        _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
+        CheckUnitContext *c = ASSERT_PTR(userdata);
+        UnitActiveState active_state;
+        int r;
+
+        r = bus_message_map_all_properties(m, map, /* flags= */ 0, &error, &states);
+        if (r < 0)
+                return log_error_errno(r, "Failed to retrieve unit state: %s", bus_error_message(&error, r));
+
+        active_state = unit_active_state_from_string(states.active_state);
+        if (active_state < 0)
+                return log_error_errno(active_state, "Invalid unit state '%s' for: %s", strna(states.active_state), unit);
+
+        if (!arg_quiet)
+                puts(unit_active_state_to_string(active_state));
+
+        FOREACH_ARRAY(good_state, c->good_states, c->n_good_states)
+                if (active_state == *good_state) {
+                        c->ok = true;
+                        break;
+                }
+
+        if (!streq_ptr(states.load_state, "not-found"))
+                c->not_found = false;
+
+        return 0;
+}
+
 static int check_unit_generic(int code, const UnitActiveState good_states[], size_t nb_states, char **args) {
         _cleanup_strv_free_ char **names = NULL;
-        UnitActiveState active_state;
+        CheckUnitContext c = {
+                .good_states = good_states,
+                .n_good_states = nb_states,
+                .not_found = true,
+        };
         sd_bus *bus;
-        bool not_found = true, ok = false;
         int r;
 
         r = acquire_bus(BUS_MANAGER, &bus);
@@ -24,32 +74,13 @@ static int check_unit_generic(int code, const UnitActiveState good_states[], siz
         if (r < 0)
                 return log_error_errno(r, "Failed to expand names: %m");
 
-        STRV_FOREACH(name, names) {
-                _cleanup_free_ char *load_state = NULL;
-
-                r = get_state_one_unit(bus, *name, &active_state);
-                if (r < 0)
-                        return r;
-
-                r = unit_load_state(bus, *name, &load_state);
-                if (r < 0)
-                        return r;
-
-                if (!arg_quiet)
-                        puts(unit_active_state_to_string(active_state));
-
-                FOREACH_ARRAY(good_state, good_states, nb_states)
-                        if (active_state == *good_state) {
-                                ok = true;
-                                break;
-                        }
-
-                if (!streq(load_state, "not-found"))
-                        not_found = false;
-        }
+        /* One call for all units, instead of two per unit */
+        r = get_units_properties(bus, names, STRV_MAKE("ActiveState", "LoadState"), check_unit_one, &c);
+        if (r < 0)
+                return r;
 
         /* We use LSB code 4 ("program or service status is unknown") when the corresponding unit file doesn't exist. */
-        return ok ? EXIT_SUCCESS : not_found ? EXIT_PROGRAM_OR_SERVICES_STATUS_UNKNOWN : code;
+        return c.ok ? EXIT_SUCCESS : c.not_found ? EXIT_PROGRAM_OR_SERVICES_STATUS_UNKNOWN : code;
 }
 
 int verb_is_active(int argc, char *argv[], void *userdata) {
@@ -110,6 +110,10 @@ static int output_units_list(const UnitInfo *unit_infos, size_t c) {
         size_t job_count = 0;
         int r;
 
+        FOREACH_ARRAY(u, unit_infos, c)
+                if (u->job_id != 0)
+                        job_count++;
+
         table = table_new("", "unit", "load", "active", "sub", "job", "description");
         if (!table)
                 return log_oom();
@@ -126,6 +130,18 @@ static int output_units_list(const UnitInfo *unit_infos, size_t c) {
 
         table_set_ersatz_string(table, TABLE_ERSATZ_DASH);
 
+        if (job_count == 0) {
+                /* There's no data in the JOB column, so let's hide it */
+                r = table_hide_column_from_display(table, 5);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to hide column: %m");
+        }
+
+        /* There might be a lot of units, hence write them out as we go rather than all at once */
+        r = output_table_stream_begin(table);
+        if (r < 0)
+                return r;
+
         FOREACH_ARRAY(u, unit_infos, c) {
                 const char *on_loaded = NULL, *on_active = NULL, *on_sub = NULL, *on_circle = NULL;
                 _cleanup_free_ char *id = NULL;
@@ -192,16 +208,6 @@ static int output_units_list(const UnitInfo *unit_infos, size_t c) {
                                    TABLE_SET_BOTH_UNDERLINES, underline);
                 if (r < 0)
                         return table_log_add_error(r);
-
-                if (u->job_id != 0)
-                        job_count++;
-        }
-
-        if (job_count == 0) {
-                /* There's no data in the JOB column, so let's hide it */
-                r = table_hide_column_from_display(table, 5);
-                if (r < 0)
-                        return log_error_errno(r, "Failed to hide column: %m");
         }
 
         r = output_table(table);
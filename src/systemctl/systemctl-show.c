@@ -238,6 +238,8 @@ typedef struct UnitStatusInfo {
         unsigned n_accepted;
         unsigned n_connections;
         unsigned n_refused;
+        usec_t accept_latency_average;
+        usec_t accept_latency_max;
         bool accept;
 
         /* Pairs of type, path */
@@ -577,6 +579,11 @@ static void print_status_info(
                 if (i->n_refused)
                         printf("   Refused: %u", i->n_refused);
                 printf("\n");
+
+                if (i->accept_latency_max > 0)
+                        printf("    Latency: %s average, %s maximum\n",
+                               FORMAT_TIMESPAN(i->accept_latency_average, 1),
+                               FORMAT_TIMESPAN(i->accept_latency_max, 1));
         }
 
         LIST_FOREACH(exec_status_info_list, p, i->exec_status_info_list) {
@@ -2014,127 +2021,128 @@ static const char* const systemctl_show_mode_table[_SYSTEMCTL_SHOW_MODE_MAX] = {
 
 DEFINE_PRIVATE_STRING_TABLE_LOOKUP_FROM_STRING(systemctl_show_mode, SystemctlShowMode);
 
-static int show_one(
+static const struct bus_properties_map property_map[] = {
+        { "Id",                             "s",               NULL,           offsetof(UnitStatusInfo, id)                                },
+        { "LoadState",                      "s",               NULL,           offsetof(UnitStatusInfo, load_state)                        },
+        { "ActiveState",                    "s",               NULL,           offsetof(UnitStatusInfo, active_state)                      },
+        { "FreezerState",                   "s",               NULL,           offsetof(UnitStatusInfo, freezer_state)                     },
+        { "Documentation",                  "as",              NULL,           offsetof(UnitStatusInfo, documentation)                     },
+        {}
+}, status_map[] = {
+        { "Id",                             "s",               NULL,           offsetof(UnitStatusInfo, id)                                },
+        { "LoadState",                      "s",               NULL,           offsetof(UnitStatusInfo, load_state)                        },
+        { "ActiveState",                    "s",               NULL,           offsetof(UnitStatusInfo, active_state)                      },
+        { "FreezerState",                   "s",               NULL,           offsetof(UnitStatusInfo, freezer_state)                     },
+        { "SubState",                       "s",               NULL,           offsetof(UnitStatusInfo, sub_state)                         },
+        { "UnitFileState",                  "s",               NULL,           offsetof(UnitStatusInfo, unit_file_state)                   },
+        { "UnitFilePreset",                 "s",               NULL,           offsetof(UnitStatusInfo, unit_file_preset)                  },
+        { "Description",                    "s",               NULL,           offsetof(UnitStatusInfo, description)                       },
+        { "Following",                      "s",               NULL,           offsetof(UnitStatusInfo, following)                         },
+        { "Documentation",                  "as",              NULL,           offsetof(UnitStatusInfo, documentation)                     },
+        { "FragmentPath",                   "s",               NULL,           offsetof(UnitStatusInfo, fragment_path)                     },
+        { "SourcePath",                     "s",               NULL,           offsetof(UnitStatusInfo, source_path)                       },
+        { "ControlGroup",                   "s",               NULL,           offsetof(UnitStatusInfo, control_group)                     },
+        { "DropInPaths",                    "as",              NULL,           offsetof(UnitStatusInfo, dropin_paths)                      },
+        { "LoadError",                      "(ss)",            map_load_error, offsetof(UnitStatusInfo, load_error)                        },
+        { "Result",                         "s",               NULL,           offsetof(UnitStatusInfo, result)                            },
+        { "TriggeredBy",                    "as",              NULL,           offsetof(UnitStatusInfo, triggered_by)                      },
+        { "Triggers",                       "as",              NULL,           offsetof(UnitStatusInfo, triggers)                          },
+        { "InactiveExitTimestamp",          "t",               NULL,           offsetof(UnitStatusInfo, inactive_exit_timestamp)           },
+        { "InactiveExitTimestampMonotonic", "t",               NULL,           offsetof(UnitStatusInfo, inactive_exit_timestamp_monotonic) },
+        { "ActiveEnterTimestamp",           "t",               NULL,           offsetof(UnitStatusInfo, active_enter_timestamp)            },
+        { "ActiveExitTimestamp",            "t",               NULL,           offsetof(UnitStatusInfo, active_exit_timestamp)             },
+        { "InactiveEnterTimestamp",         "t",               NULL,           offsetof(UnitStatusInfo, inactive_enter_timestamp)          },
+        { "RuntimeMaxUSec",                 "t",               NULL,           offsetof(UnitStatusInfo, runtime_max_sec)                   },
+        { "InvocationID",                   "s",               bus_map_id128,  offsetof(UnitStatusInfo, invocation_id)                     },
+        { "NeedDaemonReload",               "b",               NULL,           offsetof(UnitStatusInfo, need_daemon_reload)                },
+        { "Transient",                      "b",               NULL,           offsetof(UnitStatusInfo, transient)                         },
+        { "ExecMainPID",                    "u",               NULL,           offsetof(UnitStatusInfo, main_pid)                          },
+        { "MainPID",                        "u",               map_main_pid,   0                                                           },
+        { "ControlPID",                     "u",               NULL,           offsetof(UnitStatusInfo, control_pid)                       },
+        { "PIDFile",                        "s",               NULL,           offsetof(UnitStatusInfo, pid_file)                          },
+        { "StatusText",                     "s",               NULL,           offsetof(UnitStatusInfo, status_text)                       },
+        { "StatusErrno",                    "i",               NULL,           offsetof(UnitStatusInfo, status_errno)                      },
+        { "StatusBusError",                 "s",               NULL,           offsetof(UnitStatusInfo, status_bus_error)                  },
+        { "StatusVarlinkError",             "s",               NULL,           offsetof(UnitStatusInfo, status_varlink_error)              },
+        { "FileDescriptorStoreMax",         "u",               NULL,           offsetof(UnitStatusInfo, fd_store_max)                      },
+        { "NFileDescriptorStore",           "u",               NULL,           offsetof(UnitStatusInfo, n_fd_store)                        },
+        { "ExecMainStartTimestamp",         "t",               NULL,           offsetof(UnitStatusInfo, start_timestamp)                   },
+        { "ExecMainExitTimestamp",          "t",               NULL,           offsetof(UnitStatusInfo, exit_timestamp)                    },
+        { "ExecMainCode",                   "i",               NULL,           offsetof(UnitStatusInfo, exit_code)                         },
+        { "ExecMainStatus",                 "i",               NULL,           offsetof(UnitStatusInfo, exit_status)                       },
+        { "LogNamespace",                   "s",               NULL,           offsetof(UnitStatusInfo, log_namespace)                     },
+        { "ConditionTimestamp",             "t",               NULL,           offsetof(UnitStatusInfo, condition_timestamp)               },
+        { "ConditionResult",                "b",               NULL,           offsetof(UnitStatusInfo, condition_result)                  },
+        { "Conditions",                     "a(sbbsi)",        map_conditions, 0                                                           },
+        { "AssertTimestamp",                "t",               NULL,           offsetof(UnitStatusInfo, assert_timestamp)                  },
+        { "AssertResult",                   "b",               NULL,           offsetof(UnitStatusInfo, assert_result)                     },
+        { "Asserts",                        "a(sbbsi)",        map_asserts,    0                                                           },
+        { "NextElapseUSecRealtime",         "t",               NULL,           offsetof(UnitStatusInfo, next_elapse_real)                  },
+        { "NextElapseUSecMonotonic",        "t",               NULL,           offsetof(UnitStatusInfo, next_elapse_monotonic)             },
+        { "NAccepted",                      "u",               NULL,           offsetof(UnitStatusInfo, n_accepted)                        },
+        { "NConnections",                   "u",               NULL,           offsetof(UnitStatusInfo, n_connections)                     },
+        { "NRefused",                       "u",               NULL,           offsetof(UnitStatusInfo, n_refused)                         },
+        { "AcceptLatencyAverageUSec",       "t",               NULL,           offsetof(UnitStatusInfo, accept_latency_average)            },
+        { "AcceptLatencyMaxUSec",           "t",               NULL,           offsetof(UnitStatusInfo, accept_latency_max)                },
+        { "Accept",                         "b",               NULL,           offsetof(UnitStatusInfo, accept)                            },
+        { "Listen",                         "a(ss)",           map_listen,     offsetof(UnitStatusInfo, listen)                            },
+        { "SysFSPath",                      "s",               NULL,           offsetof(UnitStatusInfo, sysfs_path)                        },
+        { "Where",                          "s",               NULL,           offsetof(UnitStatusInfo, where)                             },
+        { "What",                           "s",               NULL,           offsetof(UnitStatusInfo, what)                              },
+        { "MemoryCurrent",                  "t",               NULL,           offsetof(UnitStatusInfo, memory_current)                    },
+        { "MemoryPeak",                     "t",               NULL,           offsetof(UnitStatusInfo, memory_peak)                       },
+        { "MemorySwapCurrent",              "t",               NULL,           offsetof(UnitStatusInfo, memory_swap_current)               },
+        { "MemorySwapPeak",                 "t",               NULL,           offsetof(UnitStatusInfo, memory_swap_peak)                  },
+        { "MemoryZSwapCurrent",             "t",               NULL,           offsetof(UnitStatusInfo, memory_zswap_current)              },
+        { "MemoryAvailable",                "t",               NULL,           offsetof(UnitStatusInfo, memory_available)                  },
+        { "DefaultMemoryMin",               "t",               NULL,           offsetof(UnitStatusInfo, default_memory_min)                },
+        { "DefaultMemoryLow",               "t",               NULL,           offsetof(UnitStatusInfo, default_memory_low)                },
+        { "DefaultStartupMemoryLow",        "t",               NULL,           offsetof(UnitStatusInfo, default_startup_memory_low)        },
+        { "MemoryMin",                      "t",               NULL,           offsetof(UnitStatusInfo, memory_min)                        },
+        { "MemoryLow",                      "t",               NULL,           offsetof(UnitStatusInfo, memory_low)                        },
+        { "StartupMemoryLow",               "t",               NULL,           offsetof(UnitStatusInfo, startup_memory_low)                },
+        { "MemoryHigh",                     "t",               NULL,           offsetof(UnitStatusInfo, memory_high)                       },
+        { "StartupMemoryHigh",              "t",               NULL,           offsetof(UnitStatusInfo, startup_memory_high)               },
+        { "MemoryMax",                      "t",               NULL,           offsetof(UnitStatusInfo, memory_max)                        },
+        { "StartupMemoryMax",               "t",               NULL,           offsetof(UnitStatusInfo, startup_memory_max)                },
+        { "MemorySwapMax",                  "t",               NULL,           offsetof(UnitStatusInfo, memory_swap_max)                   },
+        { "StartupMemorySwapMax",           "t",               NULL,           offsetof(UnitStatusInfo, startup_memory_swap_max)           },
+        { "MemoryZSwapMax",                 "t",               NULL,           offsetof(UnitStatusInfo, memory_zswap_max)                  },
+        { "StartupMemoryZSwapMax",          "t",               NULL,           offsetof(UnitStatusInfo, startup_memory_zswap_max)          },
+        { "MemoryLimit",                    "t",               NULL,           offsetof(UnitStatusInfo, memory_limit)                      },
+        { "CPUUsageNSec",                   "t",               NULL,           offsetof(UnitStatusInfo, cpu_usage_nsec)                    },
+        { "TasksCurrent",                   "t",               NULL,           offsetof(UnitStatusInfo, tasks_current)                     },
+        { "TasksMax",                       "t",               NULL,           offsetof(UnitStatusInfo, tasks_max)                         },
+        { "IPIngressBytes",                 "t",               NULL,           offsetof(UnitStatusInfo, ip_ingress_bytes)                  },
+        { "IPEgressBytes",                  "t",               NULL,           offsetof(UnitStatusInfo, ip_egress_bytes)                   },
+        { "IOReadBytes",                    "t",               NULL,           offsetof(UnitStatusInfo, io_read_bytes)                     },
+        { "IOWriteBytes",                   "t",               NULL,           offsetof(UnitStatusInfo, io_write_bytes)                    },
+        { "ExecCondition",                  "a(sasbttttuii)",  map_exec,       0                                                           },
+        { "ExecConditionEx",                "a(sasasttttuii)", map_exec,       0                                                           },
+        { "ExecStartPre",                   "a(sasbttttuii)",  map_exec,       0                                                           },
+        { "ExecStartPreEx",                 "a(sasasttttuii)", map_exec,       0                                                           },
+        { "ExecStart",                      "a(sasbttttuii)",  map_exec,       0                                                           },
+        { "ExecStartEx",                    "a(sasasttttuii)", map_exec,       0                                                           },
+        { "ExecStartPost",                  "a(sasbttttuii)",  map_exec,       0                                                           },
+        { "ExecStartPostEx",                "a(sasasttttuii)", map_exec,       0                                                           },
+        { "ExecReload",                     "a(sasbttttuii)",  map_exec,       0                                                           },
+        { "ExecReloadEx",                   "a(sasasttttuii)", map_exec,       0                                                           },
+        { "ExecStopPre",                    "a(sasbttttuii)",  map_exec,       0                                                           },
+        { "ExecStop",                       "a(sasbttttuii)",  map_exec,       0                                                           },
+        { "ExecStopEx",                     "a(sasasttttuii)", map_exec,       0                                                           },
+        { "ExecStopPost",                   "a(sasbttttuii)",  map_exec,       0                                                           },
+        { "ExecStopPostEx",                 "a(sasasttttuii)", map_exec,       0                                                           },
+                {}
+};
+
+static int show_unit_properties(
                 sd_bus *bus,
-                const char *path,
+                sd_bus_message *reply,
                 const char *unit,
                 SystemctlShowMode show_mode,
                 bool *new_line,
                 bool *ellipsized) {
 
-        static const struct bus_properties_map property_map[] = {
-                { "Id",                             "s",               NULL,           offsetof(UnitStatusInfo, id)                                },
-                { "LoadState",                      "s",               NULL,           offsetof(UnitStatusInfo, load_state)                        },
-                { "ActiveState",                    "s",               NULL,           offsetof(UnitStatusInfo, active_state)                      },
-                { "FreezerState",                   "s",               NULL,           offsetof(UnitStatusInfo, freezer_state)                     },
-                { "Documentation",                  "as",              NULL,           offsetof(UnitStatusInfo, documentation)                     },
-                {}
-        }, status_map[] = {
-                { "Id",                             "s",               NULL,           offsetof(UnitStatusInfo, id)                                },
-                { "LoadState",                      "s",               NULL,           offsetof(UnitStatusInfo, load_state)                        },
-                { "ActiveState",                    "s",               NULL,           offsetof(UnitStatusInfo, active_state)                      },
-                { "FreezerState",                   "s",               NULL,           offsetof(UnitStatusInfo, freezer_state)                     },
-                { "SubState",                       "s",               NULL,           offsetof(UnitStatusInfo, sub_state)                         },
-                { "UnitFileState",                  "s",               NULL,           offsetof(UnitStatusInfo, unit_file_state)                   },
-                { "UnitFilePreset",                 "s",               NULL,           offsetof(UnitStatusInfo, unit_file_preset)                  },
-                { "Description",                    "s",               NULL,           offsetof(UnitStatusInfo, description)                       },
-                { "Following",                      "s",               NULL,           offsetof(UnitStatusInfo, following)                         },
-                { "Documentation",                  "as",              NULL,           offsetof(UnitStatusInfo, documentation)                     },
-                { "FragmentPath",                   "s",               NULL,           offsetof(UnitStatusInfo, fragment_path)                     },
-                { "SourcePath",                     "s",               NULL,           offsetof(UnitStatusInfo, source_path)                       },
-                { "ControlGroup",                   "s",               NULL,           offsetof(UnitStatusInfo, control_group)                     },
-                { "DropInPaths",                    "as",              NULL,           offsetof(UnitStatusInfo, dropin_paths)                      },
-                { "LoadError",                      "(ss)",            map_load_error, offsetof(UnitStatusInfo, load_error)                        },
-                { "Result",                         "s",               NULL,           offsetof(UnitStatusInfo, result)                            },
-                { "TriggeredBy",                    "as",              NULL,           offsetof(UnitStatusInfo, triggered_by)                      },
-                { "Triggers",                       "as",              NULL,           offsetof(UnitStatusInfo, triggers)                          },
-                { "InactiveExitTimestamp",          "t",               NULL,           offsetof(UnitStatusInfo, inactive_exit_timestamp)           },
-                { "InactiveExitTimestampMonotonic", "t",               NULL,           offsetof(UnitStatusInfo, inactive_exit_timestamp_monotonic) },
-                { "ActiveEnterTimestamp",           "t",               NULL,           offsetof(UnitStatusInfo, active_enter_timestamp)            },
-                { "ActiveExitTimestamp",            "t",               NULL,           offsetof(UnitStatusInfo, active_exit_timestamp)             },
-                { "InactiveEnterTimestamp",         "t",               NULL,           offsetof(UnitStatusInfo, inactive_enter_timestamp)          },
-                { "RuntimeMaxUSec",                 "t",               NULL,           offsetof(UnitStatusInfo, runtime_max_sec)                   },
-                { "InvocationID",                   "s",               bus_map_id128,  offsetof(UnitStatusInfo, invocation_id)                     },
-                { "NeedDaemonReload",               "b",               NULL,           offsetof(UnitStatusInfo, need_daemon_reload)                },
-                { "Transient",                      "b",               NULL,           offsetof(UnitStatusInfo, transient)                         },
-                { "ExecMainPID",                    "u",               NULL,           offsetof(UnitStatusInfo, main_pid)                          },
-                { "MainPID",                        "u",               map_main_pid,   0                                                           },
-                { "ControlPID",                     "u",               NULL,           offsetof(UnitStatusInfo, control_pid)                       },
-                { "PIDFile",                        "s",               NULL,           offsetof(UnitStatusInfo, pid_file)                          },
-                { "StatusText",                     "s",               NULL,           offsetof(UnitStatusInfo, status_text)                       },
-                { "StatusErrno",                    "i",               NULL,           offsetof(UnitStatusInfo, status_errno)                      },
-                { "StatusBusError",                 "s",               NULL,           offsetof(UnitStatusInfo, status_bus_error)                  },
-                { "StatusVarlinkError",             "s",               NULL,           offsetof(UnitStatusInfo, status_varlink_error)              },
-                { "FileDescriptorStoreMax",         "u",               NULL,           offsetof(UnitStatusInfo, fd_store_max)                      },
-                { "NFileDescriptorStore",           "u",               NULL,           offsetof(UnitStatusInfo, n_fd_store)                        },
-                { "ExecMainStartTimestamp",         "t",               NULL,           offsetof(UnitStatusInfo, start_timestamp)                   },
-                { "ExecMainExitTimestamp",          "t",               NULL,           offsetof(UnitStatusInfo, exit_timestamp)                    },
-                { "ExecMainCode",                   "i",               NULL,           offsetof(UnitStatusInfo, exit_code)                         },
-                { "ExecMainStatus",                 "i",               NULL,           offsetof(UnitStatusInfo, exit_status)                       },
-                { "LogNamespace",                   "s",               NULL,           offsetof(UnitStatusInfo, log_namespace)                     },
-                { "ConditionTimestamp",             "t",               NULL,           offsetof(UnitStatusInfo, condition_timestamp)               },
-                { "ConditionResult",                "b",               NULL,           offsetof(UnitStatusInfo, condition_result)                  },
-                { "Conditions",                     "a(sbbsi)",        map_conditions, 0                                                           },
-                { "AssertTimestamp",                "t",               NULL,           offsetof(UnitStatusInfo, assert_timestamp)                  },
-                { "AssertResult",                   "b",               NULL,           offsetof(UnitStatusInfo, assert_result)                     },
-                { "Asserts",                        "a(sbbsi)",        map_asserts,    0                                                           },
-                { "NextElapseUSecRealtime",         "t",               NULL,           offsetof(UnitStatusInfo, next_elapse_real)                  },
-                { "NextElapseUSecMonotonic",        "t",               NULL,           offsetof(UnitStatusInfo, next_elapse_monotonic)             },
-                { "NAccepted",                      "u",               NULL,           offsetof(UnitStatusInfo, n_accepted)                        },
-                { "NConnections",                   "u",               NULL,           offsetof(UnitStatusInfo, n_connections)                     },
-                { "NRefused",                       "u",               NULL,           offsetof(UnitStatusInfo, n_refused)                         },
-                { "Accept",                         "b",               NULL,           offsetof(UnitStatusInfo, accept)                            },
-                { "Listen",                         "a(ss)",           map_listen,     offsetof(UnitStatusInfo, listen)                            },
-                { "SysFSPath",                      "s",               NULL,           offsetof(UnitStatusInfo, sysfs_path)                        },
-                { "Where",                          "s",               NULL,           offsetof(UnitStatusInfo, where)                             },
-                { "What",                           "s",               NULL,           offsetof(UnitStatusInfo, what)                              },
-                { "MemoryCurrent",                  "t",               NULL,           offsetof(UnitStatusInfo, memory_current)                    },
-                { "MemoryPeak",                     "t",               NULL,           offsetof(UnitStatusInfo, memory_peak)                       },
-                { "MemorySwapCurrent",              "t",               NULL,           offsetof(UnitStatusInfo, memory_swap_current)               },
-                { "MemorySwapPeak",                 "t",               NULL,           offsetof(UnitStatusInfo, memory_swap_peak)                  },
-                { "MemoryZSwapCurrent",             "t",               NULL,           offsetof(UnitStatusInfo, memory_zswap_current)              },
-                { "MemoryAvailable",                "t",               NULL,           offsetof(UnitStatusInfo, memory_available)                  },
-                { "DefaultMemoryMin",               "t",               NULL,           offsetof(UnitStatusInfo, default_memory_min)                },
-                { "DefaultMemoryLow",               "t",               NULL,           offsetof(UnitStatusInfo, default_memory_low)                },
-                { "DefaultStartupMemoryLow",        "t",               NULL,           offsetof(UnitStatusInfo, default_startup_memory_low)        },
-                { "MemoryMin",                      "t",               NULL,           offsetof(UnitStatusInfo, memory_min)                        },
-                { "MemoryLow",                      "t",               NULL,           offsetof(UnitStatusInfo, memory_low)                        },
-                { "StartupMemoryLow",               "t",               NULL,           offsetof(UnitStatusInfo, startup_memory_low)                },
-                { "MemoryHigh",                     "t",               NULL,           offsetof(UnitStatusInfo, memory_high)                       },
-                { "StartupMemoryHigh",              "t",               NULL,           offsetof(UnitStatusInfo, startup_memory_high)               },
-                { "MemoryMax",                      "t",               NULL,           offsetof(UnitStatusInfo, memory_max)                        },
-                { "StartupMemoryMax",               "t",               NULL,           offsetof(UnitStatusInfo, startup_memory_max)                },
-                { "MemorySwapMax",                  "t",               NULL,           offsetof(UnitStatusInfo, memory_swap_max)                   },
-                { "StartupMemorySwapMax",           "t",               NULL,           offsetof(UnitStatusInfo, startup_memory_swap_max)           },
-                { "MemoryZSwapMax",                 "t",               NULL,           offsetof(UnitStatusInfo, memory_zswap_max)                  },
-                { "StartupMemoryZSwapMax",          "t",               NULL,           offsetof(UnitStatusInfo, startup_memory_zswap_max)          },
-                { "MemoryLimit",                    "t",               NULL,           offsetof(UnitStatusInfo, memory_limit)                      },
-                { "CPUUsageNSec",                   "t",               NULL,           offsetof(UnitStatusInfo, cpu_usage_nsec)                    },
-                { "TasksCurrent",                   "t",               NULL,           offsetof(UnitStatusInfo, tasks_current)                     },
-                { "TasksMax",                       "t",               NULL,           offsetof(UnitStatusInfo, tasks_max)                         },
-                { "IPIngressBytes",                 "t",               NULL,           offsetof(UnitStatusInfo, ip_ingress_bytes)                  },
-                { "IPEgressBytes",                  "t",               NULL,           offsetof(UnitStatusInfo, ip_egress_bytes)                   },
-                { "IOReadBytes",                    "t",               NULL,           offsetof(UnitStatusInfo, io_read_bytes)                     },
-                { "IOWriteBytes",                   "t",               NULL,           offsetof(UnitStatusInfo, io_write_bytes)                    },
-                { "ExecCondition",                  "a(sasbttttuii)",  map_exec,       0                                                           },
-                { "ExecConditionEx",                "a(sasasttttuii)", map_exec,       0                                                           },
-                { "ExecStartPre",                   "a(sasbttttuii)",  map_exec,       0                                                           },
-                { "ExecStartPreEx",                 "a(sasasttttuii)", map_exec,       0                                                           },
-                { "ExecStart",                      "a(sasbttttuii)",  map_exec,       0                                                           },
-                { "ExecStartEx",                    "a(sasasttttuii)", map_exec,       0                                                           },
-                { "ExecStartPost",                  "a(sasbttttuii)",  map_exec,       0                                                           },
-                { "ExecStartPostEx",                "a(sasasttttuii)", map_exec,       0                                                           },
-                { "ExecReload",                     "a(sasbttttuii)",  map_exec,       0                                                           },
-                { "ExecReloadEx",                   "a(sasasttttuii)", map_exec,       0                                                           },
-                { "ExecStopPre",                    "a(sasbttttuii)",  map_exec,       0                                                           },
-                { "ExecStop",                       "a(sasbttttuii)",  map_exec,       0                                                           },
-                { "ExecStopEx",                     "a(sasasttttuii)", map_exec,       0                                                           },
-                { "ExecStopPost",                   "a(sasbttttuii)",  map_exec,       0                                                           },
-                { "ExecStopPostEx",                 "a(sasasttttuii)", map_exec,       0                                                           },
-                {}
-        };
-
-        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
         _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
         _cleanup_set_free_ Set *found_properties = NULL;
         _cleanup_(unit_status_info_done) UnitStatusInfo info = {
@@ -2164,22 +2172,17 @@ static int show_one(
         };
         int r;
 
-        assert(path);
+        assert(reply);
         assert(new_line);
 
-        log_debug("Showing one %s", path);
-
-        r = bus_map_all_properties(
-                        bus,
-                        "org.freedesktop.systemd1",
-                        path,
+        r = bus_message_map_all_properties(
+                        reply,
                         show_mode == SYSTEMCTL_SHOW_STATUS ? status_map : property_map,
                         BUS_MAP_BOOLEAN_AS_BOOL,
                         &error,
-                        &reply,
                         &info);
         if (r < 0)
-                return log_error_errno(r, "Failed to get properties: %s", bus_error_message(&error, r));
+                return log_error_errno(r, "Failed to map properties: %s", bus_error_message(&error, r));
 
         if (unit && streq_ptr(info.load_state, "not-found") && streq_ptr(info.active_state, "inactive")) {
                 log_full(show_mode == SYSTEMCTL_SHOW_PROPERTIES ? LOG_DEBUG : LOG_ERR,
@@ -2209,9 +2212,9 @@ static int show_one(
                 return 0;
         }
 
-        r = sd_bus_message_rewind(reply, true);
+        r = unit_properties_rewind(reply);
         if (r < 0)
-                return log_error_errno(r, "Failed to rewind: %s", bus_error_message(&error, r));
+                return log_error_errno(r, "Failed to rewind: %m");
 
         r = bus_message_print_all_properties(reply, print_property, arg_properties, arg_print_flags, &found_properties);
         if (r < 0)
@@ -2224,6 +2227,95 @@ static int show_one(
         return 0;
 }
 
+static int show_one(
+                sd_bus *bus,
+                const char *path,
+                const char *unit,
+                SystemctlShowMode show_mode,
+                bool *new_line,
+                bool *ellipsized) {
+
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
+        int r;
+
+        assert(path);
+
+        log_debug("Showing one %s", path);
+
+        r = sd_bus_call_method(
+                        bus,
+                        "org.freedesktop.systemd1",
+                        path,
+                        "org.freedesktop.DBus.Properties",
+                        "GetAll",
+                        &error,
+                        &reply,
+                        "s", "");
+        if (r < 0)
+                return log_error_errno(r, "Failed to get properties: %s", bus_error_message(&error, r));
+
+        return show_unit_properties(bus, reply, unit, show_mode, new_line, ellipsized);
+}
+
+typedef struct ShowUnitsContext {
+        SystemctlShowMode show_mode;
+        bool *new_line;
+        bool *ellipsized;
+        int ret;
+} ShowUnitsContext;
+
+static int show_units_one(sd_bus_message *m, const char *unit, void *userdata) {
+        ShowUnitsContext *c = ASSERT_PTR(userdata);
+        int r;
+
+        r = show_unit_properties(sd_bus_message_get_bus(m), m, unit, c->show_mode, c->new_line, c->ellipsized);
+        if (r < 0)
+                return r;
+        if (r > 0 && c->ret == 0)
+                c->ret = r;
+
+        return 0;
+}
+
+static int show_units(
+                sd_bus *bus,
+                char * const *names,
+                SystemctlShowMode show_mode,
+                bool *new_line,
+                bool *ellipsized) {
+
+        _cleanup_strv_free_ char **properties = NULL;
+        ShowUnitsContext c = {
+                .show_mode = show_mode,
+                .new_line = new_line,
+                .ellipsized = ellipsized,
+        };
+        int r;
+
+        /* Fetches the properties of many units at once, and only the ones we are going to look at. With
+         * 'show' and no --property= that's all of them. */
+        if (show_mode != SYSTEMCTL_SHOW_PROPERTIES || !strv_isempty(arg_properties)) {
+                const struct bus_properties_map *map = show_mode == SYSTEMCTL_SHOW_STATUS ? status_map : property_map;
+
+                if (show_mode == SYSTEMCTL_SHOW_PROPERTIES) {
+                        properties = strv_copy(arg_properties);
+                        if (!properties)
+                                return log_oom();
+                }
+
+                for (const struct bus_properties_map *i = map; i->member; i++)
+                        if (strv_extend(&properties, i->member) < 0)
+                                return log_oom();
+        }
+
+        r = get_units_properties(bus, names, properties, show_units_one, &c);
+        if (r < 0)
+                return r;
+
+        return c.ret;
+}
+
 static int show_all(
                 sd_bus *bus,
                 SystemctlShowMode show_mode,
@@ -2232,8 +2324,9 @@ static int show_all(
 
         _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
         _cleanup_free_ UnitInfo *unit_infos = NULL;
+        _cleanup_free_ char **names = NULL;
         unsigned c;
-        int r, ret = 0;
+        int r;
 
         r = get_unit_list(bus, NULL, NULL, &unit_infos, 0, &reply);
         if (r < 0)
@@ -2245,21 +2338,15 @@ static int show_all(
 
         typesafe_qsort(unit_infos, c, unit_info_compare);
 
-        for (const UnitInfo *u = unit_infos; u < unit_infos + c; u++) {
-                _cleanup_free_ char *p = NULL;
+        names = new(char*, c + 1);
+        if (!names)
+                return log_oom();
 
-                p = unit_dbus_path_from_name(u->id);
-                if (!p)
-                        return log_oom();
+        for (unsigned i = 0; i < c; i++)
+                names[i] = (char*) unit_infos[i].id;
+        names[c] = NULL;
 
-                r = show_one(bus, p, u->id, show_mode, new_line, ellipsized);
-                if (r < 0)
-                        return r;
-                if (r > 0 && ret == 0)
-                        ret = r;
-        }
-
-        return ret;
+        return show_units(bus, names, show_mode, new_line, ellipsized);
 }
 
 static int show_system_status(sd_bus *bus) {
@@ -2420,19 +2507,11 @@ int verb_show(int argc, char *argv[], void *userdata) {
                         if (r < 0)
                                 return r;
 
-                        STRV_FOREACH(name, names) {
-                                _cleanup_free_ char *path = NULL;
-
-                                path = unit_dbus_path_from_name(*name);
-                                if (!path)
-                                        return log_oom();
-
-                                r = show_one(bus, path, *name, show_mode, &new_line, &ellipsized);
-                                if (r < 0)
-                                        return r;
-                                if (r > 0 && ret == 0)
-                                        ret = r;
-                        }
+                        r = show_units(bus, names, show_mode, &new_line, &ellipsized);
+                        if (r < 0)
+                                return r;
+                        if (r > 0 && ret == 0)
+                                ret = r;
                 }
         }
 
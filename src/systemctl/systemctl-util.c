@@ -262,6 +262,174 @@ int get_unit_list(
         return c;
 }
 
+/* Large enough to make the number of calls irrelevant, small enough to keep the replies of a reasonable size
+ * even if all properties are requested */
+#define UNIT_PROPERTIES_BATCH 256U
+
+static int get_units_properties_one_by_one(
+                sd_bus *bus,
+                char * const *names,
+                UnitPropertiesHandler handler,
+                void *userdata) {
+
+        int r;
+
+        STRV_FOREACH(name, names) {
+                _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
+                _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+                _cleanup_free_ char *path = NULL;
+
+                path = unit_dbus_path_from_name(*name);
+                if (!path)
+                        return log_oom();
+
+                r = sd_bus_call_method(
+                                bus,
+                                "org.freedesktop.systemd1",
+                                path,
+                                "org.freedesktop.DBus.Properties",
+                                "GetAll",
+                                &error,
+                                &reply,
+                                "s", "");
+                if (r < 0)
+                        return log_error_errno(r, "Failed to get properties: %s", bus_error_message(&error, r));
+
+                r = handler(reply, *name, userdata);
+                if (r < 0)
+                        return r;
+        }
+
+        return 0;
+}
+
+int get_units_properties(
+                sd_bus *bus,
+                char * const *names,
+                char * const *properties,
+                UnitPropertiesHandler handler,
+                void *userdata) {
+
+        static bool use_get_all = false;
+        size_t n_names;
+        int r;
+
+        assert(bus);
+        assert(handler);
+
+        /* Calls the handler for each of the units with a message positioned at the array of its properties,
+         * i.e. as if GetAll() was called on each of them. If the list of properties is not empty, other
+         * properties might be omitted. The manager returns the properties for a batch of units in a single
+         * reply, instead of one call per unit. */
+
+        if (use_get_all)
+                return get_units_properties_one_by_one(bus, names, handler, userdata);
+
+        n_names = strv_length((char**) names);
+
+        for (size_t i = 0; i < n_names; i += UNIT_PROPERTIES_BATCH) {
+                _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL, *reply = NULL;
+                _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
+                _cleanup_free_ char **batch = NULL;
+
+                batch = strv_copy_n((char**) names + i, UNIT_PROPERTIES_BATCH);
+                if (!batch)
+                        return log_oom();
+
+                r = bus_message_new_method_call(bus, &m, bus_systemd_mgr, "ListUnitPropertiesByPatterns");
+                if (r < 0)
+                        return bus_log_create_error(r);
+
+                r = sd_bus_message_append_strv(m, NULL);
+                if (r < 0)
+                        return bus_log_create_error(r);
+
+                r = sd_bus_message_append_strv(m, batch);
+                if (r < 0)
+                        return bus_log_create_error(r);
+
+                r = sd_bus_message_append_strv(m, (char**) properties);
+                if (r < 0)
+                        return bus_log_create_error(r);
+
+                r = sd_bus_call(bus, m, 0, &error, &reply);
+                if (r < 0 && sd_bus_error_has_names(&error, SD_BUS_ERROR_UNKNOWN_METHOD,
+                                                            SD_BUS_ERROR_ACCESS_DENIED)) {
+                        /* Fall back to one GetAll() call per unit with older managers */
+                        log_debug_errno(r, "Failed to get unit properties: %s Falling back to GetAll().",
+                                        bus_error_message(&error, r));
+                        use_get_all = true;
+                        return get_units_properties_one_by_one(bus, (char**) names + i, handler, userdata);
+                }
+                if (r < 0)
+                        return log_error_errno(r, "Failed to get properties: %s", bus_error_message(&error, r));
+
+                r = sd_bus_message_enter_container(reply, SD_BUS_TYPE_ARRAY, "(sa{sv})");
+                if (r < 0)
+                        return bus_log_parse_error(r);
+
+                for (;;) {
+                        const char *name;
+
+                        r = sd_bus_message_enter_container(reply, SD_BUS_TYPE_STRUCT, "sa{sv}");
+                        if (r < 0)
+                                return bus_log_parse_error(r);
+                        if (r == 0)
+                                break;
+
+                        r = sd_bus_message_read(reply, "s", &name);
+                        if (r < 0)
+                                return bus_log_parse_error(r);
+
+                        r = handler(reply, name, userdata);
+                        if (r < 0)
+                                return r;
+
+                        /* The handler might not have consumed the properties, or gone back to the beginning
+                         * of the structure to parse them again, see unit_properties_rewind() */
+                        r = sd_bus_message_rewind(reply, /* complete= */ false);
+                        if (r < 0)
+                                return bus_log_parse_error(r);
+
+                        r = sd_bus_message_skip(reply, "sa{sv}");
+                        if (r < 0)
+                                return bus_log_parse_error(r);
+
+                        r = sd_bus_message_exit_container(reply);
+                        if (r < 0)
+                                return bus_log_parse_error(r);
+                }
+
+                r = sd_bus_message_exit_container(reply);
+                if (r < 0)
+                        return bus_log_parse_error(r);
+        }
+
+        return 0;
+}
+
+int unit_properties_rewind(sd_bus_message *m) {
+        char type;
+        int r;
+
+        assert(m);
+
+        /* Goes back to the beginning of the properties passed to an UnitPropertiesHandler. That's either the
+         * beginning of a GetAll() reply, or of the structure with the unit name and its properties. */
+
+        r = sd_bus_message_rewind(m, /* complete= */ false);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_peek_type(m, &type, NULL);
+        if (r < 0)
+                return r;
+        if (type == SD_BUS_TYPE_STRING)
+                return sd_bus_message_skip(m, "s");
+
+        return 0;
+}
+
 int expand_unit_names(
                 sd_bus *bus,
                 char * const *names,
@@ -567,7 +735,7 @@ int unit_find_paths(
                 _cleanup_set_free_free_ Set *names = NULL;
 
                 if (!*cached_name_map) {
-                        r = unit_file_build_name_map(lp, NULL, cached_id_map, cached_name_map, NULL);
+                        r = unit_file_load_or_build_name_map(lp, NULL, cached_id_map, cached_name_map, NULL);
                         if (r < 0)
                                 return r;
                 }
@@ -891,21 +1059,39 @@ bool install_client_side(void) {
         return false;
 }
 
+static sd_json_format_flags_t output_table_json_format_flags(void) {
+        if (OUTPUT_MODE_IS_JSON(arg_output))
+                return output_mode_to_json_format_flags(arg_output) | SD_JSON_FORMAT_COLOR_AUTO;
+
+        return SD_JSON_FORMAT_OFF;
+}
+
 int output_table(Table *table) {
         int r;
 
         assert(table);
 
-        if (OUTPUT_MODE_IS_JSON(arg_output))
-                r = table_print_json(table, NULL, output_mode_to_json_format_flags(arg_output) | SD_JSON_FORMAT_COLOR_AUTO);
-        else
-                r = table_print(table, NULL);
+        r = table_print_json(table, NULL, output_table_json_format_flags());
         if (r < 0)
                 return table_log_print_error(r);
 
         return 0;
 }
 
+int output_table_stream_begin(Table *table) {
+        int r;
+
+        assert(table);
+
+        /* Rows are written out as they are added from now on, finish with output_table() */
+
+        r = table_stream_begin(table, NULL, output_table_json_format_flags(), TABLE_STREAM_SAMPLE_ROWS);
+        if (r < 0)
+                return log_error_errno(r, "Failed to set up table output: %m");
+
+        return 0;
+}
+
 bool show_preset_for_state(UnitFileState state) {
         /* Don't show preset state in those unit file states, it'll only confuse users. */
         return !IN_SET(state,
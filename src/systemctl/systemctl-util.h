@@ -26,6 +26,10 @@ int get_sub_state_one_unit(sd_bus *bus, const char *unit, char **ret_sub_state);
 int get_unit_list(sd_bus *bus, const char *machine, char **patterns, UnitInfo **unit_infos, int c, sd_bus_message **ret_reply);
 int expand_unit_names(sd_bus *bus, char * const *names, const char* suffix, char ***ret, bool *ret_expanded);
 
+typedef int (*UnitPropertiesHandler)(sd_bus_message *m, const char *unit, void *userdata);
+int get_units_properties(sd_bus *bus, char * const *names, char * const *properties, UnitPropertiesHandler handler, void *userdata);
+int unit_properties_rewind(sd_bus_message *m);
+
 int get_active_triggering_units(sd_bus *bus, const char *unit, bool ignore_masked, char ***ret);
 void warn_triggering_units(sd_bus *bus, const char *unit, const char *operation, bool ignore_masked);
 
@@ -50,6 +54,7 @@ bool output_show_unit(const UnitInfo *u, char **patterns);
 bool install_client_side(void);
 
 int output_table(Table *table);
+int output_table_stream_begin(Table *table);
 
 bool show_preset_for_state(UnitFileState state);
 
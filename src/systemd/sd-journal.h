@@ -74,6 +74,7 @@ enum {
         SD_JOURNAL_INCLUDE_DEFAULT_NAMESPACE = 1 << 6, /* Show default namespace in addition to specified one */
         SD_JOURNAL_TAKE_DIRECTORY_FD         = 1 << 7, /* sd_journal_open_directory_fd() will take ownership of the provided file descriptor. */
         SD_JOURNAL_ASSUME_IMMUTABLE          = 1 << 8, /* Assume the opened journal files are immutable. Journal entries added later may be ignored. */
+        SD_JOURNAL_SHARE_CACHE               = 1 << 9, /* Share memory maps with other journal objects of the same thread opened with this flag. */
 
         SD_JOURNAL_SYSTEM_ONLY _sd_deprecated_ = SD_JOURNAL_SYSTEM /* old name */
 };
@@ -114,6 +115,7 @@ int sd_journal_enumerate_available_data(sd_journal *j, const void **data, size_t
 void sd_journal_restart_data(sd_journal *j);
 
 int sd_journal_add_match(sd_journal *j, const void *data, size_t size);
+int sd_journal_add_match_set(sd_journal *j, const char *field, const char **values);
 int sd_journal_add_disjunction(sd_journal *j);
 int sd_journal_add_conjunction(sd_journal *j);
 void sd_journal_flush_matches(sd_journal *j);
@@ -132,6 +134,8 @@ int sd_journal_get_cutoff_monotonic_usec(sd_journal *j, const sd_id128_t boot_id
 
 int sd_journal_get_usage(sd_journal *j, uint64_t *bytes);
 
+int sd_journal_get_histogram(sd_journal *j, uint64_t since, uint64_t until, uint64_t bucket_usec, uint64_t **ret_counts, size_t *ret_n_buckets);
+
 int sd_journal_query_unique(sd_journal *j, const char *field);
 int sd_journal_enumerate_unique(sd_journal *j, const void **data, size_t *l);
 int sd_journal_enumerate_available_unique(sd_journal *j, const void **data, size_t *l);
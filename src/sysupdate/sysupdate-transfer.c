@@ -809,8 +809,9 @@ static int run_callout(
 
 int transfer_acquire_instance(Transfer *t, Instance *i) {
         _cleanup_free_ char *formatted_pattern = NULL, *digest = NULL;
-        char offset[DECIMAL_STR_MAX(uint64_t)+1], max_size[DECIMAL_STR_MAX(uint64_t)+1];
-        const char *where = NULL;
+        char offset[DECIMAL_STR_MAX(uint64_t)+1], max_size[DECIMAL_STR_MAX(uint64_t)+1],
+                delta_base_offset[DECIMAL_STR_MAX(uint64_t)+1] = "0";
+        const char *where = NULL, *delta_base = NULL, *delta_base_arg;
         InstanceMetadata f;
         Instance *existing;
         int r;
@@ -892,8 +893,23 @@ int transfer_acquire_instance(Transfer *t, Instance *i) {
                 digest = hexmem(i->metadata.sha256sum, sizeof(i->metadata.sha256sum));
                 if (!digest)
                         return log_oom();
+
+                /* Offer the newest installed version for a delta download, so that only what changed
+                 * since then needs to be downloaded, if the server publishes a chunk index.
+                 * (Instances are ordered newest first.) */
+                if (t->target.n_instances > 0) {
+                        Instance *newest = t->target.instances[0];
+
+                        if (t->target.type == RESOURCE_PARTITION) {
+                                delta_base = t->target.path;
+                                xsprintf(delta_base_offset, "%" PRIu64, newest->partition_info.start);
+                        } else
+                                delta_base = newest->path;
+                }
         }
 
+        delta_base_arg = strjoina("--delta-base=", strempty(delta_base));
+
         switch (i->resource->type) { /* Source */
 
         case RESOURCE_REGULAR_FILE:
@@ -987,6 +1003,8 @@ int transfer_acquire_instance(Transfer *t, Instance *i) {
                                                "--direct",          /* just download the specified URL, don't download anything else */
                                                "--verify", digest,  /* validate by explicit SHA256 sum */
                                                arg_sync ? "--sync=yes" : "--sync=no",
+                                               delta_base_arg,
+                                               "--delta-base-offset", delta_base_offset,
                                                i->path,
                                                t->temporary_path));
                         break;
@@ -1004,6 +1022,8 @@ int transfer_acquire_instance(Transfer *t, Instance *i) {
                                                "--offset", offset,
                                                "--size-max", max_size,
                                                arg_sync ? "--sync=yes" : "--sync=no",
+                                               delta_base_arg,
+                                               "--delta-base-offset", delta_base_offset,
                                                i->path,
                                                t->target.path));
                         break;
@@ -30,6 +30,14 @@ static void test_policy_closed(const char *cgroup_path, BPFProgram **installed_p
         r = bpf_devices_apply_policy(&prog, CGROUP_DEVICE_POLICY_CLOSED, true, cgroup_path, installed_prog);
         ASSERT_OK(r);
 
+        /* Applying the very same policy again leaves the installed program alone */
+        BPFProgram *installed = *installed_prog;
+        ASSERT_OK(bpf_devices_cgroup_init(&prog, CGROUP_DEVICE_POLICY_CLOSED, true));
+        ASSERT_OK(bpf_devices_allow_list_static(prog, cgroup_path));
+        ASSERT_EQ(bpf_devices_apply_policy(&prog, CGROUP_DEVICE_POLICY_CLOSED, true, cgroup_path, installed_prog), 1);
+        ASSERT_TRUE(*installed_prog == installed);
+        ASSERT_NULL(prog);
+
         FOREACH_STRING(s, "/dev/null",
                           "/dev/zero",
                           "/dev/full",
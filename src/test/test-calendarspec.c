@@ -219,6 +219,11 @@ TEST(calendar_spec_next) {
         /* Check that we don't start looping if mktime() moves us backwards */
         test_next("Sun *-*-* 01:00:00 Europe/Dublin", "", 1616412478000000, 1617494400000000);
         test_next("Sun *-*-* 01:00:00 Europe/Dublin", "IST", 1616412478000000, 1617494400000000);
+        /* Weekdays combined with days of the month, which are rare */
+        test_next("Fri *-*-13 00:00:00 UTC", "", 1704067200000000, 1726185600000000);
+        test_next("Sat,Sun *-*-* 10:30 UTC", "", 1704067200000000, 1704537000000000);
+        test_next("Mon *-*-01..07 12:00 UTC", "", 1704153600000000, 1707134400000000);
+        test_next("Thu *-02-29 00:00:00 UTC", "", 1709251200000000, 2592777600000000);
 }
 
 TEST(calendar_spec_from_string) {
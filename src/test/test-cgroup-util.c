@@ -7,6 +7,7 @@
 #include "fd-util.h"
 #include "format-util.h"
 #include "parse-util.h"
+#include "path-util.h"
 #include "proc-cmdline.h"
 #include "process-util.h"
 #include "special.h"
@@ -455,6 +456,54 @@ TEST(cg_get_keyed_attribute) {
         }
 }
 
+TEST(cg_at) {
+        _cleanup_free_ char *path = NULL, *a = NULL, *b = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        _cleanup_close_ int fd = -EBADF;
+        bool found = false;
+        pid_t pid;
+        int r;
+
+        r = cg_unified_controller(SYSTEMD_CGROUP_CONTROLLER);
+        if (r <= 0) {
+                log_tests_skipped("unified hierarchy not mounted");
+                return;
+        }
+
+        ASSERT_OK(cg_pid_get_path(SYSTEMD_CGROUP_CONTROLLER, 0, &path));
+        fd = cg_path_open(SYSTEMD_CGROUP_CONTROLLER, path);
+        if (ERRNO_IS_NEG_PRIVILEGE(fd) || fd == -ENOENT) {
+                log_tests_skipped_errno(fd, "Own cgroup %s not accessible", path);
+                return;
+        }
+        ASSERT_OK(fd);
+
+        ASSERT_OK(cg_get_attribute(SYSTEMD_CGROUP_CONTROLLER, path, "cgroup.controllers", &a));
+        ASSERT_OK(cg_get_attribute_at(fd, "cgroup.controllers", &b));
+        ASSERT_STREQ(a, b);
+
+        ASSERT_ERROR(cg_get_attribute_at(fd, "no_such_file", &b), ENOENT);
+
+        ASSERT_OK(cg_enumerate_processes_at(fd, &f));
+        while ((r = cg_read_pid(f, &pid, /* flags = */ 0)) > 0)
+                if (pid == getpid_cached())
+                        found = true;
+        if (r == -EOPNOTSUPP) /* threaded */
+                return;
+        ASSERT_OK(r);
+        ASSERT_TRUE(found);
+
+        /* The root cgroup has no cgroup.events */
+        if (empty_or_root(path))
+                return;
+
+        a = mfree(a);
+        ASSERT_OK(cg_read_event_at(fd, "populated", &a));
+        ASSERT_STREQ(a, "1");
+        ASSERT_EQ(cg_is_empty_recursive_at(fd), 0);
+        ASSERT_EQ(cg_is_empty_recursive(SYSTEMD_CGROUP_CONTROLLER, path), 0);
+}
+
 TEST(bfq_weight_conversion) {
         assert_se(BFQ_WEIGHT(1) == 1);
         assert_se(BFQ_WEIGHT(50) == 50);
@@ -1,9 +1,15 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
+#include <unistd.h>
+
 #include "alloc-util.h"
 #include "compress.h"
+#include "cpu-set-util.h"
 #include "env-util.h"
+#include "fd-util.h"
+#include "io-util.h"
 #include "macro.h"
+#include "memfd-util.h"
 #include "memory-util.h"
 #include "nulstr-util.h"
 #include "parse-util.h"
@@ -138,6 +144,53 @@ static void test_compress_decompress(const char* label, const char* type,
                  100 - compressed * 100. / total,
                  skipped);
 }
+
+#if HAVE_ZSTD
+static void test_compress_stream_zstd(const char *type, size_t size) {
+        _cleanup_close_ int src = -EBADF;
+        unsigned n_threads;
+        int n_cpus;
+
+        /* Like a core dump, i.e. a large file, with different data in each chunk */
+        assert_se((src = memfd_new("src")) >= 0);
+        for (size_t i = 0; i < size; i += MAX_SIZE) {
+                _cleanup_free_ char *buf = make_buf(MAX_SIZE, type);
+
+                assert_se(loop_write(src, buf, MAX_SIZE) >= 0);
+        }
+
+        n_cpus = cpus_in_affinity_mask();
+
+        FOREACH_ARGUMENT(n_threads, 1U, 2U, 4U, (unsigned) MAX(n_cpus, 1)) {
+                _cleanup_close_ int dst = -EBADF, out = -EBADF;
+                uint64_t uncompressed_size = 0, compressed_size;
+                usec_t n;
+                float dt;
+
+                assert_se((dst = memfd_new("dst")) >= 0);
+                assert_se(lseek(src, 0, SEEK_SET) == 0);
+
+                n = now(CLOCK_MONOTONIC);
+                assert_se(compress_stream_zstd_full(src, dst, UINT64_MAX, n_threads, &uncompressed_size) >= 0);
+                dt = (now(CLOCK_MONOTONIC) - n) / 1e6;
+
+                assert_se(uncompressed_size == size);
+                assert_se(memfd_get_size(dst, &compressed_size) >= 0);
+
+                /* Whatever the number of threads, the output is a regular zstd frame */
+                assert_se((out = memfd_new("out")) >= 0);
+                assert_se(lseek(dst, 0, SEEK_SET) == 0);
+                assert_se(decompress_stream_zstd(dst, out, UINT64_MAX) >= 0);
+                assert_se(lseek(out, 0, SEEK_CUR) == (off_t) size);
+
+                log_info("ZSTD/stream/%s: compressed %zu bytes with %u thread(s) in %.2fs (%.2fMiB/s), "
+                         "mean compression %.2f%%",
+                         type, size, n_threads, dt,
+                         size / 1024. / 1024 / dt,
+                         100 - compressed_size * 100. / size);
+        }
+}
+#endif
 #endif
 
 int main(int argc, char *argv[]) {
@@ -169,6 +222,10 @@ int main(int argc, char *argv[]) {
                 test_compress_decompress("ZSTD", i, compress_blob_zstd, decompress_blob_zstd);
 #endif
         }
+
+#if HAVE_ZSTD
+        test_compress_stream_zstd("random", (slow_tests_enabled() ? 512 : 16) * MAX_SIZE);
+#endif
         return 0;
 #else
         return log_tests_skipped("No compression feature is enabled");
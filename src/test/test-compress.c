@@ -269,6 +269,135 @@ static void test_lz4_decompress_partial(void) {
 }
 #endif
 
+#if HAVE_ZSTD
+static void test_zstd_dictionary(void) {
+        _cleanup_(zstd_dictionary_freep) ZstdDictionary *d = NULL;
+        _cleanup_free_ char *samples = NULL, *decompressed = NULL;
+        _cleanup_free_ size_t *sample_sizes = NULL;
+        _cleanup_free_ void *dict = NULL;
+        const char *message = "MESSAGE=Started session 4711 of user nobody.";
+        char compressed[512];
+        size_t n = 2000, samples_size = 0, dict_size, csize, csize_dict, dsize;
+        int r;
+
+        log_info("/* testing ZSTD dictionary compression */");
+
+        assert_se(sample_sizes = new(size_t, n));
+        for (size_t i = 0; i < n; i++) {
+                _cleanup_free_ char *t = NULL;
+
+                assert_se(asprintf(&t, "MESSAGE=Started session %zu of user %s.", i, i % 3 == 0 ? "root" : "nobody") >= 0);
+                assert_se(GREEDY_REALLOC(samples, samples_size + strlen(t)));
+                memcpy(samples + samples_size, t, strlen(t));
+                samples_size += strlen(t);
+                sample_sizes[i] = strlen(t);
+        }
+
+        r = zstd_dictionary_train(samples, sample_sizes, n, 4096, &dict, &dict_size);
+        if (r == -ENODATA)
+                return (void) log_tests_skipped("not enough data to train a ZSTD dictionary");
+        assert_se(r >= 0);
+        assert_se(dict_size > 0 && dict_size <= 4096);
+
+        assert_se(zstd_dictionary_new(dict, dict_size, &d) >= 0);
+
+        assert_se(compress_blob_zstd(message, strlen(message), compressed, sizeof(compressed), &csize) >= 0);
+        assert_se(compress_blob_zstd_with_dictionary(message, strlen(message), compressed, sizeof(compressed), &csize_dict, d) >= 0);
+        log_info("compressed %zu bytes to %zu bytes without and %zu bytes with dictionary",
+                 strlen(message), csize, csize_dict);
+        assert_se(csize_dict < csize);
+
+        assert_se(decompress_blob_zstd_with_dictionary(compressed, csize_dict, (void**) &decompressed, &dsize, 0, d) >= 0);
+        assert_se(dsize == strlen(message));
+        assert_se(memcmp(decompressed, message, dsize) == 0);
+
+        assert_se(decompress_startswith_zstd_with_dictionary(compressed, csize_dict, (void**) &decompressed, "MESSAGE", STRLEN("MESSAGE"), '=', d) > 0);
+        assert_se(decompress_startswith_zstd_with_dictionary(compressed, csize_dict, (void**) &decompressed, "MESSAGEX", STRLEN("MESSAGEX"), '=', d) == 0);
+}
+
+typedef struct DecompressorOutput {
+        char *data;
+        size_t size;
+} DecompressorOutput;
+
+static int decompressor_append(const void *data, size_t size, void *userdata) {
+        DecompressorOutput *o = ASSERT_PTR(userdata);
+
+        if (!GREEDY_REALLOC(o->data, o->size + size))
+                return -ENOMEM;
+
+        memcpy(o->data + o->size, data, size);
+        o->size += size;
+        return 0;
+}
+
+static void test_decompressor(const char *data, size_t data_size) {
+        _cleanup_(decompressor_freep) Decompressor *d = NULL;
+        _cleanup_free_ char *compressed = NULL;
+        DecompressorOutput out = {};
+        size_t csize1, csize2, alloc;
+
+        log_info("/* testing ZSTD streaming decompression of %zu bytes */", data_size);
+
+        /* Two concatenated frames, fed in pieces of an odd size */
+        alloc = 2 * data_size + 1024;
+        assert_se(compressed = malloc(alloc));
+        assert_se(compress_blob_zstd(data, data_size, compressed, alloc, &csize1) >= 0);
+        assert_se(compress_blob_zstd(data, data_size, compressed + csize1, alloc - csize1, &csize2) >= 0);
+
+        assert_se(decompressor_new(COMPRESSION_ZSTD, &d) >= 0);
+        for (size_t i = 0; i < csize1 + csize2; i += 7)
+                assert_se(decompressor_push(d, compressed + i, MIN((size_t) 7, csize1 + csize2 - i),
+                                            decompressor_append, &out) >= 0);
+
+        assert_se(out.size == 2 * data_size);
+        assert_se(memcmp(out.data, data, data_size) == 0);
+        assert_se(memcmp(out.data + data_size, data, data_size) == 0);
+        out.data = mfree(out.data);
+        out.size = 0;
+
+        /* Garbage is refused */
+        assert_se(decompressor_push(d, "garbage!", 8, decompressor_append, &out) < 0);
+
+        assert_se(decompressor_new(COMPRESSION_XZ, &d) == -EOPNOTSUPP);
+}
+
+static void test_compressor(const char *data, size_t data_size) {
+        _cleanup_(compressor_freep) Compressor *c = NULL;
+        _cleanup_(decompressor_freep) Decompressor *d = NULL;
+        DecompressorOutput compressed = {}, out = {};
+
+        log_info("/* testing ZSTD streaming compression of %zu bytes */", data_size);
+
+        assert_se(compressor_new(COMPRESSION_ZSTD, &c) >= 0);
+        assert_se(decompressor_new(COMPRESSION_ZSTD, &d) >= 0);
+
+        /* Everything pushed so far can be decoded on the other side right away */
+        assert_se(compressor_push(c, data, data_size / 2, /* end= */ false, decompressor_append, &compressed) >= 0);
+        assert_se(decompressor_push(d, compressed.data, compressed.size, decompressor_append, &out) >= 0);
+        assert_se(out.size == data_size / 2);
+        assert_se(memcmp(out.data, data, out.size) == 0);
+
+        compressed.size = 0;
+        assert_se(compressor_push(c, data + data_size / 2, data_size - data_size / 2, /* end= */ true, decompressor_append, &compressed) >= 0);
+        assert_se(decompressor_push(d, compressed.data, compressed.size, decompressor_append, &out) >= 0);
+        assert_se(out.size == data_size);
+        assert_se(memcmp(out.data, data, data_size) == 0);
+
+        /* The next push starts a new frame, which can be decoded on its own */
+        d = decompressor_free(d);
+        assert_se(decompressor_new(COMPRESSION_ZSTD, &d) >= 0);
+        compressed.size = out.size = 0;
+        assert_se(compressor_push(c, data, data_size, /* end= */ true, decompressor_append, &compressed) >= 0);
+        assert_se(decompressor_push(d, compressed.data, compressed.size, decompressor_append, &out) >= 0);
+        assert_se(out.size == data_size);
+        assert_se(memcmp(out.data, data, data_size) == 0);
+
+        free(compressed.data);
+        free(out.data);
+}
+#endif
+
 int main(int argc, char *argv[]) {
 #if HAVE_COMPRESSION
         _unused_ const char text[] =
@@ -365,6 +494,13 @@ int main(int argc, char *argv[]) {
                              compress_stream_zstd, decompress_stream_zstd, srcfile);
 
         test_decompress_startswith_short("ZSTD", compress_blob_zstd, decompress_startswith_zstd);
+
+        test_zstd_dictionary();
+
+        test_decompressor(text, sizeof(text));
+        test_decompressor(huge, HUGE_SIZE);
+        test_compressor(text, sizeof(text));
+        test_compressor(huge, HUGE_SIZE);
 #else
         log_info("/* ZSTD test skipped */");
 #endif
@@ -392,6 +392,64 @@ TEST(config_parse) {
                 test_config_parse_one(i, config_file[i]);
 }
 
+TEST(config_parse_cache) {
+        _cleanup_(unlink_tempfilep) char name[] = "/tmp/test-conf-parser.XXXXXX";
+        _cleanup_hashmap_free_ Hashmap *cache = NULL;
+        _cleanup_free_ char *setting1 = NULL, *setting2 = NULL;
+        _cleanup_close_ int fd = -EBADF;
+        struct stat st;
+
+        const ConfigTableItem items[] = {
+                { "Section", "setting1",  config_parse_string,   0, &setting1},
+                { "Other",   "setting2",  config_parse_string,   0, &setting2},
+                {}
+        };
+
+        fd = mkostemp_safe(name);
+        assert_se(fd >= 0);
+        assert_se(write_string_file(name,
+                                    "[Section]\n"
+                                    "setting1=1\\\n"
+                                    "2\n"
+                                    "[Other]\n"
+                                    "setting2=aaa\n",
+                                    WRITE_STRING_FILE_TRUNCATE|WRITE_STRING_FILE_DISABLE_BUFFER) >= 0);
+
+        assert_se(config_parse_full(NULL, name, NULL, "Section\0Other\0", config_item_table_lookup, items,
+                                    CONFIG_PARSE_WARN, NULL, &st, &cache) == 1);
+        ASSERT_STREQ(setting1, "1 2");
+        ASSERT_STREQ(setting2, "aaa");
+        assert_se(hashmap_size(cache) == 1);
+
+        /* Sneak in different contents of the same size behind the cache's back: the cached tokens are used
+         * as long as size and mtime match, with whatever sections are requested this time */
+        setting1 = mfree(setting1);
+        setting2 = mfree(setting2);
+        assert_se(pwrite(fd, "3", 1, STRLEN("[Section]\nsetting1=")) == 1);
+        assert_se(futimens(fd, (const struct timespec[2]) { st.st_atim, st.st_mtim }) >= 0);
+
+        assert_se(config_parse_full(NULL, name, NULL, "Section\0", config_item_table_lookup, items,
+                                    CONFIG_PARSE_RELAXED, NULL, NULL, &cache) == 1);
+        ASSERT_STREQ(setting1, "1 2");
+        ASSERT_NULL(setting2);
+
+        /* And once the file changes, it is read again */
+        setting1 = mfree(setting1);
+        assert_se(write_string_file(name, "[Section]\nsetting1=4\n", WRITE_STRING_FILE_TRUNCATE|WRITE_STRING_FILE_DISABLE_BUFFER) >= 0);
+
+        assert_se(config_parse_full(NULL, name, NULL, "Section\0Other\0", config_item_table_lookup, items,
+                                    CONFIG_PARSE_WARN, NULL, NULL, &cache) == 1);
+        ASSERT_STREQ(setting1, "4");
+        ASSERT_NULL(setting2);
+        assert_se(hashmap_size(cache) == 1);
+
+        /* Files not parsed between two trims are dropped */
+        config_parse_cache_trim(cache);
+        assert_se(hashmap_size(cache) == 1);
+        config_parse_cache_trim(cache);
+        assert_se(hashmap_isempty(cache));
+}
+
 TEST(config_parse_standard_file_with_dropins_full) {
         _cleanup_(rmdir_and_freep) char *root = NULL;
         _cleanup_close_ int rfd = -EBADF;
@@ -0,0 +1,138 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <unistd.h>
+
+#include "alloc-util.h"
+#include "copy.h"
+#include "fd-util.h"
+#include "fileio.h"
+#include "fs-util.h"
+#include "io-util.h"
+#include "mkdir.h"
+#include "parse-util.h"
+#include "path-util.h"
+#include "random-util.h"
+#include "rm-rf.h"
+#include "stat-util.h"
+#include "stdio-util.h"
+#include "tests.h"
+#include "time-util.h"
+#include "tmpfile-util.h"
+#include "user-util.h"
+
+#define FILES_PER_DIR 64U
+#define FILE_SIZE_MAX (1U*U64_MB)
+
+static unsigned arg_n_files;
+
+/* Like an OS tree: mostly small files, and a few large ones */
+static size_t file_size(unsigned i) {
+        if (i % 97 == 0)
+                return FILE_SIZE_MAX;
+        if (i % 7 == 0)
+                return 64U * U64_KB + i % 4096;
+
+        return i % 8192;
+}
+
+static void file_path(char buf[static 64], unsigned i) {
+        assert_se(snprintf_ok(buf, 64, "dir%u/sub%u/file%u", i / FILES_PER_DIR, i / FILES_PER_DIR % 3, i));
+}
+
+static void make_tree(int dir_fd, const uint8_t *data) {
+        /* Every 16th file is hardlinked into the directory above, too */
+        for (unsigned i = 0; i < arg_n_files; i++) {
+                _cleanup_close_ int fd = -EBADF;
+                char p[64];
+
+                file_path(p, i);
+
+                assert_se(mkdirat_parents(dir_fd, p, 0755) >= 0);
+                fd = openat(dir_fd, p, O_WRONLY|O_CREAT|O_EXCL|O_CLOEXEC, 0644);
+                assert_se(fd >= 0);
+                assert_se(loop_write(fd, data + i % 4096, file_size(i)) >= 0);
+
+                if (i % 16 == 0) {
+                        char l[64];
+
+                        assert_se(snprintf_ok(l, sizeof(l), "dir%u/link%u", i / FILES_PER_DIR, i));
+                        assert_se(linkat(dir_fd, p, dir_fd, l, 0) >= 0);
+                }
+        }
+}
+
+static void verify_tree(int dir_fd, const char *path, const uint8_t *data) {
+        _cleanup_free_ char *buf = NULL;
+
+        for (unsigned i = 0; i < arg_n_files; i++) {
+                _cleanup_free_ char *p = NULL;
+                char f[64];
+                size_t sz;
+
+                file_path(f, i);
+                assert_se(p = path_join(path, f));
+
+                assert_se(read_full_file_at(dir_fd, p, &buf, &sz) >= 0);
+                assert_se(sz == file_size(i));
+                assert_se(memcmp(buf, data + i % 4096, sz) == 0);
+                buf = mfree(buf);
+
+                if (i % 16 == 0) {
+                        _cleanup_free_ char *l = NULL;
+                        struct stat a, b;
+
+                        assert_se(asprintf(&l, "%s/dir%u/link%u", path, i / FILES_PER_DIR, i) >= 0);
+                        assert_se(fstatat(dir_fd, p, &a, AT_SYMLINK_NOFOLLOW) >= 0);
+                        assert_se(fstatat(dir_fd, l, &b, AT_SYMLINK_NOFOLLOW) >= 0);
+                        assert_se(stat_inode_same(&a, &b));
+                }
+        }
+}
+
+static void test_copy_tree_one(int dir_fd, const char *label, CopyFlags flags, const uint8_t *data) {
+        usec_t n;
+
+        /* Start from a cold page cache for the source if we may, copying trees is bound by I/O latency
+         * then, which is what copying in parallel is about. */
+        sync();
+        (void) write_string_file("/proc/sys/vm/drop_caches", "3", WRITE_STRING_FILE_DISABLE_BUFFER);
+
+        n = now(CLOCK_MONOTONIC);
+        assert_se(copy_tree_at(dir_fd, "src", dir_fd, label, UID_INVALID, GID_INVALID,
+                               COPY_REFLINK|COPY_HARDLINKS|flags, NULL, NULL) >= 0);
+        n = now(CLOCK_MONOTONIC) - n;
+
+        log_info("%s: copied %u files in %s (%.1fus/file)",
+                 label, arg_n_files, FORMAT_TIMESPAN(n, 1), (double) n / arg_n_files);
+
+        verify_tree(dir_fd, label, data);
+}
+
+int main(int argc, char *argv[]) {
+        _cleanup_(rm_rf_physical_and_freep) char *t = NULL;
+        _cleanup_close_ int dir_fd = -EBADF, src_fd = -EBADF;
+        _cleanup_free_ uint8_t *data = NULL;
+
+        test_setup_logging(LOG_INFO);
+
+        if (argc >= 2)
+                assert_se(safe_atou(argv[1], &arg_n_files) >= 0 && arg_n_files > 0);
+        else
+                arg_n_files = slow_tests_enabled() ? 100000 : 2000;
+
+        /* The tree is created below $TMPDIR, point it to a real disk rather than tmpfs for meaningful numbers */
+        dir_fd = mkdtemp_open(NULL, 0, &t);
+        assert_se(dir_fd >= 0);
+
+        assert_se(data = malloc(FILE_SIZE_MAX + 4096));
+        random_bytes(data, FILE_SIZE_MAX + 4096);
+
+        src_fd = open_mkdir_at(dir_fd, "src", O_EXCL|O_CLOEXEC, 0755);
+        assert_se(src_fd >= 0);
+        make_tree(src_fd, data);
+
+        test_copy_tree_one(dir_fd, "serial", 0, data);
+        test_copy_tree_one(dir_fd, "parallel", COPY_PARALLEL, data);
+
+        return 0;
+}
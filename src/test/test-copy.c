@@ -18,6 +18,7 @@
 #include "path-util.h"
 #include "random-util.h"
 #include "rm-rf.h"
+#include "stat-util.h"
 #include "string-util.h"
 #include "strv.h"
 #include "tests.h"
@@ -591,4 +592,52 @@ TEST(copy_verify_linked) {
         assert_se(faccessat(tfd, "to_2", F_OK, AT_SYMLINK_NOFOLLOW) < 0 && errno == ENOENT);
 }
 
+TEST(copy_tree_parallel) {
+        _cleanup_(rm_rf_physical_and_freep) char *srcp = NULL, *dstp = NULL;
+        _cleanup_close_ int src = -EBADF, dst = -EBADF;
+        struct stat a, b;
+
+        ASSERT_OK(src = mkdtemp_open(NULL, 0, &srcp));
+        ASSERT_OK(dst = mkdtemp_open(NULL, 0, &dstp));
+
+        /* More files than fit into the queue of the workers, so that we also have to wait for them while
+         * walking the tree */
+        for (unsigned i = 0; i < 200; i++) {
+                _cleanup_free_ char *p = NULL, *c = NULL;
+
+                ASSERT_OK(asprintf(&p, "dir%u/sub/file%u", i % 7, i));
+                ASSERT_OK(asprintf(&c, "file %u", i));
+                ASSERT_OK(write_string_file_at(src, p, c, WRITE_STRING_FILE_CREATE|WRITE_STRING_FILE_MKDIR_0755));
+        }
+
+        ASSERT_OK_ERRNO(fchmodat(src, "dir1/sub/file1", 0600, 0));
+        ASSERT_OK_ERRNO(linkat(src, "dir0/sub/file0", src, "dir6/hardlink", 0));
+        ASSERT_OK_ERRNO(symlinkat("sub/file2", src, "dir2/symlink"));
+
+        ASSERT_OK(copy_tree_at(src, NULL, dst, "copy", UID_INVALID, GID_INVALID, COPY_PARALLEL|COPY_HARDLINKS, NULL, NULL));
+
+        for (unsigned i = 0; i < 200; i++) {
+                _cleanup_free_ char *p = NULL, *c = NULL;
+
+                ASSERT_OK(asprintf(&p, "copy/dir%u/sub/file%u", i % 7, i));
+                ASSERT_OK(asprintf(&c, "file %u\n", i));
+                ASSERT_TRUE(read_file_at_and_streq(dst, p, c));
+        }
+
+        ASSERT_OK_ERRNO(fstatat(dst, "copy/dir1/sub/file1", &a, AT_SYMLINK_NOFOLLOW));
+        ASSERT_EQ(a.st_mode & 07777, 0600U);
+
+        ASSERT_OK_ERRNO(fstatat(dst, "copy/dir0/sub/file0", &a, AT_SYMLINK_NOFOLLOW));
+        ASSERT_OK_ERRNO(fstatat(dst, "copy/dir6/hardlink", &b, AT_SYMLINK_NOFOLLOW));
+        ASSERT_TRUE(stat_inode_same(&a, &b));
+
+        ASSERT_TRUE(read_file_at_and_streq(dst, "copy/dir2/symlink", "file 2\n"));
+
+        /* Existing files are replaced while the tree is walked, before their new contents are copied */
+        ASSERT_OK(write_string_file_at(src, "dir3/sub/file3", "changed", WRITE_STRING_FILE_TRUNCATE));
+        ASSERT_OK(copy_tree_at(src, NULL, dst, "copy", UID_INVALID, GID_INVALID, COPY_PARALLEL|COPY_MERGE|COPY_REPLACE, NULL, NULL));
+        ASSERT_TRUE(read_file_at_and_streq(dst, "copy/dir3/sub/file3", "changed\n"));
+        ASSERT_TRUE(read_file_at_and_streq(dst, "copy/dir4/sub/file4", "file 4\n"));
+}
+
 DEFINE_TEST_MAIN(LOG_DEBUG);
@@ -10,7 +10,9 @@
 #include "service.h"
 #include "slice.h"
 #include "special.h"
+#include "stdio-util.h"
 #include "strv.h"
+#include "target.h"
 #include "tests.h"
 #include "unit-serialize.h"
 
@@ -184,32 +186,50 @@ int main(int argc, char *argv[]) {
         assert_se(manager_add_job(m, JOB_START, a_conj, JOB_REPLACE, NULL, NULL, &j) == -EDEADLK);
         manager_dump_jobs(m, stdout, /* patterns= */ NULL, "\t");
 
-        assert_se(!hashmap_get(unit_get_dependencies(a, UNIT_PROPAGATES_RELOAD_TO), b));
-        assert_se(!hashmap_get(unit_get_dependencies(b, UNIT_RELOAD_PROPAGATED_FROM), a));
-        assert_se(!hashmap_get(unit_get_dependencies(a, UNIT_PROPAGATES_RELOAD_TO), c));
-        assert_se(!hashmap_get(unit_get_dependencies(c, UNIT_RELOAD_PROPAGATED_FROM), a));
+        assert_se(!unit_dependency_list_get(unit_get_dependencies(a, UNIT_PROPAGATES_RELOAD_TO), b));
+        assert_se(!unit_dependency_list_get(unit_get_dependencies(b, UNIT_RELOAD_PROPAGATED_FROM), a));
+        assert_se(!unit_dependency_list_get(unit_get_dependencies(a, UNIT_PROPAGATES_RELOAD_TO), c));
+        assert_se(!unit_dependency_list_get(unit_get_dependencies(c, UNIT_RELOAD_PROPAGATED_FROM), a));
 
         assert_se(unit_add_dependency(a, UNIT_PROPAGATES_RELOAD_TO, b, true, UNIT_DEPENDENCY_UDEV) >= 0);
         assert_se(unit_add_dependency(a, UNIT_PROPAGATES_RELOAD_TO, c, true, UNIT_DEPENDENCY_PROC_SWAP) >= 0);
 
-        assert_se( hashmap_get(unit_get_dependencies(a, UNIT_PROPAGATES_RELOAD_TO), b));
-        assert_se( hashmap_get(unit_get_dependencies(b, UNIT_RELOAD_PROPAGATED_FROM), a));
-        assert_se( hashmap_get(unit_get_dependencies(a, UNIT_PROPAGATES_RELOAD_TO), c));
-        assert_se( hashmap_get(unit_get_dependencies(c, UNIT_RELOAD_PROPAGATED_FROM), a));
+        assert_se( unit_dependency_list_get(unit_get_dependencies(a, UNIT_PROPAGATES_RELOAD_TO), b));
+        assert_se( unit_dependency_list_get(unit_get_dependencies(b, UNIT_RELOAD_PROPAGATED_FROM), a));
+        assert_se( unit_dependency_list_get(unit_get_dependencies(a, UNIT_PROPAGATES_RELOAD_TO), c));
+        assert_se( unit_dependency_list_get(unit_get_dependencies(c, UNIT_RELOAD_PROPAGATED_FROM), a));
 
         unit_remove_dependencies(a, UNIT_DEPENDENCY_UDEV);
 
-        assert_se(!hashmap_get(unit_get_dependencies(a, UNIT_PROPAGATES_RELOAD_TO), b));
-        assert_se(!hashmap_get(unit_get_dependencies(b, UNIT_RELOAD_PROPAGATED_FROM), a));
-        assert_se( hashmap_get(unit_get_dependencies(a, UNIT_PROPAGATES_RELOAD_TO), c));
-        assert_se( hashmap_get(unit_get_dependencies(c, UNIT_RELOAD_PROPAGATED_FROM), a));
+        assert_se(!unit_dependency_list_get(unit_get_dependencies(a, UNIT_PROPAGATES_RELOAD_TO), b));
+        assert_se(!unit_dependency_list_get(unit_get_dependencies(b, UNIT_RELOAD_PROPAGATED_FROM), a));
+        assert_se( unit_dependency_list_get(unit_get_dependencies(a, UNIT_PROPAGATES_RELOAD_TO), c));
+        assert_se( unit_dependency_list_get(unit_get_dependencies(c, UNIT_RELOAD_PROPAGATED_FROM), a));
 
         unit_remove_dependencies(a, UNIT_DEPENDENCY_PROC_SWAP);
 
-        assert_se(!hashmap_get(unit_get_dependencies(a, UNIT_PROPAGATES_RELOAD_TO), b));
-        assert_se(!hashmap_get(unit_get_dependencies(b, UNIT_RELOAD_PROPAGATED_FROM), a));
-        assert_se(!hashmap_get(unit_get_dependencies(a, UNIT_PROPAGATES_RELOAD_TO), c));
-        assert_se(!hashmap_get(unit_get_dependencies(c, UNIT_RELOAD_PROPAGATED_FROM), a));
+        assert_se(!unit_dependency_list_get(unit_get_dependencies(a, UNIT_PROPAGATES_RELOAD_TO), b));
+        assert_se(!unit_dependency_list_get(unit_get_dependencies(b, UNIT_RELOAD_PROPAGATED_FROM), a));
+        assert_se(!unit_dependency_list_get(unit_get_dependencies(a, UNIT_PROPAGATES_RELOAD_TO), c));
+        assert_se(!unit_dependency_list_get(unit_get_dependencies(c, UNIT_RELOAD_PROPAGATED_FROM), a));
+
+        /* Enough dependencies of one type for the list to be converted into a hashmap */
+        for (unsigned k = 0; k <= UNIT_DEPENDENCY_LIST_MAX; k++) {
+                char name[STRLEN("many-.target") + DECIMAL_STR_MAX(unsigned)];
+                Unit *x;
+
+                xsprintf(name, "many-%u.target", k);
+                assert_se(unit_new_for_name(m, sizeof(Target), name, &x) >= 0);
+                assert_se(unit_add_dependency(a, UNIT_PROPAGATES_RELOAD_TO, x, true, k % 2 ? UNIT_DEPENDENCY_UDEV : UNIT_DEPENDENCY_PROC_SWAP) >= 0);
+                assert_se(unit_dependency_list_get(unit_get_dependencies(a, UNIT_PROPAGATES_RELOAD_TO), x));
+                assert_se(unit_dependency_list_get(unit_get_dependencies(x, UNIT_RELOAD_PROPAGATED_FROM), a));
+        }
+
+        assert_se(unit_dependency_list_size(unit_get_dependencies(a, UNIT_PROPAGATES_RELOAD_TO)) == UNIT_DEPENDENCY_LIST_MAX + 1);
+        unit_remove_dependencies(a, UNIT_DEPENDENCY_UDEV);
+        assert_se(unit_dependency_list_size(unit_get_dependencies(a, UNIT_PROPAGATES_RELOAD_TO)) == UNIT_DEPENDENCY_LIST_MAX / 2 + 1);
+        unit_remove_dependencies(a, UNIT_DEPENDENCY_PROC_SWAP);
+        assert_se(unit_dependency_list_size(unit_get_dependencies(a, UNIT_PROPAGATES_RELOAD_TO)) == 0);
 
         assert_se(manager_load_unit(m, "unit-with-multiple-dashes.service", NULL, NULL, &unit_with_multiple_dashes) >= 0);
 
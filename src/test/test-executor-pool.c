@@ -0,0 +1,106 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "executor-pool.h"
+#include "fd-util.h"
+#include "fdset.h"
+#include "fileio.h"
+#include "iovec-util.h"
+#include "serialize.h"
+#include "socket-util.h"
+#include "stat-util.h"
+#include "tests.h"
+
+TEST(roundtrip) {
+        _cleanup_close_pair_ int pair[2] = EBADF_PAIR, pipe_fds[2] = EBADF_PAIR;
+        _cleanup_free_ char *log_levels = NULL, *log_target = NULL, *line = NULL;
+        _cleanup_fdset_free_ FDSet *fds = NULL;
+        _cleanup_fclose_ FILE *f = NULL, *g = NULL;
+        struct stat a, b;
+        int number;
+
+        ASSERT_OK_ERRNO(socketpair(AF_UNIX, SOCK_SEQPACKET|SOCK_CLOEXEC, 0, pair));
+        ASSERT_OK_ERRNO(pipe2(pipe_fds, O_CLOEXEC));
+
+        ASSERT_OK(open_serialization_file("test-executor-pool", &f));
+        ASSERT_OK(fputs("foo=bar\n", f));
+        ASSERT_OK(fflush_and_check(f));
+        ASSERT_OK_ERRNO(fseeko(f, 0, SEEK_SET));
+
+        /* Pass the read end of the pipe, under a number that differs from the one it'll be received as */
+        ASSERT_OK_ERRNO(fstat(pipe_fds[0], &a));
+        number = pipe_fds[0];
+        ASSERT_NOT_NULL(fds = fdset_new());
+        ASSERT_OK(fdset_consume(fds, TAKE_FD(pipe_fds[0])));
+
+        ASSERT_OK(executor_pool_send_invocation(pair[0], fileno(f), fds, "debug", "console"));
+        pair[0] = safe_close(pair[0]);
+        fds = fdset_free(fds);
+
+        ASSERT_EQ(executor_pool_receive_invocation(TAKE_FD(pair[1]), &g, &log_levels, &log_target), 1);
+        ASSERT_STREQ(log_levels, "debug");
+        ASSERT_STREQ(log_target, "console");
+
+        ASSERT_OK(read_line(g, LONG_LINE_MAX, &line));
+        ASSERT_STREQ(line, "foo=bar");
+
+        /* The fd is back under its old number, and inherited by children again */
+        ASSERT_OK_ERRNO(fstat(number, &b));
+        ASSERT_TRUE(stat_inode_same(&a, &b));
+        ASSERT_EQ(fcntl(number, F_GETFD), 0);
+        ASSERT_OK(fd_cloexec(number, true));
+        safe_close(number);
+}
+
+TEST(eof) {
+        _cleanup_close_pair_ int pair[2] = EBADF_PAIR;
+        _cleanup_free_ char *log_levels = NULL, *log_target = NULL;
+        FILE *f = NULL;
+
+        /* Closing the socket tells the executor to go away */
+        ASSERT_OK_ERRNO(socketpair(AF_UNIX, SOCK_SEQPACKET|SOCK_CLOEXEC, 0, pair));
+        pair[0] = safe_close(pair[0]);
+
+        ASSERT_EQ(executor_pool_receive_invocation(TAKE_FD(pair[1]), &f, &log_levels, &log_target), 0);
+        ASSERT_NULL(f);
+}
+
+TEST(invalid) {
+        _cleanup_close_ int fd = -EBADF;
+        FILE *f = NULL;
+
+        ASSERT_OK(fd = open("/dev/null", O_RDONLY|O_CLOEXEC));
+
+        FOREACH_STRING(text,
+                       "log-level=debug\n",                                     /* no target */
+                       "log-level=debug\nlog-target=console\nfd=17\n",          /* more fd= lines than fds */
+                       "log-level=debug\nlog-target=console\nfoo=bar\n") {      /* unknown field */
+                _cleanup_close_pair_ int pair[2] = EBADF_PAIR;
+                _cleanup_free_ char *log_levels = NULL, *log_target = NULL;
+
+                ASSERT_OK_ERRNO(socketpair(AF_UNIX, SOCK_SEQPACKET|SOCK_CLOEXEC, 0, pair));
+                ASSERT_OK(send_many_fds_iov(pair[0], &fd, 1, &IOVEC_MAKE_STRING(text), 1, 0));
+
+                ASSERT_ERROR(executor_pool_receive_invocation(TAKE_FD(pair[1]), &f, &log_levels, &log_target), EBADMSG);
+                ASSERT_NULL(f);
+        }
+}
+
+TEST(too_many_fds) {
+        _cleanup_close_pair_ int pair[2] = EBADF_PAIR;
+        _cleanup_fdset_free_ FDSet *fds = NULL;
+
+        ASSERT_OK_ERRNO(socketpair(AF_UNIX, SOCK_SEQPACKET|SOCK_CLOEXEC, 0, pair));
+        ASSERT_NOT_NULL(fds = fdset_new());
+
+        for (unsigned i = 0; i < EXECUTOR_POOL_FDS_MAX; i++)
+                ASSERT_OK(fdset_put_dup(fds, pair[1]));
+
+        /* These don't fit in one message together with the serialization fd */
+        ASSERT_ERROR(executor_pool_send_invocation(pair[0], pair[1], fds, "info", "console"), E2BIG);
+}
+
+DEFINE_TEST_MAIN(LOG_DEBUG);
@@ -13,6 +13,7 @@
 #include "fd-util.h"
 #include "fileio.h"
 #include "fs-util.h"
+#include "io-util.h"
 #include "iovec-util.h"
 #include "memfd-util.h"
 #include "parse-util.h"
@@ -1106,6 +1107,53 @@ TEST(read_virtual_file) {
         test_read_virtual_file_one(SIZE_MAX);
 }
 
+TEST(read_virtual_file_at_buffer) {
+        _cleanup_(unlink_tempfilep) char fn[] = "/tmp/test-read_virtual_file_at_buffer-XXXXXX";
+        _cleanup_free_ char *text = NULL, *buf = NULL, *cmdline = NULL;
+        _cleanup_close_ int fd = -EBADF;
+        size_t size, n_cmdline;
+
+        assert_se(text = new(char, 10000));
+        for (size_t i = 0; i < 10000; i++)
+                text[i] = i % 80 == 79 ? '\n' : 'a' + i % 26;
+
+        fd = mkostemp_safe(fn);
+        assert_se(fd >= 0);
+        assert_se(loop_write(fd, text, 10000) >= 0);
+
+        /* Start out with a tiny buffer, so that it needs to be grown */
+        assert_se(buf = malloc(2));
+
+        FOREACH_ELEMENT(max_size, ((const size_t[]) { 0, 1, 2, 20, 4096, 4097, 9999, 10000, 10001, SIZE_MAX })) {
+                size_t n = MIN(*max_size, 10000U);
+
+                log_info("/* %s (max_size=%zu) */", __func__, *max_size);
+
+                ASSERT_EQ(read_virtual_file_at_buffer(AT_FDCWD, fn, *max_size, &buf, &size), (int) (*max_size >= 10000));
+                ASSERT_EQ(size, n);
+                assert_se(memcmp(buf, text, n) == 0);
+                ASSERT_EQ(buf[n], 0);
+        }
+
+        /* Reads via the fd itself start at the beginning, regardless of the file offset */
+        ASSERT_EQ(read_virtual_file_at_buffer(fd, NULL, SIZE_MAX, &buf, &size), 1);
+        ASSERT_EQ(size, 10000U);
+        assert_se(memcmp(buf, text, size) == 0);
+        ASSERT_EQ(read_virtual_file_at_buffer(fd, NULL, SIZE_MAX, &buf, NULL), 1);
+        ASSERT_EQ(strlen(buf), 10000U);
+
+        ASSERT_ERROR(read_virtual_file_at_buffer(AT_FDCWD, NULL, SIZE_MAX, &buf, &size), EBADF);
+        ASSERT_ERROR(read_virtual_file_at_buffer(AT_FDCWD, "/proc/self/idontexist", SIZE_MAX, &buf, &size), ENOENT);
+
+        /* Contents with embedded NULs are refused if the size is not requested */
+        ASSERT_EQ(read_virtual_file("/proc/self/cmdline", SIZE_MAX, &cmdline, &n_cmdline), 1);
+        ASSERT_EQ(read_virtual_file_at_buffer(AT_FDCWD, "/proc/self/cmdline", SIZE_MAX, &buf, &size), 1);
+        ASSERT_EQ(size, n_cmdline);
+        assert_se(memcmp(buf, cmdline, size) == 0);
+        if (memchr(cmdline, 0, n_cmdline))
+                ASSERT_ERROR(read_virtual_file_at_buffer(AT_FDCWD, "/proc/self/cmdline", SIZE_MAX, &buf, NULL), EBADMSG);
+}
+
 TEST(fdopen_independent) {
 #define TEST_TEXT "this is some random test text we are going to write to a memfd"
         _cleanup_close_ int fd = -EBADF;
@@ -5,6 +5,7 @@
 #include "alloc-util.h"
 #include "format-table.h"
 #include "json-util.h"
+#include "memstream-util.h"
 #include "string-util.h"
 #include "strv.h"
 #include "tests.h"
@@ -662,6 +663,92 @@ TEST(table_bps) {
                   ));
 }
 
+static Table* stream_table_new(void) {
+        Table *t;
+
+        assert_se(t = table_new("name", "count"));
+        assert_se(table_set_align_percent(t, TABLE_HEADER_CELL(1), 100) >= 0);
+        table_set_width(t, 0);
+
+        return t;
+}
+
+static void stream_table_add(Table *t, unsigned n) {
+        for (unsigned i = 0; i < n; i++)
+                assert_se(table_add_many(t,
+                                         TABLE_STRING, i == n - 1 ? "a-very-long-last-name" : "name",
+                                         TABLE_UINT, i) >= 0);
+}
+
+TEST(stream) {
+        unsigned n;
+
+        FOREACH_STRING(mode, "text", "json", "json-pretty")
+                FOREACH_ARGUMENT(n, 0U, 2U, 5U) {
+                        _cleanup_(table_unrefp) Table *a = NULL, *b = NULL;
+                        _cleanup_(memstream_done) MemStream m = {};
+                        _cleanup_free_ char *x = NULL, *y = NULL;
+                        sd_json_format_flags_t flags;
+                        FILE *f;
+
+                        flags = streq(mode, "text") ? SD_JSON_FORMAT_OFF :
+                                streq(mode, "json") ? SD_JSON_FORMAT_NEWLINE : SD_JSON_FORMAT_PRETTY;
+
+                        /* With enough sample rows, the output is the same as when printed all at once */
+                        assert_se(a = stream_table_new());
+                        stream_table_add(a, n);
+                        assert_se(f = memstream_init(&m));
+                        assert_se(table_print_json(a, f, flags) >= 0);
+                        assert_se(memstream_finalize(&m, &x, NULL) >= 0);
+
+                        assert_se(b = stream_table_new());
+                        assert_se(f = memstream_init(&m));
+                        assert_se(table_stream_begin(b, f, flags, 5) >= 0);
+                        stream_table_add(b, n);
+                        assert_se(table_get_rows(b) == n + 1);
+                        assert_se(table_print_json(b, NULL, SD_JSON_FORMAT_OFF) >= 0);
+                        assert_se(memstream_finalize(&m, &y, NULL) >= 0);
+
+                        log_info("%s/%u:\n%s", mode, n, y);
+                        ASSERT_STREQ(x, y);
+                }
+}
+
+TEST(stream_sample) {
+        _cleanup_(table_unrefp) Table *t = NULL;
+        _cleanup_(memstream_done) MemStream m = {};
+        _cleanup_free_ char *formatted = NULL;
+        FILE *f;
+
+        /* Widths are only determined from the sampled rows, but in full width mode later rows are not
+         * truncated */
+        assert_se(t = stream_table_new());
+        assert_se(f = memstream_init(&m));
+        assert_se(table_stream_begin(t, f, SD_JSON_FORMAT_OFF, 2) >= 0);
+        assert_se(table_set_sort(t, (size_t) 0) == -EBUSY);
+        assert_se(table_hide_column_from_display(t, 1) == -EBUSY);
+        stream_table_add(t, 4);
+
+        /* Rows written out are dropped, except for the last one */
+        assert_se(table_get_rows(t) == 5);
+        assert_se(!table_get_cell(t, 1, 0));
+        assert_se(!table_get_cell(t, 2, 0));
+        assert_se(table_get_cell(t, 3, 0));
+        ASSERT_STREQ(table_get_at(t, 0, 0), "name");
+        ASSERT_STREQ(table_get_at(t, 4, 0), "a-very-long-last-name");
+
+        assert_se(table_print(t, NULL) >= 0);
+        assert_se(memstream_finalize(&m, &formatted, NULL) >= 0);
+
+        printf("%s", formatted);
+        ASSERT_STREQ(formatted,
+                     "NAME COUNT\n"
+                     "name     0\n"
+                     "name     1\n"
+                     "name     2\n"
+                     "a-very-long-last-name     3\n");
+}
+
 static int intro(void) {
         assert_se(setenv("SYSTEMD_COLORS", "0", 1) >= 0);
         assert_se(setenv("COLUMNS", "40", 1) >= 0);
@@ -0,0 +1,124 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "alloc-util.h"
+#include "fileio.h"
+#include "generator.h"
+#include "generator-cache.h"
+#include "mkdir.h"
+#include "path-util.h"
+#include "rm-rf.h"
+#include "string-util.h"
+#include "strv.h"
+#include "tests.h"
+#include "tmpfile-util.h"
+
+static void write_generator(const char *dir, const char *name, const char *declare) {
+        _cleanup_free_ char *p = NULL, *script = NULL;
+
+        /* Each run appends a line to <dir>/<name>.runs, and creates <name>.service in the normal output dir */
+        ASSERT_NOT_NULL(script = strjoin(
+                                "#!/bin/sh\n"
+                                "set -e\n"
+                                "echo run >>", dir, "/", name, ".runs\n",
+                                declare ? "printf '%s' '" : "",
+                                strempty(declare),
+                                declare ? "' >>\"$" GENERATOR_INPUTS_ENV "\"\n" : "",
+                                "touch \"$1/", name, ".service\"\n"));
+
+        ASSERT_NOT_NULL(p = path_join(dir, "gens", name));
+        ASSERT_OK(write_string_file(p, script, WRITE_STRING_FILE_CREATE|WRITE_STRING_FILE_MKDIR_0755));
+        ASSERT_OK_ERRNO(chmod(p, 0755));
+}
+
+static size_t runs(const char *dir, const char *name) {
+        _cleanup_free_ char *p = NULL, *c = NULL;
+
+        ASSERT_NOT_NULL(p = strjoin(dir, "/", name, ".runs"));
+        if (read_full_file(p, &c, NULL) == -ENOENT)
+                return 0;
+
+        return strlen(c) / STRLEN("run\n");
+}
+
+static void run_generators(const char *dir, char **output_dirs) {
+        _cleanup_free_ char *gens = NULL, *cache = NULL;
+
+        STRV_FOREACH(d, output_dirs) {
+                ASSERT_OK(rm_rf(*d, REMOVE_ROOT|REMOVE_PHYSICAL));
+                ASSERT_OK(mkdir_p(*d, 0755));
+        }
+
+        ASSERT_NOT_NULL(gens = path_join(dir, "gens"));
+        ASSERT_NOT_NULL(cache = path_join(dir, "cache"));
+
+        ASSERT_OK(generator_cache_execute(STRV_MAKE(gens), cache, output_dirs, /* env= */ NULL, USEC_PER_MINUTE));
+}
+
+TEST(generator_cache) {
+        _cleanup_(rm_rf_physical_and_freep) char *dir = NULL;
+        _cleanup_free_ char *input = NULL, *stamp = NULL, *cache = NULL, *unit = NULL;
+        _cleanup_strv_free_ char **output_dirs = NULL;
+        GeneratorResult *results = NULL;
+        size_t n_results = 0;
+
+        CLEANUP_ARRAY(results, n_results, generator_result_free_many);
+
+        if (access("/bin/sh", X_OK) < 0)
+                return (void) log_tests_skipped("/bin/sh is not available");
+
+        ASSERT_OK(mkdtemp_malloc("/tmp/test-generator-cache-XXXXXX", &dir));
+
+        ASSERT_NOT_NULL(input = path_join(dir, "input"));
+        ASSERT_OK(write_string_file(input, "foo", WRITE_STRING_FILE_CREATE));
+        ASSERT_OK(generator_stamp_file(&stamp, input));
+
+        write_generator(dir, "declaring", stamp);
+        write_generator(dir, "undeclared", NULL);
+
+        ASSERT_NOT_NULL(output_dirs = strv_new(
+                                        strjoina(dir, "/normal"),
+                                        strjoina(dir, "/early"),
+                                        strjoina(dir, "/late")));
+
+        /* The first time around, everything is run, and the output is merged */
+        run_generators(dir, output_dirs);
+        ASSERT_EQ(runs(dir, "declaring"), 1u);
+        ASSERT_EQ(runs(dir, "undeclared"), 1u);
+
+        ASSERT_NOT_NULL(unit = path_join(output_dirs[0], "declaring.service"));
+        ASSERT_OK_ERRNO(access(unit, F_OK));
+        unit = mfree(unit);
+        ASSERT_NOT_NULL(unit = path_join(output_dirs[0], "undeclared.service"));
+        ASSERT_OK_ERRNO(access(unit, F_OK));
+
+        /* Nothing changed, hence only the generator that didn't declare its inputs is run again, but the
+         * output of both is there */
+        run_generators(dir, output_dirs);
+        ASSERT_EQ(runs(dir, "declaring"), 1u);
+        ASSERT_EQ(runs(dir, "undeclared"), 2u);
+        ASSERT_OK_ERRNO(access(unit, F_OK));
+        unit = mfree(unit);
+        ASSERT_NOT_NULL(unit = path_join(output_dirs[0], "declaring.service"));
+        ASSERT_OK_ERRNO(access(unit, F_OK));
+
+        ASSERT_NOT_NULL(cache = path_join(dir, "cache"));
+        ASSERT_OK(generator_cache_load_results(cache, &results, &n_results));
+        ASSERT_EQ(n_results, 2u);
+        ASSERT_STREQ(results[0].name, "declaring");
+        ASSERT_TRUE(results[0].reused);
+        ASSERT_EQ(results[0].exit_status, 0);
+        ASSERT_STREQ(results[1].name, "undeclared");
+        ASSERT_FALSE(results[1].reused);
+
+        /* Changing the input makes it run again */
+        ASSERT_OK(write_string_file(input, "foobar", WRITE_STRING_FILE_TRUNCATE));
+        run_generators(dir, output_dirs);
+        ASSERT_EQ(runs(dir, "declaring"), 2u);
+        ASSERT_EQ(runs(dir, "undeclared"), 3u);
+        ASSERT_OK_ERRNO(access(unit, F_OK));
+}
+
+DEFINE_TEST_MAIN(LOG_DEBUG);
@@ -0,0 +1,178 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include "alloc-util.h"
+#include "hashmap.h"
+#include "parse-util.h"
+#include "set.h"
+#include "stdio-util.h"
+#include "string-util.h"
+#include "tests.h"
+#include "time-util.h"
+
+static unsigned arg_n_keys;
+
+typedef struct Keys {
+        const struct hash_ops *hash_ops;
+        void **keys;    /* the keys that are inserted */
+        void **lookups; /* equal to keys, but different objects for string keys */
+        void **misses;  /* keys that are never inserted */
+        char *buf;
+} Keys;
+
+static void keys_done(Keys *k) {
+        free(k->keys);
+        free(k->lookups);
+        free(k->misses);
+        free(k->buf);
+}
+
+static void keys_init(Keys *k, const char *type) {
+        size_t l = DECIMAL_STR_MAX(unsigned) + STRLEN("unit-.service");
+
+        *k = (Keys) {
+                .keys = new(void*, arg_n_keys),
+                .lookups = new(void*, arg_n_keys),
+                .misses = new(void*, arg_n_keys),
+        };
+        assert_se(k->keys && k->lookups && k->misses);
+
+        if (STR_IN_SET(type, "string", "string-trusted")) {
+                k->hash_ops = streq(type, "string") ? &string_hash_ops : &string_hash_ops_trusted;
+
+                /* Like unit names, which is what most of the large hashmaps are keyed by */
+                assert_se(k->buf = new(char, l * 3 * arg_n_keys));
+                for (unsigned i = 0; i < arg_n_keys; i++) {
+                        char *p = k->buf + l * 3 * i;
+
+                        assert_se(snprintf_ok(p, l, "unit-%u.service", i));
+                        assert_se(snprintf_ok(p + l, l, "unit-%u.service", i));
+                        assert_se(snprintf_ok(p + 2 * l, l, "unit-%u.socket", i));
+                        k->keys[i] = p;
+                        k->lookups[i] = p + l;
+                        k->misses[i] = p + 2 * l;
+                }
+        } else if (STR_IN_SET(type, "pointer", "pointer-trusted")) {
+                k->hash_ops = streq(type, "pointer") ? &trivial_hash_ops : &trivial_hash_ops_trusted;
+
+                /* Like pointers to objects, which is what sets are mostly made of */
+                assert_se(k->buf = new(char, 2 * arg_n_keys));
+                for (unsigned i = 0; i < arg_n_keys; i++) {
+                        k->keys[i] = k->lookups[i] = k->buf + i;
+                        k->misses[i] = k->buf + arg_n_keys + i;
+                }
+        } else
+                assert_not_reached();
+}
+
+static void report(const char *label, const char *type, const char *op, usec_t t) {
+        _cleanup_free_ char *scenario = NULL;
+
+        assert_se(scenario = strjoin(label, "/", type, "/", op));
+        benchmark_report(scenario, arg_n_keys, t);
+}
+
+#define TIME_OP(label, type, op, expr)                                  \
+        ({                                                              \
+                usec_t _n = now(CLOCK_MONOTONIC);                       \
+                expr;                                                   \
+                report(label, type, op, now(CLOCK_MONOTONIC) - _n);     \
+        })
+
+static void test_hashmap(const char *type, const Keys *k) {
+        _cleanup_hashmap_free_ Hashmap *h = NULL;
+        unsigned n = 0;
+        void *v;
+
+        assert_se(h = hashmap_new(k->hash_ops));
+
+        TIME_OP("hashmap", type, "insert",
+                for (unsigned i = 0; i < arg_n_keys; i++)
+                        assert_se(hashmap_put(h, k->keys[i], k->keys[i]) > 0));
+        TIME_OP("hashmap", type, "lookup",
+                for (unsigned i = 0; i < arg_n_keys; i++)
+                        assert_se(hashmap_get(h, k->lookups[i]) == k->keys[i]));
+        TIME_OP("hashmap", type, "miss",
+                for (unsigned i = 0; i < arg_n_keys; i++)
+                        assert_se(!hashmap_get(h, k->misses[i])));
+        TIME_OP("hashmap", type, "iterate",
+                HASHMAP_FOREACH(v, h)
+                        n++);
+        assert_se(n == arg_n_keys);
+        TIME_OP("hashmap", type, "remove",
+                for (unsigned i = 0; i < arg_n_keys; i++)
+                        assert_se(hashmap_remove(h, k->lookups[i]) == k->keys[i]));
+        assert_se(hashmap_isempty(h));
+}
+
+static void test_ordered_hashmap(const char *type, const Keys *k) {
+        _cleanup_ordered_hashmap_free_ OrderedHashmap *h = NULL;
+        unsigned n = 0;
+        void *v;
+
+        assert_se(h = ordered_hashmap_new(k->hash_ops));
+
+        TIME_OP("ordered_hashmap", type, "insert",
+                for (unsigned i = 0; i < arg_n_keys; i++)
+                        assert_se(ordered_hashmap_put(h, k->keys[i], k->keys[i]) > 0));
+        TIME_OP("ordered_hashmap", type, "lookup",
+                for (unsigned i = 0; i < arg_n_keys; i++)
+                        assert_se(ordered_hashmap_get(h, k->lookups[i]) == k->keys[i]));
+        TIME_OP("ordered_hashmap", type, "miss",
+                for (unsigned i = 0; i < arg_n_keys; i++)
+                        assert_se(!ordered_hashmap_get(h, k->misses[i])));
+        TIME_OP("ordered_hashmap", type, "iterate",
+                ORDERED_HASHMAP_FOREACH(v, h)
+                        assert_se(v == k->keys[n++]));
+        assert_se(n == arg_n_keys);
+        TIME_OP("ordered_hashmap", type, "remove",
+                for (unsigned i = 0; i < arg_n_keys; i++)
+                        assert_se(ordered_hashmap_remove(h, k->lookups[i]) == k->keys[i]));
+        assert_se(ordered_hashmap_isempty(h));
+}
+
+static void test_set(const char *type, const Keys *k) {
+        _cleanup_set_free_ Set *s = NULL;
+        unsigned n = 0;
+        void *v;
+
+        assert_se(s = set_new(k->hash_ops));
+
+        TIME_OP("set", type, "insert",
+                for (unsigned i = 0; i < arg_n_keys; i++)
+                        assert_se(set_put(s, k->keys[i]) > 0));
+        TIME_OP("set", type, "lookup",
+                for (unsigned i = 0; i < arg_n_keys; i++)
+                        assert_se(set_contains(s, k->lookups[i])));
+        TIME_OP("set", type, "miss",
+                for (unsigned i = 0; i < arg_n_keys; i++)
+                        assert_se(!set_contains(s, k->misses[i])));
+        TIME_OP("set", type, "iterate",
+                SET_FOREACH(v, s)
+                        n++);
+        assert_se(n == arg_n_keys);
+        TIME_OP("set", type, "remove",
+                for (unsigned i = 0; i < arg_n_keys; i++)
+                        assert_se(set_remove(s, k->lookups[i]) == k->keys[i]));
+        assert_se(set_isempty(s));
+}
+
+int main(int argc, char *argv[]) {
+        test_setup_logging(LOG_INFO);
+
+        if (argc >= 2)
+                assert_se(safe_atou(argv[1], &arg_n_keys) >= 0 && arg_n_keys > 0);
+        else
+                arg_n_keys = slow_tests_enabled() ? 1000000 : 10000;
+
+        FOREACH_STRING(type, "string", "string-trusted", "pointer", "pointer-trusted") {
+                _cleanup_(keys_done) Keys k = {};
+
+                keys_init(&k, type);
+
+                test_hashmap(type, &k);
+                test_ordered_hashmap(type, &k);
+                test_set(type, &k);
+        }
+
+        return 0;
+}
@@ -6,6 +6,7 @@
 #include "hexdecoct.h"
 #include "macro.h"
 #include "random-util.h"
+#include "simd-util.h"
 #include "string-util.h"
 #include "tests.h"
 
@@ -545,4 +546,120 @@ TEST(base64withwithouturl) {
          * --base64url to generate the correctly encoded base64 strings */
 }
 
+typedef struct Decoded {
+        int r;
+        void *data;
+        size_t size;
+} Decoded;
+
+static void decoded_done(Decoded *d) {
+        d->data = mfree(d->data);
+}
+
+static void decode_all(const char *s, size_t l, Decoded *ret_hex, Decoded *ret_base64) {
+        ret_hex->r = unhexmem_full(s, l, /* secure = */ false, &ret_hex->data, &ret_hex->size);
+        ret_base64->r = unbase64mem_full(s, l, /* secure = */ true, &ret_base64->data, &ret_base64->size);
+}
+
+static void assert_decoded_eq(const Decoded *a, const Decoded *b) {
+        ASSERT_EQ(a->r, b->r);
+        if (a->r >= 0) {
+                ASSERT_EQ(a->size, b->size);
+                assert_se(memcmp(a->data, b->data, a->size) == 0);
+        }
+}
+
+static void test_simd_decode_one(const char *s, size_t l) {
+        _cleanup_(decoded_done) Decoded hex = {}, base64 = {}, hex_scalar = {}, base64_scalar = {};
+        SimdLevel level = simd_level();
+
+        /* The vector code has to behave exactly like the scalar one, on errors too */
+        decode_all(s, l, &hex, &base64);
+
+        ASSERT_OK(simd_level_set(SIMD_NONE));
+        decode_all(s, l, &hex_scalar, &base64_scalar);
+        ASSERT_OK(simd_level_set(level));
+
+        assert_decoded_eq(&hex, &hex_scalar);
+        assert_decoded_eq(&base64, &base64_scalar);
+}
+
+static void test_simd_one(const uint8_t *data, size_t n) {
+        _cleanup_free_ char *hex = NULL, *base64 = NULL;
+        _cleanup_free_ void *mem = NULL;
+        size_t size, line_break;
+        ssize_t l;
+
+        assert_se(hex = hexmem(data, n));
+        ASSERT_EQ(strlen(hex), 2 * n);
+        for (size_t i = 0; i < n; i++) {
+                ASSERT_EQ(hex[2 * i], hexchar(data[i] >> 4));
+                ASSERT_EQ(hex[2 * i + 1], hexchar(data[i]));
+        }
+
+        ASSERT_OK(unhexmem(hex, &mem, &size));
+        ASSERT_EQ(size, n);
+        assert_se(memcmp_safe(mem, data, n) == 0);
+        mem = mfree(mem);
+
+        l = base64mem(data, n, &base64);
+        ASSERT_OK(l);
+        ASSERT_EQ((size_t) l, DIV_ROUND_UP(n, 3) * 4);
+
+        FOREACH_ARGUMENT(line_break, SIZE_MAX, 1, 16, 17, 64, 79) {
+                _cleanup_free_ char *b = NULL, *scalar = NULL;
+                SimdLevel level = simd_level();
+
+                ASSERT_OK(base64mem_full(data, n, line_break, &b));
+
+                ASSERT_OK(simd_level_set(SIMD_NONE));
+                ASSERT_OK(base64mem_full(data, n, line_break, &scalar));
+                ASSERT_OK(simd_level_set(level));
+                ASSERT_STREQ(b, scalar);
+
+                ASSERT_OK(unbase64mem(b, &mem, &size));
+                ASSERT_EQ(size, n);
+                assert_se(memcmp_safe(mem, data, n) == 0);
+                mem = mfree(mem);
+        }
+
+        /* Put something that is not part of the encoding, padding and whitespace at every position, and cut
+         * the string short there. Hex digits are valid base64 and vice versa for the letters, hence this
+         * covers valid input for the other decoder too. */
+        FOREACH_STRING(t, hex, base64) {
+                size_t k = strlen(t);
+
+                test_simd_decode_one(t, k);
+
+                for (size_t i = 0; i < k; i++) {
+                        _cleanup_free_ char *c = NULL;
+
+                        test_simd_decode_one(t, i);
+
+                        assert_se(c = strdup(t));
+                        FOREACH_STRING(x, "!", "=", " ", "\n", "\x80", "g", "_") {
+                                c[i] = x[0];
+                                test_simd_decode_one(c, k);
+                        }
+                        c[i] = t[i];
+                }
+        }
+}
+
+TEST(simd) {
+        uint8_t data[200];
+
+        random_bytes(data, sizeof(data));
+
+        for (SimdLevel level = 0; level <= simd_level_supported(); level++) {
+                log_info("SIMD level: %s", simd_level_to_string(level));
+                ASSERT_OK(simd_level_set(level));
+
+                for (size_t n = 0; n <= sizeof(data); n += n < 64 ? 1 : 17)
+                        test_simd_one(data, n);
+        }
+
+        ASSERT_OK(simd_level_set(simd_level_supported()));
+}
+
 DEFINE_TEST_MAIN(LOG_INFO);
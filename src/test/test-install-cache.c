@@ -0,0 +1,120 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <unistd.h>
+
+#include "fileio.h"
+#include "install-cache.h"
+#include "mkdir.h"
+#include "rm-rf.h"
+#include "string-util.h"
+#include "tests.h"
+#include "tmpfile-util.h"
+
+static char *root = NULL;
+
+STATIC_DESTRUCTOR_REGISTER(root, rm_rf_physical_and_freep);
+
+static UnitFileState get_state(InstallCache *c, const char *name) {
+        UnitFileState state;
+
+        ASSERT_OK(install_cache_get_state(c, name, &state));
+        return state;
+}
+
+TEST(get_state) {
+        _cleanup_(install_cache_freep) InstallCache *c = NULL;
+        InstallChange *changes = NULL;
+        size_t n_changes = 0;
+        const char *p;
+
+        ASSERT_OK(install_cache_new(RUNTIME_SCOPE_SYSTEM, root, &c));
+
+        /* Twice, the second time around from the cache */
+        ASSERT_ERROR(install_cache_get_state(c, "a.service", NULL), ENOENT);
+        ASSERT_ERROR(install_cache_get_state(c, "a.service", NULL), ENOENT);
+
+        p = strjoina(root, "/usr/lib/systemd/system/a.service");
+        ASSERT_OK(write_string_file(p,
+                                    "[Install]\n"
+                                    "WantedBy=multi-user.target\n", WRITE_STRING_FILE_CREATE));
+
+        ASSERT_EQ(get_state(c, "a.service"), UNIT_FILE_DISABLED);
+        ASSERT_EQ(get_state(c, "a.service"), UNIT_FILE_DISABLED);
+
+        /* Creates the .wants/ directory, too */
+        ASSERT_OK(unit_file_enable(RUNTIME_SCOPE_SYSTEM, 0, root, STRV_MAKE("a.service"), &changes, &n_changes));
+        install_changes_free(changes, n_changes);
+        changes = NULL; n_changes = 0;
+
+        ASSERT_EQ(get_state(c, "a.service"), UNIT_FILE_ENABLED);
+
+        /* Only changes a symlink in the .wants/ directory */
+        ASSERT_OK(unit_file_disable(RUNTIME_SCOPE_SYSTEM, 0, root, STRV_MAKE("a.service"), &changes, &n_changes));
+        install_changes_free(changes, n_changes);
+        changes = NULL; n_changes = 0;
+
+        ASSERT_EQ(get_state(c, "a.service"), UNIT_FILE_DISABLED);
+
+        /* In a directory of the search path that doesn't exist yet */
+        p = strjoina(root, "/etc/systemd/system.control/b.service");
+        ASSERT_OK(write_string_file(p, "[Unit]\n", WRITE_STRING_FILE_CREATE|WRITE_STRING_FILE_MKDIR_0755));
+
+        ASSERT_EQ(get_state(c, "b.service"), UNIT_FILE_STATIC);
+
+        ASSERT_OK_ERRNO(unlink(p));
+        ASSERT_ERROR(install_cache_get_state(c, "b.service", NULL), ENOENT);
+
+        install_cache_flush(c);
+        ASSERT_EQ(get_state(c, "a.service"), UNIT_FILE_DISABLED);
+}
+
+TEST(get_list) {
+        _cleanup_(install_cache_freep) InstallCache *c = NULL;
+        UnitFileList *item;
+        Hashmap *h;
+        const char *p;
+
+        ASSERT_OK(install_cache_new(RUNTIME_SCOPE_SYSTEM, root, &c));
+
+        ASSERT_OK(install_cache_get_list(c, &h));
+        ASSERT_NOT_NULL(item = hashmap_get(h, "multi-user.target"));
+        ASSERT_EQ(item->state, UNIT_FILE_STATIC);
+        ASSERT_NULL(hashmap_get(h, "c.service"));
+
+        /* The list answers state queries, too */
+        ASSERT_EQ(get_state(c, "multi-user.target"), UNIT_FILE_STATIC);
+
+        p = strjoina(root, "/usr/lib/systemd/system/c.service");
+        ASSERT_OK(write_string_file(p,
+                                    "[Install]\n"
+                                    "WantedBy=multi-user.target\n", WRITE_STRING_FILE_CREATE));
+
+        ASSERT_OK(install_cache_get_list(c, &h));
+        ASSERT_NOT_NULL(item = hashmap_get(h, "c.service"));
+        ASSERT_EQ(item->state, UNIT_FILE_DISABLED);
+        ASSERT_NOT_NULL(hashmap_get(h, "multi-user.target"));
+
+        ASSERT_EQ(get_state(c, "c.service"), UNIT_FILE_DISABLED);
+}
+
+static int intro(void) {
+        const char *p;
+
+        ASSERT_OK(mkdtemp_malloc("/tmp/test-install-cache-XXXXXX", &root));
+
+        p = strjoina(root, "/usr/lib/systemd/system/");
+        ASSERT_OK(mkdir_p(p, 0755));
+
+        p = strjoina(root, SYSTEM_CONFIG_UNIT_DIR"/");
+        ASSERT_OK(mkdir_p(p, 0755));
+
+        p = strjoina(root, "/run/systemd/system/");
+        ASSERT_OK(mkdir_p(p, 0755));
+
+        p = strjoina(root, "/usr/lib/systemd/system/multi-user.target");
+        ASSERT_OK(write_string_file(p, "# pretty much empty", WRITE_STRING_FILE_CREATE));
+
+        return EXIT_SUCCESS;
+}
+
+DEFINE_TEST_MAIN_WITH_INTRO(LOG_INFO, intro);
@@ -821,6 +821,43 @@ TEST(preset_order) {
         assert_se(unit_file_get_state(RUNTIME_SCOPE_SYSTEM, root, "prefix-2.service", &state) >= 0 && state == UNIT_FILE_DISABLED);
 }
 
+TEST(preset_query) {
+        _cleanup_(unit_file_presets_done) UnitFilePresets presets = {};
+        const char *p;
+
+        p = strjoina(root, "/usr/lib/systemd/system-preset/10-query.preset");
+        ASSERT_OK(write_string_file(p,
+                                    "disable query-1.service\n"
+                                    "enable query-1.service\n"
+                                    "ignore query-[23].service\n"
+                                    "enable query-3.service\n"
+                                    "disable query-4.service\n"
+                                    "disable query-inst@.service foo\n"
+                                    "enable query-inst@.service\n"
+                                    "enable query-*.service\n"
+                                    "disable query-5.service\n"
+                                    "disable query-?.socket\n"
+                                    "enable query-*.socket\n",
+                                    WRITE_STRING_FILE_CREATE|WRITE_STRING_FILE_MKDIR_0755));
+
+        /* The first matching rule wins, regardless of whether it is a glob or not */
+        ASSERT_EQ(unit_file_query_preset(RUNTIME_SCOPE_SYSTEM, root, "query-1.service", &presets), PRESET_DISABLE);
+        ASSERT_TRUE(presets.initialized);
+        ASSERT_EQ(unit_file_query_preset(RUNTIME_SCOPE_SYSTEM, root, "query-2.service", &presets), PRESET_IGNORE);
+        ASSERT_EQ(unit_file_query_preset(RUNTIME_SCOPE_SYSTEM, root, "query-3.service", &presets), PRESET_IGNORE);
+        ASSERT_EQ(unit_file_query_preset(RUNTIME_SCOPE_SYSTEM, root, "query-4.service", &presets), PRESET_DISABLE);
+        ASSERT_EQ(unit_file_query_preset(RUNTIME_SCOPE_SYSTEM, root, "query-5.service", &presets), PRESET_ENABLE);
+        ASSERT_EQ(unit_file_query_preset(RUNTIME_SCOPE_SYSTEM, root, "query-6.service", &presets), PRESET_ENABLE);
+        ASSERT_EQ(unit_file_query_preset(RUNTIME_SCOPE_SYSTEM, root, "query-1.socket", &presets), PRESET_DISABLE);
+        ASSERT_EQ(unit_file_query_preset(RUNTIME_SCOPE_SYSTEM, root, "query-10.socket", &presets), PRESET_ENABLE);
+
+        /* Without asking for instances, rules with instances only match the template itself */
+        ASSERT_EQ(unit_file_query_preset(RUNTIME_SCOPE_SYSTEM, root, "query-inst@.service", &presets), PRESET_DISABLE);
+        ASSERT_EQ(unit_file_query_preset(RUNTIME_SCOPE_SYSTEM, root, "query-inst@foo.service", &presets), PRESET_ENABLE);
+
+        ASSERT_OK_ERRNO(unlink(p));
+}
+
 TEST(static_instance) {
         UnitFileState state;
         const char *p;
@@ -5,11 +5,14 @@
 #include <fcntl.h>
 
 #include "alloc-util.h"
+#include "compress.h"
 #include "log.h"
+#include "journal-export-binary.h"
 #include "journal-importer.h"
 #include "path-util.h"
 #include "string-util.h"
 #include "tests.h"
+#include "unaligned.h"
 
 static void assert_iovec_entry(const struct iovec *iovec, const char* content) {
         assert_se(strlen(content) == iovec->iov_len);
@@ -68,4 +71,158 @@ TEST(bad_input) {
         assert_se(journal_importer_eof(&imp));
 }
 
+TEST(push_data) {
+        _cleanup_(journal_importer_cleanup) JournalImporter imp = JOURNAL_IMPORTER_INIT(STDIN_FILENO);
+        static const char data[] =
+                "MESSAGE=foo\n"
+                "BINARY\n" "\x03\x00\x00\x00\x00\x00\x00\x00" "a\nb" "\n"
+                "\n"
+                "MESSAGE=bar\n"
+                "\n";
+        struct iovec *iovec;
+        int r;
+
+        imp.passive_fd = true;
+        ASSERT_OK(journal_importer_push_data(&imp, data, sizeof(data) - 1));
+
+        while ((r = journal_importer_process_data(&imp)) == 0)
+                ;
+        ASSERT_EQ(r, 1);
+        ASSERT_EQ(imp.iovw.count, 2u);
+        assert_iovec_entry(&imp.iovw.iovec[0], "MESSAGE=foo");
+        assert_iovec_entry(&imp.iovw.iovec[1], "BINARY=a\nb");
+
+        /* The iovec array is reused for the next entry, and the size of the entry is remembered */
+        iovec = imp.iovw.iovec;
+        journal_importer_drop_iovw(&imp);
+        ASSERT_EQ(imp.iovw.count, 0u);
+        ASSERT_TRUE(imp.iovw.iovec == iovec);
+        ASSERT_EQ(imp.entry_size, strlen("MESSAGE=foo\n" "BINARY\n") + 8 + strlen("a\nb\n\n"));
+
+        while ((r = journal_importer_process_data(&imp)) == 0)
+                ;
+        ASSERT_EQ(r, 1);
+        ASSERT_EQ(imp.iovw.count, 1u);
+        ASSERT_TRUE(imp.iovw.iovec == iovec);
+        assert_iovec_entry(&imp.iovw.iovec[0], "MESSAGE=bar");
+        journal_importer_drop_iovw(&imp);
+
+        /* A smaller entry lets the estimate decay only slowly */
+        ASSERT_EQ(imp.entry_size, (size_t) 30);
+
+        ASSERT_ERROR(journal_importer_process_data(&imp), EAGAIN);
+        ASSERT_EQ(journal_importer_bytes_remaining(&imp), (size_t) 0);
+}
+
+/* Two entries in the binary export format: the first one introduces the field names, the second one refers
+ * to them by their index */
+#define BINARY_HEADER                                                   \
+        JOURNAL_EXPORT_BINARY_HEADER "\x04\x00\x00\x00" "\x01\x00\x00\x00"
+#define BINARY_ENTRIES                                                  \
+        JOURNAL_EXPORT_BINARY_ENTRY "\x27\x00\x00\x00" "\x02\x00\x00\x00" \
+        "\xff\xff" "\x07\x00" "MESSAGE" "\x03\x00\x00\x00" "foo"        \
+        "\xff\xff" "\x06\x00" "BINARY" "\x03\x00\x00\x00" "a\nb"        \
+        JOURNAL_EXPORT_BINARY_ENTRY "\x13\x00\x00\x00" "\x02\x00\x00\x00" \
+        "\x00\x00" "\x03\x00\x00\x00" "bar"                             \
+        "\x01\x00" "\x00\x00\x00\x00"
+
+static void assert_binary_entries(JournalImporter *imp) {
+        int r;
+
+        while ((r = journal_importer_process_data(imp)) == 0)
+                ;
+        ASSERT_EQ(r, 1);
+        ASSERT_EQ(imp->iovw.count, 2u);
+        assert_iovec_entry(&imp->iovw.iovec[0], "MESSAGE=foo");
+        assert_iovec_entry(&imp->iovw.iovec[1], "BINARY=a\nb");
+        journal_importer_drop_iovw(imp);
+
+        while ((r = journal_importer_process_data(imp)) == 0)
+                ;
+        ASSERT_EQ(r, 1);
+        ASSERT_EQ(imp->iovw.count, 2u);
+        assert_iovec_entry(&imp->iovw.iovec[0], "MESSAGE=bar");
+        assert_iovec_entry(&imp->iovw.iovec[1], "BINARY=");
+        journal_importer_drop_iovw(imp);
+
+        ASSERT_ERROR(journal_importer_process_data(imp), EAGAIN);
+        ASSERT_EQ(journal_importer_bytes_remaining(imp), (size_t) 0);
+}
+
+TEST(binary) {
+        _cleanup_(journal_importer_cleanup) JournalImporter imp = JOURNAL_IMPORTER_INIT(STDIN_FILENO);
+        static const char data[] = BINARY_HEADER BINARY_ENTRIES;
+
+        imp.passive_fd = true;
+        ASSERT_OK(journal_importer_push_data(&imp, data, sizeof(data) - 1));
+        assert_binary_entries(&imp);
+}
+
+TEST(binary_partial) {
+        _cleanup_(journal_importer_cleanup) JournalImporter imp = JOURNAL_IMPORTER_INIT(STDIN_FILENO);
+        static const char data[] = BINARY_HEADER BINARY_ENTRIES;
+        size_t n = 0;
+        int r;
+
+        imp.passive_fd = true;
+
+        /* Blocks split up at any point are put together again */
+        for (size_t i = 0; i < sizeof(data) - 1; i++) {
+                ASSERT_OK(journal_importer_push_data(&imp, data + i, 1));
+
+                while ((r = journal_importer_process_data(&imp)) == 0)
+                        ;
+                if (r == -EAGAIN)
+                        continue;
+
+                ASSERT_EQ(r, 1);
+                ASSERT_EQ(imp.iovw.count, 2u);
+                assert_iovec_entry(&imp.iovw.iovec[0], n == 0 ? "MESSAGE=foo" : "MESSAGE=bar");
+                journal_importer_drop_iovw(&imp);
+                n++;
+        }
+
+        ASSERT_EQ(n, 2u);
+        ASSERT_EQ(journal_importer_bytes_remaining(&imp), (size_t) 0);
+}
+
+TEST(binary_bad_input) {
+        _cleanup_(journal_importer_cleanup) JournalImporter imp = JOURNAL_IMPORTER_INIT(STDIN_FILENO);
+        static const char data[] =
+                BINARY_HEADER
+                /* Refers to a field name that was never introduced */
+                JOURNAL_EXPORT_BINARY_ENTRY "\x0d\x00\x00\x00" "\x01\x00\x00\x00"
+                "\x05\x00" "\x03\x00\x00\x00" "foo";
+        int r;
+
+        imp.passive_fd = true;
+        ASSERT_OK(journal_importer_push_data(&imp, data, sizeof(data) - 1));
+
+        while ((r = journal_importer_process_data(&imp)) == 0)
+                ;
+        ASSERT_ERROR(r, EBADMSG);
+}
+
+TEST(binary_batch) {
+        _cleanup_(journal_importer_cleanup) JournalImporter imp = JOURNAL_IMPORTER_INIT(STDIN_FILENO);
+        static const char header[] = BINARY_HEADER, entries[] = BINARY_ENTRIES;
+        char compressed[sizeof(entries) + 256];
+        uint8_t block[JOURNAL_EXPORT_BINARY_BLOCK_HEADER_SIZE];
+        size_t size;
+
+        if (!compression_supported(COMPRESSION_ZSTD))
+                return (void) log_tests_skipped("zstd support is not compiled in");
+
+        ASSERT_OK(compress_blob_zstd(entries, sizeof(entries) - 1, compressed, sizeof(compressed), &size));
+
+        memcpy(block, JOURNAL_EXPORT_BINARY_ZSTD, JOURNAL_EXPORT_BINARY_TYPE_SIZE);
+        unaligned_write_le32(block + JOURNAL_EXPORT_BINARY_TYPE_SIZE, size);
+
+        imp.passive_fd = true;
+        ASSERT_OK(journal_importer_push_data(&imp, header, sizeof(header) - 1));
+        ASSERT_OK(journal_importer_push_data(&imp, (const char*) block, sizeof(block)));
+        ASSERT_OK(journal_importer_push_data(&imp, compressed, size));
+        assert_binary_entries(&imp);
+}
+
 DEFINE_TEST_MAIN(LOG_DEBUG);
@@ -0,0 +1,122 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include "sd-json.h"
+
+#include "alloc-util.h"
+#include "json-binary.h"
+#include "json-util.h"
+#include "tests.h"
+
+static void test_roundtrip_one(const char *text) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL, *w = NULL;
+        _cleanup_free_ uint8_t *b = NULL;
+        _cleanup_free_ char *t = NULL;
+        size_t n;
+
+        ASSERT_OK(sd_json_parse(text, 0, &v, NULL, NULL));
+        ASSERT_OK(json_variant_format_binary(v, &b, &n));
+        ASSERT_GT(n, 0u);
+
+        ASSERT_OK(json_variant_parse_binary(b, n, &w));
+        ASSERT_TRUE(sd_json_variant_equal(v, w));
+
+        ASSERT_OK(sd_json_variant_format(w, 0, &t));
+        log_debug("%s → %zu bytes → %s", text, n, t);
+
+        /* Every truncation of the encoding must be refused */
+        for (size_t i = 0; i < n; i++) {
+                _cleanup_(sd_json_variant_unrefp) sd_json_variant *x = NULL;
+
+                ASSERT_ERROR(json_variant_parse_binary(b, i, &x), EBADMSG);
+        }
+}
+
+TEST(roundtrip) {
+        test_roundtrip_one("null");
+        test_roundtrip_one("true");
+        test_roundtrip_one("false");
+        test_roundtrip_one("0");
+        test_roundtrip_one("127");
+        test_roundtrip_one("128");
+        test_roundtrip_one("-1");
+        test_roundtrip_one("-9223372036854775808");
+        test_roundtrip_one("9223372036854775807");
+        test_roundtrip_one("18446744073709551615");
+        test_roundtrip_one("0.5");
+        test_roundtrip_one("-1e300");
+        test_roundtrip_one("\"\"");
+        test_roundtrip_one("\"zażółć gęślą jaźń\"");
+        test_roundtrip_one("[]");
+        test_roundtrip_one("{}");
+        test_roundtrip_one("[1,[2,[3,[]]],{\"a\":{}}]");
+        test_roundtrip_one("{\"method\":\"io.systemd.ManagedOOM.ReportManagedOOMCGroups\","
+                           "\"parameters\":{\"cgroups\":[{\"mode\":\"auto\",\"path\":\"/system.slice\",\"property\":\"ManagedOOMSwap\",\"limit\":0}]},"
+                           "\"more\":true}");
+}
+
+TEST(append) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *a = NULL, *b = NULL, *x = NULL;
+        _cleanup_free_ uint8_t *buf = NULL;
+        size_t n = 0, n_a;
+
+        /* Appending must leave what is in the buffer already alone */
+        ASSERT_OK(sd_json_build(&a, SD_JSON_BUILD_OBJECT(SD_JSON_BUILD_PAIR_STRING("foo", "bar"))));
+        ASSERT_OK(sd_json_build(&b, SD_JSON_BUILD_ARRAY(SD_JSON_BUILD_INTEGER(-5), SD_JSON_BUILD_REAL(1.5))));
+
+        ASSERT_OK(json_variant_append_binary(a, &buf, &n));
+        n_a = n;
+        ASSERT_OK(json_variant_append_binary(b, &buf, &n));
+        ASSERT_GT(n, n_a);
+
+        ASSERT_OK(json_variant_parse_binary(buf, n_a, &x));
+        ASSERT_TRUE(sd_json_variant_equal(a, x));
+        x = sd_json_variant_unref(x);
+
+        ASSERT_OK(json_variant_parse_binary(buf + n_a, n - n_a, &x));
+        ASSERT_TRUE(sd_json_variant_equal(b, x));
+        x = sd_json_variant_unref(x);
+
+        /* But both at once is trailing garbage */
+        ASSERT_ERROR(json_variant_parse_binary(buf, n, &x), EBADMSG);
+}
+
+TEST(invalid) {
+        sd_json_variant *v = NULL;
+
+        /* Unknown tag */
+        ASSERT_ERROR(json_variant_parse_binary((const uint8_t[]) { 0x42 }, 1, &v), EBADMSG);
+        /* Overlong varint */
+        ASSERT_ERROR(json_variant_parse_binary((const uint8_t[]) { 3, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x7f }, 11, &v), EBADMSG);
+        /* Negative number out of range */
+        ASSERT_ERROR(json_variant_parse_binary((const uint8_t[]) { 4, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x01 }, 11, &v), EBADMSG);
+        /* String with embedded NUL, and with invalid UTF-8 */
+        ASSERT_ERROR(json_variant_parse_binary((const uint8_t[]) { 6, 2, 'a', 0 }, 4, &v), EBADMSG);
+        ASSERT_LT(json_variant_parse_binary((const uint8_t[]) { 6, 2, 'a', 0xff }, 4, &v), 0);
+        /* Array and object claiming more elements than there is data */
+        ASSERT_ERROR(json_variant_parse_binary((const uint8_t[]) { 7, 0xff, 0xff, 0xff, 0xff, 0x0f, 0 }, 7, &v), EBADMSG);
+        ASSERT_ERROR(json_variant_parse_binary((const uint8_t[]) { 8, 2, 1, 'a', 0 }, 5, &v), EBADMSG);
+        /* Object key that is not valid UTF-8 */
+        ASSERT_LT(json_variant_parse_binary((const uint8_t[]) { 8, 1, 1, 0xfe, 0 }, 5, &v), 0);
+
+        ASSERT_NULL(v);
+}
+
+TEST(depth) {
+        _cleanup_free_ uint8_t *b = NULL;
+        sd_json_variant *v = NULL;
+        size_t n = 10000;
+
+        /* Deeply nested arrays are refused, rather than overflowing the stack */
+        b = new(uint8_t, n * 2);
+        ASSERT_NOT_NULL(b);
+
+        for (size_t i = 0; i < n; i++) {
+                b[2*i] = 7;
+                b[2*i+1] = i == n - 1 ? 0 : 1;
+        }
+
+        ASSERT_ERROR(json_variant_parse_binary(b, n * 2, &v), ELNRNG);
+        ASSERT_NULL(v);
+}
+
+DEFINE_TEST_MAIN(LOG_DEBUG);
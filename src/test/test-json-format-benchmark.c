@@ -0,0 +1,172 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include "sd-json.h"
+
+#include "alloc-util.h"
+#include "parse-util.h"
+#include "stdio-util.h"
+#include "string-util.h"
+#include "tests.h"
+#include "time-util.h"
+#include "utf8.h"
+
+#define BUF_SIZE (64*1024LU)
+
+static usec_t arg_duration;
+
+static char* make_buf(const char *type) {
+        static const char *const words[] = { "zażółć", "gęślą", "jaźń", "Ünïcödé", "ascii", "≠", "🙂" };
+        char *buf, *p;
+
+        buf = malloc(BUF_SIZE + 1);
+        assert_se(buf);
+
+        if (streq(type, "ascii"))
+                for (size_t i = 0; i < BUF_SIZE; i++)
+                        buf[i] = 'a' + i % ('z' - 'a' + 1);
+        else if (streq(type, "utf8")) {
+                /* Mostly multi-byte characters, separated by spaces */
+                p = buf;
+                for (size_t i = 0;; i++) {
+                        const char *w = words[i % ELEMENTSOF(words)];
+
+                        if ((size_t) (p - buf) + strlen(w) + 1 > BUF_SIZE)
+                                break;
+
+                        p = stpcpy(stpcpy(p, w), " ");
+                }
+                memset(p, ' ', BUF_SIZE - (p - buf));
+        } else if (streq(type, "escaped"))
+                /* Every 16th character needs escaping */
+                for (size_t i = 0; i < BUF_SIZE; i++)
+                        buf[i] = i % 16 == 15 ? '"' : 'a' + i % ('z' - 'a' + 1);
+        else
+                assert_not_reached();
+
+        buf[BUF_SIZE] = 0;
+        return buf;
+}
+
+static bool utf8_is_valid_bytewise(const char *s, size_t n) {
+        /* The plain loop over all characters, to compare against */
+        for (size_t i = 0; i < n; ) {
+                int len;
+
+                len = utf8_encoded_valid_unichar(s + i, n - i);
+                if (len < 0)
+                        return false;
+
+                i += len;
+        }
+
+        return true;
+}
+
+static void report(const char *label, const char *type, size_t total, usec_t t) {
+        _cleanup_free_ char *scenario = NULL;
+
+        /* The count is in bytes here */
+        assert_se(scenario = strjoin(label, "/", type));
+        benchmark_report(scenario, total, t);
+}
+
+static void test_utf8_is_valid(const char *type, const char *buf) {
+        size_t total, total_bytewise;
+        usec_t n, t = 0, t_bytewise = 0;
+
+        n = now(CLOCK_MONOTONIC);
+        for (total = 0; t < arg_duration; total += BUF_SIZE, t = now(CLOCK_MONOTONIC) - n)
+                assert_se(utf8_is_valid_n(buf, BUF_SIZE));
+
+        n = now(CLOCK_MONOTONIC);
+        for (total_bytewise = 0; t_bytewise < arg_duration; total_bytewise += BUF_SIZE, t_bytewise = now(CLOCK_MONOTONIC) - n)
+                assert_se(utf8_is_valid_bytewise(buf, BUF_SIZE));
+
+        report("utf8_is_valid_n", type, total, t);
+        report("bytewise", type, total_bytewise, t_bytewise);
+}
+
+static void test_json_format(const char *type, const char *buf) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        size_t total;
+        usec_t n, t = 0;
+
+        assert_se(sd_json_variant_new_string(&v, buf) >= 0);
+
+        n = now(CLOCK_MONOTONIC);
+        for (total = 0; t < arg_duration; total += BUF_SIZE, t = now(CLOCK_MONOTONIC) - n) {
+                _cleanup_free_ char *s = NULL;
+
+                assert_se(sd_json_variant_format(v, 0, &s) >= 0);
+                assert_se(strlen(s) >= BUF_SIZE + 2);
+        }
+
+        report("sd_json_variant_format", type, total, t);
+}
+
+static void test_json_document(void) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        _cleanup_free_ char *text = NULL;
+        usec_t n, t = 0;
+        uint64_t k;
+
+        /* A structured document, like the output of "systemctl list-units --output=json" */
+        for (unsigned i = 0; i < 1000; i++) {
+                char unit[DECIMAL_STR_MAX(unsigned) + STRLEN("unit-.service")];
+
+                xsprintf(unit, "unit-%u.service", i);
+                assert_se(sd_json_variant_append_arraybo(
+                                          &v,
+                                          SD_JSON_BUILD_PAIR("unit", SD_JSON_BUILD_STRING(unit)),
+                                          SD_JSON_BUILD_PAIR("load", SD_JSON_BUILD_STRING("loaded")),
+                                          SD_JSON_BUILD_PAIR("active", SD_JSON_BUILD_STRING(i % 3 == 0 ? "inactive" : "active")),
+                                          SD_JSON_BUILD_PAIR("sub", SD_JSON_BUILD_STRING(i % 3 == 0 ? "dead" : "running")),
+                                          SD_JSON_BUILD_PAIR("description", SD_JSON_BUILD_STRING("A service with a \"quoted\" description")),
+                                          SD_JSON_BUILD_PAIR("pid", SD_JSON_BUILD_UNSIGNED(1000 + i)),
+                                          SD_JSON_BUILD_PAIR("memory", SD_JSON_BUILD_UNSIGNED(UINT64_C(4096) * i)),
+                                          SD_JSON_BUILD_PAIR("cpuUsage", SD_JSON_BUILD_REAL(i / 7.)),
+                                          SD_JSON_BUILD_PAIR("following", SD_JSON_BUILD_NULL)) >= 0);
+        }
+
+        assert_se(sd_json_variant_format(v, 0, &text) >= 0);
+
+        n = now(CLOCK_MONOTONIC);
+        for (k = 0; t < arg_duration; k++, t = now(CLOCK_MONOTONIC) - n) {
+                _cleanup_(sd_json_variant_unrefp) sd_json_variant *w = NULL;
+
+                assert_se(sd_json_parse(text, 0, &w, NULL, NULL) >= 0);
+        }
+        benchmark_report("sd_json_parse/document", k, t);
+
+        n = now(CLOCK_MONOTONIC);
+        for (k = 0, t = 0; t < arg_duration; k++, t = now(CLOCK_MONOTONIC) - n) {
+                _cleanup_free_ char *f = NULL;
+
+                assert_se(sd_json_variant_format(v, 0, &f) >= 0);
+        }
+        benchmark_report("sd_json_variant_format/document", k, t);
+}
+
+int main(int argc, char *argv[]) {
+        test_setup_logging(LOG_INFO);
+
+        if (argc >= 2) {
+                unsigned x;
+
+                assert_se(safe_atou(argv[1], &x) >= 0);
+                arg_duration = x * USEC_PER_SEC;
+        } else
+                arg_duration = slow_tests_enabled() ?
+                        2 * USEC_PER_SEC : USEC_PER_SEC / 50;
+
+        FOREACH_STRING(type, "ascii", "utf8", "escaped") {
+                _cleanup_free_ char *buf = make_buf(type);
+
+                test_utf8_is_valid(type, buf);
+                test_json_format(type, buf);
+        }
+
+        test_json_document();
+
+        return 0;
+}
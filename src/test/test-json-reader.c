@@ -0,0 +1,380 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <stdio.h>
+
+#include "sd-json.h"
+
+#include "alloc-util.h"
+#include "fd-util.h"
+#include "fileio.h"
+#include "json-reader.h"
+#include "json-util.h"
+#include "string-util.h"
+#include "strv.h"
+#include "tests.h"
+
+static const char *json_input =
+        "{ \"name\" : \"f\\u00e4\\\"o\", \"numbers\" : [ 1, -2, 3.5, 18446744073709551615 ],\n"
+        "  \"flags\" : [ true, false, null ], \"empty\" : {}, \"nested\" : [[], [{\"x\": 0}]] }";
+
+/* Turns the token stream into a string, so that it is easy to compare */
+static int describe_token(JsonReader *r, int token, char **s) {
+        _cleanup_free_ char *v = NULL;
+
+        switch (token) {
+
+        case JSON_READER_END:
+                return 0;
+
+        case JSON_READER_OBJECT_START:
+                return strextend(s, "{") ? 1 : -ENOMEM;
+
+        case JSON_READER_OBJECT_END:
+                return strextend(s, "}") ? 1 : -ENOMEM;
+
+        case JSON_READER_ARRAY_START:
+                return strextend(s, "[") ? 1 : -ENOMEM;
+
+        case JSON_READER_ARRAY_END:
+                return strextend(s, "]") ? 1 : -ENOMEM;
+
+        case JSON_READER_KEY:
+                return strextend(s, "K(", json_reader_key(r), ")") ? 1 : -ENOMEM;
+
+        case JSON_READER_VALUE:
+                ASSERT_OK(sd_json_variant_format(json_reader_value(r), 0, &v));
+                return strextend(s, "V(", v, ")") ? 1 : -ENOMEM;
+
+        default:
+                ASSERT_LT(token, 0);
+                return token;
+        }
+}
+
+static const char *expected_tokens =
+        "{K(name)V(\"f\u00e4\\\"o\")K(numbers)[V(1)V(-2)V(3.500000000000000000000e+00)V(18446744073709551615)]"
+        "K(flags)[V(true)V(false)V(null)]K(empty){}K(nested)[[][{K(x)V(0)}]]}";
+
+TEST(tokens) {
+        _cleanup_(json_reader_freep) JsonReader *r = NULL;
+        _cleanup_free_ char *s = NULL;
+        int k;
+
+        ASSERT_OK(json_reader_new(0, &r));
+        ASSERT_OK(json_reader_feed(r, json_input, strlen(json_input)));
+        json_reader_feed_eof(r);
+
+        ASSERT_EQ(json_reader_peek(r), JSON_READER_OBJECT_START);
+        ASSERT_EQ(json_reader_peek(r), JSON_READER_OBJECT_START);
+
+        while ((k = describe_token(r, json_reader_next(r), &s)) > 0)
+                ;
+        ASSERT_OK(k);
+
+        ASSERT_STREQ(s, expected_tokens);
+
+        /* The end is sticky */
+        ASSERT_EQ(json_reader_next(r), JSON_READER_END);
+}
+
+TEST(position) {
+        _cleanup_(json_reader_freep) JsonReader *r = NULL;
+        unsigned line, column;
+        int k;
+
+        ASSERT_OK(json_reader_new(0, &r));
+        ASSERT_OK(json_reader_feed(r, json_input, strlen(json_input)));
+        json_reader_feed_eof(r);
+
+        while ((k = json_reader_next(r)) != JSON_READER_KEY || !streq(json_reader_key(r), "flags"))
+                ASSERT_GT(k, 0);
+
+        json_reader_get_position(r, &line, &column);
+        ASSERT_EQ(line, 2u);
+        ASSERT_EQ(column, 3u);
+}
+
+TEST(incremental) {
+        _cleanup_(json_reader_freep) JsonReader *r = NULL;
+        _cleanup_free_ char *s = NULL;
+        int k;
+
+        /* Feed the input byte by byte, so that every token is cut off at every possible place */
+        ASSERT_OK(json_reader_new(0, &r));
+
+        for (const char *p = json_input; *p; p++) {
+                ASSERT_OK(json_reader_feed(r, p, 1));
+
+                while ((k = describe_token(r, json_reader_next(r), &s)) > 0)
+                        ;
+                ASSERT_ERROR(k, EAGAIN);
+        }
+
+        json_reader_feed_eof(r);
+        while ((k = describe_token(r, json_reader_next(r), &s)) > 0)
+                ;
+        ASSERT_OK(k);
+
+        ASSERT_STREQ(s, expected_tokens);
+}
+
+TEST(incremental_number) {
+        _cleanup_(json_reader_freep) JsonReader *r = NULL;
+        sd_json_variant *v;
+
+        /* A number at the end of the input so far might continue */
+        ASSERT_OK(json_reader_new(0, &r));
+        ASSERT_OK(json_reader_feed(r, "12", 2));
+        ASSERT_ERROR(json_reader_next(r), EAGAIN);
+        ASSERT_OK(json_reader_feed(r, "34 ", 3));
+        ASSERT_EQ(json_reader_next(r), JSON_READER_VALUE);
+        ASSERT_NOT_NULL(v = json_reader_value(r));
+        ASSERT_EQ(sd_json_variant_unsigned(v), 1234u);
+        ASSERT_ERROR(json_reader_next(r), EAGAIN);
+        json_reader_feed_eof(r);
+        ASSERT_EQ(json_reader_next(r), JSON_READER_END);
+}
+
+static void test_invalid_one(const char *input, int error) {
+        _cleanup_(json_reader_freep) JsonReader *r = NULL;
+        int k;
+
+        log_info("/* %s(%s) */", __func__, input);
+
+        ASSERT_OK(json_reader_new(0, &r));
+        ASSERT_OK(json_reader_feed(r, input, strlen(input)));
+        json_reader_feed_eof(r);
+
+        while ((k = json_reader_next(r)) > 0)
+                ;
+
+        ASSERT_ERROR(k, error);
+}
+
+TEST(invalid) {
+        test_invalid_one("", ENODATA);
+        test_invalid_one("   ", ENODATA);
+        test_invalid_one("[1,]", EINVAL);
+        test_invalid_one("[1 2]", EINVAL);
+        test_invalid_one("{\"a\" 1}", EINVAL);
+        test_invalid_one("{\"a\":1,}", EINVAL);
+        test_invalid_one("{1:2}", EINVAL);
+        test_invalid_one("[1", EINVAL);
+        test_invalid_one("\"foo", EINVAL);
+        test_invalid_one("tru", EINVAL);
+        test_invalid_one("[] []", EINVAL);
+        test_invalid_one("]", EINVAL);
+
+        _cleanup_(json_reader_freep) JsonReader *r = NULL;
+        ASSERT_OK(json_reader_new(0, &r));
+        ASSERT_ERROR(json_reader_feed(r, "[\0]", 3), EINVAL);
+}
+
+TEST(read_variant) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL, *w = NULL, *parsed = NULL;
+        _cleanup_(json_reader_freep) JsonReader *r = NULL;
+        size_t n = 0;
+        int k;
+
+        ASSERT_OK(sd_json_parse(json_input, 0, &parsed, NULL, NULL));
+
+        /* The whole input as one variant */
+        ASSERT_OK(json_reader_new(0, &r));
+        ASSERT_OK(json_reader_feed(r, json_input, strlen(json_input)));
+        json_reader_feed_eof(r);
+        ASSERT_GT(json_reader_read_variant(r, &v), 0);
+        ASSERT_TRUE(sd_json_variant_equal(v, parsed));
+        ASSERT_EQ(json_reader_read_variant(r, &w), 0);
+        ASSERT_NULL(w);
+        r = json_reader_free(r);
+
+        /* And field by field */
+        ASSERT_OK(json_reader_new(0, &r));
+        ASSERT_OK(json_reader_feed(r, json_input, strlen(json_input)));
+        json_reader_feed_eof(r);
+        ASSERT_EQ(json_reader_next(r), JSON_READER_OBJECT_START);
+
+        while ((k = json_reader_next(r)) == JSON_READER_KEY) {
+                _cleanup_free_ char *key = NULL;
+
+                ASSERT_NOT_NULL(key = strdup(json_reader_key(r)));
+
+                if (streq(key, "flags")) {
+                        ASSERT_GT(json_reader_skip(r), 0);
+                        continue;
+                }
+
+                w = sd_json_variant_unref(w);
+                ASSERT_GT(json_reader_read_variant(r, &w), 0);
+                ASSERT_TRUE(sd_json_variant_equal(w, sd_json_variant_by_key(parsed, key)));
+                n++;
+        }
+        ASSERT_EQ(k, JSON_READER_OBJECT_END);
+        ASSERT_EQ(n, 4u);
+        ASSERT_EQ(json_reader_next(r), JSON_READER_END);
+}
+
+TEST(read_variant_incremental) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL, *parsed = NULL;
+        _cleanup_(json_reader_freep) JsonReader *r = NULL;
+        const char *p = json_input;
+        int k;
+
+        ASSERT_OK(sd_json_parse(json_input, 0, &parsed, NULL, NULL));
+
+        /* Nothing is consumed until the whole value is there */
+        ASSERT_OK(json_reader_new(0, &r));
+        for (;;) {
+                k = json_reader_read_variant(r, &v);
+                if (k != -EAGAIN)
+                        break;
+
+                ASSERT_NE(*p, 0);
+                ASSERT_OK(json_reader_feed(r, p++, 1));
+        }
+        ASSERT_GT(k, 0);
+        ASSERT_TRUE(sd_json_variant_equal(v, parsed));
+        ASSERT_EQ(*p, 0);
+}
+
+typedef struct Record {
+        char *name;
+        uint64_t size;
+        char **tags;
+} Record;
+
+static void record_done(Record *rec) {
+        assert(rec);
+
+        rec->name = mfree(rec->name);
+        rec->tags = strv_free(rec->tags);
+}
+
+static const sd_json_dispatch_field record_table[] = {
+        { "name", SD_JSON_VARIANT_STRING,        sd_json_dispatch_string, offsetof(Record, name), SD_JSON_MANDATORY },
+        { "size", _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64, offsetof(Record, size), 0                 },
+        { "tags", SD_JSON_VARIANT_ARRAY,         sd_json_dispatch_strv,   offsetof(Record, tags), 0                 },
+        {},
+};
+
+static const char *records_input =
+        "[ { \"name\" : \"a\", \"size\" : 1, \"tags\" : [ \"x\", \"y\" ] },\n"
+        "  { \"size\" : \"2\", \"name\" : \"b\" },\n"
+        "  { \"name\" : \"c\", \"tags\" : [] } ]";
+
+static void check_record(const Record *rec, unsigned i) {
+        switch (i) {
+
+        case 0:
+                ASSERT_STREQ(rec->name, "a");
+                ASSERT_EQ(rec->size, 1u);
+                ASSERT_TRUE(strv_equal(rec->tags, STRV_MAKE("x", "y")));
+                break;
+
+        case 1:
+                ASSERT_STREQ(rec->name, "b");
+                ASSERT_EQ(rec->size, 2u);
+                ASSERT_NULL(rec->tags);
+                break;
+
+        case 2:
+                ASSERT_STREQ(rec->name, "c");
+                ASSERT_EQ(rec->size, 0u);
+                ASSERT_TRUE(strv_isempty(rec->tags));
+                break;
+
+        default:
+                assert_not_reached();
+        }
+}
+
+TEST(dispatch_file) {
+        _cleanup_(json_reader_freep) JsonReader *r = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        unsigned n = 0;
+        int k;
+
+        ASSERT_NOT_NULL(f = fmemopen_unlocked((char*) records_input, strlen(records_input), "r"));
+        ASSERT_OK(json_reader_new_file(f, 0, &r));
+
+        ASSERT_EQ(json_reader_next(r), JSON_READER_ARRAY_START);
+        for (;;) {
+                _cleanup_(record_done) Record rec = {};
+
+                k = json_reader_dispatch(r, record_table, 0, &rec);
+                ASSERT_OK(k);
+                if (k == 0)
+                        break;
+
+                check_record(&rec, n++);
+        }
+        ASSERT_EQ(n, 3u);
+        ASSERT_EQ(json_reader_next(r), JSON_READER_END);
+}
+
+TEST(dispatch_incremental) {
+        _cleanup_(json_reader_freep) JsonReader *r = NULL;
+        const char *p = records_input;
+        unsigned n = 0;
+        int k;
+
+        ASSERT_OK(json_reader_new(0, &r));
+
+        while ((k = json_reader_next(r)) == -EAGAIN)
+                ASSERT_OK(json_reader_feed(r, p++, 1));
+        ASSERT_EQ(k, JSON_READER_ARRAY_START);
+
+        for (;;) {
+                _cleanup_(record_done) Record rec = {};
+
+                k = json_reader_dispatch(r, record_table, 0, &rec);
+                if (k == -EAGAIN) {
+                        /* Partially available records are not dispatched */
+                        ASSERT_NULL(rec.name);
+
+                        if (*p)
+                                ASSERT_OK(json_reader_feed(r, p++, 1));
+                        else
+                                json_reader_feed_eof(r);
+                        continue;
+                }
+                ASSERT_OK(k);
+                if (k == 0)
+                        break;
+
+                check_record(&rec, n++);
+        }
+
+        ASSERT_EQ(n, 3u);
+        ASSERT_EQ(*p, 0);
+}
+
+TEST(dispatch_invalid) {
+        _cleanup_(json_reader_freep) JsonReader *r = NULL;
+        _cleanup_(record_done) Record rec = {};
+        const char *input = "[ { \"size\" : 7 }, { \"name\" : \"a\", \"foo\" : 1 }, 5, { \"name\" : \"b\" } ]", *bad;
+
+        ASSERT_OK(json_reader_new(0, &r));
+        ASSERT_OK(json_reader_feed(r, input, strlen(input)));
+        json_reader_feed_eof(r);
+
+        ASSERT_EQ(json_reader_next(r), JSON_READER_ARRAY_START);
+
+        ASSERT_ERROR(json_reader_dispatch_full(r, record_table, NULL, 0, &rec, &bad), ENXIO);
+        ASSERT_STREQ(bad, "name");
+        record_done(&rec);
+
+        ASSERT_ERROR(json_reader_dispatch_full(r, record_table, NULL, 0, &rec, &bad), EADDRNOTAVAIL);
+        ASSERT_STREQ(bad, "foo");
+        ASSERT_EQ(json_reader_next(r), JSON_READER_OBJECT_END);
+        record_done(&rec);
+
+        ASSERT_ERROR(json_reader_dispatch(r, record_table, 0, &rec), EINVAL);
+
+        ASSERT_GT(json_reader_dispatch(r, record_table, 0, &rec), 0);
+        ASSERT_STREQ(rec.name, "b");
+        ASSERT_EQ(json_reader_dispatch(r, record_table, 0, &rec), 0);
+        ASSERT_EQ(json_reader_next(r), JSON_READER_END);
+}
+
+DEFINE_TEST_MAIN(LOG_INFO);
@@ -916,6 +916,80 @@ TEST(json_dispatch) {
         assert_se(foobar.p == INT8_MIN);
 }
 
+typedef struct DispatchIndexData {
+        int64_t a, b, c;
+        unsigned n_other;
+} DispatchIndexData;
+
+static int dispatch_other(const char *name, sd_json_variant *variant, sd_json_dispatch_flags_t flags, void *userdata) {
+        DispatchIndexData *d = ASSERT_PTR(userdata);
+
+        d->n_other++;
+        return 0;
+}
+
+static void test_dispatch_index_one(const sd_json_dispatch_field table[], const char *json, int expected, const char *expected_bad_field) {
+        _cleanup_(json_dispatch_index_freep) JsonDispatchIndex *index = NULL;
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        DispatchIndexData x = {}, y = {};
+        const char *bad_x = NULL, *bad_y = NULL;
+
+        log_debug("/* %s(%s) */", __func__, json);
+
+        ASSERT_OK(sd_json_parse(json, 0, &v, NULL, NULL));
+        ASSERT_OK(json_dispatch_index_new(table, &index));
+
+        /* The index must not change anything about how fields are matched */
+        ASSERT_EQ(sd_json_dispatch_full(v, table, NULL, 0, &x, &bad_x), expected);
+        ASSERT_EQ(json_dispatch_index_full(v, index, NULL, 0, &y, &bad_y), expected);
+        ASSERT_STREQ(bad_x, expected_bad_field);
+        ASSERT_STREQ(bad_y, expected_bad_field);
+        ASSERT_EQ(memcmp(&x, &y, sizeof(x)), 0);
+}
+
+TEST(json_dispatch_index) {
+        static const sd_json_dispatch_field table[] = {
+                { "zeta",     _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_int64, offsetof(DispatchIndexData, a), SD_JSON_MANDATORY },
+                { "alpha",    _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_int64, offsetof(DispatchIndexData, b), 0                 },
+                { "alpha",    _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_int64, offsetof(DispatchIndexData, c), 0                 },
+                { "mu",       SD_JSON_VARIANT_STRING,        NULL,                   0,                              0                 },
+                { POINTER_MAX, _SD_JSON_VARIANT_TYPE_INVALID, dispatch_other,         0,                              0                 },
+                { "omega",    _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_int64, offsetof(DispatchIndexData, c), 0                 },
+                {}
+        };
+        static const sd_json_dispatch_field strict_table[] = {
+                { "b", _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_int64, offsetof(DispatchIndexData, b), 0 },
+                { "a", _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_int64, offsetof(DispatchIndexData, a), 0 },
+                {}
+        };
+        static const sd_json_dispatch_field empty_table[] = {
+                {}
+        };
+
+        test_dispatch_index_one(table, "{\"alpha\":1,\"zeta\":2,\"omega\":3}", 3, NULL);
+        test_dispatch_index_one(table, "{\"zeta\":2,\"mu\":\"foo\"}", 2, NULL);
+        test_dispatch_index_one(table, "{\"alpha\":1}", -ENXIO, "zeta");
+        test_dispatch_index_one(table, "{\"zeta\":2,\"mu\":7}", -EINVAL, "mu");
+        test_dispatch_index_one(strict_table, "{\"a\":1,\"b\":2}", 2, NULL);
+        test_dispatch_index_one(strict_table, "{}", 0, NULL);
+        test_dispatch_index_one(strict_table, "{\"a\":1,\"c\":2}", -EADDRNOTAVAIL, "c");
+        test_dispatch_index_one(empty_table, "{}", 0, NULL);
+        test_dispatch_index_one(empty_table, "{\"a\":1}", -EADDRNOTAVAIL, "a");
+
+        /* The cached index is built once and then reused by the call site */
+        for (unsigned i = 0; i < 3; i++) {
+                _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+                DispatchIndexData d = {};
+
+                ASSERT_OK(sd_json_parse("{\"zeta\":5,\"alpha\":6,\"other\":true}", 0, &v, NULL, NULL));
+                ASSERT_EQ(json_dispatch_indexed(v, table, 0, &d), 3);
+                ASSERT_EQ(d.a, 5);
+                ASSERT_EQ(d.b, 6);
+                ASSERT_EQ(d.c, 0);
+                ASSERT_EQ(d.n_other, 1u);
+        }
+}
+
 typedef enum mytestenum {
         myfoo, mybar, mybaz, with_some_dashes, _mymax, _myinvalid = -EINVAL,
 } mytestenum;
@@ -1238,4 +1312,111 @@ TEST(parse_continue) {
         assert_se(sd_json_parse_with_source_continue(&p, "piff", /* flags= */ 0, &x, &line, &column) == -EINVAL);
 }
 
+TEST(packed_strings) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL, *w = NULL, *a = NULL, *b = NULL, *value = NULL;
+        _cleanup_free_ char *f = NULL;
+        _align_(2) char name[32];
+
+        /* Field names that are not 2-aligned take a different path when building */
+        strcpy(name + 1, "odd-aligned-name");
+
+        ASSERT_OK(sd_json_build(&v, SD_JSON_BUILD_OBJECT(
+                                        SD_JSON_BUILD_PAIR("a-long-field-name", SD_JSON_BUILD_STRING("a long string value")),
+                                        SD_JSON_BUILD_PAIR(name + 1, SD_JSON_BUILD_STRING("another long string value")),
+                                        SD_JSON_BUILD_PAIR("short", SD_JSON_BUILD_STRING("short")),
+                                        SD_JSON_BUILD_PAIR("strv", SD_JSON_BUILD_STRV(STRV_MAKE("foo", "a long string in an array"))),
+                                        SD_JSON_BUILD_PAIR("const", JSON_BUILD_CONST_STRING("a long const string")))));
+
+        ASSERT_OK(sd_json_variant_format(v, 0, &f));
+        ASSERT_STREQ(f, "{\"a-long-field-name\":\"a long string value\","
+                        "\"odd-aligned-name\":\"another long string value\","
+                        "\"short\":\"short\","
+                        "\"strv\":[\"foo\",\"a long string in an array\"],"
+                        "\"const\":\"a long const string\"}");
+
+        /* Parsing yields the same */
+        ASSERT_OK(sd_json_parse(f, 0, &w, NULL, NULL));
+        ASSERT_TRUE(sd_json_variant_equal(v, w));
+        w = sd_json_variant_unref(w);
+
+        /* Members stay valid after the object is gone, if referenced */
+        ASSERT_NOT_NULL(value = sd_json_variant_ref(sd_json_variant_by_key(v, "odd-aligned-name")));
+        ASSERT_OK(sd_json_variant_set_field_string(&v, "a-long-field-name", "a changed long string value"));
+        ASSERT_OK(sd_json_variant_set_field_string(&v, "a-long-field-name", "and once more changed"));
+        ASSERT_OK(sd_json_variant_set_field_string(&v, "yet-another-long-name", "and once more changed"));
+        ASSERT_OK(sd_json_variant_normalize(&v));
+
+        f = mfree(f);
+        ASSERT_OK(sd_json_variant_format(v, 0, &f));
+        ASSERT_STREQ(f, "{\"a-long-field-name\":\"and once more changed\","
+                        "\"const\":\"a long const string\","
+                        "\"odd-aligned-name\":\"another long string value\","
+                        "\"short\":\"short\","
+                        "\"strv\":[\"foo\",\"a long string in an array\"],"
+                        "\"yet-another-long-name\":\"and once more changed\"}");
+
+        v = sd_json_variant_unref(v);
+        ASSERT_STREQ(sd_json_variant_string(value), "another long string value");
+
+        /* Arrays of packed strings can be appended to */
+        ASSERT_OK(sd_json_variant_new_array_strv(&a, STRV_MAKE("first long string", "second long string")));
+        ASSERT_OK(sd_json_variant_append_array(&a, value));
+        ASSERT_OK(sd_json_variant_append_arrayb(&a, SD_JSON_BUILD_STRING("fourth long string")));
+        ASSERT_OK(sd_json_variant_append_arrayb(&a, SD_JSON_BUILD_STRING("fifth long string")));
+
+        ASSERT_OK(sd_json_build(&b, SD_JSON_BUILD_STRV(STRV_MAKE("first long string", "second long string", "another long string value",
+                                                                 "fourth long string", "fifth long string"))));
+        ASSERT_TRUE(sd_json_variant_equal(a, b));
+
+        /* Sensitive strings are not packed, they remain sensitive within arrays */
+        w = sd_json_variant_unref(w);
+        ASSERT_OK(sd_json_variant_new_string(&w, "a sensitive long string"));
+        sd_json_variant_sensitive(w);
+        b = sd_json_variant_unref(b);
+        ASSERT_OK(sd_json_variant_new_array(&b, &w, 1));
+        ASSERT_TRUE(sd_json_variant_is_sensitive_recursive(b));
+}
+
+TEST(format_string_escape) {
+        static const struct {
+                char c;
+                const char *escaped;
+        } table[] = {
+                { '"',    "\\\""   },
+                { '\\',   "\\\\"  },
+                { '\n',   "\\n"    },
+                { '\t',   "\\t"    },
+                { '\001', "\\u0001" },
+                { '\037', "\\u001f" },
+                { ' ',    " "      },
+                { '\177', "\177"   },
+                { '#',    "#"      },
+                { ']',    "]"      },
+        };
+
+        /* Put each character at every position of a string, so that the escaping is checked for both the
+         * word-wise and the bytewise scanning. */
+        FOREACH_ELEMENT(e, table)
+                for (size_t i = 0; i < 24; i++) {
+                        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+                        _cleanup_free_ char *s = NULL, *expected = NULL, *formatted = NULL;
+
+                        ASSERT_NOT_NULL(s = strrep("x", 24));
+                        s[i] = e->c;
+                        ASSERT_NOT_NULL(expected = strjoin("\"", strndupa_safe(s, i), e->escaped, s + i + 1, "\""));
+
+                        ASSERT_OK(sd_json_variant_new_string(&v, s));
+                        ASSERT_OK(sd_json_variant_format(v, 0, &formatted));
+                        ASSERT_STREQ(formatted, expected);
+                }
+
+        /* Non-ASCII UTF-8 is written out as is */
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        _cleanup_free_ char *formatted = NULL;
+
+        ASSERT_OK(sd_json_variant_new_string(&v, "zażółć gęślą jaźń \"quoted\""));
+        ASSERT_OK(sd_json_variant_format(v, 0, &formatted));
+        ASSERT_STREQ(formatted, "\"zażółć gęślą jaźń \\\"quoted\\\"\"");
+}
+
 DEFINE_TEST_MAIN(LOG_DEBUG);
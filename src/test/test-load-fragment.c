@@ -1091,6 +1091,35 @@ TEST(config_parse_open_file) {
         assert_se(!of);
 }
 
+TEST(config_parse_socket_reuse_port_shards) {
+        _cleanup_free_ char *t = NULL;
+        unsigned n = 0;
+
+        ASSERT_OK(config_parse_socket_reuse_port_shards(NULL, "fake", 1, "section", 1,
+                                                        "ReusePortShards", 0, "4", &n, NULL));
+        ASSERT_EQ(n, 4u);
+
+        ASSERT_OK(config_parse_socket_reuse_port_shards(NULL, "fake", 1, "section", 1,
+                                                        "ReusePortShards", 0, "cpus", &n, NULL));
+        ASSERT_EQ(n, SOCKET_REUSE_PORT_SHARDS_CPUS);
+        ASSERT_OK(socket_reuse_port_shards_to_string_alloc(n, &t));
+        ASSERT_STREQ(t, "cpus");
+
+        /* Invalid values are ignored */
+        ASSERT_OK(config_parse_socket_reuse_port_shards(NULL, "fake", 1, "section", 1,
+                                                        "ReusePortShards", 0, "100000", &n, NULL));
+        ASSERT_EQ(n, SOCKET_REUSE_PORT_SHARDS_CPUS);
+        ASSERT_OK(config_parse_socket_reuse_port_shards(NULL, "fake", 1, "section", 1,
+                                                        "ReusePortShards", 0, "many", &n, NULL));
+        ASSERT_EQ(n, SOCKET_REUSE_PORT_SHARDS_CPUS);
+
+        ASSERT_OK(config_parse_socket_reuse_port_shards(NULL, "fake", 1, "section", 1,
+                                                        "ReusePortShards", 0, "", &n, NULL));
+        ASSERT_EQ(n, 0u);
+
+        ASSERT_ERROR(socket_reuse_port_shards_to_string_alloc(SOCKET_REUSE_PORT_SHARDS_MAX + 1, &t), EINVAL);
+}
+
 static int intro(void) {
         if (enter_cgroup_subroot(NULL) == -ENOMEDIUM)
                 return log_tests_skipped("cgroupfs not available");
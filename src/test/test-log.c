@@ -225,6 +225,8 @@ static void test_log_prefix(void) {
 }
 
 int main(int argc, char* argv[]) {
+        bool async;
+
         test_setup_logging(LOG_DEBUG);
 
         test_assert_return_is_critical();
@@ -232,15 +234,21 @@ int main(int argc, char* argv[]) {
 
         assert_se(log_info_errno(SYNTHETIC_ERRNO(EUCLEAN), "foo") == -EUCLEAN);
 
-        for (int target = 0; target < _LOG_TARGET_MAX; target++) {
-                log_set_target(target);
-                log_open();
+        FOREACH_ARGUMENT(async, false, true) {
+                log_set_async(async);
 
-                test_log_struct();
-                test_long_lines();
-                test_log_syntax();
-                test_log_context();
-                test_log_prefix();
+                for (int target = 0; target < _LOG_TARGET_MAX; target++) {
+                        log_set_target(target);
+                        log_open();
+
+                        test_log_struct();
+                        test_long_lines();
+                        test_log_syntax();
+                        test_log_context();
+                        test_log_prefix();
+                }
+
+                log_flush();
         }
 
         return 0;
@@ -0,0 +1,154 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <fcntl.h>
+
+#include "sd-journal.h"
+#include "sd-json.h"
+
+#include "alloc-util.h"
+#include "iovec-util.h"
+#include "journal-file-util.h"
+#include "logs-show.h"
+#include "memstream-util.h"
+#include "mmap-cache.h"
+#include "path-util.h"
+#include "rm-rf.h"
+#include "set.h"
+#include "string-util.h"
+#include "strv.h"
+#include "tests.h"
+#include "tmpfile-util.h"
+
+static void append(JournalFile *f, dual_timestamp *ts, const sd_id128_t *boot_id, const struct iovec *iovec, size_t n) {
+        ts->monotonic += USEC_PER_MSEC;
+        ts->realtime += USEC_PER_MSEC;
+
+        ASSERT_OK(journal_file_append_entry(f, ts, boot_id, iovec, n, NULL, NULL, NULL, NULL));
+}
+
+static char* format_entry(sd_journal *j, OutputMode mode, OutputFlags flags, Set *output_fields) {
+        _cleanup_(memstream_done) MemStream m = {};
+        dual_timestamp previous_ts = DUAL_TIMESTAMP_NULL;
+        sd_id128_t previous_boot_id = SD_ID128_NULL;
+        char *buf;
+        FILE *f;
+
+        ASSERT_NOT_NULL(f = memstream_init(&m));
+        sd_journal_restart_data(j);
+        ASSERT_OK(show_journal_entry(f, j, mode, 0, flags, output_fields, NULL, NULL, &previous_ts, &previous_boot_id));
+        ASSERT_OK(memstream_finalize(&m, &buf, NULL));
+
+        return buf;
+}
+
+static sd_json_variant* parse_entry(const char *s) {
+        sd_json_variant *v;
+
+        ASSERT_OK(sd_json_parse(s, 0, &v, NULL, NULL));
+        return v;
+}
+
+static void test_entry(sd_journal *j, OutputFlags flags, Set *output_fields) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *direct = NULL, *generic = NULL;
+        _cleanup_free_ char *s = NULL, *p = NULL, *seq = NULL, *sse = NULL;
+
+        /* The compact modes are formatted directly, the pretty one through a JSON object. Both must yield
+         * the same. */
+        ASSERT_NOT_NULL(s = format_entry(j, OUTPUT_JSON, flags, output_fields));
+        ASSERT_NOT_NULL(p = format_entry(j, OUTPUT_JSON_PRETTY, flags, output_fields));
+
+        log_debug("%s", s);
+
+        /* One line per entry */
+        ASSERT_TRUE(endswith(s, "}\n"));
+        ASSERT_TRUE(strchr(s, '\n') == s + strlen(s) - 1);
+
+        direct = parse_entry(s);
+        generic = parse_entry(p);
+        ASSERT_TRUE(sd_json_variant_equal(direct, generic));
+
+        ASSERT_NOT_NULL(seq = format_entry(j, OUTPUT_JSON_SEQ, flags, output_fields));
+        ASSERT_STREQ(seq, strjoina("\x1e", s));
+
+        ASSERT_NOT_NULL(sse = format_entry(j, OUTPUT_JSON_SSE, flags, output_fields));
+        ASSERT_STREQ(sse, strjoina("data: ", s, "\n"));
+}
+
+TEST(output_json) {
+        _cleanup_(rm_rf_physical_and_freep) char *t = NULL;
+        _cleanup_(mmap_cache_unrefp) MMapCache *m = NULL;
+        _cleanup_(sd_journal_closep) sd_journal *j = NULL;
+        _cleanup_set_free_ Set *output_fields = NULL;
+        _cleanup_free_ char *fn = NULL, *large = NULL;
+        JournalFile *f = NULL;
+        sd_id128_t boot_id;
+        dual_timestamp ts;
+        unsigned n = 0;
+
+        /* journal_file_open() requires a valid machine id */
+        if (sd_id128_get_machine(NULL) < 0)
+                return (void) log_tests_skipped("No valid machine ID found");
+
+        ASSERT_OK(mkdtemp_malloc("/tmp/test-logs-show-XXXXXX", &t));
+        ASSERT_NOT_NULL(fn = path_join(t, "test.journal"));
+        ASSERT_NOT_NULL(m = mmap_cache_new());
+        ASSERT_OK(journal_file_open(-EBADF, fn, O_RDWR|O_CREAT, JOURNAL_COMPRESS, 0644, UINT64_MAX, NULL, m, NULL, &f));
+
+        ASSERT_OK(sd_id128_randomize(&boot_id));
+        dual_timestamp_now(&ts);
+
+        append(f, &ts, &boot_id,
+               (const struct iovec[]) {
+                       IOVEC_MAKE_STRING("MESSAGE=hello"),
+                       IOVEC_MAKE_STRING("PRIORITY=6"),
+               }, 2);
+
+        /* Escaping, and fields that occur more than once */
+        append(f, &ts, &boot_id,
+               (const struct iovec[]) {
+                       IOVEC_MAKE_STRING("MESSAGE=\"quoted\" \\ back\tslash\nnext line"),
+                       IOVEC_MAKE_STRING("FOO=1"),
+                       IOVEC_MAKE_STRING("BAR=x"),
+                       IOVEC_MAKE_STRING("FOO=2"),
+                       IOVEC_MAKE_STRING("FOO=3"),
+                       IOVEC_MAKE_STRING("EMPTY="),
+                       IOVEC_MAKE_STRING("UTF8=zażółć gęślą jaźń"),
+               }, 7);
+
+        /* Binary data, which is formatted as an array of bytes, and the boot ID, which is taken from the
+         * entry header */
+        append(f, &ts, &boot_id,
+               (const struct iovec[]) {
+                       IOVEC_MAKE_STRING("MESSAGE=binary"),
+                       IOVEC_MAKE("BINARY=a\0b\x01\xff", STRLEN("BINARY=a\0b\x01\xff")),
+                       IOVEC_MAKE_STRING("CONTROL=\x1b[0m\r"),
+                       IOVEC_MAKE_STRING("INVALID=\xc3\x28"),
+                       IOVEC_MAKE_STRING("_BOOT_ID=00000000000000000000000000000001"),
+               }, 5);
+
+        /* Large fields are suppressed unless all is shown */
+        ASSERT_NOT_NULL(large = strjoin("LARGE=", strrepa("x", 5000)));
+        append(f, &ts, &boot_id,
+               (const struct iovec[]) {
+                       IOVEC_MAKE_STRING("MESSAGE=large"),
+                       IOVEC_MAKE_STRING(large),
+                       IOVEC_MAKE_STRING("LARGE=small"),
+               }, 3);
+
+        (void) journal_file_offline_close(f);
+
+        ASSERT_OK(sd_journal_open_files(&j, (const char**) STRV_MAKE(fn), 0));
+        ASSERT_OK(set_put_strdupv(&output_fields, STRV_MAKE("MESSAGE", "FOO", "LARGE")));
+
+        SD_JOURNAL_FOREACH(j) {
+                test_entry(j, 0, NULL);
+                test_entry(j, OUTPUT_SHOW_ALL, NULL);
+                test_entry(j, 0, output_fields);
+                test_entry(j, OUTPUT_SHOW_ALL, output_fields);
+                n++;
+        }
+
+        ASSERT_EQ(n, 4u);
+}
+
+DEFINE_TEST_MAIN(LOG_INFO);
@@ -1,6 +1,8 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
+#include "alloc-util.h"
 #include "mempool.h"
+#include "memstream-util.h"
 #include "random-util.h"
 #include "tests.h"
 
@@ -89,4 +91,58 @@ TEST(mempool_trim) {
         assert_se(!test_mempool.freelist);
 }
 
+DEFINE_MEMPOOL(stats_mempool, struct element, 8);
+
+TEST(mempool_stats) {
+        _cleanup_(memstream_done) MemStream m = {};
+        _cleanup_free_ char *dump = NULL;
+        struct element *a[100];
+        MempoolStats stats;
+        FILE *f;
+
+        mempool_get_stats(&stats_mempool, &stats);
+        assert_se(stats.n_pools == 0);
+        assert_se(stats.n_tiles == 0);
+        assert_se(stats.n_tiles_used == 0);
+
+        FOREACH_ELEMENT(i, a)
+                assert_se(*i = mempool_alloc_tile(&stats_mempool));
+
+        mempool_get_stats(&stats_mempool, &stats);
+        assert_se(stats.n_pools > 0);
+        assert_se(stats.n_tiles >= ELEMENTSOF(a));
+        assert_se(stats.n_tiles_used == ELEMENTSOF(a));
+        assert_se(stats.n_bytes >= stats.n_tiles * sizeof(struct element));
+
+        assert_se(f = memstream_init(&m));
+        mempool_dump_stats(f);
+        assert_se(memstream_finalize(&m, &dump, NULL) >= 0);
+        log_info("%s", dump);
+        assert_se(strstr(dump, "name=\"stats_mempool\""));
+
+        for (size_t i = 0; i < ELEMENTSOF(a) / 2; i++)
+                a[i] = mempool_free_tile(&stats_mempool, a[i]);
+
+        mempool_get_stats(&stats_mempool, &stats);
+        assert_se(stats.n_tiles_used == ELEMENTSOF(a) - ELEMENTSOF(a) / 2);
+
+        /* Reuses the freed tiles */
+        for (size_t i = 0; i < ELEMENTSOF(a) / 2; i++)
+                assert_se(a[i] = mempool_alloc_tile(&stats_mempool));
+
+        mempool_get_stats(&stats_mempool, &stats);
+        assert_se(stats.n_tiles_used == ELEMENTSOF(a));
+
+        FOREACH_ELEMENT(i, a)
+                *i = mempool_free_tile(&stats_mempool, *i);
+
+        mempool_trim_all();
+
+        mempool_get_stats(&stats_mempool, &stats);
+        assert_se(stats.n_pools == 0);
+        assert_se(stats.n_tiles_used == 0);
+        assert_se(!stats_mempool.first_pool);
+        assert_se(!stats_mempool.freelist);
+}
+
 DEFINE_TEST_MAIN(LOG_DEBUG);
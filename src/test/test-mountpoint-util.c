@@ -10,6 +10,7 @@
 #include "fileio.h"
 #include "hashmap.h"
 #include "log.h"
+#include "missing_syscall.h"
 #include "mountpoint-util.h"
 #include "path-util.h"
 #include "rm-rf.h"
@@ -411,6 +412,51 @@ TEST(path_get_mnt_id_at_null) {
         id2 = -1;
 }
 
+TEST(mount_list_ids) {
+        _cleanup_free_ uint64_t *ids = NULL;
+        size_t n_ids;
+        bool found_proc = false;
+        int proc_id, r;
+
+        r = mount_list_ids(&ids, &n_ids);
+        if (r == -EOPNOTSUPP || ERRNO_IS_NEG_PRIVILEGE(r))
+                return (void) log_tests_skipped_errno(r, "listmount() not available");
+        ASSERT_OK(r);
+        ASSERT_GT(n_ids, 0u);
+
+        ASSERT_OK(path_get_mnt_id("/proc", &proc_id));
+
+        for (size_t i = 0; i < n_ids; i++) {
+                _cleanup_free_ struct new_statmount *sm = NULL;
+                _cleanup_free_ char *options = NULL;
+                const char *where, *fstype;
+
+                if (i > 0)
+                        ASSERT_LT(ids[i-1], ids[i]);
+
+                r = mount_stat(ids[i], STATMOUNT_SB_BASIC|STATMOUNT_MNT_BASIC|STATMOUNT_MNT_POINT|STATMOUNT_FS_TYPE|STATMOUNT_MNT_OPTS, &sm);
+                if (r == -ENOENT) /* Raced against an umount */
+                        continue;
+                ASSERT_OK(r);
+                ASSERT_EQ(sm->mnt_id, ids[i]);
+
+                ASSERT_NOT_NULL(where = statmount_string(sm, STATMOUNT_MNT_POINT, sm->mnt_point));
+                ASSERT_NOT_NULL(fstype = statmount_string(sm, STATMOUNT_FS_TYPE, sm->fs_type));
+                ASSERT_TRUE(path_is_absolute(where));
+                ASSERT_NULL(statmount_string(sm, STATMOUNT_MNT_ROOT, sm->mnt_root));
+
+                ASSERT_OK(statmount_options_to_string(sm, &options));
+                ASSERT_TRUE(STARTSWITH_SET(options, "rw", "ro"));
+
+                log_debug("%" PRIu64 " (%" PRIu32 "): %s %s %s", sm->mnt_id, sm->mnt_id_old, where, fstype, options);
+
+                if (path_equal(where, "/proc") && streq(fstype, "proc") && (int) sm->mnt_id_old == proc_id)
+                        found_proc = true;
+        }
+
+        ASSERT_TRUE(found_proc);
+}
+
 static int intro(void) {
         /* let's move into our own mount namespace with all propagation from the host turned off, so
          * that /proc/self/mountinfo is static and constant for the whole time our test runs. */
@@ -0,0 +1,224 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <sys/socket.h>
+
+#include "sd-bus.h"
+#include "sd-event.h"
+
+#include "alloc-util.h"
+#include "bus-message.h"
+#include "calendarspec.h"
+#include "fd-util.h"
+#include "parse-util.h"
+#include "prioq.h"
+#include "random-util.h"
+#include "string-util.h"
+#include "tests.h"
+#include "time-util.h"
+
+/* This program measures primitives that are used all over the tree, in scenarios that are the same on every
+ * run, so that results can be compared across builds and hosts. Set $SYSTEMD_BENCHMARK_JSON to collect
+ * them, see benchmark_report(). */
+
+#define N_IO_SOURCES 16U
+
+static unsigned arg_n;
+
+typedef struct Item {
+        uint64_t value;
+        unsigned idx;
+} Item;
+
+static int item_compare(const Item *x, const Item *y) {
+        return CMP(x->value, y->value);
+}
+
+static void bench_prioq(void) {
+        _cleanup_(prioq_freep) Prioq *q = NULL;
+        _cleanup_free_ Item *items = NULL;
+
+        ASSERT_NOT_NULL(q = prioq_new((compare_func_t) item_compare));
+        ASSERT_NOT_NULL(items = new(Item, arg_n));
+
+        for (unsigned i = 0; i < arg_n; i++)
+                items[i] = (Item) {
+                        .value = random_u64(),
+                        .idx = PRIOQ_IDX_NULL,
+                };
+
+        BENCHMARK("prioq/put", arg_n,
+                  for (unsigned i = 0; i < arg_n; i++)
+                          ASSERT_OK(prioq_put(q, items + i, &items[i].idx)));
+
+        /* Like timers that are re-armed */
+        BENCHMARK("prioq/reshuffle", arg_n,
+                  for (unsigned i = 0; i < arg_n; i++) {
+                          items[i].value = random_u64();
+                          prioq_reshuffle(q, items + i, &items[i].idx);
+                  });
+
+        BENCHMARK("prioq/pop", arg_n,
+                  for (unsigned i = 0; i < arg_n; i++)
+                          ASSERT_NOT_NULL(prioq_pop(q)));
+
+        ASSERT_TRUE(prioq_isempty(q));
+}
+
+static void bench_calendar_spec(void) {
+        /* A fixed start and UTC, so that the results do not depend on when and where this runs */
+        usec_t start = 1700000000 * USEC_PER_SEC;
+
+        FOREACH_STRING(spec,
+                       "*-*-* *:00:00 UTC",
+                       "*:0/15 UTC",
+                       "Mon..Fri *-*-* 09:00:00 UTC",
+                       "*-*-1,15 04:30:00 UTC",
+                       "Sat *-*-1..7 18:00:00 UTC",
+                       "*-*~03 00:00:00 UTC") {
+                _cleanup_(calendar_spec_freep) CalendarSpec *c = NULL;
+                _cleanup_free_ char *label = NULL;
+                usec_t next;
+
+                ASSERT_OK(calendar_spec_from_string(spec, &c));
+                ASSERT_NOT_NULL(label = strjoin("calendar_spec_next_usec/", spec));
+
+                BENCHMARK(label, arg_n,
+                          for (unsigned i = 0; i < arg_n; i++)
+                                  ASSERT_OK(calendar_spec_next_usec(c, start + i * 37 * USEC_PER_MINUTE, &next)));
+        }
+}
+
+static int io_handler(sd_event_source *s, int fd, uint32_t revents, void *userdata) {
+        unsigned *n = ASSERT_PTR(userdata);
+        char c;
+
+        ASSERT_EQ(read(fd, &c, 1), 1);
+        (*n)++;
+
+        return 0;
+}
+
+static void bench_event_io(void) {
+        _cleanup_(sd_event_unrefp) sd_event *e = NULL;
+        int pipes[N_IO_SOURCES][2];
+        unsigned n = 0;
+
+        ASSERT_OK(sd_event_new(&e));
+
+        for (unsigned k = 0; k < N_IO_SOURCES; k++) {
+                ASSERT_OK_ERRNO(pipe2(pipes[k], O_CLOEXEC|O_NONBLOCK));
+                ASSERT_OK(sd_event_add_io(e, NULL, pipes[k][0], EPOLLIN, io_handler, &n));
+        }
+
+        /* Every round makes all sources ready at once, and dispatches them */
+        BENCHMARK("sd-event/io-dispatch", (uint64_t) arg_n * N_IO_SOURCES,
+                  for (unsigned i = 0; i < arg_n; i++) {
+                          for (unsigned k = 0; k < N_IO_SOURCES; k++)
+                                  ASSERT_EQ(write(pipes[k][1], "x", 1), 1);
+
+                          while (n < (i + 1) * N_IO_SOURCES)
+                                  ASSERT_OK(sd_event_run(e, UINT64_MAX));
+                  });
+
+        e = sd_event_unref(e);
+
+        for (unsigned k = 0; k < N_IO_SOURCES; k++)
+                safe_close_pair(pipes[k]);
+}
+
+static sd_bus_message* build_message(sd_bus *bus, uint64_t cookie) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
+
+        /* Like a StartTransientUnit() call */
+        ASSERT_OK(sd_bus_message_new_method_call(
+                                  bus,
+                                  &m,
+                                  "org.freedesktop.systemd1",
+                                  "/org/freedesktop/systemd1",
+                                  "org.freedesktop.systemd1.Manager",
+                                  "StartTransientUnit"));
+        ASSERT_OK(sd_bus_message_append(
+                                  m,
+                                  "ssa(sv)a(sa(sv))",
+                                  "benchmark.service",
+                                  "fail",
+                                  4,
+                                  "Description", "s", "A benchmark",
+                                  "CPUWeight", "t", UINT64_C(100),
+                                  "Environment", "as", 2, "FOO=1", "BAR=2",
+                                  "ExecStart", "a(sasb)", 1, "/bin/true", 1, "/bin/true", false,
+                                  0));
+        ASSERT_OK(sd_bus_message_seal(m, cookie, 0));
+
+        return TAKE_PTR(m);
+}
+
+static void parse_message(sd_bus_message *m) {
+        const char *name, *mode;
+        int r;
+
+        ASSERT_OK(sd_bus_message_read(m, "ss", &name, &mode));
+
+        ASSERT_OK(sd_bus_message_enter_container(m, 'a', "(sv)"));
+        for (;;) {
+                const char *property;
+
+                r = sd_bus_message_enter_container(m, 'r', "sv");
+                ASSERT_OK(r);
+                if (r == 0)
+                        break;
+
+                ASSERT_OK(sd_bus_message_read(m, "s", &property));
+                ASSERT_OK(sd_bus_message_skip(m, "v"));
+                ASSERT_OK(sd_bus_message_exit_container(m));
+        }
+        ASSERT_OK(sd_bus_message_exit_container(m));
+}
+
+static void bench_bus_marshal(void) {
+        _cleanup_(sd_bus_flush_close_unrefp) sd_bus *bus = NULL;
+        _cleanup_close_pair_ int pair[2] = EBADF_PAIR;
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
+        _cleanup_free_ void *blob = NULL;
+        size_t size;
+
+        ASSERT_OK_ERRNO(socketpair(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0, pair));
+        ASSERT_OK(sd_bus_new(&bus));
+        ASSERT_OK(sd_bus_set_fd(bus, pair[0], pair[0]));
+        TAKE_FD(pair[0]);
+        ASSERT_OK(sd_bus_start(bus));
+
+        BENCHMARK("sd-bus/marshal", arg_n,
+                  for (unsigned i = 0; i < arg_n; i++)
+                          sd_bus_message_unref(build_message(bus, i + 1)));
+
+        m = build_message(bus, 1);
+        ASSERT_OK(bus_message_get_blob(m, &blob, &size));
+
+        /* Includes copying the message, as it is done when reading it from the socket */
+        BENCHMARK("sd-bus/unmarshal", arg_n,
+                  for (unsigned i = 0; i < arg_n; i++) {
+                          _cleanup_(sd_bus_message_unrefp) sd_bus_message *n = NULL;
+                          void *copy;
+
+                          ASSERT_NOT_NULL(copy = memdup(blob, size));
+                          ASSERT_OK(bus_message_from_malloc(bus, copy, size, NULL, 0, NULL, &n));
+                          parse_message(n);
+                  });
+}
+
+int main(int argc, char *argv[]) {
+        test_setup_logging(LOG_INFO);
+
+        if (argc >= 2)
+                ASSERT_OK(safe_atou(argv[1], &arg_n));
+        else
+                arg_n = slow_tests_enabled() ? 1000000 : 10000;
+
+        bench_prioq();
+        bench_calendar_spec();
+        bench_event_io();
+        bench_bus_marshal();
+
+        return 0;
+}
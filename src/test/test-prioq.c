@@ -120,4 +120,65 @@ TEST(struct) {
         assert_se(set_isempty(s));
 }
 
+static uint64_t test_key(const struct test *x) {
+        /* Coarser than the comparison function, so that the latter has to order objects with the same key */
+        return x->value >> 8;
+}
+
+static void test_full_one(prioq_key_func_t key_func, unsigned arity) {
+        _cleanup_(prioq_freep) Prioq *q = NULL;
+        struct test *buffer;
+        unsigned previous = 0;
+
+        log_info("/* %s(key_func=%s, arity=%u) */", __func__, key_func ? "yes" : "no", arity);
+
+        srand(0);
+
+        assert_se(q = prioq_new_full((compare_func_t) test_compare, key_func, arity));
+        assert_se(buffer = new(struct test, SET_SIZE));
+
+        for (unsigned i = 0; i < SET_SIZE; i++) {
+                buffer[i].value = (unsigned) rand() % (SET_SIZE * 16);
+                assert_se(prioq_put(q, buffer + i, &buffer[i].idx) >= 0);
+                assert_se(buffer[i].idx < prioq_size(q));
+        }
+
+        /* Change the values of some of the objects, which requires a reshuffle */
+        for (unsigned i = 0; i < SET_SIZE; i += 3) {
+                buffer[i].value = (unsigned) rand() % (SET_SIZE * 16);
+                prioq_reshuffle(q, buffer + i, &buffer[i].idx);
+        }
+
+        for (unsigned i = 0; i < SET_SIZE; i += 5) {
+                assert_se(prioq_remove(q, buffer + i, &buffer[i].idx) == 1);
+                assert_se(prioq_remove(q, buffer + i, &buffer[i].idx) == 0);
+        }
+
+        for (unsigned i = 0; i < prioq_size(q); i++) {
+                struct test *t = prioq_peek_by_index(q, i);
+
+                assert_se(t->idx == i);
+        }
+
+        for (unsigned i = 0, n = prioq_size(q); i < n; i++) {
+                struct test *t;
+
+                assert_se(t = prioq_pop(q));
+                assert_se(previous <= t->value);
+                previous = t->value;
+        }
+
+        assert_se(prioq_isempty(q));
+        free(buffer);
+}
+
+TEST(full) {
+        unsigned arity;
+
+        FOREACH_ARGUMENT(arity, 2U, 4U, 8U) {
+                test_full_one(NULL, arity);
+                test_full_one((prioq_key_func_t) test_key, arity);
+        }
+}
+
 DEFINE_TEST_MAIN(LOG_INFO);
@@ -67,6 +67,9 @@ static int recurse_dir_callback(
         assert_se(path);
         assert_se(de);
 
+        if (sx && (sx->stx_mask & STATX_TYPE))
+                assert_se(IFTODT(sx->stx_mode) == de->d_type);
+
         switch (event) {
 
         case RECURSE_DIR_ENTRY:
@@ -118,7 +121,7 @@ static int recurse_dir_callback(
 }
 
 int main(int argc, char *argv[]) {
-        _cleanup_strv_free_ char **list_recurse_dir = NULL;
+        _cleanup_strv_free_ char **list_recurse_dir = NULL, **list_type_only = NULL;
         const char *p;
         usec_t t1, t2, t3, t4;
         _cleanup_close_ int fd = -EBADF;
@@ -156,6 +159,11 @@ int main(int argc, char *argv[]) {
 
         log_info("recurse_dir(): %s – nftw(): %s", FORMAT_TIMESPAN(t2 - t1, 1), FORMAT_TIMESPAN(t4 - t3, 1));
 
+        /* Once more asking for the type only, which is taken from the directory entries where possible,
+         * without calling statx(). This needs to find the same entries. */
+        assert_se(lseek(fd, 0, SEEK_SET) == 0);
+        assert_se(recurse_dir(fd, p, STATX_TYPE, UINT_MAX, RECURSE_DIR_SORT|RECURSE_DIR_ENSURE_TYPE|RECURSE_DIR_SAME_MOUNT, recurse_dir_callback, &list_type_only) >= 0);
+
         strv_sort(list_recurse_dir);
         strv_sort(list_nftw);
 
@@ -172,6 +180,9 @@ int main(int argc, char *argv[]) {
                         break;
         }
 
+        strv_sort(list_type_only);
+        assert_se(strv_equal(list_recurse_dir, list_type_only));
+
         list_nftw = strv_free(list_nftw);
         return 0;
 }
@@ -7,6 +7,7 @@
 #include "errno.h"
 #include "hwdb-internal.h"
 #include "nulstr-util.h"
+#include "stdio-util.h"
 #include "tests.h"
 
 TEST(failed_enumerate) {
@@ -54,6 +55,41 @@ TEST(basic_enumerate) {
         assert_se(len1 == len2);
 }
 
+static size_t properties_length(sd_hwdb *hwdb, const char *modalias) {
+        const char *key, *value;
+        size_t len = 0;
+
+        SD_HWDB_FOREACH_PROPERTY(hwdb, modalias, key, value)
+                len += strlen(key) + strlen(value);
+
+        return len;
+}
+
+TEST(cached_lookup) {
+        _cleanup_(sd_hwdb_unrefp) sd_hwdb *hwdb = NULL;
+        size_t len;
+
+        assert_se(sd_hwdb_new(&hwdb) == 0);
+
+        len = properties_length(hwdb, DELL_MODALIAS);
+
+        /* Served from the cache */
+        assert_se(properties_length(hwdb, DELL_MODALIAS) == len);
+        assert_se(properties_length(hwdb, "no-such-modalias-should-exist") == 0);
+        assert_se(properties_length(hwdb, DELL_MODALIAS) == len);
+
+        /* Evict the entry, and look it up again */
+        for (unsigned i = 0; i <= HWDB_CACHE_MAX; i++) {
+                char modalias[STRLEN("no-such-modalias-") + DECIMAL_STR_MAX(unsigned)];
+
+                xsprintf(modalias, "no-such-modalias-%u", i);
+                assert_se(properties_length(hwdb, modalias) == 0);
+        }
+        assert_se(hwdb->n_cache == HWDB_CACHE_MAX);
+
+        assert_se(properties_length(hwdb, DELL_MODALIAS) == len);
+}
+
 TEST(sd_hwdb_new_from_path) {
         _cleanup_(sd_hwdb_unrefp) sd_hwdb *hwdb = NULL;
         int r;
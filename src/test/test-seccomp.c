@@ -878,6 +878,62 @@ TEST(load_syscall_filter_set_raw) {
         assert_se(wait_for_terminate_and_check("syscallrawseccomp", pid, WAIT_LOG) == EXIT_SUCCESS);
 }
 
+TEST(compile_syscall_filter_set_raw) {
+        _cleanup_hashmap_free_ Hashmap *s = NULL;
+        _cleanup_close_ int fd = -EBADF;
+        pid_t pid;
+
+        if (!is_seccomp_available()) {
+                log_notice("Seccomp not available, skipping %s", __func__);
+                return;
+        }
+        if (!have_seccomp_privs()) {
+                log_notice("Not privileged, skipping %s", __func__);
+                return;
+        }
+
+        /* Nothing to compile */
+        assert_se(seccomp_compile_syscall_filter_set_raw(SCMP_ACT_ALLOW, NULL, scmp_act_kill_process(), true, &fd) >= 0);
+        assert_se(fd == -EBADF);
+
+        assert_se(s = hashmap_new(NULL));
+#if defined __NR_access && __NR_access >= 0
+        assert_se(hashmap_put(s, UINT32_TO_PTR(__NR_access + 1), INT_TO_PTR(-1)) >= 0);
+#endif
+#if defined __NR_faccessat && __NR_faccessat >= 0
+        assert_se(hashmap_put(s, UINT32_TO_PTR(__NR_faccessat + 1), INT_TO_PTR(-1)) >= 0);
+#endif
+#if defined __NR_faccessat2 && __NR_faccessat2 >= 0
+        assert_se(hashmap_put(s, UINT32_TO_PTR(__NR_faccessat2 + 1), INT_TO_PTR(-1)) >= 0);
+#endif
+
+        assert_se(seccomp_compile_syscall_filter_set_raw(SCMP_ACT_ALLOW, s, SCMP_ACT_ERRNO(EUCLEAN), true, &fd) >= 0);
+        assert_se(fd >= 0);
+
+        /* Compiling doesn't install anything */
+        assert_se(access("/", F_OK) >= 0);
+
+        /* The same program may be installed by any number of processes */
+        for (unsigned i = 0; i < 2; i++) {
+                pid = fork();
+                assert_se(pid >= 0);
+
+                if (pid == 0) {
+                        assert_se(access("/", F_OK) >= 0);
+                        assert_se(seccomp_load_compiled_filter(fd) >= 0);
+
+                        assert_se(access("/", F_OK) < 0);
+                        assert_se(errno == EUCLEAN);
+
+                        assert_se(poll(NULL, 0, 0) == 0);
+
+                        _exit(EXIT_SUCCESS);
+                }
+
+                assert_se(wait_for_terminate_and_check("syscallcompiledseccomp", pid, WAIT_LOG) == EXIT_SUCCESS);
+        }
+}
+
 TEST(native_syscalls_filtered) {
         pid_t pid;
 
@@ -256,6 +256,75 @@ TEST(serialize_string_set) {
         assert_se(STR_IN_SET(q, "abc def", "ghi jkl"));
 }
 
+TEST(serialize_binary) {
+        _cleanup_(unlink_tempfilep) char fn[] = "/tmp/test-serialize.XXXXXX";
+        _cleanup_fclose_ FILE *f = NULL;
+        char *big;
+
+        assert_se(fmkostemp_safe(fn, "r+", &f) == 0);
+        log_info("/* %s (%s) */", __func__, fn);
+
+        /* A value long enough to need a multi-byte length */
+        big = strndupa_safe(long_string, 300);
+
+        ASSERT_OK(serialize_item(f, "text", "before"));
+        ASSERT_TRUE(serialize_binary_start(f) == f);
+        ASSERT_EQ(serialize_item(f, "a", "bbb"), 1);
+        ASSERT_EQ(serialize_item(f, "a", NULL), 0);
+        ASSERT_EQ(serialize_item(f, "spaces", " x "), 1);
+        ASSERT_EQ(serialize_item_format(f, "n", "%i", 42), 1);
+        ASSERT_EQ(serialize_item(f, "big", big), 1);
+        ASSERT_ERROR(serialize_item(f, "a", long_string), EINVAL);
+        ASSERT_NULL(serialize_binary_stop(f));
+        fputc('\n', f); /* End marker, as written by hand by many serializers */
+        ASSERT_OK(serialize_item(f, "text", "after"));
+
+        rewind(f);
+
+        /* The binary records are not lines */
+        _cleanup_free_ char *raw = NULL;
+        ASSERT_OK(read_full_stream(f, &raw, NULL));
+        ASSERT_TRUE(startswith(raw, "text=before\n"
+                                "\x1e\x05" "a=bbb"
+                                "\x1e\x0a" "spaces= x "
+                                "\x1e\x04" "n=42"
+                                "\x1e\xb0\x02" "big="));
+
+        rewind(f);
+
+        _cleanup_free_ char *l1 = NULL, *l2 = NULL, *l3 = NULL, *l4 = NULL, *l5 = NULL, *l6 = NULL, *l7 = NULL;
+        ASSERT_EQ(deserialize_read_line(f, &l1), 1);
+        ASSERT_STREQ(l1, "text=before");
+        ASSERT_EQ(deserialize_read_line(f, &l2), 1);
+        ASSERT_STREQ(l2, "a=bbb");
+        ASSERT_EQ(deserialize_read_line(f, &l3), 1);
+        ASSERT_STREQ(l3, "spaces= x ");
+        ASSERT_EQ(deserialize_read_line(f, &l4), 1);
+        ASSERT_STREQ(l4, "n=42");
+        ASSERT_EQ(deserialize_read_line(f, &l5), 1);
+        ASSERT_TRUE(startswith(l5, "big="));
+        ASSERT_STREQ(l5 + 4, big);
+        ASSERT_EQ(deserialize_read_line(f, &l6), 0);
+        ASSERT_NULL(l6);
+        ASSERT_EQ(deserialize_read_line(f, &l7), 1);
+        ASSERT_STREQ(l7, "text=after");
+}
+
+TEST(deserialize_binary_truncated) {
+        _cleanup_(unlink_tempfilep) char fn[] = "/tmp/test-serialize.XXXXXX";
+        _cleanup_fclose_ FILE *f = NULL;
+        _cleanup_free_ char *l = NULL;
+
+        assert_se(fmkostemp_safe(fn, "r+", &f) == 0);
+        log_info("/* %s (%s) */", __func__, fn);
+
+        fputs("\x1e\x10" "short", f);
+        rewind(f);
+
+        ASSERT_ERROR(deserialize_read_line(f, &l), EBADMSG);
+        ASSERT_NULL(l);
+}
+
 static int intro(void) {
         memset(long_string, 'x', sizeof(long_string)-1);
         char_array_0(long_string);
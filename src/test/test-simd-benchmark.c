@@ -0,0 +1,108 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include "alloc-util.h"
+#include "hexdecoct.h"
+#include "parse-util.h"
+#include "random-util.h"
+#include "simd-util.h"
+#include "tests.h"
+#include "time-util.h"
+#include "utf8.h"
+
+static size_t arg_size;
+static unsigned arg_n_iterations;
+
+static void report(const char *op, SimdLevel level, size_t size, usec_t t) {
+        log_info("%s/%s: %zu bytes × %u in %s (%.1f MB/s)",
+                 op, simd_level_to_string(level), size, arg_n_iterations, FORMAT_TIMESPAN(t, 1),
+                 (double) size * arg_n_iterations / t);
+}
+
+#define TIME_OP(op, level, size, expr)                                  \
+        ({                                                              \
+                usec_t _n = now(CLOCK_MONOTONIC);                       \
+                for (unsigned _i = 0; _i < arg_n_iterations; _i++)      \
+                        expr;                                           \
+                report(op, level, size, now(CLOCK_MONOTONIC) - _n);     \
+        })
+
+static void test_one(SimdLevel level, const uint8_t *data, const char *ascii, const char *utf8) {
+        _cleanup_free_ char *hex = NULL, *base64 = NULL;
+        /* utf8_is_valid_n() is pure, make sure it is actually called for every iteration */
+        volatile size_t n = arg_size;
+        size_t size;
+
+        ASSERT_OK(simd_level_set(level));
+
+        /* Mostly ASCII, like journal fields, and text in a language that needs a multi-byte character
+         * every few bytes */
+        TIME_OP("utf8-ascii", level, arg_size,
+                assert_se(utf8_is_valid_n(ascii, n)));
+        TIME_OP("utf8-mixed", level, arg_size,
+                assert_se(utf8_is_valid_n(utf8, n)));
+
+        assert_se(hex = hexmem(data, arg_size));
+        ASSERT_OK(base64mem(data, arg_size, &base64));
+
+        TIME_OP("hexmem", level, arg_size,
+                free(ASSERT_PTR(hexmem(data, arg_size))));
+        TIME_OP("unhexmem", level, 2 * arg_size,
+                ({
+                        _cleanup_free_ void *p = NULL;
+
+                        ASSERT_OK(unhexmem(hex, &p, &size));
+                }));
+        TIME_OP("base64mem", level, arg_size,
+                ({
+                        _cleanup_free_ char *p = NULL;
+
+                        ASSERT_OK(base64mem(data, arg_size, &p));
+                }));
+        TIME_OP("base64mem-linebreak", level, arg_size,
+                ({
+                        _cleanup_free_ char *p = NULL;
+
+                        ASSERT_OK(base64mem_full(data, arg_size, 79, &p));
+                }));
+        TIME_OP("unbase64mem", level, strlen(base64),
+                ({
+                        _cleanup_free_ void *p = NULL;
+
+                        ASSERT_OK(unbase64mem(base64, &p, &size));
+                }));
+}
+
+int main(int argc, char *argv[]) {
+        _cleanup_free_ char *ascii = NULL, *utf8 = NULL;
+        _cleanup_free_ uint8_t *data = NULL;
+
+        test_setup_logging(LOG_INFO);
+
+        if (argc >= 2)
+                ASSERT_OK(parse_size(argv[1], 1024, &arg_size));
+        else
+                arg_size = 4096;
+        assert_se(arg_size > 0);
+
+        arg_n_iterations = MAX(slow_tests_enabled() ? 256U * U64_MB / arg_size : 16U * U64_MB / arg_size, 1U);
+
+        assert_se(data = malloc(arg_size));
+        random_bytes(data, arg_size);
+
+        assert_se(ascii = new(char, arg_size));
+        assert_se(utf8 = new(char, arg_size));
+        for (size_t i = 0; i < arg_size; i++)
+                ascii[i] = ' ' + data[i] % 95;
+
+        /* "ü" (2 bytes) after every 8 characters */
+        memcpy(utf8, ascii, arg_size);
+        for (size_t i = 8; i + 1 < arg_size; i += 10) {
+                utf8[i] = (char) 0xc3;
+                utf8[i + 1] = (char) 0xbc;
+        }
+
+        for (SimdLevel level = 0; level <= simd_level_supported(); level++)
+                test_one(level, data, ascii, utf8);
+
+        return 0;
+}
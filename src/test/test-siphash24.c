@@ -104,5 +104,30 @@ TEST(short_hashes) {
         }
 }
 
+TEST(siphash13) {
+        const uint8_t in[15]  = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+                                  0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e };
+        const uint8_t key[16] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+                                  0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+        struct siphash state = {};
+
+        /* Same key and input as in the SipHash paper, but with one compression and three finalization
+         * rounds. The first one is also the first test vector of the Rust sip13 implementation. */
+        siphash13_init(&state, key);
+        assert_se(siphash24_finalize(&state) == 0xabac0158050fc4dc);
+
+        for (size_t i = 0; i < sizeof(in); i++) {
+                siphash13_init(&state, key);
+                siphash24_compress(in, i, &state);
+                siphash24_compress(&in[i], sizeof(in) - i, &state);
+                assert_se(siphash24_finalize(&state) == 0xd320d86d2a519956);
+        }
+
+        /* Make sure the reduced rounds don't leak into the regular SipHash-2-4 */
+        siphash24_init(&state, key);
+        siphash24_compress(in, sizeof(in), &state);
+        assert_se(siphash24_finalize(&state) == 0xa129ca6149be45e5);
+}
+
 /* see https://131002.net/siphash/siphash.pdf, Appendix A */
 DEFINE_TEST_MAIN(LOG_INFO);
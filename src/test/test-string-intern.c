@@ -0,0 +1,98 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include "alloc-util.h"
+#include "string-intern.h"
+#include "string-util.h"
+#include "strv.h"
+#include "tests.h"
+
+static void assert_stats(size_t n_strings, size_t n_refs, size_t bytes_saved) {
+        size_t a, b, c;
+
+        string_intern_stats(&a, &b, &c);
+        ASSERT_EQ(a, n_strings);
+        ASSERT_EQ(b, n_refs);
+        ASSERT_EQ(c, bytes_saved);
+}
+
+TEST(string_intern) {
+        char *a, *b, *c;
+
+        assert_stats(0, 0, 0);
+
+        ASSERT_NOT_NULL(a = string_intern("/usr/lib/systemd/system/foo@.service"));
+        ASSERT_NOT_NULL(b = string_intern("/usr/lib/systemd/system/foo@.service"));
+        ASSERT_NOT_NULL(c = string_intern("/usr/lib/systemd/system/bar.service"));
+
+        ASSERT_TRUE(a == b);
+        ASSERT_TRUE(a != c);
+        ASSERT_STREQ(a, "/usr/lib/systemd/system/foo@.service");
+        ASSERT_STREQ(c, "/usr/lib/systemd/system/bar.service");
+        assert_stats(2, 3, strlen(a) + 1);
+
+        ASSERT_NULL(string_unintern(b));
+        assert_stats(2, 2, 0);
+        ASSERT_STREQ(a, "/usr/lib/systemd/system/foo@.service");
+
+        ASSERT_NULL(string_unintern(a));
+        ASSERT_NULL(string_unintern(c));
+        assert_stats(0, 0, 0);
+
+        /* Strings that have not been interned are simply freed, even if an equal one is in the pool */
+        ASSERT_NOT_NULL(a = string_intern("waldo"));
+        ASSERT_NOT_NULL(b = strdup("waldo"));
+        ASSERT_NULL(string_unintern(b));
+        assert_stats(1, 1, 0);
+        ASSERT_NULL(string_unintern(a));
+        assert_stats(0, 0, 0);
+}
+
+TEST(string_intern_replace) {
+        char *p = NULL, *q = NULL;
+
+        ASSERT_EQ(string_intern_replace(&p, "foo"), 1);
+        ASSERT_EQ(string_intern_replace(&q, "foo"), 1);
+        ASSERT_TRUE(p == q);
+        ASSERT_EQ(string_intern_replace(&p, "foo"), 0);
+        assert_stats(1, 2, 4);
+
+        ASSERT_EQ(string_intern_replace(&p, "bar"), 1);
+        ASSERT_STREQ(p, "bar");
+        ASSERT_STREQ(q, "foo");
+        assert_stats(2, 2, 0);
+
+        /* Replacing a string that has not been interned frees it */
+        q = string_unintern(q);
+        ASSERT_NOT_NULL(q = strdup("bar"));
+        ASSERT_EQ(string_intern_replace(&q, q), 1);
+        ASSERT_TRUE(p == q);
+
+        ASSERT_EQ(string_intern_replace(&p, NULL), 1);
+        ASSERT_NULL(p);
+        q = string_unintern(q);
+        assert_stats(0, 0, 0);
+}
+
+TEST(string_intern_strv) {
+        char **a = NULL, **b = NULL;
+
+        ASSERT_NOT_NULL(a = strv_new("man:foo(1)", "man:bar(8)"));
+        ASSERT_NOT_NULL(b = strv_new("man:foo(1)"));
+
+        ASSERT_OK(string_intern_strv(a));
+        ASSERT_OK(string_intern_strv(b));
+        ASSERT_TRUE(a[0] == b[0]);
+        assert_stats(2, 3, strlen("man:foo(1)") + 1);
+
+        /* Already interned elements are left alone, new ones get interned */
+        ASSERT_OK(strv_extend(&b, "man:bar(8)"));
+        ASSERT_OK(string_intern_strv(b));
+        ASSERT_TRUE(a[1] == b[1]);
+        assert_stats(2, 4, strlen("man:foo(1)") + strlen("man:bar(8)") + 2);
+
+        a = string_unintern_strv(a);
+        b = string_unintern_strv(b);
+        assert_stats(0, 0, 0);
+}
+
+DEFINE_TEST_MAIN(LOG_DEBUG);
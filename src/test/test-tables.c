@@ -76,6 +76,7 @@ int main(int argc, char **argv) {
         test_table(log_target, LOG_TARGET);
         test_table(managed_oom_mode, MANAGED_OOM_MODE);
         test_table(managed_oom_preference, MANAGED_OOM_PREFERENCE);
+        test_table(manager_phase, MANAGER_PHASE);
         test_table(manager_state, MANAGER_STATE);
         test_table(manager_timestamp, MANAGER_TIMESTAMP);
         test_table(mount_exec_command, MOUNT_EXEC_COMMAND);
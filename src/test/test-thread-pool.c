@@ -0,0 +1,207 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "sd-event.h"
+
+#include "fd-util.h"
+#include "process-util.h"
+#include "tests.h"
+#include "thread-pool.h"
+#include "time-util.h"
+
+typedef struct Context {
+        pid_t loop_tid;
+        unsigned n_done;
+        unsigned n_cancelled;
+        int block_fd;
+        int started_fd;
+} Context;
+
+static int work_square(void *userdata) {
+        unsigned *v = ASSERT_PTR(userdata);
+
+        *v = *v * *v;
+        return 7;
+}
+
+static void done_square(ThreadPool *p, int result, void *userdata) {
+        ASSERT_EQ(result, 7);
+        ASSERT_NOT_NULL(userdata);
+}
+
+static int work_nop(void *userdata) {
+        return 0;
+}
+
+static void done_count(ThreadPool *p, int result, void *userdata) {
+        Context *c = ASSERT_PTR(userdata);
+
+        /* Completions are always dispatched on the loop thread */
+        ASSERT_EQ(gettid(), c->loop_tid);
+
+        if (result == -ECANCELED)
+                c->n_cancelled++;
+        else {
+                ASSERT_OK(result);
+                c->n_done++;
+        }
+}
+
+static int work_block(void *userdata) {
+        Context *c = ASSERT_PTR(userdata);
+        char x;
+
+        /* Tell the test that we are running, then wait until we are released */
+        ASSERT_EQ(write(c->started_fd, "x", 1), 1);
+        ASSERT_EQ(read(c->block_fd, &x, 1), 1);
+        return 0;
+}
+
+static void context_open_pipes(Context *c, int block[static 2], int started[static 2]) {
+        ASSERT_OK_ERRNO(pipe2(block, O_CLOEXEC));
+        ASSERT_OK_ERRNO(pipe2(started, O_CLOEXEC));
+
+        *c = (Context) {
+                .loop_tid = gettid(),
+                .block_fd = block[0],
+                .started_fd = started[1],
+        };
+}
+
+static void wait_started(int fd) {
+        char x;
+
+        ASSERT_EQ(read(fd, &x, 1), 1);
+}
+
+TEST(submit) {
+        _cleanup_(sd_event_unrefp) sd_event *e = NULL;
+        _cleanup_(thread_pool_unrefp) ThreadPool *p = NULL;
+        unsigned v[200];
+        Context c = {
+                .loop_tid = gettid(),
+        };
+
+        ASSERT_OK(sd_event_new(&e));
+        ASSERT_OK(thread_pool_new(e, "test-pool", 4, 0, &p));
+
+        for (unsigned i = 0; i < ELEMENTSOF(v); i++) {
+                v[i] = i;
+                ASSERT_OK(thread_pool_submit(p, work_square, done_square, v + i));
+                ASSERT_OK(thread_pool_submit(p, work_nop, done_count, &c));
+        }
+
+        ASSERT_EQ(thread_pool_get_n_pending(p), 2 * ELEMENTSOF(v));
+
+        while (thread_pool_get_n_pending(p) > 0)
+                ASSERT_OK(sd_event_run(e, UINT64_MAX));
+
+        ASSERT_EQ(c.n_done, ELEMENTSOF(v));
+        for (unsigned i = 0; i < ELEMENTSOF(v); i++)
+                ASSERT_EQ(v[i], i * i);
+}
+
+TEST(steal) {
+        _cleanup_(sd_event_unrefp) sd_event *e = NULL;
+        _cleanup_(thread_pool_unrefp) ThreadPool *p = NULL;
+        _cleanup_close_pair_ int block[2] = EBADF_PAIR, started[2] = EBADF_PAIR;
+        Context c;
+
+        context_open_pipes(&c, block, started);
+
+        ASSERT_OK(sd_event_new(&e));
+        ASSERT_OK(thread_pool_new(e, "test-pool", 4, 0, &p));
+
+        /* While one worker is blocked, the items queued to it are taken over by the others */
+        ASSERT_OK(thread_pool_submit(p, work_block, done_count, &c));
+        wait_started(started[0]);
+
+        for (unsigned i = 0; i < 100; i++)
+                ASSERT_OK(thread_pool_submit(p, work_nop, done_count, &c));
+
+        while (c.n_done < 100)
+                ASSERT_OK(sd_event_run(e, UINT64_MAX));
+
+        ASSERT_EQ(thread_pool_get_n_pending(p), 1U);
+
+        ASSERT_EQ(write(block[1], "x", 1), 1);
+
+        while (thread_pool_get_n_pending(p) > 0)
+                ASSERT_OK(sd_event_run(e, UINT64_MAX));
+
+        ASSERT_EQ(c.n_done, 101U);
+}
+
+TEST(queue_full) {
+        _cleanup_(sd_event_unrefp) sd_event *e = NULL;
+        _cleanup_(thread_pool_unrefp) ThreadPool *p = NULL;
+        _cleanup_close_pair_ int block[2] = EBADF_PAIR, started[2] = EBADF_PAIR;
+        Context c;
+
+        context_open_pipes(&c, block, started);
+
+        ASSERT_OK(sd_event_new(&e));
+        ASSERT_OK(thread_pool_new(e, "test-pool", 1, 2, &p));
+
+        ASSERT_OK(thread_pool_submit(p, work_block, done_count, &c));
+        wait_started(started[0]);
+
+        /* The running item does not count, the queued ones do */
+        ASSERT_OK(thread_pool_submit(p, work_nop, done_count, &c));
+        ASSERT_OK(thread_pool_submit(p, work_nop, done_count, &c));
+        ASSERT_ERROR(thread_pool_submit(p, work_nop, done_count, &c), ENOBUFS);
+
+        ASSERT_EQ(write(block[1], "x", 1), 1);
+
+        while (thread_pool_get_n_pending(p) > 0)
+                ASSERT_OK(sd_event_run(e, UINT64_MAX));
+
+        ASSERT_EQ(c.n_done, 3U);
+        ASSERT_OK(thread_pool_submit(p, work_nop, done_count, &c));
+
+        while (thread_pool_get_n_pending(p) > 0)
+                ASSERT_OK(sd_event_run(e, UINT64_MAX));
+
+        ASSERT_EQ(c.n_done, 4U);
+}
+
+static void* release_thread(void *userdata) {
+        int *fd = ASSERT_PTR(userdata);
+
+        /* Give thread_pool_unref() time to stop the pool, it then waits for the running item */
+        (void) usleep_safe(200 * USEC_PER_MSEC);
+        ASSERT_EQ(write(*fd, "x", 1), 1);
+        return NULL;
+}
+
+TEST(cancel) {
+        _cleanup_(sd_event_unrefp) sd_event *e = NULL;
+        _cleanup_close_pair_ int block[2] = EBADF_PAIR, started[2] = EBADF_PAIR;
+        ThreadPool *p;
+        pthread_t t;
+        Context c;
+
+        context_open_pipes(&c, block, started);
+
+        ASSERT_OK(sd_event_new(&e));
+        ASSERT_OK(thread_pool_new(e, "test-pool", 1, 0, &p));
+
+        ASSERT_OK(thread_pool_submit(p, work_block, done_count, &c));
+        wait_started(started[0]);
+
+        for (unsigned i = 0; i < 10; i++)
+                ASSERT_OK(thread_pool_submit(p, work_nop, done_count, &c));
+
+        ASSERT_EQ(pthread_create(&t, NULL, release_thread, &block[1]), 0);
+
+        /* The running item completes, the queued ones are cancelled */
+        ASSERT_NULL(thread_pool_unref(p));
+        ASSERT_EQ(c.n_done, 1U);
+        ASSERT_EQ(c.n_cancelled, 10U);
+
+        ASSERT_EQ(pthread_join(t, NULL), 0);
+}
+
+DEFINE_TEST_MAIN(LOG_DEBUG);
@@ -0,0 +1,120 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include "fileio.h"
+#include "manager.h"
+#include "parse-util.h"
+#include "path-util.h"
+#include "rm-rf.h"
+#include "stdio-util.h"
+#include "tests.h"
+#include "time-util.h"
+#include "tmpfile-util.h"
+#include "unit.h"
+
+/* Builds a transaction of a target wanting N units ordered in a chain, of which every cycle_len-th is also
+ * ordered before the one cycle_len - 1 places earlier in the chain, creating N / cycle_len ordering
+ * cycles that each need a job dropped. Loading the target, which loads all the units it wants from disk,
+ * is measured too. */
+
+static unsigned arg_n_units;
+
+static void write_units(const char *dir, const char *prefix, unsigned n, unsigned cycle_len) {
+        _cleanup_free_ char *wants = NULL;
+        char name[64];
+
+        for (unsigned i = 0; i < n; i++) {
+                _cleanup_free_ char *path = NULL, *contents = NULL;
+
+                xsprintf(name, "%s-%u.target", prefix, i);
+                assert_se(strextend_with_separator(&wants, " ", name));
+
+                contents = strdup("[Unit]\nDefaultDependencies=no\n");
+                assert_se(contents);
+
+                if (i > 0)
+                        assert_se(strextendf(&contents, "After=%s-%u.target\n", prefix, i - 1) >= 0);
+                if (cycle_len > 0 && i % cycle_len == cycle_len - 1)
+                        assert_se(strextendf(&contents, "Before=%s-%u.target\n", prefix, i - (cycle_len - 1)) >= 0);
+
+                assert_se(path = path_join(dir, name));
+                assert_se(write_string_file(path, contents, WRITE_STRING_FILE_CREATE) >= 0);
+        }
+
+        xsprintf(name, "%s.target", prefix);
+        _cleanup_free_ char *path = path_join(dir, name), *contents = NULL;
+        assert_se(path);
+        assert_se(contents = strjoin("[Unit]\nDefaultDependencies=no\nWants=", wants, "\n"));
+        assert_se(write_string_file(path, contents, WRITE_STRING_FILE_CREATE) >= 0);
+}
+
+static void run(Manager *m, const char *prefix, unsigned n, unsigned cycle_len) {
+        _cleanup_(sd_bus_error_free) sd_bus_error err = SD_BUS_ERROR_NULL;
+        char name[64], scenario[64];
+        unsigned n_jobs;
+        usec_t t;
+        Unit *u;
+        Job *j;
+
+        xsprintf(name, "%s.target", prefix);
+
+        t = now(CLOCK_MONOTONIC);
+        assert_se(manager_load_startable_unit_or_warn(m, name, NULL, &u) >= 0);
+        manager_dispatch_load_queue(m);
+        t = now(CLOCK_MONOTONIC) - t;
+
+        xsprintf(scenario, "load/%s", prefix);
+        benchmark_report(scenario, n + 1, t);
+
+        /* Don't count the logging of the cycles */
+        log_set_max_level(LOG_EMERG);
+
+        t = now(CLOCK_MONOTONIC);
+        assert_se(manager_add_job(m, JOB_START, u, JOB_REPLACE, NULL, &err, &j) == 0);
+        t = now(CLOCK_MONOTONIC) - t;
+
+        log_set_max_level(LOG_INFO);
+
+        n_jobs = hashmap_size(m->jobs);
+        manager_clear_jobs(m);
+
+        /* One job is dropped per cycle */
+        assert_se(n_jobs == n + 1 - (cycle_len > 0 ? n / cycle_len : 0));
+
+        xsprintf(scenario, "transaction/%s", prefix);
+        benchmark_report(scenario, n_jobs, t);
+}
+
+int main(int argc, char *argv[]) {
+        _cleanup_(rm_rf_physical_and_freep) char *runtime_dir = NULL, *unit_dir = NULL;
+        _cleanup_(manager_freep) Manager *m = NULL;
+        int r;
+
+        test_setup_logging(LOG_INFO);
+
+        if (argc >= 2)
+                assert_se(safe_atou(argv[1], &arg_n_units) >= 0);
+        else
+                arg_n_units = slow_tests_enabled() ? 5000 : 500;
+
+        r = enter_cgroup_subroot(NULL);
+        if (r == -ENOMEDIUM)
+                return log_tests_skipped("cgroupfs not available");
+
+        assert_se(mkdtemp_malloc("/tmp/test-transaction-benchmark-XXXXXX", &unit_dir) >= 0);
+        write_units(unit_dir, "acyclic", arg_n_units, 0);
+        write_units(unit_dir, "cyclic", arg_n_units, 10);
+
+        assert_se(set_unit_path(unit_dir) >= 0);
+        assert_se(runtime_dir = setup_fake_runtime_dir());
+
+        r = manager_new(RUNTIME_SCOPE_USER, MANAGER_TEST_RUN_BASIC, &m);
+        if (manager_errno_skip_test(r))
+                return log_tests_skipped_errno(r, "manager_new");
+        assert_se(r >= 0);
+        assert_se(manager_startup(m, NULL, NULL, NULL) >= 0);
+
+        run(m, "acyclic", arg_n_units, 0);
+        run(m, "cyclic", arg_n_units, 10);
+
+        return 0;
+}
@@ -1,11 +1,19 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
+#include <sys/stat.h>
+
+#include "fileio.h"
+#include "fs-util.h"
 #include "initrd-util.h"
+#include "mkdir.h"
 #include "path-lookup.h"
+#include "path-util.h"
+#include "rm-rf.h"
 #include "set.h"
 #include "special.h"
 #include "strv.h"
 #include "tests.h"
+#include "tmpfile-util.h"
 #include "unit-file.h"
 
 TEST(unit_validate_alias_symlink_and_warn) {
@@ -86,6 +94,109 @@ TEST(unit_file_build_name_map) {
         }
 }
 
+static void assert_name_maps_equal(Hashmap *ids_a, Hashmap *names_a, Set *paths_a,
+                                   Hashmap *ids_b, Hashmap *names_b, Set *paths_b) {
+        const char *k, *v;
+        char **l;
+
+        ASSERT_EQ(hashmap_size(ids_a), hashmap_size(ids_b));
+        HASHMAP_FOREACH_KEY(v, k, ids_a)
+                ASSERT_STREQ(hashmap_get(ids_b, k), v);
+
+        ASSERT_EQ(hashmap_size(names_a), hashmap_size(names_b));
+        HASHMAP_FOREACH_KEY(l, k, names_a)
+                ASSERT_TRUE(strv_equal(hashmap_get(names_b, k), l));
+
+        ASSERT_TRUE(set_equal(paths_a, paths_b));
+}
+
+static ino_t name_map_cache_inode(const char *dir) {
+        _cleanup_strv_free_ char **files = NULL;
+        _cleanup_free_ char *p = NULL;
+        struct stat st;
+
+        ASSERT_OK(get_files_in_directory(dir, &files));
+        ASSERT_EQ(strv_length(files), 1u);
+
+        p = path_join(dir, files[0]);
+        ASSERT_NOT_NULL(p);
+        ASSERT_OK_ERRNO(stat(p, &st));
+
+        return st.st_ino;
+}
+
+TEST(unit_file_load_or_build_name_map) {
+        _cleanup_(rm_rf_physical_and_freep) char *d = NULL;
+        _cleanup_(lookup_paths_done) LookupPaths lp = {};
+        _cleanup_hashmap_free_ Hashmap *ids = NULL, *names = NULL;
+        _cleanup_set_free_ Set *paths = NULL;
+        _cleanup_free_ char *etc = NULL, *gen = NULL, *usr = NULL, *cache = NULL;
+        uint64_t hash = 0;
+        ino_t ino;
+
+        ASSERT_OK(mkdtemp_malloc("/tmp/test-unit-file-XXXXXX", &d));
+
+        ASSERT_NOT_NULL(etc = path_join(d, "etc"));
+        ASSERT_NOT_NULL(gen = path_join(d, "generator"));
+        ASSERT_NOT_NULL(usr = path_join(d, "usr"));
+        ASSERT_NOT_NULL(cache = path_join(d, "run/unit-name-map"));
+
+        lp.search_path = strv_new(etc, gen, usr);
+        ASSERT_NOT_NULL(lp.search_path);
+        ASSERT_NOT_NULL(lp.generator = strdup(gen));
+        ASSERT_NOT_NULL(lp.runtime_config = path_join(d, "run/system"));
+
+        ASSERT_OK(mkdir_p(etc, 0755));
+        ASSERT_OK(mkdir_p(gen, 0755));
+        ASSERT_OK(mkdir_p(usr, 0755));
+        ASSERT_OK(write_string_file_at(AT_FDCWD, strjoina(usr, "/a.service"), "[Service]", WRITE_STRING_FILE_CREATE));
+        ASSERT_OK(mkdir_p(strjoina(usr, "/a.service.d"), 0755));
+        ASSERT_OK_ERRNO(symlink(strjoina(usr, "/a.service"), strjoina(etc, "/b.service")));
+        ASSERT_OK(write_string_file_at(AT_FDCWD, strjoina(gen, "/g.service"), "[Service]", WRITE_STRING_FILE_CREATE));
+
+        /* The first time around the maps are built, and stored */
+        ASSERT_EQ(unit_file_load_or_build_name_map(&lp, &hash, &ids, &names, &paths), 1);
+        ASSERT_STREQ(hashmap_get(ids, "a.service"), strjoina(usr, "/a.service"));
+        ASSERT_STREQ(hashmap_get(ids, "b.service"), "a.service");
+        ASSERT_STREQ(hashmap_get(ids, "g.service"), strjoina(gen, "/g.service"));
+        ASSERT_TRUE(set_contains(paths, strjoina(usr, "/a.service.d")));
+        ino = name_map_cache_inode(cache);
+
+        /* Nothing changed, the in-memory copy is still good */
+        ASSERT_EQ(unit_file_load_or_build_name_map(&lp, &hash, &ids, &names, &paths), 0);
+
+        /* A fresh process loads the stored maps */
+        {
+                _cleanup_hashmap_free_ Hashmap *ids2 = NULL, *names2 = NULL;
+                _cleanup_set_free_ Set *paths2 = NULL;
+
+                ASSERT_EQ(unit_file_load_or_build_name_map(&lp, NULL, &ids2, &names2, &paths2), 1);
+                assert_name_maps_equal(ids, names, paths, ids2, names2, paths2);
+                ASSERT_EQ(name_map_cache_inode(cache), ino);
+        }
+
+        /* Regenerating the generator directory with the same contents keeps the cache valid */
+        ASSERT_OK(rm_rf(gen, REMOVE_ROOT|REMOVE_PHYSICAL));
+        ASSERT_OK(mkdir_p(gen, 0755));
+        ASSERT_OK(write_string_file_at(AT_FDCWD, strjoina(gen, "/g.service"), "[Service]", WRITE_STRING_FILE_CREATE));
+        {
+                _cleanup_hashmap_free_ Hashmap *ids2 = NULL, *names2 = NULL;
+                _cleanup_set_free_ Set *paths2 = NULL;
+
+                ASSERT_EQ(unit_file_load_or_build_name_map(&lp, NULL, &ids2, &names2, &paths2), 1);
+                assert_name_maps_equal(ids, names, paths, ids2, names2, paths2);
+                ASSERT_EQ(name_map_cache_inode(cache), ino);
+        }
+
+        /* But new units invalidate it */
+        ASSERT_OK(write_string_file_at(AT_FDCWD, strjoina(gen, "/h.service"), "", WRITE_STRING_FILE_CREATE));
+        ASSERT_OK(write_string_file_at(AT_FDCWD, strjoina(usr, "/c.service"), "[Service]", WRITE_STRING_FILE_CREATE));
+        ASSERT_EQ(unit_file_load_or_build_name_map(&lp, NULL, &ids, &names, &paths), 1);
+        ASSERT_NOT_NULL(hashmap_get(ids, "c.service"));
+        ASSERT_NOT_NULL(hashmap_get(ids, "h.service"));
+        ASSERT_NE(name_map_cache_inode(cache), ino);
+}
+
 TEST(runlevel_to_target) {
         in_initrd_force(false);
         ASSERT_STREQ(runlevel_to_target(NULL), NULL);
@@ -1,6 +1,7 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
 #include "alloc-util.h"
+#include "simd-util.h"
 #include "string-util.h"
 #include "strv.h"
 #include "tests.h"
@@ -55,6 +56,74 @@ TEST(ascii_is_valid_n) {
         assert_se( ascii_is_valid_n("\342\204\242", 0));
 }
 
+TEST(ascii_span) {
+        char buf[40];
+
+        ASSERT_EQ(ascii_span("", 0), 0u);
+        ASSERT_EQ(ascii_span("alsdjf\t\vbarr\nba z", 17), 17u);
+        ASSERT_EQ(ascii_span("\342\204\242", 3), 0u);
+
+        /* Put a non-ASCII byte and a NUL byte at every position, so that both the word-wise and the
+         * bytewise paths see them */
+        for (size_t i = 0; i < sizeof(buf); i++) {
+                memset(buf, 'x', sizeof(buf));
+
+                buf[i] = (char) 0x80;
+                ASSERT_EQ(ascii_span(buf, sizeof(buf)), i);
+                ASSERT_FALSE(ascii_is_valid_n(buf, sizeof(buf)));
+                ASSERT_FALSE(utf8_is_valid_n(buf, sizeof(buf)));
+                ASSERT_EQ(ascii_span(buf, i), i);
+
+                buf[i] = 0;
+                ASSERT_EQ(ascii_span(buf, sizeof(buf)), i);
+                ASSERT_FALSE(utf8_is_valid_n(buf, sizeof(buf)));
+
+                /* A valid multi-byte sequence anywhere, also straddling word boundaries */
+                if (i + 3 <= sizeof(buf)) {
+                        memcpy(buf + i, "\342\204\242", 3);
+                        ASSERT_TRUE(utf8_is_valid_n(buf, sizeof(buf)));
+                        ASSERT_FALSE(utf8_is_valid_n(buf, i + 2));
+                }
+        }
+}
+
+TEST(ascii_span_simd) {
+        char buf[150];
+
+        /* Same as above, but with all vector sizes and with vectors of each kind in between */
+        for (SimdLevel level = 0; level <= simd_level_supported(); level++) {
+                log_info("SIMD level: %s", simd_level_to_string(level));
+                ASSERT_OK(simd_level_set(level));
+
+                for (size_t i = 0; i < sizeof(buf); i++) {
+                        memset(buf, 'x', sizeof(buf));
+
+                        ASSERT_EQ(ascii_span(buf, i), i);
+
+                        FOREACH_STRING(c, "\x80", "\xff", "\x7f\x80", "\x01\x00") {
+                                size_t n = strlen(c) + (c[0] == 1);
+
+                                if (i + n > sizeof(buf))
+                                        continue;
+
+                                memcpy(buf + i, c, n);
+                                ASSERT_EQ(ascii_span(buf, sizeof(buf)), i + n - 1);
+                                ASSERT_FALSE(utf8_is_valid_n(buf, sizeof(buf)));
+                                memset(buf + i, 'x', n);
+                        }
+
+                        if (i + 4 <= sizeof(buf)) {
+                                memcpy(buf + i, "\360\237\220\261", 4);
+                                ASSERT_EQ(ascii_span(buf, sizeof(buf)), i);
+                                ASSERT_TRUE(utf8_is_valid_n(buf, sizeof(buf)));
+                                ASSERT_FALSE(utf8_is_valid_n(buf, i + 3));
+                        }
+                }
+        }
+
+        ASSERT_OK(simd_level_set(simd_level_supported()));
+}
+
 static void test_utf8_to_ascii_one(const char *s, int r_expected, const char *expected) {
         _cleanup_free_ char *ans = NULL;
         int r;
@@ -0,0 +1,117 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <pthread.h>
+#include <sys/socket.h>
+
+#include "sd-event.h"
+#include "sd-json.h"
+
+#include "fd-util.h"
+#include "json-util.h"
+#include "parse-util.h"
+#include "stdio-util.h"
+#include "tests.h"
+#include "time-util.h"
+#include "varlink.h"
+
+static usec_t arg_duration;
+
+static int method_echo(Varlink *link, sd_json_variant *parameters, VarlinkMethodFlags flags, void *userdata) {
+        return varlink_reply(link, parameters);
+}
+
+static void *server_thread(void *arg) {
+        _cleanup_(varlink_server_unrefp) VarlinkServer *s = NULL;
+        _cleanup_(sd_event_unrefp) sd_event *e = NULL;
+        int fd = PTR_TO_FD(arg);
+
+        assert_se(sd_event_new(&e) >= 0);
+        assert_se(varlink_server_new(&s, VARLINK_SERVER_ALLOW_BINARY) >= 0);
+        assert_se(varlink_server_bind_method(s, "io.test.Echo", method_echo) >= 0);
+        assert_se(varlink_server_attach_event(s, e, 0) >= 0);
+        assert_se(varlink_server_add_connection(s, fd, NULL) >= 0);
+        assert_se(varlink_server_set_exit_on_idle(s, true) >= 0);
+
+        assert_se(sd_event_loop(e) >= 0);
+        return NULL;
+}
+
+static void run(const char *label, bool binary, sd_json_variant *payload) {
+        _cleanup_(varlink_flush_close_unrefp) Varlink *c = NULL;
+        _cleanup_close_pair_ int fds[2] = EBADF_PAIR;
+        _cleanup_free_ char *text = NULL;
+        unsigned n_calls = 0;
+        usec_t n, t = 0;
+        pthread_t thread;
+
+        assert_se(socketpair(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0, fds) >= 0);
+        assert_se(pthread_create(&thread, NULL, server_thread, FD_TO_PTR(TAKE_FD(fds[1]))) == 0);
+
+        assert_se(varlink_connect_fd(&c, TAKE_FD(fds[0])) >= 0);
+        if (binary)
+                assert_se(varlink_negotiate_binary(c) > 0);
+
+        n = now(CLOCK_MONOTONIC);
+        for (; t < arg_duration; n_calls++, t = now(CLOCK_MONOTONIC) - n) {
+                sd_json_variant *reply = NULL;
+                const char *error_id = NULL;
+
+                assert_se(varlink_call(c, "io.test.Echo", payload, &reply, &error_id) >= 0);
+                assert_se(!error_id);
+                assert_se(sd_json_variant_equal(reply, payload));
+        }
+
+        c = varlink_flush_close_unref(c);
+        assert_se(pthread_join(thread, NULL) == 0);
+
+        assert_se(sd_json_variant_format(payload, 0, &text) >= 0);
+        log_info("%s/%s: %u calls in %.2fs, %.1fµs per round trip, %.2fMiB/s of JSON payload each way",
+                 label, binary ? "binary" : "json", n_calls, t / 1e6, (double) t / n_calls,
+                 (double) n_calls * strlen(text) / 1024 / 1024 / (t / 1e6));
+}
+
+static void build_payloads(sd_json_variant **ret_small, sd_json_variant **ret_large) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *cgroups = NULL;
+
+        assert_se(sd_json_buildo(ret_small, SD_JSON_BUILD_PAIR_UNSIGNED("a", 1)) >= 0);
+
+        /* Modelled after what systemd-oomd and PID 1 exchange */
+        for (unsigned i = 0; i < 64; i++) {
+                char path[STRLEN("/system.slice/service-.service") + DECIMAL_STR_MAX(unsigned)];
+
+                xsprintf(path, "/system.slice/service-%u.service", i);
+
+                assert_se(sd_json_variant_append_arraybo(
+                                        &cgroups,
+                                        SD_JSON_BUILD_PAIR_STRING("mode", i % 2 ? "auto" : "kill"),
+                                        SD_JSON_BUILD_PAIR_STRING("path", path),
+                                        SD_JSON_BUILD_PAIR_STRING("property", "ManagedOOMMemoryPressure"),
+                                        SD_JSON_BUILD_PAIR_UNSIGNED("limit", UINT32_MAX / 100 * 60),
+                                        SD_JSON_BUILD_PAIR_UNSIGNED("duration", 30 * USEC_PER_SEC)) >= 0);
+        }
+
+        assert_se(sd_json_buildo(ret_large, SD_JSON_BUILD_PAIR_VARIANT("cgroups", cgroups)) >= 0);
+}
+
+int main(int argc, char *argv[]) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *small = NULL, *large = NULL;
+
+        test_setup_logging(LOG_INFO);
+
+        if (argc >= 2) {
+                unsigned x;
+
+                assert_se(safe_atou(argv[1], &x) >= 0);
+                arg_duration = x * USEC_PER_SEC;
+        } else
+                arg_duration = slow_tests_enabled() ?
+                        2 * USEC_PER_SEC : USEC_PER_SEC / 50;
+
+        build_payloads(&small, &large);
+
+        FOREACH_STRING(label, "small", "large")
+                for (int binary = 0; binary <= 1; binary++)
+                        run(label, binary, streq(label, "small") ? small : large);
+
+        return 0;
+}
@@ -12,7 +12,10 @@
 #include "varlink-io.systemd.Credentials.h"
 #include "varlink-io.systemd.Import.h"
 #include "varlink-io.systemd.Journal.h"
+#include "varlink-io.systemd.Login.h"
+#include "varlink-io.systemd.MachineImage.h"
 #include "varlink-io.systemd.ManagedOOM.h"
+#include "varlink-io.systemd.Manager.h"
 #include "varlink-io.systemd.MountFileSystem.h"
 #include "varlink-io.systemd.NamespaceResource.h"
 #include "varlink-io.systemd.Network.h"
@@ -157,12 +160,18 @@ TEST(parse_format) {
         print_separator();
         test_parse_format_one(&vl_interface_io_systemd_Journal);
         print_separator();
+        test_parse_format_one(&vl_interface_io_systemd_Login);
+        print_separator();
         test_parse_format_one(&vl_interface_io_systemd_Resolve);
         print_separator();
         test_parse_format_one(&vl_interface_io_systemd_Resolve_Monitor);
         print_separator();
+        test_parse_format_one(&vl_interface_io_systemd_MachineImage);
+        print_separator();
         test_parse_format_one(&vl_interface_io_systemd_ManagedOOM);
         print_separator();
+        test_parse_format_one(&vl_interface_io_systemd_Manager);
+        print_separator();
         test_parse_format_one(&vl_interface_io_systemd_MountFileSystem);
         print_separator();
         test_parse_format_one(&vl_interface_io_systemd_Network);
@@ -51,6 +51,24 @@ static int method_something(Varlink *link, sd_json_variant *parameters, VarlinkM
         return varlink_reply(link, ret);
 }
 
+static pid_t main_tid = 0;
+
+static int method_something_threaded(sd_json_variant *parameters, VarlinkMethodFlags flags, void *userdata, sd_json_variant **ret_reply, const char **ret_error_id) {
+        sd_json_variant *a, *b;
+
+        /* This runs on a worker thread, not on the thread running the event loop */
+        assert_se(gettid() != main_tid);
+
+        a = sd_json_variant_by_key(parameters, "a");
+        b = sd_json_variant_by_key(parameters, "b");
+        if (!a || !b) {
+                *ret_error_id = "io.test.BadParameters";
+                return 0;
+        }
+
+        return sd_json_buildo(ret_reply, SD_JSON_BUILD_PAIR("sum", SD_JSON_BUILD_INTEGER(sd_json_variant_integer(a) + sd_json_variant_integer(b))));
+}
+
 static int method_something_more(Varlink *link, sd_json_variant *parameters, VarlinkMethodFlags flags, void *userdata) {
         _cleanup_(sd_json_variant_unrefp) sd_json_variant *ret = NULL;
         int r;
@@ -237,6 +255,104 @@ static void flood_test(const char *address) {
                 connections[k] = varlink_unref(connections[k]);
 }
 
+#define N_PIPELINED 16U
+
+typedef struct PipelinedCall {
+        unsigned index;
+        int64_t sum;
+        bool not_found;
+} PipelinedCall;
+
+static unsigned n_pipelined_replies = 0;
+
+static int pipelined_reply(Varlink *link, sd_json_variant *parameters, const char *error_id, VarlinkReplyFlags flags, void *userdata) {
+        PipelinedCall *c = ASSERT_PTR(userdata);
+
+        /* Replies must be matched up with the calls in order */
+        ASSERT_EQ(c->index, n_pipelined_replies);
+        n_pipelined_replies++;
+
+        c->sum = sd_json_variant_integer(sd_json_variant_by_key(parameters, "sum"));
+        c->not_found = streq_ptr(error_id, VARLINK_ERROR_METHOD_NOT_FOUND);
+        return 0;
+}
+
+static void pipeline_test(Varlink *c, const char *method) {
+        PipelinedCall calls[N_PIPELINED + 1] = {};
+
+        /* Issue a bunch of calls at once, and only then start processing the replies */
+        for (unsigned i = 0; i < N_PIPELINED; i++) {
+                _cleanup_(sd_json_variant_unrefp) sd_json_variant *p = NULL;
+
+                calls[i].index = i;
+                ASSERT_OK(sd_json_buildo(&p,
+                                         SD_JSON_BUILD_PAIR("a", SD_JSON_BUILD_INTEGER(i)),
+                                         SD_JSON_BUILD_PAIR("b", SD_JSON_BUILD_INTEGER(1000))));
+                ASSERT_OK(varlink_invoke_full(c, method, p, pipelined_reply, calls + i));
+
+                /* One without a callback of its own in between, whose reply goes to the bound callback
+                 * (there is none here), and must not get into the way of the others */
+                if (i == N_PIPELINED / 2)
+                        ASSERT_OK(varlink_invoke(c, method, p));
+        }
+
+        calls[N_PIPELINED].index = N_PIPELINED;
+        ASSERT_OK(varlink_invoke_full(c, "io.test.IDontExist", NULL, pipelined_reply, calls + N_PIPELINED));
+
+        while (n_pipelined_replies < N_PIPELINED + 1) {
+                int r;
+
+                r = varlink_process(c);
+                ASSERT_OK(r);
+                if (r == 0)
+                        ASSERT_OK(varlink_wait(c, USEC_INFINITY));
+        }
+
+        for (unsigned i = 0; i < N_PIPELINED; i++) {
+                ASSERT_EQ(calls[i].sum, (int64_t) (i + 1000));
+                ASSERT_FALSE(calls[i].not_found);
+        }
+        ASSERT_TRUE(calls[N_PIPELINED].not_found);
+}
+
+static void check_statistics(VarlinkServer *s) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *methods = NULL, *connections = NULL;
+        sd_json_variant *m;
+        unsigned n_found = 0;
+
+        ASSERT_OK(varlink_server_get_statistics(s, &methods, &connections));
+        ASSERT_TRUE(sd_json_variant_is_array(connections));
+
+        JSON_VARIANT_ARRAY_FOREACH(m, methods) {
+                const char *method = sd_json_variant_string(sd_json_variant_by_key(m, "method"));
+                uint64_t calls = sd_json_variant_unsigned(sd_json_variant_by_key(m, "calls")), sum = 0, k = 0;
+                sd_json_variant *h;
+
+                log_debug("%s(): %" PRIu64 " calls", method, calls);
+
+                ASSERT_EQ(sd_json_variant_unsigned(sd_json_variant_by_key(m, "inFlight")), 0u);
+
+                JSON_VARIANT_ARRAY_FOREACH(h, sd_json_variant_by_key(m, "latencyHistogram")) {
+                        sum += sd_json_variant_unsigned(h);
+                        k++;
+                }
+                ASSERT_EQ(sum, calls);
+                ASSERT_GT(k, 0u);
+
+                /* The pipelined calls plus the synchronous ones */
+                if (streq(method, "io.test.DoSomething")) {
+                        ASSERT_GE(calls, (uint64_t) N_PIPELINED);
+                        n_found++;
+                } else if (streq(method, "io.test.DoSomethingThreaded")) {
+                        ASSERT_EQ(calls, (uint64_t) N_PIPELINED + 1 + 2);
+                        ASSERT_EQ(sd_json_variant_unsigned(sd_json_variant_by_key(m, "errors")), 1u);
+                        n_found++;
+                }
+        }
+
+        ASSERT_EQ(n_found, 2u);
+}
+
 static void *thread(void *arg) {
         _cleanup_(varlink_flush_close_unrefp) Varlink *c = NULL;
         _cleanup_(sd_json_variant_unrefp) sd_json_variant *i = NULL;
@@ -254,6 +370,9 @@ static void *thread(void *arg) {
         assert_se(varlink_set_allow_fd_passing_input(c, true) >= 0);
         assert_se(varlink_set_allow_fd_passing_output(c, true) >= 0);
 
+        /* Everything from now on on this connection uses the binary encoding */
+        assert_se(varlink_negotiate_binary(c) > 0);
+
         /* Test that client is able to perform two sequential varlink_collect calls if first resulted in an error */
         assert_se(sd_json_build(&wrong, SD_JSON_BUILD_OBJECT(SD_JSON_BUILD_PAIR("a", SD_JSON_BUILD_INTEGER(88)),
                                                        SD_JSON_BUILD_PAIR("c", SD_JSON_BUILD_INTEGER(99)))) >= 0);
@@ -303,6 +422,23 @@ static void *thread(void *arg) {
         ASSERT_STREQ(sd_json_variant_string(sd_json_variant_by_key(o, "method")), "io.test.IDontExist");
         ASSERT_STREQ(e, VARLINK_ERROR_METHOD_NOT_FOUND);
 
+        pipeline_test(c, "io.test.DoSomething");
+
+        /* Same for a method that is processed on the worker threads */
+        n_pipelined_replies = 0;
+        pipeline_test(c, "io.test.DoSomethingThreaded");
+
+        assert_se(varlink_call(c, "io.test.DoSomethingThreaded", i, &o, &e) >= 0);
+        assert_se(sd_json_variant_integer(sd_json_variant_by_key(o, "sum")) == 88 + 99);
+        assert_se(!e);
+
+        assert_se(varlink_call(c, "io.test.DoSomethingThreaded", wrong, &o, &e) >= 0);
+        ASSERT_STREQ(e, "io.test.BadParameters");
+
+        /* The connection is idle again now, hence synchronous calls work again */
+        assert_se(varlink_call(c, "io.test.DoSomething", i, &o, &e) >= 0);
+        assert_se(sd_json_variant_integer(sd_json_variant_by_key(o, "sum")) == 88 + 99);
+
         flood_test(arg);
 
         assert_se(varlink_send(c, "io.test.Done", NULL) >= 0);
@@ -340,6 +476,8 @@ int main(int argc, char *argv[]) {
 
         test_setup_logging(LOG_DEBUG);
 
+        main_tid = gettid();
+
         assert_se(mkdtemp_malloc("/tmp/varlink-test-XXXXXX", &tmpdir) >= 0);
         sp = strjoina(tmpdir, "/socket");
 
@@ -350,13 +488,17 @@ int main(int argc, char *argv[]) {
         assert_se(sd_event_source_set_priority(block_event, SD_EVENT_PRIORITY_IMPORTANT) >= 0);
         block_write_fd = TAKE_FD(block_fds[1]);
 
-        assert_se(varlink_server_new(&s, VARLINK_SERVER_ACCOUNT_UID) >= 0);
+        assert_se(varlink_server_new(&s, VARLINK_SERVER_ACCOUNT_UID|VARLINK_SERVER_ALLOW_BINARY) >= 0);
         assert_se(varlink_server_set_description(s, "our-server") >= 0);
 
         assert_se(varlink_server_bind_method(s, "io.test.PassFD", method_passfd) >= 0);
         assert_se(varlink_server_bind_method(s, "io.test.DoSomething", method_something) >= 0);
         assert_se(varlink_server_bind_method(s, "io.test.DoSomethingMore", method_something_more) >= 0);
         assert_se(varlink_server_bind_method(s, "io.test.Done", method_done) >= 0);
+        assert_se(varlink_server_bind_method_threaded(s, "io.test.DoSomethingThreaded", method_something_threaded) >= 0);
+        assert_se(varlink_server_bind_method_threaded(s, "io.test.DoSomething", method_something_threaded) == -EEXIST);
+        assert_se(varlink_server_set_worker_threads(s, 4) >= 0);
+        assert_se(varlink_server_set_statistics(s, true) >= 0);
         assert_se(varlink_server_bind_connect(s, on_connect) >= 0);
         assert_se(varlink_server_listen_address(s, sp, 0600) >= 0);
         assert_se(varlink_server_attach_event(s, e, 0) >= 0);
@@ -379,5 +521,7 @@ int main(int argc, char *argv[]) {
 
         assert_se(pthread_join(t, NULL) == 0);
 
+        check_statistics(s);
+
         return 0;
 }
@@ -9,6 +9,8 @@
 #include <sys/timerfd.h>
 #include <sys/timex.h>
 #include <sys/types.h>
+#include <linux/errqueue.h> /* needs struct timespec declared first */
+#include <linux/net_tstamp.h>
 
 #include "sd-daemon.h"
 #include "sd-messages.h"
@@ -80,6 +82,14 @@ static double ts_to_d(const struct timespec *ts) {
         return ts->tv_sec + (1.0e-9 * ts->tv_nsec);
 }
 
+static double ntp_sample_delay(const NTPSample *s) {
+        assert(s);
+
+        /* d = (T4 - T1) - (T3 - T2), see manager_receive_response() */
+        return (ts_to_d(&s->dest_time) - ts_to_d(&s->origin_time)) -
+                (ntp_ts_to_d(&s->ntpmsg.trans_time) - ntp_ts_to_d(&s->ntpmsg.recv_time));
+}
+
 static int manager_timeout(sd_event_source *source, usec_t usec, void *userdata) {
         _cleanup_free_ char *pretty = NULL;
         Manager *m = ASSERT_PTR(userdata);
@@ -132,13 +142,17 @@ static int manager_send_request(Manager *m) {
 
         /*
          * Record the transmit timestamp. This should be as close as possible to
-         * the send-to to ensure the timestamp is reasonably accurate
+         * the send-to to ensure the timestamp is reasonably accurate. If the kernel
+         * supports it, this is replaced by the time the packet actually left, once
+         * we get that from the socket's error queue, see manager_receive_tx_timestamp()
          */
         assert_se(clock_gettime(CLOCK_BOOTTIME, &m->trans_time_mon) >= 0);
         assert_se(clock_gettime(CLOCK_REALTIME, &m->trans_time) >= 0);
+        m->tx_timestamped = false;
 
         len = sendto(m->server_socket, &ntpmsg, sizeof(ntpmsg), MSG_DONTWAIT, &m->current_server_address->sockaddr.sa, m->current_server_address->socklen);
         if (len == sizeof(ntpmsg)) {
+                m->n_sent++;
                 m->pending = true;
                 log_debug("Sent NTP request to %s (%s).", strna(pretty), m->current_server_name->string);
         } else {
@@ -389,6 +403,110 @@ static void manager_adjust_poll(Manager *m, double offset, bool spike) {
         }
 }
 
+static int manager_receive_tx_timestamp(Manager *m, int fd) {
+        int r;
+
+        assert(m);
+        assert(fd >= 0);
+
+        /* With SO_TIMESTAMPING the kernel reports the time our request was handed to the network device
+         * driver via the socket's error queue. That's more accurate than what we took before sendto(), as it
+         * doesn't include the time we spent getting scheduled, going through the network stack and waiting
+         * in the queueing discipline. */
+
+        for (;;) {
+                CMSG_BUFFER_TYPE(CMSG_SPACE(3 * sizeof(struct timespec_large)) +
+                                 CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(union sockaddr_union))) control = {};
+                struct msghdr msghdr = {
+                        .msg_control = &control,
+                        .msg_controllen = sizeof(control),
+                };
+                struct sock_extended_err *ee = NULL;
+                struct scm_timestamping *tss;
+                struct cmsghdr *cmsg;
+                ssize_t len;
+
+                len = recvmsg_safe(fd, &msghdr, MSG_ERRQUEUE|MSG_DONTWAIT);
+                if (len == -EAGAIN)
+                        return 0;
+                if (len < 0)
+                        return len;
+
+                CMSG_FOREACH(cmsg, &msghdr)
+                        if ((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+                            (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR))
+                                ee = CMSG_TYPED_DATA(cmsg, struct sock_extended_err);
+
+                if (!ee)
+                        continue;
+                if (ee->ee_origin != SO_EE_ORIGIN_TIMESTAMPING) {
+                        r = ee->ee_errno > 0 ? -(int) ee->ee_errno : -EIO;
+                        return log_debug_errno(r, "Received error from socket error queue: %m");
+                }
+
+                /* Ignore timestamps of earlier packets, we only care about the last one we sent */
+                if (!m->pending || ee->ee_data != m->n_sent - 1)
+                        continue;
+
+                tss = CMSG_FIND_AND_COPY_DATA(&msghdr, SOL_SOCKET, SCM_TIMESTAMPING, struct scm_timestamping);
+                if (!tss || timespec_load(&tss->ts[0]) == 0)
+                        continue;
+
+                log_debug("Packet left %.3f ms after we took the transmit timestamp.",
+                          (ts_to_d(&tss->ts[0]) - ts_to_d(&m->trans_time)) * 1e3);
+
+                m->trans_time = tss->ts[0];
+                m->tx_timestamped = true;
+        }
+}
+
+static int manager_burst_sample(Manager *m, struct ntp_msg *ntpmsg, struct timespec *origin_time, struct timespec *dest_time) {
+        const NTPSample *best = NULL;
+        int r;
+
+        assert(m);
+        assert(ntpmsg);
+        assert(origin_time);
+        assert(dest_time);
+        assert(m->burst_idx < MIN(m->poll_samples, ELEMENTSOF(m->burst)));
+
+        /* Collects one sample of a burst. Returns 0 if there are more to come, and > 0 once the burst is
+         * complete, in which case the sample with the shortest round trip is returned in the arguments.
+         * The delay mostly varies due to queueing on the way to the server and back, which biases the
+         * offset, so the fastest sample is the most accurate one. */
+
+        m->burst[m->burst_idx++] = (NTPSample) {
+                .ntpmsg = *ntpmsg,
+                .origin_time = *origin_time,
+                .dest_time = *dest_time,
+        };
+
+        if (m->burst_idx < m->poll_samples) {
+                log_debug("Received sample %u of %u, delay %.6f sec.",
+                          m->burst_idx, m->poll_samples, ntp_sample_delay(&m->burst[m->burst_idx - 1]));
+
+                r = manager_arm_timer(m, NTP_POLL_SAMPLES_INTERVAL_USEC);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to rearm timer: %m");
+
+                return 0;
+        }
+
+        FOREACH_ARRAY(s, m->burst, m->burst_idx)
+                if (!best || ntp_sample_delay(s) < ntp_sample_delay(best))
+                        best = s;
+
+        log_debug("Using sample %zu of %u with the lowest delay of %.6f sec.",
+                  (size_t) (best - m->burst) + 1, m->burst_idx, ntp_sample_delay(best));
+
+        *ntpmsg = best->ntpmsg;
+        *origin_time = best->origin_time;
+        *dest_time = best->dest_time;
+
+        m->burst_idx = 0;
+        return 1;
+}
+
 static int manager_receive_response(sd_event_source *source, int fd, uint32_t revents, void *userdata) {
         Manager *m = ASSERT_PTR(userdata);
         struct ntp_msg ntpmsg;
@@ -397,8 +515,9 @@ static int manager_receive_response(sd_event_source *source, int fd, uint32_t re
                 .iov_base = &ntpmsg,
                 .iov_len = sizeof(ntpmsg),
         };
-        /* This needs to be initialized with zero. See #20741. */
-        CMSG_BUFFER_TYPE(CMSG_SPACE_TIMESPEC) control = {};
+        /* This needs to be initialized with zero. See #20741. Leave room for the SCM_TIMESTAMPING
+         * message the kernel might attach too, once SO_TIMESTAMPING is enabled. */
+        CMSG_BUFFER_TYPE(CMSG_SPACE_TIMESPEC + CMSG_SPACE(3 * sizeof(struct timespec_large))) control = {};
         union sockaddr_union server_addr;
         struct msghdr msghdr = {
                 .msg_iov = &iov,
@@ -408,7 +527,7 @@ static int manager_receive_response(sd_event_source *source, int fd, uint32_t re
                 .msg_name = &server_addr,
                 .msg_namelen = sizeof(server_addr),
         };
-        struct timespec *recv_time;
+        struct timespec *recv_time, origin_time, dest_time;
         triple_timestamp dts;
         ssize_t len;
         double origin, receive, trans, dest, delay, offset, root_distance;
@@ -417,11 +536,23 @@ static int manager_receive_response(sd_event_source *source, int fd, uint32_t re
 
         assert(source);
 
-        if (revents & (EPOLLHUP|EPOLLERR)) {
+        /* Transmit timestamps are queued on the error queue, hence we get EPOLLERR for them */
+        if (revents & EPOLLERR) {
+                r = manager_receive_tx_timestamp(m, fd);
+                if (r < 0) {
+                        log_warning_errno(r, "Server connection returned error: %m");
+                        return manager_connect(m);
+                }
+        }
+
+        if (revents & EPOLLHUP) {
                 log_warning("Server connection returned error.");
                 return manager_connect(m);
         }
 
+        if (!(revents & EPOLLIN))
+                return 0;
+
         len = recvmsg_safe(fd, &msghdr, MSG_DONTWAIT);
         if (len == -EAGAIN)
                 return 0;
@@ -497,6 +628,17 @@ static int manager_receive_response(sd_event_source *source, int fd, uint32_t re
         /* Stop listening */
         manager_listen_stop(m);
 
+        origin_time = m->trans_time;
+        dest_time = *recv_time;
+
+        if (m->poll_samples > 1) {
+                r = manager_burst_sample(m, &ntpmsg, &origin_time, &dest_time);
+                if (r <= 0)
+                        return r;
+
+                root_distance = ntp_ts_short_to_d(&ntpmsg.root_delay) / 2 + ntp_ts_short_to_d(&ntpmsg.root_dispersion);
+        }
+
         /* announce leap seconds */
         if (NTP_FIELD_LEAP(ntpmsg.field) & NTP_LEAP_PLUSSEC)
                 leap_sec = 1;
@@ -516,10 +658,10 @@ static int manager_receive_response(sd_event_source *source, int fd, uint32_t re
          *  The round-trip delay, d, and system clock offset, t, are defined as:
          *  d = (T4 - T1) - (T3 - T2)     t = ((T2 - T1) + (T3 - T4)) / 2"
          */
-        origin = ts_to_d(&m->trans_time) + OFFSET_1900_1970;
+        origin = ts_to_d(&origin_time) + OFFSET_1900_1970;
         receive = ntp_ts_to_d(&ntpmsg.recv_time);
         trans = ntp_ts_to_d(&ntpmsg.trans_time);
-        dest = ts_to_d(recv_time) + OFFSET_1900_1970;
+        dest = ts_to_d(&dest_time) + OFFSET_1900_1970;
 
         offset = ((receive - origin) + (trans - dest)) / 2;
         delay = (dest - origin) - (trans - receive);
@@ -536,7 +678,7 @@ static int manager_receive_response(sd_event_source *source, int fd, uint32_t re
                   "  precision    : %.6f sec (%i)\n"
                   "  root distance: %.6f sec\n"
                   "  reference    : %.4s\n"
-                  "  origin       : %.3f\n"
+                  "  origin       : %.3f%s\n"
                   "  receive      : %.3f\n"
                   "  transmit     : %.3f\n"
                   "  dest         : %.3f\n"
@@ -552,7 +694,7 @@ static int manager_receive_response(sd_event_source *source, int fd, uint32_t re
                   exp2(ntpmsg.precision), ntpmsg.precision,
                   root_distance,
                   ntpmsg.stratum == 1 ? ntpmsg.refid : "n/a",
-                  origin - OFFSET_1900_1970,
+                  origin - OFFSET_1900_1970, m->tx_timestamped ? " (kernel)" : "",
                   receive - OFFSET_1900_1970,
                   trans - OFFSET_1900_1970,
                   dest - OFFSET_1900_1970,
@@ -582,8 +724,8 @@ static int manager_receive_response(sd_event_source *source, int fd, uint32_t re
 
         /* Save NTP response */
         m->ntpmsg = ntpmsg;
-        m->origin_time = m->trans_time;
-        m->dest_time = *recv_time;
+        m->origin_time = origin_time;
+        m->dest_time = dest_time;
         m->spike = spike;
 
         log_debug("interval/delta/delay/jitter/drift " USEC_FMT "s/%+.3fs/%.3fs/%.3fs/%+"PRIi64"ppm%s",
@@ -654,9 +796,26 @@ static int manager_listen_setup(Manager *m) {
         if (r < 0)
                 return r;
 
+        /* Ask for the time our requests actually leave, as taken by the network driver. We'd prefer
+         * hardware timestamps, but those are in the time base of the network card's clock, which we have no
+         * way to relate to the system clock. Older kernels and some drivers don't support this, in which
+         * case we stick to the timestamps we take ourselves. */
+        m->n_sent = 0;
+        r = setsockopt_int(m->server_socket, SOL_SOCKET, SO_TIMESTAMPING,
+                           SOF_TIMESTAMPING_TX_SOFTWARE|SOF_TIMESTAMPING_SOFTWARE|
+                           SOF_TIMESTAMPING_OPT_ID|SOF_TIMESTAMPING_OPT_TSONLY);
+        if (r < 0)
+                log_debug_errno(r, "Failed to enable transmit timestamps, ignoring: %m");
+
         (void) socket_set_option(m->server_socket, addr.sa.sa_family, IP_TOS, IPV6_TCLASS, IPTOS_DSCP_EF);
 
-        return sd_event_add_io(m->event, &m->event_receive, m->server_socket, EPOLLIN, manager_receive_response, m);
+        r = sd_event_add_io(m->event, &m->event_receive, m->server_socket, EPOLLIN, manager_receive_response, m);
+        if (r < 0)
+                return r;
+
+        /* Receive timestamps are taken by the kernel, but transmit timestamps might not be, so make sure we
+         * don't lag behind other events on the way to sendto() */
+        return sd_event_source_set_priority(m->event_receive, SD_EVENT_PRIORITY_IMPORTANT);
 }
 
 static void manager_listen_stop(Manager *m) {
@@ -676,6 +835,7 @@ static int manager_begin(Manager *m) {
 
         m->talking = false;
         m->missed_replies = NTP_MAX_MISSED_REPLIES;
+        m->burst_idx = 0;
         if (m->poll_interval_usec == 0)
                 m->poll_interval_usec = m->poll_interval_min_usec;
 
@@ -1108,6 +1268,7 @@ int manager_new(Manager **ret) {
                 .root_distance_max_usec = NTP_ROOT_DISTANCE_MAX_USEC,
                 .poll_interval_min_usec = NTP_POLL_INTERVAL_MIN_USEC,
                 .poll_interval_max_usec = NTP_POLL_INTERVAL_MAX_USEC,
+                .poll_samples = 1,
 
                 .connection_retry_usec = DEFAULT_CONNECTION_RETRY_USEC,
 
@@ -32,6 +32,15 @@ typedef struct Manager Manager;
 
 #define DEFAULT_SAVE_TIME_INTERVAL_USEC (60 * USEC_PER_SEC)
 
+/* Maximum number of requests sent per poll, and the interval between them */
+#define NTP_POLL_SAMPLES_MAX            8U
+#define NTP_POLL_SAMPLES_INTERVAL_USEC  (2 * USEC_PER_SEC)
+
+typedef struct NTPSample {
+        struct ntp_msg ntpmsg;
+        struct timespec origin_time, dest_time;
+} NTPSample;
+
 struct Manager {
         sd_bus *bus;
         sd_event *event;
@@ -71,6 +80,8 @@ struct Manager {
         usec_t retry_interval;
         usec_t connection_retry_usec;
         bool pending;
+        uint32_t n_sent;      /* Number of packets sent on server_socket, to match up transmit timestamps */
+        bool tx_timestamped;  /* trans_time was reported by the kernel */
 
         /* poll timer */
         sd_event_source *event_timer;
@@ -79,6 +90,11 @@ struct Manager {
         usec_t poll_interval_max_usec;
         bool poll_resync;
 
+        /* samples collected during the current poll, of which the one with the lowest delay is used */
+        unsigned poll_samples;
+        NTPSample burst[NTP_POLL_SAMPLES_MAX];
+        unsigned burst_idx;
+
         /* history data */
         struct {
                 double offset;
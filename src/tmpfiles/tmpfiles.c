@@ -56,6 +56,7 @@
 #include "path-lookup.h"
 #include "path-util.h"
 #include "pretty-print.h"
+#include "process-util.h"
 #include "rlimit-util.h"
 #include "rm-rf.h"
 #include "selinux-util.h"
@@ -210,6 +211,7 @@ static char *arg_root = NULL;
 static char *arg_image = NULL;
 static char *arg_replace = NULL;
 static ImagePolicy *arg_image_policy = NULL;
+static unsigned arg_jobs = 1;
 
 #define MAX_DEPTH 256
 
@@ -1960,7 +1962,7 @@ static int copy_files(Context *c, Item *i) {
                          dfd, bn,
                          i->uid_set ? i->uid : UID_INVALID,
                          i->gid_set ? i->gid : GID_INVALID,
-                         COPY_REFLINK | ((i->append_or_force) ? COPY_MERGE : COPY_MERGE_EMPTY) | COPY_MAC_CREATE | COPY_HARDLINKS,
+                         COPY_REFLINK | ((i->append_or_force) ? COPY_MERGE : COPY_MERGE_EMPTY) | COPY_MAC_CREATE | COPY_HARDLINKS | COPY_PARALLEL,
                          NULL, NULL);
 
         fd = openat(dfd, bn, O_NOFOLLOW|O_CLOEXEC|O_PATH);
@@ -3279,6 +3281,124 @@ static int process_item_array(
         return r;
 }
 
+static ItemArray* item_array_root(ItemArray *a) {
+        assert(a);
+
+        while (a->parent)
+                a = a->parent;
+
+        return a;
+}
+
+static int process_items(Context *c, OperationMask operation, Hashmap *jobs, unsigned job) {
+        ItemArray *a;
+        int r = 0, k;
+
+        assert(c);
+
+        /* If 'jobs' is set, only the item arrays of the trees assigned to 'job' are processed */
+
+        /* The non-globbing ones usually create things, hence we apply them first */
+        ORDERED_HASHMAP_FOREACH(a, c->items) {
+                if (jobs && PTR_TO_UINT(hashmap_get(jobs, item_array_root(a))) != job + 1)
+                        continue;
+
+                k = process_item_array(c, a, operation);
+                if (k < 0 && r >= 0)
+                        r = k;
+        }
+
+        /* The globbing ones usually alter things, hence we apply them second. */
+        ORDERED_HASHMAP_FOREACH(a, c->globs) {
+                if (jobs && PTR_TO_UINT(hashmap_get(jobs, item_array_root(a))) != job + 1)
+                        continue;
+
+                k = process_item_array(c, a, operation);
+                if (k < 0 && r >= 0)
+                        r = k;
+        }
+
+        return r;
+}
+
+static int assign_job(Hashmap **jobs, ItemArray *a, unsigned *n_trees) {
+        ItemArray *root;
+
+        assert(jobs);
+        assert(a);
+        assert(n_trees);
+
+        root = item_array_root(a);
+        if (hashmap_contains(*jobs, root))
+                return 0;
+
+        if (hashmap_ensure_put(jobs, NULL, root, UINT_TO_PTR(*n_trees % arg_jobs + 1)) < 0)
+                return log_oom();
+
+        (*n_trees)++;
+        return 0;
+}
+
+static int process_items_parallel(Context *c, OperationMask operation) {
+        _cleanup_hashmap_free_ Hashmap *jobs = NULL;
+        _cleanup_free_ pid_t *pids = NULL;
+        unsigned n_trees = 0, n_jobs;
+        ItemArray *a;
+        int r = 0, k;
+
+        assert(c);
+
+        /* The trees of item arrays, i.e. an item array without a parent and everything below it, are
+         * independent of each other, since parents are created before and cleaned up after their children
+         * only. Hence distribute the trees among the jobs round-robin, and let each job process its trees,
+         * in the usual order, in a child process of its own. */
+
+        ORDERED_HASHMAP_FOREACH(a, c->items) {
+                r = assign_job(&jobs, a, &n_trees);
+                if (r < 0)
+                        return r;
+        }
+        ORDERED_HASHMAP_FOREACH(a, c->globs) {
+                r = assign_job(&jobs, a, &n_trees);
+                if (r < 0)
+                        return r;
+        }
+
+        n_jobs = MIN(arg_jobs, n_trees);
+        if (n_jobs <= 1)
+                return process_items(c, operation, /* jobs= */ NULL, 0);
+
+        pids = new(pid_t, n_jobs);
+        if (!pids)
+                return log_oom();
+
+        for (unsigned job = 0; job < n_jobs; job++) {
+                r = safe_fork("(sd-tmpfiles)", FORK_RESET_SIGNALS|FORK_DEATHSIG_SIGTERM|FORK_LOG, pids + job);
+                if (r < 0) {
+                        /* Wait for the jobs that are already running, doing the rest ourselves would only
+                         * mess up the order */
+                        n_jobs = job;
+                        break;
+                }
+                if (r == 0) {
+                        r = process_items(c, operation, jobs, job);
+                        _exit(r < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+                }
+        }
+
+        for (unsigned job = 0; job < n_jobs; job++) {
+                k = wait_for_terminate_and_check("(sd-tmpfiles)", pids[job], WAIT_LOG_ABNORMAL);
+                if (k > 0)
+                        /* The job logged its errors already, but we don't learn which ones. Treat them like
+                         * a failure to create something, which is what most of them are. */
+                        k = -EIO;
+                if (k < 0 && r >= 0)
+                        r = k;
+        }
+
+        return r;
+}
+
 static void item_free_contents(Item *i) {
         assert(i);
         free(i->path);
@@ -4155,6 +4275,7 @@ static int help(void) {
                "     --image-policy=POLICY  Specify disk image dissection policy\n"
                "     --replace=PATH         Treat arguments as replacement for PATH\n"
                "     --dry-run              Just print what would be done\n"
+               "  -j --jobs=N               Process independent paths in N parallel jobs\n"
                "     --no-pager             Do not pipe output into a pager\n"
                "\nSee the %5$s for details.\n",
                program_invocation_short_name,
@@ -4208,6 +4329,7 @@ static int parse_argv(int argc, char *argv[]) {
                 { "replace",        required_argument,   NULL, ARG_REPLACE        },
                 { "dry-run",        no_argument,         NULL, ARG_DRY_RUN        },
                 { "no-pager",       no_argument,         NULL, ARG_NO_PAGER       },
+                { "jobs",           required_argument,   NULL, 'j'                },
                 {}
         };
 
@@ -4216,7 +4338,7 @@ static int parse_argv(int argc, char *argv[]) {
         assert(argc >= 0);
         assert(argv);
 
-        while ((c = getopt_long(argc, argv, "hE", options, NULL)) >= 0)
+        while ((c = getopt_long(argc, argv, "hEj:", options, NULL)) >= 0)
 
                 switch (c) {
 
@@ -4322,6 +4444,14 @@ static int parse_argv(int argc, char *argv[]) {
                         arg_pager_flags |= PAGER_DISABLE;
                         break;
 
+                case 'j':
+                        r = safe_atou(optarg, &arg_jobs);
+                        if (r < 0)
+                                return log_error_errno(r, "Failed to parse --jobs= argument: %s", optarg);
+                        if (arg_jobs == 0)
+                                return log_error_errno(SYNTHETIC_ERRNO(EINVAL), "The argument to --jobs= must be positive.");
+                        break;
+
                 case '?':
                         return -EINVAL;
 
@@ -4679,19 +4809,12 @@ static int run(int argc, char *argv[]) {
                 if (op == 0) /* Nothing requested in this phase */
                         continue;
 
-                /* The non-globbing ones usually create things, hence we apply them first */
-                ORDERED_HASHMAP_FOREACH(a, c.items) {
-                        k = process_item_array(&c, a, op);
-                        if (k < 0 && r >= 0)
-                                r = k;
-                }
-
-                /* The globbing ones usually alter things, hence we apply them second. */
-                ORDERED_HASHMAP_FOREACH(a, c.globs) {
-                        k = process_item_array(&c, a, op);
-                        if (k < 0 && r >= 0)
-                                r = k;
-                }
+                if (arg_jobs > 1)
+                        k = process_items_parallel(&c, op);
+                else
+                        k = process_items(&c, op, /* jobs= */ NULL, 0);
+                if (k < 0 && r >= 0)
+                        r = k;
         }
 
         if (ERRNO_IS_RESOURCE(r))
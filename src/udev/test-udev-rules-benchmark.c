@@ -0,0 +1,101 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <stdio.h>
+
+#include "device-private.h"
+#include "fd-util.h"
+#include "fileio.h"
+#include "parse-util.h"
+#include "path-util.h"
+#include "rm-rf.h"
+#include "strv.h"
+#include "tests.h"
+#include "tmpfile-util.h"
+#include "udev-event.h"
+#include "udev-rules.h"
+
+/* This program measures parsing a large rules file, and applying it to an event, which is what every
+ * worker does for every uevent. The rules resemble those shipped by distributions, few of them apply to
+ * any given device. Nothing is executed, and the device is synthetic, hence no sysfs access is needed. */
+
+static unsigned arg_n_rules;
+static unsigned arg_n_events;
+
+static void write_rules(const char *path) {
+        _cleanup_fclose_ FILE *f = NULL;
+
+        ASSERT_NOT_NULL(f = fopen(path, "we"));
+
+        for (unsigned i = 0; i < arg_n_rules; i++)
+                switch (i % 5) {
+
+                case 0:
+                        fprintf(f, "SUBSYSTEM==\"block\", KERNEL==\"sd*[!0-9]\", ENV{ID_BENCH_%u}=\"1\"\n", i);
+                        break;
+
+                case 1:
+                        fprintf(f, "ACTION==\"add\", SUBSYSTEM==\"net\", KERNEL==\"eth%u\", ENV{ID_NET_BENCH}=\"%u\"\n", i, i);
+                        break;
+
+                case 2:
+                        fprintf(f, "SUBSYSTEM==\"net\", ENV{INTERFACE}==\"bench*\", TAG+=\"bench%u\"\n", i);
+                        break;
+
+                case 3:
+                        fprintf(f, "SUBSYSTEM==\"usb\", ATTR{idVendor}==\"%04x\", MODE=\"0660\"\n", i & 0xffff);
+                        break;
+
+                case 4:
+                        fprintf(f,
+                                "ACTION!=\"add\", GOTO=\"bench_end_%u\"\n"
+                                "ENV{ID_BENCH_ADDED}=\"1\"\n"
+                                "LABEL=\"bench_end_%u\"\n",
+                                i, i);
+                        break;
+                }
+
+        ASSERT_OK(fflush_and_check(f));
+}
+
+int main(int argc, char *argv[]) {
+        _cleanup_(rm_rf_physical_and_freep) char *tmp = NULL;
+        _cleanup_(udev_rules_freep) UdevRules *rules = NULL;
+        _cleanup_(sd_device_unrefp) sd_device *dev = NULL;
+        _cleanup_free_ char *path = NULL;
+
+        test_setup_logging(LOG_INFO);
+
+        if (argc >= 2)
+                ASSERT_OK(safe_atou(argv[1], &arg_n_rules));
+        else
+                arg_n_rules = slow_tests_enabled() ? 50000 : 5000;
+        if (argc >= 3)
+                ASSERT_OK(safe_atou(argv[2], &arg_n_events));
+        else
+                arg_n_events = slow_tests_enabled() ? 10000 : 100;
+
+        ASSERT_OK(mkdtemp_malloc("/tmp/test-udev-rules-benchmark-XXXXXX", &tmp));
+        ASSERT_NOT_NULL(path = path_join(tmp, "99-benchmark.rules"));
+        write_rules(path);
+
+        BENCHMARK("parse", arg_n_rules,
+                  ASSERT_NOT_NULL(rules = udev_rules_new(RESOLVE_NAME_EARLY));
+                  ASSERT_OK(udev_rules_parse_file(rules, path, /* extra_checks = */ false, NULL)));
+
+        ASSERT_OK(device_new_from_strv(&dev, STRV_MAKE("DEVPATH=/devices/virtual/net/bench0",
+                                                       "SUBSYSTEM=net",
+                                                       "ACTION=add",
+                                                       "SEQNUM=1",
+                                                       "INTERFACE=bench0",
+                                                       "IFINDEX=42")));
+
+        BENCHMARK("apply", arg_n_events,
+                  for (unsigned i = 0; i < arg_n_events; i++) {
+                          _cleanup_(udev_event_freep) UdevEvent *event = NULL;
+
+                          ASSERT_NOT_NULL(event = udev_event_new(dev, NULL, EVENT_UDEVADM_TEST));
+                          ASSERT_OK(udev_rules_apply_to_event(rules, event));
+                  });
+
+        return 0;
+}
@@ -0,0 +1,47 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <unistd.h>
+
+#include "process-util.h"
+#include "tests.h"
+#include "udev-stats.h"
+
+TEST(udev_stats_counter_add) {
+        _cleanup_(udev_stats_freep) UdevStats *stats = NULL;
+
+        ASSERT_OK(udev_stats_new(&stats, 3));
+        ASSERT_EQ(stats->n_lines, 3U);
+        ASSERT_EQ(stats->lines[2].count, 0U);
+
+        udev_stats_counter_add(stats->lines + 1, 10);
+        udev_stats_counter_add(stats->lines + 1, 30);
+        udev_stats_counter_add(stats->lines + 1, 20);
+
+        ASSERT_EQ(stats->lines[1].count, 3U);
+        ASSERT_EQ(stats->lines[1].total_usec, 60U);
+        ASSERT_EQ(stats->lines[1].max_usec, 30U);
+        ASSERT_EQ(stats->lines[0].count, 0U);
+        ASSERT_EQ(stats->lines[2].count, 0U);
+}
+
+TEST(udev_stats_shared) {
+        _cleanup_(udev_stats_freep) UdevStats *stats = NULL;
+        int r;
+
+        ASSERT_OK(udev_stats_new(&stats, 1));
+
+        /* Counters updated by forked workers are seen by the manager */
+        r = safe_fork("(test-stats)", FORK_WAIT|FORK_DEATHSIG_SIGKILL, NULL);
+        ASSERT_OK(r);
+        if (r == 0) {
+                udev_stats_counter_add(&stats->spawn, 100);
+                udev_stats_counter_add(stats->lines, 5);
+                _exit(EXIT_SUCCESS);
+        }
+
+        ASSERT_EQ(stats->spawn.count, 1U);
+        ASSERT_EQ(stats->spawn.total_usec, 100U);
+        ASSERT_EQ(stats->lines[0].max_usec, 5U);
+}
+
+DEFINE_TEST_MAIN(LOG_DEBUG);
@@ -22,18 +22,30 @@
 
 #include "alloc-util.h"
 #include "blkid-util.h"
+#include "blockdev-util.h"
+#include "device-private.h"
 #include "device-util.h"
 #include "devnum-util.h"
 #include "efi-loader.h"
 #include "errno-util.h"
+#include "escape.h"
 #include "fd-util.h"
+#include "fileio.h"
 #include "gpt.h"
 #include "parse-util.h"
+#include "path-util.h"
+#include "siphash24.h"
 #include "string-util.h"
 #include "strv.h"
 #include "strxcpyx.h"
 #include "udev-builtin.h"
 
+#define BLKID_CACHE_DIR "/run/udev/blkid/"
+
+/* Partition tables and superblocks are located within this distance from the beginning or the end of the
+ * device */
+#define BLKID_CACHE_SAMPLE_SIZE (128U * 1024U)
+
 static void print_property(sd_device *dev, EventMode mode, const char *name, const char *value) {
         char s[256];
 
@@ -122,7 +134,7 @@ static void print_property(sd_device *dev, EventMode mode, const char *name, con
         }
 }
 
-static int find_gpt_root(sd_device *dev, blkid_probe pr, EventMode mode) {
+static int find_gpt_root(blkid_probe pr, sd_id128_t *ret) {
 
 #if defined(SD_GPT_ROOT_NATIVE) && ENABLE_EFI
 
@@ -132,6 +144,7 @@ static int find_gpt_root(sd_device *dev, blkid_probe pr, EventMode mode) {
         int r;
 
         assert(pr);
+        assert(ret);
 
         /* Iterate through the partitions on this disk, and see if the UEFI ESP or XBOOTLDR partition we
          * booted from is on it. If so, find the first root disk, and add a property indicating its partition
@@ -200,8 +213,10 @@ static int find_gpt_root(sd_device *dev, blkid_probe pr, EventMode mode) {
 
         /* We found the ESP/XBOOTLDR on this disk, and also found a root partition, nice! Let's export its
          * UUID */
-        if (found_esp_or_xbootldr && !sd_id128_is_null(root_id))
-                udev_builtin_add_property(dev, mode, "ID_PART_GPT_AUTO_ROOT_UUID", SD_ID128_TO_UUID_STRING(root_id));
+        if (found_esp_or_xbootldr && !sd_id128_is_null(root_id)) {
+                *ret = root_id;
+                return 1;
+        }
 #endif
 
         return 0;
@@ -315,12 +330,260 @@ notloop:
         return 0;
 }
 
+static int blkid_cache_hash_region(int fd, uint64_t offset, uint64_t length, struct siphash *state) {
+        _cleanup_free_ uint8_t *buf = NULL;
+
+        assert(fd >= 0);
+        assert(state);
+        assert(length <= BLKID_CACHE_SAMPLE_SIZE);
+
+        if (length == 0)
+                return 0;
+
+        buf = malloc(length);
+        if (!buf)
+                return -ENOMEM;
+
+        for (uint64_t done = 0; done < length; ) {
+                ssize_t n;
+
+                n = pread(fd, buf + done, length - done, offset + done);
+                if (n < 0)
+                        return -errno;
+                if (n == 0)
+                        return -EIO; /* The device shrunk under us */
+
+                done += n;
+        }
+
+        siphash24_compress(buf, length, state);
+        return 0;
+}
+
+static int blkid_cache_key(
+                sd_device *dev,
+                int fd,
+                int argc,
+                char *argv[],
+                const char *root_partition,
+                char **ret) {
+
+        /* Random, but fixed, so that the key stays the same across invocations */
+        static const uint8_t hash_key[16] = {
+                0x5a, 0x1b, 0xf3, 0x87, 0x0c, 0x6e, 0x42, 0xd9,
+                0x9b, 0x27, 0x74, 0xe1, 0x3d, 0xa0, 0xc8, 0x16,
+        };
+
+        uint64_t diskseq = 0, size, tail;
+        const char *version = NULL;
+        struct siphash state;
+        dev_t devnum;
+        char *k;
+        int r;
+
+        assert(dev);
+        assert(fd >= 0);
+        assert(ret);
+
+        /* Probe results are keyed by the identity of the device, the probing options, and a checksum of the
+         * areas at the beginning and the end of the device that partition tables and superblocks live in. */
+
+        r = sd_device_get_devnum(dev, &devnum);
+        if (r < 0)
+                return r;
+
+        r = sd_device_get_diskseq(dev, &diskseq);
+        if (r < 0 && r != -ENOENT)
+                return r;
+
+        r = blockdev_get_device_size(fd, &size);
+        if (r < 0)
+                return r;
+
+        (void) blkid_get_library_version(&version, NULL);
+
+        siphash24_init(&state, hash_key);
+        siphash24_compress_typesafe(devnum, &state);
+        siphash24_compress_typesafe(diskseq, &state);
+        siphash24_compress_typesafe(size, &state);
+        siphash24_compress_string(strempty(version), &state);
+        siphash24_compress_byte(0, &state);
+        siphash24_compress_string(strempty(root_partition), &state);
+        siphash24_compress_byte(0, &state);
+        for (int i = 1; i < argc; i++) {
+                siphash24_compress_string(argv[i], &state);
+                siphash24_compress_byte(0, &state);
+        }
+
+        /* The beginning and the end of the device, without hashing anything twice on small devices */
+        tail = MAX(size, (uint64_t) BLKID_CACHE_SAMPLE_SIZE * 2) - BLKID_CACHE_SAMPLE_SIZE;
+
+        r = blkid_cache_hash_region(fd, 0, MIN(size, (uint64_t) BLKID_CACHE_SAMPLE_SIZE), &state);
+        if (r < 0)
+                return r;
+
+        if (size > tail) {
+                r = blkid_cache_hash_region(fd, tail, size - tail, &state);
+                if (r < 0)
+                        return r;
+        }
+
+        if (asprintf(&k, "%016" PRIx64, siphash24_finalize(&state)) < 0)
+                return -ENOMEM;
+
+        *ret = k;
+        return 0;
+}
+
+static int blkid_cache_path(sd_device *dev, char **ret) {
+        const char *id;
+        char *p;
+        int r;
+
+        assert(dev);
+        assert(ret);
+
+        r = device_get_device_id(dev, &id);
+        if (r < 0)
+                return r;
+
+        p = path_join(BLKID_CACHE_DIR, id);
+        if (!p)
+                return -ENOMEM;
+
+        *ret = p;
+        return 0;
+}
+
+static int blkid_cache_load(sd_device *dev, const char *key, char ***ret_values, sd_id128_t *ret_gpt_root) {
+        _cleanup_strv_free_ char **lines = NULL, **values = NULL;
+        _cleanup_free_ char *path = NULL, *contents = NULL;
+        sd_id128_t gpt_root = SD_ID128_NULL;
+        int r;
+
+        assert(dev);
+        assert(key);
+        assert(ret_values);
+        assert(ret_gpt_root);
+
+        r = blkid_cache_path(dev, &path);
+        if (r < 0)
+                return r;
+
+        r = read_full_file(path, &contents, NULL);
+        if (r == -ENOENT)
+                return 0;
+        if (r < 0)
+                return r;
+
+        lines = strv_split_newlines(contents);
+        if (!lines)
+                return -ENOMEM;
+
+        if (!streq_ptr(startswith(strv_isempty(lines) ? NULL : lines[0], "K:"), key))
+                return 0;
+
+        STRV_FOREACH(l, lines + 1) {
+                const char *v;
+
+                if ((v = startswith(*l, "V:"))) {
+                        _cleanup_free_ char *name = NULL, *value = NULL;
+                        const char *eq;
+
+                        eq = strchr(v, '=');
+                        if (!eq)
+                                return -EBADMSG;
+
+                        name = strndup(v, eq - v);
+                        if (!name)
+                                return -ENOMEM;
+
+                        if (cunescape(eq + 1, 0, &value) < 0)
+                                return -EBADMSG;
+
+                        r = strv_consume_pair(&values, TAKE_PTR(name), TAKE_PTR(value));
+                        if (r < 0)
+                                return r;
+
+                } else if ((v = startswith(*l, "R:"))) {
+                        r = sd_id128_from_string(v, &gpt_root);
+                        if (r < 0)
+                                return -EBADMSG;
+                } else
+                        return -EBADMSG;
+        }
+
+        *ret_values = TAKE_PTR(values);
+        *ret_gpt_root = gpt_root;
+        return 1;
+}
+
+static int blkid_cache_save(sd_device *dev, const char *key, char **values, sd_id128_t gpt_root) {
+        _cleanup_free_ char *path = NULL, *contents = NULL;
+        int r;
+
+        assert(dev);
+        assert(key);
+
+        r = blkid_cache_path(dev, &path);
+        if (r < 0)
+                return r;
+
+        contents = strjoin("K:", key, "\n");
+        if (!contents)
+                return -ENOMEM;
+
+        STRV_FOREACH_PAIR(name, value, values) {
+                _cleanup_free_ char *e = NULL;
+
+                e = cescape(*value);
+                if (!e)
+                        return -ENOMEM;
+
+                if (!strextend(&contents, "V:", *name, "=", e, "\n"))
+                        return -ENOMEM;
+        }
+
+        if (!sd_id128_is_null(gpt_root) &&
+            !strextend(&contents, "R:", SD_ID128_TO_UUID_STRING(gpt_root), "\n"))
+                return -ENOMEM;
+
+        return write_string_file(path, contents,
+                                 WRITE_STRING_FILE_CREATE|WRITE_STRING_FILE_ATOMIC|
+                                 WRITE_STRING_FILE_MKDIR_0755|WRITE_STRING_FILE_AVOID_NEWLINE);
+}
+
+static bool blkid_cache_reprobe_requested(sd_device *dev) {
+        assert(dev);
+
+        /* Set via 'udevadm trigger --reprobe' */
+        return device_get_property_bool(dev, "SYNTH_ARG_REPROBE") > 0;
+}
+
+static void blkid_export(sd_device *dev, EventMode mode, char **values, const char *root_partition, sd_id128_t gpt_root) {
+        assert(dev);
+
+        STRV_FOREACH_PAIR(name, value, values) {
+                print_property(dev, mode, *name, *value);
+
+                /* Is this a partition that matches the root partition
+                 * property inherited from the parent? */
+                if (root_partition && streq(*name, "PART_ENTRY_UUID") && streq(*value, root_partition))
+                        udev_builtin_add_property(dev, mode, "ID_PART_GPT_AUTO_ROOT", "1");
+        }
+
+        if (!sd_id128_is_null(gpt_root))
+                udev_builtin_add_property(dev, mode, "ID_PART_GPT_AUTO_ROOT_UUID", SD_ID128_TO_UUID_STRING(gpt_root));
+}
+
 static int builtin_blkid(UdevEvent *event, int argc, char *argv[]) {
         sd_device *dev = ASSERT_PTR(ASSERT_PTR(event)->dev);
         const char *devnode, *root_partition = NULL, *data, *name;
         _cleanup_(blkid_free_probep) blkid_probe pr = NULL;
-        _cleanup_free_ char *backing_fname = NULL;
-        bool noraid = false, is_gpt = false;
+        _cleanup_free_ char *backing_fname = NULL, *cache_key = NULL;
+        _cleanup_strv_free_ char **values = NULL;
+        sd_id128_t gpt_root = SD_ID128_NULL;
+        bool noraid = false, is_gpt = false, cached = false;
         _cleanup_close_ int fd = -EBADF;
         ino_t backing_inode = 0;
         dev_t backing_devno = 0;
@@ -399,43 +662,75 @@ static int builtin_blkid(UdevEvent *event, int argc, char *argv[]) {
                 return ignore ? 0 : fd;
         }
 
-        errno = 0;
-        r = blkid_probe_set_device(pr, fd, offset, 0);
-        if (r < 0)
-                return log_device_debug_errno(dev, errno_or_else(ENOMEM), "Failed to set device to blkid prober: %m");
+        /* If the device is a partition then its parent passed the root partition UUID to the device */
+        (void) sd_device_get_property_value(dev, "ID_PART_GPT_AUTO_ROOT_UUID", &root_partition);
+
+        /* Repeated change events (partition rescans, multipath path changes, retriggers) usually don't
+         * change the contents of the device. Reuse the results of the last probe then, as probing may
+         * involve a lot of I/O on busy devices. */
+        if (event->event_mode == EVENT_UDEV_WORKER) {
+                r = blkid_cache_key(dev, fd, argc, argv, root_partition, &cache_key);
+                if (r < 0)
+                        log_device_debug_errno(dev, r, "Failed to determine blkid cache key, not using cache: %m");
+                else if (blkid_cache_reprobe_requested(dev))
+                        log_device_debug(dev, "Reprobing requested, not using cached blkid results.");
+                else {
+                        r = blkid_cache_load(dev, cache_key, &values, &gpt_root);
+                        if (r < 0)
+                                log_device_debug_errno(dev, r, "Failed to load cached blkid results, ignoring: %m");
+                        else if (r > 0) {
+                                log_device_debug(dev, "Contents of %s unchanged, using cached blkid results.", devnode);
+                                cached = true;
+                        }
+                }
+        }
 
-        log_device_debug(dev, "Probe %s with %sraid and offset=%"PRIi64, devnode, noraid ? "no" : "", offset);
+        if (!cached) {
+                errno = 0;
+                r = blkid_probe_set_device(pr, fd, offset, 0);
+                if (r < 0)
+                        return log_device_debug_errno(dev, errno_or_else(ENOMEM), "Failed to set device to blkid prober: %m");
 
-        r = probe_superblocks(pr);
-        if (r < 0)
-                return log_device_debug_errno(dev, r, "Failed to probe superblocks: %m");
+                log_device_debug(dev, "Probe %s with %sraid and offset=%"PRIi64, devnode, noraid ? "no" : "", offset);
 
-        /* If the device is a partition then its parent passed the root partition UUID to the device */
-        (void) sd_device_get_property_value(dev, "ID_PART_GPT_AUTO_ROOT_UUID", &root_partition);
+                r = probe_superblocks(pr);
+                if (r < 0)
+                        return log_device_debug_errno(dev, r, "Failed to probe superblocks: %m");
 
-        errno = 0;
-        int nvals = blkid_probe_numof_values(pr);
-        if (nvals < 0)
-                return log_device_debug_errno(dev, errno_or_else(ENOMEM), "Failed to get number of probed values: %m");
+                errno = 0;
+                int nvals = blkid_probe_numof_values(pr);
+                if (nvals < 0)
+                        return log_device_debug_errno(dev, errno_or_else(ENOMEM), "Failed to get number of probed values: %m");
 
-        for (int i = 0; i < nvals; i++) {
-                if (blkid_probe_get_value(pr, i, &name, &data, NULL) < 0)
-                        continue;
+                for (int i = 0; i < nvals; i++) {
+                        if (blkid_probe_get_value(pr, i, &name, &data, NULL) < 0)
+                                continue;
 
-                print_property(dev, event->event_mode, name, data);
+                        r = strv_extend_many(&values, name, data);
+                        if (r < 0)
+                                return log_oom_debug();
 
-                /* Is this a disk with GPT partition table? */
-                if (streq(name, "PTTYPE") && streq(data, "gpt"))
-                        is_gpt = true;
+                        /* Is this a disk with GPT partition table? */
+                        if (streq(name, "PTTYPE") && streq(data, "gpt"))
+                                is_gpt = true;
+                }
 
-                /* Is this a partition that matches the root partition
-                 * property inherited from the parent? */
-                if (root_partition && streq(name, "PART_ENTRY_UUID") && streq(data, root_partition))
-                        udev_builtin_add_property(dev, event->event_mode, "ID_PART_GPT_AUTO_ROOT", "1");
+                if (is_gpt) {
+                        r = find_gpt_root(pr, &gpt_root);
+                        if (r < 0) {
+                                log_device_debug_errno(dev, r, "Failed to find root partition, ignoring: %m");
+                                cache_key = mfree(cache_key);
+                        }
+                }
+
+                if (cache_key) {
+                        r = blkid_cache_save(dev, cache_key, values, gpt_root);
+                        if (r < 0)
+                                log_device_debug_errno(dev, r, "Failed to save blkid results, ignoring: %m");
+                }
         }
 
-        if (is_gpt)
-                find_gpt_root(dev, pr, event->event_mode);
+        blkid_export(dev, event->event_mode, values, root_partition, gpt_root);
 
         r = read_loopback_backing_inode(
                         dev,
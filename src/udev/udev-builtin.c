@@ -8,6 +8,7 @@
 #include "string-util.h"
 #include "strv.h"
 #include "udev-builtin.h"
+#include "udev-stats.h"
 
 static bool initialized;
 
@@ -115,9 +116,17 @@ int udev_builtin_run(UdevEvent *event, UdevBuiltinCommand cmd, const char *comma
         if (r < 0)
                 return r;
 
+        UdevStats *stats = event->worker ? event->worker->stats : NULL;
+        usec_t start = stats ? now(CLOCK_MONOTONIC) : 0;
+
         /* we need '0' here to reset the internal state */
         optind = 0;
-        return builtins[cmd]->cmd(event, strv_length(argv), argv);
+        r = builtins[cmd]->cmd(event, strv_length(argv), argv);
+
+        if (stats)
+                udev_stats_counter_add(stats->builtins + cmd, usec_sub_unsigned(now(CLOCK_MONOTONIC), start));
+
+        return r;
 }
 
 int udev_builtin_add_property(sd_device *dev, EventMode mode, const char *key, const char *val) {
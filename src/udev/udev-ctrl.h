@@ -18,6 +18,9 @@ typedef enum UdevCtrlMessageType {
         UDEV_CTRL_SET_CHILDREN_MAX,
         UDEV_CTRL_PING,
         UDEV_CTRL_EXIT,
+        UDEV_CTRL_SET_EVENT_LOOP_STATISTICS,
+        UDEV_CTRL_LOG_QUEUE_STATISTICS,
+        UDEV_CTRL_SET_RULE_STATISTICS,
 } UdevCtrlMessageType;
 
 typedef union UdevCtrlMessageValue {
@@ -75,4 +78,16 @@ static inline int udev_ctrl_send_exit(UdevCtrl *uctrl) {
         return udev_ctrl_send(uctrl, UDEV_CTRL_EXIT, NULL);
 }
 
+static inline int udev_ctrl_send_set_event_loop_statistics(UdevCtrl *uctrl, bool b) {
+        return udev_ctrl_send(uctrl, UDEV_CTRL_SET_EVENT_LOOP_STATISTICS, INT_TO_PTR(b));
+}
+
+static inline int udev_ctrl_send_log_queue_statistics(UdevCtrl *uctrl) {
+        return udev_ctrl_send(uctrl, UDEV_CTRL_LOG_QUEUE_STATISTICS, NULL);
+}
+
+static inline int udev_ctrl_send_set_rule_statistics(UdevCtrl *uctrl, bool b) {
+        return udev_ctrl_send(uctrl, UDEV_CTRL_SET_RULE_STATISTICS, INT_TO_PTR(b));
+}
+
 DEFINE_TRIVIAL_CLEANUP_FUNC(UdevCtrl*, udev_ctrl_unref);
@@ -44,6 +44,8 @@ typedef struct UdevEvent {
         usec_t birth_usec;
         unsigned builtin_run;
         unsigned builtin_ret;
+        unsigned rule_lines_evaluated;
+        unsigned rule_lines_skipped;
         UdevRuleEscapeType esc:8;
         bool inotify_watch;
         bool inotify_watch_final;
@@ -46,6 +46,23 @@ typedef enum EventState {
         EVENT_RUNNING,
 } EventState;
 
+typedef struct EventIndexEntry EventIndexEntry;
+
+/* All in-flight events sharing one key of one of the event indexes, in the order of their seqnums. */
+typedef struct EventIndexBucket {
+        Hashmap *index;
+        char *key;
+        LIST_HEAD(EventIndexEntry, entries);
+        EventIndexEntry *entries_tail;
+} EventIndexBucket;
+
+struct EventIndexEntry {
+        Event *event;
+        EventIndexBucket *bucket;
+        bool old; /* added for DEVPATH_OLD= rather than DEVPATH= */
+        LIST_FIELDS(EventIndexEntry, entries);
+};
+
 typedef struct Event {
         Manager *manager;
         Worker *worker;
@@ -69,6 +86,9 @@ typedef struct Event {
         sd_event_source *timeout_warning_event;
         sd_event_source *timeout_event;
 
+        EventIndexEntry *index_entries;
+        size_t n_index_entries;
+
         LIST_FIELDS(Event, event);
 } Event;
 
@@ -89,13 +109,172 @@ typedef struct Worker {
         Event *event;
 } Worker;
 
+static void event_index_entry_remove(EventIndexEntry *entry) {
+        EventIndexBucket *bucket;
+
+        assert(entry);
+
+        bucket = ASSERT_PTR(entry->bucket);
+
+        if (bucket->entries_tail == entry)
+                bucket->entries_tail = entry->entries_prev;
+        LIST_REMOVE(entries, bucket->entries, entry);
+        entry->bucket = NULL;
+
+        if (bucket->entries)
+                return;
+
+        assert_se(hashmap_remove(bucket->index, bucket->key) == bucket);
+        free(bucket->key);
+        free(bucket);
+}
+
+static int event_index_add(Hashmap **index, const char *key, Event *event, bool old) {
+        EventIndexBucket *bucket;
+        EventIndexEntry *entry;
+        int r;
+
+        assert(index);
+        assert(key);
+        assert(event);
+        assert(event->index_entries);
+
+        bucket = hashmap_get(*index, key);
+        if (!bucket) {
+                _cleanup_free_ EventIndexBucket *b = NULL;
+                _cleanup_free_ char *k = NULL;
+
+                k = strdup(key);
+                if (!k)
+                        return -ENOMEM;
+
+                b = new(EventIndexBucket, 1);
+                if (!b)
+                        return -ENOMEM;
+
+                *b = (EventIndexBucket) {
+                        .key = k,
+                };
+
+                r = hashmap_ensure_put(index, &string_hash_ops, b->key, b);
+                if (r < 0)
+                        return r;
+
+                b->index = *index;
+                TAKE_PTR(k);
+                bucket = TAKE_PTR(b);
+        }
+
+        /* Events are queued in the order of their seqnums, hence appending keeps the bucket ordered. */
+        entry = &event->index_entries[event->n_index_entries++];
+        *entry = (EventIndexEntry) {
+                .event = event,
+                .bucket = bucket,
+                .old = old,
+        };
+
+        if (bucket->entries_tail)
+                LIST_INSERT_AFTER(entries, bucket->entries, bucket->entries_tail, entry);
+        else
+                LIST_PREPEND(entries, bucket->entries, entry);
+        bucket->entries_tail = entry;
+
+        return 0;
+}
+
+static size_t devpath_depth(const char *devpath) {
+        size_t n = 0;
+
+        if (!devpath)
+                return 0;
+
+        for (const char *p = devpath + 1; *p != '\0'; p++)
+                if (*p == '/')
+                        n++;
+
+        return n + 1;
+}
+
+static int event_index_add_devpath(Manager *manager, Event *event, const char *devpath, bool old) {
+        _cleanup_free_ char *buf = NULL;
+        int r;
+
+        assert(manager);
+        assert(event);
+
+        if (!devpath)
+                return 0;
+
+        r = event_index_add(&manager->events_by_devpath, devpath, event, old);
+        if (r < 0)
+                return r;
+
+        buf = strdup(devpath);
+        if (!buf)
+                return -ENOMEM;
+
+        /* Record the event for the device itself and all its ancestors, so that the events of all descendants
+         * of a device can be found with one lookup. */
+        for (char *p = buf + 1;; p++) {
+                if (*p != '/' && *p != '\0')
+                        continue;
+
+                char c = *p;
+                *p = '\0';
+                r = event_index_add(&manager->events_by_devpath_prefix, buf, event, old);
+                *p = c;
+                if (r < 0)
+                        return r;
+
+                if (c == '\0')
+                        return 0;
+        }
+}
+
+static int event_index_add_all(Manager *manager, Event *event) {
+        int r;
+
+        assert(manager);
+        assert(event);
+        assert(!event->index_entries);
+
+        event->index_entries = new(EventIndexEntry, 2 + 2 + devpath_depth(event->devpath) + devpath_depth(event->devpath_old));
+        if (!event->index_entries)
+                return -ENOMEM;
+
+        /* Events of devices without ID block each other, hence index them with the empty string. */
+        r = event_index_add(&manager->events_by_id, strempty(event->id), event, /* old = */ false);
+        if (r < 0)
+                return r;
+
+        if (event->devnode) {
+                r = event_index_add(&manager->events_by_devnode, event->devnode, event, /* old = */ false);
+                if (r < 0)
+                        return r;
+        }
+
+        r = event_index_add_devpath(manager, event, event->devpath, /* old = */ false);
+        if (r < 0)
+                return r;
+
+        return event_index_add_devpath(manager, event, event->devpath_old, /* old = */ true);
+}
+
 static Event *event_free(Event *event) {
         if (!event)
                 return NULL;
 
         assert(event->manager);
 
+        FOREACH_ARRAY(entry, event->index_entries, event->n_index_entries)
+                event_index_entry_remove(entry);
+        free(event->index_entries);
+
+        if (event->manager->events_tail == event)
+                event->manager->events_tail = event->event_prev;
         LIST_REMOVE(event, event->manager->events, event);
+        assert(event->manager->n_events > 0);
+        event->manager->n_events--;
         sd_device_unref(event->dev);
 
         sd_event_source_unref(event->retry_event_source);
@@ -142,10 +321,21 @@ Manager* manager_free(Manager *manager) {
 
         hashmap_free_free_free(manager->properties);
         udev_rules_free(manager->rules);
+        udev_stats_free(manager->stats);
 
         hashmap_free(manager->workers);
         event_queue_cleanup(manager, EVENT_UNDEF);
 
+        /* All buckets are freed together with the last event referencing them. */
+        assert(hashmap_isempty(manager->events_by_id));
+        assert(hashmap_isempty(manager->events_by_devnode));
+        assert(hashmap_isempty(manager->events_by_devpath));
+        assert(hashmap_isempty(manager->events_by_devpath_prefix));
+        hashmap_free(manager->events_by_id);
+        hashmap_free(manager->events_by_devnode);
+        hashmap_free(manager->events_by_devpath);
+        hashmap_free(manager->events_by_devpath_prefix);
+
         safe_close(manager->inotify_fd);
         safe_close_pair(manager->worker_watch);
 
@@ -251,6 +441,28 @@ static void notify_ready(Manager *manager) {
 }
 
 /* reload requested, HUP signal received, rules changed, builtin changed */
+static int manager_set_rule_statistics(Manager *manager, bool enable, UdevRules *rules) {
+        _cleanup_(udev_stats_freep) UdevStats *stats = NULL;
+        int r;
+
+        assert(manager);
+
+        if (enable && rules) {
+                r = udev_stats_new(&stats, udev_rules_count_lines(rules));
+                if (r < 0)
+                        return r;
+        }
+
+        udev_stats_free(manager->stats);
+        manager->stats = TAKE_PTR(stats);
+
+        /* Workers keep updating the statistics they were forked with. Let them go, so that new workers are
+         * spawned with the new ones. Busy workers are killed when they finished their event. */
+        manager_kill_workers(manager, false);
+
+        return 0;
+}
+
 static void manager_reload(Manager *manager, bool force) {
         _cleanup_(udev_rules_freep) UdevRules *rules = NULL;
         usec_t now_usec;
@@ -283,11 +495,18 @@ static void manager_reload(Manager *manager, bool force) {
                 udev_builtin_exit();
                 udev_builtin_init();
 
-                r = udev_rules_load(&rules, manager->resolve_name_timing);
+                r = udev_rules_load(&rules, manager->resolve_name_timing, manager->rules);
                 if (r < 0)
                         log_warning_errno(r, "Failed to read udev rules, using the previously loaded rules, ignoring: %m");
-                else
+                else {
+                        /* Statistics are indexed by rule line, hence start over with the new rules. */
+                        if (manager->stats) {
+                                udev_stats_log(manager->stats, manager->rules);
+                                (void) manager_set_rule_statistics(manager, true, rules);
+                        }
+
                         udev_rules_free_and_replace(manager->rules, rules);
+                }
         }
 
         notify_ready(manager);
@@ -402,6 +621,8 @@ static int worker_spawn(Manager *manager, Event *event) {
         if (r < 0)
                 return log_error_errno(r, "Worker: Failed to enable receiving of device: %m");
 
+        usec_t fork_start_usec = now(CLOCK_MONOTONIC);
+
         r = safe_fork("(udev-worker)", FORK_DEATHSIG_SIGTERM, &pid);
         if (r < 0) {
                 event->state = EVENT_QUEUED;
@@ -412,6 +633,7 @@ static int worker_spawn(Manager *manager, Event *event) {
                         .monitor = TAKE_PTR(worker_monitor),
                         .properties = TAKE_PTR(manager->properties),
                         .rules = TAKE_PTR(manager->rules),
+                        .stats = manager->stats,
                         .pipe_fd = TAKE_FD(manager->worker_watch[WRITE_END]),
                         .inotify_fd = TAKE_FD(manager->inotify_fd),
                         .exec_delay_usec = manager->exec_delay_usec,
@@ -427,6 +649,11 @@ static int worker_spawn(Manager *manager, Event *event) {
                 _exit(r < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
         }
 
+        usec_t fork_usec = usec_sub_unsigned(now(CLOCK_MONOTONIC), fork_start_usec);
+        manager->n_workers_spawned++;
+        manager->worker_spawn_usec_total = usec_add(manager->worker_spawn_usec_total, fork_usec);
+        manager->worker_spawn_usec_max = MAX(manager->worker_spawn_usec_max, fork_usec);
+
         r = worker_new(&worker, manager, worker_monitor, pid);
         if (r < 0)
                 return log_error_errno(r, "Failed to create worker object: %m");
@@ -501,20 +728,80 @@ bool devpath_conflict(const char *a, const char *b) {
         return *a == '/' || *b == '/' || *a == *b;
 }
 
+static Event* event_index_find_earliest(Hashmap *index, const char *key, Event *event, bool skip_old) {
+        EventIndexBucket *bucket;
+
+        assert(event);
+
+        bucket = hashmap_get(index, key);
+        if (!bucket)
+                return NULL;
+
+        LIST_FOREACH(entries, entry, bucket->entries) {
+                /* Later events cannot block us. */
+                if (entry->event->seqnum >= event->seqnum)
+                        return NULL;
+
+                if (skip_old && entry->old)
+                        continue;
+
+                return entry->event;
+        }
+
+        return NULL;
+}
+
+static void event_update_blocker(Event **blocker, Event *e) {
+        assert(blocker);
+
+        if (e && (!*blocker || e->seqnum < (*blocker)->seqnum))
+                *blocker = e;
+}
+
+static int event_find_earliest_blocker_by_devpath(Event *event, const char *devpath, bool skip_old, Event **blocker) {
+        Manager *manager = ASSERT_PTR(ASSERT_PTR(event)->manager);
+        _cleanup_free_ char *buf = NULL;
+
+        assert(blocker);
+
+        if (!devpath)
+                return 0;
+
+        /* Events of the device itself or any of its descendants */
+        event_update_blocker(blocker, event_index_find_earliest(manager->events_by_devpath_prefix, devpath, event, skip_old));
+
+        /* Events of any of its ancestors */
+        buf = strdup(devpath);
+        if (!buf)
+                return -ENOMEM;
+
+        for (char *p = buf + 1; *p != '\0'; p++) {
+                if (*p != '/')
+                        continue;
+
+                *p = '\0';
+                event_update_blocker(blocker, event_index_find_earliest(manager->events_by_devpath, buf, event, skip_old));
+                *p = '/';
+        }
+
+        return 0;
+}
+
 static int event_is_blocked(Event *event) {
-        Event *loop_event = NULL;
+        Event *blocker = NULL;
+        Manager *manager;
         int r;
 
         /* lookup event for identical, parent, child device */
 
         assert(event);
-        assert(event->manager);
+        manager = ASSERT_PTR(event->manager);
         assert(event->blocker_seqnum <= event->seqnum);
 
         if (event->retry_again_next_usec > 0) {
                 usec_t now_usec;
 
-                r = sd_event_now(event->manager->event, CLOCK_BOOTTIME, &now_usec);
+                r = sd_event_now(manager->event, CLOCK_BOOTTIME, &now_usec);
                 if (r < 0)
                         return r;
 
@@ -526,60 +813,34 @@ static int event_is_blocked(Event *event) {
                 /* we have checked previously and no blocker found */
                 return false;
 
-        LIST_FOREACH(event, e, event->manager->events) {
-                loop_event = e;
+        /* All earlier events are indexed by their device ID, device node, and device path, see
+         * event_index_add_all(). Hence this takes time proportional to the depth of the device path. */
 
-                /* we already found a later event, earlier cannot block us, no need to check again */
-                if (loop_event->seqnum < event->blocker_seqnum)
-                        continue;
-
-                /* event we checked earlier still exists, no need to check again */
-                if (loop_event->seqnum == event->blocker_seqnum)
-                        return true;
+        event_update_blocker(&blocker, event_index_find_earliest(manager->events_by_id, strempty(event->id), event, /* skip_old = */ false));
 
-                /* found ourself, no later event can block us */
-                if (loop_event->seqnum >= event->seqnum)
-                        goto no_blocker;
+        if (event->devnode)
+                event_update_blocker(&blocker, event_index_find_earliest(manager->events_by_devnode, event->devnode, event, /* skip_old = */ false));
 
-                /* found event we have not checked */
-                break;
-        }
-
-        assert(loop_event);
-        assert(loop_event->seqnum > event->blocker_seqnum &&
-               loop_event->seqnum < event->seqnum);
-
-        /* check if queue contains events we depend on */
-        LIST_FOREACH(event, e, loop_event) {
-                loop_event = e;
-
-                /* found ourself, no later event can block us */
-                if (loop_event->seqnum >= event->seqnum)
-                        goto no_blocker;
-
-                if (streq_ptr(loop_event->id, event->id))
-                        break;
+        r = event_find_earliest_blocker_by_devpath(event, event->devpath, /* skip_old = */ false, &blocker);
+        if (r < 0)
+                return r;
 
-                if (devpath_conflict(event->devpath, loop_event->devpath) ||
-                    devpath_conflict(event->devpath, loop_event->devpath_old) ||
-                    devpath_conflict(event->devpath_old, loop_event->devpath))
-                        break;
+        /* DEVPATH_OLD= of this event only conflicts with DEVPATH= of earlier events. */
+        r = event_find_earliest_blocker_by_devpath(event, event->devpath_old, /* skip_old = */ true, &blocker);
+        if (r < 0)
+                return r;
 
-                if (event->devnode && streq_ptr(event->devnode, loop_event->devnode))
-                        break;
+        if (!blocker) {
+                event->blocker_seqnum = event->seqnum;
+                return false;
         }
 
-        assert(loop_event);
-
-        log_device_debug(event->dev, "SEQNUM=%" PRIu64 " blocked by SEQNUM=%" PRIu64,
-                         event->seqnum, loop_event->seqnum);
+        if (event->blocker_seqnum != blocker->seqnum)
+                log_device_debug(event->dev, "SEQNUM=%" PRIu64 " blocked by SEQNUM=%" PRIu64,
+                                 event->seqnum, blocker->seqnum);
 
-        event->blocker_seqnum = loop_event->seqnum;
+        event->blocker_seqnum = blocker->seqnum;
         return true;
-
-no_blocker:
-        event->blocker_seqnum = event->seqnum;
-        return false;
 }
 
 static int event_queue_start(Manager *manager) {
@@ -759,12 +1020,28 @@ static int event_queue_insert(Manager *manager, sd_device *dev) {
         };
 
         if (!manager->events) {
+                manager->queue_busy_since_usec = now(CLOCK_MONOTONIC);
+                manager->n_events_processed_busy_start = manager->n_events_processed;
+
                 r = touch("/run/udev/queue");
                 if (r < 0)
                         log_warning_errno(r, "Failed to touch /run/udev/queue, ignoring: %m");
         }
 
-        LIST_APPEND(event, manager->events, event);
+        /* Keep track of the tail, as LIST_APPEND() would need to walk the whole queue. */
+        if (manager->events_tail)
+                LIST_INSERT_AFTER(event, manager->events, manager->events_tail, event);
+        else
+                LIST_PREPEND(event, manager->events, event);
+        manager->events_tail = event;
+        manager->n_events++;
+        manager->n_events_max = MAX(manager->n_events_max, manager->n_events);
+
+        r = event_index_add_all(manager, event);
+        if (r < 0) {
+                event_free(event);
+                return r;
+        }
 
         log_device_uevent(dev, "Device is queued");
 
@@ -843,6 +1120,9 @@ static int on_worker(sd_event_source *s, int fd, uint32_t revents, void *userdat
                         worker->state = WORKER_IDLE;
 
                 /* worker returned */
+                if (result != EVENT_RESULT_TRY_AGAIN)
+                        manager->n_events_processed++;
+
                 if (result == EVENT_RESULT_TRY_AGAIN &&
                     event_requeue(worker->event) < 0)
                         udev_broadcast_result(manager->monitor, worker->event->dev, -ETIMEDOUT);
@@ -854,6 +1134,35 @@ static int on_worker(sd_event_source *s, int fd, uint32_t revents, void *userdat
         return 1;
 }
 
+static void manager_log_queue_statistics(Manager *manager) {
+        size_t n_running = 0, n_queued = 0, n_blocked = 0;
+
+        assert(manager);
+
+        LIST_FOREACH(event, event, manager->events)
+                if (event->state == EVENT_RUNNING)
+                        n_running++;
+                else {
+                        n_queued++;
+
+                        /* Only counts events which were found blocked when last checked. */
+                        if (event->blocker_seqnum > 0 && event->blocker_seqnum != event->seqnum)
+                                n_blocked++;
+                }
+
+        log_info("Event queue: %zu events (%zu running, %zu queued, %zu of them blocked), "
+                 "at most %zu events were queued at once, %u workers.",
+                 manager->n_events, n_running, n_queued, n_blocked,
+                 manager->n_events_max, hashmap_size(manager->workers));
+
+        if (manager->n_workers_spawned > 0)
+                log_info("Processed %" PRIu64 " events, spawned %" PRIu64 " workers, "
+                         "forking a worker took %s on average, at most %s.",
+                         manager->n_events_processed, manager->n_workers_spawned,
+                         FORMAT_TIMESPAN(manager->worker_spawn_usec_total / manager->n_workers_spawned, USEC_PER_MSEC / 10),
+                         FORMAT_TIMESPAN(manager->worker_spawn_usec_max, USEC_PER_MSEC / 10));
+}
+
 static void manager_set_default_children_max(Manager *manager) {
         uint64_t cpu_limit, mem_limit, cpu_count = 1;
         int r;
@@ -982,6 +1291,37 @@ static int on_ctrl_msg(UdevCtrl *uctrl, UdevCtrlMessageType type, const UdevCtrl
                 log_debug("Received udev control message (EXIT)");
                 manager_exit(manager);
                 break;
+        case UDEV_CTRL_SET_EVENT_LOOP_STATISTICS:
+                log_debug("Received udev control message (SET_EVENT_LOOP_STATISTICS), setting collection to %s", yes_no(value->intval));
+
+                /* Log what was collected so far, as there is no other way to get at it */
+                if (sd_event_get_statistics_enabled(manager->event) > 0) {
+                        r = event_log_statistics(manager->event, LOG_INFO);
+                        if (r < 0)
+                                log_warning_errno(r, "Failed to log event loop statistics, ignoring: %m");
+                }
+
+                r = sd_event_set_statistics(manager->event, value->intval);
+                if (r < 0)
+                        log_warning_errno(r, "Failed to %s event loop statistics, ignoring: %m",
+                                          value->intval ? "enable" : "disable");
+                break;
+        case UDEV_CTRL_SET_RULE_STATISTICS:
+                log_debug("Received udev control message (SET_RULE_STATISTICS), setting collection to %s", yes_no(value->intval));
+
+                /* Log what was collected so far, as there is no other way to get at it */
+                if (manager->stats)
+                        udev_stats_log(manager->stats, manager->rules);
+
+                r = manager_set_rule_statistics(manager, value->intval, manager->rules);
+                if (r < 0)
+                        log_warning_errno(r, "Failed to %s rule statistics, ignoring: %m",
+                                          value->intval ? "enable" : "disable");
+                break;
+        case UDEV_CTRL_LOG_QUEUE_STATISTICS:
+                log_debug("Received udev control message (LOG_QUEUE_STATISTICS)");
+                manager_log_queue_statistics(manager);
+                break;
         default:
                 log_debug("Received unknown udev control message, ignoring");
         }
@@ -1174,8 +1514,15 @@ static int on_post(sd_event_source *s, void *userdata) {
         if (unlink("/run/udev/queue") < 0) {
                 if (errno != ENOENT)
                         log_warning_errno(errno, "Failed to unlink /run/udev/queue, ignoring: %m");
-        } else
-                log_debug("No events are queued, removing /run/udev/queue.");
+        } else {
+                uint64_t n = manager->n_events_processed - manager->n_events_processed_busy_start;
+                usec_t t = usec_sub_unsigned(now(CLOCK_MONOTONIC), manager->queue_busy_since_usec);
+
+                log_debug("No events are queued, removing /run/udev/queue. "
+                          "Processed %" PRIu64 " events in %s (%.1f events/s).",
+                          n, FORMAT_TIMESPAN(t, USEC_PER_MSEC),
+                          t > 0 ? (double) n * USEC_PER_SEC / t : 0.0);
+        }
 
         if (!hashmap_isempty(manager->workers)) {
                 /* There are idle workers */
@@ -1375,7 +1722,7 @@ int manager_main(Manager *manager) {
 
         udev_builtin_init();
 
-        r = udev_rules_load(&manager->rules, manager->resolve_name_timing);
+        r = udev_rules_load(&manager->rules, manager->resolve_name_timing, /* previous = */ NULL);
         if (r < 0)
                 return log_error_errno(r, "Failed to read udev rules: %m");
 
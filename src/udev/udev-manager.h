@@ -11,6 +11,7 @@
 #include "time-util.h"
 #include "udev-ctrl.h"
 #include "udev-rules.h"
+#include "udev-stats.h"
 
 typedef struct Event Event;
 typedef struct Worker Worker;
@@ -19,11 +20,28 @@ typedef struct Manager {
         sd_event *event;
         Hashmap *workers;
         LIST_HEAD(Event, events);
+        Event *events_tail;
+        size_t n_events;
+        size_t n_events_max;
+        uint64_t n_events_processed;
+        /* Used to log the event throughput whenever the queue becomes empty */
+        uint64_t n_events_processed_busy_start;
+        usec_t queue_busy_since_usec;
+
+        uint64_t n_workers_spawned;
+        usec_t worker_spawn_usec_total;
+        usec_t worker_spawn_usec_max;
+        /* Indexes of queued and running events, used to find blocking events, see event_is_blocked(). */
+        Hashmap *events_by_id;
+        Hashmap *events_by_devnode;
+        Hashmap *events_by_devpath;
+        Hashmap *events_by_devpath_prefix;
         char *cgroup;
         int log_level;
 
         UdevRules *rules;
         Hashmap *properties;
+        UdevStats *stats; /* rule processing statistics, if enabled */
 
         sd_device_monitor *monitor;
         UdevCtrl *ctrl;
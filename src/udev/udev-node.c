@@ -130,6 +130,15 @@ static int stack_directory_read_one(int dirfd, const char *id, char **devnode, i
 
                 *colon = '\0';
 
+                r = safe_atoi(buf, &tmp_prio);
+                if (r < 0)
+                        return r;
+
+                /* Compare the priority first, so that entries which cannot win do not cost an extra
+                 * syscall. This matters when many devices claim the same symlink. */
+                if (devnode && *devnode && tmp_prio <= *priority)
+                        return 0; /* Unchanged */
+
                 /* Of course, this check is racy, but it is not necessary to be perfect. Even if the device
                  * node will be removed after this check, we will receive 'remove' uevent, and the invalid
                  * symlink will be removed during processing the event. The check is just for shortening the
@@ -137,16 +146,9 @@ static int stack_directory_read_one(int dirfd, const char *id, char **devnode, i
                 if (access(colon + 1, F_OK) < 0)
                         return -ENODEV;
 
-                r = safe_atoi(buf, &tmp_prio);
-                if (r < 0)
-                        return r;
-
                 if (!devnode)
                         goto finalize;
 
-                if (*devnode && tmp_prio <= *priority)
-                        return 0; /* Unchanged */
-
                 r = free_and_strdup(devnode, colon + 1);
                 if (r < 0)
                         return r;
@@ -392,25 +394,30 @@ static int stack_directory_open(sd_device *dev, const char *slink, int *ret_dirf
 }
 
 static int node_get_current(const char *slink, int dirfd, char **ret_id, int *ret_prio) {
-        _cleanup_(sd_device_unrefp) sd_device *dev = NULL;
-        _cleanup_free_ char *id_dup = NULL;
-        const char *id;
+        _cleanup_free_ char *id = NULL;
+        struct stat st;
         int r;
 
         assert(slink);
         assert(dirfd >= 0);
         assert(ret_id);
 
-        r = sd_device_new_from_devname(&dev, slink);
-        if (r < 0)
-                return r;
+        /* The device ID of a device with a device node is always derived from its device number, see
+         * device_get_device_id(). Hence, we can determine the current owner of the symlink from stat()
+         * alone, without creating an sd_device object, which requires reading sysfs and the udev
+         * database. */
 
-        r = device_get_device_id(dev, &id);
+        if (stat(slink, &st) < 0)
+                return -errno;
+
+        r = stat_verify_device_node(&st);
         if (r < 0)
                 return r;
 
-        id_dup = strdup(id);
-        if (!id_dup)
+        if (major(st.st_rdev) == 0)
+                return -ENODEV;
+
+        if (asprintf(&id, "%c" DEVNUM_FORMAT_STR, S_ISBLK(st.st_mode) ? 'b' : 'c', DEVNUM_FORMAT_VAL(st.st_rdev)) < 0)
                 return -ENOMEM;
 
         if (ret_prio) {
@@ -419,7 +426,7 @@ static int node_get_current(const char *slink, int dirfd, char **ret_id, int *re
                         return r;
         }
 
-        *ret_id = TAKE_PTR(id_dup);
+        *ret_id = TAKE_PTR(id);
         return 0;
 }
 
@@ -37,6 +37,7 @@
 #include "udev-node.h"
 #include "udev-rules.h"
 #include "udev-spawn.h"
+#include "udev-stats.h"
 #include "udev-trace.h"
 #include "udev-util.h"
 #include "user-util.h"
@@ -174,6 +175,7 @@ struct UdevRuleLine {
         UdevRuleLine *goto_line;
 
         UdevRuleFile *rule_file;
+        unsigned position; /* index among all lines of all files, assigned when building line sets */
         LIST_HEAD(UdevRuleToken, tokens);
         LIST_FIELDS(UdevRuleLine, rule_lines);
 };
@@ -181,6 +183,7 @@ struct UdevRuleLine {
 struct UdevRuleFile {
         char *filename;
         unsigned issues; /* used by "udevadm verify" */
+        bool resolved_names; /* user or group names were resolved while parsing, see udev_rules_reuse_file() */
 
         UdevRules *rules;
         LIST_HEAD(UdevRuleLine, rule_lines);
@@ -192,9 +195,17 @@ struct UdevRules {
         Hashmap *known_users;
         Hashmap *known_groups;
         Hashmap *stats_by_path;
+        Hashmap *line_sets_by_key; /* "ACTION/SUBSYSTEM" → UdevRuleLineSet */
         LIST_HEAD(UdevRuleFile, rule_files);
 };
 
+/* The lines of all rule files that may match events with a specific action and subsystem, in order. */
+typedef struct UdevRuleLineSet {
+        unsigned n_skipped; /* lines of all rule files not included in the set */
+        size_t n_lines;
+        UdevRuleLine *lines[];
+} UdevRuleLineSet;
+
 #define LINE_GET_RULES(line)                                            \
         ASSERT_PTR(ASSERT_PTR(ASSERT_PTR(line)->rule_file)->rules)
 
@@ -380,9 +391,13 @@ static UdevRuleFile *udev_rule_file_free(UdevRuleFile *rule_file) {
         LIST_FOREACH(rule_lines, i, rule_file->rule_lines)
                 udev_rule_line_free(i);
 
-        if (rule_file->rules)
+        if (rule_file->rules) {
                 LIST_REMOVE(rule_files, rule_file->rules->rule_files, rule_file);
 
+                /* The line sets may refer to the lines we just freed */
+                rule_file->rules->line_sets_by_key = hashmap_free(rule_file->rules->line_sets_by_key);
+        }
+
         free(rule_file->filename);
         return mfree(rule_file);
 }
@@ -399,6 +414,7 @@ UdevRules *udev_rules_free(UdevRules *rules) {
         hashmap_free_free_key(rules->known_users);
         hashmap_free_free_key(rules->known_groups);
         hashmap_free(rules->stats_by_path);
+        hashmap_free(rules->line_sets_by_key);
         return mfree(rules);
 }
 
@@ -418,6 +434,8 @@ static int rule_resolve_user(UdevRuleLine *rule_line, const char *name, uid_t *r
                 return 0;
         }
 
+        rule_line->rule_file->resolved_names = true;
+
         r = get_user_creds(&name, &uid, NULL, NULL, NULL, USER_CREDS_ALLOW_MISSING);
         if (r < 0) {
                 log_unknown_owner(NULL, rule_line, r, "user", name);
@@ -454,6 +472,8 @@ static int rule_resolve_group(UdevRuleLine *rule_line, const char *name, gid_t *
                 return 0;
         }
 
+        rule_line->rule_file->resolved_names = true;
+
         r = get_group_creds(&name, &gid, USER_CREDS_ALLOW_MISSING);
         if (r < 0) {
                 log_unknown_owner(NULL, rule_line, r, "group", name);
@@ -1513,6 +1533,9 @@ int udev_rules_parse_file(UdevRules *rules, const char *filename, bool extra_che
         assert(rules);
         assert(filename);
 
+        /* Line sets are built lazily when applying rules, drop them as the set of lines is about to change */
+        rules->line_sets_by_key = hashmap_free(rules->line_sets_by_key);
+
         f = fopen(filename, "re");
         if (!f) {
                 if (extra_checks)
@@ -1650,7 +1673,59 @@ UdevRules* udev_rules_new(ResolveNameTiming resolve_name_timing) {
         return rules;
 }
 
-int udev_rules_load(UdevRules **ret_rules, ResolveNameTiming resolve_name_timing) {
+static int udev_rules_reuse_file(UdevRules *rules, UdevRules *previous, const char *filename) {
+        struct stat *old_st, st;
+        UdevRuleFile *rule_file = NULL;
+        int r;
+
+        assert(rules);
+        assert(filename);
+
+        /* Moves an already parsed rules file from the previously loaded rules to the new ones, if the file
+         * on disk has not been modified since. Returns 1 if the file was taken over, 0 if it needs to be
+         * parsed again. */
+
+        if (!previous || previous->resolve_name_timing != rules->resolve_name_timing)
+                return 0;
+
+        old_st = hashmap_get(previous->stats_by_path, filename);
+        if (!old_st)
+                return 0;
+
+        if (stat(filename, &st) < 0)
+                return 0;
+
+        if (!stat_inode_unmodified(old_st, &st))
+                return 0;
+
+        LIST_FOREACH(rule_files, i, previous->rule_files)
+                if (streq(i->filename, filename)) {
+                        rule_file = i;
+                        break;
+                }
+        if (!rule_file)
+                return 0;
+
+        /* User and group names may resolve differently now, hence always reparse such files. */
+        if (rule_file->resolved_names)
+                return 0;
+
+        r = hashmap_put_stats_by_path(&rules->stats_by_path, filename, &st);
+        if (r < 0)
+                return 0;
+
+        LIST_REMOVE(rule_files, previous->rule_files, rule_file);
+        previous->line_sets_by_key = hashmap_free(previous->line_sets_by_key);
+
+        rule_file->rules = rules;
+        LIST_APPEND(rule_files, rules->rule_files, rule_file);
+        rules->line_sets_by_key = hashmap_free(rules->line_sets_by_key);
+
+        log_debug("Reusing already parsed rules file: %s", filename);
+        return 1;
+}
+
+int udev_rules_load(UdevRules **ret_rules, ResolveNameTiming resolve_name_timing, UdevRules *previous) {
         _cleanup_(udev_rules_freep) UdevRules *rules = NULL;
         _cleanup_strv_free_ char **files = NULL;
         int r;
@@ -1663,7 +1738,12 @@ int udev_rules_load(UdevRules **ret_rules, ResolveNameTiming resolve_name_timing
         if (r < 0)
                 return log_debug_errno(r, "Failed to enumerate rules files: %m");
 
+        /* Note, from here on nothing may fail: unmodified files are taken out of the previous rules, which
+         * the caller keeps using if we return an error. */
         STRV_FOREACH(f, files) {
+                if (udev_rules_reuse_file(rules, previous, *f) > 0)
+                        continue;
+
                 r = udev_rules_parse_file(rules, *f, /* extra_checks = */ false, NULL);
                 if (r < 0)
                         log_debug_errno(r, "Failed to read rules file %s, ignoring: %m", *f);
@@ -2885,18 +2965,212 @@ static int udev_rule_apply_line_to_event(
         return 0;
 }
 
-int udev_rules_apply_to_event(UdevRules *rules, UdevEvent *event) {
+static bool rule_line_may_match(UdevRuleLine *line, const char *action, const char *subsystem) {
+        assert(line);
+        assert(action);
+
+        /* Checks whether the ACTION== and SUBSYSTEM== matches of the line are satisfied. Since the tokens
+         * are sorted by type, these and only side-effect free matches are evaluated before them, hence a
+         * line failing here would not have any effect on the event. */
+
+        LIST_FOREACH(tokens, token, line->tokens) {
+                if (token->type > TK_M_SUBSYSTEM)
+                        break;
+
+                if (token->type == TK_M_ACTION && !token_match_string(token, action))
+                        return false;
+                if (token->type == TK_M_SUBSYSTEM && !token_match_string(token, subsystem))
+                        return false;
+        }
+
+        return true;
+}
+
+static int udev_rules_get_line_set(UdevRules *rules, const char *action, const char *subsystem, UdevRuleLineSet **ret) {
+        _cleanup_free_ UdevRuleLineSet *set = NULL;
+        _cleanup_free_ char *key = NULL;
+        size_t n = 0;
+        unsigned n_total = 0;
+        int r;
+
+        assert(rules);
+        assert(action);
+        assert(ret);
+
+        key = strjoin(action, "/", strempty(subsystem));
+        if (!key)
+                return -ENOMEM;
+
+        set = hashmap_get(rules->line_sets_by_key, key);
+        if (set) {
+                *ret = TAKE_PTR(set);
+                return 0;
+        }
+
+        n_total = udev_rules_count_lines(rules);
+
+        LIST_FOREACH(rule_files, file, rules->rule_files)
+                LIST_FOREACH(rule_lines, line, file->rule_lines)
+                        if (rule_line_may_match(line, action, subsystem))
+                                n++;
+
+        set = malloc(offsetof(UdevRuleLineSet, lines) + n * sizeof(UdevRuleLine*));
+        if (!set)
+                return -ENOMEM;
+
+        *set = (UdevRuleLineSet) {
+                .n_skipped = n_total - n,
+        };
+
+        LIST_FOREACH(rule_files, file, rules->rule_files)
+                LIST_FOREACH(rule_lines, line, file->rule_lines)
+                        if (rule_line_may_match(line, action, subsystem))
+                                set->lines[set->n_lines++] = line;
+
+        assert(set->n_lines == n);
+
+        r = hashmap_ensure_put(&rules->line_sets_by_key, &string_hash_ops_free_free, key, set);
+        if (r < 0)
+                return r;
+
+        TAKE_PTR(key);
+        *ret = TAKE_PTR(set);
+        return 0;
+}
+
+static int udev_rules_get_line_set_for_event(UdevRules *rules, UdevEvent *event, UdevRuleLineSet **ret) {
+        sd_device_action_t action;
+        const char *subsystem;
         int r;
 
         assert(rules);
         assert(event);
+        assert(ret);
+
+        r = sd_device_get_action(event->dev, &action);
+        if (r < 0)
+                return r;
+
+        r = sd_device_get_subsystem(event->dev, &subsystem);
+        if (r == -ENOENT)
+                subsystem = NULL;
+        else if (r < 0)
+                return r;
+
+        return udev_rules_get_line_set(rules, device_action_to_string(action), subsystem, ret);
+}
+
+static size_t rule_line_set_find(UdevRuleLineSet *set, size_t start, unsigned position) {
+        size_t left = start, right = set->n_lines;
+
+        assert(set);
+        assert(start <= set->n_lines);
+
+        /* Returns the index of the first line in the set at or after the specified position */
+
+        while (left < right) {
+                size_t middle = left + (right - left) / 2;
 
+                if (set->lines[middle]->position < position)
+                        left = middle + 1;
+                else
+                        right = middle;
+        }
+
+        return left;
+}
+
+unsigned udev_rules_count_lines(UdevRules *rules) {
+        unsigned n = 0;
+
+        assert(rules);
+
+        /* Assigns the positions of all lines, and returns their number. Positions only depend on the order
+         * of the lines, hence they are the same in forked workers. */
         LIST_FOREACH(rule_files, file, rules->rule_files)
-                LIST_FOREACH_WITH_NEXT(rule_lines, line, next_line, file->rule_lines) {
-                        r = udev_rule_apply_line_to_event(line, event, &next_line);
-                        if (r < 0)
-                                return r;
-                }
+                LIST_FOREACH(rule_lines, line, file->rule_lines)
+                        line->position = n++;
+
+        return n;
+}
+
+int udev_rules_get_line_location(UdevRules *rules, unsigned position, char **ret) {
+        assert(rules);
+        assert(ret);
+
+        LIST_FOREACH(rule_files, file, rules->rule_files)
+                LIST_FOREACH(rule_lines, line, file->rule_lines)
+                        if (line->position == position) {
+                                if (asprintf(ret, "%s:%u", file->filename, line->line_number) < 0)
+                                        return -ENOMEM;
+                                return 0;
+                        }
+
+        return -ENOENT;
+}
+
+static int udev_rule_apply_line_to_event_with_stats(UdevRuleLine *line, UdevEvent *event, UdevRuleLine **next_line) {
+        UdevStats *stats;
+        usec_t start;
+        int r;
+
+        assert(line);
+        assert(event);
+
+        stats = event->worker ? event->worker->stats : NULL;
+        if (!stats || line->position >= stats->n_lines)
+                return udev_rule_apply_line_to_event(line, event, next_line);
+
+        start = now(CLOCK_MONOTONIC);
+        r = udev_rule_apply_line_to_event(line, event, next_line);
+        udev_stats_counter_add(stats->lines + line->position, usec_sub_unsigned(now(CLOCK_MONOTONIC), start));
+
+        return r;
+}
+
+int udev_rules_apply_to_event(UdevRules *rules, UdevEvent *event) {
+        UdevRuleLineSet *set;
+        int r;
+
+        assert(rules);
+        assert(event);
+
+        /* Most lines start with ACTION== or SUBSYSTEM== matches, so rather than walking all lines, only walk
+         * those that may match the action and subsystem of the event. */
+        r = udev_rules_get_line_set_for_event(rules, event, &set);
+        if (r < 0) {
+                log_device_debug_errno(event->dev, r, "Failed to determine rule lines for event, walking all lines: %m");
+
+                LIST_FOREACH(rule_files, file, rules->rule_files)
+                        LIST_FOREACH_WITH_NEXT(rule_lines, line, next_line, file->rule_lines) {
+                                event->rule_lines_evaluated++;
+
+                                r = udev_rule_apply_line_to_event_with_stats(line, event, &next_line);
+                                if (r < 0)
+                                        return r;
+                        }
+
+                return 0;
+        }
+
+        event->rule_lines_skipped += set->n_skipped;
+
+        for (size_t i = 0; i < set->n_lines; ) {
+                UdevRuleLine *line = set->lines[i], *next_line = line->rule_lines_next;
+
+                event->rule_lines_evaluated++;
+
+                r = udev_rule_apply_line_to_event_with_stats(line, event, &next_line);
+                if (r < 0)
+                        return r;
+
+                if (next_line == line->rule_lines_next)
+                        i++;
+                else
+                        /* GOTO= matched, fast-forward to the label, or the first line after it in the set.
+                         * Lines in between would not match anyway. */
+                        i = rule_line_set_find(set, i + 1, next_line->position);
+        }
 
         return 0;
 }
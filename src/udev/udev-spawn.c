@@ -13,6 +13,7 @@
 #include "udev-builtin.h"
 #include "udev-event.h"
 #include "udev-spawn.h"
+#include "udev-stats.h"
 #include "udev-trace.h"
 
 typedef struct Spawn {
@@ -319,6 +320,8 @@ int udev_event_spawn(
                 .result_size = result_size,
         };
         r = spawn_wait(&spawn);
+        if (event->worker && event->worker->stats)
+                udev_stats_counter_add(&event->worker->stats->spawn, usec_sub_unsigned(now(CLOCK_MONOTONIC), now_usec));
         if (r < 0)
                 return log_device_error_errno(event->dev, r,
                                               "Failed to wait for spawned command '%s': %m", cmd);
@@ -0,0 +1,108 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#include <sys/mman.h>
+
+#include "alloc-util.h"
+#include "log.h"
+#include "sort-util.h"
+#include "udev-rules.h"
+#include "udev-stats.h"
+
+/* Number of the most expensive rule lines to log */
+#define UDEV_STATS_LOG_LINES_MAX 20U
+
+int udev_stats_new(UdevStats **ret, unsigned n_lines) {
+        UdevStats *stats;
+        size_t size;
+
+        assert(ret);
+
+        size = offsetof(UdevStats, lines) + n_lines * sizeof(UdevStatsCounter);
+
+        /* Shared, so that the counters are updated by forked workers. Anonymous memory is zero-initialized. */
+        stats = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+        if (stats == MAP_FAILED)
+                return -errno;
+
+        stats->size = size;
+        stats->n_lines = n_lines;
+
+        *ret = stats;
+        return 0;
+}
+
+UdevStats* udev_stats_free(UdevStats *stats) {
+        if (!stats)
+                return NULL;
+
+        (void) munmap(stats, stats->size);
+        return NULL;
+}
+
+void udev_stats_counter_add(UdevStatsCounter *counter, usec_t usec) {
+        usec_t m;
+
+        assert(counter);
+
+        __atomic_add_fetch(&counter->count, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&counter->total_usec, usec, __ATOMIC_RELAXED);
+
+        m = __atomic_load_n(&counter->max_usec, __ATOMIC_RELAXED);
+        while (usec > m &&
+               !__atomic_compare_exchange_n(&counter->max_usec, &m, usec, /* weak = */ true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                ;
+}
+
+static void log_counter(const char *name, const UdevStatsCounter *counter) {
+        assert(name);
+        assert(counter);
+
+        if (counter->count == 0)
+                return;
+
+        log_info("  %s: %" PRIu64 " times, %s in total, %s on average, at most %s",
+                 name, counter->count,
+                 FORMAT_TIMESPAN(counter->total_usec, 1),
+                 FORMAT_TIMESPAN(counter->total_usec / counter->count, 1),
+                 FORMAT_TIMESPAN(counter->max_usec, 1));
+}
+
+static int line_cmp(const unsigned *a, const unsigned *b, UdevStats *stats) {
+        /* Most expensive first */
+        return -CMP(stats->lines[*a].total_usec, stats->lines[*b].total_usec);
+}
+
+void udev_stats_log(const UdevStats *stats, UdevRules *rules) {
+        _cleanup_free_ unsigned *positions = NULL;
+        unsigned n = 0;
+
+        assert(stats);
+
+        log_info("Rule processing statistics:");
+
+        log_counter("spawned programs", &stats->spawn);
+
+        for (UdevBuiltinCommand i = 0; i < _UDEV_BUILTIN_MAX; i++) {
+                const char *name = udev_builtin_name(i);
+
+                if (name)
+                        log_counter(name, stats->builtins + i);
+        }
+
+        positions = new(unsigned, stats->n_lines);
+        if (!positions)
+                return (void) log_oom();
+
+        for (unsigned i = 0; i < stats->n_lines; i++)
+                if (stats->lines[i].count > 0)
+                        positions[n++] = i;
+
+        typesafe_qsort_r(positions, n, line_cmp, (UdevStats*) stats);
+
+        FOREACH_ARRAY(p, positions, MIN(n, UDEV_STATS_LOG_LINES_MAX)) {
+                _cleanup_free_ char *location = NULL;
+
+                (void) udev_rules_get_line_location(rules, *p, &location);
+                log_counter(strna(location), stats->lines + *p);
+        }
+}
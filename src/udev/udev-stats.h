@@ -0,0 +1,34 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+#pragma once
+
+#include <inttypes.h>
+
+#include "time-util.h"
+#include "udev-builtin.h"
+
+typedef struct UdevRules UdevRules;
+
+typedef struct UdevStatsCounter {
+        uint64_t count;
+        usec_t total_usec;
+        usec_t max_usec;
+} UdevStatsCounter;
+
+/* Accounting of rule processing. The object lives in memory shared between the manager and its workers,
+ * which update the counters atomically. It is sized for one set of loaded rules, indexed by the position
+ * of each rule line, see udev_rules_count_lines(). */
+typedef struct UdevStats {
+        size_t size;
+        UdevStatsCounter builtins[_UDEV_BUILTIN_MAX];
+        UdevStatsCounter spawn;
+        unsigned n_lines;
+        UdevStatsCounter lines[];
+} UdevStats;
+
+int udev_stats_new(UdevStats **ret, unsigned n_lines);
+UdevStats* udev_stats_free(UdevStats *stats);
+DEFINE_TRIVIAL_CLEANUP_FUNC(UdevStats*, udev_stats_free);
+
+void udev_stats_counter_add(UdevStatsCounter *counter, usec_t usec);
+
+void udev_stats_log(const UdevStats *stats, UdevRules *rules);
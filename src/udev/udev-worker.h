@@ -15,6 +15,7 @@
 #define MIN_WORKER_TIMEOUT_USEC     (1 * USEC_PER_MSEC)
 
 typedef struct UdevRules UdevRules;
+typedef struct UdevStats UdevStats;
 
 typedef struct UdevWorker {
         sd_event *event;
@@ -23,6 +24,7 @@ typedef struct UdevWorker {
 
         Hashmap *properties;
         UdevRules *rules;
+        UdevStats *stats; /* shared with the manager, not owned */
 
         int pipe_fd;
         int inotify_fd; /* Do not close! */
@@ -9,6 +9,7 @@
 #include <unistd.h>
 
 #include "creds-util.h"
+#include "parse-argument.h"
 #include "parse-util.h"
 #include "process-util.h"
 #include "static-destruct.h"
@@ -27,6 +28,9 @@ static bool arg_exit = false;
 static int arg_max_children = -1;
 static int arg_log_level = -1;
 static int arg_start_exec_queue = -1;
+static int arg_event_loop_statistics = -1;
+static bool arg_queue_statistics = false;
+static int arg_rule_statistics = -1;
 static bool arg_load_credentials = false;
 
 STATIC_DESTRUCTOR_REGISTER(arg_env, strv_freep);
@@ -39,6 +43,9 @@ static bool arg_has_control_commands(void) {
                 arg_reload ||
                 !strv_isempty(arg_env) ||
                 arg_max_children >= 0 ||
+                arg_event_loop_statistics >= 0 ||
+                arg_queue_statistics ||
+                arg_rule_statistics >= 0 ||
                 arg_ping;
 }
 
@@ -55,6 +62,13 @@ static int help(void) {
                "  -p --property=KEY=VALUE  Set a global property for all events\n"
                "  -m --children-max=N      Maximum number of children\n"
                "     --ping                Wait for udev to respond to a ping message\n"
+               "     --event-loop-statistics=BOOL\n"
+               "                           Log the event loop statistics collected so far,\n"
+               "                           and start or stop collecting them\n"
+               "     --queue-statistics    Log the number of queued, running, and blocked events\n"
+               "     --rule-statistics=BOOL\n"
+               "                           Log the time spent in rules, builtins and programs so far,\n"
+               "                           and start or stop collecting it\n"
                "  -t --timeout=SECONDS     Maximum time to block for a reply\n"
                "     --load-credentials    Load udev rules from credentials\n",
                program_invocation_short_name);
@@ -66,6 +80,9 @@ static int parse_argv(int argc, char *argv[]) {
         enum {
                 ARG_PING = 0x100,
                 ARG_LOAD_CREDENTIALS,
+                ARG_EVENT_LOOP_STATISTICS,
+                ARG_QUEUE_STATISTICS,
+                ARG_RULE_STATISTICS,
         };
 
         static const struct option options[] = {
@@ -80,6 +97,9 @@ static int parse_argv(int argc, char *argv[]) {
                 { "env",              required_argument, NULL, 'p'                  }, /* alias for -p */
                 { "children-max",     required_argument, NULL, 'm'                  },
                 { "ping",             no_argument,       NULL, ARG_PING             },
+                { "event-loop-statistics", required_argument, NULL, ARG_EVENT_LOOP_STATISTICS },
+                { "queue-statistics", no_argument,       NULL, ARG_QUEUE_STATISTICS },
+                { "rule-statistics",  required_argument, NULL, ARG_RULE_STATISTICS  },
                 { "timeout",          required_argument, NULL, 't'                  },
                 { "load-credentials", no_argument,       NULL, ARG_LOAD_CREDENTIALS },
                 { "version",          no_argument,       NULL, 'V'                  },
@@ -140,6 +160,24 @@ static int parse_argv(int argc, char *argv[]) {
                         arg_ping = true;
                         break;
 
+                case ARG_EVENT_LOOP_STATISTICS:
+                        r = parse_boolean_argument("--event-loop-statistics=", optarg, NULL);
+                        if (r < 0)
+                                return r;
+                        arg_event_loop_statistics = r;
+                        break;
+
+                case ARG_QUEUE_STATISTICS:
+                        arg_queue_statistics = true;
+                        break;
+
+                case ARG_RULE_STATISTICS:
+                        r = parse_boolean_argument("--rule-statistics=", optarg, NULL);
+                        if (r < 0)
+                                return r;
+                        arg_rule_statistics = r;
+                        break;
+
                 case 't':
                         r = parse_sec(optarg, &arg_timeout);
                         if (r < 0)
@@ -225,6 +263,24 @@ static int send_control_commands(void) {
                         return log_error_errno(r, "Failed to send request to set number of children: %m");
         }
 
+        if (arg_event_loop_statistics >= 0) {
+                r = udev_ctrl_send_set_event_loop_statistics(uctrl, arg_event_loop_statistics);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to send request to set event loop statistics: %m");
+        }
+
+        if (arg_queue_statistics) {
+                r = udev_ctrl_send_log_queue_statistics(uctrl);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to send request to log queue statistics: %m");
+        }
+
+        if (arg_rule_statistics >= 0) {
+                r = udev_ctrl_send_set_rule_statistics(uctrl, arg_rule_statistics);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to send request to set rule statistics: %m");
+        }
+
         if (arg_ping) {
                 r = udev_ctrl_send_ping(uctrl);
                 if (r < 0)
@@ -111,7 +111,7 @@ int test_main(int argc, char *argv[], void *userdata) {
 
         udev_builtin_init();
 
-        r = udev_rules_load(&rules, arg_resolve_name_timing);
+        r = udev_rules_load(&rules, arg_resolve_name_timing, /* previous = */ NULL);
         if (r < 0) {
                 log_error_errno(r, "Failed to read udev rules: %m");
                 goto out;
@@ -211,6 +211,9 @@ int test_main(int argc, char *argv[], void *userdata) {
                 }
         }
 
+        printf("%sRule lines:%s\n  %u evaluated, %u skipped\n",
+               ansi_highlight(), ansi_normal(), event->rule_lines_evaluated, event->rule_lines_skipped);
+
         r = 0;
 out:
         udev_builtin_exit();
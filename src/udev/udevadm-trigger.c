@@ -19,6 +19,7 @@
 #include "static-destruct.h"
 #include "string-util.h"
 #include "strv.h"
+#include "time-util.h"
 #include "udevadm.h"
 #include "udevadm-util.h"
 #include "udev-ctrl.h"
@@ -29,19 +30,64 @@ static bool arg_dry_run = false;
 static bool arg_quiet = false;
 static bool arg_uuid = false;
 static bool arg_settle = false;
+static bool arg_reprobe = false;
+static unsigned arg_max_in_flight = 0;
+
+#define IN_FLIGHT_WAIT_USEC (5 * USEC_PER_SEC)
+
+typedef struct SettleContext {
+        Set *path_or_ids;
+        bool triggered;   /* Set when all events are triggered, only then the event loop may exit */
+        unsigned n_settled;
+} SettleContext;
+
+static void settle_context_done(SettleContext *c) {
+        assert(c);
+
+        c->path_or_ids = set_free(c->path_or_ids);
+}
+
+static int wait_in_flight(sd_event *event, SettleContext *c) {
+        int r;
+
+        assert(event);
+        assert(c);
+
+        /* Wait until the number of triggered but not yet processed events drops below the limit, so that
+         * the udevd queue does not get flooded with our events. If udevd does not make progress for a
+         * while, e.g. because some of our events got lost, give up waiting and trigger further events. */
+
+        while (set_size(c->path_or_ids) >= arg_max_in_flight) {
+                r = sd_event_run(event, IN_FLIGHT_WAIT_USEC);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to run event loop: %m");
+                if (r == 0) {
+                        log_debug("No triggered events processed within %s, not waiting for %u in-flight events.",
+                                  FORMAT_TIMESPAN(IN_FLIGHT_WAIT_USEC, USEC_PER_SEC), set_size(c->path_or_ids));
+                        break;
+                }
+        }
+
+        return 0;
+}
 
 static int exec_list(
                 sd_device_enumerator *e,
                 sd_device_action_t action,
-                Set **ret_settle_path_or_ids) {
+                sd_event *event,
+                SettleContext *settle) {
 
-        _cleanup_set_free_ Set *settle_path_or_ids = NULL;
         int uuid_supported = -1;
         const char *action_str;
+        unsigned n_triggered = 0;
+        usec_t start_usec;
         sd_device *d;
         int r, ret = 0;
 
         assert(e);
+        assert(!settle || event);
+
+        start_usec = now(CLOCK_MONOTONIC);
 
         action_str = device_action_to_string(action);
 
@@ -61,10 +107,14 @@ static int exec_list(
                 if (arg_dry_run)
                         continue;
 
-                /* Use the UUID mode if the user explicitly asked for it, or if --settle has been specified,
-                 * so that we can recognize our own uevent. */
-                r = sd_device_trigger_with_uuid(d, action, (arg_uuid || arg_settle) && uuid_supported != 0 ? &id : NULL);
-                if (r == -EINVAL && !arg_uuid && arg_settle && uuid_supported < 0) {
+                /* Use the UUID mode if the user explicitly asked for it, or if --settle or --max-in-flight=
+                 * has been specified, so that we can recognize our own uevent. */
+                if (arg_reprobe)
+                        /* Passing arguments requires the UUID mode anyway */
+                        r = device_trigger_with_args(d, action, STRV_MAKE("REPROBE=1"), &id);
+                else
+                        r = sd_device_trigger_with_uuid(d, action, (arg_uuid || settle) && uuid_supported != 0 ? &id : NULL);
+                if (r == -EINVAL && !arg_uuid && !arg_reprobe && settle && uuid_supported < 0) {
                         /* If we specified a UUID because of the settling logic, and we got EINVAL this might
                          * be caused by an old kernel which doesn't know the UUID logic (pre-4.13). Let's try
                          * if it works without the UUID logic then. */
@@ -115,6 +165,8 @@ static int exec_list(
                 } else
                         log_device_debug(d, "Triggered device with action '%s'.", action_str);
 
+                n_triggered++;
+
                 if (uuid_supported < 0)
                         uuid_supported = true;
 
@@ -122,7 +174,7 @@ static int exec_list(
                 if (arg_uuid)
                         printf(SD_ID128_UUID_FORMAT_STR "\n", SD_ID128_FORMAT_VAL(id));
 
-                if (arg_settle) {
+                if (settle) {
                         if (uuid_supported) {
                                 sd_id128_t *dup;
 
@@ -130,7 +182,7 @@ static int exec_list(
                                 if (!dup)
                                         return log_oom();
 
-                                r = set_ensure_consume(&settle_path_or_ids, &id128_hash_ops_free, dup);
+                                r = set_ensure_consume(&settle->path_or_ids, &id128_hash_ops_free, dup);
                         } else {
                                 char *dup;
 
@@ -138,21 +190,36 @@ static int exec_list(
                                 if (!dup)
                                         return log_oom();
 
-                                r = set_ensure_consume(&settle_path_or_ids, &path_hash_ops_free, dup);
+                                r = set_ensure_consume(&settle->path_or_ids, &path_hash_ops_free, dup);
                         }
                         if (r < 0)
                                 return log_oom();
+
+                        if (arg_max_in_flight > 0) {
+                                r = wait_in_flight(event, settle);
+                                if (r < 0)
+                                        return r;
+                        }
                 }
         }
 
-        if (ret_settle_path_or_ids)
-                *ret_settle_path_or_ids = TAKE_PTR(settle_path_or_ids);
+        if (n_triggered > 0) {
+                usec_t t = usec_sub_unsigned(now(CLOCK_MONOTONIC), start_usec);
+
+                log_debug("Triggered %u events in %s (%.0f events/s).",
+                          n_triggered, FORMAT_TIMESPAN(t, USEC_PER_MSEC),
+                          (double) n_triggered * USEC_PER_SEC / MAX(t, (usec_t) 1));
+        }
+
+        if (settle)
+                settle->triggered = true;
 
         return ret;
 }
 
 static int device_monitor_handler(sd_device_monitor *m, sd_device *dev, void *userdata) {
-        Set *settle_path_or_ids = * (Set**) ASSERT_PTR(userdata);
+        SettleContext *settle = ASSERT_PTR(userdata);
+        Set *settle_path_or_ids = settle->path_or_ids;
         const char *syspath;
         sd_id128_t id;
         int r;
@@ -213,13 +280,15 @@ static int device_monitor_handler(sd_device_monitor *m, sd_device *dev, void *us
                 }
         }
 
-        if (arg_verbose)
+        settle->n_settled++;
+
+        if (arg_verbose && arg_settle)
                 printf("settle %s\n", syspath);
 
-        if (arg_uuid)
+        if (arg_uuid && arg_settle)
                 printf("settle " SD_ID128_UUID_FORMAT_STR "\n", SD_ID128_FORMAT_VAL(id));
 
-        if (set_isempty(settle_path_or_ids))
+        if (settle->triggered && set_isempty(settle_path_or_ids))
                 return sd_event_exit(sd_device_monitor_get_event(m), 0);
 
         return 0;
@@ -272,8 +341,11 @@ static int help(void) {
                "     --wait-daemon[=SECONDS]        Wait for udevd daemon to be initialized\n"
                "                                    before triggering uevents\n"
                "     --uuid                         Print synthetic uevent UUID\n"
+               "     --reprobe                      Ask builtins to ignore cached probe results\n"
                "     --prioritized-subsystem=SUBSYSTEM[,SUBSYSTEM…]\n"
-               "                                    Trigger devices from a matching subsystem first\n",
+               "                                    Trigger devices from a matching subsystem first\n"
+               "     --max-in-flight=NUMBER         Limit the number of triggered events which are\n"
+               "                                    not processed yet\n",
                program_invocation_short_name);
 
         return 0;
@@ -287,6 +359,8 @@ int trigger_main(int argc, char *argv[], void *userdata) {
                 ARG_PRIORITIZED_SUBSYSTEM,
                 ARG_INITIALIZED_MATCH,
                 ARG_INITIALIZED_NOMATCH,
+                ARG_MAX_IN_FLIGHT,
+                ARG_REPROBE,
         };
 
         static const struct option options[] = {
@@ -312,6 +386,8 @@ int trigger_main(int argc, char *argv[], void *userdata) {
                 { "help",                  no_argument,       NULL, 'h'                       },
                 { "uuid",                  no_argument,       NULL, ARG_UUID                  },
                 { "prioritized-subsystem", required_argument, NULL, ARG_PRIORITIZED_SUBSYSTEM },
+                { "max-in-flight",         required_argument, NULL, ARG_MAX_IN_FLIGHT         },
+                { "reprobe",               no_argument,       NULL, ARG_REPROBE               },
                 {}
         };
         enum {
@@ -323,7 +399,7 @@ int trigger_main(int argc, char *argv[], void *userdata) {
         _cleanup_(sd_device_enumerator_unrefp) sd_device_enumerator *e = NULL;
         _cleanup_(sd_device_monitor_unrefp) sd_device_monitor *m = NULL;
         _cleanup_(sd_event_unrefp) sd_event *event = NULL;
-        _cleanup_set_free_ Set *settle_path_or_ids = NULL;
+        _cleanup_(settle_context_done) SettleContext settle = {};
         usec_t ping_timeout_usec = 5 * USEC_PER_SEC;
         bool ping = false;
         int c, r;
@@ -458,6 +534,10 @@ int trigger_main(int argc, char *argv[], void *userdata) {
                         arg_uuid = true;
                         break;
 
+                case ARG_REPROBE:
+                        arg_reprobe = true;
+                        break;
+
                 case ARG_PRIORITIZED_SUBSYSTEM: {
                         _cleanup_strv_free_ char **subsystems = NULL;
 
@@ -478,6 +558,11 @@ int trigger_main(int argc, char *argv[], void *userdata) {
                         if (r < 0)
                                 return log_error_errno(r, "Failed to set initialized filter: %m");
                         break;
+                case ARG_MAX_IN_FLIGHT:
+                        r = safe_atou(optarg, &arg_max_in_flight);
+                        if (r < 0)
+                                return log_error_errno(r, "Failed to parse --max-in-flight= value '%s': %m", optarg);
+                        break;
                 case 'V':
                         return print_version();
                 case 'h':
@@ -517,7 +602,7 @@ int trigger_main(int argc, char *argv[], void *userdata) {
                         return log_error_errno(r, "Failed to add parent match '%s': %m", argv[optind]);
         }
 
-        if (arg_settle) {
+        if (arg_settle || arg_max_in_flight > 0) {
                 r = sd_event_default(&event);
                 if (r < 0)
                         return log_error_errno(r, "Failed to get default event: %m");
@@ -530,7 +615,7 @@ int trigger_main(int argc, char *argv[], void *userdata) {
                 if (r < 0)
                         return log_error_errno(r, "Failed to attach event to device monitor: %m");
 
-                r = sd_device_monitor_start(m, device_monitor_handler, &settle_path_or_ids);
+                r = sd_device_monitor_start(m, device_monitor_handler, &settle);
                 if (r < 0)
                         return log_error_errno(r, "Failed to start device monitor: %m");
         }
@@ -555,14 +640,21 @@ int trigger_main(int argc, char *argv[], void *userdata) {
                 assert_not_reached();
         }
 
-        r = exec_list(e, action, arg_settle ? &settle_path_or_ids : NULL);
+        r = exec_list(e, action, event, event ? &settle : NULL);
         if (r < 0)
                 return r;
 
-        if (!set_isempty(settle_path_or_ids)) {
+        if (arg_settle && !set_isempty(settle.path_or_ids)) {
+                usec_t start_usec = now(CLOCK_MONOTONIC);
+                unsigned n_settled = settle.n_settled;
+
                 r = sd_event_loop(event);
                 if (r < 0)
                         return log_error_errno(r, "Event loop failed: %m");
+
+                log_debug("Waited %s for the remaining %u events to be processed.",
+                          FORMAT_TIMESPAN(usec_sub_unsigned(now(CLOCK_MONOTONIC), start_usec), USEC_PER_MSEC),
+                          settle.n_settled - n_settled);
         }
 
         return 0;
@@ -1892,6 +1892,25 @@ SUBSYSTEMS=="scsi", PROGRAM=="/bin/sh -c \"printf %%s 'foo1 foo2' | grep 'foo1 f
         LABEL="end"
         """),
 
+    Rules.new(
+        "GOTO test with lines of other subsystems and actions",
+        Device(
+            "/devices/pci0000:00/0000:00:1f.2/host0/target0:0:0/0:0:0:0/block/sda/sda1",
+            exp_links       = ["right", "right2"],
+            not_exp_links   = ["wrong", "wrong2", "wrong3"],
+        ),
+        rules = r"""
+        SUBSYSTEM=="block", GOTO="TEST"
+        SUBSYSTEM=="block", SYMLINK+="wrong"
+        LABEL="TEST"
+        SUBSYSTEM=="net", SYMLINK+="wrong2", LABEL="NET"
+        ACTION=="remove", SYMLINK+="wrong3"
+        SUBSYSTEM!="net", SYMLINK+="right", GOTO="NET2"
+        SUBSYSTEM=="block", SYMLINK+="wrong3"
+        SUBSYSTEM=="net", LABEL="NET2"
+        SUBSYSTEM=="block|tty", ACTION=="add", SYMLINK+="right2"
+        """),
+
     Rules.new(
         "GOTO label does not exist",
         Device(
@@ -0,0 +1,43 @@
+#!/usr/bin/env bash
+# SPDX-License-Identifier: LGPL-2.1-or-later
+set -eux
+set -o pipefail
+
+# Test StartTransientUnits(), i.e. creating multiple transient units in one call
+
+at_exit() {
+    set +e
+
+    systemctl stop test-bulk-one.service test-bulk-two.service
+}
+
+trap at_exit EXIT
+
+# The spec of the second unit is invalid (unknown property), but that must neither affect the units before
+# nor after it, and the failure must be reported in the reply.
+busctl call --json=short \
+    org.freedesktop.systemd1 /org/freedesktop/systemd1 \
+    org.freedesktop.systemd1.Manager StartTransientUnits \
+    "sa(sa(sv)a(sa(sv)))" replace 3 \
+      test-bulk-one.service 1 ExecStart "a(sasb)" 1 /usr/bin/sleep 2 /usr/bin/sleep infinity false 0 \
+      test-bulk-bad.service 2 Description s bad ThisPropertyDoesNotExist s foo 0 \
+      test-bulk-two.service 1 ExecStart "a(sasb)" 1 /usr/bin/sleep 2 /usr/bin/sleep infinity false 0 \
+      >/tmp/bulk-reply.json
+
+cat /tmp/bulk-reply.json
+
+jq -e '.data[0] | length == 3' /tmp/bulk-reply.json
+jq -e '.data[0][0][0] == "test-bulk-one.service" and .data[0][0][1] != "/" and .data[0][0][2] == ""' /tmp/bulk-reply.json
+jq -e '.data[0][1][0] == "test-bulk-bad.service" and .data[0][1][1] == "/" and .data[0][1][2] != ""' /tmp/bulk-reply.json
+jq -e '.data[0][2][0] == "test-bulk-two.service" and .data[0][2][1] != "/" and .data[0][2][2] == ""' /tmp/bulk-reply.json
+rm -f /tmp/bulk-reply.json
+
+timeout 30s bash -xec 'until systemctl is-active test-bulk-one.service test-bulk-two.service; do sleep .5; done'
+(! systemctl is-active test-bulk-bad.service)
+
+# Creating a unit that already exists must fail for that unit only
+busctl call --json=short \
+    org.freedesktop.systemd1 /org/freedesktop/systemd1 \
+    org.freedesktop.systemd1.Manager StartTransientUnits \
+    "sa(sa(sv)a(sa(sv)))" replace 1 \
+      test-bulk-one.service 0 0 | jq -e '.data[0][0][2] == "org.freedesktop.systemd1.UnitExists"'
@@ -195,6 +195,9 @@ udevadm trigger --action help /sys/class/net/$netdev
 udevadm trigger --prioritized-subsystem block
 udevadm trigger --prioritized-subsystem block,net
 udevadm trigger --prioritized-subsystem hello
+udevadm trigger --max-in-flight 2 -s net
+udevadm trigger --max-in-flight=2 --settle --prioritized-subsystem block
+(! udevadm trigger --max-in-flight=hello)
 udevadm trigger -s net
 udevadm trigger -S net
 udevadm trigger -a subsystem=net
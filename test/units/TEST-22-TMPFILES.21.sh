@@ -0,0 +1,34 @@
+#!/usr/bin/env bash
+# SPDX-License-Identifier: LGPL-2.1-or-later
+# Test --jobs=
+set -eux
+
+rm -rf /tmp/jobs
+mkdir /tmp/jobs
+
+for i in {1..20}; do
+    mkdir -p "/tmp/jobs/dir-$i/remove-me"
+    cat >>/tmp/jobs/config.conf <<EOF
+d /tmp/jobs/dir-$i 0755 - - -
+d /tmp/jobs/dir-$i/sub 0700 - - -
+f /tmp/jobs/dir-$i/sub/file 0644 - - - $i
+R /tmp/jobs/dir-$i/remove-*
+EOF
+done
+
+systemd-tmpfiles --create --remove --jobs=4 /tmp/jobs/config.conf
+
+for i in {1..20}; do
+    test "$(stat -c %a "/tmp/jobs/dir-$i")" = 755
+    test "$(stat -c %a "/tmp/jobs/dir-$i/sub")" = 700
+    test "$(cat "/tmp/jobs/dir-$i/sub/file")" = "$i"
+    test ! -e "/tmp/jobs/dir-$i/remove-me"
+done
+
+# Failures of any of the jobs are reported
+(! printf 'd /tmp/jobs/ok 0755 - - -\nf /proc/tmpfiles-jobs 0644 - - -\n' | systemd-tmpfiles --create --jobs=2 -)
+test -d /tmp/jobs/ok
+
+(! systemd-tmpfiles --create --jobs=0 /tmp/jobs/config.conf)
+
+rm -rf /tmp/jobs
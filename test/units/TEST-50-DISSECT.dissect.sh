@@ -693,6 +693,19 @@ systemd-dissect --no-pager /run/extensions/testkit.raw | grep -q '✓ sysext for
 systemd-sysext merge
 systemd-sysext status
 grep -q -F "MARKER_SYSEXT_123" /usr/lib/testfile
+# The time each extension took to set up is recorded, and the image is in the manifest now
+systemd-sysext status --json=short | jq -e '.[] | select(.hierarchy == "/usr") | .timing.testkit.mountUSec'
+jq -e '."/run/extensions/testkit.raw".release' /run/systemd/sysext-manifest.json
+systemd-sysext unmerge
+# Unchanged, hence taken from the manifest, and changed, hence read again
+systemd-sysext merge
+grep -q -F "MARKER_SYSEXT_123" /usr/lib/testfile
+systemd-sysext unmerge
+echo "MARKER_SYSEXT_456" >testkit/usr/lib/testfile
+mksquashfs testkit/ testkit.raw -noappend
+cp testkit.raw /run/extensions/
+systemd-sysext merge
+grep -q -F "MARKER_SYSEXT_456" /usr/lib/testfile
 systemd-sysext unmerge
 rm -rf /run/extensions/ testkit/
 
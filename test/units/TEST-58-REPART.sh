@@ -1307,6 +1307,76 @@ testcase_urandom() {
     [[ "$(sfdisk -q -l "$image" | grep -c "$image")" -eq 1 ]]
 }
 
+testcase_jobs() {
+    local workdir defs output drh hrh
+
+    workdir="$(mktemp --directory "/tmp/test-repart.jobs.XXXXXXXXXX")"
+    # shellcheck disable=SC2064
+    trap "rm -rf '${workdir:?}'" RETURN
+
+    defs="$workdir/defs"
+    mkdir "$defs"
+    dd if=/dev/urandom of="$workdir/data.raw" bs=1M count=16
+
+    tee "$defs/10-verity-data.conf" <<EOF
+[Partition]
+Type=root-${architecture}
+CopyBlocks=$workdir/data.raw
+Verity=data
+VerityMatchKey=root
+EOF
+
+    tee "$defs/11-verity-hash.conf" <<EOF
+[Partition]
+Type=root-${architecture}-verity
+Verity=hash
+VerityMatchKey=root
+SizeMinBytes=4M
+EOF
+
+    tee "$defs/20-home.conf" <<EOF
+[Partition]
+Type=home
+Format=ext4
+SizeMinBytes=32M
+EOF
+
+    tee "$defs/30-swap.conf" <<EOF
+[Partition]
+Type=swap
+Format=swap
+SizeMinBytes=8M
+EOF
+
+    # The same image, written one partition after the other and in parallel
+    for jobs in 1 3; do
+        output=$(systemd-repart --offline="$OFFLINE" \
+                                --definitions="$defs" \
+                                --seed="$seed" \
+                                --dry-run=no \
+                                --empty=create \
+                                --size=auto \
+                                --json=pretty \
+                                --jobs="$jobs" \
+                                "$workdir/image-$jobs.img")
+
+        drh=$(jq -r ".[] | select(.type == \"root-${architecture}\") | .roothash" <<<"$output")
+        hrh=$(jq -r ".[] | select(.type == \"root-${architecture}-verity\") | .roothash" <<<"$output")
+        assert_eq "$drh" "$hrh"
+
+        # Every partition written reports how long that took
+        [[ "$(jq '[.[] | select(.write_time != null)] | length' <<<"$output")" -eq 3 ]]
+
+        sfdisk --dump "$workdir/image-$jobs.img" | grep -v "^device:" | sed "s|$workdir/image-$jobs.img||" >"$workdir/table-$jobs"
+        echo "$drh" >"$workdir/roothash-$jobs"
+    done
+
+    cmp "$workdir/table-1" "$workdir/table-3"
+    cmp "$workdir/roothash-1" "$workdir/roothash-3"
+
+    (! systemd-repart --definitions="$defs" --jobs=0 "$workdir/image-1.img")
+}
+
 OFFLINE="yes"
 run_testcases
 
@@ -32,6 +32,11 @@ systemd-analyze plot --json=off --no-legend >/dev/null || :
 systemd-analyze plot --table >/dev/null || :
 systemd-analyze plot --table --no-legend >/dev/null || :
 (! systemd-analyze plot --global)
+systemd-analyze phases
+systemd-analyze phases --json=short
+systemd-analyze phases | grep units-load >/dev/null
+systemd-analyze phases | grep unit-files-parsed >/dev/null
+systemd-analyze --user phases >/dev/null || :
 # legacy/deprecated options (moved to systemctl, but still usable from analyze)
 systemd-analyze log-level
 systemd-analyze log-level "$(systemctl log-level)"
@@ -265,6 +265,36 @@ EOF
     update_now
     verify_version "$blockdev" "$sector_size" v4 2 4
 
+    # Create fifth version, which differs from the fourth only in the first 4K of the first partition, and
+    # publish a chunk index for it, so that only that part has to be downloaded, and the rest is copied
+    # from the partition the fourth version is installed in
+    new_version "$sector_size" v5
+    cp "$WORKDIR/source/part1-v4.raw" "$WORKDIR/source/part1-v5.raw"
+    dd if=/dev/urandom of="$WORKDIR/source/part1-v5.raw" bs=4096 count=1 conv=notrunc
+    (cd "$WORKDIR/source" && sha256sum uki* part* dir-*.tar.gz >SHA256SUMS)
+    {
+        echo "$(stat -c %s "$WORKDIR/source/part1-v5.raw") 4096"
+        split -b 4096 --filter='sha256sum | cut -d" " -f1' "$WORKDIR/source/part1-v5.raw"
+    } >"$WORKDIR/source/part1-v5.raw.chunks"
+
+    cat >"$WORKDIR/defs/01-first.conf" <<EOF
+[Source]
+Type=url-file
+Path=file://$WORKDIR/source
+MatchPattern=part1-@v.raw
+
+[Target]
+Type=partition
+Path=$blockdev
+MatchPattern=part1-@v
+MatchPartitionType=root-x86-64
+EOF
+
+    "$SYSUPDATE" --definitions="$WORKDIR/defs" --verify=no update |& tee "$WORKDIR/update.log"
+    grep "4K left to download" "$WORKDIR/update.log"
+    (! "$SYSUPDATE" --definitions="$WORKDIR/defs" --verify=no check-new)
+    verify_version "$blockdev" "$sector_size" v5 1 3
+
     # Cleanup
     [[ -b "$blockdev" ]] && losetup --detach "$blockdev"
     rm "$BACKING_FILE"
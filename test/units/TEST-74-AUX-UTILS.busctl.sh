@@ -46,6 +46,12 @@ busctl call -j \
 busctl call --verbose --timeout=60 --expect-reply=yes \
             org.freedesktop.systemd1 /org/freedesktop/systemd1 org.freedesktop.systemd1.Manager \
             ListUnitsByPatterns asas 1 "active" 2 "systemd-*.socket" "*.mount"
+busctl call --json=short \
+            org.freedesktop.systemd1 /org/freedesktop/systemd1 org.freedesktop.systemd1.Manager \
+            GetUnitProcessesWithLimit st "systemd-journald.service" 0 | jq -e '(.data[0] | length) == 0 and .data[1] >= 1'
+busctl call --json=short \
+            org.freedesktop.systemd1 /org/freedesktop/systemd1 org.freedesktop.systemd1.Manager \
+            GetUnitProcessesWithLimit st "systemd-journald.service" 1 | jq -e '(.data[0] | length) == 1'
 
 busctl emit /org/freedesktop/login1 org.freedesktop.login1.Manager \
             PrepareForSleep b false
@@ -70,6 +70,15 @@ rm /tmp/syncfifo1 /tmp/syncfifo2
 assert_eq "$(systemctl show TEST-80-BUSERROR.service -P StatusBusError)" "org.freedesktop.DBus.Error.UnknownObject"
 assert_in "D-Bus: org.freedesktop.DBus.Error.UnknownObject" "$(systemctl status TEST-80-BUSERROR.service)"
 
+# Send a burst of notifications, so that they are received in batches, and make sure the last one wins
+MYUNIT="burst$RANDOM.service"
+systemd-run -u "$MYUNIT" -p Type=notify -p NotifyAccess=all \
+    bash -c 'for i in {1..200}; do systemd-notify --status="Burst $i" WATCHDOG=1 & done; wait; systemd-notify --ready --status="Burst done"; exec sleep infinity'
+
+systemctl --quiet is-active "$MYUNIT"
+assert_eq "$(systemctl show "$MYUNIT" -P StatusText)" "Burst done"
+systemctl stop "$MYUNIT"
+
 # Now test basic fdstore behaviour
 
 MYSCRIPT="/tmp/myscript$RANDOM.sh"